@@ -23,6 +23,12 @@ else()
   set(DISABLE_CACHE_OBLIVIOUS "--disable-cache-oblivious")
 endif()
 
+if (NOT ENABLE_JEMALLOC_PROF)
+  set(JEMALLOC_ENABLE_PROF "")
+else()
+  set(JEMALLOC_ENABLE_PROF "--enable-prof")
+endif()
+
 include(cmake/utils.cmake)
 
 FetchContent_DeclareGitHubWithMirror(jemalloc
@@ -38,7 +44,8 @@ if(NOT jemalloc_POPULATED)
     WORKING_DIRECTORY ${jemalloc_SOURCE_DIR}
   )
   execute_process(COMMAND ${jemalloc_SOURCE_DIR}/configure CC=${CMAKE_C_COMPILER} -C --enable-autogen
-                    --disable-shared --disable-libdl ${DISABLE_CACHE_OBLIVIOUS} --with-jemalloc-prefix=""
+                    --disable-shared --disable-libdl ${DISABLE_CACHE_OBLIVIOUS} ${JEMALLOC_ENABLE_PROF}
+                    --with-jemalloc-prefix=""
     WORKING_DIRECTORY ${jemalloc_BINARY_DIR}
   )
   add_custom_target(make_jemalloc 
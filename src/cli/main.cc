@@ -169,7 +169,7 @@ int main(int argc, char *argv[]) {
 #endif
 
   engine::Storage storage(&config);
-  s = storage.Open();
+  s = storage.Open(config.secondary_db_dir.empty() ? kDBOpenModeDefault : kDBOpenModeAsSecondaryInstance);
   if (!s.IsOK()) {
     LOG(ERROR) << "Failed to open: " << s.Msg();
     return 1;
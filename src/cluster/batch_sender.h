@@ -23,17 +23,20 @@
 #include <rocksdb/rate_limiter.h>
 #include <rocksdb/write_batch.h>
 
+#include <memory>
+
 #include "status.h"
 
 class BatchSender {
  public:
   BatchSender() = default;
   BatchSender(int fd, size_t max_bytes, size_t bytes_per_sec)
-      : dst_fd_(fd),
-        max_bytes_(max_bytes),
-        bytes_per_sec_(bytes_per_sec),
-        rate_limiter_(std::unique_ptr<rocksdb::RateLimiter>(
-            rocksdb::NewGenericRateLimiter(static_cast<int64_t>(bytes_per_sec_)))) {}
+      : BatchSender(fd, max_bytes, bytes_per_sec,
+                    std::shared_ptr<rocksdb::RateLimiter>(
+                        rocksdb::NewGenericRateLimiter(static_cast<int64_t>(bytes_per_sec)))) {}
+  // The rate limiter may be shared by the concurrent senders to limit their total rate
+  BatchSender(int fd, size_t max_bytes, size_t bytes_per_sec, std::shared_ptr<rocksdb::RateLimiter> rate_limiter)
+      : dst_fd_(fd), max_bytes_(max_bytes), bytes_per_sec_(bytes_per_sec), rate_limiter_(std::move(rate_limiter)) {}
 
   ~BatchSender() = default;
 
@@ -67,5 +70,5 @@ class BatchSender {
   size_t max_bytes_;
 
   size_t bytes_per_sec_ = 0;  // 0 means no limit
-  std::unique_ptr<rocksdb::RateLimiter> rate_limiter_;
+  std::shared_ptr<rocksdb::RateLimiter> rate_limiter_;
 };
@@ -43,41 +43,47 @@ ClusterNode::ClusterNode(std::string id, std::string host, int port, int role, s
     : id(std::move(id)), host(std::move(host)), port(port), role(role), master_id(std::move(master_id)), slots(slots) {}
 
 Cluster::Cluster(Server *srv, std::vector<std::string> binds, int port)
-    : srv_(srv), binds_(std::move(binds)), port_(port) {
-  for (auto &slots_node : slots_nodes_) {
-    slots_node = nullptr;
-  }
-}
+    : srv_(srv), binds_(std::move(binds)), port_(port), topology_(std::make_shared<ClusterTopology>()) {}
 
-// We access cluster without lock, actually we guarantee data-safe by work threads
-// ReadWriteLockGuard, CLUSTER command doesn't have 'exclusive' attribute, i.e.
-// CLUSTER command can be executed concurrently, but some subcommand may change
-// cluster data, so these commands should be executed exclusively, and ReadWriteLock
-// also can guarantee accessing data is safe.
+// The routing table is an immutable snapshot which is published atomically, so the commands read
+// it without any lock, see ClusterTopology. CLUSTER command doesn't have 'exclusive' attribute, i.e.
+// CLUSTER command can be executed concurrently, and the topology changes are serialized by
+// topology_mu_, but some subcommands still need the exclusivity of the workers, e.g. SETNODEID
+// switches the replication relationship and IMPORT marks the connection as importing.
 bool Cluster::SubCommandIsExecExclusive(const std::string &subcommand) {
-  std::array subcommands = {"setnodes", "setnodeid", "setslot", "import", "reset"};
+  std::array subcommands = {"setnodeid", "import", "reset"};
 
   return std::any_of(std::begin(subcommands), std::end(subcommands),
                      [&subcommand](const std::string &val) { return util::EqualICase(val, subcommand); });
 }
 
+// The address of the master of this node in the topology, "-" if it's a master,
+// or empty if it isn't in the topology or its master isn't
+static std::string ReplicationOf(const ClusterTopology &topology) {
+  if (!topology.myself) return "";
+  if (topology.myself->role == kClusterMaster) return "-";
+  auto iter = topology.nodes.find(topology.myself->master_id);
+  if (iter == topology.nodes.end()) return "";
+  return fmt::format("{}:{}", iter->second->host, iter->second->port);
+}
+
 Status Cluster::SetNodeId(const std::string &node_id) {
   if (node_id.size() != kClusterNodeIdLen) {
     return {Status::ClusterInvalidInfo, errInvalidNodeID};
   }
 
-  myid_ = node_id;
-  // Already has cluster topology
-  if (version_ >= 0 && nodes_.find(node_id) != nodes_.end()) {
-    myself_ = nodes_[myid_];
-  } else {
-    myself_ = nullptr;
+  {
+    std::lock_guard<std::mutex> guard(topology_mu_);
+    auto topology = std::make_shared<ClusterTopology>(*loadTopology());
+    topology->myid = node_id;
+    // Already has cluster topology
+    auto iter = topology->nodes.find(node_id);
+    topology->myself = topology->version >= 0 && iter != topology->nodes.end() ? iter->second : nullptr;
+    publishTopology(std::move(topology));
   }
 
-  // Set replication relationship
-  if (myself_) return SetMasterSlaveRepl();
-
-  return Status::OK();
+  // Set replication relationship, SETNODEID is executed exclusively
+  return SetMasterSlaveRepl();
 }
 
 // The reason why the new version MUST be +1 of current version is that,
@@ -89,7 +95,9 @@ Status Cluster::SetNodeId(const std::string &node_id) {
 // updates since of network failure, it is state instead of operation.
 Status Cluster::SetSlotRanges(const std::vector<SlotRange> &slot_ranges, const std::string &node_id,
                               int64_t new_version) {
-  if (new_version <= 0 || new_version != version_ + 1) {
+  std::lock_guard<std::mutex> guard(topology_mu_);
+  auto current = loadTopology();
+  if (new_version <= 0 || new_version != current->version + 1) {
     return {Status::NotOK, errInvalidClusterVersion};
   }
 
@@ -98,17 +106,26 @@ Status Cluster::SetSlotRanges(const std::vector<SlotRange> &slot_ranges, const s
   }
 
   // Get the node which we want to assign slots into it
-  std::shared_ptr<ClusterNode> to_assign_node = nodes_[node_id];
-  if (to_assign_node == nullptr) {
+  auto node_iter = current->nodes.find(node_id);
+  if (node_iter == current->nodes.end() || node_iter->second == nullptr) {
     return {Status::NotOK, "No this node in the cluster"};
   }
 
-  if (to_assign_node->role != kClusterMaster) {
+  if (node_iter->second->role != kClusterMaster) {
     return {Status::NotOK, errNoMasterNode};
   }
 
   // Update version
-  version_ = new_version;
+  auto topology = std::make_shared<ClusterTopology>(*current);
+  topology->version = new_version;
+
+  // The nodes whose slots are changed are copied, since the published ones are immutable
+  std::map<const ClusterNode *, std::shared_ptr<ClusterNode>> copies;
+  auto copy_of = [&copies](const std::shared_ptr<ClusterNode> &node) {
+    auto &copy = copies[node.get()];
+    if (!copy) copy = std::make_shared<ClusterNode>(*node);
+    return copy;
+  };
 
   // Update topology
   //  1. Remove the slot from old node if existing
@@ -116,34 +133,45 @@ Status Cluster::SetSlotRanges(const std::vector<SlotRange> &slot_ranges, const s
   //  3. Update the map of slots to nodes.
   // remember: The atomicity of the process is based on
   // the transactionality of ClearKeysOfSlotRange().
+  const auto &to_assign_node = node_iter->second;
   engine::Context ctx(srv_->storage);
   for (auto [s_start, s_end] : slot_ranges) {
     for (int slot = s_start; slot <= s_end; slot++) {
-      std::shared_ptr<ClusterNode> old_node = slots_nodes_[slot];
+      const auto &old_node = current->slots_nodes[slot];
       if (old_node != nullptr) {
-        old_node->slots[slot] = false;
+        copy_of(old_node)->slots[slot] = false;
       }
-      to_assign_node->slots[slot] = true;
-      slots_nodes_[slot] = to_assign_node;
+      copy_of(to_assign_node)->slots[slot] = true;
+      topology->slots_nodes[slot] = to_assign_node;
 
       // Clear data of migrated slot or record of imported slot
-      if (old_node == myself_ && old_node != to_assign_node) {
+      if (old_node == current->myself && old_node != to_assign_node) {
         // If slot is migrated from this node
-        if (migrated_slots_.count(slot) > 0) {
+        if (topology->migrated_slots.count(slot) > 0) {
           auto s = srv_->slot_migrator->ClearKeysOfSlotRange(ctx, kDefaultNamespace, SlotRange::GetPoint(slot));
           if (!s.ok()) {
             LOG(ERROR) << "failed to clear data of migrated slot: " << s.ToString();
           }
-          migrated_slots_.erase(slot);
+          topology->migrated_slots.erase(slot);
         }
         // If slot is imported into this node
-        if (imported_slots_.count(slot) > 0) {
-          imported_slots_.erase(slot);
+        if (topology->imported_slots.count(slot) > 0) {
+          topology->imported_slots.erase(slot);
         }
       }
     }
   }
 
+  // Replace the changed nodes with their copies
+  auto replace = [&copies](std::shared_ptr<ClusterNode> &node) {
+    if (!node) return;
+    if (auto iter = copies.find(node.get()); iter != copies.end()) node = iter->second;
+  };
+  for (auto &node : topology->slots_nodes) replace(node);
+  for (auto &[_, node] : topology->nodes) replace(node);
+  replace(topology->myself);
+
+  publishTopology(std::move(topology));
   return Status::OK();
 }
 
@@ -152,70 +180,70 @@ Status Cluster::SetSlotRanges(const std::vector<SlotRange> &slot_ranges, const s
 Status Cluster::SetClusterNodes(const std::string &nodes_str, int64_t version, bool force) {
   if (version < 0) return {Status::NotOK, errInvalidClusterVersion};
 
+  std::lock_guard<std::mutex> guard(topology_mu_);
+  auto current = loadTopology();
   if (!force) {
     // Low version wants to reset current version
-    if (version_ > version) {
+    if (current->version > version) {
       return {Status::NotOK, errInvalidClusterVersion};
     }
 
     // The same version, it is not needed to update
-    if (version_ == version) return Status::OK();
+    if (current->version == version) return Status::OK();
   }
 
-  ClusterNodes nodes;
+  // The new topology is built off to the side, the commands still route by the current one
+  auto topology = std::make_shared<ClusterTopology>();
   std::unordered_map<int, std::string> slots_nodes;
-  Status s = parseClusterNodes(nodes_str, &nodes, &slots_nodes);
+  Status s = parseClusterNodes(nodes_str, &topology->nodes, &slots_nodes);
   if (!s.IsOK()) return s;
 
   // Update version and cluster topology
-  version_ = version;
-  nodes_ = nodes;
-  size_ = 0;
-
-  // Update slots to nodes
-  for (const auto &[slot, node_id] : slots_nodes) {
-    slots_nodes_[slot] = nodes_[node_id];
-  }
+  topology->version = version;
+  topology->myid = current->myid;
 
   // Update replicas info and size
-  for (const auto &[node_id, node] : nodes_) {
+  auto &nodes = topology->nodes;
+  for (const auto &[node_id, node] : nodes) {
     if (node->role == kClusterSlave) {
-      if (nodes_.find(node->master_id) != nodes_.end()) {
-        nodes_[node->master_id]->replicas.push_back(node_id);
+      if (nodes.find(node->master_id) != nodes.end()) {
+        nodes[node->master_id]->replicas.push_back(node_id);
       }
     }
     if (node->role == kClusterMaster && node->slots.count() > 0) {
-      size_++;
+      topology->size++;
     }
   }
 
-  if (myid_.empty() || force) {
-    for (const auto &[node_id, node] : nodes_) {
+  // Keep the unchanged nodes of the current topology, so that only the changed entries are replaced
+  for (auto &[node_id, node] : nodes) {
+    auto iter = current->nodes.find(node_id);
+    if (iter != current->nodes.end() && *iter->second == *node) node = iter->second;
+  }
+
+  // Update slots to nodes
+  for (const auto &[slot, node_id] : slots_nodes) {
+    topology->slots_nodes[slot] = nodes[node_id];
+  }
+
+  if (topology->myid.empty() || force) {
+    for (const auto &[node_id, node] : nodes) {
       if (node->port == port_ && util::MatchListeningIP(binds_, node->host)) {
-        myid_ = node_id;
+        topology->myid = node_id;
         break;
       }
     }
   }
 
-  myself_ = nullptr;
-  if (!myid_.empty() && nodes_.find(myid_) != nodes_.end()) {
-    myself_ = nodes_[myid_];
-  }
-
-  // Set replication relationship
-  if (myself_) {
-    s = SetMasterSlaveRepl();
-    if (!s.IsOK()) {
-      return s.Prefixed("failed to set master-replica replication");
-    }
+  if (!topology->myid.empty() && nodes.find(topology->myid) != nodes.end()) {
+    topology->myself = nodes[topology->myid];
   }
 
-  // Clear data of migrated slots
-  if (!migrated_slots_.empty()) {
+  // Clear data of migrated slots, they're still moved by the current topology
+  if (!current->migrated_slots.empty()) {
     engine::Context ctx(srv_->storage);
-    for (const auto &[slot, _] : migrated_slots_) {
-      if (slots_nodes_[slot] != myself_) {
+    for (const auto &[slot, _] : current->migrated_slots) {
+      if (topology->slots_nodes[slot] != topology->myself) {
         auto s = srv_->slot_migrator->ClearKeysOfSlotRange(ctx, kDefaultNamespace, SlotRange::GetPoint(slot));
         if (!s.ok()) {
           LOG(ERROR) << "failed to clear data of migrated slots: " << s.ToString();
@@ -223,29 +251,38 @@ Status Cluster::SetClusterNodes(const std::string &nodes_str, int64_t version, b
       }
     }
   }
-  // Clear migrated and imported slot info
-  migrated_slots_.clear();
-  imported_slots_.clear();
 
+  // Set replication relationship by the cron if it's changed, since it needs the exclusivity of the workers
+  auto replication = ReplicationOf(*topology);
+  if (!replication.empty() && replication != ReplicationOf(*current)) {
+    repl_switch_pending_ = true;
+  }
+
+  // The migrated and imported slot info is cleared in the new topology
+  publishTopology(std::move(topology));
   return Status::OK();
 }
 
 // Set replication relationship by cluster topology setting
 Status Cluster::SetMasterSlaveRepl() {
+  repl_switch_pending_ = false;
+
   if (!srv_) return Status::OK();
 
-  if (!myself_) return Status::OK();
+  auto topology = loadTopology();
+  const auto &myself = topology->myself;
+  if (!myself) return Status::OK();
 
-  if (myself_->role == kClusterMaster) {
+  if (myself->role == kClusterMaster) {
     // Master mode
     auto s = srv_->RemoveMaster();
     if (!s.IsOK()) {
       return s.Prefixed("failed to remove master");
     }
     LOG(INFO) << "MASTER MODE enabled by cluster topology setting";
-  } else if (nodes_.find(myself_->master_id) != nodes_.end()) {
+  } else if (auto iter = topology->nodes.find(myself->master_id); iter != topology->nodes.end()) {
     // Replica mode and master node is existing
-    std::shared_ptr<ClusterNode> master = nodes_[myself_->master_id];
+    const auto &master = iter->second;
     auto s = srv_->AddMaster(master->host, master->port, false);
     if (!s.IsOK()) {
       LOG(WARNING) << "SLAVE OF " << master->host << ":" << master->port
@@ -258,7 +295,10 @@ Status Cluster::SetMasterSlaveRepl() {
   return Status::OK();
 }
 
-bool Cluster::IsNotMaster() { return myself_ == nullptr || myself_->role != kClusterMaster || srv_->IsSlave(); }
+bool Cluster::IsNotMaster() {
+  auto myself = loadTopology()->myself;
+  return myself == nullptr || myself->role != kClusterMaster || srv_->IsSlave();
+}
 
 Status Cluster::SetSlotRangeMigrated(const SlotRange &slot_range, const std::string &ip_port) {
   if (!slot_range.IsValid()) {
@@ -266,12 +306,15 @@ Status Cluster::SetSlotRangeMigrated(const SlotRange &slot_range, const std::str
   }
 
   // It is called by slot-migrating thread which is an asynchronous thread.
-  // Therefore, it should be locked when a record is added to 'migrated_slots_'
-  // which will be accessed when executing commands.
+  // The commands routed by the previous topology may still write the migrated slots,
+  // so it should wait for them before the slots are moved to the destination node.
   auto exclusivity = srv_->WorkExclusivityGuard();
+  std::lock_guard<std::mutex> guard(topology_mu_);
+  auto topology = std::make_shared<ClusterTopology>(*loadTopology());
   for (auto slot = slot_range.start; slot <= slot_range.end; slot++) {
-    migrated_slots_[slot] = ip_port;
+    topology->migrated_slots[slot] = ip_port;
   }
+  publishTopology(std::move(topology));
   return Status::OK();
 }
 
@@ -282,15 +325,20 @@ Status Cluster::SetSlotRangeImported(const SlotRange &slot_range) {
 
   // It is called by command 'cluster import'. When executing the command, the
   // exclusive lock has been locked. Therefore, it can't be locked again.
+  std::lock_guard<std::mutex> guard(topology_mu_);
+  auto topology = std::make_shared<ClusterTopology>(*loadTopology());
   for (auto slot = slot_range.start; slot <= slot_range.end; slot++) {
-    imported_slots_.insert(slot);
+    topology->imported_slots.insert(slot);
   }
+  publishTopology(std::move(topology));
   return Status::OK();
 }
 
 Status Cluster::MigrateSlotRange(const SlotRange &slot_range, const std::string &dst_node_id,
                                  SyncMigrateContext *blocking_ctx) {
-  if (nodes_.find(dst_node_id) == nodes_.end()) {
+  auto topology = loadTopology();
+  auto dst_iter = topology->nodes.find(dst_node_id);
+  if (dst_iter == topology->nodes.end()) {
     return {Status::NotOK, "Can't find the destination node id"};
   }
 
@@ -298,13 +346,14 @@ Status Cluster::MigrateSlotRange(const SlotRange &slot_range, const std::string
     return {Status::NotOK, errSlotRangeInvalid};
   }
 
-  if (!migrated_slots_.empty() &&
-      slot_range.HasOverlap({migrated_slots_.begin()->first, migrated_slots_.rbegin()->first})) {
+  const auto &migrated_slots = topology->migrated_slots;
+  if (!migrated_slots.empty() &&
+      slot_range.HasOverlap({migrated_slots.begin()->first, migrated_slots.rbegin()->first})) {
     return {Status::NotOK, "Can't migrate slot which has been migrated"};
   }
 
   for (auto slot = slot_range.start; slot <= slot_range.end; slot++) {
-    if (slots_nodes_[slot] != myself_) {
+    if (topology->slots_nodes[slot] != topology->myself) {
       return {Status::NotOK, "Can't migrate slot which doesn't belong to me"};
     }
   }
@@ -313,15 +362,15 @@ Status Cluster::MigrateSlotRange(const SlotRange &slot_range, const std::string
     return {Status::NotOK, "Slave can't migrate slot"};
   }
 
-  if (nodes_[dst_node_id]->role != kClusterMaster) {
+  const auto &dst = dst_iter->second;
+  if (dst->role != kClusterMaster) {
     return {Status::NotOK, "Can't migrate slot to a slave"};
   }
 
-  if (nodes_[dst_node_id] == myself_) {
+  if (dst == topology->myself) {
     return {Status::NotOK, "Can't migrate slot to myself"};
   }
 
-  const auto &dst = nodes_[dst_node_id];
   Status s =
       srv_->slot_migrator->PerformSlotRangeMigration(dst_node_id, dst->host, dst->port, slot_range, blocking_ctx);
   return s;
@@ -336,9 +385,10 @@ Status Cluster::ImportSlotRange(redis::Connection *conn, const SlotRange &slot_r
     return {Status::NotOK, errSlotRangeInvalid};
   }
 
+  auto topology = loadTopology();
   for (auto slot = slot_range.start; slot <= slot_range.end; slot++) {
-    auto source_node = srv_->cluster->slots_nodes_[slot];
-    if (source_node && source_node->id == myid_) {
+    const auto &source_node = topology->slots_nodes[slot];
+    if (source_node && source_node->id == topology->myid) {
       return {Status::NotOK, "Can't import slot which belongs to me"};
     }
   }
@@ -351,15 +401,14 @@ Status Cluster::ImportSlotRange(redis::Connection *conn, const SlotRange &slot_r
 
       // Set link importing
       conn->SetImporting();
-      myself_->importing_slot_range = slot_range;
       // Set link error callback
       conn->close_cb = [object_ptr = srv_->slot_import.get(), slot_range]([[maybe_unused]] int fd) {
-        auto s = object_ptr->StopForLinkError();
+        auto s = object_ptr->StopForLinkError(slot_range);
         if (!s.IsOK()) {
           LOG(ERROR) << fmt::format("[import] Failed to stop importing slot(s) {}: {}", slot_range.String(), s.Msg());
         }
       };  // Stop forbidding writing slot to accept write commands
-      if (slot_range == srv_->slot_migrator->GetForbiddenSlotRange()) srv_->slot_migrator->ReleaseForbiddenSlotRange();
+      srv_->slot_migrator->ReleaseForbiddenSlotRange(slot_range);
       LOG(INFO) << fmt::format("[import] Start importing slot(s) {}", slot_range.String());
       break;
     case kImportSuccess:
@@ -380,14 +429,15 @@ Status Cluster::ImportSlotRange(redis::Connection *conn, const SlotRange &slot_r
 }
 
 Status Cluster::GetClusterInfo(std::string *cluster_infos) {
-  if (version_ < 0) {
+  auto topology = loadTopology();
+  if (topology->version < 0) {
     return {Status::RedisClusterDown, errClusterNoInitialized};
   }
 
   cluster_infos->clear();
 
   int ok_slot = 0;
-  for (auto &slots_node : slots_nodes_) {
+  for (const auto &slots_node : topology->slots_nodes) {
     if (slots_node != nullptr) ok_slot++;
   }
 
@@ -402,18 +452,18 @@ Status Cluster::GetClusterInfo(std::string *cluster_infos) {
       "cluster_slots_pfail:0\r\n"
       "cluster_slots_fail:0\r\n"
       "cluster_known_nodes:" +
-      std::to_string(nodes_.size()) +
+      std::to_string(topology->nodes.size()) +
       "\r\n"
       "cluster_size:" +
-      std::to_string(size_) +
+      std::to_string(topology->size) +
       "\r\n"
       "cluster_current_epoch:" +
-      std::to_string(version_) +
+      std::to_string(topology->version) +
       "\r\n"
       "cluster_my_epoch:" +
-      std::to_string(version_) + "\r\n";
+      std::to_string(topology->version) + "\r\n";
 
-  if (myself_ != nullptr && myself_->role == kClusterMaster && !srv_->IsSlave()) {
+  if (topology->myself != nullptr && topology->myself->role == kClusterMaster && !srv_->IsSlave()) {
     // Get migrating status
     std::string migrate_infos;
     srv_->slot_migrator->GetMigrationInfo(&migrate_infos);
@@ -438,7 +488,8 @@ Status Cluster::GetClusterInfo(std::string *cluster_infos) {
 //               3) node ID
 //          ... continued until done
 Status Cluster::GetSlotsInfo(std::vector<SlotInfo> *slots_infos) {
-  if (version_ < 0) {
+  auto topology = loadTopology();
+  if (topology->version < 0) {
     return {Status::RedisClusterDown, errClusterNoInitialized};
   }
 
@@ -450,15 +501,15 @@ Status Cluster::GetSlotsInfo(std::vector<SlotInfo> *slots_infos) {
     // Find start node and slot id
     if (n == nullptr) {
       if (i == kClusterSlots) break;
-      n = slots_nodes_[i];
+      n = topology->slots_nodes[i];
       start = i;
       continue;
     }
     // Generate slots info when occur different node with start or end of slot
-    if (i == kClusterSlots || n != slots_nodes_[i]) {
-      slots_infos->emplace_back(genSlotNodeInfo(start, i - 1, n));
+    if (i == kClusterSlots || n != topology->slots_nodes[i]) {
+      slots_infos->emplace_back(genSlotNodeInfo(*topology, start, i - 1, n));
       if (i == kClusterSlots) break;
-      n = slots_nodes_[i];
+      n = topology->slots_nodes[i];
       start = i;
     }
   }
@@ -466,13 +517,15 @@ Status Cluster::GetSlotsInfo(std::vector<SlotInfo> *slots_infos) {
   return Status::OK();
 }
 
-SlotInfo Cluster::genSlotNodeInfo(int start, int end, const std::shared_ptr<ClusterNode> &n) {
+SlotInfo Cluster::genSlotNodeInfo(const ClusterTopology &topology, int start, int end,
+                                  const std::shared_ptr<ClusterNode> &n) {
   std::vector<SlotInfo::NodeInfo> vn;
   vn.push_back({n->host, n->port, n->id});  // itself
 
   for (const auto &id : n->replicas) {  // replicas
-    if (nodes_.find(id) == nodes_.end()) continue;
-    vn.push_back({nodes_[id]->host, nodes_[id]->port, nodes_[id]->id});
+    auto iter = topology.nodes.find(id);
+    if (iter == topology.nodes.end()) continue;
+    vn.push_back({iter->second->host, iter->second->port, iter->second->id});
   }
 
   return {start, end, vn};
@@ -481,21 +534,24 @@ SlotInfo Cluster::genSlotNodeInfo(int start, int end, const std::shared_ptr<Clus
 // $node $host:$port@$cport $role $master_id/$- $ping_sent $ping_received
 // $version $connected $slot_range
 Status Cluster::GetClusterNodes(std::string *nodes_str) {
-  if (version_ < 0) {
+  auto topology = loadTopology();
+  if (topology->version < 0) {
     return {Status::RedisClusterDown, errClusterNoInitialized};
   }
 
-  *nodes_str = genNodesDescription();
+  *nodes_str = genNodesDescription(*topology);
   return Status::OK();
 }
 
 StatusOr<std::string> Cluster::GetReplicas(const std::string &node_id) {
-  if (version_ < 0) {
+  auto topology = loadTopology();
+  if (topology->version < 0) {
     return {Status::RedisClusterDown, errClusterNoInitialized};
   }
 
-  auto item = nodes_.find(node_id);
-  if (item == nodes_.end()) {
+  const auto &nodes = topology->nodes;
+  auto item = nodes.find(node_id);
+  if (item == nodes.end()) {
     return {Status::InvalidArgument, errInvalidNodeID};
   }
 
@@ -507,8 +563,8 @@ StatusOr<std::string> Cluster::GetReplicas(const std::string &node_id) {
   auto now = util::GetTimeStampMS();
   std::string replicas_desc;
   for (const auto &replica_id : node->replicas) {
-    auto n = nodes_.find(replica_id);
-    if (n == nodes_.end()) {
+    auto n = nodes.find(replica_id);
+    if (n == nodes.end()) {
       continue;
     }
 
@@ -523,7 +579,7 @@ StatusOr<std::string> Cluster::GetReplicas(const std::string &node_id) {
     node_str.append(fmt::format("slave {} ", node_id));
 
     // Ping sent, pong received, config epoch, link status
-    node_str.append(fmt::format("{} {} {} connected", now - 1, now, version_));
+    node_str.append(fmt::format("{} {} {} connected", now - 1, now, topology->version));
 
     replicas_desc.append(node_str + "\n");
   }
@@ -531,24 +587,24 @@ StatusOr<std::string> Cluster::GetReplicas(const std::string &node_id) {
   return replicas_desc;
 }
 
-std::string Cluster::getNodeIDBySlot(int slot) const {
-  if (slot < 0 || slot >= kClusterSlots || !slots_nodes_[slot]) return "";
-  return slots_nodes_[slot]->id;
+std::string Cluster::getNodeIDBySlot(const ClusterTopology &topology, int slot) {
+  if (slot < 0 || slot >= kClusterSlots || !topology.slots_nodes[slot]) return "";
+  return topology.slots_nodes[slot]->id;
 }
 
-std::string Cluster::genNodesDescription() {
-  auto slots_infos = getClusterNodeSlots();
+std::string Cluster::genNodesDescription(const ClusterTopology &topology) {
+  auto slots_infos = getClusterNodeSlots(topology);
 
   auto now = util::GetTimeStampMS();
   std::string nodes_desc;
-  for (const auto &[_, node] : nodes_) {
+  for (const auto &[_, node] : topology.nodes) {
     std::string node_str;
     // ID, host, port
     node_str.append(node->id + " ");
     node_str.append(fmt::format("{}:{}@{} ", node->host, node->port, node->port + kClusterPortIncr));
 
     // Flags
-    if (node->id == myid_) node_str.append("myself,");
+    if (node->id == topology.myid) node_str.append("myself,");
     if (node->role == kClusterMaster) {
       node_str.append("master - ");
     } else {
@@ -556,7 +612,7 @@ std::string Cluster::genNodesDescription() {
     }
 
     // Ping sent, pong received, config epoch, link status
-    node_str.append(fmt::format("{} {} {} connected", now - 1, now, version_));
+    node_str.append(fmt::format("{} {} {} connected", now - 1, now, topology.version));
 
     if (node->role == kClusterMaster) {
       auto iter = slots_infos.find(node->id);
@@ -566,18 +622,17 @@ std::string Cluster::genNodesDescription() {
     }
 
     // Just for MYSELF node to show the importing/migrating slot
-    if (node->id == myid_) {
+    if (node->id == topology.myid) {
       if (srv_->slot_migrator) {
-        auto migrating_slot_range = srv_->slot_migrator->GetMigratingSlotRange();
-        if (migrating_slot_range.IsValid()) {
-          node_str.append(fmt::format(" [{}->-{}]", migrating_slot_range.String(), srv_->slot_migrator->GetDstNode()));
+        for (const auto &[migrating_slot_range, dst_node] : srv_->slot_migrator->GetMigratingSlotRanges()) {
+          node_str.append(fmt::format(" [{}->-{}]", migrating_slot_range.String(), dst_node));
         }
       }
       if (srv_->slot_import) {
-        auto importing_slot_range = srv_->slot_import->GetSlotRange();
-        if (importing_slot_range.IsValid()) {
+        for (const auto &importing_slot_range : srv_->slot_import->GetSlotRanges()) {
           node_str.append(
-              fmt::format(" [{}-<-{}]", importing_slot_range.String(), getNodeIDBySlot(importing_slot_range.start)));
+              fmt::format(" [{}-<-{}]", importing_slot_range.String(),
+                          getNodeIDBySlot(topology, importing_slot_range.start)));
         }
       }
     }
@@ -586,7 +641,7 @@ std::string Cluster::genNodesDescription() {
   return nodes_desc;
 }
 
-std::map<std::string, std::string, std::less<>> Cluster::getClusterNodeSlots() const {
+std::map<std::string, std::string, std::less<>> Cluster::getClusterNodeSlots(const ClusterTopology &topology) {
   int start = -1;
   // node id => slots info string
   std::map<std::string, std::string, std::less<>> slots_infos;
@@ -596,19 +651,19 @@ std::map<std::string, std::string, std::less<>> Cluster::getClusterNodeSlots() c
     // Find start node and slot id
     if (n == nullptr) {
       if (i == kClusterSlots) break;
-      n = slots_nodes_[i];
+      n = topology.slots_nodes[i];
       start = i;
       continue;
     }
     // Generate slots info when occur different node with start or end of slot
-    if (i == kClusterSlots || n != slots_nodes_[i]) {
+    if (i == kClusterSlots || n != topology.slots_nodes[i]) {
       if (start == i - 1) {
         slots_infos[n->id] += fmt::format("{} ", start);
       } else {
         slots_infos[n->id] += fmt::format("{}-{} ", start, i - 1);
       }
       if (i == kClusterSlots) break;
-      n = slots_nodes_[i];
+      n = topology.slots_nodes[i];
       start = i;
     }
   }
@@ -619,11 +674,11 @@ std::map<std::string, std::string, std::less<>> Cluster::getClusterNodeSlots() c
   return slots_infos;
 }
 
-std::string Cluster::genNodesInfo() const {
-  auto slots_infos = getClusterNodeSlots();
+std::string Cluster::genNodesInfo(const ClusterTopology &topology) {
+  auto slots_infos = getClusterNodeSlots(topology);
 
   std::string nodes_info;
-  for (const auto &[_, node] : nodes_) {
+  for (const auto &[_, node] : topology.nodes) {
     std::string node_str;
     node_str.append("node ");
     // ID
@@ -654,10 +709,11 @@ Status Cluster::DumpClusterNodes(const std::string &file) {
   // Parse and validate the cluster nodes string before dumping into file
   std::string tmp_path = file + ".tmp";
   remove(tmp_path.data());
+  auto topology = loadTopology();
   std::ofstream output_file(tmp_path, std::ios::out);
-  output_file << fmt::format("version {}\n", version_);
-  output_file << fmt::format("id {}\n", myid_);
-  output_file << genNodesInfo();
+  output_file << fmt::format("version {}\n", topology->version);
+  output_file << fmt::format("id {}\n", topology->myid);
+  output_file << genNodesInfo(*topology);
   output_file.close();
   if (rename(tmp_path.data(), file.data()) < 0) {
     return {Status::NotOK, fmt::format("rename file encounter error: {}", strerror(errno))};
@@ -705,8 +761,16 @@ Status Cluster::LoadClusterNodes(const std::string &file_path) {
     }
   }
 
-  myid_ = id;
-  return SetClusterNodes(nodes_info, version, false);
+  {
+    std::lock_guard<std::mutex> guard(topology_mu_);
+    auto topology = std::make_shared<ClusterTopology>(*loadTopology());
+    topology->myid = id;
+    publishTopology(std::move(topology));
+  }
+  GET_OR_RET(SetClusterNodes(nodes_info, version, false));
+  // It's loaded before the workers are started, so the replication relationship is set directly
+  if (HasPendingReplicationSwitch()) return SetMasterSlaveRepl();
+  return Status::OK();
 }
 
 Status Cluster::parseClusterNodes(const std::string &nodes_str, ClusterNodes *nodes,
@@ -827,7 +891,7 @@ Status Cluster::parseClusterNodes(const std::string &nodes_str, ClusterNodes *no
 }
 
 bool Cluster::IsWriteForbiddenSlot(int slot) const {
-  return srv_->slot_migrator->GetForbiddenSlotRange().Contains(slot);
+  return srv_->slot_migrator->IsWriteForbiddenSlot(slot);
 }
 
 Status Cluster::CanExecByMySelf(const redis::CommandAttributes *attributes, const std::vector<std::string> &cmd_tokens,
@@ -852,15 +916,19 @@ Status Cluster::CanExecByMySelf(const redis::CommandAttributes *attributes, cons
   }
   if (slot == -1) return Status::OK();
 
-  if (slots_nodes_[slot] == nullptr) {
+  // All the checks are against the same snapshot, which may be replaced by a topology change meanwhile
+  auto topology = loadTopology();
+  const auto &myself = topology->myself;
+  const auto &slot_node = topology->slots_nodes[slot];
+  if (slot_node == nullptr) {
     return {Status::RedisClusterDown, "Hash slot not served"};
   }
 
   bool cross_slot_ok = false;
   if (script_run_ctx) {
     if (script_run_ctx->current_slot != -1 && script_run_ctx->current_slot != slot) {
-      if (getNodeIDBySlot(script_run_ctx->current_slot) != getNodeIDBySlot(slot)) {
-        return {Status::RedisMoved, fmt::format("{} {}:{}", slot, slots_nodes_[slot]->host, slots_nodes_[slot]->port)};
+      if (getNodeIDBySlot(*topology, script_run_ctx->current_slot) != getNodeIDBySlot(*topology, slot)) {
+        return {Status::RedisMoved, fmt::format("{} {}:{}", slot, slot_node->host, slot_node->port)};
       }
       if (!(script_run_ctx->flags & lua::ScriptFlagType::kScriptAllowCrossSlotKeys)) {
         return {Status::RedisCrossSlot, "Script attempted to access keys that do not hash to the same slot"};
@@ -871,12 +939,13 @@ Status Cluster::CanExecByMySelf(const redis::CommandAttributes *attributes, cons
     cross_slot_ok = true;
   }
 
-  if (myself_ && myself_ == slots_nodes_[slot]) {
+  if (myself && myself == slot_node) {
     // We use central controller to manage the topology of the cluster.
     // Server can't change the topology directly, so we record the migrated slots
     // to move the requests of the migrated slots to the destination node.
-    if (migrated_slots_.count(slot) > 0) {  // I'm not serving the migrated slot
-      return {Status::RedisMoved, fmt::format("{} {}", slot, migrated_slots_[slot])};
+    if (auto iter = topology->migrated_slots.find(slot); iter != topology->migrated_slots.end()) {
+      // I'm not serving the migrated slot
+      return {Status::RedisMoved, fmt::format("{} {}", slot, iter->second)};
     }
     // To keep data consistency, slot will be forbidden write while sending the last incremental data.
     // During this phase, the requests of the migrating slot has to be rejected.
@@ -887,8 +956,8 @@ Status Cluster::CanExecByMySelf(const redis::CommandAttributes *attributes, cons
     return Status::OK();  // I'm serving this slot
   }
 
-  if (myself_ && myself_->importing_slot_range.Contains(slot) &&
-      (conn->IsImporting() || conn->IsFlagEnabled(redis::Connection::kAsking))) {
+  if (myself && (conn->IsImporting() || conn->IsFlagEnabled(redis::Connection::kAsking)) &&
+      srv_->slot_import->IsImportingSlot(slot)) {
     // While data migrating, the topology of the destination node has not been changed.
     // The destination node has to serve the requests from the migrating slot,
     // although the slot is not belong to itself. Therefore, we record the importing slot
@@ -896,21 +965,23 @@ Status Cluster::CanExecByMySelf(const redis::CommandAttributes *attributes, cons
     return Status::OK();  // I'm serving the importing connection or asking connection
   }
 
-  if (myself_ && imported_slots_.count(slot)) {
+  if (myself && topology->imported_slots.count(slot)) {
     // After the slot is migrated, new requests of the migrated slot will be moved to
     // the destination server. Before the central controller change the topology, the destination
     // server should record the imported slots to accept new data of the imported slots.
     return Status::OK();  // I'm serving the imported slot
   }
 
-  if (myself_ && myself_->role == kClusterSlave && !(attributes->flags & redis::kCmdWrite) &&
-      nodes_.find(myself_->master_id) != nodes_.end() && nodes_[myself_->master_id] == slots_nodes_[slot] &&
+  if (myself && myself->role == kClusterSlave && !(attributes->flags & redis::kCmdWrite) &&
       conn->IsFlagEnabled(redis::Connection::kReadOnly)) {
-    return Status::OK();  // My master is serving this slot
+    auto master_iter = topology->nodes.find(myself->master_id);
+    if (master_iter != topology->nodes.end() && master_iter->second == slot_node) {
+      return Status::OK();  // My master is serving this slot
+    }
   }
 
   if (!cross_slot_ok) {
-    return {Status::RedisMoved, fmt::format("{} {}:{}", slot, slots_nodes_[slot]->host, slots_nodes_[slot]->port)};
+    return {Status::RedisMoved, fmt::format("{} {}:{}", slot, slot_node->host, slot_node->port)};
   }
 
   return Status::OK();
@@ -919,10 +990,10 @@ Status Cluster::CanExecByMySelf(const redis::CommandAttributes *attributes, cons
 // Only HARD mode is meaningful to the Kvrocks cluster,
 // so it will force clearing all information after resetting.
 Status Cluster::Reset() {
-  if (srv_->slot_migrator && srv_->slot_migrator->GetMigratingSlotRange().IsValid()) {
+  if (srv_->slot_migrator && !srv_->slot_migrator->GetMigratingSlotRanges().empty()) {
     return {Status::NotOK, "Can't reset cluster while migrating slot"};
   }
-  if (srv_->slot_import && srv_->slot_import->GetSlotRange().IsValid()) {
+  if (srv_->slot_import && !srv_->slot_import->GetSlotRanges().empty()) {
     return {Status::NotOK, "Can't reset cluster while importing slot"};
   }
   if (!srv_->storage->IsEmptyDB()) {
@@ -933,17 +1004,10 @@ Status Cluster::Reset() {
     if (!s.IsOK()) return s;
   }
 
-  version_ = -1;
-  size_ = 0;
-  myid_.clear();
-  myself_.reset();
-
-  nodes_.clear();
-  for (auto &n : slots_nodes_) {
-    n = nullptr;
+  {
+    std::lock_guard<std::mutex> guard(topology_mu_);
+    publishTopology(std::make_shared<ClusterTopology>());
   }
-  migrated_slots_.clear();
-  imported_slots_.clear();
 
   // unlink the cluster nodes file if exists
   unlink(srv_->GetConfig()->NodesFilePath().data());
@@ -21,9 +21,12 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <bitset>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <string>
 #include <unordered_map>
@@ -41,6 +44,10 @@ class ClusterNode {
  public:
   explicit ClusterNode(std::string id, std::string host, int port, int role, std::string master_id,
                        const std::bitset<kClusterSlots> &slots);
+  bool operator==(const ClusterNode &other) const {
+    return id == other.id && host == other.host && port == other.port && role == other.role &&
+           master_id == other.master_id && slots == other.slots && replicas == other.replicas;
+  }
   std::string id;
   std::string host;
   int port;
@@ -48,7 +55,6 @@ class ClusterNode {
   std::string master_id;
   std::bitset<kClusterSlots> slots;
   std::vector<std::string> replicas;
-  SlotRange importing_slot_range = {-1, -1};
 };
 
 struct SlotInfo {
@@ -64,6 +70,22 @@ struct SlotInfo {
 
 using ClusterNodes = std::unordered_map<std::string, std::shared_ptr<ClusterNode>>;
 
+// ClusterTopology is an immutable snapshot of the cluster topology and the routing table of the slots.
+// A topology change copies the current snapshot, applies the change to the copy off to the side and
+// publishes it atomically, so the commands route their keys by the snapshot they load without any lock.
+// The nodes of a published snapshot are never modified, a change copies the nodes it modifies.
+struct ClusterTopology {
+  int64_t version = -1;
+  int size = 0;
+  std::string myid;
+  std::shared_ptr<ClusterNode> myself;
+  ClusterNodes nodes;
+  std::array<std::shared_ptr<ClusterNode>, kClusterSlots> slots_nodes;
+  // the slots migrated from this node with the ip:port of their destination, and the slots imported into it
+  std::map<int, std::string> migrated_slots;
+  std::set<int> imported_slots;
+};
+
 class Server;
 class SyncMigrateContext;
 
@@ -79,17 +101,20 @@ class Cluster {
   Status SetSlotRangeImported(const SlotRange &slot_range);
   Status GetSlotsInfo(std::vector<SlotInfo> *slot_infos);
   Status GetClusterInfo(std::string *cluster_infos);
-  int64_t GetVersion() const { return version_; }
+  int64_t GetVersion() const { return loadTopology()->version; }
   static bool IsValidSlot(int slot) { return slot >= 0 && slot < kClusterSlots; }
   bool IsNotMaster();
   bool IsWriteForbiddenSlot(int slot) const;
   Status CanExecByMySelf(const redis::CommandAttributes *attributes, const std::vector<std::string> &cmd_tokens,
                          redis::Connection *conn, lua::ScriptRunCtx *script_run_ctx = nullptr);
+  // SetMasterSlaveRepl sets the replication relationship by the current topology, it needs the exclusivity
+  // of the workers. The topology pushes don't take it, so they leave a pending switch applied by the cron.
   Status SetMasterSlaveRepl();
+  bool HasPendingReplicationSwitch() const { return repl_switch_pending_.load(std::memory_order_relaxed); }
   Status MigrateSlotRange(const SlotRange &slot_range, const std::string &dst_node_id,
                           SyncMigrateContext *blocking_ctx = nullptr);
   Status ImportSlotRange(redis::Connection *conn, const SlotRange &slot_range, int state);
-  std::string GetMyId() const { return myid_; }
+  std::string GetMyId() const { return loadTopology()->myid; }
   Status DumpClusterNodes(const std::string &file);
   Status LoadClusterNodes(const std::string &file_path);
   Status Reset();
@@ -97,23 +122,27 @@ class Cluster {
   static bool SubCommandIsExecExclusive(const std::string &subcommand);
 
  private:
-  std::string getNodeIDBySlot(int slot) const;
-  std::string genNodesDescription();
-  std::string genNodesInfo() const;
-  std::map<std::string, std::string, std::less<>> getClusterNodeSlots() const;
-  SlotInfo genSlotNodeInfo(int start, int end, const std::shared_ptr<ClusterNode> &n);
+  static std::string getNodeIDBySlot(const ClusterTopology &topology, int slot);
+  std::string genNodesDescription(const ClusterTopology &topology);
+  static std::string genNodesInfo(const ClusterTopology &topology);
+  static std::map<std::string, std::string, std::less<>> getClusterNodeSlots(const ClusterTopology &topology);
+  static SlotInfo genSlotNodeInfo(const ClusterTopology &topology, int start, int end,
+                                  const std::shared_ptr<ClusterNode> &n);
   static Status parseClusterNodes(const std::string &nodes_str, ClusterNodes *nodes,
                                   std::unordered_map<int, std::string> *slots_nodes);
+
+  std::shared_ptr<const ClusterTopology> loadTopology() const { return std::atomic_load(&topology_); }
+  void publishTopology(std::shared_ptr<const ClusterTopology> topology) {
+    std::atomic_store(&topology_, std::move(topology));
+  }
+
   Server *srv_;
   std::vector<std::string> binds_;
   int port_;
-  int size_ = 0;
-  int64_t version_ = -1;
-  std::string myid_;
-  std::shared_ptr<ClusterNode> myself_;
-  ClusterNodes nodes_;
-  std::shared_ptr<ClusterNode> slots_nodes_[kClusterSlots];
 
-  std::map<int, std::string> migrated_slots_;
-  std::set<int> imported_slots_;
+  // the published topology, which is only loaded and stored atomically
+  std::shared_ptr<const ClusterTopology> topology_;
+  // serializes the topology changes, i.e. the copy, change and publish of the topology
+  std::mutex topology_mu_;
+  std::atomic<bool> repl_switch_pending_ = false;
 };
@@ -0,0 +1,80 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "migration_throttle.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "server/server.h"
+#include "string_util.h"
+#include "time_util.h"
+
+std::string MigrationThrottle::CheckLoad() {
+  std::lock_guard<std::mutex> guard(sample_mu_);
+  auto now = util::GetTimeStampMS();
+  if (now - last_sample_ms_ < kIntervalMs) return sampled_load_;
+  last_sample_ms_ = now;
+
+  auto config = srv_->GetConfig();
+  std::vector<std::string> signals;
+
+  // The latencies are only recorded if latency-tracking is enabled
+  auto latency = srv_->stats.foreground_latency_histogram.GetSnapshot();
+  auto p99 = latency.Since(last_latency_).Percentile(99);
+  last_latency_ = latency;
+  if (p99 > static_cast<uint64_t>(config->migrate_adaptive_latency_us)) signals.emplace_back("latency");
+
+  auto db = srv_->storage->GetDB();
+  uint64_t value = 0;
+  if ((db->GetIntProperty(rocksdb::DB::Properties::kIsWriteStopped, &value) && value > 0) ||
+      (db->GetIntProperty(rocksdb::DB::Properties::kActualDelayedWriteRate, &value) && value > 0)) {
+    signals.emplace_back("write-stall");
+  }
+  if (db->GetAggregatedIntProperty(rocksdb::DB::Properties::kEstimatePendingCompactionBytes, &value) &&
+      value > static_cast<uint64_t>(config->migrate_adaptive_pending_compaction_mb) * MiB) {
+    signals.emplace_back("pending-compaction");
+  }
+
+  sampled_load_ = util::StringJoin(signals, [](const auto &v) -> decltype(auto) { return v; }, ",");
+  return sampled_load_;
+}
+
+size_t MigrationThrottle::Adjust(size_t max_bytes_per_sec, const std::string &load, uint64_t now_ms) {
+  std::lock_guard<std::mutex> guard(adjust_mu_);
+  auto min_rate = std::min(kMinBytesPerSec, max_bytes_per_sec);
+  auto step = std::max<size_t>(max_bytes_per_sec / kIncreaseSteps, 1);
+  size_t rate = rate_;
+  if (rate == 0) {
+    rate = min_rate + step;
+    last_adjust_ms_ = now_ms;
+  } else if (now_ms - last_adjust_ms_ >= kIntervalMs) {
+    rate = load.empty() ? rate + step : rate / 2;
+    last_adjust_ms_ = now_ms;
+  }
+  load_ = load;
+  rate_ = std::clamp(rate, min_rate, max_bytes_per_sec);
+  return rate_;
+}
+
+std::string MigrationThrottle::GetLoad() const {
+  std::lock_guard<std::mutex> guard(adjust_mu_);
+  return load_;
+}
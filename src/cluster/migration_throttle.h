@@ -0,0 +1,75 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "config/config.h"
+#include "latency_histogram.h"
+
+class Server;
+
+// MigrationThrottle adapts the rate of the raw-key-value and raw-sst-file slot migrations to the load
+// of the nodes, when migrate-adaptive-rate is enabled.
+//
+// It's an AIMD feedback loop: once per interval, the rate is raised by a tenth of the max rate while
+// neither node is overloaded, and halved while either is, so the migrations take the bandwidth the
+// foreground commands leave, and give it back within a few intervals when they need it.
+//
+// A node is overloaded if the p99 latency of its foreground commands over the last interval is over
+// migrate-adaptive-latency-us, if RocksDB stalls its writes, or if its pending compaction bytes are over
+// migrate-adaptive-pending-compaction-mb.
+class MigrationThrottle {
+ public:
+  static constexpr uint64_t kIntervalMs = 1000;
+  static constexpr size_t kMinBytesPerSec = 1 * MiB;
+  // the max rate if migrate-batch-rate-limit-mb is 0
+  static constexpr size_t kMaxBytesPerSec = 1 * GiB;
+  static constexpr size_t kIncreaseSteps = 10;
+
+  explicit MigrationThrottle(Server *srv) : srv_(srv) {}
+
+  // CheckLoad returns the signals of the node over their thresholds joined by commas, or an empty string.
+  // They're sampled at most once per interval, the last sample is returned in between.
+  std::string CheckLoad();
+  // Adjust returns the rate of the migrations, which starts from a step above the min rate.
+  // The load is the reason why the nodes are overloaded, it's empty if they aren't.
+  size_t Adjust(size_t max_bytes_per_sec, const std::string &load, uint64_t now_ms);
+  size_t GetRate() const { return rate_; }
+  std::string GetLoad() const;
+
+ private:
+  Server *srv_;
+
+  std::mutex sample_mu_;
+  uint64_t last_sample_ms_ = 0;
+  LatencyHistogram::Snapshot last_latency_;
+  std::string sampled_load_;
+
+  mutable std::mutex adjust_mu_;
+  uint64_t last_adjust_ms_ = 0;
+  std::string load_;
+  std::atomic<size_t> rate_ = 0;
+};
@@ -37,12 +37,14 @@
 #include "event_util.h"
 #include "fmt/format.h"
 #include "io_util.h"
+#include "parse_util.h"
 #include "rocksdb_crc32c.h"
 #include "scope_exit.h"
 #include "server/redis_reply.h"
 #include "server/server.h"
 #include "status.h"
 #include "storage/batch_debugger.h"
+#include "string_util.h"
 #include "thread_util.h"
 #include "time_util.h"
 #include "unique_fd.h"
@@ -72,6 +74,9 @@ Status FeedSlaveThread::Start() {
 
   if (s) {
     t_ = std::move(*s);
+    if (auto s = util::ThreadSetAffinity(t_, srv_->GetConfig()->replication_cpus); !s) {
+      LOG(WARNING) << "Failed to pin the replica feeding thread: " << s.Msg();
+    }
   } else {
     conn_ = nullptr;  // prevent connection was freed when failed to start the thread
   }
@@ -100,65 +105,304 @@ void FeedSlaveThread::checkLivenessIfNeed() {
   }
 }
 
+void FeedSlaveThread::readAcks() {
+  if (!conn_->IsReplAckEnabled()) return;
+
+  ssl_st *ssl = nullptr;
+#ifdef ENABLE_OPENSSL
+  ssl = bufferevent_openssl_get_ssl(conn_->GetBufferEvent());
+#endif
+  while (util::SockReadable(conn_->GetFD())) {
+    if (auto s = util::EvbufferRead(ack_buf_.get(), conn_->GetFD(), -1, ssl); !s) {
+      LOG(ERROR) << "Read error from slave[" << conn_->GetAddr() << "]: " << s.Msg() << ", would stop the thread";
+      Stop();
+      return;
+    }
+  }
+
+  rocksdb::SequenceNumber acked_seq = 0;
+  while (true) {
+    UniqueEvbufReadln line(ack_buf_.get(), EVBUFFER_EOL_CRLF_STRICT);
+    if (!line) break;
+    auto tokens = util::Split(line.View(), " ");
+    if (tokens.size() != 3 || !util::EqualICase(tokens[0], "replconf") || !util::EqualICase(tokens[1], "ack")) {
+      LOG(WARNING) << "Unexpected data from slave[" << conn_->GetAddr() << "]: " << line.View();
+      continue;
+    }
+    if (auto seq = ParseInt<uint64_t>(tokens[2], 10)) acked_seq = std::max(acked_seq, *seq);
+  }
+  if (acked_seq > acked_seq_.load(std::memory_order_relaxed)) {
+    acked_seq_.store(acked_seq, std::memory_order_relaxed);
+    srv_->WakeupReplicaAckWaiters();
+  }
+}
+
+WALRing::EntryPtr WALRing::MakeEntry(const rocksdb::BatchResult &batch) {
+  auto entry = std::make_shared<Entry>();
+  entry->seq = batch.sequence;
+  entry->count = static_cast<size_t>(batch.writeBatchPtr->Count());
+  entry->bulk = redis::BulkString(batch.writeBatchPtr->Data());
+  return entry;
+}
+
+const std::string &WALRing::Entry::Frame(util::CompressionType type) const {
+  if (type == util::CompressionType::kNone) return bulk;
+
+  std::lock_guard<std::mutex> guard(frames_mu_);
+  auto &frame = frames_[static_cast<size_t>(type)];
+  if (frame.empty()) {
+    std::string compressed;
+    util::CompressFrame(type, bulk, &compressed);
+    frame = redis::BulkString(compressed);
+  }
+  return frame;
+}
+
+WALRing::Result WALRing::Get(rocksdb::SequenceNumber seq, EntryPtr *entry) {
+  std::lock_guard<std::mutex> guard(mu_);
+
+  if (!entries_.empty() && seq < next_seq_) return find(seq, entry);
+  // the backlog is kept for the other replicas, the replica catches up with the ring by its own iterator
+  if (!entries_.empty() && seq > next_seq_) return Result::kLagged;
+
+  if (entries_.empty() || seq != next_seq_) {
+    // start to tail the WAL from the sequence, e.g. for the first replica
+    entries_.clear();
+    bytes_ = 0;
+    iter_ = nullptr;
+    next_seq_ = seq;
+  }
+
+  if (!tail()) return Result::kNoData;
+  return find(seq, entry);
+}
+
+bool WALRing::Covers(rocksdb::SequenceNumber seq) {
+  std::lock_guard<std::mutex> guard(mu_);
+  if (entries_.empty()) return false;
+  if (seq == next_seq_) return true;
+  return find(seq, nullptr) == Result::kOK;
+}
+
+void WALRing::Tail() {
+  // bound the batches read by a call, so that the cron isn't stuck by heavy writes
+  auto max_rounds = static_cast<size_t>(storage_->GetConfig()->repl_backlog_size_mb) * MiB / kGroupBytes;
+  for (size_t i = 0; i < max_rounds; i++) {
+    // the feeding threads get the entries between the rounds
+    std::lock_guard<std::mutex> guard(mu_);
+    if (next_seq_ == 0 || !tail()) return;
+  }
+}
+
+void WALRing::Reset() {
+  std::lock_guard<std::mutex> guard(mu_);
+  entries_.clear();
+  bytes_ = 0;
+  iter_ = nullptr;
+  next_seq_ = 0;
+}
+
+rocksdb::SequenceNumber WALRing::GetBacklog(size_t *bytes) {
+  std::lock_guard<std::mutex> guard(mu_);
+  *bytes = bytes_;
+  return entries_.empty() ? 0 : entries_.front()->seq;
+}
+
+WALRing::Result WALRing::find(rocksdb::SequenceNumber seq, EntryPtr *entry) {
+  // the first entry which ends after the sequence
+  auto iter = std::upper_bound(entries_.begin(), entries_.end(), seq,
+                               [](rocksdb::SequenceNumber s, const EntryPtr &e) { return s < e->seq + e->count; });
+  if (iter == entries_.end() || (*iter)->seq > seq) return Result::kLagged;
+  if ((*iter)->seq == seq) {
+    if (entry) *entry = *iter;
+    return Result::kOK;
+  }
+
+  // a replica resumes in the middle of a grouped entry, e.g. after it reconnects
+  const auto &batches = (*iter)->batches;
+  auto batch = std::lower_bound(batches.begin(), batches.end(), std::make_pair(seq, size_t(0)));
+  if (batch == batches.end() || batch->first != seq) return Result::kLagged;
+  if (!entry) return Result::kOK;
+  auto rest = std::make_shared<Entry>();
+  rest->seq = seq;
+  rest->count = (*iter)->seq + (*iter)->count - seq;
+  rest->bulk = (*iter)->bulk.substr(batch->second);
+  *entry = std::move(rest);
+  return Result::kOK;
+}
+
+void WALRing::push(std::shared_ptr<Entry> entry) {
+  auto max_bytes = static_cast<size_t>(storage_->GetConfig()->repl_backlog_size_mb) * MiB;
+  bytes_ += entry->bulk.size();
+  entries_.emplace_back(std::move(entry));
+  while (entries_.size() > 1 && bytes_ > max_bytes) {
+    bytes_ -= entries_.front()->bulk.size();
+    entries_.pop_front();
+  }
+}
+
+bool WALRing::tail() {
+  std::shared_ptr<Entry> group;
+  while ((!group || group->bulk.size() < kGroupBytes) && storage_->WALHasNewData(next_seq_)) {
+    // the iterator stays at the last read batch until there's new data, like the feeding threads did
+    if (iter_ && iter_->Valid()) iter_->Next();
+    if (!iter_ || !iter_->Valid()) {
+      if (iter_) LOG(INFO) << "WAL was rotated, would reopen again";
+      if (!storage_->GetWALIter(next_seq_, &iter_).IsOK()) {
+        iter_ = nullptr;
+        break;
+      }
+    }
+
+    auto batch = iter_->GetBatch();
+    // a discrete batch starts a new entry, so that the replicas find the gap in the sequences
+    if (group && batch.sequence != group->seq + group->count) {
+      push(std::move(group));
+    }
+    if (!group) {
+      group = std::make_shared<Entry>();
+      group->seq = batch.sequence;
+    }
+    group->batches.emplace_back(batch.sequence, group->bulk.size());
+    group->count += static_cast<size_t>(batch.writeBatchPtr->Count());
+    group->bulk += redis::BulkString(batch.writeBatchPtr->Data());
+    next_seq_ = group->seq + group->count;
+  }
+
+  if (!group) return false;
+  push(std::move(group));
+  return true;
+}
+
 void FeedSlaveThread::loop() {
   // is_first_repl_batch was used to fix that replication may be stuck in a dead loop
   // when some seqs might be lost in the middle of the WAL log, so forced to replicate
   // first batch here to work around this issue instead of waiting for enough batch size.
   bool is_first_repl_batch = true;
   uint32_t yield_microseconds = 2 * 1000;
-  std::string batches_bulk;
+  // The entries gathered for the next send, their frames are sent by one writev
+  std::vector<WALRing::EntryPtr> pending_entries;
+  std::vector<std::string_view> pending_frames;
+  size_t pending_bytes = 0;
   size_t updates_in_batches = 0;
+  size_t raw_bytes_in_batches = 0;
+  size_t batches_in_frames = 0;
+  uint64_t pending_since_us = 0;
+  auto ring = srv_->GetWALRing();
+  // The replica asked for the compression by REPLCONF before PSYNC
+  auto compression = conn_->GetReplCompression();
+  const auto *config = srv_->GetConfig();
+
+  auto send_pending = [&]() {
+    auto s = util::SockSendv(conn_->GetFD(), pending_frames, conn_->GetBufferEvent());
+    if (!s.IsOK()) {
+      LOG(ERROR) << "Write error while sending " << batches_in_frames << " batches to slave: " << s.Msg();
+      Stop();
+      return false;
+    }
+    if (compression != util::CompressionType::kNone) {
+      srv_->stats.IncrReplCompressionBytes(raw_bytes_in_batches, pending_bytes);
+    }
+    srv_->stats.IncrReplSends(batches_in_frames);
+    readAcks();
+    is_first_repl_batch = false;
+    pending_frames.clear();
+    pending_entries.clear();
+    pending_bytes = 0;
+    updates_in_batches = 0;
+    raw_bytes_in_batches = 0;
+    batches_in_frames = 0;
+    pending_since_us = 0;
+    return true;
+  };
+  // wait yields while there's no new batch, and sends the gathered batches once the first of them has waited
+  // for repl-batch-delay-us, since no more batches may come for a while
+  auto wait = [&]() {
+    auto delay_us = static_cast<uint64_t>(config->repl_batch_delay_us);
+    usleep(pending_entries.empty() || delay_us == 0 ? yield_microseconds
+                                                    : std::min<uint64_t>(yield_microseconds, delay_us));
+    checkLivenessIfNeed();
+    if (!pending_entries.empty() && util::GetTimeStampUS() - pending_since_us >= delay_us) return send_pending();
+    readAcks();
+    return true;
+  };
+
   while (!IsStopped()) {
     auto curr_seq = next_repl_seq_.load();
 
-    if (!iter_ || !iter_->Valid()) {
-      if (iter_) LOG(INFO) << "WAL was rotated, would reopen again";
-      if (!srv_->storage->WALHasNewData(curr_seq) || !srv_->storage->GetWALIter(curr_seq, &iter_).IsOK()) {
-        iter_ = nullptr;
-        usleep(yield_microseconds);
-        checkLivenessIfNeed();
+    // The batches are read from the WAL ring shared by all the replicas,
+    // unless the replica lags behind the ring and reads the WAL by its own iterator
+    if (iter_ && ring->Covers(curr_seq)) {
+      LOG(INFO) << "Slave " << conn_->GetAddr() << " caught up with the WAL ring at sequence " << curr_seq;
+      iter_ = nullptr;
+    }
+
+    WALRing::EntryPtr entry;
+    if (!iter_) {
+      auto res = ring->Get(curr_seq, &entry);
+      if (res == WALRing::Result::kNoData) {
+        if (!wait()) return;
         continue;
       }
+      if (res == WALRing::Result::kLagged) {
+        LOG(INFO) << "Slave " << conn_->GetAddr() << " isn't in the WAL ring at sequence " << curr_seq
+                  << ", would read the WAL by its own iterator";
+      }
     }
-    // iter_ would be always valid here
-    auto batch = iter_->GetBatch();
-    if (batch.sequence != curr_seq) {
+
+    if (!entry) {
+      if (!iter_ || !iter_->Valid()) {
+        if (iter_) LOG(INFO) << "WAL was rotated, would reopen again";
+        if (!srv_->storage->WALHasNewData(curr_seq) || !srv_->storage->GetWALIter(curr_seq, &iter_).IsOK()) {
+          iter_ = nullptr;
+          if (!wait()) return;
+          continue;
+        }
+      }
+      // iter_ would be always valid here
+      entry = WALRing::MakeEntry(iter_->GetBatch());
+    }
+
+    if (entry->seq != curr_seq) {
       LOG(ERROR) << "Fatal error encountered, WAL iterator is discrete, some seq might be lost"
-                 << ", sequence " << curr_seq << " expected, but got " << batch.sequence;
+                 << ", sequence " << curr_seq << " expected, but got " << entry->seq;
       Stop();
       return;
     }
-    updates_in_batches += batch.writeBatchPtr->Count();
-    batches_bulk += redis::BulkString(batch.writeBatchPtr->Data());
+    const auto &frame = entry->Frame(compression);
+    pending_frames.emplace_back(frame);
+    pending_entries.emplace_back(entry);
+    pending_bytes += frame.size();
+    updates_in_batches += entry->count;
+    raw_bytes_in_batches += entry->bulk.size();
+    batches_in_frames += std::max<size_t>(entry->batches.size(), 1);
+    if (pending_since_us == 0) pending_since_us = util::GetTimeStampUS();
     // 1. We must send the first replication batch, as said above.
     // 2. To avoid frequently calling 'write' system call to send replication stream,
-    //    we pack multiple batches into one big bulk if possible, and only send once.
-    //    But we should send the bulk of batches if its size exceed kMaxDelayBytes,
-    //    16Kb by default. Moreover, we also send if updates count in all bathes is
-    //    more that kMaxDelayUpdates, to void too many delayed updates.
-    // 3. To avoid master don't send replication stream to slave since of packing
-    //    batches strategy, we still send batches if current batch sequence is less
-    //    kMaxDelayUpdates than latest sequence.
-    if (is_first_repl_batch || batches_bulk.size() >= kMaxDelayBytes || updates_in_batches >= kMaxDelayUpdates ||
-        srv_->storage->LatestSeqNumber() - batch.sequence <= kMaxDelayUpdates) {
-      // Send entire bulk which contain multiple batches
-      auto s = util::SockSend(conn_->GetFD(), batches_bulk, conn_->GetBufferEvent());
-      if (!s.IsOK()) {
-        LOG(ERROR) << "Write error while sending batch to slave: " << s.Msg() << ". batches: 0x"
-                   << util::StringToHex(batches_bulk);
-        Stop();
-        return;
-      }
-      is_first_repl_batch = false;
-      batches_bulk.clear();
-      if (batches_bulk.capacity() > kMaxDelayBytes * 2) batches_bulk.shrink_to_fit();
-      updates_in_batches = 0;
+    //    we gather multiple batches and send them by one writev if possible.
+    //    But we should send the batches if their size exceed repl-batch-max-kb.
+    // 3. If repl-batch-delay-us is set, the batches are gathered until the first of
+    //    them has waited for so long, even if the replica has caught up.
+    // 4. Otherwise, we also send if updates count in all batches is more than
+    //    kMaxDelayUpdates, to avoid too many delayed updates, and we still send
+    //    batches if current batch sequence is less kMaxDelayUpdates than latest
+    //    sequence, to avoid master don't send replication stream to slave since
+    //    of packing batches strategy.
+    auto delay_us = static_cast<uint64_t>(config->repl_batch_delay_us);
+    bool send = is_first_repl_batch || pending_bytes >= static_cast<size_t>(config->repl_batch_max_kb) * KiB;
+    if (!send && delay_us > 0) {
+      send = util::GetTimeStampUS() - pending_since_us >= delay_us;
+    } else if (!send) {
+      send = updates_in_batches >= kMaxDelayUpdates ||
+             srv_->storage->LatestSeqNumber() - entry->seq <= kMaxDelayUpdates;
     }
-    curr_seq = batch.sequence + batch.writeBatchPtr->Count();
+    if (send && !send_pending()) return;
+    curr_seq = entry->seq + entry->count;
     next_repl_seq_.store(curr_seq);
+    if (!iter_) continue;
+
     while (!IsStopped() && !srv_->storage->WALHasNewData(curr_seq)) {
-      usleep(yield_microseconds);
-      checkLivenessIfNeed();
+      if (!wait()) return;
     }
     iter_->Next();
   }
@@ -301,6 +545,9 @@ void ReplicationThread::CallbacksStateMachine::Start() {
 
   handler_idx_ = 0;
   repl_->incr_state_ = Incr_batch_size;
+  // the batches left by the last connection aren't applied, the new one resumes from the latest sequence
+  repl_->pending_batches_.clear();
+  repl_->pending_bytes_ = 0;
   if (getHandlerEventType(0) == WRITE) {
     SetWriteCB(bev, EventCallbackFunc<&CallbacksStateMachine::ReadWriteCB>);
   } else {
@@ -356,6 +603,9 @@ Status ReplicationThread::Start(std::function<bool()> &&pre_fullsync_cb, std::fu
     this->run();
     assert(stop_flag_);
   }));
+  if (auto s = util::ThreadSetAffinity(t_, srv_->GetConfig()->replication_cpus); !s) {
+    LOG(WARNING) << "Failed to pin the replication thread: " << s.Msg();
+  }
 
   return Status::OK();
 }
@@ -457,6 +707,17 @@ ReplicationThread::CBState ReplicationThread::replConfWriteCB(bufferevent *bev)
     data_to_send.emplace_back("ip-address");
     data_to_send.emplace_back(config->replica_announce_ip);
   }
+  repl_compression_ = next_try_without_compression_ ? util::CompressionType::kNone : config->replication_compression;
+  if (repl_compression_ != util::CompressionType::kNone) {
+    data_to_send.emplace_back("compression");
+    data_to_send.emplace_back(util::CompressionTypeName(repl_compression_));
+  }
+  repl_ack_ = !next_try_without_ack_;
+  last_acked_seq_ = 0;
+  if (repl_ack_) {
+    data_to_send.emplace_back("capa");
+    data_to_send.emplace_back("ack");
+  }
   SendString(bev, redis::ArrayOfBulkStrings(data_to_send));
   repl_state_.store(kReplReplConf, std::memory_order_relaxed);
   LOG(INFO) << "[replication] replconf request was sent, waiting for response";
@@ -468,6 +729,20 @@ ReplicationThread::CBState ReplicationThread::replConfReadCB(bufferevent *bev) {
   UniqueEvbufReadln line(input, EVBUFFER_EOL_CRLF_STRICT);
   if (!line) return CBState::AGAIN;
 
+  // on an error of the compression, e.g. the old version master, try with the uncompressed stream
+  if (line[0] == '-' && repl_compression_ != util::CompressionType::kNone && !isRestoringError(line.View())) {
+    next_try_without_compression_ = true;
+    LOG(WARNING) << "[replication] The master can't handle the compression "
+                 << util::CompressionTypeName(repl_compression_) << ", try without it again: " << line.get() + 1;
+    return CBState::PREV;
+  }
+  next_try_without_compression_ = false;
+  // the master before the acks rejects the capa option
+  if (isUnknownOption(line.View()) && repl_ack_) {
+    next_try_without_ack_ = true;
+    LOG(WARNING) << "[replication] The master can't handle the acks, try without them again";
+    return CBState::PREV;
+  }
   // on unknown option: first try without announce ip, if it fails again - do nothing (to prevent infinite loop)
   if (isUnknownOption(line.View()) && !next_try_without_announce_ip_address_) {
     next_try_without_announce_ip_address_ = true;
@@ -483,9 +758,12 @@ ReplicationThread::CBState ReplicationThread::replConfReadCB(bufferevent *bev) {
   if (!ResponseLineIsOK(line.View())) {
     LOG(WARNING) << "[replication] Failed to replconf: " << line.get() + 1;
     //  backward compatible with old version that doesn't support replconf cmd
+    repl_compression_ = util::CompressionType::kNone;
+    repl_ack_ = false;
     return CBState::NEXT;
   } else {
-    LOG(INFO) << "[replication] replconf is ok, start psync";
+    LOG(INFO) << "[replication] replconf is ok, start psync, the compression of the stream: "
+              << util::CompressionTypeName(repl_compression_);
     return CBState::NEXT;
   }
 }
@@ -566,7 +844,15 @@ ReplicationThread::CBState ReplicationThread::incrementBatchLoopCB(bufferevent *
       case Incr_batch_size: {
         // Read bulk length
         UniqueEvbufReadln line(input, EVBUFFER_EOL_CRLF_STRICT);
-        if (!line) return CBState::AGAIN;
+        if (!line) {
+          // the batches received so far are applied before waiting for more data
+          if (auto s = applyPendingBatches(); !s.IsOK()) {
+            LOG(ERROR) << "[replication] CRITICAL - " << s.Msg();
+            return CBState::RESTART;
+          }
+          sendAck(bev);
+          return CBState::AGAIN;
+        }
         incr_bulk_len_ = line.length > 0 ? std::strtoull(line.get() + 1, nullptr, 10) : 0;
         if (incr_bulk_len_ == 0) {
           LOG(ERROR) << "[replication] Invalid increment data size";
@@ -583,23 +869,21 @@ ReplicationThread::CBState ReplicationThread::incrementBatchLoopCB(bufferevent *
           // master would send the ping heartbeat packet to check whether the slave was alive or not,
           // don't write ping to db here.
           if (bulk_string != "ping") {
-            auto s = storage_->ReplicaApplyWriteBatch(std::string(bulk_data, incr_bulk_len_));
+            auto s = repl_compression_ == util::CompressionType::kNone ? addWriteBatch(std::move(bulk_string))
+                                                                       : addFrame(bulk_string);
             if (!s.IsOK()) {
-              LOG(ERROR) << "[replication] CRITICAL - Failed to write batch to local, " << s.Msg() << ". batch: 0x"
-                         << util::StringToHex(bulk_string);
-              return CBState::RESTART;
-            }
-
-            s = parseWriteBatch(bulk_string);
-            if (!s.IsOK()) {
-              LOG(ERROR) << "[replication] CRITICAL - failed to parse write batch 0x" << util::StringToHex(bulk_string)
-                         << ": " << s.Msg();
+              LOG(ERROR) << "[replication] CRITICAL - " << s.Msg();
               return CBState::RESTART;
             }
           }
           evbuffer_drain(input, incr_bulk_len_ + 2);
           incr_state_ = Incr_batch_size;
         } else {
+          if (auto s = applyPendingBatches(); !s.IsOK()) {
+            LOG(ERROR) << "[replication] CRITICAL - " << s.Msg();
+            return CBState::RESTART;
+          }
+          sendAck(bev);
           return CBState::AGAIN;
         }
         break;
@@ -685,6 +969,11 @@ ReplicationThread::CBState ReplicationThread::fullSyncReadCB(bufferevent *bev) {
         // file doesn't have number.
         auto iter = std::find(need_files.begin(), need_files.end(), "CURRENT");
         if (iter != need_files.end()) need_files.erase(iter);
+        // Keep the parts of the files fetched by the last full sync, the fetches are resumed from them
+        auto n_files = need_files.size();
+        for (size_t i = 0; i < n_files; i++) {
+          need_files.emplace_back(need_files[i] + ".tmp");
+        }
         auto s = engine::Storage::ReplDataManager::CleanInvalidFiles(storage_, target_dir, need_files);
         if (!s.IsOK()) {
           LOG(WARNING) << "[replication] Failed to clean up invalid files of the old checkpoint,"
@@ -756,82 +1045,124 @@ ReplicationThread::CBState ReplicationThread::fullSyncReadCB(bufferevent *bev) {
 
 Status ReplicationThread::parallelFetchFile(const std::string &dir,
                                             const std::vector<std::pair<std::string, uint32_t>> &files) {
-  size_t concurrency = 1;
-  if (files.size() > 20) {
-    // Use 4 threads to download files in parallel
-    concurrency = 4;
-  }
+  auto max_concurrency = static_cast<size_t>(srv_->GetConfig()->fullsync_fetch_threads);
+  std::atomic<size_t> next_file = {0};
   std::atomic<uint32_t> fetch_cnt = {0};
   std::atomic<uint32_t> skip_cnt = {0};
-  std::vector<std::future<Status>> results;
-  for (size_t tid = 0; tid < concurrency; ++tid) {
-    results.push_back(
-        std::async(std::launch::async, [this, dir, &files, tid, concurrency, &fetch_cnt, &skip_cnt]() -> Status {
-          if (this->stop_flag_) {
-            return {Status::NotOK, "replication thread was stopped"};
-          }
-          ssl_st *ssl = nullptr;
+  std::atomic<bool> failed = {false};
+  fullsync_fetched_bytes_ = 0;
+
+  auto fetch = [this, dir, &files, &next_file, &fetch_cnt, &skip_cnt, &failed]() -> Status {
+    if (this->stop_flag_) {
+      return {Status::NotOK, "replication thread was stopped"};
+    }
+    ssl_st *ssl = nullptr;
 #ifdef ENABLE_OPENSSL
-          if (this->srv_->GetConfig()->tls_replication) {
-            ssl = SSL_new(this->srv_->ssl_ctx.get());
-          }
-          auto exit = MakeScopeExit([ssl] { SSL_free(ssl); });
+    if (this->srv_->GetConfig()->tls_replication) {
+      ssl = SSL_new(this->srv_->ssl_ctx.get());
+    }
+    auto exit = MakeScopeExit([ssl] { SSL_free(ssl); });
 #endif
-          int sock_fd = GET_OR_RET(util::SockConnect(this->host_, this->port_, ssl).Prefixed("connect the server err"));
+    int sock_fd = GET_OR_RET(util::SockConnect(this->host_, this->port_, ssl).Prefixed("connect the server err"));
 #ifdef ENABLE_OPENSSL
-          exit.Disable();
+    exit.Disable();
 #endif
-          UniqueFD unique_fd{sock_fd};
-          auto s = this->sendAuth(sock_fd, ssl);
-          if (!s.IsOK()) {
-            return s.Prefixed("send the auth command err");
-          }
-          std::vector<std::string> fetch_files;
-          std::vector<uint32_t> crcs;
-          for (auto f_idx = tid; f_idx < files.size(); f_idx += concurrency) {
-            if (this->stop_flag_) {
-              return {Status::NotOK, "replication thread was stopped"};
-            }
-            const auto &f_name = files[f_idx].first;
-            const auto &f_crc = files[f_idx].second;
-            // Don't fetch existing files
-            if (engine::Storage::ReplDataManager::FileExists(this->storage_, dir, f_name, f_crc)) {
-              skip_cnt.fetch_add(1);
-              uint32_t cur_skip_cnt = skip_cnt.load();
-              uint32_t cur_fetch_cnt = fetch_cnt.load();
-              LOG(INFO) << "[skip] " << f_name << " " << f_crc << ", skip count: " << cur_skip_cnt
-                        << ", fetch count: " << cur_fetch_cnt << ", progress: " << cur_skip_cnt + cur_fetch_cnt << "/"
-                        << files.size();
-              continue;
-            }
-            fetch_files.push_back(f_name);
-            crcs.push_back(f_crc);
-          }
-          unsigned files_count = files.size();
-          FetchFileCallback fn = [&fetch_cnt, &skip_cnt, files_count](const std::string &fetch_file,
-                                                                      uint32_t fetch_crc) {
-            fetch_cnt.fetch_add(1);
-            uint32_t cur_skip_cnt = skip_cnt.load();
-            uint32_t cur_fetch_cnt = fetch_cnt.load();
-            LOG(INFO) << "[fetch] "
-                      << "Fetched " << fetch_file << ", crc32: " << fetch_crc << ", skip count: " << cur_skip_cnt
-                      << ", fetch count: " << cur_fetch_cnt << ", progress: " << cur_skip_cnt + cur_fetch_cnt << "/"
-                      << files_count;
-          };
-          // For master using old version, it only supports to fetch a single file by one
-          // command, so we need to fetch all files by multiple command interactions.
-          if (srv_->GetConfig()->master_use_repl_port) {
-            for (unsigned i = 0; i < fetch_files.size(); i++) {
-              s = this->fetchFiles(sock_fd, dir, {fetch_files[i]}, {crcs[i]}, fn, ssl);
-              if (!s.IsOK()) break;
-            }
-          } else {
-            if (!fetch_files.empty()) {
-              s = this->fetchFiles(sock_fd, dir, fetch_files, crcs, fn, ssl);
-            }
-          }
-          return s;
-        }));
+    UniqueFD unique_fd{sock_fd};
+    auto s = this->sendAuth(sock_fd, ssl);
+    if (!s.IsOK()) {
+      return s.Prefixed("send the auth command err");
+    }
+
+    unsigned files_count = files.size();
+    FetchFileCallback fn = [&fetch_cnt, &skip_cnt, files_count](const std::string &fetch_file, uint32_t fetch_crc) {
+      fetch_cnt.fetch_add(1);
+      uint32_t cur_skip_cnt = skip_cnt.load();
+      uint32_t cur_fetch_cnt = fetch_cnt.load();
+      LOG(INFO) << "[fetch] "
+                << "Fetched " << fetch_file << ", crc32: " << fetch_crc << ", skip count: " << cur_skip_cnt
+                << ", fetch count: " << cur_fetch_cnt << ", progress: " << cur_skip_cnt + cur_fetch_cnt << "/"
+                << files_count;
+    };
+
+    // The files are taken from the shared list a few at a time, so that the threads added later share the rest
+    while (!failed) {
+      std::vector<std::string> fetch_files;
+      std::vector<uint32_t> crcs;
+      while (fetch_files.size() < kFetchFilesPerRequest) {
+        auto f_idx = next_file.fetch_add(1);
+        if (f_idx >= files.size()) break;
+        if (this->stop_flag_) {
+          return {Status::NotOK, "replication thread was stopped"};
+        }
+        const auto &f_name = files[f_idx].first;
+        const auto &f_crc = files[f_idx].second;
+        // Don't fetch existing files
+        if (engine::Storage::ReplDataManager::FileExists(this->storage_, dir, f_name, f_crc)) {
+          skip_cnt.fetch_add(1);
+          uint32_t cur_skip_cnt = skip_cnt.load();
+          uint32_t cur_fetch_cnt = fetch_cnt.load();
+          LOG(INFO) << "[skip] " << f_name << " " << f_crc << ", skip count: " << cur_skip_cnt
+                    << ", fetch count: " << cur_fetch_cnt << ", progress: " << cur_skip_cnt + cur_fetch_cnt << "/"
+                    << files.size();
+          continue;
+        }
+        fetch_files.push_back(f_name);
+        crcs.push_back(f_crc);
+      }
+      if (fetch_files.empty()) break;
+
+      // For master using old version, it only supports to fetch a single file by one
+      // command, so we need to fetch all files by multiple command interactions.
+      if (srv_->GetConfig()->master_use_repl_port) {
+        for (unsigned i = 0; i < fetch_files.size(); i++) {
+          s = this->fetchFiles(sock_fd, dir, {fetch_files[i]}, {crcs[i]}, fn, ssl);
+          if (!s.IsOK()) break;
+        }
+      } else {
+        s = this->fetchFiles(sock_fd, dir, fetch_files, crcs, fn, ssl);
+      }
+      if (!s.IsOK()) {
+        failed = true;
+        return s;
+      }
+    }
+    return Status::OK();
+  };
+
+  // The fetch starts with one thread, and a thread is added each sampling interval while the throughput
+  // keeps growing by kFetchThroughputGain, until the concurrency reaches fullsync-fetch-threads
+  std::vector<std::future<Status>> results;
+  results.push_back(std::async(std::launch::async, fetch));
+  auto all_done = [&results] {
+    return std::all_of(results.begin(), results.end(), [](const std::future<Status> &f) {
+      return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    });
+  };
+
+  bool growing = true;
+  uint64_t last_bytes = 0;
+  double best_throughput = 0;
+  while (!all_done()) {
+    std::this_thread::sleep_for(kFetchSampleInterval);
+    uint64_t bytes = fullsync_fetched_bytes_;
+    auto throughput = static_cast<double>(bytes - last_bytes);
+    last_bytes = bytes;
+    if (!growing || results.size() >= max_concurrency || next_file >= files.size() || failed || stop_flag_) {
+      continue;
+    }
+
+    // no data fetched in the interval, e.g. the existing files are being verified
+    if (throughput == 0 || throughput > best_throughput * kFetchThroughputGain) {
+      best_throughput = std::max(best_throughput, throughput);
+      results.push_back(std::async(std::launch::async, fetch));
+      LOG(INFO) << "[replication] Fetch files by " << results.size() << " threads, throughput of the last "
+                << std::chrono::duration_cast<std::chrono::milliseconds>(kFetchSampleInterval).count()
+                << "ms: " << util::BytesToHuman(static_cast<uint64_t>(throughput));
+    } else {
+      growing = false;
+      LOG(INFO) << "[replication] Fetch files by " << results.size() << " threads since more threads don't improve"
+                << " the throughput";
+    }
   }
 
   // Wait til finish
@@ -866,10 +1197,11 @@ Status ReplicationThread::sendAuth(int sock_fd, ssl_st *ssl) {
 }
 
 Status ReplicationThread::fetchFile(int sock_fd, evbuffer *evbuf, const std::string &dir, const std::string &file,
-                                    uint32_t crc, const FetchFileCallback &fn, ssl_st *ssl) {
+                                    uint32_t crc, FetchedPart *part, const FetchFileCallback &fn, ssl_st *ssl) {
   size_t file_size = 0;
+  uint64_t offset = 0;
 
-  // Read file size line
+  // Read file size line, the reply to a ranged fetch is the offset and the size of the rest of the file
   while (true) {
     UniqueEvbufReadln line(evbuf, EVBUFFER_EOL_CRLF_STRICT);
     if (!line) {
@@ -882,18 +1214,35 @@ Status ReplicationThread::fetchFile(int sock_fd, evbuffer *evbuf, const std::str
       std::string msg(line.get());
       return {Status::NotOK, msg};
     }
-    file_size = line.length > 0 ? std::strtoull(line.get(), nullptr, 10) : 0;
+    if (part) {
+      char *end = nullptr;
+      offset = std::strtoull(line.get(), &end, 10);
+      file_size = std::strtoull(end, nullptr, 10);
+    } else {
+      file_size = line.length > 0 ? std::strtoull(line.get(), nullptr, 10) : 0;
+    }
     break;
   }
 
-  // Write to tmp file
-  auto tmp_file = engine::Storage::ReplDataManager::NewTmpFile(storage_, dir, file);
+  // Write to tmp file, or append to the part fetched before if the master resumes from it
+  std::unique_ptr<rocksdb::WritableFile> tmp_file;
+  uint32_t tmp_crc = 0;
+  if (offset > 0) {
+    if (!part->file || offset != part->size) {
+      return {Status::NotOK, fmt::format("unexpected offset {} to resume fetching {}", offset, file)};
+    }
+    tmp_file = std::move(part->file);
+    tmp_crc = part->crc;
+    LOG(INFO) << "[fetch] Resume fetching " << file << " from offset " << offset;
+  } else {
+    if (part) part->file = nullptr;
+    tmp_file = engine::Storage::ReplDataManager::NewTmpFile(storage_, dir, file);
+  }
   if (!tmp_file) {
     return {Status::NotOK, "unable to create tmp file"};
   }
 
   size_t remain = file_size;
-  uint32_t tmp_crc = 0;
   char data[16 * 1024];
   while (remain != 0) {
     if (evbuffer_get_length(evbuf) > 0) {
@@ -905,14 +1254,18 @@ Status ReplicationThread::fetchFile(int sock_fd, evbuffer *evbuf, const std::str
       tmp_file->Append(rocksdb::Slice(data, data_len));
       tmp_crc = rocksdb::crc32c::Extend(tmp_crc, data, data_len);
       remain -= data_len;
+      fullsync_fetched_bytes_.fetch_add(data_len, std::memory_order_relaxed);
     } else {
       if (auto s = util::EvbufferRead(evbuf, sock_fd, -1, ssl); !s) {
         return std::move(s).Prefixed("read sst file");
       }
     }
   }
+  tmp_file = nullptr;
   // Verify file crc checksum if crc is not 0
   if (crc && crc != tmp_crc) {
+    // the next full sync shouldn't resume from the corrupted file
+    engine::Storage::ReplDataManager::RemoveTmpFile(storage_, dir, file);
     return {Status::NotOK, fmt::format("CRC mismatched, {} was expected but got {}", crc, tmp_crc)};
   }
   // File is OK, rename to formal name
@@ -933,15 +1286,39 @@ Status ReplicationThread::fetchFiles(int sock_fd, const std::string &dir, const
   }
   files_str.pop_back();
 
-  const auto fetch_command = redis::ArrayOfBulkStrings({"_fetch_file", files_str});
+  // The files whose fetches were interrupted by the last full sync are resumed from the fetched parts,
+  // if the master supports it
+  std::vector<FetchedPart> parts(files.size());
+  std::string ranges_str;
+  bool ranged = false;
+  if (!srv_->GetConfig()->master_use_repl_port && !fetch_file_range_unsupported_) {
+    for (size_t i = 0; i < files.size(); i++) {
+      auto &part = parts[i];
+      part.file = engine::Storage::ReplDataManager::ResumeTmpFile(storage_, dir, files[i], &part.size, &part.crc);
+      if (!part.file) part.size = part.crc = 0;
+      ranged = ranged || part.size > 0;
+      ranges_str += std::to_string(part.size) + ":" + std::to_string(part.crc) + ",";
+    }
+    ranges_str.pop_back();
+  }
+
+  if (!ranged) parts.clear();
+
+  std::vector<std::string> fetch_args{"_fetch_file", files_str};
+  if (ranged) fetch_args.emplace_back(ranges_str);
+  const auto fetch_command = redis::ArrayOfBulkStrings(fetch_args);
   auto s = util::SockSend(sock_fd, fetch_command, ssl);
   if (!s.IsOK()) return s.Prefixed("send fetch file command");
 
   UniqueEvbuf evbuf;
   for (unsigned i = 0; i < files.size(); i++) {
     DLOG(INFO) << "[fetch] Start to fetch file " << files[i];
-    s = fetchFile(sock_fd, evbuf.get(), dir, files[i], crcs[i], fn, ssl);
+    s = fetchFile(sock_fd, evbuf.get(), dir, files[i], crcs[i], ranged ? &parts[i] : nullptr, fn, ssl);
     if (!s.IsOK()) {
+      if (ranged && i == 0 && s.Msg().find(redis::errWrongNumOfArguments) != std::string::npos) {
+        fetch_file_range_unsupported_ = true;
+        LOG(WARNING) << "[fetch] The master can't resume fetching files, would fetch the whole files";
+      }
       s = Status(Status::NotOK, "fetch file err: " + s.Msg());
       LOG(WARNING) << "[fetch] Fail to fetch file " << files[i] << ", err: " << s.Msg();
       break;
@@ -967,8 +1344,7 @@ void ReplicationThread::TimerCB(int, int16_t) {
   }
 }
 
-Status ReplicationThread::parseWriteBatch(const std::string &batch_string) {
-  rocksdb::WriteBatch write_batch(batch_string);
+Status ReplicationThread::parseWriteBatch(const rocksdb::WriteBatch &write_batch) {
   WriteBatchHandler write_batch_handler;
 
   auto db_status = write_batch.Iterate(&write_batch_handler);
@@ -1001,7 +1377,15 @@ Status ReplicationThread::parseWriteBatch(const std::string &batch_string) {
       redis::StreamEntryID id;
       GetFixed64(&entry_id, &id.ms);
       GetFixed64(&entry_id, &id.seq);
-      srv_->OnEntryAddedToStream(ikey.GetNamespace().ToString(), ikey.GetKey().ToString(), id);
+      std::string user_key = ikey.GetKey().ToString();
+      if (ikey.IsCompact()) {
+        // the batch has been written, so the key ID entry of the stream is there
+        if (auto s = storage_->GetKeyByID(ikey, &user_key); !s.ok()) {
+          LOG(WARNING) << "[replication] Failed to look up the key ID of a stream entry: " << s.ToString();
+          break;
+        }
+      }
+      srv_->OnEntryAddedToStream(ikey.GetNamespace().ToString(), user_key, id);
       break;
     }
     case kBatchTypeNone:
@@ -1010,6 +1394,68 @@ Status ReplicationThread::parseWriteBatch(const std::string &batch_string) {
   return Status::OK();
 }
 
+Status ReplicationThread::addWriteBatch(std::string &&batch_string) {
+  pending_bytes_ += batch_string.size();
+  pending_batches_.emplace_back(std::move(batch_string));
+  if (pending_bytes_ < static_cast<size_t>(srv_->GetConfig()->replica_apply_batch_size_kb) * KiB) {
+    return Status::OK();
+  }
+  return applyPendingBatches();
+}
+
+Status ReplicationThread::addFrame(const std::string &frame) {
+  std::string bulks;
+  auto s = util::DecompressFrame(frame, &bulks);
+  if (!s.IsOK()) return s.Prefixed("failed to decompress the replication stream");
+
+  // the frame contains the write batches encoded as bulk strings, i.e. $<length>\r\n<batch>\r\n
+  std::string_view input = bulks;
+  while (!input.empty()) {
+    auto pos = input.find("\r\n");
+    if (input[0] != '$' || pos == std::string_view::npos) {
+      return {Status::NotOK, "invalid bulk string in the decompressed replication stream"};
+    }
+    auto len = ParseInt<size_t>(std::string(input.substr(1, pos - 1)), 10);
+    if (!len || pos + 2 + *len + 2 > input.size()) {
+      return {Status::NotOK, "invalid bulk length in the decompressed replication stream"};
+    }
+    GET_OR_RET(addWriteBatch(std::string(input.substr(pos + 2, *len))));
+    input.remove_prefix(pos + 2 + *len + 2);
+  }
+  return Status::OK();
+}
+
+Status ReplicationThread::applyPendingBatches() {
+  if (pending_batches_.empty()) return Status::OK();
+
+  auto batches = std::move(pending_batches_);
+  pending_batches_.clear();
+  pending_bytes_ = 0;
+
+  // The consecutive batches are written at once, their records take the same sequences
+  // as on the master, and they become visible together
+  std::string rep = batches.front().Data();
+  for (size_t i = 1; i < batches.size(); i++) {
+    engine::GroupCommitter::MergeBatches(&rep, batches[i]);
+  }
+  auto s = storage_->ReplicaApplyWriteBatch(std::move(rep));
+  if (!s.IsOK()) {
+    if (batches.size() > 1) {
+      return {Status::NotOK, "Failed to write " + std::to_string(batches.size()) + " batches to local, " + s.Msg()};
+    }
+    return {Status::NotOK, "Failed to write batch to local, " + s.Msg() + ". batch: 0x" +
+                               util::StringToHex(batches.front().Data())};
+  }
+
+  for (const auto &batch : batches) {
+    s = parseWriteBatch(batch);
+    if (!s.IsOK()) {
+      return {Status::NotOK, "failed to parse write batch 0x" + util::StringToHex(batch.Data()) + ": " + s.Msg()};
+    }
+  }
+  return Status::OK();
+}
+
 bool ReplicationThread::isRestoringError(std::string_view err) {
   // err doesn't contain the CRLF, so cannot use redis::Error here.
   return err == RESP_PREFIX_ERROR + redis::StatusToRedisErrorMsg({Status::RedisLoading, redis::errRestoringBackup});
@@ -1020,6 +1466,16 @@ bool ReplicationThread::isWrongPsyncNum(std::string_view err) {
   return err == RESP_PREFIX_ERROR + redis::StatusToRedisErrorMsg({Status::NotOK, redis::errWrongNumArguments});
 }
 
+void ReplicationThread::sendAck(bufferevent *bev) {
+  if (!repl_ack_) return;
+
+  auto seq = storage_->LatestSeqNumber();
+  if (seq == last_acked_seq_) return;
+  // the ack is an inline command, it's read by the feeder thread of the master
+  SendString(bev, fmt::format("REPLCONF ACK {}\r\n", seq));
+  last_acked_seq_ = seq;
+}
+
 bool ReplicationThread::isUnknownOption(std::string_view err) {
   // err doesn't contain the CRLF, so cannot use redis::Error here.
   return err == RESP_PREFIX_ERROR + redis::StatusToRedisErrorMsg({Status::NotOK, redis::errUnknownOption});
@@ -22,15 +22,19 @@
 
 #include <event2/bufferevent.h>
 
+#include <array>
 #include <atomic>
+#include <chrono>
 #include <deque>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <tuple>
 #include <utility>
 #include <vector>
 
+#include "compress_util.h"
 #include "event_util.h"
 #include "io_util.h"
 #include "server/redis_connection.h"
@@ -60,6 +64,79 @@ enum WriteBatchType {
 
 using FetchFileCallback = std::function<void(const std::string &, uint32_t)>;
 
+// WALRing tails the WAL once for all the replicas: the batches read by a single WAL iterator are kept
+// in a ring buffer, encoded as the bulk strings sent to the replicas, and shared by the threads feeding
+// the replicas at their own sequences. The oldest batches are dropped once the ring exceeds
+// repl-backlog-size-mb, so a replica which lags behind the ring reads the WAL by its own iterator until
+// it catches up.
+//
+// The ring is also the replication backlog: once a replica started it, the server cron keeps tailing
+// the WAL even if no replica is connected, so a replica which reconnects after its WAL files were
+// purged can still resume from the ring.
+//
+// The consecutive batches which are already in the WAL when the ring tails it are grouped into an
+// entry of up to kGroupBytes, and an entry is compressed at most once for the replicas which ask for
+// a compressed stream. A replica joining the ring in the middle of an entry gets the rest of it.
+class WALRing {
+ public:
+  struct Entry {
+    rocksdb::SequenceNumber seq = 0;
+    size_t count = 0;
+    // the write batches encoded as bulk strings
+    std::string bulk;
+    // the sequence and the offset in bulk of each batch of a grouped entry
+    std::vector<std::pair<rocksdb::SequenceNumber, size_t>> batches;
+
+    // Frame returns the bulks compressed as a frame and encoded as a bulk string
+    const std::string &Frame(util::CompressionType type) const;
+
+   private:
+    mutable std::mutex frames_mu_;
+    mutable std::array<std::string, 3> frames_;
+  };
+  using EntryPtr = std::shared_ptr<const Entry>;
+
+  enum class Result {
+    kOK,
+    kNoData,
+    kLagged,
+  };
+
+  static constexpr size_t kGroupBytes = 64 * 1024;
+
+  explicit WALRing(engine::Storage *storage) : storage_(storage) {}
+
+  static EntryPtr MakeEntry(const rocksdb::BatchResult &batch);
+
+  // Get returns the batches from seq to the end of its entry, it's kNoData if there's no new batch in
+  // the WAL, or kLagged if the batch isn't in the ring, i.e. it's dropped or not read yet, or seq isn't
+  // the start of a batch
+  Result Get(rocksdb::SequenceNumber seq, EntryPtr *entry);
+  // Covers returns true if the batch which starts at seq is in the ring or is the next one to be read
+  bool Covers(rocksdb::SequenceNumber seq);
+  // Tail reads the new batches into the ring if a replica has started it, it's called by the server cron
+  void Tail();
+  // Reset drops the ring before the db is replaced
+  void Reset();
+  // GetBacklog returns the sequence of the first batch in the ring, or 0 if it's empty, and its bytes
+  rocksdb::SequenceNumber GetBacklog(size_t *bytes);
+
+ private:
+  engine::Storage *storage_;
+
+  std::mutex mu_;
+  std::deque<EntryPtr> entries_;
+  size_t bytes_ = 0;
+  // the sequence of the next batch to be read from the WAL
+  rocksdb::SequenceNumber next_seq_ = 0;
+  std::unique_ptr<rocksdb::TransactionLogIterator> iter_;
+
+  bool tail();
+  // find only checks if the batch is in the ring if entry is nullptr
+  Result find(rocksdb::SequenceNumber seq, EntryPtr *entry);
+  void push(std::shared_ptr<Entry> entry);
+};
+
 class FeedSlaveThread {
  public:
   explicit FeedSlaveThread(Server *srv, redis::Connection *conn, rocksdb::SequenceNumber next_repl_seq)
@@ -75,6 +152,8 @@ class FeedSlaveThread {
     auto seq = next_repl_seq_.load();
     return seq == 0 ? 0 : seq - 1;
   }
+  // GetAckedSeq returns the latest sequence applied by the replica, it's 0 if the replica doesn't ack
+  rocksdb::SequenceNumber GetAckedSeq() const { return acked_seq_.load(std::memory_order_relaxed); }
 
  private:
   uint64_t interval_ = 0;
@@ -82,14 +161,18 @@ class FeedSlaveThread {
   Server *srv_ = nullptr;
   std::unique_ptr<redis::Connection> conn_ = nullptr;
   std::atomic<rocksdb::SequenceNumber> next_repl_seq_ = 0;
+  std::atomic<rocksdb::SequenceNumber> acked_seq_ = 0;
+  // the acks sent by the replica which aren't parsed yet
+  UniqueEvbuf ack_buf_;
   std::thread t_;
   std::unique_ptr<rocksdb::TransactionLogIterator> iter_ = nullptr;
 
   static const size_t kMaxDelayUpdates = 16;
-  static const size_t kMaxDelayBytes = 16 * 1024;
 
   void loop();
   void checkLivenessIfNeed();
+  // readAcks reads the "REPLCONF ACK <seq>" lines sent by the replica without blocking
+  void readAcks();
 };
 
 class ReplicationThread : private EventCallbackBase<ReplicationThread> {
@@ -159,6 +242,17 @@ class ReplicationThread : private EventCallbackBase<ReplicationThread> {
   std::atomic<int64_t> last_io_time_secs_ = 0;
   bool next_try_old_psync_ = false;
   bool next_try_without_announce_ip_address_ = false;
+  bool next_try_without_compression_ = false;
+  bool next_try_without_ack_ = false;
+  bool next_try_without_ack_ = false;
+  // the compression of the incremental replication stream negotiated with the master
+  util::CompressionType repl_compression_ = util::CompressionType::kNone;
+  // whether the master reads the acks of the applied sequences, and the last acked one
+  bool repl_ack_ = false;
+  rocksdb::SequenceNumber last_acked_seq_ = 0;
+  // whether the master reads the acks of the applied sequences, and the last acked one
+  bool repl_ack_ = false;
+  rocksdb::SequenceNumber last_acked_seq_ = 0;
 
   std::function<bool()> pre_fullsync_cb_;
   std::function<void()> post_fullsync_cb_;
@@ -171,6 +265,10 @@ class ReplicationThread : private EventCallbackBase<ReplicationThread> {
   } fullsync_state_ = kFetchMetaID;
   rocksdb::BackupID fullsync_meta_id_ = 0;
   size_t fullsync_filesize_ = 0;
+  // the bytes of the files fetched by the current full sync, which the fetch concurrency adapts to
+  std::atomic<uint64_t> fullsync_fetched_bytes_ = 0;
+  // the master of an old version can't resume the fetches of the files
+  std::atomic<bool> fetch_file_range_unsupported_ = false;
 
   // Internal states managed by IncrementBatchLoop procedure
   enum IncrementBatchLoopState {
@@ -179,6 +277,15 @@ class ReplicationThread : private EventCallbackBase<ReplicationThread> {
   } incr_state_ = Incr_batch_size;
 
   size_t incr_bulk_len_ = 0;
+  // the received write batches which aren't applied yet
+  std::vector<rocksdb::WriteBatch> pending_batches_;
+  size_t pending_bytes_ = 0;
+
+  // The files fetched by a request of a full sync thread, and the interval to sample the throughput
+  // of the full sync to decide whether to add a thread
+  static constexpr size_t kFetchFilesPerRequest = 4;
+  static constexpr auto kFetchSampleInterval = std::chrono::seconds(1);
+  static constexpr double kFetchThroughputGain = 1.1;
 
   using CBState = CallbacksStateMachine::State;
   CallbacksStateMachine psync_steps_;
@@ -200,8 +307,16 @@ class ReplicationThread : private EventCallbackBase<ReplicationThread> {
 
   // Synchronized-Blocking ops
   Status sendAuth(int sock_fd, ssl_st *ssl);
+  // The part of a file fetched by an interrupted full sync, which the fetch is resumed from
+  struct FetchedPart {
+    uint64_t size = 0;
+    uint32_t crc = 0;
+    std::unique_ptr<rocksdb::WritableFile> file;
+  };
+
+  // part is nullptr unless the fetch is a ranged one
   Status fetchFile(int sock_fd, evbuffer *evbuf, const std::string &dir, const std::string &file, uint32_t crc,
-                   const FetchFileCallback &fn, ssl_st *ssl);
+                   FetchedPart *part, const FetchFileCallback &fn, ssl_st *ssl);
   Status fetchFiles(int sock_fd, const std::string &dir, const std::vector<std::string> &files,
                     const std::vector<uint32_t> &crcs, const FetchFileCallback &fn, ssl_st *ssl);
   Status parallelFetchFile(const std::string &dir, const std::vector<std::pair<std::string, uint32_t>> &files);
@@ -209,7 +324,15 @@ class ReplicationThread : private EventCallbackBase<ReplicationThread> {
   static bool isWrongPsyncNum(std::string_view err);
   static bool isUnknownOption(std::string_view err);
 
-  Status parseWriteBatch(const std::string &batch_string);
+  Status parseWriteBatch(const rocksdb::WriteBatch &write_batch);
+  // addWriteBatch queues a write batch of the master, the queued batches are applied
+  // by one write once they exceed replica-apply-batch-size-kb
+  Status addWriteBatch(std::string &&batch_string);
+  // addFrame queues the write batches in a compressed frame of bulk strings
+  Status addFrame(const std::string &frame);
+  Status applyPendingBatches();
+  // sendAck sends the latest sequence to the master if it changed since the last ack
+  void sendAck(bufferevent *bev);
 };
 
 /*
@@ -20,23 +20,32 @@
 
 #include "slot_import.h"
 
-SlotImport::SlotImport(Server *srv)
-    : Database(srv->storage, kDefaultNamespace), srv_(srv), import_slot_range_(-1, -1), import_status_(kImportNone) {
+#include <algorithm>
+
+SlotImport::SlotImport(Server *srv) : Database(srv->storage, kDefaultNamespace), srv_(srv) {
   std::lock_guard<std::mutex> guard(mutex_);
   // Let metadata_cf_handle_ be nullptr, then get them in real time while use them.
-  // See comments in SlotMigrator::SlotMigrator for detailed reason.
+  // See comments in SlotMigrationWorker::SlotMigrationWorker for detailed reason.
   metadata_cf_handle_ = nullptr;
 }
 
+SlotImport::ImportJob *SlotImport::findJob(const SlotRange &slot_range) {
+  auto iter = std::find_if(jobs_.begin(), jobs_.end(), [&](const auto &job) { return job.slot_range == slot_range; });
+  return iter == jobs_.end() ? nullptr : &*iter;
+}
+
 Status SlotImport::Start(const SlotRange &slot_range) {
   std::lock_guard<std::mutex> guard(mutex_);
-  if (import_status_ == kImportStart) {
+  bool running = false;
+  for (const auto &job : jobs_) {
+    if (job.status != kImportStart) continue;
     // return ok if the same slot is importing
-    if (import_slot_range_ == slot_range) {
-      return Status::OK();
+    if (job.slot_range == slot_range) return Status::OK();
+    if (job.slot_range.HasOverlap(slot_range)) {
+      return {Status::NotOK, fmt::format("the slot(s) {} overlap the importing slot(s) {}", slot_range.String(),
+                                         job.slot_range.String())};
     }
-    return {Status::NotOK,
-            fmt::format("only one importing job is allowed, current importing: {}", import_slot_range_.String())};
+    running = true;
   }
 
   // Clean slot data first
@@ -46,32 +55,35 @@ Status SlotImport::Start(const SlotRange &slot_range) {
     return {Status::NotOK, fmt::format("clear keys of slot(s) error: {}", s.ToString())};
   }
 
-  import_status_ = kImportStart;
-  import_slot_range_ = slot_range;
+  auto finished = [&](const ImportJob &job) {
+    return job.status != kImportStart && (!running || job.slot_range.HasOverlap(slot_range));
+  };
+  jobs_.erase(std::remove_if(jobs_.begin(), jobs_.end(), finished), jobs_.end());
+  jobs_.push_back({slot_range, kImportStart});
   return Status::OK();
 }
 
 Status SlotImport::Success(const SlotRange &slot_range) {
   std::lock_guard<std::mutex> guard(mutex_);
-  if (import_slot_range_ != slot_range) {
-    return {Status::NotOK, fmt::format("mismatch slot, importing slot(s): {}, but got: {}", import_slot_range_.String(),
-                                       slot_range.String())};
+  auto job = findJob(slot_range);
+  if (!job) {
+    return {Status::NotOK, fmt::format("mismatch slot, no importing slot(s): {}", slot_range.String())};
   }
 
-  Status s = srv_->cluster->SetSlotRangeImported(import_slot_range_);
+  Status s = srv_->cluster->SetSlotRangeImported(slot_range);
   if (!s.IsOK()) {
     return {Status::NotOK, fmt::format("unable to set imported status: {}", slot_range.String())};
   }
 
-  import_status_ = kImportSuccess;
+  job->status = kImportSuccess;
   return Status::OK();
 }
 
 Status SlotImport::Fail(const SlotRange &slot_range) {
   std::lock_guard<std::mutex> guard(mutex_);
-  if (import_slot_range_ != slot_range) {
-    return {Status::NotOK, fmt::format("mismatch slot, importing slot(s): {}, but got: {}", import_slot_range_.String(),
-                                       slot_range.String())};
+  auto job = findJob(slot_range);
+  if (!job) {
+    return {Status::NotOK, fmt::format("mismatch slot, no importing slot(s): {}", slot_range.String())};
   }
 
   // Clean imported slot data
@@ -81,18 +93,19 @@ Status SlotImport::Fail(const SlotRange &slot_range) {
     return {Status::NotOK, fmt::format("clear keys of slot(s) error: {}", s.ToString())};
   }
 
-  import_status_ = kImportFailed;
+  job->status = kImportFailed;
   return Status::OK();
 }
 
-Status SlotImport::StopForLinkError() {
+Status SlotImport::StopForLinkError(const SlotRange &slot_range) {
   std::lock_guard<std::mutex> guard(mutex_);
+  auto job = findJob(slot_range);
   // We don't need to do anything if the importer is not started yet.
-  if (import_status_ != kImportStart) return Status::OK();
+  if (!job || job->status != kImportStart) return Status::OK();
 
   // Maybe server has failovered
   // Situation:
-  // Refer to the situation described in SlotMigrator::SlotMigrator
+  // Refer to the situation described in SlotMigrationWorker::SlotMigrationWorker
   // 1. Change server to slave when it is importing data.
   // 2. Source server's migration process end after destination server has finished replication.
   // 3. The migration link closed by source server, then this function will be call by OnEvent.
@@ -102,54 +115,56 @@ Status SlotImport::StopForLinkError() {
   if (!srv_->IsSlave()) {
     // Clean imported slot data
     engine::Context ctx(srv_->storage);
-    auto s = ClearKeysOfSlotRange(ctx, namespace_, import_slot_range_);
+    auto s = ClearKeysOfSlotRange(ctx, namespace_, slot_range);
     if (!s.ok()) {
       return {Status::NotOK, fmt::format("clear keys of slot error: {}", s.ToString())};
     }
   }
 
-  import_status_ = kImportFailed;
+  job->status = kImportFailed;
   return Status::OK();
 }
 
-SlotRange SlotImport::GetSlotRange() {
+std::vector<SlotRange> SlotImport::GetSlotRanges() {
   std::lock_guard<std::mutex> guard(mutex_);
-  // import_slot_ only be set when import_status_ is kImportStart
-  if (import_status_ != kImportStart) {
-    return {-1, -1};
+  std::vector<SlotRange> slot_ranges;
+  for (const auto &job : jobs_) {
+    if (job.status == kImportStart) slot_ranges.push_back(job.slot_range);
   }
-  return import_slot_range_;
+  return slot_ranges;
 }
 
-int SlotImport::GetStatus() {
+bool SlotImport::IsImportingSlot(int slot) {
   std::lock_guard<std::mutex> guard(mutex_);
-  return import_status_;
+  return std::any_of(jobs_.begin(), jobs_.end(),
+                     [slot](const auto &job) { return job.status == kImportStart && job.slot_range.Contains(slot); });
 }
 
 void SlotImport::GetImportInfo(std::string *info) {
   std::lock_guard<std::mutex> guard(mutex_);
   info->clear();
-  if (!import_slot_range_.IsValid()) {
-    return;
-  }
+  for (const auto &job : jobs_) {
+    std::string import_stat;
+    switch (job.status) {
+      case kImportNone:
+        import_stat = "none";
+        break;
+      case kImportStart:
+        import_stat = "start";
+        break;
+      case kImportSuccess:
+        import_stat = "success";
+        break;
+      case kImportFailed:
+        import_stat = "error";
+        break;
+      default:
+        break;
+    }
 
-  std::string import_stat;
-  switch (import_status_) {
-    case kImportNone:
-      import_stat = "none";
-      break;
-    case kImportStart:
-      import_stat = "start";
-      break;
-    case kImportSuccess:
-      import_stat = "success";
-      break;
-    case kImportFailed:
-      import_stat = "error";
-      break;
-    default:
-      break;
+    info->append(fmt::format("importing_slot(s): {}\r\nimport_state: {}\r\n", job.slot_range.String(), import_stat));
+  }
+  if (!jobs_.empty()) {
+    info->append(fmt::format("import_rate: {}\r\n", srv_->stats.GetInstantaneousMetric(STATS_METRIC_IMPORT_BYTES)));
   }
-
-  *info = fmt::format("importing_slot(s): {}\r\nimport_state: {}\r\n", import_slot_range_.String(), import_stat);
 }
@@ -38,6 +38,8 @@ enum ImportStatus {
   kImportNone,
 };
 
+// SlotImport tracks the slot ranges imported from the migrating nodes, several ranges
+// may be imported concurrently over their own connections.
 class SlotImport : public redis::Database {
  public:
   explicit SlotImport(Server *srv);
@@ -46,14 +48,22 @@ class SlotImport : public redis::Database {
   Status Start(const SlotRange &slot_range);
   Status Success(const SlotRange &slot_range);
   Status Fail(const SlotRange &slot_range);
-  Status StopForLinkError();
-  SlotRange GetSlotRange();
-  int GetStatus();
+  Status StopForLinkError(const SlotRange &slot_range);
+  // The slot ranges being imported
+  std::vector<SlotRange> GetSlotRanges();
+  bool IsImportingSlot(int slot);
   void GetImportInfo(std::string *info);
 
  private:
+  struct ImportJob {
+    SlotRange slot_range;
+    int status;
+  };
+
   Server *srv_ = nullptr;
   std::mutex mutex_;
-  SlotRange import_slot_range_;
-  int import_status_;
+  // the finished jobs are kept for the info until another job starts while none is running
+  std::vector<ImportJob> jobs_;
+
+  ImportJob *findJob(const SlotRange &slot_range);
 };
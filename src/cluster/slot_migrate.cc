@@ -20,6 +20,11 @@
 
 #include "slot_migrate.h"
 
+#include <rocksdb/sst_file_writer.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
 #include <memory>
 #include <utility>
 
@@ -29,9 +34,14 @@
 #include "io_util.h"
 #include "storage/batch_extractor.h"
 #include "storage/iterator.h"
+#include "storage/ttl_index.h"
+#include "string_util.h"
 #include "sync_migrate_context.h"
 #include "thread_util.h"
 #include "time_util.h"
+#include "types/redis_bitmap_container.h"
+#include "types/redis_sortedint_block.h"
+#include "types/redis_string.h"
 #include "types/redis_stream_base.h"
 
 constexpr std::string_view errFailedToSendCommands = "failed to send commands to restore a key";
@@ -44,14 +54,17 @@ static std::map<RedisType, std::string> type_to_cmd = {
     {kRedisZSet, "zadd"},  {kRedisBitmap, "setbit"}, {kRedisSortedint, "siadd"}, {kRedisStream, "xadd"},
 };
 
-SlotMigrator::SlotMigrator(Server *srv)
+SlotMigrationWorker::SlotMigrationWorker(Server *srv, std::shared_ptr<rocksdb::RateLimiter> batch_rate_limiter,
+                                         MigrationThrottle *throttle)
     : Database(srv->storage, kDefaultNamespace),
       srv_(srv),
       max_migration_speed_(srv->GetConfig()->migrate_speed),
       max_pipeline_size_(srv->GetConfig()->pipeline_size),
       seq_gap_limit_(srv->GetConfig()->sequence_gap),
       migrate_batch_bytes_per_sec_(srv->GetConfig()->migrate_batch_rate_limit_mb * MiB),
-      migrate_batch_size_bytes_(srv->GetConfig()->migrate_batch_size_kb * KiB) {
+      migrate_batch_size_bytes_(srv->GetConfig()->migrate_batch_size_kb * KiB),
+      batch_rate_limiter_(std::move(batch_rate_limiter)),
+      throttle_(throttle) {
   // Let metadata_cf_handle_ be nullptr, and get them in real time to avoid accessing invalid pointer,
   // because metadata_cf_handle_ and db_ will be destroyed if DB is reopened.
   // [Situation]:
@@ -74,10 +87,9 @@ SlotMigrator::SlotMigrator(Server *srv)
   }
 }
 
-Status SlotMigrator::PerformSlotRangeMigration(const std::string &node_id, std::string &dst_ip, int dst_port,
-                                               const SlotRange &slot_range, SyncMigrateContext *blocking_ctx) {
-  // TODO: concurrent migration, multiple migration jobs
-  // Only one slot migration job at the same time
+Status SlotMigrationWorker::PerformSlotRangeMigration(const std::string &node_id, std::string &dst_ip, int dst_port,
+                                                      const SlotRange &slot_range, SyncMigrateContext *blocking_ctx) {
+  // Only one slot migration job at the same time in a worker
   SlotRange empty_slot_range = {-1, -1};
   if (!slot_range_.compare_exchange_strong(empty_slot_range, slot_range)) {
     return {Status::NotOK, "There is already a migrating job"};
@@ -127,7 +139,7 @@ Status SlotMigrator::PerformSlotRangeMigration(const std::string &node_id, std::
   return Status::OK();
 }
 
-SlotMigrator::~SlotMigrator() {
+SlotMigrationWorker::~SlotMigrationWorker() {
   if (thread_state_ == ThreadState::Running) {
     stop_migration_ = true;
     thread_state_ = ThreadState::Terminated;
@@ -138,16 +150,19 @@ SlotMigrator::~SlotMigrator() {
   }
 }
 
-Status SlotMigrator::CreateMigrationThread() {
+Status SlotMigrationWorker::CreateMigrationThread() {
   t_ = GET_OR_RET(util::CreateThread("slot-migrate", [this] {
     thread_state_ = ThreadState::Running;
     this->loop();
   }));
+  if (auto s = util::ThreadSetAffinity(t_, srv_->GetConfig()->replication_cpus); !s) {
+    LOG(WARNING) << "Failed to pin the slot migrating thread: " << s.Msg();
+  }
 
   return Status::OK();
 }
 
-void SlotMigrator::loop() {
+void SlotMigrationWorker::loop() {
   while (true) {
     {
       std::unique_lock<std::mutex> ul(job_mutex_);
@@ -174,7 +189,7 @@ void SlotMigrator::loop() {
   }
 }
 
-void SlotMigrator::runMigrationProcess() {
+void SlotMigrationWorker::runMigrationProcess() {
   current_stage_ = SlotMigrationStage::kStart;
 
   while (true) {
@@ -261,7 +276,7 @@ void SlotMigrator::runMigrationProcess() {
   }
 }
 
-Status SlotMigrator::startMigration() {
+Status SlotMigrationWorker::startMigration() {
   // Get snapshot and sequence
   slot_snapshot_ = storage_->GetDB()->GetSnapshot();
   if (!slot_snapshot_) {
@@ -270,6 +285,9 @@ Status SlotMigrator::startMigration() {
 
   wal_begin_seq_ = slot_snapshot_->GetSequenceNumber();
   last_send_time_ = 0;
+  dst_load_supported_ = true;
+  last_dst_load_check_ms_ = 0;
+  dst_load_.clear();
 
   // Connect to the destination node
   auto result = util::SockConnect(dst_ip_, dst_port_);
@@ -296,10 +314,17 @@ Status SlotMigrator::startMigration() {
 
   migration_type_ = srv_->GetConfig()->migrate_type;
 
-  // If the APPLYBATCH command is not supported on the destination,
-  // we will fall back to the redis-command migration type.
+  // If the APPLYSST command is not supported on the destination, we will fall back to the raw-key-value
+  // migration type, and if the APPLYBATCH command is not supported either, to the redis-command one.
+  if (migration_type_ == MigrationType::kRawSSTFile) {
+    bool supported = GET_OR_RET(supportedCommandOnDstNode(*dst_fd_, "applysst"));
+    if (!supported) {
+      LOG(INFO) << "APPLYSST command is not supported, use raw key value for migration";
+      migration_type_ = MigrationType::kRawKeyValue;
+    }
+  }
   if (migration_type_ == MigrationType::kRawKeyValue) {
-    bool supported = GET_OR_RET(supportedApplyBatchCommandOnDstNode(*dst_fd_));
+    bool supported = GET_OR_RET(supportedCommandOnDstNode(*dst_fd_, "applybatch"));
     if (!supported) {
       LOG(INFO) << "APPLYBATCH command is not supported, use redis command for migration";
       migration_type_ = MigrationType::kRedisCommand;
@@ -312,25 +337,27 @@ Status SlotMigrator::startMigration() {
   return Status::OK();
 }
 
-Status SlotMigrator::sendSnapshot() {
+Status SlotMigrationWorker::sendSnapshot() {
   if (migration_type_ == MigrationType::kRedisCommand) {
     return sendSnapshotByCmd();
   } else if (migration_type_ == MigrationType::kRawKeyValue) {
     return sendSnapshotByRawKV();
+  } else if (migration_type_ == MigrationType::kRawSSTFile) {
+    return sendSnapshotBySSTFile();
   }
   return {Status::NotOK, std::string(errUnsupportedMigrationType)};
 }
 
-Status SlotMigrator::syncWAL() {
+Status SlotMigrationWorker::syncWAL() {
   if (migration_type_ == MigrationType::kRedisCommand) {
     return syncWALByCmd();
-  } else if (migration_type_ == MigrationType::kRawKeyValue) {
+  } else if (migration_type_ == MigrationType::kRawKeyValue || migration_type_ == MigrationType::kRawSSTFile) {
     return syncWALByRawKV();
   }
   return {Status::NotOK, std::string(errUnsupportedMigrationType)};
 }
 
-Status SlotMigrator::sendSnapshotByCmd() {
+Status SlotMigrationWorker::sendSnapshotByCmd() {
   uint64_t migrated_key_cnt = 0;
   uint64_t expired_key_cnt = 0;
   uint64_t empty_key_cnt = 0;
@@ -339,31 +366,25 @@ Status SlotMigrator::sendSnapshotByCmd() {
 
   LOG(INFO) << "[migrate] Start migrating snapshot of slot(s): " << slot_range.String();
 
-  // Construct key prefix to iterate the keys belong to the target slot
-  std::string prefix = ComposeSlotKeyPrefix(namespace_, slot_range.start);
-  LOG(INFO) << "[migrate] Iterate keys of slot(s), key's prefix: " << prefix;
+  // Iterate the keys belong to the target slots, bounded by the prefixes of the slot range
+  engine::SlotRangeBounds bounds(namespace_, slot_range);
+  LOG(INFO) << "[migrate] Iterate keys of slot(s), key's prefix: " << bounds.LowerBound();
 
   rocksdb::ReadOptions read_options = storage_->DefaultScanOptions();
   read_options.snapshot = slot_snapshot_;
-  Slice prefix_slice(prefix);
-  read_options.iterate_lower_bound = &prefix_slice;
+  bounds.Apply(&read_options);
   rocksdb::ColumnFamilyHandle *cf_handle = storage_->GetCFHandle(ColumnFamilyID::Metadata);
   auto iter = util::UniqueIterator(storage_->GetDB()->NewIterator(read_options, cf_handle));
 
-  // Seek to the beginning of keys start with 'prefix' and iterate all these keys
   int current_slot = slot_range.start;
-  for (iter->Seek(prefix); iter->Valid(); iter->Next()) {
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
     // The migrating task has to be stopped, if server role is changed from master to slave
     // or flush command (flushdb or flushall) is executed
     if (stop_migration_) {
       return {Status::NotOK, std::string(errMigrationTaskCanceled)};
     }
 
-    // Iteration is out of range
     current_slot = ExtractSlotId(iter->key());
-    if (!slot_range.Contains(current_slot)) {
-      break;
-    }
 
     // Get user key
     auto [_, user_key] = ExtractNamespaceKey(iter->key(), /*slot_id_encoded=*/true);
@@ -409,7 +430,7 @@ Status SlotMigrator::sendSnapshotByCmd() {
   return Status::OK();
 }
 
-Status SlotMigrator::syncWALByCmd() {
+Status SlotMigrationWorker::syncWALByCmd() {
   // Send incremental data from WAL circularly until new increment less than a certain amount
   auto s = syncWalBeforeForbiddingSlot();
   if (!s.IsOK()) {
@@ -427,7 +448,7 @@ Status SlotMigrator::syncWALByCmd() {
   return Status::OK();
 }
 
-Status SlotMigrator::finishSuccessfulMigration() {
+Status SlotMigrationWorker::finishSuccessfulMigration() {
   if (stop_migration_) {
     return {Status::NotOK, std::string(errMigrationTaskCanceled)};
   }
@@ -450,7 +471,7 @@ Status SlotMigrator::finishSuccessfulMigration() {
   return Status::OK();
 }
 
-Status SlotMigrator::finishFailedMigration() {
+Status SlotMigrationWorker::finishFailedMigration() {
   // Stop slot will forbid writing
   migrate_failed_slot_range_ = slot_range_.load();
   forbidden_slot_range_ = {-1, -1};
@@ -464,7 +485,7 @@ Status SlotMigrator::finishFailedMigration() {
   return Status::OK();
 }
 
-void SlotMigrator::clean() {
+void SlotMigrationWorker::clean() {
   LOG(INFO) << "[migrate] Clean resources of migrating slot(s) " << slot_range_.load().String();
   if (slot_snapshot_) {
     storage_->GetDB()->ReleaseSnapshot(slot_snapshot_);
@@ -481,7 +502,7 @@ void SlotMigrator::clean() {
   SetStopMigrationFlag(false);
 }
 
-Status SlotMigrator::authOnDstNode(int sock_fd, const std::string &password) {
+Status SlotMigrationWorker::authOnDstNode(int sock_fd, const std::string &password) {
   std::string cmd = redis::ArrayOfBulkStrings({"auth", password});
   auto s = util::SockSend(sock_fd, cmd);
   if (!s.IsOK()) {
@@ -496,7 +517,7 @@ Status SlotMigrator::authOnDstNode(int sock_fd, const std::string &password) {
   return Status::OK();
 }
 
-Status SlotMigrator::setImportStatusOnDstNode(int sock_fd, int status) {
+Status SlotMigrationWorker::setImportStatusOnDstNode(int sock_fd, int status) {
   if (sock_fd <= 0) return {Status::NotOK, "invalid socket descriptor"};
 
   std::string cmd =
@@ -514,8 +535,8 @@ Status SlotMigrator::setImportStatusOnDstNode(int sock_fd, int status) {
   return Status::OK();
 }
 
-StatusOr<bool> SlotMigrator::supportedApplyBatchCommandOnDstNode(int sock_fd) {
-  std::string cmd = redis::ArrayOfBulkStrings({"command", "info", "applybatch"});
+StatusOr<bool> SlotMigrationWorker::supportedCommandOnDstNode(int sock_fd, const std::string &command) {
+  std::string cmd = redis::ArrayOfBulkStrings({"command", "info", command});
   auto s = util::SockSend(sock_fd, cmd);
   if (!s.IsOK()) {
     return s.Prefixed("failed to send command info to the destination node");
@@ -541,7 +562,7 @@ StatusOr<bool> SlotMigrator::supportedApplyBatchCommandOnDstNode(int sock_fd) {
   return false;
 }
 
-Status SlotMigrator::checkSingleResponse(int sock_fd) { return checkMultipleResponses(sock_fd, 1); }
+Status SlotMigrationWorker::checkSingleResponse(int sock_fd) { return checkMultipleResponses(sock_fd, 1); }
 
 // Commands  |  Response            |  Instance
 // ++++++++++++++++++++++++++++++++++++++++
@@ -569,7 +590,7 @@ Status SlotMigrator::checkSingleResponse(int sock_fd) { return checkMultipleResp
 // del          Redis::Integer
 // xadd         Redis::BulkString
 // bitfield     Redis::Array           *1\r\n:0
-Status SlotMigrator::checkMultipleResponses(int sock_fd, int total) {
+Status SlotMigrationWorker::checkMultipleResponses(int sock_fd, int total) {
   if (sock_fd < 0 || total <= 0) {
     return {Status::NotOK, fmt::format("invalid arguments: sock_fd={}, count={}", sock_fd, total)};
   }
@@ -673,9 +694,9 @@ Status SlotMigrator::checkMultipleResponses(int sock_fd, int total) {
   }
 }
 
-StatusOr<KeyMigrationResult> SlotMigrator::migrateOneKey(const rocksdb::Slice &key,
-                                                         const rocksdb::Slice &encoded_metadata,
-                                                         std::string *restore_cmds) {
+StatusOr<KeyMigrationResult> SlotMigrationWorker::migrateOneKey(const rocksdb::Slice &key,
+                                                                const rocksdb::Slice &encoded_metadata,
+                                                                std::string *restore_cmds) {
   std::string bytes = encoded_metadata.ToString();
   Metadata metadata(kRedisNone, false);
   if (auto s = metadata.Decode(bytes); !s.ok()) {
@@ -699,12 +720,46 @@ StatusOr<KeyMigrationResult> SlotMigrator::migrateOneKey(const rocksdb::Slice &k
       }
       break;
     }
+    case kRedisHash: {
+      HashMetadata hash_md(false);
+      if (auto s = hash_md.Decode(bytes); !s.ok()) {
+        return {Status::NotOK, s.ToString()};
+      }
+
+      auto s = hash_md.IsInline() ? migrateInlineHash(key, hash_md, restore_cmds)
+                                  : migrateComplexKey(key, hash_md, restore_cmds);
+      if (!s.IsOK()) {
+        return s.Prefixed("failed to migrate hash key");
+      }
+      break;
+    }
+    case kRedisBitmap: {
+      BitmapMetadata bitmap_md(false);
+      if (auto s = bitmap_md.Decode(bytes); !s.ok()) {
+        return {Status::NotOK, s.ToString()};
+      }
+
+      auto s = migrateComplexKey(key, bitmap_md, restore_cmds);
+      if (!s.IsOK()) {
+        return s.Prefixed("failed to migrate bitmap key");
+      }
+      break;
+    }
+    case kRedisSortedint: {
+      SortedintMetadata sortedint_md(false);
+      if (auto s = sortedint_md.Decode(bytes); !s.ok()) {
+        return {Status::NotOK, s.ToString()};
+      }
+
+      auto s = migrateComplexKey(key, sortedint_md, restore_cmds);
+      if (!s.IsOK()) {
+        return s.Prefixed("failed to migrate sortedint key");
+      }
+      break;
+    }
     case kRedisList:
     case kRedisZSet:
-    case kRedisBitmap:
-    case kRedisHash:
-    case kRedisSet:
-    case kRedisSortedint: {
+    case kRedisSet: {
       auto s = migrateComplexKey(key, metadata, restore_cmds);
       if (!s.IsOK()) {
         return s.Prefixed("failed to migrate complex key");
@@ -736,8 +791,10 @@ StatusOr<KeyMigrationResult> SlotMigrator::migrateOneKey(const rocksdb::Slice &k
   return KeyMigrationResult::kMigrated;
 }
 
-Status SlotMigrator::migrateSimpleKey(const rocksdb::Slice &key, const Metadata &metadata, const std::string &bytes,
-                                      std::string *restore_cmds) {
+Status SlotMigrationWorker::migrateSimpleKey(const rocksdb::Slice &key, const Metadata &metadata,
+                                             const std::string &bytes, std::string *restore_cmds) {
+  if (metadata.IsSplit()) return migrateChunkedString(key, metadata, restore_cmds);
+
   std::vector<std::string> command = {"SET", key.ToString(), bytes.substr(Metadata::GetOffsetAfterExpire(bytes[0]))};
   if (metadata.expire > 0) {
     command.emplace_back("PXAT");
@@ -756,7 +813,75 @@ Status SlotMigrator::migrateSimpleKey(const rocksdb::Slice &key, const Metadata
   return Status::OK();
 }
 
-Status SlotMigrator::migrateComplexKey(const rocksdb::Slice &key, const Metadata &metadata, std::string *restore_cmds) {
+Status SlotMigrationWorker::migrateChunkedString(const rocksdb::Slice &key, const Metadata &metadata,
+                                                 std::string *restore_cmds) {
+  // The value is restored chunk by chunk, so no command carries the whole value
+  std::vector<std::string> command = {"SET", key.ToString(), ""};
+  if (metadata.expire > 0) {
+    command.emplace_back("PXAT");
+    command.emplace_back(std::to_string(metadata.expire));
+  }
+  *restore_cmds += redis::ArrayOfBulkStrings(command);
+  current_pipeline_size_++;
+
+  std::string slot_key = AppendNamespacePrefix(key);
+  std::string prefix_subkey = InternalKey(slot_key, "", metadata.version, true).Encode();
+  rocksdb::ReadOptions read_options = storage_->DefaultScanOptions();
+  read_options.snapshot = slot_snapshot_;
+  Slice prefix_slice(prefix_subkey);
+  read_options.iterate_lower_bound = &prefix_slice;
+  auto iter = util::UniqueIterator(storage_->GetDB()->NewIterator(read_options));
+  for (iter->Seek(prefix_subkey); iter->Valid() && iter->key().starts_with(prefix_subkey); iter->Next()) {
+    if (stop_migration_) {
+      return {Status::NotOK, std::string(errMigrationTaskCanceled)};
+    }
+
+    InternalKey inkey(iter->key(), true);
+    auto offset = static_cast<uint64_t>(DecodeFixed32(inkey.GetSubKey().data())) * redis::String::kChunkSize;
+    command = {"SETRANGE", key.ToString(), std::to_string(offset), iter->value().ToString()};
+    *restore_cmds += redis::ArrayOfBulkStrings(command);
+    current_pipeline_size_++;
+
+    auto s = sendCmdsPipelineIfNeed(restore_cmds, false);
+    if (!s.IsOK()) {
+      return s.Prefixed(errFailedToSendCommands);
+    }
+  }
+  if (!iter->status().ok()) return {Status::NotOK, iter->status().ToString()};
+
+  auto s = sendCmdsPipelineIfNeed(restore_cmds, false);
+  if (!s.IsOK()) {
+    return s.Prefixed(errFailedToSendCommands);
+  }
+  return Status::OK();
+}
+
+Status SlotMigrationWorker::migrateInlineHash(const rocksdb::Slice &key, const HashMetadata &metadata,
+                                              std::string *restore_cmds) {
+  // The fields are in the metadata, and the inline limit keeps them small enough for one command
+  std::vector<std::string> command = {"HMSET", key.ToString()};
+  for (const auto &[field, value] : metadata.inline_fields) {
+    command.emplace_back(field);
+    command.emplace_back(value);
+  }
+  *restore_cmds += redis::ArrayOfBulkStrings(command);
+  current_pipeline_size_++;
+
+  if (metadata.expire > 0) {
+    *restore_cmds += redis::ArrayOfBulkStrings({"PEXPIREAT", key.ToString(), std::to_string(metadata.expire)});
+    current_pipeline_size_++;
+  }
+
+  auto s = sendCmdsPipelineIfNeed(restore_cmds, false);
+  if (!s.IsOK()) {
+    return s.Prefixed(errFailedToSendCommands);
+  }
+
+  return Status::OK();
+}
+
+Status SlotMigrationWorker::migrateComplexKey(const rocksdb::Slice &key, const Metadata &metadata,
+                                              std::string *restore_cmds) {
   std::string cmd;
   {
     auto iter = type_to_cmd.find(metadata.Type());
@@ -802,7 +927,16 @@ Status SlotMigrator::migrateComplexKey(const rocksdb::Slice &key, const Metadata
       }
       case kRedisSortedint: {
         auto id = DecodeFixed64(inkey.GetSubKey().ToString().data());
-        user_cmd.emplace_back(std::to_string(id));
+        // The metadata of the sortedints is decoded as SortedintMetadata by migrateOneKey
+        if (!static_cast<const SortedintMetadata &>(metadata).IsBlockEncoded()) {
+          user_cmd.emplace_back(std::to_string(id));
+          break;
+        }
+        std::vector<uint64_t> ids;
+        if (auto s = SortedintBlock::Decode(id, iter->value(), &ids); !s.ok()) {
+          return {Status::NotOK, s.ToString()};
+        }
+        for (const auto block_id : ids) user_cmd.emplace_back(std::to_string(block_id));
         break;
       }
       case kRedisZSet: {
@@ -812,7 +946,8 @@ Status SlotMigrator::migrateComplexKey(const rocksdb::Slice &key, const Metadata
         break;
       }
       case kRedisBitmap: {
-        auto s = migrateBitmapKey(inkey, &iter, &user_cmd, restore_cmds);
+        // The metadata of the bitmaps is decoded as BitmapMetadata by migrateOneKey
+        auto s = migrateBitmapKey(inkey, static_cast<const BitmapMetadata &>(metadata), &iter, &user_cmd, restore_cmds);
         if (!s.IsOK()) {
           return s.Prefixed("failed to migrate bitmap key");
         }
@@ -880,7 +1015,7 @@ Status SlotMigrator::migrateComplexKey(const rocksdb::Slice &key, const Metadata
   return Status::OK();
 }
 
-Status SlotMigrator::migrateStream(const Slice &key, const StreamMetadata &metadata, std::string *restore_cmds) {
+Status SlotMigrationWorker::migrateStream(const Slice &key, const StreamMetadata &metadata, std::string *restore_cmds) {
   rocksdb::ReadOptions read_options = storage_->DefaultScanOptions();
   read_options.snapshot = slot_snapshot_;
   std::string ns_key = AppendNamespacePrefix(key);
@@ -904,7 +1039,7 @@ Status SlotMigrator::migrateStream(const Slice &key, const StreamMetadata &metad
       break;
     }
 
-    auto s = WriteBatchExtractor::ExtractStreamAddCommand(true, iter->key(), iter->value(), &user_cmd);
+    auto s = WriteBatchExtractor::ExtractStreamAddCommand(true, key, iter->key(), iter->value(), &user_cmd);
     if (!s.IsOK()) {
       return s;
     }
@@ -945,8 +1080,9 @@ Status SlotMigrator::migrateStream(const Slice &key, const StreamMetadata &metad
   return Status::OK();
 }
 
-Status SlotMigrator::migrateBitmapKey(const InternalKey &inkey, std::unique_ptr<rocksdb::Iterator> *iter,
-                                      std::vector<std::string> *user_cmd, std::string *restore_cmds) {
+Status SlotMigrationWorker::migrateBitmapKey(const InternalKey &inkey, const BitmapMetadata &metadata,
+                                             std::unique_ptr<rocksdb::Iterator> *iter,
+                                             std::vector<std::string> *user_cmd, std::string *restore_cmds) {
   std::string index_str = inkey.GetSubKey().ToString();
   std::string fragment = (*iter)->value().ToString();
   auto parse_result = ParseInt<int>(index_str, 10);
@@ -955,6 +1091,13 @@ Status SlotMigrator::migrateBitmapKey(const InternalKey &inkey, std::unique_ptr<
   }
 
   uint32_t index = *parse_result;
+  if (metadata.IsRoaring()) {
+    std::string dense;
+    if (auto s = redis::BitmapContainer::ToDense(fragment, 0, &dense); !s.ok()) {
+      return {Status::NotOK, s.ToString()};
+    }
+    fragment = std::move(dense);
+  }
 
   // Bitmap does not have hmset-like command
   // TODO(chrisZMF): Use hmset-like command for efficiency
@@ -981,7 +1124,7 @@ Status SlotMigrator::migrateBitmapKey(const InternalKey &inkey, std::unique_ptr<
   return Status::OK();
 }
 
-Status SlotMigrator::sendCmdsPipelineIfNeed(std::string *commands, bool need) {
+Status SlotMigrationWorker::sendCmdsPipelineIfNeed(std::string *commands, bool need) {
   if (stop_migration_) {
     return {Status::NotOK, std::string(errMigrationTaskCanceled)};
   }
@@ -1004,6 +1147,7 @@ Status SlotMigrator::sendCmdsPipelineIfNeed(std::string *commands, bool need) {
   }
 
   last_send_time_ = util::GetTimeStampUS();
+  srv_->stats.IncrMigrateBytes(commands->size());
 
   s = checkMultipleResponses(*dst_fd_, current_pipeline_size_);
   if (!s.IsOK()) {
@@ -1017,7 +1161,7 @@ Status SlotMigrator::sendCmdsPipelineIfNeed(std::string *commands, bool need) {
   return Status::OK();
 }
 
-void SlotMigrator::setForbiddenSlotRange(const SlotRange &slot_range) {
+void SlotMigrationWorker::setForbiddenSlotRange(const SlotRange &slot_range) {
   LOG(INFO) << "[migrate] Setting forbidden slot(s) " << slot_range.String();
   // Block server to set forbidden slot
   uint64_t during = util::GetTimeStampUS();
@@ -1029,12 +1173,12 @@ void SlotMigrator::setForbiddenSlotRange(const SlotRange &slot_range) {
   LOG(INFO) << "[migrate] To set forbidden slot, server was blocked for " << during << "us";
 }
 
-void SlotMigrator::ReleaseForbiddenSlotRange() {
+void SlotMigrationWorker::ReleaseForbiddenSlotRange() {
   LOG(INFO) << "[migrate] Release forbidden slot(s) " << forbidden_slot_range_.load().String();
   forbidden_slot_range_ = {-1, -1};
 }
 
-void SlotMigrator::applyMigrationSpeedLimit() const {
+void SlotMigrationWorker::applyMigrationSpeedLimit() const {
   if (max_migration_speed_ > 0) {
     uint64_t current_time = util::GetTimeStampUS();
     uint64_t per_request_time = 1000000 * max_pipeline_size_ / max_migration_speed_;
@@ -1049,28 +1193,23 @@ void SlotMigrator::applyMigrationSpeedLimit() const {
   }
 }
 
-Status SlotMigrator::generateCmdsFromBatch(rocksdb::BatchResult *batch, std::string *commands) {
+Status SlotMigrationWorker::generateCmdsFromBatch(rocksdb::BatchResult *batch, std::string *commands) {
   // Iterate batch to get keys and construct commands for keys
-  WriteBatchExtractor write_batch_extractor(storage_->IsSlotIdEncoded(), slot_range_, false);
+  // the commands are serialized straight into the pipeline, in the order of the batch
+  WriteBatchExtractor write_batch_extractor(storage_->IsSlotIdEncoded(), slot_range_, false, storage_);
+  write_batch_extractor.SetRESPOutput(commands);
   rocksdb::Status status = batch->writeBatchPtr->Iterate(&write_batch_extractor);
   if (!status.ok()) {
     LOG(ERROR) << "[migrate] Failed to parse write batch, Err: " << status.ToString();
     return {Status::NotOK};
   }
 
-  // Get all constructed commands
-  auto resp_commands = write_batch_extractor.GetRESPCommands();
-  for (const auto &iter : *resp_commands) {
-    for (const auto &it : iter.second) {
-      *commands += it;
-      current_pipeline_size_++;
-    }
-  }
-
+  current_pipeline_size_ += static_cast<int>(write_batch_extractor.GetRESPCommandCount());
   return Status::OK();
 }
 
-Status SlotMigrator::migrateIncrementData(std::unique_ptr<rocksdb::TransactionLogIterator> *iter, uint64_t end_seq) {
+Status SlotMigrationWorker::migrateIncrementData(std::unique_ptr<rocksdb::TransactionLogIterator> *iter,
+                                                 uint64_t end_seq) {
   if (!(*iter) || !(*iter)->Valid()) {
     LOG(ERROR) << "[migrate] WAL iterator is invalid";
     return {Status::NotOK};
@@ -1129,7 +1268,7 @@ Status SlotMigrator::migrateIncrementData(std::unique_ptr<rocksdb::TransactionLo
   return Status::OK();
 }
 
-Status SlotMigrator::syncWalBeforeForbiddingSlot() {
+Status SlotMigrationWorker::syncWalBeforeForbiddingSlot() {
   uint32_t count = 0;
 
   while (count < kMaxLoopTimes) {
@@ -1164,7 +1303,7 @@ Status SlotMigrator::syncWalBeforeForbiddingSlot() {
   return Status::OK();
 }
 
-Status SlotMigrator::syncWalAfterForbiddingSlot() {
+Status SlotMigrationWorker::syncWalAfterForbiddingSlot() {
   uint64_t latest_seq = storage_->GetDB()->GetLatestSequenceNumber();
 
   // No incremental data
@@ -1189,7 +1328,7 @@ Status SlotMigrator::syncWalAfterForbiddingSlot() {
   return Status::OK();
 }
 
-void SlotMigrator::GetMigrationInfo(std::string *info) const {
+void SlotMigrationWorker::GetMigrationInfo(std::string *info) const {
   info->clear();
   if (!slot_range_.load().IsValid() && !forbidden_slot_range_.load().IsValid() &&
       !migrate_failed_slot_range_.load().IsValid()) {
@@ -1223,12 +1362,14 @@ void SlotMigrator::GetMigrationInfo(std::string *info) const {
                       dst_node_, task_state);
 }
 
-void SlotMigrator::CancelSyncCtx() {
+bool SlotMigrationWorker::CancelSyncCtx(const SyncMigrateContext *ctx) {
   std::unique_lock<std::mutex> lock(blocking_mutex_);
+  if (blocking_context_ != ctx) return false;
   blocking_context_ = nullptr;
+  return true;
 }
 
-void SlotMigrator::resumeSyncCtx(const Status &migrate_result) {
+void SlotMigrationWorker::resumeSyncCtx(const Status &migrate_result) {
   std::unique_lock<std::mutex> lock(blocking_mutex_);
   if (blocking_context_) {
     blocking_context_->Resume(migrate_result);
@@ -1237,35 +1378,100 @@ void SlotMigrator::resumeSyncCtx(const Status &migrate_result) {
   }
 }
 
-Status SlotMigrator::sendMigrationBatch(BatchSender *batch) {
+Status SlotMigrationWorker::sendMigrationBatch(BatchSender *batch) {
   // user may dynamically change some configs, apply it when send data
   batch->SetMaxBytes(migrate_batch_size_bytes_);
-  batch->SetBytesPerSecond(migrate_batch_bytes_per_sec_);
-  return batch->Send();
+  batch->SetBytesPerSecond(GET_OR_RET(batchRateLimit()));
+  auto sent_bytes = batch->GetSentBytes();
+  GET_OR_RET(batch->Send());
+  srv_->stats.IncrMigrateBytes(batch->GetSentBytes() - sent_bytes);
+  return Status::OK();
+}
+
+StatusOr<size_t> SlotMigrationWorker::batchRateLimit() {
+  size_t max_rate = migrate_batch_bytes_per_sec_;
+  if (!srv_->GetConfig()->migrate_adaptive_rate) return max_rate;
+  if (max_rate == 0) max_rate = MigrationThrottle::kMaxBytesPerSec;
+
+  std::vector<std::string> load;
+  if (auto src_load = throttle_->CheckLoad(); !src_load.empty()) load.emplace_back("source:" + src_load);
+  if (auto dst_load = GET_OR_RET(checkLoadOnDstNode()); !dst_load.empty()) {
+    load.emplace_back("destination:" + dst_load);
+  }
+  return throttle_->Adjust(max_rate, util::StringJoin(load, [](const auto &v) -> decltype(auto) { return v; }, " "),
+                           util::GetTimeStampMS());
+}
+
+StatusOr<std::string> SlotMigrationWorker::checkLoadOnDstNode() {
+  auto now = util::GetTimeStampMS();
+  if (!dst_load_supported_ || now - last_dst_load_check_ms_ < MigrationThrottle::kIntervalMs) return dst_load_;
+  last_dst_load_check_ms_ = now;
+
+  GET_OR_RET(util::SockSend(*dst_fd_, redis::ArrayOfBulkStrings({"cluster", "overload"}))
+                 .Prefixed("failed to check the load of the destination node"));
+  std::string line = GET_OR_RET(util::SockReadLine(*dst_fd_));
+  if (line.compare(0, 1, "-") == 0) {
+    LOG(INFO) << "[migrate] The destination node doesn't report its load, the rate only adapts to the source node";
+    dst_load_supported_ = false;
+    dst_load_.clear();
+  } else {
+    dst_load_ = line.substr(1);
+  }
+  return dst_load_;
 }
 
-Status SlotMigrator::sendSnapshotByRawKV() {
+Status SlotMigrationWorker::sendZSetRankByRawKV(const rocksdb::Slice &ns_key, const rocksdb::Slice &metadata_bytes,
+                                                BatchSender *batch) {
+  Metadata metadata(kRedisNone, false);
+  if (auto s = metadata.Decode(metadata_bytes); !s.ok()) return {Status::NotOK, s.ToString()};
+
+  // the counts of the rank index are copied as is, there are none if the zset isn't rank indexed
+  std::string prefix_key = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
+  std::string next_version_prefix_key =
+      InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
+  rocksdb::ReadOptions read_options = storage_->DefaultScanOptions();
+  read_options.snapshot = slot_snapshot_;
+  rocksdb::Slice upper_bound(next_version_prefix_key);
+  read_options.iterate_upper_bound = &upper_bound;
+  rocksdb::Slice lower_bound(prefix_key);
+  read_options.iterate_lower_bound = &lower_bound;
+
+  auto rank_cf = storage_->GetCFHandle(ColumnFamilyID::ZSetRank);
+  auto iter = util::UniqueIterator(storage_->GetDB()->NewIterator(read_options, rank_cf));
+  for (iter->Seek(prefix_key); iter->Valid(); iter->Next()) {
+    GET_OR_RET(batch->Put(rank_cf, iter->key(), iter->value()));
+  }
+  if (!iter->status().ok()) return {Status::NotOK, iter->status().ToString()};
+  return Status::OK();
+}
+
+Status SlotMigrationWorker::sendKeyIDByRawKV(const rocksdb::Slice &ns_key, const rocksdb::Slice &metadata_bytes,
+                                             BatchSender *batch) {
+  Metadata metadata(kRedisNone, false);
+  if (auto s = metadata.Decode(metadata_bytes); !s.ok()) return {Status::NotOK, s.ToString()};
+  if (metadata.IsSingleKVType() || !InternalKey::IsCompactVersion(metadata.version)) return Status::OK();
+
+  // the raw batches aren't indexed by the destination, and its compact subkeys are only found by the key ID entry
+  auto [_, user_key] = ExtractNamespaceKey(ns_key, storage_->IsSlotIdEncoded());
+  auto id_key = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).EncodePrefix();
+  return batch->Put(storage_->GetCFHandle(ColumnFamilyID::KeyID), id_key, user_key);
+}
+
+Status SlotMigrationWorker::sendSnapshotByRawKV() {
   uint64_t start_ts = util::GetTimeStampMS();
   auto slot_range = slot_range_.load();
   LOG(INFO) << "[migrate] Migrating snapshot of slot(s) " << slot_range.String() << " by raw key value";
 
-  auto prefix = ComposeSlotKeyPrefix(namespace_, slot_range.start);
+  engine::SlotRangeBounds bounds(namespace_, slot_range);
   rocksdb::ReadOptions read_options = storage_->DefaultScanOptions();
   read_options.snapshot = slot_snapshot_;
-  rocksdb::Slice prefix_slice(prefix);
-  read_options.iterate_lower_bound = &prefix_slice;
+  bounds.Apply(&read_options);
   auto no_txn_ctx = engine::Context::NoTransactionContext(storage_);
   engine::DBIterator iter(no_txn_ctx, read_options);
 
-  BatchSender batch_sender(*dst_fd_, migrate_batch_size_bytes_, migrate_batch_bytes_per_sec_);
-
-  for (iter.Seek(prefix); iter.Valid(); iter.Next()) {
-    // Iteration is out of range
-    auto key_slot_id = ExtractSlotId(iter.Key());
-    if (!slot_range.Contains(key_slot_id)) {
-      break;
-    }
+  BatchSender batch_sender(*dst_fd_, migrate_batch_size_bytes_, migrate_batch_bytes_per_sec_, batch_rate_limiter_);
 
+  for (iter.Seek(bounds.LowerBound()); iter.Valid(); iter.Next()) {
     auto redis_type = iter.Type();
     std::string log_data;
     if (redis_type == RedisType::kRedisList) {
@@ -1278,6 +1484,7 @@ Status SlotMigrator::sendSnapshotByRawKV() {
     batch_sender.SetPrefixLogData(log_data);
 
     GET_OR_RET(batch_sender.Put(storage_->GetCFHandle(ColumnFamilyID::Metadata), iter.Key(), iter.Value()));
+    GET_OR_RET(sendKeyIDByRawKV(iter.Key(), iter.Value(), &batch_sender));
 
     auto subkey_iter = iter.GetSubKeyIterator();
     if (!subkey_iter) {
@@ -1301,6 +1508,10 @@ Status SlotMigrator::sendSnapshotByRawKV() {
       }
     }
 
+    if (redis_type == RedisType::kRedisZSet) {
+      GET_OR_RET(sendZSetRankByRawKV(iter.Key(), iter.Value(), &batch_sender));
+    }
+
     if (batch_sender.IsFull()) {
       GET_OR_RET(sendMigrationBatch(&batch_sender));
     }
@@ -1318,10 +1529,107 @@ Status SlotMigrator::sendSnapshotByRawKV() {
   return Status::OK();
 }
 
-Status SlotMigrator::syncWALByRawKV() {
+Status SlotMigrationWorker::sendSnapshotBySSTFile() {
+  uint64_t start_ts = util::GetTimeStampMS();
+  auto slot_range = slot_range_.load();
+  LOG(INFO) << "[migrate] Migrating snapshot of slot(s) " << slot_range.String() << " by SST files";
+
+  // All the column families keyed by the slot, the entries of the slot range are contiguous in each of them
+  engine::SlotRangeBounds bounds(namespace_, slot_range);
+  rocksdb::ReadOptions read_options = storage_->DefaultScanOptions();
+  read_options.snapshot = slot_snapshot_;
+  bounds.Apply(&read_options);
+
+  // The TTL index is keyed by the expire time first, so its entries of the slot range are picked out of all of them
+  rocksdb::ReadOptions ttl_index_read_options = storage_->DefaultScanOptions();
+  ttl_index_read_options.snapshot = slot_snapshot_;
+  auto in_slot_range = [&](const rocksdb::Slice &index_key) {
+    uint64_t expire = 0;
+    rocksdb::Slice ns_key;
+    if (!engine::ParseTTLIndexKey(index_key, &expire, &ns_key)) return false;
+    auto [ns, user_key] = ExtractNamespaceKey(ns_key, storage_->IsSlotIdEncoded());
+    return ns == namespace_ && slot_range.Contains(GetSlotIdFromKey(user_key.ToStringView()));
+  };
+
+  auto path = fmt::format("{}/migrate-{}.sst", srv_->GetConfig()->dir, slot_range.start);
+  uint64_t sent_bytes = 0, sent_files = 0, entries = 0;
+  for (auto cf_id : {ColumnFamilyID::Metadata, ColumnFamilyID::PrimarySubkey, ColumnFamilyID::SecondarySubkey,
+                     ColumnFamilyID::Stream, ColumnFamilyID::ZSetRank, ColumnFamilyID::KeyID,
+                     ColumnFamilyID::TTLIndex}) {
+    bool is_ttl_index = cf_id == ColumnFamilyID::TTLIndex;
+    auto cf = storage_->GetCFHandle(cf_id);
+    rocksdb::SstFileWriter writer(rocksdb::EnvOptions(), storage_->GetDB()->GetOptions(cf), cf);
+    bool opened = false;
+    auto send_file = [&]() -> Status {
+      opened = false;
+      auto s = writer.Finish();
+      if (!s.ok()) return {Status::NotOK, "failed to finish the SST file: " + s.ToString()};
+      sent_bytes += GET_OR_RET(sendSSTFile(cf->GetName(), path));
+      sent_files++;
+      return Status::OK();
+    };
+
+    auto iter = util::UniqueIterator(
+        storage_->GetDB()->NewIterator(is_ttl_index ? ttl_index_read_options : read_options, cf));
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      if (is_ttl_index && !in_slot_range(iter->key())) continue;
+      if (!opened) {
+        auto s = writer.Open(path);
+        if (!s.ok()) return {Status::NotOK, "failed to open the SST file: " + s.ToString()};
+        opened = true;
+      }
+      auto s = writer.Put(iter->key(), iter->value());
+      if (!s.ok()) return {Status::NotOK, "failed to write the SST file: " + s.ToString()};
+      entries++;
+      if (writer.FileSize() >= migrate_batch_size_bytes_) GET_OR_RET(send_file());
+    }
+    if (!iter->status().ok()) return {Status::NotOK, iter->status().ToString()};
+    if (opened) GET_OR_RET(send_file());
+  }
+
+  auto elapsed = util::GetTimeStampMS() - start_ts;
+  LOG(INFO) << fmt::format(
+      "[migrate] Succeed to migrate snapshot range, slot(s): {}, elapsed: {} ms, "
+      "sent: {} bytes, SST files: {}, entries: {}",
+      slot_range.String(), elapsed, sent_bytes, sent_files, entries);
+
+  return Status::OK();
+}
+
+StatusOr<uint64_t> SlotMigrationWorker::sendSSTFile(const std::string &cf_name, const std::string &path) {
+  std::string content;
+  {
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file.good()) return {Status::NotOK, "failed to open " + path};
+    content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  }
+  std::remove(path.c_str());
+
+  // The files share the rate limit of the batches, since they take the place of them
+  if (auto rate = GET_OR_RET(batchRateLimit()); rate > 0) {
+    batch_rate_limiter_->SetBytesPerSecond(static_cast<int64_t>(rate));
+    auto single_burst = batch_rate_limiter_->GetSingleBurstBytes();
+    for (auto left = static_cast<int64_t>(content.size()); left > 0;) {
+      auto request_size = std::min(left, single_burst);
+      batch_rate_limiter_->Request(request_size, rocksdb::Env::IOPriority::IO_HIGH, nullptr);
+      left -= request_size;
+    }
+  }
+
+  GET_OR_RET(util::SockSend(*dst_fd_, redis::ArrayOfBulkStrings({"APPLYSST", cf_name, content}))
+                 .Prefixed("failed to send APPLYSST command"));
+  std::string line = GET_OR_RET(util::SockReadLine(*dst_fd_));
+  if (line.compare(0, 1, "-") == 0) {
+    return {Status::NotOK, "failed to apply the SST file on the destination node: " + line};
+  }
+  srv_->stats.IncrMigrateBytes(content.size());
+  return content.size();
+}
+
+Status SlotMigrationWorker::syncWALByRawKV() {
   uint64_t start_ts = util::GetTimeStampMS();
   LOG(INFO) << "[migrate] Syncing WAL of slot(s) " << slot_range_.load().String() << " by raw key value";
-  BatchSender batch_sender(*dst_fd_, migrate_batch_size_bytes_, migrate_batch_bytes_per_sec_);
+  BatchSender batch_sender(*dst_fd_, migrate_batch_size_bytes_, migrate_batch_bytes_per_sec_, batch_rate_limiter_);
 
   int epoch = 1;
   uint64_t wal_incremental_seq = 0;
@@ -1363,7 +1671,7 @@ Status SlotMigrator::syncWALByRawKV() {
   return Status::OK();
 }
 
-bool SlotMigrator::catchUpIncrementalWAL() {
+bool SlotMigrationWorker::catchUpIncrementalWAL() {
   uint64_t gap = storage_->GetDB()->GetLatestSequenceNumber() - wal_begin_seq_;
   if (gap <= seq_gap_limit_) {
     LOG(INFO) << fmt::format(
@@ -1374,14 +1682,14 @@ bool SlotMigrator::catchUpIncrementalWAL() {
   return false;
 }
 
-Status SlotMigrator::migrateIncrementalDataByRawKV(uint64_t end_seq, BatchSender *batch_sender) {
+Status SlotMigrationWorker::migrateIncrementalDataByRawKV(uint64_t end_seq, BatchSender *batch_sender) {
   engine::WALIterator wal_iter(storage_, slot_range_);
   uint64_t start_seq = wal_begin_seq_ + 1;
   for (wal_iter.Seek(start_seq); wal_iter.Valid(); wal_iter.Next()) {
     if (wal_iter.NextSequenceNumber() > end_seq + 1) {
       break;
     }
-    auto item = wal_iter.Item();
+    const auto &item = wal_iter.Item();
     switch (item.type) {
       case engine::WALItem::Type::kTypeLogData: {
         GET_OR_RET(batch_sender->PutLogData(item.key));
@@ -1420,3 +1728,143 @@ Status SlotMigrator::migrateIncrementalDataByRawKV(uint64_t end_seq, BatchSender
   // send the remaining data
   return sendMigrationBatch(batch_sender);
 }
+
+SlotMigrator::SlotMigrator(Server *srv)
+    : Database(srv->storage, kDefaultNamespace),
+      srv_(srv),
+      batch_rate_limiter_(rocksdb::NewGenericRateLimiter(
+          static_cast<int64_t>(srv->GetConfig()->migrate_batch_rate_limit_mb * MiB))),
+      throttle_(srv) {
+  // See the comments in SlotMigrationWorker::SlotMigrationWorker
+  metadata_cf_handle_ = nullptr;
+}
+
+Status SlotMigrator::CreateMigrationThread() {
+  std::lock_guard<std::mutex> guard(workers_mu_);
+  GET_OR_RET(addWorker());
+  return Status::OK();
+}
+
+StatusOr<SlotMigrationWorker *> SlotMigrator::addWorker() {
+  auto n = num_workers_.load(std::memory_order_relaxed);
+  if (n >= kMaxConcurrency) return {Status::NotOK, "too many migration workers"};
+
+  auto worker = std::make_unique<SlotMigrationWorker>(srv_, batch_rate_limiter_, &throttle_);
+  GET_OR_RET(worker->CreateMigrationThread());
+  workers_[n] = std::move(worker);
+  num_workers_.store(n + 1, std::memory_order_release);
+  return workers_[n].get();
+}
+
+Status SlotMigrator::PerformSlotRangeMigration(const std::string &node_id, std::string &dst_ip, int dst_port,
+                                               const SlotRange &slot_range, SyncMigrateContext *blocking_ctx) {
+  std::lock_guard<std::mutex> guard(workers_mu_);
+
+  auto concurrency = static_cast<size_t>(srv_->GetConfig()->migrate_concurrency);
+  size_t running = 0;
+  SlotMigrationWorker *idle_worker = nullptr;
+  for (size_t i = 0; i < num_workers_; i++) {
+    auto worker = workers_[i].get();
+    if (slot_range.HasOverlap(worker->GetForbiddenSlotRange())) {
+      return {Status::NotOK, "Can't migrate slot which has been migrated"};
+    }
+    auto migrating_slot_range = worker->GetMigratingSlotRange();
+    if (!migrating_slot_range.IsValid()) {
+      if (!idle_worker) idle_worker = worker;
+      continue;
+    }
+    if (slot_range.HasOverlap(migrating_slot_range)) {
+      return {Status::NotOK, fmt::format("Can't migrate slot which is being migrated in {}",
+                                         migrating_slot_range.String())};
+    }
+    running++;
+  }
+  if (running >= concurrency) {
+    if (concurrency == 1) return {Status::NotOK, "There is already a migrating job"};
+    return {Status::NotOK, fmt::format("There are already {} migrating jobs", running)};
+  }
+
+  if (!idle_worker) idle_worker = GET_OR_RET(addWorker());
+  return idle_worker->PerformSlotRangeMigration(node_id, dst_ip, dst_port, slot_range, blocking_ctx);
+}
+
+void SlotMigrator::ReleaseForbiddenSlotRange(const SlotRange &slot_range) {
+  forEachWorker([&](SlotMigrationWorker *worker) {
+    if (worker->GetForbiddenSlotRange() == slot_range) worker->ReleaseForbiddenSlotRange();
+  });
+}
+
+void SlotMigrator::SetMaxMigrationSpeed(int value) {
+  forEachWorker([=](SlotMigrationWorker *worker) { worker->SetMaxMigrationSpeed(value); });
+}
+
+void SlotMigrator::SetMaxPipelineSize(int value) {
+  forEachWorker([=](SlotMigrationWorker *worker) { worker->SetMaxPipelineSize(value); });
+}
+
+void SlotMigrator::SetSequenceGapLimit(int value) {
+  forEachWorker([=](SlotMigrationWorker *worker) { worker->SetSequenceGapLimit(value); });
+}
+
+void SlotMigrator::SetMigrateBatchRateLimit(size_t bytes_per_sec) {
+  forEachWorker([=](SlotMigrationWorker *worker) { worker->SetMigrateBatchRateLimit(bytes_per_sec); });
+}
+
+void SlotMigrator::SetMigrateBatchSize(size_t size) {
+  forEachWorker([=](SlotMigrationWorker *worker) { worker->SetMigrateBatchSize(size); });
+}
+
+void SlotMigrator::SetStopMigrationFlag(bool value) {
+  forEachWorker([=](SlotMigrationWorker *worker) { worker->SetStopMigrationFlag(value); });
+}
+
+bool SlotMigrator::IsMigrationInProgress() const {
+  bool in_progress = false;
+  forEachWorker([&](SlotMigrationWorker *worker) { in_progress = in_progress || worker->IsMigrationInProgress(); });
+  return in_progress;
+}
+
+SlotMigrationStage SlotMigrator::GetCurrentSlotMigrationStage() const {
+  auto stage = SlotMigrationStage::kNone;
+  forEachWorker([&](SlotMigrationWorker *worker) {
+    if (stage == SlotMigrationStage::kNone) stage = worker->GetCurrentSlotMigrationStage();
+  });
+  return stage;
+}
+
+bool SlotMigrator::IsWriteForbiddenSlot(int slot) const {
+  bool forbidden = false;
+  forEachWorker([&](SlotMigrationWorker *worker) {
+    forbidden = forbidden || worker->GetForbiddenSlotRange().Contains(slot);
+  });
+  return forbidden;
+}
+
+std::vector<std::pair<SlotRange, std::string>> SlotMigrator::GetMigratingSlotRanges() const {
+  std::vector<std::pair<SlotRange, std::string>> ranges;
+  forEachWorker([&](SlotMigrationWorker *worker) {
+    auto slot_range = worker->GetMigratingSlotRange();
+    if (slot_range.IsValid()) ranges.emplace_back(slot_range, worker->GetDstNode());
+  });
+  return ranges;
+}
+
+void SlotMigrator::GetMigrationInfo(std::string *info) const {
+  info->clear();
+  forEachWorker([&](SlotMigrationWorker *worker) {
+    std::string worker_info;
+    worker->GetMigrationInfo(&worker_info);
+    info->append(worker_info);
+  });
+  if (info->empty()) return;
+
+  auto config = srv_->GetConfig();
+  size_t rate_limit = config->migrate_adaptive_rate ? throttle_.GetRate() : config->migrate_batch_rate_limit_mb * MiB;
+  info->append(fmt::format("migrate_rate: {}\r\nmigrate_rate_limit: {}\r\nmigrate_overload: {}\r\n",
+                           srv_->stats.GetInstantaneousMetric(STATS_METRIC_MIGRATE_BYTES), rate_limit,
+                           config->migrate_adaptive_rate ? throttle_.GetLoad() : ""));
+}
+
+void SlotMigrator::CancelSyncCtx(const SyncMigrateContext *ctx) {
+  forEachWorker([&](SlotMigrationWorker *worker) { worker->CancelSyncCtx(ctx); });
+}
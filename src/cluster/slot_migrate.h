@@ -26,6 +26,7 @@
 #include <rocksdb/transaction_log.h>
 #include <rocksdb/write_batch.h>
 
+#include <array>
 #include <chrono>
 #include <map>
 #include <memory>
@@ -36,6 +37,7 @@
 
 #include "batch_sender.h"
 #include "encoding.h"
+#include "migration_throttle.h"
 #include "parse_util.h"
 #include "server/server.h"
 #include "slot_import.h"
@@ -52,7 +54,13 @@ enum class MigrationType {
   ///
   /// If downstream is not compatible with raw key-value, this migration type will
   /// auto switch to kRedisCommand.
-  kRawKeyValue
+  kRawKeyValue,
+  /// Build SST files of the snapshot, which are ingested by the "APPLYSST" command in kvrocks,
+  /// then sync the WAL as kRawKeyValue does.
+  ///
+  /// If downstream is not compatible with SST files, this migration type will
+  /// auto switch to kRawKeyValue.
+  kRawSSTFile
 };
 
 enum class MigrationState { kNone = 0, kStarted, kSuccess, kFailed };
@@ -84,12 +92,16 @@ struct SlotMigrationJob {
 
 class SyncMigrateContext;
 
-class SlotMigrator : public redis::Database {
+// SlotMigrationWorker migrates one slot range at a time on its own thread, over its own
+// connection to the destination node and from its own snapshot.
+class SlotMigrationWorker : public redis::Database {
  public:
-  explicit SlotMigrator(Server *srv);
-  SlotMigrator(const SlotMigrator &other) = delete;
-  SlotMigrator &operator=(const SlotMigrator &other) = delete;
-  ~SlotMigrator();
+  // The batches of the raw-key-value migration are charged to batch_rate_limiter, which is shared by the workers
+  SlotMigrationWorker(Server *srv, std::shared_ptr<rocksdb::RateLimiter> batch_rate_limiter,
+                      MigrationThrottle *throttle);
+  SlotMigrationWorker(const SlotMigrationWorker &other) = delete;
+  SlotMigrationWorker &operator=(const SlotMigrationWorker &other) = delete;
+  ~SlotMigrationWorker();
 
   Status CreateMigrationThread();
   Status PerformSlotRangeMigration(const std::string &node_id, std::string &dst_ip, int dst_port,
@@ -113,7 +125,8 @@ class SlotMigrator : public redis::Database {
   SlotRange GetMigratingSlotRange() const { return slot_range_; }
   std::string GetDstNode() const { return dst_node_; }
   void GetMigrationInfo(std::string *info) const;
-  void CancelSyncCtx();
+  // CancelSyncCtx returns false if the worker isn't blocking the context
+  bool CancelSyncCtx(const SyncMigrateContext *ctx);
 
  private:
   void loop();
@@ -128,7 +141,7 @@ class SlotMigrator : public redis::Database {
 
   Status authOnDstNode(int sock_fd, const std::string &password);
   Status setImportStatusOnDstNode(int sock_fd, int status);
-  static StatusOr<bool> supportedApplyBatchCommandOnDstNode(int sock_fd);
+  static StatusOr<bool> supportedCommandOnDstNode(int sock_fd, const std::string &command);
 
   Status sendSnapshotByCmd();
   Status syncWALByCmd();
@@ -139,10 +152,13 @@ class SlotMigrator : public redis::Database {
                                              std::string *restore_cmds);
   Status migrateSimpleKey(const rocksdb::Slice &key, const Metadata &metadata, const std::string &bytes,
                           std::string *restore_cmds);
+  Status migrateChunkedString(const rocksdb::Slice &key, const Metadata &metadata, std::string *restore_cmds);
   Status migrateComplexKey(const rocksdb::Slice &key, const Metadata &metadata, std::string *restore_cmds);
+  Status migrateInlineHash(const rocksdb::Slice &key, const HashMetadata &metadata, std::string *restore_cmds);
   Status migrateStream(const rocksdb::Slice &key, const StreamMetadata &metadata, std::string *restore_cmds);
-  Status migrateBitmapKey(const InternalKey &inkey, std::unique_ptr<rocksdb::Iterator> *iter,
-                          std::vector<std::string> *user_cmd, std::string *restore_cmds);
+  Status migrateBitmapKey(const InternalKey &inkey, const BitmapMetadata &metadata,
+                          std::unique_ptr<rocksdb::Iterator> *iter, std::vector<std::string> *user_cmd,
+                          std::string *restore_cmds);
 
   Status sendCmdsPipelineIfNeed(std::string *commands, bool need);
   void applyMigrationSpeedLimit() const;
@@ -152,8 +168,19 @@ class SlotMigrator : public redis::Database {
   Status syncWalAfterForbiddingSlot();
 
   Status sendMigrationBatch(BatchSender *batch);
+  // batchRateLimit returns the rate of the batches, which adapts to the load of both nodes if
+  // migrate-adaptive-rate is enabled
+  StatusOr<size_t> batchRateLimit();
+  // checkLoadOnDstNode returns the signals by which the destination is overloaded, it's asked once per
+  // interval of the throttle, and never again if it doesn't support CLUSTER OVERLOAD
+  StatusOr<std::string> checkLoadOnDstNode();
   Status sendSnapshotByRawKV();
+  Status sendZSetRankByRawKV(const rocksdb::Slice &ns_key, const rocksdb::Slice &metadata_bytes, BatchSender *batch);
+  Status sendKeyIDByRawKV(const rocksdb::Slice &ns_key, const rocksdb::Slice &metadata_bytes, BatchSender *batch);
   Status syncWALByRawKV();
+  Status sendSnapshotBySSTFile();
+  // sendSSTFile returns the size of the file, which is removed after it's read
+  StatusOr<uint64_t> sendSSTFile(const std::string &cf_name, const std::string &path);
   bool catchUpIncrementalWAL();
   Status migrateIncrementalDataByRawKV(uint64_t end_seq, BatchSender *batch_sender);
 
@@ -178,6 +205,11 @@ class SlotMigrator : public redis::Database {
   uint64_t seq_gap_limit_ = kDefaultSequenceGapLimit;
   std::atomic<size_t> migrate_batch_bytes_per_sec_ = 1 * GiB;
   std::atomic<size_t> migrate_batch_size_bytes_;
+  std::shared_ptr<rocksdb::RateLimiter> batch_rate_limiter_;
+  MigrationThrottle *throttle_;
+  bool dst_load_supported_ = true;
+  uint64_t last_dst_load_check_ms_ = 0;
+  std::string dst_load_;
 
   SlotMigrationStage current_stage_ = SlotMigrationStage::kNone;
   ParserState parser_state_ = ParserState::ArrayLen;
@@ -211,3 +243,53 @@ class SlotMigrator : public redis::Database {
   std::mutex blocking_mutex_;
   SyncMigrateContext *blocking_context_ = nullptr;
 };
+
+// SlotMigrator runs the slot migrations, up to migrate-concurrency slot ranges concurrently.
+// The workers are created on demand and kept idle once their migration is done, so the forbidden
+// slot ranges can be checked without locks on the write path.
+class SlotMigrator : public redis::Database {
+ public:
+  static constexpr size_t kMaxConcurrency = 16;
+
+  explicit SlotMigrator(Server *srv);
+  SlotMigrator(const SlotMigrator &other) = delete;
+  SlotMigrator &operator=(const SlotMigrator &other) = delete;
+  ~SlotMigrator() = default;
+
+  Status CreateMigrationThread();
+  Status PerformSlotRangeMigration(const std::string &node_id, std::string &dst_ip, int dst_port,
+                                   const SlotRange &range, SyncMigrateContext *blocking_ctx = nullptr);
+  void ReleaseForbiddenSlotRange(const SlotRange &slot_range);
+  void SetMaxMigrationSpeed(int value);
+  void SetMaxPipelineSize(int value);
+  void SetSequenceGapLimit(int value);
+  void SetMigrateBatchRateLimit(size_t bytes_per_sec);
+  void SetMigrateBatchSize(size_t size);
+  void SetStopMigrationFlag(bool value);
+  bool IsMigrationInProgress() const;
+  // The stage of the first running migration, kNone if there's none
+  SlotMigrationStage GetCurrentSlotMigrationStage() const;
+  bool IsWriteForbiddenSlot(int slot) const;
+  // The migrating slot ranges with their destination nodes
+  std::vector<std::pair<SlotRange, std::string>> GetMigratingSlotRanges() const;
+  void GetMigrationInfo(std::string *info) const;
+  void CancelSyncCtx(const SyncMigrateContext *ctx);
+  MigrationThrottle *GetThrottle() { return &throttle_; }
+
+ private:
+  Server *srv_;
+  std::shared_ptr<rocksdb::RateLimiter> batch_rate_limiter_;
+  MigrationThrottle throttle_;
+
+  std::mutex workers_mu_;
+  // workers_[0, num_workers_) are created, they're only added under workers_mu_
+  std::array<std::unique_ptr<SlotMigrationWorker>, kMaxConcurrency> workers_;
+  std::atomic<size_t> num_workers_ = 0;
+
+  StatusOr<SlotMigrationWorker *> addWorker();
+  template <typename F>
+  void forEachWorker(F &&f) const {
+    auto n = num_workers_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < n; i++) f(workers_[i].get());
+  }
+};
@@ -46,7 +46,7 @@ void SyncMigrateContext::OnEvent(bufferevent *bev, int16_t events) {
   if (events & (BEV_EVENT_EOF | BEV_EVENT_ERROR)) {
     timer_.reset();
 
-    slot_migrator->CancelSyncCtx();
+    slot_migrator->CancelSyncCtx(this);
   }
   conn_->OnEvent(bev, events);
 }
@@ -57,7 +57,7 @@ void SyncMigrateContext::TimerCB(int, [[maybe_unused]] int16_t events) {
   conn_->Reply(conn_->NilString());
   timer_.reset();
 
-  slot_migrator->CancelSyncCtx();
+  slot_migrator->CancelSyncCtx(this);
 
   auto bev = conn_->GetBufferEvent();
   conn_->SetCB(bev);
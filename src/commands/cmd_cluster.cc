@@ -18,12 +18,17 @@
  *
  */
 
+#include <algorithm>
+#include <map>
+
 #include "cluster/cluster_defs.h"
 #include "cluster/slot_import.h"
 #include "cluster/sync_migrate_context.h"
+#include "command_parser.h"
 #include "commander.h"
 #include "error_constants.h"
 #include "status.h"
+#include "storage/iterator.h"
 
 namespace redis {
 
@@ -32,7 +37,8 @@ class CommandCluster : public Commander {
   Status Parse(const std::vector<std::string> &args) override {
     subcommand_ = util::ToLower(args[1]);
 
-    if (args.size() == 2 && (subcommand_ == "nodes" || subcommand_ == "slots" || subcommand_ == "info"))
+    if (args.size() == 2 &&
+        (subcommand_ == "nodes" || subcommand_ == "slots" || subcommand_ == "info" || subcommand_ == "overload"))
       return Status::OK();
 
     // CLUSTER RESET [HARD|SOFT]
@@ -62,7 +68,51 @@ class CommandCluster : public Commander {
 
     if (subcommand_ == "replicas" && args_.size() == 3) return Status::OK();
 
-    return {Status::RedisParseErr, "CLUSTER command, CLUSTER INFO|NODES|SLOTS|KEYSLOT|RESET|REPLICAS"};
+    // CLUSTER GETKEYSINSLOT <slot> <count> and CLUSTER COUNTKEYSINSLOT <slot>
+    if ((subcommand_ == "getkeysinslot" && args_.size() == 4) ||
+        (subcommand_ == "countkeysinslot" && args_.size() == 3)) {
+      CommandParser parser(args, 2);
+      slot_ = GET_OR_RET(parser.TakeInt<int>(NumericRange<int>{0, kClusterSlots - 1}));
+      if (parser.Good()) keys_count_ = GET_OR_RET(parser.TakeInt<int64_t>(NumericRange<int64_t>{0, INT64_MAX}));
+      return Status::OK();
+    }
+
+    // CLUSTER SLOT-STATS SLOTSRANGE <start> <end> | ORDERBY <KEY-COUNT|BYTES> [LIMIT <limit>] [ASC|DESC]
+    if (subcommand_ == "slot-stats") {
+      CommandParser parser(args, 2);
+      if (parser.EatEqICase("slotsrange")) {
+        slot_stats_start_ = GET_OR_RET(parser.TakeInt<int>(NumericRange<int>{0, kClusterSlots - 1}));
+        slot_stats_end_ = GET_OR_RET(parser.TakeInt<int>(NumericRange<int>{0, kClusterSlots - 1}));
+        if (slot_stats_start_ > slot_stats_end_) return {Status::RedisParseErr, "Invalid slot range"};
+      } else if (parser.EatEqICase("orderby")) {
+        if (parser.EatEqICase("key-count")) {
+          slot_stats_order_by_ = "key-count";
+        } else if (parser.EatEqICase("bytes")) {
+          slot_stats_order_by_ = "bytes";
+        } else {
+          return {Status::RedisParseErr, "Unrecognized sort metric for ORDERBY"};
+        }
+        while (parser.Good()) {
+          if (parser.EatEqICase("limit")) {
+            slot_stats_limit_ = GET_OR_RET(parser.TakeInt<int>(NumericRange<int>{1, kClusterSlots}));
+          } else if (parser.EatEqICase("asc")) {
+            slot_stats_desc_ = false;
+          } else if (parser.EatEqICase("desc")) {
+            slot_stats_desc_ = true;
+          } else {
+            return parser.InvalidSyntax();
+          }
+        }
+      } else {
+        return {Status::RedisParseErr, errInvalidSyntax};
+      }
+      if (parser.Good()) return parser.InvalidSyntax();
+      return Status::OK();
+    }
+
+    return {Status::RedisParseErr,
+            "CLUSTER command, CLUSTER INFO|NODES|SLOTS|KEYSLOT|RESET|REPLICAS|OVERLOAD|SLOT-STATS|GETKEYSINSLOT|"
+            "COUNTKEYSINSLOT"};
   }
 
   Status Execute(Server *srv, Connection *conn, std::string *output) override {
@@ -120,6 +170,54 @@ class CommandCluster : public Commander {
       } else {
         return s;
       }
+    } else if (subcommand_ == "overload") {
+      // The signals by which the slot migrations from other nodes back off, see MigrationThrottle
+      *output = redis::SimpleString(srv->slot_migrator->GetThrottle()->CheckLoad());
+    } else if (subcommand_ == "slot-stats") {
+      // The sizes are estimated from the table properties without scanning the keys, see Storage::GetSlotStats
+      std::map<uint16_t, SlotStats> stats;
+      GET_OR_RET(srv->storage->GetSlotStats(&stats));
+
+      std::vector<std::pair<int, SlotStats>> entries;
+      if (slot_stats_order_by_.empty()) {
+        for (int slot = slot_stats_start_; slot <= slot_stats_end_; slot++) {
+          auto iter = stats.find(slot);
+          entries.emplace_back(slot, iter != stats.end() ? iter->second : SlotStats{});
+        }
+      } else {
+        // only the slots with the data are ordered
+        entries.assign(stats.begin(), stats.end());
+        auto metric = [this](const SlotStats &stat) {
+          return slot_stats_order_by_ == "bytes" ? stat.bytes : stat.n_key;
+        };
+        std::stable_sort(entries.begin(), entries.end(), [&](const auto &a, const auto &b) {
+          return slot_stats_desc_ ? metric(a.second) > metric(b.second) : metric(a.second) < metric(b.second);
+        });
+        if (entries.size() > static_cast<size_t>(slot_stats_limit_)) entries.resize(slot_stats_limit_);
+      }
+
+      output->append(redis::MultiLen(entries.size()));
+      for (const auto &[slot, stat] : entries) {
+        output->append(redis::MultiLen(2));
+        output->append(redis::Integer(slot));
+        output->append(conn->HeaderOfMap(2));
+        output->append(redis::BulkString("key-count"));
+        output->append(redis::Integer(stat.n_key));
+        output->append(redis::BulkString("bytes"));
+        output->append(redis::Integer(stat.bytes));
+      }
+    } else if (subcommand_ == "getkeysinslot" || subcommand_ == "countkeysinslot") {
+      // The iterator is bounded by the prefix of the slot, so only the keys of the slot are read
+      engine::Context ctx(srv->storage);
+      engine::DBIterator iter(ctx, ctx.DefaultScanOptions(), slot_);
+      bool get_keys = subcommand_ == "getkeysinslot";
+      std::vector<std::string> keys;
+      int64_t n_keys = 0;
+      for (iter.Seek(); iter.Valid() && (!get_keys || n_keys < keys_count_); iter.Next()) {
+        if (get_keys) keys.emplace_back(std::get<1>(iter.UserKey()).ToString());
+        n_keys++;
+      }
+      *output = get_keys ? ArrayOfBulkStrings(keys) : redis::Integer(n_keys);
     } else if (subcommand_ == "reset") {
       Status s = srv->cluster->Reset();
       if (s.IsOK()) {
@@ -145,6 +243,13 @@ class CommandCluster : public Commander {
   std::string subcommand_;
   std::vector<SlotRange> slot_ranges_;
   ImportStatus state_ = kImportNone;
+  int slot_stats_start_ = 0;
+  int slot_stats_end_ = 0;
+  std::string slot_stats_order_by_;
+  int slot_stats_limit_ = kClusterSlots;
+  bool slot_stats_desc_ = true;
+  int slot_ = 0;
+  int64_t keys_count_ = 0;
 };
 
 class CommandClusterX : public Commander {
@@ -284,19 +389,22 @@ class CommandClusterX : public Commander {
     } else if (subcommand_ == "myid") {
       *output = redis::BulkString(srv->cluster->GetMyId());
     } else if (subcommand_ == "migrate") {
+      if (sync_migrate_ && slot_ranges_.size() > 1) {
+        return {Status::RedisExecErr, "Sync migration only supports one slot range"};
+      }
       if (sync_migrate_) {
         sync_migrate_ctx_ = std::make_unique<SyncMigrateContext>(srv, conn, sync_migrate_timeout_);
       }
-      // TODO: support multiple slot ranges
-      Status s = srv->cluster->MigrateSlotRange(slot_ranges_[0], dst_node_id_, sync_migrate_ctx_.get());
-      if (s.IsOK()) {
-        if (sync_migrate_) {
-          return {Status::BlockingCmd};
-        }
-        *output = redis::SimpleString("OK");
-      } else {
-        return s;
+      // the slot ranges are migrated concurrently as far as migrate-concurrency allows,
+      // the ones started before an error keep migrating
+      for (const auto &slot_range : slot_ranges_) {
+        Status s = srv->cluster->MigrateSlotRange(slot_range, dst_node_id_, sync_migrate_ctx_.get());
+        if (!s.IsOK()) return s;
+      }
+      if (sync_migrate_) {
+        return {Status::BlockingCmd};
       }
+      *output = redis::SimpleString("OK");
     } else {
       return {Status::RedisExecErr, "Invalid cluster command options"};
     }
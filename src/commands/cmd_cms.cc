@@ -0,0 +1,188 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "command_parser.h"
+#include "commander.h"
+#include "error_constants.h"
+#include "server/server.h"
+#include "types/redis_cms.h"
+
+namespace {
+
+constexpr const char *errBadWidth = "CMS: invalid width";
+constexpr const char *errBadDepth = "CMS: invalid depth";
+constexpr const char *errBadErrorRate = "CMS: invalid overestimation value";
+constexpr const char *errBadProbability = "CMS: invalid prob value";
+constexpr const char *errBadIncrement = "CMS: Cannot parse number";
+constexpr const char *errKeyNotFound = "CMS: key does not exist";
+}  // namespace
+
+namespace redis {
+
+class CommandCMSInitByDim : public Commander {
+ public:
+  Status Parse(const std::vector<std::string> &args) override {
+    auto parse_width = ParseInt<uint32_t>(args[2], NumericRange<uint32_t>{1, UINT32_MAX}, 10);
+    if (!parse_width) return {Status::RedisParseErr, errBadWidth};
+    width_ = *parse_width;
+
+    auto parse_depth = ParseInt<uint32_t>(args[3], NumericRange<uint32_t>{1, UINT32_MAX}, 10);
+    if (!parse_depth) return {Status::RedisParseErr, errBadDepth};
+    depth_ = *parse_depth;
+
+    return Commander::Parse(args);
+  }
+
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    redis::CountMinSketch cms_db(srv->storage, conn->GetNamespace());
+    engine::Context ctx(srv->storage);
+    auto s = cms_db.InitByDim(ctx, args_[1], width_, depth_);
+    if (!s.ok()) return {Status::RedisExecErr, s.ToString()};
+
+    *output = redis::SimpleString("OK");
+    return Status::OK();
+  }
+
+ private:
+  uint32_t width_ = 0;
+  uint32_t depth_ = 0;
+};
+
+class CommandCMSInitByProb : public Commander {
+ public:
+  Status Parse(const std::vector<std::string> &args) override {
+    auto parse_error_rate = ParseFloat<double>(args[2]);
+    if (!parse_error_rate || *parse_error_rate <= 0 || *parse_error_rate >= 1) {
+      return {Status::RedisParseErr, errBadErrorRate};
+    }
+    auto parse_probability = ParseFloat<double>(args[3]);
+    if (!parse_probability || *parse_probability <= 0 || *parse_probability >= 1) {
+      return {Status::RedisParseErr, errBadProbability};
+    }
+    auto s = CountMinSketch::DimensionsByProb(*parse_error_rate, *parse_probability, &width_, &depth_);
+    if (!s.ok()) return {Status::RedisParseErr, s.ToString()};
+
+    return Commander::Parse(args);
+  }
+
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    redis::CountMinSketch cms_db(srv->storage, conn->GetNamespace());
+    engine::Context ctx(srv->storage);
+    auto s = cms_db.InitByDim(ctx, args_[1], width_, depth_);
+    if (!s.ok()) return {Status::RedisExecErr, s.ToString()};
+
+    *output = redis::SimpleString("OK");
+    return Status::OK();
+  }
+
+ private:
+  uint32_t width_ = 0;
+  uint32_t depth_ = 0;
+};
+
+class CommandCMSIncrBy : public Commander {
+ public:
+  Status Parse(const std::vector<std::string> &args) override {
+    if (args.size() % 2 != 0) return {Status::RedisParseErr, errWrongNumOfArguments};
+
+    increments_.reserve((args.size() - 2) / 2);
+    for (size_t i = 2; i < args.size(); i += 2) {
+      auto parse_increment = ParseInt<uint32_t>(args[i + 1], NumericRange<uint32_t>{1, UINT32_MAX}, 10);
+      if (!parse_increment) return {Status::RedisParseErr, errBadIncrement};
+      increments_.emplace_back(args[i], *parse_increment);
+    }
+    return Commander::Parse(args);
+  }
+
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    redis::CountMinSketch cms_db(srv->storage, conn->GetNamespace());
+    std::vector<uint32_t> counts;
+    engine::Context ctx(srv->storage);
+    auto s = cms_db.IncrBy(ctx, args_[1], increments_, &counts);
+    if (s.IsNotFound()) return {Status::RedisExecErr, errKeyNotFound};
+    if (!s.ok()) return {Status::RedisExecErr, s.ToString()};
+
+    *output = redis::MultiLen(counts.size());
+    for (uint32_t count : counts) {
+      *output += redis::Integer(count);
+    }
+    return Status::OK();
+  }
+
+ private:
+  std::vector<std::pair<std::string, uint32_t>> increments_;
+};
+
+class CommandCMSQuery : public Commander {
+ public:
+  Status Parse(const std::vector<std::string> &args) override {
+    items_.reserve(args.size() - 2);
+    for (size_t i = 2; i < args.size(); ++i) {
+      items_.emplace_back(args[i]);
+    }
+    return Commander::Parse(args);
+  }
+
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    redis::CountMinSketch cms_db(srv->storage, conn->GetNamespace());
+    std::vector<uint32_t> counts;
+    engine::Context ctx(srv->storage);
+    auto s = cms_db.Query(ctx, args_[1], items_, &counts);
+    if (s.IsNotFound()) return {Status::RedisExecErr, errKeyNotFound};
+    if (!s.ok()) return {Status::RedisExecErr, s.ToString()};
+
+    *output = redis::MultiLen(counts.size());
+    for (uint32_t count : counts) {
+      *output += redis::Integer(count);
+    }
+    return Status::OK();
+  }
+
+ private:
+  std::vector<std::string> items_;
+};
+
+class CommandCMSInfo : public Commander {
+ public:
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    redis::CountMinSketch cms_db(srv->storage, conn->GetNamespace());
+    CMSInfo info;
+    engine::Context ctx(srv->storage);
+    auto s = cms_db.Info(ctx, args_[1], &info);
+    if (s.IsNotFound()) return {Status::RedisExecErr, errKeyNotFound};
+    if (!s.ok()) return {Status::RedisExecErr, s.ToString()};
+
+    *output = redis::MultiLen(2 * 3);
+    *output += redis::SimpleString("width");
+    *output += redis::Integer(info.width);
+    *output += redis::SimpleString("depth");
+    *output += redis::Integer(info.depth);
+    *output += redis::SimpleString("count");
+    *output += redis::Integer(info.count);
+    return Status::OK();
+  }
+};
+
+REDIS_REGISTER_COMMANDS(CountMinSketch, MakeCmdAttr<CommandCMSInitByDim>("cms.initbydim", 4, "write", 1, 1, 1),
+                        MakeCmdAttr<CommandCMSInitByProb>("cms.initbyprob", 4, "write", 1, 1, 1),
+                        MakeCmdAttr<CommandCMSIncrBy>("cms.incrby", -4, "write", 1, 1, 1),
+                        MakeCmdAttr<CommandCMSQuery>("cms.query", -3, "read-only", 1, 1, 1),
+                        MakeCmdAttr<CommandCMSInfo>("cms.info", 2, "read-only", 1, 1, 1), )
+}  // namespace redis
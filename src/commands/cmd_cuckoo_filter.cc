@@ -0,0 +1,243 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "command_parser.h"
+#include "commander.h"
+#include "error_constants.h"
+#include "server/server.h"
+#include "types/redis_cuckoo_filter.h"
+
+namespace {
+
+constexpr const char *errBadCapacity = "Bad capacity";
+constexpr const char *errBadBucketSize = "Bad bucket size";
+constexpr const char *errBadMaxIterations = "Bad max iterations";
+constexpr const char *errBadExpansion = "Bad expansion";
+constexpr const char *errCapacityTooSmall = "Capacity must be at least (BucketSize * 2)";
+constexpr const char *errFilterFull = "Filter is full";
+constexpr const char *errNotFound = "Not found";
+}  // namespace
+
+namespace redis {
+
+class CommandCFReserve : public Commander {
+ public:
+  Status Parse(const std::vector<std::string> &args) override {
+    auto parse_capacity = ParseInt<uint32_t>(args[2], 10);
+    if (!parse_capacity || *parse_capacity == 0) {
+      return {Status::RedisParseErr, errBadCapacity};
+    }
+    options_.capacity = *parse_capacity;
+
+    CommandParser parser(args, 3);
+    while (parser.Good()) {
+      if (parser.EatEqICase("bucketsize")) {
+        auto parse_bucket_size = parser.TakeInt<uint16_t>(NumericRange<uint16_t>{1, UINT8_MAX});
+        if (!parse_bucket_size.IsOK()) {
+          return {Status::RedisParseErr, errBadBucketSize};
+        }
+        options_.bucket_size = static_cast<uint8_t>(parse_bucket_size.GetValue());
+      } else if (parser.EatEqICase("maxiterations")) {
+        auto parse_max_iterations = parser.TakeInt<uint16_t>(NumericRange<uint16_t>{1, UINT16_MAX});
+        if (!parse_max_iterations.IsOK()) {
+          return {Status::RedisParseErr, errBadMaxIterations};
+        }
+        options_.max_iterations = parse_max_iterations.GetValue();
+      } else if (parser.EatEqICase("expansion")) {
+        auto parse_expansion = parser.TakeInt<uint16_t>(NumericRange<uint16_t>{0, kCFMaxExpansion});
+        if (!parse_expansion.IsOK()) {
+          return {Status::RedisParseErr, errBadExpansion};
+        }
+        options_.expansion = parse_expansion.GetValue();
+      } else {
+        return {Status::RedisParseErr, errInvalidSyntax};
+      }
+    }
+
+    if (options_.capacity < static_cast<uint32_t>(options_.bucket_size) * 2) {
+      return {Status::RedisParseErr, errCapacityTooSmall};
+    }
+
+    return Commander::Parse(args);
+  }
+
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    redis::CuckooFilter cuckoo_db(srv->storage, conn->GetNamespace());
+    engine::Context ctx(srv->storage);
+    auto s = cuckoo_db.Reserve(ctx, args_[1], options_);
+    if (!s.ok()) return {Status::RedisExecErr, s.ToString()};
+
+    *output = redis::SimpleString("OK");
+    return Status::OK();
+  }
+
+ private:
+  CuckooFilterReserveOptions options_;
+};
+
+class CommandCFAddItem : public Commander {
+ public:
+  explicit CommandCFAddItem(bool no_exist) : no_exist_(no_exist) {}
+
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    redis::CuckooFilter cuckoo_db(srv->storage, conn->GetNamespace());
+    CuckooFilterAddResult ret = CuckooFilterAddResult::kOk;
+    engine::Context ctx(srv->storage);
+    auto s = cuckoo_db.Add(ctx, args_[1], args_[2], no_exist_, &ret);
+    if (!s.ok()) return {Status::RedisExecErr, s.ToString()};
+
+    switch (ret) {
+      case CuckooFilterAddResult::kOk:
+        *output = redis::Integer(1);
+        break;
+      case CuckooFilterAddResult::kExist:
+        *output = redis::Integer(0);
+        break;
+      case CuckooFilterAddResult::kFull:
+        return {Status::RedisExecErr, errFilterFull};
+    }
+    return Status::OK();
+  }
+
+ private:
+  bool no_exist_;
+};
+
+class CommandCFAdd : public CommandCFAddItem {
+ public:
+  CommandCFAdd() : CommandCFAddItem(false) {}
+};
+
+class CommandCFAddNX : public CommandCFAddItem {
+ public:
+  CommandCFAddNX() : CommandCFAddItem(true) {}
+};
+
+class CommandCFDel : public Commander {
+ public:
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    redis::CuckooFilter cuckoo_db(srv->storage, conn->GetNamespace());
+    bool deleted = false;
+    engine::Context ctx(srv->storage);
+    auto s = cuckoo_db.Remove(ctx, args_[1], args_[2], &deleted);
+    if (s.IsNotFound()) return {Status::RedisExecErr, errNotFound};
+    if (!s.ok()) return {Status::RedisExecErr, s.ToString()};
+
+    *output = redis::Integer(deleted ? 1 : 0);
+    return Status::OK();
+  }
+};
+
+class CommandCFExists : public Commander {
+ public:
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    redis::CuckooFilter cuckoo_db(srv->storage, conn->GetNamespace());
+    bool exist = false;
+    engine::Context ctx(srv->storage);
+    auto s = cuckoo_db.Exists(ctx, args_[1], args_[2], &exist);
+    if (!s.ok()) return {Status::RedisExecErr, s.ToString()};
+
+    *output = redis::Integer(exist ? 1 : 0);
+    return Status::OK();
+  }
+};
+
+class CommandCFMExists : public Commander {
+ public:
+  Status Parse(const std::vector<std::string> &args) override {
+    items_.reserve(args.size() - 2);
+    for (size_t i = 2; i < args.size(); ++i) {
+      items_.emplace_back(args[i]);
+    }
+    return Commander::Parse(args);
+  }
+
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    redis::CuckooFilter cuckoo_db(srv->storage, conn->GetNamespace());
+    std::vector<bool> exists(items_.size(), false);
+    engine::Context ctx(srv->storage);
+    auto s = cuckoo_db.MExists(ctx, args_[1], items_, &exists);
+    if (!s.ok()) return {Status::RedisExecErr, s.ToString()};
+
+    *output = redis::MultiLen(items_.size());
+    for (size_t i = 0; i < items_.size(); ++i) {
+      *output += Integer(exists[i] ? 1 : 0);
+    }
+    return Status::OK();
+  }
+
+ private:
+  std::vector<std::string> items_;
+};
+
+class CommandCFCount : public Commander {
+ public:
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    redis::CuckooFilter cuckoo_db(srv->storage, conn->GetNamespace());
+    uint64_t count = 0;
+    engine::Context ctx(srv->storage);
+    auto s = cuckoo_db.Count(ctx, args_[1], args_[2], &count);
+    if (!s.ok()) return {Status::RedisExecErr, s.ToString()};
+
+    *output = redis::Integer(count);
+    return Status::OK();
+  }
+};
+
+class CommandCFInfo : public Commander {
+ public:
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    redis::CuckooFilter cuckoo_db(srv->storage, conn->GetNamespace());
+    CuckooFilterInfo info;
+    engine::Context ctx(srv->storage);
+    auto s = cuckoo_db.Info(ctx, args_[1], &info);
+    if (s.IsNotFound()) return {Status::RedisExecErr, errNotFound};
+    if (!s.ok()) return {Status::RedisExecErr, s.ToString()};
+
+    *output = redis::MultiLen(2 * 8);
+    *output += redis::SimpleString("Size");
+    *output += redis::Integer(info.bytes);
+    *output += redis::SimpleString("Number of buckets");
+    *output += redis::Integer(info.num_buckets);
+    *output += redis::SimpleString("Number of filters");
+    *output += redis::Integer(info.n_filters);
+    *output += redis::SimpleString("Number of items inserted");
+    *output += redis::Integer(info.num_items);
+    *output += redis::SimpleString("Number of items deleted");
+    *output += redis::Integer(info.num_deletes);
+    *output += redis::SimpleString("Bucket size");
+    *output += redis::Integer(info.bucket_size);
+    *output += redis::SimpleString("Expansion rate");
+    *output += redis::Integer(info.expansion);
+    *output += redis::SimpleString("Max iterations");
+    *output += redis::Integer(info.max_iterations);
+    return Status::OK();
+  }
+};
+
+REDIS_REGISTER_COMMANDS(CuckooFilter, MakeCmdAttr<CommandCFReserve>("cf.reserve", -3, "write", 1, 1, 1),
+                        MakeCmdAttr<CommandCFAdd>("cf.add", 3, "write", 1, 1, 1),
+                        MakeCmdAttr<CommandCFAddNX>("cf.addnx", 3, "write", 1, 1, 1),
+                        MakeCmdAttr<CommandCFDel>("cf.del", 3, "write", 1, 1, 1),
+                        MakeCmdAttr<CommandCFExists>("cf.exists", 3, "read-only", 1, 1, 1),
+                        MakeCmdAttr<CommandCFMExists>("cf.mexists", -3, "read-only", 1, 1, 1),
+                        MakeCmdAttr<CommandCFCount>("cf.count", 3, "read-only", 1, 1, 1),
+                        MakeCmdAttr<CommandCFInfo>("cf.info", 2, "read-only", 1, 1, 1), )
+}  // namespace redis
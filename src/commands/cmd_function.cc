@@ -110,7 +110,7 @@ uint64_t GenerateFunctionFlags(uint64_t flags, const std::vector<std::string> &a
 
 REDIS_REGISTER_COMMANDS(
     Function, MakeCmdAttr<CommandFunction>("function", -2, "exclusive no-script", 0, 0, 0, GenerateFunctionFlags),
-    MakeCmdAttr<CommandFCall<>>("fcall", -3, "exclusive write no-script", GetScriptEvalKeyRange),
-    MakeCmdAttr<CommandFCall<true>>("fcall_ro", -3, "read-only ro-script no-script", GetScriptEvalKeyRange));
+    MakeCmdAttr<CommandFCall<>>("fcall", -3, "exclusive write script no-script", GetScriptEvalKeyRange),
+    MakeCmdAttr<CommandFCall<true>>("fcall_ro", -3, "read-only script ro-script no-script", GetScriptEvalKeyRange));
 
 }  // namespace redis
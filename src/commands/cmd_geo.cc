@@ -307,16 +307,17 @@ class CommandGeoRadius : public CommandGeoBase {
 
   Status Execute(Server *srv, Connection *conn, std::string *output) override {
     std::vector<GeoPoint> geo_points;
+    uint64_t stored_cnt = 0;
     redis::Geo geo_db(srv->storage, conn->GetNamespace());
     engine::Context ctx(srv->storage);
     auto s = geo_db.Radius(ctx, args_[1], longitude_, latitude_, GetRadiusMeters(radius_), count_, sort_, store_key_,
-                           store_distance_, GetUnitConversion(), &geo_points);
+                           store_distance_, GetUnitConversion(), &geo_points, &stored_cnt);
     if (!s.ok()) {
       return {Status::RedisExecErr, s.ToString()};
     }
 
     if (store_key_.size() != 0) {
-      *output = redis::Integer(geo_points.size());
+      *output = redis::Integer(stored_cnt);
     } else {
       *output = GenerateOutput(conn, geo_points);
     }
@@ -618,16 +619,17 @@ class CommandGeoSearchStore : public CommandGeoSearch {
 
   Status Execute(Server *srv, Connection *conn, std::string *output) override {
     std::vector<GeoPoint> geo_points;
+    uint64_t stored_cnt = 0;
     redis::Geo geo_db(srv->storage, conn->GetNamespace());
 
     engine::Context ctx(srv->storage);
     auto s = geo_db.SearchStore(ctx, args_[2], geo_shape_, origin_point_type_, member_, count_, sort_, store_key_,
-                                store_distance_, GetUnitConversion(), &geo_points);
+                                store_distance_, GetUnitConversion(), &geo_points, &stored_cnt);
 
     if (!s.ok()) {
       return {Status::RedisExecErr, s.ToString()};
     }
-    *output = redis::Integer(geo_points.size());
+    *output = redis::Integer(stored_cnt);
     return Status::OK();
   }
 
@@ -662,16 +664,17 @@ class CommandGeoRadiusByMember : public CommandGeoRadius {
 
   Status Execute(Server *srv, Connection *conn, std::string *output) override {
     std::vector<GeoPoint> geo_points;
+    uint64_t stored_cnt = 0;
     redis::Geo geo_db(srv->storage, conn->GetNamespace());
     engine::Context ctx(srv->storage);
     auto s = geo_db.RadiusByMember(ctx, args_[1], args_[2], GetRadiusMeters(radius_), count_, sort_, store_key_,
-                                   store_distance_, GetUnitConversion(), &geo_points);
+                                   store_distance_, GetUnitConversion(), &geo_points, &stored_cnt);
     if (!s.ok()) {
       return {Status::RedisExecErr, s.ToString()};
     }
 
     if (store_key_.size() != 0) {
-      *output = redis::Integer(geo_points.size());
+      *output = redis::Integer(stored_cnt);
     } else {
       *output = GenerateOutput(conn, geo_points);
     }
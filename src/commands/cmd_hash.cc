@@ -18,11 +18,16 @@
  *
  */
 
+#include <algorithm>
+#include <limits>
+
 #include "commander.h"
 #include "commands/command_parser.h"
+#include "commands/streaming_commander.h"
 #include "error_constants.h"
 #include "scan_base.h"
 #include "server/server.h"
+#include "time_util.h"
 #include "types/redis_hash.h"
 
 namespace redis {
@@ -215,11 +220,14 @@ class CommandHMGet : public Commander {
       return {Status::RedisExecErr, s.ToString()};
     }
 
-    if (s.IsNotFound()) {
-      values.resize(fields.size(), "");
-      *output = conn->MultiBulkString(values);
-    } else {
-      *output = conn->MultiBulkString(values, statuses);
+    auto writer = conn->Writer(output);
+    writer.ArrayHeader(fields.size());
+    for (size_t i = 0; i < fields.size(); i++) {
+      if (s.IsNotFound() || (i < statuses.size() && !statuses[i].ok())) {
+        writer.NilString();
+      } else {
+        writer.BulkString(values[i]);
+      }
     }
     return Status::OK();
   }
@@ -269,12 +277,15 @@ class CommandHKeys : public Commander {
       return {Status::RedisExecErr, s.ToString()};
     }
 
-    std::vector<std::string> keys;
-    keys.reserve(field_values.size());
+    auto writer = conn->Writer(output);
+    writer.ArrayHeader(field_values.size());
     for (const auto &fv : field_values) {
-      keys.emplace_back(fv.field);
+      if (fv.field.empty()) {
+        writer.NilString();
+      } else {
+        writer.BulkString(fv.field);
+      }
     }
-    *output = conn->MultiBulkString(keys);
 
     return Status::OK();
   }
@@ -291,38 +302,80 @@ class CommandHVals : public Commander {
       return {Status::RedisExecErr, s.ToString()};
     }
 
-    std::vector<std::string> values;
-    values.reserve(field_values.size());
+    auto writer = conn->Writer(output);
+    size_t reserve_size = 0;
+    for (const auto &p : field_values) reserve_size += ReplyWriter::BulkStringSize(p.value.size());
+    writer.Reserve(reserve_size);
+    writer.ArrayHeader(field_values.size());
     for (const auto &p : field_values) {
-      values.emplace_back(p.value);
+      writer.BulkString(p.value);
     }
-    *output = ArrayOfBulkStrings(values);
 
     return Status::OK();
   }
 };
 
-class CommandHGetAll : public Commander {
+class CommandHGetAll : public StreamingCommander {
  public:
   Status Execute(Server *srv, Connection *conn, std::string *output) override {
     redis::Hash hash_db(srv->storage, conn->GetNamespace());
+    ctx_ = std::make_unique<engine::Context>(srv->storage);
+    uint64_t size = 0, expiring_fields = 0;
+    auto s = hash_db.Size(*ctx_, args_[1], &size, &expiring_fields);
+    if (!s.ok() && !s.IsNotFound()) {
+      return {Status::RedisExecErr, s.ToString()};
+    }
+    // The size counts the expired fields not reaped yet, so a hash with expiring fields isn't streamed
+    if (expiring_fields == 0 && ShouldStream(srv, conn, size)) {
+      ns_ = conn->GetNamespace();
+      left_ = size;
+      *output = conn->HeaderOfMap(size);
+      return StartStreaming(conn);
+    }
+
     std::vector<FieldValue> field_values;
-    engine::Context ctx(srv->storage);
-    auto s = hash_db.GetAll(ctx, args_[1], &field_values);
+    s = hash_db.GetAll(*ctx_, args_[1], &field_values);
     if (!s.ok()) {
       return {Status::RedisExecErr, s.ToString()};
     }
 
-    std::vector<std::string> kv_pairs;
-    kv_pairs.reserve(field_values.size());
+    auto writer = conn->Writer(output);
+    size_t reserve_size = 0;
     for (const auto &p : field_values) {
-      kv_pairs.emplace_back(p.field);
-      kv_pairs.emplace_back(p.value);
+      reserve_size += ReplyWriter::BulkStringSize(p.field.size()) + ReplyWriter::BulkStringSize(p.value.size());
+    }
+    writer.Reserve(reserve_size);
+    writer.MapHeader(field_values.size());
+    for (const auto &p : field_values) {
+      writer.BulkString(p.field);
+      writer.BulkString(p.value);
     }
-    *output = conn->MapOfBulkStrings(kv_pairs);
 
     return Status::OK();
   }
+
+  StatusOr<bool> OnStreamingWrite(std::string *output) override {
+    redis::Hash hash_db(ctx_->storage, ns_);
+    std::vector<std::string> fields, values;
+    auto s = hash_db.Scan(*ctx_, args_[1], cursor_, std::min<uint64_t>(left_, kBatchSize), "", &fields, &values);
+    if (!s.ok()) return {Status::RedisExecErr, s.ToString()};
+    // The fields are counted in the header, so the snapshot must have as many of them
+    if (fields.empty()) return {Status::NotOK, "the hash has less fields than its size"};
+
+    auto writer = conn_->Writer(output);
+    for (size_t i = 0; i < fields.size(); i++) {
+      writer.BulkString(fields[i]);
+      writer.BulkString(values[i]);
+    }
+    cursor_ = std::move(fields.back());
+    left_ -= fields.size();
+    return left_ == 0;
+  }
+
+ private:
+  std::string ns_;
+  std::string cursor_;
+  uint64_t left_ = 0;
 };
 
 class CommandHRangeByLex : public Commander {
@@ -377,12 +430,14 @@ class CommandHScan : public CommandSubkeyScanBase {
     std::vector<std::string> values;
     auto key_name = srv->GetKeyNameFromCursor(cursor_, CursorType::kTypeHash);
     engine::Context ctx(srv->storage);
-    auto s = hash_db.Scan(ctx, key_, key_name, limit_, prefix_, &fields, &values);
+    std::string end_cursor;
+    auto s = hash_db.Scan(ctx, key_, key_name, limit_, prefix_, &fields, &values, pattern_, TimeBudgetUS(srv),
+                          &end_cursor);
     if (!s.ok() && !s.IsNotFound()) {
       return {Status::RedisExecErr, s.ToString()};
     }
 
-    auto cursor = GetNextCursor(srv, fields, CursorType::kTypeHash);
+    auto cursor = GetNextCursor(srv, end_cursor, CursorType::kTypeHash);
     std::vector<std::string> entries;
     entries.reserve(2 * fields.size());
     for (size_t i = 0; i < fields.size(); i++) {
@@ -445,6 +500,133 @@ class CommandHRandField : public Commander {
   bool no_parameters_ = true;
 };
 
+// CommandHashFieldsBase parses the `FIELDS numfields field [field ...]` of the hash field expiration commands
+class CommandHashFieldsBase : public Commander {
+ protected:
+  Status parseFields(const std::vector<std::string> &args, size_t pos) {
+    if (args.size() < pos + 3 || !util::EqualICase(args[pos], "fields")) {
+      return {Status::RedisParseErr, errInvalidSyntax};
+    }
+    auto numfields = GET_OR_RET(ParseInt<uint64_t>(args[pos + 1], 10));
+    if (numfields == 0) {
+      return {Status::RedisParseErr, "Parameter `numFields` should be greater than 0"};
+    }
+    if (numfields != args.size() - pos - 2) {
+      return {Status::RedisParseErr, "The `numfields` parameter must match the number of arguments"};
+    }
+    fields_.assign(args.begin() + static_cast<ptrdiff_t>(pos) + 2, args.end());
+    return Status::OK();
+  }
+
+  std::vector<Slice> fields() const { return std::vector<Slice>(fields_.begin(), fields_.end()); }
+
+  static void writeResults(Connection *conn, const std::vector<int64_t> &results, std::string *output) {
+    auto writer = conn->Writer(output);
+    writer.ArrayHeader(results.size());
+    for (auto result : results) writer.Integer(result);
+  }
+
+ private:
+  std::vector<std::string> fields_;
+};
+
+// HEXPIRE, HPEXPIRE, HEXPIREAT and HPEXPIREAT key time [NX | XX | GT | LT] FIELDS numfields field [field ...]
+template <bool Milliseconds, bool Absolute>
+class CommandHExpire : public CommandHashFieldsBase {
+ public:
+  Status Parse(const std::vector<std::string> &args) override {
+    time_ = GET_OR_RET(ParseInt<int64_t>(args[2], 10));
+    if (time_ < 0 || (!Milliseconds && time_ > std::numeric_limits<int64_t>::max() / 1000)) {
+      return {Status::RedisParseErr, "invalid expire time"};
+    }
+
+    size_t pos = 3;
+    if (util::EqualICase(args[pos], "nx")) {
+      condition_ = Hash::FieldExpireCondition::kNX;
+    } else if (util::EqualICase(args[pos], "xx")) {
+      condition_ = Hash::FieldExpireCondition::kXX;
+    } else if (util::EqualICase(args[pos], "gt")) {
+      condition_ = Hash::FieldExpireCondition::kGT;
+    } else if (util::EqualICase(args[pos], "lt")) {
+      condition_ = Hash::FieldExpireCondition::kLT;
+    }
+    if (condition_ != Hash::FieldExpireCondition::kNone) pos++;
+    return parseFields(args, pos);
+  }
+
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    auto expire = static_cast<uint64_t>(Milliseconds ? time_ : time_ * 1000);
+    if (!Absolute) {
+      auto now = util::GetTimeStampMS();
+      if (expire > static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) - now) {
+        return {Status::RedisExecErr, "invalid expire time"};
+      }
+      expire += now;
+    }
+    // a time of 0 has passed as well, but an expire time of 0 means none
+    expire = std::max<uint64_t>(expire, 1);
+
+    redis::Hash hash_db(srv->storage, conn->GetNamespace());
+    std::vector<int64_t> results;
+    engine::Context ctx(srv->storage);
+    auto s = hash_db.ExpireFields(ctx, args_[1], expire, condition_, fields(), &results);
+    if (!s.ok()) {
+      return {Status::RedisExecErr, s.ToString()};
+    }
+
+    writeResults(conn, results, output);
+    return Status::OK();
+  }
+
+ private:
+  int64_t time_ = 0;
+  Hash::FieldExpireCondition condition_ = Hash::FieldExpireCondition::kNone;
+};
+
+// HTTL, HPTTL, HEXPIRETIME and HPEXPIRETIME key FIELDS numfields field [field ...]
+template <bool Milliseconds, bool Absolute>
+class CommandHTTL : public CommandHashFieldsBase {
+ public:
+  Status Parse(const std::vector<std::string> &args) override { return parseFields(args, 2); }
+
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    redis::Hash hash_db(srv->storage, conn->GetNamespace());
+    std::vector<int64_t> results;
+    engine::Context ctx(srv->storage);
+    auto s = hash_db.FieldsExpireTime(ctx, args_[1], fields(), &results);
+    if (!s.ok()) {
+      return {Status::RedisExecErr, s.ToString()};
+    }
+
+    auto now = static_cast<int64_t>(util::GetTimeStampMS());
+    for (auto &result : results) {
+      if (result < 0) continue;
+      if (!Absolute) result = std::max<int64_t>(result - now, 0);
+      if (!Milliseconds) result /= 1000;
+    }
+    writeResults(conn, results, output);
+    return Status::OK();
+  }
+};
+
+class CommandHPersist : public CommandHashFieldsBase {
+ public:
+  Status Parse(const std::vector<std::string> &args) override { return parseFields(args, 2); }
+
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    redis::Hash hash_db(srv->storage, conn->GetNamespace());
+    std::vector<int64_t> results;
+    engine::Context ctx(srv->storage);
+    auto s = hash_db.PersistFields(ctx, args_[1], fields(), &results);
+    if (!s.ok()) {
+      return {Status::RedisExecErr, s.ToString()};
+    }
+
+    writeResults(conn, results, output);
+    return Status::OK();
+  }
+};
+
 REDIS_REGISTER_COMMANDS(Hash, MakeCmdAttr<CommandHGet>("hget", 3, "read-only", 1, 1, 1),
                         MakeCmdAttr<CommandHIncrBy>("hincrby", 4, "write", 1, 1, 1),
                         MakeCmdAttr<CommandHIncrByFloat>("hincrbyfloat", 4, "write", 1, 1, 1),
@@ -461,6 +643,15 @@ REDIS_REGISTER_COMMANDS(Hash, MakeCmdAttr<CommandHGet>("hget", 3, "read-only", 1
                         MakeCmdAttr<CommandHGetAll>("hgetall", 2, "read-only slow", 1, 1, 1),
                         MakeCmdAttr<CommandHScan>("hscan", -3, "read-only", 1, 1, 1),
                         MakeCmdAttr<CommandHRangeByLex>("hrangebylex", -4, "read-only", 1, 1, 1),
-                        MakeCmdAttr<CommandHRandField>("hrandfield", -2, "read-only slow", 1, 1, 1), )
+                        MakeCmdAttr<CommandHRandField>("hrandfield", -2, "read-only slow", 1, 1, 1),
+                        MakeCmdAttr<CommandHExpire<false, false>>("hexpire", -6, "write", 1, 1, 1),
+                        MakeCmdAttr<CommandHExpire<true, false>>("hpexpire", -6, "write", 1, 1, 1),
+                        MakeCmdAttr<CommandHExpire<false, true>>("hexpireat", -6, "write", 1, 1, 1),
+                        MakeCmdAttr<CommandHExpire<true, true>>("hpexpireat", -6, "write", 1, 1, 1),
+                        MakeCmdAttr<CommandHTTL<false, false>>("httl", -5, "read-only", 1, 1, 1),
+                        MakeCmdAttr<CommandHTTL<true, false>>("hpttl", -5, "read-only", 1, 1, 1),
+                        MakeCmdAttr<CommandHTTL<false, true>>("hexpiretime", -5, "read-only", 1, 1, 1),
+                        MakeCmdAttr<CommandHTTL<true, true>>("hpexpiretime", -5, "read-only", 1, 1, 1),
+                        MakeCmdAttr<CommandHPersist>("hpersist", -5, "write", 1, 1, 1), )
 
 }  // namespace redis
@@ -67,7 +67,8 @@ class CommandPfCount final : public Commander {
       std::vector<Slice> keys(args_.begin() + 1, args_.end());
       s = hll.CountMultiple(ctx, keys, &ret);
     } else {
-      s = hll.Count(ctx, args_[1], &ret);
+      // The replicas can't write the cached cardinality, which would diverge from their master
+      s = hll.Count(ctx, args_[1], &ret, /*cache_result=*/!srv->IsSlave());
     }
     if (!s.ok() && !s.IsNotFound()) {
       return {Status::RedisExecErr, s.ToString()};
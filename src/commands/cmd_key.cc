@@ -348,12 +348,26 @@ class CommandDel : public Commander {
     uint64_t cnt = 0;
     redis::Database redis(srv->storage, conn->GetNamespace());
     engine::Context ctx(srv->storage);
-    auto s = redis.MDel(ctx, keys, &cnt);
+    auto s = redis.MDel(ctx, keys, &cnt, attributes_->name == "unlink");
     if (!s.ok()) return {Status::RedisExecErr, s.ToString()};
+    if (srv->storage->GetLazyFreeQueue()->GetPendingKeys() > 0) srv->ScheduleLazyFree();
 
     *output = redis::Integer(cnt);
     return Status::OK();
   }
+
+  uint64_t EstimateCost(Server *srv, Connection *conn) override {
+    uint64_t cost = 0;
+    redis::Database redis(srv->storage, conn->GetNamespace());
+    engine::Context ctx(srv->storage);
+    for (size_t i = 1; i < args_.size(); i++) {
+      Metadata metadata(kRedisNone, false);
+      auto s = redis.GetMetadata(ctx, RedisTypes::All(), redis.AppendNamespacePrefix(args_[i]), &metadata);
+      if (!s.ok()) continue;
+      cost += metadata.IsSingleKVType() ? 1 : metadata.size;
+    }
+    return cost;
+  }
 };
 
 class CommandRename : public Commander {
@@ -549,6 +563,45 @@ class CommandSort : public Commander {
     return Status::OK();
   }
 
+  // The keys of the BY and GET patterns are looked up for every element, see Database::Sort
+  uint64_t EstimateCost(Server *srv, Connection *conn) override {
+    redis::Database redis(srv->storage, conn->GetNamespace());
+    engine::Context ctx(srv->storage);
+    Metadata metadata(kRedisNone, false);
+    auto s = redis.GetMetadata(ctx, {kRedisList, kRedisSet, kRedisZSet}, redis.AppendNamespacePrefix(args_[1]),
+                               &metadata);
+    if (!s.ok() || metadata.size > SORT_LENGTH_LIMIT) return 0;
+
+    uint64_t lookups = 0;
+    if (!sort_argument_.dontsort && !sort_argument_.sortby.empty()) lookups++;
+    for (const auto &pattern : sort_argument_.getpatterns) {
+      if (pattern != "#") lookups++;
+    }
+    return metadata.size * (lookups + 1);
+  }
+
+  // The STORE destination is a key of the command too: EXEC locks it up front, so the list writes of SORT
+  // find its stripe pinned and don't lock it again while the other stripes are held
+  static std::vector<CommandKeyRange> Range(const std::vector<std::string> &args) {
+    int store_key = 0;
+    for (size_t i = 2; i < args.size(); i++) {
+      auto arg = util::ToLower(args[i]);
+      if (arg == "by" || arg == "get") {
+        i++;
+      } else if (arg == "limit") {
+        i += 2;
+      } else if (arg == "store" && i + 1 < args.size()) {
+        store_key = static_cast<int>(i) + 1;
+        i++;
+      }
+    }
+
+    if (store_key > 0) {
+      return {{1, 1, 1}, {store_key, store_key, 1}};
+    }
+    return {{1, 1, 1}};
+  }
+
  private:
   SortArgument sort_argument_;
 };
@@ -572,7 +625,7 @@ REDIS_REGISTER_COMMANDS(Key, MakeCmdAttr<CommandTTL>("ttl", 2, "read-only", 1, 1
                         MakeCmdAttr<CommandRename>("rename", 3, "write", 1, 2, 1),
                         MakeCmdAttr<CommandRenameNX>("renamenx", 3, "write", 1, 2, 1),
                         MakeCmdAttr<CommandCopy>("copy", -3, "write", 1, 2, 1),
-                        MakeCmdAttr<CommandSort<false>>("sort", -2, "write slow", 1, 1, 1),
+                        MakeCmdAttr<CommandSort<false>>("sort", -2, "write slow", CommandSort<false>::Range),
                         MakeCmdAttr<CommandSort<true>>("sort_ro", -2, "read-only slow", 1, 1, 1))
 
 }  // namespace redis
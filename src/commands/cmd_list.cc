@@ -18,9 +18,12 @@
  *
  */
 
+#include <algorithm>
+
 #include "commander.h"
 #include "commands/blocking_commander.h"
 #include "commands/command_parser.h"
+#include "commands/streaming_commander.h"
 #include "error_constants.h"
 #include "event_util.h"
 #include "server/redis_reply.h"
@@ -304,6 +307,7 @@ class CommandBPop : public BlockingCommander {
         conn_->Reply(conn_->MultiBulkString({"", ""}));
       } else {
         conn_->GetServer()->UpdateWatchedKeysManually({*last_key_ptr});
+        conn_->GetServer()->InvalidateTrackedKeys(conn_, {*last_key_ptr});
         conn_->Reply(conn_->MultiBulkString({*last_key_ptr, std::move(elem)}));
       }
     } else if (!s.IsNotFound()) {
@@ -414,6 +418,7 @@ class CommandBLMPop : public BlockingCommander {
     if (s.ok()) {
       if (!elems.empty()) {
         conn_->GetServer()->UpdateWatchedKeysManually({chosen_key});
+        conn_->GetServer()->InvalidateTrackedKeys(conn_, {chosen_key});
         std::string elems_bulk = conn_->MultiBulkString(elems);
         conn_->Reply(redis::Array({redis::BulkString(chosen_key), std::move(elems_bulk)}));
       }
@@ -521,7 +526,7 @@ class CommandLInsert : public Commander {
   bool before_ = false;
 };
 
-class CommandLRange : public Commander {
+class CommandLRange : public StreamingCommander {
  public:
   Status Parse(const std::vector<std::string> &args) override {
     auto parse_start = ParseInt<int>(args[2], 10);
@@ -537,19 +542,66 @@ class CommandLRange : public Commander {
 
   Status Execute(Server *srv, Connection *conn, std::string *output) override {
     redis::List list_db(srv->storage, conn->GetNamespace());
+    ctx_ = std::make_unique<engine::Context>(srv->storage);
+    uint64_t size = 0;
+    auto s = list_db.Size(*ctx_, args_[1], &size);
+    if (!s.ok()) {
+      return {Status::RedisExecErr, s.ToString()};
+    }
+    // Normalize the range like List::Range, to count the elements of the reply upfront
+    auto len = static_cast<int64_t>(size);
+    int64_t start = start_ < 0 ? std::max<int64_t>(len + start_, 0) : start_;
+    int64_t stop = stop_ < 0 ? len + stop_ : std::min<int64_t>(stop_, len - 1);
+    uint64_t count = start <= stop ? static_cast<uint64_t>(stop - start + 1) : 0;
+    if (ShouldStream(srv, conn, count)) {
+      ns_ = conn->GetNamespace();
+      next_ = start;
+      last_ = stop;
+      *output = redis::MultiLen(count);
+      return StartStreaming(conn);
+    }
+
     std::vector<std::string> elems;
-    engine::Context ctx(srv->storage);
-    auto s = list_db.Range(ctx, args_[1], start_, stop_, &elems);
+    s = list_db.Range(*ctx_, args_[1], start_, stop_, &elems);
     if (!s.ok() && !s.IsNotFound()) {
       return {Status::RedisExecErr, s.ToString()};
     }
 
-    *output = ArrayOfBulkStrings(elems);
+    auto writer = conn->Writer(output);
+    size_t reserve_size = 0;
+    for (const auto &elem : elems) reserve_size += ReplyWriter::BulkStringSize(elem.size());
+    writer.Reserve(reserve_size);
+    writer.ArrayHeader(elems.size());
+    for (const auto &elem : elems) {
+      writer.BulkString(elem);
+    }
     return Status::OK();
   }
 
+  StatusOr<bool> OnStreamingWrite(std::string *output) override {
+    redis::List list_db(ctx_->storage, ns_);
+    auto last = std::min<int64_t>(next_ + static_cast<int64_t>(kBatchSize) - 1, last_);
+    std::vector<std::string> elems;
+    auto s = list_db.Range(*ctx_, args_[1], static_cast<int>(next_), static_cast<int>(last), &elems);
+    if (!s.ok()) return {Status::RedisExecErr, s.ToString()};
+    // The elements are counted in the header, so the snapshot must have as many of them
+    if (elems.size() != static_cast<size_t>(last - next_ + 1)) {
+      return {Status::NotOK, "the list has less elements than its size"};
+    }
+
+    auto writer = conn_->Writer(output);
+    for (const auto &elem : elems) {
+      writer.BulkString(elem);
+    }
+    next_ = last + 1;
+    return next_ > last_;
+  }
+
  private:
   int start_ = 0, stop_ = 0;
+  std::string ns_;
+  // the next and the last index of the streamed elements
+  int64_t next_ = 0, last_ = 0;
 };
 
 class CommandLLen : public Commander {
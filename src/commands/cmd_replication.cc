@@ -18,6 +18,7 @@
  *
  */
 
+#include "blocking_commander.h"
 #include "commander.h"
 #include "error_constants.h"
 #include "io_util.h"
@@ -78,12 +79,19 @@ class CommandPSync : public Commander {
       }
     }
 
-    // Check Log sequence
-    if (!need_full_sync && !checkWALBoundary(srv->storage, next_repl_seq_).IsOK()) {
+    // Check Log sequence, the replication backlog may still have it after the WAL is purged
+    if (!need_full_sync && !checkWALBoundary(srv->storage, next_repl_seq_).IsOK() &&
+        !srv->GetWALRing()->Covers(next_repl_seq_)) {
       *output = "sequence out of range, please use fullsync";
       need_full_sync = true;
     }
 
+    // The entries of the SST files ingested by a slot migration aren't in the WAL
+    if (!need_full_sync && next_repl_seq_ <= srv->storage->GetLastIngestSeq()) {
+      *output = "sequence is before an ingestion of SST files, please use fullsync";
+      need_full_sync = true;
+    }
+
     if (need_full_sync) {
       srv->stats.IncrPSyncErrCount();
       return {Status::RedisExecErr, *output};
@@ -179,6 +187,13 @@ class CommandReplConf : public Commander {
         return {Status::RedisParseErr, "ip-address should not be empty"};
       }
       ip_address_ = value;
+    } else if (option == "compression") {
+      auto type = util::ParseCompressionType(value);
+      if (!type) return {Status::RedisParseErr, type.Msg()};
+      compression_ = *type;
+    } else if (option == "capa") {
+      // the unknown capabilities are ignored, like redis does
+      if (util::EqualICase(value, "ack")) ack_ = true;
     } else {
       return {Status::RedisParseErr, errUnknownOption};
     }
@@ -193,6 +208,8 @@ class CommandReplConf : public Commander {
     if (!ip_address_.empty()) {
       conn->SetAnnounceIP(ip_address_);
     }
+    conn->SetReplCompression(compression_);
+    conn->SetReplAck(ack_);
     *output = redis::SimpleString("OK");
     return Status::OK();
   }
@@ -200,6 +217,8 @@ class CommandReplConf : public Commander {
  private:
   int port_ = 0;
   std::string ip_address_;
+  util::CompressionType compression_ = util::CompressionType::kNone;
+  bool ack_ = false;
 };
 
 class CommandFetchMeta : public Commander {
@@ -257,13 +276,28 @@ class CommandFetchMeta : public Commander {
 
 class CommandFetchFile : public Commander {
  public:
+  // _fetch_file <files> [<ranges>], the ranges are the offsets and the crc32c of the fetched parts of
+  // the files, e.g. "4096:1234,0:0", to resume the interrupted fetches
   Status Parse(const std::vector<std::string> &args) override {
     files_str_ = args[1];
+    if (args.size() > 2) {
+      auto ranges = util::Split(args[2], ",");
+      for (const auto &range : ranges) {
+        auto parts = util::Split(range, ":");
+        if (parts.size() != 2) return {Status::RedisParseErr, "invalid file range"};
+        auto offset = GET_OR_RET(ParseInt<uint64_t>(parts[0], 10).Prefixed("invalid file offset"));
+        auto crc = GET_OR_RET(ParseInt<uint32_t>(parts[1], 10).Prefixed("invalid file crc"));
+        ranges_.emplace_back(offset, crc);
+      }
+    }
     return Status::OK();
   }
 
   Status Execute(Server *srv, Connection *conn, [[maybe_unused]] std::string *output) override {
     std::vector<std::string> files = util::Split(files_str_, ",");
+    if (!ranges_.empty() && ranges_.size() != files.size()) {
+      return {Status::RedisExecErr, "the number of the file ranges doesn't match the files"};
+    }
 
     int repl_fd = conn->GetFD();
     std::string ip = conn->GetAnnounceIP();
@@ -276,11 +310,18 @@ class CommandFetchFile : public Commander {
     conn->NeedNotFreeBufferEvent();  // Feed-replica-file thread will close the replica bufferevent
     conn->EnableFlag(redis::Connection::kCloseAsync);
 
-    auto t = GET_OR_RET(util::CreateThread("feed-repl-file", [srv, repl_fd, ip, files, bev = conn->GetBufferEvent()]() {
-      auto exit = MakeScopeExit([bev] { bufferevent_free(bev); });
+    auto t = GET_OR_RET(util::CreateThread("feed-repl-file", [srv, repl_fd, ip, files, ranges = ranges_,
+                                                              bev = conn->GetBufferEvent()]() {
+      // The checkpoint is referenced until all the files are sent, so it can't be purged in the middle
+      srv->storage->AcquireCheckpoint();
+      auto exit = MakeScopeExit([srv, bev] {
+        bufferevent_free(bev);
+        srv->storage->ReleaseCheckpoint();
+      });
       srv->IncrFetchFileThread();
 
-      for (const auto &file : files) {
+      for (size_t i = 0; i < files.size(); i++) {
+        const auto &file = files[i];
         if (srv->IsStopped()) break;
 
         uint64_t file_size = 0, max_replication_bytes = 0;
@@ -291,10 +332,23 @@ class CommandFetchFile : public Commander {
         auto fd = UniqueFD(engine::Storage::ReplDataManager::OpenDataFile(srv->storage, file, &file_size));
         if (!fd) break;
 
+        // A fetch is resumed from the offset if the replica has the same data before it, or the whole file is sent,
+        // and the reply to a ranged fetch starts with the offset of the sent data
+        std::string header = std::to_string(file_size) + CRLF;
+        uint64_t offset = 0;
+        if (!ranges.empty()) {
+          auto [range_offset, range_crc] = ranges[i];
+          if (range_offset > 0 &&
+              engine::Storage::ReplDataManager::CheckDataFilePrefix(srv->storage, file, range_offset, range_crc)) {
+            offset = range_offset;
+          }
+          header = std::to_string(offset) + " " + std::to_string(file_size - offset) + CRLF;
+        }
+
         // Send file size and content
-        if (util::SockSend(repl_fd, std::to_string(file_size) + CRLF, bev).IsOK() &&
-            util::SockSendFile(repl_fd, *fd, file_size, bev).IsOK()) {
-          LOG(INFO) << "[replication] Succeed sending file " << file << " to " << ip;
+        if (util::SockSend(repl_fd, header, bev).IsOK() &&
+            util::SockSendFileRange(repl_fd, *fd, static_cast<off_t>(offset), file_size - offset, bev).IsOK()) {
+          LOG(INFO) << "[replication] Succeed sending file " << file << " from offset " << offset << " to " << ip;
         } else {
           LOG(WARNING) << "[replication] Fail to send file " << file << " to " << ip << ", error: " << strerror(errno);
           break;
@@ -305,7 +359,7 @@ class CommandFetchFile : public Commander {
         auto end = std::chrono::high_resolution_clock::now();
         uint64_t duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
         if (max_replication_bytes > 0) {
-          auto shortest = static_cast<uint64_t>(static_cast<double>(file_size) /
+          auto shortest = static_cast<uint64_t>(static_cast<double>(file_size - offset) /
                                                 static_cast<double>(max_replication_bytes) * (1000 * 1000));
           if (duration < shortest) {
             LOG(INFO) << "[replication] Need to sleep " << (shortest - duration) / 1000
@@ -314,8 +368,6 @@ class CommandFetchFile : public Commander {
           }
         }
       }
-      auto now_secs = util::GetTimeStamp<std::chrono::seconds>();
-      srv->storage->SetCheckpointAccessTimeSecs(now_secs);
       srv->DecrFetchFileThread();
     }));
 
@@ -328,6 +380,7 @@ class CommandFetchFile : public Commander {
 
  private:
   std::string files_str_;
+  std::vector<std::pair<uint64_t, uint32_t>> ranges_;
 };
 
 class CommandDBName : public Commander {
@@ -340,11 +393,74 @@ class CommandDBName : public Commander {
   }
 };
 
+// WAIT blocks until the writes of the connection are acked by numreplicas replicas or the timeout,
+// and replies the number of the replicas which acked them. Only the replicas negotiating the
+// acks (REPLCONF capa ack) are counted.
+class CommandWait : public BlockingCommander {
+ public:
+  Status Parse(const std::vector<std::string> &args) override {
+    auto num_replicas = ParseInt<int64_t>(args[1], NumericRange<int64_t>{0, INT64_MAX}, 10);
+    if (!num_replicas) {
+      return {Status::RedisParseErr, "numreplicas should be a non-negative integer"};
+    }
+    num_replicas_ = static_cast<size_t>(*num_replicas);
+
+    auto timeout_ms = ParseInt<int64_t>(args[2], NumericRange<int64_t>{0, INT64_MAX / 1000}, 10);
+    if (!timeout_ms) {
+      return {Status::RedisParseErr, "timeout is negative or out of range"};
+    }
+    timeout_ = *timeout_ms * 1000;
+
+    return Commander::Parse(args);
+  }
+
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    if (srv->IsSlave()) {
+      return {Status::RedisExecErr, "WAIT cannot be used with replica instances"};
+    }
+
+    srv_ = srv;
+    InitConnection(conn);
+    seq_ = conn->GetLastWriteSeq();
+    if (num_replicas_ == 0 || srv->CountReplicasAcked(seq_) >= num_replicas_) {
+      *output = NoopReply(conn);
+      return Status::OK();
+    }
+
+    return StartBlocking(timeout_, output);
+  }
+
+  void BlockKeys() override {
+    srv_->BlockOnReplicaAcks(conn_);
+    // the acks received before the waiter is added would be missed
+    if (srv_->CountReplicasAcked(seq_) >= num_replicas_) srv_->WakeupReplicaAckWaiters();
+  }
+
+  void UnblockKeys() override { srv_->UnblockOnReplicaAcks(conn_); }
+
+  bool OnBlockingWrite() override {
+    auto acked = srv_->CountReplicasAcked(seq_);
+    if (acked < num_replicas_) return false;
+
+    conn_->Reply(redis::Integer(acked));
+    return true;
+  }
+
+  std::string NoopReply(const Connection *) override { return redis::Integer(srv_->CountReplicasAcked(seq_)); }
+
+ private:
+  Server *srv_ = nullptr;
+  size_t num_replicas_ = 0;
+  int64_t timeout_ = 0;
+  rocksdb::SequenceNumber seq_ = 0;
+};
+
 REDIS_REGISTER_COMMANDS(
     Replication, MakeCmdAttr<CommandReplConf>("replconf", -3, "read-only replication no-script", 0, 0, 0),
     MakeCmdAttr<CommandPSync>("psync", -2, "read-only replication no-multi no-script", 0, 0, 0),
     MakeCmdAttr<CommandFetchMeta>("_fetch_meta", 1, "read-only replication no-multi no-script", 0, 0, 0),
-    MakeCmdAttr<CommandFetchFile>("_fetch_file", 2, "read-only replication no-multi no-script", 0, 0, 0),
-    MakeCmdAttr<CommandDBName>("_db_name", 1, "read-only replication no-multi", 0, 0, 0), )
+    MakeCmdAttr<CommandFetchFile>("_fetch_file", -2, "read-only replication no-multi no-script", 0, 0, 0),
+    MakeCmdAttr<CommandDBName>("_db_name", 1, "read-only replication no-multi", 0, 0, 0),
+    MakeCmdAttr<CommandWait>("wait", 3, "read-only no-script", 0, 0, 0), )
 
 }  // namespace redis
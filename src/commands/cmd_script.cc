@@ -41,9 +41,11 @@ class CommandEvalImpl : public Commander {
       return {Status::NotOK, "Number of keys can't be negative"};
     }
 
+    // a no-writes script is admitted as a read-only one by GenerateScriptEvalFlags
+    bool no_writes = read_only || (!evalsha && lua::IsNoWritesScript(args_[1]));
     return lua::EvalGenericCommand(
         conn, args_[1], std::vector<std::string>(args_.begin() + 3, args_.begin() + 3 + numkeys),
-        std::vector<std::string>(args_.begin() + 3 + numkeys, args_.end()), evalsha, output, read_only);
+        std::vector<std::string>(args_.begin() + 3 + numkeys, args_.end()), evalsha, output, no_writes);
   }
 };
 
@@ -115,6 +117,15 @@ CommandKeyRange GetScriptEvalKeyRange(const std::vector<std::string> &args) {
   return {3, 2 + numkeys, 1};
 }
 
+// EVAL of a script with the no-writes flag is run like EVAL_RO, i.e. concurrently and on replicas
+uint64_t GenerateScriptEvalFlags(uint64_t flags, const std::vector<std::string> &args) {
+  if (args.size() > 1 && lua::IsNoWritesScript(args[1])) {
+    return (flags & ~(kCmdExclusive | kCmdWrite)) | kCmdReadOnly | kCmdROScript;
+  }
+
+  return flags;
+}
+
 uint64_t GenerateScriptFlags(uint64_t flags, const std::vector<std::string> &args) {
   if (util::EqualICase(args[1], "load") || util::EqualICase(args[1], "flush")) {
     return flags | kCmdWrite;
@@ -124,10 +135,12 @@ uint64_t GenerateScriptFlags(uint64_t flags, const std::vector<std::string> &arg
 }
 
 REDIS_REGISTER_COMMANDS(
-    Script, MakeCmdAttr<CommandEval>("eval", -3, "exclusive write no-script", GetScriptEvalKeyRange),
-    MakeCmdAttr<CommandEvalSHA>("evalsha", -3, "exclusive write no-script", GetScriptEvalKeyRange),
-    MakeCmdAttr<CommandEvalRO>("eval_ro", -3, "read-only no-script ro-script", GetScriptEvalKeyRange),
-    MakeCmdAttr<CommandEvalSHARO>("evalsha_ro", -3, "read-only no-script ro-script", GetScriptEvalKeyRange),
+    Script, MakeCmdAttr<CommandEval>("eval", -3, "exclusive write script no-script", GetScriptEvalKeyRange,
+                                     GenerateScriptEvalFlags),
+    MakeCmdAttr<CommandEvalSHA>("evalsha", -3, "exclusive write script no-script", GetScriptEvalKeyRange),
+    MakeCmdAttr<CommandEvalRO>("eval_ro", -3, "read-only script no-script ro-script", GetScriptEvalKeyRange),
+    MakeCmdAttr<CommandEvalSHARO>("evalsha_ro", -3, "read-only script no-script ro-script",
+                                  GetScriptEvalKeyRange),
     MakeCmdAttr<CommandScript>("script", -2, "exclusive no-script", 0, 0, 0), )
 
 }  // namespace redis
@@ -18,12 +18,19 @@
  *
  */
 
+#include <rocksdb/perf_context.h>
+
+#include <atomic>
+#include <chrono>
+#include <map>
 #include <memory>
+#include <set>
 #include <sstream>
 #include <variant>
 
 #include "commander.h"
 #include "commands/command_parser.h"
+#include "commands/suspendable_commander.h"
 #include "search/common_transformer.h"
 #include "search/index_info.h"
 #include "search/ir.h"
@@ -85,6 +92,8 @@ class CommandFTCreate : public Commander {
           field_meta = std::make_unique<redis::TagFieldMetadata>();
         } else if (parser.EatEqICase("NUMERIC")) {
           field_meta = std::make_unique<redis::NumericFieldMetadata>();
+        } else if (parser.EatEqICase("TEXT")) {
+          field_meta = std::make_unique<redis::TextFieldMetadata>();
         } else if (parser.EatEqICase("VECTOR")) {
           if (parser.EatEqICase("HNSW")) {
             field_meta = std::make_unique<redis::HnswVectorFieldMetadata>();
@@ -100,7 +109,7 @@ class CommandFTCreate : public Commander {
             return {Status::RedisParseErr, "only support HNSW algorithm for vector field"};
           }
         } else {
-          return {Status::RedisParseErr, "expect field type TAG, NUMERIC or VECTOR"};
+          return {Status::RedisParseErr, "expect field type TAG, NUMERIC, TEXT or VECTOR"};
         }
 
         while (parser.Good()) {
@@ -120,12 +129,20 @@ class CommandFTCreate : public Commander {
             } else {
               break;
             }
+          } else if (auto text = dynamic_cast<redis::TextFieldMetadata *>(field_meta.get())) {
+            if (parser.EatEqICase("NOSTEM")) {
+              text->nostem = true;
+            } else {
+              break;
+            }
           } else if (auto vector = dynamic_cast<redis::HnswVectorFieldMetadata *>(field_meta.get())) {
             if (hnsw_state->num_attributes <= 0) break;
 
             if (parser.EatEqICase("TYPE")) {
               if (parser.EatEqICase("FLOAT64")) {
                 vector->vector_type = VectorType::FLOAT64;
+              } else if (parser.EatEqICase("FLOAT32")) {
+                vector->vector_type = VectorType::FLOAT32;
               } else {
                 return {Status::RedisParseErr, "unsupported vector type"};
               }
@@ -152,6 +169,14 @@ class CommandFTCreate : public Commander {
               vector->ef_runtime = GET_OR_RET(parser.TakeInt<uint32_t>());
             } else if (parser.EatEqICase("EPSILON")) {
               vector->epsilon = GET_OR_RET(parser.TakeFloat<double>());
+            } else if (parser.EatEqICase("QUANTIZATION")) {
+              if (parser.EatEqICase("NONE")) {
+                vector->quantization = VectorQuantization::NONE;
+              } else if (parser.EatEqICase("SQ8")) {
+                vector->quantization = VectorQuantization::SQ8;
+              } else {
+                return {Status::RedisParseErr, "unsupported vector quantization"};
+              }
             } else {
               break;
             }
@@ -228,6 +253,15 @@ static void DumpQueryResult(const std::vector<kqir::ExecutorContext::RowType> &r
   }
 }
 
+// The searches with the same arguments have the same plan, so the arguments are the key of the cached plan
+static std::string PlanCacheKey(std::string_view kind, const std::vector<std::string> &args) {
+  std::string key(kind);
+  for (size_t i = 1; i < args.size(); ++i) {
+    PutSizedString(&key, args[i]);
+  }
+  return key;
+}
+
 using CommandParserWithNode = std::pair<CommandParserFromConst<std::vector<std::string>>, std::unique_ptr<kqir::Node>>;
 
 static StatusOr<CommandParserWithNode> ParseSQLQuery(const std::vector<std::string> &args) {
@@ -308,7 +342,8 @@ class CommandFTSearchSQL : public Commander {
     return Status::OK();
   }
   Status Execute(Server *srv, Connection *conn, std::string *output) override {
-    auto results = GET_OR_RET(srv->index_mgr.Search(std::move(ir_), conn->GetNamespace()));
+    auto results =
+        GET_OR_RET(srv->index_mgr.Search(std::move(ir_), conn->GetNamespace(), PlanCacheKey("sql", args_)));
 
     DumpQueryResult(results, output);
 
@@ -319,7 +354,9 @@ class CommandFTSearchSQL : public Commander {
   std::unique_ptr<kqir::Node> ir_;
 };
 
-static StatusOr<std::unique_ptr<kqir::Node>> ParseRediSearchQuery(const std::vector<std::string> &args) {
+// WAITINDEX is only parsed if wait_index_ms is given, it's 0 if the search doesn't wait for the index
+static StatusOr<std::unique_ptr<kqir::Node>> ParseRediSearchQuery(const std::vector<std::string> &args,
+                                                                  uint64_t *wait_index_ms = nullptr) {
   CommandParser parser(args, 1);
 
   auto index_name = GET_OR_RET(parser.TakeStr());
@@ -367,6 +404,8 @@ static StatusOr<std::unique_ptr<kqir::Node>> ParseRediSearchQuery(const std::vec
 
         param_map.emplace(key, val);
       }
+    } else if (wait_index_ms && parser.EatEqICase("WAITINDEX")) {
+      *wait_index_ms = GET_OR_RET(parser.TakeInt<uint64_t>(NumericRange<uint64_t>{1, UINT32_MAX}));
     } else {
       return parser.InvalidSyntax();
     }
@@ -398,23 +437,323 @@ class CommandFTExplain : public Commander {
   std::unique_ptr<kqir::Node> ir_;
 };
 
-class CommandFTSearch : public Commander {
+// FT.SEARCH with WAITINDEX suspends the connection until the index catches up with the writes,
+// instead of blocking the worker, unless it runs in MULTI, scripts or the heavy command pool
+class CommandFTSearch : public SuspendableCommander {
   Status Parse(const std::vector<std::string> &args) override {
-    ir_ = GET_OR_RET(ParseRediSearchQuery(args));
+    ir_ = GET_OR_RET(ParseRediSearchQuery(args, &wait_index_ms_));
     return Status::OK();
   }
 
   Status Execute(Server *srv, Connection *conn, std::string *output) override {
     CHECK(ir_);
-    auto results = GET_OR_RET(srv->index_mgr.Search(std::move(ir_), conn->GetNamespace()));
+    if (wait_index_ms_ == 0) return search(srv, conn, output);
+
+    if (!conn->CanSuspend(this)) {
+      GET_OR_RET(srv->index_mgr.WaitForIndex(args_[1], conn->GetNamespace(),
+                                             std::chrono::milliseconds(wait_index_ms_)));
+      return search(srv, conn, output);
+    }
+
+    auto applied = std::make_shared<std::atomic<bool>>(false);
+    auto on_applied = [applied, waker = MakeWaker()](bool ok) {
+      *applied = ok;
+      waker.Wake();
+    };
+    GET_OR_RET(srv->index_mgr.NotifyIndexApplied(args_[1], conn->GetNamespace(), std::move(on_applied)));
+    if (*applied) return search(srv, conn, output);
+
+    return AwaitWake(srv, conn, static_cast<int64_t>(wait_index_ms_) * 1000, output,
+                     [this, srv, conn, applied](bool, std::string *output) -> Status {
+                       if (!*applied) {
+                         return {Status::NotOK, "timeout while waiting for the index to catch up with the writes"};
+                       }
+                       return search(srv, conn, output);
+                     });
+  };
+
+ private:
+  std::unique_ptr<kqir::Node> ir_;
+  uint64_t wait_index_ms_ = 0;
+
+  Status search(Server *srv, Connection *conn, std::string *output) {
+    auto results =
+        GET_OR_RET(srv->index_mgr.Search(std::move(ir_), conn->GetNamespace(), PlanCacheKey("query", args_)));
 
     DumpQueryResult(results, output);
 
+    return Status::OK();
+  }
+};
+
+// DumpProfile appends the profile of the executor of the operator, and the ones of the executors it reads from
+static void DumpProfile(const kqir::ExecutorContext &ctx, kqir::PlanOperator *op, Connection *conn,
+                        std::string *output) {
+  std::vector<kqir::PlanOperator *> children;
+  for (auto iter = op->ChildBegin(); iter != op->ChildEnd(); ++iter) {
+    // the scans of an intersection are read by the intersection itself, so they have no executor
+    auto child = dynamic_cast<kqir::PlanOperator *>(*iter);
+    if (child && ctx.GetProfile(child)) children.push_back(child);
+  }
+
+  const auto *profile = ctx.GetProfile(op);
+  output->append(MultiLen(20));
+  output->append(SimpleString("type"));
+  output->append(BulkString(std::string(op->Name())));
+  output->append(SimpleString("details"));
+  output->append(BulkString(op->Content()));
+  output->append(SimpleString("calls"));
+  output->append(Integer(profile->calls));
+  output->append(SimpleString("rows"));
+  output->append(Integer(profile->rows));
+  output->append(SimpleString("time_ms"));
+  output->append(conn->Double(static_cast<double>(profile->time_us) / 1000));
+  output->append(SimpleString("rocksdb_keys_scanned"));
+  output->append(Integer(profile->keys_scanned));
+  output->append(SimpleString("rocksdb_read_bytes"));
+  output->append(Integer(profile->read_bytes));
+  output->append(SimpleString("rocksdb_block_reads"));
+  output->append(Integer(profile->block_reads));
+  output->append(SimpleString("children"));
+  output->append(MultiLen(children.size()));
+  for (auto *child : children) {
+    DumpProfile(ctx, child, conn, output);
+  }
+}
+
+// FT.PROFILE <index> SEARCH QUERY <query> [options of FT.SEARCH]
+class CommandFTProfile : public Commander {
+  Status Parse(const std::vector<std::string> &args) override {
+    CommandParser parser(args, 2);
+    if (!parser.EatEqICase("SEARCH")) {
+      return {Status::NotOK, "only SEARCH queries can be profiled"};
+    }
+    if (!parser.EatEqICase("QUERY")) {
+      return parser.InvalidSyntax();
+    }
+
+    // the arguments of FT.SEARCH are the index and the ones after QUERY
+    std::vector<std::string> search_args{"ft.search", args[1]};
+    search_args.insert(search_args.end(), args.begin() + static_cast<ptrdiff_t>(args.size() - parser.Remains()),
+                       args.end());
+    ir_ = GET_OR_RET(ParseRediSearchQuery(search_args));
+    return Status::OK();
+  }
+
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    CHECK(ir_);
+    auto plan = GET_OR_RET(srv->index_mgr.GeneratePlan(std::move(ir_), conn->GetNamespace()));
+    kqir::ExecutorContext executor_ctx(plan.get(), srv->storage, true);
+
+    // the reads of RocksDB are counted by the perf context of the thread
+    auto perf_level = rocksdb::GetPerfLevel();
+    if (perf_level < rocksdb::PerfLevel::kEnableCount) rocksdb::SetPerfLevel(rocksdb::PerfLevel::kEnableCount);
+    auto results = redis::IndexManager::Execute(executor_ctx);
+    rocksdb::SetPerfLevel(perf_level);
+    if (!results) return std::move(results);
+
+    output->append(MultiLen(2));
+    DumpQueryResult(*results, output);
+    DumpProfile(executor_ctx, plan.get(), conn, output);
+
+    return Status::OK();
+  };
+
+ private:
+  std::unique_ptr<kqir::Node> ir_;
+};
+
+// FT.AGGREGATE <index> <query> GROUPBY <nargs> @<field>... [REDUCE <function> <nargs> [@<field>] [AS <name>]]...
+//   [APPLY <expression> AS <name>]... [SORTBY <nargs> @<name> [ASC|DESC]] [LIMIT <offset> <num>] [PARAMS ...]
+class CommandFTAggregate : public Commander {
+  Status Parse(const std::vector<std::string> &args) override {
+    CommandParser parser(args, 1);
+
+    auto index_name = GET_OR_RET(parser.TakeStr());
+    auto query_str = GET_OR_RET(parser.TakeStr());
+
+    auto take_field = [&parser]() -> StatusOr<std::string> {
+      auto field = GET_OR_RET(parser.TakeStr());
+      if (field.size() < 2 || field[0] != '@') {
+        return {Status::RedisParseErr, "expect a field name starting with '@'"};
+      }
+      return field.substr(1);
+    };
+
+    bool has_group_by = false;
+    kqir::ParamMap param_map;
+    while (parser.Good()) {
+      if (parser.EatEqICase("GROUPBY")) {
+        if (has_group_by) return {Status::RedisParseErr, "only one GROUPBY is supported"};
+        has_group_by = true;
+
+        auto nargs = GET_OR_RET(parser.TakeInt<size_t>());
+        for (size_t i = 0; i < nargs; ++i) {
+          group_by_.push_back(GET_OR_RET(take_field()));
+        }
+      } else if (parser.EatEqICase("REDUCE")) {
+        if (!has_group_by) return {Status::RedisParseErr, "REDUCE must follow GROUPBY"};
+
+        ReducerArgs reducer;
+        if (parser.EatEqICase("COUNT")) {
+          reducer.kind = kqir::Aggregate::COUNT;
+        } else if (parser.EatEqICase("SUM")) {
+          reducer.kind = kqir::Aggregate::SUM;
+        } else if (parser.EatEqICase("AVG")) {
+          reducer.kind = kqir::Aggregate::AVG;
+        } else if (parser.EatEqICase("MIN")) {
+          reducer.kind = kqir::Aggregate::MIN;
+        } else if (parser.EatEqICase("MAX")) {
+          reducer.kind = kqir::Aggregate::MAX;
+        } else if (parser.EatEqICase("COUNT_DISTINCT")) {
+          reducer.kind = kqir::Aggregate::COUNT_DISTINCT;
+        } else {
+          return {Status::RedisParseErr, "expect reducer COUNT, SUM, AVG, MIN, MAX or COUNT_DISTINCT"};
+        }
+
+        auto nargs = GET_OR_RET(parser.TakeInt<size_t>());
+        if (nargs != (reducer.kind == kqir::Aggregate::COUNT ? 0 : 1)) {
+          return {Status::RedisParseErr, "COUNT takes no argument, and the other reducers take a field"};
+        }
+        if (nargs == 1) reducer.field = GET_OR_RET(take_field());
+
+        if (parser.EatEqICase("AS")) {
+          reducer.alias = GET_OR_RET(parser.TakeStr());
+        } else {
+          reducer.alias = fmt::format("__generated_alias{}{}", kqir::Aggregate::ReduceKindToString(reducer.kind),
+                                      reducer.field);
+        }
+        reducers_.push_back(std::move(reducer));
+      } else if (parser.EatEqICase("APPLY")) {
+        if (!has_group_by) return {Status::RedisParseErr, "APPLY is only supported after GROUPBY"};
+
+        auto expr = GET_OR_RET(kqir::ArithmeticExpr::Parse(GET_OR_RET(parser.TakeStr())));
+        if (!parser.EatEqICase("AS")) return {Status::RedisParseErr, "expect AS after the expression of APPLY"};
+        applies_.push_back({std::move(expr), GET_OR_RET(parser.TakeStr())});
+      } else if (parser.EatEqICase("SORTBY")) {
+        auto nargs = GET_OR_RET(parser.TakeInt<size_t>(NumericRange<size_t>{1, 2}));
+        auto order = kqir::SortByClause::ASC;
+        auto column = GET_OR_RET(take_field());
+        if (nargs == 2) {
+          if (parser.EatEqICase("DESC")) {
+            order = kqir::SortByClause::DESC;
+          } else if (!parser.EatEqICase("ASC")) {
+            return {Status::RedisParseErr, "expect ASC or DESC in SORTBY"};
+          }
+        }
+
+        sort_by_ = std::make_unique<kqir::SortByClause>(order, std::make_unique<kqir::FieldRef>(column));
+      } else if (parser.EatEqICase("LIMIT")) {
+        auto offset = GET_OR_RET(parser.TakeInt<size_t>());
+        auto count = GET_OR_RET(parser.TakeInt<size_t>());
+
+        limit_ = std::make_unique<kqir::LimitClause>(offset, count);
+      } else if (parser.EatEqICase("PARAMS")) {
+        auto nargs = GET_OR_RET(parser.TakeInt<size_t>());
+        if (nargs % 2 != 0) {
+          return {Status::NotOK, "nargs of PARAMS must be multiple of 2"};
+        }
+
+        for (size_t i = 0; i < nargs / 2; ++i) {
+          auto key = GET_OR_RET(parser.TakeStr());
+          auto val = GET_OR_RET(parser.TakeStr());
+
+          param_map.emplace(key, val);
+        }
+      } else {
+        return parser.InvalidSyntax();
+      }
+    }
+
+    if (!has_group_by) return {Status::RedisParseErr, "GROUPBY is required"};
+
+    // only the fields which are grouped or reduced are retrieved
+    std::set<std::string> fields(group_by_.begin(), group_by_.end());
+    for (const auto &reducer : reducers_) {
+      if (!reducer.field.empty()) fields.insert(reducer.field);
+    }
+    auto select = std::make_unique<kqir::SelectClause>(std::vector<std::unique_ptr<kqir::FieldRef>>{});
+    for (const auto &field : fields) {
+      select->fields.push_back(std::make_unique<kqir::FieldRef>(field));
+    }
+
+    auto query = kqir::Node::MustAs<kqir::QueryExpr>(
+        GET_OR_RET(kqir::redis_query::ParseToIR(kqir::peg::string_input(query_str, "ft.aggregate"), param_map)));
+    ir_ = std::make_unique<kqir::SearchExpr>(std::make_unique<kqir::IndexRef>(index_name), std::move(query), nullptr,
+                                             nullptr, std::move(select));
+    return Status::OK();
+  }
+
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    CHECK(ir_);
+    auto plan = GET_OR_RET(srv->index_mgr.GeneratePlan(std::move(ir_), conn->GetNamespace(),
+                                                       PlanCacheKey("aggregate", args_)));
+
+    // the fields are resolved by the projection, which is skipped if there's no field to retrieve
+    auto proj = kqir::Node::MustAs<kqir::Projection>(std::move(plan));
+    auto resolve = [&proj](const std::string &name) {
+      for (const auto &field : proj->select->fields) {
+        if (field->name == name) return field->CloneAs<kqir::FieldRef>();
+      }
+      CHECK(false) << "the field " << name << " is not selected";
+    };
+
+    std::vector<std::unique_ptr<kqir::FieldRef>> group_by;
+    for (const auto &field : group_by_) group_by.push_back(resolve(field));
+    std::vector<kqir::Aggregate::Reducer> reducers;
+    for (auto &reducer : reducers_) {
+      reducers.push_back({reducer.kind, reducer.field.empty() ? nullptr : resolve(reducer.field), reducer.alias});
+    }
+
+    std::unique_ptr<kqir::PlanOperator> source;
+    if (proj->select->fields.empty()) {
+      source = std::move(proj->source);
+    } else {
+      source = std::move(proj);
+    }
+
+    auto max_memory = static_cast<uint64_t>(srv->GetConfig()->search_aggregate_max_memory) * MiB;
+    auto aggregate = std::make_unique<kqir::Aggregate>(std::move(source), std::move(group_by), std::move(reducers),
+                                                       std::move(applies_), std::move(sort_by_), max_memory);
+    GET_OR_RET(aggregate->Check());
+
+    auto aggregate_op = aggregate.get();
+    std::unique_ptr<kqir::PlanOperator> op = std::move(aggregate);
+    if (limit_) op = std::make_unique<kqir::Limit>(std::move(op), std::move(limit_));
+
+    kqir::ExecutorContext executor_ctx(op.get(), srv->storage);
+    auto rows = GET_OR_RET(redis::IndexManager::Execute(executor_ctx));
+
+    output->append(MultiLen(rows.size() + 1));
+    output->append(Integer(rows.size()));
+    for (const auto &row : rows) {
+      output->append(MultiLen(row.fields.size() * 2));
+      for (const auto *column : aggregate_op->columns) {
+        auto iter = row.fields.find(column);
+        if (iter == row.fields.end()) continue;
+
+        output->append(BulkString(column->name));
+        output->append(BulkString(iter->second.ToString(column->metadata.get())));
+      }
+    }
+
     return Status::OK();
   };
 
  private:
+  struct ReducerArgs {
+    kqir::Aggregate::ReduceKind kind;
+    // it's empty for COUNT
+    std::string field;
+    std::string alias;
+  };
+
   std::unique_ptr<kqir::Node> ir_;
+  std::vector<std::string> group_by_;
+  std::vector<ReducerArgs> reducers_;
+  std::vector<kqir::Aggregate::Apply> applies_;
+  std::unique_ptr<kqir::SortByClause> sort_by_;
+  std::unique_ptr<kqir::LimitClause> limit_;
 };
 
 class CommandFTInfo : public Commander {
@@ -428,7 +767,7 @@ class CommandFTInfo : public Commander {
     }
 
     const auto &info = iter->second;
-    output->append(MultiLen(6));
+    output->append(MultiLen(20));
 
     output->append(redis::SimpleString("index_name"));
     output->append(redis::BulkString(info->name));
@@ -456,11 +795,56 @@ class CommandFTInfo : public Commander {
         output->append(redis::BulkString(std::string(1, tag->separator)));
         output->append(redis::SimpleString("case_sensitive"));
         output->append(conn->Bool(tag->case_sensitive));
+      } else if (auto text = field.MetadataAs<TextFieldMetadata>()) {
+        output->append(redis::MultiLen(2));
+        output->append(redis::SimpleString("nostem"));
+        output->append(conn->Bool(text->nostem));
       } else {
         output->append(redis::MultiLen(0));
       }
     }
 
+    // an index without a build has been built before the restart
+    const auto *builder = srv->index_mgr.FindBuilder(info.get());
+    output->append(redis::SimpleString("indexing"));
+    output->append(redis::Integer(builder && builder->IsRunning() ? 1 : 0));
+    output->append(redis::SimpleString("percent_indexed"));
+    output->append(conn->Double(builder ? builder->GetPercentIndexed() : 1));
+    output->append(redis::SimpleString("hash_indexing_failures"));
+    output->append(redis::Integer(builder ? builder->GetFailures() : 0));
+
+    auto plan_stats = srv->index_mgr.plan_cache.GetStats(ComposeNamespaceKey(info->ns, info->name, false));
+    auto searches = plan_stats.hits + plan_stats.misses;
+    output->append(redis::SimpleString("plan_cache_hits"));
+    output->append(redis::Integer(plan_stats.hits));
+    output->append(redis::SimpleString("plan_cache_hit_rate"));
+    output->append(conn->Double(searches ? static_cast<double>(plan_stats.hits) / static_cast<double>(searches) : 0));
+
+    // the health of the HNSW graphs found by the last maintenance check
+    const auto *maintainer = srv->index_mgr.FindMaintainer(info.get());
+    auto graphs = maintainer ? maintainer->GetHealth() : std::map<std::string, redis::HnswMaintainer::FieldHealth>{};
+    output->append(redis::SimpleString("hnsw_graphs"));
+    output->append(MultiLen(graphs.size()));
+    for (const auto &[name, health] : graphs) {
+      output->append(MultiLen(12));
+      output->append(redis::SimpleString("identifier"));
+      output->append(redis::BulkString(name));
+      output->append(redis::SimpleString("nodes"));
+      output->append(redis::Integer(health.nodes));
+      output->append(redis::SimpleString("average_degree"));
+      output->append(conn->Double(health.average_degree));
+      output->append(redis::SimpleString("under_connected_nodes"));
+      output->append(redis::Integer(health.under_connected));
+      output->append(redis::SimpleString("unreachable_nodes"));
+      output->append(redis::Integer(health.unreachable));
+      output->append(redis::SimpleString("relinked_nodes"));
+      output->append(redis::Integer(health.relinked));
+    }
+
+    // the index is still warmed up after the restart
+    output->append(redis::SimpleString("loading"));
+    output->append(redis::Integer(info->loading ? 1 : 0));
+
     return Status::OK();
   };
 };
@@ -512,10 +896,12 @@ class CommandFTTagVals : public Commander {
 REDIS_REGISTER_COMMANDS(Search,
                         MakeCmdAttr<CommandFTCreate>("ft.create", -2, "write exclusive no-multi no-script slow", 0, 0,
                                                      0),
-                        MakeCmdAttr<CommandFTSearchSQL>("ft.searchsql", -2, "read-only", 0, 0, 0),
-                        MakeCmdAttr<CommandFTSearch>("ft.search", -3, "read-only", 0, 0, 0),
+                        MakeCmdAttr<CommandFTSearchSQL>("ft.searchsql", -2, "read-only heavy", 0, 0, 0),
+                        MakeCmdAttr<CommandFTSearch>("ft.search", -3, "read-only heavy", 0, 0, 0),
                         MakeCmdAttr<CommandFTExplainSQL>("ft.explainsql", -2, "read-only", 0, 0, 0),
                         MakeCmdAttr<CommandFTExplain>("ft.explain", -3, "read-only", 0, 0, 0),
+                        MakeCmdAttr<CommandFTProfile>("ft.profile", -5, "read-only heavy", 0, 0, 0),
+                        MakeCmdAttr<CommandFTAggregate>("ft.aggregate", -3, "read-only heavy", 0, 0, 0),
                         MakeCmdAttr<CommandFTInfo>("ft.info", 2, "read-only", 0, 0, 0),
                         MakeCmdAttr<CommandFTList>("ft._list", 1, "read-only", 0, 0, 0),
                         MakeCmdAttr<CommandFTDrop>("ft.dropindex", 2, "write exclusive no-multi no-script", 0, 0, 0),
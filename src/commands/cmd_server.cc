@@ -18,9 +18,16 @@
  *
  */
 
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <optional>
+
 #include "command_parser.h"
 #include "commander.h"
 #include "commands/scan_base.h"
+#include "common/alloc_util.h"
 #include "common/io_util.h"
 #include "common/rdb_stream.h"
 #include "config/config.h"
@@ -118,16 +125,13 @@ class CommandKeys : public Commander {
     std::vector<std::string> keys;
     redis::Database redis(srv->storage, conn->GetNamespace());
     engine::Context ctx(srv->storage);
-    rocksdb::Status s;
-    if (prefix == "*") {
-      s = redis.Keys(ctx, std::string(), &keys);
-    } else {
-      if (prefix[prefix.size() - 1] != '*') {
-        return {Status::RedisExecErr, "only keys prefix match was supported"};
-      }
-
-      s = redis.Keys(ctx, prefix.substr(0, prefix.size() - 1), &keys);
+    if (prefix.empty() || prefix.back() != '*') {
+      return {Status::RedisExecErr, "only keys prefix match was supported"};
     }
+    prefix.pop_back();
+
+    std::string end_cursor;
+    auto s = redis.ParallelScan(ctx, "", 0, prefix, srv->GetConfig()->keys_scan_threads, &keys, &end_cursor);
     if (!s.ok()) {
       return {Status::RedisExecErr, s.ToString()};
     }
@@ -150,6 +154,10 @@ class CommandFlushDB : public Commander {
     auto s = redis.FlushDB(ctx);
     LOG(WARNING) << "DB keys in namespace: " << conn->GetNamespace() << " was flushed, addr: " << conn->GetAddr();
     if (s.ok()) {
+      // The subkeys left behind are invisible already, so a failure only defers the space to the compactions
+      if (auto purge_s = srv->AsyncPurgeNamespace(conn->GetNamespace()); !purge_s) {
+        LOG(WARNING) << "Failed to schedule the purge of namespace: " << conn->GetNamespace() << ", " << purge_s.Msg();
+      }
       *output = redis::SimpleString("OK");
       return Status::OK();
     }
@@ -292,7 +300,45 @@ class CommandDisk : public Commander {
   }
 };
 
-class CommandMemory : public CommandDisk {};
+class CommandMemory : public Commander {
+ public:
+  Status Parse(const std::vector<std::string> &args) override {
+    std::string opname = util::ToLower(args[1]);
+    if (opname != "usage") return {Status::RedisInvalidCmd, "Unknown operation"};
+
+    CommandParser parser(args, 3);
+    while (parser.Good()) {
+      if (parser.EatEqICase("samples")) {
+        // unlike Redis, SAMPLES 0 doesn't read all the elements but only takes the approximate sizes
+        samples_ = GET_OR_RET(parser.TakeInt<uint64_t>());
+      } else {
+        return {Status::RedisParseErr, errInvalidSyntax};
+      }
+    }
+    return Commander::Parse(args);
+  }
+
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    redis::Disk disk_db(srv->storage, conn->GetNamespace());
+    engine::Context ctx(srv->storage);
+    uint64_t result = 0;
+    auto s = disk_db.GetKeyMemoryUsage(ctx, args_[2], samples_, &result);
+    if (!s.ok()) {
+      // Redis returns the Nil string when the key does not exist
+      if (s.IsNotFound()) {
+        *output = conn->NilString();
+        return Status::OK();
+      }
+      return {Status::RedisExecErr, s.ToString()};
+    }
+
+    *output = redis::Integer(result);
+    return Status::OK();
+  }
+
+ private:
+  uint64_t samples_ = 0;
+};
 
 class CommandRole : public Commander {
  public:
@@ -317,8 +363,13 @@ class CommandDBSize : public Commander {
       } else {
         return s;
       }
+    } else if (args_.size() == 2 && util::EqualICase(args_[1], "approx")) {
+      // estimated from the table properties of all namespaces, no keys are iterated
+      ApproxKeyNumStats stats;
+      if (auto s = srv->storage->GetApproxKeyNumStats(&stats); !s) return s;
+      *output = redis::Integer(stats.n_key);
     } else {
-      return {Status::RedisExecErr, "DBSIZE subcommand only supports scan"};
+      return {Status::RedisExecErr, "DBSIZE subcommand only supports scan and approx"};
     }
     return Status::OK();
   }
@@ -401,11 +452,130 @@ class CommandSlowlog : public Commander {
   int64_t cnt_ = 10;
 };
 
+class CommandLatency : public Commander {
+ public:
+  Status Parse(const std::vector<std::string> &args) override {
+    subcommand_ = util::ToLower(args[1]);
+    if (subcommand_ != "histogram") {
+      return {Status::NotOK, "LATENCY subcommand must be HISTOGRAM"};
+    }
+
+    for (size_t i = 2; i < args.size(); i++) {
+      names_.emplace_back(util::ToLower(args[i]));
+    }
+    return Status::OK();
+  }
+
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    // Besides commands, the contended lock waits can be queried under these names
+    const std::map<std::string, const LatencyHistogram *> wait_histograms = {
+        {"lock_manager_wait", &srv->stats.lock_wait_histogram},
+        {"work_exclusivity_wait", &srv->stats.exclusivity_wait_histogram},
+    };
+    const auto *commands = CommandTable::GetOriginal();
+    if (names_.empty()) {
+      for (const auto &[name, _] : *commands) names_.emplace_back(name);
+      for (const auto &[name, _] : wait_histograms) names_.emplace_back(name);
+    }
+
+    std::vector<std::pair<std::string, LatencyHistogram::Snapshot>> snapshots;
+    for (const auto &name : names_) {
+      const LatencyHistogram *histogram = nullptr;
+      if (auto iter = commands->find(name); iter != commands->end()) {
+        histogram = &srv->stats.GetCommandLatencyHistogram(iter->second->id);
+      } else if (auto iter = wait_histograms.find(name); iter != wait_histograms.end()) {
+        histogram = iter->second;
+      } else {
+        continue;  // unknown names are ignored, the same as Redis
+      }
+
+      auto snapshot = histogram->GetSnapshot();
+      if (snapshot.count > 0) snapshots.emplace_back(name, snapshot);
+    }
+
+    auto writer = conn->Writer(output);
+    writer.MapHeader(snapshots.size());
+    for (const auto &[name, snapshot] : snapshots) {
+      writer.BulkString(name);
+      writer.MapHeader(2);
+      writer.BulkString("calls");
+      writer.Integer(snapshot.count);
+      writer.BulkString("histogram_usec");
+
+      size_t non_empty_buckets = 0;
+      for (auto count : snapshot.buckets) non_empty_buckets += count > 0;
+      // Like Redis, report the cumulative count up to the upper bound of each bucket
+      writer.MapHeader(non_empty_buckets);
+      uint64_t cumulative = 0;
+      for (size_t i = 0; i < snapshot.buckets.size(); i++) {
+        if (snapshot.buckets[i] == 0) continue;
+        cumulative += snapshot.buckets[i];
+        writer.Integer(LatencyHistogram::BucketUpperBound(i));
+        writer.Integer(cumulative);
+      }
+    }
+    return Status::OK();
+  }
+
+ private:
+  std::string subcommand_;
+  std::vector<std::string> names_;
+};
+
+class CommandHotKeys : public Commander {
+ public:
+  Status Parse(const std::vector<std::string> &args) override {
+    CommandParser parser(args, 1);
+    while (parser.Good()) {
+      if (parser.EatEqICase("count")) {
+        count_ = GET_OR_RET(parser.TakeInt<size_t>(NumericRange<size_t>{1, HotKeys::kTopKeysCapacity}));
+      } else if (parser.EatEqICase("namespace")) {
+        ns_ = GET_OR_RET(parser.TakeStr());
+      } else {
+        return {Status::RedisParseErr, errInvalidSyntax};
+      }
+    }
+    return Status::OK();
+  }
+
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    // users can only see the hot keys of their own namespace
+    if (!conn->IsAdmin()) {
+      if (!ns_.empty() && ns_ != conn->GetNamespace()) {
+        return {Status::RedisExecErr, errAdminPermissionRequired};
+      }
+      ns_ = conn->GetNamespace();
+    }
+
+    // the tracker only sees the sampled accesses, scale them back up
+    uint64_t scale = std::max(srv->GetConfig()->hotkeys_sample_interval, 1);
+    auto entries = srv->stats.hot_keys.GetTop(count_, ns_);
+    auto writer = conn->Writer(output);
+    writer.ArrayHeader(entries.size());
+    for (const auto &entry : entries) {
+      writer.MapHeader(4);
+      writer.BulkString("key");
+      writer.BulkString(entry.key);
+      writer.BulkString("namespace");
+      writer.BulkString(entry.ns);
+      writer.BulkString("reads");
+      writer.Integer(entry.reads * scale);
+      writer.BulkString("writes");
+      writer.Integer(entry.writes * scale);
+    }
+    return Status::OK();
+  }
+
+ private:
+  size_t count_ = 10;
+  std::string ns_;
+};
+
 class CommandClient : public Commander {
  public:
   Status Parse(const std::vector<std::string> &args) override {
     subcommand_ = util::ToLower(args[1]);
-    // subcommand: getname id kill list info setname
+    // subcommand: getname id kill list info setname setinfo top tracking caching getredirect
     if ((subcommand_ == "id" || subcommand_ == "getname" || subcommand_ == "list" || subcommand_ == "info") &&
         args.size() == 2) {
       return Status::OK();
@@ -425,6 +595,95 @@ class CommandClient : public Commander {
       return Status::OK();
     }
 
+    if (subcommand_ == "tracking" && args.size() >= 3) {
+      CommandParser parser(args, 2);
+      if (parser.EatEqICase("on")) {
+        tracking_on_ = true;
+      } else if (parser.EatEqICase("off")) {
+        tracking_on_ = false;
+      } else {
+        return {Status::RedisParseErr, errInvalidSyntax};
+      }
+
+      while (parser.Good()) {
+        if (parser.EatEqICase("redirect")) {
+          tracking_options_.redirect = GET_OR_RET(parser.TakeInt<uint64_t>());
+        } else if (parser.EatEqICase("prefix")) {
+          tracking_options_.prefixes.emplace_back(GET_OR_RET(parser.TakeStr()));
+        } else if (parser.EatEqICase("bcast")) {
+          tracking_options_.bcast = true;
+        } else if (parser.EatEqICase("optin")) {
+          tracking_options_.optin = true;
+        } else if (parser.EatEqICase("optout")) {
+          tracking_options_.optout = true;
+        } else if (parser.EatEqICase("noloop")) {
+          tracking_options_.noloop = true;
+        } else {
+          return {Status::RedisParseErr, errInvalidSyntax};
+        }
+      }
+
+      if (tracking_options_.optin && tracking_options_.optout) {
+        return {Status::RedisParseErr, "You can't use both OPTIN and OPTOUT"};
+      }
+      if (tracking_options_.bcast && (tracking_options_.optin || tracking_options_.optout)) {
+        return {Status::RedisParseErr, "OPTIN and OPTOUT are not compatible with BCAST"};
+      }
+      if (!tracking_options_.bcast && !tracking_options_.prefixes.empty()) {
+        return {Status::RedisParseErr, "PREFIX option requires BCAST mode to be enabled"};
+      }
+      return Status::OK();
+    }
+
+    if (subcommand_ == "caching" && args.size() == 3) {
+      if (util::EqualICase(args[2], "yes")) {
+        caching_ = true;
+      } else if (util::EqualICase(args[2], "no")) {
+        caching_ = false;
+      } else {
+        return {Status::RedisParseErr, errInvalidSyntax};
+      }
+      return Status::OK();
+    }
+
+    if (subcommand_ == "getredirect" && args.size() == 2) {
+      return Status::OK();
+    }
+
+    if (subcommand_ == "top" && args.size() >= 3) {
+      CommandParser parser(args, 2);
+      auto resource = util::ToLower(GET_OR_RET(parser.TakeStr()));
+      if (resource == "cmds") {
+        resource_ = Connection::kResourceCommands;
+      } else if (resource == "cpu") {
+        resource_ = Connection::kResourceCPU;
+      } else if (resource == "read-bytes") {
+        resource_ = Connection::kResourceReadBytes;
+      } else if (resource == "net-in") {
+        resource_ = Connection::kResourceNetIn;
+      } else if (resource == "net-out") {
+        resource_ = Connection::kResourceNetOut;
+      } else if (resource == "obuf") {
+        resource_ = Connection::kResourceOutput;
+      } else {
+        return {Status::RedisParseErr, "the resource should be one of CMDS, CPU, READ-BYTES, NET-IN, NET-OUT and OBUF"};
+      }
+      if (parser.EatEqICase("count")) {
+        top_count_ = GET_OR_RET(parser.TakeInt<size_t>(NumericRange<size_t>{1, SIZE_MAX}));
+      }
+      if (parser.Good()) return {Status::RedisParseErr, errInvalidSyntax};
+      return Status::OK();
+    }
+
+    if (subcommand_ == "setinfo" && args.size() == 4) {
+      if (!util::EqualICase(args[2], "traceparent")) {
+        return {Status::RedisParseErr, fmt::format("Unrecognized option '{}'", args[2])};
+      }
+      // an empty traceparent clears the trace context
+      if (!args[3].empty()) trace_context_ = GET_OR_RET(TraceContext::Parse(args[3]));
+      return Status::OK();
+    }
+
     if ((subcommand_ == "kill")) {
       if (args.size() == 2) {
         return {Status::RedisParseErr, errInvalidSyntax};
@@ -477,7 +736,8 @@ class CommandClient : public Commander {
       }
       return Status::OK();
     }
-    return {Status::RedisInvalidCmd, "Syntax error, try CLIENT LIST|INFO|KILL ip:port|GETNAME|SETNAME"};
+    return {Status::RedisInvalidCmd,
+            "Syntax error, try CLIENT LIST|INFO|KILL ip:port|GETNAME|SETNAME|SETINFO|TOP|TRACKING|CACHING|GETREDIRECT"};
   }
 
   Status Execute(Server *srv, Connection *conn, std::string *output) override {
@@ -498,6 +758,35 @@ class CommandClient : public Commander {
     } else if (subcommand_ == "id") {
       *output = redis::Integer(conn->GetID());
       return Status::OK();
+    } else if (subcommand_ == "tracking") {
+      if (tracking_on_) {
+        GET_OR_RET(srv->EnableTracking(conn, tracking_options_));
+      } else {
+        srv->DisableTracking(conn);
+      }
+      *output = redis::SimpleString("OK");
+      return Status::OK();
+    } else if (subcommand_ == "caching") {
+      // CLIENT CACHING YES is only meaningful in the OPTIN mode, and NO in the OPTOUT mode
+      if (!conn->tracking || (caching_ && !conn->tracking->optin) || (!caching_ && !conn->tracking->optout)) {
+        return {Status::RedisExecErr,
+                "CLIENT CACHING YES is only valid when tracking is enabled in OPTIN mode, "
+                "and CLIENT CACHING NO in OPTOUT mode"};
+      }
+      conn->tracking_caching = caching_;
+      *output = redis::SimpleString("OK");
+      return Status::OK();
+    } else if (subcommand_ == "top") {
+      *output = conn->VerbatimString("txt", srv->GetTopClientsStr(resource_, top_count_));
+      return Status::OK();
+    } else if (subcommand_ == "setinfo") {
+      conn->trace_context = trace_context_;
+      *output = redis::SimpleString("OK");
+      return Status::OK();
+    } else if (subcommand_ == "getredirect") {
+      int64_t redirect = conn->tracking ? static_cast<int64_t>(conn->tracking->redirect) : -1;
+      *output = redis::Integer(redirect);
+      return Status::OK();
     } else if (subcommand_ == "kill") {
       int64_t killed = 0;
       srv->KillClient(&killed, addr_, id_, kill_type_, skipme_, conn);
@@ -523,6 +812,12 @@ class CommandClient : public Commander {
   int64_t kill_type_ = 0;
   uint64_t id_ = 0;
   bool new_format_ = true;
+  bool tracking_on_ = false;
+  TrackingOptions tracking_options_;
+  bool caching_ = false;
+  std::optional<TraceContext> trace_context_;
+  Connection::Resource resource_ = Connection::kResourceCommands;
+  size_t top_count_ = 10;
 };
 
 class CommandMonitor : public Commander {
@@ -842,7 +1137,13 @@ class CommandScan : public CommandScanBase {
     std::vector<std::string> keys;
     std::string end_key;
     engine::Context ctx(srv->storage);
-    auto s = redis_db.Scan(ctx, key_name, limit_, prefix_, &keys, &end_key, type_);
+    rocksdb::Status s;
+    if (parallel_ > 1) {
+      s = redis_db.ParallelScan(ctx, key_name, limit_, prefix_, parallel_, &keys, &end_key, type_, pattern_);
+    } else {
+      auto time_budget_us = static_cast<uint64_t>(srv->GetConfig()->scan_time_budget_ms) * 1000;
+      s = redis_db.Scan(ctx, key_name, limit_, prefix_, &keys, &end_key, type_, pattern_, time_budget_us);
+    }
     if (!s.ok()) {
       return {Status::RedisExecErr, s.ToString()};
     }
@@ -870,6 +1171,24 @@ class CommandRandomKey : public Commander {
 
 class CommandCompact : public Commander {
  public:
+  // COMPACT [CF <column family>], compacting one column family rewrites all of its SST files,
+  // e.g. to build the compression dictionaries after rocksdb.compression_max_dict_bytes is set
+  Status Parse(const std::vector<std::string> &args) override {
+    CommandParser parser(args, 1);
+    while (parser.Good()) {
+      if (parser.EatEqICase("cf")) {
+        auto name = GET_OR_RET(parser.TakeStr());
+        const auto &cfs = engine::ColumnFamilyConfigs::ListAllColumnFamilies();
+        auto iter = std::find_if(cfs.begin(), cfs.end(), [&name](const auto &cf) { return cf.Name() == name; });
+        if (iter == cfs.end()) return {Status::RedisParseErr, "unknown column family " + name};
+        cf_id_ = iter->Id();
+      } else {
+        return {Status::RedisParseErr, errInvalidSyntax};
+      }
+    }
+    return Status::OK();
+  }
+
   Status Execute(Server *srv, Connection *conn, std::string *output) override {
     std::string begin_key, end_key;
     auto ns = conn->GetNamespace();
@@ -878,13 +1197,17 @@ class CommandCompact : public Commander {
       end_key = util::StringNext(begin_key);
     }
 
-    Status s = srv->AsyncCompactDB(begin_key, end_key);
+    auto cf = cf_id_ ? srv->storage->GetCFHandle(*cf_id_) : nullptr;
+    Status s = srv->AsyncCompactDB(begin_key, end_key, cf);
     if (!s.IsOK()) return s;
 
     *output = redis::SimpleString("OK");
     LOG(INFO) << "Compact was triggered by manual with executed success";
     return Status::OK();
   }
+
+ private:
+  std::optional<ColumnFamilyID> cf_id_;
 };
 
 class CommandBGSave : public Commander {
@@ -965,6 +1288,10 @@ class CommandSlaveOf : public Commander {
       return {Status::RedisExecErr, "slaveof doesn't work with disable_wal option"};
     }
 
+    if (srv->storage->IsSecondary()) {
+      return {Status::RedisExecErr, "slaveof doesn't work on a secondary instance"};
+    }
+
     if (!conn->IsAdmin()) {
       return {Status::RedisExecErr, errAdminPermissionRequired};
     }
@@ -1097,6 +1424,13 @@ class CommandRestore : public Commander {
       ttl_ms_ -= now;
     }
 
+    if (redis::Database::IsNativeDump(args_[3])) {
+      db_status = redis.RestoreNative(ctx, args_[1], args_[3], ttl_ms_);
+      if (!db_status.ok()) return {Status::RedisExecErr, db_status.ToString()};
+      *output = redis::SimpleString("OK");
+      return Status::OK();
+    }
+
     auto stream_ptr = std::make_unique<RdbStringStream>(args_[3]);
     RDB rdb(srv->storage, conn->GetNamespace(), std::move(stream_ptr));
     auto s = rdb.Restore(ctx, args_[1], args_[3], ttl_ms_);
@@ -1111,13 +1445,234 @@ class CommandRestore : public Commander {
   uint64_t ttl_ms_ = 0;
 };
 
+// command format: bigkeys start [TOPN n]
+//                 bigkeys stop
+//                 bigkeys reset
+//                 bigkeys result
+class CommandBigKeys : public Commander {
+ public:
+  Status Parse(const std::vector<std::string> &args) override {
+    CommandParser parser(args, 1);
+    subcommand_ = util::ToLower(GET_OR_RET(parser.TakeStr()));
+    if (subcommand_ == "start") {
+      while (parser.Good()) {
+        if (parser.EatEqICase("topn")) {
+          top_n_ = GET_OR_RET(parser.TakeInt<size_t>(NumericRange<size_t>{1, 1000}));
+        } else {
+          return {Status::RedisParseErr, errInvalidSyntax};
+        }
+      }
+      return Status::OK();
+    }
+    if (subcommand_ != "stop" && subcommand_ != "reset" && subcommand_ != "result") {
+      return {Status::RedisParseErr, "unknown subcommand"};
+    }
+    if (parser.Good()) return {Status::RedisParseErr, errInvalidSyntax};
+    return Status::OK();
+  }
+
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    // The results of the namespace are readable by its users, but the analysis covers all the namespaces
+    if (subcommand_ == "result") {
+      auto type_top_keys = srv->GetBigKeys(conn->GetNamespace());
+      auto big_keys_reply = [](const std::vector<BigKeyAnalyzer::BigKey> &keys) {
+        std::string reply = redis::MultiLen(keys.size());
+        for (const auto &key : keys) {
+          reply += redis::MultiLen(3);
+          reply += redis::BulkString(key.key);
+          reply += redis::Integer(key.elements);
+          reply += redis::Integer(key.bytes);
+        }
+        return reply;
+      };
+      *output = redis::MultiLen(type_top_keys.size());
+      for (const auto &[type, top_keys] : type_top_keys) {
+        *output += redis::MultiLen(5);
+        *output += redis::BulkString(RedisTypeNames[type]);
+        *output += redis::BulkString("by_elements");
+        *output += big_keys_reply(top_keys.by_elements);
+        *output += redis::BulkString("by_bytes");
+        *output += big_keys_reply(top_keys.by_bytes);
+      }
+      return Status::OK();
+    }
+
+    if (!conn->IsAdmin()) {
+      return {Status::RedisExecErr, errAdminPermissionRequired};
+    }
+    if (subcommand_ == "start") {
+      GET_OR_RET(srv->AsyncAnalyzeBigKeys(top_n_));
+    } else if (subcommand_ == "stop") {
+      srv->StopBigKeysAnalysis();
+    } else {
+      GET_OR_RET(srv->ResetBigKeys());
+    }
+    *output = redis::SimpleString("OK");
+    return Status::OK();
+  }
+
+ private:
+  std::string subcommand_;
+  size_t top_n_ = BigKeyAnalyzer::kDefaultTopKeys;
+};
+
+// command format: capture start <path> [SAMPLE ratio] [ANONYMIZE KEYS|VALUES|ALL] [MAXBYTES bytes]
+//                 capture stop
+//                 capture status
+class CommandCapture : public Commander {
+ public:
+  Status Parse(const std::vector<std::string> &args) override {
+    CommandParser parser(args, 1);
+    subcommand_ = util::ToLower(GET_OR_RET(parser.TakeStr()));
+    if (subcommand_ == "start") {
+      options_.path = GET_OR_RET(parser.TakeStr());
+      while (parser.Good()) {
+        if (parser.EatEqICase("sample")) {
+          options_.sample_ratio = GET_OR_RET(parser.TakeFloat());
+          if (options_.sample_ratio <= 0 || options_.sample_ratio > 1) {
+            return {Status::RedisParseErr, "the sample ratio should be in (0, 1]"};
+          }
+        } else if (parser.EatEqICase("anonymize")) {
+          if (parser.EatEqICase("keys")) {
+            options_.anonymize_keys = true;
+          } else if (parser.EatEqICase("values")) {
+            options_.anonymize_values = true;
+          } else if (parser.EatEqICase("all")) {
+            options_.anonymize_keys = true;
+            options_.anonymize_values = true;
+          } else {
+            return {Status::RedisParseErr, errInvalidSyntax};
+          }
+        } else if (parser.EatEqICase("maxbytes")) {
+          options_.max_bytes = GET_OR_RET(parser.TakeInt<uint64_t>(NumericRange<uint64_t>{1, UINT64_MAX}));
+        } else {
+          return {Status::RedisParseErr, errInvalidSyntax};
+        }
+      }
+      return Status::OK();
+    }
+    if (subcommand_ != "stop" && subcommand_ != "status") {
+      return {Status::RedisParseErr, "unknown subcommand"};
+    }
+    if (parser.Good()) return {Status::RedisParseErr, errInvalidSyntax};
+    return Status::OK();
+  }
+
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    if (!conn->IsAdmin()) {
+      return {Status::RedisExecErr, errAdminPermissionRequired};
+    }
+
+    // The commands of the sampled connections are written in the background, see TrafficCapture
+    auto capture = srv->GetTrafficCapture();
+    if (subcommand_ == "start") {
+      GET_OR_RET(capture->Start(options_));
+    } else if (subcommand_ == "stop") {
+      capture->Stop();
+    } else {
+      *output = conn->HeaderOfMap(5);
+      *output += redis::BulkString("running");
+      *output += redis::Integer(capture->IsRunning() ? 1 : 0);
+      *output += redis::BulkString("path");
+      *output += redis::BulkString(capture->GetPath());
+      *output += redis::BulkString("captured_commands");
+      *output += redis::Integer(capture->GetCapturedCommands());
+      *output += redis::BulkString("dropped_commands");
+      *output += redis::Integer(capture->GetDroppedCommands());
+      *output += redis::BulkString("written_bytes");
+      *output += redis::Integer(capture->GetWrittenBytes());
+      return Status::OK();
+    }
+    *output = redis::SimpleString("OK");
+    return Status::OK();
+  }
+
+ private:
+  std::string subcommand_;
+  TrafficCapture::Options options_;
+};
+
+// command format: profile cpu start [seconds] [hz]
+//                 profile cpu stop | dump | status
+//                 profile heap dump [path]
+class CommandProfile : public Commander {
+ public:
+  Status Parse(const std::vector<std::string> &args) override {
+    CommandParser parser(args, 1);
+    if (parser.EatEqICase("heap")) {
+      if (!parser.EatEqICase("dump")) return {Status::RedisParseErr, "unknown subcommand"};
+      heap_ = true;
+      if (parser.Good()) path_ = GET_OR_RET(parser.TakeStr());
+    } else if (parser.EatEqICase("cpu")) {
+      subcommand_ = util::ToLower(GET_OR_RET(parser.TakeStr()));
+      if (subcommand_ == "start") {
+        if (parser.Good()) seconds_ = GET_OR_RET(parser.TakeInt<int>(NumericRange<int>{1, 3600}));
+        if (parser.Good()) hz_ = GET_OR_RET(parser.TakeInt<int>(NumericRange<int>{1, 1000}));
+      } else if (subcommand_ != "stop" && subcommand_ != "dump" && subcommand_ != "status") {
+        return {Status::RedisParseErr, "unknown subcommand"};
+      }
+    } else {
+      return {Status::RedisParseErr, "unknown subcommand"};
+    }
+    if (parser.Good()) return {Status::RedisParseErr, errInvalidSyntax};
+    return Status::OK();
+  }
+
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    if (!conn->IsAdmin()) {
+      return {Status::RedisExecErr, errAdminPermissionRequired};
+    }
+
+    if (heap_) {
+      GET_OR_RET(util::DumpHeapProfile(path_));
+      *output = redis::SimpleString("OK");
+      return Status::OK();
+    }
+
+    auto profiler = srv->GetCpuProfiler();
+    if (subcommand_ == "start") {
+      GET_OR_RET(profiler->Start(seconds_, hz_));
+    } else if (subcommand_ == "stop") {
+      profiler->Stop();
+    } else if (subcommand_ == "dump") {
+      // the stacks in the collapsed format, which is read by flamegraph.pl
+      *output = redis::BulkString(profiler->Dump());
+      return Status::OK();
+    } else {
+      *output = conn->HeaderOfMap(3);
+      *output += redis::BulkString("running");
+      *output += redis::Integer(profiler->IsRunning() ? 1 : 0);
+      *output += redis::BulkString("samples");
+      *output += redis::Integer(profiler->GetSamples());
+      *output += redis::BulkString("dropped_samples");
+      *output += redis::Integer(profiler->GetDroppedSamples());
+      return Status::OK();
+    }
+    *output = redis::SimpleString("OK");
+    return Status::OK();
+  }
+
+ private:
+  bool heap_ = false;
+  std::string path_;
+  std::string subcommand_;
+  int seconds_ = 30;
+  int hz_ = 99;
+};
+
 // command format: rdb load <path> [NX]  [DB index]
+//                 rdb save <path>
 class CommandRdb : public Commander {
  public:
   Status Parse(const std::vector<std::string> &args) override {
     CommandParser parser(args, 1);
 
     type_ = GET_OR_RET(parser.TakeStr());
+    if (util::EqualICase(type_, "save")) {
+      path_ = GET_OR_RET(parser.TakeStr());
+      if (parser.Good()) return {Status::RedisParseErr, errInvalidSyntax};
+      return Status::OK();
+    }
     if (!util::EqualICase(type_, "load")) {
       return {Status::RedisParseErr, "unknown subcommand"};
     }
@@ -1141,6 +1696,13 @@ class CommandRdb : public Commander {
       return {Status::RedisExecErr, errAdminPermissionRequired};
     }
 
+    // The keys are exported from a snapshot in the background, see RdbExporter
+    if (util::EqualICase(type_, "save")) {
+      GET_OR_RET(srv->AsyncExportRdb(conn->GetNamespace(), path_));
+      *output = redis::SimpleString("Background RDB export started");
+      return Status::OK();
+    }
+
     redis::Database redis(srv->storage, conn->GetNamespace());
     engine::Context ctx(srv->storage);
 
@@ -1148,7 +1710,8 @@ class CommandRdb : public Commander {
     GET_OR_RET(stream_ptr->Open());
 
     RDB rdb(srv->storage, conn->GetNamespace(), std::move(stream_ptr));
-    GET_OR_RET(rdb.LoadRdb(ctx, db_index_, overwrite_exist_key_));
+    // The command is exclusive, so no replica can connect while the objects are written without the WAL
+    GET_OR_RET(rdb.LoadRdb(ctx, db_index_, overwrite_exist_key_, !srv->HasSlaves()));
 
     *output = redis::SimpleString("OK");
     return Status::OK();
@@ -1210,12 +1773,16 @@ class CommandApplyBatch : public Commander {
     return Commander::Parse(args);
   }
 
-  Status Execute(Server *svr, [[maybe_unused]] Connection *conn, std::string *output) override {
+  Status Execute(Server *svr, Connection *conn, std::string *output) override {
     size_t size = raw_batch_.size();
     auto options = svr->storage->DefaultWriteOptions();
     options.low_pri = low_pri_;
+    // The imported batches yield to the foreground writes. They keep the WAL, which the replicas and the other
+    // consumers of the WAL read without gaps in its sequence numbers.
+    if (conn->IsImporting()) options.low_pri = true;
     auto s = svr->storage->ApplyWriteBatch(options, std::move(raw_batch_));
     if (!s.IsOK()) return s;
+    if (conn->IsImporting()) svr->stats.IncrImportBytes(size);
 
     *output = redis::Integer(size);
     return Status::OK();
@@ -1226,12 +1793,52 @@ class CommandApplyBatch : public Commander {
   bool low_pri_ = false;
 };
 
+class CommandApplySST : public Commander {
+ public:
+  Status Parse(const std::vector<std::string> &args) override {
+    cf_name_ = args[1];
+    sst_ = args[2];
+    return Commander::Parse(args);
+  }
+
+  Status Execute(Server *svr, Connection *conn, std::string *output) override {
+    static std::atomic<uint64_t> file_id = 0;
+    auto path = fmt::format("{}/applysst-{}.sst", svr->GetConfig()->dir, file_id.fetch_add(1));
+    std::ofstream file(path, std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!file.good()) return {Status::NotOK, "failed to open " + path};
+    file.write(sst_.data(), static_cast<std::streamsize>(sst_.size()));
+    file.close();
+    if (!file.good()) {
+      std::remove(path.c_str());
+      return {Status::NotOK, "failed to write " + path};
+    }
+
+    auto s = svr->ApplySSTFile(cf_name_, path);
+    // The file is left behind if it isn't moved into the db
+    std::remove(path.c_str());
+    if (!s.IsOK()) return s;
+    if (conn->IsImporting()) svr->stats.IncrImportBytes(sst_.size());
+
+    *output = redis::Integer(sst_.size());
+    return Status::OK();
+  }
+
+ private:
+  std::string cf_name_;
+  std::string sst_;
+};
+
+// command format: dump <key> [NATIVE]
 class CommandDump : public Commander {
  public:
   Status Parse(const std::vector<std::string> &args) override {
-    if (args.size() != 2) {
+    if (args.size() != 2 && args.size() != 3) {
       return {Status::RedisExecErr, errWrongNumOfArguments};
     }
+    if (args.size() == 3) {
+      if (!util::EqualICase(args[2], "native")) return {Status::RedisParseErr, errInvalidSyntax};
+      native_ = true;
+    }
     return Status::OK();
   }
 
@@ -1254,6 +1861,15 @@ class CommandDump : public Commander {
       return Status::OK();
     }
 
+    // The native payload ships the raw entries, which only a kvrocks RESTORE understands
+    if (native_) {
+      std::string payload;
+      db_status = redis.DumpNative(ctx, key, &payload);
+      if (!db_status.ok()) return {Status::RedisExecErr, db_status.ToString()};
+      *output = redis::BulkString(payload);
+      return Status::OK();
+    }
+
     RedisType type = kRedisNone;
     db_status = redis.Type(ctx, key, &type);
     if (!db_status.ok()) return {Status::RedisExecErr, db_status.ToString()};
@@ -1267,6 +1883,9 @@ class CommandDump : public Commander {
     *output = redis::BulkString(static_cast<RdbStringStream *>(rdb.GetStream().get())->GetInput());
     return Status::OK();
   }
+
+ private:
+  bool native_ = false;
 };
 
 class CommandPollUpdates : public Commander {
@@ -1331,11 +1950,13 @@ REDIS_REGISTER_COMMANDS(Server, MakeCmdAttr<CommandAuth>("auth", 2, "read-only o
                         MakeCmdAttr<CommandRole>("role", 1, "read-only ok-loading", 0, 0, 0),
                         MakeCmdAttr<CommandConfig>("config", -2, "read-only", 0, 0, 0, GenerateConfigFlag),
                         MakeCmdAttr<CommandNamespace>("namespace", -3, "read-only", 0, 0, 0),
-                        MakeCmdAttr<CommandKeys>("keys", 2, "read-only slow", 0, 0, 0),
+                        MakeCmdAttr<CommandKeys>("keys", 2, "read-only slow heavy", 0, 0, 0),
                         MakeCmdAttr<CommandFlushDB>("flushdb", 1, "write no-dbsize-check", 0, 0, 0),
                         MakeCmdAttr<CommandFlushAll>("flushall", 1, "write no-dbsize-check", 0, 0, 0),
                         MakeCmdAttr<CommandDBSize>("dbsize", -1, "read-only", 0, 0, 0),
                         MakeCmdAttr<CommandSlowlog>("slowlog", -2, "read-only", 0, 0, 0),
+                        MakeCmdAttr<CommandLatency>("latency", -2, "read-only", 0, 0, 0),
+                        MakeCmdAttr<CommandHotKeys>("hotkeys", -1, "read-only", 0, 0, 0),
                         MakeCmdAttr<CommandPerfLog>("perflog", -2, "read-only", 0, 0, 0),
                         MakeCmdAttr<CommandClient>("client", -2, "read-only", 0, 0, 0),
                         MakeCmdAttr<CommandMonitor>("monitor", 1, "read-only no-multi", 0, 0, 0),
@@ -1348,19 +1969,23 @@ REDIS_REGISTER_COMMANDS(Server, MakeCmdAttr<CommandAuth>("auth", 2, "read-only o
                         MakeCmdAttr<CommandEcho>("echo", 2, "read-only", 0, 0, 0),
                         MakeCmdAttr<CommandTime>("time", 1, "read-only ok-loading", 0, 0, 0),
                         MakeCmdAttr<CommandDisk>("disk", 3, "read-only", 0, 0, 0),
-                        MakeCmdAttr<CommandMemory>("memory", 3, "read-only", 0, 0, 0),
+                        MakeCmdAttr<CommandMemory>("memory", -3, "read-only", 0, 0, 0),
                         MakeCmdAttr<CommandHello>("hello", -1, "read-only ok-loading", 0, 0, 0),
                         MakeCmdAttr<CommandRestore>("restore", -4, "write", 1, 1, 1),
 
-                        MakeCmdAttr<CommandCompact>("compact", 1, "read-only no-script", 0, 0, 0),
+                        MakeCmdAttr<CommandCompact>("compact", -1, "read-only no-script", 0, 0, 0),
                         MakeCmdAttr<CommandBGSave>("bgsave", 1, "read-only no-script", 0, 0, 0),
                         MakeCmdAttr<CommandLastSave>("lastsave", 1, "read-only", 0, 0, 0),
                         MakeCmdAttr<CommandFlushBackup>("flushbackup", 1, "read-only no-script", 0, 0, 0),
                         MakeCmdAttr<CommandSlaveOf>("slaveof", 3, "read-only exclusive no-script", 0, 0, 0),
                         MakeCmdAttr<CommandStats>("stats", 1, "read-only", 0, 0, 0),
                         MakeCmdAttr<CommandRdb>("rdb", -3, "write exclusive", 0, 0, 0),
+                        MakeCmdAttr<CommandBigKeys>("bigkeys", -2, "read-only", 0, 0, 0),
+                        MakeCmdAttr<CommandCapture>("capture", -2, "read-only", 0, 0, 0),
+                        MakeCmdAttr<CommandProfile>("profile", -3, "read-only", 0, 0, 0),
                         MakeCmdAttr<CommandReset>("reset", 1, "ok-loading multi no-script pub-sub", 0, 0, 0),
                         MakeCmdAttr<CommandApplyBatch>("applybatch", -2, "write no-multi", 0, 0, 0),
-                        MakeCmdAttr<CommandDump>("dump", 2, "read-only", 0, 0, 0),
+                        MakeCmdAttr<CommandApplySST>("applysst", 3, "write no-multi", 0, 0, 0),
+                        MakeCmdAttr<CommandDump>("dump", -2, "read-only", 0, 0, 0),
                         MakeCmdAttr<CommandPollUpdates>("pollupdates", -2, "read-only", 0, 0, 0), )
 }  // namespace redis
@@ -18,10 +18,12 @@
  *
  */
 
+#include <algorithm>
 #include <cstdint>
 
 #include "commander.h"
 #include "commands/scan_base.h"
+#include "commands/streaming_commander.h"
 #include "error_constants.h"
 #include "server/server.h"
 #include "types/redis_set.h"
@@ -86,13 +88,25 @@ class CommandSCard : public Commander {
   }
 };
 
-class CommandSMembers : public Commander {
+class CommandSMembers : public StreamingCommander {
  public:
   Status Execute(Server *srv, Connection *conn, std::string *output) override {
     redis::Set set_db(srv->storage, conn->GetNamespace());
+    ctx_ = std::make_unique<engine::Context>(srv->storage);
+    uint64_t size = 0;
+    auto s = set_db.Card(*ctx_, args_[1], &size);
+    if (!s.ok()) {
+      return {Status::RedisExecErr, s.ToString()};
+    }
+    if (ShouldStream(srv, conn, size)) {
+      ns_ = conn->GetNamespace();
+      left_ = size;
+      *output = conn->HeaderOfSet(size);
+      return StartStreaming(conn);
+    }
+
     std::vector<std::string> members;
-    engine::Context ctx(srv->storage);
-    auto s = set_db.Members(ctx, args_[1], &members);
+    s = set_db.Members(*ctx_, args_[1], &members);
     if (!s.ok()) {
       return {Status::RedisExecErr, s.ToString()};
     }
@@ -100,6 +114,28 @@ class CommandSMembers : public Commander {
     *output = conn->SetOfBulkStrings(members);
     return Status::OK();
   }
+
+  StatusOr<bool> OnStreamingWrite(std::string *output) override {
+    redis::Set set_db(ctx_->storage, ns_);
+    std::vector<std::string> members;
+    auto s = set_db.Scan(*ctx_, args_[1], cursor_, std::min<uint64_t>(left_, kBatchSize), "", &members);
+    if (!s.ok()) return {Status::RedisExecErr, s.ToString()};
+    // The members are counted in the header, so the snapshot must have as many of them
+    if (members.empty()) return {Status::NotOK, "the set has less members than its size"};
+
+    auto writer = conn_->Writer(output);
+    for (const auto &member : members) {
+      writer.BulkString(member);
+    }
+    cursor_ = std::move(members.back());
+    left_ -= members.size();
+    return left_ == 0;
+  }
+
+ private:
+  std::string ns_;
+  std::string cursor_;
+  uint64_t left_ = 0;
 };
 
 class CommandSIsMember : public Commander {
@@ -444,12 +480,14 @@ class CommandSScan : public CommandSubkeyScanBase {
     std::vector<std::string> members;
     auto key_name = srv->GetKeyNameFromCursor(cursor_, CursorType::kTypeSet);
     engine::Context ctx(srv->storage);
-    auto s = set_db.Scan(ctx, key_, key_name, limit_, prefix_, &members);
+    std::string end_cursor;
+    auto s = set_db.Scan(ctx, key_, key_name, limit_, prefix_, &members, pattern_, TimeBudgetUS(srv), &end_cursor);
     if (!s.ok() && !s.IsNotFound()) {
       return {Status::RedisExecErr, s.ToString()};
     }
 
-    *output = CommandScanBase::GenerateOutput(srv, conn, members, CursorType::kTypeSet);
+    auto cursor = GetNextCursor(srv, end_cursor, CursorType::kTypeSet);
+    *output = redis::Array({redis::BulkString(cursor), ArrayOfBulkStrings(members)});
     return Status::OK();
   }
 };
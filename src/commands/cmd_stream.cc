@@ -71,30 +71,73 @@ class CommandXAck : public Commander {
 class CommandXAdd : public Commander {
  public:
   Status Parse(const std::vector<std::string> &args) override {
-    bool entry_id_found = false;
     stream_name_ = args[1];
+    size_t i = 2;
+    if (auto s = parseAddOptions(args, &i); !s.IsOK()) return s;
+    if (i >= args.size()) {
+      return {Status::RedisParseErr, errWrongNumOfArguments};
+    }
+
+    next_id_strategy_ = GET_OR_RET(ParseNextStreamEntryIDStrategy(util::ToLower(args[i])));
+    name_value_pairs_.assign(args.begin() + static_cast<std::ptrdiff_t>(i) + 1, args.end());
+
+    if (name_value_pairs_.empty() || name_value_pairs_.size() % 2 != 0) {
+      return {Status::RedisParseErr, errWrongNumOfArguments};
+    }
+
+    return Status::OK();
+  }
 
-    for (size_t i = 2; i < args.size();) {
-      auto val = entry_id_found ? args[i] : util::ToLower(args[i]);
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    auto options = makeAddOptions();
+    options.next_id_strategy = std::move(next_id_strategy_);
 
-      if (val == "nomkstream" && !entry_id_found) {
+    redis::Stream stream_db(srv->storage, conn->GetNamespace());
+    StreamEntryID entry_id;
+    engine::Context ctx(srv->storage);
+    auto s = stream_db.Add(ctx, stream_name_, options, name_value_pairs_, &entry_id);
+    if (!s.ok() && !s.IsNotFound()) {
+      return {Status::RedisExecErr, s.ToString()};
+    }
+
+    if (s.IsNotFound() && nomkstream_) {
+      *output = conn->NilString();
+      return Status::OK();
+    }
+
+    *output = redis::BulkString(entry_id.ToString());
+
+    srv->OnEntryAddedToStream(conn->GetNamespace(), stream_name_, entry_id);
+
+    return Status::OK();
+  }
+
+ protected:
+  // parseAddOptions parses NOMKSTREAM and the trimming options from args[*i], until the first argument
+  // which isn't an option, and moves *i to it
+  Status parseAddOptions(const std::vector<std::string> &args, size_t *i) {
+    while (*i < args.size()) {
+      auto val = util::ToLower(args[*i]);
+
+      if (val == "nomkstream") {
         nomkstream_ = true;
-        ++i;
+        ++*i;
         continue;
       }
 
-      if (val == "maxlen" && !entry_id_found) {
-        if (i + 1 >= args.size()) {
+      if (val == "maxlen") {
+        if (*i + 1 >= args.size()) {
           return {Status::RedisParseErr, errInvalidSyntax};
         }
 
         size_t max_len_idx = 0;
         bool eq_sign_found = false;
-        if (args[i + 1] == "=") {
-          max_len_idx = i + 2;
+        if (args[*i + 1] == "=" || args[*i + 1] == "~") {
+          max_len_idx = *i + 2;
           eq_sign_found = true;
+          approximate_ = args[*i + 1] == "~";
         } else {
-          max_len_idx = i + 1;
+          max_len_idx = *i + 1;
         }
 
         if (max_len_idx >= args.size()) {
@@ -109,22 +152,23 @@ class CommandXAdd : public Commander {
         max_len_ = *parse_result;
         with_max_len_ = true;
 
-        i += eq_sign_found ? 3 : 2;
+        *i += eq_sign_found ? 3 : 2;
         continue;
       }
 
-      if (val == "minid" && !entry_id_found) {
-        if (i + 1 >= args.size()) {
+      if (val == "minid") {
+        if (*i + 1 >= args.size()) {
           return {Status::RedisParseErr, errInvalidSyntax};
         }
 
         size_t min_id_idx = 0;
         bool eq_sign_found = false;
-        if (args[i + 1] == "=") {
-          min_id_idx = i + 2;
+        if (args[*i + 1] == "=" || args[*i + 1] == "~") {
+          min_id_idx = *i + 2;
           eq_sign_found = true;
+          approximate_ = args[*i + 1] == "~";
         } else {
-          min_id_idx = i + 1;
+          min_id_idx = *i + 1;
         }
 
         if (min_id_idx >= args.size()) {
@@ -135,37 +179,36 @@ class CommandXAdd : public Commander {
         if (!s.IsOK()) return s;
 
         with_min_id_ = true;
-        i += eq_sign_found ? 3 : 2;
+        *i += eq_sign_found ? 3 : 2;
         continue;
       }
 
-      if (val == "limit" && !entry_id_found) {
-        return {Status::RedisParseErr, errLimitOptionNotAllowed};
-      }
-
-      if (!entry_id_found) {
-        auto result = ParseNextStreamEntryIDStrategy(val);
-        if (!result.IsOK()) return result;
+      if (val == "limit") {
+        if (!approximate_) {
+          return {Status::RedisParseErr, errLimitOptionNotAllowed};
+        }
+        if (*i + 1 >= args.size()) {
+          return {Status::RedisParseErr, errInvalidSyntax};
+        }
 
-        next_id_strategy_ = std::move(*result);
+        auto parse_result = ParseInt<uint64_t>(args[*i + 1], 10);
+        if (!parse_result) {
+          return {Status::RedisParseErr, errValueNotInteger};
+        }
 
-        entry_id_found = true;
-        ++i;
+        limit_ = *parse_result;
+        *i += 2;
         continue;
       }
 
-      name_value_pairs_.push_back(val);
-      ++i;
-    }
-
-    if (name_value_pairs_.empty() || name_value_pairs_.size() % 2 != 0) {
-      return {Status::RedisParseErr, errWrongNumOfArguments};
+      break;
     }
 
     return Status::OK();
   }
 
-  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+  // makeAddOptions returns the options parsed by parseAddOptions, without the strategy of the next ID
+  redis::StreamAddOptions makeAddOptions() const {
     redis::StreamAddOptions options;
     options.nomkstream = nomkstream_;
     if (with_max_len_) {
@@ -176,37 +219,88 @@ class CommandXAdd : public Commander {
       options.trim_options.strategy = StreamTrimStrategy::MinID;
       options.trim_options.min_id = min_id_;
     }
-    options.next_id_strategy = std::move(next_id_strategy_);
+    options.trim_options.approximate = approximate_;
+    if (limit_) options.trim_options.limit = *limit_;
+    return options;
+  }
+
+  std::string stream_name_;
+  uint64_t max_len_ = 0;
+  redis::StreamEntryID min_id_;
+  std::unique_ptr<redis::NextStreamEntryIDGenerationStrategy> next_id_strategy_;
+  std::vector<std::string> name_value_pairs_;
+  bool nomkstream_ = false;
+  bool with_max_len_ = false;
+  bool with_min_id_ = false;
+  bool approximate_ = false;
+  std::optional<uint64_t> limit_;
+};
+
+// XADDMULTI key [NOMKSTREAM] [MAXLEN|MINID [=|~] threshold [LIMIT count]] id numpairs field value [field value ...]
+//   [id numpairs field value [field value ...] ...]
+// adds the entries to the stream by one write with one update of the metadata, and replies their IDs.
+// The entries are added all or none, e.g. none of them is added if an ID is not greater than the one before it.
+class CommandXAddMulti : public CommandXAdd {
+ public:
+  Status Parse(const std::vector<std::string> &args) override {
+    stream_name_ = args[1];
+    size_t i = 2;
+    if (auto s = parseAddOptions(args, &i); !s.IsOK()) return s;
+
+    while (i < args.size()) {
+      if (i + 1 >= args.size()) {
+        return {Status::RedisParseErr, errWrongNumOfArguments};
+      }
+
+      redis::StreamAddEntry entry;
+      entry.next_id_strategy = GET_OR_RET(ParseNextStreamEntryIDStrategy(util::ToLower(args[i])));
+      auto num_pairs = ParseInt<size_t>(args[i + 1], NumericRange<size_t>{1, (args.size() - i - 2) / 2}, 10);
+      if (!num_pairs) {
+        return {Status::RedisParseErr, "the number of the field-value pairs of an entry is invalid"};
+      }
+
+      auto begin = args.begin() + static_cast<std::ptrdiff_t>(i) + 2;
+      entry.values.assign(begin, begin + static_cast<std::ptrdiff_t>(*num_pairs * 2));
+      entries_.push_back(std::move(entry));
+      i += 2 + *num_pairs * 2;
+    }
+
+    if (entries_.empty()) {
+      return {Status::RedisParseErr, errWrongNumOfArguments};
+    }
+
+    return Status::OK();
+  }
+
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    auto options = makeAddOptions();
 
     redis::Stream stream_db(srv->storage, conn->GetNamespace());
-    StreamEntryID entry_id;
+    std::vector<StreamEntryID> entry_ids;
     engine::Context ctx(srv->storage);
-    auto s = stream_db.Add(ctx, stream_name_, options, name_value_pairs_, &entry_id);
+    auto s = stream_db.AddEntries(ctx, stream_name_, options, entries_, &entry_ids);
     if (!s.ok() && !s.IsNotFound()) {
       return {Status::RedisExecErr, s.ToString()};
     }
 
     if (s.IsNotFound() && nomkstream_) {
-      *output = conn->NilString();
+      *output = conn->NilArray();
       return Status::OK();
     }
 
-    *output = redis::BulkString(entry_id.ToString());
+    output->append(redis::MultiLen(entry_ids.size()));
+    for (const auto &entry_id : entry_ids) {
+      output->append(redis::BulkString(entry_id.ToString()));
+    }
 
-    srv->OnEntryAddedToStream(conn->GetNamespace(), stream_name_, entry_id);
+    // the waiters are woken once by the last entry, they read all the entries after their IDs
+    srv->OnEntryAddedToStream(conn->GetNamespace(), stream_name_, entry_ids.back());
 
     return Status::OK();
   }
 
  private:
-  std::string stream_name_;
-  uint64_t max_len_ = 0;
-  redis::StreamEntryID min_id_;
-  std::unique_ptr<redis::NextStreamEntryIDGenerationStrategy> next_id_strategy_;
-  std::vector<std::string> name_value_pairs_;
-  bool nomkstream_ = false;
-  bool with_max_len_ = false;
-  bool with_min_id_ = false;
+  std::vector<redis::StreamAddEntry> entries_;
 };
 
 class CommandXDel : public Commander {
@@ -1221,6 +1315,9 @@ class CommandXRead : public Commander,
     std::vector<redis::StreamReadResult> results;
     engine::Context ctx(srv->storage);
 
+    // the metadata of all the streams is read by one MultiGet
+    std::vector<std::string> streams;
+    std::vector<redis::StreamRangeOptions> range_options;
     for (size_t i = 0; i < streams_.size(); ++i) {
       if (latest_marks_[i]) {
         continue;
@@ -1235,14 +1332,19 @@ class CommandXRead : public Commander,
       options.exclude_start = true;
       options.exclude_end = false;
 
-      std::vector<StreamEntry> result;
-      auto s = stream_db.Range(ctx, streams_[i], options, &result);
-      if (!s.ok() && !s.IsNotFound()) {
-        return {Status::RedisExecErr, s.ToString()};
-      }
+      streams.push_back(streams_[i]);
+      range_options.push_back(options);
+    }
 
-      if (result.size() > 0) {
-        results.emplace_back(streams_[i], result);
+    std::vector<std::vector<StreamEntry>> entries;
+    auto s = stream_db.MultiRange(ctx, streams, range_options, &entries);
+    if (!s.ok()) {
+      return {Status::RedisExecErr, s.ToString()};
+    }
+
+    for (size_t i = 0; i < streams.size(); ++i) {
+      if (entries[i].size() > 0) {
+        results.emplace_back(streams[i], std::move(entries[i]));
       }
     }
 
@@ -1287,23 +1389,27 @@ class CommandXRead : public Commander,
       count_ = blocked_default_count_;
     }
 
-    for (size_t i = 0; i < streams_.size(); ++i) {
-      if (latest_marks_[i]) {
-        StreamEntryID last_generated_id;
-        engine::Context ctx(srv->storage);
-        auto s = stream_db->GetLastGeneratedID(ctx, streams_[i], &last_generated_id);
-        if (!s.ok()) {
-          return {Status::RedisExecErr, s.ToString()};
+    if (std::find(latest_marks_.begin(), latest_marks_.end(), true) != latest_marks_.end()) {
+      // the last generated IDs of the streams are read by one MultiGet, it's 0-0 if a stream doesn't exist
+      engine::Context ctx(srv->storage);
+      std::vector<StreamMetadata> metadatas;
+      auto statuses = stream_db->MultiGetMetadata(ctx, streams_, &metadatas);
+      for (size_t i = 0; i < streams_.size(); ++i) {
+        if (!latest_marks_[i]) continue;
+        if (!statuses[i].ok() && !statuses[i].IsNotFound()) {
+          return {Status::RedisExecErr, statuses[i].ToString()};
         }
 
-        ids_[i] = last_generated_id;
+        ids_[i] = statuses[i].ok() ? metadatas[i].last_generated_id : StreamEntryID{};
       }
     }
 
     srv_ = srv;
     conn_ = conn;
 
-    srv_->BlockOnStreams(streams_, ids_, conn_);
+    std::optional<uint64_t> read_count;
+    if (count_ > 0) read_count = count_;
+    srv_->BlockOnStreams(streams_, ids_, conn_, read_count);
 
     auto bev = conn->GetBufferEvent();
     SetCB(bev);
@@ -1339,6 +1445,13 @@ class CommandXRead : public Commander,
     std::vector<StreamReadResult> results;
     engine::Context ctx(srv_->storage);
     for (size_t i = 0; i < streams_.size(); ++i) {
+      // the worker may have read the new entries once for all of its waiters of the stream
+      std::vector<StreamEntry> shared_result;
+      if (conn_->Owner()->GetSharedStreamRead(conn_->GetNamespace(), streams_[i], ids_[i], count_, &shared_result)) {
+        results.emplace_back(streams_[i], std::move(shared_result));
+        continue;
+      }
+
       redis::StreamRangeOptions options;
       options.reverse = false;
       options.start = ids_[i];
@@ -1734,25 +1847,23 @@ class CommandXReadGroup : public Commander,
 class CommandXTrim : public Commander {
  public:
   Status Parse(const std::vector<std::string> &args) override {
-    bool eq_sign_found = false;
-
     auto trim_strategy = util::ToLower(args[2]);
-    if (trim_strategy == "maxlen") {
-      strategy_ = StreamTrimStrategy::MaxLen;
+    size_t threshold_idx = 3;
+    if (args[3] == "=") {
+      threshold_idx = 4;
+    } else if (args[3] == "~") {
+      threshold_idx = 4;
+      approximate_ = true;
+    }
 
-      size_t max_len_idx = 0;
-      if (args[3] != "=") {
-        max_len_idx = 3;
-      } else {
-        max_len_idx = 4;
-        eq_sign_found = true;
-      }
+    if (threshold_idx >= args.size()) {
+      return {Status::RedisParseErr, errInvalidSyntax};
+    }
 
-      if (max_len_idx >= args.size()) {
-        return {Status::RedisParseErr, errInvalidSyntax};
-      }
+    if (trim_strategy == "maxlen") {
+      strategy_ = StreamTrimStrategy::MaxLen;
 
-      auto parse_result = ParseInt<uint64_t>(args[max_len_idx], 10);
+      auto parse_result = ParseInt<uint64_t>(args[threshold_idx], 10);
       if (!parse_result) {
         return {Status::RedisParseErr, errValueNotInteger};
       }
@@ -1761,19 +1872,7 @@ class CommandXTrim : public Commander {
     } else if (trim_strategy == "minid") {
       strategy_ = StreamTrimStrategy::MinID;
 
-      size_t min_id_idx = 0;
-      if (args[3] != "=") {
-        min_id_idx = 3;
-      } else {
-        min_id_idx = 4;
-        eq_sign_found = true;
-      }
-
-      if (min_id_idx >= args.size()) {
-        return {Status::RedisParseErr, errInvalidSyntax};
-      }
-
-      auto s = ParseStreamEntryID(args[min_id_idx], &min_id_);
+      auto s = ParseStreamEntryID(args[threshold_idx], &min_id_);
       if (!s.IsOK()) {
         return s;
       }
@@ -1781,19 +1880,19 @@ class CommandXTrim : public Commander {
       return {Status::RedisParseErr, errInvalidSyntax};
     }
 
-    bool limit_option_found = false;
-    if (eq_sign_found) {
-      if (args.size() > 6 && util::ToLower(args[5]) == "limit") {
-        limit_option_found = true;
+    if (args.size() > threshold_idx + 1 && util::ToLower(args[threshold_idx + 1]) == "limit") {
+      if (!approximate_) {
+        return {Status::RedisParseErr, errLimitOptionNotAllowed};
       }
-    } else {
-      if (args.size() > 5 && util::ToLower(args[4]) == "limit") {
-        limit_option_found = true;
+      if (args.size() == threshold_idx + 2) {
+        return {Status::RedisParseErr, errInvalidSyntax};
       }
-    }
 
-    if (limit_option_found) {
-      return {Status::RedisParseErr, errLimitOptionNotAllowed};
+      auto parse_result = ParseInt<uint64_t>(args[threshold_idx + 2], 10);
+      if (!parse_result) {
+        return {Status::RedisParseErr, errValueNotInteger};
+      }
+      limit_ = *parse_result;
     }
 
     return Status::OK();
@@ -1806,6 +1905,8 @@ class CommandXTrim : public Commander {
     options.strategy = strategy_;
     options.max_len = max_len_;
     options.min_id = min_id_;
+    options.approximate = approximate_;
+    if (limit_) options.limit = *limit_;
 
     uint64_t removed = 0;
     engine::Context ctx(srv->storage);
@@ -1823,6 +1924,8 @@ class CommandXTrim : public Commander {
   uint64_t max_len_ = 0;
   StreamEntryID min_id_;
   StreamTrimStrategy strategy_ = StreamTrimStrategy::None;
+  bool approximate_ = false;
+  std::optional<uint64_t> limit_;
 };
 
 class CommandXSetId : public Commander {
@@ -1884,6 +1987,7 @@ class CommandXSetId : public Commander {
 
 REDIS_REGISTER_COMMANDS(Stream, MakeCmdAttr<CommandXAck>("xack", -4, "write no-dbsize-check", 1, 1, 1),
                         MakeCmdAttr<CommandXAdd>("xadd", -5, "write", 1, 1, 1),
+                        MakeCmdAttr<CommandXAddMulti>("xaddmulti", -6, "write", 1, 1, 1),
                         MakeCmdAttr<CommandXDel>("xdel", -3, "write no-dbsize-check", 1, 1, 1),
                         MakeCmdAttr<CommandXClaim>("xclaim", -6, "write", 1, 1, 1),
                         MakeCmdAttr<CommandAutoClaim>("xautoclaim", -6, "write", 1, 1, 1),
@@ -111,19 +111,15 @@ class CommandGetEx : public Commander {
 class CommandStrlen : public Commander {
  public:
   Status Execute(Server *srv, Connection *conn, std::string *output) override {
-    std::string value;
+    uint64_t len = 0;
     redis::String string_db(srv->storage, conn->GetNamespace());
     engine::Context ctx(srv->storage);
-    auto s = string_db.Get(ctx, args_[1], &value);
+    auto s = string_db.Strlen(ctx, args_[1], &len);
     if (!s.ok() && !s.IsNotFound()) {
       return {Status::RedisExecErr, s.ToString()};
     }
 
-    if (s.IsNotFound()) {
-      *output = redis::Integer(0);
-    } else {
-      *output = redis::Integer(value.size());
-    }
+    *output = redis::Integer(len);
     return Status::OK();
   }
 };
@@ -183,28 +179,15 @@ class CommandGetRange : public Commander {
   }
 
   Status Execute(Server *srv, Connection *conn, std::string *output) override {
-    std::string value;
+    std::optional<std::string> value;
     redis::String string_db(srv->storage, conn->GetNamespace());
     engine::Context ctx(srv->storage);
-    auto s = string_db.Get(ctx, args_[1], &value);
+    auto s = string_db.GetRange(ctx, args_[1], start_, stop_, &value);
     if (!s.ok() && !s.IsNotFound()) {
       return {Status::RedisExecErr, s.ToString()};
     }
 
-    if (s.IsNotFound()) {
-      *output = conn->NilString();
-      return Status::OK();
-    }
-
-    if (start_ < 0) start_ = static_cast<int>(value.size()) + start_;
-    if (stop_ < 0) stop_ = static_cast<int>(value.size()) + stop_;
-    if (start_ < 0) start_ = 0;
-    if (stop_ > static_cast<int>(value.size())) stop_ = static_cast<int>(value.size());
-    if (start_ > stop_) {
-      *output = conn->NilString();
-    } else {
-      *output = redis::BulkString(value.substr(start_, stop_ - start_ + 1));
-    }
+    *output = value ? redis::BulkString(*value) : conn->NilString();
     return Status::OK();
   }
 
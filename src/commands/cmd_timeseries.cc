@@ -0,0 +1,444 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include <algorithm>
+#include <map>
+
+#include "command_parser.h"
+#include "commander.h"
+#include "error_constants.h"
+#include "server/server.h"
+#include "time_util.h"
+#include "types/redis_timeseries.h"
+
+namespace {
+
+constexpr const char *errBadTimestamp = "TSDB: invalid timestamp";
+constexpr const char *errBadValue = "TSDB: invalid value";
+constexpr const char *errBadRetention = "TSDB: Couldn't parse RETENTION";
+constexpr const char *errBadChunkSize = "TSDB: CHUNK_SIZE value must be a multiple of 8 in the range [48 .. 1048576]";
+constexpr const char *errBadDuplicatePolicy = "TSDB: Unknown DUPLICATE_POLICY";
+constexpr const char *errBadLabels = "TSDB: Invalid labels";
+constexpr const char *errBadCount = "TSDB: Couldn't parse COUNT";
+constexpr const char *errBadAggregation = "TSDB: Unknown aggregation type";
+constexpr const char *errBadBucketDuration = "TSDB: bucketDuration must be greater than zero";
+constexpr const char *errBadFilter = "TSDB: failed parsing labels";
+constexpr const char *errKeyNotFound = "TSDB: the key does not exist";
+
+using Parser = CommandParserFromConst<std::vector<std::string>>;
+
+const std::vector<std::pair<std::string, TSDuplicatePolicy>> kDuplicatePolicyNames = {
+    {"block", TSDuplicatePolicy::kBlock}, {"first", TSDuplicatePolicy::kFirst}, {"last", TSDuplicatePolicy::kLast},
+    {"min", TSDuplicatePolicy::kMin},     {"max", TSDuplicatePolicy::kMax},     {"sum", TSDuplicatePolicy::kSum},
+};
+
+const std::vector<std::pair<std::string, redis::TSAggregator>> kAggregatorNames = {
+    {"avg", redis::TSAggregator::kAvg},     {"sum", redis::TSAggregator::kSum},
+    {"min", redis::TSAggregator::kMin},     {"max", redis::TSAggregator::kMax},
+    {"range", redis::TSAggregator::kRange}, {"count", redis::TSAggregator::kCount},
+    {"first", redis::TSAggregator::kFirst}, {"last", redis::TSAggregator::kLast},
+};
+
+StatusOr<TSDuplicatePolicy> ParseDuplicatePolicy(const std::string &name) {
+  for (const auto &[policy_name, policy] : kDuplicatePolicyNames) {
+    if (util::EqualICase(name, policy_name)) return policy;
+  }
+  return {Status::RedisParseErr, errBadDuplicatePolicy};
+}
+
+std::string DuplicatePolicyName(TSDuplicatePolicy policy) {
+  for (const auto &[policy_name, value] : kDuplicatePolicyNames) {
+    if (value == policy) return policy_name;
+  }
+  return "block";
+}
+
+/// Parse a timestamp of a range, which is "-" for the earliest and "+" for the latest.
+StatusOr<uint64_t> ParseRangeTimestamp(const std::string &arg) {
+  if (arg == "-") return 0;
+  if (arg == "+") return UINT64_MAX;
+  auto parse_ts = ParseInt<uint64_t>(arg, 10);
+  if (!parse_ts) return {Status::RedisParseErr, errBadTimestamp};
+  return *parse_ts;
+}
+
+/// Parse an option of creating a series, and return false if the next argument isn't one of them.
+/// The duplicate policy of TS.ADD is named ON_DUPLICATE since it's also the policy of the sample itself.
+StatusOr<bool> ParseCreateOption(Parser &parser, redis::TSCreateOptions *options) {
+  if (parser.EatEqICase("retention")) {
+    auto parse_retention = parser.TakeInt<uint64_t>();
+    if (!parse_retention.IsOK()) return {Status::RedisParseErr, errBadRetention};
+    options->retention = *parse_retention;
+  } else if (parser.EatEqICase("chunk_size")) {
+    auto parse_chunk_size =
+        parser.TakeInt<uint32_t>(NumericRange<uint32_t>{redis::kTSMinChunkSize, redis::kTSMaxChunkSize});
+    if (!parse_chunk_size.IsOK() || *parse_chunk_size % 8 != 0) return {Status::RedisParseErr, errBadChunkSize};
+    options->chunk_size = *parse_chunk_size;
+  } else if (parser.EatEqICase("duplicate_policy")) {
+    auto parse_name = parser.TakeStr();
+    if (!parse_name.IsOK()) return {Status::RedisParseErr, errBadDuplicatePolicy};
+    auto parse_policy = ParseDuplicatePolicy(*parse_name);
+    if (!parse_policy.IsOK()) return std::move(parse_policy).ToStatus();
+    options->duplicate_policy = *parse_policy;
+  } else if (parser.EatEqICase("labels")) {
+    if (!parser.Good() || parser.Remains() % 2 != 0) return {Status::RedisParseErr, errBadLabels};
+    while (parser.Good()) {
+      auto label = parser.RawTake();
+      auto value = parser.RawTake();
+      options->labels.emplace_back(label, value);
+    }
+  } else {
+    return false;
+  }
+  return true;
+}
+
+/// Parse the options of a range, and return false if the next argument isn't one of them.
+StatusOr<bool> ParseRangeOption(Parser &parser, redis::TSRangeOptions *options) {
+  if (parser.EatEqICase("count")) {
+    auto parse_count = parser.TakeInt<uint64_t>(NumericRange<uint64_t>{1, UINT64_MAX});
+    if (!parse_count.IsOK()) return {Status::RedisParseErr, errBadCount};
+    options->count = *parse_count;
+  } else if (parser.EatEqICase("aggregation")) {
+    auto parse_name = parser.TakeStr();
+    if (!parse_name.IsOK()) return {Status::RedisParseErr, errBadAggregation};
+    auto iter = std::find_if(kAggregatorNames.begin(), kAggregatorNames.end(),
+                             [&](const auto &entry) { return util::EqualICase(*parse_name, entry.first); });
+    if (iter == kAggregatorNames.end()) return {Status::RedisParseErr, errBadAggregation};
+    options->aggregator = iter->second;
+
+    auto parse_bucket_duration = parser.TakeInt<uint64_t>(NumericRange<uint64_t>{1, UINT64_MAX});
+    if (!parse_bucket_duration.IsOK()) return {Status::RedisParseErr, errBadBucketDuration};
+    options->bucket_duration = *parse_bucket_duration;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+std::string SamplesReply(const Connection *conn, const std::vector<TSSample> &samples) {
+  std::string output = redis::MultiLen(samples.size());
+  for (const auto &sample : samples) {
+    output += redis::MultiLen(2);
+    output += redis::Integer(sample.ts);
+    output += conn->Double(sample.value);
+  }
+  return output;
+}
+
+std::string LabelsReply(const redis::TSLabels &labels) {
+  std::string output = redis::MultiLen(labels.size());
+  for (const auto &[label, value] : labels) {
+    output += redis::MultiLen(2);
+    output += redis::BulkString(label);
+    output += redis::BulkString(value);
+  }
+  return output;
+}
+
+}  // namespace
+
+namespace redis {
+
+class CommandTSCreate : public Commander {
+ public:
+  Status Parse(const std::vector<std::string> &args) override {
+    CommandParser parser(args, 2);
+    while (parser.Good()) {
+      auto parse_option = ParseCreateOption(parser, &options_);
+      if (!parse_option.IsOK()) return std::move(parse_option).ToStatus();
+      if (!*parse_option) return {Status::RedisParseErr, errInvalidSyntax};
+    }
+    return Commander::Parse(args);
+  }
+
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    redis::TimeSeries ts_db(srv->storage, conn->GetNamespace());
+    engine::Context ctx(srv->storage);
+    auto s = ts_db.Create(ctx, args_[1], options_);
+    if (!s.ok()) return {Status::RedisExecErr, s.ToString()};
+
+    *output = redis::SimpleString("OK");
+    return Status::OK();
+  }
+
+ private:
+  TSCreateOptions options_;
+};
+
+class CommandTSAdd : public Commander {
+ public:
+  Status Parse(const std::vector<std::string> &args) override {
+    if (args[2] == "*") {
+      sample_.ts = util::GetTimeStampMS();
+    } else {
+      auto parse_ts = ParseInt<uint64_t>(args[2], 10);
+      if (!parse_ts) return {Status::RedisParseErr, errBadTimestamp};
+      sample_.ts = *parse_ts;
+    }
+    auto parse_value = ParseFloat<double>(args[3]);
+    if (!parse_value) return {Status::RedisParseErr, errBadValue};
+    sample_.value = *parse_value;
+
+    CommandParser parser(args, 4);
+    while (parser.Good()) {
+      if (parser.EatEqICase("on_duplicate")) {
+        auto parse_name = parser.TakeStr();
+        if (!parse_name.IsOK()) return {Status::RedisParseErr, errBadDuplicatePolicy};
+        auto parse_policy = ParseDuplicatePolicy(*parse_name);
+        if (!parse_policy.IsOK()) return std::move(parse_policy).ToStatus();
+        on_duplicate_ = *parse_policy;
+        continue;
+      }
+      auto parse_option = ParseCreateOption(parser, &create_options_);
+      if (!parse_option.IsOK()) return std::move(parse_option).ToStatus();
+      if (!*parse_option) return {Status::RedisParseErr, errInvalidSyntax};
+    }
+    return Commander::Parse(args);
+  }
+
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    redis::TimeSeries ts_db(srv->storage, conn->GetNamespace());
+    std::vector<rocksdb::Status> results;
+    engine::Context ctx(srv->storage);
+    auto s = ts_db.Add(ctx, args_[1], {sample_}, &create_options_, on_duplicate_, &results);
+    if (!s.ok()) return {Status::RedisExecErr, s.ToString()};
+    if (!results[0].ok()) return {Status::RedisExecErr, results[0].ToString()};
+
+    *output = redis::Integer(sample_.ts);
+    return Status::OK();
+  }
+
+ private:
+  TSSample sample_{0, 0};
+  TSCreateOptions create_options_;
+  std::optional<TSDuplicatePolicy> on_duplicate_;
+};
+
+class CommandTSMAdd : public Commander {
+ public:
+  Status Parse(const std::vector<std::string> &args) override {
+    if ((args.size() - 1) % 3 != 0) return {Status::RedisParseErr, errWrongNumOfArguments};
+
+    // the samples of a key are added together, and the replies are in the order of the arguments
+    for (size_t i = 1; i < args.size(); i += 3) {
+      TSSample sample{0, 0};
+      if (args[i + 1] == "*") {
+        sample.ts = util::GetTimeStampMS();
+      } else {
+        auto parse_ts = ParseInt<uint64_t>(args[i + 1], 10);
+        if (!parse_ts) return {Status::RedisParseErr, errBadTimestamp};
+        sample.ts = *parse_ts;
+      }
+      auto parse_value = ParseFloat<double>(args[i + 2]);
+      if (!parse_value) return {Status::RedisParseErr, errBadValue};
+      sample.value = *parse_value;
+
+      auto &key_samples = samples_[args[i]];
+      key_samples.first.push_back(sample);
+      key_samples.second.push_back(replies_.size());
+      replies_.emplace_back();
+    }
+    return Commander::Parse(args);
+  }
+
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    redis::TimeSeries ts_db(srv->storage, conn->GetNamespace());
+    engine::Context ctx(srv->storage);
+    for (const auto &[key, key_samples] : samples_) {
+      const auto &[samples, reply_indexes] = key_samples;
+      std::vector<rocksdb::Status> results;
+      auto s = ts_db.Add(ctx, key, samples, nullptr, std::nullopt, &results);
+      for (size_t i = 0; i < samples.size(); ++i) {
+        std::string &reply = replies_[reply_indexes[i]];
+        if (s.IsNotFound()) {
+          reply = redis::Error({Status::NotOK, errKeyNotFound});
+        } else if (!s.ok()) {
+          reply = redis::Error({Status::NotOK, s.ToString()});
+        } else if (!results[i].ok()) {
+          // the errors of the samples are InvalidArgument with a message, which is replied without the prefix of it
+          reply = redis::Error({Status::NotOK, results[i].getState()});
+        } else {
+          reply = redis::Integer(samples[i].ts);
+        }
+      }
+    }
+
+    *output = redis::MultiLen(replies_.size());
+    for (const auto &reply : replies_) {
+      *output += reply;
+    }
+    return Status::OK();
+  }
+
+ private:
+  // the samples of each key, and the indexes of their replies
+  std::map<std::string, std::pair<std::vector<TSSample>, std::vector<size_t>>> samples_;
+  std::vector<std::string> replies_;
+};
+
+class CommandTSGet : public Commander {
+ public:
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    redis::TimeSeries ts_db(srv->storage, conn->GetNamespace());
+    std::optional<TSSample> sample;
+    engine::Context ctx(srv->storage);
+    auto s = ts_db.Get(ctx, args_[1], &sample);
+    if (s.IsNotFound()) return {Status::RedisExecErr, errKeyNotFound};
+    if (!s.ok()) return {Status::RedisExecErr, s.ToString()};
+
+    if (!sample) {
+      *output = redis::MultiLen(0);
+      return Status::OK();
+    }
+    *output = redis::MultiLen(2);
+    *output += redis::Integer(sample->ts);
+    *output += conn->Double(sample->value);
+    return Status::OK();
+  }
+};
+
+class CommandTSRange : public Commander {
+ public:
+  Status Parse(const std::vector<std::string> &args) override {
+    auto parse_from = ParseRangeTimestamp(args[2]);
+    if (!parse_from.IsOK()) return std::move(parse_from).ToStatus();
+    options_.from = *parse_from;
+    auto parse_to = ParseRangeTimestamp(args[3]);
+    if (!parse_to.IsOK()) return std::move(parse_to).ToStatus();
+    options_.to = *parse_to;
+
+    CommandParser parser(args, 4);
+    while (parser.Good()) {
+      auto parse_option = ParseRangeOption(parser, &options_);
+      if (!parse_option.IsOK()) return std::move(parse_option).ToStatus();
+      if (!*parse_option) return {Status::RedisParseErr, errInvalidSyntax};
+    }
+    return Commander::Parse(args);
+  }
+
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    redis::TimeSeries ts_db(srv->storage, conn->GetNamespace());
+    std::vector<TSSample> samples;
+    engine::Context ctx(srv->storage);
+    auto s = ts_db.Range(ctx, args_[1], options_, &samples);
+    if (s.IsNotFound()) return {Status::RedisExecErr, errKeyNotFound};
+    if (!s.ok()) return {Status::RedisExecErr, s.ToString()};
+
+    *output = SamplesReply(conn, samples);
+    return Status::OK();
+  }
+
+ private:
+  TSRangeOptions options_;
+};
+
+class CommandTSMRange : public Commander {
+ public:
+  Status Parse(const std::vector<std::string> &args) override {
+    auto parse_from = ParseRangeTimestamp(args[1]);
+    if (!parse_from.IsOK()) return std::move(parse_from).ToStatus();
+    options_.from = *parse_from;
+    auto parse_to = ParseRangeTimestamp(args[2]);
+    if (!parse_to.IsOK()) return std::move(parse_to).ToStatus();
+    options_.to = *parse_to;
+
+    CommandParser parser(args, 3);
+    while (parser.Good()) {
+      if (parser.EatEqICase("withlabels")) {
+        with_labels_ = true;
+      } else if (parser.EatEqICase("filter")) {
+        // only the label=value matchers are supported, and FILTER takes all the arguments after it
+        while (parser.Good()) {
+          const std::string &filter = parser.RawTake();
+          auto pos = filter.find('=');
+          if (pos == std::string::npos || pos == 0) return {Status::RedisParseErr, errBadFilter};
+          filters_.emplace_back(filter.substr(0, pos), filter.substr(pos + 1));
+        }
+      } else {
+        auto parse_option = ParseRangeOption(parser, &options_);
+        if (!parse_option.IsOK()) return std::move(parse_option).ToStatus();
+        if (!*parse_option) return {Status::RedisParseErr, errInvalidSyntax};
+      }
+    }
+    if (filters_.empty()) return {Status::RedisParseErr, errBadFilter};
+    return Commander::Parse(args);
+  }
+
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    redis::TimeSeries ts_db(srv->storage, conn->GetNamespace());
+    std::vector<TSMRangeEntry> entries;
+    engine::Context ctx(srv->storage);
+    auto s = ts_db.MRange(ctx, filters_, options_, &entries);
+    if (!s.ok()) return {Status::RedisExecErr, s.ToString()};
+
+    *output = redis::MultiLen(entries.size());
+    for (const auto &entry : entries) {
+      *output += redis::MultiLen(3);
+      *output += redis::BulkString(entry.key);
+      *output += with_labels_ ? LabelsReply(entry.labels) : redis::MultiLen(0);
+      *output += SamplesReply(conn, entry.samples);
+    }
+    return Status::OK();
+  }
+
+ private:
+  TSRangeOptions options_;
+  TSLabels filters_;
+  bool with_labels_ = false;
+};
+
+class CommandTSInfo : public Commander {
+ public:
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    redis::TimeSeries ts_db(srv->storage, conn->GetNamespace());
+    TSInfo info;
+    engine::Context ctx(srv->storage);
+    auto s = ts_db.Info(ctx, args_[1], &info);
+    if (s.IsNotFound()) return {Status::RedisExecErr, errKeyNotFound};
+    if (!s.ok()) return {Status::RedisExecErr, s.ToString()};
+
+    *output = redis::MultiLen(2 * 7);
+    *output += redis::SimpleString("totalSamples");
+    *output += redis::Integer(info.total_samples);
+    *output += redis::SimpleString("firstTimestamp");
+    *output += redis::Integer(info.first_timestamp);
+    *output += redis::SimpleString("lastTimestamp");
+    *output += redis::Integer(info.last_timestamp);
+    *output += redis::SimpleString("retentionTime");
+    *output += redis::Integer(info.retention);
+    *output += redis::SimpleString("chunkSize");
+    *output += redis::Integer(info.chunk_size);
+    *output += redis::SimpleString("duplicatePolicy");
+    *output += redis::BulkString(DuplicatePolicyName(info.duplicate_policy));
+    *output += redis::SimpleString("labels");
+    *output += LabelsReply(info.labels);
+    return Status::OK();
+  }
+};
+
+REDIS_REGISTER_COMMANDS(TimeSeries, MakeCmdAttr<CommandTSCreate>("ts.create", -2, "write", 1, 1, 1),
+                        MakeCmdAttr<CommandTSAdd>("ts.add", -4, "write", 1, 1, 1),
+                        MakeCmdAttr<CommandTSMAdd>("ts.madd", -4, "write", 1, -1, 3),
+                        MakeCmdAttr<CommandTSGet>("ts.get", 2, "read-only", 1, 1, 1),
+                        MakeCmdAttr<CommandTSRange>("ts.range", -4, "read-only", 1, 1, 1),
+                        MakeCmdAttr<CommandTSMRange>("ts.mrange", -5, "read-only", 0, 0, 0),
+                        MakeCmdAttr<CommandTSInfo>("ts.info", 2, "read-only", 1, 1, 1), )
+}  // namespace redis
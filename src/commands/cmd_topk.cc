@@ -0,0 +1,254 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "command_parser.h"
+#include "commander.h"
+#include "error_constants.h"
+#include "server/server.h"
+#include "types/redis_topk.h"
+
+namespace {
+
+constexpr const char *errBadK = "TopK: invalid k";
+constexpr const char *errBadWidth = "TopK: invalid width";
+constexpr const char *errBadDepth = "TopK: invalid depth";
+constexpr const char *errBadDecay = "TopK: invalid decay value. must be '<= 1' & '> 0'";
+constexpr const char *errBadIncrement = "TopK: increment must be an integer between 1 and 100000";
+constexpr const char *errKeyNotFound = "TopK: key does not exist";
+}  // namespace
+
+namespace redis {
+
+class CommandTopKReserve : public Commander {
+ public:
+  Status Parse(const std::vector<std::string> &args) override {
+    if (args.size() != 3 && args.size() != 6) return {Status::RedisParseErr, errWrongNumOfArguments};
+
+    auto parse_k = ParseInt<uint32_t>(args[2], NumericRange<uint32_t>{1, UINT32_MAX}, 10);
+    if (!parse_k) return {Status::RedisParseErr, errBadK};
+    k_ = *parse_k;
+
+    if (args.size() == 6) {
+      auto parse_width = ParseInt<uint32_t>(args[3], NumericRange<uint32_t>{1, UINT32_MAX}, 10);
+      if (!parse_width) return {Status::RedisParseErr, errBadWidth};
+      width_ = *parse_width;
+
+      auto parse_depth = ParseInt<uint32_t>(args[4], NumericRange<uint32_t>{1, UINT32_MAX}, 10);
+      if (!parse_depth) return {Status::RedisParseErr, errBadDepth};
+      depth_ = *parse_depth;
+
+      auto parse_decay = ParseFloat<double>(args[5]);
+      if (!parse_decay || *parse_decay <= 0 || *parse_decay > 1) return {Status::RedisParseErr, errBadDecay};
+      decay_ = *parse_decay;
+    }
+
+    return Commander::Parse(args);
+  }
+
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    redis::TopK topk_db(srv->storage, conn->GetNamespace());
+    engine::Context ctx(srv->storage);
+    auto s = topk_db.Reserve(ctx, args_[1], k_, width_, depth_, decay_);
+    if (!s.ok()) return {Status::RedisExecErr, s.ToString()};
+
+    *output = redis::SimpleString("OK");
+    return Status::OK();
+  }
+
+ private:
+  uint32_t k_ = 0;
+  uint32_t width_ = kTopKDefaultWidth;
+  uint32_t depth_ = kTopKDefaultDepth;
+  double decay_ = kTopKDefaultDecay;
+};
+
+class CommandTopKIncrItems : public Commander {
+ public:
+  explicit CommandTopKIncrItems(bool with_increment) : with_increment_(with_increment) {}
+
+  Status Parse(const std::vector<std::string> &args) override {
+    if (!with_increment_) {
+      increments_.reserve(args.size() - 2);
+      for (size_t i = 2; i < args.size(); ++i) {
+        increments_.emplace_back(args[i], 1);
+      }
+      return Commander::Parse(args);
+    }
+
+    if (args.size() % 2 != 0) return {Status::RedisParseErr, errWrongNumOfArguments};
+    increments_.reserve((args.size() - 2) / 2);
+    for (size_t i = 2; i < args.size(); i += 2) {
+      auto parse_increment = ParseInt<uint32_t>(args[i + 1], NumericRange<uint32_t>{1, kTopKMaxIncrement}, 10);
+      if (!parse_increment) return {Status::RedisParseErr, errBadIncrement};
+      increments_.emplace_back(args[i], *parse_increment);
+    }
+    return Commander::Parse(args);
+  }
+
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    redis::TopK topk_db(srv->storage, conn->GetNamespace());
+    std::vector<std::optional<std::string>> expelled;
+    engine::Context ctx(srv->storage);
+    auto s = topk_db.IncrBy(ctx, args_[1], increments_, &expelled);
+    if (s.IsNotFound()) return {Status::RedisExecErr, errKeyNotFound};
+    if (!s.ok()) return {Status::RedisExecErr, s.ToString()};
+
+    *output = redis::MultiLen(expelled.size());
+    for (const auto &item : expelled) {
+      *output += item ? redis::BulkString(*item) : conn->NilString();
+    }
+    return Status::OK();
+  }
+
+ private:
+  bool with_increment_;
+  std::vector<std::pair<std::string, uint32_t>> increments_;
+};
+
+class CommandTopKAdd : public CommandTopKIncrItems {
+ public:
+  CommandTopKAdd() : CommandTopKIncrItems(false) {}
+};
+
+class CommandTopKIncrBy : public CommandTopKIncrItems {
+ public:
+  CommandTopKIncrBy() : CommandTopKIncrItems(true) {}
+};
+
+class CommandTopKQuery : public Commander {
+ public:
+  Status Parse(const std::vector<std::string> &args) override {
+    items_.reserve(args.size() - 2);
+    for (size_t i = 2; i < args.size(); ++i) {
+      items_.emplace_back(args[i]);
+    }
+    return Commander::Parse(args);
+  }
+
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    redis::TopK topk_db(srv->storage, conn->GetNamespace());
+    std::vector<bool> exists;
+    engine::Context ctx(srv->storage);
+    auto s = topk_db.Query(ctx, args_[1], items_, &exists);
+    if (s.IsNotFound()) return {Status::RedisExecErr, errKeyNotFound};
+    if (!s.ok()) return {Status::RedisExecErr, s.ToString()};
+
+    *output = redis::MultiLen(exists.size());
+    for (bool exist : exists) {
+      *output += redis::Integer(exist ? 1 : 0);
+    }
+    return Status::OK();
+  }
+
+ private:
+  std::vector<std::string> items_;
+};
+
+class CommandTopKCount : public Commander {
+ public:
+  Status Parse(const std::vector<std::string> &args) override {
+    items_.reserve(args.size() - 2);
+    for (size_t i = 2; i < args.size(); ++i) {
+      items_.emplace_back(args[i]);
+    }
+    return Commander::Parse(args);
+  }
+
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    redis::TopK topk_db(srv->storage, conn->GetNamespace());
+    std::vector<uint32_t> counts;
+    engine::Context ctx(srv->storage);
+    auto s = topk_db.Count(ctx, args_[1], items_, &counts);
+    if (s.IsNotFound()) return {Status::RedisExecErr, errKeyNotFound};
+    if (!s.ok()) return {Status::RedisExecErr, s.ToString()};
+
+    *output = redis::MultiLen(counts.size());
+    for (uint32_t count : counts) {
+      *output += redis::Integer(count);
+    }
+    return Status::OK();
+  }
+
+ private:
+  std::vector<std::string> items_;
+};
+
+class CommandTopKList : public Commander {
+ public:
+  Status Parse(const std::vector<std::string> &args) override {
+    if (args.size() > 3) return {Status::RedisParseErr, errWrongNumOfArguments};
+    if (args.size() == 3) {
+      if (!util::EqualICase(args[2], "withcount")) return {Status::RedisParseErr, errInvalidSyntax};
+      with_count_ = true;
+    }
+    return Commander::Parse(args);
+  }
+
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    redis::TopK topk_db(srv->storage, conn->GetNamespace());
+    std::vector<TopKItem> items;
+    engine::Context ctx(srv->storage);
+    auto s = topk_db.List(ctx, args_[1], &items);
+    if (s.IsNotFound()) return {Status::RedisExecErr, errKeyNotFound};
+    if (!s.ok()) return {Status::RedisExecErr, s.ToString()};
+
+    *output = redis::MultiLen(with_count_ ? 2 * items.size() : items.size());
+    for (const auto &item : items) {
+      *output += redis::BulkString(item.item);
+      if (with_count_) *output += redis::Integer(item.count);
+    }
+    return Status::OK();
+  }
+
+ private:
+  bool with_count_ = false;
+};
+
+class CommandTopKInfo : public Commander {
+ public:
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    redis::TopK topk_db(srv->storage, conn->GetNamespace());
+    TopKInfo info;
+    engine::Context ctx(srv->storage);
+    auto s = topk_db.Info(ctx, args_[1], &info);
+    if (s.IsNotFound()) return {Status::RedisExecErr, errKeyNotFound};
+    if (!s.ok()) return {Status::RedisExecErr, s.ToString()};
+
+    *output = redis::MultiLen(2 * 4);
+    *output += redis::SimpleString("k");
+    *output += redis::Integer(info.k);
+    *output += redis::SimpleString("width");
+    *output += redis::Integer(info.width);
+    *output += redis::SimpleString("depth");
+    *output += redis::Integer(info.depth);
+    *output += redis::SimpleString("decay");
+    *output += conn->Double(info.decay);
+    return Status::OK();
+  }
+};
+
+REDIS_REGISTER_COMMANDS(TopK, MakeCmdAttr<CommandTopKReserve>("topk.reserve", -3, "write", 1, 1, 1),
+                        MakeCmdAttr<CommandTopKAdd>("topk.add", -3, "write", 1, 1, 1),
+                        MakeCmdAttr<CommandTopKIncrBy>("topk.incrby", -4, "write", 1, 1, 1),
+                        MakeCmdAttr<CommandTopKQuery>("topk.query", -3, "read-only", 1, 1, 1),
+                        MakeCmdAttr<CommandTopKCount>("topk.count", -3, "read-only", 1, 1, 1),
+                        MakeCmdAttr<CommandTopKList>("topk.list", -2, "read-only", 1, 1, 1),
+                        MakeCmdAttr<CommandTopKInfo>("topk.info", 2, "read-only", 1, 1, 1), )
+}  // namespace redis
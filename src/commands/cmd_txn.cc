@@ -18,6 +18,8 @@
  *
  */
 
+#include <optional>
+
 #include "commander.h"
 #include "error_constants.h"
 #include "scope_exit.h"
@@ -77,6 +79,12 @@ class CommandExec : public Commander {
     }
 
     auto storage = srv->storage;
+    // Without the exclusivity, the keys of all commands are locked until the transaction is committed
+    std::optional<TxnLockGuard> lock_guard;
+    if (auto lock_keys = conn->GetExecLockKeys()) {
+      lock_guard.emplace(storage->GetLockManager(), *lock_keys);
+    }
+
     // Reply multi length first
     conn->Reply(redis::MultiLen(conn->GetMultiExecCommands()->size()));
     // Execute multi-exec commands
@@ -97,7 +105,7 @@ class CommandWatch : public Commander {
       return {Status::RedisExecErr, "WATCH inside MULTI is not allowed"};
     }
 
-    // If a conn is already marked as watched_keys_modified, we can skip the watch.
+    // If the watched keys of a conn are already modified, we can skip the watch.
     if (srv->IsWatchedKeysModified(conn)) {
       *output = redis::SimpleString("OK");
       return Status::OK();
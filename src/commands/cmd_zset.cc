@@ -257,10 +257,11 @@ class CommandZPop : public Commander {
       return {Status::RedisExecErr, s.ToString()};
     }
 
-    output->append(redis::MultiLen(member_scores.size() * 2));
+    auto writer = conn->Writer(output);
+    writer.ArrayHeader(member_scores.size() * 2);
     for (const auto &ms : member_scores) {
-      output->append(redis::BulkString(ms.member));
-      output->append(conn->Double(ms.score));
+      writer.BulkString(ms.member);
+      writer.Double(ms.score);
     }
 
     return Status::OK();
@@ -826,13 +827,18 @@ class CommandZRangeGeneric : public Commander {
     }
 
     auto is_resp3 = conn->GetProtocolVersion() == RESP::v3;
+    auto writer = conn->Writer(output);
+    size_t reserve_size = 0;
+    for (const auto &ms : member_scores) reserve_size += ReplyWriter::BulkStringSize(ms.member.size());
+    if (with_scores_) reserve_size += member_scores.size() * ReplyWriter::BulkStringSize(0);
+    writer.Reserve(reserve_size);
     // RESP3 with scores should return an array of arrays,
     // so we don't need to multiply the size by 2 here.
-    output->append(redis::MultiLen(member_scores.size() * (with_scores_ && !is_resp3 ? 2 : 1)));
+    writer.ArrayHeader(member_scores.size() * (with_scores_ && !is_resp3 ? 2 : 1));
     for (const auto &ms : member_scores) {
-      if (with_scores_ && is_resp3) output->append(MultiLen(2));
-      output->append(redis::BulkString(ms.member));
-      if (with_scores_) output->append(conn->Double(ms.score));
+      if (with_scores_ && is_resp3) writer.ArrayHeader(2);
+      writer.BulkString(ms.member);
+      if (with_scores_) writer.Double(ms.score);
     }
     return Status::OK();
   }
@@ -1158,10 +1164,11 @@ class CommandZUnion : public Commander {
       return score1.score < score2.score;
     };
     std::sort(member_scores.begin(), member_scores.end(), compare_score);
-    output->append(redis::MultiLen(member_scores.size() * (with_scores_ ? 2 : 1)));
+    auto writer = conn->Writer(output);
+    writer.ArrayHeader(member_scores.size() * (with_scores_ ? 2 : 1));
     for (const auto &ms : member_scores) {
-      output->append(redis::BulkString(ms.member));
-      if (with_scores_) output->append(conn->Double(ms.score));
+      writer.BulkString(ms.member);
+      if (with_scores_) writer.Double(ms.score);
     }
     return Status::OK();
   }
@@ -1295,10 +1302,11 @@ class CommandZInter : public CommandZUnion {
       return ms1.score < ms2.score;
     };
     std::sort(member_scores.begin(), member_scores.end(), ms_comparator);
-    output->append(redis::MultiLen(member_scores.size() * (with_scores_ ? 2 : 1)));
+    auto writer = conn->Writer(output);
+    writer.ArrayHeader(member_scores.size() * (with_scores_ ? 2 : 1));
     for (const auto &member_score : member_scores) {
-      output->append(redis::BulkString(member_score.member));
-      if (with_scores_) output->append(conn->Double(member_score.score));
+      writer.BulkString(member_score.member);
+      if (with_scores_) writer.Double(member_score.score);
     }
     return Status::OK();
   }
@@ -1369,12 +1377,14 @@ class CommandZScan : public CommandSubkeyScanBase {
     std::vector<double> scores;
     auto key_name = srv->GetKeyNameFromCursor(cursor_, CursorType::kTypeZSet);
     engine::Context ctx(srv->storage);
-    auto s = zset_db.Scan(ctx, key_, key_name, limit_, prefix_, &members, &scores);
+    std::string end_cursor;
+    auto s = zset_db.Scan(ctx, key_, key_name, limit_, prefix_, &members, &scores, pattern_, TimeBudgetUS(srv),
+                          &end_cursor);
     if (!s.ok() && !s.IsNotFound()) {
       return {Status::RedisExecErr, s.ToString()};
     }
 
-    auto cursor = GetNextCursor(srv, members, CursorType::kTypeZSet);
+    auto cursor = GetNextCursor(srv, end_cursor, CursorType::kTypeZSet);
     std::vector<std::string> entries;
     entries.reserve(2 * members.size());
     for (size_t i = 0; i < members.size(); i++) {
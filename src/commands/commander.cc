@@ -20,6 +20,8 @@
 
 #include "commander.h"
 
+#include <cctype>
+
 #include "cluster/cluster_defs.h"
 
 namespace redis {
@@ -28,10 +30,12 @@ RegisterToCommandTable::RegisterToCommandTable(CommandCategory category,
                                                std::initializer_list<CommandAttributes> list) {
   for (auto attr : list) {
     attr.category = category;
+    attr.id = CommandTable::redis_command_table.size();
     CommandTable::redis_command_table.emplace_back(attr);
     CommandTable::original_commands[attr.name] = &CommandTable::redis_command_table.back();
     CommandTable::commands[attr.name] = &CommandTable::redis_command_table.back();
   }
+  CommandTable::UpdateIndex();
 }
 
 size_t CommandTable::Size() { return redis_command_table.size(); }
@@ -40,7 +44,48 @@ const CommandMap *CommandTable::GetOriginal() { return &original_commands; }
 
 CommandMap *CommandTable::Get() { return &commands; }
 
-void CommandTable::Reset() { commands = original_commands; }
+void CommandTable::Reset() {
+  commands = original_commands;
+  UpdateIndex();
+}
+
+namespace {
+
+// FNV-1a of the lowercase name
+uint64_t HashCommandName(std::string_view name) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (auto c : name) {
+    hash ^= static_cast<unsigned char>(std::tolower(static_cast<unsigned char>(c)));
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+}  // namespace
+
+void CommandTable::UpdateIndex() {
+  // At most a quarter of the slots are used, so a lookup mostly probes one slot
+  size_t n_slots = 1;
+  while (n_slots < commands.size() * 4) n_slots <<= 1;
+
+  index_slots.assign(n_slots, {"", nullptr});
+  for (const auto &[name, attributes] : commands) {
+    auto i = HashCommandName(name) & (n_slots - 1);
+    while (index_slots[i].second != nullptr) i = (i + 1) & (n_slots - 1);
+    index_slots[i] = {name, attributes};
+  }
+}
+
+const CommandAttributes *CommandTable::Lookup(std::string_view name) {
+  if (index_slots.empty()) return nullptr;
+
+  auto mask = index_slots.size() - 1;
+  for (auto i = HashCommandName(name) & mask;; i = (i + 1) & mask) {
+    const auto &[slot_name, attributes] = index_slots[i];
+    if (attributes == nullptr) return nullptr;
+    if (util::EqualICase(slot_name, name)) return attributes;
+  }
+}
 
 std::string CommandTable::GetCommandInfo(const CommandAttributes *command_attributes) {
   std::string command, command_flags;
@@ -33,6 +33,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <utility>
 #include <vector>
@@ -56,7 +57,7 @@ enum CommandFlags : uint64_t {
   kCmdReadOnly = 1ULL << 1,        // "read-only" flag
   kCmdReplication = 1ULL << 2,     // "replication" flag
   kCmdPubSub = 1ULL << 3,          // "pub-sub" flag
-  kCmdScript = 1ULL << 4,          // "script" flag
+  kCmdScript = 1ULL << 4,          // "script" flag for the commands running a script
   kCmdLoading = 1ULL << 5,         // "ok-loading" flag
   kCmdMulti = 1ULL << 6,           // "multi" flag
   kCmdExclusive = 1ULL << 7,       // "exclusive" flag
@@ -66,6 +67,7 @@ enum CommandFlags : uint64_t {
   kCmdCluster = 1ULL << 11,        // "cluster" flag
   kCmdNoDBSizeCheck = 1ULL << 12,  // "no-dbsize-check" flag
   kCmdSlow = 1ULL << 13,           // "slow" flag
+  kCmdHeavy = 1ULL << 14,          // "heavy" flag for commands that may run long enough to stall a worker
 };
 
 enum class CommandCategory : uint8_t {
@@ -73,6 +75,8 @@ enum class CommandCategory : uint8_t {
   Bit,
   BloomFilter,
   Cluster,
+  CountMinSketch,
+  CuckooFilter,
   Function,
   Geo,
   Hash,
@@ -89,6 +93,8 @@ enum class CommandCategory : uint8_t {
   SortedInt,
   Stream,
   String,
+  TimeSeries,
+  TopK,
   Txn,
   ZSet,
 };
@@ -104,6 +110,9 @@ class Commander {
                          [[maybe_unused]] std::string *output) {
     return {Status::RedisExecErr, errNotImplemented};
   }
+  // EstimateCost is called after a successful parse and returns the approximate number of elements
+  // the command will touch, so that expensive invocations of cheap commands can be run off the worker.
+  virtual uint64_t EstimateCost([[maybe_unused]] Server *srv, [[maybe_unused]] Connection *conn) { return 0; }
 
   virtual ~Commander() = default;
 
@@ -120,6 +129,9 @@ class CommanderWithParseMove : Commander {
 
 using CommanderFactory = std::function<std::unique_ptr<Commander>()>;
 
+// CommanderRecycler reconstructs a commander created by the factory in place, so it can be reused
+using CommanderRecycler = std::function<void(Commander *)>;
+
 struct CommandKeyRange {
   // index of the first key in command tokens
   // 0 stands for no key, since the first index of command arguments is command name
@@ -178,6 +190,12 @@ struct CommandAttributes {
   // commander object generator
   CommanderFactory factory;
 
+  // commander object recycler, which resets the commanders of the factory for the next invocation
+  CommanderRecycler recycler;
+
+  // index of this command in the command table, assigned at registration
+  size_t id = 0;
+
   auto GenerateFlags(const std::vector<std::string> &args) const {
     uint64_t res = flags;
     if (flag_gen) res = flag_gen(res, args);
@@ -234,6 +252,8 @@ inline uint64_t ParseCommandFlags(const std::string &description, const std::str
       flags |= kCmdNoMulti;
     else if (flag == "no-script")
       flags |= kCmdNoScript;
+    else if (flag == "script")
+      flags |= kCmdScript;
     else if (flag == "ro-script")
       flags |= kCmdROScript;
     else if (flag == "cluster")
@@ -242,6 +262,8 @@ inline uint64_t ParseCommandFlags(const std::string &description, const std::str
       flags |= kCmdNoDBSizeCheck;
     else if (flag == "slow")
       flags |= kCmdSlow;
+    else if (flag == "heavy")
+      flags |= kCmdHeavy;
     else {
       std::cout << fmt::format("Encountered non-existent flag '{}' in command {} in command attribute parsing", flag,
                                cmd_name)
@@ -264,7 +286,12 @@ auto MakeCmdAttr(const std::string &name, int arity, const std::string &descript
                          {first_key, last_key, key_step},
                          {},
                          {},
-                         []() -> std::unique_ptr<Commander> { return std::unique_ptr<Commander>(new T()); }};
+                         []() -> std::unique_ptr<Commander> { return std::unique_ptr<Commander>(new T()); },
+                         [](Commander *cmd) {
+                           auto t = static_cast<T *>(cmd);
+                           t->~T();
+                           new (t) T();
+                         }};
 
   if ((first_key > 0 && key_step <= 0) || (first_key > 0 && last_key >= 0 && last_key < first_key)) {
     std::cout << fmt::format("Encountered invalid key range in command {}", name) << std::endl;
@@ -285,7 +312,12 @@ auto MakeCmdAttr(const std::string &name, int arity, const std::string &descript
                          {-1, 0, 0},
                          gen,
                          {},
-                         []() -> std::unique_ptr<Commander> { return std::unique_ptr<Commander>(new T()); }};
+                         []() -> std::unique_ptr<Commander> { return std::unique_ptr<Commander>(new T()); },
+                         [](Commander *cmd) {
+                           auto t = static_cast<T *>(cmd);
+                           t->~T();
+                           new (t) T();
+                         }};
 
   return attr;
 }
@@ -301,7 +333,12 @@ auto MakeCmdAttr(const std::string &name, int arity, const std::string &descript
                          {-2, 0, 0},
                          {},
                          vec_gen,
-                         []() -> std::unique_ptr<Commander> { return std::unique_ptr<Commander>(new T()); }};
+                         []() -> std::unique_ptr<Commander> { return std::unique_ptr<Commander>(new T()); },
+                         [](Commander *cmd) {
+                           auto t = static_cast<T *>(cmd);
+                           t->~T();
+                           new (t) T();
+                         }};
 
   return attr;
 }
@@ -318,6 +355,11 @@ struct CommandTable {
   static const CommandMap *GetOriginal();
   static void Reset();
 
+  // Lookup returns the attributes of the command by its case-insensitive name, or nullptr if it doesn't exist
+  static const CommandAttributes *Lookup(std::string_view name);
+  // UpdateIndex rebuilds the lookup index after the command table is changed, e.g. by rename-command
+  static void UpdateIndex();
+
   static void GetAllCommandsInfo(std::string *info);
   static void GetCommandsInfo(std::string *info, const std::vector<std::string> &cmd_names);
   static std::string GetCommandInfo(const CommandAttributes *command_attributes);
@@ -338,6 +380,9 @@ struct CommandTable {
   // Command table after rename-command directive
   static inline CommandMap commands;
 
+  // Open addressing index of the command table, hashed by the lowercase names, see Lookup
+  static inline std::vector<std::pair<std::string, const CommandAttributes *>> index_slots;
+
   friend struct RegisterToCommandTable;
 };
 
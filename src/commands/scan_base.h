@@ -29,6 +29,7 @@
 namespace redis {
 
 inline constexpr const char *kCursorPrefix = "_";
+inline constexpr int kMaxScanParallelism = 64;
 
 class CommandScanBase : public Commander {
  public:
@@ -44,17 +45,17 @@ class CommandScanBase : public Commander {
   Status ParseAdditionalFlags(Parser &parser) {
     while (parser.Good()) {
       if (parser.EatEqICase("match")) {
-        prefix_ = GET_OR_RET(parser.TakeStr());
-        if (!prefix_.empty() && prefix_.back() == '*') {
-          prefix_ = prefix_.substr(0, prefix_.size() - 1);
-        } else {
-          return {Status::RedisParseErr, "currently only key prefix matching is supported"};
-        }
+        // The keys are sought from the literal prefix, and only the others are matched against the pattern
+        pattern_ = GET_OR_RET(parser.TakeStr());
+        prefix_ = util::StringMatchPrefix(pattern_);
+        if (pattern_ == prefix_ + "*") pattern_.clear();
       } else if (parser.EatEqICase("count")) {
         limit_ = GET_OR_RET(parser.TakeInt());
         if (limit_ <= 0) {
           return {Status::RedisParseErr, "limit should be a positive integer"};
         }
+      } else if (IsScan && parser.EatEqICase("parallel")) {
+        parallel_ = GET_OR_RET(parser.template TakeInt<int>(NumericRange<int>{1, kMaxScanParallelism}));
       } else if (IsScan && parser.EatEqICase("type")) {
         std::string type_str = GET_OR_RET(parser.TakeStr());
         if (auto iter = std::find(RedisTypeNames.begin(), RedisTypeNames.end(), type_str);
@@ -98,8 +99,12 @@ class CommandScanBase : public Commander {
  protected:
   std::string cursor_;
   std::string prefix_;
+  // the glob-style pattern of MATCH, or empty if it's just the prefix
+  std::string pattern_;
   int limit_ = 20;
   RedisType type_ = kRedisNone;
+  // the number of the partitions SCAN PARALLEL scans concurrently
+  int parallel_ = 1;
 };
 
 class CommandSubkeyScanBase : public CommandScanBase {
@@ -116,11 +121,15 @@ class CommandSubkeyScanBase : public CommandScanBase {
     return ParseAdditionalFlags<false>(parser);
   }
 
-  std::string GetNextCursor(Server *srv, std::vector<std::string> &fields, CursorType cursor_type) const {
-    if (fields.size() == static_cast<size_t>(limit_)) {
-      return srv->GenerateCursorFromKeyName(fields.back(), cursor_type);
-    }
-    return "0";
+  // GetNextCursor returns the cursor to resume the scan after end_cursor, the subkey where the scan stopped
+  std::string GetNextCursor(Server *srv, const std::string &end_cursor, CursorType cursor_type) const {
+    if (end_cursor.empty()) return "0";
+    return srv->GenerateCursorFromKeyName(end_cursor, cursor_type);
+  }
+
+  // the time budget of a call, the subkey scan returns a partial page once it runs out
+  static uint64_t TimeBudgetUS(Server *srv) {
+    return static_cast<uint64_t>(srv->GetConfig()->scan_time_budget_ms) * 1000;
   }
 
  protected:
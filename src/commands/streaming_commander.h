@@ -0,0 +1,130 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "commander.h"
+#include "event_util.h"
+#include "server/redis_connection.h"
+#include "server/server.h"
+#include "storage/storage.h"
+
+namespace redis {
+
+// StreamingCommander writes a huge reply in batches instead of building it in memory at once.
+//
+// The command replies the header from Execute, and the batches are written from the write callbacks.
+// The iteration pauses once the output buffer of the client holds kHighWatermark bytes, and resumes
+// when it drains below kLowWatermark. All the batches are read from the snapshot of ctx_, which is
+// taken when the command starts, so the reply is as consistent as a reply built at once.
+// Each batch is read under WorkConcurrencyGuard, and the reply is aborted once the server is loading,
+// since the DB and the snapshot are going to be replaced.
+class StreamingCommander : public Commander, private EvbufCallbackBase<StreamingCommander, false> {
+ public:
+  static constexpr size_t kBatchSize = 1024;
+  static constexpr size_t kLowWatermark = 64 * 1024;
+  static constexpr size_t kHighWatermark = 256 * 1024;
+
+  // method to write the next batch of the reply to the output,
+  // returns true when the reply is done
+  virtual StatusOr<bool> OnStreamingWrite(std::string *output) = 0;
+
+  // if a reply of `elements` elements should be streamed
+  bool ShouldStream(Server *srv, Connection *conn, uint64_t elements) const {
+    auto threshold = static_cast<uint64_t>(srv->GetConfig()->reply_streaming_threshold);
+    return threshold > 0 && elements >= threshold && conn->CanStreamReply(this);
+  }
+
+  // to start streaming the batches after the header is replied
+  // usually put to the end of the Execute method
+  Status StartStreaming(Connection *conn) {
+    conn_ = conn;
+    auto bev = conn->GetBufferEvent();
+    bev_ = bev;
+    conn->GetServer()->AddStreamingReply(bev);
+    SetCB(bev);
+    bufferevent_setwatermark(bev, EV_WRITE, kLowWatermark, 0);
+    conn->StartStreamingReply();
+    // Deferred, so the first batch is written after the header is replied by the connection
+    bufferevent_trigger(bev, EV_WRITE, BEV_TRIG_IGNORE_WATERMARKS | BEV_TRIG_DEFER_CALLBACKS);
+    return Status::OK();
+  }
+
+  void OnWrite(bufferevent *bev) {
+    if (conn_->IsFlagEnabled(Connection::kCloseAfterReply) || conn_->IsFlagEnabled(Connection::kCloseAsync)) {
+      conn_->Close();
+      return;
+    }
+
+    auto srv = conn_->GetServer();
+    auto concurrency = srv->WorkConcurrencyGuard();
+    auto output = bufferevent_get_output(bev);
+    while (evbuffer_get_length(output) < kHighWatermark) {
+      std::string batch;
+      auto done = srv->IsLoading() ? StatusOr<bool>(Status(Status::NotOK, "the server is loading the DB"))
+                                   : OnStreamingWrite(&batch);
+      if (!done) {
+        // The client can't tell an error in the middle of the reply, so close it after the written part
+        LOG(WARNING) << "[connection] Failed to stream the reply to " << conn_->GetAddr() << ": " << done.Msg();
+        conn_->EnableFlag(Connection::kCloseAfterReply);
+        finishStreaming(bev);
+        return;
+      }
+      if (!batch.empty()) conn_->Reply(std::move(batch));
+      if (*done) {
+        finishStreaming(bev);
+        return;
+      }
+    }
+  }
+
+  ~StreamingCommander() override {
+    if (bev_) conn_->GetServer()->RemoveStreamingReply(bev_);
+  }
+
+  void OnEvent(bufferevent *bev, int16_t events) { conn_->OnEvent(bev, events); }
+
+ protected:
+  Connection *conn_ = nullptr;
+  std::unique_ptr<engine::Context> ctx_;
+
+ private:
+  bufferevent *bev_ = nullptr;
+
+  void finishStreaming(bufferevent *bev) {
+    auto conn = conn_;
+    ctx_.reset();
+    conn->GetServer()->RemoveStreamingReply(bev);
+    bev_ = nullptr;
+    bufferevent_setwatermark(bev, EV_WRITE, 0, 0);
+    conn->SetCB(bev);
+    bufferevent_enable(bev, EV_READ);
+    // This command is destroyed here, only use locals from now on
+    conn->FinishStreamingReply();
+    // Process the commands pipelined after this one, or close the connection after the reply
+    bufferevent_trigger(bev, conn->IsFlagEnabled(Connection::kCloseAfterReply) ? EV_WRITE : EV_READ,
+                        BEV_TRIG_IGNORE_WATERMARKS | BEV_TRIG_DEFER_CALLBACKS);
+  }
+};
+
+}  // namespace redis
@@ -0,0 +1,204 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "commander.h"
+#include "event_util.h"
+#include "server/redis_connection.h"
+#include "server/server.h"
+
+namespace redis {
+
+// SuspendableCommander can suspend its connection in the middle of the execution, and continue on the
+// worker of the connection once the awaited thing happens, like a coroutine on the event loop:
+//
+//   Status Execute(Server *srv, Connection *conn, std::string *output) override {
+//     return AwaitResult<int>(
+//         srv, conn, output, [] { return SlowWork(); },
+//         [](int res, std::string *output) {
+//           *output = redis::Integer(res);
+//           return Status::OK();
+//         });
+//   }
+//
+// A continuation runs under the concurrency of the workers like a command, it may await again, and the
+// commands pipelined after this one are processed once a continuation is done. Unlike the blocking commands,
+// the connection is resumed by an event of its worker directly, without a round trip of the write event.
+//
+// The command can't be suspended in MULTI, scripts or the heavy command pool, see Connection::CanSuspend,
+// then the tasks are run and the continuations are called in place, and AwaitWake times out right away.
+class SuspendableCommander : public Commander, private EvbufCallbackBase<SuspendableCommander, false> {
+ public:
+  // Continuation is called with whether the suspension timed out instead of being woken up
+  using Continuation = std::function<Status(bool timed_out, std::string *output)>;
+
+  // Waker wakes up the suspended command from any thread, it does nothing after the command is resumed or gone
+  class Waker {
+   public:
+    void Wake() const {
+      std::lock_guard<std::mutex> guard(state_->mu);
+      state_->woken = true;
+      if (state_->ev) event_active(state_->ev, EV_READ, 0);
+    }
+
+   private:
+    friend class SuspendableCommander;
+
+    struct State {
+      std::mutex mu;
+      event *ev = nullptr;
+      bool woken = false;
+    };
+
+    explicit Waker(std::shared_ptr<State> state) : state_(std::move(state)) {}
+
+    std::shared_ptr<State> state_;
+  };
+
+  ~SuspendableCommander() override { detachWaker(); }
+
+  // MakeWaker returns the waker of the next AwaitWake, it can be woken up even before AwaitWake is called
+  Waker MakeWaker() {
+    detachWaker();
+    waker_ = std::make_shared<Waker::State>();
+    return Waker(waker_);
+  }
+
+  // AwaitWake suspends the connection until the waker from MakeWaker is woken up, or timeout_us microseconds
+  // pass if it isn't 0. Without a waker it's a timer.
+  Status AwaitWake(Server *srv, Connection *conn, int64_t timeout_us, std::string *output, Continuation next) {
+    if (!conn->CanSuspend(this)) {
+      bool woken = false;
+      if (waker_) {
+        std::lock_guard<std::mutex> guard(waker_->mu);
+        woken = waker_->woken;
+      }
+      detachWaker();
+      return next(!woken, output);
+    }
+
+    srv_ = srv;
+    conn_ = conn;
+    next_ = std::move(next);
+    auto bev = conn->GetBufferEvent();
+    SetCB(bev);
+    resume_event_.reset(
+        event_new(bufferevent_get_base(bev), -1, 0, EventCallbackFunc<&SuspendableCommander::onResume>, this));
+    if (timeout_us > 0) {
+      timeval tm = {timeout_us / 1000 / 1000, static_cast<int>(timeout_us % (1000 * 1000))};
+      event_add(resume_event_.get(), &tm);
+    }
+    if (waker_) {
+      std::lock_guard<std::mutex> guard(waker_->mu);
+      waker_->ev = resume_event_.get();
+      if (waker_->woken) event_active(resume_event_.get(), EV_READ, 0);
+    }
+    return {Status::BlockingCmd};
+  }
+
+  // AwaitResult runs the task in the background, and continues with its result on the worker.
+  // The task mustn't access the command, since it may be gone when the task is done.
+  template <typename T>
+  Status AwaitResult(Server *srv, Connection *conn, std::string *output, std::function<T()> task,
+                     std::function<Status(T, std::string *)> next) {
+    if (!conn->CanSuspend(this)) return next(task(), output);
+
+    auto result = std::make_shared<std::optional<T>>();
+    auto s = srv->PublishCommandTask([result, task, waker = MakeWaker()] {
+      *result = task();
+      waker.Wake();
+    });
+    if (!s) {
+      detachWaker();
+      return next(task(), output);
+    }
+    return AwaitWake(srv, conn, 0, output, [result, next = std::move(next)](bool, std::string *output) {
+      return next(std::move(**result), output);
+    });
+  }
+
+  void OnWrite(bufferevent *bev) {
+    // woken up by CLIENT KILL
+    if (conn_->IsFlagEnabled(Connection::kCloseAfterReply)) {
+      conn_->Close();
+      return;
+    }
+    bufferevent_disable(bev, EV_WRITE);
+  }
+
+  void OnEvent(bufferevent *bev, int16_t events) { conn_->OnEvent(bev, events); }
+
+ private:
+  Server *srv_ = nullptr;
+  Connection *conn_ = nullptr;
+  Continuation next_;
+  UniqueEvent resume_event_;
+  std::shared_ptr<Waker::State> waker_;
+
+  void detachWaker() {
+    if (!waker_) return;
+    {
+      std::lock_guard<std::mutex> guard(waker_->mu);
+      waker_->ev = nullptr;
+    }
+    waker_.reset();
+  }
+
+  void onResume(evutil_socket_t, int16_t events) {
+    bool timed_out = !(events & EV_READ);
+    detachWaker();
+    resume_event_.reset();
+
+    auto conn = conn_;
+    auto bev = conn->GetBufferEvent();
+    auto next = std::move(next_);
+    std::string output;
+    Status s;
+    {
+      auto concurrency = srv_->WorkConcurrencyGuard();
+      s = next(timed_out, &output);
+    }
+    // suspended again
+    if (s.Is<Status::BlockingCmd>()) return;
+
+    if (!s.IsOK()) {
+      conn->Reply(redis::Error(s));
+    } else if (!output.empty()) {
+      conn->Reply(std::move(output));
+    }
+
+    conn->SetCB(bev);
+    bufferevent_enable(bev, EV_READ);
+    // This command is destroyed here, only use locals from now on
+    conn->FinishSuspendedCommand();
+    // Process the commands pipelined after this one
+    bufferevent_trigger(bev, EV_READ, BEV_TRIG_IGNORE_WATERMARKS | BEV_TRIG_DEFER_CALLBACKS);
+  }
+};
+
+}  // namespace redis
@@ -0,0 +1,103 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "alloc_util.h"
+
+#ifdef ENABLE_JEMALLOC
+#include <jemalloc/jemalloc.h>
+#endif
+
+#include "fmt/format.h"
+
+namespace util {
+
+#ifdef ENABLE_JEMALLOC
+
+StatusOr<unsigned> BindThreadArena() {
+  unsigned arena = 0;
+  size_t size = sizeof(arena);
+  if (auto ret = mallctl("arenas.create", &arena, &size, nullptr, 0); ret != 0) {
+    return {Status::NotOK, fmt::format("failed to create the jemalloc arena, err: {}", ret)};
+  }
+  if (auto ret = mallctl("thread.arena", nullptr, nullptr, &arena, sizeof(arena)); ret != 0) {
+    return {Status::NotOK, fmt::format("failed to bind the jemalloc arena {}, err: {}", arena, ret)};
+  }
+  return arena;
+}
+
+uint64_t ThreadAllocatedBytes() {
+  thread_local uint64_t *allocated = [] {
+    uint64_t *p = nullptr;
+    size_t size = sizeof(p);
+    if (mallctl("thread.allocatedp", &p, &size, nullptr, 0) != 0) return static_cast<uint64_t *>(nullptr);
+    return p;
+  }();
+  return allocated ? *allocated : 0;
+}
+
+uint64_t ArenaAllocatedBytes(unsigned arena) {
+  uint64_t total = 0;
+  for (const char *kind : {"small", "large"}) {
+    size_t allocated = 0;
+    size_t size = sizeof(allocated);
+    auto name = fmt::format("stats.arenas.{}.{}.allocated", arena, kind);
+    if (mallctl(name.c_str(), &allocated, &size, nullptr, 0) == 0) total += allocated;
+  }
+  return total;
+}
+
+void RefreshAllocStats() {
+  uint64_t epoch = 1;
+  size_t size = sizeof(epoch);
+  mallctl("epoch", &epoch, &size, &epoch, size);
+}
+
+Status DumpHeapProfile(const std::string &path) {
+  bool enabled = false;
+  size_t size = sizeof(enabled);
+  if (mallctl("opt.prof", &enabled, &size, nullptr, 0) != 0) {
+    return {Status::NotSupported, "jemalloc isn't built with the heap profiling"};
+  }
+  if (!enabled) return {Status::NotSupported, "the heap profiling isn't enabled by MALLOC_CONF=prof:true"};
+
+  const char *filename = path.empty() ? nullptr : path.c_str();
+  if (auto ret = mallctl("prof.dump", nullptr, nullptr, &filename, sizeof(filename)); ret != 0) {
+    return {Status::NotOK, fmt::format("failed to dump the heap profile, err: {}", ret)};
+  }
+  return Status::OK();
+}
+
+#else
+
+StatusOr<unsigned> BindThreadArena() { return {Status::NotSupported, "kvrocks isn't built with jemalloc"}; }
+
+uint64_t ThreadAllocatedBytes() { return 0; }
+
+uint64_t ArenaAllocatedBytes([[maybe_unused]] unsigned arena) { return 0; }
+
+void RefreshAllocStats() {}
+
+Status DumpHeapProfile([[maybe_unused]] const std::string &path) {
+  return {Status::NotSupported, "kvrocks isn't built with jemalloc"};
+}
+
+#endif
+
+}  // namespace util
@@ -0,0 +1,50 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "status.h"
+
+// The helpers of the jemalloc arenas and statistics. Without jemalloc (e.g. DISABLE_JEMALLOC or macOS),
+// BindThreadArena fails and the statistics are all zero.
+namespace util {
+
+// BindThreadArena creates a jemalloc arena for the current thread and binds the thread to it, so that the
+// allocations of the thread don't contend with the other threads on the arena locks, and can be accounted
+// by ArenaAllocatedBytes. It returns the index of the arena.
+StatusOr<unsigned> BindThreadArena();
+
+// ThreadAllocatedBytes is the total bytes allocated by the current thread so far. It's a thread-local
+// counter of jemalloc, which is read without any call into the allocator after the first time.
+uint64_t ThreadAllocatedBytes();
+
+// ArenaAllocatedBytes is the bytes currently allocated from the arena, as of the last RefreshAllocStats
+uint64_t ArenaAllocatedBytes(unsigned arena);
+void RefreshAllocStats();
+
+// DumpHeapProfile writes the sampled allocations of jemalloc to the file, which is read by jeprof. It needs
+// jemalloc built with --enable-prof (ENABLE_JEMALLOC_PROF) and started with MALLOC_CONF=prof:true.
+// If the path is empty, the file is named by the prof_prefix of jemalloc.
+Status DumpHeapProfile(const std::string &path);
+
+}  // namespace util
@@ -0,0 +1,323 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "bit_util.h"
+
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace util::simd {
+
+namespace {
+
+struct AndOp {
+  template <typename T>
+  static T Apply(T a, T b) {
+    return a & b;
+  }
+};
+
+struct OrOp {
+  template <typename T>
+  static T Apply(T a, T b) {
+    return a | b;
+  }
+};
+
+struct XorOp {
+  template <typename T>
+  static T Apply(T a, T b) {
+    return a ^ b;
+  }
+};
+
+// The portable kernels load the words by memcpy, which is safe for the unaligned arrays on all platforms
+
+size_t PopcountScalar(const uint8_t *p, size_t count) {
+  size_t bits = 0;
+  for (; count >= 8; p += 8, count -= 8) {
+    uint64_t v = 0;
+    memcpy(&v, p, sizeof(v));
+    bits += __builtin_popcountll(v);
+  }
+  for (; count > 0; p++, count--) {
+    bits += __builtin_popcount(*p);
+  }
+  return bits;
+}
+
+size_t SkipFilledBytesScalar(const uint8_t *p, size_t count, uint8_t fill) {
+  const uint64_t fill_word = 0x0101010101010101ULL * fill;
+  size_t n = 0;
+  for (; n + 8 <= count; n += 8) {
+    uint64_t v = 0;
+    memcpy(&v, p + n, sizeof(v));
+    if (v != fill_word) break;
+  }
+  while (n < count && p[n] == fill) n++;
+  return n;
+}
+
+template <typename Op>
+void BitwiseScalar(uint8_t *dst, const uint8_t *src, size_t count) {
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    uint64_t a = 0, b = 0;
+    memcpy(&a, dst + i, sizeof(a));
+    memcpy(&b, src + i, sizeof(b));
+    a = Op::Apply(a, b);
+    memcpy(dst + i, &a, sizeof(a));
+  }
+  for (; i < count; i++) {
+    dst[i] = Op::Apply(dst[i], src[i]);
+  }
+}
+
+void BitwiseNotScalar(uint8_t *dst, size_t count) {
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    uint64_t a = 0;
+    memcpy(&a, dst + i, sizeof(a));
+    a = ~a;
+    memcpy(dst + i, &a, sizeof(a));
+  }
+  for (; i < count; i++) {
+    dst[i] = ~dst[i];
+  }
+}
+
+void MaxBytesScalar(uint8_t *dst, const uint8_t *src, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    if (src[i] > dst[i]) dst[i] = src[i];
+  }
+}
+
+#if defined(__x86_64__)
+
+// The x86 kernels are compiled for their instruction sets only, and chosen by the CPU features at runtime
+
+__attribute__((target("avx2"))) size_t PopcountAVX2(const uint8_t *p, size_t count) {
+  // count the bits of each nibble by a table lookup, and sum up the bytes by SAD
+  const __m256i lookup =
+      _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low_mask = _mm256_set1_epi8(0x0f);
+  __m256i acc = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 32 <= count; i += 32) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+    __m256i lo = _mm256_and_si256(v, low_mask);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+    __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+    acc = _mm256_add_epi64(acc, _mm256_sad_epu8(cnt, _mm256_setzero_si256()));
+  }
+  __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+  size_t bits = _mm_cvtsi128_si64(sum) + _mm_extract_epi64(sum, 1);
+  return bits + PopcountScalar(p + i, count - i);
+}
+
+__attribute__((target("avx512f,avx512vpopcntdq"))) size_t PopcountAVX512(const uint8_t *p, size_t count) {
+  __m512i acc = _mm512_setzero_si512();
+  size_t i = 0;
+  for (; i + 64 <= count; i += 64) {
+    __m512i v = _mm512_loadu_si512(p + i);
+    acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(v));
+  }
+  uint64_t lanes[8];
+  _mm512_storeu_si512(lanes, acc);
+  size_t bits = 0;
+  for (auto lane : lanes) bits += lane;
+  return bits + PopcountScalar(p + i, count - i);
+}
+
+__attribute__((target("avx2"))) size_t SkipFilledBytesAVX2(const uint8_t *p, size_t count, uint8_t fill) {
+  const __m256i fill_vec = _mm256_set1_epi8(static_cast<char>(fill));
+  size_t n = 0;
+  for (; n + 32 <= count; n += 32) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + n));
+    if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, fill_vec)) != -1) break;
+  }
+  return n + SkipFilledBytesScalar(p + n, count - n, fill);
+}
+
+struct AndAVX2 : AndOp {
+  __attribute__((target("avx2"))) static __m256i Apply256(__m256i a, __m256i b) { return _mm256_and_si256(a, b); }
+};
+
+struct OrAVX2 : OrOp {
+  __attribute__((target("avx2"))) static __m256i Apply256(__m256i a, __m256i b) { return _mm256_or_si256(a, b); }
+};
+
+struct XorAVX2 : XorOp {
+  __attribute__((target("avx2"))) static __m256i Apply256(__m256i a, __m256i b) { return _mm256_xor_si256(a, b); }
+};
+
+template <typename Op>
+__attribute__((target("avx2"))) void BitwiseAVX2(uint8_t *dst, const uint8_t *src, size_t count) {
+  size_t i = 0;
+  for (; i + 32 <= count; i += 32) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), Op::Apply256(a, b));
+  }
+  BitwiseScalar<Op>(dst + i, src + i, count - i);
+}
+
+__attribute__((target("avx2"))) void BitwiseNotAVX2(uint8_t *dst, size_t count) {
+  const __m256i ones = _mm256_set1_epi8(static_cast<char>(0xff));
+  size_t i = 0;
+  for (; i + 32 <= count; i += 32) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_xor_si256(a, ones));
+  }
+  BitwiseNotScalar(dst + i, count - i);
+}
+
+__attribute__((target("avx2"))) void MaxBytesAVX2(uint8_t *dst, const uint8_t *src, size_t count) {
+  size_t i = 0;
+  for (; i + 32 <= count; i += 32) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_max_epu8(a, b));
+  }
+  MaxBytesScalar(dst + i, src + i, count - i);
+}
+
+#elif defined(__aarch64__)
+
+// NEON is always there on aarch64, so its kernels need no detection
+
+size_t PopcountNEON(const uint8_t *p, size_t count) {
+  uint64x2_t acc = vdupq_n_u64(0);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    uint8x16_t cnt = vcntq_u8(vld1q_u8(p + i));
+    acc = vaddq_u64(acc, vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(cnt))));
+  }
+  return vaddvq_u64(acc) + PopcountScalar(p + i, count - i);
+}
+
+size_t SkipFilledBytesNEON(const uint8_t *p, size_t count, uint8_t fill) {
+  const uint8x16_t fill_vec = vdupq_n_u8(fill);
+  size_t n = 0;
+  for (; n + 16 <= count; n += 16) {
+    if (vminvq_u8(vceqq_u8(vld1q_u8(p + n), fill_vec)) != 0xff) break;
+  }
+  return n + SkipFilledBytesScalar(p + n, count - n, fill);
+}
+
+struct AndNEON : AndOp {
+  static uint8x16_t Apply128(uint8x16_t a, uint8x16_t b) { return vandq_u8(a, b); }
+};
+
+struct OrNEON : OrOp {
+  static uint8x16_t Apply128(uint8x16_t a, uint8x16_t b) { return vorrq_u8(a, b); }
+};
+
+struct XorNEON : XorOp {
+  static uint8x16_t Apply128(uint8x16_t a, uint8x16_t b) { return veorq_u8(a, b); }
+};
+
+template <typename Op>
+void BitwiseNEON(uint8_t *dst, const uint8_t *src, size_t count) {
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    vst1q_u8(dst + i, Op::Apply128(vld1q_u8(dst + i), vld1q_u8(src + i)));
+  }
+  BitwiseScalar<Op>(dst + i, src + i, count - i);
+}
+
+void BitwiseNotNEON(uint8_t *dst, size_t count) {
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    vst1q_u8(dst + i, vmvnq_u8(vld1q_u8(dst + i)));
+  }
+  BitwiseNotScalar(dst + i, count - i);
+}
+
+void MaxBytesNEON(uint8_t *dst, const uint8_t *src, size_t count) {
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) vst1q_u8(dst + i, vmaxq_u8(vld1q_u8(dst + i), vld1q_u8(src + i)));
+  MaxBytesScalar(dst + i, src + i, count - i);
+}
+
+#endif
+
+struct Kernels {
+  const char *name;
+  size_t (*popcount)(const uint8_t *, size_t);
+  size_t (*skip_filled_bytes)(const uint8_t *, size_t, uint8_t);
+  void (*bitwise_and)(uint8_t *, const uint8_t *, size_t);
+  void (*bitwise_or)(uint8_t *, const uint8_t *, size_t);
+  void (*bitwise_xor)(uint8_t *, const uint8_t *, size_t);
+  void (*bitwise_not)(uint8_t *, size_t);
+  void (*max_bytes)(uint8_t *, const uint8_t *, size_t);
+};
+
+Kernels DetectKernels() {
+  Kernels kernels{"scalar",           PopcountScalar,      SkipFilledBytesScalar, BitwiseScalar<AndOp>,
+                  BitwiseScalar<OrOp>, BitwiseScalar<XorOp>, BitwiseNotScalar,      MaxBytesScalar};
+#if defined(__x86_64__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    kernels = {"avx2",         PopcountAVX2,         SkipFilledBytesAVX2, BitwiseAVX2<AndAVX2>,
+               BitwiseAVX2<OrAVX2>, BitwiseAVX2<XorAVX2>, BitwiseNotAVX2,      MaxBytesAVX2};
+  }
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq")) {
+    kernels.name = "avx512";
+    kernels.popcount = PopcountAVX512;
+  }
+#elif defined(__aarch64__)
+  kernels = {"neon",         PopcountNEON,         SkipFilledBytesNEON, BitwiseNEON<AndNEON>,
+             BitwiseNEON<OrNEON>, BitwiseNEON<XorNEON>, BitwiseNotNEON,      MaxBytesNEON};
+#endif
+  return kernels;
+}
+
+const Kernels &GetKernels() {
+  static const Kernels kernels = DetectKernels();
+  return kernels;
+}
+
+}  // namespace
+
+size_t Popcount(const uint8_t *p, size_t count) { return GetKernels().popcount(p, count); }
+
+size_t SkipFilledBytes(const uint8_t *p, size_t count, uint8_t fill) {
+  return GetKernels().skip_filled_bytes(p, count, fill);
+}
+
+void BitwiseAnd(uint8_t *dst, const uint8_t *src, size_t count) { GetKernels().bitwise_and(dst, src, count); }
+
+void BitwiseOr(uint8_t *dst, const uint8_t *src, size_t count) { GetKernels().bitwise_or(dst, src, count); }
+
+void BitwiseXor(uint8_t *dst, const uint8_t *src, size_t count) { GetKernels().bitwise_xor(dst, src, count); }
+
+void BitwiseNot(uint8_t *dst, size_t count) { GetKernels().bitwise_not(dst, count); }
+
+void MaxBytes(uint8_t *dst, const uint8_t *src, size_t count) { GetKernels().max_bytes(dst, src, count); }
+
+const char *KernelName() { return GetKernels().name; }
+
+}  // namespace util::simd
@@ -30,11 +30,38 @@
 
 namespace util {
 
+namespace simd {
+
+// The kernels over byte arrays use AVX-512, AVX2 or NEON by the features of the CPU detected at the first call,
+// and fall back to the portable word loops on other CPUs.
+
+// Popcount counts the bits set in the array
+size_t Popcount(const uint8_t *p, size_t count);
+// SkipFilledBytes gets the number of the leading bytes of the array which are equal to `fill`
+size_t SkipFilledBytes(const uint8_t *p, size_t count, uint8_t fill);
+// BitwiseAnd, BitwiseOr and BitwiseXor apply the operation to `dst` with `src` byte by byte
+void BitwiseAnd(uint8_t *dst, const uint8_t *src, size_t count);
+void BitwiseOr(uint8_t *dst, const uint8_t *src, size_t count);
+void BitwiseXor(uint8_t *dst, const uint8_t *src, size_t count);
+// BitwiseNot inverts the bits of `dst`
+void BitwiseNot(uint8_t *dst, size_t count);
+// MaxBytes sets each byte of `dst` to the max of it and the byte of `src`
+void MaxBytes(uint8_t *dst, const uint8_t *src, size_t count);
+// KernelName gets the name of the instruction set used by the kernels
+const char *KernelName();
+
+// The kernels are only worth a call for the arrays of at least this size
+constexpr int64_t kMinBytes = 64;
+
+}  // namespace simd
+
 /* Count number of bits set in the binary array pointed by 's' and long
  * 'count' bytes. The implementation of this function is required to
  * work with a input string length up to 512 MB.
  * */
 inline size_t RawPopcount(const uint8_t *p, int64_t count) {
+  if (count >= simd::kMinBytes) return simd::Popcount(p, count);
+
   size_t bits = 0;
 
   for (; count >= 8; p += 8, count -= 8) {
@@ -112,10 +139,17 @@ static inline void SetBitTo(uint8_t *bits, int64_t i, bool bit_is_set) {
  * */
 inline int64_t RawBitpos(const uint8_t *c, int64_t count, bool bit) {
   int64_t res = 0;
+  int64_t ct = count;
+
+  // skip the bytes without the bit by the kernel, and search the rest word by word
+  if (count >= simd::kMinBytes) {
+    auto skipped = static_cast<int64_t>(simd::SkipFilledBytes(c, count, bit ? 0 : UINT8_MAX));
+    c += skipped;
+    count -= skipped;
+    res += skipped * 8;
+  }
 
   if (bit) {
-    int64_t ct = count;
-
     for (; count >= 8; c += 8, count -= 8) {
       uint64_t x = *reinterpret_cast<const uint64_t *>(c);
       if (x != 0) {
@@ -0,0 +1,118 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "compress_util.h"
+
+#include <lz4.h>
+#include <zstd.h>
+
+#include "encoding.h"
+#include "string_util.h"
+
+namespace util {
+
+// The level of zstd is low, since the frames are compressed on the write path of the master
+static constexpr int kZSTDLevel = 1;
+
+const char *CompressionTypeName(CompressionType type) {
+  switch (type) {
+    case CompressionType::kLZ4:
+      return "lz4";
+    case CompressionType::kZSTD:
+      return "zstd";
+    default:
+      return "no";
+  }
+}
+
+StatusOr<CompressionType> ParseCompressionType(std::string_view name) {
+  auto lower = ToLower(std::string(name));
+  if (lower == "no") return CompressionType::kNone;
+  if (lower == "lz4") return CompressionType::kLZ4;
+  if (lower == "zstd") return CompressionType::kZSTD;
+  return {Status::NotOK, "unsupported compression type: " + std::string(name)};
+}
+
+void CompressFrame(CompressionType type, std::string_view input, std::string *dst) {
+  auto start = dst->size();
+  PutFixed8(dst, static_cast<uint8_t>(type));
+  PutVarint32(dst, static_cast<uint32_t>(input.size()));
+  auto header_size = dst->size();
+
+  size_t compressed_size = 0;
+  if (type == CompressionType::kLZ4 && input.size() <= LZ4_MAX_INPUT_SIZE) {
+    auto bound = LZ4_compressBound(static_cast<int>(input.size()));
+    dst->resize(header_size + bound);
+    auto n = LZ4_compress_default(input.data(), dst->data() + header_size, static_cast<int>(input.size()), bound);
+    compressed_size = n > 0 ? static_cast<size_t>(n) : 0;
+  } else if (type == CompressionType::kZSTD) {
+    auto bound = ZSTD_compressBound(input.size());
+    dst->resize(header_size + bound);
+    auto n = ZSTD_compress(dst->data() + header_size, bound, input.data(), input.size(), kZSTDLevel);
+    compressed_size = ZSTD_isError(n) ? 0 : n;
+  }
+
+  if (compressed_size == 0 || compressed_size >= input.size()) {
+    dst->resize(start);
+    PutFixed8(dst, static_cast<uint8_t>(CompressionType::kNone));
+    PutVarint32(dst, static_cast<uint32_t>(input.size()));
+    dst->append(input);
+    return;
+  }
+  dst->resize(header_size + compressed_size);
+}
+
+Status DecompressFrame(std::string_view frame, std::string *dst) {
+  rocksdb::Slice input(frame.data(), frame.size());
+  uint8_t type = 0;
+  uint32_t size = 0;
+  if (!GetFixed8(&input, &type) || !GetVarint32(&input, &size)) {
+    return {Status::NotOK, "the compressed frame is truncated"};
+  }
+
+  auto start = dst->size();
+  switch (static_cast<CompressionType>(type)) {
+    case CompressionType::kNone:
+      if (input.size() != size) break;
+      dst->append(input.data(), input.size());
+      return Status::OK();
+    case CompressionType::kLZ4: {
+      dst->resize(start + size);
+      auto n = LZ4_decompress_safe(input.data(), dst->data() + start, static_cast<int>(input.size()),
+                                   static_cast<int>(size));
+      if (n >= 0 && static_cast<uint32_t>(n) == size) return Status::OK();
+      break;
+    }
+    case CompressionType::kZSTD: {
+      dst->resize(start + size);
+      auto n = ZSTD_decompress(dst->data() + start, size, input.data(), input.size());
+      if (!ZSTD_isError(n) && n == size) return Status::OK();
+      break;
+    }
+    default:
+      return {Status::NotOK, "unknown compression type of the frame: " + std::to_string(type)};
+  }
+
+  dst->resize(start);
+  return {Status::NotOK, std::string("the frame is corrupted, compression type: ") +
+                             CompressionTypeName(static_cast<CompressionType>(type))};
+}
+
+}  // namespace util
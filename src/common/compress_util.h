@@ -0,0 +1,46 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "status.h"
+
+namespace util {
+
+enum class CompressionType : uint8_t {
+  kNone = 0,
+  kLZ4 = 1,
+  kZSTD = 2,
+};
+
+const char *CompressionTypeName(CompressionType type);
+StatusOr<CompressionType> ParseCompressionType(std::string_view name);
+
+// A compressed frame is the compression type, the size of the uncompressed data as a varint32,
+// and the compressed data. The data is stored uncompressed, i.e. with the type kNone, if it can't be
+// compressed to a smaller size, so decompressing a frame never costs more than copying it.
+void CompressFrame(CompressionType type, std::string_view input, std::string *dst);
+Status DecompressFrame(std::string_view frame, std::string *dst);
+
+}  // namespace util
@@ -29,6 +29,12 @@
 #include <string>
 #include <utility>
 
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 inline uint64_t EncodeDoubleToUInt64(double value) {
   uint64_t result = 0;
 
@@ -71,6 +77,169 @@ bool GetDouble(rocksdb::Slice *input, double *value) {
   return true;
 }
 
+namespace {
+
+void DecodeFixed32ArrayScalar(const char *ptr, uint32_t *dst, size_t n) {
+  for (size_t i = 0; i < n; i++) dst[i] = DecodeFixed32(ptr + i * sizeof(uint32_t));
+}
+
+void DecodeFixed64ArrayScalar(const char *ptr, uint64_t *dst, size_t n) {
+  for (size_t i = 0; i < n; i++) dst[i] = DecodeFixed64(ptr + i * sizeof(uint64_t));
+}
+
+void DecodeDoubleArrayScalar(const char *ptr, double *dst, size_t n) {
+  for (size_t i = 0; i < n; i++) dst[i] = DecodeDouble(ptr + i * sizeof(uint64_t));
+}
+
+void DecodeFloatArrayScalar(const char *ptr, double *dst, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    uint32_t bits = DecodeFixed32(ptr + i * sizeof(uint32_t));
+    float value = 0;
+    __builtin_memcpy(&value, &bits, sizeof(value));
+    dst[i] = value;
+  }
+}
+
+#if defined(__x86_64__)
+
+// The x86 kernels are compiled for AVX2 only, and chosen by the CPU features at runtime
+
+__attribute__((target("avx2"))) __m256i LoadSwapped32AVX2(const char *ptr) {
+  const __m256i shuffle = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,  //
+                                           3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+  return _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(ptr)), shuffle);
+}
+
+__attribute__((target("avx2"))) __m256i LoadSwapped64AVX2(const char *ptr) {
+  const __m256i shuffle = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,  //
+                                           7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+  return _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(ptr)), shuffle);
+}
+
+__attribute__((target("avx2"))) void DecodeFixed32ArrayAVX2(const char *ptr, uint32_t *dst, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), LoadSwapped32AVX2(ptr + i * sizeof(uint32_t)));
+  }
+  DecodeFixed32ArrayScalar(ptr + i * sizeof(uint32_t), dst + i, n - i);
+}
+
+__attribute__((target("avx2"))) void DecodeFixed64ArrayAVX2(const char *ptr, uint64_t *dst, size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), LoadSwapped64AVX2(ptr + i * sizeof(uint64_t)));
+  }
+  DecodeFixed64ArrayScalar(ptr + i * sizeof(uint64_t), dst + i, n - i);
+}
+
+__attribute__((target("avx2"))) void DecodeDoubleArrayAVX2(const char *ptr, double *dst, size_t n) {
+  // the inverse of EncodeDoubleToUInt64: clear the sign bit of the values with it, and flip all bits of the others
+  const __m256i low_bits = _mm256_set1_epi64x(0x7fffffffffffffff);
+  const __m256i all_bits = _mm256_set1_epi64x(-1);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256i v = LoadSwapped64AVX2(ptr + i * sizeof(uint64_t));
+    __m256i with_sign = _mm256_cmpgt_epi64(_mm256_setzero_si256(), v);
+    __m256i mask = _mm256_xor_si256(_mm256_and_si256(with_sign, low_bits), all_bits);
+    _mm256_storeu_pd(dst + i, _mm256_castsi256_pd(_mm256_xor_si256(v, mask)));
+  }
+  DecodeDoubleArrayScalar(ptr + i * sizeof(uint64_t), dst + i, n - i);
+}
+
+__attribute__((target("avx2"))) void DecodeFloatArrayAVX2(const char *ptr, double *dst, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 v = _mm256_castsi256_ps(LoadSwapped32AVX2(ptr + i * sizeof(uint32_t)));
+    _mm256_storeu_pd(dst + i, _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+    _mm256_storeu_pd(dst + i + 4, _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+  }
+  DecodeFloatArrayScalar(ptr + i * sizeof(uint32_t), dst + i, n - i);
+}
+
+#elif defined(__aarch64__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+
+// NEON is always there on aarch64, so its kernels need no detection
+
+void DecodeFixed32ArrayNEON(const char *ptr, uint32_t *dst, size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    auto v = vrev32q_u8(vld1q_u8(reinterpret_cast<const uint8_t *>(ptr + i * sizeof(uint32_t))));
+    vst1q_u32(dst + i, vreinterpretq_u32_u8(v));
+  }
+  DecodeFixed32ArrayScalar(ptr + i * sizeof(uint32_t), dst + i, n - i);
+}
+
+void DecodeFixed64ArrayNEON(const char *ptr, uint64_t *dst, size_t n) {
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    auto v = vrev64q_u8(vld1q_u8(reinterpret_cast<const uint8_t *>(ptr + i * sizeof(uint64_t))));
+    vst1q_u64(dst + i, vreinterpretq_u64_u8(v));
+  }
+  DecodeFixed64ArrayScalar(ptr + i * sizeof(uint64_t), dst + i, n - i);
+}
+
+void DecodeDoubleArrayNEON(const char *ptr, double *dst, size_t n) {
+  // the inverse of EncodeDoubleToUInt64, see DecodeDoubleArrayAVX2
+  const uint64x2_t low_bits = vdupq_n_u64(0x7fffffffffffffff);
+  const uint64x2_t all_bits = vdupq_n_u64(UINT64_MAX);
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    auto v = vreinterpretq_u64_u8(vrev64q_u8(vld1q_u8(reinterpret_cast<const uint8_t *>(ptr + i * sizeof(uint64_t)))));
+    uint64x2_t with_sign = vcltzq_s64(vreinterpretq_s64_u64(v));
+    uint64x2_t mask = veorq_u64(vandq_u64(with_sign, low_bits), all_bits);
+    vst1q_f64(dst + i, vreinterpretq_f64_u64(veorq_u64(v, mask)));
+  }
+  DecodeDoubleArrayScalar(ptr + i * sizeof(uint64_t), dst + i, n - i);
+}
+
+void DecodeFloatArrayNEON(const char *ptr, double *dst, size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    auto v = vreinterpretq_f32_u8(vrev32q_u8(vld1q_u8(reinterpret_cast<const uint8_t *>(ptr + i * sizeof(uint32_t)))));
+    vst1q_f64(dst + i, vcvt_f64_f32(vget_low_f32(v)));
+    vst1q_f64(dst + i + 2, vcvt_high_f64_f32(v));
+  }
+  DecodeFloatArrayScalar(ptr + i * sizeof(uint32_t), dst + i, n - i);
+}
+
+#endif
+
+struct Kernels {
+  void (*decode_fixed32_array)(const char *, uint32_t *, size_t);
+  void (*decode_fixed64_array)(const char *, uint64_t *, size_t);
+  void (*decode_double_array)(const char *, double *, size_t);
+  void (*decode_float_array)(const char *, double *, size_t);
+};
+
+Kernels DetectKernels() {
+  Kernels kernels{DecodeFixed32ArrayScalar, DecodeFixed64ArrayScalar, DecodeDoubleArrayScalar,
+                  DecodeFloatArrayScalar};
+#if defined(__x86_64__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    kernels = {DecodeFixed32ArrayAVX2, DecodeFixed64ArrayAVX2, DecodeDoubleArrayAVX2, DecodeFloatArrayAVX2};
+  }
+#elif defined(__aarch64__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  kernels = {DecodeFixed32ArrayNEON, DecodeFixed64ArrayNEON, DecodeDoubleArrayNEON, DecodeFloatArrayNEON};
+#endif
+  return kernels;
+}
+
+const Kernels &GetKernels() {
+  static const Kernels kernels = DetectKernels();
+  return kernels;
+}
+
+}  // namespace
+
+void DecodeFixed32Array(const char *ptr, uint32_t *dst, size_t n) { GetKernels().decode_fixed32_array(ptr, dst, n); }
+
+void DecodeFixed64Array(const char *ptr, uint64_t *dst, size_t n) { GetKernels().decode_fixed64_array(ptr, dst, n); }
+
+void DecodeDoubleArray(const char *ptr, double *dst, size_t n) { GetKernels().decode_double_array(ptr, dst, n); }
+
+void DecodeFloatArray(const char *ptr, double *dst, size_t n) { GetKernels().decode_float_array(ptr, dst, n); }
+
 char *EncodeVarint32(char *dst, uint32_t v) {
   // Operate on characters as unsigneds
   auto *ptr = reinterpret_cast<unsigned char *>(dst);
@@ -122,6 +122,14 @@ void PutDouble(std::string *dst, double value);
 double DecodeDouble(const char *ptr);
 bool GetDouble(rocksdb::Slice *input, double *value);
 
+// The bulk decoders decode `n` consecutive values at `ptr` into `dst` like DecodeFixed32, DecodeFixed64 and
+// DecodeDouble, by the byte shuffles of AVX2 or NEON if the CPU has them
+void DecodeFixed32Array(const char *ptr, uint32_t *dst, size_t n);
+void DecodeFixed64Array(const char *ptr, uint64_t *dst, size_t n);
+void DecodeDoubleArray(const char *ptr, double *dst, size_t n);
+// DecodeFloatArray decodes the floats encoded as the EncodeFixed32 of their bits, and widens them to doubles
+void DecodeFloatArray(const char *ptr, double *dst, size_t n);
+
 char *EncodeVarint32(char *dst, uint32_t v);
 void PutVarint32(std::string *dst, uint32_t v);
 bool GetVarint32(rocksdb::Slice *input, uint32_t *value);
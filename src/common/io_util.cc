@@ -28,6 +28,9 @@
 #include <netinet/tcp.h>
 #include <poll.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+
+#include <climits>
 
 #include "fmt/ostream.h"
 #include "server/tls_util.h"
@@ -249,9 +252,8 @@ ssize_t SendFileSSLImpl(ssl_st *ssl, int in_fd, off_t offset, size_t count) {
 #endif
 
 template <auto F, typename FD, typename... Args>
-Status SockSendFileImpl(FD out_fd, int in_fd, size_t size, Args... args) {
+Status SockSendFileImpl(FD out_fd, int in_fd, off_t offset, size_t size, Args... args) {
   constexpr size_t BUFFER_SIZE = 16 * 1024;
-  off_t offset = 0;
   while (size != 0) {
     size_t n = size <= BUFFER_SIZE ? size : BUFFER_SIZE;
     ssize_t nwritten = F(out_fd, in_fd, offset, n, args...);
@@ -269,26 +271,38 @@ Status SockSendFileImpl(FD out_fd, int in_fd, size_t size, Args... args) {
 
 // Send file by sendfile actually according to different operation systems,
 // please note that, the out socket fd should be in blocking mode.
-Status SockSendFile(int out_fd, int in_fd, size_t size) { return SockSendFileImpl<SendFileImpl>(out_fd, in_fd, size); }
+Status SockSendFile(int out_fd, int in_fd, size_t size) {
+  return SockSendFileImpl<SendFileImpl>(out_fd, in_fd, 0, size);
+}
 
-Status SockSendFile(int out_fd, int in_fd, size_t size, [[maybe_unused]] ssl_st *ssl) {
+static Status SockSendFileRangeImpl(int out_fd, int in_fd, off_t offset, size_t size, [[maybe_unused]] ssl_st *ssl) {
 #ifdef ENABLE_OPENSSL
   if (ssl) {
-#if OPENSSL_VERSION_NUMBER >= 0x30000000L
-    return SockSendFileImpl<SSL_sendfile>(ssl, in_fd, size, 0);
-#else
-    return SockSendFileImpl<SendFileSSLImpl>(ssl, in_fd, size);
+#ifdef BIO_get_ktls_send
+    // SSL_sendfile only works when the kernel TLS is enabled for sending, see tls-ktls
+    if (BIO_get_ktls_send(SSL_get_wbio(ssl))) {
+      return SockSendFileImpl<SSL_sendfile>(ssl, in_fd, offset, size, 0);
+    }
 #endif
+    return SockSendFileImpl<SendFileSSLImpl>(ssl, in_fd, offset, size);
   }
 #endif
-  return SockSendFile(out_fd, in_fd, size);
+  return SockSendFileImpl<SendFileImpl>(out_fd, in_fd, offset, size);
+}
+
+Status SockSendFile(int out_fd, int in_fd, size_t size, ssl_st *ssl) {
+  return SockSendFileRangeImpl(out_fd, in_fd, 0, size, ssl);
 }
 
-Status SockSendFile(int out_fd, int in_fd, size_t size, [[maybe_unused]] bufferevent *bev) {
+Status SockSendFile(int out_fd, int in_fd, size_t size, bufferevent *bev) {
+  return SockSendFileRange(out_fd, in_fd, 0, size, bev);
+}
+
+Status SockSendFileRange(int out_fd, int in_fd, off_t offset, size_t size, [[maybe_unused]] bufferevent *bev) {
 #ifdef ENABLE_OPENSSL
-  return SockSendFile(out_fd, in_fd, size, bufferevent_openssl_get_ssl(bev));
+  return SockSendFileRangeImpl(out_fd, in_fd, offset, size, bufferevent_openssl_get_ssl(bev));
 #else
-  return SockSendFile(out_fd, in_fd, size);
+  return SockSendFileRangeImpl(out_fd, in_fd, offset, size, nullptr);
 #endif
 }
 
@@ -391,6 +405,8 @@ int AeWait(int fd, int mask, int timeout) {
   }
 }
 
+bool SockReadable(int fd) { return AeWait(fd, AE_READABLE, 0) > 0; }
+
 bool MatchListeningIP(std::vector<std::string> &binds, const std::string &ip) {
   if (std::find(binds.begin(), binds.end(), ip) != binds.end()) {
     return true;
@@ -471,6 +487,42 @@ Status SockSend(int fd, const std::string &data, [[maybe_unused]] bufferevent *b
 #endif
 }
 
+Status SockSendv(int fd, const std::vector<std::string_view> &bufs, [[maybe_unused]] bufferevent *bev) {
+#ifdef ENABLE_OPENSSL
+  if (auto ssl = bufferevent_openssl_get_ssl(bev)) {
+    for (const auto &buf : bufs) {
+      auto s = WriteImpl<SSL_write>(ssl, buf);
+      if (!s.IsOK()) return s;
+    }
+    return Status::OK();
+  }
+#endif
+
+  std::vector<iovec> iov;
+  iov.reserve(bufs.size());
+  for (const auto &buf : bufs) iov.push_back({const_cast<char *>(buf.data()), buf.size()});
+
+  size_t i = 0;
+  while (i < iov.size()) {
+    auto cnt = static_cast<int>(std::min(iov.size() - i, static_cast<size_t>(IOV_MAX)));
+    ssize_t nwritten = writev(fd, iov.data() + i, cnt);
+    if (nwritten == -1) {
+      return Status::FromErrno();
+    }
+    // skip the buffers written, and the written part of the next one
+    auto n = static_cast<size_t>(nwritten);
+    while (i < iov.size() && n >= iov[i].iov_len) {
+      n -= iov[i].iov_len;
+      i++;
+    }
+    if (n > 0) {
+      iov[i].iov_base = static_cast<char *>(iov[i].iov_base) + n;
+      iov[i].iov_len -= n;
+    }
+  }
+  return Status::OK();
+}
+
 StatusOr<int> SockConnect(const std::string &host, uint32_t port, [[maybe_unused]] ssl_st *ssl, int conn_timeout,
                           int timeout) {
 #ifdef ENABLE_OPENSSL
@@ -22,6 +22,9 @@
 
 #include <netinet/in.h>
 
+#include <string_view>
+#include <vector>
+
 #include "status.h"
 
 // forward declarations
@@ -48,14 +51,20 @@ bool MatchListeningIP(std::vector<std::string> &binds, const std::string &ip);
 std::vector<std::string> GetLocalIPAddresses();
 
 int AeWait(int fd, int mask, int milliseconds);
+// SockReadable returns true if a read of the socket doesn't block, i.e. there's data or the socket is closed
+bool SockReadable(int fd);
 Status Write(int fd, const std::string &data);
 Status Pwrite(int fd, const std::string &data, off_t offset);
 
 Status SockSend(int fd, const std::string &data, ssl_st *ssl);
 Status SockSend(int fd, const std::string &data, bufferevent *bev);
+// SockSendv sends the buffers in order by writev, or one by one if the connection is over TLS
+Status SockSendv(int fd, const std::vector<std::string_view> &bufs, bufferevent *bev);
 
 Status SockSendFile(int out_fd, int in_fd, size_t size, ssl_st *ssl);
 Status SockSendFile(int out_fd, int in_fd, size_t size, bufferevent *bev);
+// SockSendFileRange sends the size bytes of the file from the offset
+Status SockSendFileRange(int out_fd, int in_fd, off_t offset, size_t size, bufferevent *bev);
 
 StatusOr<int> SockConnect(const std::string &host, uint32_t port, ssl_st *ssl, int conn_timeout = 0, int timeout = 0);
 StatusOr<int> EvbufferRead(evbuffer *buf, int fd, int howmuch, ssl_st *ssl);
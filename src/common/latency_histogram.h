@@ -0,0 +1,99 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// LatencyHistogram is a HdrHistogram-like log-linear histogram of durations in microseconds.
+// Every power of two range is split into kSubBuckets linear buckets, so recording is just
+// a bit scan plus a relaxed atomic increment, and the relative error of a value is below 1/kSubBuckets.
+class LatencyHistogram {
+ public:
+  static constexpr unsigned kSubBucketBits = 3;
+  static constexpr uint64_t kSubBuckets = 1ULL << kSubBucketBits;
+  // values from 2^kMaxValueBits us (about 19 hours) on fall into the last bucket
+  static constexpr unsigned kMaxValueBits = 36;
+  static constexpr size_t kBuckets = (kMaxValueBits - kSubBucketBits + 1) * kSubBuckets;
+
+  struct Snapshot {
+    uint64_t count = 0;
+    std::array<uint64_t, kBuckets> buckets{};
+
+    // Percentile returns the upper bound of the bucket holding the p-th (0 < p <= 100) percentile
+    uint64_t Percentile(double p) const {
+      if (count == 0) return 0;
+      auto rank = static_cast<uint64_t>(p / 100 * static_cast<double>(count));
+      if (rank == 0) rank = 1;
+      uint64_t seen = 0;
+      for (size_t i = 0; i < kBuckets; i++) {
+        seen += buckets[i];
+        if (seen >= rank) return BucketUpperBound(i);
+      }
+      return BucketUpperBound(kBuckets - 1);
+    }
+
+    // Since returns the values recorded between the earlier snapshot and this one
+    Snapshot Since(const Snapshot &earlier) const {
+      Snapshot delta;
+      for (size_t i = 0; i < kBuckets; i++) {
+        delta.buckets[i] = buckets[i] - earlier.buckets[i];
+      }
+      delta.count = count - earlier.count;
+      return delta;
+    }
+  };
+
+  LatencyHistogram() = default;
+  LatencyHistogram(const LatencyHistogram &) = delete;
+  LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+
+  void Record(uint64_t us) { buckets_[BucketIndex(us)].fetch_add(1, std::memory_order_relaxed); }
+
+  Snapshot GetSnapshot() const {
+    Snapshot snapshot;
+    for (size_t i = 0; i < kBuckets; i++) {
+      snapshot.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+      snapshot.count += snapshot.buckets[i];
+    }
+    return snapshot;
+  }
+
+  static size_t BucketIndex(uint64_t us) {
+    if (us < kSubBuckets) return us;
+    unsigned msb = 63 - __builtin_clzll(us);
+    if (msb >= kMaxValueBits) return kBuckets - 1;
+    unsigned shift = msb - kSubBucketBits;
+    return (shift + 1) * kSubBuckets + ((us >> shift) & (kSubBuckets - 1));
+  }
+
+  static uint64_t BucketUpperBound(size_t index) {
+    if (index < kSubBuckets) return index;
+    auto shift = index / kSubBuckets - 1;
+    auto lower = (kSubBuckets + index % kSubBuckets) << shift;
+    return lower + (1ULL << shift) - 1;
+  }
+
+ private:
+  std::array<std::atomic<uint64_t>, kBuckets> buckets_{};
+};
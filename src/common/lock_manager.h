@@ -22,16 +22,23 @@
 
 #include <rocksdb/db.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <functional>
+#include <iterator>
 #include <mutex>
-#include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "latency_histogram.h"
+
 class LockManager {
  public:
   explicit LockManager(unsigned hash_power)
-      : hash_power_(hash_power), hash_mask_((1U << hash_power) - 1), mutex_pool_(Size()) {}
+      : hash_power_(hash_power), hash_mask_((1U << hash_power) - 1), stripes_(Size()) {}
   ~LockManager() = default;
 
   LockManager(const LockManager &) = delete;
@@ -39,52 +46,140 @@ class LockManager {
 
   unsigned Size() const { return (1U << hash_power_); }
 
-  void Lock(std::string_view key) { mutex_pool_[hash(key)].lock(); }
-  void UnLock(std::string_view key) { mutex_pool_[hash(key)].unlock(); }
+  void Lock(std::string_view key) { acquire(hash(key)); }
+  void UnLock(std::string_view key) { stripes_[hash(key)].mutex.unlock(); }
   void Lock(rocksdb::Slice key) { Lock(key.ToStringView()); }
   void UnLock(rocksdb::Slice key) { UnLock(key.ToStringView()); }
 
+  // Contended acquisitions are timed into the histogram, if any
+  void SetWaitHistogram(LatencyHistogram *histogram) { wait_histogram_ = histogram; }
+
   template <typename Key>
   std::mutex *Get(const Key &key) {
-    return &mutex_pool_[hash(key)];
+    return &stripes_[hash(key)].mutex;
+  }
+
+  // Lock the stripe of the key and return its mutex, or nullptr if it's pinned by this thread
+  template <typename Key>
+  std::mutex *Acquire(const Key &key) {
+    auto index = hash(key);
+    if (isPinned(index)) return nullptr;
+    acquire(index);
+    return &stripes_[index].mutex;
   }
 
+  // Lock the stripes of all keys, `indexes` must have room for one index per key.
+  // Returns the number of distinct stripes locked, which are left in `indexes`
+  // in the acquisition order.
+  //
+  // Keys with the same stripe are only locked once, otherwise we would deadlock on
+  // ourselves. The stripes are also acquired in a global order since different
+  // threads may lock the same keys in different orders. Sorting a flat array is much
+  // cheaper than building a `std::set` for the handful of keys a command carries.
   template <typename Keys>
-  std::vector<std::mutex *> MultiGet(const Keys &keys) {
-    std::set<unsigned, std::greater<unsigned>> to_acquire_indexes;
-    // We are using the `set` to avoid retrieving the mutex, as well as guarantee to retrieve
-    // the order of locks.
-    //
-    // For example, we need lock the key `A` and `B` and they have the same lock hash
-    // index, it will be deadlock if lock the same mutex twice. Besides, we also need
-    // to order the mutex before acquiring locks since different threads may acquire
-    // same keys with different order.
+  size_t MultiLock(const Keys &keys, unsigned *indexes) {
+    size_t n = 0;
     for (const auto &key : keys) {
-      to_acquire_indexes.insert(hash(key));
+      indexes[n++] = hash(key);
+    }
+    std::sort(indexes, indexes + n, std::greater<unsigned>());
+    n = std::unique(indexes, indexes + n) - indexes;
+    if (pinned_.owner == this) {
+      n = std::remove_if(indexes, indexes + n, [this](unsigned index) { return isPinned(index); }) - indexes;
     }
 
-    std::vector<std::mutex *> locks;
-    locks.reserve(to_acquire_indexes.size());
-    for (auto index : to_acquire_indexes) {
-      locks.emplace_back(&mutex_pool_[index]);
+    for (size_t i = 0; i < n; i++) {
+      acquire(indexes[i]);
     }
-    return locks;
+    return n;
+  }
+
+  void MultiUnLock(const unsigned *indexes, size_t n) {
+    // Lock with order `A B C` and unlock should be `C B A`
+    for (size_t i = n; i > 0; i--) {
+      stripes_[indexes[i - 1]].mutex.unlock();
+    }
+  }
+
+  // While stripes are pinned, the lock guards of this thread skip them, since they are held already.
+  // `indexes` must be sorted as MultiLock leaves them.
+  void Pin(const unsigned *indexes, size_t n) { pinned_ = PinnedStripes{this, indexes, n}; }
+  void Unpin() { pinned_ = PinnedStripes{}; }
+
+  uint64_t GetContentions() const {
+    uint64_t total = 0;
+    for (const auto &stripe : stripes_) {
+      total += stripe.contentions.load(std::memory_order_relaxed);
+    }
+    return total;
+  }
+
+  // Returns up to `n` (stripe index, contentions) pairs of the most contended stripes
+  std::vector<std::pair<unsigned, uint64_t>> GetHotStripes(size_t n) const {
+    std::vector<std::pair<unsigned, uint64_t>> hot;
+    for (unsigned i = 0; i < stripes_.size(); i++) {
+      auto contentions = stripes_[i].contentions.load(std::memory_order_relaxed);
+      if (contentions > 0) hot.emplace_back(i, contentions);
+    }
+    auto cmp = [](const auto &a, const auto &b) { return a.second > b.second; };
+    if (hot.size() > n) {
+      std::partial_sort(hot.begin(), hot.begin() + static_cast<std::ptrdiff_t>(n), hot.end(), cmp);
+      hot.resize(n);
+    } else {
+      std::sort(hot.begin(), hot.end(), cmp);
+    }
+    return hot;
   }
 
  private:
+  // Each stripe sits on its own cache line, so threads locking neighbouring
+  // stripes don't bounce the same line around
+  struct alignas(64) Stripe {
+    std::mutex mutex;
+    std::atomic<uint64_t> contentions{0};
+  };
+
   unsigned hash_power_;
   unsigned hash_mask_;
-  std::vector<std::mutex> mutex_pool_;
+  std::vector<Stripe> stripes_;
+  LatencyHistogram *wait_histogram_ = nullptr;
+
+  // Zero initialized as a thread local
+  struct PinnedStripes {
+    const LockManager *owner;
+    const unsigned *indexes;
+    size_t size;
+  };
+  static inline thread_local PinnedStripes pinned_;
 
   unsigned hash(std::string_view key) const { return std::hash<std::string_view>{}(key)&hash_mask_; }
+
+  bool isPinned(unsigned index) const {
+    if (pinned_.owner != this) return false;
+    return std::binary_search(pinned_.indexes, pinned_.indexes + pinned_.size, index, std::greater<unsigned>());
+  }
+
+  void acquire(unsigned index) {
+    auto &stripe = stripes_[index];
+    if (stripe.mutex.try_lock()) return;
+
+    stripe.contentions.fetch_add(1, std::memory_order_relaxed);
+    if (!wait_histogram_) {
+      stripe.mutex.lock();
+      return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    stripe.mutex.lock();
+    auto end = std::chrono::steady_clock::now();
+    wait_histogram_->Record(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+  }
 };
 
 class LockGuard {
  public:
   template <typename KeyType>
-  explicit LockGuard(LockManager *lock_mgr, const KeyType &key) : lock_(lock_mgr->Get(key)) {
-    lock_->lock();
-  }
+  explicit LockGuard(LockManager *lock_mgr, const KeyType &key) : lock_(lock_mgr->Acquire(key)) {}
   ~LockGuard() {
     if (lock_) lock_->unlock();
   }
@@ -109,24 +204,59 @@ class LockGuard {
 class MultiLockGuard {
  public:
   template <typename Keys>
-  explicit MultiLockGuard(LockManager *lock_mgr, const Keys &keys) : locks_(lock_mgr->MultiGet(keys)) {
-    for (const auto &iter : locks_) {
-      iter->lock();
+  explicit MultiLockGuard(LockManager *lock_mgr, const Keys &keys) : lock_mgr_(lock_mgr) {
+    size_t n = std::size(keys);
+    if (n > kInlineLocks) {
+      heap_indexes_.resize(n);
+      indexes_ = heap_indexes_.data();
     }
+    size_ = lock_mgr_->MultiLock(keys, indexes_);
   }
 
   ~MultiLockGuard() {
-    // Lock with order `A B C` and unlock should be `C B A`
-    for (auto iter = locks_.rbegin(); iter != locks_.rend(); ++iter) {
-      (*iter)->unlock();
-    }
+    if (size_ > 0) lock_mgr_->MultiUnLock(indexes_, size_);
   }
 
   MultiLockGuard(const MultiLockGuard &) = delete;
   MultiLockGuard &operator=(const MultiLockGuard &) = delete;
 
-  MultiLockGuard(MultiLockGuard &&guard) : locks_(std::move(guard.locks_)) {}
+  MultiLockGuard(MultiLockGuard &&guard) noexcept
+      : lock_mgr_(guard.lock_mgr_),
+        inline_indexes_(guard.inline_indexes_),
+        heap_indexes_(std::move(guard.heap_indexes_)),
+        size_(guard.size_) {
+    indexes_ = guard.indexes_ == guard.inline_indexes_.data() ? inline_indexes_.data() : heap_indexes_.data();
+    guard.size_ = 0;
+  }
+
+ private:
+  friend class TxnLockGuard;
+
+  // Most commands lock a few keys, keep their stripe indexes inline to avoid allocating
+  static constexpr size_t kInlineLocks = 8;
+
+  LockManager *lock_mgr_;
+  std::array<unsigned, kInlineLocks> inline_indexes_;
+  std::vector<unsigned> heap_indexes_;
+  unsigned *indexes_ = inline_indexes_.data();
+  size_t size_ = 0;
+};
+
+// TxnLockGuard locks the keys of a whole transaction upfront. The lock guards taken by
+// its commands on the same thread skip the stripes which are held already, so they
+// neither deadlock on themselves nor release the locks before the commit.
+class TxnLockGuard {
+ public:
+  template <typename Keys>
+  explicit TxnLockGuard(LockManager *lock_mgr, const Keys &keys) : lock_mgr_(lock_mgr), guard_(lock_mgr, keys) {
+    lock_mgr_->Pin(guard_.indexes_, guard_.size_);
+  }
+  ~TxnLockGuard() { lock_mgr_->Unpin(); }
+
+  TxnLockGuard(const TxnLockGuard &) = delete;
+  TxnLockGuard &operator=(const TxnLockGuard &) = delete;
 
  private:
-  std::vector<std::mutex *> locks_;
+  LockManager *lock_mgr_;
+  MultiLockGuard guard_;
 };
@@ -76,3 +76,29 @@ Status RdbFileStream::Read(char *buf, size_t len) {
   }
   return Status::OK();
 }
+
+Status RdbFileWriteStream::Open() {
+  ofs_.open(file_name_, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+  if (!ofs_.is_open()) {
+    return {Status::NotOK, fmt::format("failed to open rdb file: '{}': {}", file_name_, strerror(errno))};
+  }
+
+  return Status::OK();
+}
+
+Status RdbFileWriteStream::Write(const char *buf, size_t len) {
+  ofs_.write(buf, static_cast<std::streamsize>(len));
+  if (!ofs_.good()) {
+    return {Status::NotOK, fmt::format("write failed: {}", strerror(errno))};
+  }
+  check_sum_ = crc64(check_sum_, reinterpret_cast<const unsigned char *>(buf), len);
+  return Status::OK();
+}
+
+Status RdbFileWriteStream::Close() {
+  ofs_.close();
+  if (ofs_.fail()) {
+    return {Status::NotOK, fmt::format("failed to close rdb file: '{}': {}", file_name_, strerror(errno))};
+  }
+  return Status::OK();
+}
@@ -88,3 +88,30 @@ class RdbFileStream : public RdbStream {
   size_t total_read_bytes_;
   size_t max_read_chunk_size_;  // maximum single read chunk size
 };
+
+// RdbFileWriteStream writes an RDB file, the checksum is computed from the written bytes
+class RdbFileWriteStream : public RdbStream {
+ public:
+  explicit RdbFileWriteStream(std::string file_name) : file_name_(std::move(file_name)) {}
+  RdbFileWriteStream(const RdbFileWriteStream &) = delete;
+  RdbFileWriteStream &operator=(const RdbFileWriteStream &) = delete;
+  ~RdbFileWriteStream() override = default;
+
+  Status Open();
+  Status Read([[maybe_unused]] char *buf, [[maybe_unused]] size_t len) override {
+    return {Status::NotOK, fmt::format("No implement")};
+  };
+  Status Write(const char *buf, size_t len) override;
+  StatusOr<uint64_t> GetCheckSum() const override {
+    uint64_t crc = check_sum_;
+    memrev64ifbe(&crc);
+    return crc;
+  }
+  // Close flushes the written bytes to the file
+  Status Close();
+
+ private:
+  std::ofstream ofs_;
+  std::string file_name_;
+  uint64_t check_sum_ = 0;
+};
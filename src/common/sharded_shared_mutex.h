@@ -0,0 +1,81 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <shared_mutex>
+
+// A reader-writer mutex for read-mostly state, where the cost of a shared
+// acquisition matters more than an exclusive one.
+//
+// Every thread takes its shared locks on one of the shards, so readers on
+// different threads touch different cache lines instead of all bouncing the
+// reader count of a single std::shared_mutex. An exclusive lock has to take
+// every shard, which is fine as long as writers are rare.
+//
+// It meets the SharedMutex requirements and works with std::shared_lock and
+// std::unique_lock. A shared lock must be released by the thread that took it.
+class ShardedSharedMutex {
+ public:
+  static constexpr size_t kShards = 32;
+
+  ShardedSharedMutex() = default;
+  ShardedSharedMutex(const ShardedSharedMutex &) = delete;
+  ShardedSharedMutex &operator=(const ShardedSharedMutex &) = delete;
+
+  void lock() {  // NOLINT
+    for (auto &shard : shards_) shard.mutex.lock();
+  }
+
+  bool try_lock() {  // NOLINT
+    for (size_t i = 0; i < kShards; i++) {
+      if (!shards_[i].mutex.try_lock()) {
+        while (i > 0) shards_[--i].mutex.unlock();
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void unlock() {  // NOLINT
+    for (auto iter = shards_.rbegin(); iter != shards_.rend(); ++iter) iter->mutex.unlock();
+  }
+
+  void lock_shared() { shards_[threadShard()].mutex.lock_shared(); }  // NOLINT
+
+  bool try_lock_shared() { return shards_[threadShard()].mutex.try_lock_shared(); }  // NOLINT
+
+  void unlock_shared() { shards_[threadShard()].mutex.unlock_shared(); }  // NOLINT
+
+ private:
+  struct alignas(64) Shard {
+    std::shared_mutex mutex;
+  };
+
+  std::array<Shard, kShards> shards_;
+
+  static size_t threadShard() {
+    static std::atomic<size_t> next_shard{0};
+    thread_local size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % kShards;
+    return shard;
+  }
+};
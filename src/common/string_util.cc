@@ -47,6 +47,16 @@ bool EqualICase(std::string_view lhs, std::string_view rhs) {
                                                 [](char l, char r) { return std::tolower(l) == std::tolower(r); });
 }
 
+bool ConstantTimeEqual(std::string_view lhs, std::string_view rhs) {
+  // only the length of rhs, i.e. the input, decides the time
+  unsigned diff = lhs.size() != rhs.size();
+  for (size_t i = 0; i < rhs.size(); i++) {
+    unsigned l = i < lhs.size() ? static_cast<unsigned char>(lhs[i]) : 0;
+    diff |= l ^ static_cast<unsigned char>(rhs[i]);
+  }
+  return diff == 0;
+}
+
 std::string Trim(std::string in, std::string_view chars) {
   if (in.empty()) return in;
 
@@ -215,6 +225,18 @@ int StringMatchLen(const char *pattern, size_t pattern_len, const char *string,
   return 0;
 }
 
+std::string StringMatchPrefix(std::string_view pattern) {
+  std::string prefix;
+  for (size_t i = 0; i < pattern.size(); i++) {
+    if (pattern[i] == '*' || pattern[i] == '?' || pattern[i] == '[') break;
+    if (pattern[i] == '\\') {
+      if (++i == pattern.size()) break;
+    }
+    prefix.push_back(pattern[i]);
+  }
+  return prefix;
+}
+
 std::vector<std::string> RegexMatch(const std::string &str, const std::string &regex) {
   std::regex base_regex(regex);
   std::smatch pieces_match;
@@ -27,6 +27,8 @@ namespace util {
 std::string Float2String(double d);
 std::string ToLower(std::string in);
 bool EqualICase(std::string_view lhs, std::string_view rhs);
+// ConstantTimeEqual doesn't stop at the first difference, so the time doesn't leak a secret like a password
+bool ConstantTimeEqual(std::string_view lhs, std::string_view rhs);
 std::string BytesToHuman(uint64_t n);
 std::string Trim(std::string in, std::string_view chars);
 std::vector<std::string> Split(std::string_view in, std::string_view delim);
@@ -34,6 +36,8 @@ std::vector<std::string> Split2KV(const std::string &in, const std::string &deli
 bool HasPrefix(const std::string &str, const std::string &prefix);
 int StringMatch(const std::string &pattern, const std::string &in, int nocase);
 int StringMatchLen(const char *p, size_t plen, const char *s, size_t slen, int nocase);
+// StringMatchPrefix returns the literal prefix of the glob-style pattern, which every string it matches starts with
+std::string StringMatchPrefix(std::string_view pattern);
 std::vector<std::string> RegexMatch(const std::string &str, const std::string &regex);
 std::string StringToHex(std::string_view input);
 std::vector<std::string> TokenizeRedisProtocol(const std::string &value);
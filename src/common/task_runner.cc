@@ -20,10 +20,48 @@
 
 #include "task_runner.h"
 
+#include <glog/logging.h>
+
 #include <thread>
 
-#include "oneapi/tbb/concurrent_queue.h"
 #include "thread_util.h"
+#include "time_util.h"
+
+namespace {
+
+// the runner and the index of the current thread, so the tasks published from a task go to its own deque
+thread_local const TaskRunner *current_runner = nullptr;
+thread_local size_t current_index = 0;
+
+}  // namespace
+
+void TaskRunner::Publish(Task task, TaskPriority priority, std::string type) {
+  if (!reserve(true)) return;
+  push(std::move(task), priority, std::move(type));
+}
+
+Status TaskRunner::TryPublish(Task task, TaskPriority priority, std::string type) {
+  if (!reserve(false)) {
+    return {Status::NotOK, "Task number limit is exceeded"};
+  }
+
+  push(std::move(task), priority, std::move(type));
+  return Status::OK();
+}
+
+void TaskRunner::Cancel() {
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    state_ = Stopping;
+  }
+  task_cv_.notify_all();
+  room_cv_.notify_all();
+}
+
+std::map<std::string, TaskStats> TaskRunner::GetStats() const {
+  std::lock_guard<std::mutex> guard(stats_mu_);
+  return stats_;
+}
 
 Status TaskRunner::Start() {
   if (state_ != Stopped) {
@@ -31,8 +69,11 @@ Status TaskRunner::Start() {
   }
 
   state_ = Running;
-  for (auto &thread : threads_) {
-    thread = GET_OR_RET(util::CreateThread("task-runner", [this] { run(); }));
+  for (size_t i = 0; i < threads_.size(); i++) {
+    threads_[i] = GET_OR_RET(util::CreateThread("task-runner", [this, i] { run(i); }));
+    if (auto s = util::ThreadSetAffinity(threads_[i], cpus_); !s) {
+      LOG(WARNING) << "Failed to pin the task runner thread: " << s.Msg();
+    }
   }
 
   return Status::OK();
@@ -50,24 +91,105 @@ Status TaskRunner::Join() {
     }
   }
 
-  task_queue_.clear();
+  for (auto &queue : queues_) {
+    std::lock_guard<std::mutex> guard(queue.mu);
+    for (auto &tasks : queue.tasks) tasks.clear();
+  }
+  size_ = 0;
   state_ = Stopped;
 
   return Status::OK();
 }
 
-void TaskRunner::run() {
-  while (state_ == Running) {
-    Task task;
+bool TaskRunner::reserve(bool wait) {
+  auto size = size_.load();
+  while (true) {
+    if (size < max_queue_size_) {
+      if (size_.compare_exchange_weak(size, size + 1)) return true;
+      continue;
+    }
+    if (!wait || state_ == Stopping) return false;
+
+    std::unique_lock<std::mutex> lock(mu_);
+    waiting_publishers_++;
+    room_cv_.wait(lock, [this] { return state_ == Stopping || size_ < max_queue_size_; });
+    waiting_publishers_--;
+    size = size_.load();
+  }
+}
+
+void TaskRunner::push(Task task, TaskPriority priority, std::string type) {
+  size_t index = 0;
+  if (current_runner == this) {
+    index = current_index;
+  } else {
+    index = next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+  }
+
+  {
+    auto &queue = queues_[index];
+    std::lock_guard<std::mutex> guard(queue.mu);
+    queue.tasks[static_cast<size_t>(priority)].push_back(
+        QueuedTask{std::move(task), std::move(type), util::GetTimeStampUS()});
+  }
+
+  // An idle thread counts itself before it checks the size, so either it sees the task or it's counted here
+  if (idle_threads_ > 0) {
+    { std::lock_guard<std::mutex> guard(mu_); }
+    task_cv_.notify_one();
+  }
+}
 
-    try {
-      task_queue_.pop(task);
-    } catch (tbb::user_abort &e) {
-      break;
+bool TaskRunner::pop(size_t index, QueuedTask *task) {
+  auto n_queues = queues_.size();
+  for (auto priority : {TaskPriority::kHigh, TaskPriority::kLow}) {
+    // the own deque first, then steal from the others
+    for (size_t i = 0; i < n_queues; i++) {
+      auto &queue = queues_[(index + i) % n_queues];
+      std::lock_guard<std::mutex> guard(queue.mu);
+      auto &tasks = queue.tasks[static_cast<size_t>(priority)];
+      if (tasks.empty()) continue;
+
+      *task = std::move(tasks.front());
+      tasks.pop_front();
+      size_--;
+      if (waiting_publishers_ > 0) {
+        { std::lock_guard<std::mutex> room_guard(mu_); }
+        room_cv_.notify_one();
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+void TaskRunner::run(size_t index) {
+  current_runner = this;
+  current_index = index;
+
+  while (state_ == Running) {
+    QueuedTask task;
+    if (!pop(index, &task)) {
+      std::unique_lock<std::mutex> lock(mu_);
+      idle_threads_++;
+      task_cv_.wait(lock, [this] { return state_ != Running || size_ > 0; });
+      idle_threads_--;
+      continue;
     }
 
     if (state_ != Running) break;
+    if (!task.task) continue;
 
-    if (task) task();
+    auto start = util::GetTimeStampUS();
+    task.task();
+    auto end = util::GetTimeStampUS();
+
+    std::lock_guard<std::mutex> guard(stats_mu_);
+    auto &stats = stats_[task.type];
+    stats.count++;
+    stats.queue_time_us += start > task.enqueue_time_us ? start - task.enqueue_time_us : 0;
+    stats.run_time_us += end > start ? end - start : 0;
   }
+
+  current_runner = nullptr;
 }
@@ -20,25 +20,45 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
+#include <deque>
 #include <functional>
+#include <map>
+#include <mutex>
+#include <string>
 #include <thread>
+#include <vector>
 
-#include "oneapi/tbb/concurrent_queue.h"
 #include "status.h"
 
 using Task = std::function<void()>;
 
+// The tasks of high priority, e.g. lazy free and heavy commands, are latency-sensitive,
+// and are always taken before the bulk ones of low priority, e.g. compaction and bgsave.
+enum class TaskPriority { kHigh, kLow };
+
+struct TaskStats {
+  uint64_t count = 0;
+  uint64_t queue_time_us = 0;
+  uint64_t run_time_us = 0;
+};
+
+// TaskRunner runs the tasks in a fixed pool of threads.
+//
+// Every thread owns a deque of each priority. The tasks published from outside are spread
+// over the deques in turn, and the ones published from a task go to the deque of its thread.
+// A thread takes the tasks of its own deque first, and steals from the deques of the others
+// when it's empty, so a long task never holds the tasks queued behind it.
 class TaskRunner {
  public:
   static constexpr uint32_t default_n_threads = 1;
   static constexpr uint32_t default_max_queue_size = 10240;
 
   explicit TaskRunner(size_t n_threads = default_n_threads, ptrdiff_t max_queue_size = default_max_queue_size)
-      : threads_(n_threads) {
-    task_queue_.set_capacity(max_queue_size);
-  }
+      : max_queue_size_(static_cast<size_t>(max_queue_size)), threads_(n_threads), queues_(n_threads) {}
 
   TaskRunner(const TaskRunner&) = delete;
   TaskRunner& operator=(const TaskRunner&) = delete;
@@ -50,35 +70,57 @@ class TaskRunner {
     }
   }
 
-  template <typename T>
-  void Publish(T&& task) {
-    task_queue_.push(std::forward<T>(task));
-  }
+  // Publish waits until there's room in the queue, the task is dropped if the runner is cancelled meanwhile
+  void Publish(Task task, TaskPriority priority = TaskPriority::kHigh, std::string type = "task");
+  Status TryPublish(Task task, TaskPriority priority = TaskPriority::kHigh, std::string type = "task");
 
-  template <typename T>
-  Status TryPublish(T&& task) {
-    if (!task_queue_.try_push(std::forward<T>(task))) {
-      return {Status::NotOK, "Task number limit is exceeded"};
-    }
+  size_t Size() const { return size_; }
+  void Cancel();
 
-    return Status::OK();
-  }
+  // SetCPUAffinity pins the threads to the CPUs, it takes effect on the next start
+  void SetCPUAffinity(std::vector<int> cpus) { cpus_ = std::move(cpus); }
 
-  size_t Size() const { return task_queue_.size(); }
-  void Cancel() {
-    state_ = Stopping;
-    task_queue_.abort();
-  }
+  // GetStats returns the number, the total queue time and the total run time of the finished tasks by type
+  std::map<std::string, TaskStats> GetStats() const;
 
   Status Start();
   Status Join();
 
  private:
-  void run();
+  struct QueuedTask {
+    Task task;
+    std::string type;
+    uint64_t enqueue_time_us;
+  };
+
+  struct WorkerQueue {
+    std::mutex mu;
+    std::deque<QueuedTask> tasks[2];
+  };
+
+  bool reserve(bool wait);
+  void push(Task task, TaskPriority priority, std::string type);
+  bool pop(size_t index, QueuedTask* task);
+  void run(size_t index);
 
   enum State { Running, Stopping, Stopped };
 
   std::atomic<State> state_ = Stopped;
-  tbb::concurrent_bounded_queue<Task> task_queue_;
+  size_t max_queue_size_;
+  // the number of the queued tasks, which is increased before a task is pushed to reserve the room
+  std::atomic<size_t> size_ = 0;
+  std::atomic<size_t> next_queue_ = 0;
   std::vector<std::thread> threads_;
+  std::vector<WorkerQueue> queues_;
+  std::vector<int> cpus_;
+
+  // the idle threads wait for new tasks, and the publishers wait for the room of the full queue on mu_
+  std::mutex mu_;
+  std::condition_variable task_cv_;
+  std::condition_variable room_cv_;
+  std::atomic<size_t> idle_threads_ = 0;
+  std::atomic<size_t> waiting_publishers_ = 0;
+
+  mutable std::mutex stats_mu_;
+  std::map<std::string, TaskStats> stats_;
 };
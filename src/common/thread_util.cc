@@ -22,6 +22,11 @@
 
 #include <fmt/std.h>
 #include <pthread.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include <cstring>
 
 namespace util {
 
@@ -48,4 +53,23 @@ Status ThreadJoin(std::thread &t) { return ThreadOperationImpl<&std::thread::joi
 
 Status ThreadDetach(std::thread &t) { return ThreadOperationImpl<&std::thread::detach>(t, "detach"); }
 
+static Status ThreadSetAffinityImpl([[maybe_unused]] pthread_t thread, const std::vector<int> &cpus) {
+  if (cpus.empty()) return Status::OK();
+#ifdef __linux__
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (auto cpu : cpus) CPU_SET(cpu, &cpu_set);
+  if (auto err = pthread_setaffinity_np(thread, sizeof(cpu_set), &cpu_set); err != 0) {
+    return {Status::NotOK, fmt::format("failed to set the CPU affinity of the thread: {}", strerror(err))};
+  }
+#endif
+  return Status::OK();
+}
+
+Status ThreadSetAffinity(std::thread &t, const std::vector<int> &cpus) {
+  return ThreadSetAffinityImpl(t.native_handle(), cpus);
+}
+
+Status ThreadSetAffinity(const std::vector<int> &cpus) { return ThreadSetAffinityImpl(pthread_self(), cpus); }
+
 }  // namespace util
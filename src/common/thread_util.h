@@ -22,6 +22,7 @@
 
 #include <system_error>
 #include <thread>
+#include <vector>
 
 #include "fmt/core.h"
 #include "status.h"
@@ -45,4 +46,9 @@ StatusOr<std::thread> CreateThread(const char *name, F f) {
 Status ThreadJoin(std::thread &t);
 Status ThreadDetach(std::thread &t);
 
+// ThreadSetAffinity pins the thread to the CPUs, it does nothing if there's no CPU or the platform isn't Linux
+Status ThreadSetAffinity(std::thread &t, const std::vector<int> &cpus);
+// ThreadSetAffinity pins the current thread to the CPUs
+Status ThreadSetAffinity(const std::vector<int> &cpus);
+
 }  // namespace util
@@ -67,7 +67,8 @@ const std::vector<ConfigEnum<int>> log_levels{
 };
 
 const std::vector<ConfigEnum<JsonStorageFormat>> json_storage_formats{{"json", JsonStorageFormat::JSON},
-                                                                      {"cbor", JsonStorageFormat::CBOR}};
+                                                                      {"cbor", JsonStorageFormat::CBOR},
+                                                                      {"split", JsonStorageFormat::Split}};
 
 const std::vector<ConfigEnum<rocksdb::CompressionType>> compression_types{[] {
   std::vector<ConfigEnum<rocksdb::CompressionType>> res;
@@ -87,8 +88,73 @@ const std::vector<ConfigEnum<BlockCacheType>> cache_types{[] {
   return res;
 }()};
 
+const std::vector<ConfigEnum<FilterPolicyType>> filter_policies{
+    {"bloom", FilterPolicyType::kBloom},
+    {"ribbon", FilterPolicyType::kRibbon},
+};
+
+const std::vector<ConfigEnum<MemtableType>> memtable_types{
+    {"skiplist", MemtableType::kSkipList},
+    {"hash-skiplist", MemtableType::kHashSkipList},
+    {"hash-linklist", MemtableType::kHashLinkList},
+};
+
+const std::vector<ConfigEnum<HugePageMode>> huge_page_modes{
+    {"no", HugePageMode::kNone},
+    {"transparent", HugePageMode::kTransparent},
+    {"explicit", HugePageMode::kExplicit},
+};
+
+const std::vector<ConfigEnum<rocksdb::Temperature>> temperatures{
+    {"unknown", rocksdb::Temperature::kUnknown},
+    {"hot", rocksdb::Temperature::kHot},
+    {"warm", rocksdb::Temperature::kWarm},
+    {"cold", rocksdb::Temperature::kCold},
+};
+
+const std::vector<ConfigEnum<rocksdb::TieredAdmissionPolicy>> secondary_cache_admission_policies{
+    {"auto", rocksdb::TieredAdmissionPolicy::kAdmPolicyAuto},
+    {"placeholder", rocksdb::TieredAdmissionPolicy::kAdmPolicyPlaceholder},
+    {"allow-cache-hits", rocksdb::TieredAdmissionPolicy::kAdmPolicyAllowCacheHits},
+};
+
+const std::vector<ConfigEnum<util::CompressionType>> replication_compression_types{
+    {"no", util::CompressionType::kNone},
+    {"lz4", util::CompressionType::kLZ4},
+    {"zstd", util::CompressionType::kZSTD},
+};
+
+const std::vector<ConfigEnum<MaxDBSizePolicy>> max_db_size_policies{
+    {"noeviction", kMaxDBSizeNoEviction},
+    {"allkeys-lfu", kMaxDBSizeAllKeysLFU},
+    {"volatile-ttl", kMaxDBSizeVolatileTTL},
+    {"volatile-lru", kMaxDBSizeVolatileLRU},
+};
+
+const std::vector<ConfigEnum<WriteStallPolicy>> write_stall_policies{
+    {"wait", kWriteStallWait},
+    {"reject-stopped", kWriteStallRejectStopped},
+    {"reject-delayed", kWriteStallRejectDelayed},
+};
+
 const std::vector<ConfigEnum<MigrationType>> migration_types{{"redis-command", MigrationType::kRedisCommand},
-                                                             {"raw-key-value", MigrationType::kRawKeyValue}};
+                                                             {"raw-key-value", MigrationType::kRawKeyValue},
+                                                             {"raw-sst-file", MigrationType::kRawSSTFile}};
+
+// ParseCPUs parses a comma-separated list of CPUs and CPU ranges, e.g. "0,2-3"
+StatusOr<std::vector<int>> ParseCPUs(const std::string &v) {
+  std::vector<int> cpus;
+  for (const auto &item : util::Split(v, ",")) {
+    auto range = util::Split(item, "-");
+    if (range.empty() || range.size() > 2) return {Status::NotOK, fmt::format("invalid CPU range '{}'", item)};
+
+    auto first = GET_OR_RET(ParseInt<int>(range[0], {0, 1023}, 10).Prefixed("invalid CPU"));
+    auto last = range.size() == 1 ? first : GET_OR_RET(ParseInt<int>(range[1], {0, 1023}, 10).Prefixed("invalid CPU"));
+    if (first > last) return {Status::NotOK, fmt::format("invalid CPU range '{}'", item)};
+    for (int cpu = first; cpu <= last; cpu++) cpus.push_back(cpu);
+  }
+  return cpus;
+}
 
 std::string TrimRocksDbPrefix(std::string s) {
   if (strncasecmp(s.data(), "rocksdb.", 8) != 0) return s;
@@ -109,6 +175,9 @@ Config::Config() {
       {"daemonize", true, new YesNoField(&daemonize, false)},
       {"bind", true, new StringField(&binds_str_, "")},
       {"port", true, new UInt32Field(&port, kDefaultPort, 1, PORT_LIMIT)},
+      {"metrics-port", true, new UInt32Field(&metrics_port, 0, 0, PORT_LIMIT)},
+      {"metrics-bind", true, new StringField(&metrics_bind, "127.0.0.1")},
+      {"metrics-rocksdb-refresh-interval", false, new IntField(&metrics_rocksdb_refresh_interval, 10, 1, INT_MAX)},
 #ifdef ENABLE_OPENSSL
       {"tls-port", true, new UInt32Field(&tls_port, 0, 0, PORT_LIMIT)},
       {"tls-cert-file", false, new StringField(&tls_cert_file, "")},
@@ -125,13 +194,38 @@ Config::Config() {
       {"tls-session-cache-size", false, new IntField(&tls_session_cache_size, 1024 * 20, 0, INT_MAX)},
       {"tls-session-cache-timeout", false, new IntField(&tls_session_cache_timeout, 300, 0, INT_MAX)},
       {"tls-replication", true, new YesNoField(&tls_replication, false)},
+      {"tls-ktls", false, new YesNoField(&tls_ktls, false)},
 #endif
       {"workers", false, new IntField(&workers, 8, 1, 256)},
+      {"worker-epoll-changelist", true, new YesNoField(&worker_epoll_changelist, false)},
+      {"worker-max-single-read-bytes", true,
+       new IntField(&worker_max_single_read_bytes, 16 * 1024, 4 * 1024, 16 * 1024 * 1024)},
+      {"worker-max-single-write-bytes", true,
+       new IntField(&worker_max_single_write_bytes, 16 * 1024, 4 * 1024, 16 * 1024 * 1024)},
+      {"worker-connection-pool-size", false, new IntField(&worker_connection_pool_size, 1024, 0, 65536)},
+      {"heavy-command-threads", true, new IntField(&heavy_command_threads, 0, 0, 256)},
+      {"heavy-command-queue-size", true, new IntField(&heavy_command_queue_size, 1024, 1, 65536)},
+      {"heavy-command-cost-threshold", false, new IntField(&heavy_command_cost_threshold, 100000, 1, INT_MAX)},
+      {"background-task-cpus", true, new StringField(&background_task_cpus_str_, "")},
+      {"worker-cpus", true, new StringField(&worker_cpus_str_, "")},
+      {"replication-cpus", true, new StringField(&replication_cpus_str_, "")},
+      {"worker-rebalance-interval", false, new IntField(&worker_rebalance_interval, 0, 0, 3600)},
+      {"worker-rebalance-threshold", false, new IntField(&worker_rebalance_threshold, 20, 1, 100)},
+      {"worker-autoscale", false, new YesNoField(&worker_autoscale, false)},
+      {"worker-autoscale-min-workers", false, new IntField(&worker_autoscale_min_workers, 2, 1, 256)},
+      {"worker-autoscale-max-workers", false, new IntField(&worker_autoscale_max_workers, 16, 1, 256)},
+      {"worker-autoscale-high-utilization", false, new IntField(&worker_autoscale_high_utilization, 80, 10, 100)},
+      {"worker-autoscale-max-delay-ms", false, new IntField(&worker_autoscale_max_delay_ms, 10, 1, 10000)},
+      {"reply-streaming-threshold", false, new IntField(&reply_streaming_threshold, 0, 0, INT_MAX)},
+      {"scan-time-budget-ms", false, new IntField(&scan_time_budget_ms, 0, 0, INT_MAX)},
       {"timeout", false, new IntField(&timeout, 0, 0, INT_MAX)},
       {"tcp-backlog", true, new IntField(&backlog, 511, 0, INT_MAX)},
       {"maxclients", false, new IntField(&maxclients, 10240, 0, INT_MAX)},
       {"max-backup-to-keep", false, new IntField(&max_backup_to_keep, 1, 0, 1)},
       {"max-backup-keep-hours", false, new IntField(&max_backup_keep_hours, 0, 0, INT_MAX)},
+      {"backup-incremental", true, new YesNoField(&backup_incremental, false)},
+      {"backup-threads", false, new IntField(&backup_threads, 4, 1, 64)},
+      {"backup-rate-limit-mb", false, new IntField(&backup_rate_limit_mb, 0, 0, INT_MAX)},
       {"master-use-repl-port", false, new YesNoField(&master_use_repl_port, false)},
       {"requirepass", false, new StringField(&requirepass, "")},
       {"masterauth", false, new StringField(&masterauth, "")},
@@ -139,6 +233,8 @@ Config::Config() {
       {"compact-cron", false, new StringField(&compact_cron_str_, "")},
       {"bgsave-cron", false, new StringField(&bgsave_cron_str_, "")},
       {"dbsize-scan-cron", false, new StringField(&dbsize_scan_cron_str_, "")},
+      {"dbsize-scan-threads", false, new IntField(&dbsize_scan_threads, 4, 1, 64)},
+      {"keys-scan-threads", false, new IntField(&keys_scan_threads, 1, 1, 64)},
       {"replica-announce-ip", false, new StringField(&replica_announce_ip, "")},
       {"replica-announce-port", false, new UInt32Field(&replica_announce_port, 0, 0, PORT_LIMIT)},
       {"compaction-checker-range", false, new StringField(&compaction_checker_range_str_, "")},
@@ -146,6 +242,8 @@ Config::Config() {
       {"force-compact-file-age", false, new Int64Field(&force_compact_file_age, 2 * 24 * 3600, 60, INT64_MAX)},
       {"force-compact-file-min-deleted-percentage", false,
        new IntField(&force_compact_file_min_deleted_percentage, 10, 1, 100)},
+      {"compaction-checker-io-budget", false, new IntField(&compaction_checker_io_budget, 1024, 0, INT_MAX)},
+      {"compaction-checker-time-limit", false, new IntField(&compaction_checker_time_limit, 600, 1, INT_MAX)},
       {"db-name", true, new StringField(&db_name, "change.me.db")},
       {"dir", true, new StringField(&dir, kDefaultDir)},
       {"backup-dir", false, new StringField(&backup_dir, kDefaultBackupDir)},
@@ -154,7 +252,15 @@ Config::Config() {
       {"pidfile", true, new StringField(&pidfile, kDefaultPidfile)},
       {"max-io-mb", false, new IntField(&max_io_mb, 0, 0, INT_MAX)},
       {"max-bitmap-to-string-mb", false, new IntField(&max_bitmap_to_string_mb, 16, 0, INT_MAX)},
+      {"bitmap-roaring-encoding", false, new YesNoField(&bitmap_roaring_encoding, false)},
+      {"sortedint-block-encoding", false, new YesNoField(&sortedint_block_encoding, false)},
+      {"string-chunk-threshold-kb", false, new IntField(&string_chunk_threshold_kb, 0, 0, INT_MAX)},
       {"max-db-size", false, new IntField(&max_db_size, 0, 0, INT_MAX)},
+      {"max-db-size-policy", false,
+       new EnumField<MaxDBSizePolicy>(&max_db_size_policy, max_db_size_policies, kMaxDBSizeNoEviction)},
+      {"max-db-size-low-watermark", false, new IntField(&max_db_size_low_watermark, 90, 1, 100)},
+      {"write-stall-policy", false,
+       new EnumField<WriteStallPolicy>(&write_stall_policy, write_stall_policies, kWriteStallWait)},
       {"max-replication-mb", false, new IntField(&max_replication_mb, 0, 0, INT_MAX)},
       {"supervised", true, new EnumField<SupervisedMode>(&supervised_mode, supervised_modes, kSupervisedNone)},
       {"slave-serve-stale-data", false, new YesNoField(&slave_serve_stale_data, true)},
@@ -162,17 +268,36 @@ Config::Config() {
       {"slave-priority", false, new IntField(&slave_priority, 100, 0, INT_MAX)},
       {"slave-read-only", false, new YesNoField(&slave_readonly, true)},
       {"use-rsid-psync", true, new YesNoField(&use_rsid_psync, false)},
+      {"replication-compression", false,
+       new EnumField<util::CompressionType>(&replication_compression, replication_compression_types,
+                                            util::CompressionType::kNone)},
+      {"replica-apply-batch-size-kb", false, new IntField(&replica_apply_batch_size_kb, 0, 0, 64 * 1024)},
+      {"repl-backlog-size-mb", false, new IntField(&repl_backlog_size_mb, 32, 1, 64 * 1024)},
+      {"repl-batch-delay-us", false, new IntField(&repl_batch_delay_us, 0, 0, 1000 * 1000)},
+      {"repl-batch-max-kb", false, new IntField(&repl_batch_max_kb, 16, 1, 64 * 1024)},
+      {"secondary-db-dir", true, new StringField(&secondary_db_dir, "")},
+      {"secondary-catch-up-interval-ms", false, new IntField(&secondary_catch_up_interval_ms, 100, 100, INT_MAX)},
+      {"secondary-max-lag-ms", false, new IntField(&secondary_max_lag_ms, 0, 0, INT_MAX)},
       {"profiling-sample-ratio", false, new IntField(&profiling_sample_ratio, 0, 0, 100)},
       {"profiling-sample-record-max-len", false, new IntField(&profiling_sample_record_max_len, 256, 0, INT_MAX)},
       {"profiling-sample-record-threshold-ms", false,
        new IntField(&profiling_sample_record_threshold_ms, 100, 0, INT_MAX)},
+      {"profiling-stats-sample-interval", false, new IntField(&profiling_stats_sample_interval, 0, 0, INT_MAX)},
+      {"trace-file", true, new StringField(&trace_file, "")},
+      {"trace-sample-interval", false, new IntField(&trace_sample_interval, 0, 0, INT_MAX)},
       {"slowlog-log-slower-than", false, new IntField(&slowlog_log_slower_than, 200000, -1, INT_MAX)},
       {"profiling-sample-commands", false, new StringField(&profiling_sample_commands_str_, "")},
       {"slowlog-max-len", false, new IntField(&slowlog_max_len, 128, 0, INT_MAX)},
+      {"latency-tracking", false, new YesNoField(&latency_tracking, true)},
+      {"hotkeys-sample-interval", false, new IntField(&hotkeys_sample_interval, 100, 0, INT_MAX)},
+      {"notify-keyspace-events", false, new StringField(&notify_keyspace_events_str_, "")},
+      {"tracking-table-max-keys", false, new IntField(&tracking_table_max_keys, 1000000, 0, INT_MAX)},
+      {"namespace-quotas", false, new StringField(&namespace_quotas_str_, "")},
       {"purge-backup-on-fullsync", false, new YesNoField(&purge_backup_on_fullsync, false)},
       {"rename-command", true, new MultiStringField(&rename_command_, std::vector<std::string>{})},
       {"auto-resize-block-and-sst", false, new YesNoField(&auto_resize_block_and_sst, true)},
       {"fullsync-recv-file-delay", false, new IntField(&fullsync_recv_file_delay, 0, 0, INT_MAX)},
+      {"fullsync-fetch-threads", false, new IntField(&fullsync_fetch_threads, 4, 1, 64)},
       {"cluster-enabled", true, new YesNoField(&cluster_enabled, false)},
       {"migrate-speed", false, new IntField(&migrate_speed, 4096, 0, INT_MAX)},
       {"migrate-pipeline-size", false, new IntField(&pipeline_size, 16, 1, INT_MAX)},
@@ -181,6 +306,11 @@ Config::Config() {
        new EnumField<MigrationType>(&migrate_type, migration_types, MigrationType::kRedisCommand)},
       {"migrate-batch-size-kb", false, new IntField(&migrate_batch_size_kb, 16, 1, INT_MAX)},
       {"migrate-batch-rate-limit-mb", false, new IntField(&migrate_batch_rate_limit_mb, 16, 0, INT_MAX)},
+      {"migrate-concurrency", false, new IntField(&migrate_concurrency, 1, 1, 16)},
+      {"migrate-adaptive-rate", false, new YesNoField(&migrate_adaptive_rate, false)},
+      {"migrate-adaptive-latency-us", false, new IntField(&migrate_adaptive_latency_us, 10000, 1, INT_MAX)},
+      {"migrate-adaptive-pending-compaction-mb", false,
+       new IntField(&migrate_adaptive_pending_compaction_mb, 16384, 1, INT_MAX)},
       {"unixsocket", true, new StringField(&unixsocket, "")},
       {"unixsocketperm", true, new OctalField(&unixsocketperm, 0777, 1, INT_MAX)},
       {"log-retention-days", false, new IntField(&log_retention_days, -1, -1, INT_MAX)},
@@ -190,18 +320,53 @@ Config::Config() {
       {"repl-namespace-enabled", false, new YesNoField(&repl_namespace_enabled, false)},
       {"proto-max-bulk-len", false,
        new IntWithUnitField<uint64_t>(&proto_max_bulk_len, std::to_string(512 * MiB), 1 * MiB, UINT64_MAX)},
+      {"pipeline-batch-read-size", false, new IntField(&pipeline_batch_read_size, 64, 0, 1024)},
       {"json-max-nesting-depth", false, new IntField(&json_max_nesting_depth, 1024, 0, INT_MAX)},
       {"json-storage-format", false,
        new EnumField<JsonStorageFormat>(&json_storage_format, json_storage_formats, JsonStorageFormat::JSON)},
       {"txn-context-enabled", true, new YesNoField(&txn_context_enabled, false)},
+      {"txn-context-max-snapshot-staleness-us", false,
+       new IntField(&txn_context_max_snapshot_staleness_us, 0, 0, 1000)},
+      {"txn-concurrent-exec", false, new YesNoField(&txn_concurrent_exec, false)},
+      {"script-lock-declared-keys", false, new YesNoField(&script_lock_declared_keys, false)},
+      {"group-commit-enabled", false, new YesNoField(&group_commit_enabled, false)},
+      {"group-commit-max-delay-us", false, new IntField(&group_commit_max_delay_us, 100, 0, 1000000)},
+      {"group-commit-max-batch-size", false, new IntField(&group_commit_max_batch_size, 32, 1, 4096)},
+      {"metadata-cache-size", true, new IntField(&metadata_cache_size, 0, 0, INT_MAX)},
+      {"metadata-cache-absent-size", true, new IntField(&metadata_cache_absent_size, 0, 0, INT_MAX)},
+      {"block-cache-warmup-keys", true, new IntField(&block_cache_warmup_keys, 0, 0, INT_MAX)},
+      {"hnsw-cache-size", false, new IntField(&hnsw_cache_size, 0, 0, INT_MAX)},
+      {"hnsw-maintenance-interval", false, new IntField(&hnsw_maintenance_interval, 3600, 0, INT_MAX)},
+      {"index-build-threads", false, new IntField(&index_build_threads, 4, 1, 64)},
+      {"search-async-indexing", false, new YesNoField(&search_async_indexing, false)},
+      {"search-plan-cache-size", false, new IntField(&search_plan_cache_size, 1024, 0, INT_MAX)},
+      {"search-aggregate-max-memory", false, new IntField(&search_aggregate_max_memory, 256, 0, INT_MAX)},
+      {"hash-max-inline-entries", false, new IntField(&hash_max_inline_entries, 0, 0, 1024)},
+      {"hash-max-inline-value", false, new IntField(&hash_max_inline_value, 64, 0, INT_MAX)},
+      {"ttl-index-enabled", false, new YesNoField(&ttl_index_enabled, false)},
+      {"ttl-index-reap-limit", false, new IntField(&ttl_index_reap_limit, 1000, 1, INT_MAX)},
+      {"lazyfree-min-size", false, new IntField(&lazyfree_min_size, 0, 0, INT_MAX)},
+      {"incr-combining", false, new YesNoField(&incr_combining, false)},
+      {"zset-rank-index", false, new YesNoField(&zset_rank_index, false)},
+      {"random-sample-exact", false, new YesNoField(&random_sample_exact, false)},
 
       /* rocksdb options */
       {"rocksdb.compression", false,
        new EnumField<rocksdb::CompressionType>(&rocks_db.compression, compression_types,
                                                rocksdb::CompressionType::kNoCompression)},
       {"rocksdb.compression_level", true, new IntField(&rocks_db.compression_level, 32767, INT_MIN, INT_MAX)},
+      {"rocksdb.compression_max_dict_bytes", false,
+       new IntField(&rocks_db.compression_max_dict_bytes, 0, 0, 1024 * 1024)},
+      {"rocksdb.compression_zstd_max_train_bytes", false,
+       new IntField(&rocks_db.compression_zstd_max_train_bytes, 0, 0, 128 * 1024 * 1024)},
+      {"rocksdb.compression_parallel_threads", false, new IntField(&rocks_db.compression_parallel_threads, 1, 1, 16)},
+      {"rocksdb.compression_dict_column_families", true,
+       new StringField(&rocks_db.compression_dict_column_families, "metadata")},
       {"rocksdb.block_size", true, new IntField(&rocks_db.block_size, 16384, 0, INT_MAX)},
       {"rocksdb.max_open_files", false, new IntField(&rocks_db.max_open_files, 8096, -1, INT_MAX)},
+      {"rocksdb.max_file_opening_threads", true, new IntField(&rocks_db.max_file_opening_threads, 16, 1, 256)},
+      {"rocksdb.fast_open", true, new YesNoField(&rocks_db.fast_open, false)},
+      {"rocksdb.background_cpus", true, new StringField(&rocks_db_background_cpus_str_, "")},
       {"rocksdb.write_buffer_size", false, new IntField(&rocks_db.write_buffer_size, 64, 0, 4096)},
       {"rocksdb.max_write_buffer_number", false, new IntField(&rocks_db.max_write_buffer_number, 4, 0, 256)},
       {"rocksdb.target_file_size_base", false, new IntField(&rocks_db.target_file_size_base, 128, 1, 1024)},
@@ -216,13 +381,34 @@ Config::Config() {
       {"rocksdb.enable_pipelined_write", true, new YesNoField(&rocks_db.enable_pipelined_write, false)},
       {"rocksdb.stats_dump_period_sec", false, new IntField(&rocks_db.stats_dump_period_sec, 0, 0, INT_MAX)},
       {"rocksdb.cache_index_and_filter_blocks", true, new YesNoField(&rocks_db.cache_index_and_filter_blocks, true)},
+      {"rocksdb.subkey_prefix_bloom", true, new YesNoField(&rocks_db.subkey_prefix_bloom, true)},
+      {"rocksdb.filter_policy", true,
+       new EnumField<FilterPolicyType>(&rocks_db.filter_policy, filter_policies, FilterPolicyType::kBloom)},
+      {"rocksdb.metadata_filter_bits_per_key", true, new IntField(&rocks_db.metadata_filter_bits_per_key, 10, 1, 40)},
+      {"rocksdb.subkey_filter_bits_per_key", true, new IntField(&rocks_db.subkey_filter_bits_per_key, 10, 1, 40)},
+      {"rocksdb.metadata_memtable", true,
+       new EnumField<MemtableType>(&rocks_db.metadata_memtable, memtable_types, MemtableType::kSkipList)},
+      {"rocksdb.metadata_memtable_bloom_percentage", true,
+       new IntField(&rocks_db.metadata_memtable_bloom_percentage, 10, 0, 25)},
+      {"rocksdb.partition_index_and_filters", true, new YesNoField(&rocks_db.partition_index_and_filters, true)},
+      {"rocksdb.pin_top_level_index_and_filter", true,
+       new YesNoField(&rocks_db.pin_top_level_index_and_filter, true)},
       {"rocksdb.block_cache_size", true, new IntField(&rocks_db.block_cache_size, 0, 0, INT_MAX)},
       {"rocksdb.block_cache_type", true,
        new EnumField<BlockCacheType>(&rocks_db.block_cache_type, cache_types, BlockCacheType::kCacheTypeLRU)},
+      {"rocksdb.compressed_secondary_cache_size", true,
+       new IntField(&rocks_db.compressed_secondary_cache_size, 0, 0, INT_MAX)},
+      {"rocksdb.secondary_cache_admission_policy", true,
+       new EnumField<rocksdb::TieredAdmissionPolicy>(&rocks_db.secondary_cache_admission_policy,
+                                                     secondary_cache_admission_policies,
+                                                     rocksdb::TieredAdmissionPolicy::kAdmPolicyAuto)},
+      {"rocksdb.secondary_cache_auto_tune", false, new YesNoField(&rocks_db.secondary_cache_auto_tune, false)},
       {"rocksdb.subkey_block_cache_size", true, new IntField(&rocks_db.subkey_block_cache_size, 2048, 0, INT_MAX)},
       {"rocksdb.metadata_block_cache_size", true, new IntField(&rocks_db.metadata_block_cache_size, 2048, 0, INT_MAX)},
       {"rocksdb.share_metadata_and_subkey_block_cache", true,
        new YesNoField(&rocks_db.share_metadata_and_subkey_block_cache, true)},
+      {"rocksdb.huge_pages", true,
+       new EnumField<HugePageMode>(&rocks_db.huge_pages, huge_page_modes, HugePageMode::kNone)},
       {"rocksdb.row_cache_size", true, new IntField(&rocks_db.row_cache_size, 0, 0, INT_MAX)},
       {"rocksdb.compaction_readahead_size", false,
        new IntField(&rocks_db.compaction_readahead_size, 2 * MiB, 0, 64 * MiB)},
@@ -243,6 +429,17 @@ Config::Config() {
        new IntField(&rocks_db.max_bytes_for_level_multiplier, 10, 1, 100)},
       {"rocksdb.level_compaction_dynamic_level_bytes", false,
        new YesNoField(&rocks_db.level_compaction_dynamic_level_bytes, false)},
+      {"rocksdb.ttl", false, new IntField(&rocks_db.ttl, 30 * 24 * 3600, 0, INT_MAX)},
+      {"rocksdb.periodic_compaction_seconds", false,
+       new IntField(&rocks_db.periodic_compaction_seconds, 30 * 24 * 3600, 0, INT_MAX)},
+      {"rocksdb.cold_dir", true, new StringField(&rocks_db.cold_dir, "")},
+      {"rocksdb.hot_dir_target_size", true, new IntField(&rocks_db.hot_dir_target_size, 0, 0, INT_MAX)},
+      {"rocksdb.cold_column_families", true, new StringField(&rocks_db.cold_column_families, "")},
+      {"rocksdb.last_level_temperature", true,
+       new EnumField<rocksdb::Temperature>(&rocks_db.last_level_temperature, temperatures,
+                                           rocksdb::Temperature::kUnknown)},
+      {"rocksdb.preclude_last_level_data_seconds", true,
+       new IntField(&rocks_db.preclude_last_level_data_seconds, 0, 0, INT_MAX)},
       {"rocksdb.max_background_jobs", false, new IntField(&rocks_db.max_background_jobs, 4, 0, 32)},
       {"rocksdb.rate_limiter_auto_tuned", true, new YesNoField(&rocks_db.rate_limiter_auto_tuned, true)},
       {"rocksdb.avoid_unnecessary_blocking_io", true, new YesNoField(&rocks_db.avoid_unnecessary_blocking_io, true)},
@@ -259,6 +456,8 @@ Config::Config() {
 
       /* rocksdb read options */
       {"rocksdb.read_options.async_io", false, new YesNoField(&rocks_db.read_options.async_io, true)},
+      {"rocksdb.read_options.max_scan_readahead_size", false,
+       new IntField(&rocks_db.read_options.max_scan_readahead_size, 2 * MiB, 0, 64 * MiB)},
   };
   for (auto &wrapper : fields) {
     auto &field = wrapper.field;
@@ -343,6 +542,7 @@ void Config::initFieldValidator() {
            }
            commands->erase(cmd_iter);
          }
+         redis::CommandTable::UpdateIndex();
          return Status::OK();
        }},
   };
@@ -391,6 +591,14 @@ void Config::initFieldCallback() {
     }
     return srv->storage->SetOptionForAllColumnFamilies("compression_per_level", compression_levels);
   };
+  auto set_compression_opts_cb = [](Server *srv, const std::string &k, const std::string &v) -> Status {
+    if (!srv) return Status::OK();
+    // the options are fields of compression_opts, e.g. compression_max_dict_bytes is compression_opts.max_dict_bytes
+    auto field = TrimRocksDbPrefix(k).substr(std::string_view("compression_").size());
+    auto value = fmt::format("{{{}={}}}", field, v);
+    if (field == "parallel_threads") return srv->storage->SetOptionForAllColumnFamilies("compression_opts", value);
+    return srv->storage->SetOptionForDictColumnFamilies("compression_opts", value);
+  };
 #ifdef ENABLE_OPENSSL
   auto set_tls_option = [](Server *srv, [[maybe_unused]] const std::string &k, [[maybe_unused]] const std::string &v) {
     if (!srv) return Status::OK();  // srv is nullptr when load config from file
@@ -474,6 +682,71 @@ void Config::initFieldCallback() {
              }
              return Status::OK();
            }},
+          {"notify-keyspace-events",
+           [this]([[maybe_unused]] Server *srv, [[maybe_unused]] const std::string &k, const std::string &v) -> Status {
+             static const std::map<char, int> event_classes = {
+                 {'K', kNotifyKeyspace}, {'E', kNotifyKeyevent}, {'g', kNotifyGeneric}, {'$', kNotifyString},
+                 {'l', kNotifyList},     {'s', kNotifySet},      {'h', kNotifyHash},    {'z', kNotifyZSet},
+                 {'x', kNotifyExpired},  {'e', kNotifyEvicted},  {'t', kNotifyStream},  {'m', kNotifyKeyMiss},
+                 {'d', kNotifyModule},   {'n', kNotifyNew},      {'A', kNotifyAll},
+             };
+             int flags = 0;
+             for (char c : v) {
+               auto iter = event_classes.find(c);
+               if (iter == event_classes.end()) {
+                 return {Status::NotOK, fmt::format("invalid keyspace event class '{}'", c)};
+               }
+               flags |= iter->second;
+             }
+             notify_keyspace_events = flags;
+             return Status::OK();
+           }},
+          {"namespace-quotas",
+           [this](Server *srv, [[maybe_unused]] const std::string &k, const std::string &v) -> Status {
+             std::map<std::string, NamespaceQuota> quotas;
+             for (const auto &item : util::Split(v, " \t")) {
+               // <namespace>:<ops>:<read-bytes>:<write-bytes>[:<weight>]
+               auto fields = util::Split(item, ":");
+               if (fields.size() != 4 && fields.size() != 5) {
+                 return {Status::NotOK, fmt::format("invalid namespace quota '{}'", item)};
+               }
+               NamespaceQuota quota;
+               quota.ops = GET_OR_RET(ParseInt<uint64_t>(fields[1], 10).Prefixed("invalid ops limit"));
+               quota.read_bytes = GET_OR_RET(ParseSizeAndUnit(fields[2]).Prefixed("invalid read bytes limit"));
+               quota.write_bytes = GET_OR_RET(ParseSizeAndUnit(fields[3]).Prefixed("invalid write bytes limit"));
+               if (fields.size() == 5) {
+                 quota.weight = GET_OR_RET(ParseInt<uint32_t>(fields[4], {1, 1000}, 10).Prefixed("invalid weight"));
+               }
+               quotas[fields[0]] = quota;
+             }
+             namespace_quotas = std::move(quotas);
+             if (srv) srv->GetNamespaceQuotas()->Reset(namespace_quotas);
+             return Status::OK();
+           }},
+          {"background-task-cpus",
+           [this]([[maybe_unused]] Server *srv, [[maybe_unused]] const std::string &k, const std::string &v) -> Status {
+             background_task_cpus = GET_OR_RET(ParseCPUs(v));
+             return Status::OK();
+           }},
+          {"worker-cpus",
+           [this]([[maybe_unused]] Server *srv, [[maybe_unused]] const std::string &k, const std::string &v) -> Status {
+             std::vector<std::vector<int>> groups;
+             for (const auto &group : util::Split(v, ";")) {
+               groups.push_back(GET_OR_RET(ParseCPUs(group)));
+             }
+             worker_cpus = std::move(groups);
+             return Status::OK();
+           }},
+          {"replication-cpus",
+           [this]([[maybe_unused]] Server *srv, [[maybe_unused]] const std::string &k, const std::string &v) -> Status {
+             replication_cpus = GET_OR_RET(ParseCPUs(v));
+             return Status::OK();
+           }},
+          {"rocksdb.background_cpus",
+           [this]([[maybe_unused]] Server *srv, [[maybe_unused]] const std::string &k, const std::string &v) -> Status {
+             rocks_db.background_cpus = GET_OR_RET(ParseCPUs(v));
+             return Status::OK();
+           }},
           {"profiling-sample-commands",
            [this]([[maybe_unused]] Server *srv, [[maybe_unused]] const std::string &k, const std::string &v) -> Status {
              std::vector<std::string> cmds = util::Split(v, ",");
@@ -505,6 +778,12 @@ void Config::initFieldCallback() {
              srv->storage->CheckDBSizeLimit();
              return Status::OK();
            }},
+          {"max-db-size-policy",
+           [](Server *srv, [[maybe_unused]] const std::string &k, [[maybe_unused]] const std::string &v) -> Status {
+             if (!srv) return Status::OK();
+             srv->storage->CheckDBSizeLimit();
+             return Status::OK();
+           }},
           {"max-io-mb",
            [this](Server *srv, [[maybe_unused]] const std::string &k, [[maybe_unused]] const std::string &v) -> Status {
              if (!srv) return Status::OK();
@@ -694,7 +973,12 @@ void Config::initFieldCallback() {
           {"rocksdb.level0_slowdown_writes_trigger", set_cf_option_cb},
           {"rocksdb.level0_stop_writes_trigger", set_cf_option_cb},
           {"rocksdb.level0_file_num_compaction_trigger", set_cf_option_cb},
+          {"rocksdb.ttl", set_cf_option_cb},
+          {"rocksdb.periodic_compaction_seconds", set_cf_option_cb},
           {"rocksdb.compression", set_compression_type_cb},
+          {"rocksdb.compression_max_dict_bytes", set_compression_opts_cb},
+          {"rocksdb.compression_zstd_max_train_bytes", set_compression_opts_cb},
+          {"rocksdb.compression_parallel_threads", set_compression_opts_cb},
 #ifdef ENABLE_OPENSSL
           {"tls-cert-file", set_tls_option},
           {"tls-key-file", set_tls_option},
@@ -709,6 +993,7 @@ void Config::initFieldCallback() {
           {"tls-session-caching", set_tls_option},
           {"tls-session-cache-size", set_tls_option},
           {"tls-session-cache-timeout", set_tls_option},
+          {"tls-ktls", set_tls_option},
 #endif
       };
   for (const auto &iter : callbacks) {
@@ -721,6 +1006,10 @@ void Config::initFieldCallback() {
 
 std::string Config::NodesFilePath() const { return dir + "/nodes.conf"; }
 
+std::string Config::CacheWarmupFilePath() const { return dir + "/block_cache_warmup"; }
+
+std::string Config::BigKeysFilePath() const { return dir + "/big_keys"; }
+
 void Config::SetMaster(const std::string &host, uint32_t port) {
   master_host = host;
   master_port = port;
@@ -798,8 +1087,22 @@ Status Config::finish() {
   if (master_port != 0 && binds.size() == 0) {
     return {Status::NotOK, "replication doesn't support unix socket"};
   }
+  if (metrics_port != 0 && (metrics_port == port || metrics_port == tls_port)) {
+    return {Status::NotOK, "metrics-port must be different from the ports of the clients"};
+  }
+  if (!secondary_db_dir.empty()) {
+    if (master_port != 0) return {Status::NotOK, "a secondary instance can't be a replica"};
+    if (cluster_enabled) return {Status::NotOK, "a secondary instance doesn't support the cluster mode"};
+    db_dir = secondary_db_dir;
+  }
   if (db_dir.empty()) db_dir = dir + "/db";
   if (log_dir.empty()) log_dir = dir;
+  if (rocks_db.cold_dir.empty() && (rocks_db.hot_dir_target_size > 0 || !rocks_db.cold_column_families.empty())) {
+    return {Status::NotOK, "rocksdb.cold_dir must be set to place the SST files on the cold tier"};
+  }
+  if (!rocks_db.cold_dir.empty() && rocks_db.cold_dir == db_dir) {
+    return {Status::NotOK, "rocksdb.cold_dir must be different from the db dir"};
+  }
   std::vector<std::string> create_dirs = {dir};
   for (const auto &name : create_dirs) {
     auto s = rocksdb::Env::Default()->CreateDirIfMissing(name);
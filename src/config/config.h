@@ -20,6 +20,7 @@
 
 #pragma once
 
+#include <rocksdb/cache.h>
 #include <rocksdb/options.h>
 #include <sys/resource.h>
 
@@ -29,6 +30,7 @@
 #include <string>
 #include <vector>
 
+#include "compress_util.h"
 #include "config_type.h"
 #include "cron.h"
 #include "status.h"
@@ -45,6 +47,46 @@ constexpr const uint32_t PORT_LIMIT = 65535;
 
 enum SupervisedMode { kSupervisedNone = 0, kSupervisedAutoDetect, kSupervisedSystemd, kSupervisedUpStart };
 
+// How the write commands are admitted when RocksDB stalls the writes, see write-stall-policy
+enum WriteStallPolicy { kWriteStallWait = 0, kWriteStallRejectStopped, kWriteStallRejectDelayed };
+
+enum MaxDBSizePolicy {
+  kMaxDBSizeNoEviction = 0,
+  kMaxDBSizeAllKeysLFU,
+  kMaxDBSizeVolatileTTL,
+  kMaxDBSizeVolatileLRU,
+};
+
+// The classes of the keyspace notifications, see notify-keyspace-events
+enum KeyspaceEventFlags : int {
+  kNotifyKeyspace = 1 << 0,  // K
+  kNotifyKeyevent = 1 << 1,  // E
+  kNotifyGeneric = 1 << 2,   // g
+  kNotifyString = 1 << 3,    // $
+  kNotifyList = 1 << 4,      // l
+  kNotifySet = 1 << 5,       // s
+  kNotifyHash = 1 << 6,      // h
+  kNotifyZSet = 1 << 7,      // z
+  kNotifyExpired = 1 << 8,   // x
+  kNotifyEvicted = 1 << 9,   // e
+  kNotifyStream = 1 << 10,   // t
+  kNotifyKeyMiss = 1 << 11,  // m
+  kNotifyModule = 1 << 12,   // d
+  kNotifyNew = 1 << 13,      // n
+  // A, the alias of "g$lshzxetd"
+  kNotifyAll = kNotifyGeneric | kNotifyString | kNotifyList | kNotifySet | kNotifyHash | kNotifyZSet | kNotifyExpired |
+               kNotifyEvicted | kNotifyStream | kNotifyModule,
+};
+
+// The throughput quota and the scheduling weight of a namespace, see namespace-quotas
+struct NamespaceQuota {
+  // the limits per second, 0 means no limit
+  uint64_t ops = 0;
+  uint64_t read_bytes = 0;
+  uint64_t write_bytes = 0;
+  uint32_t weight = 1;
+};
+
 constexpr const char *TLS_AUTH_CLIENTS_NO = "no";
 constexpr const char *TLS_AUTH_CLIENTS_OPTIONAL = "optional";
 
@@ -57,6 +99,12 @@ constexpr const char *kDefaultNamespace = "__namespace";
 
 enum class BlockCacheType { kCacheTypeLRU = 0, kCacheTypeHCC };
 
+enum class FilterPolicyType { kBloom = 0, kRibbon };
+
+enum class MemtableType { kSkipList = 0, kHashSkipList, kHashLinkList };
+
+enum class HugePageMode { kNone = 0, kTransparent, kExplicit };
+
 struct CLIOptions {
   std::string conf_file;
   std::vector<std::pair<std::string, std::string>> cli_options;
@@ -70,6 +118,10 @@ struct Config {
   Config();
   ~Config() = default;
   uint32_t port = 0;
+  // the HTTP listener of the metrics for Prometheus, 0 disables it
+  uint32_t metrics_port = 0;
+  std::string metrics_bind;
+  int metrics_rocksdb_refresh_interval = 10;
 
   uint32_t tls_port = 0;
   std::string tls_cert_file;
@@ -86,17 +138,55 @@ struct Config {
   int tls_session_cache_size = 1024 * 20;
   int tls_session_cache_timeout = 300;
   bool tls_replication = false;
+  bool tls_ktls = false;
 
   int workers = 0;
+  bool worker_epoll_changelist = false;
+  int worker_max_single_read_bytes = 16 * 1024;
+  int worker_max_single_write_bytes = 16 * 1024;
+  int worker_connection_pool_size = 1024;
+  int heavy_command_threads = 0;
+  int heavy_command_queue_size = 1024;
+  int heavy_command_cost_threshold = 100000;
+  std::vector<int> background_task_cpus;
+  // the groups of CPUs of the worker threads, the workers are spread over the groups round-robin,
+  // e.g. a group for each NUMA node
+  std::vector<std::vector<int>> worker_cpus;
+  // the CPUs of the replication threads and the slot migration threads
+  std::vector<int> replication_cpus;
+  // the seconds between the rebalances of the connections from the busy workers to the idle ones, 0 to disable
+  int worker_rebalance_interval = 0;
+  // the minimal gap of the utilization percentages of the busiest and the idlest workers to rebalance
+  int worker_rebalance_threshold = 20;
+  // scale the worker threads within [worker_autoscale_min_workers, worker_autoscale_max_workers] by their load,
+  // the workers are overloaded if their average utilization percentage reaches worker_autoscale_high_utilization,
+  // or a request waits more than worker_autoscale_max_delay_ms in the event loop of a worker
+  bool worker_autoscale = false;
+  int worker_autoscale_min_workers = 2;
+  int worker_autoscale_max_workers = 16;
+  int worker_autoscale_high_utilization = 80;
+  int worker_autoscale_max_delay_ms = 10;
+  int reply_streaming_threshold = 0;
+  int scan_time_budget_ms = 0;
   int timeout = 0;
   int log_level = 0;
   int backlog = 511;
   int maxclients = 10000;
   int max_backup_to_keep = 1;
   int max_backup_keep_hours = 24;
+  bool backup_incremental = false;
+  int backup_threads = 4;
+  int backup_rate_limit_mb = 0;
   int slowlog_log_slower_than = 100000;
   int slowlog_max_len = 128;
+  bool latency_tracking = true;
+  int hotkeys_sample_interval = 100;
+  // The flags of KeyspaceEventFlags parsed from notify-keyspace-events
+  int notify_keyspace_events = 0;
+  int tracking_table_max_keys = 1000000;
+  std::map<std::string, NamespaceQuota> namespace_quotas;
   uint64_t proto_max_bulk_len = 512 * 1024 * 1024;
+  int pipeline_batch_read_size = 64;
   bool daemonize = false;
   SupervisedMode supervised_mode = kSupervisedNone;
   bool slave_readonly = true;
@@ -104,14 +194,29 @@ struct Config {
   bool slave_empty_db_before_fullsync = false;
   int slave_priority = 100;
   int max_db_size = 0;
+  MaxDBSizePolicy max_db_size_policy = kMaxDBSizeNoEviction;
+  int max_db_size_low_watermark = 90;
+  WriteStallPolicy write_stall_policy = kWriteStallWait;
   int max_replication_mb = 0;
   int max_io_mb = 0;
   int max_bitmap_to_string_mb = 16;
+  bool bitmap_roaring_encoding = false;
+  bool sortedint_block_encoding = false;
+  int string_chunk_threshold_kb = 0;
   bool master_use_repl_port = false;
   bool purge_backup_on_fullsync = false;
   bool auto_resize_block_and_sst = true;
   int fullsync_recv_file_delay = 0;
+  int fullsync_fetch_threads = 4;
   bool use_rsid_psync = false;
+  util::CompressionType replication_compression = util::CompressionType::kNone;
+  int replica_apply_batch_size_kb = 0;
+  int repl_backlog_size_mb = 32;
+  int repl_batch_delay_us = 0;
+  int repl_batch_max_kb = 16;
+  std::string secondary_db_dir;
+  int secondary_catch_up_interval_ms = 100;
+  int secondary_max_lag_ms = 0;
   std::vector<std::string> binds;
   std::string dir;
   std::string db_dir;
@@ -131,9 +236,14 @@ struct Config {
   Cron compact_cron;
   Cron bgsave_cron;
   Cron dbsize_scan_cron;
+  int dbsize_scan_threads = 4;
+  int keys_scan_threads = 1;
   Cron compaction_checker_cron;
   int64_t force_compact_file_age;
   int force_compact_file_min_deleted_percentage;
+  // The compaction I/O in MiB and the seconds which a check of a column family may spend
+  int compaction_checker_io_budget;
+  int compaction_checker_time_limit;
   bool repl_namespace_enabled = false;
   std::string replica_announce_ip;
   uint32_t replica_announce_port = 0;
@@ -148,6 +258,10 @@ struct Config {
   MigrationType migrate_type;
   int migrate_batch_size_kb;
   int migrate_batch_rate_limit_mb;
+  int migrate_concurrency;
+  bool migrate_adaptive_rate;
+  int migrate_adaptive_latency_us;
+  int migrate_adaptive_pending_compaction_mb;
 
   bool redis_cursor_compatible = false;
   bool resp3_enabled = false;
@@ -163,6 +277,9 @@ struct Config {
   int profiling_sample_record_max_len = 128;
   std::set<std::string> profiling_sample_commands;
   bool profiling_sample_all_commands = false;
+  int profiling_stats_sample_interval = 0;
+  std::string trace_file;
+  int trace_sample_interval = 0;
 
   // json
   int json_max_nesting_depth = 1024;
@@ -170,17 +287,78 @@ struct Config {
 
   // Enable transactional mode in engine::Context
   bool txn_context_enabled = false;
+  int txn_context_max_snapshot_staleness_us = 0;
+
+  // Run EXEC under the locks of its keys instead of the global exclusivity
+  bool txn_concurrent_exec = false;
+  bool script_lock_declared_keys = false;
+
+  // group commit of write batches across connections
+  bool group_commit_enabled = false;
+  int group_commit_max_delay_us = 100;
+  int group_commit_max_batch_size = 32;
+
+  // The size of the in-memory cache of metadata in MiB, 0 means disabled
+  int metadata_cache_size = 0;
+  // The size of the in-memory cache of the keys found absent in MiB, 0 means disabled
+  int metadata_cache_absent_size = 0;
+  int block_cache_warmup_keys = 0;
+  // The size of the in-memory HNSW graph cache of each vector field in MiB, 0 means disabled
+  int hnsw_cache_size = 0;
+  // The interval in seconds between the checks of the HNSW graphs, 0 means disabled
+  int hnsw_maintenance_interval = 3600;
+  int index_build_threads = 4;
+  bool search_async_indexing = false;
+  int search_plan_cache_size = 1024;
+  // The max memory of the groups of an aggregation in MiB, 0 means no limit
+  int search_aggregate_max_memory = 256;
+
+  // Hashes up to this many fields are stored inside the metadata value, 0 means disabled
+  int hash_max_inline_entries = 0;
+  int hash_max_inline_value = 64;
+
+  // Index the keys with a TTL by their expire time, so the expired ones are deleted actively
+  bool ttl_index_enabled = false;
+  int ttl_index_reap_limit = 1000;
+  int lazyfree_min_size = 0;
+  bool incr_combining = false;
+  bool zset_rank_index = false;
+  bool random_sample_exact = false;
 
   struct RocksDB {
     int block_size;
     bool cache_index_and_filter_blocks;
+    bool subkey_prefix_bloom;
+    FilterPolicyType filter_policy;
+    // the bits per key of the filters of the metadata and the subkey column families, the others use 10
+    int metadata_filter_bits_per_key;
+    int subkey_filter_bits_per_key;
+    // the memtable of the metadata column family, the hash ones bucket the keys by the whole user key
+    MemtableType metadata_memtable;
+    // the size of the whole key bloom filter in the memtables of the metadata column family,
+    // in percentage of the write buffer size, 0 to disable it
+    int metadata_memtable_bloom_percentage;
+    // if the indexes and the filters of the SST files are split into partitions under a top level index
+    bool partition_index_and_filters;
+    bool pin_top_level_index_and_filter;
     int block_cache_size;
     BlockCacheType block_cache_type;
+    int compressed_secondary_cache_size;
+    rocksdb::TieredAdmissionPolicy secondary_cache_admission_policy;
+    bool secondary_cache_auto_tune;
     int metadata_block_cache_size;
     int subkey_block_cache_size;
     bool share_metadata_and_subkey_block_cache;
+    // if the block cache and the memtable arenas are allocated on huge pages
+    HugePageMode huge_pages;
     int row_cache_size;
     int max_open_files;
+    // the threads to open the table files on DB::Open, only if max_open_files is -1
+    int max_file_opening_threads;
+    // skip reading the table properties and checking the file sizes of every table file on DB::Open
+    bool fast_open;
+    // the CPUs of the flush and compaction threads
+    std::vector<int> background_cpus;
     int write_buffer_size;
     int max_write_buffer_number;
     int max_background_compactions;
@@ -199,6 +377,10 @@ struct Config {
     int level0_file_num_compaction_trigger;
     rocksdb::CompressionType compression;
     int compression_level;
+    int compression_max_dict_bytes;
+    int compression_zstd_max_train_bytes;
+    int compression_parallel_threads;
+    std::string compression_dict_column_families;
     bool disable_auto_compactions;
     bool enable_blob_files;
     int min_blob_size;
@@ -208,6 +390,13 @@ struct Config {
     int max_bytes_for_level_base;
     int max_bytes_for_level_multiplier;
     bool level_compaction_dynamic_level_bytes;
+    int ttl;
+    int periodic_compaction_seconds;
+    std::string cold_dir;
+    int hot_dir_target_size;
+    std::string cold_column_families;
+    rocksdb::Temperature last_level_temperature;
+    int preclude_last_level_data_seconds;
     int max_background_jobs;
     bool rate_limiter_auto_tuned;
     bool avoid_unnecessary_blocking_io = true;
@@ -223,12 +412,15 @@ struct Config {
 
     struct ReadOptions {
       bool async_io;
+      int max_scan_readahead_size;
     } read_options;
   } rocks_db;
 
   mutable std::mutex backup_mu;
 
   std::string NodesFilePath() const;
+  std::string CacheWarmupFilePath() const;
+  std::string BigKeysFilePath() const;
   Status Rewrite(const std::map<std::string, std::string> &tokens);
   Status Load(const CLIOptions &path);
   void Get(const std::string &key, std::vector<std::string> *values) const;
@@ -248,6 +440,12 @@ struct Config {
   std::string compaction_checker_range_str_;
   std::string compaction_checker_cron_str_;
   std::string profiling_sample_commands_str_;
+  std::string notify_keyspace_events_str_;
+  std::string namespace_quotas_str_;
+  std::string background_task_cpus_str_;
+  std::string worker_cpus_str_;
+  std::string replication_cpus_str_;
+  std::string rocks_db_background_cpus_str_;
   std::map<std::string, std::unique_ptr<ConfigField>> fields_;
   std::vector<std::string> rename_command_;
 
@@ -0,0 +1,193 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <cctype>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "fmt/core.h"
+#include "parse_util.h"
+#include "status.h"
+
+namespace kqir {
+
+// ArithmeticExpr is an expression of APPLY in FT.AGGREGATE, e.g. `(@sum - @min) / @count`,
+// made of numbers, columns of the aggregated rows, the four arithmetic operators and parentheses
+struct ArithmeticExpr {
+  enum Kind { NUMBER, COLUMN, ADD, SUB, MUL, DIV } kind = NUMBER;
+  double number = 0;
+  std::string column;
+  std::unique_ptr<ArithmeticExpr> lhs, rhs;
+
+  static StatusOr<std::unique_ptr<ArithmeticExpr>> Parse(std::string_view str) {
+    Parser parser{str};
+    auto expr = GET_OR_RET(parser.ParseSum());
+    parser.SkipSpaces();
+    if (parser.pos != str.size()) {
+      return {Status::NotOK, fmt::format("unexpected '{}' in the expression of APPLY", str.substr(parser.pos))};
+    }
+    return expr;
+  }
+
+  // Eval returns NaN if a column isn't a number, get_column returns the value of a column or NaN
+  template <typename F>
+  double Eval(F &&get_column) const {
+    switch (kind) {
+      case NUMBER:
+        return number;
+      case COLUMN:
+        return get_column(column);
+      case ADD:
+        return lhs->Eval(get_column) + rhs->Eval(get_column);
+      case SUB:
+        return lhs->Eval(get_column) - rhs->Eval(get_column);
+      case MUL:
+        return lhs->Eval(get_column) * rhs->Eval(get_column);
+      case DIV:
+        return lhs->Eval(get_column) / rhs->Eval(get_column);
+    }
+
+    __builtin_unreachable();
+  }
+
+  std::string Dump() const {
+    switch (kind) {
+      case NUMBER:
+        return fmt::format("{}", number);
+      case COLUMN:
+        return "@" + column;
+      case ADD:
+        return fmt::format("({} + {})", lhs->Dump(), rhs->Dump());
+      case SUB:
+        return fmt::format("({} - {})", lhs->Dump(), rhs->Dump());
+      case MUL:
+        return fmt::format("({} * {})", lhs->Dump(), rhs->Dump());
+      case DIV:
+        return fmt::format("({} / {})", lhs->Dump(), rhs->Dump());
+    }
+
+    __builtin_unreachable();
+  }
+
+  std::unique_ptr<ArithmeticExpr> Clone() const {
+    auto res = std::make_unique<ArithmeticExpr>();
+    res->kind = kind;
+    res->number = number;
+    res->column = column;
+    if (lhs) res->lhs = lhs->Clone();
+    if (rhs) res->rhs = rhs->Clone();
+    return res;
+  }
+
+ private:
+  static std::unique_ptr<ArithmeticExpr> MakeBinary(Kind kind, std::unique_ptr<ArithmeticExpr> lhs,
+                                                    std::unique_ptr<ArithmeticExpr> rhs) {
+    auto res = std::make_unique<ArithmeticExpr>();
+    res->kind = kind;
+    res->lhs = std::move(lhs);
+    res->rhs = std::move(rhs);
+    return res;
+  }
+
+  // a recursive descent parser, sum := product (('+' | '-') product)*, product := term (('*' | '/') term)*
+  struct Parser {
+    std::string_view str;
+    size_t pos = 0;
+
+    void SkipSpaces() {
+      while (pos < str.size() && std::isspace(static_cast<unsigned char>(str[pos]))) pos++;
+    }
+
+    bool Eat(char c) {
+      SkipSpaces();
+      if (pos < str.size() && str[pos] == c) {
+        pos++;
+        return true;
+      }
+      return false;
+    }
+
+    StatusOr<std::unique_ptr<ArithmeticExpr>> ParseSum() {
+      auto res = GET_OR_RET(ParseProduct());
+      while (true) {
+        if (Eat('+')) {
+          res = MakeBinary(ADD, std::move(res), GET_OR_RET(ParseProduct()));
+        } else if (Eat('-')) {
+          res = MakeBinary(SUB, std::move(res), GET_OR_RET(ParseProduct()));
+        } else {
+          return res;
+        }
+      }
+    }
+
+    StatusOr<std::unique_ptr<ArithmeticExpr>> ParseProduct() {
+      auto res = GET_OR_RET(ParseTerm());
+      while (true) {
+        if (Eat('*')) {
+          res = MakeBinary(MUL, std::move(res), GET_OR_RET(ParseTerm()));
+        } else if (Eat('/')) {
+          res = MakeBinary(DIV, std::move(res), GET_OR_RET(ParseTerm()));
+        } else {
+          return res;
+        }
+      }
+    }
+
+    StatusOr<std::unique_ptr<ArithmeticExpr>> ParseTerm() {
+      if (Eat('(')) {
+        auto res = GET_OR_RET(ParseSum());
+        if (!Eat(')')) return {Status::NotOK, "expect ')' in the expression of APPLY"};
+        return res;
+      }
+
+      auto res = std::make_unique<ArithmeticExpr>();
+      if (Eat('@')) {
+        auto begin = pos;
+        while (pos < str.size() && (std::isalnum(static_cast<unsigned char>(str[pos])) || str[pos] == '_')) pos++;
+        if (pos == begin) return {Status::NotOK, "expect a column name after '@' in the expression of APPLY"};
+
+        res->kind = COLUMN;
+        res->column = std::string(str.substr(begin, pos - begin));
+        return res;
+      }
+
+      SkipSpaces();
+      auto begin = pos;
+      if (pos < str.size() && (str[pos] == '-' || str[pos] == '+')) pos++;
+      while (pos < str.size() && (std::isdigit(static_cast<unsigned char>(str[pos])) || str[pos] == '.')) pos++;
+      if (pos < str.size() && (str[pos] == 'e' || str[pos] == 'E')) {
+        pos++;
+        if (pos < str.size() && (str[pos] == '-' || str[pos] == '+')) pos++;
+        while (pos < str.size() && std::isdigit(static_cast<unsigned char>(str[pos]))) pos++;
+      }
+
+      auto number = ParseFloat<double>(std::string(str.substr(begin, pos - begin)));
+      if (!number) return {Status::NotOK, "expect a number, a column or '(' in the expression of APPLY"};
+
+      res->number = *number;
+      return res;
+    }
+  };
+};
+
+}  // namespace kqir
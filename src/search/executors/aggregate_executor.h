@@ -0,0 +1,262 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "encoding.h"
+#include "search/plan_executor.h"
+#include "types/hyperloglog.h"
+#include "vendor/murmurhash2.h"
+
+namespace kqir {
+
+// AggregateExecutor reads its source by batches, and groups the rows of each batch by a hash table.
+// The columns of a batch are reduced one after another, after the groups of its rows are found.
+// All the groups are kept in memory until the source ends, so the aggregation fails once they take
+// more than max_memory bytes.
+struct AggregateExecutor : ExecutorNode {
+  // DistinctCounter estimates the number of distinct values by HyperLogLog, its registers are kept sparse
+  // until more than kHyperLogLogSparseMaxRegisters of them are non-zero, since most groups are small
+  struct DistinctCounter {
+    // the non-zero registers sorted by their indexes
+    std::vector<std::pair<uint16_t, uint8_t>> sparse;
+    // all the registers unpacked, if it isn't empty
+    std::vector<uint8_t> dense;
+
+    // Add returns the bytes of memory it takes more
+    size_t Add(std::string_view val) {
+      auto [index, count] = ExtractDenseHllResult(
+          HllMurMurHash64A(val.data(), static_cast<int32_t>(val.size()), kHyperLogLogHashSeed));
+
+      if (!dense.empty()) {
+        dense[index] = std::max(dense[index], count);
+        return 0;
+      }
+
+      auto iter = std::lower_bound(sparse.begin(), sparse.end(), index,
+                                   [](const auto &reg, uint32_t index) { return reg.first < index; });
+      if (iter != sparse.end() && iter->first == index) {
+        iter->second = std::max(iter->second, count);
+        return 0;
+      }
+
+      sparse.emplace(iter, index, count);
+      if (sparse.size() <= kHyperLogLogSparseMaxRegisters) return sizeof(sparse[0]);
+
+      dense.resize(kHyperLogLogRegisterCount);
+      for (const auto &[i, v] : sparse) dense[i] = v;
+      auto freed = sparse.size() * sizeof(sparse[0]);
+      sparse = {};
+      return kHyperLogLogRegisterCount - freed;
+    }
+
+    uint64_t Estimate() const { return dense.empty() ? HllSparseEstimate(sparse) : HllUnpackedEstimate(dense.data()); }
+  };
+
+  struct Accumulator {
+    uint64_t count = 0;
+    double sum = 0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    DistinctCounter distinct;
+  };
+
+  struct Group {
+    std::vector<ValueType> values;
+    std::vector<Accumulator> accumulators;
+  };
+
+  Aggregate *aggregate;
+  std::unordered_map<std::string, size_t> group_index;
+  std::vector<Group> groups;
+  size_t memory = 0;
+
+  std::vector<RowType> rows;
+  decltype(rows)::iterator rows_iter;
+  bool initialized = false;
+
+  AggregateExecutor(ExecutorContext *ctx, Aggregate *aggregate) : ExecutorNode(ctx), aggregate(aggregate) {}
+
+  StatusOr<Result> Next() override {
+    if (!initialized) {
+      while (true) {
+        auto batch = GET_OR_RET(ctx->Get(aggregate->source)->NextBatch());
+        if (batch.Empty()) break;
+
+        GET_OR_RET(reduceBatch(batch));
+      }
+
+      // there's a single group of all the rows if there's no group field, even if there's no row
+      if (aggregate->group_by.empty() && groups.empty()) {
+        groups.push_back(Group{{}, std::vector<Accumulator>(aggregate->reducers.size())});
+      }
+
+      makeRows();
+      initialized = true;
+      rows_iter = rows.begin();
+    }
+
+    if (rows_iter == rows.end()) {
+      return end;
+    }
+
+    return std::move(*rows_iter++);
+  }
+
+ private:
+  static const ValueType *ColumnValue(const RowBatch &batch, const FieldInfo *field, size_t i) {
+    if (auto iter = batch.columns.find(field); iter != batch.columns.end()) return &iter->second[i];
+    return nullptr;
+  }
+
+  Status reduceBatch(const RowBatch &batch) {
+    // the groups of the rows are found before the columns are reduced
+    std::vector<size_t> row_groups(batch.Size());
+    std::string key;
+    for (size_t i = 0; i < batch.Size(); i++) {
+      key.clear();
+      for (const auto &field : aggregate->group_by) {
+        auto val = ColumnValue(batch, field->info, i);
+        bool is_null = !val || val->IsNull();
+        key.push_back(is_null ? 0 : 1);
+        if (!is_null) PutSizedString(&key, val->ToString(field->info->metadata.get()));
+      }
+
+      auto [iter, inserted] = group_index.emplace(key, groups.size());
+      if (inserted) {
+        Group group{{}, std::vector<Accumulator>(aggregate->reducers.size())};
+        for (const auto &field : aggregate->group_by) {
+          auto val = ColumnValue(batch, field->info, i);
+          group.values.push_back(val ? *val : ValueType{});
+          memory += val ? val->ToString(field->info->metadata.get()).size() : 0;
+        }
+        groups.push_back(std::move(group));
+        memory += key.size() * 2 + sizeof(Group) + aggregate->reducers.size() * sizeof(Accumulator);
+      }
+      row_groups[i] = iter->second;
+    }
+
+    for (size_t r = 0; r < aggregate->reducers.size(); r++) {
+      const auto &reducer = aggregate->reducers[r];
+      for (size_t i = 0; i < batch.Size(); i++) {
+        auto &acc = groups[row_groups[i]].accumulators[r];
+        if (reducer.kind == Aggregate::COUNT) {
+          acc.count++;
+          continue;
+        }
+
+        auto val = ColumnValue(batch, reducer.field->info, i);
+        if (!val || val->IsNull()) continue;
+
+        if (reducer.kind == Aggregate::COUNT_DISTINCT) {
+          memory += acc.distinct.Add(val->ToString(reducer.field->info->metadata.get()));
+        } else if (val->Is<Numeric>()) {
+          auto num = val->Get<Numeric>();
+          acc.count++;
+          acc.sum += num;
+          acc.min = std::min(acc.min, num);
+          acc.max = std::max(acc.max, num);
+        }
+      }
+    }
+
+    if (aggregate->max_memory > 0 && memory > aggregate->max_memory) {
+      return {Status::NotOK, fmt::format("the groups of the aggregation take more than {} bytes of memory",
+                                         aggregate->max_memory)};
+    }
+
+    return Status::OK();
+  }
+
+  static ValueType ReducedValue(Aggregate::ReduceKind kind, const Accumulator &acc) {
+    switch (kind) {
+      case Aggregate::COUNT:
+        return static_cast<Numeric>(acc.count);
+      case Aggregate::SUM:
+        return acc.sum;
+      case Aggregate::AVG:
+        return acc.count > 0 ? ValueType(acc.sum / static_cast<double>(acc.count)) : ValueType{};
+      case Aggregate::MIN:
+        return acc.count > 0 ? ValueType(acc.min) : ValueType{};
+      case Aggregate::MAX:
+        return acc.count > 0 ? ValueType(acc.max) : ValueType{};
+      case Aggregate::COUNT_DISTINCT:
+        return static_cast<Numeric>(acc.distinct.Estimate());
+    }
+
+    __builtin_unreachable();
+  }
+
+  void makeRows() {
+    const auto &columns = aggregate->columns;
+    size_t num_reducers = aggregate->reducers.size();
+
+    rows.reserve(groups.size());
+    for (auto &group : groups) {
+      std::vector<ValueType> values = std::move(group.values);
+      for (size_t r = 0; r < num_reducers; r++) {
+        values.push_back(ReducedValue(aggregate->reducers[r].kind, group.accumulators[r]));
+      }
+      for (const auto &apply : aggregate->applies) {
+        auto res = apply.expr->Eval([&](const std::string &name) {
+          for (size_t i = 0; i < values.size(); i++) {
+            if (columns[i]->name == name && values[i].Is<Numeric>()) return values[i].Get<Numeric>();
+          }
+          return std::numeric_limits<double>::quiet_NaN();
+        });
+        values.push_back(std::isfinite(res) ? ValueType(res) : ValueType{});
+      }
+
+      RowType row{"", {}, nullptr};
+      for (size_t i = 0; i < values.size(); i++) {
+        if (!values[i].IsNull()) row.fields.emplace(columns[i], std::move(values[i]));
+      }
+      rows.push_back(std::move(row));
+    }
+    groups.clear();
+    group_index.clear();
+
+    if (!aggregate->sort_by) return;
+
+    // the numbers are ordered before the strings, and the rows without the column are always the last ones
+    const auto *sort_column = aggregate->sort_by->field->info;
+    bool desc = aggregate->sort_by->order == SortByClause::DESC;
+    auto less = [](const ValueType &l, const ValueType &r) {
+      if (l.Is<Numeric>() && r.Is<Numeric>()) return l.Get<Numeric>() < r.Get<Numeric>();
+      if (l.Is<Numeric>() != r.Is<Numeric>()) return l.Is<Numeric>();
+      return l.ToString() < r.ToString();
+    };
+    std::stable_sort(rows.begin(), rows.end(), [&](const RowType &l, const RowType &r) {
+      auto li = l.fields.find(sort_column), ri = r.fields.find(sort_column);
+      if (li == l.fields.end() || ri == r.fields.end()) return li != l.fields.end() && ri == r.fields.end();
+      return desc ? less(ri->second, li->second) : less(li->second, ri->second);
+    });
+  }
+};
+
+}  // namespace kqir
@@ -27,6 +27,7 @@
 #include "search/ir.h"
 #include "search/plan_executor.h"
 #include "search/search_encoding.h"
+#include "search/text_analyzer.h"
 #include "string_util.h"
 
 namespace kqir {
@@ -54,6 +55,9 @@ struct QueryExprEvaluator {
     if (auto v = dynamic_cast<TagContainExpr *>(e)) {
       return Visit(v);
     }
+    if (auto v = dynamic_cast<TextMatchExpr *>(e)) {
+      return Visit(v);
+    }
 
     CHECK(false) << "unreachable";
   }
@@ -78,7 +82,29 @@ struct QueryExprEvaluator {
 
   StatusOr<bool> Visit(TagContainExpr *v) const {
     auto val = GET_OR_RET(ctx->Retrieve(ctx->db_ctx, row, v->field->info));
+    return Match(v, val);
+  }
+
+  StatusOr<bool> Visit(TextMatchExpr *v) const {
+    auto val = GET_OR_RET(ctx->Retrieve(ctx->db_ctx, row, v->field->info));
+    return Match(v, QueryTokens(v), val);
+  }
+
+  StatusOr<bool> Visit(NumericCompareExpr *v) const {
+    auto val = GET_OR_RET(ctx->Retrieve(ctx->db_ctx, row, v->field->info));
+    return Match(v, val);
+  }
+
+  StatusOr<bool> Visit(VectorRangeExpr *v) const {
+    auto val = GET_OR_RET(ctx->Retrieve(ctx->db_ctx, row, v->field->info));
+    auto vector = GET_OR_RET(QueryVector(v));
+    return Match(v, vector, val);
+  }
 
+  // The atoms are matched against the retrieved values by the following functions,
+  // which are shared with QueryExprBatchEvaluator
+
+  static bool Match(TagContainExpr *v, const ExecutorNode::ValueType &val) {
     CHECK(val.Is<kqir::StringArray>());
     auto tags = val.Get<kqir::StringArray>();
 
@@ -91,11 +117,20 @@ struct QueryExprEvaluator {
     }
   }
 
-  StatusOr<bool> Visit(NumericCompareExpr *v) const {
-    auto l_val = GET_OR_RET(ctx->Retrieve(ctx->db_ctx, row, v->field->info));
+  static std::vector<std::string> QueryTokens(TextMatchExpr *v) {
+    return redis::TokenizeText(v->query->val, !v->field->info->MetadataAs<redis::TextFieldMetadata>()->nostem);
+  }
+
+  static bool Match(TextMatchExpr *v, const std::vector<std::string> &query, const ExecutorNode::ValueType &val) {
+    CHECK(val.Is<kqir::String>());
+    bool stem = !v->field->info->MetadataAs<redis::TextFieldMetadata>()->nostem;
 
-    CHECK(l_val.Is<kqir::Numeric>());
-    auto l = l_val.Get<kqir::Numeric>();
+    return redis::MatchTokens(redis::TokenizeText(val.Get<kqir::String>(), stem), query, v->phrase);
+  }
+
+  static bool Match(NumericCompareExpr *v, const ExecutorNode::ValueType &val) {
+    CHECK(val.Is<kqir::Numeric>());
+    auto l = val.Get<kqir::Numeric>();
     auto r = v->num->val;
 
     switch (v->op) {
@@ -117,25 +152,123 @@ struct QueryExprEvaluator {
     }
   }
 
-  StatusOr<bool> Visit(VectorRangeExpr *v) const {
-    auto val = GET_OR_RET(ctx->Retrieve(ctx->db_ctx, row, v->field->info));
+  static StatusOr<redis::VectorItem> QueryVector(VectorRangeExpr *v) {
+    auto meta = v->field->info->MetadataAs<redis::HnswVectorFieldMetadata>();
 
+    redis::VectorItem vector;
+    GET_OR_RET(redis::VectorItem::Create({}, v->vector->values, meta, &vector));
+    return vector;
+  }
+
+  static StatusOr<bool> Match(VectorRangeExpr *v, const redis::VectorItem &vector, const ExecutorNode::ValueType &val) {
     CHECK(val.Is<kqir::NumericArray>());
-    auto l_values = val.Get<kqir::NumericArray>();
-    auto r_values = v->vector->values;
     auto meta = v->field->info->MetadataAs<redis::HnswVectorFieldMetadata>();
 
-    redis::VectorItem left, right;
-    GET_OR_RET(redis::VectorItem::Create({}, l_values, meta, &left));
-    GET_OR_RET(redis::VectorItem::Create({}, r_values, meta, &right));
+    redis::VectorItem item;
+    GET_OR_RET(redis::VectorItem::Create({}, val.Get<kqir::NumericArray>(), meta, &item));
 
-    auto dist = GET_OR_RET(redis::ComputeSimilarity(left, right));
+    auto dist = GET_OR_RET(redis::ComputeSimilarity(item, vector));
     auto effective_range = v->range->val * (1 + meta->epsilon);
 
     return (dist >= -abs(effective_range) && dist <= abs(effective_range));
   }
 };
 
+// QueryExprBatchEvaluator evaluates a query expression over the columns of a batch of rows.
+//
+// Eval narrows a selection: the rows selected on entry are the ones to be evaluated, and
+// on return only the rows among them which match the expression are selected, so the
+// values of a field are only retrieved for the rows which aren't decided by the former
+// operands of an AND or OR expression.
+struct QueryExprBatchEvaluator {
+  using RowBatch = ExecutorNode::RowBatch;
+
+  ExecutorContext *ctx;
+  RowBatch &batch;
+
+  Status Eval(QueryExpr *e, RowBatch::Selection &sel) const {
+    if (auto v = dynamic_cast<AndExpr *>(e)) {
+      return Visit(v, sel);
+    }
+    if (auto v = dynamic_cast<OrExpr *>(e)) {
+      return Visit(v, sel);
+    }
+    if (auto v = dynamic_cast<NotExpr *>(e)) {
+      return Visit(v, sel);
+    }
+    if (auto v = dynamic_cast<VectorRangeExpr *>(e)) {
+      auto vector = GET_OR_RET(QueryExprEvaluator::QueryVector(v));
+      return Filter(v->field->info, sel, [v, &vector](const auto &val) {
+        return QueryExprEvaluator::Match(v, vector, val);
+      });
+    }
+    if (auto v = dynamic_cast<NumericCompareExpr *>(e)) {
+      return Filter(v->field->info, sel,
+                    [v](const auto &val) -> StatusOr<bool> { return QueryExprEvaluator::Match(v, val); });
+    }
+    if (auto v = dynamic_cast<TagContainExpr *>(e)) {
+      return Filter(v->field->info, sel,
+                    [v](const auto &val) -> StatusOr<bool> { return QueryExprEvaluator::Match(v, val); });
+    }
+    if (auto v = dynamic_cast<TextMatchExpr *>(e)) {
+      auto query = QueryExprEvaluator::QueryTokens(v);
+      return Filter(v->field->info, sel, [v, &query](const auto &val) -> StatusOr<bool> {
+        return QueryExprEvaluator::Match(v, query, val);
+      });
+    }
+
+    CHECK(false) << "unreachable";
+  }
+
+  Status Visit(AndExpr *v, RowBatch::Selection &sel) const {
+    for (const auto &n : v->inners) {
+      GET_OR_RET(Eval(n.get(), sel));
+    }
+
+    return Status::OK();
+  }
+
+  Status Visit(OrExpr *v, RowBatch::Selection &sel) const {
+    RowBatch::Selection res(sel.size(), 0);
+    for (const auto &n : v->inners) {
+      // the rows which are matched by the former operands aren't evaluated again
+      auto inner_sel = sel;
+      GET_OR_RET(Eval(n.get(), inner_sel));
+      for (size_t i = 0; i < sel.size(); i++) {
+        if (inner_sel[i]) {
+          res[i] = 1;
+          sel[i] = 0;
+        }
+      }
+    }
+
+    sel = std::move(res);
+    return Status::OK();
+  }
+
+  Status Visit(NotExpr *v, RowBatch::Selection &sel) const {
+    auto inner_sel = sel;
+    GET_OR_RET(Eval(v->inner.get(), inner_sel));
+    for (size_t i = 0; i < sel.size(); i++) {
+      if (inner_sel[i]) sel[i] = 0;
+    }
+
+    return Status::OK();
+  }
+
+  template <typename F>
+  Status Filter(const FieldInfo *field, RowBatch::Selection &sel, F &&match) const {
+    GET_OR_RET(ctx->RetrieveColumn(ctx->db_ctx, batch, field, &sel));
+
+    const auto &column = batch.columns[field];
+    for (size_t i = 0; i < sel.size(); i++) {
+      if (sel[i] && !GET_OR_RET(match(column[i]))) sel[i] = 0;
+    }
+
+    return Status::OK();
+  }
+};
+
 struct FilterExecutor : ExecutorNode {
   Filter *filter;
 
@@ -156,6 +289,20 @@ struct FilterExecutor : ExecutorNode {
       }
     }
   }
+
+  StatusOr<RowBatch> NextBatch() override {
+    while (true) {
+      auto batch = GET_OR_RET(ctx->Get(filter->source)->NextBatch());
+      if (batch.Empty()) return batch;
+
+      RowBatch::Selection sel(batch.Size(), 1);
+      QueryExprBatchEvaluator eval{ctx, batch};
+      GET_OR_RET(eval.Eval(filter->filter_expr.get(), sel));
+
+      batch.Select(sel);
+      if (!batch.Empty()) return batch;
+    }
+  }
 };
 
 }  // namespace kqir
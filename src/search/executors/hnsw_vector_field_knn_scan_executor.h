@@ -20,7 +20,10 @@
 
 #pragma once
 
+#include <algorithm>
 #include <string>
+#include <unordered_set>
+#include <vector>
 
 #include "db_util.h"
 #include "encoding.h"
@@ -34,8 +37,16 @@
 
 namespace kqir {
 
+// With a filter, the keys it selects are collected first, and the neighbours are searched either by
+// computing the distances to all of them, or by skipping the other nodes while the graph is traversed.
+// The traversal has to visit about ef / selectivity nodes to find ef allowed ones, where the selectivity
+// is the fraction of the vectors allowed, so the keys are searched by brute force if there're fewer of them.
+//
 // TODO(Beihao): Add DB context to improve consistency and isolation - see #2332
 struct HnswVectorFieldKnnScanExecutor : ExecutorNode {
+  // the max number of the allowed keys searched by brute force if the statistics of the field aren't collected
+  static constexpr size_t kBruteForceMaxKeys = 1024;
+
   HnswVectorFieldKnnScan *scan;
   bool initialized = false;
 
@@ -52,11 +63,15 @@ struct HnswVectorFieldKnnScanExecutor : ExecutorNode {
         index(scan->field->info->index),
         search_key(index->ns, index->name, scan->field->name),
         field_metadata(*(scan->field->info->MetadataAs<redis::HnswVectorFieldMetadata>())),
-        hnsw_index(redis::HnswIndex(search_key, &field_metadata, ctx->storage)) {}
+        hnsw_index(redis::HnswIndex(search_key, &field_metadata, ctx->storage, scan->field->info->hnsw_cache.get())) {}
 
   StatusOr<Result> Next() override {
     if (!initialized) {
-      row_keys = GET_OR_RET(hnsw_index.KnnSearch(ctx->db_ctx, scan->vector, scan->k));
+      if (scan->filter) {
+        row_keys = GET_OR_RET(filteredSearch());
+      } else {
+        row_keys = GET_OR_RET(hnsw_index.KnnSearch(ctx->db_ctx, scan->vector, scan->k, scan->ef_runtime));
+      }
       row_keys_iter = row_keys.begin();
       initialized = true;
     }
@@ -69,6 +84,33 @@ struct HnswVectorFieldKnnScanExecutor : ExecutorNode {
     row_keys_iter++;
     return RowType{key_str, {}, scan->field->info->index};
   }
+
+ private:
+  StatusOr<std::vector<redis::KeyWithDistance>> filteredSearch() {
+    auto filter = ctx->Get(scan->filter);
+    std::unordered_set<std::string> allowed;
+    while (true) {
+      auto batch = GET_OR_RET(filter->NextBatch());
+      if (batch.Empty()) break;
+      allowed.insert(std::make_move_iterator(batch.keys.begin()), std::make_move_iterator(batch.keys.end()));
+    }
+    if (allowed.empty()) return std::vector<redis::KeyWithDistance>{};
+
+    if (useBruteForce(allowed.size())) {
+      std::vector<std::string> keys(allowed.begin(), allowed.end());
+      return hnsw_index.BruteForceKnnSearch(ctx->db_ctx, scan->vector, scan->k, scan->ef_runtime, keys);
+    }
+    return hnsw_index.KnnSearch(ctx->db_ctx, scan->vector, scan->k, scan->ef_runtime, &allowed);
+  }
+
+  bool useBruteForce(uint64_t allowed) const {
+    const auto *stats = scan->field->info->stats.get();
+    if (!stats || !stats->IsComplete() || stats->GetCardinality() == 0) return allowed <= kBruteForceMaxKeys;
+
+    // allowed <= ef / (allowed / vectors)
+    uint64_t ef = std::max(scan->ef_runtime != 0 ? scan->ef_runtime : field_metadata.ef_runtime, scan->k);
+    return allowed * allowed <= ef * stats->GetCardinality();
+  }
 };
 
 }  // namespace kqir
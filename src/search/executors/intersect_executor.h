@@ -0,0 +1,143 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "db_util.h"
+#include "encoding.h"
+#include "search/plan_executor.h"
+#include "search/search_encoding.h"
+#include "storage/redis_metadata.h"
+#include "storage/storage.h"
+#include "string_util.h"
+
+namespace kqir {
+
+// IntersectExecutor intersects the postings of its scans, i.e. the keys under the prefix of a tag or
+// a numeric value, which are in the order of the sized keys.
+//
+// The postings are advanced in turn to the largest key seen so far, until they all reach the same key,
+// so the intersection costs about as much as reading the smallest posting. A posting is advanced by a
+// few Next calls first, which are cheaper than a Seek if the target is close, and seeks otherwise.
+struct IntersectExecutor : ExecutorNode {
+  // The number of Next calls tried before a Seek
+  static constexpr int kNextsBeforeSeek = 8;
+
+  struct Posting {
+    std::string prefix;
+    util::UniqueIterator iter{nullptr};
+
+    bool Valid() const { return iter->Valid() && iter->key().starts_with(prefix); }
+    Slice SizedKey() const { return {iter->key().data() + prefix.size(), iter->key().size() - prefix.size()}; }
+
+    // SeekTo moves to the first sized key not less than the target
+    void SeekTo(Slice target) {
+      for (int i = 0; i < kNextsBeforeSeek && Valid() && SizedKey().compare(target) < 0; i++) {
+        iter->Next();
+      }
+      if (Valid() && SizedKey().compare(target) < 0) {
+        iter->Seek(prefix + target.ToString());
+      }
+    }
+  };
+
+  Intersect *intersect;
+  const IndexInfo *index = nullptr;
+  std::vector<Posting> postings;
+  std::map<const FieldInfo *, ValueType> fields;
+  // the posting to be advanced next
+  size_t next = 0;
+  bool done = false;
+
+  IntersectExecutor(ExecutorContext *ctx, Intersect *intersect) : ExecutorNode(ctx), intersect(intersect) {
+    for (const auto &op : intersect->ops) {
+      auto scan = dynamic_cast<FieldScan *>(op.get());
+      CHECK(scan && Intersect::IsOrderedScan(scan));
+
+      auto info = scan->field->info;
+      index = info->index;
+      redis::SearchKey search_key(index->ns, index->name, info->name);
+      if (auto tag = dynamic_cast<TagFieldScan *>(scan)) {
+        // the tags of a case-insensitive field are indexed in lower case
+        bool case_sensitive = info->MetadataAs<redis::TagFieldMetadata>()->case_sensitive;
+        auto prefix = search_key.ConstructTagFieldPrefix(case_sensitive ? tag->tag : util::ToLower(tag->tag));
+        postings.push_back(Posting{std::move(prefix)});
+      } else {
+        auto num = dynamic_cast<NumericFieldScan *>(scan)->range.l;
+        postings.push_back(Posting{search_key.ConstructNumericFieldPrefix(num)});
+        fields.emplace(info, kqir::MakeValue<kqir::Numeric>(num));
+      }
+    }
+  }
+
+  StatusOr<Result> Next() override {
+    if (done) {
+      return end;
+    }
+
+    if (!postings.front().iter) {
+      for (auto &posting : postings) {
+        posting.iter = util::UniqueIterator(ctx->db_ctx, ctx->db_ctx.DefaultScanOptions(),
+                                            ctx->storage->GetCFHandle(ColumnFamilyID::Search));
+        posting.iter->Seek(posting.prefix);
+      }
+    } else {
+      // move past the last yielded key
+      postings[next].iter->Next();
+    }
+
+    std::string target;
+    for (size_t matched = 0; matched < postings.size(); next = (next + 1) % postings.size()) {
+      auto &posting = postings[next];
+      if (!target.empty()) posting.SeekTo(target);
+
+      if (auto s = posting.iter->status(); !s.ok()) {
+        return {Status::NotOK, s.ToString()};
+      }
+      if (!posting.Valid()) {
+        done = true;
+        return end;
+      }
+
+      if (auto key = posting.SizedKey(); key == target) {
+        matched++;
+      } else {
+        target = key.ToString();
+        matched = 1;
+      }
+    }
+
+    // the postings are all at the target, and the one before `next` is advanced by the next call
+    next = (next + postings.size() - 1) % postings.size();
+
+    Slice sized_key = target;
+    Slice user_key;
+    if (!GetSizedString(&sized_key, &user_key)) {
+      return {Status::NotOK, "failed to decode the key of the index"};
+    }
+    return RowType{user_key.ToString(), fields, index};
+  }
+};
+
+}  // namespace kqir
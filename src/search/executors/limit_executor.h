@@ -27,6 +27,8 @@ namespace kqir {
 struct LimitExecutor : ExecutorNode {
   Limit *limit;
   size_t step = 0;
+  // the number of rows skipped by NextBatch
+  size_t skipped = 0;
 
   LimitExecutor(ExecutorContext *ctx, Limit *limit) : ExecutorNode(ctx), limit(limit) {}
 
@@ -52,6 +54,31 @@ struct LimitExecutor : ExecutorNode {
     step++;
     return res;
   }
+
+  StatusOr<RowBatch> NextBatch() override {
+    auto offset = limit->limit->offset;
+    auto count = limit->limit->count;
+
+    while (step < count) {
+      auto batch = GET_OR_RET(ctx->Get(limit->op)->NextBatch());
+      if (batch.Empty()) return batch;
+
+      RowBatch::Selection sel(batch.Size(), 0);
+      for (size_t i = 0; i < batch.Size() && step < count; i++) {
+        if (skipped < offset) {
+          skipped++;
+        } else {
+          sel[i] = 1;
+          step++;
+        }
+      }
+
+      batch.Select(sel);
+      if (!batch.Empty()) return batch;
+    }
+
+    return RowBatch{};
+  }
 };
 
 }  // namespace kqir
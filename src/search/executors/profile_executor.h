@@ -0,0 +1,83 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <rocksdb/perf_context.h>
+
+#include <chrono>
+#include <memory>
+
+#include "search/plan_executor.h"
+
+namespace kqir {
+
+// ProfileExecutor wraps an executor for FT.PROFILE, and counts its calls, its rows, its time and its reads
+// from RocksDB into the profile. The reads are only counted if the perf level of RocksDB is kEnableCount or above.
+struct ProfileExecutor : ExecutorNode {
+  std::unique_ptr<ExecutorNode> inner;
+  ExecutorProfile *profile;
+
+  ProfileExecutor(ExecutorContext *ctx, std::unique_ptr<ExecutorNode> inner, ExecutorProfile *profile)
+      : ExecutorNode(ctx), inner(std::move(inner)), profile(profile) {}
+
+  StatusOr<Result> Next() override {
+    Measure measure(profile);
+    auto res = GET_OR_RET(inner->Next());
+    if (std::holds_alternative<RowType>(res)) profile->rows++;
+    return res;
+  }
+
+  StatusOr<RowBatch> NextBatch() override {
+    Measure measure(profile);
+    auto batch = GET_OR_RET(inner->NextBatch());
+    profile->rows += batch.Size();
+    return batch;
+  }
+
+ private:
+  // Measure adds the time and the reads of a call to the profile when it's destructed
+  struct Measure {
+    ExecutorProfile *profile;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    uint64_t keys_scanned = rocksdb::get_perf_context()->internal_key_skipped_count;
+    uint64_t read_bytes = ReadBytes();
+    uint64_t block_reads = rocksdb::get_perf_context()->block_read_count;
+
+    explicit Measure(ExecutorProfile *profile) : profile(profile) { profile->calls++; }
+    ~Measure() {
+      auto elapsed = std::chrono::steady_clock::now() - start;
+      profile->time_us += std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+      profile->keys_scanned += rocksdb::get_perf_context()->internal_key_skipped_count - keys_scanned;
+      profile->read_bytes += ReadBytes() - read_bytes;
+      profile->block_reads += rocksdb::get_perf_context()->block_read_count - block_reads;
+    }
+
+    Measure(const Measure &) = delete;
+    Measure &operator=(const Measure &) = delete;
+
+    static uint64_t ReadBytes() {
+      const auto *perf = rocksdb::get_perf_context();
+      return perf->get_read_bytes + perf->multiget_read_bytes + perf->iter_read_bytes;
+    }
+  };
+};
+
+}  // namespace kqir
@@ -53,6 +53,35 @@ struct ProjectionExecutor : ExecutorNode {
 
     return v;
   }
+
+  StatusOr<RowBatch> NextBatch() override {
+    auto batch = GET_OR_RET(ctx->Get(proj->source)->NextBatch());
+    if (batch.Empty()) return batch;
+
+    if (proj->select->fields.empty()) {
+      for (size_t i = 0; i < batch.Size(); i++) {
+        if (i > 0 && batch.indexes[i] == batch.indexes[i - 1]) continue;
+
+        // the rows of a batch are almost always of the same index
+        RowBatch::Selection sel(batch.Size());
+        for (size_t j = i; j < batch.Size(); j++) sel[j] = batch.indexes[j] == batch.indexes[i];
+        for (const auto &field : batch.indexes[i]->fields) {
+          GET_OR_RET(ctx->RetrieveColumn(ctx->db_ctx, batch, &field.second, &sel));
+        }
+      }
+    } else {
+      std::map<const FieldInfo *, std::vector<ValueType>> columns;
+
+      for (const auto &field : proj->select->fields) {
+        GET_OR_RET(ctx->RetrieveColumn(ctx->db_ctx, batch, field->info));
+        columns.emplace(field->info, std::move(batch.columns[field->info]));
+      }
+
+      batch.columns = std::move(columns);
+    }
+
+    return batch;
+  }
 };
 
 }  // namespace kqir
@@ -0,0 +1,154 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "search/plan_executor.h"
+#include "search/search_encoding.h"
+#include "search/text_analyzer.h"
+#include "search/text_index.h"
+#include "storage/storage.h"
+
+namespace kqir {
+
+// TextFieldScanExecutor scores the keys whose texts contain all the terms by BM25,
+// and returns them in the descending order of their scores.
+//
+// The postings of the terms are intersected from the rarest one. The other postings are sought to
+// the key of the rarest one, which skips their blocks before the key without decoding them, and the
+// rarest posting is sought to the largest key found, until they all reach the same key.
+struct TextFieldScanExecutor : ExecutorNode {
+  static constexpr double kK1 = 1.2;
+  static constexpr double kB = 0.75;
+
+  struct Term {
+    std::string term;
+    uint64_t freq;
+    double idf;
+    redis::TextPostingCursor cursor;
+  };
+
+  TextFieldScan *scan;
+  std::vector<RowType> rows;
+  size_t pos = 0;
+  bool scanned = false;
+
+  TextFieldScanExecutor(ExecutorContext *ctx, TextFieldScan *scan) : ExecutorNode(ctx), scan(scan) {}
+
+  StatusOr<Result> Next() override {
+    if (!scanned) {
+      GET_OR_RET(Scan());
+      scanned = true;
+    }
+
+    if (pos >= rows.size()) return end;
+    return std::move(rows[pos++]);
+  }
+
+  Status Scan() {
+    const auto *info = scan->field->info;
+    redis::SearchKey search_key(info->index->ns, info->index->name, info->name);
+    redis::TextIndex text_index(search_key, ctx->storage);
+
+    auto header = GET_OR_RET(text_index.GetFieldHeader(ctx->db_ctx));
+    if (header.docs == 0 || scan->terms.empty()) return Status::OK();
+    auto avg_length = static_cast<double>(header.tokens) / static_cast<double>(header.docs);
+
+    std::vector<Term> terms;
+    for (const auto &term : std::set<std::string>(scan->terms.begin(), scan->terms.end())) {
+      auto freq = GET_OR_RET(text_index.GetDocFreq(ctx->db_ctx, term));
+      if (freq == 0) return Status::OK();
+
+      auto n = static_cast<double>(header.docs), f = static_cast<double>(freq);
+      terms.push_back({term, freq, std::log(1 + (n - f + 0.5) / (f + 0.5)),
+                       redis::TextPostingCursor(ctx->db_ctx, search_key, term)});
+    }
+    std::sort(terms.begin(), terms.end(), [](const Term &l, const Term &r) { return l.freq < r.freq; });
+
+    std::vector<std::pair<double, std::string>> scored;
+    auto &lead = terms[0].cursor;
+    GET_OR_RET(lead.Seek({}));
+    bool exhausted = false;
+    while (lead.Valid() && !exhausted) {
+      std::string target = lead.Get().key;
+      bool matched = true;
+      for (size_t i = 1; i < terms.size() && matched && !exhausted; i++) {
+        auto &cursor = terms[i].cursor;
+        GET_OR_RET(cursor.Seek(target));
+        if (!cursor.Valid()) {
+          exhausted = true;
+        } else if (cursor.Get().key != target) {
+          target = cursor.Get().key;
+          matched = false;
+        }
+      }
+      if (exhausted) break;
+
+      if (!matched) {
+        GET_OR_RET(lead.Seek(target));
+        continue;
+      }
+
+      if (!scan->phrase || MatchPhrase(terms)) scored.emplace_back(Score(terms, avg_length), std::move(target));
+      GET_OR_RET(lead.Next());
+    }
+
+    std::sort(scored.begin(), scored.end(), [](const auto &l, const auto &r) {
+      return l.first > r.first || (l.first == r.first && l.second < r.second);
+    });
+    for (auto &[_, key] : scored) {
+      rows.push_back(RowType{std::move(key), {}, info->index});
+    }
+
+    return Status::OK();
+  }
+
+  // MatchPhrase checks the positions of the terms at the current key in the order of the phrase
+  bool MatchPhrase(const std::vector<Term> &terms) const {
+    std::vector<const std::vector<uint32_t> *> positions;
+    for (const auto &term : scan->terms) {
+      auto iter = std::find_if(terms.begin(), terms.end(), [&term](const Term &t) { return t.term == term; });
+      positions.push_back(&iter->cursor.Get().positions);
+    }
+
+    return redis::MatchPhrase(positions);
+  }
+
+  static double Score(const std::vector<Term> &terms, double avg_length) {
+    double score = 0;
+    for (const auto &term : terms) {
+      const auto &posting = term.cursor.Get();
+      auto tf = static_cast<double>(posting.positions.size());
+      auto norm = 1 - kB + kB * static_cast<double>(posting.length) / avg_length;
+      score += term.idf * tf * (kK1 + 1) / (tf + kK1 * norm);
+    }
+
+    return score;
+  }
+};
+
+}  // namespace kqir
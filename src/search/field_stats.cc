@@ -0,0 +1,232 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "field_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <set>
+
+#include "string_util.h"
+
+namespace redis {
+
+void FieldStats::Update(const IndexFieldMetadata *metadata, const kqir::Value &original, const kqir::Value &current) {
+  std::lock_guard<std::mutex> guard(mu_);
+  updates_++;
+
+  if (original.IsNull() && !current.IsNull()) {
+    cardinality_++;
+  } else if (!original.IsNull() && current.IsNull() && cardinality_ > 0) {
+    cardinality_--;
+  }
+
+  if (auto tag = dynamic_cast<const TagFieldMetadata *>(metadata)) {
+    auto to_tag_set = [tag](const kqir::Value &value) {
+      std::set<std::string> res;
+      if (!value.Is<kqir::StringArray>()) return res;
+      for (const auto &t : value.Get<kqir::StringArray>()) {
+        res.emplace(tag->case_sensitive ? t : util::ToLower(t));
+      }
+      return res;
+    };
+
+    for (const auto &t : to_tag_set(original)) addTag(t, false);
+    for (const auto &t : to_tag_set(current)) addTag(t, true);
+  } else if (dynamic_cast<const NumericFieldMetadata *>(metadata)) {
+    if (original.Is<kqir::Numeric>()) {
+      auto &count = histogram_[BucketOf(original.Get<kqir::Numeric>())];
+      if (count > 0) count--;
+    }
+    if (current.Is<kqir::Numeric>()) {
+      histogram_[BucketOf(current.Get<kqir::Numeric>())]++;
+    }
+  }
+}
+
+void FieldStats::addTag(const std::string &tag, bool add) {
+  auto iter = tags_.find(tag);
+  if (add) {
+    if (iter != tags_.end()) {
+      iter->second++;
+    } else if (tags_.size() < kMaxTags) {
+      tags_.emplace(tag, 1);
+    } else {
+      untracked_tags_++;
+    }
+  } else {
+    if (iter != tags_.end()) {
+      if (--iter->second == 0) tags_.erase(iter);
+    } else if (untracked_tags_ > 0) {
+      untracked_tags_--;
+    }
+  }
+}
+
+bool FieldStats::IsComplete() const {
+  std::lock_guard<std::mutex> guard(mu_);
+  return complete_;
+}
+
+uint64_t FieldStats::GetCardinality() const {
+  std::lock_guard<std::mutex> guard(mu_);
+  return cardinality_;
+}
+
+double FieldStats::TagSelectivity(const TagFieldMetadata *metadata, const std::string &tag) const {
+  std::lock_guard<std::mutex> guard(mu_);
+  if (cardinality_ == 0) return 0;
+
+  double count = 0;
+  if (auto iter = tags_.find(metadata->case_sensitive ? tag : util::ToLower(tag)); iter != tags_.end()) {
+    count = static_cast<double>(iter->second);
+  } else if (untracked_tags_ > 0) {
+    // the tag may be one of the untracked ones, which are assumed to be as common as the tracked ones
+    uint64_t tracked = 0;
+    for (const auto &[_, n] : tags_) tracked += n;
+    count = std::min(static_cast<double>(tracked) / static_cast<double>(std::max<size_t>(tags_.size(), 1)),
+                     static_cast<double>(untracked_tags_));
+  }
+
+  return std::min(count / static_cast<double>(cardinality_), 1.0);
+}
+
+double FieldStats::NumericSelectivity(double l, double r) const {
+  std::lock_guard<std::mutex> guard(mu_);
+
+  double total = 0, count = 0;
+  for (size_t i = 0; i < kBuckets; i++) {
+    if (histogram_[i] == 0) continue;
+
+    auto n = static_cast<double>(histogram_[i]);
+    total += n;
+
+    auto [lo, hi] = BucketBounds(i);
+    auto overlap_l = std::max(lo, l), overlap_r = std::min(hi, r);
+    if (overlap_l >= overlap_r) continue;
+
+    // the values are assumed to be uniform in a bucket, and a range overlapping a bucket matches one value at least
+    double fraction = std::isinf(hi - lo) ? (overlap_l == lo && overlap_r == hi ? 1 : 0.5)
+                                          : (overlap_r - overlap_l) / (hi - lo);
+    count += std::max(n * fraction, 1.0);
+  }
+
+  if (total == 0) return 0;
+  return std::min(count / total, 1.0);
+}
+
+bool FieldStats::NeedSave() {
+  std::lock_guard<std::mutex> guard(mu_);
+  if (updates_ < kSaveInterval) return false;
+  updates_ = 0;
+  return true;
+}
+
+void FieldStats::Encode(std::string *dst) const {
+  std::lock_guard<std::mutex> guard(mu_);
+
+  PutFixed8(dst, complete_);
+  PutFixed64(dst, cardinality_);
+
+  PutFixed32(dst, tags_.size());
+  for (const auto &[tag, count] : tags_) {
+    PutSizedString(dst, tag);
+    PutFixed64(dst, count);
+  }
+  PutFixed64(dst, untracked_tags_);
+
+  auto buckets = std::count_if(histogram_.begin(), histogram_.end(), [](uint64_t n) { return n > 0; });
+  PutFixed32(dst, static_cast<uint32_t>(buckets));
+  for (size_t i = 0; i < kBuckets; i++) {
+    if (histogram_[i] == 0) continue;
+    PutFixed16(dst, static_cast<uint16_t>(i));
+    PutFixed64(dst, histogram_[i]);
+  }
+}
+
+rocksdb::Status FieldStats::Decode(Slice *input) {
+  std::lock_guard<std::mutex> guard(mu_);
+
+  uint8_t complete = 0;
+  uint32_t size = 0;
+  if (!GetFixed8(input, &complete) || !GetFixed64(input, &cardinality_) || !GetFixed32(input, &size)) {
+    return rocksdb::Status::Corruption(kErrorInsufficientLength);
+  }
+  complete_ = complete;
+
+  tags_.clear();
+  for (uint32_t i = 0; i < size; i++) {
+    Slice tag;
+    uint64_t count = 0;
+    if (!GetSizedString(input, &tag) || !GetFixed64(input, &count)) {
+      return rocksdb::Status::Corruption(kErrorInsufficientLength);
+    }
+    tags_.emplace(tag.ToString(), count);
+  }
+
+  if (!GetFixed64(input, &untracked_tags_) || !GetFixed32(input, &size)) {
+    return rocksdb::Status::Corruption(kErrorInsufficientLength);
+  }
+
+  histogram_.fill(0);
+  for (uint32_t i = 0; i < size; i++) {
+    uint16_t bucket = 0;
+    uint64_t count = 0;
+    if (!GetFixed16(input, &bucket) || !GetFixed64(input, &count)) {
+      return rocksdb::Status::Corruption(kErrorInsufficientLength);
+    }
+    if (bucket >= kBuckets) {
+      return rocksdb::Status::Corruption("invalid bucket of the numeric histogram");
+    }
+    histogram_[bucket] = count;
+  }
+
+  return rocksdb::Status::OK();
+}
+
+size_t FieldStats::BucketOf(double value) {
+  auto abs = std::fabs(value);
+  if (std::isnan(value) || abs < std::ldexp(1.0, kMinExp)) return kZeroBucket;
+
+  int exp = kMaxExp - 1;
+  if (!std::isinf(abs)) {
+    // abs = m * 2^exp with m in [0.5, 1), so it's in [2^(exp-1), 2^exp)
+    std::frexp(abs, &exp);
+    exp = std::clamp(exp - 1, kMinExp, kMaxExp - 1);
+  }
+
+  auto offset = static_cast<size_t>(exp - kMinExp) + 1;
+  return value > 0 ? kZeroBucket + offset : kZeroBucket - offset;
+}
+
+std::pair<double, double> FieldStats::BucketBounds(size_t bucket) {
+  constexpr double inf = std::numeric_limits<double>::infinity();
+  if (bucket == kZeroBucket) return {-std::ldexp(1.0, kMinExp), std::ldexp(1.0, kMinExp)};
+
+  auto offset = bucket > kZeroBucket ? bucket - kZeroBucket : kZeroBucket - bucket;
+  int exp = static_cast<int>(offset - 1) + kMinExp;
+  double lo = std::ldexp(1.0, exp), hi = exp == kMaxExp - 1 ? inf : std::ldexp(1.0, exp + 1);
+
+  if (bucket > kZeroBucket) return {lo, hi};
+  return {-hi, -lo};
+}
+
+}  // namespace redis
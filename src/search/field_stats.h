@@ -0,0 +1,93 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <string>
+
+#include "search/search_encoding.h"
+#include "search/value.h"
+
+namespace redis {
+
+// FieldStats are the statistics of the values of an indexed field, i.e. the number of keys
+// with the field, the number of keys of each tag, and a histogram of the numeric values.
+// They're updated with the index and used by the cost model to estimate the selectivity of
+// the scans of the field.
+//
+// The statistics are saved to the search column family every kSaveInterval updates and on
+// shutdown, so they're approximate: the updates since the last save are lost on a crash,
+// and a key indexed again, e.g. by a resumed build, is counted again.
+class FieldStats {
+ public:
+  // The tags beyond it are only counted in total
+  static constexpr size_t kMaxTags = 4096;
+  static constexpr uint64_t kSaveInterval = 1024;
+
+  // The histogram has a bucket per power of two of the absolute values in [2^kMinExp, 2^kMaxExp),
+  // for each sign, with the smaller values in the middle bucket and the larger ones in the last buckets
+  static constexpr int kMinExp = -32;
+  static constexpr int kMaxExp = 64;
+  static constexpr size_t kZeroBucket = kMaxExp - kMinExp;
+  static constexpr size_t kBuckets = kZeroBucket * 2 + 1;
+
+  // The statistics of an index created before they're collected are incomplete until it's rebuilt
+  explicit FieldStats(bool complete = true) : complete_(complete) {}
+
+  FieldStats(const FieldStats &) = delete;
+  FieldStats &operator=(const FieldStats &) = delete;
+
+  void Update(const IndexFieldMetadata *metadata, const kqir::Value &original, const kqir::Value &current);
+
+  bool IsComplete() const;
+  uint64_t GetCardinality() const;
+  // The estimated fraction of the keys with the field which have the tag or a value in [l, r)
+  double TagSelectivity(const TagFieldMetadata *metadata, const std::string &tag) const;
+  double NumericSelectivity(double l, double r) const;
+
+  // NeedSave returns true once in kSaveInterval updates
+  bool NeedSave();
+  void Encode(std::string *dst) const;
+  rocksdb::Status Decode(Slice *input);
+
+  static size_t BucketOf(double value);
+  // The bounds [lo, hi) of a bucket, the first and the last ones are unbounded
+  static std::pair<double, double> BucketBounds(size_t bucket);
+
+ private:
+  mutable std::mutex mu_;
+  bool complete_;
+  uint64_t updates_ = 0;
+
+  uint64_t cardinality_ = 0;
+  std::map<std::string, uint64_t> tags_;
+  // the number of the tags which aren't in tags_
+  uint64_t untracked_tags_ = 0;
+  std::array<uint64_t, kBuckets> histogram_{};
+
+  void addTag(const std::string &tag, bool add);
+};
+
+}  // namespace redis
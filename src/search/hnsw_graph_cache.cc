@@ -0,0 +1,220 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "hnsw_graph_cache.h"
+
+#include "encoding.h"
+
+namespace redis {
+
+bool HnswGraphCache::LookupMetadata(uint16_t level, std::string_view key, HnswNodeFieldMetadata *metadata) {
+  auto cache_key = cacheKey(level, key);
+  auto &shard = shardOf(cache_key);
+  std::lock_guard<std::mutex> guard(shard.mutex);
+
+  auto iter = shard.index.find(cache_key);
+  if (iter == shard.index.end() || !iter->second->metadata) {
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  if (!iter->second->resident) shard.lru.splice(shard.lru.begin(), shard.lru, iter->second);
+  *metadata = *iter->second->metadata;
+  hits_.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+bool HnswGraphCache::LookupNeighbours(uint16_t level, std::string_view key, std::vector<std::string> *neighbours) {
+  auto cache_key = cacheKey(level, key);
+  auto &shard = shardOf(cache_key);
+  std::lock_guard<std::mutex> guard(shard.mutex);
+
+  auto iter = shard.index.find(cache_key);
+  if (iter == shard.index.end() || !iter->second->neighbours) {
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  if (!iter->second->resident) shard.lru.splice(shard.lru.begin(), shard.lru, iter->second);
+  *neighbours = *iter->second->neighbours;
+  hits_.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+uint64_t HnswGraphCache::GetGeneration(uint16_t level, std::string_view key) {
+  auto &shard = shardOf(cacheKey(level, key));
+  std::lock_guard<std::mutex> guard(shard.mutex);
+  return shard.generation;
+}
+
+void HnswGraphCache::InsertMetadata(uint16_t level, std::string_view key, const HnswNodeFieldMetadata &metadata,
+                                    uint64_t generation, size_t capacity) {
+  insert(level, key, generation, capacity, [&metadata](Entry &entry) { entry.metadata = metadata; });
+}
+
+void HnswGraphCache::InsertNeighbours(uint16_t level, std::string_view key,
+                                      const std::vector<std::string> &neighbours, uint64_t generation,
+                                      size_t capacity) {
+  insert(level, key, generation, capacity, [&neighbours](Entry &entry) { entry.neighbours = neighbours; });
+}
+
+template <typename Fill>
+void HnswGraphCache::insert(uint16_t level, std::string_view key, uint64_t generation, size_t capacity, Fill &&fill) {
+  auto cache_key = cacheKey(level, key);
+  auto &shard = shardOf(cache_key);
+  std::lock_guard<std::mutex> guard(shard.mutex);
+
+  // The shard was written after the node was read, so it may be stale
+  if (shard.generation != generation) return;
+
+  size_t shard_capacity = capacity / kShards;
+  Entry entry;
+  if (auto iter = shard.index.find(cache_key); iter != shard.index.end()) {
+    entry = std::move(*iter->second);
+    eraseEntry(shard, iter);
+  } else {
+    entry.key = std::move(cache_key);
+    entry.resident = level > 0;
+  }
+
+  fill(entry);
+  entry.charge = charge(entry);
+  if (entry.charge > shard_capacity) return;
+
+  // The resident nodes can't be evicted, so they're only kept while they fit in the budget
+  if (entry.resident && shard.usage + entry.charge > shard_capacity) {
+    while (!shard.lru.empty() && shard.usage + entry.charge > shard_capacity) {
+      eraseEntry(shard, shard.index.find(shard.lru.back().key));
+    }
+    if (shard.usage + entry.charge > shard_capacity) return;
+  }
+
+  shard.usage += entry.charge;
+  auto &list = entry.resident ? shard.resident : shard.lru;
+  list.emplace_front(std::move(entry));
+  shard.index.emplace(list.front().key, list.begin());
+
+  while (shard.usage > shard_capacity && !shard.lru.empty()) {
+    eraseEntry(shard, shard.index.find(shard.lru.back().key));
+  }
+}
+
+void HnswGraphCache::Erase(uint16_t level, std::string_view key) {
+  auto cache_key = cacheKey(level, key);
+  auto &shard = shardOf(cache_key);
+  std::lock_guard<std::mutex> guard(shard.mutex);
+
+  shard.generation++;
+  if (auto iter = shard.index.find(cache_key); iter != shard.index.end()) {
+    eraseEntry(shard, iter);
+  }
+}
+
+void HnswGraphCache::Invalidate(const SearchKey &search_key, rocksdb::WriteBatch *batch, uint32_t search_cf_id) {
+  class Invalidator : public rocksdb::WriteBatch::Handler {
+   public:
+    Invalidator(HnswGraphCache *cache, std::string prefix, uint32_t search_cf_id)
+        : cache_(cache), prefix_(std::move(prefix)), search_cf_id_(search_cf_id) {}
+
+    rocksdb::Status PutCF(uint32_t column_family_id, const Slice &key, [[maybe_unused]] const Slice &value) override {
+      return DeleteCF(column_family_id, key);
+    }
+    rocksdb::Status DeleteCF(uint32_t column_family_id, const Slice &key) override {
+      if (column_family_id != search_cf_id_ || !key.starts_with(prefix_)) return rocksdb::Status::OK();
+
+      // Both `level | NODE | node` and `level | EDGE | node | neighbour` change the node
+      Slice input(key.data() + prefix_.size(), key.size() - prefix_.size());
+      uint16_t level = 0;
+      uint8_t type = 0;
+      Slice node;
+      if (GetFixed16(&input, &level) && GetFixed8(&input, &type) && GetSizedString(&input, &node)) {
+        cache_->Erase(level, node.ToStringView());
+      }
+      return rocksdb::Status::OK();
+    }
+    rocksdb::Status SingleDeleteCF(uint32_t column_family_id, const Slice &key) override {
+      return DeleteCF(column_family_id, key);
+    }
+    rocksdb::Status MergeCF(uint32_t column_family_id, const Slice &key, [[maybe_unused]] const Slice &value) override {
+      return DeleteCF(column_family_id, key);
+    }
+    rocksdb::Status DeleteRangeCF(uint32_t column_family_id, [[maybe_unused]] const Slice &begin_key,
+                                  [[maybe_unused]] const Slice &end_key) override {
+      if (column_family_id == search_cf_id_) cache_->Clear();
+      return rocksdb::Status::OK();
+    }
+
+   private:
+    HnswGraphCache *cache_;
+    std::string prefix_;
+    uint32_t search_cf_id_;
+  };
+
+  Invalidator invalidator(this, search_key.ConstructHnswFieldPrefix(), search_cf_id);
+  auto s = batch->Iterate(&invalidator);
+  if (!s.ok()) Clear();
+}
+
+void HnswGraphCache::Clear() {
+  for (auto &shard : shards_) {
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    shard.generation++;
+    shard.index.clear();
+    shard.lru.clear();
+    shard.resident.clear();
+    shard.usage = 0;
+  }
+}
+
+size_t HnswGraphCache::GetUsage() {
+  size_t usage = 0;
+  for (auto &shard : shards_) {
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    usage += shard.usage;
+  }
+  return usage;
+}
+
+std::string HnswGraphCache::cacheKey(uint16_t level, std::string_view key) {
+  std::string cache_key;
+  PutFixed16(&cache_key, level);
+  cache_key.append(key);
+  return cache_key;
+}
+
+size_t HnswGraphCache::charge(const Entry &entry) {
+  size_t charge = entry.key.size() + kEntryOverhead;
+  if (entry.metadata) charge += entry.metadata->vector.size() * sizeof(double);
+  if (entry.neighbours) {
+    for (const auto &neighbour : *entry.neighbours) {
+      charge += neighbour.size() + kNeighbourOverhead;
+    }
+  }
+  return charge;
+}
+
+void HnswGraphCache::eraseEntry(Shard &shard, Index::iterator iter) {
+  auto entry = iter->second;
+  shard.usage -= entry->charge;
+  shard.index.erase(iter);
+  (entry->resident ? shard.resident : shard.lru).erase(entry);
+}
+
+}  // namespace redis
@@ -0,0 +1,117 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <rocksdb/write_batch.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "search/search_encoding.h"
+
+namespace redis {
+
+// HnswGraphCache keeps the decoded nodes of the HNSW graph of a vector field in memory,
+// i.e. the node metadata (the vector and its norm) and the adjacency list of each node.
+//
+// The nodes above layer 0 are few and visited by every search, so they stay resident
+// once read. The nodes of layer 0 are kept in an LRU within the rest of the budget.
+//
+// Like the MetadataCache, it holds the latest committed graph: the nodes written by a
+// batch of the index are erased after the batch is written, and a read which raced with
+// a write of the same shard isn't inserted.
+class HnswGraphCache {
+ public:
+  static constexpr size_t kShards = 16;
+
+  HnswGraphCache() = default;
+
+  HnswGraphCache(const HnswGraphCache &) = delete;
+  HnswGraphCache &operator=(const HnswGraphCache &) = delete;
+
+  bool LookupMetadata(uint16_t level, std::string_view key, HnswNodeFieldMetadata *metadata);
+  bool LookupNeighbours(uint16_t level, std::string_view key, std::vector<std::string> *neighbours);
+
+  // Read the generation before reading the DB, and pass it to the Insert methods.
+  // The capacity is the budget in bytes of the whole cache.
+  uint64_t GetGeneration(uint16_t level, std::string_view key);
+  void InsertMetadata(uint16_t level, std::string_view key, const HnswNodeFieldMetadata &metadata,
+                      uint64_t generation, size_t capacity);
+  void InsertNeighbours(uint16_t level, std::string_view key, const std::vector<std::string> &neighbours,
+                        uint64_t generation, size_t capacity);
+
+  void Erase(uint16_t level, std::string_view key);
+  // Invalidate erases the nodes and the adjacency lists written by the batch to the graph of the field
+  void Invalidate(const SearchKey &search_key, rocksdb::WriteBatch *batch, uint32_t search_cf_id);
+  void Clear();
+
+  uint64_t GetHits() const { return hits_.load(std::memory_order_relaxed); }
+  uint64_t GetMisses() const { return misses_.load(std::memory_order_relaxed); }
+  size_t GetUsage();
+
+ private:
+  struct Entry {
+    std::string key;
+    std::optional<HnswNodeFieldMetadata> metadata;
+    std::optional<std::vector<std::string>> neighbours;
+    size_t charge = 0;
+    bool resident = false;
+  };
+
+  using Index = std::unordered_map<std::string_view, std::list<Entry>::iterator>;
+
+  struct Shard {
+    std::mutex mutex;
+    // The nodes of layer 0, the most recently used one is at the front
+    std::list<Entry> lru;
+    // The nodes above layer 0, which are never evicted
+    std::list<Entry> resident;
+    Index index;
+    size_t usage = 0;
+    uint64_t generation = 0;
+  };
+
+  std::array<Shard, kShards> shards_;
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+
+  static std::string cacheKey(uint16_t level, std::string_view key);
+  Shard &shardOf(const std::string &cache_key) { return shards_[std::hash<std::string>{}(cache_key) % kShards]; }
+
+  template <typename Fill>
+  void insert(uint16_t level, std::string_view key, uint64_t generation, size_t capacity, Fill &&fill);
+  static size_t charge(const Entry &entry);
+  static void eraseEntry(Shard &shard, Index::iterator iter);
+
+  // Rough memory cost of the list node and index slot of an entry, and of a neighbour in a list
+  static constexpr size_t kEntryOverhead = 160;
+  static constexpr size_t kNeighbourOverhead = 32;
+};
+
+}  // namespace redis
@@ -27,10 +27,12 @@
 #include <memory>
 #include <queue>
 #include <random>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 #include "db_util.h"
+#include "vector_distance.h"
 
 namespace redis {
 
@@ -103,22 +105,24 @@ Status HnswNode::RemoveNeighbour(engine::Context& ctx, const NodeKey& neighbour_
 }
 
 Status VectorItem::Create(NodeKey key, const kqir::NumericArray& vector, const HnswVectorFieldMetadata* metadata,
-                          VectorItem* out) {
+                          VectorItem* out, double norm) {
   if (metadata->dim != vector.size()) {
     return {Status::InvalidArgument, "VectorItem's metadata dimension must be consistent with the vector itself."};
   }
 
-  *out = VectorItem(std::move(key), vector, metadata);
+  if (norm < 0 && metadata->distance_metric == DistanceMetric::COSINE) norm = VectorNorm(vector.data(), vector.size());
+  *out = VectorItem(std::move(key), vector, metadata, norm);
   return Status::OK();
 }
 
 Status VectorItem::Create(NodeKey key, kqir::NumericArray&& vector, const HnswVectorFieldMetadata* metadata,
-                          VectorItem* out) {
+                          VectorItem* out, double norm) {
   if (metadata->dim != vector.size()) {
     return {Status::InvalidArgument, "VectorItem's metadata dimension must be consistent with the vector itself."};
   }
 
-  *out = VectorItem(std::move(key), std::move(vector), metadata);
+  if (norm < 0 && metadata->distance_metric == DistanceMetric::COSINE) norm = VectorNorm(vector.data(), vector.size());
+  *out = VectorItem(std::move(key), std::move(vector), metadata, norm);
   return Status::OK();
 }
 
@@ -126,11 +130,13 @@ bool VectorItem::operator==(const VectorItem& other) const { return key == other
 
 bool VectorItem::operator<(const VectorItem& other) const { return key < other.key; }
 
-VectorItem::VectorItem(NodeKey&& key, const kqir::NumericArray& vector, const HnswVectorFieldMetadata* metadata)
-    : key(std::move(key)), vector(vector), metadata(metadata) {}
+VectorItem::VectorItem(NodeKey&& key, const kqir::NumericArray& vector, const HnswVectorFieldMetadata* metadata,
+                       double norm)
+    : key(std::move(key)), vector(vector), metadata(metadata), norm(norm) {}
 
-VectorItem::VectorItem(NodeKey&& key, kqir::NumericArray&& vector, const HnswVectorFieldMetadata* metadata)
-    : key(std::move(key)), vector(std::move(vector)), metadata(metadata) {}
+VectorItem::VectorItem(NodeKey&& key, kqir::NumericArray&& vector, const HnswVectorFieldMetadata* metadata,
+                       double norm)
+    : key(std::move(key)), vector(std::move(vector)), metadata(metadata), norm(norm) {}
 
 StatusOr<double> ComputeSimilarity(const VectorItem& left, const VectorItem& right) {
   if (left.metadata->distance_metric != right.metadata->distance_metric || left.metadata->dim != right.metadata->dim)
@@ -140,31 +146,14 @@ StatusOr<double> ComputeSimilarity(const VectorItem& left, const VectorItem& rig
   auto dim = left.metadata->dim;
 
   switch (metric) {
-    case DistanceMetric::L2: {
-      double dist = 0.0;
-      for (auto i = 0; i < dim; i++) {
-        double diff = left.vector[i] - right.vector[i];
-        dist += diff * diff;
-      }
-      return std::sqrt(dist);
-    }
-    case DistanceMetric::IP: {
-      double dist = 0.0;
-      for (auto i = 0; i < dim; i++) {
-        dist += left.vector[i] * right.vector[i];
-      }
-      return -dist;
-    }
+    case DistanceMetric::L2:
+      return std::sqrt(SquaredL2Distance(left.vector.data(), right.vector.data(), dim));
+    case DistanceMetric::IP:
+      return -InnerProduct(left.vector.data(), right.vector.data(), dim);
     case DistanceMetric::COSINE: {
-      double dist = 0.0;
-      double norm_left = 0.0;
-      double norm_right = 0.0;
-      for (auto i = 0; i < dim; i++) {
-        dist += left.vector[i] * right.vector[i];
-        norm_left += left.vector[i] * left.vector[i];
-        norm_right += right.vector[i] * right.vector[i];
-      }
-      auto similarity = dist / std::sqrt(norm_left * norm_right);
+      double norm_left = left.norm >= 0 ? left.norm : VectorNorm(left.vector.data(), dim);
+      double norm_right = right.norm >= 0 ? right.norm : VectorNorm(right.vector.data(), dim);
+      auto similarity = InnerProduct(left.vector.data(), right.vector.data(), dim) / (norm_left * norm_right);
       return 1.0 - similarity;
     }
     default:
@@ -173,13 +162,53 @@ StatusOr<double> ComputeSimilarity(const VectorItem& left, const VectorItem& rig
 }
 
 HnswIndex::HnswIndex(const SearchKey& search_key, HnswVectorFieldMetadata* vector, engine::Storage* storage,
-                     std::random_device::result_type seed)
+                     HnswGraphCache* cache, std::random_device::result_type seed)
     : search_key(search_key),
       metadata(vector),
       storage(storage),
+      cache(cache),
       generator(std::mt19937(seed)),
       m_level_normalization_factor(1.0 / std::log(metadata->m)) {}
 
+// The cache holds the latest graph, which must not be seen by reads on a snapshot
+// or by reads which should see the pending writes of a transaction
+static size_t CacheCapacity(engine::Context& ctx, const HnswGraphCache* cache) {
+  if (!cache || ctx.is_txn_mode || ctx.storage->InTxn()) return 0;
+  return static_cast<size_t>(ctx.storage->GetConfig()->hnsw_cache_size) * MiB;
+}
+
+StatusOr<HnswNodeFieldMetadata> HnswIndex::DecodeNodeMetadata(engine::Context& ctx, const HnswNode& node) const {
+  auto capacity = CacheCapacity(ctx, cache);
+  if (capacity == 0) return node.DecodeMetadata(ctx, search_key);
+
+  HnswNodeFieldMetadata node_metadata;
+  if (cache->LookupMetadata(node.level, node.key, &node_metadata)) return node_metadata;
+
+  auto generation = cache->GetGeneration(node.level, node.key);
+  node_metadata = GET_OR_RET(node.DecodeMetadata(ctx, search_key));
+  cache->InsertMetadata(node.level, node.key, node_metadata, generation, capacity);
+  return node_metadata;
+}
+
+void HnswIndex::DecodeNodeNeighbours(engine::Context& ctx, HnswNode* node) const {
+  auto capacity = CacheCapacity(ctx, cache);
+  if (capacity == 0) {
+    node->DecodeNeighbours(ctx, search_key);
+    return;
+  }
+
+  if (cache->LookupNeighbours(node->level, node->key, &node->neighbours)) return;
+
+  auto generation = cache->GetGeneration(node->level, node->key);
+  node->DecodeNeighbours(ctx, search_key);
+  cache->InsertNeighbours(node->level, node->key, node->neighbours, generation, capacity);
+}
+
+void HnswIndex::InvalidateCache(rocksdb::WriteBatch* batch) const {
+  if (!cache) return;
+  cache->Invalidate(search_key, batch, storage->GetCFHandle(ColumnFamilyID::Search)->GetID());
+}
+
 uint16_t HnswIndex::RandomizeLayer() {
   std::uniform_real_distribution<double> level_dist(0.0, 1.0);
   double r = level_dist(generator);
@@ -221,14 +250,15 @@ StatusOr<std::vector<VectorItem>> HnswIndex::DecodeNodesToVectorItems(engine::Co
     }
     auto neighbour_metadata = neighbour_metadata_status.GetValue();
     VectorItem item;
-    GET_OR_RET(VectorItem::Create(neighbour_key, std::move(neighbour_metadata.vector), metadata, &item));
+    GET_OR_RET(VectorItem::Create(neighbour_key, std::move(neighbour_metadata.vector), metadata, &item,
+                                  neighbour_metadata.norm));
     vector_items.emplace_back(std::move(item));
   }
   return vector_items;
 }
 
 Status HnswIndex::AddEdge(const NodeKey& node_key1, const NodeKey& node_key2, uint16_t layer,
-                          ObserverOrUniquePtr<rocksdb::WriteBatchBase>& batch) const {
+                          engine::WriteBatchBasePtr& batch) const {
   auto edge_index_key1 = search_key.ConstructHnswEdge(layer, node_key1, node_key2);
   auto s = batch->Put(storage->GetCFHandle(ColumnFamilyID::Search), edge_index_key1, Slice());
   if (!s.ok()) {
@@ -244,7 +274,7 @@ Status HnswIndex::AddEdge(const NodeKey& node_key1, const NodeKey& node_key2, ui
 }
 
 Status HnswIndex::RemoveEdge(const NodeKey& node_key1, const NodeKey& node_key2, uint16_t layer,
-                             ObserverOrUniquePtr<rocksdb::WriteBatchBase>& batch) const {
+                             engine::WriteBatchBasePtr& batch) const {
   auto edge_index_key1 = search_key.ConstructHnswEdge(layer, node_key1, node_key2);
   auto s = batch->Delete(storage->GetCFHandle(ColumnFamilyID::Search), edge_index_key1);
   if (!s.ok()) {
@@ -282,35 +312,37 @@ StatusOr<std::vector<VectorItem>> HnswIndex::SelectNeighbors(const VectorItem& v
 
 StatusOr<std::vector<VectorItemWithDistance>> HnswIndex::SearchLayerInternal(
     engine::Context& ctx, uint16_t level, const VectorItem& target_vector, uint32_t ef_runtime,
-    const std::vector<NodeKey>& entry_points) const {
+    const std::vector<NodeKey>& entry_points, const std::unordered_set<NodeKey>* allowed) const {
   std::vector<VectorItemWithDistance> result;
   std::unordered_set<NodeKey> visited;
   std::priority_queue<VectorItemWithDistance, std::vector<VectorItemWithDistance>, std::greater<>> explore_heap;
   std::priority_queue<VectorItemWithDistance> result_heap;
+  auto is_allowed = [allowed](const NodeKey& key) { return !allowed || allowed->count(key) > 0; };
 
   for (const auto& entry_point_key : entry_points) {
     HnswNode entry_node = HnswNode(entry_point_key, level);
-    auto entry_node_metadata = GET_OR_RET(entry_node.DecodeMetadata(ctx, search_key));
+    auto entry_node_metadata = GET_OR_RET(DecodeNodeMetadata(ctx, entry_node));
 
     VectorItem entry_point_vector;
-    GET_OR_RET(
-        VectorItem::Create(entry_point_key, std::move(entry_node_metadata.vector), metadata, &entry_point_vector));
+    GET_OR_RET(VectorItem::Create(entry_point_key, std::move(entry_node_metadata.vector), metadata,
+                                  &entry_point_vector, entry_node_metadata.norm));
     auto dist = GET_OR_RET(ComputeSimilarity(target_vector, entry_point_vector));
 
     explore_heap.push(std::make_pair(dist, entry_point_vector));
-    result_heap.push(std::make_pair(dist, std::move(entry_point_vector)));
+    if (is_allowed(entry_point_key)) result_heap.push(std::make_pair(dist, std::move(entry_point_vector)));
     visited.insert(entry_point_key);
   }
 
   while (!explore_heap.empty()) {
     auto [dist, current_vector] = explore_heap.top();
     explore_heap.pop();
-    if (dist > result_heap.top().first) {
+    // with a filter, the traversal goes on through the nodes not allowed until there're ef results
+    if (!result_heap.empty() && dist > result_heap.top().first && (!allowed || result_heap.size() >= ef_runtime)) {
       break;
     }
 
     auto current_node = HnswNode(current_vector.key, level);
-    current_node.DecodeNeighbours(ctx, search_key);
+    DecodeNodeNeighbours(ctx, &current_node);
 
     for (const auto& neighbour_key : current_node.neighbours) {
       if (visited.find(neighbour_key) != visited.end()) {
@@ -319,15 +351,15 @@ StatusOr<std::vector<VectorItemWithDistance>> HnswIndex::SearchLayerInternal(
       visited.insert(neighbour_key);
 
       auto neighbour_node = HnswNode(neighbour_key, level);
-      auto neighbour_node_metadata = GET_OR_RET(neighbour_node.DecodeMetadata(ctx, search_key));
+      auto neighbour_node_metadata = GET_OR_RET(DecodeNodeMetadata(ctx, neighbour_node));
 
       VectorItem neighbour_node_vector;
       GET_OR_RET(VectorItem::Create(neighbour_key, std::move(neighbour_node_metadata.vector), metadata,
-                                    &neighbour_node_vector));
+                                    &neighbour_node_vector, neighbour_node_metadata.norm));
 
       auto dist = GET_OR_RET(ComputeSimilarity(target_vector, neighbour_node_vector));
       explore_heap.push(std::make_pair(dist, neighbour_node_vector));
-      result_heap.push(std::make_pair(dist, neighbour_node_vector));
+      if (is_allowed(neighbour_key)) result_heap.push(std::make_pair(dist, neighbour_node_vector));
       while (result_heap.size() > ef_runtime) {
         result_heap.pop();
       }
@@ -356,14 +388,23 @@ StatusOr<std::vector<VectorItem>> HnswIndex::SearchLayer(engine::Context& ctx, u
 }
 
 Status HnswIndex::InsertVectorEntryInternal(engine::Context& ctx, std::string_view key,
-                                            const kqir::NumericArray& vector,
-                                            ObserverOrUniquePtr<rocksdb::WriteBatchBase>& batch,
+                                            const kqir::NumericArray& vector, engine::WriteBatchBasePtr& batch,
                                             uint16_t target_level) const {
   auto cf_handle = storage->GetCFHandle(ColumnFamilyID::Search);
   VectorItem inserted_vector_item;
   GET_OR_RET(VectorItem::Create(std::string(key), vector, metadata, &inserted_vector_item));
   std::vector<VectorItem> nearest_vec_items;
 
+  // The nodes only hold the codes of a quantized vector, the full vector is kept aside for re-ranking
+  if (metadata->quantization != VectorQuantization::NONE) {
+    std::string full_vector;
+    HnswNodeFieldMetadata(0, vector, metadata->vector_type).Encode(&full_vector);
+    auto s = batch->Put(cf_handle, search_key.ConstructHnswVector(key), full_vector);
+    if (!s.ok()) {
+      return {Status::NotOK, s.ToString()};
+    }
+  }
+
   if (metadata->num_levels != 0) {
     auto level = metadata->num_levels - 1;
 
@@ -448,7 +489,8 @@ Status HnswIndex::InsertVectorEntryInternal(engine::Context& ctx, std::string_vi
       }
 
       // Update inserted node metadata
-      HnswNodeFieldMetadata node_metadata(static_cast<uint16_t>(connected_edges_set.size()), vector);
+      HnswNodeFieldMetadata node_metadata(static_cast<uint16_t>(connected_edges_set.size()), vector,
+                                          metadata->vector_type, metadata->quantization);
       auto s = node.PutMetadata(&node_metadata, search_key, storage, batch.Get());
       if (!s.IsOK()) {
         return s;
@@ -488,7 +530,7 @@ Status HnswIndex::InsertVectorEntryInternal(engine::Context& ctx, std::string_vi
     }
   } else {
     auto node = HnswNode(std::string(key), 0);
-    HnswNodeFieldMetadata node_metadata(0, vector);
+    HnswNodeFieldMetadata node_metadata(0, vector, metadata->vector_type, metadata->quantization);
     auto s = node.PutMetadata(&node_metadata, search_key, storage, batch.Get());
     if (!s.IsOK()) {
       return s;
@@ -498,7 +540,7 @@ Status HnswIndex::InsertVectorEntryInternal(engine::Context& ctx, std::string_vi
 
   while (target_level > metadata->num_levels - 1) {
     auto node = HnswNode(std::string(key), metadata->num_levels);
-    HnswNodeFieldMetadata node_metadata(0, vector);
+    HnswNodeFieldMetadata node_metadata(0, vector, metadata->vector_type, metadata->quantization);
     auto s = node.PutMetadata(&node_metadata, search_key, storage, batch.Get());
     if (!s.IsOK()) {
       return s;
@@ -518,14 +560,21 @@ Status HnswIndex::InsertVectorEntryInternal(engine::Context& ctx, std::string_vi
 }
 
 Status HnswIndex::InsertVectorEntry(engine::Context& ctx, std::string_view key, const kqir::NumericArray& vector,
-                                    ObserverOrUniquePtr<rocksdb::WriteBatchBase>& batch) {
+                                    engine::WriteBatchBasePtr& batch) {
   auto target_level = RandomizeLayer();
   return InsertVectorEntryInternal(ctx, key, vector, batch, target_level);
 }
 
 Status HnswIndex::DeleteVectorEntry(engine::Context& ctx, std::string_view key,
-                                    ObserverOrUniquePtr<rocksdb::WriteBatchBase>& batch) const {
+                                    engine::WriteBatchBasePtr& batch) const {
   std::string node_key(key);
+  if (metadata->quantization != VectorQuantization::NONE) {
+    auto s = batch->Delete(storage->GetCFHandle(ColumnFamilyID::Search), search_key.ConstructHnswVector(key));
+    if (!s.ok()) {
+      return {Status::NotOK, s.ToString()};
+    }
+  }
+
   for (uint16_t level = 0; level < metadata->num_levels; level++) {
     auto node = HnswNode(node_key, level);
     auto node_metadata_status = node.DecodeMetadata(ctx, search_key);
@@ -591,8 +640,49 @@ Status HnswIndex::DeleteVectorEntry(engine::Context& ctx, std::string_view key,
   return Status::OK();
 }
 
+Status HnswIndex::RerankWithFullVectors(engine::Context& ctx, const VectorItem& query_vector_item,
+                                        std::vector<KeyWithDistance>* candidates) const {
+  if (metadata->quantization == VectorQuantization::NONE || candidates->empty()) {
+    return Status::OK();
+  }
+
+  std::vector<std::string> vector_keys;
+  vector_keys.reserve(candidates->size());
+  for (const auto& [_, candidate_key] : *candidates) {
+    vector_keys.push_back(search_key.ConstructHnswVector(candidate_key));
+  }
+  std::vector<Slice> key_slices(vector_keys.begin(), vector_keys.end());
+  std::vector<rocksdb::PinnableSlice> values(key_slices.size());
+  std::vector<rocksdb::Status> statuses(key_slices.size());
+  storage->MultiGet(ctx, ctx.DefaultMultiGetOptions(), storage->GetCFHandle(ColumnFamilyID::Search), key_slices.size(),
+                    key_slices.data(), values.data(), statuses.data());
+
+  for (size_t i = 0; i < candidates->size(); i++) {
+    // keep the approximate distance of a node without the full vector
+    if (statuses[i].IsNotFound()) continue;
+    if (!statuses[i].ok()) return {Status::NotOK, statuses[i].ToString()};
+
+    HnswNodeFieldMetadata full_vector;
+    Slice input(values[i].data(), values[i].size());
+    auto s = full_vector.Decode(&input);
+    if (!s.ok()) return {Status::NotOK, s.ToString()};
+
+    auto& [distance, candidate_key] = (*candidates)[i];
+    VectorItem candidate_vector_item;
+    GET_OR_RET(VectorItem::Create(candidate_key, std::move(full_vector.vector), metadata, &candidate_vector_item,
+                                  full_vector.norm));
+    distance = GET_OR_RET(ComputeSimilarity(query_vector_item, candidate_vector_item));
+  }
+
+  std::sort(candidates->begin(), candidates->end(),
+            [](const KeyWithDistance& a, const KeyWithDistance& b) { return a.first < b.first; });
+  return Status::OK();
+}
+
 StatusOr<std::vector<KeyWithDistance>> HnswIndex::KnnSearch(engine::Context& ctx,
-                                                            const kqir::NumericArray& query_vector, uint32_t k) const {
+                                                            const kqir::NumericArray& query_vector, uint32_t k,
+                                                            uint32_t ef_runtime,
+                                                            const std::unordered_set<NodeKey>* allowed) const {
   VectorItem query_vector_item;
   GET_OR_RET(VectorItem::Create({}, query_vector, metadata, &query_vector_item));
 
@@ -600,29 +690,193 @@ StatusOr<std::vector<KeyWithDistance>> HnswIndex::KnnSearch(engine::Context& ctx
     return {Status::NotFound, fmt::format("No vector found in the HNSW index")};
   }
 
+  if (ef_runtime == 0) ef_runtime = metadata->ef_runtime;
   auto level = metadata->num_levels - 1;
   auto default_entry_node = GET_OR_RET(DefaultEntryPoint(ctx, level));
   std::vector<NodeKey> entry_points{default_entry_node};
   std::vector<VectorItem> nearest_vec_items;
 
   for (; level > 0; level--) {
-    nearest_vec_items = GET_OR_RET(SearchLayer(ctx, level, query_vector_item, metadata->ef_runtime, entry_points));
+    nearest_vec_items = GET_OR_RET(SearchLayer(ctx, level, query_vector_item, ef_runtime, entry_points));
     entry_points = {nearest_vec_items[0].key};
   }
 
-  uint32_t effective_ef = std::max(metadata->ef_runtime, k);  // Ensure ef_runtime is at least k
+  uint32_t effective_ef = std::max(ef_runtime, k);  // Ensure ef_runtime is at least k
   auto nearest_vec_with_distance =
-      GET_OR_RET(SearchLayerInternal(ctx, 0, query_vector_item, effective_ef, entry_points));
+      GET_OR_RET(SearchLayerInternal(ctx, 0, query_vector_item, effective_ef, entry_points, allowed));
 
-  uint32_t result_length = std::min(k, static_cast<uint32_t>(nearest_vec_with_distance.size()));
+  // All the ef candidates found by the approximate distances of a quantized field are re-ranked
   std::vector<KeyWithDistance> nearest_neighbours;
-  for (uint32_t result_idx = 0; result_idx < result_length; result_idx++) {
-    nearest_neighbours.emplace_back(nearest_vec_with_distance[result_idx].first,
-                                    std::move(nearest_vec_with_distance[result_idx].second.key));
+  nearest_neighbours.reserve(nearest_vec_with_distance.size());
+  for (auto& [distance, vector_item] : nearest_vec_with_distance) {
+    nearest_neighbours.emplace_back(distance, std::move(vector_item.key));
   }
+  GET_OR_RET(RerankWithFullVectors(ctx, query_vector_item, &nearest_neighbours));
+
+  nearest_neighbours.resize(std::min(static_cast<size_t>(k), nearest_neighbours.size()));
   return nearest_neighbours;
 }
 
+StatusOr<std::vector<KeyWithDistance>> HnswIndex::BruteForceKnnSearch(engine::Context& ctx,
+                                                                      const kqir::NumericArray& query_vector,
+                                                                      uint32_t k, uint32_t ef_runtime,
+                                                                      const std::vector<NodeKey>& keys) const {
+  VectorItem query_vector_item;
+  GET_OR_RET(VectorItem::Create({}, query_vector, metadata, &query_vector_item));
+
+  // the keys without a vector of the field have no node, and they're skipped
+  auto vector_items = GET_OR_RET(DecodeNodesToVectorItems(ctx, keys, 0, search_key, metadata));
+  std::vector<KeyWithDistance> nearest_neighbours;
+  nearest_neighbours.reserve(vector_items.size());
+  for (auto& vector_item : vector_items) {
+    auto dist = GET_OR_RET(ComputeSimilarity(query_vector_item, vector_item));
+    nearest_neighbours.emplace_back(dist, std::move(vector_item.key));
+  }
+
+  // the ef nearest ones by the approximate distances of a quantized field are re-ranked, like KnnSearch
+  if (ef_runtime == 0) ef_runtime = metadata->ef_runtime;
+  auto candidates = std::min(static_cast<size_t>(std::max(ef_runtime, k)), nearest_neighbours.size());
+  std::partial_sort(nearest_neighbours.begin(), nearest_neighbours.begin() + static_cast<ptrdiff_t>(candidates),
+                    nearest_neighbours.end(),
+                    [](const KeyWithDistance& a, const KeyWithDistance& b) { return a.first < b.first; });
+  nearest_neighbours.resize(candidates);
+  GET_OR_RET(RerankWithFullVectors(ctx, query_vector_item, &nearest_neighbours));
+
+  nearest_neighbours.resize(std::min(static_cast<size_t>(k), nearest_neighbours.size()));
+  return nearest_neighbours;
+}
+
+StatusOr<HnswGraphHealth> HnswIndex::CheckGraphHealth(engine::Context& ctx) const {
+  HnswGraphHealth health;
+  if (metadata->num_levels == 0) return health;
+
+  std::vector<NodeKey> node_keys;
+  std::unordered_map<NodeKey, size_t> node_ids;
+  auto node_prefix = search_key.ConstructHnswLevelNodePrefix(0);
+  util::UniqueIterator node_iter(ctx, ctx.DefaultScanOptions(), ColumnFamilyID::Search);
+  for (node_iter->Seek(node_prefix); node_iter->Valid() && node_iter->key().starts_with(node_prefix);
+       node_iter->Next()) {
+    Slice encoded = node_iter->key();
+    encoded.remove_prefix(node_prefix.size());
+    Slice node_key;
+    if (!GetSizedString(&encoded, &node_key)) continue;
+    node_ids.emplace(node_key.ToString(), node_keys.size());
+    node_keys.emplace_back(node_key.ToString());
+  }
+  if (auto s = node_iter->status(); !s.ok()) return {Status::NotOK, s.ToString()};
+
+  std::vector<std::vector<size_t>> adjacency(node_keys.size());
+  auto edge_prefix = search_key.ConstructHnswLevelEdgePrefix(0);
+  util::UniqueIterator edge_iter(ctx, ctx.DefaultScanOptions(), ColumnFamilyID::Search);
+  for (edge_iter->Seek(edge_prefix); edge_iter->Valid() && edge_iter->key().starts_with(edge_prefix);
+       edge_iter->Next()) {
+    Slice encoded = edge_iter->key();
+    encoded.remove_prefix(edge_prefix.size());
+    Slice node_key1, node_key2;
+    if (!GetSizedString(&encoded, &node_key1) || !GetSizedString(&encoded, &node_key2)) continue;
+    auto id1 = node_ids.find(node_key1.ToString());
+    auto id2 = node_ids.find(node_key2.ToString());
+    if (id1 == node_ids.end() || id2 == node_ids.end()) continue;
+    adjacency[id1->second].push_back(id2->second);
+  }
+  if (auto s = edge_iter->status(); !s.ok()) return {Status::NotOK, s.ToString()};
+
+  health.nodes = node_keys.size();
+  if (node_keys.empty()) return health;
+
+  // the searches start from the entry point of the top layer, which is also in the bottom layer
+  std::vector<bool> reached(node_keys.size(), false);
+  auto entry_point = DefaultEntryPoint(ctx, metadata->num_levels - 1);
+  if (auto iter = entry_point ? node_ids.find(*entry_point) : node_ids.end(); iter != node_ids.end()) {
+    std::vector<size_t> frontier{iter->second};
+    reached[iter->second] = true;
+    while (!frontier.empty()) {
+      auto id = frontier.back();
+      frontier.pop_back();
+      for (auto neighbour : adjacency[id]) {
+        if (reached[neighbour]) continue;
+        reached[neighbour] = true;
+        frontier.push_back(neighbour);
+      }
+    }
+  }
+
+  // a node can't have more neighbours than the other nodes
+  auto min_degree = std::min<size_t>(metadata->m, node_keys.size() - 1) / 2;
+  for (size_t id = 0; id < node_keys.size(); id++) {
+    health.degrees += adjacency[id].size();
+    if (!reached[id]) {
+      health.unreachable.push_back(node_keys[id]);
+    } else if (adjacency[id].size() < min_degree) {
+      health.under_connected.push_back(node_keys[id]);
+    }
+  }
+  return health;
+}
+
+Status HnswIndex::WarmUpCache(engine::Context& ctx, const std::atomic<bool>& stop) const {
+  if (CacheCapacity(ctx, cache) == 0) return Status::OK();
+
+  // the searches go through all the upper layers but only a few nodes of the bottom one
+  for (uint16_t level = 1; level < metadata->num_levels; level++) {
+    auto node_prefix = search_key.ConstructHnswLevelNodePrefix(level);
+    util::UniqueIterator iter(ctx, ctx.DefaultScanOptions(), ColumnFamilyID::Search);
+    for (iter->Seek(node_prefix); iter->Valid() && iter->key().starts_with(node_prefix); iter->Next()) {
+      if (stop) return Status::OK();
+
+      Slice encoded = iter->key();
+      encoded.remove_prefix(node_prefix.size());
+      Slice node_key;
+      if (!GetSizedString(&encoded, &node_key)) continue;
+
+      HnswNode node(node_key.ToString(), level);
+      GET_OR_RET(DecodeNodeMetadata(ctx, node));
+      DecodeNodeNeighbours(ctx, &node);
+    }
+    if (auto s = iter->status(); !s.ok()) return {Status::NotOK, s.ToString()};
+  }
+  return Status::OK();
+}
+
+Status HnswIndex::RelinkNode(engine::Context& ctx, const NodeKey& key) {
+  auto node_metadata = HnswNode(key, 0).DecodeMetadata(ctx, search_key);
+  if (!node_metadata) return Status::OK();
+
+  // the node of a quantized field only holds the codes, so it's inserted again by the full vector
+  auto vector = std::move(node_metadata->vector);
+  if (metadata->quantization != VectorQuantization::NONE) {
+    std::string full_vector_value;
+    auto s = storage->Get(ctx, ctx.GetReadOptions(), storage->GetCFHandle(ColumnFamilyID::Search),
+                          search_key.ConstructHnswVector(key), &full_vector_value);
+    if (s.ok()) {
+      HnswNodeFieldMetadata full_vector;
+      Slice input(full_vector_value);
+      if (auto decoded = full_vector.Decode(&input); !decoded.ok()) return {Status::NotOK, decoded.ToString()};
+      vector = std::move(full_vector.vector);
+    } else if (!s.IsNotFound()) {
+      return {Status::NotOK, s.ToString()};
+    }
+  }
+
+  uint16_t top_level = 0;
+  while (top_level + 1 < metadata->num_levels && HnswNode(key, top_level + 1).DecodeMetadata(ctx, search_key)) {
+    top_level++;
+  }
+
+  auto batch = storage->GetWriteBatchBase();
+  GET_OR_RET(DeleteVectorEntry(ctx, key, batch));
+  auto s = storage->Write(ctx, storage->DefaultWriteOptions(), batch->GetWriteBatch());
+  InvalidateCache(batch->GetWriteBatch());
+  if (!s.ok()) return {Status::NotOK, s.ToString()};
+
+  batch = storage->GetWriteBatchBase();
+  GET_OR_RET(InsertVectorEntryInternal(ctx, key, vector, batch, top_level));
+  s = storage->Write(ctx, storage->DefaultWriteOptions(), batch->GetWriteBatch());
+  InvalidateCache(batch->GetWriteBatch());
+  if (!s.ok()) return {Status::NotOK, s.ToString()};
+  return Status::OK();
+}
+
 StatusOr<std::vector<KeyWithDistance>> HnswIndex::ExpandSearchScope(engine::Context& ctx,
                                                                     const kqir::NumericArray& query_vector,
                                                                     std::vector<redis::KeyWithDistance>&& initial_keys,
@@ -637,7 +891,7 @@ StatusOr<std::vector<KeyWithDistance>> HnswIndex::ExpandSearchScope(engine::Cont
     initial_keys.erase(initial_keys.begin());
 
     auto current_node = HnswNode(current_key, level);
-    current_node.DecodeNeighbours(ctx, search_key);
+    DecodeNodeNeighbours(ctx, &current_node);
 
     for (const auto& neighbour_key : current_node.neighbours) {
       if (visited.find(neighbour_key) != visited.end()) {
@@ -646,11 +900,11 @@ StatusOr<std::vector<KeyWithDistance>> HnswIndex::ExpandSearchScope(engine::Cont
       visited.insert(neighbour_key);
 
       auto neighbour_node = HnswNode(neighbour_key, level);
-      auto neighbour_node_metadata = GET_OR_RET(neighbour_node.DecodeMetadata(ctx, search_key));
+      auto neighbour_node_metadata = GET_OR_RET(DecodeNodeMetadata(ctx, neighbour_node));
 
       VectorItem neighbour_node_vector;
       GET_OR_RET(VectorItem::Create(neighbour_key, std::move(neighbour_node_metadata.vector), metadata,
-                                    &neighbour_node_vector));
+                                    &neighbour_node_vector, neighbour_node_metadata.norm));
 
       auto dist = GET_OR_RET(ComputeSimilarity(query_vector_item, neighbour_node_vector));
       result.emplace_back(dist, neighbour_key);
@@ -658,6 +912,7 @@ StatusOr<std::vector<KeyWithDistance>> HnswIndex::ExpandSearchScope(engine::Cont
   }
   std::sort(result.begin(), result.end(),
             [](const KeyWithDistance& a, const KeyWithDistance& b) { return a.first < b.first; });
+  GET_OR_RET(RerankWithFullVectors(ctx, query_vector_item, &result));
 
   return result;
 }
@@ -20,10 +20,13 @@
 
 #pragma once
 
+#include <atomic>
 #include <random>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
+#include "search/hnsw_graph_cache.h"
 #include "search/indexer.h"
 #include "search/search_encoding.h"
 #include "search/value.h"
@@ -60,20 +63,23 @@ struct VectorItem {
   NodeKey key;
   kqir::NumericArray vector;
   const HnswVectorFieldMetadata* metadata;
+  // the L2 norm of the vector, negative if it isn't computed yet
+  double norm = -1;
 
   VectorItem() : metadata(nullptr) {}
 
+  // the norm is computed for the COSINE metric if it's not given, e.g. by the stored node
   static Status Create(NodeKey key, const kqir::NumericArray& vector, const HnswVectorFieldMetadata* metadata,
-                       VectorItem* out);
+                       VectorItem* out, double norm = -1);
   static Status Create(NodeKey key, kqir::NumericArray&& vector, const HnswVectorFieldMetadata* metadata,
-                       VectorItem* out);
+                       VectorItem* out, double norm = -1);
 
   bool operator==(const VectorItem& other) const;
   bool operator<(const VectorItem& other) const;
 
  private:
-  VectorItem(NodeKey&& key, const kqir::NumericArray& vector, const HnswVectorFieldMetadata* metadata);
-  VectorItem(NodeKey&& key, kqir::NumericArray&& vector, const HnswVectorFieldMetadata* metadata);
+  VectorItem(NodeKey&& key, const kqir::NumericArray& vector, const HnswVectorFieldMetadata* metadata, double norm);
+  VectorItem(NodeKey&& key, kqir::NumericArray&& vector, const HnswVectorFieldMetadata* metadata, double norm);
 };
 
 StatusOr<double> ComputeSimilarity(const VectorItem& left, const VectorItem& right);
@@ -81,6 +87,19 @@ StatusOr<double> ComputeSimilarity(const VectorItem& left, const VectorItem& rig
 using VectorItemWithDistance = std::pair<double, VectorItem>;
 using KeyWithDistance = std::pair<double, std::string>;
 
+// The connectivity of the bottom layer of an HNSW graph, where every vector has a node
+struct HnswGraphHealth {
+  uint64_t nodes = 0;
+  // every edge is counted by both of its nodes
+  uint64_t degrees = 0;
+  // the nodes with fewer than half of M neighbours
+  std::vector<std::string> under_connected;
+  // the nodes which can't be reached from the entry point of the searches
+  std::vector<std::string> unreachable;
+
+  double AverageDegree() const { return nodes == 0 ? 0 : static_cast<double>(degrees) / static_cast<double>(nodes); }
+};
+
 // TODO(Beihao): Add DB context to improve consistency and isolation - see #2332
 struct HnswIndex {
   using NodeKey = HnswNode::NodeKey;
@@ -88,40 +107,67 @@ struct HnswIndex {
   SearchKey search_key;
   HnswVectorFieldMetadata* metadata;
   engine::Storage* storage = nullptr;
+  // the graph cache of the field, it may be null
+  HnswGraphCache* cache = nullptr;
 
   std::mt19937 generator;
   double m_level_normalization_factor;
 
   HnswIndex(const SearchKey& search_key, HnswVectorFieldMetadata* vector, engine::Storage* storage,
-            std::random_device::result_type seed = std::random_device()());
+            HnswGraphCache* cache = nullptr, std::random_device::result_type seed = std::random_device()());
 
   static StatusOr<std::vector<VectorItem>> DecodeNodesToVectorItems(engine::Context& ctx,
                                                                     const std::vector<NodeKey>& node_key,
                                                                     uint16_t level, const SearchKey& search_key,
                                                                     const HnswVectorFieldMetadata* metadata);
+  // DecodeNodeMetadata and DecodeNodeNeighbours read the node through the graph cache if it's usable
+  StatusOr<HnswNodeFieldMetadata> DecodeNodeMetadata(engine::Context& ctx, const HnswNode& node) const;
+  void DecodeNodeNeighbours(engine::Context& ctx, HnswNode* node) const;
+  // InvalidateCache erases the nodes written by the batch from the graph cache, after the batch is written
+  void InvalidateCache(rocksdb::WriteBatch* batch) const;
+
   uint16_t RandomizeLayer();
   StatusOr<NodeKey> DefaultEntryPoint(engine::Context& ctx, uint16_t level) const;
   Status AddEdge(const NodeKey& node_key1, const NodeKey& node_key2, uint16_t layer,
-                 ObserverOrUniquePtr<rocksdb::WriteBatchBase>& batch) const;
+                 engine::WriteBatchBasePtr& batch) const;
   Status RemoveEdge(const NodeKey& node_key1, const NodeKey& node_key2, uint16_t layer,
-                    ObserverOrUniquePtr<rocksdb::WriteBatchBase>& batch) const;
+                    engine::WriteBatchBasePtr& batch) const;
 
   StatusOr<std::vector<VectorItem>> SelectNeighbors(const VectorItem& vec, const std::vector<VectorItem>& vectors,
                                                     uint16_t layer) const;
-  StatusOr<std::vector<VectorItemWithDistance>> SearchLayerInternal(engine::Context& ctx, uint16_t level,
-                                                                    const VectorItem& target_vector,
-                                                                    uint32_t ef_runtime,
-                                                                    const std::vector<NodeKey>& entry_points) const;
+  // Only the nodes in `allowed` are taken as the results if it's given, but all the nodes are traversed
+  StatusOr<std::vector<VectorItemWithDistance>> SearchLayerInternal(
+      engine::Context& ctx, uint16_t level, const VectorItem& target_vector, uint32_t ef_runtime,
+      const std::vector<NodeKey>& entry_points, const std::unordered_set<NodeKey>* allowed = nullptr) const;
   StatusOr<std::vector<VectorItem>> SearchLayer(engine::Context& ctx, uint16_t level, const VectorItem& target_vector,
                                                 uint32_t ef_runtime, const std::vector<NodeKey>& entry_points) const;
   Status InsertVectorEntryInternal(engine::Context& ctx, std::string_view key, const kqir::NumericArray& vector,
-                                   ObserverOrUniquePtr<rocksdb::WriteBatchBase>& batch, uint16_t layer) const;
+                                   engine::WriteBatchBasePtr& batch, uint16_t layer) const;
   Status InsertVectorEntry(engine::Context& ctx, std::string_view key, const kqir::NumericArray& vector,
-                           ObserverOrUniquePtr<rocksdb::WriteBatchBase>& batch);
-  Status DeleteVectorEntry(engine::Context& ctx, std::string_view key,
-                           ObserverOrUniquePtr<rocksdb::WriteBatchBase>& batch) const;
+                           engine::WriteBatchBasePtr& batch);
+  Status DeleteVectorEntry(engine::Context& ctx, std::string_view key, engine::WriteBatchBasePtr& batch) const;
+  // RerankWithFullVectors replaces the approximate distances of the candidates of a quantized field
+  // by the distances to their full vectors, and sorts them again
+  Status RerankWithFullVectors(engine::Context& ctx, const VectorItem& query_vector_item,
+                               std::vector<KeyWithDistance>* candidates) const;
+  // The ef_runtime of the field is used if it's 0. The neighbours are only searched in `allowed` if it's given,
+  // which are filtered while the bottom layer is traversed.
   StatusOr<std::vector<KeyWithDistance>> KnnSearch(engine::Context& ctx, const kqir::NumericArray& query_vector,
-                                                   uint32_t k) const;
+                                                   uint32_t k, uint32_t ef_runtime = 0,
+                                                   const std::unordered_set<NodeKey>* allowed = nullptr) const;
+  // BruteForceKnnSearch computes the distances to all the nodes of the keys, which is cheaper than
+  // a filtered KnnSearch if there're few keys allowed
+  StatusOr<std::vector<KeyWithDistance>> BruteForceKnnSearch(engine::Context& ctx,
+                                                             const kqir::NumericArray& query_vector, uint32_t k,
+                                                             uint32_t ef_runtime,
+                                                             const std::vector<NodeKey>& keys) const;
+  // CheckGraphHealth reads the nodes and the edges of the bottom layer, so it should be given a snapshot
+  StatusOr<HnswGraphHealth> CheckGraphHealth(engine::Context& ctx) const;
+  // WarmUpCache reads the nodes of the upper layers into the graph cache, it returns early once `stop` is set
+  Status WarmUpCache(engine::Context& ctx, const std::atomic<bool>& stop) const;
+  // RelinkNode inserts the node again by an ef_construction search on every layer it's in, which connects
+  // it to its nearest nodes again after its neighbours are deleted. A removed node is skipped.
+  Status RelinkNode(engine::Context& ctx, const NodeKey& key);
   StatusOr<std::vector<KeyWithDistance>> ExpandSearchScope(engine::Context& ctx, const kqir::NumericArray& query_vector,
                                                            std::vector<redis::KeyWithDistance>&& initial_keys,
                                                            std::unordered_set<std::string>& visited) const;
@@ -0,0 +1,143 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "hnsw_maintainer.h"
+
+#include <glog/logging.h>
+
+#include <chrono>
+#include <memory>
+
+#include "search/hnsw_indexer.h"
+#include "search/search_encoding.h"
+#include "thread_util.h"
+
+namespace redis {
+
+Status HnswMaintainer::Start() {
+  Stop();
+
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    stop_ = false;
+  }
+  thread_ = GET_OR_RET(util::CreateThread("hnsw-maintain", [this] { run(); }));
+  return Status::OK();
+}
+
+void HnswMaintainer::Stop() {
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    stop_ = true;
+  }
+  stop_cv_.notify_all();
+  if (!thread_.joinable()) return;
+  if (auto s = util::ThreadJoin(thread_); !s) {
+    LOG(WARNING) << "[index] Failed to join the HNSW maintenance thread of index " << info_->name << ": " << s.Msg();
+  }
+}
+
+std::map<std::string, HnswMaintainer::FieldHealth> HnswMaintainer::GetHealth() const {
+  std::lock_guard<std::mutex> guard(mu_);
+  return health_;
+}
+
+bool HnswMaintainer::isStopped() const {
+  std::lock_guard<std::mutex> guard(mu_);
+  return stop_;
+}
+
+void HnswMaintainer::run() {
+  auto last_check = std::chrono::steady_clock::now();
+  while (true) {
+    // the interval is read every second, so a change of it takes effect soon
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      if (stop_cv_.wait_for(lock, std::chrono::seconds(1), [this] { return stop_; })) break;
+    }
+    auto interval = storage_->GetConfig()->hnsw_maintenance_interval;
+    if (interval == 0 || std::chrono::steady_clock::now() - last_check < std::chrono::seconds(interval)) continue;
+
+    for (const auto &[name, field] : info_->fields) {
+      if (isStopped()) break;
+      if (!field.MetadataAs<HnswVectorFieldMetadata>()) continue;
+      if (auto s = maintainField(field); !s) {
+        LOG(WARNING) << "[index] Failed to maintain the HNSW graph of index " << info_->name << ", field " << name
+                     << ": " << s.Msg();
+      }
+    }
+    last_check = std::chrono::steady_clock::now();
+  }
+}
+
+Status HnswMaintainer::maintainField(const kqir::FieldInfo &field) {
+  SearchKey search_key(info_->ns, info_->name, field.name);
+
+  std::shared_ptr<const rocksdb::Snapshot> snapshot;
+  {
+    auto guard = storage_->ReadLockGuard();
+    snapshot = storage_->GetSharedSnapshot(false);
+  }
+  auto snapshot_ctx = engine::Context::SnapshotContext(storage_, std::move(snapshot));
+
+  // the levels of the graph may be changed by the writes after the snapshot, so they're read from it
+  std::string field_value;
+  auto s = storage_->Get(snapshot_ctx, snapshot_ctx.GetReadOptions(), storage_->GetCFHandle(ColumnFamilyID::Search),
+                         search_key.ConstructFieldMeta(), &field_value);
+  if (!s.ok()) return {Status::NotOK, s.ToString()};
+  std::unique_ptr<IndexFieldMetadata> snapshot_metadata;
+  Slice field_slice = field_value;
+  s = IndexFieldMetadata::Decode(&field_slice, snapshot_metadata);
+  if (!s.ok()) return {Status::NotOK, s.ToString()};
+  auto snapshot_vector = dynamic_cast<HnswVectorFieldMetadata *>(snapshot_metadata.get());
+  if (!snapshot_vector) return {Status::NotOK, "the field isn't a vector field"};
+
+  auto health = GET_OR_RET(HnswIndex(search_key, snapshot_vector, storage_).CheckGraphHealth(snapshot_ctx));
+
+  FieldHealth field_health;
+  field_health.nodes = health.nodes;
+  field_health.average_degree = health.AverageDegree();
+  field_health.under_connected = health.under_connected.size();
+  field_health.unreachable = health.unreachable.size();
+
+  // the unreachable nodes are relinked first, since they can't be found at all
+  auto vector = dynamic_cast<HnswVectorFieldMetadata *>(field.metadata.get());
+  HnswIndex hnsw(search_key, vector, storage_, field.hnsw_cache.get());
+  Status relink_status;
+  for (const auto *keys : {&health.unreachable, &health.under_connected}) {
+    for (const auto &key : *keys) {
+      if (isStopped()) break;
+      auto ctx = engine::Context::NoTransactionContext(storage_);
+      std::lock_guard<std::mutex> guard(*field.hnsw_mutex);
+      relink_status = hnsw.RelinkNode(ctx, key);
+      if (!relink_status) break;
+      field_health.relinked++;
+    }
+    if (!relink_status) break;
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    health_[field.name] = field_health;
+  }
+  return relink_status;
+}
+
+}  // namespace redis
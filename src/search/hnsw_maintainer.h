@@ -0,0 +1,84 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "search/index_info.h"
+#include "status.h"
+#include "storage/storage.h"
+
+namespace redis {
+
+// HnswMaintainer repairs the HNSW graphs of the vector fields of an index in the background.
+//
+// A deleted vector is unlinked from its neighbours in place, so after many updates some nodes are
+// left with few neighbours, or can't be reached from the entry point of the searches anymore, which
+// lowers the recall of the searches. Every hnsw-maintenance-interval seconds, the bottom layer of
+// each graph is checked on a snapshot, and the under-connected and unreachable nodes are linked again
+// by an ef_construction search. The nodes are relinked one at a time under the mutex of the field,
+// so the writes to the index are only blocked for a short while.
+//
+// The health of the graphs found by the last check is reported in FT.INFO.
+class HnswMaintainer {
+ public:
+  struct FieldHealth {
+    uint64_t nodes = 0;
+    double average_degree = 0;
+    uint64_t under_connected = 0;
+    uint64_t unreachable = 0;
+    // the nodes relinked after the check
+    uint64_t relinked = 0;
+  };
+
+  HnswMaintainer(const kqir::IndexInfo *info, engine::Storage *storage) : info_(info), storage_(storage) {}
+  ~HnswMaintainer() { Stop(); }
+
+  HnswMaintainer(const HnswMaintainer &) = delete;
+  HnswMaintainer &operator=(const HnswMaintainer &) = delete;
+
+  Status Start();
+  void Stop();
+
+  // GetHealth returns the health of the vector fields which have been checked
+  std::map<std::string, FieldHealth> GetHealth() const;
+
+ private:
+  const kqir::IndexInfo *info_;
+  engine::Storage *storage_;
+
+  std::thread thread_;
+  bool stop_ = false;
+  mutable std::mutex mu_;
+  std::condition_variable stop_cv_;
+  std::map<std::string, FieldHealth> health_;
+
+  void run();
+  bool isStopped() const;
+  Status maintainField(const kqir::FieldInfo &field);
+};
+
+}  // namespace redis
@@ -0,0 +1,287 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "index_builder.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+
+#include "db_util.h"
+#include "lock_manager.h"
+#include "storage/redis_metadata.h"
+#include "storage/storage.h"
+#include "string_util.h"
+#include "thread_util.h"
+
+namespace redis {
+
+IndexBuilder::IndexBuilder(const IndexUpdater &updater) : updater_(updater), storage_(updater.indexer->storage) {}
+
+Status IndexBuilder::Start(IndexBuildProgress progress) {
+  Stop();
+
+  {
+    std::lock_guard<std::mutex> guard(progress_mu_);
+    progress_ = std::move(progress);
+  }
+  stop_ = false;
+  done_ = false;
+  running_ = true;
+  auto t = util::CreateThread("index-build", [this] { run(); });
+  if (!t) {
+    running_ = false;
+    return std::move(t);
+  }
+  thread_ = std::move(*t);
+  return Status::OK();
+}
+
+void IndexBuilder::Stop() {
+  stop_ = true;
+  if (!thread_.joinable()) return;
+  if (auto s = util::ThreadJoin(thread_); !s) {
+    LOG(WARNING) << "[index] Failed to join the build thread of index " << updater_.info->name << ": " << s.Msg();
+  }
+}
+
+uint64_t IndexBuilder::GetIndexedKeys() const {
+  std::lock_guard<std::mutex> guard(progress_mu_);
+  return progress_.indexed_keys;
+}
+
+double IndexBuilder::GetPercentIndexed() const {
+  if (IsDone()) return 1;
+
+  auto progress = [this] {
+    std::lock_guard<std::mutex> guard(progress_mu_);
+    return progress_;
+  }();
+
+  std::vector<std::string> bounds;
+  for (const auto &prefix : updater_.info->prefixes) {
+    auto ns_key = ComposeNamespaceKey(updater_.info->ns, prefix, storage_->IsSlotIdEncoded());
+    bounds.emplace_back(ns_key);
+    bounds.emplace_back(util::StringNext(ns_key));
+  }
+  size_t n_prefixes = bounds.size() / 2;
+
+  // The ranges of the prefixes, and the indexed part of the current prefix at last
+  std::vector<rocksdb::Range> ranges;
+  for (size_t i = 0; i < n_prefixes; i++) {
+    ranges.emplace_back(bounds[i * 2], bounds[i * 2 + 1]);
+  }
+  bool in_prefix = progress.prefix_index < n_prefixes && !progress.last_key.empty();
+  if (in_prefix) ranges.emplace_back(bounds[progress.prefix_index * 2], progress.last_key);
+
+  rocksdb::SizeApproximationOptions options;
+  options.include_memtables = true;
+  options.include_files = true;
+  std::vector<uint64_t> sizes(ranges.size(), 0);
+  auto s = storage_->GetDB()->GetApproximateSizes(options, storage_->GetCFHandle(ColumnFamilyID::Metadata),
+                                                  ranges.data(), static_cast<int>(ranges.size()), sizes.data());
+  if (!s.ok()) return 0;
+
+  uint64_t total = 0, indexed = 0;
+  for (size_t i = 0; i < n_prefixes; i++) {
+    total += sizes[i];
+    if (i < progress.prefix_index) indexed += sizes[i];
+  }
+  if (in_prefix) indexed += sizes.back();
+
+  if (total == 0) return 0;
+  return std::min(static_cast<double>(indexed) / static_cast<double>(total), 1.0);
+}
+
+void IndexBuilder::run() {
+  const auto &name = updater_.info->name;
+  LOG(INFO) << "[index] Start to build index " << name << " in the background";
+
+  while (!stop_) {
+    auto done = buildRound();
+    if (stop_) break;
+    if (!done) {
+      LOG(ERROR) << "[index] Failed to build index " << name << ": " << done.Msg();
+      break;
+    }
+    if (*done) {
+      if (auto s = removeProgress(); !s) {
+        LOG(WARNING) << "[index] Failed to remove the build progress of index " << name << ": " << s.Msg();
+      }
+      for (const auto &[_, field] : updater_.info->fields) {
+        auto ctx = engine::Context::NoTransactionContext(storage_);
+        if (auto s = updater_.SaveFieldStats(ctx, field); !s) {
+          LOG(WARNING) << "[index] Failed to save the statistics of index " << name << ": " << s.Msg();
+        }
+      }
+      done_ = true;
+      LOG(INFO) << "[index] Index " << name << " is built, " << GetIndexedKeys() << " keys are indexed with "
+                << GetFailures() << " failures";
+      break;
+    }
+  }
+
+  running_ = false;
+}
+
+StatusOr<bool> IndexBuilder::buildRound() {
+  auto progress = [this] {
+    std::lock_guard<std::mutex> guard(progress_mu_);
+    return progress_;
+  }();
+
+  const auto &prefixes = updater_.info->prefixes;
+  auto n_prefixes = static_cast<size_t>(std::distance(prefixes.begin(), prefixes.end()));
+  if (progress.prefix_index >= n_prefixes) return true;
+
+  auto threads = static_cast<size_t>(std::max(storage_->GetConfig()->index_build_threads, 1));
+  size_t round_keys = threads * kChunkKeys;
+  auto prefix_key =
+      ComposeNamespaceKey(updater_.info->ns, prefixes.begin()[progress.prefix_index], storage_->IsSlotIdEncoded());
+
+  std::vector<std::string> ns_keys;
+  {
+    auto ctx = engine::Context::NoTransactionContext(storage_);
+    util::UniqueIterator iter(ctx, ctx.DefaultScanOptions(), ColumnFamilyID::Metadata);
+    if (progress.last_key.empty()) {
+      iter->Seek(prefix_key);
+    } else {
+      iter->Seek(progress.last_key);
+      if (iter->Valid() && iter->key() == progress.last_key) iter->Next();
+    }
+    for (; iter->Valid() && ns_keys.size() < round_keys; iter->Next()) {
+      if (!iter->key().starts_with(prefix_key)) break;
+      ns_keys.emplace_back(iter->key().ToString());
+    }
+    if (auto s = iter->status(); !s.ok()) return {Status::NotOK, s.ToString()};
+  }
+
+  if (!ns_keys.empty()) {
+    size_t chunk_size = (ns_keys.size() + threads - 1) / threads;
+    std::vector<std::vector<std::string>> chunks;
+    for (size_t i = 0; i < ns_keys.size(); i += chunk_size) {
+      auto end = std::min(i + chunk_size, ns_keys.size());
+      chunks.emplace_back(ns_keys.begin() + static_cast<ptrdiff_t>(i), ns_keys.begin() + static_cast<ptrdiff_t>(end));
+    }
+
+    std::vector<Status> statuses(chunks.size());
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < chunks.size(); i++) {
+      auto t = util::CreateThread("index-build", [&, i] { statuses[i] = buildChunk(chunks[i]); });
+      if (!t) {
+        // fall back to index the chunk in the current thread
+        statuses[i] = buildChunk(chunks[i]);
+        continue;
+      }
+      workers.emplace_back(std::move(*t));
+    }
+    statuses[0] = buildChunk(chunks[0]);
+    for (auto &worker : workers) {
+      if (auto s = util::ThreadJoin(worker); !s) {
+        LOG(WARNING) << "[index] Failed to join the build thread: " << s.Msg();
+      }
+    }
+
+    for (const auto &s : statuses) {
+      if (!s) return s;
+    }
+  }
+
+  progress.indexed_keys += ns_keys.size();
+  if (ns_keys.size() < round_keys) {
+    progress.prefix_index++;
+    progress.last_key.clear();
+  } else {
+    progress.last_key = ns_keys.back();
+  }
+  GET_OR_RET(saveProgress(progress));
+
+  std::lock_guard<std::mutex> guard(progress_mu_);
+  progress_ = std::move(progress);
+  return progress_.prefix_index >= n_prefixes;
+}
+
+Status IndexBuilder::buildChunk(const std::vector<std::string> &ns_keys) {
+  // The keys can't be changed before the entries in the batch are written
+  MultiLockGuard guard(storage_->GetLockManager(), ns_keys);
+
+  auto ctx = engine::Context::NoTransactionContext(storage_);
+  auto batch = storage_->GetWriteBatchBase();
+  for (const auto &ns_key : ns_keys) {
+    if (stop_) return {Status::NotOK, "the index build is stopped"};
+
+    auto [_, key] = ExtractNamespaceKey(ns_key, storage_->IsSlotIdEncoded());
+    auto values = updater_.Record(ctx, key.ToStringView());
+    if (values.Is<Status::TypeMismatched>()) continue;
+    if (!values) {
+      failures_++;
+      continue;
+    }
+
+    for (const auto &[field, value] : *values) {
+      // the HNSW graph is written by its own batches under the mutex of the field
+      auto s = updater_.UpdateIndex(ctx, field, key.ToStringView(), {}, value, batch.Get());
+      if (!s) {
+        failures_++;
+        break;
+      }
+    }
+  }
+
+  auto write_batch = batch->GetWriteBatch();
+  if (write_batch->Count() == 0) return Status::OK();
+  if (auto rate_limiter = storage_->GetIORateLimiter()) {
+    for (auto left = static_cast<int64_t>(write_batch->GetDataSize()); left > 0;) {
+      auto bytes = std::min(left, rate_limiter->GetSingleBurstBytes());
+      rate_limiter->Request(bytes, rocksdb::Env::IOPriority::IO_LOW, nullptr);
+      left -= bytes;
+    }
+  }
+  auto s = storage_->Write(ctx, storage_->DefaultWriteOptions(), write_batch);
+  if (!s.ok()) return {Status::NotOK, s.ToString()};
+  return Status::OK();
+}
+
+Status IndexBuilder::saveProgress(const IndexBuildProgress &progress) {
+  std::string value;
+  progress.Encode(&value);
+
+  auto ctx = engine::Context::NoTransactionContext(storage_);
+  auto batch = storage_->GetWriteBatchBase();
+  SearchKey index_key(updater_.info->ns, updater_.info->name);
+  auto s = batch->Put(storage_->GetCFHandle(ColumnFamilyID::Search), index_key.ConstructIndexBuildProgress(), value);
+  if (!s.ok()) return {Status::NotOK, s.ToString()};
+  s = storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+  if (!s.ok()) return {Status::NotOK, s.ToString()};
+  return Status::OK();
+}
+
+Status IndexBuilder::removeProgress() {
+  auto ctx = engine::Context::NoTransactionContext(storage_);
+  auto batch = storage_->GetWriteBatchBase();
+  SearchKey index_key(updater_.info->ns, updater_.info->name);
+  auto s = batch->Delete(storage_->GetCFHandle(ColumnFamilyID::Search), index_key.ConstructIndexBuildProgress());
+  if (!s.ok()) return {Status::NotOK, s.ToString()};
+  s = storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+  if (!s.ok()) return {Status::NotOK, s.ToString()};
+  return Status::OK();
+}
+
+}  // namespace redis
@@ -0,0 +1,90 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "search/indexer.h"
+#include "search/search_encoding.h"
+#include "status.h"
+
+namespace redis {
+
+// IndexBuilder indexes the existing keys of a newly created index in the background.
+//
+// The keys under the prefixes of the index are read from the metadata column family in rounds.
+// The keys of a round are split into chunks which are indexed by a thread each, under the locks
+// of their keys. The tag and numeric entries of a chunk are written in one batch charged to the
+// I/O rate limiter, while the inserts into the HNSW graph of a field are serialized by the mutex
+// of the field, since the graph doesn't support concurrent inserts.
+//
+// The progress is saved after each round, so the build is resumed from the last completed round
+// after a restart. Indexing a key twice is harmless, so the keys of an unfinished round are just
+// indexed again.
+class IndexBuilder {
+ public:
+  // The number of keys indexed by a thread in a round
+  static constexpr size_t kChunkKeys = 256;
+
+  // The updater must be added to the GlobalIndexer, it's used by the threads of the builder
+  explicit IndexBuilder(const IndexUpdater &updater);
+  ~IndexBuilder() { Stop(); }
+
+  IndexBuilder(const IndexBuilder &) = delete;
+  IndexBuilder &operator=(const IndexBuilder &) = delete;
+
+  Status Start(IndexBuildProgress progress);
+  // Stop waits for the current round to be interrupted, the progress of the completed rounds is kept
+  void Stop();
+
+  bool IsRunning() const { return running_.load(std::memory_order_relaxed); }
+  bool IsDone() const { return done_.load(std::memory_order_relaxed); }
+  uint64_t GetIndexedKeys() const;
+  uint64_t GetFailures() const { return failures_.load(std::memory_order_relaxed); }
+  // GetPercentIndexed estimates the progress by the approximate size of the indexed part of the key space
+  double GetPercentIndexed() const;
+
+ private:
+  IndexUpdater updater_;
+  engine::Storage *storage_;
+
+  std::thread thread_;
+  std::atomic<bool> stop_ = false;
+  std::atomic<bool> running_ = false;
+  std::atomic<bool> done_ = false;
+  std::atomic<uint64_t> failures_ = 0;
+
+  mutable std::mutex progress_mu_;
+  IndexBuildProgress progress_;
+
+  void run();
+  // buildRound returns true once all the prefixes are indexed
+  StatusOr<bool> buildRound();
+  Status buildChunk(const std::vector<std::string> &ns_keys);
+  Status saveProgress(const IndexBuildProgress &progress);
+  Status removeProgress();
+};
+
+}  // namespace redis
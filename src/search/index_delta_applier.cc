@@ -0,0 +1,363 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "index_delta_applier.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "db_util.h"
+#include "encoding.h"
+#include "search/search_encoding.h"
+#include "storage/storage.h"
+#include "string_util.h"
+#include "thread_util.h"
+
+namespace redis {
+
+// the types of the encoded values, they're the indexes of the alternatives of kqir::Value
+enum class IndexDeltaValueType : uint8_t {
+  NUMERIC = 1,
+  STRING = 2,
+  STRING_ARRAY = 3,
+  NUMERIC_ARRAY = 4,
+};
+
+void EncodeIndexDelta(std::string_view key, const IndexUpdater::FieldValues &original, std::string *dst) {
+  PutSizedString(dst, key);
+  for (const auto &[field, value] : original) {
+    if (value.IsNull()) continue;
+
+    PutSizedString(dst, field);
+    PutFixed8(dst, static_cast<uint8_t>(value.index()));
+    if (value.Is<kqir::Numeric>()) {
+      PutDouble(dst, value.Get<kqir::Numeric>());
+    } else if (value.Is<kqir::String>()) {
+      PutSizedString(dst, value.Get<kqir::String>());
+    } else if (value.Is<kqir::StringArray>()) {
+      PutFixed32(dst, value.Get<kqir::StringArray>().size());
+      for (const auto &str : value.Get<kqir::StringArray>()) {
+        PutSizedString(dst, str);
+      }
+    } else if (value.Is<kqir::NumericArray>()) {
+      PutFixed32(dst, value.Get<kqir::NumericArray>().size());
+      for (auto num : value.Get<kqir::NumericArray>()) {
+        PutDouble(dst, num);
+      }
+    }
+  }
+}
+
+Status DecodeIndexDelta(Slice input, std::string *key, IndexUpdater::FieldValues *original) {
+  Slice key_slice;
+  if (!GetSizedString(&input, &key_slice)) return {Status::NotOK, kErrorInsufficientLength};
+  *key = key_slice.ToString();
+
+  while (!input.empty()) {
+    Slice field;
+    uint8_t type = 0;
+    if (!GetSizedString(&input, &field) || !GetFixed8(&input, &type)) {
+      return {Status::NotOK, kErrorInsufficientLength};
+    }
+
+    kqir::Value value;
+    switch (static_cast<IndexDeltaValueType>(type)) {
+      case IndexDeltaValueType::NUMERIC: {
+        double num = 0;
+        if (!GetDouble(&input, &num)) return {Status::NotOK, kErrorInsufficientLength};
+        value = kqir::MakeValue<kqir::Numeric>(num);
+        break;
+      }
+      case IndexDeltaValueType::STRING: {
+        Slice str;
+        if (!GetSizedString(&input, &str)) return {Status::NotOK, kErrorInsufficientLength};
+        value = kqir::MakeValue<kqir::String>(str.ToString());
+        break;
+      }
+      case IndexDeltaValueType::STRING_ARRAY: {
+        uint32_t size = 0;
+        if (!GetFixed32(&input, &size)) return {Status::NotOK, kErrorInsufficientLength};
+        kqir::StringArray strs;
+        for (uint32_t i = 0; i < size; i++) {
+          Slice str;
+          if (!GetSizedString(&input, &str)) return {Status::NotOK, kErrorInsufficientLength};
+          strs.emplace_back(str.ToString());
+        }
+        value = kqir::MakeValue<kqir::StringArray>(std::move(strs));
+        break;
+      }
+      case IndexDeltaValueType::NUMERIC_ARRAY: {
+        uint32_t size = 0;
+        if (!GetFixed32(&input, &size)) return {Status::NotOK, kErrorInsufficientLength};
+        kqir::NumericArray nums(size);
+        for (auto &num : nums) {
+          if (!GetDouble(&input, &num)) return {Status::NotOK, kErrorInsufficientLength};
+        }
+        value = kqir::MakeValue<kqir::NumericArray>(std::move(nums));
+        break;
+      }
+      default:
+        return {Status::NotOK, "unknown value type of the index delta"};
+    }
+
+    original->emplace(field.ToString(), std::move(value));
+  }
+
+  return Status::OK();
+}
+
+IndexDeltaApplier::IndexDeltaApplier(const IndexUpdater &updater)
+    : updater_(updater), storage_(updater.indexer->storage) {}
+
+Status IndexDeltaApplier::Start() {
+  Stop();
+
+  // continue the sequences of the deltas left by the last run
+  SearchKey index_key(updater_.info->ns, updater_.info->name);
+  auto prefix = index_key.ConstructIndexDeltaPrefix();
+  auto ctx = engine::Context::NoTransactionContext(storage_);
+  util::UniqueIterator iter(ctx, ctx.DefaultScanOptions(), ColumnFamilyID::Search);
+  uint64_t first_seq = 0, last_seq = 0;
+  iter->Seek(prefix);
+  if (iter->Valid() && iter->key().starts_with(prefix)) {
+    first_seq = DecodeFixed64(iter->key().data() + prefix.size());
+    iter->SeekForPrev(index_key.ConstructIndexDelta(UINT64_MAX));
+    if (iter->Valid() && iter->key().starts_with(prefix)) last_seq = DecodeFixed64(iter->key().data() + prefix.size());
+  }
+  if (auto s = iter->status(); !s.ok()) return {Status::NotOK, s.ToString()};
+
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    stop_ = false;
+    next_seq_ = std::max(last_seq + 1, first_seq);
+    applied_seq_ = first_seq > 0 ? first_seq - 1 : next_seq_ - 1;
+  }
+
+  thread_ = GET_OR_RET(util::CreateThread("index-delta", [this] { run(); }));
+  return Status::OK();
+}
+
+void IndexDeltaApplier::Stop() {
+  std::vector<std::function<void(bool)>> waiters;
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    stop_ = true;
+    waiters = takeAppliedWaiters(true);
+  }
+  appended_cv_.notify_all();
+  for (const auto &cb : waiters) cb(false);
+  if (!thread_.joinable()) return;
+  if (auto s = util::ThreadJoin(thread_); !s) {
+    LOG(WARNING) << "[index] Failed to join the delta thread of index " << updater_.info->name << ": " << s.Msg();
+  }
+}
+
+Status IndexDeltaApplier::Append(engine::Context &ctx, std::string_view key,
+                                 const IndexUpdater::FieldValues &original) {
+  std::string value;
+  EncodeIndexDelta(key, original, &value);
+
+  SearchKey index_key(updater_.info->ns, updater_.info->name);
+  auto batch = storage_->GetWriteBatchBase();
+
+  // The applier can't skip over a delta which isn't written yet
+  std::lock_guard<std::mutex> append_guard(append_mu_);
+  uint64_t seq = 0;
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    seq = next_seq_;
+  }
+  auto s = batch->Put(storage_->GetCFHandle(ColumnFamilyID::Search), index_key.ConstructIndexDelta(seq), value);
+  if (!s.ok()) return {Status::NotOK, s.ToString()};
+  s = storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+  if (!s.ok()) return {Status::NotOK, s.ToString()};
+
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    next_seq_ = seq + 1;
+  }
+  appended_cv_.notify_one();
+  return Status::OK();
+}
+
+bool IndexDeltaApplier::Wait(std::chrono::milliseconds timeout) {
+  std::unique_lock<std::mutex> lock(mu_);
+  auto target = next_seq_ - 1;
+  return applied_cv_.wait_for(lock, timeout, [this, target] { return applied_seq_ >= target; });
+}
+
+void IndexDeltaApplier::NotifyApplied(std::function<void(bool)> cb) {
+  bool applied = false;
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    auto target = next_seq_ - 1;
+    applied = applied_seq_ >= target;
+    if (!applied && !stop_) {
+      applied_waiters_.emplace(target, std::move(cb));
+      return;
+    }
+  }
+  cb(applied);
+}
+
+std::vector<std::function<void(bool)>> IndexDeltaApplier::takeAppliedWaiters(bool all) {
+  std::vector<std::function<void(bool)>> waiters;
+  auto end = all ? applied_waiters_.end() : applied_waiters_.upper_bound(applied_seq_);
+  for (auto iter = applied_waiters_.begin(); iter != end; ++iter) waiters.push_back(std::move(iter->second));
+  applied_waiters_.erase(applied_waiters_.begin(), end);
+  return waiters;
+}
+
+uint64_t IndexDeltaApplier::GetPendingDeltas() const {
+  std::lock_guard<std::mutex> guard(mu_);
+  return next_seq_ - 1 - applied_seq_;
+}
+
+void IndexDeltaApplier::run() {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      appended_cv_.wait(lock, [this] { return stop_ || applied_seq_ + 1 < next_seq_; });
+      if (stop_) break;
+    }
+
+    auto applied = applyBatch();
+    if (!applied || *applied == 0) {
+      if (!applied) {
+        LOG(ERROR) << "[index] Failed to apply the deltas of index " << updater_.info->name << ": " << applied.Msg();
+      }
+      // retry later, the deltas are kept until they're applied
+      std::unique_lock<std::mutex> lock(mu_);
+      appended_cv_.wait_for(lock, std::chrono::seconds(1), [this] { return stop_; });
+      continue;
+    }
+
+    std::vector<std::function<void(bool)>> waiters;
+    {
+      std::lock_guard<std::mutex> guard(mu_);
+      if (*applied > applied_seq_) applied_seq_ = *applied;
+      waiters = takeAppliedWaiters(false);
+    }
+    applied_cv_.notify_all();
+    for (const auto &cb : waiters) cb(true);
+  }
+}
+
+StatusOr<uint64_t> IndexDeltaApplier::applyBatch() {
+  SearchKey index_key(updater_.info->ns, updater_.info->name);
+  auto prefix = index_key.ConstructIndexDeltaPrefix();
+  auto upper_bound = util::StringNext(prefix);
+  auto cf = storage_->GetCFHandle(ColumnFamilyID::Search);
+
+  // the original values of each key in the order of the deltas
+  std::map<std::string, std::vector<IndexUpdater::FieldValues>> originals;
+  auto batch = storage_->GetWriteBatchBase();
+  uint64_t last_seq = 0;
+
+  auto ctx = engine::Context::NoTransactionContext(storage_);
+  {
+    auto read_options = ctx.DefaultScanOptions();
+    Slice upper_bound_slice(upper_bound);
+    read_options.iterate_upper_bound = &upper_bound_slice;
+    util::UniqueIterator iter(ctx, read_options, ColumnFamilyID::Search);
+    size_t n = 0;
+    for (iter->Seek(prefix); iter->Valid() && n < kBatchDeltas; iter->Next(), n++) {
+      last_seq = DecodeFixed64(iter->key().data() + prefix.size());
+
+      std::string key;
+      IndexUpdater::FieldValues original;
+      if (auto s = DecodeIndexDelta(iter->value(), &key, &original); !s) {
+        LOG(WARNING) << "[index] Failed to decode a delta of index " << updater_.info->name << ": " << s.Msg();
+        failures_++;
+      } else {
+        originals[key].emplace_back(std::move(original));
+      }
+
+      auto s = batch->Delete(cf, iter->key());
+      if (!s.ok()) return {Status::NotOK, s.ToString()};
+    }
+    if (auto s = iter->status(); !s.ok()) return {Status::NotOK, s.ToString()};
+  }
+
+  for (const auto &[key, key_originals] : originals) {
+    // the entries are all removed if the key isn't of the indexed type anymore
+    IndexUpdater::FieldValues current;
+    if (auto values = updater_.Record(ctx, key)) {
+      current = std::move(*values);
+    } else if (!values.Is<Status::TypeMismatched>()) {
+      failures_++;
+      continue;
+    }
+
+    for (const auto &[field, info] : updater_.info->fields) {
+      if (info.metadata->noindex) continue;
+
+      kqir::Value current_val;
+      if (auto it = current.find(field); it != current.end()) current_val = it->second;
+
+      // The entries of all the original values are removed, since a write racing with the
+      // applied one may have left any of them in the index
+      std::vector<kqir::Value> original_vals;
+      for (const auto &original : key_originals) {
+        auto it = original.find(field);
+        if (it == original.end()) continue;
+        if (std::find(original_vals.begin(), original_vals.end(), it->second) == original_vals.end()) {
+          original_vals.emplace_back(it->second);
+        }
+      }
+
+      if (original_vals.empty()) {
+        original_vals.emplace_back();
+      } else if (info.MetadataAs<TagFieldMetadata>()) {
+        // the tags are diffed against the current ones, so they're merged into one set
+        std::set<std::string> tags;
+        for (const auto &val : original_vals) {
+          tags.insert(val.Get<kqir::StringArray>().begin(), val.Get<kqir::StringArray>().end());
+        }
+        original_vals = {kqir::MakeValue<kqir::StringArray>(tags.begin(), tags.end())};
+      } else if (info.MetadataAs<HnswVectorFieldMetadata>()) {
+        // a key has one node in the graph, it's replaced by any of the original values
+        original_vals.resize(1);
+      }
+
+      Status s;
+      for (const auto &original_val : original_vals) {
+        s = updater_.UpdateIndex(ctx, field, key, original_val, current_val, batch.Get());
+        if (!s) break;
+      }
+      if (!s) {
+        failures_++;
+        LOG(WARNING) << "[index] Failed to apply a delta of index " << updater_.info->name << " for key " << key
+                     << ": " << s.Msg();
+      }
+    }
+  }
+
+  // The deltas are removed with the tag and numeric entries they produce
+  auto s = storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+  if (!s.ok()) return {Status::NotOK, s.ToString()};
+  return last_seq;
+}
+
+}  // namespace redis
@@ -0,0 +1,105 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "search/indexer.h"
+#include "status.h"
+
+namespace redis {
+
+// An index delta is a write to an indexed key, i.e. the key and its field values before the write
+void EncodeIndexDelta(std::string_view key, const IndexUpdater::FieldValues &original, std::string *dst);
+Status DecodeIndexDelta(Slice input, std::string *key, IndexUpdater::FieldValues *original);
+
+// IndexDeltaApplier applies the writes to the indexed keys of an index in the background,
+// when search-async-indexing is enabled.
+//
+// A write only saves an index delta to the search column family, and the applier reads the
+// deltas in order and updates the index in batches. The deltas of the same key in a batch are
+// coalesced, i.e. the document is read once and the entries of all its original values are
+// removed, so a key written many times is indexed once per batch.
+//
+// The deltas are numbered, and a search can wait until the deltas written before it are applied.
+class IndexDeltaApplier {
+ public:
+  // The max number of deltas applied in a batch
+  static constexpr size_t kBatchDeltas = 1024;
+
+  // The updater must be added to the GlobalIndexer
+  explicit IndexDeltaApplier(const IndexUpdater &updater);
+  ~IndexDeltaApplier() { Stop(); }
+
+  IndexDeltaApplier(const IndexDeltaApplier &) = delete;
+  IndexDeltaApplier &operator=(const IndexDeltaApplier &) = delete;
+
+  // Start applies the deltas left by the last run first
+  Status Start();
+  void Stop();
+
+  Status Append(engine::Context &ctx, std::string_view key, const IndexUpdater::FieldValues &original);
+  // Wait returns false if the deltas appended before the call aren't applied within the timeout
+  bool Wait(std::chrono::milliseconds timeout);
+  // NotifyApplied calls the callback once the deltas appended before the call are applied, with true,
+  // or once the applier stops, with false. It's called in place if there's nothing to wait for
+  void NotifyApplied(std::function<void(bool applied)> cb);
+
+  uint64_t GetPendingDeltas() const;
+  uint64_t GetFailures() const { return failures_.load(std::memory_order_relaxed); }
+
+ private:
+  IndexUpdater updater_;
+  engine::Storage *storage_;
+
+  std::thread thread_;
+  bool stop_ = false;
+
+  mutable std::mutex mu_;
+  std::condition_variable appended_cv_;
+  std::condition_variable applied_cv_;
+  // the sequence of the next delta, and the sequence of the last applied one
+  uint64_t next_seq_ = 1;
+  uint64_t applied_seq_ = 0;
+  // the callbacks of NotifyApplied by the sequences they wait for
+  std::multimap<uint64_t, std::function<void(bool)>> applied_waiters_;
+
+  // the deltas are written in the order of their sequences
+  std::mutex append_mu_;
+  std::atomic<uint64_t> failures_ = 0;
+
+  void run();
+  // takeAppliedWaiters returns the callbacks of NotifyApplied which are done, it's called under mu_
+  std::vector<std::function<void(bool)>> takeAppliedWaiters(bool all);
+  // applyBatch returns the sequence of the last applied delta, or 0 if there's none
+  StatusOr<uint64_t> applyBatch();
+};
+
+}  // namespace redis
@@ -21,11 +21,15 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 
+#include "field_stats.h"
+#include "hnsw_graph_cache.h"
 #include "search_encoding.h"
 #include "storage/redis_metadata.h"
 
@@ -37,9 +41,26 @@ struct FieldInfo {
   std::string name;
   IndexInfo *index = nullptr;
   std::unique_ptr<redis::IndexFieldMetadata> metadata;
+  // the in-memory graph of a vector field, it lives as long as the index
+  std::unique_ptr<redis::HnswGraphCache> hnsw_cache;
+  // the statistics of a tag or numeric field for the cost model
+  std::unique_ptr<redis::FieldStats> stats;
+  // the updates of the postings of a text field are serialized by it
+  std::unique_ptr<std::mutex> text_mutex;
+  // the updates of the graph of a vector field are serialized by it, since the graph doesn't support concurrent updates
+  std::unique_ptr<std::mutex> hnsw_mutex;
 
   FieldInfo(std::string name, std::unique_ptr<redis::IndexFieldMetadata> &&metadata)
-      : name(std::move(name)), metadata(std::move(metadata)) {}
+      : name(std::move(name)), metadata(std::move(metadata)) {
+    if (MetadataAs<redis::HnswVectorFieldMetadata>()) {
+      hnsw_cache = std::make_unique<redis::HnswGraphCache>();
+      hnsw_mutex = std::make_unique<std::mutex>();
+    }
+    if (MetadataAs<redis::TagFieldMetadata>() || MetadataAs<redis::NumericFieldMetadata>()) {
+      stats = std::make_unique<redis::FieldStats>();
+    }
+    if (MetadataAs<redis::TextFieldMetadata>()) text_mutex = std::make_unique<std::mutex>();
+  }
 
   bool IsSortable() const { return metadata->IsSortable(); }
   bool HasIndex() const { return !metadata->noindex; }
@@ -58,6 +79,8 @@ struct IndexInfo {
   FieldMap fields;
   redis::IndexPrefixes prefixes;
   std::string ns;
+  // the index is still warmed up after the server starts, the FT.* commands on it fail until it's ready
+  std::atomic<bool> loading = false;
 
   IndexInfo(std::string name, redis::IndexMetadata metadata, std::string ns)
       : name(std::move(name)), metadata(std::move(metadata)), ns(std::move(ns)) {}
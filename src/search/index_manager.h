@@ -20,24 +20,51 @@
 
 #pragma once
 
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
 #include "db_util.h"
 #include "encoding.h"
+#include "search/index_builder.h"
+#include "search/hnsw_indexer.h"
+#include "search/hnsw_maintainer.h"
+#include "search/index_delta_applier.h"
 #include "search/index_info.h"
 #include "search/indexer.h"
 #include "search/ir.h"
 #include "search/ir_sema_checker.h"
 #include "search/passes/manager.h"
+#include "search/plan_cache.h"
 #include "search/plan_executor.h"
 #include "search/search_encoding.h"
 #include "search/value.h"
 #include "status.h"
 #include "storage/storage.h"
 #include "string_util.h"
+#include "thread_util.h"
 
 namespace redis {
 
 struct IndexManager {
   kqir::IndexMap index_map;
+  // The background builds of the indexes, a completed build is kept for its statistics
+  std::map<const kqir::IndexInfo *, std::unique_ptr<IndexBuilder>> builders;
+  // The appliers of the index deltas written by search-async-indexing
+  std::map<const kqir::IndexInfo *, std::unique_ptr<IndexDeltaApplier>> appliers;
+  // The maintenance of the HNSW graphs of the indexes with vector fields
+  std::map<const kqir::IndexInfo *, std::unique_ptr<HnswMaintainer>> maintainers;
+  // The plans of the recent searches, they refer to the fields of the indexes
+  mutable kqir::PlanCache plan_cache;
+  // The warmup of the indexes loaded at startup, see StartWarmUp
+  std::vector<std::thread> warmup_threads;
+  std::atomic<bool> stop_warmup = false;
   GlobalIndexer *indexer;
   engine::Storage *storage;
 
@@ -52,6 +79,8 @@ struct IndexManager {
     util::UniqueIterator iter(no_txn_ctx, no_txn_ctx.DefaultScanOptions(), ColumnFamilyID::Search);
     auto begin = SearchKey{ns, ""}.ConstructIndexMeta();
 
+    // only the index metadata are read by the scan, the rest of the indexes are loaded in parallel
+    std::vector<std::pair<std::string, IndexMetadata>> index_metas;
     for (iter->Seek(begin); iter->Valid(); iter->Next()) {
       auto key = iter->key();
 
@@ -73,71 +102,133 @@ struct IndexManager {
       if (auto s = metadata.Decode(&index_meta_value); !s.ok()) {
         return {Status::NotOK, fmt::format("fail to decode index metadata for index {}: {}", index_name, s.ToString())};
       }
+      index_metas.emplace_back(index_name.ToString(), metadata);
+    }
 
-      auto index_key = SearchKey(ns, index_name.ToStringView());
-      std::string prefix_value;
-      if (auto s = storage->Get(no_txn_ctx, no_txn_ctx.DefaultMultiGetOptions(),
-                                storage->GetCFHandle(ColumnFamilyID::Search), index_key.ConstructIndexPrefixes(),
-                                &prefix_value);
-          !s.ok()) {
-        return {Status::NotOK, fmt::format("fail to find index prefixes for index {}: {}", index_name, s.ToString())};
-      }
-
-      IndexPrefixes prefixes;
-      Slice prefix_slice = prefix_value;
-      if (auto s = prefixes.Decode(&prefix_slice); !s.ok()) {
-        return {Status::NotOK, fmt::format("fail to decode index prefixes for index {}: {}", index_name, s.ToString())};
-      }
-
-      auto info = std::make_unique<kqir::IndexInfo>(index_name.ToString(), metadata, ns);
-      info->prefixes = prefixes;
-
-      util::UniqueIterator field_iter(no_txn_ctx, no_txn_ctx.DefaultScanOptions(), ColumnFamilyID::Search);
-      auto field_begin = index_key.ConstructFieldMeta();
-
-      for (field_iter->Seek(field_begin); field_iter->Valid(); field_iter->Next()) {
-        auto key = field_iter->key();
-
-        uint8_t ns_size = 0;
-        if (!GetFixed8(&key, &ns_size)) break;
-        if (ns_size != ns.size()) break;
-        if (!key.starts_with(ns)) break;
-        key.remove_prefix(ns_size);
-
-        uint8_t subkey_type = 0;
-        if (!GetFixed8(&key, &subkey_type)) break;
-        if (subkey_type != (uint8_t)SearchSubkeyType::FIELD_META) break;
-
-        Slice value;
-        if (!GetSizedString(&key, &value)) break;
-        if (value != index_name) break;
-
-        if (!GetSizedString(&key, &value)) break;
-
-        auto field_name = value;
-        auto field_value = field_iter->value();
+    if (auto s = iter->status(); !s.ok()) {
+      return {Status::NotOK, fmt::format("fail to load index metadata: {}", s.ToString())};
+    }
 
-        std::unique_ptr<IndexFieldMetadata> field_meta;
-        if (auto s = IndexFieldMetadata::Decode(&field_value, field_meta); !s.ok()) {
-          return {Status::NotOK, fmt::format("fail to decode index field metadata for index {}, field {}: {}",
-                                             index_name, field_name, s.ToString())};
+    std::vector<std::unique_ptr<kqir::IndexInfo>> infos(index_metas.size());
+    std::vector<Status> statuses(index_metas.size());
+    std::atomic<size_t> next = 0;
+    auto load_indexes = [&] {
+      for (size_t i = next++; i < index_metas.size(); i = next++) {
+        auto info = loadIndex(ns, index_metas[i].first, index_metas[i].second);
+        if (!info) {
+          statuses[i] = std::move(info).ToStatus();
+          continue;
         }
-
-        info->Add(kqir::FieldInfo(field_name.ToString(), std::move(field_meta)));
+        infos[i] = std::move(*info);
+      }
+    };
+
+    auto threads = std::min(static_cast<size_t>(std::max(storage->GetConfig()->index_build_threads, 1)), infos.size());
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threads; i++) {
+      auto t = util::CreateThread("index-load", load_indexes);
+      if (!t) break;
+      workers.emplace_back(std::move(*t));
+    }
+    load_indexes();
+    for (auto &worker : workers) {
+      if (auto s = util::ThreadJoin(worker); !s) {
+        LOG(WARNING) << "[index] Failed to join the index loading thread: " << s.Msg();
       }
+    }
+    for (auto &s : statuses) {
+      if (!s) return s;
+    }
 
+    std::vector<kqir::IndexInfo *> warmups;
+    for (auto &info : infos) {
+      auto index_key = SearchKey(ns, info->name);
       IndexUpdater updater(info.get());
       indexer->Add(updater);
+      auto info_ptr = info.get();
       index_map.Insert(std::move(info));
-    }
 
-    if (auto s = iter->status(); !s.ok()) {
-      return {Status::NotOK, fmt::format("fail to load index metadata: {}", s.ToString())};
+      // the index was still being built when the server stopped
+      std::string progress_value;
+      auto s = storage->Get(no_txn_ctx, no_txn_ctx.DefaultMultiGetOptions(),
+                            storage->GetCFHandle(ColumnFamilyID::Search), index_key.ConstructIndexBuildProgress(),
+                            &progress_value);
+      if (s.ok()) {
+        IndexBuildProgress progress;
+        Slice progress_slice = progress_value;
+        if (auto s = progress.Decode(&progress_slice); !s.ok()) {
+          return {Status::NotOK,
+                  fmt::format("fail to decode index build progress for index {}: {}", info_ptr->name, s.ToString())};
+        }
+        // the replicas receive the index data written by the build of the master
+        if (!storage->GetConfig()->IsSlave()) {
+          GET_OR_RET(StartBuild(info_ptr, std::move(progress)));
+        }
+      } else if (!s.IsNotFound()) {
+        return {Status::NotOK,
+                fmt::format("fail to find index build progress for index {}: {}", info_ptr->name, s.ToString())};
+      }
+
+      if (!storage->GetConfig()->IsSlave()) {
+        GET_OR_RET(StartApplier(info_ptr));
+        GET_OR_RET(StartMaintainer(info_ptr));
+      }
+
+      if (HasVectorField(info_ptr)) {
+        info_ptr->loading = true;
+        warmups.push_back(info_ptr);
+      }
     }
 
+    StartWarmUp(std::move(warmups));
     return Status::OK();
   }
 
+  // StartWarmUp reads the upper layers of the HNSW graphs of the indexes into the graph caches in the background,
+  // the indexes are kept loading until they are warmed up, so that the first searches aren't slowed down by it
+  void StartWarmUp(std::vector<kqir::IndexInfo *> infos) {
+    if (infos.empty()) return;
+
+    struct WarmUpQueue {
+      std::vector<kqir::IndexInfo *> infos;
+      std::atomic<size_t> next = 0;
+    };
+    auto queue = std::make_shared<WarmUpQueue>();
+    queue->infos = std::move(infos);
+
+    auto warm_up = [this, queue] {
+      for (size_t i = queue->next++; i < queue->infos.size(); i = queue->next++) {
+        auto info = queue->infos[i];
+        for (const auto &[name, field] : info->fields) {
+          auto vector = dynamic_cast<HnswVectorFieldMetadata *>(field.metadata.get());
+          if (!vector || stop_warmup) continue;
+
+          auto ctx = engine::Context::NoTransactionContext(storage);
+          HnswIndex hnsw(SearchKey(info->ns, info->name, name), vector, storage, field.hnsw_cache.get());
+          if (auto s = hnsw.WarmUpCache(ctx, stop_warmup); !s) {
+            LOG(WARNING) << "[index] Failed to warm up the HNSW graph of index " << info->name << ", field " << name
+                         << ": " << s.Msg();
+          }
+        }
+        info->loading = false;
+      }
+    };
+
+    auto threads = std::min(static_cast<size_t>(std::max(storage->GetConfig()->index_build_threads, 1)),
+                            queue->infos.size());
+    size_t started = 0;
+    for (; started < threads; started++) {
+      auto t = util::CreateThread("index-warmup", warm_up);
+      if (!t) {
+        LOG(WARNING) << "[index] Failed to create the index warmup thread: " << t.Msg();
+        break;
+      }
+      warmup_threads.emplace_back(std::move(*t));
+    }
+    // the indexes are warmed up in the current thread if no thread can be created
+    if (started == 0) warm_up();
+  }
+
   Status Create(engine::Context &ctx, std::unique_ptr<kqir::IndexInfo> info) {
     if (storage->GetConfig()->cluster_enabled) {
       return {Status::NotOK, "currently index cannot work in cluster mode"};
@@ -178,23 +269,166 @@ struct IndexManager {
       }
     }
 
+    std::string progress_val;
+    IndexBuildProgress().Encode(&progress_val);
+    s = batch->Put(cf, index_key.ConstructIndexBuildProgress(), progress_val);
+    if (!s.ok()) {
+      return {Status::NotOK, s.ToString()};
+    }
+
     if (auto s = storage->Write(ctx, storage->DefaultWriteOptions(), batch->GetWriteBatch()); !s.ok()) {
       return {Status::NotOK, fmt::format("failed to write index metadata: {}", s.ToString())};
     }
 
     IndexUpdater updater(info.get());
     indexer->Add(updater);
+    auto info_ptr = info.get();
     index_map.Insert(std::move(info));
+    plan_cache.Clear();
+
+    GET_OR_RET(StartApplier(info_ptr));
+    GET_OR_RET(StartMaintainer(info_ptr));
+
+    // the existing keys are indexed in the background, while the new writes are indexed by the indexer
+    return StartBuild(info_ptr, IndexBuildProgress());
+  }
+
+  Status StartApplier(const kqir::IndexInfo *info) {
+    IndexUpdater updater(info);
+    updater.indexer = indexer;
+
+    auto &applier = appliers[info];
+    applier = std::make_unique<IndexDeltaApplier>(updater);
+    return applier->Start();
+  }
+
+  static bool HasVectorField(const kqir::IndexInfo *info) {
+    return std::any_of(info->fields.begin(), info->fields.end(),
+                       [](const kqir::IndexInfo::FieldMap::value_type &field) {
+                         return field.second.MetadataAs<HnswVectorFieldMetadata>() != nullptr;
+                       });
+  }
+
+  Status StartMaintainer(const kqir::IndexInfo *info) {
+    if (!HasVectorField(info)) return Status::OK();
+
+    auto &maintainer = maintainers[info];
+    maintainer = std::make_unique<HnswMaintainer>(info, storage);
+    return maintainer->Start();
+  }
+
+  // AppendDelta defers the index updating of a write to the applier of the index
+  Status AppendDelta(engine::Context &ctx, const GlobalIndexer::RecordResult &record) {
+    auto iter = appliers.find(record.updater.info);
+    if (iter == appliers.end()) return GlobalIndexer::Update(ctx, record);
+    return iter->second->Append(ctx, record.key, record.fields);
+  }
+
+  // WaitForIndex waits until the index deltas written before are applied
+  Status WaitForIndex(std::string_view index_name, const std::string &ns, std::chrono::milliseconds timeout) {
+    auto iter = index_map.Find(index_name, ns);
+    if (iter == index_map.end()) {
+      return {Status::NotOK, "index not found"};
+    }
+
+    auto applier = appliers.find(iter->second.get());
+    if (applier != appliers.end() && !applier->second->Wait(timeout)) {
+      return {Status::NotOK, "timeout while waiting for the index to catch up with the writes"};
+    }
+    return Status::OK();
+  }
+
+  // NotifyIndexApplied is the asynchronous WaitForIndex, see IndexDeltaApplier::NotifyApplied
+  Status NotifyIndexApplied(std::string_view index_name, const std::string &ns, std::function<void(bool)> cb) {
+    auto iter = index_map.Find(index_name, ns);
+    if (iter == index_map.end()) {
+      return {Status::NotOK, "index not found"};
+    }
+
+    auto applier = appliers.find(iter->second.get());
+    if (applier == appliers.end()) {
+      cb(true);
+    } else {
+      applier->second->NotifyApplied(std::move(cb));
+    }
+    return Status::OK();
+  }
+
+  Status StartBuild(const kqir::IndexInfo *info, IndexBuildProgress progress) {
+    IndexUpdater updater(info);
+    updater.indexer = indexer;
 
-    for (auto updater : indexer->updater_list) {
-      GET_OR_RET(updater.Build(ctx));
+    auto &builder = builders[info];
+    builder = std::make_unique<IndexBuilder>(updater);
+    return builder->Start(std::move(progress));
+  }
+
+  void StopBackgroundJobs() {
+    stop_warmup = true;
+    for (auto &thread : warmup_threads) {
+      if (auto s = util::ThreadJoin(thread); !s) {
+        LOG(WARNING) << "[index] Failed to join the index warmup thread: " << s.Msg();
+      }
+    }
+    warmup_threads.clear();
+    for (auto &[_, builder] : builders) {
+      builder->Stop();
+    }
+    for (auto &[_, applier] : appliers) {
+      applier->Stop();
     }
+    for (auto &[_, maintainer] : maintainers) {
+      maintainer->Stop();
+    }
+    SaveStats();
+  }
 
+  // SaveStats saves the statistics of the fields, which are otherwise saved once in a while by the updates
+  void SaveStats() {
+    auto ctx = engine::Context::NoTransactionContext(storage);
+    for (const auto &[_, info] : index_map) {
+      IndexUpdater updater(info.get());
+      updater.indexer = indexer;
+      for (const auto &[name, field] : info->fields) {
+        if (auto s = updater.SaveFieldStats(ctx, field); !s) {
+          LOG(WARNING) << "[index] Failed to save the statistics of index " << info->name << ", field " << name << ": "
+                       << s.Msg();
+        }
+      }
+    }
+  }
+
+  const IndexBuilder *FindBuilder(const kqir::IndexInfo *info) const {
+    auto iter = builders.find(info);
+    return iter == builders.end() ? nullptr : iter->second.get();
+  }
+
+  const HnswMaintainer *FindMaintainer(const kqir::IndexInfo *info) const {
+    auto iter = maintainers.find(info);
+    return iter == maintainers.end() ? nullptr : iter->second.get();
+  }
+
+  static Status CheckLoaded(const kqir::IndexInfo &info) {
+    if (info.loading) return {Status::RedisLoading, fmt::format("index {} is loading", info.name)};
     return Status::OK();
   }
 
-  StatusOr<std::unique_ptr<kqir::PlanOperator>> GeneratePlan(std::unique_ptr<kqir::Node> ir,
-                                                             const std::string &ns) const {
+  // The plan is cached by the key if it's given, the searches with the same key must have the same plan
+  StatusOr<std::unique_ptr<kqir::PlanOperator>> GeneratePlan(std::unique_ptr<kqir::Node> ir, const std::string &ns,
+                                                             const std::string &cache_key = "") const {
+    std::string index_key, plan_key;
+    auto search = dynamic_cast<const kqir::SearchExpr *>(ir.get());
+    if (search) {
+      if (auto iter = index_map.Find(search->index->name, ns); iter != index_map.end()) {
+        GET_OR_RET(CheckLoaded(*iter->second));
+      }
+    }
+    if (search && !cache_key.empty() && storage->GetConfig()->search_plan_cache_size > 0) {
+      index_key = ComposeNamespaceKey(ns, search->index->name, false);
+      plan_key = ComposeNamespaceKey(ns, cache_key, false);
+      if (auto plan = plan_cache.Get(plan_key, index_key)) return plan;
+    }
+
     kqir::SemaChecker sema_checker(index_map);
     sema_checker.ns = ns;
 
@@ -206,22 +440,33 @@ struct IndexManager {
       return {Status::NotOK, "failed to convert the query to plan operators"};
     }
 
+    if (!plan_key.empty()) {
+      plan_cache.Put(plan_key, *plan_op, storage->GetConfig()->search_plan_cache_size);
+    }
+
     return plan_op;
   }
 
-  StatusOr<std::vector<kqir::ExecutorContext::RowType>> Search(std::unique_ptr<kqir::Node> ir,
-                                                               const std::string &ns) const {
-    auto plan_op = GET_OR_RET(GeneratePlan(std::move(ir), ns));
+  StatusOr<std::vector<kqir::ExecutorContext::RowType>> Search(std::unique_ptr<kqir::Node> ir, const std::string &ns,
+                                                               const std::string &cache_key = "") const {
+    auto plan_op = GET_OR_RET(GeneratePlan(std::move(ir), ns, cache_key));
 
     kqir::ExecutorContext executor_ctx(plan_op.get(), storage);
+    return Execute(executor_ctx);
+  }
 
+  // Execute runs the plan of the context to the end, e.g. a plan whose executors are profiled
+  static StatusOr<std::vector<kqir::ExecutorContext::RowType>> Execute(kqir::ExecutorContext &executor_ctx) {
     std::vector<kqir::ExecutorContext::RowType> results;
 
-    auto iter_res = GET_OR_RET(executor_ctx.Next());
-    while (!std::holds_alternative<kqir::ExecutorNode::End>(iter_res)) {
-      results.push_back(std::get<kqir::ExecutorContext::RowType>(iter_res));
+    // the plan is executed by batches, and the rows are only assembled at last
+    while (true) {
+      auto batch = GET_OR_RET(executor_ctx.NextBatch());
+      if (batch.Empty()) break;
 
-      iter_res = GET_OR_RET(executor_ctx.Next());
+      for (size_t i = 0; i < batch.Size(); i++) {
+        results.push_back(batch.Row(i));
+      }
     }
 
     return results;
@@ -234,6 +479,13 @@ struct IndexManager {
     }
 
     auto info = iter->second.get();
+    // the index is still read by its warmup
+    GET_OR_RET(CheckLoaded(*info));
+
+    // the background jobs must be stopped before the index is removed
+    builders.erase(info);
+    appliers.erase(info);
+    maintainers.erase(info);
     indexer->Remove(info);
 
     SearchKey index_key(info->ns, info->name);
@@ -249,6 +501,10 @@ struct IndexManager {
     if (!s.ok()) {
       return {Status::NotOK, s.ToString()};
     }
+    s = batch->Delete(cf, index_key.ConstructIndexBuildProgress());
+    if (!s.ok()) {
+      return {Status::NotOK, s.ToString()};
+    }
 
     auto begin = index_key.ConstructAllFieldMetaBegin();
     auto end = index_key.ConstructAllFieldMetaEnd();
@@ -264,11 +520,26 @@ struct IndexManager {
       return {Status::NotOK, s.ToString()};
     }
 
+    begin = index_key.ConstructIndexDeltaPrefix();
+    end = util::StringNext(begin);
+    s = batch->DeleteRange(cf, begin, end);
+    if (!s.ok()) {
+      return {Status::NotOK, s.ToString()};
+    }
+
+    begin = index_key.ConstructAllFieldStatsPrefix();
+    end = util::StringNext(begin);
+    s = batch->DeleteRange(cf, begin, end);
+    if (!s.ok()) {
+      return {Status::NotOK, s.ToString()};
+    }
+
     auto no_txn_ctx = engine::Context::NoTransactionContext(storage);
     if (auto s = storage->Write(no_txn_ctx, storage->DefaultWriteOptions(), batch->GetWriteBatch()); !s.ok()) {
       return {Status::NotOK, fmt::format("failed to delete index metadata and data: {}", s.ToString())};
     }
 
+    plan_cache.Clear(ComposeNamespaceKey(info->ns, info->name, false));
     index_map.erase(iter);
 
     return Status::OK();
@@ -281,6 +552,7 @@ struct IndexManager {
       return {Status::NotOK, fmt::format("Index '{}' not found in namespace '{}'", index_name, ns)};
     }
     const auto &info = iter->second;
+    GET_OR_RET(CheckLoaded(*info));
 
     std::string tag_field_name_str(tag_field_name);
     auto field_it = info->fields.find(tag_field_name_str);
@@ -334,5 +606,92 @@ struct IndexManager {
 
     return matching_values;
   }
+
+ private:
+  // loadIndex reads the prefixes, the fields and the statistics of an index
+  StatusOr<std::unique_ptr<kqir::IndexInfo>> loadIndex(const std::string &ns, const std::string &index_name,
+                                                       const IndexMetadata &metadata) const {
+    auto no_txn_ctx = engine::Context::NoTransactionContext(storage);
+    auto index_key = SearchKey(ns, index_name);
+    std::string prefix_value;
+    if (auto s = storage->Get(no_txn_ctx, no_txn_ctx.DefaultMultiGetOptions(),
+                              storage->GetCFHandle(ColumnFamilyID::Search), index_key.ConstructIndexPrefixes(),
+                              &prefix_value);
+        !s.ok()) {
+      return {Status::NotOK, fmt::format("fail to find index prefixes for index {}: {}", index_name, s.ToString())};
+    }
+
+    IndexPrefixes prefixes;
+    Slice prefix_slice = prefix_value;
+    if (auto s = prefixes.Decode(&prefix_slice); !s.ok()) {
+      return {Status::NotOK, fmt::format("fail to decode index prefixes for index {}: {}", index_name, s.ToString())};
+    }
+
+    auto info = std::make_unique<kqir::IndexInfo>(index_name, metadata, ns);
+    info->prefixes = prefixes;
+
+    util::UniqueIterator field_iter(no_txn_ctx, no_txn_ctx.DefaultScanOptions(), ColumnFamilyID::Search);
+    auto field_begin = index_key.ConstructFieldMeta();
+
+    for (field_iter->Seek(field_begin); field_iter->Valid(); field_iter->Next()) {
+      auto key = field_iter->key();
+
+      uint8_t ns_size = 0;
+      if (!GetFixed8(&key, &ns_size)) break;
+      if (ns_size != ns.size()) break;
+      if (!key.starts_with(ns)) break;
+      key.remove_prefix(ns_size);
+
+      uint8_t subkey_type = 0;
+      if (!GetFixed8(&key, &subkey_type)) break;
+      if (subkey_type != (uint8_t)SearchSubkeyType::FIELD_META) break;
+
+      Slice value;
+      if (!GetSizedString(&key, &value)) break;
+      if (value != index_name) break;
+
+      if (!GetSizedString(&key, &value)) break;
+
+      auto field_name = value;
+      auto field_value = field_iter->value();
+
+      std::unique_ptr<IndexFieldMetadata> field_meta;
+      if (auto s = IndexFieldMetadata::Decode(&field_value, field_meta); !s.ok()) {
+        return {Status::NotOK, fmt::format("fail to decode index field metadata for index {}, field {}: {}",
+                                           index_name, field_name, s.ToString())};
+      }
+
+      info->Add(kqir::FieldInfo(field_name.ToString(), std::move(field_meta)));
+    }
+    if (auto s = field_iter->status(); !s.ok()) {
+      return {Status::NotOK, fmt::format("fail to load the fields of index {}: {}", index_name, s.ToString())};
+    }
+
+    for (auto &[field_name, field_info] : info->fields) {
+      if (!field_info.stats) continue;
+
+      std::string stats_value;
+      auto s = storage->Get(no_txn_ctx, no_txn_ctx.DefaultMultiGetOptions(),
+                            storage->GetCFHandle(ColumnFamilyID::Search),
+                            SearchKey(ns, index_name, field_name).ConstructFieldStats(), &stats_value);
+      if (s.IsNotFound()) {
+        // the index is created before the statistics are collected
+        field_info.stats = std::make_unique<FieldStats>(false);
+        continue;
+      }
+      if (!s.ok()) {
+        return {Status::NotOK, fmt::format("fail to find the statistics of index {}, field {}: {}", index_name,
+                                           field_name, s.ToString())};
+      }
+
+      Slice stats_slice = stats_value;
+      if (auto s = field_info.stats->Decode(&stats_slice); !s.ok()) {
+        return {Status::NotOK, fmt::format("fail to decode the statistics of index {}, field {}: {}", index_name,
+                                           field_name, s.ToString())};
+      }
+    }
+
+    return info;
+  }
 };
 }  // namespace redis
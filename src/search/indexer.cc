@@ -21,12 +21,16 @@
 #include "indexer.h"
 
 #include <algorithm>
+#include <cstring>
+#include <optional>
 #include <variant>
 
 #include "db_util.h"
 #include "parse_util.h"
 #include "search/hnsw_indexer.h"
 #include "search/search_encoding.h"
+#include "search/text_analyzer.h"
+#include "search/text_index.h"
 #include "search/value.h"
 #include "storage/redis_metadata.h"
 #include "storage/storage.h"
@@ -89,9 +93,14 @@ StatusOr<kqir::Value> FieldValueRetriever::ParseFromJson(const jsoncons::json &v
     for (size_t i = 0; i < dim; ++i) {
       if (!val[i].is_number() || val[i].is_string())
         return {Status::NotOK, "json value should be array of numbers for vector fields"};
-      nums.push_back(val[i].as_double());
+      // keep the precision of the stored elements, so the inserted vector is the same as the one read back
+      nums.push_back(vector->vector_type == VectorType::FLOAT32 ? static_cast<float>(val[i].as_double())
+                                                                : val[i].as_double());
     }
     return kqir::MakeValue<kqir::NumericArray>(nums);
+  } else if (auto text [[maybe_unused]] = dynamic_cast<const redis::TextFieldMetadata *>(type)) {
+    if (!val.is_string()) return {Status::NotOK, "json value should be string for text fields"};
+    return kqir::MakeValue<kqir::String>(val.as_string());
   } else {
     return {Status::NotOK, "unknown field type to retrieve"};
   }
@@ -108,16 +117,26 @@ StatusOr<kqir::Value> FieldValueRetriever::ParseFromHash(const std::string &valu
     return kqir::MakeValue<kqir::StringArray>(vec);
   } else if (auto vector = dynamic_cast<const redis::HnswVectorFieldMetadata *>(type)) {
     const auto dim = vector->dim;
-    if (value.size() != dim * sizeof(double)) {
+    if (value.size() != dim * VectorElementSize(vector->vector_type)) {
       return {Status::NotOK, "field value is too short or too long to be parsed as a vector"};
     }
     std::vector<double> vec;
+    vec.reserve(dim);
     for (size_t i = 0; i < dim; ++i) {
       // TODO: care about endian later
-      // TODO: currently only support 64bit floating point
-      vec.push_back(*(reinterpret_cast<const double *>(value.data()) + i));
+      if (vector->vector_type == VectorType::FLOAT32) {
+        float element = 0;
+        memcpy(&element, value.data() + i * sizeof(float), sizeof(float));
+        vec.push_back(element);
+      } else {
+        double element = 0;
+        memcpy(&element, value.data() + i * sizeof(double), sizeof(double));
+        vec.push_back(element);
+      }
     }
     return kqir::MakeValue<kqir::NumericArray>(vec);
+  } else if (auto text [[maybe_unused]] = dynamic_cast<const redis::TextFieldMetadata *>(type)) {
+    return kqir::MakeValue<kqir::String>(value);
   } else {
     return {Status::NotOK, "unknown field type to retrieve"};
   }
@@ -127,6 +146,14 @@ StatusOr<kqir::Value> FieldValueRetriever::Retrieve(engine::Context &ctx, std::s
                                                     const redis::IndexFieldMetadata *type) {
   if (std::holds_alternative<HashData>(db)) {
     auto &[hash, metadata, key] = std::get<HashData>(db);
+    if (metadata.IsInline()) {
+      auto iter = std::find_if(metadata.inline_fields.begin(), metadata.inline_fields.end(),
+                               [field](const auto &field_value) { return field_value.first == field; });
+      if (iter == metadata.inline_fields.end()) return {Status::NotFound, "field not found"};
+
+      return ParseFromHash(iter->second, type);
+    }
+
     std::string ns_key = hash.AppendNamespacePrefix(key);
     std::string sub_key = InternalKey(ns_key, field, metadata.version, hash.storage_->IsSlotIdEncoded()).Encode();
     std::string value;
@@ -186,7 +213,7 @@ StatusOr<IndexUpdater::FieldValues> IndexUpdater::Record(engine::Context &ctx, s
 
 Status IndexUpdater::UpdateTagIndex(engine::Context &ctx, std::string_view key, const kqir::Value &original,
                                     const kqir::Value &current, const SearchKey &search_key,
-                                    const TagFieldMetadata *tag) const {
+                                    const TagFieldMetadata *tag, rocksdb::WriteBatchBase *batch) const {
   CHECK(original.IsNull() || original.Is<kqir::StringArray>());
   CHECK(current.IsNull() || current.Is<kqir::StringArray>());
   auto original_tags = original.IsNull() ? std::vector<std::string>() : original.Get<kqir::StringArray>();
@@ -220,7 +247,8 @@ Status IndexUpdater::UpdateTagIndex(engine::Context &ctx, std::string_view key,
   }
 
   auto *storage = indexer->storage;
-  auto batch = storage->GetWriteBatchBase();
+  std::optional<engine::WriteBatchBasePtr> own_batch;
+  if (!batch) batch = own_batch.emplace(storage->GetWriteBatchBase()).Get();
   auto cf_handle = storage->GetCFHandle(ColumnFamilyID::Search);
 
   for (const auto &tag : tags_to_delete) {
@@ -241,6 +269,7 @@ Status IndexUpdater::UpdateTagIndex(engine::Context &ctx, std::string_view key,
     }
   }
 
+  if (!own_batch) return Status::OK();
   auto s = storage->Write(ctx, storage->DefaultWriteOptions(), batch->GetWriteBatch());
   if (!s.ok()) return {Status::NotOK, s.ToString()};
   return Status::OK();
@@ -248,12 +277,14 @@ Status IndexUpdater::UpdateTagIndex(engine::Context &ctx, std::string_view key,
 
 Status IndexUpdater::UpdateNumericIndex(engine::Context &ctx, std::string_view key, const kqir::Value &original,
                                         const kqir::Value &current, const SearchKey &search_key,
-                                        [[maybe_unused]] const NumericFieldMetadata *num) const {
+                                        [[maybe_unused]] const NumericFieldMetadata *num,
+                                        rocksdb::WriteBatchBase *batch) const {
   CHECK(original.IsNull() || original.Is<kqir::Numeric>());
   CHECK(current.IsNull() || current.Is<kqir::Numeric>());
 
   auto *storage = indexer->storage;
-  auto batch = storage->GetWriteBatchBase();
+  std::optional<engine::WriteBatchBasePtr> own_batch;
+  if (!batch) batch = own_batch.emplace(storage->GetWriteBatchBase()).Get();
   auto cf_handle = storage->GetCFHandle(ColumnFamilyID::Search);
 
   if (!original.IsNull()) {
@@ -273,6 +304,8 @@ Status IndexUpdater::UpdateNumericIndex(engine::Context &ctx, std::string_view k
       return {Status::NotOK, s.ToString()};
     }
   }
+
+  if (!own_batch) return Status::OK();
   auto s = storage->Write(ctx, storage->DefaultWriteOptions(), batch->GetWriteBatch());
   if (!s.ok()) return {Status::NotOK, s.ToString()};
   return Status::OK();
@@ -280,17 +313,27 @@ Status IndexUpdater::UpdateNumericIndex(engine::Context &ctx, std::string_view k
 
 Status IndexUpdater::UpdateHnswVectorIndex(engine::Context &ctx, std::string_view key, const kqir::Value &original,
                                            const kqir::Value &current, const SearchKey &search_key,
-                                           HnswVectorFieldMetadata *vector) const {
+                                           HnswVectorFieldMetadata *vector, HnswGraphCache *cache,
+                                           std::mutex *mu) const {
   CHECK(original.IsNull() || original.Is<kqir::NumericArray>());
   CHECK(current.IsNull() || current.Is<kqir::NumericArray>());
 
+  std::optional<std::lock_guard<std::mutex>> guard;
+  if (mu) guard.emplace(*mu);
+
   auto storage = indexer->storage;
-  auto hnsw = HnswIndex(search_key, vector, storage);
+  auto hnsw = HnswIndex(search_key, vector, storage, cache);
 
-  if (!original.IsNull()) {
+  // A key can be indexed again by a resumed build or by a write racing with the build,
+  // so an existing node is removed first instead of inserting a duplicate one
+  bool exists = original.IsNull() && !current.IsNull() &&
+                hnsw.DecodeNodeMetadata(ctx, HnswNode(std::string(key), 0)).IsOK();
+
+  if (!original.IsNull() || exists) {
     auto batch = storage->GetWriteBatchBase();
     GET_OR_RET(hnsw.DeleteVectorEntry(ctx, key, batch));
     auto s = storage->Write(ctx, storage->DefaultWriteOptions(), batch->GetWriteBatch());
+    hnsw.InvalidateCache(batch->GetWriteBatch());
     if (!s.ok()) return {Status::NotOK, s.ToString()};
   }
 
@@ -298,14 +341,34 @@ Status IndexUpdater::UpdateHnswVectorIndex(engine::Context &ctx, std::string_vie
     auto batch = storage->GetWriteBatchBase();
     GET_OR_RET(hnsw.InsertVectorEntry(ctx, key, current.Get<kqir::NumericArray>(), batch));
     auto s = storage->Write(ctx, storage->DefaultWriteOptions(), batch->GetWriteBatch());
+    hnsw.InvalidateCache(batch->GetWriteBatch());
     if (!s.ok()) return {Status::NotOK, s.ToString()};
   }
 
   return Status::OK();
 }
 
+Status IndexUpdater::UpdateTextIndex(engine::Context &ctx, std::string_view key, const kqir::Value &original,
+                                     const kqir::Value &current, const SearchKey &search_key,
+                                     const TextFieldMetadata *text, std::mutex *mu) const {
+  CHECK(original.IsNull() || original.Is<kqir::String>());
+  CHECK(current.IsNull() || current.Is<kqir::String>());
+
+  auto tokenize = [text](const kqir::Value &value) {
+    return value.IsNull() ? std::vector<std::string>() : TokenizeText(value.Get<kqir::String>(), !text->nostem);
+  };
+  auto original_tokens = tokenize(original);
+  auto current_tokens = tokenize(current);
+  if (original_tokens == current_tokens) return Status::OK();
+
+  std::optional<std::lock_guard<std::mutex>> guard;
+  if (mu) guard.emplace(*mu);
+  return TextIndex(search_key, indexer->storage).Update(ctx, key, original_tokens, current_tokens);
+}
+
 Status IndexUpdater::UpdateIndex(engine::Context &ctx, const std::string &field, std::string_view key,
-                                 const kqir::Value &original, const kqir::Value &current) const {
+                                 const kqir::Value &original, const kqir::Value &current,
+                                 rocksdb::WriteBatchBase *batch) const {
   if (original == current) {
     // the value of this field is unchanged, no need to update
     return Status::OK();
@@ -319,15 +382,44 @@ Status IndexUpdater::UpdateIndex(engine::Context &ctx, const std::string &field,
   auto *metadata = iter->second.metadata.get();
   SearchKey search_key(info->ns, info->name, field);
   if (auto tag = dynamic_cast<TagFieldMetadata *>(metadata)) {
-    GET_OR_RET(UpdateTagIndex(ctx, key, original, current, search_key, tag));
+    GET_OR_RET(UpdateTagIndex(ctx, key, original, current, search_key, tag, batch));
   } else if (auto numeric [[maybe_unused]] = dynamic_cast<NumericFieldMetadata *>(metadata)) {
-    GET_OR_RET(UpdateNumericIndex(ctx, key, original, current, search_key, numeric));
+    GET_OR_RET(UpdateNumericIndex(ctx, key, original, current, search_key, numeric, batch));
   } else if (auto vector = dynamic_cast<HnswVectorFieldMetadata *>(metadata)) {
-    GET_OR_RET(UpdateHnswVectorIndex(ctx, key, original, current, search_key, vector));
+    GET_OR_RET(UpdateHnswVectorIndex(ctx, key, original, current, search_key, vector, iter->second.hnsw_cache.get(),
+                                     iter->second.hnsw_mutex.get()));
+  } else if (auto text = dynamic_cast<TextFieldMetadata *>(metadata)) {
+    GET_OR_RET(UpdateTextIndex(ctx, key, original, current, search_key, text, iter->second.text_mutex.get()));
   } else {
     return {Status::NotOK, "Unexpected field type"};
   }
 
+  if (auto *stats = iter->second.stats.get()) {
+    stats->Update(metadata, original, current);
+    if (stats->NeedSave()) GET_OR_RET(SaveFieldStats(ctx, iter->second, batch));
+  }
+
+  return Status::OK();
+}
+
+Status IndexUpdater::SaveFieldStats(engine::Context &ctx, const kqir::FieldInfo &field,
+                                    rocksdb::WriteBatchBase *batch) const {
+  if (!field.stats) return Status::OK();
+
+  std::string value;
+  field.stats->Encode(&value);
+
+  auto *storage = indexer->storage;
+  std::optional<engine::WriteBatchBasePtr> own_batch;
+  if (!batch) batch = own_batch.emplace(storage->GetWriteBatchBase()).Get();
+
+  SearchKey search_key(info->ns, info->name, field.name);
+  auto s = batch->Put(storage->GetCFHandle(ColumnFamilyID::Search), search_key.ConstructFieldStats(), value);
+  if (!s.ok()) return {Status::NotOK, s.ToString()};
+
+  if (!own_batch) return Status::OK();
+  s = storage->Write(ctx, storage->DefaultWriteOptions(), batch->GetWriteBatch());
+  if (!s.ok()) return {Status::NotOK, s.ToString()};
   return Status::OK();
 }
 
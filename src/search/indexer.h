@@ -24,6 +24,7 @@
 
 #include <deque>
 #include <map>
+#include <mutex>
 #include <utility>
 #include <variant>
 
@@ -79,20 +80,33 @@ struct IndexUpdater {
   explicit IndexUpdater(const kqir::IndexInfo *info) : info(info) {}
 
   StatusOr<FieldValues> Record(engine::Context &ctx, std::string_view key) const;
+  // The tag and numeric entries are put into the batch if it's given, instead of being written at once.
+  // The HNSW graph and the text postings read their own writes, so vector and text fields are always
+  // written directly.
   Status UpdateIndex(engine::Context &ctx, const std::string &field, std::string_view key, const kqir::Value &original,
-                     const kqir::Value &current) const;
+                     const kqir::Value &current, rocksdb::WriteBatchBase *batch = nullptr) const;
   Status Update(engine::Context &ctx, const FieldValues &original, std::string_view key) const;
+  // SaveFieldStats puts the statistics of the field into the batch if it's given, or writes them at once
+  Status SaveFieldStats(engine::Context &ctx, const kqir::FieldInfo &field,
+                        rocksdb::WriteBatchBase *batch = nullptr) const;
 
   Status Build(engine::Context &ctx) const;
 
   Status UpdateTagIndex(engine::Context &ctx, std::string_view key, const kqir::Value &original,
-                        const kqir::Value &current, const SearchKey &search_key, const TagFieldMetadata *tag) const;
+                        const kqir::Value &current, const SearchKey &search_key, const TagFieldMetadata *tag,
+                        rocksdb::WriteBatchBase *batch = nullptr) const;
   Status UpdateNumericIndex(engine::Context &ctx, std::string_view key, const kqir::Value &original,
                             const kqir::Value &current, const SearchKey &search_key,
-                            const NumericFieldMetadata *num) const;
+                            const NumericFieldMetadata *num, rocksdb::WriteBatchBase *batch = nullptr) const;
+  // The graph is updated in place, so the updates are serialized by the mutex if it's given
   Status UpdateHnswVectorIndex(engine::Context &ctx, std::string_view key, const kqir::Value &original,
                                const kqir::Value &current, const SearchKey &search_key,
-                               HnswVectorFieldMetadata *vector) const;
+                               HnswVectorFieldMetadata *vector, HnswGraphCache *cache = nullptr,
+                               std::mutex *mu = nullptr) const;
+  // The postings of a text field are read-modify-written, so the updates are serialized by the mutex if it's given
+  Status UpdateTextIndex(engine::Context &ctx, std::string_view key, const kqir::Value &original,
+                         const kqir::Value &current, const SearchKey &search_key, const TextFieldMetadata *text,
+                         std::mutex *mu = nullptr) const;
 };
 
 struct GlobalIndexer {
@@ -139,6 +139,30 @@ struct TagContainExpr : BoolAtomExpr {
   }
 };
 
+// TextMatchExpr matches the texts containing all the words of the query, or containing them
+// consecutively in order if it's a phrase
+struct TextMatchExpr : BoolAtomExpr {
+  std::unique_ptr<FieldRef> field;
+  std::unique_ptr<StringLiteral> query;
+  bool phrase;
+
+  TextMatchExpr(std::unique_ptr<FieldRef> &&field, std::unique_ptr<StringLiteral> &&query, bool phrase = false)
+      : field(std::move(field)), query(std::move(query)), phrase(phrase) {}
+
+  std::string_view Name() const override { return "TextMatchExpr"; }
+  std::string Dump() const override {
+    return fmt::format("{} {} {}", field->Dump(), phrase ? "matchphrase" : "match", query->Dump());
+  }
+
+  NodeIterator ChildBegin() override { return {field.get(), query.get()}; };
+  NodeIterator ChildEnd() override { return {}; };
+
+  std::unique_ptr<Node> Clone() const override {
+    return std::make_unique<TextMatchExpr>(Node::MustAs<FieldRef>(field->Clone()),
+                                           Node::MustAs<StringLiteral>(query->Clone()), phrase);
+  }
+};
+
 struct NumericLiteral : Literal {
   double val;
 
@@ -231,8 +255,12 @@ struct NumericCompareExpr : BoolAtomExpr {
 
 struct VectorLiteral : Literal {
   std::vector<double> values;
+  // the binary parameter the values are decoded from as FLOAT64,
+  // it's decoded again by the semantic checker if the field stores another type
+  std::string blob;
 
   explicit VectorLiteral(std::vector<double> &&values) : values(std::move(values)){};
+  VectorLiteral(std::vector<double> &&values, std::string blob) : values(std::move(values)), blob(std::move(blob)){};
 
   std::string_view Name() const override { return "VectorLiteral"; }
   std::string Dump() const override {
@@ -268,16 +296,28 @@ struct VectorKnnExpr : BoolAtomExpr {
   std::unique_ptr<FieldRef> field;
   std::unique_ptr<VectorLiteral> vector;
   size_t k;
+  // the ef_runtime of the field is used if it's 0
+  uint32_t ef_runtime;
+  // the k nearest neighbours are searched in the documents matching the filter, or all the documents if it's null
+  std::unique_ptr<QueryExpr> filter;
 
-  VectorKnnExpr(std::unique_ptr<FieldRef> &&field, std::unique_ptr<VectorLiteral> &&vector, size_t k)
-      : field(std::move(field)), vector(std::move(vector)), k(k) {}
+  VectorKnnExpr(std::unique_ptr<FieldRef> &&field, std::unique_ptr<VectorLiteral> &&vector, size_t k,
+                uint32_t ef_runtime = 0, std::unique_ptr<QueryExpr> &&filter = nullptr)
+      : field(std::move(field)), vector(std::move(vector)), k(k), ef_runtime(ef_runtime), filter(std::move(filter)) {}
 
   std::string_view Name() const override { return "VectorKnnExpr"; }
-  std::string Dump() const override { return fmt::format("KNN k={}, {} <-> {}", k, field->Dump(), vector->Dump()); }
+  std::string Dump() const override {
+    std::string knn = ef_runtime == 0 ? fmt::format("KNN k={}, {} <-> {}", k, field->Dump(), vector->Dump())
+                                      : fmt::format("KNN k={} ef_runtime={}, {} <-> {}", k, ef_runtime, field->Dump(),
+                                                    vector->Dump());
+    if (filter) return fmt::format("{} => {}", filter->Dump(), knn);
+    return knn;
+  }
 
   std::unique_ptr<Node> Clone() const override {
     return std::make_unique<VectorKnnExpr>(Node::MustAs<FieldRef>(field->Clone()),
-                                           Node::MustAs<VectorLiteral>(vector->Clone()), k);
+                                           Node::MustAs<VectorLiteral>(vector->Clone()), k, ef_runtime,
+                                           filter ? Node::MustAs<QueryExpr>(filter->Clone()) : nullptr);
   }
 };
 
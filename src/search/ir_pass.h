@@ -59,6 +59,8 @@ struct Visitor : Pass {
       return Visit(std::move(v));
     } else if (auto v = Node::As<TagContainExpr>(std::move(node))) {
       return Visit(std::move(v));
+    } else if (auto v = Node::As<TextMatchExpr>(std::move(node))) {
+      return Visit(std::move(v));
     } else if (auto v = Node::As<VectorLiteral>(std::move(node))) {
       return Visit(std::move(v));
     } else if (auto v = Node::As<VectorKnnExpr>(std::move(node))) {
@@ -75,6 +77,8 @@ struct Visitor : Pass {
       return Visit(std::move(v));
     } else if (auto v = Node::As<TagFieldScan>(std::move(node))) {
       return Visit(std::move(v));
+    } else if (auto v = Node::As<TextFieldScan>(std::move(node))) {
+      return Visit(std::move(v));
     } else if (auto v = Node::As<HnswVectorFieldRangeScan>(std::move(node))) {
       return Visit(std::move(v));
     } else if (auto v = Node::As<HnswVectorFieldKnnScan>(std::move(node))) {
@@ -85,6 +89,8 @@ struct Visitor : Pass {
       return Visit(std::move(v));
     } else if (auto v = Node::As<Merge>(std::move(node))) {
       return Visit(std::move(v));
+    } else if (auto v = Node::As<Intersect>(std::move(node))) {
+      return Visit(std::move(v));
     } else if (auto v = Node::As<Sort>(std::move(node))) {
       return Visit(std::move(v));
     } else if (auto v = Node::As<TopNSort>(std::move(node))) {
@@ -149,9 +155,16 @@ struct Visitor : Pass {
     return node;
   }
 
+  virtual std::unique_ptr<Node> Visit(std::unique_ptr<TextMatchExpr> node) {
+    node->field = VisitAs<FieldRef>(std::move(node->field));
+    node->query = VisitAs<StringLiteral>(std::move(node->query));
+    return node;
+  }
+
   virtual std::unique_ptr<Node> Visit(std::unique_ptr<VectorKnnExpr> node) {
     node->field = VisitAs<FieldRef>(std::move(node->field));
     node->vector = VisitAs<VectorLiteral>(std::move(node->vector));
+    if (node->filter) node->filter = TransformAs<QueryExpr>(std::move(node->filter));
     return node;
   }
 
@@ -198,9 +211,14 @@ struct Visitor : Pass {
 
   virtual std::unique_ptr<Node> Visit(std::unique_ptr<TagFieldScan> node) { return node; }
 
+  virtual std::unique_ptr<Node> Visit(std::unique_ptr<TextFieldScan> node) { return node; }
+
   virtual std::unique_ptr<Node> Visit(std::unique_ptr<HnswVectorFieldRangeScan> node) { return node; }
 
-  virtual std::unique_ptr<Node> Visit(std::unique_ptr<HnswVectorFieldKnnScan> node) { return node; }
+  virtual std::unique_ptr<Node> Visit(std::unique_ptr<HnswVectorFieldKnnScan> node) {
+    if (node->filter) node->filter = TransformAs<PlanOperator>(std::move(node->filter));
+    return node;
+  }
 
   virtual std::unique_ptr<Node> Visit(std::unique_ptr<Filter> node) {
     node->source = TransformAs<PlanOperator>(std::move(node->source));
@@ -240,6 +258,14 @@ struct Visitor : Pass {
 
     return node;
   }
+
+  virtual std::unique_ptr<Node> Visit(std::unique_ptr<Intersect> node) {
+    for (auto &n : node->ops) {
+      n = TransformAs<PlanOperator>(std::move(n));
+    }
+
+    return node;
+  }
 };
 
 }  // namespace kqir
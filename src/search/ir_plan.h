@@ -20,10 +20,12 @@
 
 #pragma once
 
+#include <algorithm>
 #include <limits>
 #include <memory>
 
 #include "ir.h"
+#include "search/arithmetic_expr.h"
 #include "search/interval.h"
 #include "search/ir_sema_checker.h"
 #include "search/value.h"
@@ -97,21 +99,57 @@ struct TagFieldScan : FieldScan {
   }
 };
 
+// TextFieldScan reads the keys whose texts contain all the terms, or contain them consecutively in order
+// if it's a phrase, in the descending order of their BM25 scores
+struct TextFieldScan : FieldScan {
+  std::vector<std::string> terms;
+  bool phrase;
+
+  TextFieldScan(std::unique_ptr<FieldRef> field, std::vector<std::string> terms, bool phrase = false)
+      : FieldScan(std::move(field)), terms(std::move(terms)), phrase(phrase) {}
+
+  std::string_view Name() const override { return "TextFieldScan"; };
+  std::string Content() const override {
+    auto terms_str = util::StringJoin(terms, [](const auto &v) -> decltype(auto) { return v; }, " ");
+    return phrase ? fmt::format("\"{}\"", terms_str) : terms_str;
+  };
+  std::string Dump() const override { return fmt::format("text-scan {}, {}", field->name, Content()); }
+
+  std::unique_ptr<Node> Clone() const override {
+    return std::make_unique<TextFieldScan>(field->CloneAs<FieldRef>(), terms, phrase);
+  }
+};
+
 struct HnswVectorFieldKnnScan : FieldScan {
   kqir::NumericArray vector;
   uint32_t k;
-
-  HnswVectorFieldKnnScan(std::unique_ptr<FieldRef> field, kqir::NumericArray vector, uint16_t k)
-      : FieldScan(std::move(field)), vector(std::move(vector)), k(k) {}
+  uint32_t ef_runtime;
+  // the plan of the documents to search in, which are collected before the search, or null for all the documents
+  std::unique_ptr<PlanOperator> filter;
+
+  HnswVectorFieldKnnScan(std::unique_ptr<FieldRef> field, kqir::NumericArray vector, uint16_t k,
+                         uint32_t ef_runtime = 0, std::unique_ptr<PlanOperator> filter = nullptr)
+      : FieldScan(std::move(field)),
+        vector(std::move(vector)),
+        k(k),
+        ef_runtime(ef_runtime),
+        filter(std::move(filter)) {}
 
   std::string_view Name() const override { return "HnswVectorFieldKnnScan"; };
   std::string Content() const override {
     return fmt::format("[{}], {}", util::StringJoin(vector, [](auto v) { return std::to_string(v); }), k);
   };
-  std::string Dump() const override { return fmt::format("hnsw-vector-knn-scan {}, {}", field->name, Content()); }
+  std::string Dump() const override {
+    if (filter) return fmt::format("hnsw-vector-knn-scan {}, {}, ({})", field->name, Content(), filter->Dump());
+    return fmt::format("hnsw-vector-knn-scan {}, {}", field->name, Content());
+  }
+
+  NodeIterator ChildBegin() override { return {field.get(), filter.get()}; }
+  NodeIterator ChildEnd() override { return {}; }
 
   std::unique_ptr<Node> Clone() const override {
-    return std::make_unique<HnswVectorFieldKnnScan>(field->CloneAs<FieldRef>(), vector, k);
+    return std::make_unique<HnswVectorFieldKnnScan>(field->CloneAs<FieldRef>(), vector, k, ef_runtime,
+                                                    filter ? filter->CloneAs<PlanOperator>() : nullptr);
   }
 };
 
@@ -185,6 +223,40 @@ struct Merge : PlanOperator {
   }
 };
 
+// Intersect yields the keys yielded by all of its scans. The scans are tag scans and numeric scans
+// of a single value, which yield the keys in the same order, so they're intersected by seeking.
+struct Intersect : PlanOperator {
+  std::vector<std::unique_ptr<PlanOperator>> ops;
+
+  explicit Intersect(std::vector<std::unique_ptr<PlanOperator>> &&ops) : ops(std::move(ops)) {}
+
+  // IsOrderedScan returns true if the op can be intersected
+  static bool IsOrderedScan(const PlanOperator *op) {
+    if (dynamic_cast<const TagFieldScan *>(op)) return true;
+    if (auto v = dynamic_cast<const NumericFieldScan *>(op)) {
+      return v->range.r == IntervalSet::NextNum(v->range.l);
+    }
+    return false;
+  }
+
+  std::string_view Name() const override { return "Intersect"; };
+  std::string Dump() const override {
+    return fmt::format("(intersect {})", util::StringJoin(ops, [](const auto &v) { return v->Dump(); }));
+  }
+
+  NodeIterator ChildBegin() override { return NodeIterator(ops.begin()); }
+  NodeIterator ChildEnd() override { return NodeIterator(ops.end()); }
+
+  std::unique_ptr<Node> Clone() const override {
+    std::vector<std::unique_ptr<PlanOperator>> res;
+    res.reserve(ops.size());
+    for (const auto &op : ops) {
+      res.push_back(Node::MustAs<PlanOperator>(op->Clone()));
+    }
+    return std::make_unique<Intersect>(std::move(res));
+  }
+};
+
 struct Limit : PlanOperator {
   std::unique_ptr<PlanOperator> op;
   std::unique_ptr<LimitClause> limit;
@@ -277,4 +349,148 @@ struct Projection : PlanOperator {
   }
 };
 
+// Aggregate groups the rows of its source by the values of the group fields, and reduces each group into
+// a row of the group values, the results of the reducers and the ones of the applied expressions,
+// which are sorted by one of these columns if sort_by is given.
+struct Aggregate : PlanOperator {
+  enum ReduceKind { COUNT, SUM, AVG, MIN, MAX, COUNT_DISTINCT };
+
+  struct Reducer {
+    ReduceKind kind;
+    // the reduced field, it's null for COUNT
+    std::unique_ptr<FieldRef> field;
+    std::string alias;
+  };
+
+  struct Apply {
+    std::unique_ptr<ArithmeticExpr> expr;
+    std::string alias;
+  };
+
+  std::unique_ptr<PlanOperator> source;
+  std::vector<std::unique_ptr<FieldRef>> group_by;
+  std::vector<Reducer> reducers;
+  std::vector<Apply> applies;
+  std::unique_ptr<SortByClause> sort_by;
+  // the max bytes of the groups kept in memory, 0 means no limit
+  uint64_t max_memory;
+
+  // the columns of the output rows in order, the ones of the reducers and the applies are owned by the operator
+  std::vector<const FieldInfo *> columns;
+  std::vector<std::unique_ptr<FieldInfo>> owned_columns;
+
+  Aggregate(std::unique_ptr<PlanOperator> &&source, std::vector<std::unique_ptr<FieldRef>> &&group_by,
+            std::vector<Reducer> &&reducers, std::vector<Apply> &&applies, std::unique_ptr<SortByClause> &&sort_by,
+            uint64_t max_memory = 0)
+      : source(std::move(source)),
+        group_by(std::move(group_by)),
+        reducers(std::move(reducers)),
+        applies(std::move(applies)),
+        sort_by(std::move(sort_by)),
+        max_memory(max_memory) {
+    for (const auto &field : this->group_by) columns.push_back(field->info);
+
+    auto add_column = [this](const std::string &name) {
+      owned_columns.push_back(std::make_unique<FieldInfo>(name, std::make_unique<redis::NumericFieldMetadata>()));
+      columns.push_back(owned_columns.back().get());
+    };
+    for (const auto &reducer : this->reducers) add_column(reducer.alias);
+    for (const auto &apply : this->applies) add_column(apply.alias);
+
+    if (this->sort_by) this->sort_by->field->info = FindColumn(this->sort_by->field->name);
+  }
+
+  static constexpr const char *ReduceKindToString(ReduceKind kind) {
+    switch (kind) {
+      case COUNT:
+        return "count";
+      case SUM:
+        return "sum";
+      case AVG:
+        return "avg";
+      case MIN:
+        return "min";
+      case MAX:
+        return "max";
+      case COUNT_DISTINCT:
+        return "count_distinct";
+    }
+
+    return "unknown";
+  }
+
+  const FieldInfo *FindColumn(std::string_view name) const {
+    for (const auto *column : columns) {
+      if (column->name == name) return column;
+    }
+
+    return nullptr;
+  }
+
+  // Check returns an error if a column used by an apply or the sorting isn't defined before it
+  Status Check() const {
+    auto check_expr = [this](const ArithmeticExpr *expr, size_t defined, auto &&self) -> Status {
+      if (!expr) return Status::OK();
+      if (expr->kind == ArithmeticExpr::COLUMN) {
+        auto iter = std::find_if(columns.begin(), columns.begin() + static_cast<std::ptrdiff_t>(defined),
+                                 [expr](const FieldInfo *column) { return column->name == expr->column; });
+        if (iter == columns.begin() + static_cast<std::ptrdiff_t>(defined)) {
+          return {Status::NotOK, fmt::format("column `{}` is not defined before APPLY", expr->column)};
+        }
+      }
+      GET_OR_RET(self(expr->lhs.get(), defined, self));
+      return self(expr->rhs.get(), defined, self);
+    };
+
+    for (size_t i = 0; i < applies.size(); i++) {
+      GET_OR_RET(check_expr(applies[i].expr.get(), group_by.size() + reducers.size() + i, check_expr));
+    }
+
+    if (sort_by && !sort_by->field->info) {
+      return {Status::NotOK, fmt::format("column `{}` of SORTBY is not defined", sort_by->field->name)};
+    }
+
+    return Status::OK();
+  }
+
+  std::string_view Name() const override { return "Aggregate"; };
+  std::string Content() const override {
+    std::string res =
+        fmt::format("groupby {}", util::StringJoin(group_by, [](const auto &v) { return "@" + v->name; }));
+    for (const auto &reducer : reducers) {
+      res += fmt::format(" reduce {}({}) as {}", ReduceKindToString(reducer.kind),
+                         reducer.field ? "@" + reducer.field->name : "", reducer.alias);
+    }
+    for (const auto &apply : applies) {
+      res += fmt::format(" apply {} as {}", apply.expr->Dump(), apply.alias);
+    }
+    if (sort_by) {
+      res += fmt::format(" sortby {}, {}", sort_by->field->name, SortByClause::OrderToString(sort_by->order));
+    }
+    return res;
+  }
+  std::string Dump() const override { return fmt::format("(aggregate {}: {})", Content(), source->Dump()); }
+
+  NodeIterator ChildBegin() override { return NodeIterator(source.get()); }
+  NodeIterator ChildEnd() override { return {}; }
+
+  std::unique_ptr<Node> Clone() const override {
+    std::vector<std::unique_ptr<FieldRef>> new_group_by;
+    for (const auto &field : group_by) new_group_by.push_back(field->CloneAs<FieldRef>());
+
+    std::vector<Reducer> new_reducers;
+    for (const auto &reducer : reducers) {
+      new_reducers.push_back({reducer.kind, reducer.field ? reducer.field->CloneAs<FieldRef>() : nullptr,
+                              reducer.alias});
+    }
+
+    std::vector<Apply> new_applies;
+    for (const auto &apply : applies) new_applies.push_back({apply.expr->Clone(), apply.alias});
+
+    return std::make_unique<Aggregate>(Node::MustAs<PlanOperator>(source->Clone()), std::move(new_group_by),
+                                       std::move(new_reducers), std::move(new_applies),
+                                       sort_by ? sort_by->CloneAs<SortByClause>() : nullptr, max_memory);
+  }
+};
+
 }  // namespace kqir
@@ -20,6 +20,8 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstring>
 #include <map>
 #include <memory>
 
@@ -27,6 +29,7 @@
 #include "index_info.h"
 #include "ir.h"
 #include "search_encoding.h"
+#include "text_analyzer.h"
 #include "storage/redis_metadata.h"
 
 namespace kqir {
@@ -39,6 +42,35 @@ struct SemaChecker {
 
   explicit SemaChecker(const IndexMap &index_map) : index_map(index_map) {}
 
+  // vector parameters are decoded as FLOAT64 by the parser, so the ones for a FLOAT32 field are decoded again
+  static Status DecodeVectorParam(VectorLiteral *vector, const redis::HnswVectorFieldMetadata *meta) {
+    if (vector->blob.empty() || meta->vector_type != redis::VectorType::FLOAT32) return Status::OK();
+
+    if (vector->blob.size() % sizeof(float) != 0) {
+      return {Status::NotOK, "data size is not a multiple of the target type size"};
+    }
+
+    vector->values.resize(vector->blob.size() / sizeof(float));
+    for (size_t i = 0; i < vector->values.size(); i++) {
+      float element = 0;
+      memcpy(&element, vector->blob.data() + i * sizeof(float), sizeof(float));
+      vector->values[i] = element;
+    }
+    return Status::OK();
+  }
+
+  static bool HasVectorExpr(const QueryExpr *node) {
+    if (dynamic_cast<const VectorKnnExpr *>(node) || dynamic_cast<const VectorRangeExpr *>(node)) return true;
+    if (auto v = dynamic_cast<const AndExpr *>(node)) {
+      return std::any_of(v->inners.begin(), v->inners.end(), [](const auto &n) { return HasVectorExpr(n.get()); });
+    }
+    if (auto v = dynamic_cast<const OrExpr *>(node)) {
+      return std::any_of(v->inners.begin(), v->inners.end(), [](const auto &n) { return HasVectorExpr(n.get()); });
+    }
+    if (auto v = dynamic_cast<const NotExpr *>(node)) return HasVectorExpr(v->inner.get());
+    return false;
+  }
+
   Status Check(Node *node) {
     if (auto v = dynamic_cast<SearchExpr *>(node)) {
       auto index_name = v->index->name;
@@ -54,9 +86,9 @@ struct SemaChecker {
           if (!v->limit) {
             return {Status::NotOK, "expect a LIMIT clause for vector field to construct a KNN search"};
           }
-          // TODO: allow hybrid query
-          if (auto b = dynamic_cast<BoolLiteral *>(v->query_expr.get()); b == nullptr) {
-            return {Status::NotOK, "KNN search cannot be combined with other query expressions"};
+          // the query expressions are the filter of the KNN search
+          if (HasVectorExpr(v->query_expr.get())) {
+            return {Status::NotOK, "the filter of a KNN search cannot contain vector queries"};
           }
         }
       } else {
@@ -83,6 +115,7 @@ struct SemaChecker {
             return {Status::NotOK,
                     fmt::format("field `{}` is marked as NOINDEX and cannot be used for KNN search", v->field->name)};
           }
+          GET_OR_RET(DecodeVectorParam(v->vector.get(), meta));
           if (v->vector->values.size() != meta->dim) {
             return {Status::NotOK,
                     fmt::format("vector should be of size `{}` for field `{}`", meta->dim, v->field->name)};
@@ -115,6 +148,18 @@ struct SemaChecker {
           return {Status::NotOK, fmt::format("tag cannot contain the separator `{}`", meta->separator)};
         }
       }
+    } else if (auto v = dynamic_cast<TextMatchExpr *>(node)) {
+      if (auto iter = current_index->fields.find(v->field->name); iter == current_index->fields.end()) {
+        return {Status::NotOK, fmt::format("field `{}` not found in index `{}`", v->field->name, current_index->name)};
+      } else if (auto meta = iter->second.MetadataAs<redis::TextFieldMetadata>(); !meta) {
+        return {Status::NotOK, fmt::format("field `{}` is not a text field", v->field->name)};
+      } else {
+        v->field->info = &iter->second;
+
+        if (redis::TokenizeText(v->query->val, !meta->nostem).empty()) {
+          return {Status::NotOK, "text query should contain at least one word"};
+        }
+      }
     } else if (auto v = dynamic_cast<NumericCompareExpr *>(node)) {
       if (auto iter = current_index->fields.find(v->field->name); iter == current_index->fields.end()) {
         return {Status::NotOK, fmt::format("field `{}` not found in index `{}`", v->field->name, current_index->name)};
@@ -136,10 +181,18 @@ struct SemaChecker {
                   fmt::format("field `{}` is marked as NOINDEX and cannot be used for KNN search", v->field->name)};
         }
         auto meta = v->field->info->MetadataAs<redis::HnswVectorFieldMetadata>();
+        GET_OR_RET(DecodeVectorParam(v->vector.get(), meta));
         if (v->vector->values.size() != meta->dim) {
           return {Status::NotOK,
                   fmt::format("vector should be of size `{}` for field `{}`", meta->dim, v->field->name)};
         }
+
+        if (v->filter) {
+          if (HasVectorExpr(v->filter.get())) {
+            return {Status::NotOK, "the filter of a KNN search cannot contain vector queries"};
+          }
+          GET_OR_RET(Check(v->filter.get()));
+        }
       }
     } else if (auto v = dynamic_cast<VectorRangeExpr *>(node)) {
       if (auto iter = current_index->fields.find(v->field->name); iter == current_index->fields.end()) {
@@ -158,6 +211,7 @@ struct SemaChecker {
           return {Status::NotOK, "range has to be between 0 and 2 for cosine distance metric"};
         }
 
+        GET_OR_RET(DecodeVectorParam(v->vector.get(), meta));
         if (v->vector->values.size() != meta->dim) {
           return {Status::NotOK,
                   fmt::format("vector should be of size `{}` for field `{}`", meta->dim, v->field->name)};
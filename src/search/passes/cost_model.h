@@ -20,8 +20,11 @@
 
 #pragma once
 
+#include <cmath>
+#include <limits>
 #include <memory>
 #include <numeric>
+#include <optional>
 
 #include "search/interval.h"
 #include "search/ir.h"
@@ -29,8 +32,9 @@
 
 namespace kqir {
 
-// TODO: collect statistical information of index in runtime
-// to optimize the cost model
+// The cost of a tag or numeric scan is proportional to its estimated selectivity, i.e. the fraction
+// of the documents of the index it matches, if the statistics of the field are collected.
+// Otherwise the costs are fixed by the kind of the scans.
 struct CostModel {
   static size_t Transform(const PlanOperator *node) {
     if (auto v = dynamic_cast<const FullIndexScan *>(node)) {
@@ -48,12 +52,18 @@ struct CostModel {
     if (auto v = dynamic_cast<const TagFieldScan *>(node)) {
       return Visit(v);
     }
+    if (auto v = dynamic_cast<const TextFieldScan *>(node)) {
+      return Visit(v);
+    }
     if (auto v = dynamic_cast<const Filter *>(node)) {
       return Visit(v);
     }
     if (auto v = dynamic_cast<const Merge *>(node)) {
       return Visit(v);
     }
+    if (auto v = dynamic_cast<const Intersect *>(node)) {
+      return Visit(v);
+    }
 
     CHECK(false) << "plan operator type not supported";
   }
@@ -61,6 +71,12 @@ struct CostModel {
   static size_t Visit([[maybe_unused]] const FullIndexScan *node) { return 100; }
 
   static size_t Visit(const NumericFieldScan *node) {
+    if (auto cost = SelectivityCost(node->field->info, [node](const redis::FieldStats *stats) {
+          return stats->NumericSelectivity(node->range.l, node->range.r);
+        })) {
+      return *cost;
+    }
+
     if (node->range.r == IntervalSet::NextNum(node->range.l)) {
       return 5;
     }
@@ -78,14 +94,52 @@ struct CostModel {
     return base;
   }
 
-  static size_t Visit([[maybe_unused]] const TagFieldScan *node) { return 10; }
+  static size_t Visit(const TagFieldScan *node) {
+    if (auto cost = SelectivityCost(node->field->info, [node](const redis::FieldStats *stats) {
+          return stats->TagSelectivity(node->field->info->MetadataAs<redis::TagFieldMetadata>(), node->tag);
+        })) {
+      return *cost;
+    }
+
+    return 10;
+  }
+
+  // a text scan reads the postings of all its terms and sorts the matched keys by their scores
+  static size_t Visit([[maybe_unused]] const TextFieldScan *node) { return 10; }
 
-  static size_t Visit([[maybe_unused]] const HnswVectorFieldKnnScan *node) { return 3; }
+  // a filtered KNN scan collects the keys of its filter first
+  static size_t Visit(const HnswVectorFieldKnnScan *node) {
+    return node->filter ? Transform(node->filter.get()) + 3 : 3;
+  }
 
   static size_t Visit([[maybe_unused]] const HnswVectorFieldRangeScan *node) { return 4; }
 
   static size_t Visit(const Filter *node) { return Transform(node->source.get()) + 1; }
 
+  // SelectivityCost scales the selectivity of a field scan, estimated by the statistics of the field,
+  // to the fraction of the documents of the index, which are assumed to be as many as the keys of its most
+  // common field. The cost of a scan matching all the documents is the cost of a full index scan.
+  template <typename F>
+  static std::optional<size_t> SelectivityCost(const FieldInfo *info, F &&estimate) {
+    if (!info || !info->index || !info->stats || !info->stats->IsComplete()) return std::nullopt;
+
+    uint64_t docs = 0;
+    for (const auto &[_, field] : info->index->fields) {
+      if (field.stats) docs = std::max(docs, field.stats->GetCardinality());
+    }
+    if (docs == 0) return std::nullopt;
+
+    double selectivity = std::forward<F>(estimate)(info->stats.get()) *
+                         static_cast<double>(info->stats->GetCardinality()) / static_cast<double>(docs);
+    return 1 + static_cast<size_t>(std::lround(std::min(selectivity, 1.0) * 99));
+  }
+
+  // an intersection seeks through the other scans, so it costs about as much as its cheapest scan
+  static size_t Visit(const Intersect *node) {
+    return std::accumulate(node->ops.begin(), node->ops.end(), std::numeric_limits<size_t>::max(),
+                           [](size_t res, const auto &v) { return std::min(res, Transform(v.get())); });
+  }
+
   static size_t Visit(const Merge *node) {
     return std::accumulate(node->ops.begin(), node->ops.end(), size_t(0), [](size_t res, const auto &v) {
       if (dynamic_cast<const Filter *>(v.get())) {
@@ -21,6 +21,7 @@
 #pragma once
 
 #include <memory>
+#include <optional>
 #include <range/v3/view.hpp>
 #include <type_traits>
 #include <variant>
@@ -35,6 +36,7 @@
 #include "search/passes/push_down_not_expr.h"
 #include "search/passes/simplify_and_or_expr.h"
 #include "search/search_encoding.h"
+#include "search/text_analyzer.h"
 
 namespace kqir {
 
@@ -79,6 +81,51 @@ struct IndexSelection : Visitor {
     }
   }
 
+  // GenerateOrderedPlan scans the sort field in the sorting order, so the rows can be returned without sorting,
+  // and the scan stops as soon as enough rows pass the filter if there's a LIMIT.
+  // The predicates on the sort field narrow the ranges of the scan instead of being filtered.
+  std::unique_ptr<PlanOperator> GenerateOrderedPlan(std::unique_ptr<QueryExpr> filter_expr) const {
+    const auto *sort_field = order->field->info;
+    auto sort_field_intervals = [this, sort_field](QueryExpr *n) -> std::optional<IntervalSet> {
+      if (auto v = dynamic_cast<NumericCompareExpr *>(n); v && v->field->info == sort_field) {
+        return IntervalSet(v->op, v->num->val);
+      }
+      if (auto iter = intervals.find(n); iter != intervals.end() && iter->second.field_info == sort_field) {
+        return iter->second.intervals;
+      }
+      return std::nullopt;
+    };
+
+    IntervalSet is(IntervalSet::full);
+    std::vector<std::unique_ptr<QueryExpr>> filter_nodes;
+    if (auto v = sort_field_intervals(filter_expr.get())) {
+      is = *v;
+    } else if (auto v = dynamic_cast<AndExpr *>(filter_expr.get())) {
+      for (auto &n : v->inners) {
+        if (auto w = sort_field_intervals(n.get())) {
+          is = is & *w;
+        } else {
+          filter_nodes.push_back(std::move(n));
+        }
+      }
+    } else {
+      filter_nodes.push_back(std::move(filter_expr));
+    }
+
+    if (is.IsEmpty()) {
+      return std::make_unique<Noop>();
+    }
+
+    auto scan = PlanFromInterval(is, order->field.get(), order->order);
+    if (filter_nodes.empty()) {
+      return scan;
+    } else if (filter_nodes.size() == 1) {
+      return std::make_unique<Filter>(std::move(scan), std::move(filter_nodes.front()));
+    } else {
+      return std::make_unique<Filter>(std::move(scan), std::make_unique<AndExpr>(std::move(filter_nodes)));
+    }
+  }
+
   // if there's no Filter node, enter this method
   std::unique_ptr<Node> Visit(std::unique_ptr<FullIndexScan> node) override {
     if (HasGoodOrder()) {
@@ -96,8 +143,7 @@ struct IndexSelection : Visitor {
       // TODO: optimize plan with sorting order via the cost model
       sort_removable = true;
 
-      auto scan = GenerateScanFromOrder();
-      return std::make_unique<Filter>(std::move(scan), std::move(node->filter_expr));
+      return GenerateOrderedPlan(std::move(node->filter_expr));
     } else {
       index = index_scan->index.get();
 
@@ -124,6 +170,9 @@ struct IndexSelection : Visitor {
     if (auto v = dynamic_cast<TagContainExpr *>(node)) {
       return VisitExpr(v);
     }
+    if (auto v = dynamic_cast<TextMatchExpr *>(node)) {
+      return VisitExpr(v);
+    }
     if (auto v = dynamic_cast<NotExpr *>(node)) {
       return VisitExpr(v);
     }
@@ -137,7 +186,7 @@ struct IndexSelection : Visitor {
   }
 
   std::unique_ptr<PlanOperator> VisitExpr(NotExpr *node) const {
-    // after PushDownNotExpr, `node->inner` should be one of TagContainExpr and NumericCompareExpr
+    // after PushDownNotExpr, `node->inner` should be one of TagContainExpr, TextMatchExpr and NumericCompareExpr
     return MakeFullIndexFilter(node);
   }
 
@@ -149,6 +198,16 @@ struct IndexSelection : Visitor {
     return MakeFullIndexFilter(node);
   }
 
+  std::unique_ptr<PlanOperator> VisitExpr(TextMatchExpr *node) const {
+    if (node->field->info->HasIndex()) {
+      auto meta = node->field->info->MetadataAs<redis::TextFieldMetadata>();
+      return std::make_unique<TextFieldScan>(node->field->CloneAs<FieldRef>(),
+                                             redis::TokenizeText(node->query->val, !meta->nostem), node->phrase);
+    }
+
+    return MakeFullIndexFilter(node);
+  }
+
   // enter only if there's just a single NumericCompareExpr, without and/or expression
   std::unique_ptr<PlanOperator> VisitExpr(NumericCompareExpr *node) const {
     if (node->field->info->HasIndex() && node->op != NumericCompareExpr::NE) {
@@ -168,9 +227,17 @@ struct IndexSelection : Visitor {
     return MakeFullIndexFilter(node);
   }
 
-  std::unique_ptr<PlanOperator> VisitExpr(VectorKnnExpr *node) const {
+  std::unique_ptr<PlanOperator> VisitExpr(VectorKnnExpr *node) {
     if (node->field->info->HasIndex()) {
-      return std::make_unique<HnswVectorFieldKnnScan>(node->field->CloneAs<FieldRef>(), node->vector->values, node->k);
+      // the filter is planned like a query of its own, and the keys it selects are collected before the search
+      std::unique_ptr<PlanOperator> filter;
+      if (auto b = dynamic_cast<BoolLiteral *>(node->filter.get())) {
+        if (!b->val) return std::make_unique<Noop>();
+      } else if (node->filter) {
+        filter = TransformExpr(node->filter.get());
+      }
+      return std::make_unique<HnswVectorFieldKnnScan>(node->field->CloneAs<FieldRef>(), node->vector->values, node->k,
+                                                      node->ef_runtime, std::move(filter));
     }
 
     return MakeFullIndexFilter(node);
@@ -248,8 +315,25 @@ struct IndexSelection : Visitor {
         }
       }
 
-      auto &best_plan = *std::min_element(available_plans.begin(), available_plans.end(),
-                                          [](const auto &l, const auto &r) { return l.cost < r.cost; });
+      // the keys of the ordered scans are intersected by seeking, instead of filtering the keys of one of them
+      std::vector<std::unique_ptr<PlanOperator>> ordered_scans;
+      std::set<Node *> intersected_nodes;
+      for (const auto &plan : available_plans) {
+        if (!Intersect::IsOrderedScan(plan.plan.get())) continue;
+
+        ordered_scans.push_back(plan.plan->CloneAs<PlanOperator>());
+        intersected_nodes.insert(plan.selected_nodes.begin(), plan.selected_nodes.end());
+      }
+      if (ordered_scans.size() > 1) {
+        available_plans.emplace_back(std::make_unique<Intersect>(std::move(ordered_scans)),
+                                     std::move(intersected_nodes));
+      }
+
+      // the plan with fewer nodes left to filter is preferred if the costs are the same
+      auto &best_plan =
+          *std::min_element(available_plans.begin(), available_plans.end(), [](const auto &l, const auto &r) {
+            return l.cost < r.cost || (l.cost == r.cost && l.selected_nodes.size() > r.selected_nodes.size());
+          });
 
       std::vector<std::unique_ptr<QueryExpr>> filter_nodes;
       for (const auto &n : node->inners) {
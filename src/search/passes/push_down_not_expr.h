@@ -36,6 +36,8 @@ struct PushDownNotExpr : Visitor {
       return v;
     } else if (auto v = Node::As<TagContainExpr>(std::move(node->inner))) {
       return std::make_unique<NotExpr>(std::move(v));
+    } else if (auto v = Node::As<TextMatchExpr>(std::move(node->inner))) {
+      return std::make_unique<NotExpr>(std::move(v));
     } else if (auto v = Node::As<AndExpr>(std::move(node->inner))) {
       std::vector<std::unique_ptr<QueryExpr>> nodes;
       for (auto& n : v->inners) {
@@ -32,13 +32,16 @@ struct SortByWithLimitToKnnExpr : Visitor {
   std::unique_ptr<Node> Visit(std::unique_ptr<SearchExpr> node) override {
     node = Node::MustAs<SearchExpr>(Visitor::Visit(std::move(node)));
 
-    // TODO: allow hybrid query
+    // the other query expressions are the filter of the KNN search
     if (node->sort_by && node->sort_by->IsVectorField() && node->limit) {
-      if (auto b = dynamic_cast<BoolLiteral*>(node->query_expr.get()); b && b->val) {
+      auto b = dynamic_cast<BoolLiteral*>(node->query_expr.get());
+      if (!b || b->val) {
+        std::unique_ptr<QueryExpr> filter;
+        if (!b) filter = std::move(node->query_expr);
         node->query_expr =
             std::make_unique<VectorKnnExpr>(Node::MustAs<FieldRef>(node->sort_by->TakeFieldRef()),
                                             Node::MustAs<VectorLiteral>(node->sort_by->TakeVectorLiteral()),
-                                            node->limit->Offset() + node->limit->Count());
+                                            node->limit->Offset() + node->limit->Count(), 0, std::move(filter));
         node->sort_by.reset();
       }
     }
@@ -0,0 +1,77 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "plan_cache.h"
+
+namespace kqir {
+
+std::unique_ptr<PlanOperator> PlanCache::Get(const std::string &key, const std::string &index) {
+  std::lock_guard<std::mutex> guard(mu_);
+
+  auto &stats = stats_[index];
+  auto iter = entries_.find(key);
+  if (iter == entries_.end()) {
+    stats.misses++;
+    return nullptr;
+  }
+
+  stats.hits++;
+  lru_.splice(lru_.begin(), lru_, iter->second);
+  return iter->second->plan->CloneAs<PlanOperator>();
+}
+
+void PlanCache::Put(const std::string &key, const PlanOperator &plan, size_t capacity) {
+  if (capacity == 0) return;
+  auto copy = plan.CloneAs<PlanOperator>();
+
+  std::lock_guard<std::mutex> guard(mu_);
+  if (auto iter = entries_.find(key); iter != entries_.end()) {
+    iter->second->plan = std::move(copy);
+    lru_.splice(lru_.begin(), lru_, iter->second);
+    return;
+  }
+
+  lru_.push_front(Entry{key, std::move(copy)});
+  entries_.emplace(key, lru_.begin());
+  while (lru_.size() > capacity) {
+    entries_.erase(lru_.back().key);
+    lru_.pop_back();
+  }
+}
+
+void PlanCache::Clear(const std::string &index) {
+  std::lock_guard<std::mutex> guard(mu_);
+  entries_.clear();
+  lru_.clear();
+  if (!index.empty()) stats_.erase(index);
+}
+
+size_t PlanCache::Size() {
+  std::lock_guard<std::mutex> guard(mu_);
+  return lru_.size();
+}
+
+PlanCache::IndexStats PlanCache::GetStats(const std::string &index) {
+  std::lock_guard<std::mutex> guard(mu_);
+  auto iter = stats_.find(index);
+  return iter == stats_.end() ? IndexStats{} : iter->second;
+}
+
+}  // namespace kqir
@@ -0,0 +1,78 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "search/ir_plan.h"
+
+namespace kqir {
+
+// PlanCache keeps the plans of the recent searches, so a repeated query skips the semantic
+// checking and the optimization passes, and its plan is copied from the cache instead.
+//
+// The plan of a query depends on the values in it, e.g. the intervals are merged and the
+// cost of a scan is estimated by the statistics of the matched values, so the parameters
+// are a part of the key. The plans refer to the fields of the indexes, so the cache is
+// cleared when an index is created or dropped.
+class PlanCache {
+ public:
+  struct IndexStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+  };
+
+  PlanCache() = default;
+
+  PlanCache(const PlanCache &) = delete;
+  PlanCache &operator=(const PlanCache &) = delete;
+
+  // Get returns a copy of the plan of the key, or nullptr if it isn't cached.
+  // The hit or the miss is counted to the index, which is in the form of ComposeNamespaceKey(ns, index).
+  std::unique_ptr<PlanOperator> Get(const std::string &key, const std::string &index);
+  // Put keeps a copy of the plan, and evicts the least recently used plans beyond the capacity
+  void Put(const std::string &key, const PlanOperator &plan, size_t capacity);
+
+  // Clear removes all the plans, and the statistics of the index if it's given
+  void Clear(const std::string &index = "");
+  size_t Size();
+  IndexStats GetStats(const std::string &index);
+
+ private:
+  struct Entry {
+    std::string key;
+    std::unique_ptr<PlanOperator> plan;
+  };
+
+  std::mutex mu_;
+  // the most recently used plan is at the front
+  std::list<Entry> lru_;
+  std::unordered_map<std::string, std::list<Entry>::iterator> entries_;
+  std::map<std::string, IndexStats> stats_;
+};
+
+}  // namespace kqir
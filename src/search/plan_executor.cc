@@ -22,18 +22,22 @@
 
 #include <memory>
 
+#include "search/executors/aggregate_executor.h"
 #include "search/executors/filter_executor.h"
 #include "search/executors/full_index_scan_executor.h"
 #include "search/executors/hnsw_vector_field_knn_scan_executor.h"
 #include "search/executors/hnsw_vector_field_range_scan_executor.h"
+#include "search/executors/intersect_executor.h"
 #include "search/executors/limit_executor.h"
 #include "search/executors/merge_executor.h"
 #include "search/executors/mock_executor.h"
 #include "search/executors/noop_executor.h"
 #include "search/executors/numeric_field_scan_executor.h"
+#include "search/executors/profile_executor.h"
 #include "search/executors/projection_executor.h"
 #include "search/executors/sort_executor.h"
 #include "search/executors/tag_field_scan_executor.h"
+#include "search/executors/text_field_scan_executor.h"
 #include "search/executors/topn_sort_executor.h"
 #include "search/indexer.h"
 #include "search/ir_plan.h"
@@ -58,6 +62,10 @@ struct ExecutorContextVisitor {
       return Visit(v);
     }
 
+    if (auto v = dynamic_cast<Intersect *>(op)) {
+      return Visit(v);
+    }
+
     if (auto v = dynamic_cast<Sort *>(op)) {
       return Visit(v);
     }
@@ -86,6 +94,10 @@ struct ExecutorContextVisitor {
       return Visit(v);
     }
 
+    if (auto v = dynamic_cast<TextFieldScan *>(op)) {
+      return Visit(v);
+    }
+
     if (auto v = dynamic_cast<HnswVectorFieldKnnScan *>(op)) {
       return Visit(v);
     }
@@ -94,6 +106,10 @@ struct ExecutorContextVisitor {
       return Visit(v);
     }
 
+    if (auto v = dynamic_cast<Aggregate *>(op)) {
+      return Visit(v);
+    }
+
     if (auto v = dynamic_cast<Mock *>(op)) {
       return Visit(v);
     }
@@ -118,6 +134,9 @@ struct ExecutorContextVisitor {
     for (const auto &child : op->ops) Transform(child.get());
   }
 
+  // the scans of an intersection are read by the intersection itself
+  void Visit(Intersect *op) { ctx->nodes[op] = std::make_unique<IntersectExecutor>(ctx, op); }
+
   void Visit(Filter *op) {
     ctx->nodes[op] = std::make_unique<FilterExecutor>(ctx, op);
     Transform(op->source.get());
@@ -139,26 +158,104 @@ struct ExecutorContextVisitor {
 
   void Visit(TagFieldScan *op) { ctx->nodes[op] = std::make_unique<TagFieldScanExecutor>(ctx, op); }
 
-  void Visit(HnswVectorFieldKnnScan *op) { ctx->nodes[op] = std::make_unique<HnswVectorFieldKnnScanExecutor>(ctx, op); }
+  void Visit(TextFieldScan *op) { ctx->nodes[op] = std::make_unique<TextFieldScanExecutor>(ctx, op); }
+
+  void Visit(HnswVectorFieldKnnScan *op) {
+    ctx->nodes[op] = std::make_unique<HnswVectorFieldKnnScanExecutor>(ctx, op);
+    if (op->filter) Transform(op->filter.get());
+  }
 
   void Visit(HnswVectorFieldRangeScan *op) {
     ctx->nodes[op] = std::make_unique<HnswVectorFieldRangeScanExecutor>(ctx, op);
   }
 
+  void Visit(Aggregate *op) {
+    ctx->nodes[op] = std::make_unique<AggregateExecutor>(ctx, op);
+    Transform(op->source.get());
+  }
+
   void Visit(Mock *op) { ctx->nodes[op] = std::make_unique<MockExecutor>(ctx, op); }
 };
 
 }  // namespace details
 
-ExecutorContext::ExecutorContext(PlanOperator *op) : root(op), db_ctx(engine::Context::NoTransactionContext(nullptr)) {
-  details::ExecutorContextVisitor visitor{this};
-  visitor.Transform(root);
+ExecutorContext::ExecutorContext(PlanOperator *op, bool profile)
+    : root(op), db_ctx(engine::Context::NoTransactionContext(nullptr)) {
+  createExecutors(profile);
 }
 
-ExecutorContext::ExecutorContext(PlanOperator *op, engine::Storage *storage)
+ExecutorContext::ExecutorContext(PlanOperator *op, engine::Storage *storage, bool profile)
     : root(op), storage(storage), db_ctx(storage) {
+  createExecutors(profile);
+}
+
+void ExecutorContext::createExecutors(bool profile) {
   details::ExecutorContextVisitor visitor{this};
   visitor.Transform(root);
+
+  if (!profile) return;
+  for (auto &[op, node] : nodes) {
+    node = std::make_unique<ProfileExecutor>(this, std::move(node), &profiles[op]);
+  }
+}
+
+void ExecutorNode::RowBatch::Append(RowType row) {
+  for (auto &[field, value] : row.fields) {
+    auto &column = columns[field];
+    column.resize(keys.size());
+    column.push_back(std::move(value));
+  }
+
+  keys.push_back(std::move(row.key));
+  indexes.push_back(row.index);
+  for (auto &[_, column] : columns) column.resize(keys.size());
+}
+
+auto ExecutorNode::RowBatch::Row(size_t i) const -> RowType {
+  RowType row{keys[i], {}, indexes[i]};
+  for (const auto &[field, column] : columns) {
+    if (!column[i].IsNull()) row.fields.emplace(field, column[i]);
+  }
+
+  return row;
+}
+
+void ExecutorNode::RowBatch::Select(const Selection &selection) {
+  size_t n = 0;
+  for (size_t i = 0; i < keys.size(); i++) {
+    if (!selection[i]) continue;
+
+    if (n != i) {
+      keys[n] = std::move(keys[i]);
+      indexes[n] = indexes[i];
+      for (auto &[_, column] : columns) column[n] = std::move(column[i]);
+    }
+    n++;
+  }
+
+  keys.resize(n);
+  indexes.resize(n);
+  for (auto &[_, column] : columns) column.resize(n);
+}
+
+auto ExecutorNode::NextBatch() -> StatusOr<RowBatch> {
+  RowBatch batch;
+  while (batch.Size() < kBatchSize) {
+    auto v = GET_OR_RET(Next());
+    if (std::holds_alternative<End>(v)) break;
+
+    batch.Append(std::get<RowType>(std::move(v)));
+  }
+
+  return batch;
+}
+
+auto ExecutorContext::Retrieve(engine::Context &ctx, const KeyType &key, const FieldInfo *field) const
+    -> StatusOr<ValueType> {  // NOLINT
+  auto retriever = GET_OR_RET(
+      redis::FieldValueRetriever::Create(field->index->metadata.on_data_type, key, storage, field->index->ns));
+
+  return retriever.Retrieve(ctx, field->name, field->metadata.get());
 }
 
 auto ExecutorContext::Retrieve(engine::Context &ctx, RowType &row, const FieldInfo *field) const
@@ -167,14 +264,25 @@ auto ExecutorContext::Retrieve(engine::Context &ctx, RowType &row, const FieldIn
     return iter->second;
   }
 
-  auto retriever = GET_OR_RET(
-      redis::FieldValueRetriever::Create(field->index->metadata.on_data_type, row.key, storage, field->index->ns));
-
-  auto s = retriever.Retrieve(ctx, field->name, field->metadata.get());
+  auto s = Retrieve(ctx, row.key, field);
   if (!s) return s;
 
   row.fields.emplace(field, *s);
   return *s;
 }
 
+Status ExecutorContext::RetrieveColumn(engine::Context &ctx, RowBatch &batch, const FieldInfo *field,
+                                       const RowBatch::Selection *selection) const {
+  auto &column = batch.columns[field];
+  column.resize(batch.Size());
+
+  for (size_t i = 0; i < batch.Size(); i++) {
+    if ((selection && !(*selection)[i]) || !column[i].IsNull()) continue;
+
+    column[i] = GET_OR_RET(Retrieve(ctx, batch.keys[i], field));
+  }
+
+  return Status::OK();
+}
+
 }  // namespace kqir
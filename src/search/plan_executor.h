@@ -20,7 +20,9 @@
 
 #pragma once
 
+#include <map>
 #include <variant>
+#include <vector>
 
 #include "ir_plan.h"
 #include "search/index_info.h"
@@ -66,26 +68,71 @@ struct ExecutorNode {
 
   using Result = std::variant<End, RowType>;
 
+  // RowBatch is a batch of rows in columns, i.e. the keys and the indexes of the rows,
+  // and a column of values for each field retrieved for any of the rows.
+  // A value in a column is null if it isn't retrieved for the row yet.
+  struct RowBatch {
+    // a flag for each row of a batch, e.g. whether the row matches a filter
+    using Selection = std::vector<char>;
+
+    std::vector<KeyType> keys;
+    std::vector<const IndexInfo *> indexes;
+    std::map<const FieldInfo *, std::vector<ValueType>> columns;
+
+    size_t Size() const { return keys.size(); }
+    bool Empty() const { return keys.empty(); }
+
+    void Append(RowType row);
+    RowType Row(size_t i) const;
+    // Select keeps the rows with a non-zero flag in order
+    void Select(const Selection &selection);
+  };
+
+  // the max number of rows in a batch
+  static constexpr size_t kBatchSize = 2048;
+
   ExecutorContext *ctx;
   explicit ExecutorNode(ExecutorContext *ctx) : ctx(ctx) {}
 
   virtual StatusOr<Result> Next() = 0;
+  // NextBatch returns an empty batch at the end. An executor is read either row by row or
+  // batch by batch, the default one collects the rows of Next, and the executors which can
+  // process a batch as a whole override it and read their sources by batches as well.
+  virtual StatusOr<RowBatch> NextBatch();
   virtual ~ExecutorNode() = default;
 };
 
+// ExecutorProfile is the counters of an executor collected by FT.PROFILE, the time and the reads of an executor
+// include the ones of the executors it reads from
+struct ExecutorProfile {
+  // the calls of Next and NextBatch
+  uint64_t calls = 0;
+  uint64_t rows = 0;
+  uint64_t time_us = 0;
+  // the internal keys stepped over by the iterators of RocksDB
+  uint64_t keys_scanned = 0;
+  // the bytes of the keys and values read from RocksDB
+  uint64_t read_bytes = 0;
+  uint64_t block_reads = 0;
+};
+
 struct ExecutorContext {
   std::map<PlanOperator *, std::unique_ptr<ExecutorNode>> nodes;
+  // the profiles of the executors, if they're profiled
+  std::map<PlanOperator *, ExecutorProfile> profiles;
   PlanOperator *root;
   engine::Storage *storage;
   engine::Context db_ctx;
 
   using Result = ExecutorNode::Result;
   using RowType = ExecutorNode::RowType;
+  using RowBatch = ExecutorNode::RowBatch;
   using KeyType = ExecutorNode::KeyType;
   using ValueType = ExecutorNode::ValueType;
 
-  explicit ExecutorContext(PlanOperator *op);
-  explicit ExecutorContext(PlanOperator *op, engine::Storage *storage);
+  // The executors are wrapped to collect their profiles if profile is true
+  explicit ExecutorContext(PlanOperator *op, bool profile = false);
+  explicit ExecutorContext(PlanOperator *op, engine::Storage *storage, bool profile = false);
 
   ExecutorNode *Get(PlanOperator *op) {
     if (auto iter = nodes.find(op); iter != nodes.end()) {
@@ -97,8 +144,26 @@ struct ExecutorContext {
 
   ExecutorNode *Get(const std::unique_ptr<PlanOperator> &op) { return Get(op.get()); }
 
+  const ExecutorProfile *GetProfile(PlanOperator *op) const {
+    if (auto iter = profiles.find(op); iter != profiles.end()) {
+      return &iter->second;
+    }
+
+    return nullptr;
+  }
+
   StatusOr<Result> Next() { return Get(root)->Next(); }
+  StatusOr<RowBatch> NextBatch() { return Get(root)->NextBatch(); }
+
+  StatusOr<ValueType> Retrieve(engine::Context &ctx, const KeyType &key, const FieldInfo *field) const;
   StatusOr<ValueType> Retrieve(engine::Context &ctx, RowType &row, const FieldInfo *field) const;
+  // RetrieveColumn fills the column of the field for the rows which are selected, or all the rows
+  // if selection is null, and whose values aren't retrieved yet
+  Status RetrieveColumn(engine::Context &ctx, RowBatch &batch, const FieldInfo *field,
+                        const RowBatch::Selection *selection = nullptr) const;
+
+ private:
+  void createExecutors(bool profile);
 };
 
 }  // namespace kqir
@@ -32,6 +32,7 @@ using namespace peg;
 
 struct VectorRangeToken : string<'V', 'E', 'C', 'T', 'O', 'R', '_', 'R', 'A', 'N', 'G', 'E'> {};
 struct KnnToken : string<'K', 'N', 'N'> {};
+struct EfRuntimeToken : string<'E', 'F', '_', 'R', 'U', 'N', 'T', 'I', 'M', 'E'> {};
 struct ArrowOp : string<'=', '>'> {};
 struct Wildcard : one<'*'> {};
 
@@ -42,6 +43,9 @@ struct Param : seq<one<'$'>, Identifier> {};
 struct Tag : sor<Identifier, StringL, Param> {};
 struct TagList : seq<one<'{'>, WSPad<Tag>, star<seq<one<'|'>, WSPad<Tag>>>, one<'}'>> {};
 
+struct Word : plus<sor<alnum, one<'_'>, utf8::range<0x80, 0x10FFFF>>> {};
+struct TermList : seq<one<'('>, plus<WSPad<sor<Word, Param>>>, one<')'>> {};
+
 struct NumberOrParam : sor<Number, Param> {};
 struct UintOrParam : sor<UnsignedInteger, Param> {};
 
@@ -50,10 +54,13 @@ struct ExclusiveNumber : seq<one<'('>, NumberOrParam> {};
 struct NumericRangePart : sor<Inf, ExclusiveNumber, NumberOrParam> {};
 struct NumericRange : seq<one<'['>, WSPad<NumericRangePart>, WSPad<NumericRangePart>, one<']'>> {};
 
-struct KnnSearch : seq<one<'['>, WSPad<KnnToken>, WSPad<UintOrParam>, WSPad<Field>, WSPad<Param>, one<']'>> {};
+struct KnnAttribute : seq<WSPad<EfRuntimeToken>, WSPad<UintOrParam>> {};
+struct KnnSearch
+    : seq<one<'['>, WSPad<KnnToken>, WSPad<UintOrParam>, WSPad<Field>, WSPad<Param>, opt<KnnAttribute>, one<']'>> {};
 struct VectorRange : seq<one<'['>, WSPad<VectorRangeToken>, WSPad<NumberOrParam>, WSPad<Param>, one<']'>> {};
 
-struct FieldQuery : seq<WSPad<Field>, one<':'>, WSPad<sor<VectorRange, TagList, NumericRange>>> {};
+struct FieldQuery
+    : seq<WSPad<Field>, one<':'>, WSPad<sor<VectorRange, TagList, NumericRange, TermList, StringL, Param, Word>>> {};
 
 struct QueryExpr;
 
@@ -71,7 +78,8 @@ struct AndExprP : sor<AndExpr, BooleanExpr> {};
 struct OrExpr : seq<AndExprP, plus<seq<one<'|'>, AndExprP>>> {};
 struct OrExprP : sor<OrExpr, AndExprP> {};
 
-struct PrefilterExpr : seq<WSPad<Wildcard>, ArrowOp, WSPad<KnnSearch>> {};
+// the KNN search is run on the documents matching the filter on the left, `*` for all the documents
+struct PrefilterExpr : seq<OrExprP, ArrowOp, WSPad<KnnSearch>> {};
 
 struct QueryP : sor<PrefilterExpr, OrExprP> {};
 
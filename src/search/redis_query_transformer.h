@@ -36,9 +36,10 @@ namespace ir = kqir;
 
 template <typename Rule>
 using TreeSelector = parse_tree::selector<
-    Rule, parse_tree::store_content::on<Number, UnsignedInteger, StringL, Param, Identifier, Inf>,
-    parse_tree::remove_content::on<TagList, NumericRange, VectorRange, ExclusiveNumber, FieldQuery, NotExpr, AndExpr,
-                                   OrExpr, PrefilterExpr, KnnSearch, Wildcard, VectorRangeToken, KnnToken, ArrowOp>>;
+    Rule, parse_tree::store_content::on<Number, UnsignedInteger, StringL, Param, Identifier, Inf, Word>,
+    parse_tree::remove_content::on<TagList, TermList, NumericRange, VectorRange, ExclusiveNumber, FieldQuery, NotExpr,
+                                   AndExpr, OrExpr, PrefilterExpr, KnnSearch, Wildcard, VectorRangeToken, KnnToken,
+                                   ArrowOp, EfRuntimeToken>>;
 
 template <typename Input>
 StatusOr<std::unique_ptr<parse_tree::node>> ParseToTree(Input&& in) {
@@ -55,12 +56,19 @@ struct Transformer : ir::TreeTransformer {
 
   StatusOr<std::unique_ptr<VectorLiteral>> Transform2Vector(const TreeNode& node) {
     std::string vector_str = GET_OR_RET(GetParam(node));
-
-    std::vector<double> values = GET_OR_RET(Binary2Vector<double>(vector_str));
-    if (values.empty()) {
+    if (vector_str.empty()) {
       return {Status::NotOK, "empty vector is invalid"};
     }
-    return std::make_unique<ir::VectorLiteral>(std::move(values));
+
+    // a blob of FLOAT32 elements may not be a multiple of the FLOAT64 size,
+    // the semantic checker reports the size mismatch against the field instead
+    std::vector<double> values;
+    if (vector_str.size() % sizeof(double) == 0) {
+      values = GET_OR_RET(Binary2Vector<double>(vector_str));
+    } else if (vector_str.size() % sizeof(float) != 0) {
+      return {Status::NotOK, "data size is not a multiple of the target type size"};
+    }
+    return std::make_unique<ir::VectorLiteral>(std::move(values), std::move(vector_str));
   };
 
   auto Transform(const TreeNode& node) -> StatusOr<std::unique_ptr<Node>> {
@@ -155,27 +163,63 @@ struct Transformer : ir::TreeTransformer {
         return std::make_unique<VectorRangeExpr>(std::make_unique<FieldRef>(field),
                                                  GET_OR_RET(number_or_param(query->children[1])),
                                                  GET_OR_RET(Transform2Vector(query->children[2])));
+      } else if (Is<TermList>(query)) {
+        std::vector<std::string> words;
+        for (const auto& word : query->children) {
+          if (Is<Param>(word)) {
+            words.push_back(GET_OR_RET(GetParam(word)));
+          } else {
+            words.push_back(word->string());
+          }
+        }
+
+        auto text = util::StringJoin(words, [](const auto& v) -> decltype(auto) { return v; }, " ");
+        return std::make_unique<TextMatchExpr>(std::make_unique<FieldRef>(field),
+                                               std::make_unique<StringLiteral>(std::move(text)));
+      } else if (Is<StringL>(query)) {
+        auto phrase = GET_OR_RET(UnescapeString(query->string()));
+        return std::make_unique<TextMatchExpr>(std::make_unique<FieldRef>(field),
+                                               std::make_unique<StringLiteral>(std::move(phrase)), true);
+      } else if (Is<Param>(query)) {
+        return std::make_unique<TextMatchExpr>(std::make_unique<FieldRef>(field),
+                                               std::make_unique<StringLiteral>(GET_OR_RET(GetParam(query))));
+      } else if (Is<Word>(query)) {
+        return std::make_unique<TextMatchExpr>(std::make_unique<FieldRef>(field),
+                                               std::make_unique<StringLiteral>(query->string()));
       }
     } else if (Is<NotExpr>(node)) {
       CHECK(node->children.size() == 1);
 
       return Node::Create<ir::NotExpr>(Node::MustAs<ir::QueryExpr>(GET_OR_RET(Transform(node->children[0]))));
     } else if (Is<PrefilterExpr>(node)) {
-      // TODO: allow hybrid query
       CHECK(node->children.size() == 3);
 
       const auto& knn_search = node->children[2];
-      CHECK(knn_search->children.size() == 4);
+      CHECK(knn_search->children.size() == 4 || knn_search->children.size() == 6);
 
-      size_t k = 0;
-      if (Is<UnsignedInteger>(knn_search->children[1])) {
-        k = *ParseInt(knn_search->children[1]->string());
-      } else {
-        k = *ParseInt(GET_OR_RET(GetParam(node)));
+      auto uint_or_param = [this](const auto& child) -> StatusOr<size_t> {
+        if (Is<UnsignedInteger>(child)) {
+          return *ParseInt(child->string());
+        }
+        return ParseInt<size_t>(GET_OR_RET(GetParam(child)))
+            .Prefixed(fmt::format("parameter {} is not an unsigned integer", child->string_view()));
+      };
+
+      size_t k = GET_OR_RET(uint_or_param(knn_search->children[1]));
+      uint32_t ef_runtime = 0;
+      if (knn_search->children.size() == 6) {
+        ef_runtime = GET_OR_RET(uint_or_param(knn_search->children[5]));
+      }
+
+      // the wildcard filter matches all the documents, so it's the same as no filter
+      std::unique_ptr<ir::QueryExpr> filter;
+      if (!Is<Wildcard>(node->children[0])) {
+        filter = Node::MustAs<ir::QueryExpr>(GET_OR_RET(Transform(node->children[0])));
       }
 
       return std::make_unique<VectorKnnExpr>(std::make_unique<FieldRef>(knn_search->children[2]->string()),
-                                             GET_OR_RET(Transform2Vector(knn_search->children[3])), k);
+                                             GET_OR_RET(Transform2Vector(knn_search->children[3])), k, ef_runtime,
+                                             std::move(filter));
     } else if (Is<AndExpr>(node)) {
       std::vector<std::unique_ptr<ir::QueryExpr>> exprs;
 
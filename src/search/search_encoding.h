@@ -23,7 +23,13 @@
 #include <encoding.h>
 #include <storage/redis_metadata.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <memory>
+#include <utility>
+
+#include "search/vector_distance.h"
 
 namespace redis {
 
@@ -71,6 +77,15 @@ enum class SearchSubkeyType : uint8_t {
 
   // field alias
   FIELD_ALIAS = 4,
+
+  // progress of the background build of the index, it's removed once the build completes
+  BUILD_PROGRESS = 5,
+
+  // the writes to the indexed keys waiting to be applied to the index, see IndexDeltaApplier
+  INDEX_DELTA = 6,
+
+  // statistics of the values of a field, see FieldStats
+  FIELD_STATS = 7,
 };
 
 enum class IndexFieldType : uint8_t {
@@ -79,10 +94,25 @@ enum class IndexFieldType : uint8_t {
   NUMERIC = 2,
 
   VECTOR = 3,
+
+  TEXT = 4,
 };
 
 enum class VectorType : uint8_t {
   FLOAT64 = 1,
+  FLOAT32 = 2,
+};
+
+inline size_t VectorElementSize(VectorType type) {
+  return type == VectorType::FLOAT32 ? sizeof(float) : sizeof(double);
+}
+
+// The vectors of a quantized field are stored as compact codes in the HNSW nodes for the traversal,
+// and the full vectors are stored aside to re-rank the final candidates
+enum class VectorQuantization : uint8_t {
+  NONE = 0,
+  // one byte per element, scaled between the min and the max element of the vector
+  SQ8 = 1,
 };
 
 enum class DistanceMetric : uint8_t {
@@ -94,6 +124,8 @@ enum class DistanceMetric : uint8_t {
 enum class HnswLevelType : uint8_t {
   NODE = 1,
   EDGE = 2,
+  // the full vector of a node of a quantized field, it's only in level 0
+  VECTOR = 3,
 };
 
 struct SearchKey {
@@ -115,11 +147,15 @@ struct SearchKey {
 
   static void PutHnswLevelType(std::string *dst, HnswLevelType type) { PutFixed8(dst, uint8_t(type)); }
 
-  void PutHnswLevelPrefix(std::string *dst, uint16_t level) const {
+  void PutHnswFieldPrefix(std::string *dst) const {
     PutNamespace(dst);
     PutType(dst, SearchSubkeyType::FIELD);
     PutIndex(dst);
     PutSizedString(dst, field);
+  }
+
+  void PutHnswLevelPrefix(std::string *dst, uint16_t level) const {
+    PutHnswFieldPrefix(dst);
     PutFixed16(dst, level);
   }
 
@@ -149,6 +185,42 @@ struct SearchKey {
     return dst;
   }
 
+  std::string ConstructIndexBuildProgress() const {
+    std::string dst;
+    PutNamespace(&dst);
+    PutType(&dst, SearchSubkeyType::BUILD_PROGRESS);
+    PutIndex(&dst);
+    return dst;
+  }
+
+  std::string ConstructIndexDeltaPrefix() const {
+    std::string dst;
+    PutNamespace(&dst);
+    PutType(&dst, SearchSubkeyType::INDEX_DELTA);
+    PutIndex(&dst);
+    return dst;
+  }
+
+  std::string ConstructIndexDelta(uint64_t seq) const {
+    std::string dst = ConstructIndexDeltaPrefix();
+    PutFixed64(&dst, seq);
+    return dst;
+  }
+
+  std::string ConstructAllFieldStatsPrefix() const {
+    std::string dst;
+    PutNamespace(&dst);
+    PutType(&dst, SearchSubkeyType::FIELD_STATS);
+    PutIndex(&dst);
+    return dst;
+  }
+
+  std::string ConstructFieldStats() const {
+    std::string dst = ConstructAllFieldStatsPrefix();
+    PutSizedString(&dst, field);
+    return dst;
+  }
+
   std::string ConstructFieldMeta() const {
     std::string dst;
     PutNamespace(&dst);
@@ -194,28 +266,66 @@ struct SearchKey {
     return dst;
   }
 
-  std::string ConstructTagFieldData(std::string_view tag, std::string_view key) const {
+  // The keys with a tag or a numeric value are under its prefix in the order of the sized keys
+  std::string ConstructTagFieldPrefix(std::string_view tag) const {
     std::string dst;
     PutNamespace(&dst);
     PutType(&dst, SearchSubkeyType::FIELD);
     PutIndex(&dst);
     PutSizedString(&dst, field);
     PutSizedString(&dst, tag);
+    return dst;
+  }
+
+  std::string ConstructTagFieldData(std::string_view tag, std::string_view key) const {
+    std::string dst = ConstructTagFieldPrefix(tag);
     PutSizedString(&dst, key);
     return dst;
   }
 
-  std::string ConstructNumericFieldData(double num, std::string_view key) const {
+  std::string ConstructNumericFieldPrefix(double num) const {
     std::string dst;
     PutNamespace(&dst);
     PutType(&dst, SearchSubkeyType::FIELD);
     PutIndex(&dst);
     PutSizedString(&dst, field);
     PutDouble(&dst, num);
+    return dst;
+  }
+
+  std::string ConstructNumericFieldData(double num, std::string_view key) const {
+    std::string dst = ConstructNumericFieldPrefix(num);
     PutSizedString(&dst, key);
     return dst;
   }
 
+  // The postings of a term are split into blocks, each under the key of its first posting,
+  // after the term header which counts the documents with the term, see TextIndex
+  std::string ConstructTextTermPrefix(std::string_view term) const {
+    std::string dst;
+    PutNamespace(&dst);
+    PutType(&dst, SearchSubkeyType::FIELD);
+    PutIndex(&dst);
+    PutSizedString(&dst, field);
+    PutSizedString(&dst, term);
+    return dst;
+  }
+
+  std::string ConstructTextPostingBlock(std::string_view term, std::string_view first_key) const {
+    std::string dst = ConstructTextTermPrefix(term);
+    dst.append(first_key);
+    return dst;
+  }
+
+  // the tokens are never empty, so the empty term holds the statistics of the field
+  std::string ConstructTextFieldHeader() const { return ConstructTextTermPrefix({}); }
+
+  std::string ConstructHnswFieldPrefix() const {
+    std::string dst;
+    PutHnswFieldPrefix(&dst);
+    return dst;
+  }
+
   std::string ConstructHnswLevelNodePrefix(uint16_t level) const {
     std::string dst;
     PutHnswLevelNodePrefix(&dst, level);
@@ -229,6 +339,20 @@ struct SearchKey {
     return dst;
   }
 
+  std::string ConstructHnswVector(std::string_view key) const {
+    std::string dst;
+    PutHnswLevelPrefix(&dst, 0);
+    PutHnswLevelType(&dst, HnswLevelType::VECTOR);
+    PutSizedString(&dst, key);
+    return dst;
+  }
+
+  std::string ConstructHnswLevelEdgePrefix(uint16_t level) const {
+    std::string dst;
+    PutHnswLevelEdgePrefix(&dst, level);
+    return dst;
+  }
+
   std::string ConstructHnswEdgeWithSingleEnd(uint16_t level, std::string_view key) const {
     std::string dst;
     PutHnswLevelEdgePrefix(&dst, level);
@@ -278,6 +402,32 @@ struct IndexPrefixes {
   }
 };
 
+// IndexBuildProgress is the position of the background build, i.e. all keys under the prefixes
+// before prefix_index and the keys up to last_key under the prefix at prefix_index are indexed
+struct IndexBuildProgress {
+  uint32_t prefix_index = 0;
+  // the last indexed namespace key of the metadata column family, empty if none of this prefix
+  std::string last_key;
+  uint64_t indexed_keys = 0;
+
+  void Encode(std::string *dst) const {
+    PutFixed32(dst, prefix_index);
+    PutSizedString(dst, last_key);
+    PutFixed64(dst, indexed_keys);
+  }
+
+  rocksdb::Status Decode(Slice *input) {
+    Slice last_key_slice;
+    if (!GetFixed32(input, &prefix_index) || !GetSizedString(input, &last_key_slice) ||
+        !GetFixed64(input, &indexed_keys)) {
+      return rocksdb::Status::Corruption(kErrorInsufficientLength);
+    }
+    last_key = last_key_slice.ToString();
+
+    return rocksdb::Status::OK();
+  }
+};
+
 struct IndexFieldMetadata {
   bool noindex = false;
   IndexFieldType type;
@@ -304,6 +454,8 @@ struct IndexFieldMetadata {
         return "numeric";
       case IndexFieldType::VECTOR:
         return "vector";
+      case IndexFieldType::TEXT:
+        return "text";
       default:
         return "unknown";
     }
@@ -359,6 +511,30 @@ struct NumericFieldMetadata : IndexFieldMetadata {
   bool IsSortable() const override { return true; }
 };
 
+struct TextFieldMetadata : IndexFieldMetadata {
+  bool nostem = false;
+
+  TextFieldMetadata() : IndexFieldMetadata(IndexFieldType::TEXT) {}
+
+  void Encode(std::string *dst) const override {
+    IndexFieldMetadata::Encode(dst);
+    PutFixed8(dst, nostem);
+  }
+
+  rocksdb::Status Decode(Slice *input) override {
+    if (auto s = IndexFieldMetadata::Decode(input); !s.ok()) {
+      return s;
+    }
+
+    if (input->size() < 1) {
+      return rocksdb::Status::Corruption(kErrorInsufficientLength);
+    }
+
+    GetFixed8(input, (uint8_t *)&nostem);
+    return rocksdb::Status::OK();
+  }
+};
+
 struct HnswVectorFieldMetadata : IndexFieldMetadata {
   VectorType vector_type;
   uint16_t dim;
@@ -371,6 +547,9 @@ struct HnswVectorFieldMetadata : IndexFieldMetadata {
   double epsilon = 0.01;           // Relative factor setting search boundaries in range queries
   uint16_t num_levels = 0;         // Number of levels in the HNSW graph
 
+  // How the vectors are stored in the nodes of the graph
+  VectorQuantization quantization = VectorQuantization::NONE;
+
   HnswVectorFieldMetadata() : IndexFieldMetadata(IndexFieldType::VECTOR) {}
 
   bool IsSortable() const override { return true; }
@@ -386,6 +565,7 @@ struct HnswVectorFieldMetadata : IndexFieldMetadata {
     PutFixed32(dst, ef_runtime);
     PutDouble(dst, epsilon);
     PutFixed16(dst, num_levels);
+    PutFixed8(dst, uint8_t(quantization));
   }
 
   rocksdb::Status Decode(Slice *input) override {
@@ -410,6 +590,12 @@ struct HnswVectorFieldMetadata : IndexFieldMetadata {
     GetFixed32(input, &ef_runtime);
     GetDouble(input, &epsilon);
     GetFixed16(input, &num_levels);
+
+    // the quantization is absent in the fields created by older versions
+    quantization = VectorQuantization::NONE;
+    if (!input->empty()) {
+      GetFixed8(input, (uint8_t *)(&quantization));
+    }
     return rocksdb::Status::OK();
   }
 };
@@ -417,16 +603,58 @@ struct HnswVectorFieldMetadata : IndexFieldMetadata {
 struct HnswNodeFieldMetadata {
   uint16_t num_neighbours;
   std::vector<double> vector;
+  // the type the elements are stored as, they're always decoded into doubles
+  VectorType vector_type = VectorType::FLOAT64;
+  // the elements are stored as SQ8 codes instead, and decoded into their approximations
+  VectorQuantization quantization = VectorQuantization::NONE;
+  // the L2 norm of the vector, it's stored so COSINE distances don't recompute it; negative if unknown
+  double norm = -1;
 
-  HnswNodeFieldMetadata() = default;
-  HnswNodeFieldMetadata(uint16_t num_neighbours, std::vector<double> vector)
-      : num_neighbours(num_neighbours), vector(std::move(vector)) {}
+  // the high bit of the stored type marks the SQ8 codes
+  static constexpr uint8_t kSQ8Flag = 0x80;
 
+  HnswNodeFieldMetadata() = default;
+  HnswNodeFieldMetadata(uint16_t num_neighbours, std::vector<double> vector,
+                        VectorType vector_type = VectorType::FLOAT64,
+                        VectorQuantization quantization = VectorQuantization::NONE)
+      : num_neighbours(num_neighbours),
+        vector(std::move(vector)),
+        vector_type(vector_type),
+        quantization(quantization) {}
+
+  // the legacy encoding is `num_neighbours | dim | FLOAT64 elements`,
+  // a zero dim is followed by `vector_type | dim | norm | elements` instead,
+  // where the SQ8 elements are `min | step | codes` and approximate `min + code * step`
   void Encode(std::string *dst) const {
     PutFixed16(dst, num_neighbours);
+    PutFixed16(dst, 0);
+    bool sq8 = quantization == VectorQuantization::SQ8;
+    PutFixed8(dst, static_cast<uint8_t>(uint8_t(vector_type) | (sq8 ? kSQ8Flag : 0)));
     PutFixed16(dst, static_cast<uint16_t>(vector.size()));
+    PutDouble(dst, norm >= 0 ? norm : VectorNorm(vector.data(), vector.size()));
+
+    if (sq8) {
+      auto [min, max] = vector.empty() ? std::make_pair(0.0, 0.0)
+                                       : std::make_pair(*std::min_element(vector.begin(), vector.end()),
+                                                        *std::max_element(vector.begin(), vector.end()));
+      double step = (max - min) / 255;
+      PutDouble(dst, min);
+      PutDouble(dst, step);
+      for (double element : vector) {
+        PutFixed8(dst, step > 0 ? static_cast<uint8_t>(std::lround((element - min) / step)) : 0);
+      }
+      return;
+    }
+
     for (double element : vector) {
-      PutDouble(dst, element);
+      if (vector_type == VectorType::FLOAT32) {
+        auto element32 = static_cast<float>(element);
+        uint32_t bits = 0;
+        memcpy(&bits, &element32, sizeof(bits));
+        PutFixed32(dst, bits);
+      } else {
+        PutDouble(dst, element);
+      }
     }
   }
 
@@ -439,14 +667,49 @@ struct HnswNodeFieldMetadata {
     uint16_t dim = 0;
     GetFixed16(input, (uint16_t *)(&dim));
 
-    if (input->size() != dim * sizeof(double)) {
+    vector_type = VectorType::FLOAT64;
+    quantization = VectorQuantization::NONE;
+    norm = -1;
+    if (dim == 0 && !input->empty()) {
+      if (input->size() < 1 + 2 + sizeof(double)) {
+        return rocksdb::Status::Corruption(kErrorInsufficientLength);
+      }
+      uint8_t type = 0;
+      GetFixed8(input, &type);
+      vector_type = VectorType(type & ~kSQ8Flag);
+      if (type & kSQ8Flag) quantization = VectorQuantization::SQ8;
+      GetFixed16(input, &dim);
+      GetDouble(input, &norm);
+    }
+
+    if (quantization == VectorQuantization::SQ8) {
+      if (input->size() != 2 * sizeof(double) + dim) {
+        return rocksdb::Status::Corruption(kErrorIncorrectLength);
+      }
+      double min = 0, step = 0;
+      GetDouble(input, &min);
+      GetDouble(input, &step);
+      vector.resize(dim);
+      for (auto i = 0; i < dim; ++i) {
+        uint8_t code = 0;
+        GetFixed8(input, &code);
+        vector[i] = min + code * step;
+      }
+      return rocksdb::Status::OK();
+    }
+
+    if (input->size() != dim * VectorElementSize(vector_type)) {
       return rocksdb::Status::Corruption(kErrorIncorrectLength);
     }
     vector.resize(dim);
 
-    for (auto i = 0; i < dim; ++i) {
-      GetDouble(input, &vector[i]);
+    // the elements are decoded in bulk, since the nodes are decoded for each distance during the search
+    if (vector_type == VectorType::FLOAT32) {
+      DecodeFloatArray(input->data(), vector.data(), dim);
+    } else {
+      DecodeDoubleArray(input->data(), vector.data(), dim);
     }
+    input->remove_prefix(input->size());
     return rocksdb::Status::OK();
   }
 };
@@ -466,6 +729,9 @@ inline rocksdb::Status IndexFieldMetadata::Decode(Slice *input, std::unique_ptr<
     case IndexFieldType::VECTOR:
       ptr = std::make_unique<HnswVectorFieldMetadata>();
       break;
+    case IndexFieldType::TEXT:
+      ptr = std::make_unique<TextFieldMetadata>();
+      break;
     default:
       return rocksdb::Status::Corruption("encountered unknown field type");
   }
@@ -37,6 +37,11 @@ struct NumberOrParam : sor<Number, Param> {};
 struct HasTag : string<'h', 'a', 's', 't', 'a', 'g'> {};
 struct HasTagExpr : WSPad<seq<Identifier, WSPad<HasTag>, StringOrParam>> {};
 
+struct Match : string<'m', 'a', 't', 'c', 'h'> {};
+struct MatchPhrase : seq<Match, string<'p', 'h', 'r', 'a', 's', 'e'>> {};
+struct TextMatchOp : sor<MatchPhrase, Match> {};
+struct TextMatchExpr : WSPad<seq<Identifier, WSPad<TextMatchOp>, StringOrParam>> {};
+
 struct NumericAtomExpr : WSPad<sor<NumberOrParam, Identifier>> {};
 struct NumericCompareOp : sor<string<'!', '='>, string<'<', '='>, string<'>', '='>, one<'=', '<', '>'>> {};
 struct NumericCompareExpr : seq<NumericAtomExpr, NumericCompareOp, NumericAtomExpr> {};
@@ -46,7 +51,7 @@ struct VectorLiteral : seq<WSPad<one<'['>>, Number, star<seq<WSPad<one<','>>>, N
 struct VectorCompareExpr : seq<WSPad<Identifier>, VectorCompareOp, WSPad<VectorLiteral>> {};
 struct VectorRangeExpr : seq<VectorCompareExpr, one<'<'>, WSPad<NumberOrParam>> {};
 
-struct BooleanAtomExpr : sor<HasTagExpr, NumericCompareExpr, VectorRangeExpr, WSPad<Boolean>> {};
+struct BooleanAtomExpr : sor<HasTagExpr, TextMatchExpr, NumericCompareExpr, VectorRangeExpr, WSPad<Boolean>> {};
 
 struct QueryExpr;
 
@@ -39,11 +39,11 @@ namespace ir = kqir;
 template <typename Rule>
 using TreeSelector = parse_tree::selector<
     Rule,
-    parse_tree::store_content::on<Boolean, Number, StringL, Param, Identifier, NumericCompareOp, AscOrDesc,
-                                  UnsignedInteger>,
-    parse_tree::remove_content::on<HasTagExpr, NumericCompareExpr, VectorCompareOp, VectorLiteral, VectorCompareExpr,
-                                   VectorRangeExpr, NotExpr, AndExpr, OrExpr, Wildcard, SelectExpr, FromExpr,
-                                   WhereClause, OrderByClause, OrderByExpr, LimitClause, SearchStmt>>;
+    parse_tree::store_content::on<Boolean, Number, StringL, Param, Identifier, NumericCompareOp, TextMatchOp,
+                                  AscOrDesc, UnsignedInteger>,
+    parse_tree::remove_content::on<HasTagExpr, TextMatchExpr, NumericCompareExpr, VectorCompareOp, VectorLiteral,
+                                   VectorCompareExpr, VectorRangeExpr, NotExpr, AndExpr, OrExpr, Wildcard, SelectExpr,
+                                   FromExpr, WhereClause, OrderByClause, OrderByExpr, LimitClause, SearchStmt>>;
 
 template <typename Input>
 StatusOr<std::unique_ptr<parse_tree::node>> ParseToTree(Input&& in) {
@@ -100,6 +100,21 @@ struct Transformer : ir::TreeTransformer {
 
       return Node::Create<ir::TagContainExpr>(std::make_unique<ir::FieldRef>(node->children[0]->string()),
                                               std::move(res));
+    } else if (Is<TextMatchExpr>(node)) {
+      CHECK(node->children.size() == 3);
+
+      const auto& query = node->children[2];
+      std::unique_ptr<ir::StringLiteral> res;
+      if (Is<StringL>(query)) {
+        res = Node::MustAs<ir::StringLiteral>(GET_OR_RET(Transform(query)));
+      } else if (Is<Param>(query)) {
+        res = std::make_unique<ir::StringLiteral>(GET_OR_RET(GetParam(query)));
+      } else {
+        return {Status::NotOK, "encountered invalid text query"};
+      }
+
+      return Node::Create<ir::TextMatchExpr>(std::make_unique<ir::FieldRef>(node->children[0]->string()),
+                                             std::move(res), node->children[1]->string_view() == "matchphrase");
     } else if (Is<NumericCompareExpr>(node)) {
       CHECK(node->children.size() == 3);
 
@@ -0,0 +1,132 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "text_analyzer.h"
+
+#include <algorithm>
+#include <map>
+
+namespace redis {
+
+namespace {
+
+bool IsVowel(char c) { return c == 'a' || c == 'e' || c == 'i' || c == 'o' || c == 'u'; }
+
+bool HasVowel(std::string_view word) { return std::any_of(word.begin(), word.end(), IsVowel); }
+
+bool EndsWith(std::string_view word, std::string_view suffix) {
+  return word.size() >= suffix.size() && word.substr(word.size() - suffix.size()) == suffix;
+}
+
+// Undouble removes the doubled consonant left by stripping a suffix, e.g. "running" -> "runn" -> "run"
+void Undouble(std::string *word) {
+  auto n = word->size();
+  if (n < 2) return;
+
+  char c = (*word)[n - 1];
+  if (c == (*word)[n - 2] && !IsVowel(c) && c != 'l' && c != 's' && c != 'z') word->pop_back();
+}
+
+}  // namespace
+
+std::vector<std::string> TokenizeText(std::string_view text, bool stem) {
+  std::vector<std::string> tokens;
+  std::string word;
+
+  auto flush = [&tokens, &word, stem] {
+    if (word.empty()) return;
+    tokens.push_back(stem ? StemWord(std::move(word)) : std::move(word));
+    word.clear();
+  };
+
+  for (char c : text) {
+    auto u = static_cast<unsigned char>(c);
+    if ((u >= 'a' && u <= 'z') || (u >= '0' && u <= '9') || u >= 0x80) {
+      word.push_back(c);
+    } else if (u >= 'A' && u <= 'Z') {
+      word.push_back(static_cast<char>(u - 'A' + 'a'));
+    } else {
+      flush();
+    }
+  }
+  flush();
+
+  return tokens;
+}
+
+std::string StemWord(std::string word) {
+  if (word.size() <= 3) return word;
+
+  if (EndsWith(word, "sses")) {
+    word.resize(word.size() - 2);
+  } else if (EndsWith(word, "ies")) {
+    word.replace(word.size() - 3, 3, "y");
+  } else if (EndsWith(word, "xes") || EndsWith(word, "ches") || EndsWith(word, "shes")) {
+    word.resize(word.size() - 2);
+  } else if (word.back() == 's' && !EndsWith(word, "ss") && !EndsWith(word, "us") && !EndsWith(word, "is")) {
+    word.pop_back();
+  }
+
+  std::string_view view = word;
+  if (EndsWith(view, "ing") && word.size() >= 6 && HasVowel(view.substr(0, word.size() - 3))) {
+    word.resize(word.size() - 3);
+    Undouble(&word);
+  } else if (EndsWith(view, "ed") && !EndsWith(view, "eed") && word.size() >= 5 &&
+             HasVowel(view.substr(0, word.size() - 2))) {
+    word.resize(word.size() - 2);
+    Undouble(&word);
+  }
+
+  return word;
+}
+
+bool MatchPhrase(const std::vector<const std::vector<uint32_t> *> &positions) {
+  if (positions.empty()) return false;
+
+  for (auto p : *positions[0]) {
+    bool matched = true;
+    for (size_t i = 1; i < positions.size() && matched; i++) {
+      matched = std::binary_search(positions[i]->begin(), positions[i]->end(), p + static_cast<uint32_t>(i));
+    }
+    if (matched) return true;
+  }
+
+  return false;
+}
+
+bool MatchTokens(const std::vector<std::string> &doc, const std::vector<std::string> &query, bool phrase) {
+  if (query.empty()) return false;
+
+  std::map<std::string_view, std::vector<uint32_t>> positions;
+  for (size_t i = 0; i < doc.size(); i++) {
+    positions[doc[i]].push_back(static_cast<uint32_t>(i));
+  }
+
+  std::vector<const std::vector<uint32_t> *> query_positions;
+  for (const auto &token : query) {
+    auto iter = positions.find(token);
+    if (iter == positions.end()) return false;
+    query_positions.push_back(&iter->second);
+  }
+
+  return !phrase || MatchPhrase(query_positions);
+}
+
+}  // namespace redis
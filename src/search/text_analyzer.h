@@ -0,0 +1,48 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace redis {
+
+// TokenizeText splits a text into the words of ASCII letters and digits or non-ASCII bytes, so a UTF-8
+// character is never split, and lowercases them. The words are stemmed unless `stem` is false.
+// The position of a token is its index in the result.
+std::vector<std::string> TokenizeText(std::string_view text, bool stem);
+
+// StemWord strips the common English inflectional suffixes, e.g. "foxes" and "jumped" are stemmed
+// to "fox" and "jump". It's a light stemmer instead of a full Porter one, which is enough to match
+// the forms of a word, since the documents and the queries are stemmed in the same way.
+std::string StemWord(std::string word);
+
+// MatchPhrase returns true if there's a position p in the first positions that p + i is in the i-th ones,
+// the positions are sorted
+bool MatchPhrase(const std::vector<const std::vector<uint32_t> *> &positions);
+
+// MatchTokens returns true if the tokens of a document contain all the tokens of a query,
+// or contain them consecutively in order if the query is a phrase
+bool MatchTokens(const std::vector<std::string> &doc, const std::vector<std::string> &query, bool phrase);
+
+}  // namespace redis
@@ -0,0 +1,317 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "text_index.h"
+
+#include <algorithm>
+#include <map>
+#include <set>
+
+#include "encoding.h"
+
+namespace redis {
+
+namespace {
+
+auto LowerBound(std::vector<TextPosting>::iterator begin, std::vector<TextPosting>::iterator end,
+                std::string_view key) {
+  return std::lower_bound(begin, end, key, [](const TextPosting &p, std::string_view k) { return p.key < k; });
+}
+
+}  // namespace
+
+void TextPostingBlock::Encode(std::string *dst) const {
+  PutVarint32(dst, static_cast<uint32_t>(postings.size()));
+  PutSizedString(dst, postings.empty() ? Slice() : Slice(postings.back().key));
+
+  std::string_view prev;
+  for (const auto &posting : postings) {
+    size_t shared = 0;
+    while (shared < prev.size() && shared < posting.key.size() && prev[shared] == posting.key[shared]) shared++;
+    PutVarint32(dst, static_cast<uint32_t>(shared));
+    PutVarint32(dst, static_cast<uint32_t>(posting.key.size() - shared));
+    dst->append(posting.key, shared);
+
+    PutVarint32(dst, posting.length);
+    PutVarint32(dst, static_cast<uint32_t>(posting.positions.size()));
+    uint32_t last = 0;
+    for (auto pos : posting.positions) {
+      PutVarint32(dst, pos - last);
+      last = pos;
+    }
+    prev = posting.key;
+  }
+}
+
+rocksdb::Status TextPostingBlock::Decode(Slice input) {
+  uint32_t n = 0;
+  Slice last_key;
+  if (!GetVarint32(&input, &n) || !GetSizedString(&input, &last_key)) {
+    return rocksdb::Status::Corruption(kErrorInsufficientLength);
+  }
+
+  postings.clear();
+  postings.reserve(std::min<size_t>(n, kMaxPostings));
+  std::string prev;
+  for (uint32_t i = 0; i < n; i++) {
+    uint32_t shared = 0, rest = 0, count = 0;
+    TextPosting posting;
+    if (!GetVarint32(&input, &shared) || !GetVarint32(&input, &rest) || shared > prev.size() || input.size() < rest) {
+      return rocksdb::Status::Corruption(kErrorInsufficientLength);
+    }
+    posting.key.assign(prev, 0, shared);
+    posting.key.append(input.data(), rest);
+    input.remove_prefix(rest);
+
+    if (!GetVarint32(&input, &posting.length) || !GetVarint32(&input, &count) || input.size() < count) {
+      return rocksdb::Status::Corruption(kErrorInsufficientLength);
+    }
+    posting.positions.reserve(count);
+    uint32_t last = 0;
+    for (uint32_t j = 0; j < count; j++) {
+      uint32_t delta = 0;
+      if (!GetVarint32(&input, &delta)) return rocksdb::Status::Corruption(kErrorInsufficientLength);
+      last += delta;
+      posting.positions.push_back(last);
+    }
+
+    prev = posting.key;
+    postings.push_back(std::move(posting));
+  }
+
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status TextPostingBlock::DecodeLastKey(Slice input, Slice *last_key) {
+  uint32_t n = 0;
+  if (!GetVarint32(&input, &n) || !GetSizedString(&input, last_key)) {
+    return rocksdb::Status::Corruption(kErrorInsufficientLength);
+  }
+  return rocksdb::Status::OK();
+}
+
+void TextFieldHeader::Encode(std::string *dst) const {
+  PutFixed64(dst, docs);
+  PutFixed64(dst, tokens);
+}
+
+rocksdb::Status TextFieldHeader::Decode(Slice input) {
+  if (!GetFixed64(&input, &docs) || !GetFixed64(&input, &tokens)) {
+    return rocksdb::Status::Corruption(kErrorInsufficientLength);
+  }
+  return rocksdb::Status::OK();
+}
+
+Status TextIndex::Update(engine::Context &ctx, std::string_view key, const std::vector<std::string> &original,
+                         const std::vector<std::string> &current) const {
+  std::map<std::string, TextPosting> postings;
+  for (size_t i = 0; i < current.size(); i++) {
+    postings[current[i]].positions.push_back(static_cast<uint32_t>(i));
+  }
+  for (auto &[_, posting] : postings) {
+    posting.key = key;
+    posting.length = static_cast<uint32_t>(current.size());
+  }
+
+  // The blocks are read from the latest data instead of the snapshot of the context,
+  // since the postings of the other keys may be written after the snapshot is taken
+  auto read_ctx = engine::Context::NoTransactionContext(storage_);
+  auto batch = storage_->GetWriteBatchBase();
+
+  std::optional<TextPosting> old;
+  for (const auto &term : std::set<std::string>(original.begin(), original.end())) {
+    if (postings.count(term) == 0) GET_OR_RET(updatePosting(read_ctx, batch.Get(), term, nullptr, key, &old));
+  }
+  for (const auto &[term, posting] : postings) {
+    GET_OR_RET(updatePosting(read_ctx, batch.Get(), term, &posting, key, &old));
+  }
+
+  // The key may be indexed before without its original text, e.g. by a resumed build,
+  // so the header is updated by the replaced postings instead of the original tokens
+  auto header = GET_OR_RET(GetFieldHeader(read_ctx));
+  if (old && header.docs > 0) {
+    header.docs--;
+    header.tokens -= std::min<uint64_t>(old->length, header.tokens);
+  }
+  if (!current.empty()) {
+    header.docs++;
+    header.tokens += current.size();
+  }
+
+  std::string value;
+  header.Encode(&value);
+  auto s = batch->Put(storage_->GetCFHandle(ColumnFamilyID::Search), search_key_.ConstructTextFieldHeader(), value);
+  if (!s.ok()) return {Status::NotOK, s.ToString()};
+
+  s = storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+  if (!s.ok()) return {Status::NotOK, s.ToString()};
+  return Status::OK();
+}
+
+Status TextIndex::updatePosting(engine::Context &ctx, rocksdb::WriteBatchBase *batch, const std::string &term,
+                                const TextPosting *posting, std::string_view key,
+                                std::optional<TextPosting> *old) const {
+  auto cf_handle = storage_->GetCFHandle(ColumnFamilyID::Search);
+  auto prefix = search_key_.ConstructTextTermPrefix(term);
+
+  // the block of the key is the last one starting before it, or the first one if the key is before all of them
+  util::UniqueIterator iter(ctx, ctx.DefaultScanOptions(), cf_handle);
+  iter->SeekForPrev(prefix + std::string(key));
+  if (!iter->Valid() || !iter->key().starts_with(prefix) || iter->key().size() == prefix.size()) {
+    iter->Seek(prefix);
+    if (iter->Valid() && iter->key() == prefix) iter->Next();
+  }
+  if (auto s = iter->status(); !s.ok()) return {Status::NotOK, s.ToString()};
+
+  std::string block_key;
+  TextPostingBlock block;
+  if (iter->Valid() && iter->key().starts_with(prefix)) {
+    block_key = iter->key().ToString();
+    if (auto s = block.Decode(iter->value()); !s.ok()) return {Status::NotOK, s.ToString()};
+  }
+
+  auto &postings = block.postings;
+  auto it = LowerBound(postings.begin(), postings.end(), key);
+  bool exists = it != postings.end() && it->key == key;
+  if (exists) *old = *it;
+  if (!exists && !posting) return Status::OK();
+  if (exists && posting && *it == *posting) return Status::OK();
+
+  int64_t delta = 0;
+  if (exists && posting) {
+    *it = *posting;
+  } else if (posting) {
+    postings.insert(it, *posting);
+    delta = 1;
+  } else {
+    postings.erase(it);
+    delta = -1;
+  }
+
+  // the key of the block changes with its first posting, and a full block is split into halves
+  if (!block_key.empty()) {
+    auto s = batch->Delete(cf_handle, block_key);
+    if (!s.ok()) return {Status::NotOK, s.ToString()};
+  }
+  auto put_block = [&](size_t begin, size_t end) {
+    TextPostingBlock part;
+    part.postings.assign(postings.begin() + static_cast<ptrdiff_t>(begin),
+                         postings.begin() + static_cast<ptrdiff_t>(end));
+    std::string value;
+    part.Encode(&value);
+    return batch->Put(cf_handle, search_key_.ConstructTextPostingBlock(term, postings[begin].key), value);
+  };
+  rocksdb::Status s;
+  if (postings.size() > TextPostingBlock::kMaxPostings) {
+    s = put_block(0, postings.size() / 2);
+    if (s.ok()) s = put_block(postings.size() / 2, postings.size());
+  } else if (!postings.empty()) {
+    s = put_block(0, postings.size());
+  }
+  if (!s.ok()) return {Status::NotOK, s.ToString()};
+
+  if (delta == 0) return Status::OK();
+  auto freq = GET_OR_RET(GetDocFreq(ctx, term));
+  freq = delta > 0 ? freq + 1 : freq - std::min<uint64_t>(freq, 1);
+  if (freq == 0) {
+    s = batch->Delete(cf_handle, prefix);
+  } else {
+    std::string value;
+    PutFixed64(&value, freq);
+    s = batch->Put(cf_handle, prefix, value);
+  }
+  if (!s.ok()) return {Status::NotOK, s.ToString()};
+  return Status::OK();
+}
+
+StatusOr<TextFieldHeader> TextIndex::GetFieldHeader(engine::Context &ctx) const {
+  std::string value;
+  auto s = storage_->Get(ctx, ctx.GetReadOptions(), storage_->GetCFHandle(ColumnFamilyID::Search),
+                         search_key_.ConstructTextFieldHeader(), &value);
+  if (s.IsNotFound()) return TextFieldHeader();
+  if (!s.ok()) return {Status::NotOK, s.ToString()};
+
+  TextFieldHeader header;
+  s = header.Decode(value);
+  if (!s.ok()) return {Status::NotOK, s.ToString()};
+  return header;
+}
+
+StatusOr<uint64_t> TextIndex::GetDocFreq(engine::Context &ctx, std::string_view term) const {
+  std::string value;
+  auto s = storage_->Get(ctx, ctx.GetReadOptions(), storage_->GetCFHandle(ColumnFamilyID::Search),
+                         search_key_.ConstructTextTermPrefix(term), &value);
+  if (s.IsNotFound()) return 0;
+  if (!s.ok()) return {Status::NotOK, s.ToString()};
+
+  Slice input(value);
+  uint64_t freq = 0;
+  if (!GetFixed64(&input, &freq)) return {Status::NotOK, kErrorInsufficientLength};
+  return freq;
+}
+
+TextPostingCursor::TextPostingCursor(engine::Context &ctx, const SearchKey &search_key, std::string_view term)
+    : prefix_(search_key.ConstructTextTermPrefix(term)), iter_(ctx, ctx.DefaultScanOptions(), ColumnFamilyID::Search) {}
+
+Status TextPostingCursor::Seek(std::string_view target) {
+  if (Valid() && Slice(block_.postings.back().key).compare(target) >= 0) {
+    auto begin = block_.postings.begin();
+    pos_ = static_cast<size_t>(LowerBound(begin + static_cast<ptrdiff_t>(pos_), block_.postings.end(), target) - begin);
+    return Status::OK();
+  }
+
+  iter_->SeekForPrev(prefix_ + std::string(target));
+  if (!iter_->Valid() || !iter_->key().starts_with(prefix_)) iter_->Seek(prefix_);
+  return loadBlock(target);
+}
+
+Status TextPostingCursor::Next() {
+  if (!Valid()) return Status::OK();
+  if (++pos_ < block_.postings.size()) return Status::OK();
+
+  iter_->Next();
+  return loadBlock({});
+}
+
+Status TextPostingCursor::loadBlock(std::string_view target) {
+  block_.postings.clear();
+  pos_ = 0;
+
+  for (; iter_->Valid() && iter_->key().starts_with(prefix_); iter_->Next()) {
+    // the term header
+    if (iter_->key().size() == prefix_.size()) continue;
+
+    Slice last_key;
+    auto s = TextPostingBlock::DecodeLastKey(iter_->value(), &last_key);
+    if (!s.ok()) return {Status::NotOK, s.ToString()};
+    if (last_key.compare(target) < 0) continue;
+
+    s = block_.Decode(iter_->value());
+    if (!s.ok()) return {Status::NotOK, s.ToString()};
+    auto begin = block_.postings.begin();
+    pos_ = static_cast<size_t>(LowerBound(begin, block_.postings.end(), target) - begin);
+    return Status::OK();
+  }
+
+  if (auto s = iter_->status(); !s.ok()) return {Status::NotOK, s.ToString()};
+  return Status::OK();
+}
+
+}  // namespace redis
@@ -0,0 +1,124 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "db_util.h"
+#include "search/search_encoding.h"
+#include "status.h"
+#include "storage/storage.h"
+
+namespace redis {
+
+// A posting of a term, i.e. a key whose text contains the term
+struct TextPosting {
+  std::string key;
+  // the number of the tokens of the text
+  uint32_t length = 0;
+  // the sorted positions of the term in the tokens
+  std::vector<uint32_t> positions;
+
+  bool operator==(const TextPosting &other) const {
+    return key == other.key && length == other.length && positions == other.positions;
+  }
+};
+
+// The postings of a term are stored in blocks of at most kMaxPostings postings in the order of their keys,
+// each under the key of its first posting, so the block of a key is found by seeking to the block before it.
+//
+// The postings in a block are compressed: a key is stored as the length of the prefix shared with the
+// previous key and the rest of it, and the positions are stored as varint deltas. The last key of the
+// block is stored before the postings as the skip data, so a block can be skipped without decoding it.
+struct TextPostingBlock {
+  static constexpr size_t kMaxPostings = 128;
+
+  std::vector<TextPosting> postings;
+
+  void Encode(std::string *dst) const;
+  rocksdb::Status Decode(Slice input);
+  static rocksdb::Status DecodeLastKey(Slice input, Slice *last_key);
+};
+
+// The number of the documents of a text field and their tokens, for the average length in BM25
+struct TextFieldHeader {
+  uint64_t docs = 0;
+  uint64_t tokens = 0;
+
+  void Encode(std::string *dst) const;
+  rocksdb::Status Decode(Slice input);
+};
+
+// TextIndex is the inverted index of a text field.
+//
+// Under the prefix of a term, there's the term header which counts the documents with the term,
+// and the blocks of its postings. The blocks are read-modify-written, so the updates of a field
+// must be serialized by the caller.
+class TextIndex {
+ public:
+  TextIndex(SearchKey search_key, engine::Storage *storage)
+      : search_key_(std::move(search_key)), storage_(storage) {}
+
+  // Update replaces the postings of the key, given the tokens of its original and current text
+  Status Update(engine::Context &ctx, std::string_view key, const std::vector<std::string> &original,
+                const std::vector<std::string> &current) const;
+
+  StatusOr<TextFieldHeader> GetFieldHeader(engine::Context &ctx) const;
+  StatusOr<uint64_t> GetDocFreq(engine::Context &ctx, std::string_view term) const;
+
+ private:
+  SearchKey search_key_;
+  engine::Storage *storage_;
+
+  // updatePosting replaces the posting of the key with the given one, or removes it if it's null,
+  // and returns the replaced one in `old` if it exists
+  Status updatePosting(engine::Context &ctx, rocksdb::WriteBatchBase *batch, const std::string &term,
+                       const TextPosting *posting, std::string_view key, std::optional<TextPosting> *old) const;
+};
+
+// TextPostingCursor iterates the postings of a term in the order of their keys
+class TextPostingCursor {
+ public:
+  TextPostingCursor(engine::Context &ctx, const SearchKey &search_key, std::string_view term);
+
+  // Seek moves to the first posting with a key not less than the target, the targets must be ascending.
+  // The blocks which end before the target are skipped without being decoded.
+  Status Seek(std::string_view target);
+  Status Next();
+
+  bool Valid() const { return pos_ < block_.postings.size(); }
+  const TextPosting &Get() const { return block_.postings[pos_]; }
+
+ private:
+  std::string prefix_;
+  util::UniqueIterator iter_;
+  TextPostingBlock block_;
+  size_t pos_ = 0;
+
+  // loadBlock decodes the first block from the iterator which may contain the target
+  Status loadBlock(std::string_view target);
+};
+
+}  // namespace redis
@@ -0,0 +1,186 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "vector_distance.h"
+
+#include <cmath>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace redis {
+
+namespace {
+
+double InnerProductScalar(const double *a, const double *b, size_t dim) {
+  // independent accumulators let the compiler keep several multiplications in flight
+  double sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+  size_t i = 0;
+  for (; i + 4 <= dim; i += 4) {
+    sum0 += a[i] * b[i];
+    sum1 += a[i + 1] * b[i + 1];
+    sum2 += a[i + 2] * b[i + 2];
+    sum3 += a[i + 3] * b[i + 3];
+  }
+  for (; i < dim; i++) sum0 += a[i] * b[i];
+  return (sum0 + sum1) + (sum2 + sum3);
+}
+
+double SquaredL2DistanceScalar(const double *a, const double *b, size_t dim) {
+  double sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+  size_t i = 0;
+  for (; i + 4 <= dim; i += 4) {
+    double d0 = a[i] - b[i], d1 = a[i + 1] - b[i + 1], d2 = a[i + 2] - b[i + 2], d3 = a[i + 3] - b[i + 3];
+    sum0 += d0 * d0;
+    sum1 += d1 * d1;
+    sum2 += d2 * d2;
+    sum3 += d3 * d3;
+  }
+  for (; i < dim; i++) {
+    double d = a[i] - b[i];
+    sum0 += d * d;
+  }
+  return (sum0 + sum1) + (sum2 + sum3);
+}
+
+#if defined(__x86_64__)
+
+// The x86 kernels are compiled for their instruction sets only, and chosen by the CPU features at runtime
+
+__attribute__((target("avx2,fma"))) double HorizontalSumAVX2(__m256d v) {
+  __m128d sum = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+  return _mm_cvtsd_f64(_mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+}
+
+__attribute__((target("avx2,fma"))) double InnerProductAVX2(const double *a, const double *b, size_t dim) {
+  __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+  size_t i = 0;
+  for (; i + 8 <= dim; i += 8) {
+    acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), acc0);
+    acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4), acc1);
+  }
+  return HorizontalSumAVX2(_mm256_add_pd(acc0, acc1)) + InnerProductScalar(a + i, b + i, dim - i);
+}
+
+__attribute__((target("avx2,fma"))) double SquaredL2DistanceAVX2(const double *a, const double *b, size_t dim) {
+  __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+  size_t i = 0;
+  for (; i + 8 <= dim; i += 8) {
+    __m256d d0 = _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i));
+    __m256d d1 = _mm256_sub_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4));
+    acc0 = _mm256_fmadd_pd(d0, d0, acc0);
+    acc1 = _mm256_fmadd_pd(d1, d1, acc1);
+  }
+  return HorizontalSumAVX2(_mm256_add_pd(acc0, acc1)) + SquaredL2DistanceScalar(a + i, b + i, dim - i);
+}
+
+__attribute__((target("avx512f"))) double InnerProductAVX512(const double *a, const double *b, size_t dim) {
+  __m512d acc0 = _mm512_setzero_pd(), acc1 = _mm512_setzero_pd();
+  size_t i = 0;
+  for (; i + 16 <= dim; i += 16) {
+    acc0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i), acc0);
+    acc1 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i + 8), _mm512_loadu_pd(b + i + 8), acc1);
+  }
+  return _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1)) + InnerProductScalar(a + i, b + i, dim - i);
+}
+
+__attribute__((target("avx512f"))) double SquaredL2DistanceAVX512(const double *a, const double *b, size_t dim) {
+  __m512d acc0 = _mm512_setzero_pd(), acc1 = _mm512_setzero_pd();
+  size_t i = 0;
+  for (; i + 16 <= dim; i += 16) {
+    __m512d d0 = _mm512_sub_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i));
+    __m512d d1 = _mm512_sub_pd(_mm512_loadu_pd(a + i + 8), _mm512_loadu_pd(b + i + 8));
+    acc0 = _mm512_fmadd_pd(d0, d0, acc0);
+    acc1 = _mm512_fmadd_pd(d1, d1, acc1);
+  }
+  return _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1)) + SquaredL2DistanceScalar(a + i, b + i, dim - i);
+}
+
+#elif defined(__aarch64__)
+
+// NEON is always there on aarch64, so its kernels need no detection
+
+double InnerProductNEON(const double *a, const double *b, size_t dim) {
+  float64x2_t acc0 = vdupq_n_f64(0), acc1 = vdupq_n_f64(0);
+  size_t i = 0;
+  for (; i + 4 <= dim; i += 4) {
+    acc0 = vfmaq_f64(acc0, vld1q_f64(a + i), vld1q_f64(b + i));
+    acc1 = vfmaq_f64(acc1, vld1q_f64(a + i + 2), vld1q_f64(b + i + 2));
+  }
+  return vaddvq_f64(vaddq_f64(acc0, acc1)) + InnerProductScalar(a + i, b + i, dim - i);
+}
+
+double SquaredL2DistanceNEON(const double *a, const double *b, size_t dim) {
+  float64x2_t acc0 = vdupq_n_f64(0), acc1 = vdupq_n_f64(0);
+  size_t i = 0;
+  for (; i + 4 <= dim; i += 4) {
+    float64x2_t d0 = vsubq_f64(vld1q_f64(a + i), vld1q_f64(b + i));
+    float64x2_t d1 = vsubq_f64(vld1q_f64(a + i + 2), vld1q_f64(b + i + 2));
+    acc0 = vfmaq_f64(acc0, d0, d0);
+    acc1 = vfmaq_f64(acc1, d1, d1);
+  }
+  return vaddvq_f64(vaddq_f64(acc0, acc1)) + SquaredL2DistanceScalar(a + i, b + i, dim - i);
+}
+
+#endif
+
+struct Kernels {
+  const char *name;
+  double (*inner_product)(const double *, const double *, size_t);
+  double (*squared_l2_distance)(const double *, const double *, size_t);
+};
+
+Kernels DetectKernels() {
+  Kernels kernels{"scalar", InnerProductScalar, SquaredL2DistanceScalar};
+#if defined(__x86_64__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    kernels = {"avx2", InnerProductAVX2, SquaredL2DistanceAVX2};
+  }
+  if (__builtin_cpu_supports("avx512f")) {
+    kernels = {"avx512", InnerProductAVX512, SquaredL2DistanceAVX512};
+  }
+#elif defined(__aarch64__)
+  kernels = {"neon", InnerProductNEON, SquaredL2DistanceNEON};
+#endif
+  return kernels;
+}
+
+const Kernels &GetKernels() {
+  static const Kernels kernels = DetectKernels();
+  return kernels;
+}
+
+}  // namespace
+
+double InnerProduct(const double *a, const double *b, size_t dim) { return GetKernels().inner_product(a, b, dim); }
+
+double SquaredL2Distance(const double *a, const double *b, size_t dim) {
+  return GetKernels().squared_l2_distance(a, b, dim);
+}
+
+double VectorNorm(const double *a, size_t dim) { return std::sqrt(InnerProduct(a, a, dim)); }
+
+const char *VectorDistanceKernelName() { return GetKernels().name; }
+
+}  // namespace redis
@@ -0,0 +1,38 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace redis {
+
+// Distance kernels of the vector fields over contiguous arrays of doubles.
+// They are dispatched at runtime to the widest instructions the CPU supports (AVX-512, AVX2 with FMA or NEON),
+// so the results may differ from a sequential sum in the last bits.
+
+double InnerProduct(const double *a, const double *b, size_t dim);
+double SquaredL2Distance(const double *a, const double *b, size_t dim);
+double VectorNorm(const double *a, size_t dim);
+
+// VectorDistanceKernelName gets the name of the instruction set used by the kernels
+const char *VectorDistanceKernelName();
+
+}  // namespace redis
@@ -0,0 +1,66 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "blocking_key_registry.h"
+
+#include <algorithm>
+
+void BlockingKeyRegistry::Block(const std::string &key, Waiter waiter) {
+  auto &shard = shardOf(key);
+  std::lock_guard<std::mutex> guard(shard.mutex);
+
+  shard.keys[key].emplace_back(waiter);
+}
+
+void BlockingKeyRegistry::Unblock(const std::string &key, const Worker *owner, int fd) {
+  auto &shard = shardOf(key);
+  std::lock_guard<std::mutex> guard(shard.mutex);
+
+  auto iter = shard.keys.find(key);
+  if (iter == shard.keys.end()) return;
+
+  auto &waiters = iter->second;
+  auto waiter = std::find_if(waiters.begin(), waiters.end(),
+                             [&](const Waiter &w) { return w.owner == owner && w.fd == fd; });
+  if (waiter == waiters.end()) return;
+
+  // the order of the other waiters is kept, so they're still woken first come first served
+  waiters.erase(waiter);
+  if (waiters.empty()) shard.keys.erase(iter);
+}
+
+std::map<Worker *, std::vector<int>> BlockingKeyRegistry::Take(const std::string &key, size_t n) {
+  std::map<Worker *, std::vector<int>> taken;
+
+  auto &shard = shardOf(key);
+  std::lock_guard<std::mutex> guard(shard.mutex);
+
+  auto iter = shard.keys.find(key);
+  if (iter == shard.keys.end()) return taken;
+
+  auto &waiters = iter->second;
+  for (; n > 0 && !waiters.empty(); n--) {
+    taken[waiters.front().owner].emplace_back(waiters.front().fd);
+    waiters.pop_front();
+  }
+  if (waiters.empty()) shard.keys.erase(iter);
+
+  return taken;
+}
@@ -0,0 +1,62 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class Worker;
+
+// BlockingKeyRegistry tracks the connections blocked by BLPOP, BLMOVE, BZPOPMIN and the like on each key.
+//
+// The waiters are kept per key in shards by key, so the pushes to different keys don't contend on one mutex.
+// A push takes at most one waiter per pushed element in the order they were blocked, grouped by their
+// workers, and the waiters are woken after the shard is unlocked.
+class BlockingKeyRegistry {
+ public:
+  static constexpr size_t kShards = 64;
+
+  struct Waiter {
+    Worker *owner;
+    int fd;
+  };
+
+  void Block(const std::string &key, Waiter waiter);
+  void Unblock(const std::string &key, const Worker *owner, int fd);
+  // Take the first n waiters of the key, grouped by their workers
+  std::map<Worker *, std::vector<int>> Take(const std::string &key, size_t n);
+
+ private:
+  struct alignas(64) Shard {
+    std::mutex mutex;
+    std::map<std::string, std::deque<Waiter>> keys;
+  };
+
+  std::array<Shard, kShards> shards_;
+
+  Shard &shardOf(const std::string &key) { return shards_[std::hash<std::string>{}(key) % kShards]; }
+};
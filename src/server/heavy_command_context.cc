@@ -0,0 +1,103 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "heavy_command_context.h"
+
+#include "server/redis_connection.h"
+#include "server/server.h"
+#include "server/worker.h"
+
+namespace redis {
+
+Status HeavyCommandContext::Start() {
+  auto bev = conn_->GetBufferEvent();
+  SetCB(bev);
+
+  auto s = srv_->PublishHeavyCommand(conn_->GetNamespace(), [this] { run(); });
+  if (!s.IsOK()) {
+    conn_->SetCB(bev);
+    return s;
+  }
+  return Status::OK();
+}
+
+void HeavyCommandContext::run() {
+  {
+    auto concurrency = srv_->WorkConcurrencyGuard();
+    status_ = conn_->ExecuteCommand(cmd_->GetAttributes()->name, cmd_tokens_, cmd_, &reply_, &usage_);
+    if (status_.IsOK()) {
+      srv_->UpdateWatchedKeysFromArgs(cmd_tokens_, *cmd_->GetAttributes());
+      srv_->RecordHotKeys(conn_->GetNamespace(), cmd_tokens_, *cmd_->GetAttributes());
+      srv_->NotifyKeyspaceEvents(conn_->GetNamespace(), cmd_tokens_, *cmd_->GetAttributes());
+      srv_->UpdateTrackedKeys(conn_, cmd_tokens_, *cmd_->GetAttributes());
+      srv_->ChargeNamespaceQuota(conn_->GetNamespace(), cmd_tokens_, *cmd_->GetAttributes(), reply_.size());
+    }
+  }
+
+  // The worker may free the connection as soon as it observes `done_`,
+  // so everything needed to wake it up must be read before.
+  auto owner = conn_->Owner();
+  auto fd = conn_->GetFD();
+  done_ = true;
+  auto s = owner->EnableWriteEvent(fd);
+  if (!s.IsOK()) {
+    LOG(ERROR) << "[server] Failed to enable write event on the heavy command connection " << fd << ": " << s.Msg();
+  }
+}
+
+void HeavyCommandContext::OnWrite(bufferevent *bev) {
+  if (!done_) {
+    // Woken up by something else (e.g. CLIENT KILL) while the command is still running.
+    bufferevent_disable(bev, EV_WRITE);
+    // The pool thread may have finished right before the write event was disabled
+    if (!done_) return;
+  }
+
+  auto conn = conn_;
+  conn->AddCommandUsage(usage_);
+  if (conn->IsFlagEnabled(Connection::kCloseAfterReply)) {
+    conn->Close();
+    return;
+  }
+
+  if (!status_.IsOK()) {
+    conn->Reply(redis::Error(status_));
+  } else if (!reply_.empty()) {
+    conn->Reply(std::move(reply_));
+  }
+
+  conn->SetCB(bev);
+  bufferevent_enable(bev, EV_READ);
+  // This context is destroyed here, only use locals from now on
+  conn->FinishHeavyCommand();
+  // Process the commands pipelined after the heavy one, see also BlockingCommander::OnWrite
+  bufferevent_trigger(bev, EV_READ, BEV_TRIG_IGNORE_WATERMARKS);
+}
+
+void HeavyCommandContext::OnEvent(bufferevent *bev, int16_t events) {
+  if (events & (BEV_EVENT_EOF | BEV_EVENT_ERROR)) {
+    // The pool thread still uses the connection, so defer closing it until the command is done
+    conn_->EnableFlag(Connection::kCloseAfterReply);
+    return;
+  }
+  conn_->OnEvent(bev, events);
+}
+
+}  // namespace redis
@@ -0,0 +1,73 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "event_util.h"
+#include "status.h"
+
+class Server;
+
+namespace redis {
+
+class Commander;
+class Connection;
+
+// CommandUsage is what a command adds to the counters of its connection. They are only updated in the owner
+// thread of the connection, so a command run by another thread collects its usage for the owner to add later.
+struct CommandUsage {
+  uint64_t commands = 0;
+  uint64_t read_bytes = 0;
+  uint64_t write_seq = 0;
+};
+
+// HeavyCommandContext runs a single command on the server's heavy command pool.
+// The connection is suspended (no read callback) while the command is running,
+// and resumed on its own worker once the pool thread signals completion by
+// enabling the write event, the same way as blocking commands are woken up.
+class HeavyCommandContext : private EvbufCallbackBase<HeavyCommandContext, false> {
+ public:
+  HeavyCommandContext(Server *srv, Connection *conn, Commander *cmd, std::vector<std::string> cmd_tokens)
+      : srv_(srv), conn_(conn), cmd_(cmd), cmd_tokens_(std::move(cmd_tokens)) {}
+
+  Status Start();
+  void OnWrite(bufferevent *bev);
+  void OnEvent(bufferevent *bev, int16_t events);
+
+ private:
+  void run();
+
+  Server *srv_;
+  Connection *conn_;
+  Commander *cmd_;
+  std::vector<std::string> cmd_tokens_;
+
+  Status status_;
+  std::string reply_;
+  CommandUsage usage_;
+  std::atomic<bool> done_ = false;
+};
+
+}  // namespace redis
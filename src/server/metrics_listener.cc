@@ -0,0 +1,91 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "metrics_listener.h"
+
+#include <event2/buffer.h>
+#include <glog/logging.h>
+
+#include <string_view>
+
+#include "thread_util.h"
+
+Status MetricsListener::Start(const std::string &host, uint32_t port) {
+  if (thread_.joinable()) return {Status::NotOK, "the metrics listener is already started"};
+
+  base_ = event_base_new();
+  if (!base_) return {Status::NotOK, "failed to create the event base of the metrics listener"};
+  http_ = evhttp_new(base_);
+  if (!http_) {
+    Stop();
+    return {Status::NotOK, "failed to create the HTTP server of the metrics listener"};
+  }
+  evhttp_set_allowed_methods(http_, EVHTTP_REQ_GET);
+  evhttp_set_gencb(http_, handleRequest, this);
+  if (evhttp_bind_socket(http_, host.c_str(), static_cast<uint16_t>(port)) != 0) {
+    Stop();
+    return {Status::NotOK, "failed to listen on " + host + ":" + std::to_string(port) + " for the metrics"};
+  }
+
+  auto t = util::CreateThread("metrics", [this] { event_base_dispatch(base_); });
+  if (!t) {
+    Stop();
+    return std::move(t);
+  }
+  thread_ = std::move(*t);
+  return Status::OK();
+}
+
+void MetricsListener::Stop() {
+  if (thread_.joinable()) {
+    event_base_loopbreak(base_);
+    if (auto s = util::ThreadJoin(thread_); !s) {
+      LOG(WARNING) << "[metrics] Failed to join the metrics listener thread: " << s.Msg();
+    }
+  }
+  if (http_) {
+    evhttp_free(http_);
+    http_ = nullptr;
+  }
+  if (base_) {
+    event_base_free(base_);
+    base_ = nullptr;
+  }
+}
+
+void MetricsListener::handleRequest(evhttp_request *req, void *arg) {
+  auto self = static_cast<MetricsListener *>(arg);
+
+  const char *path = evhttp_uri_get_path(evhttp_request_get_evhttp_uri(req));
+  if (!path || std::string_view(path) != "/metrics") {
+    evhttp_send_error(req, HTTP_NOTFOUND, nullptr);
+    return;
+  }
+
+  std::string output;
+  self->render_(&output);
+
+  evhttp_add_header(evhttp_request_get_output_headers(req), "Content-Type",
+                    "application/openmetrics-text; version=1.0.0; charset=utf-8");
+  auto buffer = evbuffer_new();
+  evbuffer_add(buffer, output.data(), output.size());
+  evhttp_send_reply(req, HTTP_OK, "OK", buffer);
+  evbuffer_free(buffer);
+}
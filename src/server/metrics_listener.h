@@ -0,0 +1,58 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <event2/event.h>
+#include <event2/http.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "status.h"
+
+// MetricsListener serves the metrics for Prometheus over HTTP in a thread of its own, see metrics-port.
+//
+// A scrape of GET /metrics gets the exposition rendered by the callback, which reads the stats directly
+// instead of building and parsing the INFO strings, so the scrapes never occupy the workers.
+class MetricsListener {
+ public:
+  using RenderCallback = std::function<void(std::string *)>;
+
+  explicit MetricsListener(RenderCallback render) : render_(std::move(render)) {}
+  ~MetricsListener() { Stop(); }
+
+  MetricsListener(const MetricsListener &) = delete;
+  MetricsListener &operator=(const MetricsListener &) = delete;
+
+  Status Start(const std::string &host, uint32_t port);
+  void Stop();
+
+ private:
+  RenderCallback render_;
+  event_base *base_ = nullptr;
+  evhttp *http_ = nullptr;
+  std::thread thread_;
+
+  static void handleRequest(evhttp_request *req, void *arg);
+};
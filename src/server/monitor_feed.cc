@@ -0,0 +1,77 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "monitor_feed.h"
+
+#include <fmt/format.h>
+#include <glog/logging.h>
+
+#include "string_util.h"
+#include "thread_util.h"
+
+Status MonitorFeed::Start() {
+  if (thread_.joinable()) return {Status::NotOK, "the monitor feed is already started"};
+
+  auto t = util::CreateThread("monitor-feed", [this] { run(); });
+  if (!t) return std::move(t);
+  thread_ = std::move(*t);
+  return Status::OK();
+}
+
+void MonitorFeed::Stop() {
+  if (!thread_.joinable()) return;
+
+  queue_.abort();
+  if (auto s = util::ThreadJoin(thread_); !s) {
+    LOG(WARNING) << "[monitor] Failed to join the monitor feed thread: " << s.Msg();
+  }
+  queue_.clear();
+}
+
+void MonitorFeed::Push(Record &&record) {
+  if (!queue_.try_push(std::move(record))) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    total_dropped_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+std::string MonitorFeed::FormatRecord(const Record &record) {
+  std::string output =
+      fmt::format("{}.{} [{} {}]", record.time_us / 1000000, record.time_us % 1000000, record.ns, record.addr);
+  for (const auto &arg : record.args) {
+    output += " \"";
+    output += util::EscapeString(arg);
+    output += "\"";
+  }
+  return output;
+}
+
+void MonitorFeed::run() {
+  while (true) {
+    Record record;
+    try {
+      queue_.pop(record);
+    } catch (tbb::user_abort &e) {
+      break;
+    }
+
+    deliver_(record, FormatRecord(record), dropped_.exchange(0, std::memory_order_relaxed));
+  }
+}
@@ -0,0 +1,78 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "oneapi/tbb/concurrent_queue.h"
+#include "status.h"
+
+// MonitorFeed delivers the commands to the MONITOR connections in a background thread.
+//
+// The workers only push a record of the command to a bounded concurrent queue, and the thread formats
+// the monitor lines and hands them to the deliver callback. When the queue is full, the records are
+// dropped and counted, so a burst never stalls the workers. The dropped records are reported to every
+// monitor with the next line, see Worker::FeedMonitorConns for the monitors that can't keep up.
+class MonitorFeed {
+ public:
+  static constexpr size_t kMaxQueuedRecords = 64 * 1024;
+
+  struct Record {
+    uint64_t time_us = 0;
+    uint64_t conn_id = 0;
+    std::string ns;
+    std::string addr;
+    std::vector<std::string> args;
+  };
+
+  // the callback gets the record, the formatted monitor line and the number of the records dropped before it
+  using DeliverCallback = std::function<void(const Record &, const std::string &, uint64_t)>;
+
+  explicit MonitorFeed(DeliverCallback deliver) : deliver_(std::move(deliver)) {
+    queue_.set_capacity(kMaxQueuedRecords);
+  }
+  ~MonitorFeed() { Stop(); }
+
+  MonitorFeed(const MonitorFeed &) = delete;
+  MonitorFeed &operator=(const MonitorFeed &) = delete;
+
+  Status Start();
+  void Stop();
+
+  void Push(Record &&record);
+  uint64_t GetDroppedRecords() const { return total_dropped_.load(std::memory_order_relaxed); }
+
+  static std::string FormatRecord(const Record &record);
+
+ private:
+  DeliverCallback deliver_;
+  tbb::concurrent_bounded_queue<Record> queue_;
+  std::atomic<uint64_t> dropped_ = 0;
+  std::atomic<uint64_t> total_dropped_ = 0;
+  std::thread thread_;
+
+  void run();
+};
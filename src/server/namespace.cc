@@ -21,6 +21,7 @@
 #include "namespace.h"
 
 #include "jsoncons/json.hpp"
+#include "string_util.h"
 
 // Error messages
 constexpr const char* kErrNamespaceExists = "the namespace already exists";
@@ -91,6 +92,8 @@ Status Namespace::LoadAndRewrite() {
     }
   }
 
+  publishTokenIndex();
+
   // The following rewrite is to remove namespace/token pairs from the configuration if the namespace replication
   // is enabled. So we don't need to do that if no tokens are loaded or the namespace replication is disabled.
   if (config->load_tokens.empty() || !config->repl_namespace_enabled) return Status::OK();
@@ -108,13 +111,24 @@ StatusOr<std::string> Namespace::Get(const std::string& ns) {
   return {Status::NotFound};
 }
 
-StatusOr<std::string> Namespace::GetByToken(const std::string& token) {
-  std::shared_lock lock(tokens_mu_);
-  auto iter = tokens_.find(token);
-  if (iter == tokens_.end()) {
+StatusOr<std::string> Namespace::GetByToken(const std::string& token) const {
+  auto index = std::atomic_load(&token_index_);
+  auto iter = index->find(std::hash<std::string>{}(token));
+  if (iter == index->end()) {
     return {Status::NotFound};
   }
-  return iter->second;
+  for (const auto& [candidate, ns] : iter->second) {
+    if (util::ConstantTimeEqual(candidate, token)) return ns;
+  }
+  return {Status::NotFound};
+}
+
+void Namespace::publishTokenIndex() {
+  auto index = std::make_shared<TokenIndex>();
+  for (const auto& [token, ns] : tokens_) {
+    (*index)[std::hash<std::string>{}(token)].emplace_back(token, ns);
+  }
+  std::atomic_store(&token_index_, std::shared_ptr<const TokenIndex>(std::move(index)));
 }
 
 Status Namespace::Set(const std::string& ns, const std::string& token) {
@@ -149,8 +163,10 @@ Status Namespace::Set(const std::string& ns, const std::string& token) {
   s = Rewrite(tokens_);
   if (!s.IsOK()) {
     tokens_.erase(token);
+    publishTokenIndex();
     return s;
   }
+  publishTokenIndex();
   return Status::OK();
 }
 
@@ -185,12 +201,14 @@ Status Namespace::Del(const std::string& ns) {
   std::unique_lock lock(tokens_mu_);
   for (const auto& iter : tokens_) {
     if (iter.second == ns) {
-      tokens_.erase(iter.first);
+      auto token = iter.first;
+      tokens_.erase(token);
       auto s = Rewrite(tokens_);
       if (!s.IsOK()) {
-        tokens_[iter.first] = iter.second;
+        tokens_[token] = ns;
         return s;
       }
+      publishTokenIndex();
       return Status::OK();
     }
   }
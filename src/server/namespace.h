@@ -20,6 +20,12 @@
 
 #pragma once
 
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 #include "storage/storage.h"
 
 constexpr const char *kNamespaceDBKey = "__namespace_keys__";
@@ -34,7 +40,8 @@ class Namespace {
 
   Status LoadAndRewrite();
   StatusOr<std::string> Get(const std::string &ns);
-  StatusOr<std::string> GetByToken(const std::string &token);
+  // GetByToken never takes a lock, and compares the tokens in constant time
+  StatusOr<std::string> GetByToken(const std::string &token) const;
   Status Set(const std::string &ns, const std::string &token);
   Status Add(const std::string &ns, const std::string &token);
   Status Del(const std::string &ns);
@@ -48,6 +55,12 @@ class Namespace {
   std::shared_mutex tokens_mu_;
   // mapping from token to namespace name
   std::map<std::string, std::string> tokens_;
+  // The read-only copy of tokens_ for the AUTH, indexed by the hash of the token. It's replaced as a whole
+  // after every change of tokens_, and is only loaded and stored atomically.
+  using TokenIndex = std::unordered_map<size_t, std::vector<std::pair<std::string, std::string>>>;
+  std::shared_ptr<const TokenIndex> token_index_ = std::make_shared<const TokenIndex>();
 
+  // publishTokenIndex rebuilds the token index from tokens_, with tokens_mu_ held
+  void publishTokenIndex();
   Status loadFromDB(std::map<std::string, std::string> *db_tokens) const;
 };
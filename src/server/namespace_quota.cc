@@ -0,0 +1,149 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "namespace_quota.h"
+
+#include "time_util.h"
+
+void NamespaceQuotas::Entry::Refill(uint64_t now_us) {
+  if (now_us <= last_refill_us) return;
+  double elapsed_secs = static_cast<double>(now_us - last_refill_us) / 1000000;
+  last_refill_us = now_us;
+  ops.Refill(elapsed_secs);
+  read_bytes.Refill(elapsed_secs);
+  write_bytes.Refill(elapsed_secs);
+}
+
+void NamespaceQuotas::Reset(const std::map<std::string, NamespaceQuota> &quotas) {
+  std::map<std::string, std::unique_ptr<Entry>> entries;
+  auto now_us = util::GetTimeStampUS();
+  for (const auto &[ns, quota] : quotas) {
+    auto entry = std::make_unique<Entry>();
+    entry->quota = quota;
+    entry->last_refill_us = now_us;
+    // the buckets start full, so the bursts of the first second are allowed
+    entry->ops.rate = entry->ops.tokens = static_cast<double>(quota.ops);
+    entry->read_bytes.rate = entry->read_bytes.tokens = static_cast<double>(quota.read_bytes);
+    entry->write_bytes.rate = entry->write_bytes.tokens = static_cast<double>(quota.write_bytes);
+    entries.emplace(ns, std::move(entry));
+  }
+
+  std::unique_lock<std::shared_mutex> guard(mu_);
+  entries_ = std::move(entries);
+  n_quotas_ = entries_.size();
+}
+
+bool NamespaceQuotas::HasQuota(const std::string &ns) const {
+  if (!HasQuotas()) return false;
+
+  std::shared_lock<std::shared_mutex> guard(mu_);
+  return entries_.count(ns) > 0;
+}
+
+bool NamespaceQuotas::Admit(const std::string &ns, bool is_write) {
+  if (!HasQuotas()) return true;
+
+  std::shared_lock<std::shared_mutex> guard(mu_);
+  auto iter = entries_.find(ns);
+  if (iter == entries_.end()) return true;
+
+  auto &entry = *iter->second;
+  std::lock_guard<std::mutex> entry_guard(entry.mu);
+  entry.Refill(util::GetTimeStampUS());
+  // the bytes of the previous commands must be paid off first
+  auto &bytes = is_write ? entry.write_bytes : entry.read_bytes;
+  if (!bytes.Unlimited() && bytes.tokens <= 0) {
+    (is_write ? entry.throttled_writes : entry.throttled_reads)++;
+    return false;
+  }
+  if (!entry.ops.Unlimited()) {
+    if (entry.ops.tokens < 1) {
+      entry.throttled_ops++;
+      return false;
+    }
+    entry.ops.tokens -= 1;
+  }
+  return true;
+}
+
+void NamespaceQuotas::Charge(const std::string &ns, uint64_t read_bytes, uint64_t write_bytes) {
+  if (!HasQuotas()) return;
+
+  std::shared_lock<std::shared_mutex> guard(mu_);
+  auto iter = entries_.find(ns);
+  if (iter == entries_.end()) return;
+
+  auto &entry = *iter->second;
+  std::lock_guard<std::mutex> entry_guard(entry.mu);
+  if (!entry.read_bytes.Unlimited()) entry.read_bytes.tokens -= static_cast<double>(read_bytes);
+  if (!entry.write_bytes.Unlimited()) entry.write_bytes.tokens -= static_cast<double>(write_bytes);
+}
+
+uint32_t NamespaceQuotas::GetWeight(const std::string &ns) const {
+  if (!HasQuotas()) return 1;
+
+  std::shared_lock<std::shared_mutex> guard(mu_);
+  auto iter = entries_.find(ns);
+  return iter == entries_.end() ? 1 : iter->second->quota.weight;
+}
+
+std::map<std::string, NamespaceQuotas::Stats> NamespaceQuotas::GetStats() const {
+  std::map<std::string, Stats> stats;
+  std::shared_lock<std::shared_mutex> guard(mu_);
+  for (const auto &[ns, entry] : entries_) {
+    stats[ns] = Stats{entry->quota, entry->throttled_ops, entry->throttled_reads, entry->throttled_writes};
+  }
+  return stats;
+}
+
+Status NamespaceFairQueue::Push(const std::string &ns, uint32_t weight, Task task) {
+  std::lock_guard<std::mutex> guard(mu_);
+  if (size_ >= capacity_) return {Status::NotOK, "Task number limit is exceeded"};
+
+  auto &flow = flows_[ns];
+  auto finish = std::max(virtual_time_, flow.last_finish) + kTaskCost / std::max(weight, 1U);
+  flow.last_finish = finish;
+  flow.tasks.emplace_back(finish, std::move(task));
+  size_++;
+  return Status::OK();
+}
+
+Task NamespaceFairQueue::Pop() {
+  std::lock_guard<std::mutex> guard(mu_);
+  auto next = flows_.end();
+  for (auto iter = flows_.begin(); iter != flows_.end(); ++iter) {
+    if (next == flows_.end() || iter->second.tasks.front().first < next->second.tasks.front().first) next = iter;
+  }
+  if (next == flows_.end()) return {};
+
+  auto &tasks = next->second.tasks;
+  virtual_time_ = tasks.front().first;
+  auto task = std::move(tasks.front().second);
+  tasks.pop_front();
+  // the last finish time of a drained flow is the virtual time now, so it's safe to forget
+  if (tasks.empty()) flows_.erase(next);
+  size_--;
+  return task;
+}
+
+size_t NamespaceFairQueue::Size() const {
+  std::lock_guard<std::mutex> guard(mu_);
+  return size_;
+}
@@ -0,0 +1,121 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "config/config.h"
+#include "status.h"
+#include "task_runner.h"
+
+// NamespaceQuotas enforces the throughput quotas of the namespaces, see namespace-quotas.
+//
+// Each limit of a namespace is a token bucket refilled at the limit per second, which holds
+// at most one second of tokens. A command takes one token of the ops bucket before it runs,
+// and the bytes it read or wrote are charged after it's done since they aren't known before.
+// So the byte buckets may go into debt, and the commands are throttled until it's paid off.
+class NamespaceQuotas {
+ public:
+  struct Stats {
+    NamespaceQuota quota;
+    uint64_t throttled_ops = 0;
+    uint64_t throttled_reads = 0;
+    uint64_t throttled_writes = 0;
+  };
+
+  void Reset(const std::map<std::string, NamespaceQuota> &quotas);
+  // HasQuotas is false if no namespace has a quota, so that the commands skip the quotas at once
+  bool HasQuotas() const { return n_quotas_.load(std::memory_order_relaxed) > 0; }
+  bool HasQuota(const std::string &ns) const;
+  // Admit takes a token for a command of the namespace, false means the command should be throttled
+  bool Admit(const std::string &ns, bool is_write);
+  void Charge(const std::string &ns, uint64_t read_bytes, uint64_t write_bytes);
+  uint32_t GetWeight(const std::string &ns) const;
+  std::map<std::string, Stats> GetStats() const;
+
+ private:
+  struct TokenBucket {
+    double rate = 0;
+    double tokens = 0;
+
+    bool Unlimited() const { return rate == 0; }
+    void Refill(double elapsed_secs) { tokens = std::min(rate, tokens + rate * elapsed_secs); }
+  };
+
+  struct Entry {
+    NamespaceQuota quota;
+    std::mutex mu;
+    uint64_t last_refill_us = 0;
+    TokenBucket ops;
+    TokenBucket read_bytes;
+    TokenBucket write_bytes;
+    std::atomic<uint64_t> throttled_ops = 0;
+    std::atomic<uint64_t> throttled_reads = 0;
+    std::atomic<uint64_t> throttled_writes = 0;
+
+    void Refill(uint64_t now_us);
+  };
+
+  mutable std::shared_mutex mu_;
+  std::map<std::string, std::unique_ptr<Entry>> entries_;
+  std::atomic<size_t> n_quotas_ = 0;
+};
+
+// NamespaceFairQueue orders the tasks of the namespaces by weighted fair queuing instead of FIFO.
+//
+// Each task is stamped with a virtual finish time, which is the later of the current virtual time
+// and the finish time of the previous task of its namespace, plus a cost inversely proportional to
+// the weight of the namespace. The task with the earliest finish time goes first, so a namespace
+// flooding the queue only delays its own tasks, and the namespaces share the consumers by weight.
+class NamespaceFairQueue {
+ public:
+  static constexpr uint64_t kTaskCost = 1 << 16;
+
+  explicit NamespaceFairQueue(size_t capacity) : capacity_(capacity) {}
+
+  Status Push(const std::string &ns, uint32_t weight, Task task);
+  // Pop returns an empty task if the queue is empty
+  Task Pop();
+  size_t Size() const;
+
+ private:
+  struct Flow {
+    uint64_t last_finish = 0;
+    std::deque<std::pair<uint64_t, Task>> tasks;
+  };
+
+  mutable std::mutex mu_;
+  size_t capacity_;
+  size_t size_ = 0;
+  uint64_t virtual_time_ = 0;
+  std::map<std::string, Flow> flows_;
+};
@@ -0,0 +1,165 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "pubsub_registry.h"
+
+#include <algorithm>
+
+#include "string_util.h"
+
+std::string_view PubSubRegistry::literalPrefix(const std::string &pattern) {
+  auto pos = pattern.find_first_of("*?[\\");
+  return std::string_view(pattern).substr(0, pos);
+}
+
+bool PubSubRegistry::mayMatchKeyspace(std::string_view prefix) {
+  constexpr std::string_view keyspace_prefix = "__key";
+  auto len = std::min(prefix.size(), keyspace_prefix.size());
+  return prefix.substr(0, len) == keyspace_prefix.substr(0, len);
+}
+
+bool PubSubRegistry::removeSubscriber(Subscribers *subscribers, const Worker *owner, int fd) {
+  auto iter = std::find_if(subscribers->begin(), subscribers->end(),
+                           [&](const Subscriber &s) { return s.owner == owner && s.fd == fd; });
+  if (iter == subscribers->end()) return false;
+
+  *iter = subscribers->back();
+  subscribers->pop_back();
+  return true;
+}
+
+void PubSubRegistry::Subscribe(const std::string &channel, Subscriber subscriber) {
+  auto &shard = shardOf(channel);
+  std::lock_guard<std::mutex> guard(shard.mutex);
+
+  auto &subscribers = shard.channels[channel];
+  if (subscribers.empty() && mayMatchKeyspace(channel)) n_keyspace_subscriptions_++;
+  subscribers.emplace_back(subscriber);
+}
+
+void PubSubRegistry::Unsubscribe(const std::string &channel, const Worker *owner, int fd) {
+  auto &shard = shardOf(channel);
+  std::lock_guard<std::mutex> guard(shard.mutex);
+
+  auto iter = shard.channels.find(channel);
+  if (iter == shard.channels.end()) return;
+
+  removeSubscriber(&iter->second, owner, fd);
+  if (!iter->second.empty()) return;
+  shard.channels.erase(iter);
+  if (mayMatchKeyspace(channel)) n_keyspace_subscriptions_--;
+}
+
+void PubSubRegistry::PSubscribe(const std::string &pattern, Subscriber subscriber) {
+  std::unique_lock<std::shared_mutex> guard(patterns_mu_);
+
+  auto prefix = literalPrefix(pattern);
+  auto &subscribers = patterns_[std::string(prefix)][pattern];
+  if (subscribers.empty()) {
+    n_patterns_++;
+    if (mayMatchKeyspace(prefix)) n_keyspace_subscriptions_++;
+  }
+  subscribers.emplace_back(subscriber);
+}
+
+void PubSubRegistry::PUnsubscribe(const std::string &pattern, const Worker *owner, int fd) {
+  std::unique_lock<std::shared_mutex> guard(patterns_mu_);
+
+  auto prefix = literalPrefix(pattern);
+  auto prefix_iter = patterns_.find(prefix);
+  if (prefix_iter == patterns_.end()) return;
+  auto iter = prefix_iter->second.find(pattern);
+  if (iter == prefix_iter->second.end()) return;
+
+  removeSubscriber(&iter->second, owner, fd);
+  if (!iter->second.empty()) return;
+  prefix_iter->second.erase(iter);
+  n_patterns_--;
+  if (mayMatchKeyspace(prefix)) n_keyspace_subscriptions_--;
+  if (prefix_iter->second.empty()) patterns_.erase(prefix_iter);
+}
+
+PubSubRegistry::Matches PubSubRegistry::Match(const std::string &channel) const {
+  Matches matches;
+
+  {
+    const auto &shard = shardOf(channel);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    if (auto iter = shard.channels.find(channel); iter != shard.channels.end()) {
+      for (const auto &subscriber : iter->second) {
+        matches.subscribers[subscriber.owner].emplace_back(subscriber.fd, kChannelMatch);
+      }
+    }
+  }
+
+  std::shared_lock<std::shared_mutex> guard(patterns_mu_);
+  // A pattern can only match the channel if its literal prefix is a prefix of the channel
+  for (size_t len = 0; len <= channel.size(); len++) {
+    auto prefix_iter = patterns_.find(std::string_view(channel).substr(0, len));
+    if (prefix_iter == patterns_.end()) continue;
+
+    for (const auto &[pattern, subscribers] : prefix_iter->second) {
+      if (!util::StringMatch(pattern, channel, 0)) continue;
+
+      matches.patterns.emplace_back(pattern);
+      for (const auto &subscriber : subscribers) {
+        matches.subscribers[subscriber.owner].emplace_back(subscriber.fd, matches.patterns.size());
+      }
+    }
+  }
+
+  return matches;
+}
+
+std::vector<std::string> PubSubRegistry::GetChannels(const std::string &pattern) const {
+  std::vector<std::string> channels;
+  for (const auto &shard : shards_) {
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    for (const auto &[channel, _] : shard.channels) {
+      if (pattern.empty() || util::StringMatch(pattern, channel, 0)) {
+        channels.emplace_back(channel);
+      }
+    }
+  }
+  std::sort(channels.begin(), channels.end());
+  return channels;
+}
+
+size_t PubSubRegistry::GetSubscribeNum(const std::string &channel) const {
+  const auto &shard = shardOf(channel);
+  std::lock_guard<std::mutex> guard(shard.mutex);
+
+  auto iter = shard.channels.find(channel);
+  return iter == shard.channels.end() ? 0 : iter->second.size();
+}
+
+size_t PubSubRegistry::GetChannelSize() const {
+  size_t size = 0;
+  for (const auto &shard : shards_) {
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    size += shard.channels.size();
+  }
+  return size;
+}
+
+size_t PubSubRegistry::GetPatternSize() const {
+  std::shared_lock<std::shared_mutex> guard(patterns_mu_);
+  return n_patterns_;
+}
@@ -0,0 +1,100 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+class Worker;
+
+// PubSubRegistry tracks the connections subscribed to channels and patterns by SUBSCRIBE and PSUBSCRIBE.
+//
+// The channels are kept in shards by name, so subscribing to and publishing on different channels don't
+// contend. The patterns are indexed by their literal prefixes before the first wildcard, so a message only
+// tests the patterns whose prefixes are prefixes of its channel, instead of all the patterns. The matched
+// subscribers are grouped by their workers, so that each worker takes the replies of a message at once.
+class PubSubRegistry {
+ public:
+  static constexpr size_t kShards = 16;
+  // The pattern index of the subscribers of the channel itself
+  static constexpr size_t kChannelMatch = 0;
+
+  struct Subscriber {
+    Worker *owner;
+    int fd;
+  };
+
+  struct Matches {
+    // The matched patterns, whose indexes start from 1 in the subscribers
+    std::vector<std::string> patterns;
+    // The fds of the matched subscribers with the indexes of their patterns, grouped by their workers
+    std::map<Worker *, std::vector<std::pair<int, size_t>>> subscribers;
+  };
+
+  void Subscribe(const std::string &channel, Subscriber subscriber);
+  void Unsubscribe(const std::string &channel, const Worker *owner, int fd);
+  void PSubscribe(const std::string &pattern, Subscriber subscriber);
+  void PUnsubscribe(const std::string &pattern, const Worker *owner, int fd);
+
+  Matches Match(const std::string &channel) const;
+  // Get the channels matched by the pattern in order, all the channels if the pattern is empty
+  std::vector<std::string> GetChannels(const std::string &pattern) const;
+  size_t GetSubscribeNum(const std::string &channel) const;
+  size_t GetChannelSize() const;
+  size_t GetPatternSize() const;
+  // HasKeyspaceSubscribers is false if no channel or pattern can match the keyspace notifications,
+  // so that they are skipped without being formatted
+  bool HasKeyspaceSubscribers() const { return n_keyspace_subscriptions_.load(std::memory_order_relaxed) > 0; }
+
+ private:
+  using Subscribers = std::vector<Subscriber>;
+
+  struct alignas(64) Shard {
+    mutable std::mutex mutex;
+    std::map<std::string, Subscribers> channels;
+  };
+
+  std::array<Shard, kShards> shards_;
+
+  mutable std::shared_mutex patterns_mu_;
+  // The patterns grouped by their literal prefixes
+  std::map<std::string, std::map<std::string, Subscribers>, std::less<>> patterns_;
+  size_t n_patterns_ = 0;
+  // The number of the channels and patterns which may match __keyspace@...__ and __keyevent@...__
+  std::atomic<size_t> n_keyspace_subscriptions_ = 0;
+
+  Shard &shardOf(const std::string &channel) { return shards_[std::hash<std::string>{}(channel) % kShards]; }
+  const Shard &shardOf(const std::string &channel) const {
+    return shards_[std::hash<std::string>{}(channel) % kShards];
+  }
+  static std::string_view literalPrefix(const std::string &pattern);
+  static bool mayMatchKeyspace(std::string_view prefix);
+  static bool removeSubscriber(Subscribers *subscribers, const Worker *owner, int fd);
+};
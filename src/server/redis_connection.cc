@@ -22,9 +22,11 @@
 #include <rocksdb/iostats_context.h>
 #include <rocksdb/perf_context.h>
 
+#include <chrono>
 #include <mutex>
 #include <shared_mutex>
 
+#include "alloc_util.h"
 #include "commands/commander.h"
 #include "commands/error_constants.h"
 #include "fmt/format.h"
@@ -42,6 +44,7 @@
 #include "server.h"
 #include "time_util.h"
 #include "tls_util.h"
+#include "types/redis_string.h"
 #include "worker.h"
 
 namespace redis {
@@ -53,7 +56,11 @@ Connection::Connection(bufferevent *bev, Worker *owner)
   last_interaction_ = now;
 }
 
-Connection::~Connection() {
+Connection::~Connection() { Release(); }
+
+void Connection::Release() {
+  // the streaming reply is unregistered from the server before its buffer event is freed
+  if (streaming_reply_) FinishStreamingReply();
   if (bev_) {
     if (need_free_bev_) {
       bufferevent_free(bev_);
@@ -61,16 +68,96 @@ Connection::~Connection() {
       // cleanup event callbacks here to prevent using Connection's resource
       bufferevent_setcb(bev_, nullptr, nullptr, nullptr, nullptr);
     }
+    bev_ = nullptr;
   }
   // unsubscribe all channels and patterns if exists
   UnsubscribeAll();
   PUnsubscribeAll();
+  // the registry mustn't keep the object, which may be reused by another client
+  SUnsubscribeAll();
+  srv_->DisableTracking(this);
+}
+
+void Connection::Reset(bufferevent *bev, Worker *owner) {
+  // the members are reset to the values of a new connection, and the containers keep their capacity
+  id_ = 0;
+  flags_ = 0;
+  ns_.clear();
+  name_.clear();
+  ip_.clear();
+  announce_ip_.clear();
+  port_ = 0;
+  addr_.clear();
+  listening_port_ = 0;
+  repl_compression_ = util::CompressionType::kNone;
+  repl_ack_ = false;
+  last_write_seq_ = 0;
+  is_admin_ = false;
+  need_free_bev_ = true;
+  last_cmd_.clear();
+  int64_t now = util::GetTimeStamp();
+  create_time_ = now;
+  last_interaction_ = now;
+
+  bev_ = bev;
+  req_.Reset();
+  owner_ = owner;
+  busy_us_ = 0;
+  taken_busy_us_ = 0;
+  total_commands_ = 0;
+  total_cpu_us_ = 0;
+  total_read_bytes_ = 0;
+  total_net_in_bytes_ = 0;
+  total_net_out_bytes_ = 0;
+  last_migrated_us_ = 0;
+  saved_current_command_.reset();
+  heavy_command_ctx_.reset();
+  streaming_reply_ = false;
+  subscribe_channels_.clear();
+  subscribe_patterns_.clear();
+  subscribe_shard_channels_.clear();
+  in_exec_ = false;
+  multi_error_ = false;
+  is_running_ = false;
+  multi_cmds_.clear();
+  exec_concurrently_ = false;
+  exec_lock_keys_.clear();
+  importing_ = false;
+  protocol_version_ = RESP::v2;
+
+  close_cb = nullptr;
+  watched_keys.clear();
+  watched_global_version = 0;
+  tracking.reset();
+  tracking_caching.reset();
 }
 
 std::string Connection::ToString() {
-  return fmt::format("id={} addr={} fd={} name={} age={} idle={} flags={} namespace={} qbuf={} obuf={} cmd={}\n", id_,
-                     addr_, bufferevent_getfd(bev_), name_, GetAge(), GetIdleTime(), GetFlags(), ns_,
-                     evbuffer_get_length(Input()), evbuffer_get_length(Output()), last_cmd_);
+  return fmt::format(
+      "id={} addr={} fd={} name={} age={} idle={} flags={} namespace={} qbuf={} obuf={} cmd={} tot-cmds={} "
+      "tot-cpu-us={} tot-read-bytes={} tot-net-in={} tot-net-out={}\n",
+      id_, addr_, bufferevent_getfd(bev_), name_, GetAge(), GetIdleTime(), GetFlags(), ns_,
+      evbuffer_get_length(Input()), evbuffer_get_length(Output()), last_cmd_, total_commands_, total_cpu_us_,
+      total_read_bytes_, total_net_in_bytes_, total_net_out_bytes_);
+}
+
+uint64_t Connection::GetResourceUsage(Resource resource) {
+  switch (resource) {
+    case kResourceCommands:
+      return total_commands_;
+    case kResourceCPU:
+      return total_cpu_us_;
+    case kResourceReadBytes:
+      return total_read_bytes_;
+    case kResourceNetIn:
+      return total_net_in_bytes_;
+    case kResourceNetOut:
+      return total_net_out_bytes_;
+    case kResourceOutput:
+      return evbuffer_get_length(Output());
+  }
+
+  __builtin_unreachable();
 }
 
 void Connection::Close() {
@@ -85,7 +172,11 @@ void Connection::OnRead([[maybe_unused]] struct bufferevent *bev) {
   MakeScopeExit([this] { is_running_ = false; });
 
   SetLastInteraction();
+  auto start = std::chrono::steady_clock::now();
+  auto cpu_start = util::GetThreadCPUTimeUS();
+  auto input_bytes = evbuffer_get_length(Input());
   auto s = req_.Tokenize(Input());
+  total_net_in_bytes_ += input_bytes - evbuffer_get_length(Input());
   if (!s.IsOK()) {
     EnableFlag(redis::Connection::kCloseAfterReply);
     Reply(redis::Error(s));
@@ -94,6 +185,10 @@ void Connection::OnRead([[maybe_unused]] struct bufferevent *bev) {
   }
 
   ExecuteCommands(req_.GetCommands());
+  auto busy_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+  busy_us_ += busy_us.count();
+  total_cpu_us_ += util::GetThreadCPUTimeUS() - cpu_start;
+  owner_->AddBusyTime(busy_us.count());
   if (IsFlagEnabled(kCloseAsync)) {
     Close();
   }
@@ -131,9 +226,16 @@ void Connection::OnEvent(bufferevent *bev, int16_t events) {
 
 void Connection::Reply(const std::string &msg) {
   owner_->srv->stats.IncrOutboundBytes(msg.size());
+  total_net_out_bytes_ += msg.size();
   redis::Reply(bufferevent_get_output(bev_), msg);
 }
 
+void Connection::Reply(std::string &&msg) {
+  owner_->srv->stats.IncrOutboundBytes(msg.size());
+  total_net_out_bytes_ += msg.size();
+  redis::Reply(bufferevent_get_output(bev_), std::move(msg));
+}
+
 void Connection::SendFile(int fd) {
   // NOTE: we don't need to close the fd, the libevent will do that
   auto output = bufferevent_get_output(bev_);
@@ -188,7 +290,109 @@ bool Connection::CanMigrate() const {
   return !is_running_                                                    // reading or writing
          && !IsFlagEnabled(redis::Connection::kCloseAfterReply)          // close after reply
          && saved_current_command_ == nullptr                            // not executing blocking command like BLPOP
-         && subscribe_channels_.empty() && subscribe_patterns_.empty();  // not subscribing any channel
+         && subscribe_channels_.empty() && subscribe_patterns_.empty()   // not subscribing any channel
+         && !tracking;                                                   // not tracking keys
+}
+
+void Connection::FinishHeavyCommand() {
+  heavy_command_ctx_.reset();
+  saved_current_command_.reset();
+}
+
+std::unique_ptr<Commander> Connection::takeCommander(const CommandAttributes *attributes) {
+  std::unique_ptr<Commander> cmd;
+  if (attributes->id < cmd_cache_.size()) cmd = std::move(cmd_cache_[attributes->id]);
+  if (!cmd) cmd = attributes->factory();
+  cmd->SetAttributes(attributes);
+  return cmd;
+}
+
+void Connection::recycleCommander(std::unique_ptr<Commander> cmd) {
+  if (!cmd) return;
+
+  const auto *attributes = cmd->GetAttributes();
+  if (attributes->id >= cmd_cache_.size()) cmd_cache_.resize(CommandTable::Size());
+  // The nested commands of EXEC may have filled the slot already
+  if (cmd_cache_[attributes->id]) return;
+  // Reset it right away, so it doesn't hold the memory of this invocation
+  attributes->recycler(cmd.get());
+  cmd_cache_[attributes->id] = std::move(cmd);
+}
+
+void Connection::FinishStreamingReply() {
+  streaming_reply_ = false;
+  saved_current_command_.reset();
+}
+
+bool Connection::isWriteStalled() const {
+  auto policy = srv_->GetConfig()->write_stall_policy;
+  if (policy == kWriteStallWait) return false;
+
+  auto condition = srv_->storage->GetWriteStallCondition();
+  if (condition == rocksdb::WriteStallCondition::kStopped) return true;
+  return policy == kWriteStallRejectDelayed && condition == rocksdb::WriteStallCondition::kDelayed;
+}
+
+bool Connection::isHeavyCommand(Commander *cmd, uint64_t cmd_flags) {
+  if (cmd_flags & kCmdHeavy) return true;
+  auto threshold = static_cast<uint64_t>(srv_->GetConfig()->heavy_command_cost_threshold);
+  return cmd->EstimateCost(srv_, this) >= threshold;
+}
+
+// EXEC can run without the global exclusivity if it can lock every key its commands touch upfront.
+// Collects the keys to lock on success.
+bool Connection::canExecConcurrently() {
+  exec_concurrently_ = false;
+  exec_lock_keys_.clear();
+
+  auto config = srv_->GetConfig();
+  if (!config->txn_concurrent_exec || !IsFlagEnabled(kMultiExec) || multi_error_) return false;
+  // A key could be modified after the check of WATCH and before it is locked
+  if (!watched_keys.empty()) return false;
+  // Index recording touches keys out of the commands
+  if (!srv_->index_mgr.index_map.empty()) return false;
+
+  std::vector<std::string> keys;
+  for (const auto &cmd_tokens : multi_cmds_) {
+    const auto *attributes = CommandTable::Lookup(cmd_tokens.front());
+    if (!attributes) return false;
+
+    auto cmd_flags = attributes->GenerateFlags(cmd_tokens);
+    if (cmd_flags & (kCmdExclusive | kCmdROScript)) return false;
+
+    bool has_keys = false;
+    attributes->ForEachKeyRange(
+        [&, this](const std::vector<std::string> &args, const CommandKeyRange &key_range) {
+          key_range.ForEachKey(
+              [&, this](const std::string &key) {
+                keys.emplace_back(ComposeNamespaceKey(ns_, key, srv_->storage->IsSlotIdEncoded()));
+                has_keys = true;
+              },
+              args);
+        },
+        cmd_tokens);
+    if ((cmd_flags & kCmdWrite) && !has_keys) return false;
+  }
+
+  exec_lock_keys_ = std::move(keys);
+  exec_concurrently_ = true;
+  return true;
+}
+
+// A write script can run without the global exclusivity if it declares the keys it touches,
+// they're locked while it runs instead, and the access to the other keys is rejected, see lua::RedisGenericCommand.
+bool Connection::canRunScriptConcurrently(uint64_t cmd_flags, const std::vector<std::string> &cmd_tokens) {
+  if (!(cmd_flags & kCmdScript) || !srv_->GetConfig()->script_lock_declared_keys) return false;
+  // Index recording touches keys out of the commands
+  if (!srv_->index_mgr.index_map.empty()) return false;
+
+  // The scripts without declared keys are run exclusively as before, since they may access any key
+  if (cmd_tokens.size() < 3) return false;
+  auto numkeys = ParseInt<int64_t>(cmd_tokens[2], 10);
+  if (!numkeys || *numkeys <= 0 || *numkeys > static_cast<int64_t>(cmd_tokens.size() - 3)) return false;
+
+  script_concurrently_ = true;
+  return true;
 }
 
 void Connection::SubscribeChannel(const std::string &channel) {
@@ -336,31 +540,250 @@ void Connection::RecordProfilingSampleIfNeed(const std::string &cmd, uint64_t du
   rocksdb::SetPerfLevel(rocksdb::PerfLevel::kDisable);
   if (perf_context.empty()) return;  // request without db operation
 
-  auto entry = std::make_unique<PerfEntry>();
-  entry->cmd_name = cmd;
-  entry->duration = duration;
-  entry->iostats_context = std::move(iostats_context);
-  entry->perf_context = std::move(perf_context);
+  PerfEntry entry;
+  entry.cmd_name = cmd;
+  entry.duration = duration;
+  entry.iostats_context = std::move(iostats_context);
+  entry.perf_context = std::move(perf_context);
   srv_->GetPerfLog()->PushEntry(std::move(entry));
 }
 
+// One of every `profiling-stats-sample-interval` commands executed by a thread is sampled
+static bool IsPerfStatsSampling(const Config *config) {
+  if (config->profiling_stats_sample_interval <= 0) return false;
+
+  thread_local uint64_t executed_commands = 0;
+  return executed_commands++ % config->profiling_stats_sample_interval == 0;
+}
+
+static PerfSample GetPerfSample() {
+  const auto *perf = rocksdb::get_perf_context();
+  const auto *iostats = rocksdb::get_iostats_context();
+
+  PerfSample sample{};
+  sample[STATS_PERF_BLOCK_CACHE_HIT] = perf->block_cache_hit_count;
+  sample[STATS_PERF_BLOCK_READ] = perf->block_read_count;
+  sample[STATS_PERF_BLOCK_READ_BYTES] = perf->block_read_byte;
+  sample[STATS_PERF_BLOCK_READ_US] = perf->block_read_time / 1000;
+  sample[STATS_PERF_MEMTABLE_GET] = perf->get_from_memtable_count;
+  sample[STATS_PERF_MEMTABLE_SEEK] = perf->seek_on_memtable_count;
+  sample[STATS_PERF_INTERNAL_KEY_SKIPPED] = perf->internal_key_skipped_count;
+  sample[STATS_PERF_INTERNAL_DELETE_SKIPPED] = perf->internal_delete_skipped_count;
+  sample[STATS_PERF_WRITE_WAL_US] = perf->write_wal_time / 1000;
+  sample[STATS_PERF_WRITE_MEMTABLE_US] = perf->write_memtable_time / 1000;
+  sample[STATS_PERF_IO_READ_BYTES] = iostats->bytes_read;
+  return sample;
+}
+
+void Connection::AddCommandUsage(const CommandUsage &usage) {
+  total_commands_ += usage.commands;
+  total_read_bytes_ += usage.read_bytes;
+  if (usage.write_seq > 0) last_write_seq_ = usage.write_seq;
+}
+
 Status Connection::ExecuteCommand(const std::string &cmd_name, const std::vector<std::string> &cmd_tokens,
-                                  Commander *current_cmd, std::string *reply) {
-  srv_->stats.IncrCalls(cmd_name);
+                                  Commander *current_cmd, std::string *reply, CommandUsage *usage) {
+  srv_->stats.IncrCalls(current_cmd->GetAttributes()->id);
 
   auto start = std::chrono::high_resolution_clock::now();
   bool is_profiling = IsProfilingEnabled(cmd_name);
+  bool is_perf_sampling = IsPerfStatsSampling(srv_->GetConfig());
+  if (is_perf_sampling && !is_profiling) {
+    rocksdb::SetPerfLevel(rocksdb::PerfLevel::kEnableTimeExceptForMutex);
+    rocksdb::get_perf_context()->Reset();
+    rocksdb::get_iostats_context()->Reset();
+  }
+  auto alloc_start = util::ThreadAllocatedBytes();
+  // The bytes read by the commands of EXEC are counted by EXEC itself. The IO stats are counted regardless of
+  // the perf level, but may be reset by the perf sampling of a nested command.
+  bool count_read_bytes = !in_exec_;
+  auto read_bytes_start = rocksdb::get_iostats_context()->bytes_read;
+  srv_->TrackReadKeys(this, cmd_tokens, *current_cmd->GetAttributes());
   auto s = current_cmd->Execute(srv_, this, reply);
   auto end = std::chrono::high_resolution_clock::now();
+  uint64_t alloc_bytes = util::ThreadAllocatedBytes() - alloc_start;
+  CommandUsage cmd_usage;
+  cmd_usage.commands = 1;
+  if (auto read_bytes_end = rocksdb::get_iostats_context()->bytes_read;
+      count_read_bytes && read_bytes_end >= read_bytes_start) {
+    cmd_usage.read_bytes = read_bytes_end - read_bytes_start;
+  }
+  if (s.IsOK() && (current_cmd->GetAttributes()->GenerateFlags(cmd_tokens) & kCmdWrite)) {
+    cmd_usage.write_seq = srv_->storage->LatestSeqNumber();
+  }
+  if (usage) {
+    *usage = cmd_usage;
+  } else {
+    AddCommandUsage(cmd_usage);
+  }
   uint64_t duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+  PerfSample perf_sample{};
+  if (is_perf_sampling) {
+    perf_sample = GetPerfSample();
+    srv_->stats.RecordPerfSample(current_cmd->GetAttributes()->id, perf_sample);
+    if (!is_profiling) rocksdb::SetPerfLevel(rocksdb::PerfLevel::kDisable);
+  }
   if (is_profiling) RecordProfilingSampleIfNeed(cmd_name, duration);
 
-  srv_->SlowlogPushEntryIfNeeded(&cmd_tokens, duration, this);
-  srv_->stats.IncrLatency(static_cast<uint64_t>(duration), cmd_name);
+  srv_->SlowlogPushEntryIfNeeded(&cmd_tokens, duration, this, is_perf_sampling ? &perf_sample : nullptr,
+                                 alloc_bytes);
+  srv_->stats.IncrLatency(static_cast<uint64_t>(duration), current_cmd->GetAttributes()->id);
+  srv_->stats.RecordAllocation(alloc_bytes, current_cmd->GetAttributes()->id);
+  if (srv_->GetConfig()->latency_tracking) {
+    srv_->stats.RecordLatency(duration, current_cmd->GetAttributes()->id);
+    if (!importing_) srv_->stats.foreground_latency_histogram.Record(duration);
+  }
   srv_->FeedMonitorConns(this, cmd_tokens);
   return s;
 }
 
+// Only GET is batched so far: it is a single metadata read, so a run of them maps onto one MultiGet.
+static bool IsCmdForBatchedRead(const CommandAttributes *attr, const CommandTokens &cmd_tokens) {
+  return attr->name == "get" && cmd_tokens.size() == 2;
+}
+
+size_t Connection::ExecuteBatchedReads(std::deque<CommandTokens> *to_process_cmds) {
+  const Config *config = srv_->GetConfig();
+  auto max_batch_size = static_cast<size_t>(config->pipeline_batch_read_size);
+  if (max_batch_size < 2 || to_process_cmds->size() < 2) return 0;
+
+  // Anything that changes how a single command is admitted goes through the regular path
+  if (GetNamespace().empty() || IsFlagEnabled(kMultiExec) || IsFlagEnabled(kCloseAfterReply) ||
+      IsFlagEnabled(kAsking) || srv_->IsLoading() || srv_->GetNamespaceQuotas()->HasQuota(ns_)) {
+    return 0;
+  }
+  if (!config->slave_serve_stale_data && srv_->IsSlave() && srv_->GetReplicationState() != kReplConnected) {
+    return 0;
+  }
+
+  const CommandAttributes *attributes = nullptr;
+  size_t batch_size = 0;
+  for (; batch_size < to_process_cmds->size() && batch_size < max_batch_size; batch_size++) {
+    const auto &cmd_tokens = (*to_process_cmds)[batch_size];
+    if (cmd_tokens.size() != 2) break;
+
+    const auto *cmd_attributes = CommandTable::Lookup(cmd_tokens.front());
+    if (!cmd_attributes || !IsCmdForBatchedRead(cmd_attributes, cmd_tokens)) break;
+    if (config->cluster_enabled && !srv_->cluster->CanExecByMySelf(cmd_attributes, cmd_tokens, this).IsOK()) break;
+    attributes = cmd_attributes;
+  }
+  if (batch_size < 2) return 0;
+
+  auto concurrency = srv_->WorkConcurrencyGuard();
+  std::vector<Slice> keys;
+  keys.reserve(batch_size);
+  for (size_t i = 0; i < batch_size; i++) {
+    keys.emplace_back((*to_process_cmds)[i][1]);
+    srv_->TrackReadKeys(this, (*to_process_cmds)[i], *attributes);
+    tracking_caching.reset();
+  }
+
+  // Every sampled GET gets a span of its own like the other commands, its execution is the MultiGet of the batch
+  std::vector<std::optional<CommandTrace>> traces(batch_size);
+  if (auto tracer = srv_->GetTracer(); tracer->IsRunning()) {
+    for (size_t i = 0; i < batch_size; i++) {
+      if (!trace_context && !Tracer::IsSampled(config->trace_sample_interval)) continue;
+      traces[i].emplace(tracer, trace_context ? &*trace_context : nullptr, attributes->name);
+      traces[i]->AddAttribute("db.system", "kvrocks");
+      traces[i]->AddAttribute("db.operation", attributes->name);
+      traces[i]->AddAttribute("kvrocks.batch_size", std::to_string(batch_size));
+      traces[i]->BeginStage("execute");
+    }
+  }
+
+  // Every GET counts towards the perf stats sampling interval, the sampled ones share the perf context of the batch
+  std::vector<bool> is_perf_sampling(batch_size);
+  bool has_perf_sampling = false;
+  for (size_t i = 0; i < batch_size; i++) {
+    is_perf_sampling[i] = IsPerfStatsSampling(config);
+    has_perf_sampling = has_perf_sampling || is_perf_sampling[i];
+  }
+
+  auto start = std::chrono::high_resolution_clock::now();
+  bool is_profiling = IsProfilingEnabled(attributes->name);
+  if (has_perf_sampling && !is_profiling) {
+    rocksdb::SetPerfLevel(rocksdb::PerfLevel::kEnableTimeExceptForMutex);
+    rocksdb::get_perf_context()->Reset();
+    rocksdb::get_iostats_context()->Reset();
+  }
+  auto alloc_start = util::ThreadAllocatedBytes();
+  auto read_bytes_start = rocksdb::get_iostats_context()->bytes_read;
+  std::vector<std::string> values;
+  redis::String string_db(srv_->storage, ns_);
+  engine::Context ctx(srv_->storage);
+  auto statuses = string_db.MGet(ctx, keys, &values);
+  auto end = std::chrono::high_resolution_clock::now();
+  // The allocations of the MultiGet are split evenly across the batch like its duration
+  uint64_t alloc_bytes = (util::ThreadAllocatedBytes() - alloc_start) / batch_size;
+  for (auto &trace : traces) {
+    if (trace) trace->EndStage();
+  }
+  // The bytes read by the MultiGet are counted once for the batch, and every GET as a command of its own
+  if (auto read_bytes_end = rocksdb::get_iostats_context()->bytes_read; read_bytes_end >= read_bytes_start) {
+    total_read_bytes_ += read_bytes_end - read_bytes_start;
+  }
+  uint64_t batch_duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+  uint64_t duration = batch_duration / batch_size;
+
+  PerfSample perf_sample{};
+  if (has_perf_sampling) {
+    perf_sample = GetPerfSample();
+    for (auto &counter : perf_sample) counter /= batch_size;
+    if (!is_profiling) rocksdb::SetPerfLevel(rocksdb::PerfLevel::kDisable);
+  }
+  if (is_profiling) RecordProfilingSampleIfNeed(attributes->name, batch_duration);
+
+  SetLastCmd(attributes->name);
+  // The batched commands are captured one by one like the others, so the replay keeps their order
+  auto capture = srv_->GetTrafficCapture();
+  bool is_captured = capture->IsRunning() && capture->IsSampled(id_);
+  std::string reply;
+  for (size_t i = 0; i < batch_size; i++) {
+    const auto &cmd_tokens = (*to_process_cmds)[i];
+    const auto &s = statuses[i];
+    if (is_captured) capture->Capture(id_, attributes, cmd_tokens);
+    if (s.IsInvalidArgument()) {
+      // the value may be a bitmap or of another type, let the command itself decide what to reply
+      auto current_cmd = attributes->factory();
+      current_cmd->SetAttributes(attributes);
+      current_cmd->SetArgs(cmd_tokens);
+      auto cmd_s = current_cmd->Parse();
+      if (cmd_s.IsOK()) cmd_s = ExecuteCommand(attributes->name, cmd_tokens, current_cmd.get(), &reply);
+      Reply(cmd_s.IsOK() ? reply : redis::Error(cmd_s));
+      reply.clear();
+      continue;
+    }
+
+    srv_->stats.IncrCalls(attributes->id);
+    total_commands_++;
+    if (s.ok()) {
+      Reply(redis::BulkString(values[i]));
+    } else if (s.IsNotFound()) {
+      Reply(NilString());
+    } else {
+      Reply(redis::Error({Status::RedisExecErr, s.ToString()}));
+    }
+    if (is_perf_sampling[i]) srv_->stats.RecordPerfSample(attributes->id, perf_sample);
+    // Every GET waits for the whole MultiGet, so a slow batch is logged with each of its commands
+    srv_->SlowlogPushEntryIfNeeded(&cmd_tokens, batch_duration, this, is_perf_sampling[i] ? &perf_sample : nullptr,
+                                   alloc_bytes);
+    srv_->stats.IncrLatency(duration, attributes->id);
+    srv_->stats.RecordAllocation(alloc_bytes, attributes->id);
+    if (config->latency_tracking) {
+      srv_->stats.RecordLatency(duration, attributes->id);
+      if (!importing_) srv_->stats.foreground_latency_histogram.Record(duration);
+    }
+    srv_->RecordHotKeys(ns_, cmd_tokens, *attributes);
+    srv_->FeedMonitorConns(this, cmd_tokens);
+    // the span of the command ends with its reply
+    traces[i].reset();
+  }
+
+  to_process_cmds->erase(to_process_cmds->begin(), to_process_cmds->begin() + static_cast<ptrdiff_t>(batch_size));
+  return batch_size;
+}
+
 static bool IsCmdForIndexing(const CommandAttributes *attr) {
   return (attr->flags & redis::kCmdWrite) &&
          (attr->category == CommandCategory::Hash || attr->category == CommandCategory::JSON ||
@@ -373,6 +796,8 @@ void Connection::ExecuteCommands(std::deque<CommandTokens> *to_process_cmds) {
   std::string password = config->requirepass;
 
   while (!to_process_cmds->empty()) {
+    if (ExecuteBatchedReads(to_process_cmds) > 0) continue;
+
     CommandTokens cmd_tokens = std::move(to_process_cmds->front());
     to_process_cmds->pop_front();
     if (cmd_tokens.empty()) continue;
@@ -380,8 +805,8 @@ void Connection::ExecuteCommands(std::deque<CommandTokens> *to_process_cmds) {
     bool is_multi_exec = IsFlagEnabled(Connection::kMultiExec);
     if (IsFlagEnabled(redis::Connection::kCloseAfterReply) && !is_multi_exec) break;
 
-    auto cmd_s = Server::LookupAndCreateCommand(cmd_tokens.front());
-    if (!cmd_s.IsOK()) {
+    const auto *cmd_attributes = CommandTable::Lookup(cmd_tokens.front());
+    if (!cmd_attributes) {
       if (is_multi_exec) multi_error_ = true;
       Reply(redis::Error(
           {Status::NotOK,
@@ -390,12 +815,23 @@ void Connection::ExecuteCommands(std::deque<CommandTokens> *to_process_cmds) {
                                         [](const auto &v) -> decltype(auto) { return fmt::format("`{}`", v); }))}));
       continue;
     }
-    auto current_cmd = std::move(*cmd_s);
+    auto current_cmd = takeCommander(cmd_attributes);
+    // The commander is reused by the next command of its type, unless it's saved for later like BLPOP
+    auto recycle_cmd = MakeScopeExit([this, &current_cmd] { recycleCommander(std::move(current_cmd)); });
 
     const auto &attributes = current_cmd->GetAttributes();
     auto cmd_name = attributes->name;
     auto cmd_flags = attributes->GenerateFlags(cmd_tokens);
 
+    // The stages of a traced command are the child spans of its span, which ends with the iteration
+    std::optional<CommandTrace> trace;
+    if (auto tracer = srv_->GetTracer();
+        tracer->IsRunning() && (trace_context || Tracer::IsSampled(config->trace_sample_interval))) {
+      trace.emplace(tracer, trace_context ? &*trace_context : nullptr, cmd_name);
+      trace->AddAttribute("db.system", "kvrocks");
+      trace->AddAttribute("db.operation", cmd_name);
+    }
+
     if (GetNamespace().empty()) {
       if (!password.empty()) {
         if (cmd_name != "auth" && cmd_name != "hello") {
@@ -408,28 +844,23 @@ void Connection::ExecuteCommands(std::deque<CommandTokens> *to_process_cmds) {
       }
     }
 
+    if (trace) trace->BeginStage("lock_wait");
     std::shared_lock<std::shared_mutex> concurrency;  // Allow concurrency
     std::unique_lock<std::shared_mutex> exclusivity;  // Need exclusivity
+    script_concurrently_ = false;
     // If the command needs to process exclusively, we need to get 'ExclusivityGuard'
     // that can guarantee other threads can't come into critical zone, such as DEBUG,
     // CLUSTER subcommand, CONFIG SET, MULTI, LUA (in the immediate future).
     // Otherwise, we just use 'ConcurrencyGuard' to allow all workers to execute commands at the same time.
     if (is_multi_exec && cmd_name != "exec") {
       // No lock guard, because 'exec' command has acquired 'WorkExclusivityGuard'
-    } else if (cmd_flags & kCmdExclusive) {
+    } else if ((cmd_flags & kCmdExclusive) && !(cmd_name == "exec" && canExecConcurrently()) &&
+               !canRunScriptConcurrently(cmd_flags, cmd_tokens)) {
       exclusivity = srv_->WorkExclusivityGuard();
-
-      // When executing lua script commands that have "exclusive" attribute, we need to know current connection,
-      // but we should set current connection after acquiring the WorkExclusivityGuard to make it thread-safe
-      srv_->SetCurrentConnection(this);
     } else {
       concurrency = srv_->WorkConcurrencyGuard();
     }
-
-    if (cmd_flags & kCmdROScript) {
-      // if executing read only lua script commands, set current connection.
-      srv_->SetCurrentConnection(this);
-    }
+    if (trace) trace->EndStage();
 
     if (srv_->IsLoading() && !(cmd_flags & kCmdLoading)) {
       Reply(redis::Error({Status::RedisLoading, errRestoringBackup}));
@@ -444,14 +875,20 @@ void Connection::ExecuteCommands(std::deque<CommandTokens> *to_process_cmds) {
       continue;
     }
 
+    if (trace) trace->BeginStage("parse");
     current_cmd->SetArgs(cmd_tokens);
     auto s = current_cmd->Parse();
+    if (trace) trace->EndStage();
     if (!s.IsOK()) {
       if (is_multi_exec) multi_error_ = true;
       Reply(redis::Error(s));
       continue;
     }
 
+    if (auto capture = srv_->GetTrafficCapture(); capture->IsRunning() && capture->IsSampled(id_)) {
+      capture->Capture(id_, attributes, cmd_tokens);
+    }
+
     if (is_multi_exec && (cmd_flags & kCmdNoMulti)) {
       Reply(redis::Error({Status::NotOK, "Can't execute " + cmd_name + " in MULTI"}));
       multi_error_ = true;
@@ -484,6 +921,11 @@ void Connection::ExecuteCommands(std::deque<CommandTokens> *to_process_cmds) {
       continue;
     }
 
+    if (srv_->storage->IsSecondary() && (cmd_flags & kCmdWrite)) {
+      Reply(redis::Error({Status::RedisReadOnly, "You can't write against a secondary instance."}));
+      continue;
+    }
+
     if ((cmd_flags & kCmdWrite) && !(cmd_flags & kCmdNoDBSizeCheck) && srv_->storage->ReachedDBSizeLimit()) {
       Reply(redis::Error({Status::NotOK, "write command not allowed when reached max-db-size."}));
       continue;
@@ -497,10 +939,44 @@ void Connection::ExecuteCommands(std::deque<CommandTokens> *to_process_cmds) {
       continue;
     }
 
+    if (config->secondary_max_lag_ms > 0 && srv_->storage->IsSecondary() && cmd_name != "info" &&
+        srv_->GetSecondaryLagMs() > static_cast<uint64_t>(config->secondary_max_lag_ms)) {
+      Reply(redis::Error({Status::RedisMasterDown, "The secondary instance lags behind the primary instance."}));
+      continue;
+    }
+
+    if (!in_exec_ && (cmd_flags & kCmdWrite) && isWriteStalled()) {
+      srv_->stats.stall_rejected_writes.fetch_add(1, std::memory_order_relaxed);
+      Reply(redis::Error({Status::RedisTryAgain, "writes are rejected while RocksDB stalls the writes"}));
+      continue;
+    }
+
+    if (!in_exec_ && !srv_->GetNamespaceQuotas()->Admit(ns_, (cmd_flags & kCmdWrite) != 0)) {
+      Reply(redis::Error({Status::RedisTryAgain, "the quota of the namespace is exceeded"}));
+      continue;
+    }
+
+    bool need_index_recording =
+        !srv_->index_mgr.index_map.empty() && IsCmdForIndexing(attributes) && !config->cluster_enabled;
+
+    // Hand heavy commands over to the heavy command pool, so they don't stall other connections of this worker.
+    // The connection is suspended until the command is done, and the saved command prevents it from migrating.
+    if (srv_->IsHeavyCommandPoolEnabled() && !is_multi_exec && !need_index_recording &&
+        !(cmd_flags & (kCmdExclusive | kCmdROScript)) && isHeavyCommand(current_cmd.get(), cmd_flags)) {
+      SetLastCmd(cmd_name);
+      heavy_command_ctx_ = std::make_unique<HeavyCommandContext>(srv_, this, current_cmd.get(), cmd_tokens);
+      if (heavy_command_ctx_->Start().IsOK()) {
+        saved_current_command_ = std::move(current_cmd);
+        break;
+      }
+      // The pool queue is full, just execute it in place
+      heavy_command_ctx_.reset();
+    }
+
     auto no_txn_ctx = engine::Context::NoTransactionContext(srv_->storage);
     // TODO: transaction support for index recording
     std::vector<GlobalIndexer::RecordResult> index_records;
-    if (!srv_->index_mgr.index_map.empty() && IsCmdForIndexing(attributes) && !config->cluster_enabled) {
+    if (need_index_recording) {
       attributes->ForEachKeyRange(
           [&, this](const std::vector<std::string> &args, const CommandKeyRange &key_range) {
             key_range.ForEachKey(
@@ -518,11 +994,16 @@ void Connection::ExecuteCommands(std::deque<CommandTokens> *to_process_cmds) {
     }
 
     SetLastCmd(cmd_name);
+    direct_cmd_ = is_multi_exec ? nullptr : current_cmd.get();
+    if (trace) trace->BeginStage("execute");
     s = ExecuteCommand(cmd_name, cmd_tokens, current_cmd.get(), &reply);
+    if (trace) trace->EndStage();
+    direct_cmd_ = nullptr;
 
     // TODO: transaction support for index updating
     for (const auto &record : index_records) {
-      auto s = GlobalIndexer::Update(no_txn_ctx, record);
+      auto s = config->search_async_indexing ? srv_->index_mgr.AppendDelta(no_txn_ctx, record)
+                                             : GlobalIndexer::Update(no_txn_ctx, record);
       if (!s.IsOK() && !s.Is<Status::TypeMismatched>()) {
         LOG(WARNING) << "index updating failed for key: " << record.key;
       }
@@ -546,9 +1027,22 @@ void Connection::ExecuteCommands(std::deque<CommandTokens> *to_process_cmds) {
     }
 
     srv_->UpdateWatchedKeysFromArgs(cmd_tokens, *attributes);
-
-    if (!reply.empty()) Reply(reply);
+    srv_->RecordHotKeys(ns_, cmd_tokens, *attributes);
+    srv_->NotifyKeyspaceEvents(ns_, cmd_tokens, *attributes);
+    srv_->UpdateTrackedKeys(this, cmd_tokens, *attributes);
+    srv_->ChargeNamespaceQuota(ns_, cmd_tokens, *attributes, reply.size());
+    if (attributes->name != "client") tracking_caching.reset();
+
+    if (trace) trace->BeginStage("reply");
+    if (!reply.empty()) Reply(std::move(reply));
     reply.clear();
+
+    // The rest of the reply is written by the command from the write callbacks,
+    // and the pipelined commands are resumed when it's done, like the blocking commands.
+    if (streaming_reply_) {
+      saved_current_command_ = std::move(current_cmd);
+      break;
+    }
   }
 }
 
@@ -556,6 +1050,8 @@ void Connection::ResetMultiExec() {
   in_exec_ = false;
   multi_error_ = false;
   multi_cmds_.clear();
+  exec_concurrently_ = false;
+  exec_lock_keys_.clear();
   DisableFlag(Connection::kMultiExec);
 }
 
@@ -23,16 +23,22 @@
 #include <event2/buffer.h>
 
 #include <deque>
+#include <map>
 #include <memory>
+#include <optional>
 #include <set>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "commands/commander.h"
+#include "compress_util.h"
 #include "event_util.h"
+#include "heavy_command_context.h"
 #include "redis_request.h"
 #include "server/redis_reply.h"
+#include "server/tracer.h"
+#include "server/tracking_table.h"
 
 class Worker;
 
@@ -56,6 +62,10 @@ class Connection : public EvbufCallbackBase<Connection> {
   Connection(const Connection &) = delete;
   Connection &operator=(const Connection &) = delete;
 
+  // Release frees the resources of the client, e.g. the buffer event and the subscriptions,
+  // and Reset prepares the released connection for a new client, see Worker::FreeConnection
+  void Release();
+  void Reset(bufferevent *bev, Worker *owner);
   void Close();
   void Detach();
   void OnRead(bufferevent *bev);
@@ -64,7 +74,19 @@ class Connection : public EvbufCallbackBase<Connection> {
   void SendFile(int fd);
   std::string ToString();
 
+  // The resources used by the client, which are counted by the owner worker, see CLIENT TOP
+  enum Resource {
+    kResourceCommands,
+    kResourceCPU,
+    kResourceReadBytes,
+    kResourceNetIn,
+    kResourceNetOut,
+    kResourceOutput,
+  };
+  uint64_t GetResourceUsage(Resource resource);
+
   void Reply(const std::string &msg);
+  void Reply(std::string &&msg);
   RESP GetProtocolVersion() const { return protocol_version_; }
   void SetProtocolVersion(RESP version) { protocol_version_ = version; }
   std::string Bool(bool b) const { return redis::Bool(protocol_version_, b); }
@@ -102,6 +124,7 @@ class Connection : public EvbufCallbackBase<Connection> {
     return redis::HeaderOfAttribute(len);
   }
   std::string HeaderOfPush(int64_t len) const { return redis::HeaderOfPush(protocol_version_, len); }
+  ReplyWriter Writer(std::string *output) const { return {protocol_version_, output}; }
 
   using UnsubscribeCallback = std::function<void(std::string, int)>;
   void SubscribeChannel(const std::string &channel);
@@ -136,6 +159,17 @@ class Connection : public EvbufCallbackBase<Connection> {
   uint32_t GetPort() const { return port_; }
   void SetListeningPort(int port) { listening_port_ = port; }
   int GetListeningPort() const { return listening_port_; }
+  // The compression of the incremental replication stream which the replica asked for by REPLCONF
+  void SetReplCompression(util::CompressionType type) { repl_compression_ = type; }
+  util::CompressionType GetReplCompression() const { return repl_compression_; }
+  // The replica acks the applied sequences if it asked for it by REPLCONF
+  void SetReplAck(bool enabled) { repl_ack_ = enabled; }
+  bool IsReplAckEnabled() const { return repl_ack_; }
+  // the monitor lines dropped for the connection, they are only counted by the monitor feed thread
+  void IncrMonitorDropped(uint64_t n) { monitor_dropped_ += n; }
+  uint64_t TakeMonitorDropped() { return std::exchange(monitor_dropped_, 0); }
+  // GetLastWriteSeq returns the latest sequence after the last write command, which WAIT waits for
+  uint64_t GetLastWriteSeq() const { return last_write_seq_; }
   void SetAnnounceIP(std::string ip) { announce_ip_ = std::move(ip); }
   std::string GetAnnounceIP() const { return !announce_ip_.empty() ? announce_ip_ : ip_; }
   uint32_t GetAnnouncePort() const { return listening_port_ != 0 ? listening_port_ : port_; }
@@ -155,18 +189,41 @@ class Connection : public EvbufCallbackBase<Connection> {
 
   Worker *Owner() { return owner_; }
   void SetOwner(Worker *new_owner) { owner_ = new_owner; };
+  // TakeRecentBusyTime returns the microseconds spent on the requests of the connection since it's called last time,
+  // i.e. since the last rebalance of the workers, they decide the connections to be migrated. It's only called in
+  // the owner thread
+  uint64_t TakeRecentBusyTime() {
+    auto busy_us = busy_us_ - taken_busy_us_;
+    taken_busy_us_ = busy_us_;
+    return busy_us;
+  }
+  uint64_t GetLastMigrated() const { return last_migrated_us_; }
+  void SetLastMigrated(uint64_t us) { last_migrated_us_ = us; }
   int GetFD() { return bufferevent_getfd(bev_); }
   evbuffer *Input() { return bufferevent_get_input(bev_); }
   evbuffer *Output() { return bufferevent_get_output(bev_); }
   bufferevent *GetBufferEvent() { return bev_; }
+  // The counters are only updated in the owner thread, see CommandUsage
+  void AddCommandUsage(const CommandUsage &usage);
+
   void ExecuteCommands(std::deque<CommandTokens> *to_process_cmds);
   Status ExecuteCommand(const std::string &cmd_name, const std::vector<std::string> &cmd_tokens, Commander *current_cmd,
-                        std::string *reply);
+                        std::string *reply, CommandUsage *usage = nullptr);
+  size_t ExecuteBatchedReads(std::deque<CommandTokens> *to_process_cmds);
   bool IsProfilingEnabled(const std::string &cmd);
   void RecordProfilingSampleIfNeed(const std::string &cmd, uint64_t duration);
   void SetImporting() { importing_ = true; }
   bool IsImporting() const { return importing_; }
   bool CanMigrate() const;
+  bool IsRunningHeavyCommand() const { return heavy_command_ctx_ != nullptr; }
+  void FinishHeavyCommand();
+  // Only the command executed right on the connection can stream its reply, see StreamingCommander
+  bool CanStreamReply(const Commander *cmd) const { return cmd != nullptr && cmd == direct_cmd_; }
+  void StartStreamingReply() { streaming_reply_ = true; }
+  void FinishStreamingReply();
+  // CanSuspend returns true if the command runs directly on the worker of the connection, see SuspendableCommander
+  bool CanSuspend(const Commander *cmd) const { return cmd != nullptr && cmd == direct_cmd_; }
+  void FinishSuspendedCommand() { saved_current_command_.reset(); }
 
   // Multi exec
   void SetInExec() { in_exec_ = true; }
@@ -174,11 +231,23 @@ class Connection : public EvbufCallbackBase<Connection> {
   bool IsMultiError() const { return multi_error_; }
   void ResetMultiExec();
   std::deque<redis::CommandTokens> *GetMultiExecCommands() { return &multi_cmds_; }
+  // The keys to lock for EXEC, or nullptr if it runs exclusively
+  const std::vector<std::string> *GetExecLockKeys() const { return exec_concurrently_ ? &exec_lock_keys_ : nullptr; }
+  // Whether the current write script runs without the exclusivity, locking its declared KEYS instead
+  bool IsScriptConcurrent() const { return script_concurrently_; }
 
   std::function<void(int)> close_cb = nullptr;
 
-  std::set<std::string> watched_keys;
-  std::atomic<bool> watched_keys_modified = false;
+  // WATCHed keys and their versions at WATCH time, see WatchedKeyTable
+  std::map<std::string, uint64_t> watched_keys;
+  uint64_t watched_global_version = 0;
+
+  // The options of CLIENT TRACKING if it's on, and the CLIENT CACHING for the next command
+  std::optional<TrackingOptions> tracking;
+  std::optional<bool> tracking_caching;
+
+  // The trace context set by CLIENT SETINFO TRACEPARENT, the commands are traced as its children
+  std::optional<TraceContext> trace_context;
 
  private:
   uint64_t id_ = 0;
@@ -190,6 +259,10 @@ class Connection : public EvbufCallbackBase<Connection> {
   uint32_t port_ = 0;
   std::string addr_;
   int listening_port_ = 0;
+  util::CompressionType repl_compression_ = util::CompressionType::kNone;
+  bool repl_ack_ = false;
+  uint64_t monitor_dropped_ = 0;
+  uint64_t last_write_seq_ = 0;
   bool is_admin_ = false;
   bool need_free_bev_ = true;
   std::string last_cmd_;
@@ -199,7 +272,21 @@ class Connection : public EvbufCallbackBase<Connection> {
   bufferevent *bev_;
   Request req_;
   Worker *owner_;
+  uint64_t busy_us_ = 0;
+  uint64_t taken_busy_us_ = 0;
+  uint64_t total_commands_ = 0;
+  uint64_t total_cpu_us_ = 0;
+  // the bytes read from the files by RocksDB
+  uint64_t total_read_bytes_ = 0;
+  uint64_t total_net_in_bytes_ = 0;
+  uint64_t total_net_out_bytes_ = 0;
+  uint64_t last_migrated_us_ = 0;
   std::unique_ptr<Commander> saved_current_command_;
+  std::unique_ptr<HeavyCommandContext> heavy_command_ctx_;
+  // The reusable commanders indexed by the command id, see takeCommander
+  std::vector<std::unique_ptr<Commander>> cmd_cache_;
+  Commander *direct_cmd_ = nullptr;
+  bool streaming_reply_ = false;
 
   std::vector<std::string> subscribe_channels_;
   std::vector<std::string> subscribe_patterns_;
@@ -210,9 +297,20 @@ class Connection : public EvbufCallbackBase<Connection> {
   bool multi_error_ = false;
   std::atomic<bool> is_running_ = false;
   std::deque<redis::CommandTokens> multi_cmds_;
+  bool exec_concurrently_ = false;
+  std::vector<std::string> exec_lock_keys_;
+  bool script_concurrently_ = false;
 
   bool importing_ = false;
   RESP protocol_version_ = RESP::v2;
+
+  bool isHeavyCommand(Commander *cmd, uint64_t cmd_flags);
+  // isWriteStalled tells whether the write commands should be rejected by write-stall-policy
+  bool isWriteStalled() const;
+  std::unique_ptr<Commander> takeCommander(const CommandAttributes *attributes);
+  void recycleCommander(std::unique_ptr<Commander> cmd);
+  bool canExecConcurrently();
+  bool canRunScriptConcurrently(uint64_t cmd_flags, const std::vector<std::string> &cmd_tokens);
 };
 
 }  // namespace redis
@@ -37,6 +37,20 @@ namespace redis {
 
 void Reply(evbuffer *output, const std::string &data) { evbuffer_add(output, data.c_str(), data.length()); }
 
+void Reply(evbuffer *output, std::string &&data) {
+  if (data.size() < REPLY_BY_REFERENCE_MIN_SIZE) {
+    Reply(output, data);
+    return;
+  }
+
+  // Large replies are moved to the heap and referenced by the evbuffer,
+  // the buffer is released by libevent once the data has been written out.
+  auto buffer = new std::string(std::move(data));
+  evbuffer_add_reference(
+      output, buffer->data(), buffer->size(),
+      [](const void *, size_t, void *arg) { delete static_cast<std::string *>(arg); }, buffer);
+}
+
 std::string SimpleString(const std::string &data) { return "+" + data + CRLF; }
 
 std::string Error(const Status &s) { return RESP_PREFIX_ERROR + StatusToRedisErrorMsg(s) + CRLF; }
@@ -22,8 +22,10 @@
 
 #include <event2/buffer.h>
 
+#include <charconv>
 #include <map>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "rocksdb/status.h"
@@ -38,7 +40,11 @@ namespace redis {
 
 enum class RESP { v2, v3 };
 
+// replies at least this large are handed to the evbuffer by reference instead of being copied into it
+constexpr size_t REPLY_BY_REFERENCE_MIN_SIZE = 16 * 1024;
+
 void Reply(evbuffer *output, const std::string &data);
+void Reply(evbuffer *output, std::string &&data);
 std::string SimpleString(const std::string &data);
 
 std::string Error(const Status &s);
@@ -110,4 +116,74 @@ std::string HeaderOfPush(RESP ver, T len) {
   return ver == RESP::v3 ? ">" + std::to_string(len) + CRLF : MultiLen(len);
 }
 
+// ReplyWriter appends RESP2/RESP3 frames in place to a reply buffer,
+// so big collection replies are not assembled from per-element temporary strings.
+class ReplyWriter {
+ public:
+  ReplyWriter(RESP ver, std::string *output) : ver_(ver), output_(output) {}
+
+  RESP GetProtocolVersion() const { return ver_; }
+  void Reserve(size_t n) { output_->reserve(output_->size() + n); }
+
+  void ArrayHeader(size_t len) { appendLength('*', len); }
+  void SetHeader(size_t len) {
+    if (ver_ == RESP::v3) {
+      appendLength('~', len);
+    } else {
+      appendLength('*', len);
+    }
+  }
+  void MapHeader(size_t len) {
+    if (ver_ == RESP::v3) {
+      appendLength('%', len);
+    } else {
+      appendLength('*', len * 2);
+    }
+  }
+
+  void BulkString(std::string_view data) {
+    appendLength('$', data.size());
+    output_->append(data.data(), data.size());
+    output_->append(CRLF);
+  }
+  void NilString() { output_->append(ver_ == RESP::v3 ? "_" CRLF : "$-1" CRLF); }
+  void NilArray() { output_->append(ver_ == RESP::v3 ? "_" CRLF : "*-1" CRLF); }
+
+  template <typename T, std::enable_if_t<std::is_integral_v<T>, int> = 0>
+  void Integer(T data) {
+    output_->push_back(':');
+    appendNumber(data);
+    output_->append(CRLF);
+  }
+  void Double(double d) {
+    if (ver_ == RESP::v3) {
+      output_->push_back(',');
+      output_->append(util::Float2String(d));
+      output_->append(CRLF);
+    } else {
+      BulkString(util::Float2String(d));
+    }
+  }
+
+  // size in bytes of a bulk string frame of the given payload length, used to reserve the buffer up front
+  static size_t BulkStringSize(size_t len) { return len + 24; }
+
+ private:
+  template <typename T>
+  void appendNumber(T n) {
+    char buf[24];
+    auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), n);
+    output_->append(buf, end);
+  }
+
+  void appendLength(char prefix, size_t len) {
+    output_->push_back(prefix);
+    appendNumber(len);
+    output_->append(CRLF);
+  }
+
+  RESP ver_;
+  std::string *output_;
+};
+
 }  // namespace redis
@@ -23,6 +23,7 @@
 #include <glog/logging.h>
 #include <rocksdb/perf_context.h>
 
+#include <algorithm>
 #include <chrono>
 #include <memory>
 #include <utility>
@@ -36,6 +37,20 @@
 
 namespace redis {
 
+// Longest length line accepted in the BulkLen state: '$' plus the digits of a 64-bit integer
+constexpr size_t PROTO_BULK_LEN_LINE_MAX_SIZE = 32;
+
+// Parse [begin, end) as a decimal length in place, without building a temporary std::string.
+// The caller must guarantee the range is followed by a non-digit character (e.g. '\r' or '\0').
+template <typename T>
+static StatusOr<T> ParseLength(const char *begin, const char *end) {
+  auto [res, pos] = GET_OR_RET(TryParseInt<T>(begin, 10));
+  if (pos != end) {
+    return {Status::NotOK, "encounter non-integer characters"};
+  }
+  return res;
+}
+
 Status Request::Tokenize(evbuffer *input) {
   size_t pipeline_size = 0;
 
@@ -65,7 +80,7 @@ Status Request::Tokenize(evbuffer *input) {
         pipeline_size++;
         srv_->stats.IncrInboundBytes(line.length);
         if (line[0] == '*') {
-          auto parse_result = ParseInt<int64_t>(std::string(line.get() + 1, line.length - 1), 10);
+          auto parse_result = ParseLength<int64_t>(line.get() + 1, line.get() + line.length);
           if (!parse_result) {
             return {Status::NotOK, "Protocol error: invalid multibulk length"};
           }
@@ -80,6 +95,7 @@ Status Request::Tokenize(evbuffer *input) {
             continue;
           }
 
+          tokens_.reserve(std::min(static_cast<size_t>(multi_bulk_len_), PROTO_TOKENS_RESERVE_SIZE));
           state_ = BulkLen;
         } else {
           if (line.length > PROTO_INLINE_MAX_SIZE) {
@@ -94,15 +110,32 @@ Status Request::Tokenize(evbuffer *input) {
         break;
       }
       case BulkLen: {
-        UniqueEvbufReadln line(input, EVBUFFER_EOL_CRLF_STRICT);
-        if (!line || line.length <= 0) return Status::OK();
+        // The length line is tiny, so peek it into a stack buffer instead of
+        // letting evbuffer_readln allocate a fresh string for every argument.
+        size_t eol_len = 0;
+        evbuffer_ptr eol = evbuffer_search_eol(input, nullptr, &eol_len, EVBUFFER_EOL_CRLF_STRICT);
+        if (eol.pos < 0) return Status::OK();
+
+        auto line_len = static_cast<size_t>(eol.pos);
+        if (line_len == 0) {
+          evbuffer_drain(input, eol_len);
+          return Status::OK();
+        }
+        if (line_len >= PROTO_BULK_LEN_LINE_MAX_SIZE) {
+          return {Status::NotOK, "Protocol error: invalid bulk length"};
+        }
 
-        srv_->stats.IncrInboundBytes(line.length);
+        char line[PROTO_BULK_LEN_LINE_MAX_SIZE];
+        evbuffer_copyout(input, line, line_len);
+        line[line_len] = '\0';
+        evbuffer_drain(input, line_len + eol_len);
+
+        srv_->stats.IncrInboundBytes(line_len);
         if (line[0] != '$') {
           return {Status::NotOK, "Protocol error: expected '$'"};
         }
 
-        auto parse_result = ParseInt<uint64_t>(std::string(line.get() + 1, line.length - 1), 10);
+        auto parse_result = ParseLength<uint64_t>(line + 1, line + line_len);
         if (!parse_result) {
           return {Status::NotOK, "Protocol error: invalid bulk length"};
         }
@@ -115,12 +148,14 @@ Status Request::Tokenize(evbuffer *input) {
         state_ = BulkData;
         break;
       }
-      case BulkData:
+      case BulkData: {
         if (evbuffer_get_length(input) < bulk_len_ + 2) return Status::OK();
 
-        char *data = reinterpret_cast<char *>(evbuffer_pullup(input, static_cast<ssize_t>(bulk_len_ + 2)));
-        tokens_.emplace_back(data, bulk_len_);
-        evbuffer_drain(input, bulk_len_ + 2);
+        // Copy the payload straight from the evbuffer chain into its final token, large values
+        // that span several chunks are no longer linearized by evbuffer_pullup before the copy.
+        auto &token = tokens_.emplace_back(bulk_len_, '\0');
+        evbuffer_remove(input, token.data(), bulk_len_);
+        evbuffer_drain(input, 2);
         srv_->stats.IncrInboundBytes(bulk_len_ + 2);
         --multi_bulk_len_;
         if (multi_bulk_len_ == 0) {
@@ -131,8 +166,19 @@ Status Request::Tokenize(evbuffer *input) {
           state_ = BulkLen;
         }
         break;
+      }
     }
   }
 }
 
+void Request::Reset() {
+  state_ = ArrayLen;
+  multi_bulk_len_ = 0;
+  bulk_len_ = 0;
+  tokens_.clear();
+  commands_.clear();
+  // a pooled request mustn't pin the memory of a huge pipeline
+  if (tokens_.capacity() > PROTO_TOKENS_RESERVE_SIZE) CommandTokens().swap(tokens_);
+}
+
 }  // namespace redis
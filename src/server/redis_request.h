@@ -34,6 +34,9 @@ namespace redis {
 
 constexpr size_t PROTO_INLINE_MAX_SIZE = 16 * 1024L;
 constexpr size_t PROTO_MULTI_MAX_SIZE = 1024 * 1024L;
+// Upper bound of token slots reserved up front from the multibulk length,
+// so a huge declared length cannot make us allocate before the data arrives.
+constexpr size_t PROTO_TOKENS_RESERVE_SIZE = 1024;
 
 using CommandTokens = std::vector<std::string>;
 
@@ -52,6 +55,8 @@ class Request {
   Status Tokenize(evbuffer *input);
 
   std::deque<CommandTokens> *GetCommands() { return &commands_; }
+  // Reset drops the parsing state for a new client, the buffers are kept unless they grew too large
+  void Reset();
 
  private:
   // internal states related to parsing
@@ -21,13 +21,16 @@
 #include "server.h"
 
 #include <glog/logging.h>
+#include <rocksdb/cache.h>
 #include <rocksdb/convenience.h>
 #include <rocksdb/statistics.h>
 #include <sys/resource.h>
 #include <sys/statvfs.h>
 #include <sys/utsname.h>
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <functional>
 #include <iomanip>
@@ -35,17 +38,26 @@
 #include <memory>
 #include <mutex>
 #include <shared_mutex>
+#include <tuple>
 #include <utility>
 
+#include "alloc_util.h"
 #include "commands/commander.h"
 #include "config.h"
 #include "config/config.h"
 #include "fmt/format.h"
+#include "parse_util.h"
 #include "redis_connection.h"
+#include "stats/open_metrics.h"
 #include "storage/compaction_checker.h"
+#include "storage/huge_page_allocator.h"
+#include "storage/key_evictor.h"
+#include "storage/namespace_purger.h"
+#include "storage/rdb_exporter.h"
 #include "storage/redis_db.h"
 #include "storage/scripting.h"
 #include "storage/storage.h"
+#include "storage/ttl_index.h"
 #include "string_util.h"
 #include "thread_util.h"
 #include "time_util.h"
@@ -58,13 +70,19 @@ Server::Server(engine::Storage *storage, Config *config)
       index_mgr(&indexer, storage),
       start_time_secs_(util::GetTimeStamp()),
       config_(config),
-      namespace_(storage) {
+      wal_ring_(storage),
+      namespace_(storage),
+      big_key_analyzer_(storage, config->BigKeysFilePath()),
+      monitor_feed_([this](const MonitorFeed::Record &record, const std::string &line, uint64_t dropped) {
+        auto response = redis::SimpleString(line);
+        for (const auto &worker_thread : worker_threads_) {
+          worker_thread->GetWorker()->FeedMonitorConns(record.conn_id, record.ns, response, dropped);
+        }
+      }),
+      metrics_listener_([this](std::string *output) { GetOpenMetrics(output); }) {
   // init commands stats here to prevent concurrent insert, and cause core
-  auto commands = redis::CommandTable::GetOriginal();
-  for (const auto &iter : *commands) {
-    stats.commands_stats[iter.first].calls = 0;
-    stats.commands_stats[iter.first].latency = 0;
-  }
+  stats.InitCommandStats(redis::CommandTable::Size());
+  storage->GetLockManager()->SetWaitHistogram(&stats.lock_wait_histogram);
 
   // init cursor_dict_
   cursor_dict_ = std::make_unique<CursorDictType>();
@@ -98,8 +116,20 @@ Server::Server(engine::Storage *storage, Config *config)
       LOG(INFO) << "[server] Listening on unix socket: " << config->unixsocket;
     }
     worker_threads_.emplace_back(std::make_unique<WorkerThread>(std::move(worker)));
+    if (!config->worker_cpus.empty()) {
+      worker_threads_.back()->SetCPUAffinity(config->worker_cpus[i % config->worker_cpus.size()]);
+    }
   }
 
+  task_runner_.SetCPUAffinity(config->background_task_cpus);
+  if (config->heavy_command_threads > 0) {
+    heavy_command_runner_ =
+        std::make_unique<TaskRunner>(config->heavy_command_threads, config->heavy_command_queue_size);
+    heavy_command_runner_->SetCPUAffinity(config->background_task_cpus);
+    heavy_command_queue_ = std::make_unique<NamespaceFairQueue>(config->heavy_command_queue_size);
+  }
+  namespace_quotas_.Reset(config->namespace_quotas);
+
   AdjustOpenFilesLimit();
   slow_log_.SetMaxEntries(config->slowlog_max_len);
   perf_log_.SetMaxEntries(config->profiling_sample_record_max_len);
@@ -141,11 +171,24 @@ Server::~Server() {
 //     - feed-replica-data-info: generate checkpoint and send files list when full sync
 //     - feed-replica-file: send SST files when slaves ask for full sync
 Status Server::Start() {
+  startup_phases_.emplace_back("storage_open", storage->GetOpenDuration());
+  auto phase_start = std::chrono::steady_clock::now();
+  auto end_phase = [this, &phase_start](const char *name) {
+    auto now = std::chrono::steady_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(now - phase_start).count();
+    startup_phases_.emplace_back(name, duration);
+    phase_start = now;
+  };
+
   auto s = namespace_.LoadAndRewrite();
   if (!s.IsOK()) {
     return s;
   }
-  if (!config_->master_host.empty()) {
+  end_phase("namespaces");
+  if (storage->IsSecondary()) {
+    // A secondary instance only reads the db of its primary instance, it's never a replica
+    secondary_catch_up_time_us_ = util::GetTimeStampUS();
+  } else if (!config_->master_host.empty()) {
     s = AddMaster(config_->master_host, static_cast<uint32_t>(config_->master_port), false);
     if (!s.IsOK()) return s;
   } else {
@@ -156,13 +199,20 @@ Status Server::Start() {
       return s.Prefixed("failed to shift replication id");
     }
   }
+  end_phase("replication");
+
+  // compile the stored scripts before serving, instead of by the first calls of all the workers
+  lua::WarmUpBytecodeCache(this);
+  end_phase("lua_scripts");
 
+  // the indexes are warmed up in the background after they are loaded
   if (!config_->cluster_enabled) {
     GET_OR_RET(index_mgr.Load(kDefaultNamespace));
     for (auto [_, ns] : namespace_.List()) {
       GET_OR_RET(index_mgr.Load(ns));
     }
   }
+  end_phase("search_indexes");
 
   if (config_->cluster_enabled) {
     if (config_->persist_cluster_nodes_enabled) {
@@ -180,7 +230,9 @@ Status Server::Start() {
 
     slot_import = std::make_unique<SlotImport>(this);
   }
+  end_phase("cluster");
 
+  // the phases are only written before the workers start, so INFO reads them without a lock
   for (const auto &worker : worker_threads_) {
     worker->Start();
   }
@@ -188,6 +240,32 @@ Status Server::Start() {
   if (auto s = task_runner_.Start(); !s) {
     LOG(WARNING) << "Failed to start task runner: " << s.Msg();
   }
+  // The analysis interrupted by the last shutdown is resumed by the next BIGKEYS START
+  if (auto s = big_key_analyzer_.Load(); !s) {
+    LOG(WARNING) << "Failed to load the big keys: " << s.Msg();
+  }
+  if (auto cache_warmup = storage->GetCacheWarmup()) {
+    auto s = task_runner_.TryPublish(
+        [cache_warmup, this] {
+          auto s = cache_warmup->Load(storage);
+          if (!s.IsOK()) LOG(WARNING) << "[task runner] Failed to warm up the block cache: " << s.Msg();
+        },
+        TaskPriority::kLow, "cache_warmup");
+    if (!s.IsOK()) LOG(WARNING) << "Failed to schedule the block cache warmup: " << s.Msg();
+  }
+  if (heavy_command_runner_) {
+    if (auto s = heavy_command_runner_->Start(); !s) {
+      return s.Prefixed("failed to start heavy command runner");
+    }
+  }
+  GET_OR_RET(monitor_feed_.Start().Prefixed("failed to start the monitor feed"));
+  if (config_->metrics_port != 0) {
+    GET_OR_RET(metrics_listener_.Start(config_->metrics_bind, config_->metrics_port)
+                   .Prefixed("failed to start the metrics listener"));
+  }
+  if (!config_->trace_file.empty()) {
+    GET_OR_RET(tracer_.Start(config_->trace_file).Prefixed("failed to start the tracer"));
+  }
   // setup server cron thread
   cron_thread_ = GET_OR_RET(util::CreateThread("server-cron", [this] { this->cron(); }));
 
@@ -195,6 +273,8 @@ Status Server::Start() {
     uint64_t counter = 0;
     int64_t last_compact_date = 0;
     CompactionChecker compaction_checker{this->storage};
+    engine::ExpiredKeyReaper expired_key_reaper{this->storage};
+    engine::KeyEvictor key_evictor{this->storage, &stats.hot_keys};
 
     while (!stop_) {
       // Sleep first
@@ -204,6 +284,26 @@ Status Server::Start() {
       auto guard = storage->ReadLockGuard();
       if (storage->IsClosing()) continue;
 
+      // A secondary instance can't write or compact the db of its primary instance
+      if (storage->IsSecondary()) continue;
+
+      // Replicas get the deletions of the master by replication. The index always has the expired hash fields,
+      // while the expired keys are only indexed with ttl-index-enabled
+      if (!is_loading_ && counter % 10 == 0 && !IsSlave()) {
+        auto s = expired_key_reaper.Reap(config_->ttl_index_reap_limit);
+        if (!s) LOG(WARNING) << "[server] Failed to reap the expired keys: " << s.Msg();
+      }
+
+      // evict the keys over max-db-size, the replicas get the deletions of the master as well
+      if (!is_loading_ && counter % 10 == 0 && !IsSlave()) {
+        auto s = key_evictor.Evict();
+        if (!s) {
+          LOG(WARNING) << "[server] Failed to evict the keys: " << s.Msg();
+        } else {
+          stats.evicted_keys += *s;
+        }
+      }
+
       if (!is_loading_ && ++counter % 600 == 0  // check every minute
           && config_->compaction_checker_cron.IsEnabled()) {
         auto t_now = static_cast<time_t>(util::GetTimeStamp());
@@ -243,7 +343,14 @@ void Server::Stop() {
   }
 
   rocksdb::CancelAllBackgroundWork(storage->GetDB(), true);
+  big_key_analyzer_.Stop();
+  traffic_capture_.Stop();
+  cpu_profiler_.Stop();
+  tracer_.Stop();
+  monitor_feed_.Stop();
+  metrics_listener_.Stop();
   task_runner_.Cancel();
+  if (heavy_command_runner_) heavy_command_runner_->Cancel();
 }
 
 void Server::Join() {
@@ -256,6 +363,14 @@ void Server::Join() {
   if (auto s = task_runner_.Join(); !s) {
     LOG(WARNING) << s.Msg();
   }
+  // The index builds and the index deltas are resumed after the restart
+  index_mgr.StopBackgroundJobs();
+  // Heavy commands hold connections owned by workers, so they must be stopped first
+  if (heavy_command_runner_) {
+    if (auto s = heavy_command_runner_->Join(); !s) {
+      LOG(WARNING) << s.Msg();
+    }
+  }
   for (const auto &worker : worker_threads_) {
     worker->Join();
   }
@@ -316,17 +431,31 @@ Status Server::RemoveMaster() {
 }
 
 Status Server::AddSlave(redis::Connection *conn, rocksdb::SequenceNumber next_repl_seq) {
+  // Checked again under the lock, since SST files may be ingested after PSYNC checks it
+  std::lock_guard<std::mutex> lg(slave_threads_mu_);
+  if (next_repl_seq <= storage->GetLastIngestSeq()) {
+    return {Status::NotOK, "sequence is before an ingestion of SST files, please use fullsync"};
+  }
+
   auto t = std::make_unique<FeedSlaveThread>(this, conn, next_repl_seq);
   auto s = t->Start();
   if (!s.IsOK()) {
     return s;
   }
 
-  std::lock_guard<std::mutex> lg(slave_threads_mu_);
   slave_threads_.emplace_back(std::move(t));
   return Status::OK();
 }
 
+Status Server::ApplySSTFile(const std::string &cf_name, const std::string &path) {
+  // The ingested entries can't be fed to the connected replicas, and the TTL index isn't built from them
+  std::lock_guard<std::mutex> lg(slave_threads_mu_);
+  if (!slave_threads_.empty() || config_->ttl_index_enabled) {
+    return storage->ApplySSTFile(cf_name, path, static_cast<size_t>(config_->migrate_batch_size_kb) * KiB);
+  }
+  return storage->IngestSSTFile(cf_name, path);
+}
+
 void Server::DisconnectSlaves() {
   std::lock_guard<std::mutex> lg(slave_threads_mu_);
 
@@ -341,6 +470,11 @@ void Server::DisconnectSlaves() {
   }
 }
 
+bool Server::HasSlaves() {
+  std::lock_guard<std::mutex> lg(slave_threads_mu_);
+  return !slave_threads_.empty();
+}
+
 void Server::CleanupExitedSlaves() {
   std::lock_guard<std::mutex> lg(slave_threads_mu_);
 
@@ -358,157 +492,66 @@ void Server::CleanupExitedSlaves() {
 void Server::FeedMonitorConns(redis::Connection *conn, const std::vector<std::string> &tokens) {
   if (monitor_clients_ <= 0) return;
 
-  auto now_us = util::GetTimeStampUS();
-  std::string output =
-      fmt::format("{}.{} [{} {}]", now_us / 1000000, now_us % 1000000, conn->GetNamespace(), conn->GetAddr());
-  for (const auto &token : tokens) {
-    output += " \"";
-    output += util::EscapeString(token);
-    output += "\"";
-  }
-
-  for (const auto &worker_thread : worker_threads_) {
-    auto worker = worker_thread->GetWorker();
-    worker->FeedMonitorConns(conn, redis::SimpleString(output));
-  }
+  // the line is formatted and delivered by the monitor feed thread
+  monitor_feed_.Push({util::GetTimeStampUS(), conn->GetID(), conn->GetNamespace(), conn->GetAddr(), tokens});
 }
 
 int Server::PublishMessage(const std::string &channel, const std::string &msg) {
-  int cnt = 0;
-  int index = 0;
-
-  pubsub_channels_mu_.lock();
-
-  std::vector<ConnContext> to_publish_conn_ctxs;
-  if (auto iter = pubsub_channels_.find(channel); iter != pubsub_channels_.end()) {
-    for (const auto &conn_ctx : iter->second) {
-      to_publish_conn_ctxs.emplace_back(conn_ctx);
-    }
-  }
-
-  // The patterns variable records the pattern of connections
-  std::vector<std::string> patterns;
-  std::vector<ConnContext> to_publish_patterns_conn_ctxs;
-  for (const auto &iter : pubsub_patterns_) {
-    if (util::StringMatch(iter.first, channel, 0)) {
-      for (const auto &conn_ctx : iter.second) {
-        to_publish_patterns_conn_ctxs.emplace_back(conn_ctx);
-        patterns.emplace_back(iter.first);
-      }
-    }
-  }
-  pubsub_channels_mu_.unlock();
+  auto matches = pubsub_registry_.Match(channel);
+  if (matches.subscribers.empty()) return 0;
 
+  // The replies are built once per pattern rather than once per connection
+  std::vector<std::string> replies;
+  replies.reserve(matches.patterns.size() + 1);
   std::string channel_reply;
   channel_reply.append(redis::MultiLen(3));
   channel_reply.append(redis::BulkString("message"));
   channel_reply.append(redis::BulkString(channel));
   channel_reply.append(redis::BulkString(msg));
-  for (const auto &conn_ctx : to_publish_conn_ctxs) {
-    auto s = conn_ctx.owner->Reply(conn_ctx.fd, channel_reply);
-    if (s.IsOK()) {
-      cnt++;
-    }
-  }
-
-  // We should publish corresponding pattern and message for connections
-  for (const auto &conn_ctx : to_publish_patterns_conn_ctxs) {
+  replies.emplace_back(std::move(channel_reply));
+  for (const auto &pattern : matches.patterns) {
     std::string pattern_reply;
     pattern_reply.append(redis::MultiLen(4));
     pattern_reply.append(redis::BulkString("pmessage"));
-    pattern_reply.append(redis::BulkString(patterns[index++]));
+    pattern_reply.append(redis::BulkString(pattern));
     pattern_reply.append(redis::BulkString(channel));
     pattern_reply.append(redis::BulkString(msg));
-    auto s = conn_ctx.owner->Reply(conn_ctx.fd, pattern_reply);
-    if (s.IsOK()) {
-      cnt++;
-    }
+    replies.emplace_back(std::move(pattern_reply));
   }
 
+  int cnt = 0;
+  for (const auto &[worker, subscribers] : matches.subscribers) {
+    cnt += worker->ReplyToSubscribers(subscribers, replies);
+  }
   return cnt;
 }
 
 void Server::SubscribeChannel(const std::string &channel, redis::Connection *conn) {
-  std::lock_guard<std::mutex> guard(pubsub_channels_mu_);
-
-  auto conn_ctx = ConnContext(conn->Owner(), conn->GetFD());
-  if (auto iter = pubsub_channels_.find(channel); iter == pubsub_channels_.end()) {
-    pubsub_channels_.emplace(channel, std::list<ConnContext>{conn_ctx});
-  } else {
-    iter->second.emplace_back(conn_ctx);
-  }
+  pubsub_registry_.Subscribe(channel, {conn->Owner(), conn->GetFD()});
 }
 
 void Server::UnsubscribeChannel(const std::string &channel, redis::Connection *conn) {
-  std::lock_guard<std::mutex> guard(pubsub_channels_mu_);
-
-  auto iter = pubsub_channels_.find(channel);
-  if (iter == pubsub_channels_.end()) {
-    return;
-  }
-
-  for (const auto &conn_ctx : iter->second) {
-    if (conn->GetFD() == conn_ctx.fd && conn->Owner() == conn_ctx.owner) {
-      iter->second.remove(conn_ctx);
-      if (iter->second.empty()) {
-        pubsub_channels_.erase(iter);
-      }
-      break;
-    }
-  }
+  pubsub_registry_.Unsubscribe(channel, conn->Owner(), conn->GetFD());
 }
 
 void Server::GetChannelsByPattern(const std::string &pattern, std::vector<std::string> *channels) {
-  std::lock_guard<std::mutex> guard(pubsub_channels_mu_);
-
-  for (const auto &iter : pubsub_channels_) {
-    if (pattern.empty() || util::StringMatch(pattern, iter.first, 0)) {
-      channels->emplace_back(iter.first);
-    }
-  }
+  auto matched = pubsub_registry_.GetChannels(pattern);
+  channels->insert(channels->end(), std::make_move_iterator(matched.begin()), std::make_move_iterator(matched.end()));
 }
 
 void Server::ListChannelSubscribeNum(const std::vector<std::string> &channels,
                                      std::vector<ChannelSubscribeNum> *channel_subscribe_nums) {
-  std::lock_guard<std::mutex> guard(pubsub_channels_mu_);
-
   for (const auto &chan : channels) {
-    if (auto iter = pubsub_channels_.find(chan); iter != pubsub_channels_.end()) {
-      channel_subscribe_nums->emplace_back(ChannelSubscribeNum{iter->first, iter->second.size()});
-    } else {
-      channel_subscribe_nums->emplace_back(ChannelSubscribeNum{chan, 0});
-    }
+    channel_subscribe_nums->emplace_back(ChannelSubscribeNum{chan, pubsub_registry_.GetSubscribeNum(chan)});
   }
 }
 
 void Server::PSubscribeChannel(const std::string &pattern, redis::Connection *conn) {
-  std::lock_guard<std::mutex> guard(pubsub_channels_mu_);
-
-  auto conn_ctx = ConnContext(conn->Owner(), conn->GetFD());
-  if (auto iter = pubsub_patterns_.find(pattern); iter == pubsub_patterns_.end()) {
-    pubsub_patterns_.emplace(pattern, std::list<ConnContext>{conn_ctx});
-  } else {
-    iter->second.emplace_back(conn_ctx);
-  }
+  pubsub_registry_.PSubscribe(pattern, {conn->Owner(), conn->GetFD()});
 }
 
 void Server::PUnsubscribeChannel(const std::string &pattern, redis::Connection *conn) {
-  std::lock_guard<std::mutex> guard(pubsub_channels_mu_);
-
-  auto iter = pubsub_patterns_.find(pattern);
-  if (iter == pubsub_patterns_.end()) {
-    return;
-  }
-
-  for (const auto &conn_ctx : iter->second) {
-    if (conn->GetFD() == conn_ctx.fd && conn->Owner() == conn_ctx.owner) {
-      iter->second.remove(conn_ctx);
-      if (iter->second.empty()) {
-        pubsub_patterns_.erase(iter);
-      }
-      break;
-    }
-  }
+  pubsub_registry_.PUnsubscribe(pattern, conn->Owner(), conn->GetFD());
 }
 
 void Server::SSubscribeChannel(const std::string &channel, redis::Connection *conn, uint16_t slot) {
@@ -570,122 +613,81 @@ void Server::ListSChannelSubscribeNum(const std::vector<std::string> &channels,
 }
 
 void Server::BlockOnKey(const std::string &key, redis::Connection *conn) {
-  std::lock_guard<std::mutex> guard(blocking_keys_mu_);
-
-  auto conn_ctx = ConnContext(conn->Owner(), conn->GetFD());
-
-  if (auto iter = blocking_keys_.find(key); iter == blocking_keys_.end()) {
-    blocking_keys_.emplace(key, std::list<ConnContext>{conn_ctx});
-  } else {
-    iter->second.emplace_back(conn_ctx);
-  }
-
+  blocking_keys_.Block(key, {conn->Owner(), conn->GetFD()});
   IncrBlockedClientNum();
 }
 
 void Server::UnblockOnKey(const std::string &key, redis::Connection *conn) {
-  std::lock_guard<std::mutex> guard(blocking_keys_mu_);
-
-  auto iter = blocking_keys_.find(key);
-  if (iter == blocking_keys_.end()) {
-    return;
-  }
-
-  for (const auto &conn_ctx : iter->second) {
-    if (conn->GetFD() == conn_ctx.fd && conn->Owner() == conn_ctx.owner) {
-      iter->second.remove(conn_ctx);
-      if (iter->second.empty()) {
-        blocking_keys_.erase(iter);
-      }
-      break;
-    }
-  }
-
+  blocking_keys_.Unblock(key, conn->Owner(), conn->GetFD());
   DecrBlockedClientNum();
 }
 
 void Server::BlockOnStreams(const std::vector<std::string> &keys, const std::vector<redis::StreamEntryID> &entry_ids,
-                            redis::Connection *conn) {
-  std::lock_guard<std::mutex> guard(blocked_stream_consumers_mu_);
-
+                            redis::Connection *conn, std::optional<uint64_t> read_count) {
   IncrBlockedClientNum();
 
   for (size_t i = 0; i < keys.size(); ++i) {
-    auto consumer = std::make_shared<StreamConsumer>(conn->Owner(), conn->GetFD(), conn->GetNamespace(), entry_ids[i]);
-    if (auto iter = blocked_stream_consumers_.find(keys[i]); iter == blocked_stream_consumers_.end()) {
-      std::set<std::shared_ptr<StreamConsumer>> consumers;
-      consumers.insert(consumer);
-      blocked_stream_consumers_.emplace(keys[i], consumers);
-    } else {
-      iter->second.insert(consumer);
-    }
+    stream_waiters_.Block(conn->GetNamespace(), keys[i], {conn->Owner(), conn->GetFD(), entry_ids[i], read_count});
   }
 }
 
 void Server::UnblockOnStreams(const std::vector<std::string> &keys, redis::Connection *conn) {
-  std::lock_guard<std::mutex> guard(blocked_stream_consumers_mu_);
-
   DecrBlockedClientNum();
 
   for (const auto &key : keys) {
-    auto iter = blocked_stream_consumers_.find(key);
-    if (iter == blocked_stream_consumers_.end()) {
-      continue;
-    }
+    stream_waiters_.Unblock(conn->GetNamespace(), key, conn->Owner(), conn->GetFD());
+  }
+}
 
-    for (auto it = iter->second.begin(); it != iter->second.end();) {
-      const auto &consumer = *it;
-      if (conn->GetFD() == consumer->fd && conn->Owner() == consumer->owner) {
-        iter->second.erase(it);
-        if (iter->second.empty()) {
-          blocked_stream_consumers_.erase(iter);
-        }
-        break;
+void Server::WakeupBlockingConns(const std::string &key, size_t n_conns) {
+  for (const auto &[worker, fds] : blocking_keys_.Take(key, n_conns)) {
+    for (int fd : fds) {
+      auto s = worker->EnableWriteEvent(fd);
+      if (!s.IsOK()) {
+        LOG(ERROR) << "[server] Failed to enable write event on blocked client " << fd << ": " << s.Msg();
       }
-      ++it;
     }
   }
 }
 
-void Server::WakeupBlockingConns(const std::string &key, size_t n_conns) {
-  std::lock_guard<std::mutex> guard(blocking_keys_mu_);
+void Server::OnEntryAddedToStream(const std::string &ns, const std::string &key, const redis::StreamEntryID &entry_id) {
+  for (auto &[worker, waiters] : stream_waiters_.TakeReadable(ns, key, entry_id)) {
+    worker->WakeupStreamWaiters(ns, key, std::move(waiters));
+  }
+}
 
-  auto iter = blocking_keys_.find(key);
-  if (iter == blocking_keys_.end() || iter->second.empty()) {
-    return;
+void Server::BlockOnReplicaAcks(redis::Connection *conn) {
+  {
+    std::lock_guard<std::mutex> guard(replica_ack_waiters_mu_);
+    replica_ack_waiters_.emplace_back(conn->Owner(), conn->GetFD());
   }
+  IncrBlockedClientNum();
+}
 
-  while (n_conns-- && !iter->second.empty()) {
-    auto conn_ctx = iter->second.front();
+void Server::UnblockOnReplicaAcks(redis::Connection *conn) {
+  {
+    std::lock_guard<std::mutex> guard(replica_ack_waiters_mu_);
+    replica_ack_waiters_.remove(ConnContext(conn->Owner(), conn->GetFD()));
+  }
+  DecrBlockedClientNum();
+}
+
+void Server::WakeupReplicaAckWaiters() {
+  // The feeder threads can't lock slave_threads_mu_ here since they're joined under it,
+  // so the waiters are just woken and count the acked replicas in their workers
+  std::lock_guard<std::mutex> guard(replica_ack_waiters_mu_);
+  for (const auto &conn_ctx : replica_ack_waiters_) {
     auto s = conn_ctx.owner->EnableWriteEvent(conn_ctx.fd);
     if (!s.IsOK()) {
       LOG(ERROR) << "[server] Failed to enable write event on blocked client " << conn_ctx.fd << ": " << s.Msg();
     }
-    iter->second.pop_front();
   }
 }
 
-void Server::OnEntryAddedToStream(const std::string &ns, const std::string &key, const redis::StreamEntryID &entry_id) {
-  std::lock_guard<std::mutex> guard(blocked_stream_consumers_mu_);
-
-  auto iter = blocked_stream_consumers_.find(key);
-  if (iter == blocked_stream_consumers_.end() || iter->second.empty()) {
-    return;
-  }
-
-  for (auto it = iter->second.begin(); it != iter->second.end();) {
-    auto consumer = *it;
-    if (consumer->ns == ns && entry_id > consumer->last_consumed_id) {
-      auto s = consumer->owner->EnableWriteEvent(consumer->fd);
-      if (!s.IsOK()) {
-        LOG(ERROR) << "[server] Failed to enable write event on blocked stream consumer " << consumer->fd << ": "
-                   << s.Msg();
-      }
-      it = iter->second.erase(it);
-    } else {
-      ++it;
-    }
-  }
+size_t Server::CountReplicasAcked(rocksdb::SequenceNumber seq) {
+  std::lock_guard<std::mutex> guard(slave_threads_mu_);
+  return std::count_if(slave_threads_.begin(), slave_threads_.end(),
+                       [seq](const auto &slave) { return !slave->IsStopped() && slave->GetAckedSeq() >= seq; });
 }
 
 void Server::updateCachedTime() { unix_time_secs.store(util::GetTimeStamp()); }
@@ -709,15 +711,67 @@ std::shared_lock<std::shared_mutex> Server::WorkConcurrencyGuard() {
   return std::shared_lock(works_concurrency_rw_lock_);
 }
 
+void Server::AddStreamingReply(bufferevent *bev) {
+  std::lock_guard<std::mutex> guard(streaming_replies_mu_);
+  streaming_replies_.insert(bev);
+}
+
+void Server::RemoveStreamingReply(bufferevent *bev) {
+  std::lock_guard<std::mutex> guard(streaming_replies_mu_);
+  streaming_replies_.erase(bev);
+}
+
+bool Server::HasWorker(const Worker *worker) const {
+  return std::any_of(worker_threads_.begin(), worker_threads_.end(),
+                     [worker](const auto &worker_thread) { return worker_thread->GetWorker() == worker; });
+}
+
 std::unique_lock<std::shared_mutex> Server::WorkExclusivityGuard() {
-  return std::unique_lock(works_concurrency_rw_lock_);
+  std::unique_lock lock(works_concurrency_rw_lock_, std::try_to_lock);
+  if (lock.owns_lock()) return lock;
+
+  auto start = std::chrono::steady_clock::now();
+  lock.lock();
+  auto end = std::chrono::steady_clock::now();
+  stats.exclusivity_wait_histogram.Record(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+  return lock;
+}
+
+void Server::ChargeNamespaceQuota(const std::string &ns, const std::vector<std::string> &args,
+                                  const redis::CommandAttributes &attr, size_t reply_size) {
+  if (!namespace_quotas_.HasQuotas()) return;
+
+  if (attr.flags & redis::kCmdWrite) {
+    uint64_t write_bytes = 0;
+    for (const auto &arg : args) write_bytes += arg.size();
+    namespace_quotas_.Charge(ns, 0, write_bytes);
+  } else {
+    namespace_quotas_.Charge(ns, reply_size, 0);
+  }
+}
+
+Status Server::PublishCommandTask(Task task) {
+  if (heavy_command_runner_) return heavy_command_runner_->TryPublish(std::move(task), TaskPriority::kHigh, "command");
+  return task_runner_.TryPublish(std::move(task), TaskPriority::kHigh, "command");
+}
+
+Status Server::PublishHeavyCommand(const std::string &ns, Task task) {
+  GET_OR_RET(heavy_command_queue_->Push(ns, namespace_quotas_.GetWeight(ns), std::move(task)));
+  // Each runner task runs the fairest queued command instead of its own one, and the runner never
+  // holds more tasks than the queue, so it's never full here.
+  heavy_command_runner_->Publish(
+      [this] {
+        if (auto task = heavy_command_queue_->Pop()) task();
+      },
+      TaskPriority::kHigh, "heavy_command");
+  return Status::OK();
 }
 
 uint64_t Server::GetClientID() { return client_id_.fetch_add(1, std::memory_order_relaxed); }
 
 void Server::recordInstantaneousMetrics() {
   auto rocksdb_stats = storage->GetDB()->GetDBOptions().statistics;
-  stats.TrackInstantaneousMetric(STATS_METRIC_COMMAND, stats.total_calls);
+  stats.TrackInstantaneousMetric(STATS_METRIC_COMMAND, stats.GetTotalCalls());
   stats.TrackInstantaneousMetric(STATS_METRIC_NET_INPUT, stats.in_bytes);
   stats.TrackInstantaneousMetric(STATS_METRIC_NET_OUTPUT, stats.out_bytes);
   stats.TrackInstantaneousMetric(STATS_METRIC_ROCKSDB_PUT,
@@ -732,6 +786,32 @@ void Server::recordInstantaneousMetrics() {
                                  rocksdb_stats->getTickerCount(rocksdb::Tickers::NUMBER_DB_NEXT));
   stats.TrackInstantaneousMetric(STATS_METRIC_ROCKSDB_PREV,
                                  rocksdb_stats->getTickerCount(rocksdb::Tickers::NUMBER_DB_PREV));
+  stats.TrackInstantaneousMetric(STATS_METRIC_MIGRATE_BYTES, stats.migrate_bytes);
+  stats.TrackInstantaneousMetric(STATS_METRIC_IMPORT_BYTES, stats.import_bytes);
+  stats.TrackInstantaneousMetric(STATS_METRIC_REPL_SENDS, stats.repl_sends);
+}
+
+void Server::catchUpWithPrimary() {
+  auto start = util::GetTimeStampUS();
+  if (start - secondary_last_try_us_ < static_cast<uint64_t>(config_->secondary_catch_up_interval_ms) * 1000) return;
+  secondary_last_try_us_ = start;
+
+  // Pause the commands, so that each of them reads a consistent view of the db without a snapshot
+  auto exclusivity = WorkExclusivityGuard();
+  auto s = storage->TryCatchUpWithPrimary();
+  if (!s.IsOK()) {
+    secondary_catch_up_failures_++;
+    LOG(WARNING) << "[server] Failed to catch up with the primary instance: " << s.Msg();
+    return;
+  }
+  secondary_catch_up_time_us_ = start;
+  secondary_catch_up_duration_us_ = util::GetTimeStampUS() - start;
+}
+
+uint64_t Server::GetSecondaryLagMs() const {
+  auto now = util::GetTimeStampUS();
+  auto last = secondary_catch_up_time_us_.load();
+  return now > last ? (now - last) / 1000 : 0;
 }
 
 void Server::cron() {
@@ -740,6 +820,21 @@ void Server::cron() {
     // Sleep first
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
+    if (storage->IsSecondary()) catchUpWithPrimary();
+
+    // The topology pushes don't take the exclusivity of the workers, the replication is switched here
+    if (config_->cluster_enabled && cluster->HasPendingReplicationSwitch()) {
+      auto exclusivity = WorkExclusivityGuard();
+      if (auto s = cluster->SetMasterSlaveRepl(); !s.IsOK()) {
+        LOG(WARNING) << "[server] Failed to set the replication by the cluster topology: " << s.Msg();
+      }
+    }
+
+    // It takes the concurrency of the workers, so it must be done before the lock of the storage
+    checkWorkers();
+
+    cpu_profiler_.StopIfDue();
+
     // To guarantee accessing DB safely
     auto guard = storage->ReadLockGuard();
     if (storage->IsClosing()) continue;
@@ -754,6 +849,34 @@ void Server::cron() {
       continue;
     }
 
+    // keep the replication backlog up to date while the replicas are disconnected
+    wal_ring_.Tail();
+
+    storage->ReleaseIdleSharedSnapshot();
+
+    // save the sampled keys for the block cache warmup every 10min
+    if (auto cache_warmup = storage->GetCacheWarmup(); cache_warmup && counter != 0 && counter % 6000 == 0) {
+      auto s = cache_warmup->Dump();
+      if (!s.IsOK()) LOG(WARNING) << "[server] Failed to save the keys for the block cache warmup: " << s.Msg();
+    }
+
+    // the scrapes of the metrics only read the RocksDB properties cached here
+    if (config_->metrics_port != 0 &&
+        util::GetTimeStamp() - rocksdb_metrics_refresh_secs_ >= config_->metrics_rocksdb_refresh_interval) {
+      refreshRocksDBMetrics();
+      rocksdb_metrics_refresh_secs_ = util::GetTimeStamp();
+    }
+
+    // rebalance the tiers of the block cache every 60s
+    if (config_->rocks_db.secondary_cache_auto_tune && counter != 0 && counter % 600 == 0) {
+      storage->TuneTieredBlockCache();
+    }
+
+    // resume the lazy free if a task couldn't be published, check every 1s
+    if (counter != 0 && counter % 10 == 0 && storage->GetLazyFreeQueue()->GetPendingKeys() > 0) {
+      ScheduleLazyFree();
+    }
+
     // check every 20s (use 20s instead of 60s so that cron will execute in critical condition)
     if (counter != 0 && counter % 200 == 0) {
       auto t = static_cast<time_t>(util::GetTimeStamp());
@@ -788,6 +911,11 @@ void Server::cron() {
         }
       }
     }
+    // fade out the keys which are no longer hot every minute
+    if (counter != 0 && counter % 600 == 0) {
+      stats.hot_keys.Decay();
+    }
+
     // check every 10s
     if (counter != 0 && counter % 100 == 0) {
       Status s = AsyncPurgeOldBackups(config_->max_backup_to_keep, config_->max_backup_keep_hours);
@@ -801,21 +929,12 @@ void Server::cron() {
 
     // No replica uses this checkpoint, we can remove it.
     if (counter != 0 && counter % 100 == 0) {
-      int64_t create_time_secs = storage->GetCheckpointCreateTimeSecs();
-      int64_t access_time_secs = storage->GetCheckpointAccessTimeSecs();
-
-      if (storage->ExistCheckpoint()) {
-        // TODO(shooterit): support to config the alive time of checkpoint
-        int64_t now_secs = util::GetTimeStamp<std::chrono::seconds>();
-        if ((GetFetchFileThreadNum() == 0 && now_secs - access_time_secs > 30) ||
-            (now_secs - create_time_secs > 24 * 60 * 60)) {
-          auto s = rocksdb::DestroyDB(config_->checkpoint_dir, rocksdb::Options());
-          if (!s.ok()) {
-            LOG(WARNING) << "[server] Fail to clean checkpoint, error: " << s.ToString();
-          } else {
-            LOG(INFO) << "[server] Clean checkpoint successfully";
-          }
-        }
+      // TODO(shooterit): support to config the alive time of checkpoint
+      auto s = storage->PurgeCheckpoint(30, 24 * 60 * 60);
+      if (!s) {
+        LOG(WARNING) << "[server] Fail to clean checkpoint, error: " << s.Msg();
+      } else if (*s) {
+        LOG(INFO) << "[server] Clean checkpoint successfully";
       }
     }
     // check if DB need to be resumed every minute
@@ -876,6 +995,25 @@ void Server::GetRocksDBInfo(std::string *info) {
     db->GetIntProperty(subkey_cf_handle, rocksdb::DB::Properties::kBlockCachePinnedUsage, &block_cache_pinned_usage);
     string_stream << "block_cache_pinned_usage[" << subkey_cf_handle->GetName() << "]:" << block_cache_pinned_usage
                   << "\r\n";
+    // the bytes of the filter and the index blocks in the block cache, the top level ones of the partitions included
+    std::map<std::string, std::string> entry_stats;
+    db->GetMapProperty(subkey_cf_handle, rocksdb::DB::Properties::kBlockCacheEntryStats, &entry_stats);
+    auto used_bytes = [&entry_stats](rocksdb::CacheEntryRole role) {
+      return ParseInt<uint64_t>(entry_stats[rocksdb::BlockCacheEntryStatsMapKeys::UsedBytes(role)]).ValueOr(0);
+    };
+    string_stream << "block_cache_filter_usage:"
+                  << used_bytes(rocksdb::CacheEntryRole::kFilterBlock) +
+                         used_bytes(rocksdb::CacheEntryRole::kFilterMetaBlock)
+                  << "\r\n";
+    string_stream << "block_cache_index_usage:" << used_bytes(rocksdb::CacheEntryRole::kIndexBlock) << "\r\n";
+  }
+  if (auto tuner = storage->GetTieredCacheTuner()) {
+    string_stream << "secondary_cache_ratio:" << tuner->GetRatio() << "\r\n";
+  }
+  if (auto cache_warmup = storage->GetCacheWarmup()) {
+    string_stream << "block_cache_warmup_in_progress:" << (cache_warmup->IsLoading() ? 1 : 0) << "\r\n";
+    string_stream << "block_cache_warmup_total_keys:" << cache_warmup->GetTotalKeys() << "\r\n";
+    string_stream << "block_cache_warmup_loaded_keys:" << cache_warmup->GetLoadedKeys() << "\r\n";
   }
 
   for (const auto &cf_handle : *storage->GetCFHandles()) {
@@ -904,6 +1042,32 @@ void Server::GetRocksDBInfo(std::string *info) {
                   << "]:" << cf_stats_map["memtable-limit-delays"] << "\r\n";
     string_stream << "memtable_count_limit_stop[" << cf_handle->GetName()
                   << "]:" << cf_stats_map["memtable-limit-stops"] << "\r\n";
+    // the raw size of the entries over the size of the data blocks in the SST files
+    std::map<std::string, std::string> table_props;
+    db->GetMapProperty(cf_handle, rocksdb::DB::Properties::kAggregatedTableProperties, &table_props);
+    auto data_size = ParseInt<uint64_t>(table_props["data_size"]).ValueOr(0);
+    auto raw_size = ParseInt<uint64_t>(table_props["raw_key_size"]).ValueOr(0) +
+                    ParseInt<uint64_t>(table_props["raw_value_size"]).ValueOr(0);
+    double compression_ratio = data_size == 0 ? 1 : static_cast<double>(raw_size) / static_cast<double>(data_size);
+    string_stream << "compression_ratio[" << cf_handle->GetName() << "]:" << fmt::format("{:.2f}", compression_ratio)
+                  << "\r\n";
+    // the total size of the filters and the indexes of the SST files, i.e. the memory they take if all cached
+    string_stream << "filter_size[" << cf_handle->GetName()
+                  << "]:" << ParseInt<uint64_t>(table_props["filter_size"]).ValueOr(0) << "\r\n";
+    string_stream << "index_size[" << cf_handle->GetName()
+                  << "]:" << ParseInt<uint64_t>(table_props["index_size"]).ValueOr(0) << "\r\n";
+  }
+
+  if (!config_->rocks_db.cold_dir.empty()) {
+    // the bytes of the live SST files in db_dir and in cold_dir
+    std::vector<rocksdb::LiveFileMetaData> live_files;
+    db->GetLiveFilesMetaData(&live_files);
+    uint64_t hot_tier_bytes = 0, cold_tier_bytes = 0;
+    for (const auto &file : live_files) {
+      (file.db_path == config_->rocks_db.cold_dir ? cold_tier_bytes : hot_tier_bytes) += file.size;
+    }
+    string_stream << "hot_tier_bytes:" << hot_tier_bytes << "\r\n";
+    string_stream << "cold_tier_bytes:" << cold_tier_bytes << "\r\n";
   }
 
   auto rocksdb_stats = storage->GetDB()->GetDBOptions().statistics;
@@ -917,10 +1081,33 @@ void Server::GetRocksDBInfo(std::string *info) {
         {"block_cache_index_miss", rocksdb::Tickers::BLOCK_CACHE_INDEX_MISS},
         {"block_cache_filter_miss", rocksdb::Tickers::BLOCK_CACHE_FILTER_MISS},
         {"block_cache_data_miss", rocksdb::Tickers::BLOCK_CACHE_DATA_MISS},
+        {"secondary_cache_hit", rocksdb::Tickers::SECONDARY_CACHE_HITS},
+        {"secondary_cache_index_hit", rocksdb::Tickers::SECONDARY_CACHE_INDEX_HITS},
+        {"secondary_cache_filter_hit", rocksdb::Tickers::SECONDARY_CACHE_FILTER_HITS},
+        {"secondary_cache_data_hit", rocksdb::Tickers::SECONDARY_CACHE_DATA_HITS},
+        {"compressed_secondary_cache_hit", rocksdb::Tickers::COMPRESSED_SECONDARY_CACHE_HITS},
+        {"compressed_secondary_cache_promotions", rocksdb::Tickers::COMPRESSED_SECONDARY_CACHE_PROMOTIONS},
     };
     for (const auto &iter : block_cache_stats) {
       string_stream << iter.first << ":" << rocksdb_stats->getTickerCount(iter.second) << "\r\n";
     }
+    // the reads of the SST files by their level and by their temperature, which is only known if
+    // rocksdb.last_level_temperature is set
+    std::map<std::string, uint32_t> tier_read_stats = {
+        {"last_level_read_bytes", rocksdb::Tickers::LAST_LEVEL_READ_BYTES},
+        {"last_level_read_count", rocksdb::Tickers::LAST_LEVEL_READ_COUNT},
+        {"non_last_level_read_bytes", rocksdb::Tickers::NON_LAST_LEVEL_READ_BYTES},
+        {"non_last_level_read_count", rocksdb::Tickers::NON_LAST_LEVEL_READ_COUNT},
+        {"hot_file_read_bytes", rocksdb::Tickers::HOT_FILE_READ_BYTES},
+        {"hot_file_read_count", rocksdb::Tickers::HOT_FILE_READ_COUNT},
+        {"warm_file_read_bytes", rocksdb::Tickers::WARM_FILE_READ_BYTES},
+        {"warm_file_read_count", rocksdb::Tickers::WARM_FILE_READ_COUNT},
+        {"cold_file_read_bytes", rocksdb::Tickers::COLD_FILE_READ_BYTES},
+        {"cold_file_read_count", rocksdb::Tickers::COLD_FILE_READ_COUNT},
+    };
+    for (const auto &iter : tier_read_stats) {
+      string_stream << iter.first << ":" << rocksdb_stats->getTickerCount(iter.second) << "\r\n";
+    }
   }
 
   string_stream << "all_mem_tables:" << memtable_sizes << "\r\n";
@@ -934,9 +1121,30 @@ void Server::GetRocksDBInfo(std::string *info) {
   string_stream << "num_live_versions:" << num_live_versions << "\r\n";
   string_stream << "num_super_version:" << num_super_version << "\r\n";
   string_stream << "num_background_errors:" << num_background_errors << "\r\n";
+  auto write_stall_condition = storage->GetWriteStallCondition();
+  string_stream << "write_stall_condition:"
+                << (write_stall_condition == rocksdb::WriteStallCondition::kStopped   ? "stopped"
+                    : write_stall_condition == rocksdb::WriteStallCondition::kDelayed ? "delayed"
+                                                                                      : "normal")
+                << "\r\n";
   auto db_stats = storage->GetDBStats();
   string_stream << "flush_count:" << db_stats->flush_count << "\r\n";
   string_stream << "compaction_count:" << db_stats->compaction_count << "\r\n";
+  string_stream << "compaction_filter_cache_hits:" << db_stats->compaction_filter_cache_hits << "\r\n";
+  string_stream << "compaction_filter_cache_misses:" << db_stats->compaction_filter_cache_misses << "\r\n";
+  string_stream << "write_batch_allocations:" << db_stats->write_batch_allocations << "\r\n";
+  string_stream << "compaction_checker_reclaimed_bytes:" << db_stats->compaction_checker_reclaimed_bytes << "\r\n";
+  const auto *lazy_free_queue = storage->GetLazyFreeQueue();
+  string_stream << "lazyfree_pending_keys:" << lazy_free_queue->GetPendingKeys() << "\r\n";
+  string_stream << "lazyfree_pending_bytes:" << lazy_free_queue->GetPendingBytes() << "\r\n";
+  string_stream << "lazyfreed_keys:" << lazy_free_queue->GetFreedKeys() << "\r\n";
+  const auto &group_commit_stats = storage->GetGroupCommitStats();
+  uint64_t group_commit_batches = group_commit_stats.batches;
+  string_stream << "group_commit_groups:" << group_commit_stats.groups << "\r\n";
+  string_stream << "group_commit_batches:" << group_commit_batches << "\r\n";
+  string_stream << "group_commit_avg_wait_us:"
+                << (group_commit_batches == 0 ? 0 : group_commit_stats.wait_us / group_commit_batches) << "\r\n";
+  string_stream << "group_commit_max_wait_us:" << group_commit_stats.max_wait_us << "\r\n";
   string_stream << "put_per_sec:" << stats.GetInstantaneousMetric(STATS_METRIC_ROCKSDB_PUT) << "\r\n";
   string_stream << "get_per_sec:"
                 << stats.GetInstantaneousMetric(STATS_METRIC_ROCKSDB_GET) +
@@ -985,6 +1193,12 @@ void Server::GetServerInfo(std::string *info) {
   int64_t now_secs = util::GetTimeStamp<std::chrono::seconds>();
   string_stream << "uptime_in_seconds:" << now_secs - start_time_secs_ << "\r\n";
   string_stream << "uptime_in_days:" << (now_secs - start_time_secs_) / 86400 << "\r\n";
+  int64_t startup_ms = 0;
+  for (const auto &[phase, ms] : startup_phases_) {
+    string_stream << "startup_" << phase << "_ms:" << ms << "\r\n";
+    startup_ms += ms;
+  }
+  string_stream << "startup_ms:" << startup_ms << "\r\n";
   *info = string_stream.str();
 }
 
@@ -994,7 +1208,16 @@ void Server::GetClientsInfo(std::string *info) {
   string_stream << "maxclients:" << config_->maxclients << "\r\n";
   string_stream << "connected_clients:" << connected_clients_ << "\r\n";
   string_stream << "monitor_clients:" << monitor_clients_ << "\r\n";
+  string_stream << "monitor_dropped_lines:" << monitor_feed_.GetDroppedRecords() << "\r\n";
   string_stream << "blocked_clients:" << blocked_clients_ << "\r\n";
+  size_t pooled_clients = 0;
+  uint64_t reused_clients = 0;
+  for (const auto &worker_thread : worker_threads_) {
+    pooled_clients += worker_thread->GetWorker()->GetPooledConnections();
+    reused_clients += worker_thread->GetWorker()->GetReusedConnections();
+  }
+  string_stream << "pooled_clients:" << pooled_clients << "\r\n";
+  string_stream << "reused_clients:" << reused_clients << "\r\n";
   *info = string_stream.str();
 }
 
@@ -1011,6 +1234,22 @@ void Server::GetMemoryInfo(std::string *info) {
   string_stream << "used_memory_lua:" << memory_lua << "\r\n";
   string_stream << "used_memory_lua_human:" << used_memory_lua_human << "\r\n";
   string_stream << "used_memory_startup:" << memory_startup_use_.load(std::memory_order_relaxed) << "\r\n";
+  util::RefreshAllocStats();
+  for (size_t i = 0; i < worker_threads_.size(); i++) {
+    int arena = worker_threads_[i]->GetWorker()->GetArena();
+    if (arena < 0) continue;
+    string_stream << "used_memory_worker_" << i << ":" << util::ArenaAllocatedBytes(static_cast<unsigned>(arena))
+                  << "\r\n";
+  }
+  auto huge_pages = config_->rocks_db.huge_pages;
+  string_stream << "huge_pages:"
+                << (huge_pages == HugePageMode::kExplicit      ? "explicit"
+                    : huge_pages == HugePageMode::kTransparent ? "transparent"
+                                                               : "no")
+                << "\r\n";
+  string_stream << "huge_pages_block_cache_bytes:" << engine::HugePageAllocator::MappedBytes() << "\r\n";
+  string_stream << "huge_pages_block_cache_fallbacks:" << engine::HugePageAllocator::FallbackCount() << "\r\n";
+  string_stream << "used_memory_huge_pages:" << engine::HugePageAllocator::ProcessHugePageBytes() << "\r\n";
   *info = string_stream.str();
 }
 
@@ -1042,13 +1281,43 @@ void Server::GetReplicationInfo(std::string *info) {
     string_stream << "slave" << std::to_string(idx) << ":";
     string_stream << "ip=" << slave->GetConn()->GetAnnounceIP() << ",port=" << slave->GetConn()->GetAnnouncePort()
                   << ",offset=" << slave->GetCurrentReplSeq() << ",lag=" << latest_seq - slave->GetCurrentReplSeq()
-                  << "\r\n";
+                  << ",ack=" << slave->GetAckedSeq() << "\r\n";
     ++idx;
   }
   slave_threads_mu_.unlock();
 
   string_stream << "master_repl_offset:" << latest_seq << "\r\n";
 
+  if (storage->IsSecondary()) {
+    string_stream << "secondary_instance:yes\r\n";
+    string_stream << "secondary_catch_up_lag_ms:" << GetSecondaryLagMs() << "\r\n";
+    string_stream << "secondary_last_catch_up_duration_us:" << secondary_catch_up_duration_us_ << "\r\n";
+    string_stream << "secondary_catch_up_failures:" << secondary_catch_up_failures_ << "\r\n";
+  }
+
+  size_t backlog_bytes = 0;
+  auto backlog_first_seq = wal_ring_.GetBacklog(&backlog_bytes);
+  string_stream << "repl_backlog_active:" << (backlog_first_seq == 0 ? 0 : 1) << "\r\n";
+  string_stream << "repl_backlog_size:" << backlog_bytes << "\r\n";
+  string_stream << "repl_backlog_first_seq:" << backlog_first_seq << "\r\n";
+
+  auto compression_raw_bytes = stats.repl_compression_raw_bytes.load(std::memory_order_relaxed);
+  auto compression_sent_bytes = stats.repl_compression_sent_bytes.load(std::memory_order_relaxed);
+  double compression_ratio = compression_sent_bytes == 0 ? 1
+                                                         : static_cast<double>(compression_raw_bytes) /
+                                                               static_cast<double>(compression_sent_bytes);
+  string_stream << "repl_compression_raw_bytes:" << compression_raw_bytes << "\r\n";
+  string_stream << "repl_compression_sent_bytes:" << compression_sent_bytes << "\r\n";
+  string_stream << "repl_compression_ratio:" << fmt::format("{:.2f}", compression_ratio) << "\r\n";
+
+  auto repl_sends = stats.repl_sends.load(std::memory_order_relaxed);
+  auto repl_sent_batches = stats.repl_sent_batches.load(std::memory_order_relaxed);
+  double batches_per_send =
+      repl_sends == 0 ? 0 : static_cast<double>(repl_sent_batches) / static_cast<double>(repl_sends);
+  string_stream << "repl_sends:" << repl_sends << "\r\n";
+  string_stream << "repl_sends_per_sec:" << stats.GetInstantaneousMetric(STATS_METRIC_REPL_SENDS) << "\r\n";
+  string_stream << "repl_batches_per_send:" << fmt::format("{:.2f}", batches_per_send) << "\r\n";
+
   *info = string_stream.str();
 }
 
@@ -1125,7 +1394,7 @@ void Server::GetStatsInfo(std::string *info) {
   std::ostringstream string_stream;
   string_stream << "# Stats\r\n";
   string_stream << "total_connections_received:" << total_clients_ << "\r\n";
-  string_stream << "total_commands_processed:" << stats.total_calls << "\r\n";
+  string_stream << "total_commands_processed:" << stats.GetTotalCalls() << "\r\n";
   string_stream << "instantaneous_ops_per_sec:" << stats.GetInstantaneousMetric(STATS_METRIC_COMMAND) << "\r\n";
   string_stream << "total_net_input_bytes:" << stats.in_bytes << "\r\n";
   string_stream << "total_net_output_bytes:" << stats.out_bytes << "\r\n";
@@ -1136,15 +1405,51 @@ void Server::GetStatsInfo(std::string *info) {
   string_stream << "sync_full:" << stats.fullsync_count << "\r\n";
   string_stream << "sync_partial_ok:" << stats.psync_ok_count << "\r\n";
   string_stream << "sync_partial_err:" << stats.psync_err_count << "\r\n";
+  string_stream << "stall_rejected_writes:" << stats.stall_rejected_writes << "\r\n";
+  string_stream << "evicted_keys:" << stats.evicted_keys << "\r\n";
 
   auto db_stats = storage->GetDBStats();
   string_stream << "keyspace_hits:" << db_stats->keyspace_hits << "\r\n";
   string_stream << "keyspace_misses:" << db_stats->keyspace_misses << "\r\n";
+  if (auto metadata_cache = storage->GetMetadataCache()) {
+    string_stream << "metadata_cache_hits:" << metadata_cache->GetHits() << "\r\n";
+    string_stream << "metadata_cache_misses:" << metadata_cache->GetMisses() << "\r\n";
+    string_stream << "metadata_cache_usage:" << metadata_cache->GetUsage() << "\r\n";
+    if (metadata_cache->IsAbsentEnabled()) {
+      string_stream << "metadata_cache_absent_hits:" << metadata_cache->GetAbsentHits() << "\r\n";
+      string_stream << "metadata_cache_absent_usage:" << metadata_cache->GetAbsentUsage() << "\r\n";
+      string_stream << "metadata_cache_absent_checks:" << metadata_cache->GetAbsentChecks() << "\r\n";
+      string_stream << "metadata_cache_absent_stale:" << metadata_cache->GetAbsentStale() << "\r\n";
+    }
+  }
 
-  {
-    std::lock_guard<std::mutex> lg(pubsub_channels_mu_);
-    string_stream << "pubsub_channels:" << pubsub_channels_.size() << "\r\n";
-    string_stream << "pubsub_patterns:" << pubsub_patterns_.size() << "\r\n";
+  auto lock_mgr = storage->GetLockManager();
+  string_stream << "lock_contentions:" << lock_mgr->GetContentions() << "\r\n";
+  string_stream << "lock_hot_stripes:";
+  bool first = true;
+  for (const auto &[index, contentions] : lock_mgr->GetHotStripes(5)) {
+    string_stream << (first ? "" : ",") << index << "=" << contentions;
+    first = false;
+  }
+  string_stream << "\r\n";
+
+  string_stream << "pubsub_channels:" << pubsub_registry_.GetChannelSize() << "\r\n";
+  string_stream << "pubsub_patterns:" << pubsub_registry_.GetPatternSize() << "\r\n";
+  string_stream << "tracking_total_keys:" << tracking_table_.GetKeySize() << "\r\n";
+  auto task_stats = task_runner_.GetStats();
+  if (heavy_command_runner_) {
+    for (const auto &[type, type_stats] : heavy_command_runner_->GetStats()) task_stats[type] = type_stats;
+  }
+  for (const auto &[type, type_stats] : task_stats) {
+    string_stream << "task_" << type << ":count=" << type_stats.count << ",queue_usec=" << type_stats.queue_time_us
+                  << ",run_usec=" << type_stats.run_time_us << "\r\n";
+  }
+  for (const auto &[ns, ns_stats] : namespace_quotas_.GetStats()) {
+    string_stream << "namespace_quota_" << ns << ":ops=" << ns_stats.quota.ops
+                  << ",read_bytes=" << ns_stats.quota.read_bytes << ",write_bytes=" << ns_stats.quota.write_bytes
+                  << ",weight=" << ns_stats.quota.weight << ",throttled_ops=" << ns_stats.throttled_ops
+                  << ",throttled_reads=" << ns_stats.throttled_reads
+                  << ",throttled_writes=" << ns_stats.throttled_writes << "\r\n";
   }
 
   *info = string_stream.str();
@@ -1154,13 +1459,56 @@ void Server::GetCommandsStatsInfo(std::string *info) {
   std::ostringstream string_stream;
   string_stream << "# Commandstats\r\n";
 
-  for (const auto &cmd_stat : stats.commands_stats) {
-    auto calls = cmd_stat.second.calls.load();
-    if (calls == 0) continue;
+  for (const auto &[name, attributes] : *redis::CommandTable::GetOriginal()) {
+    auto stat = stats.GetCommandStat(attributes->id);
+    if (stat.calls == 0) continue;
 
-    auto latency = cmd_stat.second.latency.load();
-    string_stream << "cmdstat_" << cmd_stat.first << ":calls=" << calls << ",usec=" << latency
-                  << ",usec_per_call=" << static_cast<float>(latency / calls) << "\r\n";
+    string_stream << "cmdstat_" << name << ":calls=" << stat.calls << ",usec=" << stat.latency
+                  << ",usec_per_call=" << static_cast<float>(stat.latency / stat.calls);
+    // the allocations are only counted with jemalloc
+    if (stat.alloc_bytes > 0) {
+      string_stream << ",alloc_bytes_per_call=" << stat.alloc_bytes / stat.calls
+                    << ",max_alloc_bytes=" << stat.max_alloc_bytes;
+    }
+    string_stream << "\r\n";
+  }
+
+  *info = string_stream.str();
+}
+
+void Server::GetLatencyStatsInfo(std::string *info) {
+  std::ostringstream string_stream;
+  string_stream << "# Latencystats\r\n";
+
+  auto append_percentiles = [&string_stream](const std::string &name, const LatencyHistogram &histogram) {
+    auto snapshot = histogram.GetSnapshot();
+    if (snapshot.count == 0) return;
+
+    string_stream << "latency_percentiles_usec_" << name << ":p50=" << snapshot.Percentile(50)
+                  << ",p99=" << snapshot.Percentile(99) << ",p99.9=" << snapshot.Percentile(99.9) << "\r\n";
+  };
+  for (const auto &[name, attributes] : *redis::CommandTable::GetOriginal()) {
+    append_percentiles(name, stats.GetCommandLatencyHistogram(attributes->id));
+  }
+  append_percentiles("lock_manager_wait", stats.lock_wait_histogram);
+  append_percentiles("work_exclusivity_wait", stats.exclusivity_wait_histogram);
+
+  *info = string_stream.str();
+}
+
+void Server::GetPerfStatsInfo(std::string *info) {
+  std::ostringstream string_stream;
+  string_stream << "# Perfstats\r\n";
+
+  for (const auto &[name, attributes] : *redis::CommandTable::GetOriginal()) {
+    auto stat = stats.GetCommandPerfStat(attributes->id);
+    if (stat.samples == 0) continue;
+
+    string_stream << "perfstat_" << name << ":samples=" << stat.samples;
+    for (size_t i = 0; i < STATS_PERF_COUNT; i++) {
+      string_stream << "," << kStatsPerfCounterNames[i] << "=" << stat.counters[i];
+    }
+    string_stream << "\r\n";
   }
 
   *info = string_stream.str();
@@ -1218,6 +1566,17 @@ void Server::GetInfo(const std::string &ns, const std::string &section, std::str
                   << (last_bgsave_timestamp_secs_ == -1 ? start_time_secs_ : last_bgsave_timestamp_secs_) << "\r\n";
     string_stream << "last_bgsave_status:" << last_bgsave_status_ << "\r\n";
     string_stream << "last_bgsave_time_sec:" << last_bgsave_duration_secs_ << "\r\n";
+    string_stream << "rdb_export_in_progress:" << (is_rdb_exporting_ ? 1 : 0) << "\r\n";
+    string_stream << "rdb_export_keys:" << (rdb_exporter_ ? rdb_exporter_->GetExportedKeys() : 0) << "\r\n";
+    string_stream << "rdb_export_skipped_keys:" << (rdb_exporter_ ? rdb_exporter_->GetSkippedKeys() : 0) << "\r\n";
+    string_stream << "last_rdb_export_status:" << last_rdb_export_status_ << "\r\n";
+    string_stream << "namespace_purge_in_progress:" << (is_namespace_purging_ ? 1 : 0) << "\r\n";
+    string_stream << "namespace_purge_pending:" << pending_namespace_purges_.size() << "\r\n";
+    string_stream << "namespace_purge_total_bytes:" << (namespace_purger_ ? namespace_purger_->GetTotalBytes() : 0)
+                  << "\r\n";
+    string_stream << "namespace_purge_purged_bytes:" << (namespace_purger_ ? namespace_purger_->GetPurgedBytes() : 0)
+                  << "\r\n";
+    string_stream << "last_namespace_purge_status:" << last_namespace_purge_status_ << "\r\n";
   }
 
   if (all || section == "stats") {
@@ -1248,6 +1607,15 @@ void Server::GetInfo(const std::string &ns, const std::string &section, std::str
                   << static_cast<float>(self_ru.ru_utime.tv_sec) +
                          static_cast<float>(self_ru.ru_utime.tv_usec / 1000000)
                   << "\r\n";
+    uint64_t rebalanced_clients = 0;
+    for (size_t i = 0; i < worker_threads_.size(); i++) {
+      auto worker = worker_threads_[i]->GetWorker();
+      string_stream << "worker_" << i << "_utilization:" << fmt::format("{:.2f}", worker->GetUtilization()) << "\r\n";
+      rebalanced_clients += worker->GetRebalancedConnections();
+    }
+    string_stream << "rebalanced_clients:" << rebalanced_clients << "\r\n";
+    string_stream << "worker_threads:" << worker_threads_.size() << "\r\n";
+    string_stream << "worker_max_loop_delay_us:" << worker_loop_delay_us_ << "\r\n";
   }
 
   if (all || section == "commandstats") {
@@ -1257,6 +1625,20 @@ void Server::GetInfo(const std::string &ns, const std::string &section, std::str
     string_stream << commands_stats_info;
   }
 
+  if (all || section == "latencystats") {
+    std::string latency_stats_info;
+    GetLatencyStatsInfo(&latency_stats_info);
+    if (section_cnt++) string_stream << "\r\n";
+    string_stream << latency_stats_info;
+  }
+
+  if (all || section == "perfstats") {
+    std::string perf_stats_info;
+    GetPerfStatsInfo(&perf_stats_info);
+    if (section_cnt++) string_stream << "\r\n";
+    string_stream << perf_stats_info;
+  }
+
   if (all || section == "cluster") {
     std::string cluster_info;
     GetClusterInfo(&cluster_info);
@@ -1283,6 +1665,29 @@ void Server::GetInfo(const std::string &ns, const std::string &section, std::str
     }
     string_stream << "db0:keys=" << stats.n_key << ",expires=" << stats.n_expires << ",avg_ttl=" << stats.avg_ttl
                   << ",expired=" << stats.n_expired << "\r\n";
+    ApproxKeyNumStats approx_stats;
+    if (storage->GetApproxKeyNumStats(&approx_stats)) {
+      string_stream << "approx_keys:" << approx_stats.n_key << "\r\n";
+      string_stream << "approx_expired_keys:" << approx_stats.n_expired << "\r\n";
+      string_stream << "approx_sub_keys:" << approx_stats.n_sub_key << "\r\n";
+      for (const auto &[type, n] : approx_stats.type_keys) {
+        string_stream << "approx_keys_" << type << ":" << n << "\r\n";
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lg(db_job_mu_);
+      string_stream << "bigkeys_analysis_in_progress:" << (is_big_keys_analyzing_ ? 1 : 0) << "\r\n";
+      string_stream << "last_bigkeys_analysis_status:" << last_big_keys_analysis_status_ << "\r\n";
+    }
+    string_stream << "bigkeys_scanned_keys:" << big_key_analyzer_.GetScannedKeys() << "\r\n";
+    string_stream << "bigkeys_analysis_start_time:" << big_key_analyzer_.GetStartTime() << "\r\n";
+    string_stream << "bigkeys_analysis_finish_time:" << big_key_analyzer_.GetFinishTime() << "\r\n";
+    for (const auto &[type, top_keys] : big_key_analyzer_.GetTopKeys(ns)) {
+      if (top_keys.by_bytes.empty()) continue;
+      const auto &big_key = top_keys.by_bytes.front();
+      string_stream << "bigkey_" << RedisTypeNames[type] << ":key=" << big_key.key << ",elements=" << big_key.elements
+                    << ",bytes=" << big_key.bytes << "\r\n";
+    }
     string_stream << "sequence:" << storage->GetDB()->GetLatestSequenceNumber() << "\r\n";
     string_stream << "used_db_size:" << storage->GetTotalSize(ns) << "\r\n";
     string_stream << "max_db_size:" << config_->max_db_size * GiB << "\r\n";
@@ -1333,6 +1738,138 @@ std::string Server::GetRocksDBStatsJson() const {
   return stats_json.to_string();
 }
 
+void Server::GetOpenMetrics(std::string *output) {
+  OpenMetricsWriter writer(output);
+  auto counter = [&writer](const char *name, const char *help, uint64_t value) {
+    writer.Family(name, "counter", help);
+    writer.Sample(std::string(name) + "_total", {}, value);
+  };
+  auto gauge = [&writer](const char *name, const char *help, uint64_t value) {
+    writer.Family(name, "gauge", help);
+    writer.Sample(name, {}, value);
+  };
+
+  gauge("kvrocks_uptime_seconds", "Seconds since the server started",
+        static_cast<uint64_t>(util::GetTimeStamp() - start_time_secs_));
+  gauge("kvrocks_connected_clients", "Connected clients", connected_clients_);
+  gauge("kvrocks_blocked_clients", "Clients blocked by the blocking commands", blocked_clients_);
+  gauge("kvrocks_used_memory_rss_bytes", "Resident memory of the process", Stats::GetMemoryRSS());
+  counter("kvrocks_connections_received", "Connections accepted", total_clients_);
+  counter("kvrocks_commands_processed", "Commands processed", stats.GetTotalCalls());
+  counter("kvrocks_net_input_bytes", "Bytes read from the network", stats.in_bytes);
+  counter("kvrocks_net_output_bytes", "Bytes written to the network", stats.out_bytes);
+  counter("kvrocks_stall_rejected_writes", "Writes rejected by the write stall of RocksDB",
+          stats.stall_rejected_writes);
+  counter("kvrocks_evicted_keys", "Keys evicted over max-db-size", stats.evicted_keys);
+  auto db_stats = storage->GetDBStats();
+  counter("kvrocks_keyspace_hits", "Lookups of the keys found", db_stats->keyspace_hits);
+  counter("kvrocks_keyspace_misses", "Lookups of the keys not found", db_stats->keyspace_misses);
+
+  const auto &commands = *redis::CommandTable::GetOriginal();
+  writer.Family("kvrocks_command_calls", "counter", "Calls of each command.");
+  for (const auto &[name, attributes] : commands) {
+    auto stat = stats.GetCommandStat(attributes->id);
+    if (stat.calls > 0) writer.Sample("kvrocks_command_calls_total", {{"cmd", name}}, stat.calls);
+  }
+  writer.Family("kvrocks_command_duration_seconds", "counter", "Seconds spent on each command.");
+  for (const auto &[name, attributes] : commands) {
+    auto stat = stats.GetCommandStat(attributes->id);
+    if (stat.calls > 0) {
+      writer.Sample("kvrocks_command_duration_seconds_total", {{"cmd", name}}, static_cast<double>(stat.latency) / 1e6);
+    }
+  }
+  writer.Family("kvrocks_command_latency_seconds", "histogram", "Latency of each command.");
+  for (const auto &[name, attributes] : commands) {
+    auto snapshot = stats.GetCommandLatencyHistogram(attributes->id).GetSnapshot();
+    if (snapshot.count > 0) writer.Histogram("kvrocks_command_latency_seconds", {{"cmd", name}}, snapshot);
+  }
+  writer.Family("kvrocks_foreground_latency_seconds", "histogram", "Latency of the commands of the clients.");
+  writer.Histogram("kvrocks_foreground_latency_seconds", {}, stats.foreground_latency_histogram.GetSnapshot());
+  writer.Family("kvrocks_lock_wait_seconds", "histogram", "Contended waits on the key locks.");
+  writer.Histogram("kvrocks_lock_wait_seconds", {}, stats.lock_wait_histogram.GetSnapshot());
+  writer.Family("kvrocks_work_exclusivity_wait_seconds", "histogram", "Waits on the exclusivity of the workers.");
+  writer.Histogram("kvrocks_work_exclusivity_wait_seconds", {}, stats.exclusivity_wait_histogram.GetSnapshot());
+
+  {
+    std::lock_guard<std::mutex> guard(rocksdb_metrics_mu_);
+    output->append(rocksdb_metrics_);
+  }
+  writer.Finish();
+}
+
+void Server::refreshRocksDBMetrics() {
+  static constexpr std::pair<const char *, const char *> kCFProperties[] = {
+      {"estimate-num-keys", "Estimated keys"},
+      {"total-sst-files-size", "Bytes of all the SST files"},
+      {"live-sst-files-size", "Bytes of the SST files of the current version"},
+      {"cur-size-all-mem-tables", "Bytes of the active and unflushed immutable memtables"},
+      {"estimate-pending-compaction-bytes", "Estimated bytes to be rewritten by the pending compactions"},
+      {"num-immutable-mem-table", "Immutable memtables not flushed yet"},
+  };
+  static constexpr std::pair<const char *, const char *> kDBProperties[] = {
+      {"num-running-compactions", "Running compactions"},
+      {"num-running-flushes", "Running flushes"},
+      {"num-snapshots", "Unreleased snapshots"},
+      {"background-errors", "Accumulated background errors"},
+  };
+  static constexpr std::tuple<rocksdb::Tickers, const char *, const char *> kTickers[] = {
+      {rocksdb::BLOCK_CACHE_HIT, "block_cache_hits", "Hits of the block cache"},
+      {rocksdb::BLOCK_CACHE_MISS, "block_cache_misses", "Misses of the block cache"},
+      {rocksdb::BYTES_READ, "bytes_read", "Bytes read by the point lookups"},
+      {rocksdb::BYTES_WRITTEN, "bytes_written", "Bytes written by the writes"},
+      {rocksdb::COMPACT_READ_BYTES, "compact_read_bytes", "Bytes read by the compactions"},
+      {rocksdb::COMPACT_WRITE_BYTES, "compact_write_bytes", "Bytes written by the compactions"},
+      {rocksdb::FLUSH_WRITE_BYTES, "flush_write_bytes", "Bytes written by the flushes"},
+      {rocksdb::STALL_MICROS, "stall_micros", "Microseconds the writes were stalled"},
+  };
+
+  std::string output;
+  OpenMetricsWriter writer(&output);
+  auto db = storage->GetDB();
+  auto metric_name = [](const char *property) {
+    std::string name = fmt::format("kvrocks_rocksdb_{}", property);
+    std::replace(name.begin(), name.end(), '-', '_');
+    return name;
+  };
+
+  for (const auto &[property, help] : kCFProperties) {
+    auto name = metric_name(property);
+    writer.Family(name, "gauge", help);
+    for (auto cf_handle : *storage->GetCFHandles()) {
+      uint64_t value = 0;
+      if (db->GetIntProperty(cf_handle, fmt::format("rocksdb.{}", property), &value)) {
+        writer.Sample(name, {{"cf", cf_handle->GetName()}}, value);
+      }
+    }
+  }
+  for (const auto &[property, help] : kDBProperties) {
+    auto name = metric_name(property);
+    uint64_t value = 0;
+    if (!db->GetAggregatedIntProperty(fmt::format("rocksdb.{}", property), &value)) continue;
+    writer.Family(name, "gauge", help);
+    writer.Sample(name, {}, value);
+  }
+
+  // All column families share the same block cache, so it's good to count a single one.
+  uint64_t block_cache_usage = 0;
+  if (db->GetIntProperty(storage->GetCFHandle(ColumnFamilyID::PrimarySubkey),
+                         rocksdb::DB::Properties::kBlockCacheUsage, &block_cache_usage)) {
+    writer.Family("kvrocks_rocksdb_block_cache_usage_bytes", "gauge", "Bytes of the block cache in use");
+    writer.Sample("kvrocks_rocksdb_block_cache_usage_bytes", {}, block_cache_usage);
+  }
+
+  if (auto statistics = db->GetDBOptions().statistics) {
+    for (const auto &[ticker, ticker_name, help] : kTickers) {
+      auto name = fmt::format("kvrocks_rocksdb_{}", ticker_name);
+      writer.Family(name, "counter", help);
+      writer.Sample(name + "_total", {}, statistics->getTickerCount(ticker));
+    }
+  }
+
+  std::lock_guard<std::mutex> guard(rocksdb_metrics_mu_);
+  rocksdb_metrics_ = std::move(output);
+}
+
 // This function is called by replication thread when finished fetching all files from its master.
 // Before restoring the db from backup or checkpoint, we should
 // guarantee other threads don't access DB and its column families, then close db.
@@ -1340,6 +1877,8 @@ bool Server::PrepareRestoreDB() {
   // Stop feeding slaves thread
   LOG(INFO) << "[server] Disconnecting slaves...";
   DisconnectSlaves();
+  // The replication backlog and its WAL iterator belong to the replaced db
+  wal_ring_.Reset();
 
   // If the DB is restored, the object 'db_' will be destroyed, but
   // 'db_' will be accessed in data migration task. To avoid wrong
@@ -1364,6 +1903,22 @@ bool Server::PrepareRestoreDB() {
   }
   works_concurrency_rw_lock_.unlock();
 
+  // The streaming replies abort on their next write callback once the server is loading,
+  // which is triggered even if their clients don't read
+  LOG(INFO) << "[server] Waiting for aborting the streaming replies...";
+  for (int i = 0;; i++) {
+    {
+      std::lock_guard<std::mutex> guard(streaming_replies_mu_);
+      if (streaming_replies_.empty()) break;
+      if (i % 100 == 0) {
+        for (auto bev : streaming_replies_) {
+          bufferevent_trigger(bev, EV_WRITE, BEV_TRIG_IGNORE_WATERMARKS | BEV_TRIG_DEFER_CALLBACKS);
+        }
+      }
+    }
+    usleep(1000);
+  }
+
   // Stop task runner
   LOG(INFO) << "[server] Stopping the task runner and clear task queue...";
   task_runner_.Cancel();
@@ -1388,7 +1943,8 @@ void Server::WaitNoMigrateProcessing() {
   }
 }
 
-Status Server::AsyncCompactDB(const std::string &begin_key, const std::string &end_key) {
+Status Server::AsyncCompactDB(const std::string &begin_key, const std::string &end_key,
+                              rocksdb::ColumnFamilyHandle *cf) {
   if (is_loading_) {
     return {Status::NotOK, "loading in-progress"};
   }
@@ -1400,19 +1956,36 @@ Status Server::AsyncCompactDB(const std::string &begin_key, const std::string &e
 
   db_compacting_ = true;
 
-  return task_runner_.TryPublish([begin_key, end_key, this] {
-    std::unique_ptr<Slice> begin = nullptr, end = nullptr;
-    if (!begin_key.empty()) begin = std::make_unique<Slice>(begin_key);
-    if (!end_key.empty()) end = std::make_unique<Slice>(end_key);
+  return task_runner_.TryPublish(
+      [begin_key, end_key, cf, this] {
+        std::unique_ptr<Slice> begin = nullptr, end = nullptr;
+        if (!begin_key.empty()) begin = std::make_unique<Slice>(begin_key);
+        if (!end_key.empty()) end = std::make_unique<Slice>(end_key);
 
-    auto s = storage->Compact(nullptr, begin.get(), end.get());
-    if (!s.ok()) {
-      LOG(ERROR) << "[task runner] Failed to do compaction: " << s.ToString();
-    }
+        auto s = storage->Compact(cf, begin.get(), end.get());
+        if (!s.ok()) {
+          LOG(ERROR) << "[task runner] Failed to do compaction: " << s.ToString();
+        }
 
-    std::lock_guard<std::mutex> lg(db_job_mu_);
-    db_compacting_ = false;
-  });
+        std::lock_guard<std::mutex> lg(db_job_mu_);
+        db_compacting_ = false;
+      },
+      TaskPriority::kLow, "compaction");
+}
+
+void Server::ScheduleLazyFree() {
+  if (lazy_free_scheduled_.exchange(true)) return;
+
+  auto s = task_runner_.TryPublish(
+      [this] {
+        auto s = storage->LazyFree();
+        if (!s.IsOK()) {
+          LOG(WARNING) << "[task runner] Failed to lazy free the deleted keys: " << s.Msg();
+        }
+        lazy_free_scheduled_ = false;
+      },
+      TaskPriority::kHigh, "lazy_free");
+  if (!s.IsOK()) lazy_free_scheduled_ = false;
 }
 
 Status Server::AsyncBgSaveDB() {
@@ -1423,23 +1996,110 @@ Status Server::AsyncBgSaveDB() {
 
   is_bgsave_in_progress_ = true;
 
-  return task_runner_.TryPublish([this] {
-    auto start_bgsave_time_secs = util::GetTimeStamp<std::chrono::seconds>();
-    Status s = storage->CreateBackup();
-    auto stop_bgsave_time_secs = util::GetTimeStamp<std::chrono::seconds>();
+  return task_runner_.TryPublish(
+      [this] {
+        auto start_bgsave_time_secs = util::GetTimeStamp<std::chrono::seconds>();
+        Status s = storage->CreateBackup();
+        auto stop_bgsave_time_secs = util::GetTimeStamp<std::chrono::seconds>();
 
-    std::lock_guard<std::mutex> lg(db_job_mu_);
-    is_bgsave_in_progress_ = false;
-    last_bgsave_timestamp_secs_ = start_bgsave_time_secs;
-    last_bgsave_status_ = s.IsOK() ? "ok" : "err";
-    last_bgsave_duration_secs_ = stop_bgsave_time_secs - start_bgsave_time_secs;
-  });
+        std::lock_guard<std::mutex> lg(db_job_mu_);
+        is_bgsave_in_progress_ = false;
+        last_bgsave_timestamp_secs_ = start_bgsave_time_secs;
+        last_bgsave_status_ = s.IsOK() ? "ok" : "err";
+        last_bgsave_duration_secs_ = stop_bgsave_time_secs - start_bgsave_time_secs;
+      },
+      TaskPriority::kLow, "bgsave");
+}
+
+Status Server::AsyncExportRdb(const std::string &ns, const std::string &path) {
+  std::lock_guard<std::mutex> lg(db_job_mu_);
+  if (is_rdb_exporting_) {
+    return {Status::NotOK, "rdb export in-progress"};
+  }
+
+  auto exporter = std::make_shared<RdbExporter>(storage, ns, path);
+  rdb_exporter_ = exporter;
+  is_rdb_exporting_ = true;
+
+  auto s = task_runner_.TryPublish(
+      [exporter, this] {
+        auto s = exporter->Export();
+        if (!s) {
+          LOG(WARNING) << "[task runner] Failed to export the RDB file " << exporter->GetPath() << ": " << s.Msg();
+        }
+
+        std::lock_guard<std::mutex> lg(db_job_mu_);
+        is_rdb_exporting_ = false;
+        last_rdb_export_status_ = s ? "ok" : "err";
+      },
+      TaskPriority::kLow, "rdb_export");
+  if (!s) is_rdb_exporting_ = false;
+  return s;
+}
+
+Status Server::AsyncPurgeNamespace(const std::string &ns) {
+  std::lock_guard<std::mutex> lg(db_job_mu_);
+  // the purge waiting to start would cover the data flushed since it's queued
+  if (pending_namespace_purges_.count(ns)) return Status::OK();
+
+  pending_namespace_purges_.insert(ns);
+  auto s = task_runner_.TryPublish(
+      [ns, this] {
+        auto purger = std::make_shared<NamespacePurger>(storage, ns);
+        {
+          std::lock_guard<std::mutex> lg(db_job_mu_);
+          pending_namespace_purges_.erase(ns);
+          namespace_purger_ = purger;
+          is_namespace_purging_ = true;
+        }
+
+        auto s = purger->Purge();
+        if (!s) LOG(WARNING) << "[task runner] Failed to purge the namespace " << ns << ": " << s.Msg();
+
+        std::lock_guard<std::mutex> lg(db_job_mu_);
+        is_namespace_purging_ = false;
+        last_namespace_purge_status_ = s ? "ok" : "err";
+      },
+      TaskPriority::kLow, "namespace_purge");
+  if (!s) pending_namespace_purges_.erase(ns);
+  return s;
+}
+
+Status Server::AsyncAnalyzeBigKeys(size_t top_n) {
+  std::lock_guard<std::mutex> lg(db_job_mu_);
+  if (is_big_keys_analyzing_) {
+    return {Status::NotOK, "big keys analysis in-progress"};
+  }
+
+  is_big_keys_analyzing_ = true;
+  auto s = task_runner_.TryPublish(
+      [top_n, this] {
+        auto s = big_key_analyzer_.Run(top_n);
+        if (!s) LOG(WARNING) << "[task runner] Failed to analyze the big keys: " << s.Msg();
+
+        std::lock_guard<std::mutex> lg(db_job_mu_);
+        is_big_keys_analyzing_ = false;
+        last_big_keys_analysis_status_ = s ? "ok" : "err";
+      },
+      TaskPriority::kLow, "bigkeys");
+  if (!s) is_big_keys_analyzing_ = false;
+  return s;
+}
+
+Status Server::ResetBigKeys() {
+  std::lock_guard<std::mutex> lg(db_job_mu_);
+  if (is_big_keys_analyzing_) {
+    return {Status::NotOK, "big keys analysis in-progress"};
+  }
+  return big_key_analyzer_.Reset();
 }
 
 Status Server::AsyncPurgeOldBackups(uint32_t num_backups_to_keep, uint32_t backup_max_keep_hours) {
-  return task_runner_.TryPublish([num_backups_to_keep, backup_max_keep_hours, this] {
-    storage->PurgeOldBackups(num_backups_to_keep, backup_max_keep_hours);
-  });
+  return task_runner_.TryPublish(
+      [num_backups_to_keep, backup_max_keep_hours, this] {
+        storage->PurgeOldBackups(num_backups_to_keep, backup_max_keep_hours);
+      },
+      TaskPriority::kLow, "purge_backups");
 }
 
 Status Server::AsyncScanDBSize(const std::string &ns) {
@@ -1455,22 +2115,24 @@ Status Server::AsyncScanDBSize(const std::string &ns) {
 
   db_scan_infos_[ns].is_scanning = true;
 
-  return task_runner_.TryPublish([ns, this] {
-    redis::Database db(storage, ns);
+  return task_runner_.TryPublish(
+      [ns, this] {
+        redis::Database db(storage, ns);
 
-    KeyNumStats stats;
-    engine::Context ctx(storage);
-    auto s = db.GetKeyNumStats(ctx, "", &stats);
-    if (!s.ok()) {
-      LOG(ERROR) << "failed to retrieve key num stats: " << s.ToString();
-    }
+        KeyNumStats stats;
+        engine::Context ctx(storage);
+        auto s = db.ScanKeyNumStats(ctx, config_->dbsize_scan_threads, &stats);
+        if (!s.ok()) {
+          LOG(ERROR) << "failed to retrieve key num stats: " << s.ToString();
+        }
 
-    std::lock_guard<std::mutex> lg(db_job_mu_);
+        std::lock_guard<std::mutex> lg(db_job_mu_);
 
-    db_scan_infos_[ns].key_num_stats = stats;
-    db_scan_infos_[ns].last_scan_time_secs = util::GetTimeStamp();
-    db_scan_infos_[ns].is_scanning = false;
-  });
+        db_scan_infos_[ns].key_num_stats = stats;
+        db_scan_infos_[ns].last_scan_time_secs = util::GetTimeStamp();
+        db_scan_infos_[ns].is_scanning = false;
+      },
+      TaskPriority::kLow, "dbsize_scan");
 }
 
 Status Server::autoResizeBlockAndSST() {
@@ -1600,30 +2262,36 @@ StatusOr<std::vector<rocksdb::BatchResult>> Server::PollUpdates(uint64_t next_se
 }
 
 void Server::SlowlogPushEntryIfNeeded(const std::vector<std::string> *args, uint64_t duration,
-                                      const redis::Connection *conn) {
+                                      const redis::Connection *conn, const PerfSample *perf_sample,
+                                      uint64_t alloc_bytes) {
   int64_t threshold = config_->slowlog_log_slower_than;
   if (threshold < 0 || static_cast<int64_t>(duration) < threshold) return;
 
-  auto entry = std::make_unique<SlowEntry>();
+  SlowEntry entry;
   size_t argc = args->size() > kSlowLogMaxArgc ? kSlowLogMaxArgc : args->size();
+  entry.args.reserve(argc);
   for (size_t i = 0; i < argc; i++) {
     if (argc != args->size() && i == argc - 1) {
-      entry->args.emplace_back(fmt::format("... ({} more arguments)", args->size() - argc + 1));
+      entry.args.emplace_back(fmt::format("... ({} more arguments)", args->size() - argc + 1));
       break;
     }
 
     if ((*args)[i].length() <= kSlowLogMaxString) {
-      entry->args.emplace_back((*args)[i]);
+      entry.args.emplace_back((*args)[i]);
     } else {
-      entry->args.emplace_back(fmt::format("{}... ({} more bytes)", (*args)[i].substr(0, kSlowLogMaxString),
-                                           (*args)[i].length() - kSlowLogMaxString));
+      entry.args.emplace_back(fmt::format("{}... ({} more bytes)", (*args)[i].substr(0, kSlowLogMaxString),
+                                          (*args)[i].length() - kSlowLogMaxString));
     }
   }
 
-  entry->duration = duration;
-  entry->client_name = conn->GetName();
-  entry->ip = conn->GetIP();
-  entry->port = conn->GetPort();
+  entry.duration = duration;
+  entry.client_name = conn->GetName();
+  entry.ip = conn->GetIP();
+  entry.port = conn->GetPort();
+  if (perf_sample) entry.perf_stats = FormatPerfSample(*perf_sample);
+  if (alloc_bytes > 0) {
+    entry.perf_stats += fmt::format("{}alloc_bytes={}", entry.perf_stats.empty() ? "" : ",", alloc_bytes);
+  }
   slow_log_.PushEntry(std::move(entry));
 }
 
@@ -1642,6 +2310,22 @@ std::string Server::GetClientsStr() {
   return clients;
 }
 
+std::string Server::GetTopClientsStr(redis::Connection::Resource resource, size_t count) {
+  std::vector<std::pair<uint64_t, std::string>> clients;
+  for (const auto &t : worker_threads_) {
+    t->GetWorker()->GetClientsByResource(resource, &clients);
+  }
+
+  count = std::min(count, clients.size());
+  std::partial_sort(clients.begin(), clients.begin() + static_cast<ptrdiff_t>(count), clients.end(),
+                    [](const auto &a, const auto &b) { return a.first > b.first; });
+  std::string output;
+  for (size_t i = 0; i < count; i++) {
+    output.append(clients[i].second);
+  }
+  return output;
+}
+
 void Server::KillClient(int64_t *killed, const std::string &addr, uint64_t id, uint64_t type, bool skipme,
                         redis::Connection *conn) {
   *killed = 0;
@@ -1688,13 +2372,11 @@ ReplState Server::GetReplicationState() {
 StatusOr<std::unique_ptr<redis::Commander>> Server::LookupAndCreateCommand(const std::string &cmd_name) {
   if (cmd_name.empty()) return {Status::RedisUnknownCmd};
 
-  auto commands = redis::CommandTable::Get();
-  auto cmd_iter = commands->find(util::ToLower(cmd_name));
-  if (cmd_iter == commands->end()) {
+  auto cmd_attr = redis::CommandTable::Lookup(cmd_name);
+  if (!cmd_attr) {
     return {Status::RedisUnknownCmd};
   }
 
-  auto cmd_attr = cmd_iter->second;
   auto cmd = cmd_attr->factory();
   cmd->SetAttributes(cmd_attr);
 
@@ -1762,6 +2444,7 @@ Status Server::FunctionSetLib(const std::string &func, const std::string &lib) c
 }
 
 void Server::ScriptReset() {
+  lua_bytecodes_.Clear();
   auto lua = lua_.exchange(lua::CreateState(this));
   lua::DestroyState(lua);
 }
@@ -1867,8 +2550,9 @@ void Server::AdjustOpenFilesLimit() {
   }
 }
 
-void Server::AdjustWorkerThreads() {
-  auto new_worker_threads = static_cast<size_t>(config_->workers);
+void Server::AdjustWorkerThreads() { resizeWorkerThreads(static_cast<size_t>(config_->workers)); }
+
+void Server::resizeWorkerThreads(size_t new_worker_threads) {
   if (new_worker_threads == worker_threads_.size()) {
     return;
   }
@@ -1889,6 +2573,9 @@ void Server::increaseWorkerThreads(size_t delta) {
   for (size_t i = 0; i < delta; i++) {
     auto worker = std::make_unique<Worker>(this, config_);
     auto worker_thread = std::make_unique<WorkerThread>(std::move(worker));
+    if (!config_->worker_cpus.empty()) {
+      worker_thread->SetCPUAffinity(config_->worker_cpus[worker_threads_.size() % config_->worker_cpus.size()]);
+    }
     worker_thread->Start();
     worker_threads_.emplace_back(std::move(worker_thread));
   }
@@ -1917,6 +2604,149 @@ void Server::decreaseWorkerThreads(size_t delta) {
   }
 }
 
+// checkWorkers measures the utilization and the loop delay of the workers every second, then rebalances
+// the connections among them and scales the number of them if it's enabled
+void Server::checkWorkers() {
+  auto now = util::GetTimeStampUS();
+  if (now - worker_checked_us_ < 1000 * 1000) return;
+
+  {
+    auto concurrency = WorkConcurrencyGuard();
+    auto elapsed = static_cast<double>(now - worker_checked_us_);
+    std::map<const Worker *, uint64_t> checked_busy_us;
+    uint64_t max_loop_delay_us = 0;
+    for (const auto &worker_thread : worker_threads_) {
+      auto worker = worker_thread->GetWorker();
+      auto busy_us = worker->GetBusyTime();
+      // a removed worker may share its address with a new one, whose busy time starts from 0
+      if (auto iter = worker_checked_busy_us_.find(worker);
+          iter != worker_checked_busy_us_.end() && busy_us >= iter->second) {
+        worker->SetUtilization(std::min(1.0, static_cast<double>(busy_us - iter->second) / elapsed));
+      }
+      checked_busy_us[worker] = busy_us;
+      max_loop_delay_us = std::max(max_loop_delay_us, worker->TakeMaxLoopDelay());
+    }
+    worker_checked_busy_us_ = std::move(checked_busy_us);
+    worker_checked_us_ = now;
+    worker_loop_delay_us_ = max_loop_delay_us;
+
+    rebalanceWorkers(now);
+  }
+
+  autoscaleWorkers();
+}
+
+// rebalanceWorkers asks the busiest worker to migrate one of its connections to the idlest one every
+// worker-rebalance-interval seconds. To avoid moving the connections back and forth:
+// - the workers are only rebalanced if the gap of their utilization is at least worker-rebalance-threshold,
+// - the migrated connection took at most half of the gap of the busy time, so the busiest worker doesn't
+//   become the idlest one,
+// - a connection isn't migrated again within 3 intervals, see Worker::onRebalance.
+void Server::rebalanceWorkers(uint64_t now) {
+  auto interval = static_cast<uint64_t>(config_->worker_rebalance_interval) * 1000 * 1000;
+  if (interval == 0 || worker_threads_.size() < 2) {
+    worker_rebalanced_busy_us_.clear();
+    return;
+  }
+  if (now - worker_rebalanced_us_ < interval) return;
+
+  Worker *hot = nullptr, *cold = nullptr;
+  uint64_t hot_busy_us = 0, cold_busy_us = 0;
+  for (const auto &worker_thread : worker_threads_) {
+    auto worker = worker_thread->GetWorker();
+    auto iter = worker_rebalanced_busy_us_.find(worker);
+    // the workers added since the last rebalance are taken as idle
+    auto busy_us = iter == worker_rebalanced_busy_us_.end() || worker->GetBusyTime() < iter->second
+                       ? 0
+                       : worker->GetBusyTime() - iter->second;
+    if (!hot || busy_us > hot_busy_us) {
+      hot = worker;
+      hot_busy_us = busy_us;
+    }
+    if (!cold || busy_us < cold_busy_us) {
+      cold = worker;
+      cold_busy_us = busy_us;
+    }
+  }
+  bool rebalance = !worker_rebalanced_busy_us_.empty();
+  worker_rebalanced_busy_us_ = worker_checked_busy_us_;
+  worker_rebalanced_us_ = now;
+
+  auto gap = static_cast<double>(hot_busy_us - cold_busy_us) / static_cast<double>(interval);
+  if (!rebalance || hot == cold || gap * 100 < config_->worker_rebalance_threshold) cold = nullptr;
+
+  // every worker starts a new busy window of its connections, only the busiest one migrates a connection
+  for (const auto &worker_thread : worker_threads_) {
+    auto worker = worker_thread->GetWorker();
+    if (worker == hot) {
+      worker->RequestRebalance(cold, (hot_busy_us - cold_busy_us) / 2);
+    } else {
+      worker->RequestRebalance(nullptr, 0);
+    }
+  }
+}
+
+// autoscaleWorkers adds a worker after the workers have been overloaded for kWorkerScaleUpSecs seconds in a row,
+// i.e. their average utilization reaches worker-autoscale-high-utilization or the requests wait longer than
+// worker-autoscale-max-delay-ms in the loop of a worker, and removes one after they have been underloaded for
+// kWorkerScaleDownSecs seconds in a row, i.e. the average utilization would stay below 3/4 of the high mark
+// without the removed worker. The connections of the removed worker are migrated to the others, see
+// decreaseWorkerThreads. It's called every second.
+void Server::autoscaleWorkers() {
+  if (!config_->worker_autoscale) {
+    worker_overloaded_secs_ = 0;
+    worker_underloaded_secs_ = 0;
+    return;
+  }
+
+  double utilization = 0;
+  auto workers = worker_threads_.size();
+  {
+    auto concurrency = WorkConcurrencyGuard();
+    workers = worker_threads_.size();
+    for (const auto &worker_thread : worker_threads_) utilization += worker_thread->GetWorker()->GetUtilization();
+  }
+  utilization = utilization / static_cast<double>(workers) * 100;
+
+  auto high = static_cast<double>(config_->worker_autoscale_high_utilization);
+  auto max_delay_us = static_cast<uint64_t>(config_->worker_autoscale_max_delay_ms) * 1000;
+  bool overloaded = utilization >= high || worker_loop_delay_us_ >= max_delay_us;
+  // the utilization after a worker is removed, since its load is spread over the others
+  auto shrunk_utilization =
+      workers > 1 ? utilization * static_cast<double>(workers) / static_cast<double>(workers - 1) : high;
+  bool underloaded = shrunk_utilization < high * 3 / 4 && worker_loop_delay_us_ < max_delay_us / 2;
+  worker_overloaded_secs_ = overloaded ? worker_overloaded_secs_ + 1 : 0;
+  worker_underloaded_secs_ = underloaded ? worker_underloaded_secs_ + 1 : 0;
+
+  auto min_workers = static_cast<size_t>(config_->worker_autoscale_min_workers);
+  auto max_workers = static_cast<size_t>(std::max(config_->worker_autoscale_min_workers,
+                                                  config_->worker_autoscale_max_workers));
+  size_t target = std::clamp(workers, min_workers, max_workers);
+  if (worker_overloaded_secs_ >= kWorkerScaleUpSecs && target < max_workers) {
+    target++;
+  } else if (worker_underloaded_secs_ >= kWorkerScaleDownSecs && target > min_workers) {
+    target--;
+  }
+  if (target == workers) return;
+
+  auto exclusivity = WorkExclusivityGuard();
+  // The last worker is removed, and it's kept while some of its connections can't be moved without being closed,
+  // it's checked again after kWorkerScaleDownSecs
+  if (target < worker_threads_.size() && !worker_threads_.back()->GetWorker()->CanMigrateAllConnections()) {
+    LOG(INFO) << "[server] Keep the worker threads at " << worker_threads_.size()
+              << ", since some connections of the last worker can't be moved to the others";
+    worker_underloaded_secs_ = 0;
+    return;
+  }
+  LOG(INFO) << "[server] Scale the worker threads from " << worker_threads_.size() << " to " << target
+            << ", utilization: " << utilization << "%, loop delay: " << worker_loop_delay_us_ << "us";
+  resizeWorkerThreads(target);
+  // CONFIG GET reports the current number of workers
+  config_->workers = static_cast<int>(target);
+  worker_overloaded_secs_ = 0;
+  worker_underloaded_secs_ = 0;
+}
+
 void Server::cleanupExitedWorkerThreads(bool force) {
   std::unique_ptr<WorkerThread> worker_thread = nullptr;
   auto total = recycle_worker_threads_.unsafe_size();
@@ -1957,30 +2787,16 @@ Status ServerLogData::Decode(const rocksdb::Slice &blob) {
 }
 
 void Server::updateWatchedKeysFromRange(const std::vector<std::string> &args, const redis::CommandKeyRange &range) {
-  std::shared_lock lock(watched_key_mutex_);
-
   for (size_t i = range.first_key; range.last_key > 0 ? i <= size_t(range.last_key) : i <= args.size() + range.last_key;
        i += range.key_step) {
-    if (auto iter = watched_key_map_.find(args[i]); iter != watched_key_map_.end()) {
-      for (auto *conn : iter->second) {
-        conn->watched_keys_modified = true;
-      }
-    }
+    watched_keys_.Touch(args[i]);
   }
 }
 
-void Server::updateAllWatchedKeys() {
-  std::shared_lock lock(watched_key_mutex_);
-
-  for (auto &[_, conn_map] : watched_key_map_) {
-    for (auto *conn : conn_map) {
-      conn->watched_keys_modified = true;
-    }
-  }
-}
+void Server::updateAllWatchedKeys() { watched_keys_.TouchAll(); }
 
 void Server::UpdateWatchedKeysFromArgs(const std::vector<std::string> &args, const redis::CommandAttributes &attr) {
-  if ((attr.flags & redis::kCmdWrite) && watched_key_size_ > 0) {
+  if ((attr.flags & redis::kCmdWrite) && !watched_keys_.Empty()) {
     if (attr.key_range.first_key > 0) {
       updateWatchedKeysFromRange(args, attr.key_range);
     } else if (attr.key_range.first_key == -1) {
@@ -2005,54 +2821,240 @@ void Server::UpdateWatchedKeysFromArgs(const std::vector<std::string> &args, con
   }
 }
 
-void Server::UpdateWatchedKeysManually(const std::vector<std::string> &keys) {
-  std::shared_lock lock(watched_key_mutex_);
+void Server::RecordHotKeys(const std::string &ns, const std::vector<std::string> &args,
+                           const redis::CommandAttributes &attr) {
+  int interval = config_->hotkeys_sample_interval;
+  if (interval <= 0) return;
 
-  for (const auto &key : keys) {
-    if (auto iter = watched_key_map_.find(key); iter != watched_key_map_.end()) {
-      for (auto *conn : iter->second) {
-        conn->watched_keys_modified = true;
+  thread_local uint64_t executed_commands = 0;
+  if (executed_commands++ % interval != 0) return;
+
+  bool is_write = attr.flags & redis::kCmdWrite;
+  attr.ForEachKeyRange(
+      [&, this](const std::vector<std::string> &args, const redis::CommandKeyRange &key_range) {
+        key_range.ForEachKey([&, this](const std::string &key) { stats.hot_keys.Record(ns, key, is_write); }, args);
+      },
+      args);
+}
+
+Status Server::EnableTracking(redis::Connection *conn, const TrackingOptions &options) {
+  TrackingTable::Target target{conn->Owner(), conn->GetFD(), conn->GetID(), conn->GetProtocolVersion(), false};
+  if (options.redirect != 0 && options.redirect != conn->GetID()) {
+    bool found = false;
+    for (const auto &worker_thread : worker_threads_) {
+      auto worker = worker_thread->GetWorker();
+      if (auto redirect_conn = worker->FindConnection(options.redirect)) {
+        target = {worker, redirect_conn->first, options.redirect, redirect_conn->second, true};
+        found = true;
+        break;
       }
     }
+    if (!found) return {Status::RedisExecErr, "The client ID you want redirect to does not exist"};
+  } else if (conn->GetProtocolVersion() != redis::RESP::v3) {
+    // RESP2 has no push messages, the invalidations can only be redirected to a subscribing connection
+    return {Status::RedisExecErr, "CLIENT TRACKING without REDIRECT requires RESP3, switch the protocol by HELLO 3"};
+  }
+
+  tracking_table_.EnableClient(conn->GetID(), conn->GetNamespace(), target, options);
+  conn->tracking = options;
+  conn->tracking_caching.reset();
+  return Status::OK();
+}
+
+void Server::DisableTracking(redis::Connection *conn) {
+  if (!conn->tracking) return;
+  tracking_table_.DisableClient(conn->GetID());
+  conn->tracking.reset();
+  conn->tracking_caching.reset();
+}
+
+void Server::UpdateTrackedKeys(redis::Connection *conn, const std::vector<std::string> &args,
+                               const redis::CommandAttributes &attr) {
+  if (!tracking_table_.HasClients() || !(attr.flags & redis::kCmdWrite)) return;
+
+  std::vector<std::string> keys;
+  attr.ForEachKeyRange(
+      [&](const std::vector<std::string> &args, const redis::CommandKeyRange &key_range) {
+        key_range.ForEachKey([&](const std::string &key) { keys.emplace_back(key); }, args);
+      },
+      args);
+
+  if (keys.empty() && attr.key_range.first_key == 0) {
+    // the commands like FLUSHDB invalidate all the keys
+    TrackingTable::Invalidations invalidations;
+    for (auto id : tracking_table_.InvalidateAll()) invalidations.emplace(id, std::vector<std::string>{});
+    sendInvalidations(invalidations);
+    return;
   }
+  InvalidateTrackedKeys(conn, keys);
 }
 
-void Server::WatchKey(redis::Connection *conn, const std::vector<std::string> &keys) {
-  std::unique_lock lock(watched_key_mutex_);
+void Server::TrackReadKeys(redis::Connection *conn, const std::vector<std::string> &args,
+                           const redis::CommandAttributes &attr) {
+  if (!tracking_table_.HasClients() || (attr.flags & redis::kCmdWrite)) return;
+  if (!conn->tracking || conn->tracking->bcast) return;
+  // In the OPTIN and OPTOUT modes, the keys are tracked by the CLIENT CACHING before the command
+  bool cached = true;
+  if (conn->tracking->optin) cached = conn->tracking_caching.value_or(false);
+  if (conn->tracking->optout) cached = conn->tracking_caching.value_or(true);
+  if (!cached) return;
+
+  std::vector<std::string> keys;
+  attr.ForEachKeyRange(
+      [&](const std::vector<std::string> &args, const redis::CommandKeyRange &key_range) {
+        key_range.ForEachKey([&](const std::string &key) { keys.emplace_back(key); }, args);
+      },
+      args);
 
+  auto max_keys = static_cast<size_t>(config_->tracking_table_max_keys);
   for (const auto &key : keys) {
-    if (auto iter = watched_key_map_.find(key); iter != watched_key_map_.end()) {
-      iter->second.emplace(conn);
+    auto evicted = tracking_table_.Track(conn->GetNamespace(), key, conn->GetID(), max_keys);
+    if (!evicted.empty()) sendInvalidations(evicted);
+  }
+}
+
+void Server::InvalidateTrackedKeys(redis::Connection *conn, const std::vector<std::string> &keys) {
+  if (!tracking_table_.HasClients() || keys.empty()) return;
+  sendInvalidations(tracking_table_.Invalidate(conn->GetNamespace(), keys, conn->GetID()));
+}
+
+void Server::sendInvalidations(const TrackingTable::Invalidations &invalidations) {
+  for (const auto &[id, keys] : invalidations) {
+    auto target = tracking_table_.GetTarget(id);
+    if (!target) continue;
+
+    // an empty key list invalidates all the keys, which is sent as a null array
+    auto keys_reply = keys.empty() ? redis::NilArray(target->resp) : redis::ArrayOfBulkStrings(keys);
+    std::string message;
+    if (target->redirected) {
+      message = redis::HeaderOfPush(target->resp, 3) + redis::BulkString("message") +
+                redis::BulkString("__redis__:invalidate") + keys_reply;
     } else {
-      watched_key_map_.emplace(key, std::set<redis::Connection *>{conn});
+      message = redis::HeaderOfPush(target->resp, 2) + redis::BulkString("invalidate") + keys_reply;
     }
+    // the tracking client itself may be gone, its invalidations are dropped
+    if (replyToClient(*target, [&](redis::RESP) { return message; })) continue;
+    if (!target->redirected || !tracking_table_.BreakRedirect(id)) continue;
 
-    conn->watched_keys.insert(key);
+    // The client of REDIRECT is gone, the invalidations are dropped from now on, and the tracking client
+    // is told once by a push message if it's in RESP3, like Redis
+    replyToClient({nullptr, -1, id, redis::RESP::v2, false}, [&](redis::RESP resp) {
+      if (resp != redis::RESP::v3) return std::string();
+      return redis::HeaderOfPush(resp, 2) + redis::BulkString("tracking-redir-broken") +
+             redis::Integer(target->id);
+    });
   }
+}
 
-  watched_key_size_ = watched_key_map_.size();
+bool Server::replyToClient(const TrackingTable::Target &target,
+                           const std::function<std::string(redis::RESP)> &reply) {
+  // the workers are only removed exclusively, and the replies are sent under WorkConcurrencyGuard
+  if (target.owner && HasWorker(target.owner) &&
+      target.owner->ReplyToClient(target.fd, target.id, reply(target.resp)).IsOK()) {
+    return true;
+  }
+  // the client may have been moved to another worker
+  for (const auto &worker_thread : worker_threads_) {
+    auto worker = worker_thread->GetWorker();
+    if (auto conn = worker->FindConnection(target.id)) {
+      auto message = reply(conn->second);
+      return message.empty() || worker->ReplyToClient(conn->first, target.id, message).IsOK();
+    }
+  }
+  return false;
+}
+
+// The class of the keyspace notifications of the commands in the category, 0 if they are not notified
+static int KeyspaceEventClassOf(redis::CommandCategory category) {
+  switch (category) {
+    case redis::CommandCategory::Key:
+      return kNotifyGeneric;
+    case redis::CommandCategory::String:
+    case redis::CommandCategory::Bit:
+    case redis::CommandCategory::HLL:
+      return kNotifyString;
+    case redis::CommandCategory::List:
+      return kNotifyList;
+    case redis::CommandCategory::Set:
+      return kNotifySet;
+    case redis::CommandCategory::Hash:
+      return kNotifyHash;
+    case redis::CommandCategory::ZSet:
+    case redis::CommandCategory::Geo:
+      return kNotifyZSet;
+    case redis::CommandCategory::Stream:
+      return kNotifyStream;
+    case redis::CommandCategory::BloomFilter:
+    case redis::CommandCategory::CountMinSketch:
+    case redis::CommandCategory::CuckooFilter:
+    case redis::CommandCategory::JSON:
+    case redis::CommandCategory::SortedInt:
+    case redis::CommandCategory::TimeSeries:
+    case redis::CommandCategory::TopK:
+      return kNotifyModule;
+    default:
+      return 0;
+  }
+}
+
+void Server::NotifyKeyspaceEvents(const std::string &ns, const std::vector<std::string> &args,
+                                  const redis::CommandAttributes &attr) {
+  int flags = config_->notify_keyspace_events;
+  if (!(flags & (kNotifyKeyspace | kNotifyKeyevent)) || !(attr.flags & redis::kCmdWrite)) return;
+  if (!(flags & KeyspaceEventClassOf(attr.category))) return;
+  // Nothing is formatted if no subscriber can receive the notifications
+  if (!pubsub_registry_.HasKeyspaceSubscribers()) return;
+
+  // The namespaces take the place of the databases of Redis, and the default one is 0
+  const std::string db = ns == kDefaultNamespace ? "0" : ns;
+  attr.ForEachKeyRange(
+      [&, this](const std::vector<std::string> &args, const redis::CommandKeyRange &key_range) {
+        key_range.ForEachKey(
+            [&, this](const std::string &key) {
+              if (flags & kNotifyKeyspace) PublishMessage("__keyspace@" + db + "__:" + key, attr.name);
+              if (flags & kNotifyKeyevent) PublishMessage("__keyevent@" + db + "__:" + attr.name, key);
+            },
+            args);
+      },
+      args);
 }
 
-bool Server::IsWatchedKeysModified(redis::Connection *conn) { return conn->watched_keys_modified; }
+void Server::UpdateWatchedKeysManually(const std::vector<std::string> &keys) {
+  if (watched_keys_.Empty()) return;
 
-void Server::ResetWatchedKeys(redis::Connection *conn) {
-  if (watched_key_size_ != 0) {
-    std::unique_lock lock(watched_key_mutex_);
+  for (const auto &key : keys) {
+    watched_keys_.Touch(key);
+  }
+}
 
-    for (const auto &key : conn->watched_keys) {
-      if (auto iter = watched_key_map_.find(key); iter != watched_key_map_.end()) {
-        iter->second.erase(conn);
+void Server::WatchKey(redis::Connection *conn, const std::vector<std::string> &keys) {
+  for (const auto &key : keys) {
+    // Watching a key again keeps the version of the first WATCH
+    if (conn->watched_keys.count(key)) continue;
 
-        if (iter->second.empty()) {
-          watched_key_map_.erase(iter);
-        }
-      }
+    if (conn->watched_keys.empty()) {
+      conn->watched_global_version = watched_keys_.GetGlobalVersion();
     }
+    conn->watched_keys.emplace(key, watched_keys_.Watch(key));
+  }
+}
+
+bool Server::IsWatchedKeysModified(redis::Connection *conn) const {
+  if (conn->watched_keys.empty()) return false;
+  if (watched_keys_.GetGlobalVersion() != conn->watched_global_version) return true;
+
+  for (const auto &[key, version] : conn->watched_keys) {
+    if (watched_keys_.GetVersion(key) != version) return true;
+  }
+  return false;
+}
 
-    conn->watched_keys.clear();
-    conn->watched_keys_modified = false;
-    watched_key_size_ = watched_key_map_.size();
+void Server::ResetWatchedKeys(redis::Connection *conn) {
+  for (const auto &[key, _] : conn->watched_keys) {
+    watched_keys_.Unwatch(key);
   }
+  conn->watched_keys.clear();
+  conn->watched_global_version = 0;
 }
 
 std::list<std::pair<std::string, uint32_t>> Server::GetSlaveHostAndPort() {
@@ -2130,7 +3132,7 @@ AuthResult Server::AuthenticateUser(const std::string &user_password, std::strin
     return AuthResult::IS_USER;
   }
 
-  if (user_password != requirepass) {
+  if (!util::ConstantTimeEqual(requirepass, user_password)) {
     return AuthResult::INVALID_PASSWORD;
   }
   *ns = kDefaultNamespace;
@@ -37,22 +37,35 @@
 #include <utility>
 #include <vector>
 
+#include "blocking_key_registry.h"
 #include "cluster/cluster.h"
 #include "cluster/replication.h"
 #include "cluster/slot_import.h"
 #include "cluster/slot_migrate.h"
 #include "commands/commander.h"
 #include "lua.hpp"
+#include "metrics_listener.h"
+#include "monitor_feed.h"
 #include "namespace.h"
+#include "namespace_quota.h"
+#include "pubsub_registry.h"
 #include "search/index_manager.h"
 #include "search/indexer.h"
 #include "server/redis_connection.h"
+#include "stats/cpu_profiler.h"
 #include "stats/log_collector.h"
 #include "stats/stats.h"
+#include "storage/big_key_analyzer.h"
+#include "storage/lua_bytecode_cache.h"
 #include "storage/redis_metadata.h"
 #include "storage/storage.h"
+#include "stream_waiter_registry.h"
 #include "task_runner.h"
 #include "tls_util.h"
+#include "tracer.h"
+#include "tracking_table.h"
+#include "traffic_capture.h"
+#include "watched_key_table.h"
 #include "worker.h"
 
 constexpr const char *REDIS_VERSION = "4.0.0";
@@ -81,15 +94,6 @@ struct ConnContext {
   bool operator==(const ConnContext &c) const { return owner == c.owner && fd == c.fd; }
 };
 
-struct StreamConsumer {
-  Worker *owner;
-  int fd;
-  std::string ns;
-  redis::StreamEntryID last_consumed_id;
-  StreamConsumer(Worker *w, int fd, std::string ns, redis::StreamEntryID id)
-      : owner(w), fd(fd), ns(std::move(ns)), last_consumed_id(id) {}
-};
-
 struct ChannelSubscribeNum {
   std::string channel;
   size_t subscribe_num;
@@ -172,6 +176,8 @@ class ServerLogData {
   std::string content_;
 };
 
+class RdbExporter;
+class NamespacePurger;
 class SlotImport;
 class SlotMigrator;
 
@@ -196,9 +202,16 @@ class Server {
   Status AddMaster(const std::string &host, uint32_t port, bool force_reconnect);
   Status RemoveMaster();
   Status AddSlave(redis::Connection *conn, rocksdb::SequenceNumber next_repl_seq);
+  // ApplySSTFile ingests an SST file of a slot migration, or writes its entries through the WAL
+  // if the replicas connected at the moment would miss them
+  Status ApplySSTFile(const std::string &cf_name, const std::string &path);
+  WALRing *GetWALRing() { return &wal_ring_; }
   void DisconnectSlaves();
   void CleanupExitedSlaves();
+  bool HasSlaves();
   bool IsSlave() const { return !master_host_.empty(); }
+  // GetSecondaryLagMs returns the time since the last successful catch up of a secondary instance
+  uint64_t GetSecondaryLagMs() const;
   void FeedMonitorConns(redis::Connection *conn, const std::vector<std::string> &tokens);
   void IncrFetchFileThread() { fetch_file_threads_num_++; }
   void DecrFetchFileThread() { fetch_file_threads_num_--; }
@@ -212,7 +225,23 @@ class Server {
                                std::vector<ChannelSubscribeNum> *channel_subscribe_nums);
   void PSubscribeChannel(const std::string &pattern, redis::Connection *conn);
   void PUnsubscribeChannel(const std::string &pattern, redis::Connection *conn);
-  size_t GetPubSubPatternSize() const { return pubsub_patterns_.size(); }
+  size_t GetPubSubPatternSize() const { return pubsub_registry_.GetPatternSize(); }
+
+  // Client-side caching by CLIENT TRACKING, see TrackingTable
+  Status EnableTracking(redis::Connection *conn, const TrackingOptions &options);
+  void DisableTracking(redis::Connection *conn);
+  // TrackReadKeys records the keys read by a tracking client. It's called before the command runs, so a write
+  // landing between the read and the tracking can't be missed.
+  void TrackReadKeys(redis::Connection *conn, const std::vector<std::string> &args,
+                     const redis::CommandAttributes &attr);
+  // UpdateTrackedKeys invalidates the keys written by a command
+  void UpdateTrackedKeys(redis::Connection *conn, const std::vector<std::string> &args,
+                         const redis::CommandAttributes &attr);
+  void InvalidateTrackedKeys(redis::Connection *conn, const std::vector<std::string> &keys);
+  // ChargeNamespaceQuota charges the bytes of a command to the quota of its namespace, the written
+  // bytes are the arguments of a write command and the read bytes are the reply of a read command
+  void ChargeNamespaceQuota(const std::string &ns, const std::vector<std::string> &args,
+                            const redis::CommandAttributes &attr, size_t reply_size);
   void SSubscribeChannel(const std::string &channel, redis::Connection *conn, uint16_t slot);
   void SUnsubscribeChannel(const std::string &channel, redis::Connection *conn, uint16_t slot);
   void GetSChannelsByPattern(const std::string &pattern, std::vector<std::string> *channels);
@@ -221,11 +250,17 @@ class Server {
 
   void BlockOnKey(const std::string &key, redis::Connection *conn);
   void UnblockOnKey(const std::string &key, redis::Connection *conn);
+  // The waiters passing the COUNT of their XREAD can be served by one read of their worker when woken
   void BlockOnStreams(const std::vector<std::string> &keys, const std::vector<redis::StreamEntryID> &entry_ids,
-                      redis::Connection *conn);
+                      redis::Connection *conn, std::optional<uint64_t> read_count = std::nullopt);
   void UnblockOnStreams(const std::vector<std::string> &keys, redis::Connection *conn);
   void WakeupBlockingConns(const std::string &key, size_t n_conns);
   void OnEntryAddedToStream(const std::string &ns, const std::string &key, const redis::StreamEntryID &entry_id);
+  // The WAIT waiters are woken on every ack of a replica, and check the acked replicas themselves
+  void BlockOnReplicaAcks(redis::Connection *conn);
+  void UnblockOnReplicaAcks(redis::Connection *conn);
+  void WakeupReplicaAckWaiters();
+  size_t CountReplicasAcked(rocksdb::SequenceNumber seq);
 
   std::string GetLastRandomKeyCursor();
   void SetLastRandomKeyCursor(const std::string &cursor);
@@ -240,15 +275,33 @@ class Server {
   void GetReplicationInfo(std::string *info);
   void GetRoleInfo(std::string *info);
   void GetCommandsStatsInfo(std::string *info);
+  void GetLatencyStatsInfo(std::string *info);
+  void GetPerfStatsInfo(std::string *info);
   void GetClusterInfo(std::string *info);
   void GetInfo(const std::string &ns, const std::string &section, std::string *info);
   std::string GetRocksDBStatsJson() const;
+  // GetOpenMetrics renders the metrics served by metrics-port, it never reads the DB, the properties of RocksDB
+  // are cached by the cron
+  void GetOpenMetrics(std::string *output);
   ReplState GetReplicationState();
 
   bool PrepareRestoreDB();
   void WaitNoMigrateProcessing();
-  Status AsyncCompactDB(const std::string &begin_key = "", const std::string &end_key = "");
+  // AsyncCompactDB compacts the range of the column family, or of all the column families if cf is null
+  Status AsyncCompactDB(const std::string &begin_key = "", const std::string &end_key = "",
+                        rocksdb::ColumnFamilyHandle *cf = nullptr);
   Status AsyncBgSaveDB();
+  // AsyncExportRdb writes the keys of the namespace to a Redis-compatible RDB file in the background
+  Status AsyncExportRdb(const std::string &ns, const std::string &path);
+  // AsyncPurgeNamespace reclaims the space of the flushed namespace in the background, see NamespacePurger
+  Status AsyncPurgeNamespace(const std::string &ns);
+  // AsyncAnalyzeBigKeys continues or starts the analysis of the big keys in the background, see BigKeyAnalyzer
+  Status AsyncAnalyzeBigKeys(size_t top_n);
+  void StopBigKeysAnalysis() { big_key_analyzer_.Stop(); }
+  Status ResetBigKeys();
+  BigKeyAnalyzer::TypeTopKeys GetBigKeys(const std::string &ns) const { return big_key_analyzer_.GetTopKeys(ns); }
+  // ScheduleLazyFree publishes a task to remove the subkeys in the lazy free queue, unless one is running
+  void ScheduleLazyFree();
   Status AsyncPurgeOldBackups(uint32_t num_backups_to_keep, uint32_t backup_max_keep_hours);
   Status AsyncScanDBSize(const std::string &ns);
   void GetLatestKeyNumStats(const std::string &ns, KeyNumStats *stats);
@@ -265,11 +318,14 @@ class Server {
   int IncrBlockedClientNum();
   int DecrBlockedClientNum();
   std::string GetClientsStr();
+  // GetTopClientsStr returns the CLIENT LIST lines of the clients which use the most of the resource
+  std::string GetTopClientsStr(redis::Connection::Resource resource, size_t count);
   uint64_t GetClientID();
   void KillClient(int64_t *killed, const std::string &addr, uint64_t id, uint64_t type, bool skipme,
                   redis::Connection *conn);
 
   lua_State *Lua() { return lua_; }
+  lua::BytecodeCache *LuaBytecodes() { return &lua_bytecodes_; }
   Status ScriptExists(const std::string &sha);
   Status ScriptGet(const std::string &sha, std::string *body) const;
   Status ScriptSet(const std::string &sha, const std::string &body) const;
@@ -285,15 +341,25 @@ class Server {
   Status ExecPropagatedCommand(const std::vector<std::string> &tokens);
   Status ExecPropagateScriptCommand(const std::vector<std::string> &tokens);
 
-  void SetCurrentConnection(redis::Connection *conn) { curr_connection_ = conn; }
-  redis::Connection *GetCurrentConnection() { return curr_connection_; }
-
   LogCollector<PerfEntry> *GetPerfLog() { return &perf_log_; }
   LogCollector<SlowEntry> *GetSlowLog() { return &slow_log_; }
-  void SlowlogPushEntryIfNeeded(const std::vector<std::string> *args, uint64_t duration, const redis::Connection *conn);
+  void SlowlogPushEntryIfNeeded(const std::vector<std::string> *args, uint64_t duration, const redis::Connection *conn,
+                                const PerfSample *perf_sample = nullptr, uint64_t alloc_bytes = 0);
 
   std::shared_lock<std::shared_mutex> WorkConcurrencyGuard();
+  // HasWorker must be called under WorkConcurrencyGuard, since the workers are only removed exclusively
+  bool HasWorker(const Worker *worker) const;
   std::unique_lock<std::shared_mutex> WorkExclusivityGuard();
+  // The streaming replies hold a snapshot of the DB out of WorkConcurrencyGuard, so they're aborted
+  // before the DB is restored, see StreamingCommander
+  void AddStreamingReply(bufferevent *bev);
+  void RemoveStreamingReply(bufferevent *bev);
+
+  bool IsHeavyCommandPoolEnabled() const { return heavy_command_runner_ != nullptr; }
+  // PublishCommandTask runs a task awaited by a suspended command, on the heavy command pool if it's enabled
+  Status PublishCommandTask(Task task);
+  // The heavy commands of the namespaces are queued fairly by their weights, see NamespaceFairQueue
+  Status PublishHeavyCommand(const std::string &ns, Task task);
 
   Stats stats;
   engine::Storage *storage;
@@ -303,12 +369,20 @@ class Server {
   std::unique_ptr<SlotImport> slot_import;
 
   void UpdateWatchedKeysFromArgs(const std::vector<std::string> &args, const redis::CommandAttributes &attr);
+  void RecordHotKeys(const std::string &ns, const std::vector<std::string> &args, const redis::CommandAttributes &attr);
+  // NotifyKeyspaceEvents publishes the keyspace notifications of a successful write command by notify-keyspace-events
+  void NotifyKeyspaceEvents(const std::string &ns, const std::vector<std::string> &args,
+                            const redis::CommandAttributes &attr);
   void UpdateWatchedKeysManually(const std::vector<std::string> &keys);
   void WatchKey(redis::Connection *conn, const std::vector<std::string> &keys);
-  static bool IsWatchedKeysModified(redis::Connection *conn);
+  bool IsWatchedKeysModified(redis::Connection *conn) const;
   void ResetWatchedKeys(redis::Connection *conn);
   std::list<std::pair<std::string, uint32_t>> GetSlaveHostAndPort();
   Namespace *GetNamespace() { return &namespace_; }
+  NamespaceQuotas *GetNamespaceQuotas() { return &namespace_quotas_; }
+  TrafficCapture *GetTrafficCapture() { return &traffic_capture_; }
+  CpuProfiler *GetCpuProfiler() { return &cpu_profiler_; }
+  Tracer *GetTracer() { return &tracer_; }
 
   AuthResult AuthenticateUser(const std::string &user_password, std::string *ns);
 
@@ -322,18 +396,47 @@ class Server {
 
  private:
   void cron();
+  void catchUpWithPrimary();
   void recordInstantaneousMetrics();
+  void refreshRocksDBMetrics();
   static void updateCachedTime();
   Status autoResizeBlockAndSST();
   void updateWatchedKeysFromRange(const std::vector<std::string> &args, const redis::CommandKeyRange &range);
   void updateAllWatchedKeys();
+  void sendInvalidations(const TrackingTable::Invalidations &invalidations);
+  // replyToClient replies to the client of the target ID, which is looked up in all the workers if it isn't at
+  // the fd of the target owner anymore, returns false if the client is gone
+  bool replyToClient(const TrackingTable::Target &target, const std::function<std::string(redis::RESP)> &reply);
   void increaseWorkerThreads(size_t delta);
   void decreaseWorkerThreads(size_t delta);
   void cleanupExitedWorkerThreads(bool force);
+  void checkWorkers();
+  void rebalanceWorkers(uint64_t now);
+  void autoscaleWorkers();
+  void resizeWorkerThreads(size_t new_worker_threads);
 
   std::atomic<bool> stop_ = false;
   std::atomic<bool> is_loading_ = false;
+  std::atomic<bool> lazy_free_scheduled_ = false;
+  // the start time of the last successful catch up of a secondary instance, and its duration
+  std::atomic<uint64_t> secondary_catch_up_time_us_ = 0;
+  std::atomic<uint64_t> secondary_catch_up_duration_us_ = 0;
+  std::atomic<uint64_t> secondary_catch_up_failures_ = 0;
+  uint64_t secondary_last_try_us_ = 0;
   int64_t start_time_secs_;
+  // the milliseconds taken by each phase of the startup before the connections are accepted, e.g. storage_open
+  std::vector<std::pair<std::string, int64_t>> startup_phases_;
+  // the busy time of each worker at the last check of the utilization and at the last rebalance, only used by cron
+  uint64_t worker_checked_us_ = 0;
+  uint64_t worker_rebalanced_us_ = 0;
+  std::map<const Worker *, uint64_t> worker_checked_busy_us_;
+  std::map<const Worker *, uint64_t> worker_rebalanced_busy_us_;
+  // the longest loop delay of the workers in the last second, and the seconds in a row they're over or under loaded
+  std::atomic<uint64_t> worker_loop_delay_us_ = 0;
+  int worker_overloaded_secs_ = 0;
+  int worker_underloaded_secs_ = 0;
+  static constexpr int kWorkerScaleUpSecs = 5;
+  static constexpr int kWorkerScaleDownSecs = 60;
   std::mutex slaveof_mu_;
   std::string master_host_;
   uint32_t master_port_ = 0;
@@ -342,8 +445,7 @@ class Server {
   std::mutex last_random_key_cursor_mu_;
 
   std::atomic<lua_State *> lua_;
-
-  redis::Connection *curr_connection_ = nullptr;
+  lua::BytecodeCache lua_bytecodes_;
 
   // client counters
   std::atomic<uint64_t> client_id_{1};
@@ -354,10 +456,22 @@ class Server {
   // slave
   std::mutex slave_threads_mu_;
   std::list<std::unique_ptr<FeedSlaveThread>> slave_threads_;
+  WALRing wal_ring_;
   std::atomic<int> fetch_file_threads_num_ = 0;
 
   // namespace
   Namespace namespace_;
+  NamespaceQuotas namespace_quotas_;
+  BigKeyAnalyzer big_key_analyzer_;
+  TrafficCapture traffic_capture_;
+  CpuProfiler cpu_profiler_;
+  Tracer tracer_;
+  MonitorFeed monitor_feed_;
+  MetricsListener metrics_listener_;
+  // the metrics of the RocksDB properties rendered by the last refresh of the cron
+  std::mutex rocksdb_metrics_mu_;
+  std::string rocksdb_metrics_;
+  int64_t rocksdb_metrics_refresh_secs_ = 0;
 
   // Some jobs to operate DB should be unique
   std::mutex db_job_mu_;
@@ -366,30 +480,44 @@ class Server {
   int64_t last_bgsave_timestamp_secs_ = -1;
   std::string last_bgsave_status_ = "ok";
   int64_t last_bgsave_duration_secs_ = -1;
+  // the running or the last RDB export, whose progress is reported by INFO
+  std::shared_ptr<RdbExporter> rdb_exporter_;
+  bool is_rdb_exporting_ = false;
+  std::string last_rdb_export_status_ = "ok";
+  // the running or the last namespace purge, and the namespaces waiting to be purged
+  std::shared_ptr<NamespacePurger> namespace_purger_;
+  bool is_namespace_purging_ = false;
+  std::set<std::string> pending_namespace_purges_;
+  std::string last_namespace_purge_status_ = "ok";
+  bool is_big_keys_analyzing_ = false;
+  std::string last_big_keys_analysis_status_ = "ok";
 
   std::map<std::string, DBScanInfo> db_scan_infos_;
 
   LogCollector<SlowEntry> slow_log_;
   LogCollector<PerfEntry> perf_log_;
 
-  std::map<std::string, std::list<ConnContext>> pubsub_channels_;
-  std::map<std::string, std::list<ConnContext>> pubsub_patterns_;
-  std::mutex pubsub_channels_mu_;
+  PubSubRegistry pubsub_registry_;
+  TrackingTable tracking_table_;
   std::vector<std::map<std::string, std::list<ConnContext>>> pubsub_shard_channels_;
   std::mutex pubsub_shard_channels_mu_;
-  std::map<std::string, std::list<ConnContext>> blocking_keys_;
-  std::mutex blocking_keys_mu_;
+  BlockingKeyRegistry blocking_keys_;
+  std::list<ConnContext> replica_ack_waiters_;
+  std::mutex replica_ack_waiters_mu_;
 
   std::atomic<int> blocked_clients_{0};
 
-  std::mutex blocked_stream_consumers_mu_;
-  std::map<std::string, std::set<std::shared_ptr<StreamConsumer>>> blocked_stream_consumers_;
+  StreamWaiterRegistry stream_waiters_;
 
   // threads
   std::shared_mutex works_concurrency_rw_lock_;
+  std::mutex streaming_replies_mu_;
+  std::set<bufferevent *> streaming_replies_;
   std::thread cron_thread_;
   std::thread compaction_checker_thread_;
   TaskRunner task_runner_;
+  std::unique_ptr<TaskRunner> heavy_command_runner_;
+  std::unique_ptr<NamespaceFairQueue> heavy_command_queue_;
   std::vector<std::unique_ptr<WorkerThread>> worker_threads_;
   std::unique_ptr<ReplicationThread> replication_thread_;
   tbb::concurrent_queue<std::unique_ptr<WorkerThread>> recycle_worker_threads_;
@@ -398,9 +526,7 @@ class Server {
   std::atomic<int64_t> memory_startup_use_ = 0;
 
   // transaction
-  std::atomic<size_t> watched_key_size_ = 0;
-  std::map<std::string, std::set<redis::Connection *>> watched_key_map_;
-  std::shared_mutex watched_key_mutex_;
+  WatchedKeyTable watched_keys_;
 
   // SCAN ring buffer
   std::atomic<uint16_t> cursor_counter_ = {0};
@@ -0,0 +1,69 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "stream_waiter_registry.h"
+
+#include <algorithm>
+
+void StreamWaiterRegistry::Block(const std::string &ns, const std::string &key, Waiter waiter) {
+  auto &shard = shardOf(key);
+  std::lock_guard<std::mutex> guard(shard.mutex);
+
+  shard.streams[{ns, key}].emplace_back(std::move(waiter));
+}
+
+void StreamWaiterRegistry::Unblock(const std::string &ns, const std::string &key, const Worker *owner, int fd) {
+  auto &shard = shardOf(key);
+  std::lock_guard<std::mutex> guard(shard.mutex);
+
+  auto iter = shard.streams.find({ns, key});
+  if (iter == shard.streams.end()) return;
+
+  auto &waiters = iter->second;
+  auto waiter = std::find_if(waiters.begin(), waiters.end(),
+                             [&](const Waiter &w) { return w.owner == owner && w.fd == fd; });
+  if (waiter == waiters.end()) return;
+
+  *waiter = std::move(waiters.back());
+  waiters.pop_back();
+  if (waiters.empty()) shard.streams.erase(iter);
+}
+
+std::map<Worker *, std::vector<StreamWaiterRegistry::Waiter>> StreamWaiterRegistry::TakeReadable(
+    const std::string &ns, const std::string &key, const redis::StreamEntryID &entry_id) {
+  std::map<Worker *, std::vector<Waiter>> readable;
+
+  auto &shard = shardOf(key);
+  std::lock_guard<std::mutex> guard(shard.mutex);
+
+  auto iter = shard.streams.find({ns, key});
+  if (iter == shard.streams.end()) return readable;
+
+  auto &waiters = iter->second;
+  auto end = std::partition(waiters.begin(), waiters.end(),
+                            [&](const Waiter &waiter) { return !(waiter.last_id < entry_id); });
+  for (auto it = end; it != waiters.end(); ++it) {
+    readable[it->owner].emplace_back(std::move(*it));
+  }
+  waiters.erase(end, waiters.end());
+  if (waiters.empty()) shard.streams.erase(iter);
+
+  return readable;
+}
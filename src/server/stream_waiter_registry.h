@@ -0,0 +1,72 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "types/redis_stream_base.h"
+
+class Worker;
+
+// StreamWaiterRegistry tracks the connections blocked by XREAD and XREADGROUP on each stream.
+//
+// The waiters are kept per stream in shards by key, so blocking and unblocking on different streams
+// don't contend. A new entry takes the waiters which can read it at once, grouped by their workers,
+// so that each worker is woken once per entry instead of once per waiting connection.
+class StreamWaiterRegistry {
+ public:
+  static constexpr size_t kShards = 64;
+
+  struct Waiter {
+    Worker *owner;
+    int fd;
+    redis::StreamEntryID last_id;
+    // the COUNT of a plain XREAD, whose read the worker can share with the other waiters of the stream,
+    // or nullopt for the reads of XREADGROUP, which are done by the waiter itself
+    std::optional<uint64_t> read_count;
+  };
+
+  void Block(const std::string &ns, const std::string &key, Waiter waiter);
+  void Unblock(const std::string &ns, const std::string &key, const Worker *owner, int fd);
+  // Take the waiters of the stream whose last ID is less than the new entry ID, grouped by their workers
+  std::map<Worker *, std::vector<Waiter>> TakeReadable(const std::string &ns, const std::string &key,
+                                                       const redis::StreamEntryID &entry_id);
+
+ private:
+  using StreamName = std::pair<std::string, std::string>;
+
+  struct alignas(64) Shard {
+    std::mutex mutex;
+    std::map<StreamName, std::vector<Waiter>> streams;
+  };
+
+  std::array<Shard, kShards> shards_;
+
+  Shard &shardOf(const std::string &key) { return shards_[std::hash<std::string>{}(key) % kShards]; }
+};
@@ -149,6 +149,15 @@ UniqueSSLContext CreateSSLContext(const Config *config, const SSL_METHOD *method
     ctx_options |= SSL_OP_CIPHER_SERVER_PREFERENCE;
   }
 
+  // OpenSSL falls back to the user space encryption by itself if the kernel or the cipher doesn't support kTLS
+  if (config->tls_ktls) {
+#ifdef SSL_OP_ENABLE_KTLS
+    ctx_options |= SSL_OP_ENABLE_KTLS;
+#else
+    LOG(WARNING) << "Kernel TLS is not supported by the OpenSSL library, tls-ktls is ignored";
+#endif
+  }
+
   SSL_CTX_set_options(ssl_ctx.get(), ctx_options);
 
   SSL_CTX_set_mode(ssl_ctx.get(), SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
@@ -0,0 +1,281 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "tracer.h"
+
+#include <fmt/format.h>
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iterator>
+#include <jsoncons/json.hpp>
+#include <random>
+
+#include "thread_util.h"
+
+namespace {
+
+constexpr size_t kMaxSpansPerLine = 512;
+
+uint64_t NowUnixNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+template <size_t N>
+void RandomID(std::array<uint8_t, N> *id) {
+  thread_local std::mt19937_64 rng{std::random_device{}()};
+  // an all zero ID is invalid
+  do {
+    for (auto &byte : *id) byte = static_cast<uint8_t>(rng());
+  } while (std::all_of(id->begin(), id->end(), [](uint8_t byte) { return byte == 0; }));
+}
+
+template <size_t N>
+std::string HexID(const std::array<uint8_t, N> &id) {
+  std::string hex;
+  for (auto byte : id) fmt::format_to(std::back_inserter(hex), "{:02x}", byte);
+  return hex;
+}
+
+template <size_t N>
+bool ParseHexID(std::string_view hex, std::array<uint8_t, N> *id) {
+  if (hex.size() != N * 2) return false;
+  for (size_t i = 0; i < N; i++) {
+    int byte = 0;
+    for (char c : hex.substr(i * 2, 2)) {
+      // only the lowercase hex digits are valid in the traceparent
+      if (c >= '0' && c <= '9') {
+        byte = byte * 16 + (c - '0');
+      } else if (c >= 'a' && c <= 'f') {
+        byte = byte * 16 + (c - 'a' + 10);
+      } else {
+        return false;
+      }
+    }
+    (*id)[i] = static_cast<uint8_t>(byte);
+  }
+  return std::any_of(id->begin(), id->end(), [](uint8_t byte) { return byte != 0; });
+}
+
+jsoncons::json Attribute(const std::string &key, const std::string &value) {
+  jsoncons::json attribute;
+  attribute["key"] = key;
+  attribute["value"]["stringValue"] = value;
+  return attribute;
+}
+
+}  // namespace
+
+StatusOr<TraceContext> TraceContext::Parse(std::string_view traceparent) {
+  // version-trace_id-parent_id-flags
+  if (traceparent.size() != 55 || traceparent.substr(0, 3) != "00-" || traceparent[35] != '-' ||
+      traceparent[52] != '-') {
+    return {Status::NotOK, "invalid traceparent, it should be 00-<trace id>-<parent id>-<flags>"};
+  }
+
+  TraceContext context;
+  if (!ParseHexID(traceparent.substr(3, 32), &context.trace_id)) {
+    return {Status::NotOK, "invalid trace id of the traceparent"};
+  }
+  if (!ParseHexID(traceparent.substr(36, 16), &context.span_id)) {
+    return {Status::NotOK, "invalid parent id of the traceparent"};
+  }
+  return context;
+}
+
+Status Tracer::Start(const std::string &path) {
+  Stop();
+
+  std::lock_guard<std::mutex> guard(mu_);
+  // the file is appended, since the collector may still be reading it
+  file_.open(path, std::ios::out | std::ios::app);
+  if (!file_.is_open()) {
+    return {Status::NotOK, fmt::format("failed to open the trace file {}: {}", path, strerror(errno))};
+  }
+
+  path_ = path;
+  stop_ = false;
+  pending_.clear();
+
+  running_.store(true, std::memory_order_release);
+  auto t = util::CreateThread("tracer", [this] { run(); });
+  if (!t) {
+    running_.store(false, std::memory_order_release);
+    file_.close();
+    return std::move(t);
+  }
+  writer_ = std::move(*t);
+  LOG(INFO) << "[tracer] Start to export the spans to " << path_;
+  return Status::OK();
+}
+
+void Tracer::Stop() {
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    stop_ = true;
+  }
+  cond_.notify_all();
+  if (writer_.joinable()) {
+    if (auto s = util::ThreadJoin(writer_); !s) {
+      LOG(WARNING) << "[tracer] Failed to join the writer thread: " << s.Msg();
+    }
+  }
+  running_.store(false, std::memory_order_release);
+}
+
+bool Tracer::IsSampled(int interval) {
+  if (interval <= 0) return false;
+
+  thread_local uint64_t commands = 0;
+  return commands++ % interval == 0;
+}
+
+void Tracer::Submit(std::vector<Span> spans) {
+  std::lock_guard<std::mutex> guard(mu_);
+  if (stop_) return;
+  if (pending_.size() + spans.size() > kMaxPendingSpans) {
+    dropped_spans_.fetch_add(spans.size(), std::memory_order_relaxed);
+    return;
+  }
+  std::move(spans.begin(), spans.end(), std::back_inserter(pending_));
+}
+
+void Tracer::EncodeBatch(const std::vector<Span> &spans, std::string *dst) {
+  jsoncons::json json_spans(jsoncons::json_array_arg);
+  for (const auto &span : spans) {
+    jsoncons::json json_span;
+    json_span["traceId"] = HexID(span.trace_id);
+    json_span["spanId"] = HexID(span.span_id);
+    if (std::any_of(span.parent_span_id.begin(), span.parent_span_id.end(), [](uint8_t byte) { return byte != 0; })) {
+      json_span["parentSpanId"] = HexID(span.parent_span_id);
+    }
+    json_span["name"] = span.name;
+    // SPAN_KIND_SERVER or SPAN_KIND_INTERNAL
+    json_span["kind"] = span.is_server ? 2 : 1;
+    // the 64 bits integers are strings in the OTLP JSON
+    json_span["startTimeUnixNano"] = std::to_string(span.start_ns);
+    json_span["endTimeUnixNano"] = std::to_string(span.end_ns);
+    jsoncons::json attributes(jsoncons::json_array_arg);
+    for (const auto &[key, value] : span.attributes) attributes.push_back(Attribute(key, value));
+    json_span["attributes"] = std::move(attributes);
+    json_spans.push_back(std::move(json_span));
+  }
+
+  jsoncons::json scope_spans;
+  scope_spans["scope"]["name"] = "kvrocks";
+  scope_spans["spans"] = std::move(json_spans);
+
+  jsoncons::json resource_spans;
+  resource_spans["resource"]["attributes"] =
+      jsoncons::json(jsoncons::json_array_arg, {Attribute("service.name", "kvrocks")});
+  resource_spans["scopeSpans"] = jsoncons::json(jsoncons::json_array_arg, {std::move(scope_spans)});
+
+  jsoncons::json request;
+  request["resourceSpans"] = jsoncons::json(jsoncons::json_array_arg, {std::move(resource_spans)});
+  dst->append(request.to_string());
+}
+
+void Tracer::run() {
+  std::vector<Span> spans;
+  std::string buf;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      // the spans are written in batches, so the workers never wake up the thread
+      cond_.wait_for(lock, std::chrono::seconds(1), [this] { return stop_; });
+      spans.swap(pending_);
+    }
+
+    for (size_t begin = 0; begin < spans.size(); begin += kMaxSpansPerLine) {
+      auto end = std::min(spans.size(), begin + kMaxSpansPerLine);
+      EncodeBatch(std::vector<Span>(spans.begin() + static_cast<ptrdiff_t>(begin),
+                                    spans.begin() + static_cast<ptrdiff_t>(end)),
+                  &buf);
+      buf.push_back('\n');
+    }
+    if (!buf.empty()) {
+      file_.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+      file_.flush();
+      if (!file_.good()) {
+        LOG(ERROR) << "[tracer] Failed to write the trace file " << path_ << ", the tracing is stopped";
+        break;
+      }
+      exported_spans_.fetch_add(spans.size(), std::memory_order_relaxed);
+      buf.clear();
+    }
+    spans.clear();
+
+    std::lock_guard<std::mutex> guard(mu_);
+    if (stop_ && pending_.empty()) break;
+  }
+
+  std::lock_guard<std::mutex> guard(mu_);
+  stop_ = true;
+  pending_.clear();
+  file_.close();
+  running_.store(false, std::memory_order_release);
+}
+
+CommandTrace::CommandTrace(Tracer *tracer, const TraceContext *parent, std::string name) : tracer_(tracer) {
+  Span span;
+  if (parent) {
+    span.trace_id = parent->trace_id;
+    span.parent_span_id = parent->span_id;
+  } else {
+    RandomID(&span.trace_id);
+  }
+  RandomID(&span.span_id);
+  span.name = std::move(name);
+  span.is_server = true;
+  span.start_ns = NowUnixNanos();
+  spans_.push_back(std::move(span));
+}
+
+CommandTrace::~CommandTrace() {
+  EndStage();
+  spans_[0].end_ns = NowUnixNanos();
+  tracer_->Submit(std::move(spans_));
+}
+
+void CommandTrace::BeginStage(std::string name) {
+  EndStage();
+
+  Span span;
+  span.trace_id = spans_[0].trace_id;
+  span.parent_span_id = spans_[0].span_id;
+  RandomID(&span.span_id);
+  span.name = std::move(name);
+  span.start_ns = NowUnixNanos();
+  spans_.push_back(std::move(span));
+  in_stage_ = true;
+}
+
+void CommandTrace::EndStage() {
+  if (!in_stage_) return;
+  spans_.back().end_ns = NowUnixNanos();
+  in_stage_ = false;
+}
+
+void CommandTrace::AddAttribute(std::string key, std::string value) {
+  spans_[0].attributes.emplace_back(std::move(key), std::move(value));
+}
@@ -0,0 +1,124 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "status.h"
+
+// TraceContext is the W3C trace context which a client sets by CLIENT SETINFO TRACEPARENT, so the spans of
+// its commands are the children of the span of the application
+struct TraceContext {
+  std::array<uint8_t, 16> trace_id{};
+  std::array<uint8_t, 8> span_id{};
+
+  // Parse accepts the traceparent header of version 00, e.g. 00-<32 hex trace id>-<16 hex span id>-01
+  static StatusOr<TraceContext> Parse(std::string_view traceparent);
+};
+
+struct Span {
+  std::array<uint8_t, 16> trace_id{};
+  std::array<uint8_t, 8> span_id{};
+  // all zero for a span without a parent
+  std::array<uint8_t, 8> parent_span_id{};
+  std::string name;
+  bool is_server = false;
+  uint64_t start_ns = 0;
+  uint64_t end_ns = 0;
+  std::vector<std::pair<std::string, std::string>> attributes;
+};
+
+// Tracer exports the spans of the traced commands to a file in the OTLP JSON format, one batch of spans per
+// line, which is read by the otlpjsonfile receiver of the OpenTelemetry Collector.
+//
+// One of every trace-sample-interval commands of a worker thread is traced, and so are all the commands of
+// the clients which set a trace context. The spans are appended to a pending batch by the workers, and
+// written by a background thread, so only the traced commands pay for the tracing. The spans are dropped
+// when there are more than kMaxPendingSpans of them.
+class Tracer {
+ public:
+  static constexpr size_t kMaxPendingSpans = 64 * 1024;
+
+  Tracer() = default;
+  ~Tracer() { Stop(); }
+
+  Tracer(const Tracer &) = delete;
+  Tracer &operator=(const Tracer &) = delete;
+
+  Status Start(const std::string &path);
+  void Stop();
+
+  bool IsRunning() const { return running_.load(std::memory_order_acquire); }
+  // IsSampled is cheap enough for every command, the interval 0 means no command is sampled
+  static bool IsSampled(int interval);
+  void Submit(std::vector<Span> spans);
+
+  uint64_t GetExportedSpans() const { return exported_spans_.load(std::memory_order_relaxed); }
+  uint64_t GetDroppedSpans() const { return dropped_spans_.load(std::memory_order_relaxed); }
+
+  static void EncodeBatch(const std::vector<Span> &spans, std::string *dst);
+
+ private:
+  std::atomic<bool> running_ = false;
+  std::atomic<uint64_t> exported_spans_ = 0;
+  std::atomic<uint64_t> dropped_spans_ = 0;
+
+  std::mutex mu_;
+  std::condition_variable cond_;
+  bool stop_ = false;
+  std::string path_;
+  std::vector<Span> pending_;
+  std::ofstream file_;
+  std::thread writer_;
+
+  void run();
+};
+
+// CommandTrace collects the span of a traced command and the spans of its stages, e.g. the parsing or the
+// execution, and submits them to the tracer when it's destructed
+class CommandTrace {
+ public:
+  CommandTrace(Tracer *tracer, const TraceContext *parent, std::string name);
+  ~CommandTrace();
+
+  CommandTrace(const CommandTrace &) = delete;
+  CommandTrace &operator=(const CommandTrace &) = delete;
+
+  // BeginStage starts a child span, which is ended by EndStage, the next stage or the end of the command
+  void BeginStage(std::string name);
+  void EndStage();
+  void AddAttribute(std::string key, std::string value);
+
+ private:
+  Tracer *tracer_;
+  std::vector<Span> spans_;
+  bool in_stage_ = false;
+};
@@ -0,0 +1,167 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "tracking_table.h"
+
+#include <algorithm>
+#include <string_view>
+
+void TrackingTable::EnableClient(uint64_t id, const std::string &ns, Target target, const TrackingOptions &options) {
+  DisableClient(id);
+
+  std::unique_lock<std::shared_mutex> guard(clients_mu_);
+  Client client{ns, target, options.bcast, options.noloop, {}};
+  if (options.bcast) {
+    client.prefixes = options.prefixes.empty() ? std::vector<std::string>{""} : options.prefixes;
+    std::sort(client.prefixes.begin(), client.prefixes.end());
+    client.prefixes.erase(std::unique(client.prefixes.begin(), client.prefixes.end()), client.prefixes.end());
+    for (const auto &prefix : client.prefixes) {
+      prefixes_[prefix].emplace_back(id);
+    }
+  }
+  clients_[id] = std::move(client);
+  n_clients_ = clients_.size();
+}
+
+void TrackingTable::DisableClient(uint64_t id) {
+  std::unique_lock<std::shared_mutex> guard(clients_mu_);
+
+  auto iter = clients_.find(id);
+  if (iter == clients_.end()) return;
+
+  for (const auto &prefix : iter->second.prefixes) {
+    auto prefix_iter = prefixes_.find(prefix);
+    if (prefix_iter == prefixes_.end()) continue;
+    auto &ids = prefix_iter->second;
+    ids.erase(std::remove(ids.begin(), ids.end(), id), ids.end());
+    if (ids.empty()) prefixes_.erase(prefix_iter);
+  }
+  // The keys tracked by the client are left in the table, and are dropped when they are invalidated
+  clients_.erase(iter);
+  n_clients_ = clients_.size();
+}
+
+std::optional<TrackingTable::Target> TrackingTable::GetTarget(uint64_t id) const {
+  std::shared_lock<std::shared_mutex> guard(clients_mu_);
+
+  auto iter = clients_.find(id);
+  if (iter == clients_.end() || iter->second.redirect_broken) return std::nullopt;
+  return iter->second.target;
+}
+
+bool TrackingTable::BreakRedirect(uint64_t id) {
+  std::unique_lock<std::shared_mutex> guard(clients_mu_);
+
+  auto iter = clients_.find(id);
+  if (iter == clients_.end() || iter->second.redirect_broken) return false;
+  iter->second.redirect_broken = true;
+  return true;
+}
+
+TrackingTable::Invalidations TrackingTable::Track(const std::string &ns, const std::string &key, uint64_t id,
+                                                  size_t max_keys) {
+  {
+    auto &shard = shardOf(key);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+
+    auto &ids = shard.keys[{ns, key}];
+    if (ids.empty()) n_keys_++;
+    if (std::find(ids.begin(), ids.end(), id) == ids.end()) ids.emplace_back(id);
+  }
+
+  Invalidations invalidations;
+  if (max_keys != 0 && n_keys_ > max_keys) evict(max_keys, &invalidations);
+  return invalidations;
+}
+
+void TrackingTable::evict(size_t max_keys, Invalidations *invalidations) {
+  // The shards are evicted in turn, and it stops after a round of empty shards
+  for (size_t empty_shards = 0; n_keys_ > max_keys && empty_shards < kShards;) {
+    auto &shard = shards_[evict_cursor_++ % kShards];
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    if (shard.keys.empty()) {
+      empty_shards++;
+      continue;
+    }
+    empty_shards = 0;
+
+    auto iter = shard.keys.begin();
+    for (auto id : iter->second) {
+      (*invalidations)[id].emplace_back(iter->first.second);
+    }
+    shard.keys.erase(iter);
+    n_keys_--;
+  }
+}
+
+TrackingTable::Invalidations TrackingTable::Invalidate(const std::string &ns, const std::vector<std::string> &keys,
+                                                       uint64_t writer_id) {
+  Invalidations invalidations;
+
+  std::shared_lock<std::shared_mutex> guard(clients_mu_);
+  auto writer = clients_.find(writer_id);
+  bool skip_writer = writer != clients_.end() && writer->second.noloop;
+
+  for (const auto &key : keys) {
+    auto &shard = shardOf(key);
+    std::lock_guard<std::mutex> shard_guard(shard.mutex);
+
+    auto iter = shard.keys.find({ns, key});
+    if (iter == shard.keys.end()) continue;
+    for (auto id : iter->second) {
+      if (skip_writer && id == writer_id) continue;
+      invalidations[id].emplace_back(key);
+    }
+    shard.keys.erase(iter);
+    n_keys_--;
+  }
+
+  if (prefixes_.empty()) return invalidations;
+  for (const auto &key : keys) {
+    for (size_t len = 0; len <= key.size(); len++) {
+      auto iter = prefixes_.find(std::string_view(key).substr(0, len));
+      if (iter == prefixes_.end()) continue;
+
+      for (auto id : iter->second) {
+        if (skip_writer && id == writer_id) continue;
+        if (clients_.at(id).ns != ns) continue;
+        // a key matching several prefixes of the client is invalidated once
+        auto &client_keys = invalidations[id];
+        if (client_keys.empty() || client_keys.back() != key) client_keys.emplace_back(key);
+      }
+    }
+  }
+  return invalidations;
+}
+
+std::vector<uint64_t> TrackingTable::InvalidateAll() {
+  for (auto &shard : shards_) {
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    n_keys_ -= shard.keys.size();
+    shard.keys.clear();
+  }
+
+  std::shared_lock<std::shared_mutex> guard(clients_mu_);
+  std::vector<uint64_t> ids;
+  for (const auto &[id, _] : clients_) {
+    ids.emplace_back(id);
+  }
+  return ids;
+}
@@ -0,0 +1,126 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "server/redis_reply.h"
+
+class Worker;
+
+// The options of CLIENT TRACKING ON
+struct TrackingOptions {
+  bool bcast = false;
+  bool optin = false;
+  bool optout = false;
+  bool noloop = false;
+  // the ID of the client which receives the invalidation messages, 0 for the client itself
+  uint64_t redirect = 0;
+  // the key prefixes of the BCAST mode, no prefix means all the keys
+  std::vector<std::string> prefixes;
+};
+
+// TrackingTable tracks the keys cached by the clients of CLIENT TRACKING, and finds the clients
+// to invalidate when the keys are written.
+//
+// In the default mode, the keys read by a client are kept with the client IDs in shards by key,
+// and are removed once they are invalidated, so a client is notified only once until it reads the
+// key again. The number of the tracked keys is bounded by a cap, and the keys beyond it are evicted
+// and invalidated as if they were written. In the BCAST mode, the clients are notified of all the
+// written keys matching their prefixes, and nothing is recorded on reads.
+class TrackingTable {
+ public:
+  static constexpr size_t kShards = 64;
+
+  // Where the invalidation messages of a client go, the client itself or the client of REDIRECT.
+  // The fd may be reused after the client is gone, so the connection is checked by the client ID.
+  struct Target {
+    Worker *owner;
+    int fd;
+    uint64_t id;
+    redis::RESP resp;
+    bool redirected;
+  };
+
+  // The invalidated keys of each client ID, an empty key list means all the keys are invalidated
+  using Invalidations = std::map<uint64_t, std::vector<std::string>>;
+
+  void EnableClient(uint64_t id, const std::string &ns, Target target, const TrackingOptions &options);
+  void DisableClient(uint64_t id);
+  // GetTarget returns nothing if the client isn't tracking, or its client of REDIRECT is gone
+  std::optional<Target> GetTarget(uint64_t id) const;
+  // BreakRedirect drops the invalidations of the client from now on, since its client of REDIRECT is gone,
+  // and returns true if it wasn't broken before
+  bool BreakRedirect(uint64_t id);
+  // HasClients is false if no client is tracking, so that the writes skip the table at once
+  bool HasClients() const { return n_clients_.load(std::memory_order_relaxed) > 0; }
+
+  // Track records the key read by the client, and returns the invalidations of the evicted keys
+  // if the number of the keys exceeds max_keys, 0 means no limit
+  Invalidations Track(const std::string &ns, const std::string &key, uint64_t id, size_t max_keys);
+  // Invalidate takes the clients of the written keys, the writer isn't notified in the NOLOOP mode
+  Invalidations Invalidate(const std::string &ns, const std::vector<std::string> &keys, uint64_t writer_id);
+  // InvalidateAll removes all the tracked keys and returns the IDs of all the clients
+  std::vector<uint64_t> InvalidateAll();
+
+  size_t GetKeySize() const { return n_keys_.load(std::memory_order_relaxed); }
+
+ private:
+  using KeyName = std::pair<std::string, std::string>;
+
+  struct Client {
+    std::string ns;
+    Target target;
+    bool bcast;
+    bool noloop;
+    std::vector<std::string> prefixes;
+    bool redirect_broken = false;
+  };
+
+  struct alignas(64) Shard {
+    std::mutex mutex;
+    std::map<KeyName, std::vector<uint64_t>> keys;
+  };
+
+  std::array<Shard, kShards> shards_;
+  std::atomic<size_t> n_keys_ = 0;
+  std::atomic<size_t> evict_cursor_ = 0;
+
+  mutable std::shared_mutex clients_mu_;
+  std::map<uint64_t, Client> clients_;
+  // The BCAST clients by their prefixes
+  std::map<std::string, std::vector<uint64_t>, std::less<>> prefixes_;
+  std::atomic<size_t> n_clients_ = 0;
+
+  Shard &shardOf(const std::string &key) { return shards_[std::hash<std::string>{}(key) % kShards]; }
+  void evict(size_t max_keys, Invalidations *invalidations);
+};
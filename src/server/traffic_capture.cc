@@ -0,0 +1,285 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "traffic_capture.h"
+
+#include <fmt/format.h>
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <random>
+
+#include "encoding.h"
+#include "parse_util.h"
+#include "thread_util.h"
+#include "time_util.h"
+#include "vendor/murmurhash2.h"
+
+namespace {
+
+// The commands which carry passwords or tokens, or whose replies can't be waited for one by one
+const char *kUncapturedCommands[] = {"auth", "hello", "config", "namespace", "capture", "monitor", "acl"};
+
+// The values which are likely the options of the commands, e.g. EX or WITHSCORES, are kept
+constexpr size_t kMaxKeywordSize = 16;
+
+uint64_t MixConnectionID(uint64_t id) {
+  // splitmix64, so the consecutive IDs are sampled evenly
+  id += 0x9e3779b97f4a7c15;
+  id = (id ^ (id >> 30)) * 0xbf58476d1ce4e5b9;
+  id = (id ^ (id >> 27)) * 0x94d049bb133111eb;
+  return id ^ (id >> 31);
+}
+
+bool IsKeptValue(const std::string &value) {
+  if (ParseFloat<double>(value)) return true;
+  if (value.empty() || value.size() > kMaxKeywordSize) return false;
+  return std::all_of(value.begin(), value.end(),
+                     [](unsigned char c) { return std::isalpha(c) || c == '-' || c == '_'; });
+}
+
+std::string AnonymizeKey(const std::string &key, uint64_t seed) {
+  auto hash = [seed](const char *data, size_t size) {
+    return HllMurMurHash64A(data, static_cast<int>(size), static_cast<uint32_t>(seed));
+  };
+
+  // keep the hash tag apart, so the keys of a slot still share a slot
+  auto open = key.find('{');
+  if (open != std::string::npos) {
+    auto close = key.find('}', open + 1);
+    if (close != std::string::npos && close > open + 1) {
+      return fmt::format("{{{:016x}}}{:016x}", hash(key.data() + open + 1, close - open - 1),
+                         hash(key.data(), key.size()));
+    }
+  }
+  return fmt::format("key:{:016x}", hash(key.data(), key.size()));
+}
+
+}  // namespace
+
+Status TrafficCapture::Start(Options options) {
+  Stop();
+
+  if (options.sample_ratio <= 0 || options.sample_ratio > 1) {
+    return {Status::NotOK, "the sample ratio should be in (0, 1]"};
+  }
+
+  std::lock_guard<std::mutex> guard(mu_);
+  file_.open(options.path, std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!file_.is_open()) {
+    return {Status::NotOK, fmt::format("failed to open the capture file {}: {}", options.path, strerror(errno))};
+  }
+  file_.write(kMagic, kMagicSize);
+
+  path_ = options.path;
+  max_bytes_ = options.max_bytes;
+  stop_ = false;
+  pending_.clear();
+  captured_commands_ = 0;
+  dropped_commands_ = 0;
+  written_bytes_ = kMagicSize;
+
+  auto threshold = options.sample_ratio >= 1
+                       ? std::numeric_limits<uint64_t>::max()
+                       : static_cast<uint64_t>(options.sample_ratio * static_cast<double>(UINT64_MAX));
+  sample_threshold_.store(threshold, std::memory_order_relaxed);
+  anonymize_keys_.store(options.anonymize_keys, std::memory_order_relaxed);
+  anonymize_values_.store(options.anonymize_values, std::memory_order_relaxed);
+  // the seed is never written, so the hashes of the keys can't be matched against guessed keys
+  seed_.store(std::random_device{}(), std::memory_order_relaxed);
+  start_us_.store(util::GetTimeStampUS(), std::memory_order_relaxed);
+
+  running_.store(true, std::memory_order_release);
+  auto t = util::CreateThread("traffic-capture", [this] { run(); });
+  if (!t) {
+    running_.store(false, std::memory_order_release);
+    file_.close();
+    return std::move(t);
+  }
+  writer_ = std::move(*t);
+  LOG(INFO) << "[capture] Start to capture the traffic to " << path_ << " with the sample ratio "
+            << options.sample_ratio;
+  return Status::OK();
+}
+
+void TrafficCapture::Stop() {
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    stop_ = true;
+  }
+  cond_.notify_all();
+  if (writer_.joinable()) {
+    if (auto s = util::ThreadJoin(writer_); !s) {
+      LOG(WARNING) << "[capture] Failed to join the writer thread: " << s.Msg();
+    }
+  }
+  running_.store(false, std::memory_order_release);
+}
+
+std::string TrafficCapture::GetPath() const {
+  std::lock_guard<std::mutex> guard(mu_);
+  return path_;
+}
+
+bool TrafficCapture::IsSampled(uint64_t conn_id) const {
+  auto threshold = sample_threshold_.load(std::memory_order_relaxed);
+  return threshold == std::numeric_limits<uint64_t>::max() || MixConnectionID(conn_id) < threshold;
+}
+
+bool TrafficCapture::IsCapturable(const redis::CommandAttributes *attributes) {
+  if (attributes->flags & (redis::kCmdReplication | redis::kCmdPubSub)) return false;
+  return std::none_of(std::begin(kUncapturedCommands), std::end(kUncapturedCommands),
+                      [attributes](const char *name) { return attributes->name == name; });
+}
+
+void TrafficCapture::Capture(uint64_t conn_id, const redis::CommandAttributes *attributes,
+                             const std::vector<std::string> &args) {
+  if (!IsCapturable(attributes)) return;
+
+  Record record;
+  record.time_us = util::GetTimeStampUS() - start_us_.load(std::memory_order_relaxed);
+  record.conn_id = conn_id;
+  record.args = args;
+
+  bool anonymize_keys = anonymize_keys_.load(std::memory_order_relaxed);
+  bool anonymize_values = anonymize_values_.load(std::memory_order_relaxed);
+  if (anonymize_keys || anonymize_values) {
+    std::vector<bool> is_key(args.size(), false);
+    attributes->ForEachKeyRange(
+        [&is_key](const std::vector<std::string> &args, const redis::CommandKeyRange &range) {
+          auto last = range.last_key > 0 ? static_cast<size_t>(range.last_key) : args.size() + range.last_key;
+          for (size_t i = range.first_key; i <= last && i < args.size(); i += range.key_step) is_key[i] = true;
+        },
+        args);
+
+    auto seed = seed_.load(std::memory_order_relaxed);
+    // the command name is always kept
+    for (size_t i = 1; i < args.size(); i++) {
+      if (is_key[i]) {
+        if (anonymize_keys) record.args[i] = AnonymizeKey(args[i], seed);
+      } else if (anonymize_values && !IsKeptValue(args[i])) {
+        record.args[i].assign(args[i].size(), 'x');
+      }
+    }
+  }
+
+  std::string buf;
+  EncodeRecord(record, &buf);
+
+  std::lock_guard<std::mutex> guard(mu_);
+  if (stop_) return;
+  if (pending_.size() + buf.size() > kMaxPendingBytes) {
+    dropped_commands_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  pending_.append(buf);
+  captured_commands_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void TrafficCapture::EncodeRecord(const Record &record, std::string *dst) {
+  PutFixed64(dst, record.time_us);
+  PutFixed64(dst, record.conn_id);
+  PutFixed32(dst, static_cast<uint32_t>(record.args.size()));
+  for (const auto &arg : record.args) {
+    PutFixed32(dst, static_cast<uint32_t>(arg.size()));
+    dst->append(arg);
+  }
+}
+
+void TrafficCapture::run() {
+  std::string buf;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      // the records are written in batches, so the workers never wake up the thread
+      cond_.wait_for(lock, std::chrono::milliseconds(100), [this] { return stop_; });
+      buf.swap(pending_);
+    }
+
+    if (!buf.empty()) {
+      file_.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+      file_.flush();
+      if (!file_.good()) {
+        LOG(ERROR) << "[capture] Failed to write the capture file " << path_ << ", the capture is stopped";
+        break;
+      }
+      auto written = written_bytes_.fetch_add(buf.size(), std::memory_order_relaxed) + buf.size();
+      buf.clear();
+      if (max_bytes_ > 0 && written >= max_bytes_) {
+        LOG(INFO) << "[capture] The capture file " << path_ << " reaches " << written
+                  << " bytes, the capture is stopped";
+        break;
+      }
+    }
+
+    std::lock_guard<std::mutex> guard(mu_);
+    if (stop_ && pending_.empty()) break;
+  }
+
+  std::lock_guard<std::mutex> guard(mu_);
+  stop_ = true;
+  pending_.clear();
+  file_.close();
+  running_.store(false, std::memory_order_release);
+  LOG(INFO) << "[capture] Captured " << GetCapturedCommands() << " commands to " << path_ << ", "
+            << GetDroppedCommands() << " commands are dropped";
+}
+
+Status TrafficCaptureReader::Open() {
+  file_.open(path_, std::ios::in | std::ios::binary);
+  if (!file_.is_open()) {
+    return {Status::NotOK, fmt::format("failed to open the capture file {}: {}", path_, strerror(errno))};
+  }
+
+  std::string magic(TrafficCapture::kMagicSize, '\0');
+  file_.read(magic.data(), static_cast<std::streamsize>(magic.size()));
+  if (!file_ || magic != TrafficCapture::kMagic) {
+    return {Status::NotOK, fmt::format("{} is not a capture file", path_)};
+  }
+  return Status::OK();
+}
+
+StatusOr<bool> TrafficCaptureReader::Next(TrafficCapture::Record *record) {
+  auto read = [this](char *data, size_t size) {
+    file_.read(data, static_cast<std::streamsize>(size));
+    return static_cast<size_t>(file_.gcount()) == size;
+  };
+
+  char header[20];
+  file_.read(header, sizeof(header));
+  if (file_.gcount() == 0 && file_.eof()) return false;
+  if (static_cast<size_t>(file_.gcount()) != sizeof(header)) return {Status::NotOK, "truncated capture record"};
+
+  record->time_us = DecodeFixed64(header);
+  record->conn_id = DecodeFixed64(header + 8);
+  auto argc = DecodeFixed32(header + 16);
+  record->args.resize(argc);
+  for (auto &arg : record->args) {
+    char len[4];
+    if (!read(len, sizeof(len))) return {Status::NotOK, "truncated capture record"};
+    arg.resize(DecodeFixed32(len));
+    if (!read(arg.data(), arg.size())) return {Status::NotOK, "truncated capture record"};
+  }
+  return true;
+}
@@ -0,0 +1,131 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "commands/commander.h"
+#include "status.h"
+
+// TrafficCapture writes the commands of the sampled connections to a binary log, which is replayed
+// by utils/kvrocks-replay to benchmark a release with a production command mix.
+//
+// The connections are sampled by their IDs, so all the commands of a sampled connection are captured
+// and the replay keeps their order. The records are encoded by the workers and appended to a pending
+// buffer, which is written to the file by a background thread. The records are dropped when the
+// buffer grows over kMaxPendingBytes, so a slow disk never stalls the workers.
+//
+// The keys can be replaced by seeded hashes, keeping their hash tags apart, so the keys of a slot
+// still share a slot. The values can be replaced by filler bytes of the same size, where the numbers
+// and the short words, which are likely the options of the commands, are kept.
+//
+// File format: the magic kMagic, followed by the records of
+//   fixed64 microseconds since the capture started | fixed64 connection ID | fixed32 argc | argc *
+//   (fixed32 length | bytes)
+class TrafficCapture {
+ public:
+  static constexpr const char kMagic[] = "KVRCAP01";
+  static constexpr size_t kMagicSize = sizeof(kMagic) - 1;
+  static constexpr size_t kMaxPendingBytes = 64 * 1024 * 1024;
+
+  struct Options {
+    std::string path;
+    double sample_ratio = 1;
+    bool anonymize_keys = false;
+    bool anonymize_values = false;
+    // stop the capture when the file reaches the size, 0 means no limit
+    uint64_t max_bytes = 0;
+  };
+
+  struct Record {
+    uint64_t time_us = 0;
+    uint64_t conn_id = 0;
+    std::vector<std::string> args;
+  };
+
+  TrafficCapture() = default;
+  ~TrafficCapture() { Stop(); }
+
+  TrafficCapture(const TrafficCapture &) = delete;
+  TrafficCapture &operator=(const TrafficCapture &) = delete;
+
+  Status Start(Options options);
+  void Stop();
+
+  bool IsRunning() const { return running_.load(std::memory_order_acquire); }
+  // IsSampled tells whether the commands of the connection are captured, it's cheap enough for every command
+  bool IsSampled(uint64_t conn_id) const;
+  // Capture records the command, the commands that carry secrets or can't be replayed are skipped
+  void Capture(uint64_t conn_id, const redis::CommandAttributes *attributes, const std::vector<std::string> &args);
+
+  std::string GetPath() const;
+  uint64_t GetCapturedCommands() const { return captured_commands_.load(std::memory_order_relaxed); }
+  uint64_t GetDroppedCommands() const { return dropped_commands_.load(std::memory_order_relaxed); }
+  uint64_t GetWrittenBytes() const { return written_bytes_.load(std::memory_order_relaxed); }
+
+  static void EncodeRecord(const Record &record, std::string *dst);
+  static bool IsCapturable(const redis::CommandAttributes *attributes);
+
+ private:
+  // The settings are read by the workers without the lock, so they are atomics
+  std::atomic<bool> running_ = false;
+  std::atomic<uint64_t> sample_threshold_ = 0;
+  std::atomic<bool> anonymize_keys_ = false;
+  std::atomic<bool> anonymize_values_ = false;
+  std::atomic<uint64_t> seed_ = 0;
+  std::atomic<uint64_t> start_us_ = 0;
+
+  std::atomic<uint64_t> captured_commands_ = 0;
+  std::atomic<uint64_t> dropped_commands_ = 0;
+  std::atomic<uint64_t> written_bytes_ = 0;
+
+  mutable std::mutex mu_;
+  std::condition_variable cond_;
+  bool stop_ = false;
+  std::string path_;
+  uint64_t max_bytes_ = 0;
+  std::string pending_;
+  std::ofstream file_;
+  std::thread writer_;
+
+  void run();
+};
+
+// TrafficCaptureReader reads the records of a file written by TrafficCapture
+class TrafficCaptureReader {
+ public:
+  explicit TrafficCaptureReader(std::string path) : path_(std::move(path)) {}
+
+  Status Open();
+  // Next returns false at the end of the file
+  StatusOr<bool> Next(TrafficCapture::Record *record);
+
+ private:
+  std::string path_;
+  std::ifstream file_;
+};
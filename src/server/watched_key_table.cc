@@ -0,0 +1,64 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "watched_key_table.h"
+
+#include <mutex>
+
+uint64_t WatchedKeyTable::Watch(const std::string &key) {
+  auto &shard = shardOf(key);
+  std::unique_lock lock(shard.mutex);
+
+  auto [iter, inserted] = shard.keys.try_emplace(key);
+  if (inserted) size_++;
+  iter->second.watchers++;
+  return iter->second.version.load(std::memory_order_acquire);
+}
+
+void WatchedKeyTable::Unwatch(const std::string &key) {
+  auto &shard = shardOf(key);
+  std::unique_lock lock(shard.mutex);
+
+  auto iter = shard.keys.find(key);
+  if (iter == shard.keys.end()) return;
+  if (--iter->second.watchers == 0) {
+    shard.keys.erase(iter);
+    size_--;
+  }
+}
+
+void WatchedKeyTable::Touch(const std::string &key) {
+  auto &shard = shardOf(key);
+  std::shared_lock lock(shard.mutex);
+
+  if (auto iter = shard.keys.find(key); iter != shard.keys.end()) {
+    iter->second.version.fetch_add(1, std::memory_order_acq_rel);
+  }
+}
+
+uint64_t WatchedKeyTable::GetVersion(const std::string &key) const {
+  const auto &shard = shardOf(key);
+  std::shared_lock lock(shard.mutex);
+
+  if (auto iter = shard.keys.find(key); iter != shard.keys.end()) {
+    return iter->second.version.load(std::memory_order_acquire);
+  }
+  return 0;
+}
@@ -0,0 +1,70 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+// WatchedKeyTable tracks a modification version per WATCHed key.
+//
+// A connection remembers the versions it saw at WATCH time, and EXEC compares them
+// with the current ones. Writers only bump the version of a watched key in one shard,
+// under a shared lock, instead of walking the watching connections under a global lock.
+// Keys which nobody watches are not tracked at all.
+class WatchedKeyTable {
+ public:
+  static constexpr size_t kShards = 64;
+
+  // Start watching the key, returns its current version
+  uint64_t Watch(const std::string &key);
+  // Stop watching the key, each Watch must be paired with one Unwatch
+  void Unwatch(const std::string &key);
+  // Bump the version of the key if it's watched
+  void Touch(const std::string &key);
+  // Bump the version of all keys, e.g. for FLUSHDB
+  void TouchAll() { global_version_.fetch_add(1, std::memory_order_acq_rel); }
+
+  uint64_t GetVersion(const std::string &key) const;
+  uint64_t GetGlobalVersion() const { return global_version_.load(std::memory_order_acquire); }
+  bool Empty() const { return size_ == 0; }
+
+ private:
+  struct Entry {
+    std::atomic<uint64_t> version{0};
+    size_t watchers = 0;
+  };
+
+  struct alignas(64) Shard {
+    mutable std::shared_mutex mutex;
+    std::unordered_map<std::string, Entry> keys;
+  };
+
+  std::array<Shard, kShards> shards_;
+  std::atomic<size_t> size_{0};
+  std::atomic<uint64_t> global_version_{0};
+
+  Shard &shardOf(const std::string &key) { return shards_[std::hash<std::string>{}(key) % kShards]; }
+  const Shard &shardOf(const std::string &key) const { return shards_[std::hash<std::string>{}(key) % kShards]; }
+};
@@ -26,11 +26,13 @@
 #include <stdexcept>
 #include <string>
 
+#include "alloc_util.h"
 #include "event2/bufferevent.h"
 #include "io_util.h"
 #include "scope_exit.h"
 #include "thread_util.h"
 #include "time_util.h"
+#include "types/redis_stream.h"
 
 #ifdef ENABLE_OPENSSL
 #include <event2/bufferevent_ssl.h>
@@ -52,12 +54,29 @@
 #include "server.h"
 #include "storage/scripting.h"
 
-Worker::Worker(Server *srv, Config *config) : srv(srv), base_(event_base_new()) {
+static event_base *NewEventBase(const Config *config) {
+  if (!config->worker_epoll_changelist) return event_base_new();
+
+  event_config *cfg = event_config_new();
+  if (!cfg) return nullptr;
+  event_config_set_flag(cfg, EVENT_BASE_FLAG_EPOLL_USE_CHANGELIST);
+  event_base *base = event_base_new_with_config(cfg);
+  event_config_free(cfg);
+  return base;
+}
+
+Worker::Worker(Server *srv, Config *config) : srv(srv), base_(NewEventBase(config)) {
   if (!base_) throw std::runtime_error{"event base failed to be created"};
 
   timer_.reset(NewEvent(base_, -1, EV_PERSIST));
   timeval tm = {10, 0};
   evtimer_add(timer_.get(), &tm);
+  stream_wakeup_event_.reset(event_new(base_, -1, 0, EventCallbackFunc<&Worker::onStreamWakeup>, this));
+  rebalance_event_.reset(event_new(base_, -1, 0, EventCallbackFunc<&Worker::onRebalance>, this));
+  loop_delay_probe_.reset(event_new(base_, -1, EV_PERSIST, EventCallbackFunc<&Worker::onLoopDelayProbe>, this));
+  timeval probe_tm = {0, kLoopDelayProbeMs * 1000};
+  evtimer_add(loop_delay_probe_.get(), &probe_tm);
+  loop_delay_probed_ = std::chrono::steady_clock::now();
 
   uint32_t ports[3] = {config->port, config->tls_port, 0};
   auto binds = config->binds;
@@ -90,6 +109,9 @@ Worker::~Worker() {
   }
 
   timer_.reset();
+  stream_wakeup_event_.reset();
+  rebalance_event_.reset();
+  loop_delay_probe_.reset();
   if (rate_limit_group_) {
     bufferevent_rate_limit_group_free(rate_limit_group_);
   }
@@ -101,6 +123,9 @@ Worker::~Worker() {
 }
 
 void Worker::TimerCB(int, [[maybe_unused]] int16_t events) {
+  // the woken waiters have been served long ago, the later ones do their own reads
+  shared_stream_reads_.clear();
+
   auto config = srv->GetConfig();
   if (config->timeout == 0) return;
   KickoutIdleClients(config->timeout);
@@ -162,7 +187,8 @@ void Worker::newTCPConnection(evconnlistener *listener, evutil_socket_t fd, [[ma
     bufferevent_openssl_set_allow_dirty_shutdown(bev, 1);
   }
 #endif
-  auto conn = new redis::Connection(bev, this);
+  setBufferEventIOLimits(bev);
+  auto conn = newConnection(bev);
   conn->SetCB(bev);
   bufferevent_enable(bev, EV_READ);
 
@@ -195,8 +221,9 @@ void Worker::newUnixSocketConnection(evconnlistener *listener, evutil_socket_t f
   auto ev_thread_safe_flags =
       BEV_OPT_THREADSAFE | BEV_OPT_DEFER_CALLBACKS | BEV_OPT_UNLOCK_CALLBACKS | BEV_OPT_CLOSE_ON_FREE;
   bufferevent *bev = bufferevent_socket_new(base, fd, ev_thread_safe_flags);
+  setBufferEventIOLimits(bev);
 
-  auto conn = new redis::Connection(bev, this);
+  auto conn = newConnection(bev);
   conn->SetCB(bev);
   bufferevent_enable(bev, EV_READ);
 
@@ -216,6 +243,12 @@ void Worker::newUnixSocketConnection(evconnlistener *listener, evutil_socket_t f
   }
 }
 
+void Worker::setBufferEventIOLimits(bufferevent *bev) {
+  auto config = srv->GetConfig();
+  bufferevent_set_max_single_read(bev, config->worker_max_single_read_bytes);
+  bufferevent_set_max_single_write(bev, config->worker_max_single_write_bytes);
+}
+
 Status Worker::listenTCP(const std::string &host, uint32_t port, int backlog) {
   bool ipv6_used = strchr(host.data(), ':');
 
@@ -291,6 +324,13 @@ Status Worker::ListenUnixSocket(const std::string &path, int perm, int backlog)
 
 void Worker::Run(std::thread::id tid) {
   tid_ = tid;
+  // The connections and replies of a worker live in its own arena, so the workers don't contend
+  // on the arena locks, and the memory of each worker can be told apart in INFO
+  if (auto arena = util::BindThreadArena()) {
+    arena_ = static_cast<int>(*arena);
+  } else if (!arena.Is<Status::NotSupported>()) {
+    LOG(WARNING) << "[worker] Failed to bind the worker thread to its own arena: " << arena.Msg();
+  }
   if (event_base_dispatch(base_) != 0) {
     LOG(ERROR) << "[worker] Failed to run server, err: " << strerror(errno);
   }
@@ -359,8 +399,8 @@ redis::Connection *Worker::removeConnection(int fd) {
 //
 // To make it simple, we would close the connection if it's
 // blocked on a key or stream.
-void Worker::MigrateConnection(Worker *target, redis::Connection *conn) {
-  if (!target || !conn) return;
+bool Worker::MigrateConnection(Worker *target, redis::Connection *conn) {
+  if (!target || !conn) return false;
 
   auto bev = conn->GetBufferEvent();
   // disable read/write event to prevent the connection from being processed during migration
@@ -370,19 +410,78 @@ void Worker::MigrateConnection(Worker *target, redis::Connection *conn) {
   if (!conn->CanMigrate()) {
     // Need to enable read/write event again since we disabled them before
     bufferevent_enable(bev, EV_READ | EV_WRITE);
-    return;
+    return false;
   }
 
   // remove the connection from current worker
   DetachConnection(conn);
   if (!target->AddConnection(conn).IsOK()) {
     conn->Close();
-    return;
+    return false;
   }
   bufferevent_base_set(target->base_, bev);
   conn->SetCB(bev);
   bufferevent_enable(bev, EV_READ | EV_WRITE);
   conn->SetOwner(target);
+  return true;
+}
+
+void Worker::onLoopDelayProbe(evutil_socket_t, [[maybe_unused]] int16_t events) {
+  auto now = std::chrono::steady_clock::now();
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - loop_delay_probed_).count();
+  loop_delay_probed_ = now;
+
+  auto delay = static_cast<uint64_t>(std::max<int64_t>(0, elapsed - kLoopDelayProbeMs * 1000));
+  if (delay > max_loop_delay_us_.load(std::memory_order_relaxed)) {
+    max_loop_delay_us_.store(delay, std::memory_order_relaxed);
+  }
+}
+
+void Worker::RequestRebalance(Worker *target, uint64_t max_busy_us) {
+  {
+    std::lock_guard<std::mutex> guard(rebalance_mu_);
+    rebalance_target_ = target;
+    rebalance_max_busy_us_ = max_busy_us;
+  }
+  event_active(rebalance_event_.get(), EV_READ, 0);
+}
+
+void Worker::onRebalance(evutil_socket_t, [[maybe_unused]] int16_t events) {
+  Worker *target = nullptr;
+  uint64_t max_busy_us = 0;
+  {
+    std::lock_guard<std::mutex> guard(rebalance_mu_);
+    std::swap(target, rebalance_target_);
+    max_busy_us = rebalance_max_busy_us_;
+  }
+
+  // the workers can't be removed by CONFIG SET while the connection is migrated
+  auto concurrency = srv->WorkConcurrencyGuard();
+  if (target && !srv->HasWorker(target)) target = nullptr;
+
+  // a migrated connection stays on its worker for a few intervals, so it doesn't bounce between the workers
+  auto now = util::GetTimeStampUS();
+  auto cooldown = static_cast<uint64_t>(srv->GetConfig()->worker_rebalance_interval) * 3 * 1000 * 1000;
+  redis::Connection *candidate = nullptr;
+  uint64_t candidate_busy_us = 0;
+  {
+    std::lock_guard<std::mutex> guard(conns_mu_);
+    for (const auto &[_, conn] : conns_) {
+      // the busy time of every connection is taken, so it's measured over the same window as the workers
+      auto busy_us = conn->TakeRecentBusyTime();
+      if (!target || busy_us > max_busy_us || busy_us <= candidate_busy_us) continue;
+      if (now - conn->GetLastMigrated() < cooldown || !conn->CanMigrate()) continue;
+      candidate = conn;
+      candidate_busy_us = busy_us;
+    }
+  }
+  if (!candidate) return;
+
+  candidate->SetLastMigrated(now);
+  if (MigrateConnection(target, candidate)) {
+    rebalanced_conns_++;
+    DLOG(INFO) << "[worker] Migrate a connection which took " << candidate_busy_us << " us to another worker";
+  }
 }
 
 void Worker::DetachConnection(redis::Connection *conn) {
@@ -403,11 +502,10 @@ void Worker::FreeConnection(redis::Connection *conn) {
   if (!conn) return;
 
   removeConnection(conn->GetFD());
-  srv->ResetWatchedKeys(conn);
   if (rate_limit_group_) {
     bufferevent_remove_from_rate_limit_group(conn->GetBufferEvent());
   }
-  delete conn;
+  recycleConnection(conn);
 }
 
 void Worker::FreeConnectionByID(int fd, uint64_t id) {
@@ -417,20 +515,45 @@ void Worker::FreeConnectionByID(int fd, uint64_t id) {
     if (rate_limit_group_ != nullptr) {
       bufferevent_remove_from_rate_limit_group(iter->second->GetBufferEvent());
     }
-    delete iter->second;
+    recycleConnection(iter->second);
     conns_.erase(iter);
     srv->DecrClientNum();
   }
 
   iter = monitor_conns_.find(fd);
   if (iter != monitor_conns_.end() && iter->second->GetID() == id) {
-    delete iter->second;
+    recycleConnection(iter->second);
     monitor_conns_.erase(iter);
     srv->DecrClientNum();
     srv->DecrMonitorClientNum();
   }
 }
 
+redis::Connection *Worker::newConnection(bufferevent *bev) {
+  {
+    std::lock_guard<std::mutex> guard(conn_pool_mu_);
+    if (!conn_pool_.empty()) {
+      auto conn = conn_pool_.back().release();
+      conn_pool_.pop_back();
+      reused_conns_++;
+      conn->Reset(bev, this);
+      return conn;
+    }
+  }
+  return new redis::Connection(bev, this);
+}
+
+void Worker::recycleConnection(redis::Connection *conn) {
+  srv->ResetWatchedKeys(conn);
+  conn->Release();
+
+  std::unique_ptr<redis::Connection> pooled(conn);
+  std::lock_guard<std::mutex> guard(conn_pool_mu_);
+  if (conn_pool_.size() < static_cast<size_t>(srv->GetConfig()->worker_connection_pool_size)) {
+    conn_pool_.emplace_back(std::move(pooled));
+  }
+}
+
 Status Worker::EnableWriteEvent(int fd) {
   std::unique_lock<std::mutex> lock(conns_mu_);
   auto iter = conns_.find(fd);
@@ -443,6 +566,92 @@ Status Worker::EnableWriteEvent(int fd) {
   return {Status::NotOK, "connection doesn't exist"};
 }
 
+void Worker::WakeupStreamWaiters(const std::string &ns, const std::string &key,
+                                 std::vector<StreamWaiterRegistry::Waiter> waiters) {
+  bool pending = false;
+  {
+    std::lock_guard<std::mutex> guard(stream_wakeups_mu_);
+    pending = !stream_wakeups_.empty();
+    stream_wakeups_.push_back({ns, key, std::move(waiters)});
+  }
+  // the event is already activated by the pending wakeups, which are handled together
+  if (!pending) event_active(stream_wakeup_event_.get(), EV_READ, 0);
+}
+
+void Worker::onStreamWakeup(evutil_socket_t, [[maybe_unused]] int16_t events) {
+  std::vector<StreamWakeup> wakeups;
+  {
+    std::lock_guard<std::mutex> guard(stream_wakeups_mu_);
+    wakeups.swap(stream_wakeups_);
+  }
+
+  for (auto &wakeup : wakeups) {
+    // read the stream once from the oldest last ID of the waiters, with the largest count of them
+    std::optional<redis::StreamEntryID> start_id;
+    uint64_t count = 0;
+    for (const auto &waiter : wakeup.waiters) {
+      if (!waiter.read_count) continue;
+      if (!start_id || waiter.last_id < *start_id) start_id = waiter.last_id;
+      count = std::max(count, *waiter.read_count);
+    }
+
+    auto stream_name = std::make_pair(wakeup.ns, wakeup.key);
+    if (start_id) {
+      redis::StreamRangeOptions options;
+      options.start = *start_id;
+      options.end = redis::StreamEntryID::Maximum();
+      options.with_count = true;
+      options.count = count;
+      options.exclude_start = true;
+
+      redis::Stream stream_db(srv->storage, wakeup.ns);
+      engine::Context ctx(srv->storage);
+      SharedStreamRead read;
+      auto s = stream_db.Range(ctx, wakeup.key, options, &read.entries);
+      if (s.ok()) {
+        read.start_id = *start_id;
+        read.truncated = read.entries.size() >= count;
+        for (const auto &entry : read.entries) {
+          redis::StreamEntryID id;
+          if (!redis::ParseStreamEntryID(entry.key, &id).IsOK()) break;
+          read.ids.emplace_back(id);
+        }
+      }
+      if (s.ok() && read.ids.size() == read.entries.size()) {
+        shared_stream_reads_[stream_name] = std::move(read);
+      } else {
+        shared_stream_reads_.erase(stream_name);
+      }
+    }
+
+    for (const auto &waiter : wakeup.waiters) {
+      auto s = EnableWriteEvent(waiter.fd);
+      if (!s.IsOK()) {
+        LOG(ERROR) << "[worker] Failed to enable write event on blocked stream consumer " << waiter.fd << ": "
+                   << s.Msg();
+      }
+    }
+  }
+}
+
+bool Worker::GetSharedStreamRead(const std::string &ns, const std::string &key, const redis::StreamEntryID &id,
+                                 uint64_t count, std::vector<redis::StreamEntry> *entries) const {
+  auto iter = shared_stream_reads_.find({ns, key});
+  if (iter == shared_stream_reads_.end()) return false;
+
+  const auto &read = iter->second;
+  if (id < read.start_id) return false;
+
+  auto begin = std::upper_bound(read.ids.begin(), read.ids.end(), id);
+  auto n = static_cast<uint64_t>(read.ids.end() - begin);
+  // the entries after the read may be needed to reach the count
+  if (n == 0 || (read.truncated && n < count)) return false;
+
+  auto offset = begin - read.ids.begin();
+  entries->assign(read.entries.begin() + offset, read.entries.begin() + offset + std::min(n, count));
+  return true;
+}
+
 Status Worker::Reply(int fd, const std::string &reply) {
   std::unique_lock<std::mutex> lock(conns_mu_);
   auto iter = conns_.find(fd);
@@ -455,6 +664,32 @@ Status Worker::Reply(int fd, const std::string &reply) {
   return {Status::NotOK, "connection doesn't exist"};
 }
 
+Status Worker::ReplyToClient(int fd, uint64_t id, const std::string &reply) {
+  std::unique_lock<std::mutex> lock(conns_mu_);
+  auto iter = conns_.find(fd);
+  if (iter != conns_.end() && iter->second->GetID() == id) {
+    iter->second->SetLastInteraction();
+    redis::Reply(iter->second->Output(), reply);
+    return Status::OK();
+  }
+
+  return {Status::NotOK, "connection doesn't exist"};
+}
+
+int Worker::ReplyToSubscribers(const std::vector<std::pair<int, size_t>> &subscribers,
+                               const std::vector<std::string> &replies) {
+  int cnt = 0;
+  std::unique_lock<std::mutex> lock(conns_mu_);
+  for (const auto &[fd, index] : subscribers) {
+    auto iter = conns_.find(fd);
+    if (iter == conns_.end()) continue;
+    iter->second->SetLastInteraction();
+    redis::Reply(iter->second->Output(), replies[index]);
+    cnt++;
+  }
+  return cnt;
+}
+
 void Worker::BecomeMonitorConn(redis::Connection *conn) {
   {
     std::lock_guard<std::mutex> guard(conns_mu_);
@@ -475,16 +710,40 @@ void Worker::QuitMonitorConn(redis::Connection *conn) {
   conn->DisableFlag(redis::Connection::kMonitor);
 }
 
-void Worker::FeedMonitorConns(redis::Connection *conn, const std::string &response) {
+void Worker::FeedMonitorConns(uint64_t conn_id, const std::string &ns, const std::string &response,
+                              uint64_t dropped) {
   std::unique_lock<std::mutex> lock(conns_mu_);
 
-  for (const auto &iter : monitor_conns_) {
-    if (conn == iter.second) continue;  // skip the monitor command
+  for (const auto &[_, monitor] : monitor_conns_) {
+    monitor->IncrMonitorDropped(dropped);
+    if (monitor->GetID() == conn_id) continue;  // skip the monitor command
 
-    if (conn->GetNamespace() == iter.second->GetNamespace() || iter.second->GetNamespace() == kDefaultNamespace) {
-      iter.second->Reply(response);
+    auto monitor_ns = monitor->GetNamespace();
+    if (ns != monitor_ns && monitor_ns != kDefaultNamespace) continue;
+
+    if (evbuffer_get_length(monitor->Output()) > kMaxMonitorPendingBytes) {
+      monitor->IncrMonitorDropped(1);
+      continue;
+    }
+    if (auto n = monitor->TakeMonitorDropped(); n > 0) {
+      monitor->Reply(redis::SimpleString(fmt::format("... {} monitor lines are dropped", n)));
     }
+    monitor->Reply(response);
+  }
+}
+
+bool Worker::CanMigrateAllConnections() {
+  std::lock_guard<std::mutex> guard(conns_mu_);
+  if (!monitor_conns_.empty()) return false;
+  return std::all_of(conns_.begin(), conns_.end(), [](const auto &iter) { return iter.second->CanMigrate(); });
+}
+
+std::optional<std::pair<int, redis::RESP>> Worker::FindConnection(uint64_t id) {
+  std::lock_guard<std::mutex> guard(conns_mu_);
+  for (const auto &[fd, conn] : conns_) {
+    if (conn->GetID() == id) return std::make_pair(fd, conn->GetProtocolVersion());
   }
+  return std::nullopt;
 }
 
 std::string Worker::GetClientsStr() {
@@ -499,6 +758,16 @@ std::string Worker::GetClientsStr() {
   return output;
 }
 
+void Worker::GetClientsByResource(redis::Connection::Resource resource,
+                                  std::vector<std::pair<uint64_t, std::string>> *clients) {
+  std::unique_lock<std::mutex> lock(conns_mu_);
+
+  for (const auto &iter : conns_) {
+    redis::Connection *conn = iter.second;
+    clients->emplace_back(conn->GetResourceUsage(resource), conn->ToString());
+  }
+}
+
 void Worker::KillClient(redis::Connection *self, uint64_t id, const std::string &addr, uint64_t type, bool skipme,
                         int64_t *killed) {
   std::lock_guard<std::mutex> guard(conns_mu_);
@@ -539,7 +808,8 @@ void Worker::KickoutIdleClients(int timeout) {
     auto iter = conns_.upper_bound(last_iter_conn_fd_);
     while (iterations--) {
       if (iter == conns_.end()) iter = conns_.begin();
-      if (static_cast<int>(iter->second->GetIdleTime()) >= timeout) {
+      // connections running a heavy command are still in use by the heavy command pool
+      if (!iter->second->IsRunningHeavyCommand() && static_cast<int>(iter->second->GetIdleTime()) >= timeout) {
         to_be_killed_conns.emplace_back(iter->first, iter->second->GetID());
       }
       iter++;
@@ -562,6 +832,9 @@ void WorkerThread::Start() {
     LOG(ERROR) << "[worker] Failed to start worker thread, err: " << s.Msg();
     return;
   }
+  if (auto s = util::ThreadSetAffinity(t_, cpus_); !s) {
+    LOG(WARNING) << "[worker] Failed to pin the worker thread: " << s.Msg();
+  }
 
   LOG(INFO) << "[worker] Thread #" << t_.get_id() << " started";
 }
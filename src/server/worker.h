@@ -25,12 +25,14 @@
 #include <event2/listener.h>
 #include <event2/util.h>
 
+#include <chrono>
 #include <cstdint>
 #include <cstring>
 #include <iostream>
 #include <lua.hpp>
 #include <map>
 #include <memory>
+#include <optional>
 #include <string>
 #include <thread>
 #include <utility>
@@ -39,11 +41,14 @@
 #include "event_util.h"
 #include "redis_connection.h"
 #include "storage/storage.h"
+#include "stream_waiter_registry.h"
 
 class Server;
 
 class Worker : EventCallbackBase<Worker>, EvconnlistenerBase<Worker> {
  public:
+  static constexpr size_t kMaxMonitorPendingBytes = 16 * 1024 * 1024;
+
   Worker(Server *srv, Config *config);
   ~Worker();
   Worker(const Worker &) = delete;
@@ -53,19 +58,66 @@ class Worker : EventCallbackBase<Worker>, EvconnlistenerBase<Worker> {
   void Stop(uint32_t wait_seconds);
   void Run(std::thread::id tid);
   bool IsTerminated() const { return is_terminated_; }
+  // GetArena is the jemalloc arena of the worker thread, -1 if it isn't bound to its own one
+  int GetArena() const { return arena_; }
 
-  void MigrateConnection(Worker *target, redis::Connection *conn);
+  // MigrateConnection returns false if the connection isn't migrated, it may be closed then
+  bool MigrateConnection(Worker *target, redis::Connection *conn);
   void DetachConnection(redis::Connection *conn);
   void FreeConnection(redis::Connection *conn);
   void FreeConnectionByID(int fd, uint64_t id);
   Status AddConnection(redis::Connection *c);
   Status EnableWriteEvent(int fd);
   Status Reply(int fd, const std::string &reply);
+  // ReplyToClient replies only if the connection of the fd is still the client of the ID
+  Status ReplyToClient(int fd, uint64_t id, const std::string &reply);
+  // ReplyToSubscribers sends replies[index] to each subscriber of (fd, index) under one lock,
+  // and returns the number of the subscribers which are still connected
+  int ReplyToSubscribers(const std::vector<std::pair<int, size_t>> &subscribers,
+                         const std::vector<std::string> &replies);
   void BecomeMonitorConn(redis::Connection *conn);
   void QuitMonitorConn(redis::Connection *conn);
-  void FeedMonitorConns(redis::Connection *conn, const std::string &response);
+  // FeedMonitorConns sends the monitor line of the command to the monitors of the namespace. The line is dropped
+  // for a monitor which has more than kMaxMonitorPendingBytes to send, and the number of its dropped lines and
+  // `dropped` ones is told with the next line it gets
+  void FeedMonitorConns(uint64_t conn_id, const std::string &ns, const std::string &response, uint64_t dropped);
+  // WakeupStreamWaiters wakes the waiters of the stream on this worker by one event, it's thread-safe
+  void WakeupStreamWaiters(const std::string &ns, const std::string &key,
+                           std::vector<StreamWaiterRegistry::Waiter> waiters);
+  // GetSharedStreamRead gets up to `count` entries after `id` from the read shared by the woken waiters
+  // of the stream, it returns false if the read can't serve them. It's only called in the worker thread
+  bool GetSharedStreamRead(const std::string &ns, const std::string &key, const redis::StreamEntryID &id,
+                           uint64_t count, std::vector<redis::StreamEntry> *entries) const;
 
   std::string GetClientsStr();
+  // GetClientsByResource appends the CLIENT LIST lines of the clients with their usages of the resource
+  void GetClientsByResource(redis::Connection::Resource resource,
+                            std::vector<std::pair<uint64_t, std::string>> *clients);
+  size_t GetPooledConnections() {
+    std::lock_guard<std::mutex> guard(conn_pool_mu_);
+    return conn_pool_.size();
+  }
+  uint64_t GetReusedConnections() const { return reused_conns_; }
+  uint64_t GetRebalancedConnections() const { return rebalanced_conns_; }
+  // AddBusyTime counts the microseconds spent on the requests of the connections, see Server::rebalanceWorkers
+  void AddBusyTime(uint64_t us) { busy_us_.fetch_add(us, std::memory_order_relaxed); }
+  uint64_t GetBusyTime() const { return busy_us_.load(std::memory_order_relaxed); }
+  // GetUtilization is the share of the last second spent on the requests, it's updated by the server cron
+  double GetUtilization() const { return utilization_.load(std::memory_order_relaxed); }
+  void SetUtilization(double utilization) { utilization_.store(utilization, std::memory_order_relaxed); }
+  // TakeMaxLoopDelay returns the longest delay of the event loop to serve a ready event since it's called last
+  // time, measured by a timer every kLoopDelayProbeMs, it's how long the requests wait in the queue at most
+  uint64_t TakeMaxLoopDelay() { return max_loop_delay_us_.exchange(0, std::memory_order_relaxed); }
+  // RequestRebalance asks the worker to migrate its most expensive connection, which took at most max_busy_us
+  // since the last rebalance, to the target worker. It's requested on every rebalance with a null target for
+  // the other workers, which only start a new busy window of their connections. It's thread-safe, and the
+  // migration is done in the worker thread between the requests of the connection
+  void RequestRebalance(Worker *target, uint64_t max_busy_us);
+  // CanMigrateAllConnections returns false if some connections would be closed by removing the worker,
+  // e.g. the subscribing, tracking, blocked or monitor connections. It's called under WorkExclusivityGuard.
+  bool CanMigrateAllConnections();
+  // FindConnection returns the fd and the protocol version of the connection with the ID
+  std::optional<std::pair<int, redis::RESP>> FindConnection(uint64_t id);
   void KillClient(redis::Connection *self, uint64_t id, const std::string &addr, uint64_t type, bool skipme,
                   int64_t *killed);
   void KickoutIdleClients(int timeout);
@@ -83,20 +135,64 @@ class Worker : EventCallbackBase<Worker>, EvconnlistenerBase<Worker> {
   void newTCPConnection(evconnlistener *listener, evutil_socket_t fd, sockaddr *address, int socklen);
   void newUnixSocketConnection(evconnlistener *listener, evutil_socket_t fd, sockaddr *address, int socklen);
   redis::Connection *removeConnection(int fd);
+  // newConnection reuses a pooled connection if any, and recycleConnection releases the closed one
+  // into the pool, the objects beyond worker-connection-pool-size are freed
+  redis::Connection *newConnection(bufferevent *bev);
+  void recycleConnection(redis::Connection *conn);
+  void setBufferEventIOLimits(bufferevent *bev);
+  void onStreamWakeup(evutil_socket_t, int16_t events);
+  void onRebalance(evutil_socket_t, int16_t events);
+  void onLoopDelayProbe(evutil_socket_t, int16_t events);
+
+  static constexpr int kLoopDelayProbeMs = 100;
+
+  struct StreamWakeup {
+    std::string ns;
+    std::string key;
+    std::vector<StreamWaiterRegistry::Waiter> waiters;
+  };
+
+  struct SharedStreamRead {
+    redis::StreamEntryID start_id;
+    std::vector<redis::StreamEntryID> ids;
+    std::vector<redis::StreamEntry> entries;
+    // whether the read stopped at its count, so the entries after it are unknown
+    bool truncated = false;
+  };
 
   event_base *base_;
   UniqueEvent timer_;
+  UniqueEvent stream_wakeup_event_;
+  std::mutex stream_wakeups_mu_;
+  std::vector<StreamWakeup> stream_wakeups_;
+  // the latest read of each stream with woken waiters, it's dropped by the timer
+  std::map<std::pair<std::string, std::string>, SharedStreamRead> shared_stream_reads_;
   std::thread::id tid_;
   std::vector<evconnlistener *> listen_events_;
   std::mutex conns_mu_;
   std::map<int, redis::Connection *> conns_;
   std::map<int, redis::Connection *> monitor_conns_;
   int last_iter_conn_fd_ = 0;  // fd of last processed connection in previous cron
+  std::mutex conn_pool_mu_;
+  std::vector<std::unique_ptr<redis::Connection>> conn_pool_;
+  std::atomic<uint64_t> reused_conns_ = 0;
+
+  UniqueEvent rebalance_event_;
+  std::mutex rebalance_mu_;
+  Worker *rebalance_target_ = nullptr;
+  uint64_t rebalance_max_busy_us_ = 0;
+  std::atomic<uint64_t> rebalanced_conns_ = 0;
+  std::atomic<uint64_t> busy_us_ = 0;
+  std::atomic<double> utilization_ = 0;
+  UniqueEvent loop_delay_probe_;
+  std::chrono::steady_clock::time_point loop_delay_probed_;
+  std::atomic<uint64_t> max_loop_delay_us_ = 0;
 
   struct bufferevent_rate_limit_group *rate_limit_group_ = nullptr;
   struct ev_token_bucket_cfg *rate_limit_group_cfg_ = nullptr;
   lua_State *lua_;
   std::atomic<bool> is_terminated_ = false;
+  std::atomic<int> arena_ = -1;
 };
 
 class WorkerThread {
@@ -108,6 +204,8 @@ class WorkerThread {
   WorkerThread &operator=(const WorkerThread &) = delete;
 
   Worker *GetWorker() { return worker_.get(); }
+  // SetCPUAffinity pins the thread to the CPUs, it takes effect on the next start
+  void SetCPUAffinity(std::vector<int> cpus) { cpus_ = std::move(cpus); }
   void Start();
   void Stop(uint32_t wait_seconds);
   void Join();
@@ -116,4 +214,5 @@ class WorkerThread {
  private:
   std::thread t_;
   std::unique_ptr<Worker> worker_;
+  std::vector<int> cpus_;
 };
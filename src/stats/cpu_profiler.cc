@@ -0,0 +1,180 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "cpu_profiler.h"
+
+#include <signal.h>
+#include <sys/time.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cpptrace/cpptrace.hpp>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "fmt/format.h"
+#include "time_util.h"
+
+std::atomic<CpuProfiler *> CpuProfiler::active_ = nullptr;
+std::atomic<int> CpuProfiler::handlers_in_flight_ = 0;
+
+Status CpuProfiler::Start(int seconds, int hz) {
+  std::lock_guard<std::mutex> guard(mu_);
+  if (running_) return {Status::NotOK, "the CPU profiling is already running"};
+  if (!cpptrace::can_signal_safe_unwind()) {
+    return {Status::NotSupported, "the stacks can't be unwound in a signal handler on this platform"};
+  }
+
+  // several threads may be on CPU at the same time, so there are more samples than seconds * hz
+  max_samples_ = std::min(static_cast<size_t>(seconds) * hz * 4, kMaxSamples);
+  samples_ = std::make_unique<Sample[]>(max_samples_);
+  next_sample_ = 0;
+  dropped_samples_ = 0;
+  deadline_ms_ = util::GetTimeStampMS() + static_cast<uint64_t>(seconds) * 1000;
+
+  CpuProfiler *expected = nullptr;
+  if (!active_.compare_exchange_strong(expected, this)) {
+    return {Status::NotOK, "another CPU profiling is running"};
+  }
+
+  // The handler is never uninstalled, since the default action of SIGPROF terminates the process,
+  // and a signal may be pending after the timer is stopped.
+  struct sigaction act {};
+  sigemptyset(&act.sa_mask);
+  act.sa_flags = SA_RESTART;
+  act.sa_handler = signalHandler;
+  if (sigaction(SIGPROF, &act, nullptr) != 0) {
+    active_ = nullptr;
+    return {Status::NotOK, fmt::format("failed to set the handler of SIGPROF: {}", strerror(errno))};
+  }
+
+  itimerval timer{};
+  auto interval_us = 1000000 / hz;
+  timer.it_interval.tv_sec = interval_us / 1000000;
+  timer.it_interval.tv_usec = interval_us % 1000000;
+  timer.it_value = timer.it_interval;
+  if (setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+    active_ = nullptr;
+    return {Status::NotOK, fmt::format("failed to set the profiling timer: {}", strerror(errno))};
+  }
+
+  running_ = true;
+  return Status::OK();
+}
+
+void CpuProfiler::Stop() {
+  std::lock_guard<std::mutex> guard(mu_);
+  stop();
+}
+
+void CpuProfiler::StopIfDue() {
+  std::lock_guard<std::mutex> guard(mu_);
+  if (running_ && util::GetTimeStampMS() >= deadline_ms_) stop();
+}
+
+void CpuProfiler::stop() {
+  if (!running_) return;
+
+  itimerval timer{};
+  setitimer(ITIMER_PROF, &timer, nullptr);
+  active_ = nullptr;
+  // the handlers which have seen the profiler are waited, the later ones do nothing
+  while (handlers_in_flight_.load() > 0) std::this_thread::yield();
+  running_ = false;
+}
+
+void CpuProfiler::signalHandler([[maybe_unused]] int sig) {
+  int saved_errno = errno;
+  handlers_in_flight_.fetch_add(1);
+  if (auto profiler = active_.load(); profiler) {
+    auto index = profiler->next_sample_.fetch_add(1, std::memory_order_relaxed);
+    if (index < profiler->max_samples_) {
+      auto &sample = profiler->samples_[index];
+      // skip the frames of the handler and the signal trampoline
+      sample.depth = cpptrace::safe_generate_raw_trace(sample.frames, kMaxFrames, 2);
+#ifdef __linux__
+      prctl(PR_GET_NAME, sample.thread);
+#else
+      sample.thread[0] = '\0';
+#endif
+      sample.ready.store(true, std::memory_order_release);
+    } else {
+      profiler->dropped_samples_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  handlers_in_flight_.fetch_sub(1);
+  errno = saved_errno;
+}
+
+uint64_t CpuProfiler::GetSamples() const {
+  std::lock_guard<std::mutex> guard(mu_);
+  return std::min(next_sample_.load(), max_samples_);
+}
+
+std::string CpuProfiler::Dump() const {
+  std::lock_guard<std::mutex> guard(mu_);
+
+  // the same stacks are counted together, and each address is only symbolized once
+  std::map<std::pair<std::string, std::vector<uintptr_t>>, uint64_t> stacks;
+  cpptrace::raw_trace addresses;
+  std::unordered_map<uintptr_t, std::string> symbols;
+  auto num_samples = std::min(next_sample_.load(), max_samples_);
+  for (size_t i = 0; i < num_samples; i++) {
+    const auto &sample = samples_[i];
+    if (!sample.ready.load(std::memory_order_acquire)) continue;
+
+    std::vector<uintptr_t> frames(sample.frames, sample.frames + sample.depth);
+    for (auto address : frames) {
+      if (symbols.emplace(address, "").second) addresses.frames.push_back(address);
+    }
+    stacks[{std::string(sample.thread, strnlen(sample.thread, kThreadNameSize)), std::move(frames)}]++;
+  }
+
+  // the inlined frames are skipped, since they can't be told apart by the addresses
+  for (const auto &frame : addresses.resolve().frames) {
+    if (frame.is_inline || frame.symbol.empty()) continue;
+    auto iter = symbols.find(frame.raw_address);
+    if (iter == symbols.end()) continue;
+    iter->second = frame.symbol;
+    // the frames are separated by ';' in the collapsed format
+    std::replace(iter->second.begin(), iter->second.end(), ';', ',');
+  }
+
+  std::string output;
+  for (const auto &[stack, count] : stacks) {
+    const auto &[thread, frames] = stack;
+    output += thread.empty() ? "unknown" : thread;
+    for (auto iter = frames.rbegin(); iter != frames.rend(); ++iter) {
+      output += ';';
+      const auto &symbol = symbols[*iter];
+      output += symbol.empty() ? fmt::format("{:#x}", *iter) : symbol;
+    }
+    fmt::format_to(std::back_inserter(output), " {}\n", count);
+  }
+  return output;
+}
@@ -0,0 +1,87 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "status.h"
+
+// CpuProfiler samples the stacks of the threads on CPU, so the hot paths of a node can be found in
+// production without attaching perf.
+//
+// An ITIMER_PROF timer raises SIGPROF every 1/hz seconds of the CPU time of the process, and the signal
+// is delivered to the thread which is running. The handler unwinds the stack of the thread into a slot
+// of a preallocated buffer without any lock or allocation, and the samples over the buffer are dropped.
+// The addresses are only symbolized by Dump, which writes the stacks in the collapsed format of the
+// flame graphs, i.e. `thread;root;...;leaf count` per line.
+//
+// SIGPROF is a process-wide signal, so only one profiler can run at a time.
+class CpuProfiler {
+ public:
+  static constexpr size_t kMaxFrames = 64;
+  static constexpr size_t kMaxSamples = 1 << 15;
+  static constexpr size_t kThreadNameSize = 16;
+
+  CpuProfiler() = default;
+  ~CpuProfiler() { Stop(); }
+
+  CpuProfiler(const CpuProfiler &) = delete;
+  CpuProfiler &operator=(const CpuProfiler &) = delete;
+
+  // Start drops the samples of the last run, and profiles for the seconds at the frequency
+  Status Start(int seconds, int hz);
+  void Stop();
+  // StopIfDue stops the profiling after its seconds, it's called by the cron
+  void StopIfDue();
+  bool IsRunning() const { return running_.load(std::memory_order_acquire); }
+
+  // Dump symbolizes the samples taken so far, which may take a while for the first time
+  std::string Dump() const;
+  uint64_t GetSamples() const;
+  uint64_t GetDroppedSamples() const { return dropped_samples_.load(std::memory_order_relaxed); }
+
+ private:
+  struct Sample {
+    std::atomic<bool> ready = false;
+    uint32_t depth = 0;
+    char thread[kThreadNameSize];
+    uintptr_t frames[kMaxFrames];
+  };
+
+  mutable std::mutex mu_;
+  std::atomic<bool> running_ = false;
+  uint64_t deadline_ms_ = 0;
+  std::unique_ptr<Sample[]> samples_;
+  size_t max_samples_ = 0;
+  std::atomic<size_t> next_sample_ = 0;
+  std::atomic<uint64_t> dropped_samples_ = 0;
+
+  static std::atomic<CpuProfiler *> active_;
+  static std::atomic<int> handlers_in_flight_;
+
+  static void signalHandler(int sig);
+  void record();
+  void stop();
+};
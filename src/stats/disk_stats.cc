@@ -22,6 +22,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "db_util.h"
 #include "rocksdb/status.h"
@@ -49,7 +50,7 @@ rocksdb::Status Disk::GetKeySize(engine::Context &ctx, const Slice &user_key, Re
   std::string ns_key = AppendNamespacePrefix(user_key);
   switch (type) {
     case RedisType::kRedisString:
-      return GetStringSize(ns_key, key_size);
+      return GetStringSize(ctx, ns_key, key_size);
     case RedisType::kRedisHash:
       return GetHashSize(ctx, ns_key, key_size);
     case RedisType::kRedisBitmap:
@@ -69,10 +70,18 @@ rocksdb::Status Disk::GetKeySize(engine::Context &ctx, const Slice &user_key, Re
   }
 }
 
-rocksdb::Status Disk::GetStringSize(const Slice &ns_key, uint64_t *key_size) {
+rocksdb::Status Disk::GetStringSize(engine::Context &ctx, const Slice &ns_key, uint64_t *key_size) {
   auto limit = ns_key.ToString() + static_cast<char>(0);
   auto key_range = rocksdb::Range(Slice(ns_key), Slice(limit));
-  return storage_->GetDB()->GetApproximateSizes(option_, metadata_cf_handle_, &key_range, 1, key_size);
+  auto s = storage_->GetDB()->GetApproximateSizes(option_, metadata_cf_handle_, &key_range, 1, key_size);
+  if (!s.ok()) return s;
+
+  // the chunks of a chunked string
+  Metadata metadata(kRedisString, false);
+  s = Database::GetMetadata(ctx, {kRedisString}, ns_key, &metadata);
+  if (!s.ok()) return s.IsNotFound() ? rocksdb::Status::OK() : s;
+  if (!metadata.IsSplit()) return rocksdb::Status::OK();
+  return GetApproximateSizes(metadata, ns_key, storage_->GetCFHandle(ColumnFamilyID::PrimarySubkey), key_size);
 }
 
 rocksdb::Status Disk::GetHashSize(engine::Context &ctx, const Slice &ns_key, uint64_t *key_size) {
@@ -107,6 +116,10 @@ rocksdb::Status Disk::GetZsetSize(engine::Context &ctx, const Slice &ns_key, uin
   s = GetApproximateSizes(metadata, ns_key, storage_->GetCFHandle(ColumnFamilyID::SecondarySubkey), key_size,
                           score_bytes, score_bytes);
   if (!s.ok()) return s;
+  if (metadata.rank_indexed) {
+    s = GetApproximateSizes(metadata, ns_key, storage_->GetCFHandle(ColumnFamilyID::ZSetRank), key_size);
+    if (!s.ok()) return s;
+  }
   return GetApproximateSizes(metadata, ns_key, storage_->GetCFHandle(ColumnFamilyID::PrimarySubkey), key_size);
 }
 
@@ -135,4 +148,100 @@ rocksdb::Status Disk::GetStreamSize(engine::Context &ctx, const Slice &ns_key, u
   return GetApproximateSizes(metadata, ns_key, storage_->GetCFHandle(ColumnFamilyID::Stream), key_size);
 }
 
+rocksdb::Status Disk::GetKeyMemoryUsage(engine::Context &ctx, const Slice &user_key, uint64_t samples,
+                                        uint64_t *usage) {
+  *usage = 0;
+  std::string ns_key = AppendNamespacePrefix(user_key);
+  std::string raw_metadata;
+  Metadata metadata(kRedisNone, false);
+  Slice rest;
+  auto s = Database::GetMetadata(ctx, RedisTypes::All(), ns_key, &raw_metadata, &metadata, &rest);
+  if (!s.ok()) return s;
+  // the values of strings and JSON are stored in the metadata
+  *usage = ns_key.size() + raw_metadata.size();
+  return GetSubkeysSize(ctx, ns_key, metadata, samples, usage);
+}
+
+rocksdb::Status Disk::GetSubkeysSize(engine::Context &ctx, const Slice &ns_key, const Metadata &metadata,
+                                     uint64_t samples, uint64_t *size) {
+  std::vector<ColumnFamilyID> cfs;
+  // the column family holding one entry per element, which can be sampled
+  auto element_cf = ColumnFamilyID::PrimarySubkey;
+  switch (metadata.Type()) {
+    case kRedisString:
+    case kRedisJson:
+      // the split values are stored in subkeys
+      if (metadata.IsSingleKVType()) return rocksdb::Status::OK();
+      cfs = {ColumnFamilyID::PrimarySubkey};
+      break;
+    case kRedisZSet:
+      cfs = {ColumnFamilyID::PrimarySubkey, ColumnFamilyID::SecondarySubkey, ColumnFamilyID::ZSetRank};
+      break;
+    case kRedisStream:
+      cfs = {ColumnFamilyID::Stream};
+      element_cf = ColumnFamilyID::Stream;
+      break;
+    default:
+      cfs = {ColumnFamilyID::PrimarySubkey};
+      break;
+  }
+  // the size of bitmaps is in bytes and the filters and sketches have no elements
+  bool sampled = samples > 0 && metadata.size > 0 &&
+                 (metadata.Type() == kRedisHash || metadata.Type() == kRedisSet || metadata.Type() == kRedisList ||
+                  metadata.Type() == kRedisZSet || metadata.Type() == kRedisSortedint ||
+                  metadata.Type() == kRedisStream);
+
+  std::string prefix_key = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
+  std::string next_version_prefix_key =
+      InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
+  for (auto cf : cfs) {
+    if (sampled && cf == element_cf) {
+      uint64_t avg_size = 0;
+      auto s = sampleElementSize(ctx, cf, prefix_key, next_version_prefix_key, samples, &avg_size);
+      if (!s.ok()) return s;
+      // e.g. the elements of inlined hashes are in the metadata, so the approximate sizes are used
+      if (avg_size > 0) {
+        *size += avg_size * metadata.size;
+        continue;
+      }
+    }
+    auto s = getRangeSize(cf, prefix_key, next_version_prefix_key, size);
+    if (!s.ok()) return s;
+  }
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status Disk::getRangeSize(ColumnFamilyID cf, const Slice &start, const Slice &limit, uint64_t *size) {
+  auto cf_handle = storage_->GetCFHandle(cf);
+  auto range = rocksdb::Range(start, limit);
+
+  rocksdb::SizeApproximationOptions file_option;
+  file_option.include_memtables = false;
+  file_option.include_files = true;
+  uint64_t file_size = 0;
+  auto s = storage_->GetDB()->GetApproximateSizes(file_option, cf_handle, &range, 1, &file_size);
+  if (!s.ok()) return s;
+
+  uint64_t mem_count = 0, mem_size = 0;
+  storage_->GetDB()->GetApproximateMemTableStats(cf_handle, range, &mem_count, &mem_size);
+  *size += file_size + mem_size;
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status Disk::sampleElementSize(engine::Context &ctx, ColumnFamilyID cf, const Slice &prefix,
+                                        const Slice &limit, uint64_t samples, uint64_t *avg_size) {
+  rocksdb::ReadOptions read_options = ctx.SubKeyScanOptions(samples);
+  read_options.iterate_upper_bound = &limit;
+
+  uint64_t total = 0, n = 0;
+  auto iter = util::UniqueIterator(ctx, read_options, cf);
+  for (iter->Seek(prefix); iter->Valid() && n < samples; iter->Next()) {
+    total += iter->key().size() + iter->value().size();
+    n++;
+  }
+  if (!iter->status().ok()) return iter->status();
+  *avg_size = n == 0 ? 0 : total / n;
+  return rocksdb::Status::OK();
+}
+
 }  // namespace redis
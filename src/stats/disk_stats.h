@@ -36,7 +36,7 @@ class Disk : public Database {
   rocksdb::Status GetApproximateSizes(const Metadata &metadata, const Slice &ns_key,
                                       rocksdb::ColumnFamilyHandle *column_family, uint64_t *key_size,
                                       Slice subkeyleft = Slice(), Slice subkeyright = Slice());
-  rocksdb::Status GetStringSize(const Slice &ns_key, uint64_t *key_size);
+  rocksdb::Status GetStringSize(engine::Context &ctx, const Slice &ns_key, uint64_t *key_size);
   rocksdb::Status GetHashSize(engine::Context &ctx, const Slice &ns_key, uint64_t *key_size);
   rocksdb::Status GetSetSize(engine::Context &ctx, const Slice &ns_key, uint64_t *key_size);
   rocksdb::Status GetListSize(engine::Context &ctx, const Slice &ns_key, uint64_t *key_size);
@@ -45,9 +45,21 @@ class Disk : public Database {
   rocksdb::Status GetSortedintSize(engine::Context &ctx, const Slice &ns_key, uint64_t *key_size);
   rocksdb::Status GetStreamSize(engine::Context &ctx, const Slice &ns_key, uint64_t *key_size);
   rocksdb::Status GetKeySize(engine::Context &ctx, const Slice &user_key, RedisType type, uint64_t *key_size);
+  // GetKeyMemoryUsage estimates the size of a key without scanning its subkeys: the raw metadata is read, and the
+  // subkeys of the current version are sized by the approximate sizes of the SST files and the memtables.
+  // If samples > 0, the average size of the first `samples` elements is multiplied by the number of elements
+  // instead, which is more accurate for the keys too small to span a data block.
+  rocksdb::Status GetKeyMemoryUsage(engine::Context &ctx, const Slice &user_key, uint64_t samples, uint64_t *usage);
+  // GetSubkeysSize adds the estimated size of the subkeys of the metadata to `size` in the same way
+  rocksdb::Status GetSubkeysSize(engine::Context &ctx, const Slice &ns_key, const Metadata &metadata, uint64_t samples,
+                                 uint64_t *size);
 
  private:
   rocksdb::SizeApproximationOptions option_;
+
+  rocksdb::Status getRangeSize(ColumnFamilyID cf, const Slice &start, const Slice &limit, uint64_t *size);
+  rocksdb::Status sampleElementSize(engine::Context &ctx, ColumnFamilyID cf, const Slice &prefix, const Slice &limit,
+                                    uint64_t samples, uint64_t *avg_size);
 };
 
 }  // namespace redis
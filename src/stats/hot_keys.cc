@@ -0,0 +1,144 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "hot_keys.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+
+static uint64_t HashKey(std::string_view ns, std::string_view key) {
+  auto h = std::hash<std::string_view>{}(ns);
+  return h ^ (std::hash<std::string_view>{}(key) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2));
+}
+
+// Each row of the sketch takes its own column from the hash by double hashing
+static size_t SketchColumn(uint64_t hash, size_t row) {
+  auto h1 = static_cast<uint32_t>(hash);
+  auto h2 = static_cast<uint32_t>(hash >> 32) | 1;
+  return (h1 + row * h2) % HotKeys::kSketchWidth;
+}
+
+uint64_t HotKeys::increaseAndEstimate(Sketch *sketch, uint64_t hash) {
+  uint64_t count = UINT64_MAX;
+  for (size_t row = 0; row < kSketchDepth; row++) {
+    auto &counter = (*sketch)[row * kSketchWidth + SketchColumn(hash, row)];
+    count = std::min<uint64_t>(count, counter.fetch_add(1, std::memory_order_relaxed) + 1);
+  }
+  return count;
+}
+
+uint64_t HotKeys::estimate(const Sketch &sketch, uint64_t hash) {
+  uint64_t count = UINT64_MAX;
+  for (size_t row = 0; row < kSketchDepth; row++) {
+    count = std::min<uint64_t>(count, sketch[row * kSketchWidth + SketchColumn(hash, row)].load());
+  }
+  return count;
+}
+
+void HotKeys::Record(std::string_view ns, std::string_view key, bool is_write) {
+  auto hash = HashKey(ns, key);
+  uint64_t reads = is_write ? estimate(reads_, hash) : increaseAndEstimate(&reads_, hash);
+  uint64_t writes = is_write ? increaseAndEstimate(&writes_, hash) : estimate(writes_, hash);
+
+  auto now = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch());
+  for (size_t row = 0; row < kSketchDepth; row++) {
+    last_access_[row * kSketchWidth + SketchColumn(hash, row)].store(static_cast<uint32_t>(now.count()),
+                                                                     std::memory_order_relaxed);
+  }
+
+  // Most of the sampled keys are cold, skip them without taking the lock
+  if (reads + writes <= min_top_count_.load(std::memory_order_relaxed)) return;
+
+  std::string id;
+  id.reserve(ns.size() + key.size() + 1);
+  id.append(ns).push_back('\0');
+  id.append(key);
+
+  auto colder = [](const auto &a, const auto &b) {
+    return a.second.reads + a.second.writes < b.second.reads + b.second.writes;
+  };
+
+  std::lock_guard<std::mutex> guard(mu_);
+  if (auto iter = top_keys_.find(id); iter != top_keys_.end()) {
+    iter->second.reads = reads;
+    iter->second.writes = writes;
+    return;
+  }
+
+  if (top_keys_.size() >= kTopKeysCapacity) {
+    auto coldest = std::min_element(top_keys_.begin(), top_keys_.end(), colder);
+    if (coldest->second.reads + coldest->second.writes >= reads + writes) {
+      min_top_count_ = coldest->second.reads + coldest->second.writes;
+      return;
+    }
+    top_keys_.erase(coldest);
+  }
+  top_keys_.emplace(std::move(id), Entry{std::string(ns), std::string(key), reads, writes});
+  if (top_keys_.size() >= kTopKeysCapacity) {
+    auto coldest = std::min_element(top_keys_.begin(), top_keys_.end(), colder);
+    min_top_count_ = coldest->second.reads + coldest->second.writes;
+  }
+}
+
+std::vector<HotKeys::Entry> HotKeys::GetTop(size_t count, std::string_view ns) const {
+  std::vector<Entry> entries;
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    for (const auto &[_, entry] : top_keys_) {
+      if (ns.empty() || entry.ns == ns) entries.emplace_back(entry);
+    }
+  }
+
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry &a, const Entry &b) { return a.reads + a.writes > b.reads + b.writes; });
+  if (entries.size() > count) entries.resize(count);
+  return entries;
+}
+
+uint64_t HotKeys::EstimateAccesses(std::string_view ns, std::string_view key) const {
+  auto hash = HashKey(ns, key);
+  return estimate(reads_, hash) + estimate(writes_, hash);
+}
+
+uint64_t HotKeys::EstimateLastAccess(std::string_view ns, std::string_view key) const {
+  return estimate(last_access_, HashKey(ns, key));
+}
+
+// The times of the last accesses aren't decayed
+void HotKeys::Decay() {
+  for (auto *sketch : {&reads_, &writes_}) {
+    for (auto &counter : *sketch) {
+      counter.store(counter.load(std::memory_order_relaxed) / 2, std::memory_order_relaxed);
+    }
+  }
+
+  std::lock_guard<std::mutex> guard(mu_);
+  for (auto iter = top_keys_.begin(); iter != top_keys_.end();) {
+    iter->second.reads /= 2;
+    iter->second.writes /= 2;
+    if (iter->second.reads + iter->second.writes == 0) {
+      iter = top_keys_.erase(iter);
+    } else {
+      iter++;
+    }
+  }
+  min_top_count_ = 0;
+}
@@ -0,0 +1,79 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// HotKeys estimates the most accessed keys from a sample of the key accesses.
+// Access frequencies are counted by two Count-Min sketches (one for reads and one for writes),
+// and the keys with the highest estimations are kept in a small top-K table.
+// The time of the last sampled access is kept by a third sketch, whose cells hold the latest time
+// of all the keys hashed into them, so the smallest of them bounds the last access of a key.
+class HotKeys {
+ public:
+  static constexpr size_t kSketchDepth = 4;
+  static constexpr size_t kSketchWidth = 1 << 14;
+  static constexpr size_t kTopKeysCapacity = 128;
+
+  struct Entry {
+    std::string ns;
+    std::string key;
+    uint64_t reads = 0;
+    uint64_t writes = 0;
+  };
+
+  HotKeys() = default;
+  HotKeys(const HotKeys &) = delete;
+  HotKeys &operator=(const HotKeys &) = delete;
+
+  // Record adds a single sampled access of the key
+  void Record(std::string_view ns, std::string_view key, bool is_write);
+  // GetTop returns at most `count` hottest keys in descending order, only in namespace `ns` if it's not empty
+  std::vector<Entry> GetTop(size_t count, std::string_view ns) const;
+  // Decay halves all counters, so that keys which are no longer accessed leave the top-K table over time
+  void Decay();
+  // EstimateAccesses returns the estimated sampled reads and writes of the key, decayed like the top-K table
+  uint64_t EstimateAccesses(std::string_view ns, std::string_view key) const;
+  // EstimateLastAccess returns the latest unix time in seconds the key may have been sampled, or 0 if it never was
+  uint64_t EstimateLastAccess(std::string_view ns, std::string_view key) const;
+
+ private:
+  using Sketch = std::array<std::atomic<uint32_t>, kSketchDepth * kSketchWidth>;
+
+  static uint64_t increaseAndEstimate(Sketch *sketch, uint64_t hash);
+  static uint64_t estimate(const Sketch &sketch, uint64_t hash);
+
+  Sketch reads_{};
+  Sketch writes_{};
+  Sketch last_access_{};
+
+  mutable std::mutex mu_;
+  // keyed by namespace + '\0' + key
+  std::unordered_map<std::string, Entry> top_keys_;
+  std::atomic<uint64_t> min_top_count_ = 0;
+};
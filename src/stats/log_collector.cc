@@ -21,20 +21,24 @@
 #include "log_collector.h"
 
 #include <algorithm>
+#include <mutex>
 #include <string>
+#include <thread>
 
 #include "server/redis_reply.h"
 #include "time_util.h"
 
 std::string SlowEntry::ToRedisString() const {
   std::string output;
-  output.append(redis::MultiLen(6));
+  // the perf stats are only appended if there're some, to keep the Redis layout for the others
+  output.append(redis::MultiLen(perf_stats.empty() ? 6 : 7));
   output.append(redis::Integer(id));
   output.append(redis::Integer(time));
   output.append(redis::Integer(duration));
   output.append(redis::ArrayOfBulkStrings(args));
   output.append(redis::BulkString(ip + ":" + std::to_string(port)));
   output.append(redis::BulkString(client_name));
+  if (!perf_stats.empty()) output.append(redis::BulkString(perf_stats));
   return output;
 }
 
@@ -51,62 +55,86 @@ std::string PerfEntry::ToRedisString() const {
 }
 
 template <class T>
-LogCollector<T>::~LogCollector() {
-  Reset();
+void LogCollector<T>::lockSlot(Slot *slot) {
+  while (slot->busy.test_and_set(std::memory_order_acquire)) {
+    std::this_thread::yield();
+  }
 }
 
 template <class T>
 ssize_t LogCollector<T>::Size() {
-  std::lock_guard<std::mutex> guard(mu_);
-  ssize_t n = entries_.size();
-  return n;
+  std::shared_lock<std::shared_mutex> guard(ring_mu_);
+  auto n = id_.load() - reset_id_.load();
+  return static_cast<ssize_t>(std::min<uint64_t>(n, capacity_));
 }
 
 template <class T>
 void LogCollector<T>::Reset() {
-  std::lock_guard<std::mutex> guard(mu_);
-  while (!entries_.empty()) {
-    entries_.pop_front();
+  std::unique_lock<std::shared_mutex> guard(ring_mu_);
+  reset_id_ = id_.load();
+  for (size_t i = 0; i < capacity_; i++) {
+    slots_[i].id = 0;
+    slots_[i].entry = T{};
   }
 }
 
 template <class T>
 void LogCollector<T>::SetMaxEntries(int64_t max_entries) {
-  std::lock_guard<std::mutex> guard(mu_);
-  while (max_entries > 0 && static_cast<int64_t>(entries_.size()) > max_entries) {
-    entries_.pop_back();
+  auto capacity = static_cast<size_t>(max_entries > 0 ? std::min(max_entries, kMaxRingEntries) : kMaxRingEntries);
+
+  std::unique_lock<std::shared_mutex> guard(ring_mu_);
+  if (capacity == capacity_) return;
+
+  // the latest entries are kept in the new ring
+  auto slots = std::make_unique<Slot[]>(capacity);
+  for (size_t i = 0; i < capacity_; i++) {
+    auto &slot = slots_[i];
+    if (slot.id == 0 || slot.id + capacity <= id_.load()) continue;
+    slots[slot.id % capacity].id = slot.id;
+    slots[slot.id % capacity].entry = std::move(slot.entry);
   }
-  max_entries_ = max_entries;
+  slots_ = std::move(slots);
+  capacity_ = capacity;
 }
 
 template <class T>
-void LogCollector<T>::PushEntry(std::unique_ptr<T> &&entry) {
-  std::lock_guard<std::mutex> guard(mu_);
-  entry->id = ++id_;
-  entry->time = util::GetTimeStamp();
-  if (max_entries_ > 0 && !entries_.empty() && entries_.size() >= static_cast<size_t>(max_entries_)) {
-    entries_.pop_back();
+void LogCollector<T>::PushEntry(T &&entry) {
+  std::shared_lock<std::shared_mutex> guard(ring_mu_);
+  auto id = id_.fetch_add(1) + 1;
+  entry.id = id;
+  entry.time = util::GetTimeStamp();
+
+  auto &slot = slots_[id % capacity_];
+  lockSlot(&slot);
+  // a slower writer of an older id in the same slot must not overwrite the newer entry
+  if (id > slot.id) {
+    slot.id = id;
+    std::swap(slot.entry, entry);
   }
-  entries_.push_front(std::move(entry));
+  unlockSlot(&slot);
+  // the replaced entry is released out of the slot lock
 }
 
 template <class T>
 std::string LogCollector<T>::GetLatestEntries(int64_t cnt) {
+  std::string entries;
   size_t n = 0;
-  std::string output;
 
-  std::lock_guard<std::mutex> guard(mu_);
-  if (cnt > 0) {
-    n = std::min(entries_.size(), static_cast<size_t>(cnt));
-  } else {
-    n = entries_.size();
+  std::shared_lock<std::shared_mutex> guard(ring_mu_);
+  auto limit = cnt > 0 ? std::min(static_cast<size_t>(cnt), capacity_) : capacity_;
+  auto latest = id_.load();
+  auto oldest = std::max(reset_id_.load(), latest > capacity_ ? latest - capacity_ : 0);
+  // the ids which are taken by the writers but not yet written are skipped
+  for (auto id = latest; id > oldest && n < limit; id--) {
+    auto &slot = slots_[id % capacity_];
+    lockSlot(&slot);
+    if (slot.id == id) {
+      entries.append(slot.entry.ToRedisString());
+      n++;
+    }
+    unlockSlot(&slot);
   }
-  output.append(redis::MultiLen(n));
-  for (const auto &entry : entries_) {
-    output.append(entry->ToRedisString());
-    if (--n == 0) break;
-  }
-  return output;
+  return redis::MultiLen(n) + entries;
 }
 
 template class LogCollector<SlowEntry>;
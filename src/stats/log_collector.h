@@ -23,11 +23,11 @@
 #include <sys/types.h>
 #include <time.h>
 
+#include <atomic>
 #include <cstdint>
-#include <deque>
 #include <functional>
 #include <memory>
-#include <mutex>
+#include <shared_mutex>
 #include <string>
 #include <vector>
 
@@ -40,6 +40,9 @@ class SlowEntry {
   std::string client_name;
   std::string ip;
   uint32_t port;
+  // aggregated perf counters if the command was sampled, see profiling-stats-sample-interval,
+  // and the bytes allocated by the command with jemalloc
+  std::string perf_stats;
   std::string ToRedisString() const;
 };
 
@@ -55,22 +58,43 @@ class PerfEntry {
   std::string ToRedisString() const;
 };
 
+// LogCollector keeps the latest entries in a ring of preallocated slots.
+//
+// A writer takes the id of its entry by an atomic increment, and moves the entry into the slot
+// of the id in the ring, so the writers never wait for each other and never allocate in the ring.
+// A slot is guarded by a flag, which is only contended when a reader is formatting the same slot,
+// or when the ring is overrun. The ring is only locked exclusively to be resized or reset.
 template <class T>
 class LogCollector {
  public:
-  LogCollector() = default;
+  // the ring can't be unbounded, so the max entries of zero (no limit) or larger than it are capped
+  static constexpr int64_t kMaxRingEntries = 1 << 16;
+
+  LogCollector() { SetMaxEntries(128); }
   LogCollector(const LogCollector &) = delete;
   LogCollector &operator=(const LogCollector &) = delete;
-  ~LogCollector();
+  ~LogCollector() = default;
   ssize_t Size();
   void Reset();
   void SetMaxEntries(int64_t max_entries);
-  void PushEntry(std::unique_ptr<T> &&entry);
+  void PushEntry(T &&entry);
   std::string GetLatestEntries(int64_t cnt);
 
  private:
-  std::mutex mu_;
-  uint64_t id_ = 0;
-  int64_t max_entries_ = 128;
-  std::deque<std::unique_ptr<T>> entries_;
+  struct Slot {
+    std::atomic_flag busy = ATOMIC_FLAG_INIT;
+    // the id of the entry in the slot, 0 if it's empty
+    uint64_t id = 0;
+    T entry;
+  };
+
+  static void lockSlot(Slot *slot);
+  static void unlockSlot(Slot *slot) { slot->busy.clear(std::memory_order_release); }
+
+  std::shared_mutex ring_mu_;
+  std::atomic<uint64_t> id_ = 0;
+  // the entries whose ids are not larger than it are removed by Reset
+  std::atomic<uint64_t> reset_id_ = 0;
+  size_t capacity_ = 0;
+  std::unique_ptr<Slot[]> slots_;
 };
@@ -0,0 +1,94 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "open_metrics.h"
+
+#include <fmt/format.h>
+
+#include <iterator>
+
+void OpenMetricsWriter::Family(std::string_view name, std::string_view type, std::string_view help) {
+  fmt::format_to(std::back_inserter(*output_), "# TYPE {} {}\n# HELP {} {}\n", name, type, name, help);
+}
+
+void OpenMetricsWriter::Sample(std::string_view name, const Labels &labels, uint64_t value) {
+  appendName(name, labels);
+  fmt::format_to(std::back_inserter(*output_), " {}\n", value);
+}
+
+void OpenMetricsWriter::Sample(std::string_view name, const Labels &labels, double value) {
+  appendName(name, labels);
+  fmt::format_to(std::back_inserter(*output_), " {}\n", value);
+}
+
+void OpenMetricsWriter::Histogram(std::string_view name, const Labels &labels,
+                                  const LatencyHistogram::Snapshot &snapshot) {
+  std::string bucket_name = fmt::format("{}_bucket", name);
+  uint64_t count = 0;
+  for (size_t i = 0; i < LatencyHistogram::kBuckets; i++) {
+    count += snapshot.buckets[i];
+    // the last bucket of each power of two, and the last bucket of all is +Inf
+    if ((i + 1) % LatencyHistogram::kSubBuckets != 0 || i + 1 == LatencyHistogram::kBuckets) continue;
+
+    auto le = fmt::format("{}", static_cast<double>(LatencyHistogram::BucketUpperBound(i)) / 1e6);
+    appendName(bucket_name, labels, "le", le);
+    fmt::format_to(std::back_inserter(*output_), " {}\n", count);
+  }
+  appendName(bucket_name, labels, "le", "+Inf");
+  fmt::format_to(std::back_inserter(*output_), " {}\n", snapshot.count);
+
+  appendName(fmt::format("{}_count", name), labels);
+  fmt::format_to(std::back_inserter(*output_), " {}\n", snapshot.count);
+}
+
+void OpenMetricsWriter::appendName(std::string_view name, const Labels &labels, std::string_view extra_label,
+                                   std::string_view extra_value) {
+  output_->append(name);
+  if (labels.empty() && extra_label.empty()) return;
+
+  auto append_label = [this](std::string_view label, std::string_view value) {
+    output_->append(label);
+    output_->append("=\"");
+    for (char c : value) {
+      if (c == '\\' || c == '"') {
+        output_->push_back('\\');
+        output_->push_back(c);
+      } else if (c == '\n') {
+        output_->append("\\n");
+      } else {
+        output_->push_back(c);
+      }
+    }
+    output_->push_back('"');
+  };
+
+  output_->push_back('{');
+  bool first = true;
+  for (const auto &[label, value] : labels) {
+    if (!first) output_->push_back(',');
+    append_label(label, value);
+    first = false;
+  }
+  if (!extra_label.empty()) {
+    if (!first) output_->push_back(',');
+    append_label(extra_label, extra_value);
+  }
+  output_->push_back('}');
+}
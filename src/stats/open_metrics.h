@@ -0,0 +1,54 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "latency_histogram.h"
+
+// OpenMetricsWriter writes the metrics in the OpenMetrics text format, which Prometheus scrapes.
+//
+// A family is declared by Family first, and then its samples follow. The name of a counter family has no
+// `_total` suffix, while the names of its samples have it. Finish ends the exposition with `# EOF`.
+class OpenMetricsWriter {
+ public:
+  using Labels = std::vector<std::pair<std::string_view, std::string_view>>;
+
+  explicit OpenMetricsWriter(std::string *output) : output_(output) {}
+
+  void Family(std::string_view name, std::string_view type, std::string_view help);
+  void Sample(std::string_view name, const Labels &labels, uint64_t value);
+  void Sample(std::string_view name, const Labels &labels, double value);
+  // Histogram writes the buckets of the latencies in seconds, one bucket per power of two microseconds
+  // is enough for the percentiles of the dashboards, and keeps the exposition small
+  void Histogram(std::string_view name, const Labels &labels, const LatencyHistogram::Snapshot &snapshot);
+  void Finish() { output_->append("# EOF\n"); }
+
+ private:
+  std::string *output_;
+
+  void appendName(std::string_view name, const Labels &labels, std::string_view extra_label = {},
+                  std::string_view extra_value = {});
+};
@@ -20,6 +20,7 @@
 
 #include "stats.h"
 
+#include <algorithm>
 #include <chrono>
 #include <mutex>
 
@@ -83,13 +84,61 @@ int64_t Stats::GetMemoryRSS() {
 }
 #endif
 
-void Stats::IncrCalls(const std::string &command_name) {
-  total_calls.fetch_add(1, std::memory_order_relaxed);
-  commands_stats[command_name].calls.fetch_add(1, std::memory_order_relaxed);
+void Stats::InitCommandStats(size_t num_commands) {
+  command_stats_shards_.clear();
+  for (size_t i = 0; i < STATS_COMMAND_SHARDS; i++) {
+    command_stats_shards_.emplace_back(std::make_unique<CommandStatsShard>(num_commands));
+  }
+  command_latency_histograms_ = std::make_unique<LatencyHistogram[]>(num_commands);
+  command_perf_counters_ = std::make_unique<PerfCounters[]>(num_commands);
+}
+
+void Stats::RecordPerfSample(size_t command_id, const PerfSample &sample) {
+  auto &perf = command_perf_counters_[command_id];
+  perf.samples.fetch_add(1, std::memory_order_relaxed);
+  for (size_t i = 0; i < STATS_PERF_COUNT; i++) {
+    if (sample[i] != 0) perf.counters[i].fetch_add(sample[i], std::memory_order_relaxed);
+  }
+}
+
+CommandPerfStat Stats::GetCommandPerfStat(size_t command_id) const {
+  const auto &perf = command_perf_counters_[command_id];
+  CommandPerfStat stat;
+  stat.samples = perf.samples.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < STATS_PERF_COUNT; i++) {
+    stat.counters[i] = perf.counters[i].load(std::memory_order_relaxed);
+  }
+  return stat;
 }
 
-void Stats::IncrLatency(uint64_t latency, const std::string &command_name) {
-  commands_stats[command_name].latency.fetch_add(latency, std::memory_order_relaxed);
+std::string FormatPerfSample(const PerfSample &sample) {
+  std::string output;
+  for (size_t i = 0; i < STATS_PERF_COUNT; i++) {
+    if (sample[i] == 0) continue;
+    if (!output.empty()) output.append(",");
+    output.append(fmt::format("{}={}", kStatsPerfCounterNames[i], sample[i]));
+  }
+  return output;
+}
+
+uint64_t Stats::GetTotalCalls() const {
+  uint64_t total_calls = 0;
+  for (const auto &shard : command_stats_shards_) {
+    total_calls += shard->total_calls.load(std::memory_order_relaxed);
+  }
+  return total_calls;
+}
+
+CommandStat Stats::GetCommandStat(size_t command_id) const {
+  CommandStat stat;
+  for (const auto &shard : command_stats_shards_) {
+    stat.calls += shard->commands[command_id].calls.load(std::memory_order_relaxed);
+    stat.latency += shard->commands[command_id].latency.load(std::memory_order_relaxed);
+    stat.alloc_bytes += shard->commands[command_id].alloc_bytes.load(std::memory_order_relaxed);
+    stat.max_alloc_bytes =
+        std::max(stat.max_alloc_bytes, shard->commands[command_id].max_alloc_bytes.load(std::memory_order_relaxed));
+  }
+  return stat;
 }
 
 void Stats::TrackInstantaneousMetric(int metric, uint64_t current_reading) {
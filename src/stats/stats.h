@@ -22,12 +22,16 @@
 
 #include <unistd.h>
 
+#include <array>
 #include <atomic>
-#include <map>
+#include <memory>
 #include <shared_mutex>
 #include <string>
 #include <vector>
 
+#include "hot_keys.h"
+#include "latency_histogram.h"
+
 enum StatsMetricFlags {
   STATS_METRIC_COMMAND = 0,       // Number of commands executed
   STATS_METRIC_NET_INPUT,         // Bytes read to network
@@ -38,14 +42,69 @@ enum StatsMetricFlags {
   STATS_METRIC_ROCKSDB_SEEK,      // Number of calls of seek in rocksdb
   STATS_METRIC_ROCKSDB_NEXT,      // Number of calls of next in rocksdb
   STATS_METRIC_ROCKSDB_PREV,      // Number of calls of prev in rocksdb
+  STATS_METRIC_MIGRATE_BYTES,     // Bytes sent by the slot migrations
+  STATS_METRIC_IMPORT_BYTES,      // Bytes applied by the slot imports
+  STATS_METRIC_REPL_SENDS,        // Number of sends of the replication stream to the replicas
   STATS_METRIC_COUNT
 };
 
 constexpr int STATS_METRIC_SAMPLES = 16;  // Number of samples per metric
 
+// Counters taken from rocksdb PerfContext/IOStatsContext of sampled commands
+enum StatsPerfCounter {
+  STATS_PERF_BLOCK_CACHE_HIT = 0,      // Number of block cache hits
+  STATS_PERF_BLOCK_READ,               // Number of blocks read from files
+  STATS_PERF_BLOCK_READ_BYTES,         // Bytes of blocks read from files
+  STATS_PERF_BLOCK_READ_US,            // Time spent on reading blocks from files
+  STATS_PERF_MEMTABLE_GET,             // Number of point lookups in memtables
+  STATS_PERF_MEMTABLE_SEEK,            // Number of seeks in memtables
+  STATS_PERF_INTERNAL_KEY_SKIPPED,     // Number of internal keys (e.g. old versions) skipped by iterators
+  STATS_PERF_INTERNAL_DELETE_SKIPPED,  // Number of tombstones skipped by iterators
+  STATS_PERF_WRITE_WAL_US,             // Time spent on writing WAL
+  STATS_PERF_WRITE_MEMTABLE_US,        // Time spent on writing memtables
+  STATS_PERF_IO_READ_BYTES,            // Bytes read by file system calls
+  STATS_PERF_COUNT
+};
+
+inline constexpr const char *kStatsPerfCounterNames[STATS_PERF_COUNT] = {
+    "block_cache_hit", "block_read", "block_read_bytes", "block_read_us", "memtable_get", "memtable_seek",
+    "internal_key_skipped", "internal_delete_skipped", "write_wal_us", "write_memtable_us", "io_read_bytes"};
+
+using PerfSample = std::array<uint64_t, STATS_PERF_COUNT>;
+
+// FormatPerfSample formats the non-zero counters as "name=value,name=value"
+std::string FormatPerfSample(const PerfSample &sample);
+
+struct CommandPerfStat {
+  uint64_t samples = 0;
+  PerfSample counters{};
+};
+
+constexpr size_t STATS_COMMAND_SHARDS = 32;  // Number of shards of command stats, should be >= workers for no sharing
+
 struct CommandStat {
-  std::atomic<uint64_t> calls;
-  std::atomic<uint64_t> latency;
+  uint64_t calls = 0;
+  uint64_t latency = 0;
+  // the bytes allocated by the calls in total and by the largest call, see util::ThreadAllocatedBytes
+  uint64_t alloc_bytes = 0;
+  uint64_t max_alloc_bytes = 0;
+};
+
+// CommandStatsShard holds the stats of all commands updated by a subset of threads,
+// indexed by the command id in the command table. Each thread sticks to one shard,
+// so that the counters of different workers never share cache lines.
+struct alignas(64) CommandStatsShard {
+  struct Counter {
+    std::atomic<uint64_t> calls = 0;
+    std::atomic<uint64_t> latency = 0;
+    std::atomic<uint64_t> alloc_bytes = 0;
+    std::atomic<uint64_t> max_alloc_bytes = 0;
+  };
+
+  explicit CommandStatsShard(size_t num_commands) : commands(new Counter[num_commands]) {}
+
+  std::atomic<uint64_t> total_calls = 0;
+  std::unique_ptr<Counter[]> commands;
 };
 
 struct InstMetric {
@@ -57,7 +116,6 @@ struct InstMetric {
 
 class Stats {
  public:
-  std::atomic<uint64_t> total_calls = {0};
   std::atomic<uint64_t> in_bytes = {0};
   std::atomic<uint64_t> out_bytes = {0};
 
@@ -67,17 +125,87 @@ class Stats {
   std::atomic<uint64_t> fullsync_count = {0};
   std::atomic<uint64_t> psync_err_count = {0};
   std::atomic<uint64_t> psync_ok_count = {0};
-  std::map<std::string, CommandStat> commands_stats;
+  // the write commands rejected because of the write stall of RocksDB, see write-stall-policy
+  std::atomic<uint64_t> stall_rejected_writes = {0};
+  // the keys evicted over max-db-size, see max-db-size-policy
+  std::atomic<uint64_t> evicted_keys = {0};
+  // the bytes of the write batches sent by the compressed incremental replication streams, before and after
+  // the compression
+  std::atomic<uint64_t> repl_compression_raw_bytes = {0};
+  std::atomic<uint64_t> repl_compression_sent_bytes = {0};
+  // the sends of the incremental replication stream to the replicas, and the batches in them
+  std::atomic<uint64_t> repl_sends = {0};
+  std::atomic<uint64_t> repl_sent_batches = {0};
+  std::atomic<uint64_t> migrate_bytes = {0};
+  std::atomic<uint64_t> import_bytes = {0};
+
+  // contended waits on the key locks of LockManager and on Server::WorkExclusivityGuard
+  LatencyHistogram lock_wait_histogram;
+  LatencyHistogram exclusivity_wait_histogram;
+  // the commands of the clients, i.e. excluding the ones of the slot importing connections
+  LatencyHistogram foreground_latency_histogram;
+
+  HotKeys hot_keys;
 
   Stats();
-  void IncrCalls(const std::string &command_name);
-  void IncrLatency(uint64_t latency, const std::string &command_name);
+  // InitCommandStats must be called before any command is executed
+  void InitCommandStats(size_t num_commands);
+  void IncrCalls(size_t command_id) {
+    auto &shard = commandStatsShard();
+    shard.total_calls.fetch_add(1, std::memory_order_relaxed);
+    shard.commands[command_id].calls.fetch_add(1, std::memory_order_relaxed);
+  }
+  void IncrLatency(uint64_t latency, size_t command_id) {
+    commandStatsShard().commands[command_id].latency.fetch_add(latency, std::memory_order_relaxed);
+  }
+  void RecordAllocation(uint64_t bytes, size_t command_id) {
+    auto &counter = commandStatsShard().commands[command_id];
+    counter.alloc_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    auto max_bytes = counter.max_alloc_bytes.load(std::memory_order_relaxed);
+    while (bytes > max_bytes && !counter.max_alloc_bytes.compare_exchange_weak(max_bytes, bytes)) {
+    }
+  }
+  void RecordLatency(uint64_t latency, size_t command_id) { command_latency_histograms_[command_id].Record(latency); }
+  const LatencyHistogram &GetCommandLatencyHistogram(size_t command_id) const {
+    return command_latency_histograms_[command_id];
+  }
+  void RecordPerfSample(size_t command_id, const PerfSample &sample);
+  CommandPerfStat GetCommandPerfStat(size_t command_id) const;
+  uint64_t GetTotalCalls() const;
+  CommandStat GetCommandStat(size_t command_id) const;
   void IncrInboundBytes(uint64_t bytes) { in_bytes.fetch_add(bytes, std::memory_order_relaxed); }
   void IncrOutboundBytes(uint64_t bytes) { out_bytes.fetch_add(bytes, std::memory_order_relaxed); }
   void IncrFullSyncCount() { fullsync_count.fetch_add(1, std::memory_order_relaxed); }
   void IncrPSyncErrCount() { psync_err_count.fetch_add(1, std::memory_order_relaxed); }
   void IncrPSyncOKCount() { psync_ok_count.fetch_add(1, std::memory_order_relaxed); }
+  void IncrMigrateBytes(uint64_t bytes) { migrate_bytes.fetch_add(bytes, std::memory_order_relaxed); }
+  void IncrImportBytes(uint64_t bytes) { import_bytes.fetch_add(bytes, std::memory_order_relaxed); }
+  void IncrReplCompressionBytes(uint64_t raw_bytes, uint64_t sent_bytes) {
+    repl_compression_raw_bytes.fetch_add(raw_bytes, std::memory_order_relaxed);
+    repl_compression_sent_bytes.fetch_add(sent_bytes, std::memory_order_relaxed);
+  }
+  void IncrReplSends(uint64_t batches) {
+    repl_sends.fetch_add(1, std::memory_order_relaxed);
+    repl_sent_batches.fetch_add(batches, std::memory_order_relaxed);
+  }
   static int64_t GetMemoryRSS();
   void TrackInstantaneousMetric(int metric, uint64_t current_reading);
   uint64_t GetInstantaneousMetric(int metric) const;
+
+ private:
+  CommandStatsShard &commandStatsShard() {
+    static std::atomic<size_t> next_shard = 0;
+    thread_local size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % STATS_COMMAND_SHARDS;
+    return *command_stats_shards_[shard];
+  }
+
+  std::vector<std::unique_ptr<CommandStatsShard>> command_stats_shards_;
+  std::unique_ptr<LatencyHistogram[]> command_latency_histograms_;
+
+  struct PerfCounters {
+    std::atomic<uint64_t> samples = 0;
+    std::array<std::atomic<uint64_t>, STATS_PERF_COUNT> counters{};
+  };
+  // sampled commands are rare enough to share the counters among threads
+  std::unique_ptr<PerfCounters[]> command_perf_counters_;
 };
@@ -27,6 +27,8 @@
 #include "server/redis_reply.h"
 #include "server/server.h"
 #include "types/redis_bitmap.h"
+#include "types/redis_sortedint_block.h"
+#include "types/redis_string.h"
 
 void WriteBatchExtractor::LogData(const rocksdb::Slice &blob) {
   // Currently, we only have two kinds of log data
@@ -44,30 +46,32 @@ void WriteBatchExtractor::LogData(const rocksdb::Slice &blob) {
 }
 
 rocksdb::Status WriteBatchExtractor::PutCF(uint32_t column_family_id, const Slice &key, const Slice &value) {
-  if (column_family_id == static_cast<uint32_t>(ColumnFamilyID::SecondarySubkey)) {
+  if (column_family_id == static_cast<uint32_t>(ColumnFamilyID::SecondarySubkey) ||
+      column_family_id == static_cast<uint32_t>(ColumnFamilyID::TTLIndex) ||
+      column_family_id == static_cast<uint32_t>(ColumnFamilyID::ZSetRank) ||
+      column_family_id == static_cast<uint32_t>(ColumnFamilyID::KeyID)) {
     return rocksdb::Status::OK();
   }
-
-  std::string ns, user_key;
-  std::vector<std::string> command_args;
+  if (!inSlotRange(column_family_id, key)) return rocksdb::Status::OK();
 
   if (column_family_id == static_cast<uint32_t>(ColumnFamilyID::Metadata)) {
-    std::tie(ns, user_key) = ExtractNamespaceKey<std::string>(key, is_slot_id_encoded_);
-    auto key_slot_id = GetSlotIdFromKey(user_key);
-    if (slot_range_.IsValid() && !slot_range_.Contains(key_slot_id)) {
-      return rocksdb::Status::OK();
-    }
+    auto [ns_slice, user_key_slice] = ExtractNamespaceKey(key, is_slot_id_encoded_);
+    auto ns = ns_slice.ToStringView(), user_key = user_key_slice.ToStringView();
 
     Metadata metadata(kRedisNone);
     auto s = metadata.Decode(value);
     if (!s.ok()) return s;
 
-    if (metadata.Type() == kRedisString) {
-      command_args = {"SET", user_key, value.ToString().substr(Metadata::GetOffsetAfterExpire(value[0]))};
-      resp_commands_[ns].emplace_back(redis::ArrayOfBulkStrings(command_args));
+    if (metadata.Type() == kRedisString && metadata.IsSplit() && log_data_.GetArguments()->empty()) {
+      // A chunked string written as a whole is cleared here, and its chunks are replayed by SETRANGE
+      appendCommand(ns, {"SET", user_key, ""});
+      if (metadata.expire > 0) {
+        appendCommand(ns, {"PEXPIREAT", user_key, std::to_string(metadata.expire)});
+      }
+    } else if (metadata.Type() == kRedisString && !metadata.IsSplit()) {
+      appendCommand(ns, {"SET", user_key, value.ToStringView().substr(Metadata::GetOffsetAfterExpire(value[0]))});
       if (metadata.expire > 0) {
-        command_args = {"PEXPIREAT", user_key, std::to_string(metadata.expire)};
-        resp_commands_[ns].emplace_back(redis::ArrayOfBulkStrings(command_args));
+        appendCommand(ns, {"PEXPIREAT", user_key, std::to_string(metadata.expire)});
       }
     } else if (metadata.expire > 0) {
       auto args = log_data_.GetArguments();
@@ -80,8 +84,7 @@ rocksdb::Status WriteBatchExtractor::PutCF(uint32_t column_family_id, const Slic
 
         auto cmd = static_cast<RedisCommand>(*parse_result);
         if (cmd == kRedisCmdExpire) {
-          command_args = {"PEXPIREAT", user_key, std::to_string(metadata.expire)};
-          resp_commands_[ns].emplace_back(redis::ArrayOfBulkStrings(command_args));
+          appendCommand(ns, {"PEXPIREAT", user_key, std::to_string(metadata.expire)});
         }
       }
     }
@@ -97,14 +100,31 @@ rocksdb::Status WriteBatchExtractor::PutCF(uint32_t column_family_id, const Slic
       auto s = stream_metadata.Decode(value);
       if (!s.ok()) return s;
 
-      command_args = {"XSETID",
-                      user_key,
-                      stream_metadata.last_entry_id.ToString(),
-                      "ENTRIESADDED",
-                      std::to_string(stream_metadata.entries_added),
-                      "MAXDELETEDID",
-                      stream_metadata.max_deleted_entry_id.ToString()};
-      resp_commands_[ns].emplace_back(redis::ArrayOfBulkStrings(command_args));
+      appendCommand(ns, {"XSETID", user_key, stream_metadata.last_entry_id.ToString(), "ENTRIESADDED",
+                         std::to_string(stream_metadata.entries_added), "MAXDELETEDID",
+                         stream_metadata.max_deleted_entry_id.ToString()});
+    }
+
+    // An INLINE hash is written as a whole by every change, so replay it as a whole too
+    if (metadata.Type() == kRedisHash) {
+      HashMetadata hash_metadata;
+      auto s = hash_metadata.Decode(value);
+      if (!s.ok()) return s;
+      if (!hash_metadata.IsInline()) return rocksdb::Status::OK();
+
+      appendCommand(ns, {"DEL", user_key});
+      if (!hash_metadata.inline_fields.empty()) {
+        std::vector<std::string> fields;
+        fields.reserve(hash_metadata.inline_fields.size() * 2);
+        for (const auto &[field, field_value] : hash_metadata.inline_fields) {
+          fields.emplace_back(field);
+          fields.emplace_back(field_value);
+        }
+        appendCommand(ns, {"HSET", user_key}, fields.begin(), fields.end());
+      }
+      if (hash_metadata.expire > 0) {
+        appendCommand(ns, {"PEXPIREAT", user_key, std::to_string(hash_metadata.expire)});
+      }
     }
 
     return rocksdb::Status::OK();
@@ -112,18 +132,18 @@ rocksdb::Status WriteBatchExtractor::PutCF(uint32_t column_family_id, const Slic
 
   if (column_family_id == static_cast<uint32_t>(ColumnFamilyID::PrimarySubkey)) {
     InternalKey ikey(key, is_slot_id_encoded_);
-    user_key = ikey.GetKey().ToString();
-    auto key_slot_id = GetSlotIdFromKey(user_key);
-    if (slot_range_.IsValid() && !slot_range_.Contains(key_slot_id)) {
+    auto resolved_key = userKey(ikey);
+    if (!resolved_key) {
+      LOG(WARNING) << "Failed to parse write_batch in PutCF: " << resolved_key.Msg();
       return rocksdb::Status::OK();
     }
-
-    std::string sub_key = ikey.GetSubKey().ToString();
-    ns = ikey.GetNamespace().ToString();
+    auto user_key = *resolved_key;
+    auto sub_key = ikey.GetSubKey().ToStringView();
+    auto ns = ikey.GetNamespace().ToStringView();
 
     switch (log_data_.GetRedisType()) {
       case kRedisHash:
-        command_args = {"HSET", user_key, sub_key, value.ToString()};
+        appendCommand(ns, {"HSET", user_key, sub_key, value.ToStringView()});
         break;
       case kRedisList: {
         auto args = log_data_.GetArguments();
@@ -148,7 +168,7 @@ rocksdb::Status WriteBatchExtractor::PutCF(uint32_t column_family_id, const Slic
               return rocksdb::Status::OK();
             }
 
-            command_args = {"LSET", user_key, (*args)[1], value.ToString()};
+            appendCommand(ns, {"LSET", user_key, (*args)[1], value.ToStringView()});
             break;
           case kRedisCmdLInsert:
             if (first_seen_) {
@@ -158,15 +178,15 @@ rocksdb::Status WriteBatchExtractor::PutCF(uint32_t column_family_id, const Slic
                 return rocksdb::Status::OK();
               }
 
-              command_args = {"LINSERT", user_key, (*args)[1] == "1" ? "before" : "after", (*args)[2], (*args)[3]};
+              appendCommand(ns, {"LINSERT", user_key, (*args)[1] == "1" ? "before" : "after", (*args)[2], (*args)[3]});
               first_seen_ = false;
             }
             break;
           case kRedisCmdLPush:
-            command_args = {"LPUSH", user_key, value.ToString()};
+            appendCommand(ns, {"LPUSH", user_key, value.ToStringView()});
             break;
           case kRedisCmdRPush:
-            command_args = {"RPUSH", user_key, value.ToString()};
+            appendCommand(ns, {"RPUSH", user_key, value.ToStringView()});
             break;
           case kRedisCmdLRem:
             // LREM will be parsed in DeleteCF, so ignore it here
@@ -181,11 +201,11 @@ rocksdb::Status WriteBatchExtractor::PutCF(uint32_t column_family_id, const Slic
         break;
       }
       case kRedisSet:
-        command_args = {"SADD", user_key, sub_key};
+        appendCommand(ns, {"SADD", user_key, sub_key});
         break;
       case kRedisZSet: {
         double score = DecodeDouble(value.data());
-        command_args = {"ZADD", user_key, std::to_string(score), sub_key};
+        appendCommand(ns, {"ZADD", user_key, std::to_string(score), sub_key});
         break;
       }
       case kRedisBitmap: {
@@ -216,8 +236,11 @@ rocksdb::Status WriteBatchExtractor::PutCF(uint32_t column_family_id, const Slic
               return rocksdb::Status::InvalidArgument(
                   fmt::format("failed to parse an offset of SETBIT: {}", parsed_offset.Msg()));
             }
-            bool bit_value = redis::Bitmap::GetBitFromValueAndOffset(value.ToStringView(), *parsed_offset);
-            command_args = {"SETBIT", user_key, (*args)[1], bit_value ? "1" : "0"};
+            // The new bit is logged since the roaring segments, and taken from the raw segment for the older logs
+            bool bit_value = args->size() > 2 ? (*args)[2] == "1"
+                                              : redis::Bitmap::GetBitFromValueAndOffset(value.ToStringView(),
+                                                                                        *parsed_offset);
+            appendCommand(ns, {"SETBIT", user_key, (*args)[1], bit_value ? "1" : "0"});
             break;
           }
           case kRedisCmdBitOp:
@@ -228,14 +251,12 @@ rocksdb::Status WriteBatchExtractor::PutCF(uint32_t column_family_id, const Slic
                 return rocksdb::Status::OK();
               }
 
-              command_args = {"BITOP", (*args)[1], user_key};
-              command_args.insert(command_args.end(), args->begin() + 2, args->end());
+              appendCommand(ns, {"BITOP", (*args)[1], user_key}, args->begin() + 2, args->end());
               first_seen_ = false;
             }
             break;
           case kRedisCmdBitfield:
-            command_args = {"BITFIELD", user_key};
-            command_args.insert(command_args.end(), args->begin() + 1, args->end());
+            appendCommand(ns, {"BITFIELD", user_key}, args->begin() + 1, args->end());
             break;
           default:
             LOG(ERROR) << "Failed to parse write_batch in PutCF. Type=Bitmap: unhandled command with code "
@@ -244,10 +265,37 @@ rocksdb::Status WriteBatchExtractor::PutCF(uint32_t column_family_id, const Slic
         }
         break;
       }
+      case kRedisString: {
+        // the chunks of the strings, see redis::String::kChunkSize
+        uint32_t index = DecodeFixed32(sub_key.data());
+        appendCommand(ns, {"SETRANGE", user_key,
+                           std::to_string(static_cast<uint64_t>(index) * redis::String::kChunkSize),
+                           value.ToStringView()});
+        break;
+      }
       case kRedisSortedint: {
-        if (!to_redis_) {
-          command_args = {"SIADD", user_key, std::to_string(DecodeFixed64(sub_key.data()))};
+        if (to_redis_) break;
+        // The plain sortedints write an empty value for every ID
+        if (value.empty()) {
+          appendCommand(ns, {"SIADD", user_key, std::to_string(DecodeFixed64(sub_key.data()))});
+          break;
         }
+        // The blocks are rewritten by SIREM too, in which case the removed IDs are replayed once
+        auto args = log_data_.GetArguments();
+        if (!args->empty() && (*args)[0] == std::to_string(kRedisCmdSIRem)) {
+          if (first_seen_) {
+            appendCommand(ns, {"SIREM", user_key}, args->begin() + 1, args->end());
+            first_seen_ = false;
+          }
+          break;
+        }
+        std::vector<uint64_t> ids;
+        auto s = SortedintBlock::Decode(DecodeFixed64(sub_key.data()), value, &ids);
+        if (!s.ok()) return s;
+        std::vector<std::string> id_args;
+        id_args.reserve(ids.size());
+        for (const auto id : ids) id_args.emplace_back(std::to_string(id));
+        appendCommand(ns, {"SIADD", user_key}, id_args.begin(), id_args.end());
         break;
       }
         // TODO: to implement the case of kRedisBloomFilter
@@ -255,58 +303,56 @@ rocksdb::Status WriteBatchExtractor::PutCF(uint32_t column_family_id, const Slic
         break;
     }
   } else if (column_family_id == static_cast<uint32_t>(ColumnFamilyID::Stream)) {
-    auto s = ExtractStreamAddCommand(is_slot_id_encoded_, key, value, &command_args);
+    InternalKey ikey(key, is_slot_id_encoded_);
+    auto resolved_key = userKey(ikey);
+    if (!resolved_key) {
+      LOG(WARNING) << "Failed to parse write_batch in PutCF: " << resolved_key.Msg();
+      return rocksdb::Status::OK();
+    }
+    std::vector<std::string> command_args;
+    auto s = ExtractStreamAddCommand(is_slot_id_encoded_, *resolved_key, key, value, &command_args);
     if (!s.IsOK()) {
       LOG(ERROR) << "Failed to parse write_batch in PutCF. Type=Stream: " << s.Msg();
       return rocksdb::Status::OK();
     }
-  }
-
-  if (!command_args.empty()) {
-    resp_commands_[ns].emplace_back(redis::ArrayOfBulkStrings(command_args));
+    appendCommand(ikey.GetNamespace().ToStringView(), {}, command_args.begin(), command_args.end());
   }
 
   return rocksdb::Status::OK();
 }
 
 rocksdb::Status WriteBatchExtractor::DeleteCF(uint32_t column_family_id, const Slice &key) {
-  if (column_family_id == static_cast<uint32_t>(ColumnFamilyID::SecondarySubkey)) {
+  if (column_family_id == static_cast<uint32_t>(ColumnFamilyID::SecondarySubkey) ||
+      column_family_id == static_cast<uint32_t>(ColumnFamilyID::TTLIndex) ||
+      column_family_id == static_cast<uint32_t>(ColumnFamilyID::ZSetRank) ||
+      column_family_id == static_cast<uint32_t>(ColumnFamilyID::KeyID)) {
     return rocksdb::Status::OK();
   }
-
-  std::vector<std::string> command_args;
-  std::string ns;
+  if (!inSlotRange(column_family_id, key)) return rocksdb::Status::OK();
 
   if (column_family_id == static_cast<uint32_t>(ColumnFamilyID::Metadata)) {
-    std::string user_key;
-    std::tie(ns, user_key) = ExtractNamespaceKey<std::string>(key, is_slot_id_encoded_);
-
-    auto key_slot_id = GetSlotIdFromKey(user_key);
-    if (slot_range_.IsValid() && !slot_range_.Contains(key_slot_id)) {
-      return rocksdb::Status::OK();
-    }
-
-    command_args = {"DEL", user_key};
+    auto [ns, user_key] = ExtractNamespaceKey(key, is_slot_id_encoded_);
+    appendCommand(ns.ToStringView(), {"DEL", user_key.ToStringView()});
   } else if (column_family_id == static_cast<uint32_t>(ColumnFamilyID::PrimarySubkey)) {
     InternalKey ikey(key, is_slot_id_encoded_);
-    std::string user_key = ikey.GetKey().ToString();
-    auto key_slot_id = GetSlotIdFromKey(user_key);
-    if (slot_range_.IsValid() && !slot_range_.Contains(key_slot_id)) {
+    auto resolved_key = userKey(ikey);
+    if (!resolved_key) {
+      LOG(WARNING) << "Failed to parse write_batch in DeleteCF: " << resolved_key.Msg();
       return rocksdb::Status::OK();
     }
-
-    std::string sub_key = ikey.GetSubKey().ToString();
-    ns = ikey.GetNamespace().ToString();
+    auto user_key = *resolved_key;
+    auto sub_key = ikey.GetSubKey().ToStringView();
+    auto ns = ikey.GetNamespace().ToStringView();
 
     switch (log_data_.GetRedisType()) {
       case kRedisHash:
-        command_args = {"HDEL", user_key, sub_key};
+        appendCommand(ns, {"HDEL", user_key, sub_key});
         break;
       case kRedisSet:
-        command_args = {"SREM", user_key, sub_key};
+        appendCommand(ns, {"SREM", user_key, sub_key});
         break;
       case kRedisZSet:
-        command_args = {"ZREM", user_key, sub_key};
+        appendCommand(ns, {"ZREM", user_key, sub_key});
         break;
       case kRedisList: {
         auto args = log_data_.GetArguments();
@@ -332,7 +378,7 @@ rocksdb::Status WriteBatchExtractor::DeleteCF(uint32_t column_family_id, const S
                 return rocksdb::Status::OK();
               }
 
-              command_args = {"LTRIM", user_key, (*args)[1], (*args)[2]};
+              appendCommand(ns, {"LTRIM", user_key, (*args)[1], (*args)[2]});
               first_seen_ = false;
             }
             break;
@@ -344,15 +390,15 @@ rocksdb::Status WriteBatchExtractor::DeleteCF(uint32_t column_family_id, const S
                 return rocksdb::Status::OK();
               }
 
-              command_args = {"LREM", user_key, (*args)[1], (*args)[2]};
+              appendCommand(ns, {"LREM", user_key, (*args)[1], (*args)[2]});
               first_seen_ = false;
             }
             break;
           case kRedisCmdLPop:
-            command_args = {"LPOP", user_key};
+            appendCommand(ns, {"LPOP", user_key});
             break;
           case kRedisCmdRPop:
-            command_args = {"RPOP", user_key};
+            appendCommand(ns, {"RPOP", user_key});
             break;
           case kRedisCmdLMove:
             if (first_seen_) {
@@ -361,7 +407,7 @@ rocksdb::Status WriteBatchExtractor::DeleteCF(uint32_t column_family_id, const S
                               "contain source, destination and where/from arguments";
                 return rocksdb::Status::OK();
               }
-              command_args = {"LMOVE", (*args)[1], (*args)[2], (*args)[3], (*args)[4]};
+              appendCommand(ns, {"LMOVE", (*args)[1], (*args)[2], (*args)[3], (*args)[4]});
               first_seen_ = false;
             }
             break;
@@ -372,8 +418,16 @@ rocksdb::Status WriteBatchExtractor::DeleteCF(uint32_t column_family_id, const S
         break;
       }
       case kRedisSortedint: {
-        if (!to_redis_) {
-          command_args = {"SIREM", user_key, std::to_string(DecodeFixed64(sub_key.data()))};
+        if (to_redis_) break;
+        auto args = log_data_.GetArguments();
+        if (args->empty()) {
+          appendCommand(ns, {"SIREM", user_key, std::to_string(DecodeFixed64(sub_key.data()))});
+          break;
+        }
+        // The blocks are deleted when they're emptied by SIREM or replaced by the split ones of SIADD
+        if ((*args)[0] == std::to_string(kRedisCmdSIRem) && first_seen_) {
+          appendCommand(ns, {"SIREM", user_key}, args->begin() + 1, args->end());
+          first_seen_ = false;
         }
         break;
       }
@@ -382,32 +436,111 @@ rocksdb::Status WriteBatchExtractor::DeleteCF(uint32_t column_family_id, const S
     }
   } else if (column_family_id == static_cast<uint32_t>(ColumnFamilyID::Stream)) {
     InternalKey ikey(key, is_slot_id_encoded_);
+    auto resolved_key = userKey(ikey);
+    if (!resolved_key) {
+      LOG(WARNING) << "Failed to parse write_batch in DeleteCF: " << resolved_key.Msg();
+      return rocksdb::Status::OK();
+    }
     Slice encoded_id = ikey.GetSubKey();
     redis::StreamEntryID entry_id;
     GetFixed64(&encoded_id, &entry_id.ms);
     GetFixed64(&encoded_id, &entry_id.seq);
-    command_args = {"XDEL", ikey.GetKey().ToString(), entry_id.ToString()};
+    appendCommand(ikey.GetNamespace().ToStringView(), {"XDEL", *resolved_key, entry_id.ToString()});
   }
 
-  if (!command_args.empty()) {
-    resp_commands_[ns].emplace_back(redis::ArrayOfBulkStrings(command_args));
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status WriteBatchExtractor::DeleteRangeCF(uint32_t column_family_id, [[maybe_unused]] const Slice &begin_key,
+                                                   const Slice &end_key) {
+  // Only the trimming of streams is replayed, the other DeleteRange operations remove
+  // the subkeys of deleted keys, whose deletions were already replayed from the metadata
+  if (column_family_id != static_cast<uint32_t>(ColumnFamilyID::Stream) ||
+      log_data_.GetRedisType() != kRedisStream) {
+    return rocksdb::Status::OK();
   }
 
+  if (!inSlotRange(column_family_id, end_key)) return rocksdb::Status::OK();
+
+  InternalKey ikey(end_key, is_slot_id_encoded_);
+  auto resolved_key = userKey(ikey);
+  if (!resolved_key) {
+    LOG(WARNING) << "Failed to parse write_batch in DeleteRangeCF: " << resolved_key.Msg();
+    return rocksdb::Status::OK();
+  }
+  auto user_key = *resolved_key;
+
+  // the range ends at the first entry which is kept, or at the end of the entries
+  Slice encoded_id = ikey.GetSubKey();
+  redis::StreamEntryID entry_id;
+  if (GetFixed64(&encoded_id, &entry_id.ms) && GetFixed64(&encoded_id, &entry_id.seq)) {
+    appendCommand(ikey.GetNamespace().ToStringView(), {"XTRIM", user_key, "MINID", entry_id.ToString()});
+  } else {
+    appendCommand(ikey.GetNamespace().ToStringView(), {"XTRIM", user_key, "MAXLEN", "0"});
+  }
   return rocksdb::Status::OK();
 }
 
-rocksdb::Status WriteBatchExtractor::DeleteRangeCF([[maybe_unused]] uint32_t column_family_id,
-                                                   [[maybe_unused]] const Slice &begin_key,
-                                                   [[maybe_unused]] const Slice &end_key) {
-  // Do nothing with DeleteRange operations
-  return rocksdb::Status::OK();
+bool WriteBatchExtractor::inSlotRange(uint32_t column_family_id, const Slice &key) {
+  if (!slot_range_.IsValid()) return true;
+  // the slot id is read from the prefix of the key, before the key is decoded
+  if (is_slot_id_encoded_) return slot_range_.Contains(ExtractSlotId(key));
+
+  if (column_family_id == static_cast<uint32_t>(ColumnFamilyID::Metadata)) {
+    auto [_, user_key] = ExtractNamespaceKey(key, false);
+    return slot_range_.Contains(GetSlotIdFromKey(user_key.ToStringView()));
+  }
+  InternalKey ikey(key, false);
+  auto user_key = userKey(ikey);
+  return user_key && slot_range_.Contains(GetSlotIdFromKey(*user_key));
+}
+
+StatusOr<std::string_view> WriteBatchExtractor::userKey(const InternalKey &ikey) {
+  if (!ikey.IsCompact()) return ikey.GetKey().ToStringView();
+  if (!storage_) return {Status::NotOK, "no storage to look up the key of a compact subkey"};
+
+  // the subkeys of a key come together in a batch, so its key is looked up once
+  std::string cache_key = ikey.GetNamespace().ToString();
+  PutFixed64(&cache_key, ikey.GetVersion());
+  auto [iter, inserted] = compact_keys_.try_emplace(std::move(cache_key));
+  if (!inserted) return std::string_view(iter->second);
+
+  auto s = storage_->GetKeyByID(ikey, &iter->second);
+  if (!s.ok()) {
+    compact_keys_.erase(iter);
+    return {Status::NotOK, fmt::format("failed to look up the key ID {}: {}", ikey.GetVersion(), s.ToString())};
+  }
+  return std::string_view(iter->second);
+}
+
+void WriteBatchExtractor::appendCommand(std::string_view ns, std::initializer_list<std::string_view> args,
+                                        ArgIter rest_begin, ArgIter rest_end) {
+  std::string *output = resp_output_;
+  if (output) {
+    resp_output_count_++;
+  } else {
+    if (!last_ns_commands_ || ns != last_ns_) {
+      last_ns_ = ns;
+      last_ns_commands_ = &resp_commands_[last_ns_];
+    }
+    output = &last_ns_commands_->emplace_back();
+  }
+
+  size_t size = 16;
+  for (const auto &arg : args) size += redis::ReplyWriter::BulkStringSize(arg.size());
+  for (auto iter = rest_begin; iter != rest_end; ++iter) size += redis::ReplyWriter::BulkStringSize(iter->size());
+
+  redis::ReplyWriter writer(redis::RESP::v2, output);
+  writer.Reserve(size);
+  writer.ArrayHeader(args.size() + static_cast<size_t>(rest_end - rest_begin));
+  for (const auto &arg : args) writer.BulkString(arg);
+  for (auto iter = rest_begin; iter != rest_end; ++iter) writer.BulkString(*iter);
 }
 
-Status WriteBatchExtractor::ExtractStreamAddCommand(bool is_slot_id_encoded, const Slice &subkey, const Slice &value,
-                                                    std::vector<std::string> *command_args) {
+Status WriteBatchExtractor::ExtractStreamAddCommand(bool is_slot_id_encoded, const Slice &user_key, const Slice &subkey,
+                                                    const Slice &value, std::vector<std::string> *command_args) {
   InternalKey ikey(subkey, is_slot_id_encoded);
-  std::string user_key = ikey.GetKey().ToString();
-  *command_args = {"XADD", user_key};
+  *command_args = {"XADD", user_key.ToString()};
 
   std::vector<std::string> values;
   auto s = redis::DecodeRawStreamEntryValue(value.ToString(), &values);
@@ -20,8 +20,11 @@
 
 #pragma once
 
+#include <initializer_list>
 #include <map>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 #include "cluster/cluster_defs.h"
@@ -33,25 +36,51 @@
 // An extractor to extract update from raw write batch
 class WriteBatchExtractor : public rocksdb::WriteBatch::Handler {
  public:
-  explicit WriteBatchExtractor(bool is_slot_id_encoded, int slot = -1, bool to_redis = false)
-      : is_slot_id_encoded_(is_slot_id_encoded), slot_range_(slot, slot), to_redis_(to_redis) {}
-  explicit WriteBatchExtractor(bool is_slot_id_encoded, const SlotRange &slot_range, bool to_redis = false)
-      : is_slot_id_encoded_(is_slot_id_encoded), slot_range_(slot_range), to_redis_(to_redis) {}
+  // The storage looks up the keys of the compact subkeys, which are skipped without it
+  explicit WriteBatchExtractor(bool is_slot_id_encoded, int slot = -1, bool to_redis = false,
+                               engine::Storage *storage = nullptr)
+      : is_slot_id_encoded_(is_slot_id_encoded), slot_range_(slot, slot), to_redis_(to_redis), storage_(storage) {}
+  explicit WriteBatchExtractor(bool is_slot_id_encoded, const SlotRange &slot_range, bool to_redis = false,
+                               engine::Storage *storage = nullptr)
+      : is_slot_id_encoded_(is_slot_id_encoded), slot_range_(slot_range), to_redis_(to_redis), storage_(storage) {}
 
   void LogData(const rocksdb::Slice &blob) override;
   rocksdb::Status PutCF(uint32_t column_family_id, const Slice &key, const Slice &value) override;
   rocksdb::Status DeleteCF(uint32_t column_family_id, const Slice &key) override;
   rocksdb::Status DeleteRangeCF(uint32_t column_family_id, const Slice &begin_key, const Slice &end_key) override;
   std::map<std::string, std::vector<std::string>> *GetRESPCommands() { return &resp_commands_; }
+  // SetRESPOutput makes the commands appended to the output in the order of the batch, instead of
+  // being grouped by their namespaces, GetRESPCommandCount returns the number of the appended commands
+  void SetRESPOutput(std::string *output) { resp_output_ = output; }
+  size_t GetRESPCommandCount() const { return resp_output_count_; }
 
-  static Status ExtractStreamAddCommand(bool is_slot_id_encoded, const Slice &subkey, const Slice &value,
-                                        std::vector<std::string> *command_args);
+  static Status ExtractStreamAddCommand(bool is_slot_id_encoded, const Slice &user_key, const Slice &subkey,
+                                        const Slice &value, std::vector<std::string> *command_args);
 
  private:
+  using ArgIter = std::vector<std::string>::const_iterator;
+
   std::map<std::string, std::vector<std::string>> resp_commands_;
+  // the commands of the namespace appended to last, so the map isn't looked up by every command
+  std::string last_ns_;
+  std::vector<std::string> *last_ns_commands_ = nullptr;
+  std::string *resp_output_ = nullptr;
+  size_t resp_output_count_ = 0;
+  // the keys of the compact subkeys looked up in the batch, by their namespaces and key IDs
+  std::unordered_map<std::string, std::string> compact_keys_;
   redis::WriteBatchLogData log_data_;
   bool first_seen_ = true;
   bool is_slot_id_encoded_ = false;
   SlotRange slot_range_;
   bool to_redis_;
+  engine::Storage *storage_;
+
+  // userKey returns the user key of the subkey, the key of a compact subkey is looked up by its key ID
+  StatusOr<std::string_view> userKey(const InternalKey &ikey);
+  // inSlotRange returns true if the key of the column family belongs to the slot range, or there's no range
+  bool inSlotRange(uint32_t column_family_id, const Slice &key);
+  // appendCommand serializes the command to RESP in place, the arguments are views of the batch
+  // or of temporaries, so no vector of arguments is built for a command
+  void appendCommand(std::string_view ns, std::initializer_list<std::string_view> args, ArgIter rest_begin = {},
+                     ArgIter rest_end = {});
 };
@@ -0,0 +1,286 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "big_key_analyzer.h"
+
+#include <glog/logging.h>
+#include <rocksdb/env.h>
+#include <rocksdb/rate_limiter.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+#include "db_util.h"
+#include "encoding.h"
+#include "scope_exit.h"
+#include "stats/disk_stats.h"
+#include "time_util.h"
+
+namespace {
+
+void EncodeBigKeys(std::string *dst, const std::vector<BigKeyAnalyzer::BigKey> &keys) {
+  PutFixed32(dst, static_cast<uint32_t>(keys.size()));
+  for (const auto &key : keys) {
+    PutSizedString(dst, key.key);
+    PutFixed64(dst, key.elements);
+    PutFixed64(dst, key.bytes);
+  }
+}
+
+bool DecodeBigKeys(rocksdb::Slice *input, std::vector<BigKeyAnalyzer::BigKey> *keys) {
+  uint32_t n = 0;
+  if (!GetFixed32(input, &n)) return false;
+  for (uint32_t i = 0; i < n; i++) {
+    BigKeyAnalyzer::BigKey key;
+    rocksdb::Slice name;
+    if (!GetSizedString(input, &name) || !GetFixed64(input, &key.elements) || !GetFixed64(input, &key.bytes)) {
+      return false;
+    }
+    key.key = name.ToString();
+    keys->emplace_back(std::move(key));
+  }
+  return true;
+}
+
+}  // namespace
+
+Status BigKeyAnalyzer::Load() {
+  std::ifstream input(path_, std::ios::in | std::ios::binary);
+  // Nothing was saved, e.g. no analysis ever ran
+  if (!input.good()) return Status::OK();
+  std::string content((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+  rocksdb::Slice input_slice(content);
+  rocksdb::Slice cursor;
+  uint8_t done = 0;
+  uint64_t start_time = 0, finish_time = 0;
+  std::lock_guard<std::mutex> guard(mu_);
+  if (!GetSizedString(&input_slice, &cursor) || !GetFixed8(&input_slice, &done) || !GetFixed64(&input_slice, &top_n_) ||
+      !GetFixed64(&input_slice, &scanned_keys_) || !GetFixed64(&input_slice, &start_time) ||
+      !GetFixed64(&input_slice, &finish_time)) {
+    return {Status::NotOK, "malformed big keys file " + path_};
+  }
+  cursor_ = cursor.ToString();
+  done_ = done != 0;
+  start_time_ = static_cast<int64_t>(start_time);
+  finish_time_ = static_cast<int64_t>(finish_time);
+
+  top_keys_.clear();
+  while (!input_slice.empty()) {
+    rocksdb::Slice ns;
+    uint8_t type = 0;
+    if (!GetSizedString(&input_slice, &ns) || !GetFixed8(&input_slice, &type)) {
+      return {Status::NotOK, "malformed big keys file " + path_};
+    }
+    auto &top_keys = top_keys_[ns.ToString()][static_cast<RedisType>(type)];
+    if (!DecodeBigKeys(&input_slice, &top_keys.by_elements) || !DecodeBigKeys(&input_slice, &top_keys.by_bytes)) {
+      return {Status::NotOK, "malformed big keys file " + path_};
+    }
+  }
+  return Status::OK();
+}
+
+Status BigKeyAnalyzer::Run(size_t top_n) {
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    if (done_ || top_n != top_n_ || cursor_.empty()) {
+      cursor_.clear();
+      done_ = false;
+      top_n_ = top_n;
+      scanned_keys_ = 0;
+      start_time_ = util::GetTimeStamp();
+      finish_time_ = 0;
+      top_keys_.clear();
+    }
+  }
+
+  stop_ = false;
+  running_ = true;
+  ScopeExit se([this] { running_ = false; });
+  LOG(INFO) << "[big keys] Start to analyze the big keys from " << GetScannedKeys() << " scanned keys";
+
+  while (!stop_) {
+    auto read_bytes = analyzeBatch();
+    if (!read_bytes) return std::move(read_bytes);
+    GET_OR_RET(save());
+    if (IsDone()) {
+      LOG(INFO) << "[big keys] The big keys are analyzed, " << GetScannedKeys() << " keys are scanned";
+      break;
+    }
+
+    // Charged after the batch is done, the rate limiter mustn't block the DB from closing
+    if (auto rate_limiter = storage_->GetIORateLimiter()) {
+      for (auto left = *read_bytes; left > 0;) {
+        auto bytes = std::min(left, rate_limiter->GetSingleBurstBytes());
+        rate_limiter->Request(bytes, rocksdb::Env::IOPriority::IO_LOW, nullptr);
+        left -= bytes;
+      }
+    }
+  }
+  return Status::OK();
+}
+
+Status BigKeyAnalyzer::Reset() {
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    cursor_.clear();
+    done_ = false;
+    scanned_keys_ = 0;
+    start_time_ = 0;
+    finish_time_ = 0;
+    top_keys_.clear();
+  }
+  if (std::remove(path_.c_str()) < 0 && errno != ENOENT) {
+    return {Status::NotOK, "failed to remove " + path_};
+  }
+  return Status::OK();
+}
+
+bool BigKeyAnalyzer::IsDone() const {
+  std::lock_guard<std::mutex> guard(mu_);
+  return done_;
+}
+
+uint64_t BigKeyAnalyzer::GetScannedKeys() const {
+  std::lock_guard<std::mutex> guard(mu_);
+  return scanned_keys_;
+}
+
+int64_t BigKeyAnalyzer::GetStartTime() const {
+  std::lock_guard<std::mutex> guard(mu_);
+  return start_time_;
+}
+
+int64_t BigKeyAnalyzer::GetFinishTime() const {
+  std::lock_guard<std::mutex> guard(mu_);
+  return finish_time_;
+}
+
+BigKeyAnalyzer::TypeTopKeys BigKeyAnalyzer::GetTopKeys(const std::string &ns) const {
+  std::lock_guard<std::mutex> guard(mu_);
+  auto iter = top_keys_.find(ns);
+  if (iter == top_keys_.end()) return {};
+  return iter->second;
+}
+
+StatusOr<int64_t> BigKeyAnalyzer::analyzeBatch() {
+  std::string cursor;
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    cursor = cursor_;
+  }
+
+  auto guard = storage_->ReadLockGuard();
+  if (storage_->IsClosing()) return {Status::NotOK, "storage is closing"};
+
+  auto ctx = engine::Context::NoTransactionContext(storage_);
+  auto read_options = ctx.DefaultScanOptions();
+  // The scan mustn't evict the hot blocks from the block cache
+  read_options.fill_cache = false;
+  auto iter = util::UniqueIterator(ctx, read_options, ColumnFamilyID::Metadata);
+  iter->Seek(cursor);
+  if (iter->Valid() && iter->key() == cursor) iter->Next();
+
+  struct AnalyzedKey {
+    std::string ns;
+    RedisType type;
+    BigKey key;
+  };
+  std::vector<AnalyzedKey> keys;
+  redis::Disk disk(storage_, "");
+  int64_t read_bytes = 0;
+  size_t n = 0;
+  for (; iter->Valid() && n < kBatchKeys; iter->Next(), n++) {
+    cursor = iter->key().ToString();
+    read_bytes += static_cast<int64_t>(iter->key().size() + iter->value().size());
+
+    Metadata metadata(kRedisNone, false);
+    if (!metadata.Decode(iter->value()).ok() || metadata.Expired()) continue;
+    auto [ns, user_key] = ExtractNamespaceKey(iter->key(), storage_->IsSlotIdEncoded());
+    uint64_t bytes = iter->key().size() + iter->value().size();
+    auto s = disk.GetSubkeysSize(ctx, iter->key(), metadata, 0, &bytes);
+    if (!s.ok()) return {Status::NotOK, s.ToString()};
+    keys.push_back({ns.ToString(), metadata.Type(), {user_key.ToString(), metadata.size, bytes}});
+  }
+  if (!iter->status().ok()) return {Status::NotOK, iter->status().ToString()};
+  bool done = !iter->Valid();
+
+  std::lock_guard<std::mutex> lg(mu_);
+  for (auto &key : keys) {
+    addKey(key.ns, key.type, std::move(key.key));
+  }
+  cursor_ = std::move(cursor);
+  scanned_keys_ += n;
+  if (done) {
+    done_ = true;
+    finish_time_ = util::GetTimeStamp();
+  }
+  return read_bytes;
+}
+
+void BigKeyAnalyzer::addKey(const std::string &ns, RedisType type, BigKey key) {
+  auto insert = [this](std::vector<BigKey> *keys, const BigKey &key, uint64_t BigKey::*field) {
+    auto pos = std::upper_bound(keys->begin(), keys->end(), key,
+                                [field](const BigKey &lhs, const BigKey &rhs) { return lhs.*field > rhs.*field; });
+    if (static_cast<uint64_t>(pos - keys->begin()) >= top_n_) return;
+    keys->insert(pos, key);
+    if (keys->size() > top_n_) keys->pop_back();
+  };
+
+  auto &top_keys = top_keys_[ns][type];
+  insert(&top_keys.by_elements, key, &BigKey::elements);
+  insert(&top_keys.by_bytes, key, &BigKey::bytes);
+}
+
+Status BigKeyAnalyzer::save() const {
+  std::string content;
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    PutSizedString(&content, cursor_);
+    PutFixed8(&content, done_ ? 1 : 0);
+    PutFixed64(&content, top_n_);
+    PutFixed64(&content, scanned_keys_);
+    PutFixed64(&content, static_cast<uint64_t>(start_time_));
+    PutFixed64(&content, static_cast<uint64_t>(finish_time_));
+    for (const auto &[ns, type_top_keys] : top_keys_) {
+      for (const auto &[type, top_keys] : type_top_keys) {
+        PutSizedString(&content, ns);
+        PutFixed8(&content, type);
+        EncodeBigKeys(&content, top_keys.by_elements);
+        EncodeBigKeys(&content, top_keys.by_bytes);
+      }
+    }
+  }
+
+  // Write to a temporary file first, so a crash can't leave a truncated file
+  std::string tmp_path = path_ + ".tmp";
+  std::ofstream output(tmp_path, std::ios::out | std::ios::trunc | std::ios::binary);
+  if (!output.good()) return {Status::NotOK, "failed to open " + tmp_path};
+  output.write(content.data(), static_cast<std::streamsize>(content.size()));
+  output.close();
+  if (!output.good()) return {Status::NotOK, "failed to write " + tmp_path};
+  if (std::rename(tmp_path.c_str(), path_.c_str()) < 0) {
+    return {Status::NotOK, "failed to rename " + tmp_path};
+  }
+  return Status::OK();
+}
@@ -0,0 +1,102 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "status.h"
+#include "storage/redis_metadata.h"
+#include "storage/storage.h"
+
+// BigKeyAnalyzer walks the metadata column family in the background and keeps the biggest keys
+// of each namespace and type, by the number of elements and by the approximate size.
+//
+// The keys are read in batches without filling the block cache, and the reads are charged to
+// the I/O rate limiter. The size of a key is its metadata plus the approximate size of its
+// subkeys, which is taken from the SST files and the memtables without reading them. The cursor
+// and the results are saved to a file after each batch, so an analysis interrupted by STOP or a
+// restart resumes from where it stopped.
+class BigKeyAnalyzer {
+ public:
+  static constexpr size_t kBatchKeys = 1024;
+  static constexpr size_t kDefaultTopKeys = 10;
+
+  struct BigKey {
+    std::string key;
+    uint64_t elements = 0;
+    uint64_t bytes = 0;
+  };
+
+  // The biggest keys of a type, in descending order
+  struct TopKeys {
+    std::vector<BigKey> by_elements;
+    std::vector<BigKey> by_bytes;
+  };
+  using TypeTopKeys = std::map<RedisType, TopKeys>;
+
+  BigKeyAnalyzer(engine::Storage *storage, std::string path) : storage_(storage), path_(std::move(path)) {}
+
+  BigKeyAnalyzer(const BigKeyAnalyzer &) = delete;
+  BigKeyAnalyzer &operator=(const BigKeyAnalyzer &) = delete;
+
+  // Load reads the state saved by the last run, it's fine if nothing was saved
+  Status Load();
+  // Run continues the unfinished analysis, or starts a new one if the last one is finished or
+  // kept a different number of keys
+  Status Run(size_t top_n);
+  void Stop() { stop_ = true; }
+  // Reset drops the results and the cursor, it mustn't be called while running
+  Status Reset();
+
+  bool IsRunning() const { return running_.load(std::memory_order_relaxed); }
+  bool IsDone() const;
+  uint64_t GetScannedKeys() const;
+  int64_t GetStartTime() const;
+  int64_t GetFinishTime() const;
+  TypeTopKeys GetTopKeys(const std::string &ns) const;
+
+ private:
+  engine::Storage *storage_;
+  std::string path_;
+
+  std::atomic<bool> stop_ = false;
+  std::atomic<bool> running_ = false;
+
+  mutable std::mutex mu_;
+  // the last analyzed metadata key, empty before the first batch
+  std::string cursor_;
+  bool done_ = false;
+  uint64_t top_n_ = kDefaultTopKeys;
+  uint64_t scanned_keys_ = 0;
+  int64_t start_time_ = 0;
+  int64_t finish_time_ = 0;
+  std::map<std::string, TypeTopKeys> top_keys_;
+
+  // analyzeBatch analyzes the keys after the cursor, and returns the number of bytes read
+  StatusOr<int64_t> analyzeBatch();
+  void addKey(const std::string &ns, RedisType type, BigKey key);
+  Status save() const;
+};
@@ -0,0 +1,161 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+#include "cache_warmup.h"
+
+#include <glog/logging.h>
+#include <rocksdb/env.h>
+#include <rocksdb/rate_limiter.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <set>
+
+#include "db_util.h"
+#include "encoding.h"
+#include "storage.h"
+#include "time_util.h"
+
+namespace engine {
+
+// The number of keys read by one MultiGet
+constexpr size_t kWarmupBatchSize = 128;
+// The number of subkeys read from the beginning of each collection
+constexpr int kWarmupSubKeys = 16;
+
+void CacheWarmup::Record(const rocksdb::Slice &ns_key) {
+  thread_local uint32_t counter = 0;
+  if (keys_.empty() || ++counter % kSampleRate != 0) return;
+
+  std::lock_guard<std::mutex> guard(mu_);
+  keys_[next_].assign(ns_key.data(), ns_key.size());
+  next_ = (next_ + 1) % keys_.size();
+}
+
+Status CacheWarmup::Dump() {
+  std::set<std::string> keys;
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    for (const auto &key : keys_) {
+      if (!key.empty()) keys.emplace(key);
+    }
+  }
+
+  std::string content;
+  for (const auto &key : keys) {
+    PutSizedString(&content, key);
+  }
+
+  // Write to a temporary file first, so a crash can't leave a truncated file
+  std::string tmp_path = path_ + ".tmp";
+  std::ofstream output(tmp_path, std::ios::out | std::ios::trunc | std::ios::binary);
+  if (!output.good()) return {Status::NotOK, "failed to open " + tmp_path};
+  output.write(content.data(), static_cast<std::streamsize>(content.size()));
+  output.close();
+  if (!output.good()) return {Status::NotOK, "failed to write " + tmp_path};
+  if (std::rename(tmp_path.c_str(), path_.c_str()) < 0) {
+    return {Status::NotOK, "failed to rename " + tmp_path};
+  }
+  return Status::OK();
+}
+
+Status CacheWarmup::Load(Storage *storage) {
+  std::ifstream input(path_, std::ios::in | std::ios::binary);
+  // Nothing was saved, e.g. on the first start
+  if (!input.good()) return Status::OK();
+  std::string content((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+  std::vector<rocksdb::Slice> ns_keys;
+  rocksdb::Slice input_slice(content);
+  rocksdb::Slice ns_key;
+  while (GetSizedString(&input_slice, &ns_key)) {
+    ns_keys.emplace_back(ns_key);
+  }
+
+  loading_ = true;
+  total_keys_ = ns_keys.size();
+  loaded_keys_ = 0;
+  auto start = util::GetTimeStampMS();
+  for (size_t i = 0; i < ns_keys.size(); i += kWarmupBatchSize) {
+    std::vector<rocksdb::Slice> batch(ns_keys.begin() + static_cast<ptrdiff_t>(i),
+                                      ns_keys.begin() + static_cast<ptrdiff_t>(std::min(i + kWarmupBatchSize,
+                                                                                        ns_keys.size())));
+    auto read_bytes = warmBatch(storage, batch);
+    if (!read_bytes) {
+      loading_ = false;
+      return std::move(read_bytes);
+    }
+    loaded_keys_ += batch.size();
+
+    // Charged after the batch is done, the rate limiter mustn't block the DB from closing
+    if (auto rate_limiter = storage->GetIORateLimiter()) {
+      for (auto left = *read_bytes; left > 0;) {
+        auto bytes = std::min(left, rate_limiter->GetSingleBurstBytes());
+        rate_limiter->Request(bytes, rocksdb::Env::IOPriority::IO_LOW, nullptr);
+        left -= bytes;
+      }
+    }
+  }
+  loading_ = false;
+  LOG(INFO) << "[storage] Warmed up the block cache with " << ns_keys.size() << " keys in "
+            << util::GetTimeStampMS() - start << "ms";
+  return Status::OK();
+}
+
+StatusOr<int64_t> CacheWarmup::warmBatch(Storage *storage, const std::vector<rocksdb::Slice> &ns_keys) {
+  auto guard = storage->ReadLockGuard();
+  if (storage->IsClosing()) return {Status::NotOK, "storage is closing"};
+
+  auto ctx = Context::NoTransactionContext(storage);
+  // The reads go through the block cache, MultiGet reads the blocks of the batch in parallel
+  auto read_options = ctx.DefaultMultiGetOptions();
+  read_options.fill_cache = true;
+  std::vector<rocksdb::PinnableSlice> values(ns_keys.size());
+  std::vector<rocksdb::Status> statuses(ns_keys.size());
+  storage->MultiGet(ctx, read_options, storage->GetCFHandle(ColumnFamilyID::Metadata), ns_keys.size(),
+                    ns_keys.data(), values.data(), statuses.data());
+
+  int64_t read_bytes = 0;
+  auto scan_options = ctx.DefaultScanOptions();
+  scan_options.fill_cache = true;
+  for (size_t i = 0; i < ns_keys.size(); i++) {
+    if (!statuses[i].ok()) continue;
+    read_bytes += static_cast<int64_t>(ns_keys[i].size() + values[i].size());
+
+    Metadata metadata(kRedisNone, false);
+    if (!metadata.Decode(values[i]).ok() || metadata.IsSingleKVType() || metadata.Expired()) continue;
+
+    std::string prefix = InternalKey(ns_keys[i], "", metadata.version, storage->IsSlotIdEncoded()).Encode();
+    std::string next_version_prefix =
+        InternalKey(ns_keys[i], "", metadata.version + 1, storage->IsSlotIdEncoded()).Encode();
+    rocksdb::Slice upper_bound(next_version_prefix);
+    scan_options.iterate_upper_bound = &upper_bound;
+    auto subkey_cf = metadata.Type() == kRedisStream ? ColumnFamilyID::Stream : ColumnFamilyID::PrimarySubkey;
+    auto iter = util::UniqueIterator(ctx, scan_options, subkey_cf);
+    int n = 0;
+    for (iter->Seek(prefix); iter->Valid() && n < kWarmupSubKeys; iter->Next(), n++) {
+      read_bytes += static_cast<int64_t>(iter->key().size() + iter->value().size());
+    }
+  }
+  return read_bytes;
+}
+
+}  // namespace engine
@@ -0,0 +1,74 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+#pragma once
+
+#include <rocksdb/slice.h>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "status.h"
+
+namespace engine {
+
+class Storage;
+
+// CacheWarmup keeps a sample of the recently looked up keys, which is saved to a file
+// periodically and on shutdown. After a restart the metadata of these keys and the first
+// subkeys of their collections are read again in the background, to fill the block cache
+// before the clients hit the cold cache.
+class CacheWarmup {
+ public:
+  // One in kSampleRate metadata lookups is recorded
+  static constexpr uint32_t kSampleRate = 16;
+
+  CacheWarmup(std::string path, size_t capacity) : path_(std::move(path)), keys_(capacity) {}
+
+  void Record(const rocksdb::Slice &ns_key);
+  Status Dump();
+  // Load reads the keys saved by the last Dump and warms up the block cache with them,
+  // the reads are charged to the I/O rate limiter
+  Status Load(Storage *storage);
+
+  uint64_t GetTotalKeys() const { return total_keys_.load(std::memory_order_relaxed); }
+  uint64_t GetLoadedKeys() const { return loaded_keys_.load(std::memory_order_relaxed); }
+  bool IsLoading() const { return loading_.load(std::memory_order_relaxed); }
+
+ private:
+  std::string path_;
+
+  std::mutex mu_;
+  // A ring of the sampled keys, the oldest one is overwritten when it's full
+  std::vector<std::string> keys_;
+  size_t next_ = 0;
+
+  std::atomic<uint64_t> total_keys_ = 0;
+  std::atomic<uint64_t> loaded_keys_ = 0;
+  std::atomic<bool> loading_ = false;
+
+  // warmBatch returns the number of bytes read
+  StatusOr<int64_t> warmBatch(Storage *storage, const std::vector<rocksdb::Slice> &ns_keys);
+};
+
+}  // namespace engine
@@ -22,12 +22,14 @@
 
 #include <glog/logging.h>
 
+#include <algorithm>
 #include <string>
 #include <utility>
 
 #include "db_util.h"
 #include "time_util.h"
 #include "types/redis_bitmap.h"
+#include "types/redis_timeseries.h"
 
 namespace engine {
 
@@ -49,38 +51,72 @@ bool MetadataFilter::Filter([[maybe_unused]] int level, const Slice &key, const
   return metadata.Expired();
 }
 
-Status SubKeyFilter::GetMetadata(const InternalKey &ikey, Metadata *metadata) const {
-  auto db = stor_->GetDB();
-  const auto cf_handles = stor_->GetCFHandles();
-  // storage close the would delete the column family handler and DB
-  if (!db || cf_handles->size() < 2) return {Status::NotOK, "storage is closed"};
-  std::string metadata_key = ComposeNamespaceKey(ikey.GetNamespace(), ikey.GetKey(), stor_->IsSlotIdEncoded());
+SubKeyFilter::~SubKeyFilter() {
+  stor_->RecordStat(StatType::CompactionFilterCacheHits, cache_hits_);
+  stor_->RecordStat(StatType::CompactionFilterCacheMisses, cache_misses_);
+}
+
+Status SubKeyFilter::GetMetadata(const InternalKey &ikey, Metadata *metadata, uint64_t *retain_from) const {
+  uint64_t staged_generation = stor_->GetStagedGeneration();
+  auto iter = std::find_if(cached_metadata_.begin(), cached_metadata_.end(), [&ikey](const CachedMetadata &cached) {
+    if (ikey.GetNamespace() != cached.ns) return false;
+    return ikey.IsCompact() ? ikey.GetVersion() == cached.key_id : ikey.GetKey() == cached.key;
+  });
+  // the metadata cached before a staged version was written may be stale
+  if (iter != cached_metadata_.end() && iter->staged_generation != staged_generation) {
+    cached_metadata_.erase(iter);
+    iter = cached_metadata_.end();
+  }
+  if (iter != cached_metadata_.end()) {
+    cache_hits_++;
+    std::rotate(cached_metadata_.begin(), iter, iter + 1);
+  } else {
+    auto db = stor_->GetDB();
+    const auto cf_handles = stor_->GetCFHandles();
+    // storage close the would delete the column family handler and DB
+    if (!db || cf_handles->size() < 2) return {Status::NotOK, "storage is closed"};
 
-  if (cached_key_.empty() || metadata_key != cached_key_) {
+    cache_misses_++;
+    CachedMetadata cached{ikey.GetNamespace().ToString(), ikey.GetKey().ToString()};
+    cached.staged_generation = staged_generation;
+    rocksdb::Status s;
+    if (ikey.IsCompact()) {
+      // the key of a compact subkey is looked up by its key ID first
+      auto key_id_cf = static_cast<size_t>(ColumnFamilyID::KeyID);
+      if (cf_handles->size() <= key_id_cf) return {Status::NotOK, "storage is closed"};
+      cached.key_id = ikey.GetVersion();
+      s = db->Get(rocksdb::ReadOptions(), (*cf_handles)[key_id_cf], ikey.EncodePrefix(), &cached.key);
+    }
     std::string bytes;
-    rocksdb::Status s = db->Get(rocksdb::ReadOptions(), (*cf_handles)[1], metadata_key, &bytes);
-    cached_key_ = std::move(metadata_key);
     if (s.ok()) {
-      cached_metadata_ = std::move(bytes);
-    } else if (s.IsNotFound()) {
-      // metadata was deleted(perhaps compaction or manual)
-      // clear the metadata
-      cached_metadata_.clear();
-      return {Status::NotFound, "metadata is not found"};
-    } else {
-      cached_key_.clear();
-      cached_metadata_.clear();
+      std::string metadata_key = ComposeNamespaceKey(ikey.GetNamespace(), cached.key, stor_->IsSlotIdEncoded());
+      s = db->Get(rocksdb::ReadOptions(), (*cf_handles)[1], metadata_key, &bytes);
+    }
+    if (s.ok()) {
+      if (auto decode_s = cached.metadata.Decode(bytes); !decode_s.ok()) {
+        return {Status::NotOK, "decode error: " + decode_s.ToString()};
+      }
+      if (cached.metadata.Type() == kRedisTimeSeries) {
+        TimeSeriesMetadata ts_metadata(false);
+        if (auto decode_s = ts_metadata.Decode(bytes); !decode_s.ok()) {
+          return {Status::NotOK, "decode error: " + decode_s.ToString()};
+        }
+        cached.retain_from = ts_metadata.RetainFrom();
+      }
+      cached.found = true;
+    } else if (!s.IsNotFound()) {
       return {Status::NotOK, "fetch error: " + s.ToString()};
     }
+    // else the metadata was deleted (perhaps compaction or manual)
+
+    if (cached_metadata_.size() >= kMetadataCacheSize) cached_metadata_.pop_back();
+    cached_metadata_.insert(cached_metadata_.begin(), std::move(cached));
   }
-  // the metadata was not found
-  if (cached_metadata_.empty()) return {Status::NotFound, "metadata is not found"};
-  // the metadata is cached
-  rocksdb::Status s = metadata->Decode(cached_metadata_);
-  if (!s.ok()) {
-    cached_key_.clear();
-    return {Status::NotOK, "decode error: " + s.ToString()};
-  }
+
+  const auto &cached = cached_metadata_.front();
+  if (!cached.found) return {Status::NotFound, "metadata is not found"};
+  *metadata = cached.metadata;
+  if (retain_from) *retain_from = cached.retain_from;
   return Status::OK();
 }
 
@@ -99,6 +135,10 @@ rocksdb::CompactionFilter::Decision SubKeyFilter::FilterBlobByKey([[maybe_unused
                                                                   [[maybe_unused]] std::string *new_value,
                                                                   [[maybe_unused]] std::string *skip_until) const {
   InternalKey ikey(key, stor_->IsSlotIdEncoded());
+  // the staged versions are checked before the metadata is read, see Storage::RemoveStagedVersion
+  if (stor_->IsStagedVersion(ikey.GetVersion())) {
+    return rocksdb::CompactionFilter::Decision::kKeep;
+  }
   Metadata metadata(kRedisNone, false);
   Status s = GetMetadata(ikey, &metadata);
   if (s.Is<Status::NotFound>()) {
@@ -109,8 +149,8 @@ rocksdb::CompactionFilter::Decision SubKeyFilter::FilterBlobByKey([[maybe_unused
                << ", namespace: " << ikey.GetNamespace() << ", key: " << ikey.GetKey() << ", err: " << s.Msg();
     return rocksdb::CompactionFilter::Decision::kKeep;
   }
-  // bitmap will be checked in Filter
-  if (metadata.Type() == kRedisBitmap) {
+  // bitmap and time series will be checked in Filter
+  if (metadata.Type() == kRedisBitmap || metadata.Type() == kRedisTimeSeries) {
     return rocksdb::CompactionFilter::Decision::kUndetermined;
   }
 
@@ -121,8 +161,10 @@ rocksdb::CompactionFilter::Decision SubKeyFilter::FilterBlobByKey([[maybe_unused
 bool SubKeyFilter::Filter([[maybe_unused]] int level, const Slice &key, const Slice &value,
                           [[maybe_unused]] std::string *new_value, [[maybe_unused]] bool *modified) const {
   InternalKey ikey(key, stor_->IsSlotIdEncoded());
+  if (stor_->IsStagedVersion(ikey.GetVersion())) return false;
   Metadata metadata(kRedisNone, false);
-  Status s = GetMetadata(ikey, &metadata);
+  uint64_t retain_from = 0;
+  Status s = GetMetadata(ikey, &metadata, &retain_from);
   if (s.Is<Status::NotFound>()) {
     return true;
   }
@@ -131,8 +173,28 @@ bool SubKeyFilter::Filter([[maybe_unused]] int level, const Slice &key, const Sl
                << ", namespace: " << ikey.GetNamespace() << ", key: " << ikey.GetKey() << ", err: " << s.Msg();
     return false;
   }
+  // the size of a time series isn't changed here, the chunks out of the retention are deleted by the add which
+  // moves the retention with their samples subtracted, so the filter never drops the samples the size counts
+  return IsMetadataExpired(ikey, metadata) ||
+         (metadata.Type() == kRedisBitmap && redis::Bitmap::IsEmptySegment(value)) ||
+         (metadata.Type() == kRedisTimeSeries && redis::TimeSeries::IsChunkOutOfRetention(value, retain_from));
+}
 
-  return IsMetadataExpired(ikey, metadata) || (metadata.Type() == kRedisBitmap && redis::Bitmap::IsEmptySegment(value));
+bool KeyIDFilter::Filter([[maybe_unused]] int level, const Slice &key, [[maybe_unused]] const Slice &value,
+                         [[maybe_unused]] std::string *new_value, [[maybe_unused]] bool *modified) const {
+  InternalKey ikey(key, stor_->IsSlotIdEncoded());
+  if (stor_->IsStagedVersion(ikey.GetVersion())) return false;
+  Metadata metadata(kRedisNone, false);
+  Status s = GetMetadata(ikey, &metadata);
+  if (s.Is<Status::NotFound>()) {
+    return true;
+  }
+  if (!s.IsOK()) {
+    LOG(ERROR) << "[compact_filter/key_id] Failed to get metadata"
+               << ", namespace: " << ikey.GetNamespace() << ", key ID: " << ikey.GetVersion() << ", err: " << s.Msg();
+    return false;
+  }
+  return IsMetadataExpired(ikey, metadata);
 }
 
 }  // namespace engine
@@ -58,17 +58,38 @@ class MetadataFilterFactory : public rocksdb::CompactionFilterFactory {
 class SubKeyFilter : public rocksdb::CompactionFilter {
  public:
   explicit SubKeyFilter(Storage *storage) : stor_(storage) {}
+  ~SubKeyFilter() override;
 
   const char *Name() const override { return "SubkeyFilter"; }
-  Status GetMetadata(const InternalKey &ikey, Metadata *metadata) const;
+  /// Get the metadata of the subkey, and the timestamp before which the chunks of a time series
+  /// are out of the retention to retain_from if it's not null.
+  Status GetMetadata(const InternalKey &ikey, Metadata *metadata, uint64_t *retain_from = nullptr) const;
   static bool IsMetadataExpired(const InternalKey &ikey, const Metadata &metadata);
   rocksdb::CompactionFilter::Decision FilterBlobByKey(int level, const Slice &key, std::string *new_value,
                                                       std::string *skip_until) const override;
   bool Filter(int level, const Slice &key, const Slice &value, std::string *new_value, bool *modified) const override;
 
  protected:
-  mutable std::string cached_key_;
-  mutable std::string cached_metadata_;
+  // Subkeys come sorted, so most lookups are for the last seen key. A few more
+  // recent keys are kept as well, in the order of last use.
+  static constexpr size_t kMetadataCacheSize = 8;
+
+  struct CachedMetadata {
+    std::string ns;
+    std::string key;
+    // the version of the compact subkeys, which is looked up instead of the key
+    uint64_t key_id = 0;
+    bool found = false;
+    Metadata metadata{kRedisNone, false};
+    uint64_t retain_from = 0;
+    // the staged generation of the storage before the metadata was read
+    uint64_t staged_generation = 0;
+  };
+
+  mutable std::vector<CachedMetadata> cached_metadata_;
+  // lookups served by the cache and read from the DB during this compaction job
+  mutable uint64_t cache_hits_ = 0;
+  mutable uint64_t cache_misses_ = 0;
   engine::Storage *stor_;
 };
 
@@ -86,6 +107,30 @@ class SubKeyFilterFactory : public rocksdb::CompactionFilterFactory {
   engine::Storage *stor_ = nullptr;
 };
 
+// KeyIDFilter drops the entries of the key ID column family whose keys are deleted, expired or have a new version,
+// their compact subkeys are dropped by SubKeyFilter at the same time.
+class KeyIDFilter : public SubKeyFilter {
+ public:
+  explicit KeyIDFilter(Storage *storage) : SubKeyFilter(storage) {}
+
+  const char *Name() const override { return "KeyIDFilter"; }
+  bool Filter(int level, const Slice &key, const Slice &value, std::string *new_value, bool *modified) const override;
+};
+
+class KeyIDFilterFactory : public rocksdb::CompactionFilterFactory {
+ public:
+  explicit KeyIDFilterFactory(engine::Storage *storage) : stor_(storage) {}
+
+  const char *Name() const override { return "KeyIDFilterFactory"; }
+  std::unique_ptr<rocksdb::CompactionFilter> CreateCompactionFilter(
+      [[maybe_unused]] const rocksdb::CompactionFilter::Context &context) override {
+    return std::unique_ptr<rocksdb::CompactionFilter>(new KeyIDFilter(stor_));
+  }
+
+ private:
+  engine::Storage *stor_ = nullptr;
+};
+
 class PropagateFilter : public rocksdb::CompactionFilter {
  public:
   const char *Name() const override { return "PropagateFilter"; }
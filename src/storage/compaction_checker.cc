@@ -22,6 +22,8 @@
 
 #include <glog/logging.h>
 
+#include <algorithm>
+
 #include "parse_util.h"
 #include "storage.h"
 #include "time_util.h"
@@ -42,6 +44,8 @@ void CompactionChecker::CompactPropagateAndPubSubFiles() {
 void CompactionChecker::PickCompactionFilesForCf(const engine::ColumnFamilyConfig &column_family_config) {
   rocksdb::TablePropertiesCollection props;
   rocksdb::ColumnFamilyHandle *cf = storage_->GetCFHandle(column_family_config.Id());
+  compactHintedRanges(column_family_config.Id(), cf);
+
   auto s = storage_->GetDB()->GetPropertiesOfAllTables(cf, &props);
   if (!s.ok()) {
     LOG(WARNING) << "[compaction checker] Failed to get table properties, " << s.ToString();
@@ -52,20 +56,27 @@ void CompactionChecker::PickCompactionFilesForCf(const engine::ColumnFamilyConfi
   // the live files was too few, Hard code to 1 here.
   if (props.size() <= 1) return;
 
+  std::vector<rocksdb::LiveFileMetaData> live_files;
+  storage_->GetDB()->GetLiveFilesMetaData(&live_files);
+  live_files.erase(std::remove_if(live_files.begin(), live_files.end(),
+                                  [&](const rocksdb::LiveFileMetaData &file) {
+                                    return file.column_family_name != column_family_config.Name();
+                                  }),
+                   live_files.end());
+
   size_t max_files_to_compact = 1;
   if (props.size() / 360 > max_files_to_compact) {
     max_files_to_compact = props.size() / 360;
   }
   int64_t now = util::GetTimeStamp();
 
-  auto force_compact_file_age = storage_->GetConfig()->force_compact_file_age;
-  auto force_compact_min_ratio =
-      static_cast<double>(storage_->GetConfig()->force_compact_file_min_deleted_percentage) / 100.0;
+  const auto *config = storage_->GetConfig();
+  auto force_compact_file_age = config->force_compact_file_age;
+  auto force_compact_min_ratio = static_cast<double>(config->force_compact_file_min_deleted_percentage) / 100.0;
 
-  std::string best_filename;
-  double best_delete_ratio = 0;
+  std::vector<CompactionCandidate> candidates;
   int64_t total_keys = 0, deleted_keys = 0;
-  rocksdb::Slice start_key, stop_key, best_start_key, best_stop_key;
+  rocksdb::Slice start_key, stop_key;
   for (const auto &iter : props) {
     if (max_files_to_compact == 0) return;
 
@@ -113,32 +124,108 @@ void CompactionChecker::PickCompactionFilesForCf(const engine::ColumnFamilyConfi
     if (file_creation_time < static_cast<uint64_t>(now - force_compact_file_age) &&
         delete_ratio >= force_compact_min_ratio) {
       LOG(INFO) << "[compaction checker] Going to compact the key in file (force compact policy): " << iter.first;
-      auto s = storage_->Compact(cf, &start_key, &stop_key);
+      auto s = compactAndRecord(cf, start_key, stop_key);
       LOG(INFO) << "[compaction checker] Compact the key in file (force compact policy): " << iter.first
                 << " finished, result: " << s.ToString();
       max_files_to_compact--;
+      start_key.clear();
+      stop_key.clear();
       continue;
     }
 
     // don't compact the SST created in 1 hour
     if (file_creation_time > static_cast<uint64_t>(now - 3600)) continue;
+    if (total_keys == 0 || delete_ratio <= 0.1) continue;
 
-    // pick the file which has highest delete ratio
-    if (total_keys != 0 && delete_ratio > best_delete_ratio) {
-      best_delete_ratio = delete_ratio;
-      best_filename = iter.first;
-      best_start_key = start_key;
-      start_key.clear();
-      best_stop_key = stop_key;
-      stop_key.clear();
+    // score the file by the bytes it would reclaim per byte of compaction I/O,
+    // the I/O includes the files of the next level which overlap with it
+    auto file = std::find_if(live_files.begin(), live_files.end(), [&](const rocksdb::LiveFileMetaData &file) {
+      return file.db_path + file.name == iter.first;
+    });
+    uint64_t file_size = iter.second->data_size + iter.second->index_size + iter.second->filter_size;
+    uint64_t io_bytes = file_size;
+    if (file != live_files.end()) {
+      file_size = file->size;
+      io_bytes = file_size + overlappingBytes(live_files, file->level + 1, file->smallestkey, file->largestkey);
     }
+    auto reclaimable_bytes = static_cast<uint64_t>(static_cast<double>(file_size) * delete_ratio);
+    candidates.push_back({iter.first, start_key.ToString(), stop_key.ToString(), reclaimable_bytes,
+                          std::max<uint64_t>(io_bytes, 1)});
+    start_key.clear();
+    stop_key.clear();
   }
-  if (best_delete_ratio > 0.1 && !best_start_key.empty() && !best_stop_key.empty()) {
-    LOG(INFO) << "[compaction checker] Going to compact the key in file: " << best_filename
-              << ", delete ratio: " << best_delete_ratio;
-    auto s = storage_->Compact(cf, &best_start_key, &best_stop_key);
+
+  std::sort(candidates.begin(), candidates.end(), [](const CompactionCandidate &a, const CompactionCandidate &b) {
+    return a.Score() > b.Score();
+  });
+
+  // compact the worst files first, until the I/O budget or the time limit is used up,
+  // the best file is always compacted as before
+  uint64_t io_budget = static_cast<uint64_t>(config->compaction_checker_io_budget) * MiB;
+  int64_t deadline = now + config->compaction_checker_time_limit;
+  uint64_t used_io_bytes = 0;
+  for (size_t i = 0; i < candidates.size(); i++) {
+    const auto &candidate = candidates[i];
+    if (i > 0 && (used_io_bytes + candidate.io_bytes > io_budget || util::GetTimeStamp() >= deadline)) break;
+
+    LOG(INFO) << "[compaction checker] Going to compact the key in file: " << candidate.filename
+              << ", reclaimable bytes: " << candidate.reclaimable_bytes << ", io bytes: " << candidate.io_bytes;
+    auto s = compactAndRecord(cf, candidate.start_key, candidate.stop_key);
     if (!s.ok()) {
       LOG(ERROR) << "[compaction checker] Failed to do compaction: " << s.ToString();
+      break;
+    }
+    used_io_bytes += candidate.io_bytes;
+  }
+}
+
+void CompactionChecker::compactHintedRanges(ColumnFamilyID cf_id, rocksdb::ColumnFamilyHandle *cf) {
+  auto hints = storage_->TakeCompactionHints(cf_id);
+  if (hints.empty()) return;
+
+  int64_t deadline = util::GetTimeStamp() + storage_->GetConfig()->compaction_checker_time_limit;
+  for (size_t i = 0; i < hints.size(); i++) {
+    // the ranges which are out of time are kept for the next round
+    if (util::GetTimeStamp() >= deadline) {
+      for (; i < hints.size(); i++) {
+        storage_->AddCompactionHint(cf_id, std::move(hints[i].first), std::move(hints[i].second));
+      }
+      break;
     }
+
+    LOG(INFO) << "[compaction checker] Going to compact the hinted range, column family: "
+              << static_cast<uint32_t>(cf_id);
+    auto s = compactAndRecord(cf, hints[i].first, hints[i].second);
+    if (!s.ok()) {
+      LOG(ERROR) << "[compaction checker] Failed to compact the hinted range: " << s.ToString();
+      break;
+    }
+  }
+}
+
+uint64_t CompactionChecker::overlappingBytes(const std::vector<rocksdb::LiveFileMetaData> &files, int level,
+                                             const std::string &smallest_key, const std::string &largest_key) {
+  uint64_t bytes = 0;
+  for (const auto &file : files) {
+    if (file.level != level) continue;
+    if (file.largestkey < smallest_key || file.smallestkey > largest_key) continue;
+    bytes += file.size;
+  }
+  return bytes;
+}
+
+rocksdb::Status CompactionChecker::compactAndRecord(rocksdb::ColumnFamilyHandle *cf, const rocksdb::Slice &start_key,
+                                                    const rocksdb::Slice &stop_key) {
+  uint64_t size_before = 0, size_after = 0;
+  auto db = storage_->GetDB();
+  db->GetIntProperty(cf, rocksdb::DB::Properties::kTotalSstFilesSize, &size_before);
+  auto s = storage_->Compact(cf, &start_key, &stop_key);
+  if (!s.ok()) return s;
+
+  db->GetIntProperty(cf, rocksdb::DB::Properties::kTotalSstFilesSize, &size_after);
+  if (size_before > size_after) {
+    LOG(INFO) << "[compaction checker] Reclaimed " << size_before - size_after << " bytes";
+    storage_->RecordStat(engine::StatType::CompactionCheckerReclaimedBytes, size_before - size_after);
   }
+  return s;
 }
@@ -34,5 +34,25 @@ class CompactionChecker {
   void CompactPropagateAndPubSubFiles();
 
  private:
+  struct CompactionCandidate {
+    std::string filename;
+    std::string start_key;
+    std::string stop_key;
+    uint64_t reclaimable_bytes;
+    uint64_t io_bytes;
+
+    double Score() const { return static_cast<double>(reclaimable_bytes) / static_cast<double>(io_bytes); }
+  };
+
+  // compactHintedRanges compacts the ranges removed by DeleteRange, whose tombstones aren't counted by the
+  // table properties, and the runs of expired metadata, within the time limit of the compaction checker
+  void compactHintedRanges(ColumnFamilyID cf_id, rocksdb::ColumnFamilyHandle *cf);
+  // overlappingBytes returns the total size of the files in the level which overlap with the key range
+  static uint64_t overlappingBytes(const std::vector<rocksdb::LiveFileMetaData> &files, int level,
+                                   const std::string &smallest_key, const std::string &largest_key);
+  // compactAndRecord compacts the key range and records the bytes reclaimed from the column family
+  rocksdb::Status compactAndRecord(rocksdb::ColumnFamilyHandle *cf, const rocksdb::Slice &start_key,
+                                   const rocksdb::Slice &stop_key);
+
   engine::Storage *storage_ = nullptr;
 };
@@ -24,6 +24,7 @@
 #include <vector>
 
 #include "fmt/format.h"
+#include "thread_util.h"
 
 std::string BackgroundErrorReason2String(const rocksdb::BackgroundErrorReason reason) {
   std::vector<std::string> background_error_reason = {
@@ -43,11 +44,16 @@ std::string FileCreatedReason2String(const rocksdb::TableFileCreationReason reas
 }
 
 std::string StallConditionType2String(const rocksdb::WriteStallCondition type) {
-  std::vector<std::string> stall_condition_strings = {"normal", "delay", "stop"};
-  if (static_cast<size_t>(type) < stall_condition_strings.size()) {
-    return stall_condition_strings[static_cast<size_t>(type)];
+  switch (type) {
+    case rocksdb::WriteStallCondition::kNormal:
+      return "normal";
+    case rocksdb::WriteStallCondition::kDelayed:
+      return "delay";
+    case rocksdb::WriteStallCondition::kStopped:
+      return "stop";
+    default:
+      return "unknown";
   }
-  return "unknown";
 }
 
 std::string CompressType2String(const rocksdb::CompressionType type) {
@@ -75,7 +81,18 @@ bool IsDiskQuotaExceeded(const rocksdb::Status &bg_error) {
   return err_msg.find(exceeded_quota_str) != std::string::npos;
 }
 
+void EventListener::pinBackgroundThread() const {
+  thread_local bool pinned = false;
+  if (pinned) return;
+  pinned = true;
+
+  if (auto s = util::ThreadSetAffinity(storage_->GetConfig()->rocks_db.background_cpus); !s) {
+    LOG(WARNING) << "[event_listener] Failed to pin the background thread: " << s.Msg();
+  }
+}
+
 void EventListener::OnCompactionBegin([[maybe_unused]] rocksdb::DB *db, const rocksdb::CompactionJobInfo &ci) {
+  pinBackgroundThread();
   LOG(INFO) << "[event_listener/compaction_begin] column family: " << ci.cf_name << ", job_id: " << ci.job_id
             << ", compaction reason: " << rocksdb::GetCompactionReasonString(ci.compaction_reason)
             << ", output compression type: " << CompressType2String(ci.compression)
@@ -99,6 +116,7 @@ void EventListener::OnCompactionCompleted([[maybe_unused]] rocksdb::DB *db, cons
 }
 
 void EventListener::OnSubcompactionBegin(const rocksdb::SubcompactionJobInfo &si) {
+  pinBackgroundThread();
   LOG(INFO) << "[event_listener/subcompaction_begin] column family: " << si.cf_name << ", job_id: " << si.job_id
             << ", compaction reason: " << rocksdb::GetCompactionReasonString(si.compaction_reason)
             << ", output compression type: " << CompressType2String(si.compression);
@@ -115,6 +133,7 @@ void EventListener::OnSubcompactionCompleted(const rocksdb::SubcompactionJobInfo
 }
 
 void EventListener::OnFlushBegin([[maybe_unused]] rocksdb::DB *db, const rocksdb::FlushJobInfo &fi) {
+  pinBackgroundThread();
   LOG(INFO) << "[event_listener/flush_begin] column family: " << fi.cf_name << ", thread_id: " << fi.thread_id
             << ", job_id: " << fi.job_id << ", reason: " << rocksdb::GetFlushReasonString(fi.flush_reason);
 }
@@ -171,6 +190,7 @@ void EventListener::OnStallConditionsChanged(const rocksdb::WriteStallInfo &info
   LOG(WARNING) << "[event_listener/stall_cond_changed] column family: " << info.cf_name
                << " write stall condition was changed, from " << StallConditionType2String(info.condition.prev)
                << " to " << StallConditionType2String(info.condition.cur);
+  storage_->SetWriteStallCondition(info.cf_name, info.condition.cur);
 }
 
 void EventListener::OnTableFileCreated(const rocksdb::TableFileCreationInfo &info) {
@@ -43,4 +43,8 @@ class EventListener : public rocksdb::EventListener {
 
  private:
   engine::Storage *storage_ = nullptr;
+
+  // pinBackgroundThread pins the current flush or compaction thread to rocksdb.background_cpus once,
+  // since RocksDB has no hook to set up its background threads when they are created
+  void pinBackgroundThread() const;
 };
@@ -0,0 +1,113 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "group_commit.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace engine {
+
+// The serialized WriteBatch starts with a 12 bytes header: 8 bytes sequence number
+// followed by a 4 bytes little-endian record count, see rocksdb/db/write_batch.cc.
+constexpr size_t kWriteBatchHeaderSize = 12;
+constexpr size_t kWriteBatchCountOffset = 8;
+
+void GroupCommitter::MergeBatches(std::string *dst, const rocksdb::WriteBatch &src) {
+  const auto &src_rep = src.Data();
+  if (src_rep.size() <= kWriteBatchHeaderSize) return;
+
+  uint32_t count = 0;
+  for (size_t i = 0; i < sizeof(count); i++) {
+    count |= static_cast<uint32_t>(static_cast<uint8_t>((*dst)[kWriteBatchCountOffset + i])) << (i * 8);
+  }
+  count += src.Count();
+  for (size_t i = 0; i < sizeof(count); i++) {
+    (*dst)[kWriteBatchCountOffset + i] = static_cast<char>((count >> (i * 8)) & 0xff);
+  }
+  dst->append(src_rep, kWriteBatchHeaderSize, std::string::npos);
+}
+
+void GroupCommitter::recordWait(uint64_t us) {
+  stats_.wait_us.fetch_add(us, std::memory_order_relaxed);
+  uint64_t max_wait = stats_.max_wait_us.load(std::memory_order_relaxed);
+  while (us > max_wait && !stats_.max_wait_us.compare_exchange_weak(max_wait, us, std::memory_order_relaxed)) {
+  }
+}
+
+rocksdb::Status GroupCommitter::Write(rocksdb::DB *db, const rocksdb::WriteOptions &options,
+                                      rocksdb::WriteBatch *updates, int max_delay_us, int max_batch_size) {
+  auto start = std::chrono::steady_clock::now();
+  auto max_size = static_cast<size_t>(std::max(max_batch_size, 1));
+
+  Writer self{updates};
+  std::unique_lock<std::mutex> lock(mu_);
+  queue_.push_back(&self);
+  if (queue_.size() >= max_size) leader_cv_.notify_one();
+
+  while (true) {
+    cv_.wait(lock, [&] { return self.done || !leader_active_; });
+    if (self.done) break;
+
+    // No group is being committed and ours is still pending, so this writer leads the next group
+    leader_active_ = true;
+    if (queue_.size() < max_size && max_delay_us > 0) {
+      leader_cv_.wait_for(lock, std::chrono::microseconds(max_delay_us), [&] { return queue_.size() >= max_size; });
+    }
+
+    std::vector<Writer *> group;
+    group.reserve(std::min(queue_.size(), max_size));
+    while (!queue_.empty() && group.size() < max_size) {
+      group.emplace_back(queue_.front());
+      queue_.pop_front();
+    }
+    lock.unlock();
+
+    rocksdb::Status s;
+    if (group.size() == 1) {
+      s = db->Write(options, group.front()->batch);
+    } else {
+      std::string rep = group.front()->batch->Data();
+      for (size_t i = 1; i < group.size(); i++) {
+        MergeBatches(&rep, *group[i]->batch);
+      }
+      rocksdb::WriteBatch merged(rep);
+      s = db->Write(options, &merged);
+    }
+    stats_.groups.fetch_add(1, std::memory_order_relaxed);
+    stats_.batches.fetch_add(group.size(), std::memory_order_relaxed);
+
+    lock.lock();
+    for (auto writer : group) {
+      writer->status = s;
+      writer->done = true;
+    }
+    leader_active_ = false;
+    cv_.notify_all();
+  }
+  lock.unlock();
+
+  recordWait(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+  return self.status;
+}
+
+}  // namespace engine
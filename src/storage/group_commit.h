@@ -0,0 +1,81 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <rocksdb/db.h>
+#include <rocksdb/write_batch.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+namespace engine {
+
+struct GroupCommitStats {
+  std::atomic<uint64_t> groups = 0;
+  std::atomic<uint64_t> batches = 0;
+  std::atomic<uint64_t> wait_us = 0;
+  std::atomic<uint64_t> max_wait_us = 0;
+};
+
+// GroupCommitter merges the write batches of concurrent writers (usually from different
+// worker threads) into a single RocksDB write, so that they share one WAL append and,
+// with the sync write option, one fsync.
+//
+// The first writer arriving at an idle committer becomes the leader, it waits at most
+// `max_delay_us` for followers to join (or until `max_batch_size` batches are queued),
+// then writes the merged batch and hands the result back to every writer of the group.
+class GroupCommitter {
+ public:
+  GroupCommitter() = default;
+
+  GroupCommitter(const GroupCommitter &) = delete;
+  GroupCommitter &operator=(const GroupCommitter &) = delete;
+
+  rocksdb::Status Write(rocksdb::DB *db, const rocksdb::WriteOptions &options, rocksdb::WriteBatch *updates,
+                        int max_delay_us, int max_batch_size);
+
+  const GroupCommitStats &GetStats() const { return stats_; }
+
+  // MergeBatches appends the records of `src` to `dst` (both must be plain, unsequenced batches)
+  static void MergeBatches(std::string *dst, const rocksdb::WriteBatch &src);
+
+ private:
+  struct Writer {
+    rocksdb::WriteBatch *batch;
+    rocksdb::Status status;
+    bool done = false;
+  };
+
+  void recordWait(uint64_t us);
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::condition_variable leader_cv_;
+  std::deque<Writer *> queue_;
+  bool leader_active_ = false;
+
+  GroupCommitStats stats_;
+};
+
+}  // namespace engine
@@ -0,0 +1,194 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "huge_page_allocator.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+#ifdef ENABLE_JEMALLOC
+#include <jemalloc/jemalloc.h>
+#endif
+
+#include "fmt/format.h"
+#include "unique_fd.h"
+
+namespace engine {
+
+namespace {
+
+std::atomic<uint64_t> mapped_bytes = 0;
+std::atomic<uint64_t> fallback_count = 0;
+
+#if defined(ENABLE_JEMALLOC) && defined(__linux__)
+
+HugePageMode extent_mode = HugePageMode::kNone;
+
+// mapAligned maps the anonymous memory of the size at the alignment, by mapping more and trimming the rest
+void *mapAligned(size_t size, size_t alignment) {
+  auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  size_t map_size = alignment > page_size ? size + alignment : size;
+  void *addr = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (addr == MAP_FAILED) return nullptr;
+
+  auto begin = reinterpret_cast<uintptr_t>(addr);
+  auto aligned = alignment > page_size ? (begin + alignment - 1) & ~(alignment - 1) : begin;
+  if (aligned > begin) munmap(addr, aligned - begin);
+  if (begin + map_size > aligned + size) {
+    munmap(reinterpret_cast<void *>(aligned + size), begin + map_size - aligned - size);
+  }
+  return reinterpret_cast<void *>(aligned);
+}
+
+void *extentAlloc([[maybe_unused]] extent_hooks_t *hooks, void *new_addr, size_t size, size_t alignment, bool *zero,
+                  bool *commit, [[maybe_unused]] unsigned arena) {
+  // the extents can't be mapped at the given addresses
+  if (new_addr) return nullptr;
+
+  constexpr auto kHugePageSize = HugePageAllocator::kHugePageSize;
+  void *addr = nullptr;
+  bool on_huge_pages = false;
+  if (extent_mode == HugePageMode::kExplicit && size % kHugePageSize == 0 && alignment <= kHugePageSize) {
+    addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (addr == MAP_FAILED) {
+      addr = nullptr;
+    } else {
+      on_huge_pages = true;
+    }
+  }
+  if (!addr) {
+    // a transparent huge page only backs the memory aligned to it
+    bool transparent = extent_mode == HugePageMode::kTransparent && size >= kHugePageSize;
+    addr = mapAligned(size, transparent ? std::max(alignment, kHugePageSize) : alignment);
+    if (!addr) return nullptr;
+    on_huge_pages = transparent && madvise(addr, size, MADV_HUGEPAGE) == 0;
+  }
+
+  if (on_huge_pages) {
+    mapped_bytes += size;
+  } else {
+    fallback_count++;
+  }
+  // the anonymous mappings are zeroed and committed
+  *zero = true;
+  *commit = true;
+  return addr;
+}
+
+// the extents are kept in the arena instead of being unmapped, by opting out of the deallocation
+bool extentDalloc([[maybe_unused]] extent_hooks_t *hooks, [[maybe_unused]] void *addr, [[maybe_unused]] size_t size,
+                  [[maybe_unused]] bool committed, [[maybe_unused]] unsigned arena) {
+  return true;
+}
+
+// the extents are split and merged by the arena only, since they're never unmapped
+bool extentSplit([[maybe_unused]] extent_hooks_t *hooks, [[maybe_unused]] void *addr, [[maybe_unused]] size_t size,
+                 [[maybe_unused]] size_t size_a, [[maybe_unused]] size_t size_b, [[maybe_unused]] bool committed,
+                 [[maybe_unused]] unsigned arena) {
+  return false;
+}
+
+bool extentMerge([[maybe_unused]] extent_hooks_t *hooks, [[maybe_unused]] void *addr_a, [[maybe_unused]] size_t size_a,
+                 [[maybe_unused]] void *addr_b, [[maybe_unused]] size_t size_b, [[maybe_unused]] bool committed,
+                 [[maybe_unused]] unsigned arena) {
+  return false;
+}
+
+extent_hooks_t huge_page_extent_hooks = {
+    extentAlloc, extentDalloc, nullptr, nullptr, nullptr, nullptr, nullptr, extentSplit, extentMerge,
+};
+
+#endif
+
+}  // namespace
+
+#if defined(ENABLE_JEMALLOC) && defined(__linux__)
+
+StatusOr<std::shared_ptr<HugePageAllocator>> HugePageAllocator::Get(HugePageMode mode) {
+  static std::mutex mu;
+  static std::shared_ptr<HugePageAllocator> allocator;
+
+  std::lock_guard<std::mutex> guard(mu);
+  if (allocator) return allocator;
+
+  extent_mode = mode;
+  unsigned arena = 0;
+  size_t size = sizeof(arena);
+  extent_hooks_t *hooks = &huge_page_extent_hooks;
+  if (auto ret = mallctl("arenas.create", &arena, &size, &hooks, sizeof(hooks)); ret != 0) {
+    return {Status::NotOK, fmt::format("failed to create the jemalloc arena of the huge pages, err: {}", ret)};
+  }
+  allocator.reset(new HugePageAllocator(arena));
+  return allocator;
+}
+
+void *HugePageAllocator::Allocate(size_t size) {
+  // the blocks skip the thread caches, which would mix them up with the other arenas
+  return mallocx(size, MALLOCX_ARENA(arena_) | MALLOCX_TCACHE_NONE);
+}
+
+void HugePageAllocator::Deallocate(void *p) { dallocx(p, MALLOCX_TCACHE_NONE); }
+
+size_t HugePageAllocator::UsableSize(void *p, [[maybe_unused]] size_t allocation_size) const { return sallocx(p, 0); }
+
+#else
+
+StatusOr<std::shared_ptr<HugePageAllocator>> HugePageAllocator::Get([[maybe_unused]] HugePageMode mode) {
+  return {Status::NotSupported, "the block cache is only allocated on huge pages with jemalloc on Linux"};
+}
+
+void *HugePageAllocator::Allocate(size_t size) { return malloc(size); }
+
+void HugePageAllocator::Deallocate(void *p) { free(p); }
+
+size_t HugePageAllocator::UsableSize([[maybe_unused]] void *p, size_t allocation_size) const {
+  return allocation_size;
+}
+
+#endif
+
+uint64_t HugePageAllocator::MappedBytes() { return mapped_bytes; }
+
+uint64_t HugePageAllocator::FallbackCount() { return fallback_count; }
+
+uint64_t HugePageAllocator::ProcessHugePageBytes() {
+  char buf[4096];
+  auto fd = UniqueFD(open("/proc/self/smaps_rollup", O_RDONLY));
+  if (!fd) return 0;
+  auto len = read(*fd, buf, sizeof(buf) - 1);
+  if (len <= 0) return 0;
+  buf[len] = '\0';
+
+  // the sizes are in kB, e.g. "AnonHugePages:    2048 kB"
+  uint64_t total = 0;
+  for (const char *name : {"AnonHugePages:", "Shared_Hugetlb:", "Private_Hugetlb:"}) {
+    if (const char *field = strstr(buf, name)) total += std::strtoull(field + strlen(name), nullptr, 10) * 1024;
+  }
+  return total;
+}
+
+}  // namespace engine
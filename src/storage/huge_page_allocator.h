@@ -0,0 +1,69 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <rocksdb/memory_allocator.h>
+
+#include <cstdint>
+#include <memory>
+
+#include "config/config.h"
+#include "status.h"
+
+namespace engine {
+
+// HugePageAllocator allocates the blocks of the block cache from a dedicated jemalloc arena, whose extents
+// are mapped on huge pages by its custom extent hooks, so a large block cache takes far fewer TLB entries.
+// The extents are mapped on the explicit huge pages reserved by vm.nr_hugepages, falling back to the normal
+// pages if there's none left, or advised by MADV_HUGEPAGE to be backed by the transparent huge pages.
+//
+// The extents are never unmapped, the memory freed by the cache is kept in the arena for the later blocks.
+class HugePageAllocator : public rocksdb::MemoryAllocator {
+ public:
+  static constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+  // Get returns the allocator of the process, which is created by the first call, since the arena can't be
+  // destroyed while the blocks of a cache may still be in use. It fails without jemalloc.
+  static StatusOr<std::shared_ptr<HugePageAllocator>> Get(HugePageMode mode);
+
+  static const char *kClassName() { return "HugePageAllocator"; }
+  const char *Name() const override { return kClassName(); }
+
+  void *Allocate(size_t size) override;
+  void Deallocate(void *p) override;
+  size_t UsableSize(void *p, size_t allocation_size) const override;
+
+  // MappedBytes is the bytes of the extents mapped on huge pages, and FallbackCount is the number of the extents
+  // mapped on the normal pages, since no huge page was available or the extent is too small for them
+  static uint64_t MappedBytes();
+  static uint64_t FallbackCount();
+
+  // ProcessHugePageBytes is the bytes of the process on the transparent and the explicit huge pages,
+  // read from /proc/self/smaps_rollup, or 0 if it can't be read
+  static uint64_t ProcessHugePageBytes();
+
+ private:
+  explicit HugePageAllocator(unsigned arena) : arena_(arena) {}
+
+  [[maybe_unused]] unsigned arena_;
+};
+
+}  // namespace engine
@@ -0,0 +1,122 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <rocksdb/status.h>
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "lock_manager.h"
+
+namespace engine {
+
+// IncrCombiner combines the concurrent increments of the same counter, e.g. INCRBY of a hot key.
+// The first increment of a counter becomes the leader: once it holds the key lock, it reads the
+// counter once, applies the increments arrived meanwhile in order and writes the counter once,
+// while the others wait for their results instead of taking the lock one after another.
+template <typename T>
+class IncrCombiner {
+ public:
+  struct Op {
+    T increment;
+    T result = 0;
+    rocksdb::Status status;
+  };
+
+  // ApplyFn reads the counter, sets the result or the status of every op in order and writes the counter,
+  // the status it returns fails all the ops
+  using ApplyFn = std::function<rocksdb::Status(const std::vector<Op *> &ops)>;
+
+  explicit IncrCombiner(LockManager *lock_mgr) : lock_mgr_(lock_mgr) {}
+
+  // IncrBy adds the increment to the counter `key`, which is protected by the lock of `lock_key`.
+  // If combine is false, the increment is applied alone under the lock.
+  rocksdb::Status IncrBy(const std::string &lock_key, const std::string &key, bool combine, T increment,
+                         T *new_value, const ApplyFn &apply) {
+    Op op{increment};
+    if (!combine) {
+      LockGuard guard(lock_mgr_, lock_key);
+      auto s = apply({&op});
+      if (!s.ok()) return s;
+      *new_value = op.result;
+      return op.status;
+    }
+
+    std::shared_ptr<Group> group;
+    bool leader = false;
+    {
+      std::lock_guard<std::mutex> guard(mu_);
+      auto &slot = groups_[key];
+      if (!slot) {
+        slot = std::make_shared<Group>();
+        leader = true;
+      }
+      group = slot;
+      group->ops.emplace_back(&op);
+    }
+
+    if (leader) {
+      LockGuard guard(lock_mgr_, lock_key);
+      std::vector<Op *> ops;
+      {
+        // the increments arriving from now on start a new group, which waits for the key lock
+        std::lock_guard<std::mutex> lg(mu_);
+        groups_.erase(key);
+        ops = std::move(group->ops);
+      }
+      auto s = apply(ops);
+      {
+        std::lock_guard<std::mutex> lg(mu_);
+        if (!s.ok()) {
+          for (auto *o : ops) o->status = s;
+        }
+        group->done = true;
+      }
+      group->cv.notify_all();
+    } else {
+      std::unique_lock<std::mutex> lock(mu_);
+      group->cv.wait(lock, [&group] { return group->done; });
+    }
+
+    if (!op.status.ok()) return op.status;
+    *new_value = op.result;
+    return rocksdb::Status::OK();
+  }
+
+ private:
+  struct Group {
+    std::vector<Op *> ops;
+    bool done = false;
+    std::condition_variable cv;
+  };
+
+  LockManager *lock_mgr_;
+  std::mutex mu_;
+  std::unordered_map<std::string, std::shared_ptr<Group>> groups_;
+};
+
+}  // namespace engine
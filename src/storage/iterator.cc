@@ -23,14 +23,68 @@
 #include <cluster/redis_slot.h>
 
 #include "db_util.h"
+#include "table_properties_collector.h"
+#include "time_util.h"
 
 namespace engine {
+SlotRangeBounds::SlotRangeBounds(const Slice &ns, const SlotRange &slot_range)
+    : slot_range_(slot_range),
+      lower_bound_(ComposeSlotKeyPrefix(ns, slot_range.start)),
+      upper_bound_(ComposeSlotKeyPrefix(ns, slot_range.end + 1)),
+      lower_bound_slice_(lower_bound_),
+      upper_bound_slice_(upper_bound_) {}
+
+void SlotRangeBounds::Apply(rocksdb::ReadOptions *read_options) const {
+  read_options->iterate_lower_bound = &lower_bound_slice_;
+  read_options->iterate_upper_bound = &upper_bound_slice_;
+  read_options->table_filter = [start = static_cast<uint16_t>(slot_range_.start),
+                                end = static_cast<uint16_t>(slot_range_.end)](const rocksdb::TableProperties &props) {
+    // the range deletions may cover the slots without any key in the file
+    if (props.num_range_deletions > 0) return true;
+    // the files written before the slot stats are collected are always read
+    auto iter = props.user_collected_properties.find(kSlotStatsProp);
+    if (iter == props.user_collected_properties.end()) return true;
+    return SlotStatsCollector::HasSlotInRange(iter->second, start, end);
+  };
+}
+
+bool ExpiredMetadataSkipper::Skip(const Slice &key, const Slice &value) {
+  if (checked_++ % kTimeCheckInterval == 0) now_ms_ = util::GetTimeStampMS();
+
+  bool expired = false;
+  if (!Metadata::PeekExpireAt(value, now_ms_, &expired)) {
+    endRun();
+    return true;
+  }
+  if (!expired) {
+    endRun();
+    return false;
+  }
+
+  expired_++;
+  if (run_++ == 0) run_begin_.assign(key.data(), key.size());
+  run_end_.assign(key.data(), key.size());
+  return true;
+}
+
+void ExpiredMetadataSkipper::endRun() {
+  if (run_ >= kMinCompactionRun) {
+    storage_->AddCompactionHint(ColumnFamilyID::Metadata, std::move(run_begin_), std::move(run_end_));
+  }
+  run_ = 0;
+}
+
 DBIterator::DBIterator(engine::Context &ctx, rocksdb::ReadOptions read_options, int slot)
     : storage_(ctx.storage),
       read_options_(std::move(read_options)),
       ctx_(&ctx),
       slot_(slot),
+      skipper_(ctx.storage),
       metadata_cf_handle_(storage_->GetCFHandle(ColumnFamilyID::Metadata)) {
+  if (slot_ != -1 && storage_->IsSlotIdEncoded()) {
+    slot_bounds_ = std::make_unique<SlotRangeBounds>(kDefaultNamespace, SlotRange::GetPoint(slot_));
+    slot_bounds_->Apply(&read_options_);
+  }
   metadata_iter_ = util::UniqueIterator(storage_->NewIterator(ctx, read_options_, metadata_cf_handle_));
 }
 
@@ -42,22 +96,11 @@ void DBIterator::Next() {
 }
 
 void DBIterator::nextUntilValid() {
-  // slot_ != -1 means we would like to iterate all keys in the slot
-  // so we can skip the afterwards keys if the slot id doesn't match
-  if (slot_ != -1 && metadata_iter_->Valid()) {
-    auto [_, user_key] = ExtractNamespaceKey(metadata_iter_->key(), storage_->IsSlotIdEncoded());
-    // Release the iterator if the slot id doesn't match
-    if (GetSlotIdFromKey(user_key.ToString()) != slot_) {
-      Reset();
-      return;
-    }
-  }
-
+  // The iteration of a slot is bounded by the slot prefix, see SlotRangeBounds
   while (metadata_iter_->Valid()) {
-    Metadata metadata(kRedisNone, false);
-    // Skip the metadata if it's expired
-    if (metadata.Decode(metadata_iter_->value()).ok() && !metadata.Expired()) {
-      metadata_ = metadata;
+    // Only the live metadata is decoded
+    if (!skipper_.Skip(metadata_iter_->key(), metadata_iter_->value()) &&
+        metadata_.Decode(metadata_iter_->value()).ok()) {
       break;
     }
     metadata_iter_->Next();
@@ -112,7 +155,11 @@ std::unique_ptr<SubKeyIterator> DBIterator::GetSubKeyIterator() const {
   }
 
   auto prefix = InternalKey(Key(), "", metadata_.version, ctx_->storage->IsSlotIdEncoded()).Encode();
-  return std::make_unique<SubKeyIterator>(*ctx_, read_options_, type, std::move(prefix));
+  // The subkey iterator is bounded by the prefix, it may outlive the slot bounds but the table filter is kept
+  auto read_options = read_options_;
+  read_options.iterate_lower_bound = nullptr;
+  read_options.iterate_upper_bound = nullptr;
+  return std::make_unique<SubKeyIterator>(*ctx_, read_options, type, std::move(prefix));
 }
 
 SubKeyIterator::SubKeyIterator(engine::Context &ctx, rocksdb::ReadOptions read_options, RedisType type,
@@ -204,9 +251,10 @@ bool WALBatchExtractor::Iter::Valid() { return items_ && cur_ < items_->size();
 
 void WALBatchExtractor::Iter::Next() { cur_++; }
 
-WALItem WALBatchExtractor::Iter::Value() {
+const WALItem &WALBatchExtractor::Iter::Value() {
+  static const WALItem invalid_item;
   if (!Valid()) {
-    return {};
+    return invalid_item;
   }
   return (*items_)[cur_];
 }
@@ -265,11 +313,12 @@ void WALIterator::Seek(rocksdb::SequenceNumber seq) {
   nextBatch();
 }
 
-WALItem WALIterator::Item() {
+const WALItem &WALIterator::Item() {
+  static const WALItem invalid_item;
   if (batch_iter_ && batch_iter_->Valid()) {
     return batch_iter_->Value();
   }
-  return {};
+  return invalid_item;
 }
 
 rocksdb::SequenceNumber WALIterator::NextSequenceNumber() const { return next_batch_seq_; }
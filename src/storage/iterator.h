@@ -27,6 +27,62 @@
 
 namespace engine {
 
+// SlotRangeBounds bounds the iterators of the column families keyed by the slot, i.e. the metadata and the
+// subkey column families when the slot id is encoded, to the keys of a slot range. Besides the bounds, the
+// iterators skip the SST files without any key of the slot range by their slot stats, see SlotStatsCollector.
+class SlotRangeBounds {
+ public:
+  explicit SlotRangeBounds(const Slice &ns, const SlotRange &slot_range);
+  SlotRangeBounds(const SlotRangeBounds &) = delete;
+  SlotRangeBounds &operator=(const SlotRangeBounds &) = delete;
+
+  // Apply sets the bounds and the table filter of the read options, which must not be used after the bounds
+  // are destroyed
+  void Apply(rocksdb::ReadOptions *read_options) const;
+  const std::string &LowerBound() const { return lower_bound_; }
+
+ private:
+  SlotRange slot_range_;
+  std::string lower_bound_;
+  std::string upper_bound_;
+  rocksdb::Slice lower_bound_slice_;
+  rocksdb::Slice upper_bound_slice_;
+};
+
+// ExpiredMetadataSkipper checks the entries of an iteration of the metadata column family, and skips the expired
+// ones by peeking the headers of their metadata instead of decoding them, see Metadata::PeekExpireAt.
+//
+// The expired metadata are only dropped by the compaction, so the iterations skip them again and again until then.
+// A run of at least kMinCompactionRun expired entries in a row is reported to the compaction checker, which
+// compacts the range in its next round, see Storage::AddCompactionHint.
+class ExpiredMetadataSkipper {
+ public:
+  static constexpr uint64_t kMinCompactionRun = 1024;
+
+  explicit ExpiredMetadataSkipper(Storage *storage) : storage_(storage) {}
+  ~ExpiredMetadataSkipper() { endRun(); }
+  ExpiredMetadataSkipper(const ExpiredMetadataSkipper &) = delete;
+  ExpiredMetadataSkipper &operator=(const ExpiredMetadataSkipper &) = delete;
+
+  // Skip returns true if the metadata is expired or can't be decoded
+  bool Skip(const Slice &key, const Slice &value);
+  uint64_t GetExpired() const { return expired_; }
+
+ private:
+  // the time is read once per kTimeCheckInterval entries rather than for every entry
+  static constexpr uint64_t kTimeCheckInterval = 1024;
+
+  void endRun();
+
+  Storage *storage_;
+  uint64_t now_ms_ = 0;
+  uint64_t checked_ = 0;
+  uint64_t expired_ = 0;
+  uint64_t run_ = 0;
+  std::string run_begin_;
+  std::string run_end_;
+};
+
 class SubKeyIterator {
  public:
   explicit SubKeyIterator(engine::Context &ctx, rocksdb::ReadOptions read_options, RedisType type, std::string prefix);
@@ -75,7 +131,9 @@ class DBIterator {
   rocksdb::ReadOptions read_options_;
   Context *ctx_;
   int slot_ = -1;
+  std::unique_ptr<SlotRangeBounds> slot_bounds_;
   Metadata metadata_ = Metadata(kRedisNone, false);
+  ExpiredMetadataSkipper skipper_;
 
   rocksdb::ColumnFamilyHandle *metadata_cf_handle_ = nullptr;
   std::unique_ptr<rocksdb::Iterator> metadata_iter_;
@@ -124,7 +182,8 @@ class WALBatchExtractor : public rocksdb::WriteBatch::Handler {
    public:
     bool Valid();
     void Next();
-    WALItem Value();
+    // Value returns the item in the batch, which is valid until the next batch is extracted
+    const WALItem &Value();
 
    private:
     explicit Iter(std::vector<WALItem> *items) : items_(items), cur_(0) {}
@@ -150,7 +209,7 @@ class WALIterator {
   bool Valid() const;
   void Seek(rocksdb::SequenceNumber seq);
   void Next();
-  WALItem Item();
+  const WALItem &Item();
 
   rocksdb::SequenceNumber NextSequenceNumber() const;
   void Reset();
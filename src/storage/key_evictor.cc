@@ -0,0 +1,167 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "key_evictor.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <tuple>
+
+#include "db_util.h"
+#include "redis_db.h"
+#include "redis_metadata.h"
+
+namespace engine {
+
+StatusOr<uint64_t> KeyEvictor::Evict() {
+  const auto *config = storage_->GetConfig();
+  auto policy = config->max_db_size_policy;
+  if (config->max_db_size <= 0 || policy == kMaxDBSizeNoEviction) {
+    bytes_to_evict_ = 0;
+    setStalled(false);
+    return 0;
+  }
+
+  auto limit = static_cast<uint64_t>(config->max_db_size) * GiB;
+  auto low_watermark = limit / 100 * config->max_db_size_low_watermark;
+  auto total_size = size_getter_ ? size_getter_() : storage_->GetTotalSize();
+  if (total_size < limit) setStalled(false);
+
+  if (bytes_to_evict_ > 0) {
+    // the bytes written since the last call are evicted as well
+    if (total_size <= low_watermark) {
+      bytes_to_evict_ = 0;
+    } else if (total_size > round_size_) {
+      bytes_to_evict_ += total_size - round_size_;
+    }
+    round_size_ = total_size;
+  }
+
+  if (bytes_to_evict_ == 0) {
+    // the space of the last round may only be reclaimed by a compaction
+    auto compaction_count = storage_->GetDBStats()->compaction_count.load();
+    if (compaction_count == last_compaction_count_ || total_size < limit) return 0;
+
+    last_compaction_count_ = compaction_count;
+    bytes_to_evict_ = total_size - low_watermark;
+    round_size_ = total_size;
+    pass_begin_ = cursor_;
+    pass_wrapped_ = false;
+    pass_candidates_ = 0;
+  }
+
+  auto ctx = engine::Context::NoTransactionContext(storage_);
+  uint64_t evicted = 0;
+  for (size_t samples = 0; samples < kMaxSamplesPerCall && bytes_to_evict_ > 0 && evicted < kMaxKeysPerCall;
+       samples++) {
+    auto candidates = GET_OR_RET(sample(ctx, policy));
+    pass_candidates_ += candidates.size();
+    std::sort(candidates.begin(), candidates.end(),
+              [](const Candidate &a, const Candidate &b) { return a.score < b.score; });
+    candidates.resize(std::min(candidates.size(), std::max<size_t>(1, candidates.size() / 4)));
+
+    for (const auto &candidate : candidates) {
+      redis::Database db(storage_, candidate.ns);
+      uint64_t deleted = 0;
+      auto s = db.MDel(ctx, {candidate.user_key}, &deleted, true);
+      if (!s.ok()) return {Status::NotOK, s.ToString()};
+      if (deleted == 0) continue;
+
+      evicted++;
+      bytes_to_evict_ -= std::min(bytes_to_evict_, candidate.bytes);
+      if (bytes_to_evict_ == 0) break;
+    }
+    if (evicted > 0) setStalled(false);
+
+    if (cursor_.empty()) pass_wrapped_ = true;
+    if (pass_wrapped_ && (cursor_.empty() ? pass_begin_.empty() : cursor_ >= pass_begin_)) {
+      if (pass_candidates_ == 0) {
+        // nothing can be evicted, the writes are rejected and the next round waits for a compaction
+        setStalled(true);
+        bytes_to_evict_ = 0;
+        break;
+      }
+      pass_begin_ = cursor_;
+      pass_wrapped_ = false;
+      pass_candidates_ = 0;
+    }
+
+    // the rest of the key space is sampled by the next call
+    if (cursor_.empty()) break;
+  }
+  return evicted;
+}
+
+void KeyEvictor::setStalled(bool stalled) {
+  if (stalled_ == stalled) return;
+  stalled_ = stalled;
+  if (stalled) {
+    LOG(WARNING) << "[key_evictor] No key can be evicted by max-db-size-policy, the writes are rejected";
+  }
+  // the DB was measured over max-db-size when it stalls, and the writes are accepted again
+  // with an eviction policy once some keys are evicted or it's below max-db-size
+  storage_->SetEvictionStalled(stalled);
+  storage_->SetDBSizeLimit(stalled);
+}
+
+StatusOr<std::vector<KeyEvictor::Candidate>> KeyEvictor::sample(engine::Context &ctx, MaxDBSizePolicy policy) {
+  bool is_volatile = policy == kMaxDBSizeVolatileTTL || policy == kMaxDBSizeVolatileLRU;
+
+  std::vector<Candidate> candidates;
+  auto iter = util::UniqueIterator(ctx, storage_->DefaultScanOptions(), ColumnFamilyID::Metadata);
+  iter->Seek(cursor_);
+  if (iter->Valid() && iter->key() == cursor_) iter->Next();
+  for (size_t n = 0; iter->Valid() && n < kSampleSize; iter->Next(), n++) {
+    cursor_ = iter->key().ToString();
+
+    Metadata metadata(kRedisNone, false);
+    if (!metadata.Decode(iter->value()).ok() || metadata.Expired()) continue;
+    if (is_volatile && metadata.expire == 0) continue;
+
+    Candidate candidate;
+    candidate.ns_key = cursor_;
+    std::tie(candidate.ns, candidate.user_key) =
+        ExtractNamespaceKey<std::string>(candidate.ns_key, storage_->IsSlotIdEncoded());
+    candidate.bytes = iter->key().size() + iter->value().size();
+    if (!metadata.IsSingleKVType()) {
+      candidate.bytes += redis::Database(storage_, candidate.ns).ApproximateSubKeySize(candidate.ns_key, metadata);
+    }
+    switch (policy) {
+      case kMaxDBSizeAllKeysLFU:
+        candidate.score = hot_keys_->EstimateAccesses(candidate.ns, candidate.user_key);
+        break;
+      case kMaxDBSizeVolatileLRU:
+        candidate.score = hot_keys_->EstimateLastAccess(candidate.ns, candidate.user_key);
+        break;
+      default:
+        candidate.score = metadata.expire;
+        break;
+    }
+    candidates.push_back(std::move(candidate));
+  }
+  if (auto s = iter->status(); !s.ok()) return {Status::NotOK, s.ToString()};
+  // wrap around to the first key
+  if (!iter->Valid()) cursor_.clear();
+
+  return candidates;
+}
+
+}  // namespace engine
@@ -0,0 +1,95 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "stats/hot_keys.h"
+#include "status.h"
+#include "storage.h"
+
+namespace engine {
+
+// KeyEvictor deletes the keys of the lowest priority under max-db-size-policy once the DB is larger than
+// max-db-size, until the approximate bytes of the evicted keys bring it below max-db-size-low-watermark.
+//
+// The metadata column family is walked from a cursor by samples of kSampleSize keys, and the worst quarter
+// of each sample is evicted, by their access frequencies (allkeys-lfu) or last access times (volatile-lru)
+// estimated by the sketches of the hot keys, or by their expire times (volatile-ttl). The subkeys of the
+// evicted keys are removed by the lazy free queue.
+//
+// The SST files only shrink after the deletions are compacted, so after the bytes of a round are evicted,
+// the next round waits for a compaction to complete. The size is measured again on each call, and the bytes
+// written during a round are added to it. If a whole pass over the key space finds nothing to evict, e.g.
+// no key has an expire time under a volatile policy, the writes are rejected as with noeviction until
+// some keys are evicted or the DB is below max-db-size again.
+class KeyEvictor {
+ public:
+  static constexpr size_t kSampleSize = 64;
+  static constexpr size_t kMaxSamplesPerCall = 64;
+  static constexpr uint64_t kMaxKeysPerCall = 1024;
+
+  // the total size of the DB, which may be replaced in tests
+  using SizeGetter = std::function<uint64_t()>;
+
+  KeyEvictor(Storage *storage, const HotKeys *hot_keys, SizeGetter size_getter = nullptr)
+      : storage_(storage), hot_keys_(hot_keys), size_getter_(std::move(size_getter)) {}
+
+  // Evict evicts at most kMaxKeysPerCall keys from kMaxSamplesPerCall samples if the DB is over its size limit,
+  // and returns the number of evicted keys
+  StatusOr<uint64_t> Evict();
+
+ private:
+  struct Candidate {
+    std::string ns_key;
+    std::string ns;
+    std::string user_key;
+    // the keys of the lowest scores are evicted first
+    uint64_t score;
+    uint64_t bytes;
+  };
+
+  // sample reads at most kSampleSize keys after the cursor, and returns the ones which may be evicted
+  StatusOr<std::vector<Candidate>> sample(engine::Context &ctx, MaxDBSizePolicy policy);
+  // setStalled rejects the writes over max-db-size if nothing can be evicted
+  void setStalled(bool stalled);
+
+  Storage *storage_;
+  const HotKeys *hot_keys_;
+  SizeGetter size_getter_;
+  std::string cursor_;
+  // the bytes left to evict in the current round
+  uint64_t bytes_to_evict_ = 0;
+  // the size of the DB measured last in the current round
+  uint64_t round_size_ = 0;
+  uint64_t last_compaction_count_ = UINT64_MAX;
+  // the key where the current pass over the key space began, and whether the cursor wrapped around since
+  std::string pass_begin_;
+  bool pass_wrapped_ = false;
+  uint64_t pass_candidates_ = 0;
+  bool stalled_ = false;
+};
+
+}  // namespace engine
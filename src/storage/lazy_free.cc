@@ -0,0 +1,55 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "lazy_free.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+namespace engine {
+
+void LazyFreeQueue::Push(Entry entry) {
+  pending_keys_.fetch_add(1, std::memory_order_relaxed);
+  pending_bytes_.fetch_add(entry.bytes, std::memory_order_relaxed);
+
+  std::lock_guard<std::mutex> guard(mu_);
+  entries_.emplace_back(std::move(entry));
+}
+
+std::vector<LazyFreeQueue::Entry> LazyFreeQueue::PopBatch(size_t n) {
+  std::lock_guard<std::mutex> guard(mu_);
+  n = std::min(n, entries_.size());
+  std::vector<Entry> entries(std::make_move_iterator(entries_.begin()),
+                             std::make_move_iterator(entries_.begin() + static_cast<ptrdiff_t>(n)));
+  entries_.erase(entries_.begin(), entries_.begin() + static_cast<ptrdiff_t>(n));
+  return entries;
+}
+
+void LazyFreeQueue::Done(const std::vector<Entry> &entries) {
+  uint64_t bytes = 0;
+  for (const auto &entry : entries) bytes += entry.bytes;
+
+  pending_keys_.fetch_sub(entries.size(), std::memory_order_relaxed);
+  pending_bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+  freed_keys_.fetch_add(entries.size(), std::memory_order_relaxed);
+}
+
+}  // namespace engine
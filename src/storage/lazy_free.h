@@ -0,0 +1,64 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "redis_metadata.h"
+
+namespace engine {
+
+// LazyFreeQueue holds the subkeys of the keys deleted by UNLINK (or a DEL of a big collection).
+// The metadata is deleted in the foreground as usual, and the subkeys of the deleted version
+// are removed by range in the background instead of being left to compactions.
+class LazyFreeQueue {
+ public:
+  struct Entry {
+    std::string ns_key;
+    uint64_t version;
+    RedisType type;
+    // the approximate size of the subkeys
+    uint64_t bytes;
+  };
+
+  void Push(Entry entry);
+  // PopBatch removes at most n entries from the queue, they're still pending until Done
+  std::vector<Entry> PopBatch(size_t n);
+  void Done(const std::vector<Entry> &entries);
+
+  uint64_t GetPendingKeys() const { return pending_keys_.load(std::memory_order_relaxed); }
+  uint64_t GetPendingBytes() const { return pending_bytes_.load(std::memory_order_relaxed); }
+  uint64_t GetFreedKeys() const { return freed_keys_.load(std::memory_order_relaxed); }
+
+ private:
+  std::mutex mu_;
+  std::deque<Entry> entries_;
+  std::atomic<uint64_t> pending_keys_ = 0;
+  std::atomic<uint64_t> pending_bytes_ = 0;
+  std::atomic<uint64_t> freed_keys_ = 0;
+};
+
+}  // namespace engine
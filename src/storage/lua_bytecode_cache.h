@@ -0,0 +1,65 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+namespace lua {
+
+// BytecodeCache keeps the compiled bytecode of the Lua scripts and function libraries, keyed by
+// the SHA1 of their code. The server and every worker have their own Lua VM, and a script is
+// only compiled by the first VM which loads it, while the others load its bytecode.
+// It's cleared by SCRIPT FLUSH, the same as the scripts.
+class BytecodeCache {
+ public:
+  bool Get(const std::string &key, std::string *bytecode) const {
+    std::shared_lock<std::shared_mutex> guard(mu_);
+    auto iter = bytecodes_.find(key);
+    if (iter == bytecodes_.end()) return false;
+
+    *bytecode = iter->second;
+    return true;
+  }
+
+  void Put(const std::string &key, std::string bytecode) {
+    std::unique_lock<std::shared_mutex> guard(mu_);
+    bytecodes_.insert_or_assign(key, std::move(bytecode));
+  }
+
+  void Clear() {
+    std::unique_lock<std::shared_mutex> guard(mu_);
+    bytecodes_.clear();
+  }
+
+  size_t Size() const {
+    std::shared_lock<std::shared_mutex> guard(mu_);
+    return bytecodes_.size();
+  }
+
+ private:
+  mutable std::shared_mutex mu_;
+  std::unordered_map<std::string, std::string> bytecodes_;
+};
+
+}  // namespace lua
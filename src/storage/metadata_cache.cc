@@ -0,0 +1,142 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "metadata_cache.h"
+
+namespace engine {
+
+bool MetadataCache::Lookup(const rocksdb::Slice &key, std::string *value, bool *absent) {
+  auto &shard = shardOf(key);
+  std::lock_guard<std::mutex> guard(shard.mutex);
+
+  auto iter = shard.index.find(key.ToStringView());
+  if (iter == shard.index.end() || (iter->second->absent && !absent)) {
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  auto &lru = iter->second->absent ? shard.absent_lru : shard.lru;
+  lru.splice(lru.begin(), lru, iter->second);
+  if (iter->second->absent) {
+    *absent = true;
+    absent_hits_.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    if (absent) *absent = false;
+    value->assign(iter->second->value);
+  }
+  hits_.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+uint64_t MetadataCache::GetGeneration(const rocksdb::Slice &key) {
+  auto &shard = shardOf(key);
+  std::lock_guard<std::mutex> guard(shard.mutex);
+  return shard.generation;
+}
+
+void MetadataCache::Insert(const rocksdb::Slice &key, const rocksdb::Slice &value, uint64_t generation) {
+  auto &shard = shardOf(key);
+  std::lock_guard<std::mutex> guard(shard.mutex);
+
+  // The shard was written after the value was read, so it may be stale
+  if (shard.generation != generation) return;
+
+  insertEntry(shard, Entry{key.ToString(), value.ToString(), false});
+}
+
+void MetadataCache::InsertAbsent(const rocksdb::Slice &key, uint64_t generation) {
+  if (!IsAbsentEnabled()) return;
+
+  auto &shard = shardOf(key);
+  std::lock_guard<std::mutex> guard(shard.mutex);
+
+  // The key may be written after it was found absent
+  if (shard.generation != generation) return;
+
+  insertEntry(shard, Entry{key.ToString(), "", true});
+}
+
+void MetadataCache::insertEntry(Shard &shard, Entry entry) {
+  if (auto iter = shard.index.find(entry.key); iter != shard.index.end()) {
+    eraseEntry(shard, iter);
+  }
+
+  auto &lru = entry.absent ? shard.absent_lru : shard.lru;
+  auto &usage = entry.absent ? shard.absent_usage : shard.usage;
+  auto capacity = entry.absent ? shard_absent_capacity_ : shard_capacity_;
+  if (charge(entry) > capacity) return;
+
+  usage += charge(entry);
+  lru.emplace_front(std::move(entry));
+  shard.index.emplace(lru.front().key, lru.begin());
+
+  while (usage > capacity) {
+    eraseEntry(shard, shard.index.find(lru.back().key));
+  }
+}
+
+void MetadataCache::Erase(const rocksdb::Slice &key) {
+  auto &shard = shardOf(key);
+  std::lock_guard<std::mutex> guard(shard.mutex);
+
+  shard.generation++;
+  if (auto iter = shard.index.find(key.ToStringView()); iter != shard.index.end()) {
+    eraseEntry(shard, iter);
+  }
+}
+
+void MetadataCache::Clear() {
+  for (auto &shard : shards_) {
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    shard.generation++;
+    shard.index.clear();
+    shard.lru.clear();
+    shard.absent_lru.clear();
+    shard.usage = 0;
+    shard.absent_usage = 0;
+  }
+}
+
+size_t MetadataCache::GetUsage() {
+  size_t usage = 0;
+  for (auto &shard : shards_) {
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    usage += shard.usage;
+  }
+  return usage;
+}
+
+size_t MetadataCache::GetAbsentUsage() {
+  size_t usage = 0;
+  for (auto &shard : shards_) {
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    usage += shard.absent_usage;
+  }
+  return usage;
+}
+
+void MetadataCache::eraseEntry(Shard &shard, Index::iterator iter) {
+  auto entry = iter->second;
+  (entry->absent ? shard.absent_usage : shard.usage) -= charge(*entry);
+  shard.index.erase(iter);
+  (entry->absent ? shard.absent_lru : shard.lru).erase(entry);
+}
+
+}  // namespace engine
@@ -0,0 +1,125 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <rocksdb/slice.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+namespace engine {
+
+// MetadataCache is a size-bounded, sharded LRU cache of the raw metadata of keys,
+// i.e. the values of the metadata column family, keyed by the namespace key.
+//
+// It always holds the latest committed metadata. Entries are erased after every write
+// touching them, and a lookup which raced with a write of the same shard won't be
+// inserted, so a stale value can't be cached after the write is done.
+//
+// The keys found absent can be cached as well, to absorb the probes of missing keys which
+// would go through the bloom filters of every level and often read a block of an SST.
+// They're kept in an LRU of their own within absent_capacity, so a flood of probes doesn't
+// evict the metadata of the existing keys.
+class MetadataCache {
+ public:
+  static constexpr size_t kShards = 16;
+
+  explicit MetadataCache(size_t capacity, size_t absent_capacity = 0)
+      : shard_capacity_(capacity / kShards), shard_absent_capacity_(absent_capacity / kShards) {}
+
+  MetadataCache(const MetadataCache &) = delete;
+  MetadataCache &operator=(const MetadataCache &) = delete;
+
+  // Lookup returns true on a hit, and the key is known to be absent if *absent is set then,
+  // the absent keys are taken as misses if absent is nullptr
+  bool Lookup(const rocksdb::Slice &key, std::string *value, bool *absent = nullptr);
+  // Read the generation before reading the DB, and pass it to Insert or InsertAbsent
+  uint64_t GetGeneration(const rocksdb::Slice &key);
+  void Insert(const rocksdb::Slice &key, const rocksdb::Slice &value, uint64_t generation);
+  void InsertAbsent(const rocksdb::Slice &key, uint64_t generation);
+  void Erase(const rocksdb::Slice &key);
+  void Clear();
+
+  // Every kAbsentCheckInterval-th absent hit is checked against the DB, see Storage::GetRawMetadata
+  static constexpr uint64_t kAbsentCheckInterval = 1024;
+
+  bool IsAbsentEnabled() const { return shard_absent_capacity_ > 0; }
+  // RecordAbsentCheck records a check of an absent hit against the DB, it's stale if the key exists
+  void RecordAbsentCheck(bool stale) {
+    absent_checks_.fetch_add(1, std::memory_order_relaxed);
+    if (stale) absent_stale_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  uint64_t GetHits() const { return hits_.load(std::memory_order_relaxed); }
+  uint64_t GetMisses() const { return misses_.load(std::memory_order_relaxed); }
+  uint64_t GetAbsentHits() const { return absent_hits_.load(std::memory_order_relaxed); }
+  uint64_t GetAbsentChecks() const { return absent_checks_.load(std::memory_order_relaxed); }
+  uint64_t GetAbsentStale() const { return absent_stale_.load(std::memory_order_relaxed); }
+  size_t GetUsage();
+  size_t GetAbsentUsage();
+
+ private:
+  struct Entry {
+    std::string key;
+    std::string value;
+    bool absent = false;
+  };
+  using Index = std::unordered_map<std::string_view, std::list<Entry>::iterator>;
+
+  struct Shard {
+    std::mutex mutex;
+    // The most recently used entry is at the front, the absent keys are in absent_lru
+    std::list<Entry> lru;
+    std::list<Entry> absent_lru;
+    Index index;
+    size_t usage = 0;
+    size_t absent_usage = 0;
+    uint64_t generation = 0;
+  };
+
+  size_t shard_capacity_;
+  size_t shard_absent_capacity_;
+  std::array<Shard, kShards> shards_;
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+  std::atomic<uint64_t> absent_hits_{0};
+  std::atomic<uint64_t> absent_checks_{0};
+  std::atomic<uint64_t> absent_stale_{0};
+
+  Shard &shardOf(const rocksdb::Slice &key) {
+    return shards_[std::hash<std::string_view>{}(key.ToStringView()) % kShards];
+  }
+  static size_t charge(const Entry &entry) { return entry.key.size() + entry.value.size() + kEntryOverhead; }
+  void insertEntry(Shard &shard, Entry entry);
+  static void eraseEntry(Shard &shard, Index::iterator iter);
+
+  // Rough memory cost of the list node and index slot of an entry
+  static constexpr size_t kEntryOverhead = 128;
+};
+
+}  // namespace engine
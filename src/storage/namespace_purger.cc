@@ -0,0 +1,106 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "namespace_purger.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "storage/redis_metadata.h"
+#include "string_util.h"
+
+Status NamespacePurger::Purge() {
+  auto begin_key = ComposeNamespaceKey(ns_, "", false);
+  auto end_key = util::StringNext(begin_key);
+
+  struct Piece {
+    // the index of the column family, since the handles are recreated if the storage is reopened
+    size_t cf_index;
+    std::string begin;
+    std::string end;
+    uint64_t bytes;
+  };
+  std::vector<Piece> pieces;
+  {
+    auto guard = storage_->ReadLockGuard();
+    if (storage_->IsClosing()) return {Status::NotOK, "storage is closing"};
+
+    std::vector<rocksdb::LiveFileMetaData> files;
+    storage_->GetDB()->GetLiveFilesMetaData(&files);
+    const auto &cf_handles = *storage_->GetCFHandles();
+    for (size_t cf_index = 0; cf_index < cf_handles.size(); cf_index++) {
+      auto cf = cf_handles[cf_index];
+      // the smallest keys of the SST files are well spread over the range, like RdbExporter
+      std::vector<std::string> split_keys;
+      for (const auto &file : files) {
+        if (file.column_family_name != cf->GetName()) continue;
+        if (file.smallestkey <= begin_key || file.smallestkey >= end_key) continue;
+        split_keys.emplace_back(file.smallestkey);
+      }
+      std::sort(split_keys.begin(), split_keys.end());
+      split_keys.erase(std::unique(split_keys.begin(), split_keys.end()), split_keys.end());
+
+      std::vector<std::string> bounds{begin_key};
+      size_t n_pieces = std::min(kMaxPieces, split_keys.size() + 1);
+      for (size_t i = 1; i < n_pieces; i++) {
+        const auto &key = split_keys[i * split_keys.size() / n_pieces];
+        if (key > bounds.back()) bounds.emplace_back(key);
+      }
+      bounds.emplace_back(end_key);
+
+      std::vector<rocksdb::Range> ranges;
+      for (size_t i = 0; i + 1 < bounds.size(); i++) {
+        ranges.emplace_back(bounds[i], bounds[i + 1]);
+      }
+      rocksdb::SizeApproximationOptions options;
+      options.include_memtables = true;
+      options.include_files = true;
+      std::vector<uint64_t> sizes(ranges.size(), 0);
+      auto s = storage_->GetDB()->GetApproximateSizes(options, cf, ranges.data(), static_cast<int>(ranges.size()),
+                                                      sizes.data());
+      if (!s.ok()) return {Status::NotOK, s.ToString()};
+
+      for (size_t i = 0; i < ranges.size(); i++) {
+        pieces.push_back({cf_index, bounds[i], bounds[i + 1], sizes[i]});
+        total_bytes_ += sizes[i];
+      }
+    }
+  }
+
+  for (const auto &piece : pieces) {
+    // the storage may be reopened between the pieces, e.g. by a full sync or a restore
+    auto guard = storage_->ReadLockGuard();
+    if (storage_->IsClosing()) return {Status::NotOK, "storage is closing"};
+
+    const auto &cf_handles = *storage_->GetCFHandles();
+    if (piece.cf_index >= cf_handles.size()) continue;
+
+    Slice begin(piece.begin), end(piece.end);
+    auto s = storage_->Compact(cf_handles[piece.cf_index], &begin, &end);
+    if (!s.ok()) return {Status::NotOK, s.ToString()};
+    purged_bytes_ += piece.bytes;
+  }
+
+  LOG(INFO) << "[namespace purge] Purged about " << GetPurgedBytes() << " bytes of namespace " << ns_ << " in "
+            << pieces.size() << " pieces";
+  return Status::OK();
+}
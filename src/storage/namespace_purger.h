@@ -0,0 +1,61 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "status.h"
+#include "storage/storage.h"
+
+// NamespacePurger reclaims the space of a flushed namespace in the background.
+//
+// FLUSHDB removes only the metadata of the namespace by one DeleteRange, so the namespace can
+// be written again at once: a new key gets a new version, and the subkeys left behind by the
+// flushed keys are never visible again. The version of the metadata works as the epoch of the
+// key, and the subkey compaction filter drops the subkeys without the metadata or of another
+// version. So the purger compacts the range of the namespace in all the column families, piece
+// by piece split by the SST files, to drop the data soon instead of whenever the compactions
+// happen to reach it. The compactions are charged to the I/O rate limiter as usual.
+class NamespacePurger {
+ public:
+  static constexpr size_t kMaxPieces = 16;
+
+  NamespacePurger(engine::Storage *storage, std::string ns) : storage_(storage), ns_(std::move(ns)) {}
+
+  NamespacePurger(const NamespacePurger &) = delete;
+  NamespacePurger &operator=(const NamespacePurger &) = delete;
+
+  Status Purge();
+
+  const std::string &GetNamespace() const { return ns_; }
+  // The approximate bytes of the namespace when the purge started, and the bytes of the compacted pieces
+  uint64_t GetTotalBytes() const { return total_bytes_.load(std::memory_order_relaxed); }
+  uint64_t GetPurgedBytes() const { return purged_bytes_.load(std::memory_order_relaxed); }
+
+ private:
+  engine::Storage *storage_;
+  std::string ns_;
+
+  std::atomic<uint64_t> total_bytes_ = 0;
+  std::atomic<uint64_t> purged_bytes_ = 0;
+};
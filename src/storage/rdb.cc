@@ -22,6 +22,13 @@
 
 #include <glog/logging.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <thread>
+
 #include "common/encoding.h"
 #include "common/rdb_stream.h"
 #include "common/time_util.h"
@@ -30,6 +37,7 @@
 #include "rdb_ziplist.h"
 #include "rdb_zipmap.h"
 #include "storage/redis_metadata.h"
+#include "thread_util.h"
 #include "time_util.h"
 #include "types/redis_bitmap.h"
 #include "types/redis_bitmap_string.h"
@@ -67,12 +75,73 @@ constexpr const int RDBOpcodeSelectDB = 254;     /* DB number of the following k
 constexpr const int RDBOpcodeEof = 255;          /* End of the RDB file. */
 
 constexpr const int SupportedRDBVersion = 10;  // not been tested for version 11, so use this version with caution.
+// The version of the exported RDB files, whose encodings are understood by Redis since 5.0
+constexpr const int RDBExportVersion = 9;
 
 constexpr const int RDBCheckSumLen = 8;                                        // rdb check sum length
 constexpr const int RestoreRdbVersionLen = 2;                                  // rdb version len in restore string
 constexpr const int RestoreFooterLen = RestoreRdbVersionLen + RDBCheckSumLen;  // 10 = ver len  + checksum len
 constexpr const int MinRdbVersionToVerifyChecksum = 5;
 
+// The objects of an RDB file are saved by the load workers, each of which writes the objects in batches
+constexpr const size_t RDBLoadWorkers = 4;
+constexpr const size_t RDBLoadBatchKeys = 512;
+// The max number of the decoded objects waiting to be saved, the reader blocks beyond it
+constexpr const size_t RDBLoadQueueObjects = 1024;
+
+namespace {
+
+struct RdbLoadObject {
+  int type;
+  std::string key;
+  RedisObjValue value;
+  uint64_t ttl_ms;
+};
+
+// RdbLoadQueue passes the objects decoded by the reader to the load workers
+class RdbLoadQueue {
+ public:
+  explicit RdbLoadQueue(size_t capacity) : capacity_(capacity) {}
+
+  // Push returns false if the queue is closed, e.g. a worker failed
+  bool Push(RdbLoadObject obj) {
+    std::unique_lock<std::mutex> lock(mu_);
+    not_full_cv_.wait(lock, [this] { return closed_ || objects_.size() < capacity_; });
+    if (closed_) return false;
+    objects_.emplace_back(std::move(obj));
+    not_empty_cv_.notify_one();
+    return true;
+  }
+
+  // Pop returns nullopt once the queue is closed and all its objects are popped
+  std::optional<RdbLoadObject> Pop() {
+    std::unique_lock<std::mutex> lock(mu_);
+    not_empty_cv_.wait(lock, [this] { return closed_ || !objects_.empty(); });
+    if (objects_.empty()) return std::nullopt;
+    auto obj = std::move(objects_.front());
+    objects_.pop_front();
+    not_full_cv_.notify_one();
+    return obj;
+  }
+
+  void Close() {
+    std::lock_guard<std::mutex> lock(mu_);
+    closed_ = true;
+    not_empty_cv_.notify_all();
+    not_full_cv_.notify_all();
+  }
+
+ private:
+  size_t capacity_;
+  std::mutex mu_;
+  std::condition_variable not_empty_cv_;
+  std::condition_variable not_full_cv_;
+  std::deque<RdbLoadObject> objects_;
+  bool closed_ = false;
+};
+
+}  // namespace
+
 template <typename T>
 T LogWhenError(T &&s) {
   if (!s) {
@@ -555,7 +624,11 @@ bool RDB::isEmptyRedisObject(const RedisObjValue &value) {
 }
 
 // Load RDB file: copy from redis/src/rdb.c:branch 7.0, 76b9c13d.
-Status RDB::LoadRdb(engine::Context &ctx, uint32_t db_index, bool overwrite_exist_key) {
+//
+// The objects are decoded by the calling thread and saved by RDBLoadWorkers threads, each of which groups
+// the writes of RDBLoadBatchKeys objects into one batch. A key appears at most once in a DB of an RDB file,
+// so the objects can be saved in any order.
+Status RDB::LoadRdb(engine::Context &ctx, uint32_t db_index, bool overwrite_exist_key, bool disable_wal) {
   char buf[1024] = {0};
   GET_OR_RET(LogWhenError(stream_->Read(buf, 9)));
   buf[9] = '\0';
@@ -571,117 +644,183 @@ Status RDB::LoadRdb(engine::Context &ctx, uint32_t db_index, bool overwrite_exis
     return {Status::NotOK, fmt::format("Can't handle RDB format version {}", rdb_ver)};
   }
 
+  std::atomic<int64_t> load_keys = 0;
+  std::atomic<uint64_t> skip_exist_keys = 0;
+  RdbLoadQueue queue(RDBLoadQueueObjects);
+
+  auto save_objects = [&, this]() -> Status {
+    // The context of the caller can't be shared between the workers, and the writes go to the batch of the worker
+    auto worker_ctx = engine::Context::NoTransactionContext(storage_);
+    GET_OR_RET(storage_->BeginTxn());
+    size_t batch_keys = 0;
+    while (auto obj = queue.Pop()) {
+      if (!overwrite_exist_key) {  // only load not exist key
+        redis::Database redis(storage_, ns_);
+        auto s = redis.KeyExist(worker_ctx, obj->key);
+        if (!s.IsNotFound()) {
+          skip_exist_keys++;  // skip it even it's not okay
+          if (!s.ok()) {
+            LOG(ERROR) << "check key " << obj->key << " exist failed: " << s.ToString();
+          }
+          continue;
+        }
+      }
+
+      auto ret = saveRdbObject(worker_ctx, obj->type, obj->key, obj->value, obj->ttl_ms);
+      if (!ret.IsOK()) {
+        LOG(WARNING) << "save rdb object key " << obj->key << " failed: " << ret.Msg();
+        continue;
+      }
+      load_keys++;
+      if (++batch_keys >= RDBLoadBatchKeys) {
+        GET_OR_RET(storage_->CommitTxn(disable_wal));
+        GET_OR_RET(storage_->BeginTxn());
+        batch_keys = 0;
+      }
+    }
+    return storage_->CommitTxn(disable_wal);
+  };
+
+  std::vector<Status> worker_statuses(RDBLoadWorkers);
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < RDBLoadWorkers; i++) {
+    auto t = util::CreateThread("rdb-load", [&, i] {
+      worker_statuses[i] = save_objects();
+      // the reader can't push the objects any longer if a worker fails
+      if (!worker_statuses[i]) queue.Close();
+    });
+    if (!t) {
+      LOG(WARNING) << "Failed to create the RDB load worker: " << t.Msg();
+      continue;
+    }
+    workers.emplace_back(std::move(*t));
+  }
+  if (workers.empty()) return {Status::NotOK, "Failed to create the RDB load workers"};
+
   uint64_t expire_time_ms = 0;
   int64_t expire_keys = 0;
-  int64_t load_keys = 0;
   int64_t empty_keys_skipped = 0;
   auto now_ms = util::GetTimeStampMS();
   uint32_t db_id = 0;
-  uint64_t skip_exist_keys = 0;
-  while (true) {
-    auto type = GET_OR_RET(LogWhenError(loadRdbType()));
-    if (type == RDBOpcodeExpireTime) {
-      expire_time_ms = static_cast<uint64_t>(GET_OR_RET(LogWhenError(loadExpiredTimeSeconds()))) * 1000;
-      continue;
-    } else if (type == RDBOpcodeExpireTimeMs) {
-      expire_time_ms = GET_OR_RET(LogWhenError(loadExpiredTimeMilliseconds(rdb_ver)));
-      continue;
-    } else if (type == RDBOpcodeFreq) {               // LFU frequency: not use in kvrocks
-      GET_OR_RET(LogWhenError(stream_->ReadByte()));  // discard the value
-      continue;
-    } else if (type == RDBOpcodeIdle) {  // LRU idle time: not use in kvrocks
-      uint64_t discard = 0;
-      GET_OR_RET(LogWhenError(stream_->Read(reinterpret_cast<char *>(&discard), sizeof(uint64_t))));
-      continue;
-    } else if (type == RDBOpcodeEof) {
-      break;
-    } else if (type == RDBOpcodeSelectDB) {
-      db_id = GET_OR_RET(LogWhenError(loadObjectLen(nullptr)));
-      continue;
-    } else if (type == RDBOpcodeResizeDB) {              // not use in kvrocks, hint redis for hash table resize
-      GET_OR_RET(LogWhenError(loadObjectLen(nullptr)));  // db_size
-      GET_OR_RET(LogWhenError(loadObjectLen(nullptr)));  // expires_size
-      continue;
-    } else if (type == RDBOpcodeAux) {
-      /* AUX: generic string-string fields. Use to add state to RDB
-       * which is backward compatible. Implementations of RDB loading
-       * are required to skip AUX fields they don't understand.
-       *
-       * An AUX field is composed of two strings: key and value. */
-      auto key = GET_OR_RET(LogWhenError(LoadStringObject()));
-      auto value = GET_OR_RET(LogWhenError(LoadStringObject()));
-      continue;
-    } else if (type == RDBOpcodeModuleAux) {
-      LOG(WARNING) << "RDB module not supported";
-      return {Status::NotOK, "RDB module not supported"};
-    } else if (type == RDBOpcodeFunction || type == RDBOpcodeFunction2) {
-      LOG(WARNING) << "RDB function not supported";
-      return {Status::NotOK, "RDB function not supported"};
-    } else {
-      if (!isObjectType(type)) {
-        LOG(WARNING) << "Invalid or Not supported object type: " << type;
-        return {Status::NotOK, fmt::format("Invalid or Not supported object type {}", type)};
+  auto read_objects = [&]() -> Status {
+    while (true) {
+      auto type = GET_OR_RET(LogWhenError(loadRdbType()));
+      if (type == RDBOpcodeExpireTime) {
+        expire_time_ms = static_cast<uint64_t>(GET_OR_RET(LogWhenError(loadExpiredTimeSeconds()))) * 1000;
+        continue;
+      } else if (type == RDBOpcodeExpireTimeMs) {
+        expire_time_ms = GET_OR_RET(LogWhenError(loadExpiredTimeMilliseconds(rdb_ver)));
+        continue;
+      } else if (type == RDBOpcodeFreq) {               // LFU frequency: not use in kvrocks
+        GET_OR_RET(LogWhenError(stream_->ReadByte()));  // discard the value
+        continue;
+      } else if (type == RDBOpcodeIdle) {  // LRU idle time: not use in kvrocks
+        uint64_t discard = 0;
+        GET_OR_RET(LogWhenError(stream_->Read(reinterpret_cast<char *>(&discard), sizeof(uint64_t))));
+        continue;
+      } else if (type == RDBOpcodeEof) {
+        break;
+      } else if (type == RDBOpcodeSelectDB) {
+        db_id = GET_OR_RET(LogWhenError(loadObjectLen(nullptr)));
+        continue;
+      } else if (type == RDBOpcodeResizeDB) {              // not use in kvrocks, hint redis for hash table resize
+        GET_OR_RET(LogWhenError(loadObjectLen(nullptr)));  // db_size
+        GET_OR_RET(LogWhenError(loadObjectLen(nullptr)));  // expires_size
+        continue;
+      } else if (type == RDBOpcodeAux) {
+        /* AUX: generic string-string fields. Use to add state to RDB
+         * which is backward compatible. Implementations of RDB loading
+         * are required to skip AUX fields they don't understand.
+         *
+         * An AUX field is composed of two strings: key and value. */
+        auto key = GET_OR_RET(LogWhenError(LoadStringObject()));
+        auto value = GET_OR_RET(LogWhenError(LoadStringObject()));
+        continue;
+      } else if (type == RDBOpcodeModuleAux) {
+        LOG(WARNING) << "RDB module not supported";
+        return {Status::NotOK, "RDB module not supported"};
+      } else if (type == RDBOpcodeFunction || type == RDBOpcodeFunction2) {
+        LOG(WARNING) << "RDB function not supported";
+        return {Status::NotOK, "RDB function not supported"};
+      } else {
+        if (!isObjectType(type)) {
+          LOG(WARNING) << "Invalid or Not supported object type: " << type;
+          return {Status::NotOK, fmt::format("Invalid or Not supported object type {}", type)};
+        }
       }
-    }
-
-    auto key = GET_OR_RET(LogWhenError(LoadStringObject()));
-    auto value = GET_OR_RET(LogWhenError(loadRdbObject(type, key)));
 
-    if (db_index != db_id) {  // skip db not match
-      continue;
-    }
+      auto key = GET_OR_RET(LogWhenError(LoadStringObject()));
+      auto value = GET_OR_RET(LogWhenError(loadRdbObject(type, key)));
+      // the expire time only applies to the object right after it
+      auto object_expire_time_ms = std::exchange(expire_time_ms, 0);
 
-    if (isEmptyRedisObject(value)) {  // compatible with empty value
-      /* Since we used to have bug that could lead to empty keys
-       * (See #8453), we rather not fail when empty key is encountered
-       * in an RDB file, instead we will silently discard it and
-       * continue loading. */
-      if (empty_keys_skipped++ < 10) {  // only log 10 empty keys, just as redis does.
-        LOG(WARNING) << "skipping empty key: " << key;
+      if (db_index != db_id) {  // skip db not match
+        continue;
       }
-      continue;
-    } else if (expire_time_ms != 0 &&
-               expire_time_ms < now_ms) {  // in redis this used to feed this deletion to any connected replicas
-      expire_keys++;
-      continue;
-    }
 
-    if (!overwrite_exist_key) {  // only load not exist key
-      redis::Database redis(storage_, ns_);
-      auto s = redis.KeyExist(ctx, key);
-      if (!s.IsNotFound()) {
-        skip_exist_keys++;  // skip it even it's not okay
-        if (!s.ok()) {
-          LOG(ERROR) << "check key " << key << " exist failed: " << s.ToString();
+      if (isEmptyRedisObject(value)) {  // compatible with empty value
+        /* Since we used to have bug that could lead to empty keys
+         * (See #8453), we rather not fail when empty key is encountered
+         * in an RDB file, instead we will silently discard it and
+         * continue loading. */
+        if (empty_keys_skipped++ < 10) {  // only log 10 empty keys, just as redis does.
+          LOG(WARNING) << "skipping empty key: " << key;
         }
         continue;
+      } else if (object_expire_time_ms != 0 && object_expire_time_ms <= now_ms) {
+        // in redis this used to feed this deletion to any connected replicas
+        expire_keys++;
+        continue;
+      }
+
+      uint64_t ttl_ms = object_expire_time_ms != 0 ? object_expire_time_ms - now_ms : 0;
+      if (!queue.Push({type, std::move(key), std::move(value), ttl_ms})) {
+        return {Status::NotOK, "Failed to save the RDB objects"};
       }
     }
 
-    auto ret = saveRdbObject(ctx, type, key, value, expire_time_ms);
-    if (!ret.IsOK()) {
-      LOG(WARNING) << "save rdb object key " << key << " failed: " << ret.Msg();
-    } else {
-      load_keys++;
+    // Verify the checksum if RDB version is >= 5
+    if (rdb_ver >= MinRdbVersionToVerifyChecksum) {
+      uint64_t chk_sum = 0;
+      auto expected = GET_OR_RET(LogWhenError(stream_->GetCheckSum()));
+      GET_OR_RET(LogWhenError(stream_->Read(reinterpret_cast<char *>(&chk_sum), RDBCheckSumLen)));
+      if (chk_sum == 0) {
+        LOG(WARNING) << "RDB file was saved with checksum disabled: no check performed.";
+      } else if (chk_sum != expected) {
+        LOG(WARNING) << "Wrong RDB checksum expected: " << chk_sum << " got: " << expected;
+        return {Status::NotOK, "All objects were processed and loaded but the checksum is unexpected!"};
+      }
+    }
+    return Status::OK();
+  };
+
+  auto s = read_objects();
+  // the workers save the objects left in the queue before exiting
+  queue.Close();
+  for (auto &worker : workers) {
+    if (auto join_status = util::ThreadJoin(worker); !join_status) {
+      LOG(WARNING) << "Failed to join the RDB load worker: " << join_status.Msg();
     }
   }
-
-  // Verify the checksum if RDB version is >= 5
-  if (rdb_ver >= MinRdbVersionToVerifyChecksum) {
-    uint64_t chk_sum = 0;
-    auto expected = GET_OR_RET(LogWhenError(stream_->GetCheckSum()));
-    GET_OR_RET(LogWhenError(stream_->Read(reinterpret_cast<char *>(&chk_sum), RDBCheckSumLen)));
-    if (chk_sum == 0) {
-      LOG(WARNING) << "RDB file was saved with checksum disabled: no check performed.";
-    } else if (chk_sum != expected) {
-      LOG(WARNING) << "Wrong RDB checksum expected: " << chk_sum << " got: " << expected;
-      return {Status::NotOK, "All objects were processed and loaded but the checksum is unexpected!"};
+  for (auto &worker_status : worker_statuses) {
+    if (!worker_status) {
+      LOG(WARNING) << "Failed to save the RDB objects: " << worker_status.Msg();
+      return worker_status;
     }
   }
+  // The objects written without the WAL are durable once the memtables are flushed
+  if (disable_wal) {
+    auto flush_status = storage_->FlushMemTables();
+    if (!flush_status.ok()) return {Status::NotOK, flush_status.ToString()};
+  }
+  // The objects aren't written through the context, it has to see them by a new snapshot
+  if (ctx.is_txn_mode) ctx.RefreshLatestSnapshot();
+  if (!s) return s;
 
-  std::string skip_info = (overwrite_exist_key ? ", exist keys skipped: " + std::to_string(skip_exist_keys) : "");
+  std::string skip_info =
+      (overwrite_exist_key ? ", exist keys skipped: " + std::to_string(skip_exist_keys.load()) : "");
 
-  LOG(INFO) << "Done loading RDB,  keys loaded: " << load_keys << ", keys expired:" << expire_keys
+  LOG(INFO) << "Done loading RDB,  keys loaded: " << load_keys.load() << ", keys expired:" << expire_keys
             << ", empty keys skipped: " << empty_keys_skipped << skip_info;
 
   return Status::OK();
@@ -719,6 +858,33 @@ Status RDB::Dump(const std::string &key, const RedisType type) {
   return stream_->Write((const char *)(&crc), 8);
 }
 
+Status RDB::SaveHeader() {
+  auto header = fmt::format("REDIS{:04d}", RDBExportVersion);
+  GET_OR_RET(stream_->Write(header.data(), header.size()));
+  auto opcode = static_cast<char>(RDBOpcodeSelectDB);
+  GET_OR_RET(stream_->Write(&opcode, 1));
+  return RdbSaveLen(0);
+}
+
+Status RDB::SaveFooter() {
+  auto opcode = static_cast<char>(RDBOpcodeEof);
+  GET_OR_RET(stream_->Write(&opcode, 1));
+  auto crc = GET_OR_RET(stream_->GetCheckSum());
+  return stream_->Write(reinterpret_cast<const char *>(&crc), RDBCheckSumLen);
+}
+
+Status RDB::SaveKeyValue(engine::Context &ctx, const std::string &key, RedisType type, uint64_t expire_ms) {
+  if (expire_ms > 0) {
+    auto opcode = static_cast<char>(RDBOpcodeExpireTimeMs);
+    GET_OR_RET(stream_->Write(&opcode, 1));
+    memrev64ifbe(&expire_ms);
+    GET_OR_RET(stream_->Write(reinterpret_cast<const char *>(&expire_ms), 8));
+  }
+  GET_OR_RET(SaveObjectType(type));
+  GET_OR_RET(SaveStringObject(key));
+  return SaveObject(ctx, key, type);
+}
+
 Status RDB::SaveObjectType(const RedisType type) {
   int robj_type = -1;
   if (type == kRedisString || type == kRedisBitmap) {
@@ -740,6 +906,10 @@ Status RDB::SaveObjectType(const RedisType type) {
 
 Status RDB::SaveObject(const std::string &key, const RedisType type) {
   engine::Context ctx(storage_);
+  return SaveObject(ctx, key, type);
+}
+
+Status RDB::SaveObject(engine::Context &ctx, const std::string &key, const RedisType type) {
   if (type == kRedisString) {
     std::string value;
     redis::String string_db(storage_, ns_);
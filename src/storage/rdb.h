@@ -104,8 +104,9 @@ class RDB {
   StatusOr<std::vector<std::string>> LoadListWithZipList();
   StatusOr<std::vector<std::string>> LoadListWithQuickList(int type);
 
-  // Load rdb
-  Status LoadRdb(engine::Context &ctx, uint32_t db_index, bool overwrite_exist_key = true);
+  // Load rdb, the objects are written without the WAL and flushed at last if disable_wal is true,
+  // which must only be set if no replica would miss them
+  Status LoadRdb(engine::Context &ctx, uint32_t db_index, bool overwrite_exist_key = true, bool disable_wal = false);
 
   std::unique_ptr<RdbStream> &GetStream() { return stream_; }
 
@@ -113,6 +114,14 @@ class RDB {
 
   Status SaveObjectType(RedisType type);
   Status SaveObject(const std::string &key, RedisType type);
+  Status SaveObject(engine::Context &ctx, const std::string &key, RedisType type);
+
+  // The header and the footer of an RDB file with the objects of DB 0, the checksum of the footer covers
+  // all the bytes written to the stream
+  Status SaveHeader();
+  Status SaveFooter();
+  // SaveKeyValue saves the expire time, the type, the key and the value of an object of an RDB file
+  Status SaveKeyValue(engine::Context &ctx, const std::string &key, RedisType type, uint64_t expire_ms);
   Status RdbSaveLen(uint64_t len);
 
   // String
@@ -0,0 +1,183 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "rdb_exporter.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include "common/rdb_stream.h"
+#include "db_util.h"
+#include "rdb.h"
+#include "storage/redis_metadata.h"
+#include "string_util.h"
+#include "thread_util.h"
+
+namespace {
+
+// The types with an RDB encoding, see RDB::SaveObjectType
+bool IsExportedType(RedisType type) {
+  return type == kRedisString || type == kRedisBitmap || type == kRedisHash || type == kRedisList ||
+         type == kRedisSet || type == kRedisZSet;
+}
+
+}  // namespace
+
+Status RdbExporter::Export() {
+  auto prefix = ComposeNamespaceKey(ns_, "", false);
+  std::shared_ptr<const rocksdb::Snapshot> snapshot;
+  {
+    auto guard = storage_->ReadLockGuard();
+    snapshot = storage_->GetSharedSnapshot(false);
+  }
+  // The context only reads, so it's shared by the threads
+  auto ctx = engine::Context::SnapshotContext(storage_, std::move(snapshot));
+
+  // the smallest keys of the SST files are well spread over the key space, like Database::ScanKeyNumStats
+  std::vector<std::string> split_keys;
+  std::vector<rocksdb::LiveFileMetaData> files;
+  storage_->GetDB()->GetLiveFilesMetaData(&files);
+  for (const auto &file : files) {
+    if (file.column_family_name != kMetadataColumnFamilyName) continue;
+    if (!Slice(file.smallestkey).starts_with(prefix)) continue;
+    split_keys.emplace_back(file.smallestkey);
+  }
+  std::sort(split_keys.begin(), split_keys.end());
+  split_keys.erase(std::unique(split_keys.begin(), split_keys.end()), split_keys.end());
+
+  // bounds[i] and bounds[i + 1] are the start and the limit of the i-th range
+  std::vector<std::string> bounds{prefix};
+  size_t n_ranges = std::min(kExportThreads, split_keys.size() + 1);
+  for (size_t i = 1; i < n_ranges; i++) {
+    const auto &key = split_keys[i * split_keys.size() / n_ranges];
+    if (key > bounds.back()) bounds.emplace_back(key);
+  }
+  bounds.emplace_back(util::StringNext(prefix));
+
+  n_ranges = bounds.size() - 1;
+  std::vector<Status> statuses(n_ranges);
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < n_ranges; i++) {
+    auto t = util::CreateThread("rdb-export", [&, i] {
+      statuses[i] = exportRange(ctx, prefix, bounds[i], bounds[i + 1], partPath(i));
+    });
+    if (!t) {
+      // fall back to export the range in the current thread
+      statuses[i] = exportRange(ctx, prefix, bounds[i], bounds[i + 1], partPath(i));
+      continue;
+    }
+    workers.emplace_back(std::move(*t));
+  }
+  statuses[0] = exportRange(ctx, prefix, bounds[0], bounds[1], partPath(0));
+  for (auto &worker : workers) {
+    if (auto s = util::ThreadJoin(worker); !s) {
+      LOG(WARNING) << "[rdb export] Failed to join the export thread: " << s.Msg();
+    }
+  }
+
+  auto s = [&]() -> Status {
+    for (const auto &status : statuses) {
+      if (!status) return status;
+    }
+
+    // The file is written under a temporary name, so an unfinished file is never taken as an RDB file
+    auto tmp_path = path_ + ".tmp";
+    RDB rdb(storage_, ns_, std::make_unique<RdbFileWriteStream>(tmp_path));
+    auto stream = static_cast<RdbFileWriteStream *>(rdb.GetStream().get());
+    GET_OR_RET(stream->Open());
+    GET_OR_RET(rdb.SaveHeader());
+    std::string buf(1024 * 1024, '\0');
+    for (size_t i = 0; i < n_ranges; i++) {
+      std::ifstream part(partPath(i), std::ifstream::in | std::ifstream::binary);
+      if (!part.is_open()) return {Status::NotOK, fmt::format("failed to open the part file {}", partPath(i))};
+      while (part) {
+        part.read(buf.data(), static_cast<std::streamsize>(buf.size()));
+        GET_OR_RET(stream->Write(buf.data(), static_cast<size_t>(part.gcount())));
+      }
+      if (!part.eof()) return {Status::NotOK, fmt::format("failed to read the part file {}", partPath(i))};
+    }
+    GET_OR_RET(rdb.SaveFooter());
+    GET_OR_RET(stream->Close());
+    if (std::rename(tmp_path.c_str(), path_.c_str()) != 0) {
+      return {Status::NotOK, fmt::format("failed to rename the RDB file: {}", strerror(errno))};
+    }
+    return Status::OK();
+  }();
+
+  for (size_t i = 0; i < n_ranges; i++) {
+    std::remove(partPath(i).c_str());
+  }
+  if (s) {
+    LOG(INFO) << "[rdb export] Exported " << GetExportedKeys() << " keys of namespace " << ns_ << " to " << path_
+              << ", " << GetSkippedKeys() << " keys are skipped";
+  }
+  return s;
+}
+
+Status RdbExporter::exportRange(engine::Context &ctx, const std::string &prefix, const std::string &start,
+                                const std::string &limit, const std::string &part_path) {
+  RdbFileWriteStream part_stream(part_path);
+  GET_OR_RET(part_stream.Open());
+  // Each object is encoded into the buffer first, so a failed one leaves nothing in the part file
+  RDB rdb(storage_, ns_, std::make_unique<RdbStringStream>(""));
+  auto &buf = static_cast<RdbStringStream *>(rdb.GetStream().get())->GetInput();
+
+  auto read_options = ctx.DefaultScanOptions();
+  Slice upper_bound(limit);
+  if (!limit.empty()) read_options.iterate_upper_bound = &upper_bound;
+  auto iter = util::UniqueIterator(ctx, read_options, ColumnFamilyID::Metadata);
+  auto rate_limiter = storage_->GetIORateLimiter();
+
+  for (iter->Seek(start); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
+    Metadata metadata(kRedisNone, false);
+    if (!metadata.Decode(iter->value()).ok() || metadata.Expired()) continue;
+    if (!IsExportedType(metadata.Type())) {
+      skipped_keys_++;
+      continue;
+    }
+
+    auto [_, user_key] = ExtractNamespaceKey(iter->key(), storage_->IsSlotIdEncoded());
+    buf.clear();
+    auto s = rdb.SaveKeyValue(ctx, user_key.ToString(), metadata.Type(), metadata.expire);
+    if (!s) {
+      LOG(WARNING) << "[rdb export] Failed to export the key " << user_key.ToString() << ": " << s.Msg();
+      skipped_keys_++;
+      continue;
+    }
+    GET_OR_RET(part_stream.Write(buf.data(), buf.size()));
+    exported_keys_++;
+
+    if (rate_limiter) {
+      for (auto left = static_cast<int64_t>(buf.size()); left > 0;) {
+        auto bytes = std::min(left, rate_limiter->GetSingleBurstBytes());
+        rate_limiter->Request(bytes, rocksdb::Env::IOPriority::IO_LOW, nullptr);
+        left -= bytes;
+      }
+    }
+  }
+  if (!iter->status().ok()) return {Status::NotOK, iter->status().ToString()};
+
+  return part_stream.Close();
+}
@@ -0,0 +1,67 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "status.h"
+#include "storage/storage.h"
+
+// RdbExporter writes the keys of a namespace to a Redis-compatible RDB file in the background.
+//
+// All the keys are read from one snapshot, so the file is a consistent view of the namespace.
+// The metadata column family is split into kExportThreads ranges by the smallest keys of the SST
+// files, and each range is written to a part file by a thread. The parts are concatenated into
+// the RDB file at last, and the checksum is computed while they are copied. The reads are charged
+// to the I/O rate limiter.
+//
+// The types without an RDB encoding in Redis, e.g. streams and JSON, are skipped.
+class RdbExporter {
+ public:
+  static constexpr size_t kExportThreads = 4;
+
+  RdbExporter(engine::Storage *storage, std::string ns, std::string path)
+      : storage_(storage), ns_(std::move(ns)), path_(std::move(path)) {}
+
+  RdbExporter(const RdbExporter &) = delete;
+  RdbExporter &operator=(const RdbExporter &) = delete;
+
+  Status Export();
+
+  const std::string &GetPath() const { return path_; }
+  uint64_t GetExportedKeys() const { return exported_keys_.load(std::memory_order_relaxed); }
+  uint64_t GetSkippedKeys() const { return skipped_keys_.load(std::memory_order_relaxed); }
+
+ private:
+  engine::Storage *storage_;
+  std::string ns_;
+  std::string path_;
+
+  std::atomic<uint64_t> exported_keys_ = 0;
+  std::atomic<uint64_t> skipped_keys_ = 0;
+
+  // exportRange writes the objects of the keys in [start, limit) to the part file, an empty limit means unbounded
+  Status exportRange(engine::Context &ctx, const std::string &prefix, const std::string &start,
+                     const std::string &limit, const std::string &part_path);
+  std::string partPath(size_t i) const { return path_ + ".part" + std::to_string(i); }
+};
@@ -20,6 +20,8 @@
 
 #include "redis_db.h"
 
+#include <algorithm>
+#include <array>
 #include <ctime>
 #include <map>
 #include <utility>
@@ -34,12 +36,16 @@
 #include "storage/iterator.h"
 #include "storage/redis_metadata.h"
 #include "storage/storage.h"
+#include "string_util.h"
+#include "thread_util.h"
 #include "time_util.h"
 #include "types/redis_hash.h"
 #include "types/redis_list.h"
 #include "types/redis_set.h"
 #include "types/redis_string.h"
 #include "types/redis_zset.h"
+#include "types/sample_helper.h"
+#include "vendor/crc64.h"
 
 namespace redis {
 
@@ -104,8 +110,123 @@ rocksdb::Status Database::GetMetadata(engine::Context &ctx, RedisTypes types, co
   return ParseMetadata(types, rest, metadata);
 }
 
+rocksdb::Status Database::GetMetadataAndSubKey(engine::Context &ctx, RedisTypes types, const Slice &ns_key,
+                                               const Slice &sub_key, Metadata *metadata, std::string *value,
+                                               rocksdb::Status *sub_key_status) {
+  auto subkey_cf_handle = storage_->GetCFHandle(ColumnFamilyID::PrimarySubkey);
+  auto metadata_cache = storage_->GetMetadataCache();
+  std::string cached_bytes;
+  Metadata cached(kRedisNone, false);
+  if (ctx.is_txn_mode && metadata_cache && metadata_cache->Lookup(ns_key, &cached_bytes) &&
+      cached.Decode(cached_bytes).ok() && !cached.IsSingleKVType()) {
+    if (auto cache_warmup = storage_->GetCacheWarmup()) cache_warmup->Record(ns_key);
+
+    std::string guessed_sub_key = InternalKey(ns_key, sub_key, cached.version, storage_->IsSlotIdEncoded()).Encode();
+    std::array<rocksdb::ColumnFamilyHandle *, 2> cf_handles{metadata_cf_handle_, subkey_cf_handle};
+    std::array<Slice, 2> keys{ns_key, guessed_sub_key};
+    std::array<rocksdb::PinnableSlice, 2> values;
+    std::array<rocksdb::Status, 2> statuses;
+    storage_->MultiGet(ctx, ctx.DefaultMultiGetOptions(), cf_handles.data(), keys.size(), keys.data(), values.data(),
+                       statuses.data());
+    if (!statuses[0].ok()) return statuses[0];
+
+    Slice rest(values[0].data(), values[0].size());
+    auto s = ParseMetadata(types, &rest, metadata);
+    if (!s.ok()) return s;
+    if (metadata->version == cached.version) {
+      *sub_key_status = statuses[1];
+      if (statuses[1].ok()) value->assign(values[1].data(), values[1].size());
+      return s;
+    }
+    // the key has been rewritten since the snapshot, so the subkey of its version on the snapshot is read below
+  } else {
+    auto s = GetMetadata(ctx, types, ns_key, metadata);
+    if (!s.ok()) return s;
+  }
+
+  std::string internal_key = InternalKey(ns_key, sub_key, metadata->version, storage_->IsSlotIdEncoded()).Encode();
+  *sub_key_status = storage_->Get(ctx, ctx.GetReadOptions(), subkey_cf_handle, internal_key, value);
+  return rocksdb::Status::OK();
+}
+
 rocksdb::Status Database::GetRawMetadata(engine::Context &ctx, const Slice &ns_key, std::string *bytes) {
-  return storage_->Get(ctx, ctx.GetReadOptions(), metadata_cf_handle_, ns_key, bytes);
+  return storage_->GetRawMetadata(ctx, ns_key, bytes);
+}
+
+std::vector<rocksdb::Status> Database::MultiGetRawMetadata(engine::Context &ctx, const std::vector<Slice> &ns_keys,
+                                                           std::vector<std::string> *raw_values) {
+  raw_values->clear();
+  raw_values->resize(ns_keys.size());
+
+  std::vector<rocksdb::Status> statuses(ns_keys.size());
+  std::vector<rocksdb::PinnableSlice> pin_values(ns_keys.size());
+  storage_->MultiGet(ctx, ctx.DefaultMultiGetOptions(), metadata_cf_handle_, ns_keys.size(), ns_keys.data(),
+                     pin_values.data(), statuses.data());
+  for (size_t i = 0; i < ns_keys.size(); i++) {
+    if (statuses[i].ok()) (*raw_values)[i].assign(pin_values[i].data(), pin_values[i].size());
+  }
+  return statuses;
+}
+
+std::vector<rocksdb::Status> Database::MultiGetSubKeys(engine::Context &ctx, const Slice &ns_key,
+                                                       const Metadata &metadata, const std::vector<Slice> &sub_keys,
+                                                       std::vector<std::string> *values) {
+  values->clear();
+  values->resize(sub_keys.size());
+
+  std::vector<std::string> internal_keys;
+  internal_keys.reserve(sub_keys.size());
+  std::vector<Slice> keys;
+  keys.reserve(sub_keys.size());
+  for (const auto &sub_key : sub_keys) {
+    internal_keys.emplace_back(InternalKey(ns_key, sub_key, metadata.version, storage_->IsSlotIdEncoded()).Encode());
+    keys.emplace_back(internal_keys.back());
+  }
+
+  std::vector<rocksdb::Status> statuses(keys.size());
+  std::vector<rocksdb::PinnableSlice> pin_values(keys.size());
+  storage_->MultiGet(ctx, ctx.DefaultMultiGetOptions(), storage_->GetDB()->DefaultColumnFamily(), keys.size(),
+                     keys.data(), pin_values.data(), statuses.data());
+  for (size_t i = 0; i < keys.size(); i++) {
+    if (statuses[i].ok()) (*values)[i].assign(pin_values[i].data(), pin_values[i].size());
+  }
+  return statuses;
+}
+
+rocksdb::Status Database::SampleSubKeys(engine::Context &ctx, const Slice &ns_key, const Metadata &metadata,
+                                        std::mt19937_64 &gen, size_t n,
+                                        std::vector<std::pair<std::string, std::string>> *subkeys) {
+  subkeys->clear();
+  std::string prefix = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
+  std::string next_version_prefix = InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
+
+  rocksdb::ReadOptions read_options = ctx.SubKeyScanOptions(n);
+  rocksdb::Slice upper_bound(next_version_prefix);
+  read_options.iterate_upper_bound = &upper_bound;
+  rocksdb::Slice lower_bound(prefix);
+  read_options.iterate_lower_bound = &lower_bound;
+  auto iter = util::UniqueIterator(ctx, read_options);
+  auto sub_key = [this, &iter] { return InternalKey(iter->key(), storage_->IsSlotIdEncoded()).GetSubKey().ToString(); };
+
+  iter->SeekToLast();
+  if (!iter->Valid()) return iter->status();
+  std::string last = sub_key();
+  iter->Seek(prefix);
+  if (!iter->Valid()) return iter->status();
+  std::string first = sub_key();
+
+  auto point = RandomKeyBetween(gen, first, last);
+  iter->Seek(InternalKey(ns_key, point, metadata.version, storage_->IsSlotIdEncoded()).Encode());
+  for (bool wrapped = false; subkeys->size() < n; iter->Next()) {
+    if (!iter->Valid()) {
+      if (!iter->status().ok() || wrapped) break;
+      wrapped = true;
+      iter->Seek(prefix);
+      if (!iter->Valid()) break;
+    }
+    subkeys->emplace_back(sub_key(), iter->value().ToString());
+  }
+  return iter->status();
 }
 
 rocksdb::Status Database::Expire(engine::Context &ctx, const Slice &user_key, uint64_t timestamp) {
@@ -163,7 +284,8 @@ rocksdb::Status Database::Del(engine::Context &ctx, const Slice &user_key) {
   return storage_->Delete(ctx, storage_->DefaultWriteOptions(), metadata_cf_handle_, ns_key);
 }
 
-rocksdb::Status Database::MDel(engine::Context &ctx, const std::vector<Slice> &keys, uint64_t *deleted_cnt) {
+rocksdb::Status Database::MDel(engine::Context &ctx, const std::vector<Slice> &keys, uint64_t *deleted_cnt,
+                               bool lazy_free) {
   *deleted_cnt = 0;
 
   std::vector<std::string> lock_keys;
@@ -187,30 +309,57 @@ rocksdb::Status Database::MDel(engine::Context &ctx, const std::vector<Slice> &k
     slice_keys.emplace_back(ns_key);
   }
 
-  std::vector<rocksdb::Status> statuses(slice_keys.size());
-  std::vector<rocksdb::PinnableSlice> pin_values(slice_keys.size());
-  storage_->MultiGet(ctx, ctx.GetReadOptions(), metadata_cf_handle_, slice_keys.size(), slice_keys.data(),
-                     pin_values.data(), statuses.data());
+  std::vector<std::string> values;
+  auto statuses = MultiGetRawMetadata(ctx, slice_keys, &values);
+
+  // The subkeys can't be removed before the transaction commits
+  int lazyfree_min_size = storage_->GetConfig()->lazyfree_min_size;
+  bool may_lazy_free = !storage_->InTxn() && (lazy_free || lazyfree_min_size > 0);
+  std::vector<engine::LazyFreeQueue::Entry> lazy_free_entries;
 
   for (size_t i = 0; i < slice_keys.size(); i++) {
     if (!statuses[i].ok() && !statuses[i].IsNotFound()) return statuses[i];
     if (statuses[i].IsNotFound()) continue;
 
     Metadata metadata(kRedisNone, false);
-    // Explicit construct a rocksdb::Slice to avoid the implicit conversion from
-    // PinnableSlice to Slice.
-    auto s = metadata.Decode(rocksdb::Slice(pin_values[i].data(), pin_values[i].size()));
+    auto s = metadata.Decode(values[i]);
     if (!s.ok()) continue;
     if (metadata.Expired()) continue;
 
     s = batch->Delete(metadata_cf_handle_, lock_keys[i]);
     if (!s.ok()) return s;
     *deleted_cnt += 1;
+
+    if (may_lazy_free && !metadata.IsSingleKVType() && metadata.size > 0 &&
+        (lazy_free || metadata.size >= static_cast<uint64_t>(lazyfree_min_size))) {
+      lazy_free_entries.push_back({lock_keys[i], metadata.version, metadata.Type(),
+                                   ApproximateSubKeySize(lock_keys[i], metadata)});
+    }
   }
 
   if (*deleted_cnt == 0) return rocksdb::Status::OK();
 
-  return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+  s = storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+  if (!s.ok()) return s;
+
+  for (auto &entry : lazy_free_entries) {
+    storage_->GetLazyFreeQueue()->Push(std::move(entry));
+  }
+  return rocksdb::Status::OK();
+}
+
+uint64_t Database::ApproximateSubKeySize(const std::string &ns_key, const Metadata &metadata) {
+  std::string begin = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
+  std::string end = InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
+  auto subkey_cf = metadata.Type() == kRedisStream ? ColumnFamilyID::Stream : ColumnFamilyID::PrimarySubkey;
+
+  rocksdb::SizeApproximationOptions option;
+  option.include_memtables = true;
+  option.include_files = true;
+  rocksdb::Range range(begin, end);
+  uint64_t size = 0;
+  auto s = storage_->GetDB()->GetApproximateSizes(option, storage_->GetCFHandle(subkey_cf), &range, 1, &size);
+  return s.ok() ? size : 0;
 }
 
 rocksdb::Status Database::Exists(engine::Context &ctx, const std::vector<Slice> &keys, int *ret) {
@@ -252,6 +401,92 @@ rocksdb::Status Database::GetKeyNumStats(engine::Context &ctx, const std::string
   return Keys(ctx, prefix, nullptr, stats);
 }
 
+rocksdb::Status Database::ScanKeyNumStats(engine::Context &ctx, int threads, KeyNumStats *stats) {
+  std::string ns_prefix;
+  if (namespace_ != kDefaultNamespace) {
+    ns_prefix = ComposeNamespaceKey(namespace_, "", false);
+  }
+
+  // the smallest keys of the SST files are well spread over the key space,
+  // so they are used as the split points without reading any data
+  std::vector<std::string> split_keys;
+  if (threads > 1) split_keys = metadataSplitKeys(ns_prefix, ns_prefix.empty() ? "" : util::StringNext(ns_prefix));
+
+  // bounds[i] and bounds[i + 1] are the start and the limit of the i-th range
+  std::vector<std::string> bounds{ns_prefix};
+  size_t n_ranges = std::min(static_cast<size_t>(std::max(threads, 1)), split_keys.size() + 1);
+  for (size_t i = 1; i < n_ranges; i++) {
+    const auto &key = split_keys[i * split_keys.size() / n_ranges];
+    if (key > bounds.back()) bounds.emplace_back(key);
+  }
+  bounds.emplace_back("");
+
+  n_ranges = bounds.size() - 1;
+  std::vector<KeyNumStats> range_stats(n_ranges);
+  std::vector<uint64_t> ttl_sums(n_ranges, 0);
+  std::vector<rocksdb::Status> statuses(n_ranges);
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < n_ranges; i++) {
+    auto t = util::CreateThread("dbsize-scan", [&, i] {
+      statuses[i] = scanKeyNumRange(ctx, ns_prefix, bounds[i], bounds[i + 1], &range_stats[i], &ttl_sums[i]);
+    });
+    if (!t) {
+      // fall back to scan the range in the current thread
+      statuses[i] = scanKeyNumRange(ctx, ns_prefix, bounds[i], bounds[i + 1], &range_stats[i], &ttl_sums[i]);
+      continue;
+    }
+    workers.emplace_back(std::move(*t));
+  }
+  statuses[0] = scanKeyNumRange(ctx, ns_prefix, bounds[0], bounds[1], &range_stats[0], &ttl_sums[0]);
+  for (auto &worker : workers) {
+    if (auto s = util::ThreadJoin(worker); !s) {
+      LOG(WARNING) << "failed to join the dbsize scan thread: " << s.Msg();
+    }
+  }
+
+  uint64_t ttl_sum = 0;
+  for (size_t i = 0; i < n_ranges; i++) {
+    if (!statuses[i].ok()) return statuses[i];
+    stats->n_key += range_stats[i].n_key;
+    stats->n_expires += range_stats[i].n_expires;
+    stats->n_expired += range_stats[i].n_expired;
+    ttl_sum += ttl_sums[i];
+  }
+  if (stats->n_expires > 0) {
+    stats->avg_ttl = ttl_sum / stats->n_expires / 1000;
+  }
+
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status Database::scanKeyNumRange(engine::Context &ctx, const std::string &prefix, const std::string &start,
+                                          const std::string &limit, KeyNumStats *stats, uint64_t *ttl_sum) {
+  auto read_options = ctx.DefaultScanOptions();
+  Slice upper_bound(limit);
+  if (!limit.empty()) read_options.iterate_upper_bound = &upper_bound;
+  auto iter = util::UniqueIterator(ctx, read_options, metadata_cf_handle_);
+
+  engine::ExpiredMetadataSkipper skipper(storage_);
+  start.empty() ? iter->SeekToFirst() : iter->Seek(start);
+  for (; iter->Valid(); iter->Next()) {
+    if (!prefix.empty() && !iter->key().starts_with(prefix)) break;
+    // only the live metadata is decoded for its TTL
+    if (skipper.Skip(iter->key(), iter->value())) continue;
+    Metadata metadata(kRedisNone, false);
+    auto s = metadata.Decode(iter->value());
+    if (!s.ok()) continue;
+    int64_t ttl = metadata.TTL();
+    stats->n_key++;
+    if (ttl != -1) {
+      stats->n_expires++;
+      if (ttl > 0) *ttl_sum += ttl;
+    }
+  }
+  stats->n_expired += skipper.GetExpired();
+
+  return iter->status();
+}
+
 rocksdb::Status Database::Keys(engine::Context &ctx, const std::string &prefix, std::vector<std::string> *keys,
                                KeyNumStats *stats) {
   uint16_t slot_id = 0;
@@ -270,6 +505,7 @@ rocksdb::Status Database::Keys(engine::Context &ctx, const std::string &prefix,
 
   uint64_t ttl_sum = 0;
   auto iter = util::UniqueIterator(ctx, ctx.GetReadOptions(), metadata_cf_handle_);
+  engine::ExpiredMetadataSkipper skipper(storage_);
 
   while (true) {
     ns_prefix.empty() ? iter->SeekToFirst() : iter->Seek(ns_prefix);
@@ -277,14 +513,11 @@ rocksdb::Status Database::Keys(engine::Context &ctx, const std::string &prefix,
       if (!ns_prefix.empty() && !iter->key().starts_with(ns_prefix)) {
         break;
       }
-      Metadata metadata(kRedisNone, false);
-      auto s = metadata.Decode(iter->value());
-      if (!s.ok()) continue;
-      if (metadata.Expired()) {
-        if (stats) stats->n_expired++;
-        continue;
-      }
+      if (skipper.Skip(iter->key(), iter->value())) continue;
       if (stats) {
+        // only the live metadata is decoded for its TTL
+        Metadata metadata(kRedisNone, false);
+        if (!metadata.Decode(iter->value()).ok()) continue;
         int64_t ttl = metadata.TTL();
         stats->n_key++;
         if (ttl != -1) {
@@ -311,6 +544,7 @@ rocksdb::Status Database::Keys(engine::Context &ctx, const std::string &prefix,
     ns_prefix.append(prefix);
   }
 
+  if (stats) stats->n_expired += skipper.GetExpired();
   if (stats && stats->n_expires > 0) {
     stats->avg_ttl = ttl_sum / stats->n_expires / 1000;
   }
@@ -320,14 +554,26 @@ rocksdb::Status Database::Keys(engine::Context &ctx, const std::string &prefix,
 
 rocksdb::Status Database::Scan(engine::Context &ctx, const std::string &cursor, uint64_t limit,
                                const std::string &prefix, std::vector<std::string> *keys, std::string *end_cursor,
-                               RedisType type) {
+                               RedisType type, const std::string &pattern, uint64_t time_budget_us) {
   end_cursor->clear();
   uint64_t cnt = 0;
   uint16_t slot_start = 0;
   std::string ns_prefix;
   std::string user_key;
 
-  auto iter = util::UniqueIterator(ctx, ctx.GetReadOptions(), metadata_cf_handle_);
+  // The iterator never steps over the tombstones out of the prefix, or out of the namespace
+  // if the slot id is encoded since the prefix is sought slot by slot
+  std::string upper_key = util::StringNext(storage_->IsSlotIdEncoded() ? ComposeNamespaceKey(namespace_, "", false)
+                                                                      : AppendNamespacePrefix(prefix));
+  Slice upper_bound(upper_key);
+  auto read_options = ctx.GetReadOptions();
+  read_options.iterate_upper_bound = &upper_bound;
+  auto iter = util::UniqueIterator(ctx, read_options, metadata_cf_handle_);
+  engine::ExpiredMetadataSkipper skipper(storage_);
+
+  uint64_t deadline = time_budget_us > 0 ? util::GetTimeStampUS() + time_budget_us : 0;
+  uint64_t visited = 0;
+  bool out_of_time = false;
 
   std::string ns_cursor = AppendNamespacePrefix(cursor);
   if (storage_->IsSlotIdEncoded()) {
@@ -358,22 +604,28 @@ rocksdb::Status Database::Scan(engine::Context &ctx, const std::string &cursor,
       if (!ns_prefix.empty() && !iter->key().starts_with(ns_prefix)) {
         break;
       }
-      Metadata metadata(kRedisNone, false);
-      auto s = metadata.Decode(iter->value());
-      if (!s.ok()) continue;
-
-      if (type != kRedisNone && type != metadata.Type()) continue;
+      if (scanKeyMatched(iter->key(), iter->value(), type, pattern, &skipper, &user_key)) {
+        keys->emplace_back(user_key);
+        cnt++;
+      }
 
-      if (metadata.Expired()) continue;
-      std::tie(std::ignore, user_key) = ExtractNamespaceKey<std::string>(iter->key(), storage_->IsSlotIdEncoded());
-      keys->emplace_back(user_key);
-      cnt++;
+      if (deadline > 0 && ++visited % kScanTimeCheckInterval == 0 && util::GetTimeStampUS() >= deadline) {
+        // The next call resumes after this key, no matter if it's returned
+        std::tie(std::ignore, user_key) = ExtractNamespaceKey<std::string>(iter->key(), storage_->IsSlotIdEncoded());
+        out_of_time = true;
+        break;
+      }
     }
 
     if (auto s = iter->status(); !s.ok()) {
       return s;
     }
 
+    if (out_of_time) {
+      end_cursor->append(user_key);
+      break;
+    }
+
     if (!storage_->IsSlotIdEncoded() || prefix.empty()) {
       if (!keys->empty() && cnt >= limit) {
         end_cursor->append(user_key);
@@ -395,8 +647,10 @@ rocksdb::Status Database::Scan(engine::Context &ctx, const std::string &cursor,
         if (iter->Valid()) {
           std::tie(std::ignore, user_key) = ExtractNamespaceKey<std::string>(iter->key(), storage_->IsSlotIdEncoded());
           auto res = std::mismatch(prefix.begin(), prefix.end(), user_key.begin());
-          if (res.first == prefix.end()) {
-            keys->emplace_back(user_key);
+          std::string matched_key;
+          if (res.first == prefix.end() &&
+              scanKeyMatched(iter->key(), iter->value(), type, pattern, &skipper, &matched_key)) {
+            keys->emplace_back(matched_key);
           }
 
           end_cursor->append(user_key);
@@ -415,6 +669,154 @@ rocksdb::Status Database::Scan(engine::Context &ctx, const std::string &cursor,
   return rocksdb::Status::OK();
 }
 
+rocksdb::Status Database::ParallelScan(engine::Context &ctx, const std::string &cursor, uint64_t limit,
+                                       const std::string &prefix, int threads, std::vector<std::string> *keys,
+                                       std::string *end_cursor, RedisType type, const std::string &pattern) {
+  end_cursor->clear();
+  auto partitions = splitScanRanges(cursor, prefix, static_cast<size_t>(std::max(threads, 1)));
+  auto n_partitions = partitions.size();
+
+  std::vector<std::vector<std::string>> partition_keys(n_partitions);
+  std::vector<rocksdb::Status> statuses(n_partitions);
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < n_partitions; i++) {
+    auto t = util::CreateThread("parallel-scan", [&, i] {
+      statuses[i] = scanRanges(ctx, partitions[i], limit, type, pattern, &partition_keys[i]);
+    });
+    if (!t) {
+      // fall back to scan the partition in the current thread
+      statuses[i] = scanRanges(ctx, partitions[i], limit, type, pattern, &partition_keys[i]);
+      continue;
+    }
+    workers.emplace_back(std::move(*t));
+  }
+  if (n_partitions > 0) statuses[0] = scanRanges(ctx, partitions[0], limit, type, pattern, &partition_keys[0]);
+  for (auto &worker : workers) {
+    if (auto s = util::ThreadJoin(worker); !s) {
+      LOG(WARNING) << "failed to join the parallel scan thread: " << s.Msg();
+    }
+  }
+
+  // The partitions are in the key order, and only the ones before the limit is reached are complete
+  for (size_t i = 0; i < n_partitions; i++) {
+    if (!statuses[i].ok()) return statuses[i];
+    for (auto &key : partition_keys[i]) {
+      if (limit > 0 && keys->size() >= limit) break;
+      keys->emplace_back(std::move(key));
+    }
+    if (limit > 0 && keys->size() >= limit) {
+      *end_cursor = keys->back();
+      break;
+    }
+  }
+  return rocksdb::Status::OK();
+}
+
+std::vector<std::string> Database::metadataSplitKeys(const std::string &start, const std::string &limit) {
+  std::vector<std::string> split_keys;
+  std::vector<rocksdb::LiveFileMetaData> files;
+  storage_->GetDB()->GetLiveFilesMetaData(&files);
+  for (const auto &file : files) {
+    if (file.column_family_name != kMetadataColumnFamilyName) continue;
+    if (file.smallestkey <= start || (!limit.empty() && file.smallestkey >= limit)) continue;
+    split_keys.emplace_back(file.smallestkey);
+  }
+  std::sort(split_keys.begin(), split_keys.end());
+  split_keys.erase(std::unique(split_keys.begin(), split_keys.end()), split_keys.end());
+  return split_keys;
+}
+
+std::vector<std::vector<Database::MetadataRange>> Database::splitScanRanges(const std::string &cursor,
+                                                                            const std::string &prefix, size_t n) {
+  // The first key after the cursor
+  std::string start;
+  if (!cursor.empty()) {
+    start = AppendNamespacePrefix(cursor);
+    start.push_back('\0');
+  }
+
+  std::vector<std::vector<MetadataRange>> partitions;
+  if (storage_->IsSlotIdEncoded() && !prefix.empty()) {
+    // One range per slot, and the slots are split into partitions evenly
+    uint16_t slot_start = cursor.empty() ? 0 : GetSlotIdFromKey(cursor);
+    std::vector<MetadataRange> ranges;
+    for (uint32_t slot = slot_start; slot < HASH_SLOTS_SIZE; slot++) {
+      auto slot_prefix = ComposeNamespaceKey(namespace_, "", false);
+      PutFixed16(&slot_prefix, static_cast<uint16_t>(slot));
+      slot_prefix.append(prefix);
+      auto limit = util::StringNext(slot_prefix);
+      ranges.push_back({std::max(slot_prefix, start), std::move(limit)});
+    }
+    size_t per_partition = (ranges.size() + n - 1) / n;
+    for (size_t i = 0; i < ranges.size(); i += per_partition) {
+      auto end = std::min(i + per_partition, ranges.size());
+      partitions.emplace_back(std::make_move_iterator(ranges.begin() + static_cast<ptrdiff_t>(i)),
+                              std::make_move_iterator(ranges.begin() + static_cast<ptrdiff_t>(end)));
+    }
+    return partitions;
+  }
+
+  auto ns_prefix = storage_->IsSlotIdEncoded() ? ComposeNamespaceKey(namespace_, "", false)
+                                               : AppendNamespacePrefix(prefix);
+  auto limit = util::StringNext(ns_prefix);
+  start = std::max(ns_prefix, start);
+  if (start >= limit) return partitions;
+
+  // bounds[i] and bounds[i + 1] are the start and the limit of the i-th partition, like ScanKeyNumStats
+  std::vector<std::string> bounds{start};
+  if (n > 1) {
+    auto split_keys = metadataSplitKeys(start, limit);
+    size_t n_ranges = std::min(n, split_keys.size() + 1);
+    for (size_t i = 1; i < n_ranges; i++) {
+      const auto &key = split_keys[i * split_keys.size() / n_ranges];
+      if (key > bounds.back()) bounds.emplace_back(key);
+    }
+  }
+  bounds.emplace_back(limit);
+  for (size_t i = 0; i + 1 < bounds.size(); i++) {
+    partitions.push_back({{bounds[i], bounds[i + 1]}});
+  }
+  return partitions;
+}
+
+rocksdb::Status Database::scanRanges(engine::Context &ctx, const std::vector<MetadataRange> &ranges, uint64_t limit,
+                                     RedisType type, const std::string &pattern, std::vector<std::string> *keys) {
+  if (ranges.empty()) return rocksdb::Status::OK();
+
+  // The ranges are in order, so one iterator bounded by the last range seeks them one by one
+  auto read_options = ctx.DefaultScanOptions();
+  Slice upper_bound(ranges.back().limit);
+  read_options.iterate_upper_bound = &upper_bound;
+  auto iter = util::UniqueIterator(ctx, read_options, metadata_cf_handle_);
+  engine::ExpiredMetadataSkipper skipper(storage_);
+
+  std::string user_key;
+  for (const auto &range : ranges) {
+    for (iter->Seek(range.start); iter->Valid() && iter->key().compare(range.limit) < 0; iter->Next()) {
+      if (limit > 0 && keys->size() >= limit) return rocksdb::Status::OK();
+      if (scanKeyMatched(iter->key(), iter->value(), type, pattern, &skipper, &user_key)) {
+        keys->emplace_back(std::move(user_key));
+      }
+    }
+    if (auto s = iter->status(); !s.ok()) return s;
+  }
+  return rocksdb::Status::OK();
+}
+
+bool Database::scanKeyMatched(const Slice &ns_key, const Slice &value, RedisType type, const std::string &pattern,
+                              engine::ExpiredMetadataSkipper *skipper, std::string *user_key) {
+  // The metadata is never decoded, its type is checked by the first byte, and its expiration by its header
+  if (skipper->Skip(ns_key, value)) return false;
+  if (type != kRedisNone && Metadata::PeekType(value) != type) return false;
+
+  auto [_, key] = ExtractNamespaceKey(ns_key, storage_->IsSlotIdEncoded());
+  if (!pattern.empty() && !util::StringMatchLen(pattern.data(), pattern.size(), key.data(), key.size(), 0)) {
+    return false;
+  }
+  *user_key = key.ToString();
+  return true;
+}
+
 rocksdb::Status Database::RandomKey(engine::Context &ctx, const std::string &cursor, std::string *key) {
   key->clear();
 
@@ -506,6 +908,18 @@ rocksdb::Status Database::Dump(engine::Context &ctx, const Slice &user_key, std:
     infos->emplace_back(std::to_string(list_metadata.head));
     infos->emplace_back("tail");
     infos->emplace_back(std::to_string(list_metadata.tail));
+    infos->emplace_back("head_tombstones");
+    infos->emplace_back(std::to_string(list_metadata.head_tombstones));
+  }
+
+  if (metadata.Type() == kRedisZSet) {
+    ZSetMetadata zset_metadata(false);
+    s = GetMetadata(ctx, {kRedisZSet}, ns_key, &zset_metadata);
+    if (!s.ok()) return s.IsNotFound() ? rocksdb::Status::OK() : s;
+    infos->emplace_back("score_floor");
+    infos->emplace_back(util::Float2String(zset_metadata.score_floor));
+    infos->emplace_back("head_tombstones");
+    infos->emplace_back(std::to_string(zset_metadata.head_tombstones));
   }
 
   return rocksdb::Status::OK();
@@ -546,16 +960,23 @@ rocksdb::Status Database::KeyExist(engine::Context &ctx, const std::string &key)
 
 rocksdb::Status SubKeyScanner::Scan(engine::Context &ctx, RedisType type, const Slice &user_key,
                                     const std::string &cursor, uint64_t limit, const std::string &subkey_prefix,
-                                    std::vector<std::string> *keys, std::vector<std::string> *values) {
+                                    std::vector<std::string> *keys, std::vector<std::string> *values,
+                                    const std::string &pattern, uint64_t time_budget_us, std::string *end_cursor) {
+  if (end_cursor) end_cursor->clear();
   uint64_t cnt = 0;
   std::string ns_key = AppendNamespacePrefix(user_key);
   Metadata metadata(type, false);
   rocksdb::Status s = GetMetadata(ctx, {type}, ns_key, &metadata);
   if (!s.ok()) return s;
 
-  auto iter = util::UniqueIterator(ctx, ctx.DefaultScanOptions());
   std::string match_prefix_key =
       InternalKey(ns_key, subkey_prefix, metadata.version, storage_->IsSlotIdEncoded()).Encode();
+  // The iterator never steps over the tombstones out of the prefix
+  std::string upper_key = util::StringNext(match_prefix_key);
+  Slice upper_bound(upper_key);
+  auto read_options = ctx.DefaultScanOptions();
+  read_options.iterate_upper_bound = &upper_bound;
+  auto iter = util::UniqueIterator(ctx, read_options);
 
   std::string start_key;
   if (!cursor.empty()) {
@@ -563,6 +984,9 @@ rocksdb::Status SubKeyScanner::Scan(engine::Context &ctx, RedisType type, const
   } else {
     start_key = match_prefix_key;
   }
+
+  uint64_t deadline = time_budget_us > 0 ? util::GetTimeStampUS() + time_budget_us : 0;
+  uint64_t visited = 0;
   for (iter->Seek(start_key); iter->Valid(); iter->Next()) {
     if (!cursor.empty() && iter->key() == start_key) {
       // if cursor is not empty, then we need to skip start_key
@@ -573,12 +997,22 @@ rocksdb::Status SubKeyScanner::Scan(engine::Context &ctx, RedisType type, const
       break;
     }
     InternalKey ikey(iter->key(), storage_->IsSlotIdEncoded());
-    keys->emplace_back(ikey.GetSubKey().ToString());
-    if (values != nullptr) {
-      values->emplace_back(iter->value().ToString());
+    auto sub_key = ikey.GetSubKey();
+    if (pattern.empty() || util::StringMatchLen(pattern.data(), pattern.size(), sub_key.data(), sub_key.size(), 0)) {
+      keys->emplace_back(sub_key.ToString());
+      if (values != nullptr) {
+        values->emplace_back(iter->value().ToString());
+      }
+      cnt++;
+      if (limit > 0 && cnt >= limit) {
+        if (end_cursor) *end_cursor = keys->back();
+        break;
+      }
     }
-    cnt++;
-    if (limit > 0 && cnt >= limit) {
+
+    if (deadline > 0 && ++visited % kScanTimeCheckInterval == 0 && util::GetTimeStampUS() >= deadline) {
+      // The next call resumes after this subkey, no matter if it's returned
+      if (end_cursor) *end_cursor = sub_key.ToString();
       break;
     }
   }
@@ -612,14 +1046,14 @@ Status WriteBatchLogData::Decode(const rocksdb::Slice &blob) {
 
 rocksdb::Status Database::existsInternal(engine::Context &ctx, const std::vector<std::string> &keys, int *ret) {
   *ret = 0;
-  rocksdb::Status s;
-  std::string value;
-  for (const auto &key : keys) {
-    s = storage_->Get(ctx, ctx.GetReadOptions(), metadata_cf_handle_, key, &value);
-    if (!s.ok() && !s.IsNotFound()) return s;
-    if (s.ok()) {
+  std::vector<Slice> ns_keys(keys.begin(), keys.end());
+  std::vector<std::string> values;
+  auto statuses = MultiGetRawMetadata(ctx, ns_keys, &values);
+  for (size_t i = 0; i < keys.size(); i++) {
+    if (!statuses[i].ok() && !statuses[i].IsNotFound()) return statuses[i];
+    if (statuses[i].ok()) {
       Metadata metadata(kRedisNone, false);
-      s = metadata.Decode(value);
+      auto s = metadata.Decode(values[i]);
       if (!s.ok()) return s;
       if (!metadata.Expired()) *ret += 1;
     }
@@ -670,24 +1104,27 @@ rocksdb::Status Database::Copy(engine::Context &ctx, const std::string &key, con
 
   if (key == new_key) return rocksdb::Status::OK();
 
-  auto batch = storage_->GetWriteBatchBase();
-  WriteBatchLogData log_data(type);
-  s = batch->PutLogData(log_data.Encode());
-  if (!s.ok()) {
-    return s;
-  }
-
   engine::DBIterator iter(ctx, ctx.GetReadOptions());
   iter.Seek(key);
 
-  if (delete_old) {
-    s = batch->Delete(metadata_cf_handle_, key);
-    if (!s.ok()) {
-      return s;
-    }
-  }
-  // copy metadata
-  s = batch->Put(metadata_cf_handle_, new_key, iter.Value());
+  Slice rest = iter.Value();
+  Metadata metadata(kRedisNone, false);
+  s = metadata.Decode(&rest);
+  if (!s.ok()) return s;
+  uint64_t old_version = metadata.version;
+  if (!metadata.IsSingleKVType()) metadata.version = Metadata(type).version;
+  uint64_t new_version = metadata.version;
+  std::string new_metadata;
+  metadata.Encode(&new_metadata);
+  // the fields of the type after the common ones, or the value of a string
+  new_metadata.append(rest.data(), rest.size());
+
+  // The subkeys are written in several batches to bound the size of each write, so the new key gets
+  // a new version: the subkeys stay invisible until its metadata is written by the last batch,
+  // and the stale subkeys of the overwritten key can't be mixed up with the copied ones.
+  WriteBatchLogData log_data(type);
+  engine::StagedWriteBatch staged(ctx, storage_, new_version, log_data.Encode());
+  s = staged.Begin();
   if (!s.ok()) {
     return s;
   }
@@ -700,9 +1137,9 @@ rocksdb::Status Database::Copy(engine::Context &ctx, const std::string &key, con
     for (subkey_iter->Seek(); subkey_iter->Valid(); subkey_iter->Next()) {
       InternalKey from_ikey(subkey_iter->Key(), storage_->IsSlotIdEncoded());
       std::string to_ikey =
-          InternalKey(new_key, from_ikey.GetSubKey(), from_ikey.GetVersion(), storage_->IsSlotIdEncoded()).Encode();
+          InternalKey(new_key, from_ikey.GetSubKey(), new_version, storage_->IsSlotIdEncoded()).Encode();
       // copy sub key
-      auto s = batch->Put(subkey_iter->ColumnFamilyHandle(), to_ikey, subkey_iter->Value());
+      auto s = staged.Get()->Put(subkey_iter->ColumnFamilyHandle(), to_ikey, subkey_iter->Value());
       if (!s.ok()) {
         return s;
       }
@@ -713,28 +1150,187 @@ rocksdb::Status Database::Copy(engine::Context &ctx, const std::string &key, con
         std::string score_bytes = subkey_iter->Value().ToString();
         score_bytes.append(from_ikey.GetSubKey().ToString());
         // copy score key
-        std::string score_key =
-            InternalKey(new_key, score_bytes, from_ikey.GetVersion(), storage_->IsSlotIdEncoded()).Encode();
-        auto s = batch->Put(zset_score_cf, score_key, Slice());
+        std::string score_key = InternalKey(new_key, score_bytes, new_version, storage_->IsSlotIdEncoded()).Encode();
+        auto s = staged.Get()->Put(zset_score_cf, score_key, Slice());
         if (!s.ok()) {
           return s;
         }
       }
+
+      s = staged.Flush();
+      if (!s.ok()) return s;
+    }
+  }
+
+  // copy the counts of the rank index, there are none if the zset isn't rank indexed
+  if (type == kRedisZSet) {
+    std::string prefix_key = InternalKey(key, "", old_version, storage_->IsSlotIdEncoded()).Encode();
+    std::string next_version_prefix_key = InternalKey(key, "", old_version + 1, storage_->IsSlotIdEncoded()).Encode();
+    rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+    rocksdb::Slice upper_bound(next_version_prefix_key);
+    read_options.iterate_upper_bound = &upper_bound;
+    rocksdb::Slice lower_bound(prefix_key);
+    read_options.iterate_lower_bound = &lower_bound;
+
+    auto rank_cf = storage_->GetCFHandle(ColumnFamilyID::ZSetRank);
+    auto rank_iter = util::UniqueIterator(ctx, read_options, rank_cf);
+    for (rank_iter->Seek(prefix_key); rank_iter->Valid(); rank_iter->Next()) {
+      InternalKey from_ikey(rank_iter->key(), storage_->IsSlotIdEncoded());
+      std::string to_ikey =
+          InternalKey(new_key, from_ikey.GetSubKey(), new_version, storage_->IsSlotIdEncoded()).Encode();
+      s = staged.Get()->Put(rank_cf, to_ikey, rank_iter->value());
+      if (!s.ok()) return s;
+    }
+    s = rank_iter->status();
+    if (!s.ok()) return s;
+  }
+
+  if (delete_old) {
+    s = staged.Get()->Delete(metadata_cf_handle_, key);
+    if (!s.ok()) {
+      return s;
     }
   }
+  // copy metadata
+  s = staged.Get()->Put(metadata_cf_handle_, new_key, new_metadata);
+  if (!s.ok()) {
+    return s;
+  }
 
-  return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+  return staged.Commit();
 }
 
-std::optional<std::string> Database::lookupKeyByPattern(engine::Context &ctx, const std::string &pattern,
-                                                        const std::string &subst) {
+rocksdb::Status Database::DumpNative(engine::Context &ctx, const Slice &user_key, std::string *payload) {
+  std::string ns_key = AppendNamespacePrefix(user_key);
+  std::string raw_metadata;
+  Metadata metadata(kRedisNone, false);
+  Slice rest;
+  auto s = GetMetadata(ctx, RedisTypes::All(), ns_key, &raw_metadata, &metadata, &rest);
+  if (!s.ok()) return s;
+
+  payload->clear();
+  PutFixed8(payload, kNativeDumpMagic);
+  PutFixed8(payload, kNativeDumpVersion);
+  PutSizedString(payload, raw_metadata);
+
+  auto dump_entries = [&, this](ColumnFamilyID cf_id) {
+    std::string prefix_key = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
+    std::string next_version_prefix_key =
+        InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
+    rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+    rocksdb::Slice upper_bound(next_version_prefix_key);
+    read_options.iterate_upper_bound = &upper_bound;
+    rocksdb::Slice lower_bound(prefix_key);
+    read_options.iterate_lower_bound = &lower_bound;
+
+    auto iter = util::UniqueIterator(ctx, read_options, storage_->GetCFHandle(cf_id));
+    for (iter->Seek(prefix_key); iter->Valid(); iter->Next()) {
+      InternalKey ikey(iter->key(), storage_->IsSlotIdEncoded());
+      PutFixed8(payload, static_cast<uint8_t>(cf_id));
+      PutSizedString(payload, ikey.GetSubKey());
+      PutSizedString(payload, iter->value());
+    }
+    return iter->status();
+  };
+
+  if (!metadata.IsSingleKVType()) {
+    auto type = metadata.Type();
+    s = dump_entries(type == kRedisStream ? ColumnFamilyID::Stream : ColumnFamilyID::PrimarySubkey);
+    if (!s.ok()) return s;
+    // the counts of the rank index, there are none if the zset isn't rank indexed
+    if (type == kRedisZSet) {
+      s = dump_entries(ColumnFamilyID::ZSetRank);
+      if (!s.ok()) return s;
+    }
+  }
+
+  uint64_t crc = crc64(0, reinterpret_cast<const unsigned char *>(payload->data()), payload->size());
+  PutFixed64(payload, crc);
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status Database::RestoreNative(engine::Context &ctx, const Slice &user_key, Slice payload,
+                                        uint64_t ttl_ms) {
+  if (payload.size() < 2 + sizeof(uint64_t) || !IsNativeDump(payload)) {
+    return rocksdb::Status::InvalidArgument("invalid native payload");
+  }
+  Slice body(payload.data(), payload.size() - sizeof(uint64_t));
+  uint64_t crc = DecodeFixed64(payload.data() + body.size());
+  if (crc != crc64(0, reinterpret_cast<const unsigned char *>(body.data()), body.size())) {
+    return rocksdb::Status::InvalidArgument("native payload checksum mismatch");
+  }
+  if (uint8_t(body[1]) != kNativeDumpVersion) {
+    return rocksdb::Status::NotSupported("unsupported native payload version");
+  }
+  body.remove_prefix(2);
+
+  Slice raw_metadata;
+  if (!GetSizedString(&body, &raw_metadata)) return rocksdb::Status::Corruption("invalid native payload");
+  Slice rest = raw_metadata;
+  Metadata metadata(kRedisNone, false);
+  auto s = metadata.Decode(&rest);
+  if (!s.ok()) return s;
+  auto type = metadata.Type();
+  if (!metadata.IsSingleKVType()) metadata.version = Metadata(type).version;
+  metadata.expire = ttl_ms > 0 ? util::GetTimeStampMS() + ttl_ms : 0;
+  std::string new_metadata;
+  metadata.Encode(&new_metadata);
+  new_metadata.append(rest.data(), rest.size());
+
+  std::string ns_key = AppendNamespacePrefix(user_key);
+  LockGuard guard(storage_->GetLockManager(), ns_key);
+
+  // The subkeys are written in several batches to bound the size of each write, see Copy
+  WriteBatchLogData log_data(type);
+  engine::StagedWriteBatch staged(ctx, storage_, metadata.version, log_data.Encode());
+  s = staged.Begin();
+  if (!s.ok()) return s;
+
+  auto zset_score_cf = storage_->GetCFHandle(ColumnFamilyID::SecondarySubkey);
+  while (!body.empty()) {
+    uint8_t cf_id = 0;
+    Slice sub_key, value;
+    if (!GetFixed8(&body, &cf_id) || !GetSizedString(&body, &sub_key) || !GetSizedString(&body, &value)) {
+      return rocksdb::Status::Corruption("invalid native payload");
+    }
+    // only the column families written by DumpNative are accepted
+    auto cf = static_cast<ColumnFamilyID>(cf_id);
+    if (cf != ColumnFamilyID::PrimarySubkey && cf != ColumnFamilyID::Stream && cf != ColumnFamilyID::ZSetRank) {
+      return rocksdb::Status::Corruption("invalid column family in native payload");
+    }
+
+    std::string ikey = InternalKey(ns_key, sub_key, metadata.version, storage_->IsSlotIdEncoded()).Encode();
+    s = staged.Get()->Put(storage_->GetCFHandle(cf), ikey, value);
+    if (!s.ok()) return s;
+    // rebuild the score index of the zset members, like Copy
+    if (type == kRedisZSet && cf == ColumnFamilyID::PrimarySubkey) {
+      std::string score_bytes = value.ToString();
+      score_bytes.append(sub_key.data(), sub_key.size());
+      std::string score_key = InternalKey(ns_key, score_bytes, metadata.version, storage_->IsSlotIdEncoded()).Encode();
+      s = staged.Get()->Put(zset_score_cf, score_key, Slice());
+      if (!s.ok()) return s;
+    }
+
+    s = staged.Flush();
+    if (!s.ok()) return s;
+  }
+
+  s = staged.Get()->Put(metadata_cf_handle_, ns_key, new_metadata);
+  if (!s.ok()) return s;
+  return staged.Commit();
+}
+
+std::vector<std::optional<std::string>> Database::lookupKeysByPattern(engine::Context &ctx, const std::string &pattern,
+                                                                     const std::vector<std::string> &substs) {
+  std::vector<std::optional<std::string>> values(substs.size());
   if (pattern == "#") {
-    return subst;
+    std::copy(substs.begin(), substs.end(), values.begin());
+    return values;
   }
 
   auto match_pos = pattern.find('*');
   if (match_pos == std::string::npos) {
-    return std::nullopt;
+    return values;
   }
 
   // hash field
@@ -744,30 +1340,28 @@ std::optional<std::string> Database::lookupKeyByPattern(engine::Context &ctx, co
     field = pattern.substr(arrow_pos + 2);
   }
 
-  std::string key = pattern.substr(0, match_pos + 1);
-  key.replace(match_pos, 1, subst);
-
-  std::string value;
-  RedisType type = RedisType::kRedisNone;
-  if (!field.empty()) {
-    auto hash_db = redis::Hash(storage_, namespace_);
-    if (auto s = hash_db.Type(ctx, key, &type); !s.ok() || type != RedisType::kRedisHash) {
-      return std::nullopt;
-    }
+  std::vector<std::string> keys;
+  keys.reserve(substs.size());
+  for (const auto &subst : substs) {
+    std::string key = pattern.substr(0, match_pos + 1);
+    key.replace(match_pos, 1, subst);
+    keys.emplace_back(std::move(key));
+  }
 
-    if (auto s = hash_db.Get(ctx, key, field, &value); !s.ok()) {
-      return std::nullopt;
-    }
-  } else {
-    auto string_db = redis::String(storage_, namespace_);
-    if (auto s = string_db.Type(ctx, key, &type); !s.ok() || type != RedisType::kRedisString) {
-      return std::nullopt;
-    }
-    if (auto s = string_db.Get(ctx, key, &value); !s.ok()) {
-      return std::nullopt;
+  // The keys are read by chunks of MultiGet, and a key of another type is looked up as a missing one
+  auto string_db = redis::String(storage_, namespace_);
+  auto hash_db = redis::Hash(storage_, namespace_);
+  for (size_t begin = 0; begin < keys.size(); begin += kSortLookupBatchSize) {
+    auto end = std::min(keys.size(), begin + kSortLookupBatchSize);
+    std::vector<Slice> batch(keys.begin() + static_cast<ptrdiff_t>(begin), keys.begin() + static_cast<ptrdiff_t>(end));
+    std::vector<std::string> batch_values;
+    auto statuses = field.empty() ? string_db.MGet(ctx, batch, &batch_values)
+                                  : hash_db.MGetOfKeys(ctx, batch, field, &batch_values);
+    for (size_t i = 0; i < batch.size(); i++) {
+      if (statuses[i].ok()) values[begin + i] = std::move(batch_values[i]);
     }
   }
-  return value;
+  return values;
 }
 
 rocksdb::Status Database::Sort(engine::Context &ctx, RedisType type, const std::string &key, const SortArgument &args,
@@ -853,12 +1447,13 @@ rocksdb::Status Database::Sort(engine::Context &ctx, RedisType type, const std::
 
   // Sort by BY, ALPHA, ASC/DESC
   if (!args.dontsort) {
+    std::vector<std::optional<std::string>> byvals;
+    if (!args.sortby.empty()) byvals = lookupKeysByPattern(ctx, args.sortby, str_vec);
     for (size_t i = 0; i < sort_vec.size(); ++i) {
       std::string byval;
       if (!args.sortby.empty()) {
-        auto lookup = lookupKeyByPattern(ctx, args.sortby, str_vec[i]);
-        if (!lookup.has_value()) continue;
-        byval = std::move(lookup.value());
+        if (!byvals[i].has_value()) continue;
+        byval = std::move(byvals[i].value());
       } else {
         byval = str_vec[i];
       }
@@ -875,9 +1470,16 @@ rocksdb::Status Database::Sort(engine::Context &ctx, RedisType type, const std::
       }
     }
 
-    std::sort(sort_vec.begin(), sort_vec.end(), [&args](const RedisSortObject &a, const RedisSortObject &b) {
+    auto compare = [&args](const RedisSortObject &a, const RedisSortObject &b) {
       return RedisSortObject::SortCompare(a, b, args);
-    });
+    };
+    // Only the elements up to the end of LIMIT are sorted
+    auto limit_end = static_cast<size_t>(offset + count);
+    if (limit_end < sort_vec.size()) {
+      std::partial_sort(sort_vec.begin(), sort_vec.begin() + limit_end, sort_vec.end(), compare);
+    } else {
+      std::sort(sort_vec.begin(), sort_vec.end(), compare);
+    }
 
     // Gets the element specified by Limit
     if (offset != 0 || count != vectorlen) {
@@ -887,17 +1489,21 @@ rocksdb::Status Database::Sort(engine::Context &ctx, RedisType type, const std::
   }
 
   // Perform storage
-  for (auto &elem : sort_vec) {
+  std::vector<std::vector<std::optional<std::string>>> getvals;
+  if (!args.getpatterns.empty()) {
+    std::vector<std::string> objs;
+    objs.reserve(sort_vec.size());
+    for (const auto &elem : sort_vec) objs.emplace_back(elem.obj);
+    for (const std::string &pattern : args.getpatterns) {
+      getvals.emplace_back(lookupKeysByPattern(ctx, pattern, objs));
+    }
+  }
+  for (size_t i = 0; i < sort_vec.size(); ++i) {
     if (args.getpatterns.empty()) {
-      elems->emplace_back(elem.obj);
+      elems->emplace_back(std::move(sort_vec[i].obj));
     }
-    for (const std::string &pattern : args.getpatterns) {
-      std::optional<std::string> val = lookupKeyByPattern(ctx, pattern, elem.obj);
-      if (val.has_value()) {
-        elems->emplace_back(val.value());
-      } else {
-        elems->emplace_back(std::nullopt);
-      }
+    for (auto &vals : getvals) {
+      elems->emplace_back(std::move(vals[i]));
     }
   }
 
@@ -22,6 +22,7 @@
 
 #include <map>
 #include <optional>
+#include <random>
 #include <string>
 #include <utility>
 #include <variant>
@@ -32,6 +33,10 @@
 #include "server/redis_reply.h"
 #include "storage.h"
 
+namespace engine {
+class ExpiredMetadataSkipper;
+}  // namespace engine
+
 namespace redis {
 
 /// SORT_LENGTH_LIMIT limits the number of elements to be sorted
@@ -39,6 +44,8 @@ namespace redis {
 /// TODO: Expect to expand or eliminate SORT_LENGTH_LIMIT
 /// through better mechanisms such as memory restriction logic.
 constexpr uint64_t SORT_LENGTH_LIMIT = 512;
+// the number of the keys of BY and GET patterns read by one MultiGet
+constexpr size_t kSortLookupBatchSize = 256;
 
 struct SortArgument {
   std::string sortby;                    // BY
@@ -73,6 +80,8 @@ struct RedisSortObject {
 class Database {
  public:
   static constexpr uint64_t RANDOM_KEY_SCAN_LIMIT = 60;
+  // Scan checks the time budget once per this many visited keys
+  static constexpr uint64_t kScanTimeCheckInterval = 64;
 
   explicit Database(engine::Storage *storage, std::string ns = "");
   /// Parsing metadata with type of `types` from bytes, the metadata is a base class of all metadata.
@@ -101,6 +110,25 @@ class Database {
   /// \param rest The rest of the bytes after parsing the metadata.
   [[nodiscard]] rocksdb::Status GetMetadata(engine::Context &ctx, RedisTypes types, const Slice &ns_key,
                                             std::string *raw_value, Metadata *metadata, Slice *rest);
+  /// GetMetadataAndSubKey reads the metadata of a key and the value of one of its subkeys, for the commands which
+  /// read a single subkey like HGET or ZSCORE.
+  ///
+  /// The metadata read on a snapshot can't be served by the metadata cache, but the version cached for the key is
+  /// most likely the version on the snapshot as well. Then the metadata and the subkey of that version are read
+  /// together by one MultiGet across the column families, and the subkey is only read again if the version on the
+  /// snapshot is a different one. Otherwise the subkey is read after the metadata.
+  ///
+  /// \param types The candidate types of the metadata.
+  /// \param ns_key The key with namespace of the metadata.
+  /// \param sub_key The subkey, e.g. the field of a hash or the member of a set.
+  /// \param metadata The output metadata.
+  /// \param value The output value of the subkey.
+  /// \param sub_key_status The status of reading the subkey, NotFound if it doesn't exist, only set if the metadata
+  /// is found.
+  /// \return The status of reading the metadata.
+  [[nodiscard]] rocksdb::Status GetMetadataAndSubKey(engine::Context &ctx, RedisTypes types, const Slice &ns_key,
+                                                     const Slice &sub_key, Metadata *metadata, std::string *value,
+                                                     rocksdb::Status *sub_key_status);
   /// GetRawMetadata is a helper function to get the "raw metadata" from the database without parsing
   /// it to the specified metadata type.
   ///
@@ -108,9 +136,37 @@ class Database {
   /// \param ns_key The key with namespace of the metadata.
   /// \param bytes The output raw metadata.
   [[nodiscard]] rocksdb::Status GetRawMetadata(engine::Context &ctx, const Slice &ns_key, std::string *bytes);
+  /// MultiGetRawMetadata is the batched version of GetRawMetadata, the "raw metadata" of all keys
+  /// is read by one MultiGet on the snapshot of the context.
+  ///
+  /// \param ns_keys The keys with namespace of the metadata.
+  /// \param raw_values The output raw metadata, in the same order as ns_keys.
+  /// \return The status of each key, NotFound if the key doesn't exist.
+  std::vector<rocksdb::Status> MultiGetRawMetadata(engine::Context &ctx, const std::vector<Slice> &ns_keys,
+                                                   std::vector<std::string> *raw_values);
+  /// MultiGetSubKeys reads the values of many subkeys of one key by one MultiGet.
+  ///
+  /// \param ns_key The key with namespace.
+  /// \param metadata The metadata of the key, which gives the version of the subkeys.
+  /// \param sub_keys The subkeys (e.g. the fields of a hash or the members of a set).
+  /// \param values The output values, in the same order as sub_keys.
+  /// \return The status of each subkey, NotFound if the subkey doesn't exist.
+  std::vector<rocksdb::Status> MultiGetSubKeys(engine::Context &ctx, const Slice &ns_key, const Metadata &metadata,
+                                               const std::vector<Slice> &sub_keys, std::vector<std::string> *values);
+  /// SampleSubKeys reads at most n subkeys and their values in order from a random point between the first
+  /// and the last subkey of a key, and wraps around to the first subkey after the last one.
+  ///
+  /// The point is drawn from the key space between the subkeys rather than from the subkeys, see
+  /// SampleRandMemberBySeek for the uniformity of the samples.
+  [[nodiscard]] rocksdb::Status SampleSubKeys(engine::Context &ctx, const Slice &ns_key, const Metadata &metadata,
+                                              std::mt19937_64 &gen, size_t n,
+                                              std::vector<std::pair<std::string, std::string>> *subkeys);
   [[nodiscard]] rocksdb::Status Expire(engine::Context &ctx, const Slice &user_key, uint64_t timestamp);
   [[nodiscard]] rocksdb::Status Del(engine::Context &ctx, const Slice &user_key);
-  [[nodiscard]] rocksdb::Status MDel(engine::Context &ctx, const std::vector<Slice> &keys, uint64_t *deleted_cnt);
+  [[nodiscard]] rocksdb::Status MDel(engine::Context &ctx, const std::vector<Slice> &keys, uint64_t *deleted_cnt,
+                                       bool lazy_free = false);
+  // ApproximateSubKeySize returns the approximate size of the subkeys of the key on disk and in memtables
+  uint64_t ApproximateSubKeySize(const std::string &ns_key, const Metadata &metadata);
   [[nodiscard]] rocksdb::Status Exists(engine::Context &ctx, const std::vector<Slice> &keys, int *ret);
   [[nodiscard]] rocksdb::Status TTL(engine::Context &ctx, const Slice &user_key, int64_t *ttl);
   [[nodiscard]] rocksdb::Status GetExpireTime(engine::Context &ctx, const Slice &user_key, uint64_t *timestamp);
@@ -119,11 +175,27 @@ class Database {
   [[nodiscard]] rocksdb::Status FlushDB(engine::Context &ctx);
   [[nodiscard]] rocksdb::Status FlushAll(engine::Context &ctx);
   [[nodiscard]] rocksdb::Status GetKeyNumStats(engine::Context &ctx, const std::string &prefix, KeyNumStats *stats);
+  // ScanKeyNumStats counts the keys of the namespace like GetKeyNumStats with an empty prefix,
+  // but splits the metadata column family by the boundaries of its SST files and scans the ranges in parallel
+  [[nodiscard]] rocksdb::Status ScanKeyNumStats(engine::Context &ctx, int threads, KeyNumStats *stats);
   [[nodiscard]] rocksdb::Status Keys(engine::Context &ctx, const std::string &prefix,
                                      std::vector<std::string> *keys = nullptr, KeyNumStats *stats = nullptr);
+  // Scan returns at most `limit` keys after the cursor which start with the prefix, and also match
+  // the glob-style pattern and the type if they're given. With a time budget, it may return fewer keys
+  // and the last visited key as the end cursor once the budget is used up.
   [[nodiscard]] rocksdb::Status Scan(engine::Context &ctx, const std::string &cursor, uint64_t limit,
                                      const std::string &prefix, std::vector<std::string> *keys,
-                                     std::string *end_cursor = nullptr, RedisType type = kRedisNone);
+                                     std::string *end_cursor = nullptr, RedisType type = kRedisNone,
+                                     const std::string &pattern = "", uint64_t time_budget_us = 0);
+  // ParallelScan is Scan without the time budget, but the rest of the key space after the cursor is split into at most
+  // `threads` partitions which are scanned concurrently. The partitions are split by the slots if the prefix is sought
+  // slot by slot, and by the boundaries of the SST files otherwise. Each partition collects at most `limit` keys, and
+  // the first `limit` keys of them in the key order are returned, so the end cursor is still the last returned key.
+  // A zero limit returns all the keys like KEYS.
+  [[nodiscard]] rocksdb::Status ParallelScan(engine::Context &ctx, const std::string &cursor, uint64_t limit,
+                                             const std::string &prefix, int threads, std::vector<std::string> *keys,
+                                             std::string *end_cursor, RedisType type = kRedisNone,
+                                             const std::string &pattern = "");
   [[nodiscard]] rocksdb::Status RandomKey(engine::Context &ctx, const std::string &cursor, std::string *key);
   std::string AppendNamespacePrefix(const Slice &user_key);
   [[nodiscard]] rocksdb::Status ClearKeysOfSlotRange(engine::Context &ctx, const rocksdb::Slice &ns,
@@ -134,6 +206,22 @@ class Database {
   enum class CopyResult { KEY_NOT_EXIST, KEY_ALREADY_EXIST, DONE };
   [[nodiscard]] rocksdb::Status Copy(engine::Context &ctx, const std::string &key, const std::string &new_key, bool nx,
                                      bool delete_old, CopyResult *res);
+  /// DumpNative serializes the key as its raw metadata and subkey entries, which are written back by
+  /// RestoreNative without any type level decoding. The payload is only understood by kvrocks.
+  ///
+  /// The payload is the magic byte kNativeDumpMagic, the format version, the sized raw metadata, the
+  /// entries of (column family id, sized subkey, sized value) and the CRC64 of all the preceding bytes.
+  /// The subkeys are stored without the key and the version, the zset score index is rebuilt on restore.
+  [[nodiscard]] rocksdb::Status DumpNative(engine::Context &ctx, const Slice &user_key, std::string *payload);
+  /// RestoreNative writes the key from a payload of DumpNative under a new version, so an existing key is
+  /// overwritten. The subkeys are written in batches of bounded size before the metadata, like Copy.
+  [[nodiscard]] rocksdb::Status RestoreNative(engine::Context &ctx, const Slice &user_key, Slice payload,
+                                              uint64_t ttl_ms);
+  static bool IsNativeDump(Slice payload) { return !payload.empty() && uint8_t(payload[0]) == kNativeDumpMagic; }
+  // The first byte of a native payload, which isn't an object type of a Redis DUMP payload
+  static constexpr uint8_t kNativeDumpMagic = 0xF0;
+  static constexpr uint8_t kNativeDumpVersion = 1;
+
   enum class SortResult { UNKNOWN_TYPE, DOUBLE_CONVERT_ERROR, LIMIT_EXCEEDED, DONE };
   /// Sort sorts keys of the specified type according to SortArgument
   ///
@@ -156,12 +244,34 @@ class Database {
   // Already internal keys
   [[nodiscard]] rocksdb::Status existsInternal(engine::Context &ctx, const std::vector<std::string> &keys, int *ret);
   [[nodiscard]] rocksdb::Status typeInternal(engine::Context &ctx, const Slice &key, RedisType *type);
+  // scanKeyNumRange counts the keys with the prefix in [start, limit), an empty start or limit means unbounded
+  [[nodiscard]] rocksdb::Status scanKeyNumRange(engine::Context &ctx, const std::string &prefix,
+                                                const std::string &start, const std::string &limit,
+                                                KeyNumStats *stats, uint64_t *ttl_sum);
+  // [start, limit) of the metadata keys
+  struct MetadataRange {
+    std::string start;
+    std::string limit;
+  };
+  // metadataSplitKeys returns the smallest keys of the metadata SST files in (start, limit) in order,
+  // which are well spread over the key space. An empty limit means unbounded.
+  std::vector<std::string> metadataSplitKeys(const std::string &start, const std::string &limit);
+  // splitScanRanges splits the key space of ParallelScan into at most n partitions of ranges in the key order
+  std::vector<std::vector<MetadataRange>> splitScanRanges(const std::string &cursor, const std::string &prefix,
+                                                           size_t n);
+  // scanRanges collects at most `limit` matched keys of the ranges in order, a zero limit means unlimited
+  [[nodiscard]] rocksdb::Status scanRanges(engine::Context &ctx, const std::vector<MetadataRange> &ranges,
+                                           uint64_t limit, RedisType type, const std::string &pattern,
+                                           std::vector<std::string> *keys);
+  // scanKeyMatched checks the metadata entry against the filters of Scan, and extracts the user key if it matches
+  bool scanKeyMatched(const Slice &ns_key, const Slice &value, RedisType type, const std::string &pattern,
+                      engine::ExpiredMetadataSkipper *skipper, std::string *user_key);
 
-  /// lookupKeyByPattern is a helper function of `Sort` to support `GET` and `BY` fields.
+  /// lookupKeysByPattern is a helper function of `Sort` to support `GET` and `BY` fields.
   ///
   /// \param pattern can be the value of a `BY` or `GET` field
-  /// \param subst is used to replace the "*" or "#" matched in the pattern string.
-  /// \return  Returns the value associated to the key with a name obtained using the following rules:
+  /// \param substs are used to replace the "*" or "#" matched in the pattern string.
+  /// \return  Returns the value associated to the key of each subst with a name obtained using the following rules:
   ///   1) The first occurrence of '*' in 'pattern' is substituted with 'subst'.
   ///   2) If 'pattern' matches the "->" string, everything on the left of
   ///      the arrow is treated as the name of a hash field, and the part on the
@@ -170,16 +280,24 @@ class Database {
   ///   3) If 'pattern' equals "#", the function simply returns 'subst' itself so
   ///      that the SORT command can be used like: SORT key GET # to retrieve
   ///      the Set/List elements directly.
-  std::optional<std::string> lookupKeyByPattern(engine::Context &ctx, const std::string &pattern,
-                                                const std::string &subst);
+  /// The keys are read by MultiGet in chunks of kSortLookupBatchSize.
+  std::vector<std::optional<std::string>> lookupKeysByPattern(engine::Context &ctx, const std::string &pattern,
+                                                              const std::vector<std::string> &substs);
 };
 
 class SubKeyScanner : public redis::Database {
  public:
   explicit SubKeyScanner(engine::Storage *storage, const std::string &ns) : Database(storage, ns) {}
+  /// Scan returns the subkeys after the cursor which start with subkey_prefix, they're sought from the prefix,
+  /// and only the ones matching the glob-style pattern are returned if it's not empty.
+  ///
+  /// \param time_budget_us The scan stops after this many microseconds even if it has found fewer subkeys than
+  /// the limit, 0 means unbounded.
+  /// \param end_cursor The subkey to resume the scan after, it's empty if there is no more subkey.
   rocksdb::Status Scan(engine::Context &ctx, RedisType type, const Slice &user_key, const std::string &cursor,
                        uint64_t limit, const std::string &subkey_prefix, std::vector<std::string> *keys,
-                       std::vector<std::string> *values = nullptr);
+                       std::vector<std::string> *values = nullptr, const std::string &pattern = "",
+                       uint64_t time_budget_us = 0, std::string *end_cursor = nullptr);
 };
 
 class WriteBatchLogData {
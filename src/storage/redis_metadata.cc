@@ -48,9 +48,13 @@ InternalKey::InternalKey(Slice input, bool slot_id_encoded) : slot_id_encoded_(s
   if (slot_id_encoded_) {
     GetFixed16(&input, &slotid_);
   }
-  GetFixed32(&input, &key_size);
-  key_ = Slice(input.data(), key_size);
-  input.remove_prefix(key_size);
+  if (!input.empty() && static_cast<uint8_t>(input[0]) == kCompactKeyMarker) {
+    input.remove_prefix(1);
+  } else {
+    GetFixed32(&input, &key_size);
+    key_ = Slice(input.data(), key_size);
+    input.remove_prefix(key_size);
+  }
   GetFixed64(&input, &version_);
   sub_key_ = Slice(input.data(), input.size());
 }
@@ -77,7 +81,7 @@ uint64_t InternalKey::GetVersion() const { return version_; }
 
 std::string InternalKey::Encode() const {
   std::string out;
-  size_t total = 1 + namespace_.size() + 4 + key_.size() + 8 + sub_key_.size();
+  size_t total = 1 + namespace_.size() + (IsCompact() ? 1 : 4 + key_.size()) + 8 + sub_key_.size();
   if (slot_id_encoded_) {
     total += 2;
   }
@@ -88,13 +92,23 @@ std::string InternalKey::Encode() const {
   if (slot_id_encoded_) {
     buf = EncodeFixed16(buf, slotid_);
   }
-  buf = EncodeFixed32(buf, static_cast<uint32_t>(key_.size()));
-  buf = EncodeBuffer(buf, key_);
+  if (IsCompact()) {
+    buf = EncodeFixed8(buf, kCompactKeyMarker);
+  } else {
+    buf = EncodeFixed32(buf, static_cast<uint32_t>(key_.size()));
+    buf = EncodeBuffer(buf, key_);
+  }
   buf = EncodeFixed64(buf, version_);
   EncodeBuffer(buf, sub_key_);
   return out;
 }
 
+std::string InternalKey::EncodePrefix() const {
+  auto out = Encode();
+  out.resize(out.size() - sub_key_.size());
+  return out;
+}
+
 bool InternalKey::operator==(const InternalKey &that) const {
   if (namespace_ != this->namespace_) return false;
   if (key_ != that.key_) return false;
@@ -205,7 +219,8 @@ void Metadata::InitVersionCounter() {
 uint64_t Metadata::generateVersion() {
   uint64_t timestamp = util::GetTimeStampUS();
   uint64_t counter = version_counter_.fetch_add(1);
-  return (timestamp << VersionCounterBits) + (counter % (1 << VersionCounterBits));
+  uint64_t version = (timestamp << VersionCounterBits) + (counter % (1 << VersionCounterBits));
+  return USE_COMPACT_SUBKEY_DEFAULT ? version | InternalKey::kCompactVersionFlag : version;
 }
 
 bool Metadata::operator==(const Metadata &that) const {
@@ -309,8 +324,12 @@ int64_t Metadata::TTL() const {
   return int64_t(expire - now);
 }
 
+uint64_t Metadata::VersionTimeUS(uint64_t version) {
+  return (version & ~InternalKey::kCompactVersionFlag) >> VersionCounterBits;
+}
+
 timeval Metadata::Time() const {
-  auto t = version >> VersionCounterBits;
+  auto t = VersionTimeUS(version);
   timeval created_at{static_cast<uint32_t>(t / 1000000), static_cast<int32_t>(t % 1000000)};
   return created_at;
 }
@@ -326,10 +345,41 @@ bool Metadata::ExpireAt(uint64_t expired_ts) const {
   return expire < expired_ts;
 }
 
-bool Metadata::IsSingleKVType() const { return Type() == kRedisString || Type() == kRedisJson; }
+bool Metadata::IsSingleKVType() const { return isSingleKVType(flags); }
+
+bool Metadata::IsEmptyableType() const { return isEmptyableType(flags); }
+
+bool Metadata::isSingleKVType(uint8_t flags) {
+  auto type = static_cast<RedisType>(flags & METADATA_TYPE_MASK);
+  return (type == kRedisString || type == kRedisJson) && !(flags & METADATA_SPLIT_MASK);
+}
+
+bool Metadata::isEmptyableType(uint8_t flags) {
+  auto type = static_cast<RedisType>(flags & METADATA_TYPE_MASK);
+  return isSingleKVType(flags) || type == kRedisJson || type == kRedisStream || type == kRedisBloomFilter ||
+         type == kRedisHyperLogLog || type == kRedisCuckooFilter || type == kRedisCountMinSketch ||
+         type == kRedisTopK || type == kRedisTimeSeries;
+}
+
+bool Metadata::PeekExpireAt(Slice input, uint64_t expired_ts, bool *expired) {
+  // the same layout as Decode: flags | expire | [version (8) | size], the expire and the size are 64 bits or 32 bits
+  if (input.empty()) return false;
+  auto flags = static_cast<uint8_t>(input[0]);
+  bool is_64bit = flags & METADATA_64BIT_ENCODING_MASK;
+  size_t common_size = is_64bit ? 8 : 4;
+  size_t encoded_size = 1 + common_size + (isSingleKVType(flags) ? 0 : 8 + common_size);
+  if (input.size() < encoded_size) return false;
 
-bool Metadata::IsEmptyableType() const {
-  return IsSingleKVType() || Type() == kRedisStream || Type() == kRedisBloomFilter || Type() == kRedisHyperLogLog;
+  auto decode_common = [&](size_t offset) -> uint64_t {
+    return is_64bit ? DecodeFixed64(input.data() + offset) : DecodeFixed32(input.data() + offset);
+  };
+  if (!isEmptyableType(flags) && decode_common(1 + common_size + 8) == 0) {
+    *expired = true;
+    return true;
+  }
+  uint64_t expire = is_64bit ? decode_common(1) : decode_common(1) * 1000;
+  *expired = expire != 0 && expire < expired_ts;
+  return true;
 }
 
 bool Metadata::Expired() const { return ExpireAt(util::GetTimeStampMS()); }
@@ -341,6 +391,8 @@ void ListMetadata::Encode(std::string *dst) const {
   Metadata::Encode(dst);
   PutFixed64(dst, head);
   PutFixed64(dst, tail);
+  // a list without the head tombstones is encoded the same as before they're counted
+  if (head_tombstones > 0) PutFixed64(dst, head_tombstones);
 }
 
 rocksdb::Status ListMetadata::Decode(Slice *input) {
@@ -353,6 +405,8 @@ rocksdb::Status ListMetadata::Decode(Slice *input) {
   }
   GetFixed64(input, &head);
   GetFixed64(input, &tail);
+  head_tombstones = 0;
+  if (input->size() >= 8) GetFixed64(input, &head_tombstones);
 
   return rocksdb::Status::OK();
 }
@@ -455,6 +509,292 @@ uint32_t BloomChainMetadata::GetCapacity() const {
   return static_cast<uint32_t>(base_capacity * (1 - pow(expansion, n_filters)) / (1 - expansion));
 }
 
+void CuckooFilterMetadata::Encode(std::string *dst) const {
+  Metadata::Encode(dst);
+
+  PutFixed32(dst, num_buckets);
+  PutFixed16(dst, n_filters);
+  PutFixed8(dst, bucket_size);
+  PutFixed16(dst, max_iterations);
+  PutFixed16(dst, expansion);
+  PutFixed64(dst, num_deletes);
+}
+
+rocksdb::Status CuckooFilterMetadata::Decode(Slice *input) {
+  if (auto s = Metadata::Decode(input); !s.ok()) {
+    return s;
+  }
+
+  if (input->size() < 19) {
+    return rocksdb::Status::InvalidArgument(kErrMetadataTooShort);
+  }
+
+  GetFixed32(input, &num_buckets);
+  GetFixed16(input, &n_filters);
+  GetFixed8(input, &bucket_size);
+  GetFixed16(input, &max_iterations);
+  GetFixed16(input, &expansion);
+  GetFixed64(input, &num_deletes);
+
+  return rocksdb::Status::OK();
+}
+
+uint64_t CuckooFilterMetadata::GetFilterBuckets(uint16_t filter_index) const {
+  uint64_t buckets = num_buckets;
+  for (uint16_t i = 0; i < filter_index; i++) buckets *= expansion;
+  return buckets;
+}
+
+uint64_t CuckooFilterMetadata::GetBytes() const {
+  uint64_t bytes = 0;
+  for (uint16_t i = 0; i < n_filters; i++) bytes += GetFilterBuckets(i) * bucket_size;
+  return bytes;
+}
+
+void CountMinSketchMetadata::Encode(std::string *dst) const {
+  Metadata::Encode(dst);
+
+  PutFixed32(dst, width);
+  PutFixed32(dst, depth);
+  PutFixed64(dst, count);
+}
+
+rocksdb::Status CountMinSketchMetadata::Decode(Slice *input) {
+  if (auto s = Metadata::Decode(input); !s.ok()) {
+    return s;
+  }
+
+  if (input->size() < 16) {
+    return rocksdb::Status::InvalidArgument(kErrMetadataTooShort);
+  }
+
+  GetFixed32(input, &width);
+  GetFixed32(input, &depth);
+  GetFixed64(input, &count);
+
+  return rocksdb::Status::OK();
+}
+
+void TopKMetadata::Encode(std::string *dst) const {
+  Metadata::Encode(dst);
+
+  PutFixed32(dst, k);
+  PutFixed32(dst, width);
+  PutFixed32(dst, depth);
+  PutDouble(dst, decay);
+}
+
+rocksdb::Status TopKMetadata::Decode(Slice *input) {
+  if (auto s = Metadata::Decode(input); !s.ok()) {
+    return s;
+  }
+
+  if (input->size() < 20) {
+    return rocksdb::Status::InvalidArgument(kErrMetadataTooShort);
+  }
+
+  GetFixed32(input, &k);
+  GetFixed32(input, &width);
+  GetFixed32(input, &depth);
+  GetDouble(input, &decay);
+
+  return rocksdb::Status::OK();
+}
+
+uint64_t TimeSeriesMetadata::RetainFrom() const {
+  if (retention == 0 || last_timestamp < retention) return 0;
+  return last_timestamp - retention;
+}
+
+void TimeSeriesMetadata::Encode(std::string *dst) const {
+  Metadata::Encode(dst);
+
+  PutFixed64(dst, retention);
+  PutFixed32(dst, chunk_size);
+  PutFixed8(dst, static_cast<uint8_t>(duplicate_policy));
+  PutFixed64(dst, last_timestamp);
+  PutFixed64(dst, head_chunk);
+  PutFixed32(dst, static_cast<uint32_t>(labels.size()));
+  for (const auto &[label, value] : labels) {
+    PutSizedString(dst, label);
+    PutSizedString(dst, value);
+  }
+}
+
+rocksdb::Status TimeSeriesMetadata::Decode(Slice *input) {
+  if (auto s = Metadata::Decode(input); !s.ok()) {
+    return s;
+  }
+
+  if (input->size() < 33) {
+    return rocksdb::Status::InvalidArgument(kErrMetadataTooShort);
+  }
+
+  uint8_t policy = 0;
+  uint32_t num_labels = 0;
+  GetFixed64(input, &retention);
+  GetFixed32(input, &chunk_size);
+  GetFixed8(input, &policy);
+  GetFixed64(input, &last_timestamp);
+  GetFixed64(input, &head_chunk);
+  GetFixed32(input, &num_labels);
+  duplicate_policy = static_cast<TSDuplicatePolicy>(policy);
+
+  labels.clear();
+  labels.reserve(num_labels);
+  for (uint32_t i = 0; i < num_labels; ++i) {
+    Slice label, value;
+    if (!GetSizedString(input, &label) || !GetSizedString(input, &value)) {
+      return rocksdb::Status::InvalidArgument(kErrMetadataTooShort);
+    }
+    labels.emplace_back(label.ToString(), value.ToString());
+  }
+
+  return rocksdb::Status::OK();
+}
+
+void HashMetadata::Encode(std::string *dst) const {
+  Metadata::Encode(dst);
+
+  // The SUBKEYS encoding without expiring fields has no extra fields, so it's the same as before the INLINE
+  // encoding existed
+  if (!IsInline()) {
+    if (expiring_fields == 0) return;
+    PutFixed8(dst, static_cast<uint8_t>(encode_type));
+    PutFixed64(dst, expiring_fields);
+    return;
+  }
+
+  PutFixed8(dst, static_cast<uint8_t>(encode_type));
+  for (const auto &[field, value] : inline_fields) {
+    PutSizedString(dst, field);
+    PutSizedString(dst, value);
+  }
+}
+
+rocksdb::Status HashMetadata::Decode(Slice *input) {
+  if (auto s = Metadata::Decode(input); !s.ok()) {
+    return s;
+  }
+
+  encode_type = EncodeType::SUBKEYS;
+  inline_fields.clear();
+  expiring_fields = 0;
+  // only a hash has the encode type, other types may go through here before the type check
+  if (Type() != kRedisHash || input->empty()) return rocksdb::Status::OK();
+
+  if (!GetFixed8(input, reinterpret_cast<uint8_t *>(&encode_type))) {
+    return rocksdb::Status::InvalidArgument(kErrMetadataTooShort);
+  }
+  if (!IsInline()) {
+    if (!input->empty() && !GetFixed64(input, &expiring_fields)) {
+      return rocksdb::Status::InvalidArgument(kErrMetadataTooShort);
+    }
+    return rocksdb::Status::OK();
+  }
+
+  for (uint64_t i = 0; i < size; i++) {
+    Slice field, value;
+    if (!GetSizedString(input, &field) || !GetSizedString(input, &value)) {
+      return rocksdb::Status::InvalidArgument(kErrMetadataTooShort);
+    }
+    inline_fields.emplace_back(field.ToString(), value.ToString());
+  }
+
+  return rocksdb::Status::OK();
+}
+
+void ZSetMetadata::Encode(std::string *dst) const {
+  Metadata::Encode(dst);
+
+  // a zset without the rank index and the score floor is encoded the same as before they existed
+  bool has_floor = score_floor != -std::numeric_limits<double>::infinity() || head_tombstones > 0;
+  if (rank_indexed || has_floor) PutFixed8(dst, rank_indexed ? 1 : 0);
+  if (has_floor) {
+    PutDouble(dst, score_floor);
+    PutFixed64(dst, head_tombstones);
+  }
+}
+
+rocksdb::Status ZSetMetadata::Decode(Slice *input) {
+  if (auto s = Metadata::Decode(input); !s.ok()) {
+    return s;
+  }
+
+  rank_indexed = false;
+  score_floor = -std::numeric_limits<double>::infinity();
+  head_tombstones = 0;
+  if (Type() != kRedisZSet || input->empty()) return rocksdb::Status::OK();
+
+  uint8_t indexed = 0;
+  if (!GetFixed8(input, &indexed)) {
+    return rocksdb::Status::InvalidArgument(kErrMetadataTooShort);
+  }
+  rank_indexed = indexed != 0;
+  if (input->empty()) return rocksdb::Status::OK();
+
+  if (!GetDouble(input, &score_floor) || !GetFixed64(input, &head_tombstones)) {
+    return rocksdb::Status::InvalidArgument(kErrMetadataTooShort);
+  }
+  return rocksdb::Status::OK();
+}
+
+void BitmapMetadata::Encode(std::string *dst) const {
+  Metadata::Encode(dst);
+
+  // a raw bitmap is encoded the same as before the roaring encoding existed
+  if (encoding != BitmapEncoding::RAW) PutFixed8(dst, uint8_t(encoding));
+}
+
+rocksdb::Status BitmapMetadata::Decode(Slice *input) {
+  if (auto s = Metadata::Decode(input); !s.ok()) {
+    return s;
+  }
+
+  encoding = BitmapEncoding::RAW;
+  // the bitmap strings are also decoded as BitmapMetadata, and their value follows the metadata
+  if (Type() != kRedisBitmap || input->empty()) return rocksdb::Status::OK();
+
+  uint8_t encoding_value = 0;
+  if (!GetFixed8(input, &encoding_value)) {
+    return rocksdb::Status::InvalidArgument(kErrMetadataTooShort);
+  }
+  encoding = static_cast<BitmapEncoding>(encoding_value);
+  return rocksdb::Status::OK();
+}
+
+void SortedintMetadata::Encode(std::string *dst) const {
+  Metadata::Encode(dst);
+
+  // a plain sortedint is encoded the same as before the block encoding existed
+  if (encoding != SortedintEncoding::PLAIN) PutFixed8(dst, uint8_t(encoding));
+}
+
+rocksdb::Status SortedintMetadata::Decode(Slice *input) {
+  if (auto s = Metadata::Decode(input); !s.ok()) {
+    return s;
+  }
+
+  encoding = SortedintEncoding::PLAIN;
+  if (input->empty()) return rocksdb::Status::OK();
+
+  uint8_t encoding_value = 0;
+  if (!GetFixed8(input, &encoding_value)) {
+    return rocksdb::Status::InvalidArgument(kErrMetadataTooShort);
+  }
+  encoding = static_cast<SortedintEncoding>(encoding_value);
+  return rocksdb::Status::OK();
+}
+
+void JsonMetadata::SetFormat(JsonStorageFormat new_format) {
+  format = new_format;
+  if (format == JsonStorageFormat::Split) {
+    flags |= METADATA_SPLIT_MASK;
+  } else {
+    flags &= ~METADATA_SPLIT_MASK;
+  }
+}
+
 void JsonMetadata::Encode(std::string *dst) const {
   Metadata::Encode(dst);
 
@@ -476,6 +816,14 @@ rocksdb::Status JsonMetadata::Decode(Slice *input) {
 void HyperLogLogMetadata::Encode(std::string *dst) const {
   Metadata::Encode(dst);
   PutFixed8(dst, static_cast<uint8_t>(this->encode_type));
+  if (encode_type == EncodeType::SPARSE) {
+    PutFixed16(dst, static_cast<uint16_t>(sparse_registers.size()));
+    for (const auto &[index, value] : sparse_registers) {
+      PutFixed16(dst, index);
+      PutFixed8(dst, value);
+    }
+  }
+  if (cached_cardinality) PutFixed64(dst, *cached_cardinality);
 }
 
 rocksdb::Status HyperLogLogMetadata::Decode(Slice *input) {
@@ -488,10 +836,27 @@ rocksdb::Status HyperLogLogMetadata::Decode(Slice *input) {
     return rocksdb::Status::InvalidArgument(kErrMetadataTooShort);
   }
   // Check validity of encode type
-  if (encoded_type > 0) {
+  if (encoded_type > static_cast<uint8_t>(EncodeType::SPARSE)) {
     return rocksdb::Status::InvalidArgument(fmt::format("Invalid encode type {}", encoded_type));
   }
   this->encode_type = static_cast<EncodeType>(encoded_type);
 
+  sparse_registers.clear();
+  if (encode_type == EncodeType::SPARSE) {
+    uint16_t count = 0;
+    if (!GetFixed16(input, &count) || input->size() < static_cast<size_t>(count) * 3) {
+      return rocksdb::Status::InvalidArgument(kErrMetadataTooShort);
+    }
+    sparse_registers.resize(count);
+    for (auto &[index, value] : sparse_registers) {
+      GetFixed16(input, &index);
+      GetFixed8(input, &value);
+    }
+  }
+
+  cached_cardinality.reset();
+  uint64_t cardinality = 0;
+  if (GetFixed64(input, &cardinality)) cached_cardinality = cardinality;
+
   return rocksdb::Status::OK();
 }
@@ -25,13 +25,19 @@
 #include <atomic>
 #include <bitset>
 #include <initializer_list>
+#include <limits>
+#include <map>
+#include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "encoding.h"
 #include "types/redis_stream_base.h"
 
 constexpr bool USE_64BIT_COMMON_FIELD_DEFAULT = METADATA_ENCODING_VERSION != 0;
+// the subkeys of the new keys are in the compact encoding, see InternalKey
+constexpr bool USE_COMPACT_SUBKEY_DEFAULT = SUBKEY_ENCODING_VERSION != 0;
 
 // We write enum integer value of every datatype
 // explicitly since it cannot be changed once confirmed
@@ -50,6 +56,10 @@ enum RedisType : uint8_t {
   kRedisBloomFilter = 9,
   kRedisJson = 10,
   kRedisHyperLogLog = 11,
+  kRedisCuckooFilter = 12,
+  kRedisCountMinSketch = 13,
+  kRedisTopK = 14,
+  kRedisTimeSeries = 15,
 };
 
 struct RedisTypes {
@@ -89,11 +99,15 @@ enum RedisCommand {
   kRedisCmdBitOp,
   kRedisCmdBitfield,
   kRedisCmdLMove,
+  kRedisCmdSIAdd,
+  kRedisCmdSIRem,
+  kRedisCmdSetRange,
 };
 
-const std::vector<std::string> RedisTypeNames = {"none",   "string",    "hash",      "list",
-                                                 "set",    "zset",      "bitmap",    "sortedint",
-                                                 "stream", "MBbloom--", "ReJSON-RL", "hyperloglog"};
+const std::vector<std::string> RedisTypeNames = {"none",      "string",    "hash",      "list",
+                                                 "set",       "zset",      "bitmap",    "sortedint",
+                                                 "stream",    "MBbloom--", "ReJSON-RL", "hyperloglog",
+                                                 "MBbloomCF", "CMSk-TYPE", "TopK-TYPE", "TSDB-TYPE"};
 
 constexpr const char *kErrMsgWrongType = "WRONGTYPE Operation against a key holding the wrong kind of value";
 constexpr const char *kErrMsgKeyExpired = "the key was expired";
@@ -107,23 +121,56 @@ struct KeyNumStats {
   uint64_t avg_ttl = 0;
 };
 
+// ApproxKeyNumStats is the key number estimated from the table properties of the metadata column family
+struct ApproxKeyNumStats {
+  uint64_t n_key = 0;
+  uint64_t n_expired = 0;
+  uint64_t n_sub_key = 0;
+  std::map<std::string, uint64_t> type_keys;
+};
+
+// SlotStats is the size of a slot estimated from the table properties of the slot-id-encoded column families
+struct SlotStats {
+  uint64_t n_key = 0;
+  uint64_t bytes = 0;
+};
+
 [[nodiscard]] uint16_t ExtractSlotId(Slice ns_key);
 template <typename T = Slice>
 [[nodiscard]] std::tuple<T, T> ExtractNamespaceKey(Slice ns_key, bool slot_id_encoded);
 [[nodiscard]] std::string ComposeNamespaceKey(const Slice &ns, const Slice &key, bool slot_id_encoded);
 [[nodiscard]] std::string ComposeSlotKeyPrefix(const Slice &ns, int slotid);
 
+// InternalKey is the key of a subkey, which is encoded as
+//   ns_size | ns | [slot_id] | key_size (4) | key | version (8) | sub_key
+// or in the compact encoding, which refers to the key by its version instead of its name:
+//   ns_size | ns | [slot_id] | kCompactKeyMarker | version (8) | sub_key
+//
+// The versions of the keys created with USE_COMPACT_SUBKEY_DEFAULT carry kCompactVersionFlag, and
+// their subkeys are always in the compact encoding, so the keys of both encodings live together.
+// The key of a compact subkey is found by its version in the key ID column family, see Storage::GetKeyByID.
+// The parsed compact subkeys have an empty key.
 class InternalKey {
  public:
+  // the first byte of the key size is never 0xff, which would take a key of almost 4GB
+  static constexpr uint8_t kCompactKeyMarker = 0xff;
+  // the version is a timestamp in microseconds shifted by 11 bits, its highest bit is free until 2112
+  static constexpr uint64_t kCompactVersionFlag = uint64_t(1) << 63;
+
   explicit InternalKey(Slice ns_key, Slice sub_key, uint64_t version, bool slot_id_encoded);
   explicit InternalKey(Slice input, bool slot_id_encoded);
   ~InternalKey() = default;
 
+  static bool IsCompactVersion(uint64_t version) { return version & kCompactVersionFlag; }
+
   Slice GetNamespace() const;
   Slice GetKey() const;
   Slice GetSubKey() const;
   uint64_t GetVersion() const;
+  bool IsCompact() const { return IsCompactVersion(version_); }
   [[nodiscard]] std::string Encode() const;
+  // EncodePrefix encodes the key without the subkey, which is the prefix of all the subkeys of the version
+  [[nodiscard]] std::string EncodePrefix() const;
   bool operator==(const InternalKey &that) const;
 
  private:
@@ -136,14 +183,17 @@ class InternalKey {
 };
 
 constexpr uint8_t METADATA_64BIT_ENCODING_MASK = 0x80;
+constexpr uint8_t METADATA_SPLIT_MASK = 0x40;
 constexpr uint8_t METADATA_TYPE_MASK = 0x0f;
 
 class Metadata {
  public:
   // metadata flags
-  // <(1-bit) 64bit-common-field-indicator> 0 0 0 <(4-bit) redis-type>
+  // <(1-bit) 64bit-common-field-indicator> <(1-bit) split-indicator> 0 0 <(4-bit) redis-type>
   // 64bit-common-field-indicator: make `expire` and `size` 64bit instead of 32bit
   // NOTE: `expire` is stored in milliseconds for 64bit, seconds for 32bit
+  // split-indicator: the value of a single key-value type is split into subkeys,
+  // so the metadata has `version` and `size` fields like the composite types
   // redis-type: RedisType for the key-value
   uint8_t flags;
 
@@ -175,6 +225,8 @@ class Metadata {
   size_t CommonEncodedSize() const;
   int64_t TTL() const;
   timeval Time() const;
+  // VersionTimeUS returns the time in microseconds when the version was generated
+  static uint64_t VersionTimeUS(uint64_t version);
   bool Expired() const;
   bool ExpireAt(uint64_t expired_ts) const;
 
@@ -182,8 +234,10 @@ class Metadata {
   // no other key-values.
   // this means that the metadata of these types do NOT have
   // `version` and `size` field.
-  // e.g. RedisString, RedisJson
+  // e.g. RedisString, RedisJson (unless they're stored in the split format)
   bool IsSingleKVType() const;
+  // whether the value of a single key-value type is split into subkeys, e.g. the chunked strings
+  bool IsSplit() const { return flags & METADATA_SPLIT_MASK; }
 
   // return whether the `size` field of this type can be zero.
   // if a type is NOT an emptyable type,
@@ -195,16 +249,49 @@ class Metadata {
   [[nodiscard]] virtual rocksdb::Status Decode(Slice *input);
   [[nodiscard]] rocksdb::Status Decode(Slice input);
 
+  // PeekType returns the type of the encoded metadata by its first byte without decoding it,
+  // or kRedisNone if the input is empty
+  static RedisType PeekType(Slice input) {
+    return input.empty() ? kRedisNone : static_cast<RedisType>(input[0] & METADATA_TYPE_MASK);
+  }
+
+  // PeekExpireAt checks if the encoded metadata is expired at the timestamp by its flags, expire and size only,
+  // without decoding it. It returns false if the input is too short to be decoded.
+  static bool PeekExpireAt(Slice input, uint64_t expired_ts, bool *expired);
+
   bool operator==(const Metadata &that) const;
   virtual ~Metadata() = default;
 
  private:
   static uint64_t generateVersion();
+  static bool isSingleKVType(uint8_t flags);
+  static bool isEmptyableType(uint8_t flags);
 };
 
 class HashMetadata : public Metadata {
  public:
+  enum class EncodeType : uint8_t {
+    // One subkey per field in the data column family
+    SUBKEYS = 0,
+    // The fields are stored inside the metadata value, for small hashes. The sets and the sorted sets don't
+    // have it, the score index of the sorted sets and the member range scans of both are built on the subkeys
+    INLINE = 1,
+  };
+
+  EncodeType encode_type = EncodeType::SUBKEYS;
+  // Fields and values of an INLINE hash, sorted by field
+  std::vector<std::pair<std::string, std::string>> inline_fields;
+  // The fields of a SUBKEYS hash with an expire time, including the expired ones which aren't reaped yet,
+  // the expire times are only looked up if there're any, see Hash::ExpireFields
+  uint64_t expiring_fields = 0;
+
   explicit HashMetadata(bool generate_version = true) : Metadata(kRedisHash, generate_version) {}
+
+  bool IsInline() const { return encode_type == EncodeType::INLINE; }
+
+  void Encode(std::string *dst) const override;
+  using Metadata::Decode;
+  rocksdb::Status Decode(Slice *input) override;
 };
 
 class SetMetadata : public Metadata {
@@ -212,25 +299,72 @@ class SetMetadata : public Metadata {
   explicit SetMetadata(bool generate_version = true) : Metadata(kRedisSet, generate_version) {}
 };
 
+// The point tombstones left at the head of a queue-style list or zset by the pops are deleted by range
+// once there're this many of them, so the compaction checker compacts the range and drops them
+constexpr uint64_t kHeadTombstonesRangeDeletion = 1024;
+
 class ZSetMetadata : public Metadata {
  public:
+  // Whether the members are counted by their scores in the zset_rank column family, see ZSetRankIndex
+  bool rank_indexed = false;
+  // No member has a score less than this, it's raised by ZPOPMIN and lowered by ZADD, so the scans
+  // from the lowest score start from it instead of skipping the tombstones of the popped members
+  double score_floor = -std::numeric_limits<double>::infinity();
+  // The number of the members popped below the score floor since the last range deletion
+  uint64_t head_tombstones = 0;
+
   explicit ZSetMetadata(bool generate_version = true) : Metadata(kRedisZSet, generate_version) {}
+
+  void Encode(std::string *dst) const override;
+  using Metadata::Decode;
+  rocksdb::Status Decode(Slice *input) override;
+};
+
+enum class BitmapEncoding : uint8_t {
+  RAW = 0,
+  ROARING = 1,
 };
 
 class BitmapMetadata : public Metadata {
  public:
+  // The segments of a roaring encoded bitmap are stored as BitmapContainer instead of their raw bytes
+  BitmapEncoding encoding = BitmapEncoding::RAW;
+
   explicit BitmapMetadata(bool generate_version = true) : Metadata(kRedisBitmap, generate_version) {}
+
+  bool IsRoaring() const { return encoding == BitmapEncoding::ROARING; }
+
+  void Encode(std::string *dst) const override;
+  using Metadata::Decode;
+  rocksdb::Status Decode(Slice *input) override;
+};
+
+enum class SortedintEncoding : uint8_t {
+  PLAIN = 0,
+  BLOCK = 1,
 };
 
 class SortedintMetadata : public Metadata {
  public:
+  // The IDs of a block encoded sortedint are packed into SortedintBlock instead of a subkey each
+  SortedintEncoding encoding = SortedintEncoding::PLAIN;
+
   explicit SortedintMetadata(bool generate_version = true) : Metadata(kRedisSortedint, generate_version) {}
+
+  bool IsBlockEncoded() const { return encoding == SortedintEncoding::BLOCK; }
+
+  void Encode(std::string *dst) const override;
+  using Metadata::Decode;
+  rocksdb::Status Decode(Slice *input) override;
 };
 
 class ListMetadata : public Metadata {
  public:
   uint64_t head;
   uint64_t tail;
+  // The number of the elements popped from the head since the last range deletion,
+  // the elements before the head are all deleted, so they're deleted by range
+  uint64_t head_tombstones = 0;
   explicit ListMetadata(bool generate_version = true);
 
   void Encode(std::string *dst) const override;
@@ -299,9 +433,126 @@ class BloomChainMetadata : public Metadata {
   bool IsScaling() const { return expansion != 0; };
 };
 
+class CuckooFilterMetadata : public Metadata {
+ public:
+  /// The number of buckets of the first sub-filter, which is always a power of 2.
+  ///
+  /// The i-th sub-filter has num_buckets * expansion^i buckets, and `size` counts the items in all of them.
+  uint32_t num_buckets = 0;
+
+  /// The number of sub-filters
+  uint16_t n_filters = 0;
+
+  /// The number of fingerprints in each bucket
+  uint8_t bucket_size = 0;
+
+  /// The number of kick-outs tried in the last sub-filter before the item goes to a new sub-filter
+  uint16_t max_iterations = 0;
+
+  /// The growth of a new sub-filter, which is a power of 2. For non-scaling, expansion should be set to 0
+  uint16_t expansion = 0;
+
+  /// The number of items deleted from the filter
+  uint64_t num_deletes = 0;
+
+  explicit CuckooFilterMetadata(bool generate_version = true) : Metadata(kRedisCuckooFilter, generate_version) {}
+
+  void Encode(std::string *dst) const override;
+  using Metadata::Decode;
+  rocksdb::Status Decode(Slice *input) override;
+
+  uint64_t GetFilterBuckets(uint16_t filter_index) const;
+
+  /// The total number of bytes of the buckets of all sub-filters
+  uint64_t GetBytes() const;
+
+  bool IsScaling() const { return expansion != 0; };
+};
+
+class CountMinSketchMetadata : public Metadata {
+ public:
+  /// The number of counters in each row
+  uint32_t width = 0;
+
+  /// The number of rows, each row hashes the item to a counter of its own
+  uint32_t depth = 0;
+
+  /// The sum of all the increments
+  uint64_t count = 0;
+
+  explicit CountMinSketchMetadata(bool generate_version = true) : Metadata(kRedisCountMinSketch, generate_version) {}
+
+  void Encode(std::string *dst) const override;
+  using Metadata::Decode;
+  rocksdb::Status Decode(Slice *input) override;
+};
+
+class TopKMetadata : public Metadata {
+ public:
+  /// The number of the top items to keep
+  uint32_t k = 0;
+
+  /// The number of buckets in each row of the HeavyKeeper counters
+  uint32_t width = 0;
+
+  /// The number of rows of the HeavyKeeper counters
+  uint32_t depth = 0;
+
+  /// The probability to decay a counter of another item is decay^count
+  double decay = 0;
+
+  explicit TopKMetadata(bool generate_version = true) : Metadata(kRedisTopK, generate_version) {}
+
+  void Encode(std::string *dst) const override;
+  using Metadata::Decode;
+  rocksdb::Status Decode(Slice *input) override;
+};
+
+/// How a sample is added to a time series when it already has a sample of the same timestamp
+enum class TSDuplicatePolicy : uint8_t {
+  kBlock = 0,
+  kFirst = 1,
+  kLast = 2,
+  kMin = 3,
+  kMax = 4,
+  kSum = 5,
+};
+
+class TimeSeriesMetadata : public Metadata {
+ public:
+  /// The samples older than the last timestamp by more than the retention (in milliseconds) are dropped,
+  /// and they are kept forever if it's 0
+  uint64_t retention = 0;
+
+  /// A new chunk is started once the encoded chunk reaches chunk_size bytes
+  uint32_t chunk_size = 0;
+
+  TSDuplicatePolicy duplicate_policy = TSDuplicatePolicy::kBlock;
+
+  /// The timestamp of the newest sample
+  uint64_t last_timestamp = 0;
+
+  /// The first timestamp of the newest chunk, which the samples in order are appended to
+  uint64_t head_chunk = 0;
+
+  std::vector<std::pair<std::string, std::string>> labels;
+
+  explicit TimeSeriesMetadata(bool generate_version = true) : Metadata(kRedisTimeSeries, generate_version) {}
+
+  /// The samples before it are out of the retention
+  uint64_t RetainFrom() const;
+
+  void Encode(std::string *dst) const override;
+  using Metadata::Decode;
+  rocksdb::Status Decode(Slice *input) override;
+};
+
 enum class JsonStorageFormat : uint8_t {
   JSON = 0,
   CBOR = 1,
+  // every member of the root object is stored as a CBOR encoded subkey,
+  // documents whose root isn't an object are stored as CBOR
+  Split = 2,
 };
 
 class JsonMetadata : public Metadata {
@@ -312,6 +563,9 @@ class JsonMetadata : public Metadata {
 
   explicit JsonMetadata(bool generate_version = true) : Metadata(kRedisJson, generate_version) {}
 
+  // set the storage format, the split indicator of the flags follows it
+  void SetFormat(JsonStorageFormat new_format);
+
   void Encode(std::string *dst) const override;
   rocksdb::Status Decode(Slice *input) override;
 };
@@ -324,8 +578,10 @@ class HyperLogLogMetadata : public Metadata {
     // The registers are stored in 6-bit format and each segment contains
     // 768 registers.
     DENSE = 0,
-    // TODO(mwish): sparse encoding
-    // SPARSE = 1,
+    // The registers which aren't zero are stored in the metadata as the (index, value) pairs sorted by
+    // the index, so a small HyperLogLog costs only the metadata. It's promoted to the dense encoding
+    // when the pairs exceed kHyperLogLogSparseMaxRegisters.
+    SPARSE = 1,
   };
 
   explicit HyperLogLogMetadata(bool generate_version = true) : Metadata(kRedisHyperLogLog, generate_version) {}
@@ -334,4 +590,9 @@ class HyperLogLogMetadata : public Metadata {
   rocksdb::Status Decode(Slice *input) override;
 
   EncodeType encode_type = EncodeType::DENSE;
+  // The non-zero registers of the sparse encoding, sorted by the register index
+  std::vector<std::pair<uint16_t, uint8_t>> sparse_registers;
+  // The cardinality estimated by PFCOUNT or PFMERGE, and dropped by PFADD when it changes a register,
+  // like the cache bit of the Redis HLL header
+  std::optional<uint64_t> cached_cardinality;
 };
@@ -27,12 +27,15 @@
 
 #include <algorithm>
 #include <cctype>
+#include <cmath>
+#include <optional>
 #include <string>
 
 #include "commands/commander.h"
 #include "commands/error_constants.h"
 #include "db_util.h"
 #include "fmt/format.h"
+#include "lock_manager.h"
 #include "lua.h"
 #include "parse_util.h"
 #include "rand.h"
@@ -48,6 +51,9 @@
  * This should be the size of the buffer given to doule to string */
 constexpr size_t MAX_LONG_DOUBLE_CHARS = 5 * 1024;
 
+/* Lua numbers are doubles, which represent the integers below 2^53 exactly. */
+constexpr double MAX_EXACT_LUA_INTEGER = 9007199254740992.0;
+
 enum {
   LL_DEBUG = 0,
   LL_VERBOSE,
@@ -281,6 +287,25 @@ int RedisRegisterFunction(lua_State *lua) {
   return 0;
 }
 
+// The bytecode of a function library is cached under the SHA1 of its code, so a replaced library never
+// loads the bytecode of its former code
+static std::string FunctionLibBytecodeKey(const std::string &script) {
+  char sha[40 + 1] = {};
+  SHA1Hex(sha, script.c_str(), script.size());
+  return std::string("lib_") + sha;
+}
+
+// ComposeNamespaceKeys composes the keys to lock for a script run without the exclusivity
+static std::vector<std::string> ComposeNamespaceKeys(redis::Connection *conn, const std::vector<std::string> &keys) {
+  auto srv = conn->GetServer();
+  std::vector<std::string> ns_keys;
+  ns_keys.reserve(keys.size());
+  for (const auto &key : keys) {
+    ns_keys.emplace_back(ComposeNamespaceKey(conn->GetNamespace(), key, srv->storage->IsSlotIdEncoded()));
+  }
+  return ns_keys;
+}
+
 Status FunctionLoad(redis::Connection *conn, const std::string &script, bool need_to_store, bool replace,
                     [[maybe_unused]] std::string *lib_name, bool read_only) {
   std::string first_line, lua_code;
@@ -319,7 +344,7 @@ Status FunctionLoad(redis::Connection *conn, const std::string &script, bool nee
     lua_setglobal(lua, REDIS_FUNCTION_NEEDSTORE);
   });
 
-  if (luaL_loadbuffer(lua, lua_code.data(), lua_code.size(), "@user_script")) {
+  if (LoadChunk(srv, lua, FunctionLibBytecodeKey(script), lua_code)) {
     std::string err_msg = lua_tostring(lua, -1);
     lua_pop(lua, 1);
     return {Status::NotOK, "Error while compiling new function lib: " + err_msg};
@@ -374,7 +399,10 @@ bool FunctionIsLibExist(redis::Connection *conn, const std::string &libname, boo
 Status FunctionCall(redis::Connection *conn, const std::string &name, const std::vector<std::string> &keys,
                     const std::vector<std::string> &argv, std::string *output, bool read_only) {
   auto srv = conn->GetServer();
-  auto lua = read_only ? conn->Owner()->Lua() : srv->Lua();
+  // A write function run without the exclusivity locks its KEYS, and uses the worker's Lua VM like a read-only one
+  bool lock_keys = !read_only && conn->IsScriptConcurrent();
+  bool worker_lua = read_only || lock_keys;
+  auto lua = worker_lua ? conn->Owner()->Lua() : srv->Lua();
 
   lua_getglobal(lua, "__redis__err__handler");
 
@@ -389,14 +417,19 @@ Status FunctionCall(redis::Connection *conn, const std::string &name, const std:
     std::string libcode;
     s = srv->FunctionGetCode(libname, &libcode);
     if (!s) return s;
-    s = FunctionLoad(conn, libcode, false, false, &libname, read_only);
+    s = FunctionLoad(conn, libcode, false, false, &libname, worker_lua);
     if (!s) return s;
 
     lua_getglobal(lua, (REDIS_LUA_REGISTER_FUNC_PREFIX + name).c_str());
   }
 
+  std::optional<TxnLockGuard> lock_guard;
+  if (lock_keys) lock_guard.emplace(srv->storage->GetLockManager(), ComposeNamespaceKeys(conn, keys));
+
   ScriptRunCtx script_run_ctx;
   script_run_ctx.flags = read_only ? ScriptFlagType::kScriptNoWrites : 0;
+  script_run_ctx.conn = conn;
+  if (lock_keys) script_run_ctx.declared_keys = &keys;
   lua_getglobal(lua, (REDIS_LUA_REGISTER_FUNC_FLAGS_PREFIX + name).c_str());
   if (!lua_isnil(lua, -1)) {
     // It should be ensured that the conversion is successful
@@ -427,7 +460,8 @@ Status FunctionCall(redis::Connection *conn, const std::string &name, const std:
    * (and for LUA_GC_CYCLE_PERIOD collection steps) because calling it
    * for every command uses too much CPU. */
   constexpr int64_t LUA_GC_CYCLE_PERIOD = 50;
-  static int64_t gc_count = 0;
+  // the read-only scripts are run by the workers at the same time
+  thread_local int64_t gc_count = 0;
 
   gc_count++;
   if (gc_count == LUA_GC_CYCLE_PERIOD) {
@@ -597,8 +631,10 @@ Status FunctionDelete(engine::Context &ctx, Server *srv, const std::string &name
 Status EvalGenericCommand(redis::Connection *conn, const std::string &body_or_sha, const std::vector<std::string> &keys,
                           const std::vector<std::string> &argv, bool evalsha, std::string *output, bool read_only) {
   Server *srv = conn->GetServer();
-  // Use the worker's private Lua VM when entering the read-only mode
-  lua_State *lua = read_only ? conn->Owner()->Lua() : srv->Lua();
+  // Use the worker's private Lua VM when entering the read-only mode, or when a write script
+  // is run without the exclusivity by locking its KEYS
+  bool lock_keys = !read_only && conn->IsScriptConcurrent();
+  lua_State *lua = read_only || lock_keys ? conn->Owner()->Lua() : srv->Lua();
 
   /* We obtain the script SHA1, then check if this function is already
    * defined into the Lua state */
@@ -641,8 +677,13 @@ Status EvalGenericCommand(redis::Connection *conn, const std::string &body_or_sh
     lua_getglobal(lua, funcname);
   }
 
+  std::optional<TxnLockGuard> lock_guard;
+  if (lock_keys) lock_guard.emplace(srv->storage->GetLockManager(), ComposeNamespaceKeys(conn, keys));
+
   ScriptRunCtx current_script_run_ctx;
   current_script_run_ctx.flags = read_only ? ScriptFlagType::kScriptNoWrites : 0;
+  current_script_run_ctx.conn = conn;
+  if (lock_keys) current_script_run_ctx.declared_keys = &keys;
   lua_getglobal(lua, fmt::format(REDIS_LUA_FUNC_SHA_FLAGS, funcname + 2).c_str());
   if (!lua_isnil(lua, -1)) {
     // It should be ensured that the conversion is successful
@@ -688,7 +729,8 @@ Status EvalGenericCommand(redis::Connection *conn, const std::string &body_or_sh
    * (and for LUA_GC_CYCLE_PERIOD collection steps) because calling it
    * for every command uses too much CPU. */
   constexpr int64_t LUA_GC_CYCLE_PERIOD = 50;
-  static int64_t gc_count = 0;
+  // the read-only scripts are run by the workers at the same time
+  thread_local int64_t gc_count = 0;
 
   gc_count++;
   if (gc_count == LUA_GC_CYCLE_PERIOD) {
@@ -730,10 +772,16 @@ int RedisGenericCommand(lua_State *lua, int raise_error) {
   }
 
   std::vector<std::string> args;
+  args.reserve(argc);
   for (int j = 1; j <= argc; j++) {
     if (lua_type(lua, j) == LUA_TNUMBER) {
       lua_Number num = lua_tonumber(lua, j);
-      args.emplace_back(fmt::format("{:.17g}", static_cast<double>(num)));
+      // integers, e.g. counters and TTLs, are formatted the same as by %.17g, but without the float formatting
+      if (std::trunc(num) == num && std::abs(num) < MAX_EXACT_LUA_INTEGER && (num != 0 || !std::signbit(num))) {
+        args.emplace_back(std::to_string(static_cast<int64_t>(num)));
+      } else {
+        args.emplace_back(fmt::format("{:.17g}", static_cast<double>(num)));
+      }
     } else {
       size_t obj_len = 0;
       const char *obj_s = lua_tolstring(lua, j, &obj_len);
@@ -770,12 +818,41 @@ int RedisGenericCommand(lua_State *lua, int raise_error) {
     return raise_error ? RaiseError(lua) : 1;
   }
 
+  if (script_run_ctx->declared_keys) {
+    if (cmd_flags & redis::kCmdExclusive) {
+      PushError(lua, "Exclusive commands are not allowed from the scripts locking their declared keys");
+      return raise_error ? RaiseError(lua) : 1;
+    }
+    bool has_keys = false, undeclared = false;
+    const auto &declared_keys = *script_run_ctx->declared_keys;
+    attributes->ForEachKeyRange(
+        [&](const std::vector<std::string> &args, const redis::CommandKeyRange &key_range) {
+          key_range.ForEachKey(
+              [&](const std::string &key) {
+                has_keys = true;
+                if (std::find(declared_keys.begin(), declared_keys.end(), key) == declared_keys.end()) {
+                  undeclared = true;
+                }
+              },
+              args);
+        },
+        args);
+    if (undeclared) {
+      PushError(lua, "Script attempted to access a key not declared in KEYS");
+      return raise_error ? RaiseError(lua) : 1;
+    }
+    if ((cmd_flags & redis::kCmdWrite) && !has_keys) {
+      PushError(lua, "Write commands without keys are not allowed from the scripts locking their declared keys");
+      return raise_error ? RaiseError(lua) : 1;
+    }
+  }
+
   std::string cmd_name = attributes->name;
 
   auto srv = GetServer(lua);
   Config *config = srv->GetConfig();
 
-  redis::Connection *conn = srv->GetCurrentConnection();
+  redis::Connection *conn = script_run_ctx->conn;
   if (config->cluster_enabled) {
     if (script_run_ctx->flags & ScriptFlagType::kScriptNoCluster) {
       PushError(lua, "Can not run script on cluster, 'no-cluster' flag is set");
@@ -797,6 +874,11 @@ int RedisGenericCommand(lua_State *lua, int raise_error) {
     return raise_error ? RaiseError(lua) : 1;
   }
 
+  if (srv->storage->IsSecondary() && (cmd_flags & redis::kCmdWrite)) {
+    PushError(lua, "READONLY You can't write against a secondary instance.");
+    return raise_error ? RaiseError(lua) : 1;
+  }
+
   if (!config->slave_serve_stale_data && srv->IsSlave() && cmd_name != "info" && cmd_name != "slaveof" &&
       srv->GetReplicationState() != kReplConnected) {
     PushError(lua,
@@ -896,7 +978,12 @@ int RedisReturnSingleFieldTable(lua_State *lua, const char *field) {
 
 int RedisSetResp(lua_State *lua) {
   auto srv = GetServer(lua);
-  auto conn = srv->GetCurrentConnection();
+  auto *script_run_ctx = GetFromRegistry<ScriptRunCtx>(lua, REGISTRY_SCRIPT_RUN_CTX_NAME);
+  if (!script_run_ctx) {
+    PushError(lua, "redis.setresp() can only be called inside a script invocation");
+    return RaiseError(lua);
+  }
+  auto conn = script_run_ctx->conn;
 
   if (lua_gettop(lua) != 1) {
     PushError(lua, "redis.setresp() requires one argument.");
@@ -1033,23 +1120,36 @@ const char *RedisProtocolToLuaType(lua_State *lua, const char *reply) {
   return p;
 }
 
+/* Parse the integer of a reply which is terminated by CRLF, e.g. the length of a bulk string,
+ * and return the position after the CRLF. Like the rest of the conversion, it doesn't validate
+ * the reply, and avoids copying the integer into a string to parse it. */
+static const char *ParseProtocolInteger(const char *p, int64_t *value) {
+  bool negative = *p == '-';
+  if (negative) p++;
+
+  uint64_t v = 0;
+  for (; *p != '\r'; p++) v = v * 10 + (*p - '0');
+  *value = negative ? static_cast<int64_t>(0 - v) : static_cast<int64_t>(v);
+  return p + 2;
+}
+
 const char *RedisProtocolToLuaTypeInt(lua_State *lua, const char *reply) {
-  const char *p = strchr(reply + 1, '\r');
-  auto value = ParseInt<int64_t>(std::string(reply + 1, p - reply - 1), 10).ValueOr(0);
+  int64_t value = 0;
+  const char *p = ParseProtocolInteger(reply + 1, &value);
   lua_pushnumber(lua, static_cast<lua_Number>(value));
-  return p + 2;
+  return p;
 }
 
 const char *RedisProtocolToLuaTypeBulk(lua_State *lua, const char *reply) {
-  const char *p = strchr(reply + 1, '\r');
-  auto bulklen = ParseInt<int64_t>(std::string(reply + 1, p - reply - 1), 10).ValueOr(0);
+  int64_t bulklen = 0;
+  const char *p = ParseProtocolInteger(reply + 1, &bulklen);
 
   if (bulklen == -1) {
     lua_pushboolean(lua, 0);
-    return p + 2;
+    return p;
   } else {
-    lua_pushlstring(lua, p + 2, bulklen);
-    return p + 2 + bulklen + 2;
+    lua_pushlstring(lua, p, bulklen);
+    return p + bulklen + 2;
   }
 }
 
@@ -1074,17 +1174,16 @@ const char *RedisProtocolToLuaTypeError(lua_State *lua, const char *reply) {
 }
 
 const char *RedisProtocolToLuaTypeAggregate(lua_State *lua, const char *reply, int atype) {
-  const char *p = strchr(reply + 1, '\r');
-  int64_t mbulklen = ParseInt<int64_t>(std::string(reply + 1, p - reply - 1), 10).ValueOr(0);
+  int64_t mbulklen = 0;
+  const char *p = ParseProtocolInteger(reply + 1, &mbulklen);
   int j = 0;
 
-  p += 2;
   if (mbulklen == -1) {
     lua_pushboolean(lua, 0);
     return p;
   }
   if (atype == '*') {
-    lua_newtable(lua);
+    lua_createtable(lua, static_cast<int>(mbulklen), 0);
     for (j = 0; j < mbulklen; j++) {
       lua_pushnumber(lua, j + 1);
       p = RedisProtocolToLuaType(lua, p);
@@ -1158,9 +1257,8 @@ const char *RedisProtocolToLuaTypeBigNumber(lua_State *lua, const char *reply) {
 }
 
 const char *RedisProtocolToLuaTypeVerbatimString(lua_State *lua, const char *reply) {
-  const char *p = strchr(reply + 1, '\r');
-  int64_t bulklen = ParseInt<int64_t>(std::string(reply + 1, p - reply - 1), 10).ValueOr(0);
-  p += 2;  // skip \r\n
+  int64_t bulklen = 0;
+  const char *p = ParseProtocolInteger(reply + 1, &bulklen);
 
   lua_newtable(lua);
   lua_pushstring(lua, "verbatim_string");
@@ -1504,7 +1602,7 @@ Status CreateFunction(Server *srv, const std::string &body, std::string *sha, lu
   lua_pushinteger(lua, static_cast<lua_Integer>(script_flags));
   lua_setglobal(lua, fmt::format(REDIS_LUA_FUNC_SHA_FLAGS, *sha).c_str());
 
-  if (luaL_loadbuffer(lua, lua_code.data(), lua_code.size(), "@user_script")) {
+  if (LoadChunk(srv, lua, *sha, lua_code)) {
     std::string err_msg = lua_tostring(lua, -1);
     lua_pop(lua, 1);
     return {Status::NotOK, "Error while compiling new script: " + err_msg};
@@ -1515,6 +1613,52 @@ Status CreateFunction(Server *srv, const std::string &body, std::string *sha, lu
   return need_to_store ? srv->ScriptSet(*sha, body) : Status::OK();
 }
 
+static int WriteBytecode([[maybe_unused]] lua_State *lua, const void *p, size_t size, void *ud) {
+  static_cast<std::string *>(ud)->append(static_cast<const char *>(p), size);
+  return 0;
+}
+
+int LoadChunk(Server *srv, lua_State *lua, const std::string &key, std::string_view code) {
+  std::string bytecode;
+  if (srv->LuaBytecodes()->Get(key, &bytecode)) {
+    if (!luaL_loadbuffer(lua, bytecode.data(), bytecode.size(), "@user_script")) return 0;
+    // compile the code again if the bytecode can't be loaded
+    lua_pop(lua, 1);
+  }
+
+  if (auto res = luaL_loadbuffer(lua, code.data(), code.size(), "@user_script")) return res;
+
+  bytecode.clear();
+  if (!lua_dump(lua, WriteBytecode, &bytecode)) srv->LuaBytecodes()->Put(key, std::move(bytecode));
+  return 0;
+}
+
+void WarmUpBytecodeCache(Server *srv) {
+  auto lua = srv->Lua();
+  engine::Context ctx(srv->storage);
+  util::UniqueIterator iter(ctx, ctx.DefaultScanOptions(), ColumnFamilyID::Propagate);
+
+  size_t scripts = 0, libs = 0;
+  std::string_view script_prefix = engine::kLuaFuncSHAPrefix;
+  for (iter->Seek(script_prefix); iter->Valid() && iter->key().starts_with(script_prefix); iter->Next()) {
+    auto sha = iter->key().ToString().substr(script_prefix.size());
+    if (CreateFunction(srv, iter->value().ToString(), &sha, lua, false)) scripts++;
+  }
+
+  std::string_view lib_prefix = engine::kLuaLibCodePrefix;
+  for (iter->Seek(lib_prefix); iter->Valid() && iter->key().starts_with(lib_prefix); iter->Next()) {
+    // only the library code is compiled, the functions are registered by the first call of them
+    auto script = iter->value().ToString();
+    auto pos = script.find('\n');
+    if (pos == std::string::npos) continue;
+
+    if (!LoadChunk(srv, lua, FunctionLibBytecodeKey(script), std::string_view(script).substr(pos + 1))) libs++;
+    lua_pop(lua, 1);
+  }
+
+  LOG(INFO) << "[Lua] Compiled " << scripts << " scripts and " << libs << " function libraries";
+}
+
 [[nodiscard]] StatusOr<std::string> ExtractLibNameFromShebang(std::string_view shebang) {
   static constexpr std::string_view lua_shebang_prefix = "#!lua";
   static constexpr std::string_view shebang_libname_prefix = "name=";
@@ -1573,6 +1717,13 @@ Status CreateFunction(Server *srv, const std::string &body, std::string *sha, lu
   return flags;
 }
 
+bool IsNoWritesScript(std::string_view body) {
+  if (body.substr(0, 2) != "#!") return false;
+
+  auto flags = ExtractFlagsFromShebang(body.substr(0, body.find('\n')));
+  return flags && (*flags & kScriptNoWrites);
+}
+
 [[nodiscard]] StatusOr<ScriptFlags> ExtractFlagsFromShebang(std::string_view shebang) {
   static constexpr std::string_view lua_shebang_prefix = "#!lua";
   static constexpr std::string_view shebang_flags_prefix = "flags=";
@@ -64,6 +64,13 @@ int RedisSetResp(lua_State *lua);
 
 Status CreateFunction(Server *srv, const std::string &body, std::string *sha, lua_State *lua, bool need_to_store);
 
+/// LoadChunk pushes the function of the Lua code like luaL_loadbuffer, but loads the bytecode cached
+/// under the key in the BytecodeCache of the server if any Lua VM has compiled the code before.
+int LoadChunk(Server *srv, lua_State *lua, const std::string &key, std::string_view code);
+/// WarmUpBytecodeCache compiles the stored scripts and function libraries into the BytecodeCache,
+/// and defines the scripts in the Lua VM of the server
+void WarmUpBytecodeCache(Server *srv);
+
 Status EvalGenericCommand(redis::Connection *conn, const std::string &body_or_sha, const std::vector<std::string> &keys,
                           const std::vector<std::string> &argv, bool evalsha, std::string *output,
                           bool read_only = false);
@@ -130,6 +137,10 @@ using ScriptFlags = uint64_t;
 [[nodiscard]] StatusOr<std::string> ExtractLibNameFromShebang(std::string_view shebang);
 [[nodiscard]] StatusOr<ScriptFlags> ExtractFlagsFromShebang(std::string_view shebang);
 
+/// IsNoWritesScript returns true if the shebang of an Eval script declares the no-writes flag.
+/// Such a script is run like EVAL_RO, i.e. concurrently on the Lua VM of the worker.
+bool IsNoWritesScript(std::string_view body);
+
 /// GetFlagsFromStrings gets flags from flags_content and composites them together.
 /// Each element in flags_content should correspond to a string form of ScriptFlagType
 [[nodiscard]] StatusOr<ScriptFlags> GetFlagsFromStrings(const std::vector<std::string> &flags_content);
@@ -146,6 +157,11 @@ using ScriptFlags = uint64_t;
 struct ScriptRunCtx {
   // ScriptFlags
   uint64_t flags = 0;
+  // the connection which runs the script, the read-only scripts of different connections
+  // are run at the same time, so it can't be kept in the server
+  redis::Connection *conn = nullptr;
+  // the KEYS of a write script run without the exclusivity, which are the only keys it can access
+  const std::vector<std::string> *declared_keys = nullptr;
   // current_slot tracks the slot currently accessed by the script
   // and is used to detect whether there is cross-slot access
   // between multiple commands in a script or function.
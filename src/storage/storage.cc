@@ -26,26 +26,38 @@
 #include <rocksdb/convenience.h>
 #include <rocksdb/env.h>
 #include <rocksdb/filter_policy.h>
+#include <rocksdb/memtablerep.h>
 #include <rocksdb/rate_limiter.h>
+#include <rocksdb/slice_transform.h>
 #include <rocksdb/sst_file_manager.h>
+#include <rocksdb/sst_file_reader.h>
+#include <rocksdb/statistics.h>
 #include <rocksdb/utilities/checkpoint.h>
 #include <rocksdb/utilities/table_properties_collectors.h>
 
 #include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <limits>
 #include <memory>
+#include <optional>
 #include <random>
 
 #include "compact_filter.h"
 #include "db_util.h"
 #include "event_listener.h"
 #include "event_util.h"
+#include "parse_util.h"
 #include "redis_db.h"
 #include "redis_metadata.h"
 #include "rocksdb/cache.h"
 #include "rocksdb_crc32c.h"
 #include "server/server.h"
 #include "storage/batch_indexer.h"
+#include "storage/huge_page_allocator.h"
+#include "string_util.h"
+#include "subkey_prefix_extractor.h"
+#include "ttl_index.h"
 #include "table_properties_collector.h"
 #include "time_util.h"
 #include "unique_fd.h"
@@ -53,6 +65,12 @@
 namespace engine {
 
 constexpr const char *kReplicationIdKey = "replication_id_";
+constexpr const char *kLastIngestSeqKey = "last_ingest_seq_";
+constexpr std::string_view kStagedVersionKeyPrefix = "staged_version_";
+
+static std::string StagedVersionKey(uint64_t version) {
+  return std::string(kStagedVersionKeyPrefix) + std::to_string(version);
+}
 
 // used in creating rocksdb::LRUCache, set `num_shard_bits` to -1 means let rocksdb choose a good default shard count
 // based on the capacity and the implementation.
@@ -83,6 +101,14 @@ Storage::Storage(Config *config)
       db_stats_(std::make_unique<DBStats>()) {
   Metadata::InitVersionCounter();
   SetWriteOptions(config->rocks_db.write_options);
+  if (config->metadata_cache_size > 0 || config->metadata_cache_absent_size > 0) {
+    metadata_cache_ = std::make_unique<MetadataCache>(static_cast<size_t>(config->metadata_cache_size) * MiB,
+                                                      static_cast<size_t>(config->metadata_cache_absent_size) * MiB);
+  }
+  if (config->block_cache_warmup_keys > 0) {
+    cache_warmup_ = std::make_unique<CacheWarmup>(config->CacheWarmupFilePath(),
+                                                  static_cast<size_t>(config->block_cache_warmup_keys));
+  }
 }
 
 Storage::~Storage() {
@@ -94,7 +120,15 @@ void Storage::CloseDB() {
   auto guard = WriteLockGuard();
   if (!db_) return;
 
+  if (cache_warmup_) {
+    auto s = cache_warmup_->Dump();
+    if (!s.IsOK()) LOG(WARNING) << "[storage] Failed to save the keys for the block cache warmup: " << s.Msg();
+  }
   db_closing_ = true;
+  {
+    std::lock_guard<std::mutex> shared_snapshot_guard(shared_snapshot_mu_);
+    shared_snapshot_.reset();
+  }
   db_->SyncWAL();
   rocksdb::CancelAllBackgroundWork(db_.get(), true);
   for (auto handle : cf_handles_) db_->DestroyColumnFamilyHandle(handle);
@@ -113,10 +147,28 @@ rocksdb::ReadOptions Storage::DefaultScanOptions() const {
   rocksdb::ReadOptions read_options;
   read_options.fill_cache = false;
   read_options.async_io = config_->rocks_db.read_options.async_io;
+  // Only use the prefix bloom filters when the upper bound keeps the scan inside one prefix
+  read_options.auto_prefix_mode = true;
+  // Keep the readahead size across the files of a level instead of starting over from each file
+  read_options.adaptive_readahead = true;
 
   return read_options;
 }
 
+rocksdb::ReadOptions Storage::SubKeyScanOptions(uint64_t n) const {
+  // Rough size of a subkey with its value, to turn a number of subkeys into bytes
+  constexpr uint64_t kEstimatedSubKeyBytes = 64;
+  // Fewer subkeys fit in a few blocks, which the automatic readahead handles well
+  constexpr uint64_t kMinReadaheadSubKeys = 256;
+
+  rocksdb::ReadOptions read_options = DefaultScanOptions();
+  auto budget = static_cast<uint64_t>(config_->rocks_db.read_options.max_scan_readahead_size);
+  if (budget > 0 && n >= kMinReadaheadSubKeys) {
+    read_options.readahead_size = std::min(n * kEstimatedSubKeyBytes, budget);
+  }
+  return read_options;
+}
+
 rocksdb::ReadOptions Storage::DefaultMultiGetOptions() const {
   rocksdb::ReadOptions read_options;
   read_options.async_io = config_->rocks_db.read_options.async_io;
@@ -124,12 +176,24 @@ rocksdb::ReadOptions Storage::DefaultMultiGetOptions() const {
   return read_options;
 }
 
-rocksdb::BlockBasedTableOptions Storage::InitTableOptions() {
+rocksdb::BlockBasedTableOptions Storage::InitTableOptions(int filter_bits_per_key) {
   rocksdb::BlockBasedTableOptions table_options;
   table_options.format_version = 5;
-  table_options.index_type = rocksdb::BlockBasedTableOptions::IndexType::kTwoLevelIndexSearch;
-  table_options.filter_policy.reset(rocksdb::NewBloomFilterPolicy(10, false));
-  table_options.partition_filters = true;
+  if (config_->rocks_db.partition_index_and_filters) {
+    // Only the top level index of the partitions has to stay in memory, the partitions are cached like data blocks
+    table_options.index_type = rocksdb::BlockBasedTableOptions::IndexType::kTwoLevelIndexSearch;
+    table_options.partition_filters = true;
+    table_options.pin_top_level_index_and_filter = config_->rocks_db.pin_top_level_index_and_filter;
+  } else {
+    table_options.index_type = rocksdb::BlockBasedTableOptions::IndexType::kBinarySearch;
+  }
+  // A Ribbon filter takes about 30% less memory than a Bloom filter of the same false positive rate,
+  // at the cost of more CPU to build it, so the filters of L0 are still Bloom ones since they're built by flushes
+  if (config_->rocks_db.filter_policy == FilterPolicyType::kRibbon) {
+    table_options.filter_policy.reset(rocksdb::NewRibbonFilterPolicy(filter_bits_per_key, 1));
+  } else {
+    table_options.filter_policy.reset(rocksdb::NewBloomFilterPolicy(filter_bits_per_key, false));
+  }
   table_options.optimize_filters_for_memory = true;
   table_options.metadata_block_size = 4096;
   table_options.data_block_index_type = rocksdb::BlockBasedTableOptions::DataBlockIndexType::kDataBlockBinaryAndHash;
@@ -148,6 +212,22 @@ void Storage::SetBlobDB(rocksdb::ColumnFamilyOptions *cf_options) {
   cf_options->blob_garbage_collection_age_cutoff = config_->rocks_db.blob_garbage_collection_age_cutoff / 100.0;
 }
 
+bool Storage::IsCompressionDictColumnFamily(std::string_view cf_name) const {
+  for (const auto &name : util::Split(config_->rocks_db.compression_dict_column_families, ", ")) {
+    if (name == cf_name) return true;
+  }
+  return false;
+}
+
+void Storage::SetCompressionDict(const std::string &cf_name, rocksdb::ColumnFamilyOptions *cf_options) {
+  if (!IsCompressionDictColumnFamily(cf_name)) return;
+  // The small values of a column family are alike, a dictionary sampled from the blocks of an SST file
+  // is shared by all of its blocks, and zstd trains a better one from up to zstd_max_train_bytes
+  cf_options->compression_opts.max_dict_bytes = static_cast<uint32_t>(config_->rocks_db.compression_max_dict_bytes);
+  cf_options->compression_opts.zstd_max_train_bytes =
+      static_cast<uint32_t>(config_->rocks_db.compression_zstd_max_train_bytes);
+}
+
 rocksdb::Options Storage::InitRocksDBOptions() {
   rocksdb::Options options;
   options.create_if_missing = true;
@@ -158,6 +238,11 @@ rocksdb::Options Storage::InitRocksDBOptions() {
   options.statistics = rocksdb::CreateDBStatistics();
   options.stats_dump_period_sec = config_->rocks_db.stats_dump_period_sec;
   options.max_open_files = config_->rocks_db.max_open_files;
+  options.max_file_opening_threads = config_->rocks_db.max_file_opening_threads;
+  if (config_->rocks_db.fast_open) {
+    options.skip_stats_update_on_db_open = true;
+    options.skip_checking_sst_file_sizes_on_db_open = true;
+  }
   options.compaction_style = rocksdb::CompactionStyle::kCompactionStyleLevel;
   options.max_subcompactions = static_cast<uint32_t>(config_->rocks_db.max_subcompactions);
   options.max_background_flushes = config_->rocks_db.max_background_flushes;
@@ -165,8 +250,14 @@ rocksdb::Options Storage::InitRocksDBOptions() {
   options.max_write_buffer_number = config_->rocks_db.max_write_buffer_number;
   options.min_write_buffer_number_to_merge = 2;
   options.write_buffer_size = config_->rocks_db.write_buffer_size * MiB;
+  // the arena blocks of the memtables are mapped on the huge pages reserved by vm.nr_hugepages,
+  // and RocksDB falls back to malloc if there's none left
+  if (config_->rocks_db.huge_pages == HugePageMode::kExplicit) {
+    options.memtable_huge_page_size = HugePageAllocator::kHugePageSize;
+  }
   options.num_levels = 7;
   options.compression_opts.level = config_->rocks_db.compression_level;
+  options.compression_opts.parallel_threads = static_cast<uint32_t>(config_->rocks_db.compression_parallel_threads);
   options.compression_per_level.resize(options.num_levels);
   // only compress levels >= 2
   for (int i = 0; i < options.num_levels; ++i) {
@@ -183,6 +274,8 @@ rocksdb::Options Storage::InitRocksDBOptions() {
   }
 
   options.enable_pipelined_write = config_->rocks_db.enable_pipelined_write;
+  // the hash memtables don't support the concurrent writes, which can only be turned off for the whole DB
+  options.allow_concurrent_memtable_write = config_->rocks_db.metadata_memtable == MemtableType::kSkipList;
   options.target_file_size_base = config_->rocks_db.target_file_size_base * MiB;
   options.max_manifest_file_size = 64 * MiB;
   options.max_log_file_size = 256 * MiB;
@@ -211,6 +304,21 @@ rocksdb::Options Storage::InitRocksDBOptions() {
   options.max_bytes_for_level_base = config_->rocks_db.max_bytes_for_level_base;
   options.max_bytes_for_level_multiplier = config_->rocks_db.max_bytes_for_level_multiplier;
   options.level_compaction_dynamic_level_bytes = config_->rocks_db.level_compaction_dynamic_level_bytes;
+  options.ttl = static_cast<uint64_t>(config_->rocks_db.ttl);
+  options.periodic_compaction_seconds = static_cast<uint64_t>(config_->rocks_db.periodic_compaction_seconds);
+  // the temperature is recorded in the SST files of the last level, and the data written in the last
+  // preclude_last_level_data_seconds seconds is kept in the level above it
+  options.last_level_temperature = config_->rocks_db.last_level_temperature;
+  options.preclude_last_level_data_seconds =
+      static_cast<uint64_t>(config_->rocks_db.preclude_last_level_data_seconds);
+  // the upper levels are placed in db_dir up to its target size, and the lower ones in cold_dir.
+  // NOTE: RocksDB disables level_compaction_dynamic_level_bytes if there're multiple paths
+  if (!config_->rocks_db.cold_dir.empty() && config_->rocks_db.hot_dir_target_size > 0) {
+    options.db_paths = {
+        {config_->db_dir, static_cast<uint64_t>(config_->rocks_db.hot_dir_target_size) * MiB},
+        {config_->rocks_db.cold_dir, std::numeric_limits<uint64_t>::max()},
+    };
+  }
   options.max_background_jobs = config_->rocks_db.max_background_jobs;
 
   // avoid blocking io on iteration
@@ -227,6 +335,15 @@ Status Storage::SetOptionForAllColumnFamilies(const std::string &key, const std:
   return Status::OK();
 }
 
+Status Storage::SetOptionForDictColumnFamilies(const std::string &key, const std::string &value) {
+  for (auto &cf_handle : cf_handles_) {
+    if (!IsCompressionDictColumnFamily(cf_handle->GetName())) continue;
+    auto s = db_->SetOptions(cf_handle, {{key, value}});
+    if (!s.ok()) return {Status::NotOK, s.ToString()};
+  }
+  return Status::OK();
+}
+
 Status Storage::SetDBOption(const std::string &key, const std::string &value) {
   auto s = db_->SetDBOptions({{key, value}});
   if (!s.ok()) return {Status::NotOK, s.ToString()};
@@ -269,6 +386,8 @@ Status Storage::CreateColumnFamilies(const rocksdb::Options &options) {
 Status Storage::Open(DBOpenMode mode) {
   auto guard = WriteLockGuard();
   db_closing_ = false;
+  // The DB may be replaced by a checkpoint or a full sync
+  if (metadata_cache_) metadata_cache_->Clear();
 
   bool cache_index_and_filter_blocks = config_->rocks_db.cache_index_and_filter_blocks;
   size_t block_cache_size = config_->rocks_db.block_cache_size * MiB;
@@ -279,6 +398,10 @@ Status Storage::Open(DBOpenMode mode) {
   }
 
   rocksdb::Options options = InitRocksDBOptions();
+  if (mode == kDBOpenModeAsSecondaryInstance) {
+    // A secondary instance must keep all the table files open, since the primary may delete them
+    options.max_open_files = -1;
+  }
   if (mode == kDBOpenModeDefault) {
     if (auto s = CreateColumnFamilies(options); !s.IsOK()) {
       return s.Prefixed("failed to create column families");
@@ -287,15 +410,45 @@ Status Storage::Open(DBOpenMode mode) {
 
   std::shared_ptr<rocksdb::Cache> shared_block_cache;
 
-  if (config_->rocks_db.block_cache_type == BlockCacheType::kCacheTypeLRU) {
-    shared_block_cache = rocksdb::NewLRUCache(block_cache_size, kRocksdbLRUAutoAdjustShardBits,
-                                              kRocksdbCacheStrictCapacityLimit, kRocksdbLRUBlockCacheHighPriPoolRatio);
+  rocksdb::LRUCacheOptions lru_cache_options(block_cache_size, kRocksdbLRUAutoAdjustShardBits,
+                                             kRocksdbCacheStrictCapacityLimit, kRocksdbLRUBlockCacheHighPriPoolRatio);
+  rocksdb::HyperClockCacheOptions hcc_cache_options(block_cache_size, kRockdbHCCAutoAdjustCharge);
+  bool use_lru = config_->rocks_db.block_cache_type == BlockCacheType::kCacheTypeLRU;
+  if (config_->rocks_db.huge_pages != HugePageMode::kNone) {
+    if (auto allocator = HugePageAllocator::Get(config_->rocks_db.huge_pages)) {
+      lru_cache_options.memory_allocator = *allocator;
+      hcc_cache_options.memory_allocator = *allocator;
+    } else {
+      LOG(WARNING) << "[storage] Failed to allocate the block cache on huge pages, the normal pages are used: "
+                   << allocator.Msg();
+    }
+  }
+  if (size_t secondary_cache_size = config_->rocks_db.compressed_secondary_cache_size * MiB;
+      secondary_cache_size > 0) {
+    // The tiered cache splits its total capacity between the block cache and the compressed secondary cache
+    rocksdb::TieredCacheOptions tiered_cache_options;
+    tiered_cache_options.cache_type =
+        use_lru ? rocksdb::PrimaryCacheType::kCacheTypeLRU : rocksdb::PrimaryCacheType::kCacheTypeHCC;
+    tiered_cache_options.cache_opts = use_lru ? static_cast<rocksdb::ShardedCacheOptions *>(&lru_cache_options)
+                                              : static_cast<rocksdb::ShardedCacheOptions *>(&hcc_cache_options);
+    tiered_cache_options.total_capacity = block_cache_size + secondary_cache_size;
+    tiered_cache_options.compressed_secondary_ratio =
+        static_cast<double>(secondary_cache_size) / static_cast<double>(tiered_cache_options.total_capacity);
+    tiered_cache_options.adm_policy = config_->rocks_db.secondary_cache_admission_policy;
+    shared_block_cache = rocksdb::NewTieredCache(tiered_cache_options);
+    if (!shared_block_cache) return {Status::NotOK, "failed to create the tiered block cache"};
+    tiered_cache_tuner_ = std::make_unique<TieredCacheTuner>(tiered_cache_options.compressed_secondary_ratio);
+  } else if (use_lru) {
+    shared_block_cache = lru_cache_options.MakeSharedCache();
+    tiered_cache_tuner_ = nullptr;
   } else {
-    rocksdb::HyperClockCacheOptions hcc_cache_options(block_cache_size, kRockdbHCCAutoAdjustCharge);
     shared_block_cache = hcc_cache_options.MakeSharedCache();
+    tiered_cache_tuner_ = nullptr;
   }
+  block_cache_ = shared_block_cache;
 
-  rocksdb::BlockBasedTableOptions metadata_table_opts = InitTableOptions();
+  rocksdb::BlockBasedTableOptions metadata_table_opts =
+      InitTableOptions(config_->rocks_db.metadata_filter_bits_per_key);
   metadata_table_opts.block_cache = shared_block_cache;
   metadata_table_opts.pin_l0_filter_and_index_blocks_in_cache = true;
   metadata_table_opts.cache_index_and_filter_blocks = cache_index_and_filter_blocks;
@@ -307,12 +460,25 @@ Status Storage::Open(DBOpenMode mode) {
   metadata_opts.disable_auto_compactions = config_->rocks_db.disable_auto_compactions;
   // Enable whole key bloom filter in memtable
   metadata_opts.memtable_whole_key_filtering = true;
-  metadata_opts.memtable_prefix_bloom_size_ratio = 0.1;
+  metadata_opts.memtable_prefix_bloom_size_ratio = config_->rocks_db.metadata_memtable_bloom_percentage / 100.0;
+  if (config_->rocks_db.metadata_memtable != MemtableType::kSkipList) {
+    // The whole user key is the prefix, so a point lookup only searches its own bucket. The iterators
+    // still see the keys in order, since they're either total order or in auto prefix mode.
+    metadata_opts.prefix_extractor.reset(rocksdb::NewNoopTransform());
+    if (config_->rocks_db.metadata_memtable == MemtableType::kHashSkipList) {
+      metadata_opts.memtable_factory.reset(rocksdb::NewHashSkipListRepFactory());
+    } else {
+      metadata_opts.memtable_factory.reset(rocksdb::NewHashLinkListRepFactory());
+    }
+  }
   metadata_opts.table_properties_collector_factories.emplace_back(
       NewCompactOnExpiredTableCollectorFactory(std::string(kMetadataColumnFamilyName), 0.3));
+  if (config_->slot_id_encoded) {
+    metadata_opts.table_properties_collector_factories.emplace_back(std::make_shared<SlotStatsCollectorFactory>(true));
+  }
   SetBlobDB(&metadata_opts);
 
-  rocksdb::BlockBasedTableOptions subkey_table_opts = InitTableOptions();
+  rocksdb::BlockBasedTableOptions subkey_table_opts = InitTableOptions(config_->rocks_db.subkey_filter_bits_per_key);
   subkey_table_opts.block_cache = shared_block_cache;
   subkey_table_opts.pin_l0_filter_and_index_blocks_in_cache = true;
   subkey_table_opts.cache_index_and_filter_blocks = cache_index_and_filter_blocks;
@@ -323,6 +489,14 @@ Status Storage::Open(DBOpenMode mode) {
   subkey_opts.disable_auto_compactions = config_->rocks_db.disable_auto_compactions;
   subkey_opts.table_properties_collector_factories.emplace_back(
       NewCompactOnExpiredTableCollectorFactory(std::string(kPrimarySubkeyColumnFamilyName), 0.3));
+  if (config_->slot_id_encoded) {
+    subkey_opts.table_properties_collector_factories.emplace_back(std::make_shared<SlotStatsCollectorFactory>(false));
+  }
+  if (config_->rocks_db.subkey_prefix_bloom) {
+    // Bloom filters on the key+version prefix, so point lookups and scans of a key skip files without its subkeys
+    subkey_opts.prefix_extractor = NewSubKeyPrefixExtractor(config_->slot_id_encoded);
+    subkey_opts.memtable_prefix_bloom_size_ratio = 0.1;
+  }
   SetBlobDB(&subkey_opts);
 
   rocksdb::BlockBasedTableOptions pubsub_table_opts = InitTableOptions();
@@ -346,6 +520,17 @@ Status Storage::Open(DBOpenMode mode) {
   search_opts.disable_auto_compactions = config_->rocks_db.disable_auto_compactions;
   SetBlobDB(&search_opts);
 
+  rocksdb::BlockBasedTableOptions ttl_index_table_opts = InitTableOptions();
+  rocksdb::ColumnFamilyOptions ttl_index_opts(options);
+  ttl_index_opts.table_factory.reset(rocksdb::NewBlockBasedTableFactory(ttl_index_table_opts));
+  ttl_index_opts.disable_auto_compactions = config_->rocks_db.disable_auto_compactions;
+
+  rocksdb::BlockBasedTableOptions key_id_table_opts = InitTableOptions();
+  rocksdb::ColumnFamilyOptions key_id_opts(options);
+  key_id_opts.table_factory.reset(rocksdb::NewBlockBasedTableFactory(key_id_table_opts));
+  key_id_opts.compaction_filter_factory = std::make_shared<KeyIDFilterFactory>(this);
+  key_id_opts.disable_auto_compactions = config_->rocks_db.disable_auto_compactions;
+
   std::vector<rocksdb::ColumnFamilyDescriptor> column_families;
   // Caution: don't change the order of column family, or the handle will be mismatched
   column_families.emplace_back(rocksdb::kDefaultColumnFamilyName, subkey_opts);
@@ -355,6 +540,17 @@ Status Storage::Open(DBOpenMode mode) {
   column_families.emplace_back(std::string(kPropagateColumnFamilyName), propagate_opts);
   column_families.emplace_back(std::string(kStreamColumnFamilyName), subkey_opts);
   column_families.emplace_back(std::string(kSearchColumnFamilyName), search_opts);
+  column_families.emplace_back(std::string(kTTLIndexColumnFamilyName), ttl_index_opts);
+  column_families.emplace_back(std::string(kZSetRankColumnFamilyName), subkey_opts);
+  column_families.emplace_back(std::string(kKeyIDColumnFamilyName), key_id_opts);
+  auto cold_column_families = util::Split(config_->rocks_db.cold_column_families, ", ");
+  for (auto &cf : column_families) {
+    SetCompressionDict(cf.name, &cf.options);
+    // all the SST files of a cold column family are placed in cold_dir
+    if (std::find(cold_column_families.begin(), cold_column_families.end(), cf.name) != cold_column_families.end()) {
+      cf.options.cf_paths = {{config_->rocks_db.cold_dir, std::numeric_limits<uint64_t>::max()}};
+    }
+  }
 
   std::vector<std::string> old_column_families;
   auto s = rocksdb::DB::ListColumnFamilies(options, config_->db_dir, &old_column_families);
@@ -386,14 +582,55 @@ Status Storage::Open(DBOpenMode mode) {
     return {Status::DBOpenErr};
   }
   LOG(INFO) << "[storage] Success to load the data from disk: " << duration << " ms";
+  db_open_mode_ = mode;
+  open_duration_ms_ = duration;
+
+  std::string last_ingest_seq;
+  s = db_->Get(rocksdb::ReadOptions(), GetCFHandle(ColumnFamilyID::Propagate), kLastIngestSeqKey, &last_ingest_seq);
+  if (s.ok()) {
+    last_ingest_seq_ = GET_OR_RET(ParseInt<uint64_t>(last_ingest_seq, 10).Prefixed("invalid last ingest sequence"));
+  }
+  if (mode == kDBOpenModeDefault) GET_OR_RET(loadStagedVersions());
 
   return Status::OK();
 }
 
+Status Storage::loadStagedVersions() {
+  auto cf = GetCFHandle(ColumnFamilyID::Propagate);
+  std::unique_ptr<rocksdb::Iterator> iter(db_->NewIterator(rocksdb::ReadOptions(), cf));
+  for (iter->Seek(kStagedVersionKeyPrefix); iter->Valid() && iter->key().starts_with(kStagedVersionKeyPrefix);
+       iter->Next()) {
+    if (!config_->IsSlave()) {
+      // the subkeys written before are dropped by the compaction filter, since the version isn't staged anymore
+      auto s = db_->Delete(default_write_opts_, cf, iter->key());
+      if (!s.ok()) return {Status::NotOK, "failed to drop the staged version: " + s.ToString()};
+      continue;
+    }
+    auto version = ParseInt<uint64_t>(iter->key().ToString().substr(kStagedVersionKeyPrefix.size()), 10);
+    if (!version) return {Status::NotOK, "invalid staged version: " + iter->key().ToString()};
+    if (!IsStagedVersion(*version)) AddStagedVersion(*version);
+  }
+  if (!iter->status().ok()) return {Status::NotOK, "failed to load the staged versions: " + iter->status().ToString()};
+  return Status::OK();
+}
+
+Status Storage::TryCatchUpWithPrimary() {
+  auto guard = ReadLockGuard();
+  if (db_closing_) return {Status::NotOK, "the db is closing"};
+
+  auto seq = db_->GetLatestSequenceNumber();
+  auto s = db_->TryCatchUpWithPrimary();
+  if (!s.ok()) return {Status::NotOK, s.ToString()};
+  // The writes replayed from the primary don't go through Write, so the cached metadata may be stale
+  if (metadata_cache_ && db_->GetLatestSequenceNumber() != seq) metadata_cache_->Clear();
+  return Status::OK();
+}
+
 Status Storage::CreateBackup(uint64_t *sequence_number) {
   LOG(INFO) << "[storage] Start to create new backup";
   std::lock_guard<std::mutex> lg(config_->backup_mu);
   std::string task_backup_dir = config_->backup_dir;
+  if (config_->backup_incremental) return createIncrementalBackup(task_backup_dir, sequence_number);
 
   std::string tmpdir = task_backup_dir + ".tmp";
   // Maybe there is a dirty tmp checkpoint, try to clean it
@@ -437,6 +674,77 @@ Status Storage::CreateBackup(uint64_t *sequence_number) {
   return Status::OK();
 }
 
+StatusOr<std::unique_ptr<rocksdb::BackupEngine>> Storage::openIncrementalBackupEngine(
+    const std::string &backup_dir) {
+  // A checkpoint backup left by the non-incremental mode can't be managed by the backup engine
+  if (env_->FileExists(backup_dir + "/CURRENT").ok()) {
+    if (auto s = rocksdb::DestroyDB(backup_dir, rocksdb::Options()); !s.ok()) {
+      return {Status::DBBackupErr, "failed to clean the checkpoint backup: " + s.ToString()};
+    }
+  }
+
+  // The SST files are named by their checksums in the shared directory, so the files which are
+  // not changed since the last backup are neither copied nor uploaded again
+  rocksdb::BackupEngineOptions options(backup_dir);
+  options.share_table_files = true;
+  options.share_files_with_checksum = true;
+  options.max_background_operations = config_->backup_threads;
+  options.backup_rate_limit = static_cast<uint64_t>(config_->backup_rate_limit_mb) * MiB;
+  return util::BackupEngineOpen(env_, options);
+}
+
+Status Storage::createIncrementalBackup(const std::string &backup_dir, uint64_t *sequence_number) {
+  auto engine = GET_OR_RET(openIncrementalBackupEngine(backup_dir));
+
+  // The backup contains the live WAL files, so it covers all the writes before the sequence
+  if (sequence_number) *sequence_number = db_->GetLatestSequenceNumber();
+  rocksdb::CreateBackupOptions options;
+  options.flush_before_backup = false;
+  rocksdb::BackupID backup_id = 0;
+  auto s = engine->CreateNewBackup(options, db_.get(), &backup_id);
+  if (!s.ok()) {
+    LOG(WARNING) << "[storage] Failed to create incremental backup. Error: " << s.ToString();
+    return {Status::DBBackupErr, s.ToString()};
+  }
+
+  // 'backup_mu_' can guarantee 'backup_creating_time_secs_' is thread-safe
+  backup_creating_time_secs_ = util::GetTimeStamp<std::chrono::seconds>();
+
+  rocksdb::BackupInfo info;
+  if (engine->GetBackupInfo(backup_id, &info).ok()) {
+    LOG(INFO) << "[storage] Success to create incremental backup " << backup_id << " with " << info.number_files
+              << " files of " << info.size << " bytes";
+  }
+  return Status::OK();
+}
+
+void Storage::purgeIncrementalBackups(const std::string &backup_dir, uint32_t num_backups_to_keep,
+                                      uint32_t backup_max_keep_hours) {
+  auto engine = openIncrementalBackupEngine(backup_dir);
+  if (!engine) {
+    LOG(WARNING) << "[storage] Failed to open the incremental backups. Error: " << engine.Msg();
+    return;
+  }
+
+  rocksdb::IOStatus s;
+  if (backup_max_keep_hours != 0) {
+    auto now_secs = util::GetTimeStamp<std::chrono::seconds>();
+    std::vector<rocksdb::BackupInfo> infos;
+    (*engine)->GetBackupInfo(&infos);
+    for (const auto &info : infos) {
+      if (info.timestamp + backup_max_keep_hours * 3600 >= now_secs) continue;
+      if (s = (*engine)->DeleteBackup(info.backup_id); !s.ok()) {
+        LOG(WARNING) << "[storage] Failed to delete incremental backup " << info.backup_id
+                     << ". Error: " << s.ToString();
+      }
+    }
+  }
+  // The shared files which aren't referenced by any remaining backup are removed as well
+  if (s = (*engine)->PurgeOldBackups(num_backups_to_keep); !s.ok()) {
+    LOG(WARNING) << "[storage] Failed to purge old incremental backups. Error: " << s.ToString();
+  }
+}
+
 void Storage::DestroyBackup() {
   if (!backup_) {
     return;
@@ -564,6 +872,11 @@ void Storage::PurgeOldBackups(uint32_t num_backups_to_keep, uint32_t backup_max_
   auto s = env_->FileExists(task_backup_dir);
   if (!s.ok()) return;
 
+  if (config_->backup_incremental) {
+    purgeIncrementalBackups(task_backup_dir, num_backups_to_keep, backup_max_keep_hours);
+    return;
+  }
+
   // No backup is needed to keep or the backup is expired, we will clean it.
   bool backup_expired =
       (backup_max_keep_hours != 0 && backup_creating_time_secs_ + backup_max_keep_hours * 3600 < now_secs);
@@ -602,8 +915,8 @@ rocksdb::Status Storage::Get(engine::Context &ctx, const rocksdb::ReadOptions &o
     DCHECK_EQ(ctx.snapshot->GetSequenceNumber(), options.snapshot->GetSequenceNumber());
   }
   rocksdb::Status s;
-  if (is_txn_mode_ && txn_write_batch_->GetWriteBatch()->Count() > 0) {
-    s = txn_write_batch_->GetFromBatchAndDB(db_.get(), options, column_family, key, value);
+  if (auto txn_batch = txnWriteBatch(); txn_batch && txn_batch->GetWriteBatch()->Count() > 0) {
+    s = txn_batch->GetFromBatchAndDB(db_.get(), options, column_family, key, value);
   } else if (ctx.batch && ctx.is_txn_mode) {
     s = ctx.batch->GetFromBatchAndDB(db_.get(), options, column_family, key, value);
   } else {
@@ -627,8 +940,8 @@ rocksdb::Status Storage::Get(engine::Context &ctx, const rocksdb::ReadOptions &o
     DCHECK_EQ(ctx.snapshot->GetSequenceNumber(), options.snapshot->GetSequenceNumber());
   }
   rocksdb::Status s;
-  if (is_txn_mode_ && txn_write_batch_->GetWriteBatch()->Count() > 0) {
-    s = txn_write_batch_->GetFromBatchAndDB(db_.get(), options, column_family, key, value);
+  if (auto txn_batch = txnWriteBatch(); txn_batch && txn_batch->GetWriteBatch()->Count() > 0) {
+    s = txn_batch->GetFromBatchAndDB(db_.get(), options, column_family, key, value);
   } else if (ctx.is_txn_mode && ctx.batch) {
     s = ctx.batch->GetFromBatchAndDB(db_.get(), options, column_family, key, value);
   } else {
@@ -660,8 +973,8 @@ rocksdb::Iterator *Storage::NewIterator(engine::Context &ctx, const rocksdb::Rea
     DCHECK_EQ(ctx.snapshot->GetSequenceNumber(), options.snapshot->GetSequenceNumber());
   }
   auto iter = db_->NewIterator(options, column_family);
-  if (is_txn_mode_ && txn_write_batch_->GetWriteBatch()->Count() > 0) {
-    return txn_write_batch_->NewIteratorWithBase(column_family, iter, &options);
+  if (auto txn_batch = txnWriteBatch(); txn_batch && txn_batch->GetWriteBatch()->Count() > 0) {
+    return txn_batch->NewIteratorWithBase(column_family, iter, &options);
   } else if (ctx.is_txn_mode && ctx.batch && ctx.batch->GetWriteBatch()->Count() > 0) {
     return ctx.batch->NewIteratorWithBase(column_family, iter, &options);
   }
@@ -675,9 +988,8 @@ void Storage::MultiGet(engine::Context &ctx, const rocksdb::ReadOptions &options
     DCHECK_NOTNULL(options.snapshot);
     DCHECK_EQ(ctx.snapshot->GetSequenceNumber(), options.snapshot->GetSequenceNumber());
   }
-  if (is_txn_mode_ && txn_write_batch_->GetWriteBatch()->Count() > 0) {
-    txn_write_batch_->MultiGetFromBatchAndDB(db_.get(), options, column_family, num_keys, keys, values, statuses,
-                                             false);
+  if (auto txn_batch = txnWriteBatch(); txn_batch && txn_batch->GetWriteBatch()->Count() > 0) {
+    txn_batch->MultiGetFromBatchAndDB(db_.get(), options, column_family, num_keys, keys, values, statuses, false);
   } else if (ctx.is_txn_mode && ctx.batch) {
     ctx.batch->MultiGetFromBatchAndDB(db_.get(), options, column_family, num_keys, keys, values, statuses, false);
   } else {
@@ -689,9 +1001,30 @@ void Storage::MultiGet(engine::Context &ctx, const rocksdb::ReadOptions &options
   }
 }
 
+void Storage::MultiGet(engine::Context &ctx, const rocksdb::ReadOptions &options,
+                       rocksdb::ColumnFamilyHandle **column_families, const size_t num_keys, const rocksdb::Slice *keys,
+                       rocksdb::PinnableSlice *values, rocksdb::Status *statuses) {
+  auto txn_batch = txnWriteBatch();
+  if ((txn_batch && txn_batch->GetWriteBatch()->Count() > 0) || (ctx.is_txn_mode && ctx.batch)) {
+    for (size_t i = 0; i < num_keys; i++) {
+      statuses[i] = Get(ctx, options, column_families[i], keys[i], &values[i]);
+    }
+    return;
+  }
+
+  if (ctx.is_txn_mode) {
+    DCHECK_NOTNULL(options.snapshot);
+    DCHECK_EQ(ctx.snapshot->GetSequenceNumber(), options.snapshot->GetSequenceNumber());
+  }
+  db_->MultiGet(options, num_keys, column_families, keys, values, statuses, false);
+  for (size_t i = 0; i < num_keys; i++) {
+    recordKeyspaceStat(column_families[i], statuses[i]);
+  }
+}
+
 rocksdb::Status Storage::Write(engine::Context &ctx, const rocksdb::WriteOptions &options,
                                rocksdb::WriteBatch *updates) {
-  if (is_txn_mode_) {
+  if (txnWriteBatch()) {
     // The batch won't be flushed until the transaction was committed or rollback
     return rocksdb::Status::OK();
   }
@@ -700,6 +1033,15 @@ rocksdb::Status Storage::Write(engine::Context &ctx, const rocksdb::WriteOptions
 
 rocksdb::Status Storage::writeToDB(engine::Context &ctx, const rocksdb::WriteOptions &options,
                                    rocksdb::WriteBatch *updates) {
+  if (config_->ttl_index_enabled) {
+    auto s = indexExpireTimes(updates);
+    if (!s.ok()) return s;
+  }
+  if (USE_COMPACT_SUBKEY_DEFAULT) {
+    auto s = indexKeyIDs(updates);
+    if (!s.ok()) return s;
+  }
+
   // Put replication id logdata at the end of write batch
   if (replid_.length() == kReplIdLength) {
     updates->PutLogData(ServerLogData(kReplIdLog, replid_).Encode());
@@ -714,7 +1056,309 @@ rocksdb::Status Storage::writeToDB(engine::Context &ctx, const rocksdb::WriteOpt
     if (!s.ok()) return s;
   }
 
-  return db_->Write(options, updates);
+  // Only batches written with the default options can share a group, since they are committed with one WriteOptions
+  if (config_->group_commit_enabled && isDefaultWriteOptions(options)) {
+    auto s = group_committer_.Write(db_.get(), options, updates, config_->group_commit_max_delay_us,
+                                    config_->group_commit_max_batch_size);
+    invalidateMetadataCache(updates);
+    return s;
+  }
+  auto s = db_->Write(options, updates);
+  invalidateMetadataCache(updates);
+  return s;
+}
+
+void Storage::invalidateMetadataCache(rocksdb::WriteBatch *updates) {
+  if (!metadata_cache_) return;
+
+  class Invalidator : public rocksdb::WriteBatch::Handler {
+   public:
+    Invalidator(MetadataCache *cache, uint32_t metadata_cf_id) : cache_(cache), metadata_cf_id_(metadata_cf_id) {}
+
+    rocksdb::Status PutCF(uint32_t column_family_id, const Slice &key, [[maybe_unused]] const Slice &value) override {
+      if (column_family_id == metadata_cf_id_) cache_->Erase(key);
+      return rocksdb::Status::OK();
+    }
+    rocksdb::Status DeleteCF(uint32_t column_family_id, const Slice &key) override {
+      if (column_family_id == metadata_cf_id_) cache_->Erase(key);
+      return rocksdb::Status::OK();
+    }
+    rocksdb::Status SingleDeleteCF(uint32_t column_family_id, const Slice &key) override {
+      return DeleteCF(column_family_id, key);
+    }
+    rocksdb::Status MergeCF(uint32_t column_family_id, const Slice &key, [[maybe_unused]] const Slice &value) override {
+      return DeleteCF(column_family_id, key);
+    }
+    rocksdb::Status DeleteRangeCF(uint32_t column_family_id, [[maybe_unused]] const Slice &begin_key,
+                                  [[maybe_unused]] const Slice &end_key) override {
+      if (column_family_id == metadata_cf_id_) cache_->Clear();
+      return rocksdb::Status::OK();
+    }
+
+   private:
+    MetadataCache *cache_;
+    uint32_t metadata_cf_id_;
+  };
+
+  // Invalidate even if the write failed, it may be partially applied
+  Invalidator invalidator(metadata_cache_.get(), GetCFHandle(ColumnFamilyID::Metadata)->GetID());
+  auto s = updates->Iterate(&invalidator);
+  if (!s.ok()) metadata_cache_->Clear();
+}
+
+rocksdb::Status Storage::indexExpireTimes(rocksdb::WriteBatch *updates) {
+  class Collector : public rocksdb::WriteBatch::Handler {
+   public:
+    explicit Collector(uint32_t metadata_cf_id) : metadata_cf_id_(metadata_cf_id) {}
+
+    rocksdb::Status PutCF(uint32_t column_family_id, const Slice &key, const Slice &value) override {
+      if (column_family_id != metadata_cf_id_) return rocksdb::Status::OK();
+
+      Metadata metadata(kRedisNone, false);
+      if (!metadata.Decode(value).ok() || metadata.expire == 0) return rocksdb::Status::OK();
+      index_entries.emplace_back(ComposeTTLIndexKey(metadata.expire, key),
+                                 metadata.IsSingleKVType() ? 0 : metadata.version);
+      return rocksdb::Status::OK();
+    }
+
+    std::vector<std::pair<std::string, uint64_t>> index_entries;
+
+   private:
+    uint32_t metadata_cf_id_;
+  };
+
+  // The old entries of a key are left behind, the reaper drops them when they don't match the metadata
+  Collector collector(GetCFHandle(ColumnFamilyID::Metadata)->GetID());
+  auto s = updates->Iterate(&collector);
+  if (!s.ok()) return s;
+
+  for (const auto &[index_key, version] : collector.index_entries) {
+    std::string value;
+    PutFixed64(&value, version);
+    s = updates->Put(GetCFHandle(ColumnFamilyID::TTLIndex), index_key, value);
+    if (!s.ok()) return s;
+  }
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status Storage::indexKeyIDs(rocksdb::WriteBatch *updates) {
+  class Collector : public rocksdb::WriteBatch::Handler {
+   public:
+    explicit Collector(uint32_t metadata_cf_id) : metadata_cf_id_(metadata_cf_id) {}
+
+    rocksdb::Status PutCF(uint32_t column_family_id, const Slice &key, const Slice &value) override {
+      if (column_family_id != metadata_cf_id_) return rocksdb::Status::OK();
+
+      Metadata metadata(kRedisNone, false);
+      if (!metadata.Decode(value).ok() || metadata.IsSingleKVType()) return rocksdb::Status::OK();
+      if (!InternalKey::IsCompactVersion(metadata.version)) return rocksdb::Status::OK();
+      id_entries.emplace_back(key.ToString(), metadata.version);
+      return rocksdb::Status::OK();
+    }
+
+    std::vector<std::pair<std::string, uint64_t>> id_entries;
+
+   private:
+    uint32_t metadata_cf_id_;
+  };
+
+  // Only the new versions need an entry, but rewriting the entry of an existing version is harmless,
+  // and the entries of the dropped versions are removed by KeyIDFilter
+  Collector collector(GetCFHandle(ColumnFamilyID::Metadata)->GetID());
+  auto s = updates->Iterate(&collector);
+  if (!s.ok()) return s;
+
+  for (const auto &[ns_key, version] : collector.id_entries) {
+    auto [_, user_key] = ExtractNamespaceKey(ns_key, IsSlotIdEncoded());
+    auto id_key = InternalKey(ns_key, "", version, IsSlotIdEncoded()).EncodePrefix();
+    s = updates->Put(GetCFHandle(ColumnFamilyID::KeyID), id_key, user_key);
+    if (!s.ok()) return s;
+  }
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status Storage::GetKeyByID(const InternalKey &ikey, std::string *user_key) {
+  return db_->Get(rocksdb::ReadOptions(), GetCFHandle(ColumnFamilyID::KeyID), ikey.EncodePrefix(), user_key);
+}
+
+std::shared_ptr<const rocksdb::Snapshot> Storage::GetSharedSnapshot(bool allow_stale) {
+  // Reading the latest sequence is a cheap atomic load, if it hasn't moved, the shared snapshot
+  // sees exactly what a new one would
+  auto sequence = db_->GetLatestSequenceNumber();
+  auto now = util::GetTimeStampUS();
+  auto max_staleness = static_cast<uint64_t>(config_->txn_context_max_snapshot_staleness_us);
+
+  std::shared_ptr<const rocksdb::Snapshot> old_snapshot;
+  std::lock_guard<std::mutex> guard(shared_snapshot_mu_);
+  if (shared_snapshot_ && (shared_snapshot_->GetSequenceNumber() == sequence ||
+                           (allow_stale && max_staleness > 0 && now - shared_snapshot_time_us_ <= max_staleness))) {
+    return shared_snapshot_;
+  }
+
+  // The old snapshot is released by its last user, under the ReadLockGuard of the caller
+  old_snapshot = std::move(shared_snapshot_);
+  // A snapshot outliving its DB, e.g. after a restore, must not be released on the reopened one
+  shared_snapshot_ = std::shared_ptr<const rocksdb::Snapshot>(
+      db_->GetSnapshot(), [this, db = db_.get()](const rocksdb::Snapshot *s) {
+        if (db_.get() == db) db_->ReleaseSnapshot(s);
+      });
+  shared_snapshot_time_us_ = now;
+  return shared_snapshot_;
+}
+
+void Storage::ReleaseIdleSharedSnapshot() {
+  std::shared_ptr<const rocksdb::Snapshot> old_snapshot;
+  std::lock_guard<std::mutex> guard(shared_snapshot_mu_);
+  if (shared_snapshot_ && shared_snapshot_.use_count() == 1) old_snapshot = std::move(shared_snapshot_);
+}
+
+void Storage::TuneTieredBlockCache() {
+  if (!tiered_cache_tuner_ || !db_) return;
+  auto stats = db_->GetDBOptions().statistics;
+  if (!stats) return;
+
+  if (!tiered_cache_tuner_->Tune(stats->getTickerCount(rocksdb::Tickers::BLOCK_CACHE_HIT),
+                                 stats->getTickerCount(rocksdb::Tickers::BLOCK_CACHE_MISS),
+                                 stats->getTickerCount(rocksdb::Tickers::SECONDARY_CACHE_HITS))) {
+    return;
+  }
+  double ratio = tiered_cache_tuner_->GetRatio();
+  auto s = rocksdb::UpdateTieredCache(block_cache_, -1, ratio);
+  if (!s.ok()) {
+    LOG(WARNING) << "[storage] Failed to set the compressed secondary cache ratio: " << s.ToString();
+    return;
+  }
+  LOG(INFO) << "[storage] Set the compressed secondary cache ratio to " << ratio;
+}
+
+Status Storage::LazyFree() {
+  // The keys of one batch are removed by one write
+  constexpr size_t kLazyFreeBatchSize = 64;
+
+  while (true) {
+    auto guard = ReadLockGuard();
+    if (db_closing_) return {Status::NotOK, "storage is closing"};
+
+    auto entries = lazy_free_queue_.PopBatch(kLazyFreeBatchSize);
+    if (entries.empty()) return Status::OK();
+
+    auto ctx = Context::NoTransactionContext(this);
+    auto batch = GetWriteBatchBase();
+    redis::WriteBatchLogData log_data(kRedisNone);
+    auto s = batch->PutLogData(log_data.Encode());
+    for (const auto &entry : entries) {
+      if (s.ok()) s = DeleteSubKeys(batch.Get(), entry.type, entry.ns_key, entry.version);
+    }
+    if (s.ok()) s = Write(ctx, default_write_opts_, batch->GetWriteBatch());
+    // The failed ones are left to compactions
+    lazy_free_queue_.Done(entries);
+    if (!s.ok()) return {Status::NotOK, s.ToString()};
+  }
+}
+
+rocksdb::Status Storage::DeleteSubKeys(rocksdb::WriteBatchBase *batch, RedisType type, const rocksdb::Slice &ns_key,
+                                       uint64_t version) {
+  std::vector<ColumnFamilyID> cfs;
+  switch (type) {
+    case kRedisStream:
+      cfs = {ColumnFamilyID::Stream};
+      break;
+    case kRedisZSet:
+      cfs = {ColumnFamilyID::PrimarySubkey, ColumnFamilyID::SecondarySubkey, ColumnFamilyID::ZSetRank};
+      break;
+    case kRedisHash:
+      // the expire times of the hash fields are indexed in the secondary subkey column family
+      cfs = {ColumnFamilyID::PrimarySubkey, ColumnFamilyID::SecondarySubkey};
+      break;
+    default:
+      cfs = {ColumnFamilyID::PrimarySubkey};
+  }
+
+  std::string begin = InternalKey(ns_key, "", version, IsSlotIdEncoded()).Encode();
+  std::string end = InternalKey(ns_key, "", version + 1, IsSlotIdEncoded()).Encode();
+  for (auto cf : cfs) {
+    auto s = batch->DeleteRange(GetCFHandle(cf), begin, end);
+    if (!s.ok()) return s;
+  }
+  return rocksdb::Status::OK();
+}
+
+void Storage::AddCompactionHint(ColumnFamilyID cf_id, std::string begin, std::string end) {
+  // The hints are only an optimization, the ranges over the limit are left to the file picking
+  constexpr size_t kMaxCompactionHints = 1024;
+
+  std::lock_guard<std::mutex> guard(compaction_hints_mu_);
+  auto &hints = compaction_hints_[cf_id];
+  if (hints.size() >= kMaxCompactionHints) return;
+  hints.emplace_back(std::move(begin), std::move(end));
+}
+
+std::vector<std::pair<std::string, std::string>> Storage::TakeCompactionHints(ColumnFamilyID cf_id) {
+  std::vector<std::pair<std::string, std::string>> hints;
+  {
+    std::lock_guard<std::mutex> guard(compaction_hints_mu_);
+    auto iter = compaction_hints_.find(cf_id);
+    if (iter == compaction_hints_.end()) return hints;
+    hints.swap(iter->second);
+  }
+
+  // the ranges trimmed from the same key one after another are adjacent, so they are compacted at once
+  std::sort(hints.begin(), hints.end());
+  std::vector<std::pair<std::string, std::string>> merged;
+  for (auto &hint : hints) {
+    if (!merged.empty() && hint.first <= merged.back().second) {
+      if (hint.second > merged.back().second) merged.back().second = std::move(hint.second);
+      continue;
+    }
+    merged.emplace_back(std::move(hint));
+  }
+  return merged;
+}
+
+rocksdb::Status Storage::GetRawMetadata(engine::Context &ctx, const rocksdb::Slice &ns_key, std::string *bytes) {
+  auto cf_handle = GetCFHandle(ColumnFamilyID::Metadata);
+  if (cache_warmup_) cache_warmup_->Record(ns_key);
+  // The cache holds the latest metadata, which must not be seen by reads on a snapshot
+  // or by reads which should see the pending writes of a transaction
+  if (!metadata_cache_ || txnWriteBatch()) {
+    return Get(ctx, ctx.GetReadOptions(), cf_handle, ns_key, bytes);
+  }
+  if (ctx.is_txn_mode) {
+    // The metadata read on the latest snapshot is the latest one, so it still fills the cache, since a write
+    // after the generation is read either changes the latest sequence or the generation. It guesses the version
+    // of the key for Database::GetMetadataAndSubKey on the later snapshots.
+    auto generation = metadata_cache_->GetGeneration(ns_key);
+    bool latest = ctx.snapshot && ctx.snapshot->GetSequenceNumber() == db_->GetLatestSequenceNumber();
+    auto s = Get(ctx, ctx.GetReadOptions(), cf_handle, ns_key, bytes);
+    if (latest && s.ok()) metadata_cache_->Insert(ns_key, *bytes, generation);
+    return s;
+  }
+
+  bool absent = false;
+  if (metadata_cache_->Lookup(ns_key, bytes, &absent)) {
+    if (!absent) return rocksdb::Status::OK();
+    // A sample of the absent hits is checked against the DB, a key found there means a write missed the cache
+    if (metadata_cache_->GetAbsentHits() % MetadataCache::kAbsentCheckInterval != 0) return rocksdb::Status::NotFound();
+    auto s = Get(ctx, ctx.GetReadOptions(), cf_handle, ns_key, bytes);
+    metadata_cache_->RecordAbsentCheck(s.ok());
+    if (s.ok()) metadata_cache_->Erase(ns_key);
+    return s;
+  }
+
+  auto generation = metadata_cache_->GetGeneration(ns_key);
+  auto s = Get(ctx, ctx.GetReadOptions(), cf_handle, ns_key, bytes);
+  if (s.ok()) {
+    metadata_cache_->Insert(ns_key, *bytes, generation);
+  } else if (s.IsNotFound()) {
+    metadata_cache_->InsertAbsent(ns_key, generation);
+  }
+  return s;
+}
+
+bool Storage::isDefaultWriteOptions(const rocksdb::WriteOptions &options) const {
+  return options.sync == default_write_opts_.sync && options.disableWAL == default_write_opts_.disableWAL &&
+         options.no_slowdown == default_write_opts_.no_slowdown && options.low_pri == default_write_opts_.low_pri &&
+         options.memtable_insert_hint_per_batch == default_write_opts_.memtable_insert_hint_per_batch;
 }
 
 rocksdb::Status Storage::Delete(engine::Context &ctx, const rocksdb::WriteOptions &options,
@@ -759,7 +1403,50 @@ rocksdb::Status Storage::FlushScripts(engine::Context &ctx, const rocksdb::Write
 }
 
 Status Storage::ReplicaApplyWriteBatch(std::string &&raw_batch) {
-  return ApplyWriteBatch(default_write_opts_, std::move(raw_batch));
+  if (db_size_limit_reached_) {
+    return {Status::NotOK, "reach space limit"};
+  }
+  auto batch = rocksdb::WriteBatch(std::move(raw_batch));
+
+  // The versions staged by the master are staged here too before their subkeys are written, and unstaged after
+  // their metadata is written, see StagedWriteBatch
+  class StagedVersionCollector : public rocksdb::WriteBatch::Handler {
+   public:
+    explicit StagedVersionCollector(uint32_t propagate_cf_id) : propagate_cf_id_(propagate_cf_id) {}
+
+    rocksdb::Status PutCF(uint32_t column_family_id, const Slice &key, [[maybe_unused]] const Slice &value) override {
+      if (auto version = parseVersion(column_family_id, key)) staged.emplace_back(*version);
+      return rocksdb::Status::OK();
+    }
+    rocksdb::Status DeleteCF(uint32_t column_family_id, const Slice &key) override {
+      if (auto version = parseVersion(column_family_id, key)) unstaged.emplace_back(*version);
+      return rocksdb::Status::OK();
+    }
+
+    std::vector<uint64_t> staged;
+    std::vector<uint64_t> unstaged;
+
+   private:
+    std::optional<uint64_t> parseVersion(uint32_t column_family_id, const Slice &key) const {
+      if (column_family_id != propagate_cf_id_ || !key.starts_with(kStagedVersionKeyPrefix)) return std::nullopt;
+      auto version = ParseInt<uint64_t>(key.ToString().substr(kStagedVersionKeyPrefix.size()), 10);
+      if (!version) return std::nullopt;
+      return *version;
+    }
+
+    uint32_t propagate_cf_id_;
+  };
+  StagedVersionCollector collector(GetCFHandle(ColumnFamilyID::Propagate)->GetID());
+  if (auto s = batch.Iterate(&collector); !s.ok()) return {Status::NotOK, s.ToString()};
+  for (auto version : collector.staged) AddStagedVersion(version);
+
+  auto s = db_->Write(default_write_opts_, &batch);
+  invalidateMetadataCache(&batch);
+  if (!s.ok()) {
+    return {Status::NotOK, s.ToString()};
+  }
+  for (auto version : collector.unstaged) RemoveStagedVersion(version);
+  return Status::OK();
 }
 
 Status Storage::ApplyWriteBatch(const rocksdb::WriteOptions &options, std::string &&raw_batch) {
@@ -767,13 +1454,73 @@ Status Storage::ApplyWriteBatch(const rocksdb::WriteOptions &options, std::strin
     return {Status::NotOK, "reach space limit"};
   }
   auto batch = rocksdb::WriteBatch(std::move(raw_batch));
-  auto s = db_->Write(options, &batch);
+  auto ctx = Context::NoTransactionContext(this);
+  auto s = writeToDB(ctx, options, &batch);
   if (!s.ok()) {
     return {Status::NotOK, s.ToString()};
   }
   return Status::OK();
 }
 
+rocksdb::ColumnFamilyHandle *Storage::getCFHandleByName(const std::string &name) {
+  for (auto cf_handle : cf_handles_) {
+    if (cf_handle->GetName() == name) return cf_handle;
+  }
+  return nullptr;
+}
+
+Status Storage::IngestSSTFile(const std::string &cf_name, const std::string &path) {
+  if (db_size_limit_reached_) {
+    return {Status::NotOK, "reach space limit"};
+  }
+  auto cf_handle = getCFHandleByName(cf_name);
+  if (!cf_handle) return {Status::NotOK, "unknown column family " + cf_name};
+
+  rocksdb::IngestExternalFileOptions options;
+  options.move_files = true;
+  auto s = db_->IngestExternalFile(cf_handle, {path}, options);
+  if (!s.ok()) return {Status::NotOK, s.ToString()};
+  if (metadata_cache_) metadata_cache_->Clear();
+
+  // The ingested entries may have no sequence of their own, so even a replica which has applied the
+  // latest sequence before the ingestion doesn't have them
+  auto seq = db_->GetLatestSequenceNumber() + 1;
+  last_ingest_seq_ = seq;
+  auto ctx = engine::Context::NoTransactionContext(this);
+  return WriteToPropagateCF(ctx, kLastIngestSeqKey, std::to_string(seq));
+}
+
+Status Storage::ApplySSTFile(const std::string &cf_name, const std::string &path, size_t batch_bytes) {
+  auto cf_handle = getCFHandleByName(cf_name);
+  if (!cf_handle) return {Status::NotOK, "unknown column family " + cf_name};
+
+  rocksdb::SstFileReader reader(db_->GetOptions(cf_handle));
+  auto s = reader.Open(path);
+  if (!s.ok()) return {Status::NotOK, s.ToString()};
+
+  auto ctx = engine::Context::NoTransactionContext(this);
+  rocksdb::WriteBatch batch;
+  auto flush = [&]() -> Status {
+    if (db_size_limit_reached_) {
+      return {Status::NotOK, "reach space limit"};
+    }
+    auto write_status = Write(ctx, default_write_opts_, &batch);
+    if (!write_status.ok()) return {Status::NotOK, write_status.ToString()};
+    batch.Clear();
+    return Status::OK();
+  };
+
+  auto iter = util::UniqueIterator(reader.NewIterator(rocksdb::ReadOptions()));
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    s = batch.Put(cf_handle, iter->key(), iter->value());
+    if (!s.ok()) return {Status::NotOK, s.ToString()};
+    if (batch.GetDataSize() >= batch_bytes) GET_OR_RET(flush());
+  }
+  if (!iter->status().ok()) return {Status::NotOK, iter->status().ToString()};
+  if (batch.Count() > 0) GET_OR_RET(flush());
+  return Status::OK();
+}
+
 void Storage::RecordStat(StatType type, uint64_t v) {
   switch (type) {
     case StatType::FlushCount:
@@ -788,6 +1535,18 @@ void Storage::RecordStat(StatType type, uint64_t v) {
     case StatType::KeyspaceMisses:
       db_stats_->keyspace_misses.fetch_add(v, std::memory_order_relaxed);
       break;
+    case StatType::CompactionFilterCacheHits:
+      db_stats_->compaction_filter_cache_hits.fetch_add(v, std::memory_order_relaxed);
+      break;
+    case StatType::CompactionFilterCacheMisses:
+      db_stats_->compaction_filter_cache_misses.fetch_add(v, std::memory_order_relaxed);
+      break;
+    case StatType::WriteBatchAllocations:
+      db_stats_->write_batch_allocations.fetch_add(v, std::memory_order_relaxed);
+      break;
+    case StatType::CompactionCheckerReclaimedBytes:
+      db_stats_->compaction_checker_reclaimed_bytes.fetch_add(v, std::memory_order_relaxed);
+      break;
   }
 }
 
@@ -807,6 +1566,12 @@ rocksdb::Status Storage::Compact(rocksdb::ColumnFamilyHandle *cf, const Slice *b
   return rocksdb::Status::OK();
 }
 
+rocksdb::Status Storage::FlushMemTables() {
+  rocksdb::FlushOptions flush_opts;
+  flush_opts.allow_write_stall = true;
+  return db_->Flush(flush_opts, cf_handles_);
+}
+
 uint64_t Storage::GetTotalSize(const std::string &ns) {
   if (ns == kDefaultNamespace) {
     return sst_file_manager_->GetTotalSize();
@@ -833,9 +1598,101 @@ uint64_t Storage::GetTotalSize(const std::string &ns) {
   return total_size;
 }
 
+Status Storage::GetApproxKeyNumStats(ApproxKeyNumStats *stats) {
+  auto metadata_cf = GetCFHandle(ColumnFamilyID::Metadata);
+  rocksdb::TablePropertiesCollection props;
+  auto s = db_->GetPropertiesOfAllTables(metadata_cf, &props);
+  if (!s.ok()) return {Status::NotOK, s.ToString()};
+
+  auto parse_value = [](const std::string &value) -> uint64_t {
+    auto parse_result = ParseInt<uint64_t>(value, 10);
+    return parse_result ? *parse_result : 0;
+  };
+  auto prop_value = [&](const rocksdb::UserCollectedProperties &user_props, const std::string &name) -> uint64_t {
+    auto iter = user_props.find(name);
+    return iter != user_props.end() ? parse_value(iter->second) : 0;
+  };
+
+  uint64_t put_keys = 0, deleted_keys = 0;
+  for (const auto &[_, table_props] : props) {
+    const auto &user_props = table_props->user_collected_properties;
+    for (auto iter = user_props.lower_bound(kApproxKeysPropPrefix); iter != user_props.end(); ++iter) {
+      if (!rocksdb::Slice(iter->first).starts_with(kApproxKeysPropPrefix)) break;
+      auto n = parse_value(iter->second);
+      stats->type_keys[iter->first.substr(strlen(kApproxKeysPropPrefix))] += n;
+      put_keys += n;
+    }
+    stats->n_expired += prop_value(user_props, kApproxExpiredKeysProp);
+    stats->n_sub_key += prop_value(user_props, kApproxSubKeysProp);
+    deleted_keys += prop_value(user_props, kApproxDeletedKeysProp);
+  }
+
+  // the keys in memtables are not classified, count the puts of them as well
+  uint64_t mem_entries = 0, mem_deletes = 0, value = 0;
+  using Properties = rocksdb::DB::Properties;
+  for (const auto &[entries, deletes] :
+       {std::pair{Properties::kNumEntriesActiveMemTable, Properties::kNumDeletesActiveMemTable},
+        std::pair{Properties::kNumEntriesImmMemTables, Properties::kNumDeletesImmMemTables}}) {
+    if (db_->GetIntProperty(metadata_cf, entries, &value)) mem_entries += value;
+    if (db_->GetIntProperty(metadata_cf, deletes, &value)) mem_deletes += value;
+  }
+  put_keys += mem_entries > mem_deletes ? mem_entries - mem_deletes : 0;
+  deleted_keys += mem_deletes;
+
+  stats->n_key = put_keys > deleted_keys ? put_keys - deleted_keys : 0;
+  return Status::OK();
+}
+
+Status Storage::GetSlotStats(std::map<uint16_t, SlotStats> *stats) {
+  if (!config_->slot_id_encoded) return {Status::NotOK, "the slot id isn't encoded in the keys"};
+
+  // every slot-id-encoded column family collects the slot stats, see SlotStatsCollector
+  std::map<uint16_t, SlotStatsCollector::Stats> slot_stats;
+  for (auto cf_id : {ColumnFamilyID::Metadata, ColumnFamilyID::PrimarySubkey, ColumnFamilyID::SecondarySubkey,
+                     ColumnFamilyID::Stream, ColumnFamilyID::ZSetRank}) {
+    rocksdb::TablePropertiesCollection props;
+    auto s = db_->GetPropertiesOfAllTables(GetCFHandle(cf_id), &props);
+    if (!s.ok()) return {Status::NotOK, s.ToString()};
+
+    for (const auto &[_, table_props] : props) {
+      const auto &user_props = table_props->user_collected_properties;
+      // the files written before the collector is added have no stats
+      auto iter = user_props.find(kSlotStatsProp);
+      if (iter == user_props.end()) continue;
+      if (!SlotStatsCollector::Decode(iter->second, &slot_stats)) {
+        return {Status::NotOK, "corrupted slot stats in the table properties"};
+      }
+    }
+  }
+
+  for (const auto &[slot, collected] : slot_stats) {
+    auto &slot_stat = (*stats)[slot];
+    slot_stat.n_key += collected.put_keys > collected.deleted_keys ? collected.put_keys - collected.deleted_keys : 0;
+    slot_stat.bytes += collected.bytes;
+  }
+  return Status::OK();
+}
+
+void Storage::SetWriteStallCondition(const std::string &cf_name, rocksdb::WriteStallCondition condition) {
+  std::lock_guard<std::mutex> guard(write_stall_mu_);
+  cf_write_stall_conditions_[cf_name] = condition;
+
+  auto worst = rocksdb::WriteStallCondition::kNormal;
+  for (const auto &[_, cf_condition] : cf_write_stall_conditions_) {
+    if (cf_condition == rocksdb::WriteStallCondition::kStopped) {
+      worst = cf_condition;
+      break;
+    }
+    if (cf_condition == rocksdb::WriteStallCondition::kDelayed) worst = cf_condition;
+  }
+  write_stall_condition_ = worst;
+}
+
 void Storage::CheckDBSizeLimit() {
+  // the keys are evicted by KeyEvictor instead of rejecting the writes, unless the policy is noeviction
+  // or nothing can be evicted
   bool limit_reached = false;
-  if (config_->max_db_size > 0) {
+  if (config_->max_db_size > 0 && (config_->max_db_size_policy == kMaxDBSizeNoEviction || eviction_stalled_)) {
     limit_reached = GetTotalSize() >= config_->max_db_size * GiB;
   }
 
@@ -861,40 +1718,160 @@ void Storage::SetIORateLimit(int64_t max_io_mb) {
 
 rocksdb::DB *Storage::GetDB() { return db_.get(); }
 
+namespace {
+
+// The transaction mode state of this thread. All writes are grouped in the write batch
+// when entering the transaction mode, then written at once when committing.
+//
+// A transaction (EXEC) runs on one worker thread from the beginning to the commit, so keeping
+// its batch thread local instead of global allows transactions on different workers to run
+// at the same time, and keeps writes from other threads out of the transaction.
+struct TxnState {
+  const Storage *owner = nullptr;
+  std::unique_ptr<rocksdb::WriteBatchWithIndex> write_batch;
+};
+
+thread_local TxnState txn_state;
+
+}  // namespace
+
+rocksdb::WriteBatchWithIndex *Storage::txnWriteBatch() const {
+  return txn_state.owner == this ? txn_state.write_batch.get() : nullptr;
+}
+
 Status Storage::BeginTxn() {
-  if (is_txn_mode_) {
+  if (txn_state.owner) {
     return Status{Status::NotOK, "cannot begin a new transaction while already in transaction mode"};
   }
-  // The EXEC command is exclusive and shouldn't have multi transaction at the same time,
-  // so it's fine to reset the global write batch without any lock.
-  is_txn_mode_ = true;
-  txn_write_batch_ =
+  txn_state.owner = this;
+  txn_state.write_batch =
       std::make_unique<rocksdb::WriteBatchWithIndex>(rocksdb::BytewiseComparator() /*default backup_index_comparator */,
                                                      0 /* default reserved_bytes*/, GetWriteBatchMaxBytes());
   return Status::OK();
 }
 
-Status Storage::CommitTxn() {
-  if (!is_txn_mode_) {
+Status Storage::CommitTxn(bool disable_wal) {
+  if (txn_state.owner != this) {
     return Status{Status::NotOK, "cannot commit while not in transaction mode"};
   }
-  engine::Context ctx(this);
-  auto s = writeToDB(ctx, default_write_opts_, txn_write_batch_->GetWriteBatch());
+  auto write_batch = std::move(txn_state.write_batch);
+  txn_state.owner = nullptr;
 
-  is_txn_mode_ = false;
-  txn_write_batch_ = nullptr;
+  engine::Context ctx(this);
+  auto write_opts = default_write_opts_;
+  write_opts.disableWAL = disable_wal;
+  auto s = writeToDB(ctx, write_opts, write_batch->GetWriteBatch());
   if (s.ok()) {
     return Status::OK();
   }
   return {Status::NotOK, s.ToString()};
 }
 
-ObserverOrUniquePtr<rocksdb::WriteBatchBase> Storage::GetWriteBatchBase() {
-  if (is_txn_mode_) {
-    return ObserverOrUniquePtr<rocksdb::WriteBatchBase>(txn_write_batch_.get(), ObserverOrUnique::Observer);
+namespace {
+
+constexpr size_t kMaxPooledWriteBatches = 4;
+// The buffer of a rare big batch isn't worth keeping around
+constexpr size_t kMaxPooledWriteBatchBytes = 1 * MiB;
+
+thread_local std::vector<std::unique_ptr<rocksdb::WriteBatch>> write_batch_pool;
+
+}  // namespace
+
+void WriteBatchRecycler::operator()(rocksdb::WriteBatchBase *batch) const {
+  // Only the batches created by GetWriteBatchBase are owned
+  std::unique_ptr<rocksdb::WriteBatch> write_batch(static_cast<rocksdb::WriteBatch *>(batch));
+  if (write_batch_pool.size() >= kMaxPooledWriteBatches ||
+      write_batch->Data().capacity() > kMaxPooledWriteBatchBytes) {
+    return;
+  }
+  write_batch->Clear();
+  write_batch_pool.emplace_back(std::move(write_batch));
+}
+
+WriteBatchBasePtr Storage::GetWriteBatchBase() {
+  if (auto txn_batch = txnWriteBatch()) {
+    return WriteBatchBasePtr(txn_batch, ObserverOrUnique::Observer);
+  }
+  if (!write_batch_pool.empty()) {
+    auto write_batch = std::move(write_batch_pool.back());
+    write_batch_pool.pop_back();
+    write_batch->SetMaxBytes(GetWriteBatchMaxBytes());
+    return WriteBatchBasePtr(write_batch.release(), ObserverOrUnique::Unique);
+  }
+  RecordStat(StatType::WriteBatchAllocations, 1);
+  return WriteBatchBasePtr(new rocksdb::WriteBatch(0 /*reserved_bytes*/, GetWriteBatchMaxBytes()),
+                           ObserverOrUnique::Unique);
+}
+
+void Storage::AddStagedVersion(uint64_t version) {
+  std::lock_guard<std::mutex> guard(staged_versions_mu_);
+  staged_versions_.insert(version);
+  staged_versions_count_++;
+}
+
+void Storage::RemoveStagedVersion(uint64_t version) {
+  std::lock_guard<std::mutex> guard(staged_versions_mu_);
+  // the generation changes before the version is unstaged, see SubKeyFilter::GetMetadata
+  staged_generation_++;
+  if (auto iter = staged_versions_.find(version); iter != staged_versions_.end()) {
+    staged_versions_.erase(iter);
+    staged_versions_count_--;
+  }
+}
+
+bool Storage::IsStagedVersion(uint64_t version) const {
+  if (staged_versions_count_ == 0) return false;
+  std::lock_guard<std::mutex> guard(staged_versions_mu_);
+  return staged_versions_.count(version) > 0;
+}
+
+StagedWriteBatch::StagedWriteBatch(Context &ctx, Storage *storage, uint64_t version, std::string log_data)
+    : ctx_(ctx),
+      storage_(storage),
+      version_(version),
+      log_data_(std::move(log_data)),
+      staged_(!storage->InTxn()),
+      batch_(storage->GetWriteBatchBase()) {
+  if (staged_) storage_->AddStagedVersion(version_);
+}
+
+StagedWriteBatch::~StagedWriteBatch() {
+  if (!staged_) return;
+  if (recorded_) {
+    // the version is never committed, its subkeys are dropped by the compaction filter once it's unstaged
+    auto batch = storage_->GetWriteBatchBase();
+    auto s = batch->Delete(storage_->GetCFHandle(ColumnFamilyID::Propagate), StagedVersionKey(version_));
+    if (s.ok()) s = storage_->Write(ctx_, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+    if (!s.ok()) LOG(WARNING) << "[storage] Failed to drop the staged version " << version_ << ": " << s.ToString();
   }
-  return ObserverOrUniquePtr<rocksdb::WriteBatchBase>(
-      new rocksdb::WriteBatch(0 /*reserved_bytes*/, GetWriteBatchMaxBytes()), ObserverOrUnique::Unique);
+  storage_->RemoveStagedVersion(version_);
+}
+
+rocksdb::Status StagedWriteBatch::Flush() {
+  if (!staged_ || batch_->GetWriteBatch()->GetDataSize() < kMaxBatchBytes) return rocksdb::Status::OK();
+
+  if (!recorded_) {
+    auto s = batch_->Put(storage_->GetCFHandle(ColumnFamilyID::Propagate), StagedVersionKey(version_), Slice());
+    if (!s.ok()) return s;
+    recorded_ = true;
+  }
+  auto s = storage_->Write(ctx_, storage_->DefaultWriteOptions(), batch_->GetWriteBatch());
+  if (!s.ok()) return s;
+  batch_ = storage_->GetWriteBatchBase();
+  return batch_->PutLogData(log_data_);
+}
+
+rocksdb::Status StagedWriteBatch::Commit() {
+  if (recorded_) {
+    auto s = batch_->Delete(storage_->GetCFHandle(ColumnFamilyID::Propagate), StagedVersionKey(version_));
+    if (!s.ok()) return s;
+  }
+  auto s = storage_->Write(ctx_, storage_->DefaultWriteOptions(), batch_->GetWriteBatch());
+  if (staged_) {
+    storage_->RemoveStagedVersion(version_);
+    staged_ = false;
+  }
+  return s;
 }
 
 Status Storage::WriteToPropagateCF(engine::Context &ctx, const std::string &key, const std::string &value) {
@@ -987,9 +1964,9 @@ std::string Storage::GetReplIdFromDbEngine() {
   return replid_in_db;
 }
 
-std::shared_lock<std::shared_mutex> Storage::ReadLockGuard() { return std::shared_lock(db_rw_lock_); }
+std::shared_lock<ShardedSharedMutex> Storage::ReadLockGuard() { return std::shared_lock(db_rw_lock_); }
 
-std::unique_lock<std::shared_mutex> Storage::WriteLockGuard() { return std::unique_lock(db_rw_lock_); }
+std::unique_lock<ShardedSharedMutex> Storage::WriteLockGuard() { return std::unique_lock(db_rw_lock_); }
 
 Status Storage::ReplDataManager::GetFullReplDataInfo(Storage *storage, std::string *files) {
   auto guard = storage->ReadLockGuard();
@@ -1029,8 +2006,10 @@ Status Storage::ReplDataManager::GetFullReplDataInfo(Storage *storage, std::stri
     if (can_shared_time_secs > 60 * 60) can_shared_time_secs = 60 * 60;
     if (can_shared_time_secs < 10 * 60) can_shared_time_secs = 10 * 60;
 
+    // The checkpoint which is being fetched by other replicas is shared regardless of its age,
+    // it can't be purged until the fetches are done, so a new one would only cost more disk space.
     auto now_secs = util::GetTimeStamp<std::chrono::seconds>();
-    if (now_secs - storage->GetCheckpointCreateTimeSecs() > can_shared_time_secs) {
+    if (storage->GetCheckpointRefs() == 0 && now_secs - storage->GetCheckpointCreateTimeSecs() > can_shared_time_secs) {
       LOG(WARNING) << "[storage] Can't use current checkpoint, waiting next checkpoint";
       return {Status::NotOK, "Can't use current checkpoint, waiting for next checkpoint"};
     }
@@ -1066,6 +2045,32 @@ bool Storage::ExistCheckpoint() {
   return env_->FileExists(config_->checkpoint_dir).ok();
 }
 
+void Storage::AcquireCheckpoint() {
+  std::lock_guard<std::mutex> lg(checkpoint_mu_);
+  checkpoint_info_.refs++;
+}
+
+void Storage::ReleaseCheckpoint() {
+  checkpoint_info_.access_time_secs = util::GetTimeStamp<std::chrono::seconds>();
+  checkpoint_info_.refs--;
+}
+
+StatusOr<bool> Storage::PurgeCheckpoint(int64_t max_idle_secs, int64_t max_age_secs) {
+  // The lock makes sure the checkpoint isn't purged while it's being created or shared
+  std::lock_guard<std::mutex> lg(checkpoint_mu_);
+  if (!env_->FileExists(config_->checkpoint_dir).ok() || checkpoint_info_.refs > 0) return false;
+
+  auto now_secs = util::GetTimeStamp<std::chrono::seconds>();
+  if (now_secs - checkpoint_info_.access_time_secs <= max_idle_secs &&
+      now_secs - checkpoint_info_.create_time_secs <= max_age_secs) {
+    return false;
+  }
+
+  auto s = rocksdb::DestroyDB(config_->checkpoint_dir, rocksdb::Options());
+  if (!s.ok()) return {Status::NotOK, s.ToString()};
+  return true;
+}
+
 bool Storage::ExistSyncCheckpoint() { return env_->FileExists(config_->sync_checkpoint_dir).ok(); }
 
 Status Storage::InWALBoundary(rocksdb::SequenceNumber seq) {
@@ -1235,47 +2240,97 @@ Status Storage::ReplDataManager::SwapTmpFile(Storage *storage, const std::string
   return Status::OK();
 }
 
-bool Storage::ReplDataManager::FileExists(Storage *storage, const std::string &dir, const std::string &repl_file,
-                                          uint32_t crc) {
-  if (storage->IsClosing()) return false;
-
-  auto file_path = dir + "/" + repl_file;
-  auto s = storage->env_->FileExists(file_path);
-  if (!s.ok()) return false;
-
-  // If crc is 0, we needn't verify, return true directly.
-  if (crc == 0) return true;
-
+// computeFileCRC computes the crc32c of the first size bytes of the file
+static bool computeFileCRC(rocksdb::Env *env, const std::string &file_path, uint64_t size, uint32_t *crc) {
   std::unique_ptr<rocksdb::SequentialFile> src_file;
   const rocksdb::EnvOptions env_options;
-  s = storage->env_->NewSequentialFile(file_path, &src_file, env_options);
-  if (!s.ok()) return false;
-
-  uint64_t size = 0;
-  s = storage->env_->GetFileSize(file_path, &size);
+  auto s = env->NewSequentialFile(file_path, &src_file, env_options);
   if (!s.ok()) return false;
 
   auto src_reader = std::make_unique<rocksdb::SequentialFileWrapper>(src_file.get());
 
-  char buffer[4096];
+  constexpr size_t kBufferSize = 1024 * 1024;
+  auto buffer = std::make_unique<char[]>(kBufferSize);
   Slice slice;
   uint32_t tmp_crc = 0;
   while (size > 0) {
-    size_t bytes_to_read = std::min(sizeof(buffer), static_cast<size_t>(size));
-    s = src_reader->Read(bytes_to_read, &slice, buffer);
+    size_t bytes_to_read = std::min(kBufferSize, static_cast<size_t>(size));
+    s = src_reader->Read(bytes_to_read, &slice, buffer.get());
     if (!s.ok()) return false;
 
     if (slice.size() == 0) return false;
 
-    tmp_crc = rocksdb::crc32c::Extend(0, slice.data(), slice.size());
+    tmp_crc = rocksdb::crc32c::Extend(tmp_crc, slice.data(), slice.size());
     size -= slice.size();
   }
 
-  return crc == tmp_crc;
+  *crc = tmp_crc;
+  return true;
+}
+
+bool Storage::ReplDataManager::CheckDataFilePrefix(Storage *storage, const std::string &rel_file, uint64_t size,
+                                                   uint32_t crc) {
+  std::string abs_path = storage->config_->checkpoint_dir + "/" + rel_file;
+  uint64_t file_size = 0;
+  if (!storage->env_->GetFileSize(abs_path, &file_size).ok() || size > file_size) return false;
+
+  uint32_t prefix_crc = 0;
+  return computeFileCRC(storage->env_, abs_path, size, &prefix_crc) && prefix_crc == crc;
+}
+
+std::unique_ptr<rocksdb::WritableFile> Storage::ReplDataManager::ResumeTmpFile(Storage *storage,
+                                                                               const std::string &dir,
+                                                                               const std::string &repl_file,
+                                                                               uint64_t *size, uint32_t *crc) {
+  std::string tmp_file = dir + "/" + repl_file + ".tmp";
+  if (!storage->env_->FileExists(tmp_file).ok()) return nullptr;
+  if (!storage->env_->GetFileSize(tmp_file, size).ok()) return nullptr;
+  if (!computeFileCRC(storage->env_, tmp_file, *size, crc)) return nullptr;
+
+  std::unique_ptr<rocksdb::WritableFile> wf;
+  auto s = storage->env_->ReopenWritableFile(tmp_file, &wf, rocksdb::EnvOptions());
+  if (!s.ok()) {
+    LOG(ERROR) << "[storage] Failed to reopen data file '" << tmp_file << "'. Error: " << s.ToString();
+    return nullptr;
+  }
+
+  return wf;
+}
+
+uint64_t Storage::ReplDataManager::GetTmpFileSize(Storage *storage, const std::string &dir,
+                                                  const std::string &repl_file) {
+  uint64_t size = 0;
+  if (!storage->env_->GetFileSize(dir + "/" + repl_file + ".tmp", &size).ok()) return 0;
+  return size;
+}
+
+void Storage::ReplDataManager::RemoveTmpFile(Storage *storage, const std::string &dir, const std::string &repl_file) {
+  std::string tmp_file = dir + "/" + repl_file + ".tmp";
+  if (storage->env_->FileExists(tmp_file).ok()) storage->env_->DeleteFile(tmp_file);
+}
+
+bool Storage::ReplDataManager::FileExists(Storage *storage, const std::string &dir, const std::string &repl_file,
+                                          uint32_t crc) {
+  if (storage->IsClosing()) return false;
+
+  auto file_path = dir + "/" + repl_file;
+  auto s = storage->env_->FileExists(file_path);
+  if (!s.ok()) return false;
+
+  // If crc is 0, we needn't verify, return true directly.
+  if (crc == 0) return true;
+
+  uint64_t size = 0;
+  s = storage->env_->GetFileSize(file_path, &size);
+  if (!s.ok()) return false;
+
+  uint32_t file_crc = 0;
+  return computeFileCRC(storage->env_, file_path, size, &file_crc) && crc == file_crc;
 }
 
 [[nodiscard]] rocksdb::ReadOptions Context::GetReadOptions() const {
   rocksdb::ReadOptions read_options;
+  read_options.auto_prefix_mode = true;
   if (is_txn_mode) read_options.snapshot = snapshot;
   return read_options;
 }
@@ -1286,6 +2341,12 @@ bool Storage::ReplDataManager::FileExists(Storage *storage, const std::string &d
   return read_options;
 }
 
+[[nodiscard]] rocksdb::ReadOptions Context::SubKeyScanOptions(uint64_t n) const {
+  rocksdb::ReadOptions read_options = storage->SubKeyScanOptions(n);
+  if (is_txn_mode) read_options.snapshot = snapshot;
+  return read_options;
+}
+
 [[nodiscard]] rocksdb::ReadOptions Context::DefaultMultiGetOptions() const {
   rocksdb::ReadOptions read_options = storage->DefaultMultiGetOptions();
   if (is_txn_mode) read_options.snapshot = snapshot;
@@ -1293,11 +2354,9 @@ bool Storage::ReplDataManager::FileExists(Storage *storage, const std::string &d
 }
 
 void Context::RefreshLatestSnapshot() {
-  auto guard = storage->WriteLockGuard();
-  if (snapshot) {
-    storage->GetDB()->ReleaseSnapshot(snapshot);
-  }
-  snapshot = storage->GetDB()->GetSnapshot();
+  auto guard = storage->ReadLockGuard();
+  shared_snapshot = storage->GetSharedSnapshot(false);
+  snapshot = shared_snapshot.get();
   if (batch) {
     batch->Clear();
   }
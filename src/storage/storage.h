@@ -30,17 +30,27 @@
 #include <atomic>
 #include <cinttypes>
 #include <cstddef>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <shared_mutex>
 #include <string>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
+#include "cache_warmup.h"
 #include "common/port.h"
 #include "config/config.h"
+#include "group_commit.h"
+#include "incr_combiner.h"
+#include "lazy_free.h"
 #include "lock_manager.h"
+#include "metadata_cache.h"
 #include "observer_or_unique.h"
+#include "sharded_shared_mutex.h"
 #include "status.h"
+#include "tiered_cache_tuner.h"
 
 #if defined(__sparc__) || defined(__arm__)
 #define USE_ALIGNED_ACCESS
@@ -68,9 +78,12 @@ enum class ColumnFamilyID : uint32_t {
   Propagate,
   Stream,
   Search,
+  TTLIndex,
+  ZSetRank,
+  KeyID,
 };
 
-constexpr uint32_t kMaxColumnFamilyID = static_cast<uint32_t>(ColumnFamilyID::Search);
+constexpr uint32_t kMaxColumnFamilyID = static_cast<uint32_t>(ColumnFamilyID::KeyID);
 
 namespace engine {
 
@@ -110,6 +123,10 @@ enum class StatType : uint_fast8_t {
   FlushCount,
   KeyspaceHits,
   KeyspaceMisses,
+  CompactionFilterCacheHits,
+  CompactionFilterCacheMisses,
+  WriteBatchAllocations,
+  CompactionCheckerReclaimedBytes,
 };
 
 struct DBStats {
@@ -117,8 +134,23 @@ struct DBStats {
   alignas(CACHE_LINE_SIZE) std::atomic<uint_fast64_t> flush_count = 0;
   alignas(CACHE_LINE_SIZE) std::atomic<uint_fast64_t> keyspace_hits = 0;
   alignas(CACHE_LINE_SIZE) std::atomic<uint_fast64_t> keyspace_misses = 0;
+  // metadata lookups of the subkey compaction filter served by its cache, and read from the DB
+  alignas(CACHE_LINE_SIZE) std::atomic<uint_fast64_t> compaction_filter_cache_hits = 0;
+  alignas(CACHE_LINE_SIZE) std::atomic<uint_fast64_t> compaction_filter_cache_misses = 0;
+  // write batches created because the pool of the thread was empty
+  alignas(CACHE_LINE_SIZE) std::atomic<uint_fast64_t> write_batch_allocations = 0;
+  // the SST bytes reclaimed by the compactions of the compaction checker
+  alignas(CACHE_LINE_SIZE) std::atomic<uint_fast64_t> compaction_checker_reclaimed_bytes = 0;
 };
 
+// WriteBatchRecycler clears a write batch and keeps it in a small pool of the current thread,
+// so the batches of the following writes reuse its buffer instead of allocating a new one
+struct WriteBatchRecycler {
+  void operator()(rocksdb::WriteBatchBase *batch) const;
+};
+
+using WriteBatchBasePtr = ObserverOrUniquePtr<rocksdb::WriteBatchBase, WriteBatchRecycler>;
+
 class ColumnFamilyConfig {
  public:
   ColumnFamilyConfig(ColumnFamilyID id, std::string_view name, bool is_minor)
@@ -140,6 +172,9 @@ constexpr const std::string_view kPubSubColumnFamilyName = "pubsub";
 constexpr const std::string_view kPropagateColumnFamilyName = "propagate";
 constexpr const std::string_view kStreamColumnFamilyName = "stream";
 constexpr const std::string_view kSearchColumnFamilyName = "search";
+constexpr const std::string_view kTTLIndexColumnFamilyName = "ttl_index";
+constexpr const std::string_view kZSetRankColumnFamilyName = "zset_rank";
+constexpr const std::string_view kKeyIDColumnFamilyName = "key_id";
 
 class ColumnFamilyConfigs {
  public:
@@ -178,6 +213,21 @@ class ColumnFamilyConfigs {
     return {ColumnFamilyID::Search, kSearchColumnFamilyName, /*is_minor=*/true};
   }
 
+  /// TTLIndexColumnFamily indexes the keys with a TTL by their expire time, see ExpiredKeyReaper.
+  static ColumnFamilyConfig TTLIndexColumnFamily() {
+    return {ColumnFamilyID::TTLIndex, kTTLIndexColumnFamilyName, /*is_minor=*/true};
+  }
+
+  /// ZSetRankColumnFamily counts the members of the zsets by the prefixes of their scores, see ZSetRankIndex.
+  static ColumnFamilyConfig ZSetRankColumnFamily() {
+    return {ColumnFamilyID::ZSetRank, kZSetRankColumnFamilyName, /*is_minor=*/true};
+  }
+
+  /// KeyIDColumnFamily maps the key IDs of the compact subkeys back to the user keys, see InternalKey.
+  static ColumnFamilyConfig KeyIDColumnFamily() {
+    return {ColumnFamilyID::KeyID, kKeyIDColumnFamilyName, /*is_minor=*/true};
+  }
+
   /// ListAllColumnFamilies returns all column families in kvrocks.
   static const std::vector<ColumnFamilyConfig> &ListAllColumnFamilies() { return AllCfs; }
 
@@ -189,11 +239,13 @@ class ColumnFamilyConfigs {
   // Caution: don't change the order of column family, or the handle will be mismatched
   inline const static std::vector<ColumnFamilyConfig> AllCfs = {
       PrimarySubkeyColumnFamily(), MetadataColumnFamily(), SecondarySubkeyColumnFamily(), PubSubColumnFamily(),
-      PropagateColumnFamily(),     StreamColumnFamily(),   SearchColumnFamily(),
+      PropagateColumnFamily(),     StreamColumnFamily(),   SearchColumnFamily(),          TTLIndexColumnFamily(),
+      ZSetRankColumnFamily(),      KeyIDColumnFamily(),
   };
   inline const static std::vector<ColumnFamilyConfig> AllCfsWithoutDefault = {
       MetadataColumnFamily(),  SecondarySubkeyColumnFamily(), PubSubColumnFamily(),
       PropagateColumnFamily(), StreamColumnFamily(),          SearchColumnFamily(),
+      TTLIndexColumnFamily(),  ZSetRankColumnFamily(),          KeyIDColumnFamily(),
   };
 };
 
@@ -209,10 +261,15 @@ class Storage {
   void CloseDB();
   bool IsEmptyDB();
   void EmptyDB();
-  rocksdb::BlockBasedTableOptions InitTableOptions();
+  rocksdb::BlockBasedTableOptions InitTableOptions(int filter_bits_per_key = 10);
   void SetBlobDB(rocksdb::ColumnFamilyOptions *cf_options);
+  // SetCompressionDict enables the dictionary compression of the column family if it's
+  // listed in rocksdb.compression_dict_column_families
+  void SetCompressionDict(const std::string &cf_name, rocksdb::ColumnFamilyOptions *cf_options);
+  bool IsCompressionDictColumnFamily(std::string_view cf_name) const;
   rocksdb::Options InitRocksDBOptions();
   Status SetOptionForAllColumnFamilies(const std::string &key, const std::string &value);
+  Status SetOptionForDictColumnFamilies(const std::string &key, const std::string &value);
   Status SetDBOption(const std::string &key, const std::string &value);
   Status CreateColumnFamilies(const rocksdb::Options &options);
   // The sequence_number will be pointed to the value of the sequence number in range of DB,
@@ -223,10 +280,41 @@ class Storage {
   Status RestoreFromBackup();
   Status RestoreFromCheckpoint();
   Status GetWALIter(rocksdb::SequenceNumber seq, std::unique_ptr<rocksdb::TransactionLogIterator> *iter);
+  /// ReplicaApplyWriteBatch writes a batch of the master as it is, its index entries are written by the master
   Status ReplicaApplyWriteBatch(std::string &&raw_batch);
+  /// ApplyWriteBatch writes a batch built elsewhere, e.g. by a slot migration, and indexes it like the local writes
   Status ApplyWriteBatch(const rocksdb::WriteOptions &options, std::string &&raw_batch);
+  /// IngestSSTFile moves the SST file into the column family of the name. The entries bypass the WAL,
+  /// so the replicas which haven't applied a sequence after the ingestion need a full sync, see GetLastIngestSeq
+  Status IngestSSTFile(const std::string &cf_name, const std::string &path);
+  /// ApplySSTFile writes the entries of the SST file through the WAL instead, in batches of about batch_bytes
+  Status ApplySSTFile(const std::string &cf_name, const std::string &path, size_t batch_bytes);
+  /// GetLastIngestSeq returns the first sequence after the last ingestion of SST files, or 0 if there's none
+  rocksdb::SequenceNumber GetLastIngestSeq() const { return last_ingest_seq_; }
   rocksdb::SequenceNumber LatestSeqNumber();
 
+  /// GetRawMetadata reads the metadata of the key, it's served by the metadata cache if possible
+  [[nodiscard]] rocksdb::Status GetRawMetadata(engine::Context &ctx, const rocksdb::Slice &ns_key, std::string *bytes);
+  MetadataCache *GetMetadataCache() { return metadata_cache_.get(); }
+  CacheWarmup *GetCacheWarmup() { return cache_warmup_.get(); }
+  // TuneTieredBlockCache rebalances the block cache and the compressed secondary cache by their recent hits
+  void TuneTieredBlockCache();
+  const TieredCacheTuner *GetTieredCacheTuner() const { return tiered_cache_tuner_.get(); }
+  LazyFreeQueue *GetLazyFreeQueue() { return &lazy_free_queue_; }
+  IncrCombiner<int64_t> *GetIncrCombiner() { return &incr_combiner_; }
+  /// LazyFree removes the subkeys of the keys in the lazy free queue by range, until the queue is empty
+  Status LazyFree();
+  /// DeleteSubKeys removes the subkeys of a version of a key by range, from every column family its type keeps
+  /// them in. The version of a deleted key is never reused, so the ranges can't hold any live subkey.
+  rocksdb::Status DeleteSubKeys(rocksdb::WriteBatchBase *batch, RedisType type, const rocksdb::Slice &ns_key,
+                                uint64_t version);
+  /// AddCompactionHint records a key range removed by DeleteRange, which the compaction checker compacts
+  /// before picking files, since the table properties don't count the keys covered by range tombstones.
+  /// The runs of expired metadata met by the iterations are recorded as well, see ExpiredMetadataSkipper
+  void AddCompactionHint(ColumnFamilyID cf_id, std::string begin, std::string end);
+  /// TakeCompactionHints returns the recorded ranges of the column family sorted and merged, and clears them
+  std::vector<std::pair<std::string, std::string>> TakeCompactionHints(ColumnFamilyID cf_id);
+
   [[nodiscard]] rocksdb::Status Get(engine::Context &ctx, const rocksdb::ReadOptions &options,
                                     const rocksdb::Slice &key, std::string *value);
   [[nodiscard]] rocksdb::Status Get(engine::Context &ctx, const rocksdb::ReadOptions &options,
@@ -239,6 +327,11 @@ class Storage {
                                     rocksdb::PinnableSlice *value);
   void MultiGet(engine::Context &ctx, const rocksdb::ReadOptions &options, rocksdb::ColumnFamilyHandle *column_family,
                 size_t num_keys, const rocksdb::Slice *keys, rocksdb::PinnableSlice *values, rocksdb::Status *statuses);
+  /// MultiGet of the keys in several column families, the key i is read from column_families[i].
+  /// The pending writes of a batch can only be read per column family, so the keys are read one by one then.
+  void MultiGet(engine::Context &ctx, const rocksdb::ReadOptions &options,
+                rocksdb::ColumnFamilyHandle **column_families, size_t num_keys, const rocksdb::Slice *keys,
+                rocksdb::PinnableSlice *values, rocksdb::Status *statuses);
   rocksdb::Iterator *NewIterator(engine::Context &ctx, const rocksdb::ReadOptions &options,
                                  rocksdb::ColumnFamilyHandle *column_family);
   rocksdb::Iterator *NewIterator(engine::Context &ctx, const rocksdb::ReadOptions &options);
@@ -247,6 +340,8 @@ class Storage {
                                       rocksdb::WriteBatch *updates);
   const rocksdb::WriteOptions &DefaultWriteOptions() { return default_write_opts_; }
   rocksdb::ReadOptions DefaultScanOptions() const;
+  // SubKeyScanOptions returns DefaultScanOptions with the readahead sized for reading `n` subkeys
+  rocksdb::ReadOptions SubKeyScanOptions(uint64_t n) const;
   rocksdb::ReadOptions DefaultMultiGetOptions() const;
   [[nodiscard]] rocksdb::Status Delete(engine::Context &ctx, const rocksdb::WriteOptions &options,
                                        rocksdb::ColumnFamilyHandle *cf_handle, const rocksdb::Slice &key);
@@ -258,11 +353,27 @@ class Storage {
   bool WALHasNewData(rocksdb::SequenceNumber seq) { return seq <= LatestSeqNumber(); }
   Status InWALBoundary(rocksdb::SequenceNumber seq);
   Status WriteToPropagateCF(engine::Context &ctx, const std::string &key, const std::string &value);
+  /// GetKeyByID returns the user key of a compact subkey from the key ID column family,
+  /// it's NotFound if the key has been deleted.
+  [[nodiscard]] rocksdb::Status GetKeyByID(const InternalKey &ikey, std::string *user_key);
 
   [[nodiscard]] rocksdb::Status Compact(rocksdb::ColumnFamilyHandle *cf, const rocksdb::Slice *begin,
                                         const rocksdb::Slice *end);
+  [[nodiscard]] rocksdb::Status FlushMemTables();
   rocksdb::DB *GetDB();
+  /// GetSharedSnapshot returns a snapshot shared by the Contexts created at about the same time, which saves
+  /// most of the GetSnapshot calls. The caller must hold ReadLockGuard. The snapshot is reused as long as
+  /// no write has been done after it was taken, or if allow_stale is true, for txn-context-max-snapshot-staleness-us.
+  std::shared_ptr<const rocksdb::Snapshot> GetSharedSnapshot(bool allow_stale);
+  /// ReleaseIdleSharedSnapshot releases the shared snapshot if no Context uses it, so it won't pin old data
+  void ReleaseIdleSharedSnapshot();
   bool IsClosing() const { return db_closing_; }
+  bool IsSecondary() const { return db_open_mode_ == kDBOpenModeAsSecondaryInstance; }
+  /// GetOpenDuration returns the milliseconds taken by the last DB::Open
+  int64_t GetOpenDuration() const { return open_duration_ms_; }
+  /// TryCatchUpWithPrimary replays the new writes of the primary on a secondary instance,
+  /// the caller must make sure that no command is reading the db
+  Status TryCatchUpWithPrimary();
   std::string GetName() const { return config_->db_name; }
   /// Get the column family handle by the column family id.
   rocksdb::ColumnFamilyHandle *GetCFHandle(ColumnFamilyID id);
@@ -270,23 +381,44 @@ class Storage {
   LockManager *GetLockManager() { return &lock_mgr_; }
   void PurgeOldBackups(uint32_t num_backups_to_keep, uint32_t backup_max_keep_hours);
   uint64_t GetTotalSize(const std::string &ns = kDefaultNamespace);
+  // GetApproxKeyNumStats estimates the key number of all namespaces from the table properties and memtables
+  Status GetApproxKeyNumStats(ApproxKeyNumStats *stats);
+  // GetSlotStats estimates the key number and the bytes of every slot of all namespaces from the table properties,
+  // the writes in the memtables are not counted until they're flushed
+  Status GetSlotStats(std::map<uint16_t, SlotStats> *stats);
   void CheckDBSizeLimit();
   bool ReachedDBSizeLimit() { return db_size_limit_reached_; }
   void SetDBSizeLimit(bool limit) { db_size_limit_reached_ = limit; }
+  // With an eviction policy, the writes are only rejected over max-db-size once nothing can be evicted
+  void SetEvictionStalled(bool stalled) { eviction_stalled_ = stalled; }
   void SetIORateLimit(int64_t max_io_mb);
+  rocksdb::RateLimiter *GetIORateLimiter() const { return rate_limiter_.get(); }
 
-  std::shared_lock<std::shared_mutex> ReadLockGuard();
-  std::unique_lock<std::shared_mutex> WriteLockGuard();
+  std::shared_lock<ShardedSharedMutex> ReadLockGuard();
+  std::unique_lock<ShardedSharedMutex> WriteLockGuard();
 
   bool IsSlotIdEncoded() const { return config_->slot_id_encoded; }
   Config *GetConfig() const { return config_; }
 
   const DBStats *GetDBStats() const { return db_stats_.get(); }
+  const GroupCommitStats &GetGroupCommitStats() const { return group_committer_.GetStats(); }
   void RecordStat(StatType type, uint64_t v);
 
   Status BeginTxn();
-  Status CommitTxn();
-  ObserverOrUniquePtr<rocksdb::WriteBatchBase> GetWriteBatchBase();
+  // CommitTxn writes the batch without the WAL if disable_wal is true, it's lost on a crash until the memtables
+  // are flushed, see FlushMemTables
+  Status CommitTxn(bool disable_wal = false);
+  bool InTxn() const { return txnWriteBatch() != nullptr; }
+  WriteBatchBasePtr GetWriteBatchBase();
+  /// The subkeys of a version may be written in several batches before its metadata, see StagedWriteBatch.
+  /// The compaction filter keeps the subkeys of the staged versions, though their metadata isn't found.
+  /// A version written in several batches is recorded in the propagate column family as well, so a replica
+  /// stages it while applying the batches of its master, see ApplyWriteBatch.
+  void AddStagedVersion(uint64_t version);
+  void RemoveStagedVersion(uint64_t version);
+  bool IsStagedVersion(uint64_t version) const;
+  /// GetStagedGeneration changes whenever a version is unstaged, the metadata read before may be stale then
+  uint64_t GetStagedGeneration() const { return staged_generation_; }
 
   Storage(const Storage &) = delete;
   Storage &operator=(const Storage &) = delete;
@@ -298,12 +430,16 @@ class Storage {
     // Master side
     static Status GetFullReplDataInfo(Storage *storage, std::string *files);
     static int OpenDataFile(Storage *storage, const std::string &rel_file, uint64_t *file_size);
+    // CheckDataFilePrefix returns true if the crc32c of the first size bytes of the data file matches
+    static bool CheckDataFilePrefix(Storage *storage, const std::string &rel_file, uint64_t size, uint32_t crc);
     static Status CleanInvalidFiles(Storage *storage, const std::string &dir, std::vector<std::string> valid_files);
     struct CheckpointInfo {
       // System clock time when the checkpoint was created.
       std::atomic<int64_t> create_time_secs = 0;
       // System clock time when the checkpoint was last accessed.
       std::atomic<int64_t> access_time_secs = 0;
+      // The number of the fetches which are sending the files of the checkpoint now.
+      std::atomic<int> refs = 0;
       uint64_t latest_seq = 0;
     };
 
@@ -319,6 +455,13 @@ class Storage {
                                    Storage::ReplDataManager::MetaInfo *meta);
     static std::unique_ptr<rocksdb::WritableFile> NewTmpFile(Storage *storage, const std::string &dir,
                                                              const std::string &repl_file);
+    // ResumeTmpFile reopens the tmp file left by an interrupted fetch to append the rest of the file,
+    // it returns the size and the crc of the fetched part, or nullptr if there's no such tmp file
+    static std::unique_ptr<rocksdb::WritableFile> ResumeTmpFile(Storage *storage, const std::string &dir,
+                                                                const std::string &repl_file, uint64_t *size,
+                                                                uint32_t *crc);
+    static uint64_t GetTmpFileSize(Storage *storage, const std::string &dir, const std::string &repl_file);
+    static void RemoveTmpFile(Storage *storage, const std::string &dir, const std::string &repl_file);
     static Status SwapTmpFile(Storage *storage, const std::string &dir, const std::string &repl_file);
     static bool FileExists(Storage *storage, const std::string &dir, const std::string &repl_file, uint32_t crc);
   };
@@ -328,8 +471,20 @@ class Storage {
   int64_t GetCheckpointCreateTimeSecs() const { return checkpoint_info_.create_time_secs; }
   void SetCheckpointAccessTimeSecs(int64_t t) { checkpoint_info_.access_time_secs = t; }
   int64_t GetCheckpointAccessTimeSecs() const { return checkpoint_info_.access_time_secs; }
+  // The checkpoint is shared by the concurrent full syncs, a fetch holds a reference while it sends
+  // the files, and the checkpoint is never purged while it's referenced
+  void AcquireCheckpoint();
+  void ReleaseCheckpoint();
+  int GetCheckpointRefs() const { return checkpoint_info_.refs; }
+  // PurgeCheckpoint destroys the checkpoint if it's not referenced and idle for max_idle_secs,
+  // or it's older than max_age_secs, and returns true if the checkpoint is destroyed
+  StatusOr<bool> PurgeCheckpoint(int64_t max_idle_secs, int64_t max_age_secs);
   void SetDBInRetryableIOError(bool yes_or_no) { db_in_retryable_io_error_ = yes_or_no; }
   bool IsDBInRetryableIOError() const { return db_in_retryable_io_error_; }
+  // SetWriteStallCondition is called by EventListener, and GetWriteStallCondition returns the worst
+  // condition of the column families, which is checked before every write command
+  void SetWriteStallCondition(const std::string &cf_name, rocksdb::WriteStallCondition condition);
+  rocksdb::WriteStallCondition GetWriteStallCondition() const { return write_stall_condition_; }
 
   Status ShiftReplId(engine::Context &ctx);
   std::string GetReplIdFromWalBySeq(rocksdb::SequenceNumber seq);
@@ -350,27 +505,57 @@ class Storage {
   std::vector<rocksdb::ColumnFamilyHandle *> cf_handles_;
   LockManager lock_mgr_;
   std::atomic<bool> db_size_limit_reached_{false};
+  std::atomic<bool> eviction_stalled_{false};
+  std::atomic<rocksdb::SequenceNumber> last_ingest_seq_ = 0;
 
   std::unique_ptr<DBStats> db_stats_;
-
-  std::shared_mutex db_rw_lock_;
+  std::unique_ptr<MetadataCache> metadata_cache_;
+  std::unique_ptr<CacheWarmup> cache_warmup_;
+  std::shared_ptr<rocksdb::Cache> block_cache_;
+
+  std::mutex shared_snapshot_mu_;
+  std::shared_ptr<const rocksdb::Snapshot> shared_snapshot_;
+  uint64_t shared_snapshot_time_us_ = 0;
+  std::unique_ptr<TieredCacheTuner> tiered_cache_tuner_;
+  LazyFreeQueue lazy_free_queue_;
+  std::mutex compaction_hints_mu_;
+  std::map<ColumnFamilyID, std::vector<std::pair<std::string, std::string>>> compaction_hints_;
+  IncrCombiner<int64_t> incr_combiner_{&lock_mgr_};
+
+  ShardedSharedMutex db_rw_lock_;
   bool db_closing_ = true;
+  DBOpenMode db_open_mode_ = kDBOpenModeDefault;
+  int64_t open_duration_ms_ = 0;
 
   std::atomic<bool> db_in_retryable_io_error_{false};
+  std::mutex write_stall_mu_;
+  std::map<std::string, rocksdb::WriteStallCondition> cf_write_stall_conditions_;
+  std::atomic<rocksdb::WriteStallCondition> write_stall_condition_ = rocksdb::WriteStallCondition::kNormal;
+  mutable std::mutex staged_versions_mu_;
+  std::unordered_multiset<uint64_t> staged_versions_;
+  std::atomic<size_t> staged_versions_count_ = 0;
+  std::atomic<uint64_t> staged_generation_ = 0;
 
-  std::atomic<bool> is_txn_mode_ = false;
-  // txn_write_batch_ is used as the global write batch for the transaction mode,
-  // all writes will be grouped in this write batch when entering the transaction mode,
-  // then write it at once when committing.
-  //
-  // Notice: the reason why we can use the global transaction? because the EXEC is an exclusive
-  // command, so it won't have multi transactions to be executed at the same time.
-  std::unique_ptr<rocksdb::WriteBatchWithIndex> txn_write_batch_;
 
   rocksdb::WriteOptions default_write_opts_ = rocksdb::WriteOptions();
+  GroupCommitter group_committer_;
 
   rocksdb::Status writeToDB(engine::Context &ctx, const rocksdb::WriteOptions &options, rocksdb::WriteBatch *updates);
+  bool isDefaultWriteOptions(const rocksdb::WriteOptions &options) const;
   void recordKeyspaceStat(const rocksdb::ColumnFamilyHandle *column_family, const rocksdb::Status &s);
+  rocksdb::WriteBatchWithIndex *txnWriteBatch() const;
+  void invalidateMetadataCache(rocksdb::WriteBatch *updates);
+  // loadStagedVersions drops the versions recorded as staged when the server stopped, they are never committed.
+  // A replica stages them again instead, they are committed or dropped by its master.
+  Status loadStagedVersions();
+  rocksdb::ColumnFamilyHandle *getCFHandleByName(const std::string &name);
+  rocksdb::Status indexExpireTimes(rocksdb::WriteBatch *updates);
+  rocksdb::Status indexKeyIDs(rocksdb::WriteBatch *updates);
+  // The incremental backups are managed by a backup engine in the backup dir, the caller must hold backup_mu
+  StatusOr<std::unique_ptr<rocksdb::BackupEngine>> openIncrementalBackupEngine(const std::string &backup_dir);
+  Status createIncrementalBackup(const std::string &backup_dir, uint64_t *sequence_number);
+  void purgeIncrementalBackups(const std::string &backup_dir, uint32_t num_backups_to_keep,
+                               uint32_t backup_max_keep_hours);
 };
 
 /// Context passes fixed snapshot and batch between APIs
@@ -387,6 +572,8 @@ struct Context {
   /// If is_txn_mode is false, the snapshot is nullptr.
   const rocksdb::Snapshot *snapshot = nullptr;
   std::unique_ptr<rocksdb::WriteBatchWithIndex> batch = nullptr;
+  /// shared_snapshot holds the snapshot, which may be shared with other Contexts
+  std::shared_ptr<const rocksdb::Snapshot> shared_snapshot = nullptr;
 
   /// is_txn_mode is used to determine whether the current Context is in transactional mode,
   /// if it is not transactional mode, then Context is equivalent to a Storage.
@@ -395,6 +582,14 @@ struct Context {
 
   /// NoTransactionContext returns a Context with a is_txn_mode of false
   static Context NoTransactionContext(engine::Storage *storage) { return Context(storage, false); }
+  /// SnapshotContext returns a Context reading the given snapshot, by which the Contexts of several threads can
+  /// read the same data
+  static Context SnapshotContext(engine::Storage *storage, std::shared_ptr<const rocksdb::Snapshot> snapshot) {
+    Context ctx(storage, true);
+    ctx.shared_snapshot = std::move(snapshot);
+    ctx.snapshot = ctx.shared_snapshot.get();
+    return ctx;
+  }
 
   /// GetReadOptions returns a default ReadOptions, and if is_txn_mode = true, then its snapshot is specified by the
   /// Context
@@ -402,6 +597,8 @@ struct Context {
   /// DefaultScanOptions returns a DefaultScanOptions, and if is_txn_mode = true, then its snapshot is specified by the
   /// Context. Otherwise it is the same as Storage::DefaultScanOptions
   [[nodiscard]] rocksdb::ReadOptions DefaultScanOptions() const;
+  /// SubKeyScanOptions is the same as DefaultScanOptions, with the readahead of Storage::SubKeyScanOptions
+  [[nodiscard]] rocksdb::ReadOptions SubKeyScanOptions(uint64_t n) const;
   /// DefaultMultiGetOptions returns a DefaultMultiGetOptions, and if is_txn_mode = true, then its snapshot is specified
   /// by the Context. Otherwise it is the same as Storage::DefaultMultiGetOptions
   [[nodiscard]] rocksdb::ReadOptions DefaultMultiGetOptions() const;
@@ -411,18 +608,19 @@ struct Context {
   /// TODO: Change it to defer getting the context, and the snapshot is pinned after the first read operation
   explicit Context(engine::Storage *storage) : storage(storage) {
     auto guard = storage->ReadLockGuard();
-    if (!storage->GetConfig()->txn_context_enabled) {
+    // A secondary instance doesn't support snapshots, its commands don't run during the catch up instead
+    if (!storage->GetConfig()->txn_context_enabled || storage->IsSecondary()) {
       is_txn_mode = false;
       return;
     }
-    snapshot = storage->GetDB()->GetSnapshot();  // NOLINT
+    shared_snapshot = storage->GetSharedSnapshot(true);
+    snapshot = shared_snapshot.get();
   }
   ~Context() {
-    if (storage) {
-      auto guard = storage->WriteLockGuard();
-      if (storage->GetDB() && snapshot) {
-        storage->GetDB()->ReleaseSnapshot(snapshot);
-      }
+    if (storage && shared_snapshot) {
+      // Releasing a snapshot is thread-safe in rocksdb, only a concurrent close of the DB has to be excluded
+      auto guard = storage->ReadLockGuard();
+      shared_snapshot.reset();
     }
   }
   Context(const Context &) = delete;
@@ -432,13 +630,18 @@ struct Context {
       storage = ctx.storage;
       snapshot = ctx.snapshot;
       batch = std::move(ctx.batch);
+      shared_snapshot = std::move(ctx.shared_snapshot);
 
       ctx.storage = nullptr;
       ctx.snapshot = nullptr;
     }
     return *this;
   }
-  Context(Context &&ctx) noexcept : storage(ctx.storage), snapshot(ctx.snapshot), batch(std::move(ctx.batch)) {
+  Context(Context &&ctx) noexcept
+      : storage(ctx.storage),
+        snapshot(ctx.snapshot),
+        batch(std::move(ctx.batch)),
+        shared_snapshot(std::move(ctx.shared_snapshot)) {
     ctx.storage = nullptr;
     ctx.snapshot = nullptr;
   }
@@ -448,4 +651,37 @@ struct Context {
   explicit Context(engine::Storage *storage, bool txn_mode) : storage(storage), is_txn_mode(txn_mode) {}
 };
 
+/// StagedWriteBatch writes the subkeys of a new version of a key in batches of bounded size, and its metadata with
+/// the last batch, so a huge key is never written at once. The version stays invisible until the last batch, and
+/// it's staged in the storage meanwhile, so the compaction filter doesn't drop the subkeys without a metadata.
+/// In a transaction (MULTI or a script), everything goes to the batch of the transaction instead.
+class StagedWriteBatch {
+ public:
+  static constexpr size_t kMaxBatchBytes = 4 * 1024 * 1024;
+
+  StagedWriteBatch(Context &ctx, Storage *storage, uint64_t version, std::string log_data);
+  ~StagedWriteBatch();
+
+  StagedWriteBatch(const StagedWriteBatch &) = delete;
+  StagedWriteBatch &operator=(const StagedWriteBatch &) = delete;
+
+  /// Begin puts the log data into the first batch
+  rocksdb::Status Begin() { return batch_->PutLogData(log_data_); }
+  rocksdb::WriteBatchBase *Get() { return batch_.Get(); }
+  /// Flush writes the batch and starts a new one if it's larger than kMaxBatchBytes, and does nothing in a transaction
+  rocksdb::Status Flush();
+  /// Commit writes the last batch, which should have the metadata
+  rocksdb::Status Commit();
+
+ private:
+  Context &ctx_;
+  Storage *storage_;
+  uint64_t version_;
+  std::string log_data_;
+  bool staged_;
+  // whether the version is recorded in the propagate column family, i.e. a batch was written before the last one
+  bool recorded_ = false;
+  WriteBatchBasePtr batch_;
+};
+
 }  // namespace engine
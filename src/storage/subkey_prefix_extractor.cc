@@ -0,0 +1,56 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "subkey_prefix_extractor.h"
+
+#include "encoding.h"
+#include "redis_metadata.h"
+
+namespace engine {
+
+size_t SubKeyPrefixExtractor::prefixLength(const rocksdb::Slice &key) const {
+  size_t len = 1;
+  if (key.size() < len) return 0;
+  len += static_cast<uint8_t>(key[0]);
+  if (slot_id_encoded_) len += 2;
+
+  if (key.size() <= len) return 0;
+  // the compact subkeys have no key, see InternalKey
+  if (static_cast<uint8_t>(key[len]) == InternalKey::kCompactKeyMarker) {
+    len += 1;
+  } else {
+    if (key.size() < len + 4) return 0;
+    len += 4 + DecodeFixed32(key.data() + len);
+  }
+  len += 8;
+  return key.size() < len ? 0 : len;
+}
+
+rocksdb::Slice SubKeyPrefixExtractor::Transform(const rocksdb::Slice &key) const {
+  return {key.data(), prefixLength(key)};
+}
+
+bool SubKeyPrefixExtractor::InDomain(const rocksdb::Slice &key) const { return prefixLength(key) > 0; }
+
+std::shared_ptr<const rocksdb::SliceTransform> NewSubKeyPrefixExtractor(bool slot_id_encoded) {
+  return std::make_shared<SubKeyPrefixExtractor>(slot_id_encoded);
+}
+
+}  // namespace engine
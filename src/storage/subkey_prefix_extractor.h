@@ -0,0 +1,58 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <rocksdb/slice_transform.h>
+
+#include <memory>
+
+namespace engine {
+
+// SubKeyPrefixExtractor extracts the key and version part of an internal key
+// (see InternalKey), so all subkeys of one key share a prefix for the prefix bloom filters:
+//
+//   | ns size (1) | ns | [slot id (2)] | key size (4) | key | version (8) | subkey |
+//
+// or the key ID part of the compact subkeys:
+//
+//   | ns size (1) | ns | [slot id (2)] | 0xff | version (8) | subkey |
+//
+// Keys shorter than that prefix are out of the domain.
+class SubKeyPrefixExtractor : public rocksdb::SliceTransform {
+ public:
+  explicit SubKeyPrefixExtractor(bool slot_id_encoded) : slot_id_encoded_(slot_id_encoded) {}
+
+  const char *Name() const override {
+    return slot_id_encoded_ ? "kvrocks.SubKeyPrefixExtractor.slot" : "kvrocks.SubKeyPrefixExtractor";
+  }
+  rocksdb::Slice Transform(const rocksdb::Slice &key) const override;
+  bool InDomain(const rocksdb::Slice &key) const override;
+
+ private:
+  // Returns the prefix length, or 0 if the key is out of the domain
+  size_t prefixLength(const rocksdb::Slice &key) const;
+
+  bool slot_id_encoded_;
+};
+
+std::shared_ptr<const rocksdb::SliceTransform> NewSubKeyPrefixExtractor(bool slot_id_encoded);
+
+}  // namespace engine
@@ -23,6 +23,7 @@
 #include <memory>
 #include <utility>
 
+#include "cluster/redis_slot.h"
 #include "encoding.h"
 #include "redis_metadata.h"
 #include "server/server.h"
@@ -37,6 +38,7 @@ rocksdb::Status CompactOnExpiredCollector::AddUserKey(const rocksdb::Slice &key,
   total_keys_ += 1;
   if (entry_type == rocksdb::kEntryDelete) {
     deleted_keys_ += 1;
+    if (cf_name_ == "metadata") deleted_metadata_keys_ += 1;
     return rocksdb::Status::OK();
   }
 
@@ -55,7 +57,15 @@ rocksdb::Status CompactOnExpiredCollector::AddUserKey(const rocksdb::Slice &key,
   total_keys_ += metadata.size;
   if (metadata.ExpireAt(Server::GetCachedUnixTime() * 1000)) {
     deleted_keys_ += metadata.size + 1;
+    expired_keys_ += 1;
+    return rocksdb::Status::OK();
   }
+
+  auto type = metadata.Type();
+  if (type >= RedisTypeNames.size()) return rocksdb::Status::OK();
+  if (type_keys_.size() <= type) type_keys_.resize(type + 1, 0);
+  type_keys_[type] += 1;
+  if (!metadata.IsSingleKVType()) sub_keys_ += metadata.size;
   return rocksdb::Status::OK();
 }
 
@@ -64,6 +74,15 @@ rocksdb::Status CompactOnExpiredCollector::Finish(rocksdb::UserCollectedProperti
   properties->emplace("deleted_keys", std::to_string(deleted_keys_));
   properties->emplace("start_key", start_key_);
   properties->emplace("stop_key", stop_key_);
+  if (cf_name_ == "metadata") {
+    for (size_t type = 0; type < type_keys_.size(); type++) {
+      if (type_keys_[type] == 0) continue;
+      properties->emplace(kApproxKeysPropPrefix + RedisTypeNames[type], std::to_string(type_keys_[type]));
+    }
+    properties->emplace(kApproxExpiredKeysProp, std::to_string(expired_keys_));
+    properties->emplace(kApproxDeletedKeysProp, std::to_string(deleted_metadata_keys_));
+    properties->emplace(kApproxSubKeysProp, std::to_string(sub_keys_));
+  }
   return rocksdb::Status::OK();
 }
 
@@ -88,3 +107,77 @@ std::shared_ptr<CompactOnExpiredTableCollectorFactory> NewCompactOnExpiredTableC
     const std::string &cf_name, float trigger_threshold) {
   return std::make_shared<CompactOnExpiredTableCollectorFactory>(cf_name, trigger_threshold);
 }
+
+rocksdb::Status SlotStatsCollector::AddUserKey(const rocksdb::Slice &key, const rocksdb::Slice &value,
+                                               rocksdb::EntryType entry_type, rocksdb::SequenceNumber, uint64_t) {
+  auto slot = ExtractSlotId(key);
+  if (slot >= HASH_SLOTS_SIZE) return rocksdb::Status::OK();
+
+  auto &stats = stats_[slot];
+  if (entry_type == rocksdb::kEntryDelete || entry_type == rocksdb::kEntrySingleDelete) {
+    if (count_keys_) stats.deleted_keys += 1;
+    return rocksdb::Status::OK();
+  }
+  if (entry_type != rocksdb::kEntryPut && entry_type != rocksdb::kEntryBlobIndex) return rocksdb::Status::OK();
+
+  stats.bytes += key.size() + value.size();
+  if (!count_keys_) return rocksdb::Status::OK();
+
+  stats.put_keys += 1;
+  if (entry_type != rocksdb::kEntryPut) return rocksdb::Status::OK();
+  Metadata metadata(RedisType::kRedisNone);
+  if (metadata.Decode(value).ok() && metadata.ExpireAt(Server::GetCachedUnixTime() * 1000)) {
+    stats.deleted_keys += 1;
+  }
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status SlotStatsCollector::Finish(rocksdb::UserCollectedProperties *properties) {
+  std::string value;
+  Encode(stats_, &value);
+  properties->emplace(kSlotStatsProp, std::move(value));
+  return rocksdb::Status::OK();
+}
+
+void SlotStatsCollector::Encode(const std::map<uint16_t, Stats> &stats, std::string *dst) {
+  for (const auto &[slot, slot_stats] : stats) {
+    PutFixed16(dst, slot);
+    PutFixed64(dst, slot_stats.put_keys);
+    PutFixed64(dst, slot_stats.deleted_keys);
+    PutFixed64(dst, slot_stats.bytes);
+  }
+}
+
+bool SlotStatsCollector::Decode(rocksdb::Slice input, std::map<uint16_t, Stats> *stats) {
+  while (!input.empty()) {
+    uint16_t slot = 0;
+    uint64_t put_keys = 0, deleted_keys = 0, bytes = 0;
+    if (!GetFixed16(&input, &slot) || !GetFixed64(&input, &put_keys) || !GetFixed64(&input, &deleted_keys) ||
+        !GetFixed64(&input, &bytes)) {
+      return false;
+    }
+    auto &slot_stats = (*stats)[slot];
+    slot_stats.put_keys += put_keys;
+    slot_stats.deleted_keys += deleted_keys;
+    slot_stats.bytes += bytes;
+  }
+  return true;
+}
+
+bool SlotStatsCollector::HasSlotInRange(rocksdb::Slice input, uint16_t start, uint16_t end) {
+  // the entries are encoded in the order of the slots, and each one is 26 bytes
+  constexpr size_t kEntrySize = sizeof(uint16_t) + sizeof(uint64_t) * 3;
+  while (input.size() >= kEntrySize) {
+    uint16_t slot = 0;
+    GetFixed16(&input, &slot);
+    if (slot > end) return false;
+    if (slot >= start) return true;
+    input.remove_prefix(kEntrySize - sizeof(uint16_t));
+  }
+  return false;
+}
+
+rocksdb::TablePropertiesCollector *SlotStatsCollectorFactory::CreateTablePropertiesCollector(
+    [[maybe_unused]] rocksdb::TablePropertiesCollectorFactory::Context context) {
+  return new SlotStatsCollector(count_keys_);
+}
@@ -22,9 +22,19 @@
 
 #include <rocksdb/table_properties.h>
 
+#include <cstdint>
+#include <map>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
+
+// The properties of the metadata SST files used to approximate the key number without scanning,
+// deletes and overwrites of keys in other files are not known, so they're only estimations
+constexpr const char *kApproxKeysPropPrefix = "approx_keys_";
+constexpr const char *kApproxExpiredKeysProp = "approx_expired_keys";
+constexpr const char *kApproxDeletedKeysProp = "approx_deleted_keys";
+constexpr const char *kApproxSubKeysProp = "approx_sub_keys";
 
 class CompactOnExpiredCollector : public rocksdb::TablePropertiesCollector {
  public:
@@ -44,6 +54,11 @@ class CompactOnExpiredCollector : public rocksdb::TablePropertiesCollector {
   uint64_t deleted_keys_ = 0;
   std::string start_key_;
   std::string stop_key_;
+  // the live keys of every redis type in the metadata column family
+  std::vector<uint64_t> type_keys_;
+  uint64_t expired_keys_ = 0;
+  uint64_t deleted_metadata_keys_ = 0;
+  uint64_t sub_keys_ = 0;
 };
 
 class CompactOnExpiredTableCollectorFactory : public rocksdb::TablePropertiesCollectorFactory {
@@ -64,3 +79,45 @@ class CompactOnExpiredTableCollectorFactory : public rocksdb::TablePropertiesCol
 
 std::shared_ptr<CompactOnExpiredTableCollectorFactory> NewCompactOnExpiredTableCollectorFactory(
     const std::string &cf_name, float trigger_threshold);
+
+// The sizes of the slots in a SST file of the slot-id-encoded column families, i.e. a list of
+// the fixed16 slot id, the fixed64 number of the put and the deleted keys and the fixed64 bytes of
+// the entries of every slot in the file. Only the metadata column family counts the keys, and the
+// expired metadata count as deleted keys.
+constexpr const char *kSlotStatsProp = "slot_stats";
+
+class SlotStatsCollector : public rocksdb::TablePropertiesCollector {
+ public:
+  explicit SlotStatsCollector(bool count_keys) : count_keys_(count_keys) {}
+  const char *Name() const override { return "slot_stats_collector"; }
+  rocksdb::Status AddUserKey(const rocksdb::Slice &key, const rocksdb::Slice &value, rocksdb::EntryType entry_type,
+                             rocksdb::SequenceNumber, uint64_t) override;
+  rocksdb::Status Finish(rocksdb::UserCollectedProperties *properties) override;
+  rocksdb::UserCollectedProperties GetReadableProperties() const override { return {}; }
+
+  struct Stats {
+    uint64_t put_keys = 0;
+    uint64_t deleted_keys = 0;
+    uint64_t bytes = 0;
+  };
+  static void Encode(const std::map<uint16_t, Stats> &stats, std::string *dst);
+  // Decode adds the stats of the property to the stats of the slots
+  static bool Decode(rocksdb::Slice input, std::map<uint16_t, Stats> *stats);
+  // HasSlotInRange returns true if the property has any entry of the slots in [start, end]
+  static bool HasSlotInRange(rocksdb::Slice input, uint16_t start, uint16_t end);
+
+ private:
+  bool count_keys_;
+  std::map<uint16_t, Stats> stats_;
+};
+
+class SlotStatsCollectorFactory : public rocksdb::TablePropertiesCollectorFactory {
+ public:
+  explicit SlotStatsCollectorFactory(bool count_keys) : count_keys_(count_keys) {}
+  rocksdb::TablePropertiesCollector *CreateTablePropertiesCollector(
+      rocksdb::TablePropertiesCollectorFactory::Context context) override;
+  const char *Name() const override { return "SlotStatsCollector"; }
+
+ private:
+  bool count_keys_;
+};
@@ -0,0 +1,56 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+#include "tiered_cache_tuner.h"
+
+#include <algorithm>
+
+namespace engine {
+
+bool TieredCacheTuner::Tune(uint64_t hits, uint64_t misses, uint64_t secondary_hits) {
+  uint64_t lookups = hits + misses;
+  // The tickers are reset when the DB is reopened
+  if (lookups < last_lookups_ || secondary_hits < last_secondary_hits_) {
+    last_lookups_ = lookups;
+    last_secondary_hits_ = secondary_hits;
+    return false;
+  }
+
+  uint64_t period_lookups = lookups - last_lookups_;
+  if (period_lookups < kMinLookups) return false;
+
+  double secondary_hit_ratio =
+      static_cast<double>(secondary_hits - last_secondary_hits_) / static_cast<double>(period_lookups);
+  last_lookups_ = lookups;
+  last_secondary_hits_ = secondary_hits;
+
+  // A configured ratio out of the bounds is only moved towards them
+  double ratio = GetRatio();
+  if (secondary_hit_ratio < kLowSecondaryHitRatio && ratio > kMinRatio) {
+    ratio_ = std::max(kMinRatio, ratio - kStep);
+    return true;
+  }
+  if (secondary_hit_ratio > kHighSecondaryHitRatio && ratio < kMaxRatio) {
+    ratio_ = std::min(kMaxRatio, ratio + kStep);
+    return true;
+  }
+  return false;
+}
+
+}  // namespace engine
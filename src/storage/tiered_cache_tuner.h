@@ -0,0 +1,54 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace engine {
+
+// TieredCacheTuner moves capacity between the block cache and the compressed secondary cache
+// of a tiered block cache, keeping the total budget fixed. It adjusts the secondary cache ratio
+// by a bounded step per period, based on the share of the block lookups of the period served
+// by the secondary cache; between the two thresholds the ratio is kept as is.
+class TieredCacheTuner {
+ public:
+  static constexpr double kMinRatio = 0.05;
+  static constexpr double kMaxRatio = 0.5;
+  static constexpr double kStep = 0.05;
+  // The secondary cache is shrunk below the low threshold and grown above the high one
+  static constexpr double kLowSecondaryHitRatio = 0.01;
+  static constexpr double kHighSecondaryHitRatio = 0.05;
+  // Periods with fewer lookups than this are too noisy to act on
+  static constexpr uint64_t kMinLookups = 10000;
+
+  explicit TieredCacheTuner(double ratio) : ratio_(ratio) {}
+
+  // Tune takes the cumulative block cache tickers, and returns true if the secondary cache ratio is changed
+  bool Tune(uint64_t hits, uint64_t misses, uint64_t secondary_hits);
+  double GetRatio() const { return ratio_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<double> ratio_;
+  uint64_t last_lookups_ = 0;
+  uint64_t last_secondary_hits_ = 0;
+};
+
+}  // namespace engine
@@ -0,0 +1,142 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "ttl_index.h"
+
+#include <rocksdb/env.h>
+#include <rocksdb/rate_limiter.h>
+
+#include <algorithm>
+
+#include "db_util.h"
+#include "encoding.h"
+#include "redis_db.h"
+#include "redis_metadata.h"
+#include "time_util.h"
+#include "types/redis_hash.h"
+
+namespace engine {
+
+std::string ComposeTTLIndexKey(uint64_t expire, const rocksdb::Slice &ns_key) {
+  std::string key;
+  key.reserve(sizeof(expire) + ns_key.size());
+  PutFixed64(&key, expire);
+  key.append(ns_key.data(), ns_key.size());
+  return key;
+}
+
+bool ParseTTLIndexKey(rocksdb::Slice key, uint64_t *expire, rocksdb::Slice *ns_key) {
+  if (!GetFixed64(&key, expire)) return false;
+  *ns_key = key;
+  return true;
+}
+
+StatusOr<uint64_t> ExpiredKeyReaper::Reap(uint64_t limit) {
+  auto ctx = engine::Context::NoTransactionContext(storage_);
+
+  // Only the entries expired by now, the index is ordered by the expire time
+  std::string upper_bound_key;
+  PutFixed64(&upper_bound_key, util::GetTimeStampMS());
+  rocksdb::Slice upper_bound(upper_bound_key);
+  rocksdb::ReadOptions read_options = storage_->DefaultScanOptions();
+  read_options.iterate_upper_bound = &upper_bound;
+
+  uint64_t reaped = 0;
+  auto iter = util::UniqueIterator(ctx, read_options, ColumnFamilyID::TTLIndex);
+  for (iter->SeekToFirst(); iter->Valid() && limit > 0; iter->Next(), limit--) {
+    uint64_t expire = 0, version = 0;
+    rocksdb::Slice ns_key, value = iter->value();
+    if (!ParseTTLIndexKey(iter->key(), &expire, &ns_key) || !GetFixed64(&value, &version)) {
+      return {Status::NotOK, "malformed TTL index entry"};
+    }
+
+    if (value.size() == 1 && value[0] == kTTLIndexHashFieldsTag) {
+      // the expired fields count against the limit instead of the entry
+      uint64_t fields = GET_OR_RET(reapHashFields(ctx, iter->key(), ns_key, version, limit));
+      limit -= std::min(limit, fields > 0 ? fields - 1 : 0);
+      continue;
+    }
+
+    auto deleted = GET_OR_RET(reapKey(ctx, iter->key(), ns_key, expire, version));
+    if (deleted) reaped++;
+  }
+  if (auto s = iter->status(); !s.ok()) return {Status::NotOK, s.ToString()};
+
+  return reaped;
+}
+
+StatusOr<uint64_t> ExpiredKeyReaper::reapHashFields(engine::Context &ctx, const rocksdb::Slice &index_key,
+                                                    const rocksdb::Slice &ns_key, uint64_t version, uint64_t limit) {
+  auto ns = std::get<0>(ExtractNamespaceKey<std::string>(ns_key, storage_->IsSlotIdEncoded()));
+
+  uint64_t reaped = 0;
+  bool done = false;
+  auto s = redis::Hash(storage_, ns).ReapExpiredFields(ctx, ns_key, version, limit, &reaped, &done);
+  if (!s.ok()) return {Status::NotOK, s.ToString()};
+
+  // the entry is kept until all the fields expired by its time are gone
+  if (done) {
+    s = storage_->Delete(ctx, storage_->DefaultWriteOptions(), storage_->GetCFHandle(ColumnFamilyID::TTLIndex),
+                         index_key);
+    if (!s.ok()) return {Status::NotOK, s.ToString()};
+  }
+  return reaped;
+}
+
+StatusOr<bool> ExpiredKeyReaper::reapKey(engine::Context &ctx, const rocksdb::Slice &index_key,
+                                         const rocksdb::Slice &ns_key, uint64_t expire, uint64_t version) {
+  auto batch = storage_->GetWriteBatchBase();
+  redis::WriteBatchLogData log_data(kRedisNone);
+  auto s = batch->PutLogData(log_data.Encode());
+  if (!s.ok()) return {Status::NotOK, s.ToString()};
+
+  // The key may be written concurrently, e.g. its TTL may be removed
+  LockGuard guard(storage_->GetLockManager(), ns_key.ToStringView());
+  std::string bytes;
+  s = storage_->Get(ctx, ctx.GetReadOptions(), storage_->GetCFHandle(ColumnFamilyID::Metadata), ns_key, &bytes);
+  if (!s.ok() && !s.IsNotFound()) return {Status::NotOK, s.ToString()};
+
+  bool deleted = false;
+  Metadata metadata(kRedisNone, false);
+  if (s.ok() && metadata.Decode(bytes).ok() && metadata.expire == expire && metadata.Expired() &&
+      (metadata.IsSingleKVType() || metadata.version == version)) {
+    s = batch->Delete(storage_->GetCFHandle(ColumnFamilyID::Metadata), ns_key);
+    if (!s.ok()) return {Status::NotOK, s.ToString()};
+
+    if (!metadata.IsSingleKVType()) {
+      s = storage_->DeleteSubKeys(batch.Get(), metadata.Type(), ns_key, version);
+      if (!s.ok()) return {Status::NotOK, s.ToString()};
+    }
+    deleted = true;
+  }
+  s = batch->Delete(storage_->GetCFHandle(ColumnFamilyID::TTLIndex), index_key);
+  if (!s.ok()) return {Status::NotOK, s.ToString()};
+
+  auto write_batch = batch->GetWriteBatch();
+  if (auto rate_limiter = storage_->GetIORateLimiter()) {
+    rate_limiter->Request(static_cast<int64_t>(write_batch->GetDataSize()), rocksdb::Env::IOPriority::IO_LOW,
+                          nullptr);
+  }
+  s = storage_->Write(ctx, storage_->DefaultWriteOptions(), write_batch);
+  if (!s.ok()) return {Status::NotOK, s.ToString()};
+  return deleted;
+}
+
+}  // namespace engine
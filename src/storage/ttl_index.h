@@ -0,0 +1,64 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <rocksdb/slice.h>
+
+#include <cstdint>
+#include <string>
+
+#include "status.h"
+#include "storage.h"
+
+namespace engine {
+
+// The keys of the TTL index column family are <expire (8)> | <ns_key>, ordered by
+// the expire time in milliseconds. The value is the version of the metadata
+// (0 for strings), which tells apart the entries of an old and a new key with the same name.
+std::string ComposeTTLIndexKey(uint64_t expire, const rocksdb::Slice &ns_key);
+// An entry whose value is followed by this tag marks a field of the hash expiring at the time, the reaper
+// deletes the expired fields of the hash instead of the key, see Hash::ExpireFields
+constexpr char kTTLIndexHashFieldsTag = 'f';
+bool ParseTTLIndexKey(rocksdb::Slice key, uint64_t *expire, rocksdb::Slice *ns_key);
+
+// ExpiredKeyReaper walks the TTL index up to the current time, deleting the
+// expired keys with their subkeys, and the index entries.
+class ExpiredKeyReaper {
+ public:
+  explicit ExpiredKeyReaper(Storage *storage) : storage_(storage) {}
+
+  // Reap deletes at most `limit` expired keys and returns the number of deleted keys
+  StatusOr<uint64_t> Reap(uint64_t limit);
+
+ private:
+  // reapHashFields deletes at most `limit` expired fields of the hash, the index entry is deleted once
+  // there's no expired field left, and returns the number of deleted fields
+  StatusOr<uint64_t> reapHashFields(engine::Context &ctx, const rocksdb::Slice &index_key,
+                                    const rocksdb::Slice &ns_key, uint64_t version, uint64_t limit);
+  // reapKey deletes the key if its metadata still matches the index entry,
+  // the index entry is deleted in any case
+  StatusOr<bool> reapKey(engine::Context &ctx, const rocksdb::Slice &index_key, const rocksdb::Slice &ns_key,
+                         uint64_t expire, uint64_t version);
+
+  Storage *storage_;
+};
+
+}  // namespace engine
@@ -20,6 +20,12 @@
 #include <cstdint>
 #include <memory>
 
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 #include "xxh3.h"
 
 OwnedBlockSplitBloomFilter CreateBlockSplitBloomFilter(uint32_t num_bytes) {
@@ -58,31 +64,105 @@ StatusOr<BlockSplitBloomFilter> CreateBlockSplitBloomFilter(std::string& bitset)
   return BlockSplitBloomFilter(bitset);
 }
 
-bool BlockSplitBloomFilter::FindHash(uint64_t hash) const {
-  const auto bucket_index = static_cast<uint32_t>(((hash >> 32) * (data_.size() / kBytesPerFilterBlock)) >> 32);
-  const auto key = static_cast<uint32_t>(hash);
-  const auto* bitset32 = reinterpret_cast<const uint32_t*>(data_.data());
+namespace {
 
-  for (int i = 0; i < kBitsSetPerBlock; ++i) {
+bool FindInBlockScalar(const uint32_t* block, uint32_t key, const uint32_t* salt) {
+  for (int i = 0; i < 8; ++i) {
     // Calculate mask for key in the given bitset.
-    const uint32_t mask = UINT32_C(0x1) << ((key * SALT[i]) >> 27);
-    if ((0 == (bitset32[kBitsSetPerBlock * bucket_index + i] & mask))) {
+    const uint32_t mask = UINT32_C(0x1) << ((key * salt[i]) >> 27);
+    if ((0 == (block[i] & mask))) {
       return false;
     }
   }
   return true;
 }
 
-void BlockSplitBloomFilter::InsertHash(uint64_t hash) {
-  const auto bucket_index = static_cast<uint32_t>(((hash >> 32) * (data_.size() / kBytesPerFilterBlock)) >> 32);
-  const auto key = static_cast<uint32_t>(hash);
-  auto* bitset32 = reinterpret_cast<uint32_t*>(data_.data());
-
-  for (int i = 0; i < kBitsSetPerBlock; i++) {
+void InsertInBlockScalar(uint32_t* block, uint32_t key, const uint32_t* salt) {
+  for (int i = 0; i < 8; i++) {
     // Calculate mask for key in the given bitset.
-    const uint32_t mask = UINT32_C(0x1) << ((key * SALT[i]) >> 27);
-    bitset32[bucket_index * kBitsSetPerBlock + i] |= mask;
+    const uint32_t mask = UINT32_C(0x1) << ((key * salt[i]) >> 27);
+    block[i] |= mask;
   }
 }
 
+#if defined(__x86_64__)
+
+__attribute__((target("avx2"))) __m256i BlockMaskAVX2(uint32_t key, const uint32_t* salt) {
+  __m256i shifts = _mm256_mullo_epi32(_mm256_set1_epi32(static_cast<int>(key)),
+                                      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(salt)));
+  shifts = _mm256_srli_epi32(shifts, 27);
+  return _mm256_sllv_epi32(_mm256_set1_epi32(1), shifts);
+}
+
+__attribute__((target("avx2"))) bool FindInBlockAVX2(const uint32_t* block, uint32_t key, const uint32_t* salt) {
+  // testc is set when every bit of the mask is also set in the block
+  return _mm256_testc_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(block)), BlockMaskAVX2(key, salt));
+}
+
+__attribute__((target("avx2"))) void InsertInBlockAVX2(uint32_t* block, uint32_t key, const uint32_t* salt) {
+  auto* p = reinterpret_cast<__m256i*>(block);
+  _mm256_storeu_si256(p, _mm256_or_si256(_mm256_loadu_si256(p), BlockMaskAVX2(key, salt)));
+}
+
+#elif defined(__aarch64__)
+
+inline uint32x4_t BlockMaskNEON(uint32_t key, const uint32_t* salt) {
+  uint32x4_t shifts = vshrq_n_u32(vmulq_u32(vdupq_n_u32(key), vld1q_u32(salt)), 27);
+  return vshlq_u32(vdupq_n_u32(1), vreinterpretq_s32_u32(shifts));
+}
+
+bool FindInBlockNEON(const uint32_t* block, uint32_t key, const uint32_t* salt) {
+  uint32x4_t lo = BlockMaskNEON(key, salt), hi = BlockMaskNEON(key, salt + 4);
+  uint32x4_t found = vandq_u32(vceqq_u32(vandq_u32(vld1q_u32(block), lo), lo),
+                               vceqq_u32(vandq_u32(vld1q_u32(block + 4), hi), hi));
+  return vminvq_u32(found) != 0;
+}
+
+void InsertInBlockNEON(uint32_t* block, uint32_t key, const uint32_t* salt) {
+  vst1q_u32(block, vorrq_u32(vld1q_u32(block), BlockMaskNEON(key, salt)));
+  vst1q_u32(block + 4, vorrq_u32(vld1q_u32(block + 4), BlockMaskNEON(key, salt + 4)));
+}
+
+#endif
+
+struct BlockKernels {
+  bool (*find)(const uint32_t*, uint32_t, const uint32_t*);
+  void (*insert)(uint32_t*, uint32_t, const uint32_t*);
+};
+
+BlockKernels DetectBlockKernels() {
+#if defined(__x86_64__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return {FindInBlockAVX2, InsertInBlockAVX2};
+#elif defined(__aarch64__)
+  return {FindInBlockNEON, InsertInBlockNEON};
+#endif
+  return {FindInBlockScalar, InsertInBlockScalar};
+}
+
+const BlockKernels& GetBlockKernels() {
+  static const BlockKernels kernels = DetectBlockKernels();
+  return kernels;
+}
+
+}  // namespace
+
+bool BlockSplitBloomFilter::findInBlock(const uint32_t* block, uint32_t key) {
+  return GetBlockKernels().find(block, key, SALT);
+}
+
+void BlockSplitBloomFilter::insertInBlock(uint32_t* block, uint32_t key) {
+  GetBlockKernels().insert(block, key, SALT);
+}
+
+bool BlockSplitBloomFilter::FindHash(uint64_t hash) const {
+  const auto* bitset32 = reinterpret_cast<const uint32_t*>(data_.data());
+  return findInBlock(bitset32 + kBitsSetPerBlock * BlockIndex(hash), static_cast<uint32_t>(hash));
+}
+
+void BlockSplitBloomFilter::InsertHash(uint64_t hash) {
+  auto* bitset32 = reinterpret_cast<uint32_t*>(data_.data());
+  insertInBlock(bitset32 + kBitsSetPerBlock * BlockIndex(hash), static_cast<uint32_t>(hash));
+}
+
 uint64_t BlockSplitBloomFilter::Hash(const char* data, size_t length) { return XXH64(data, length, /*seed=*/0); }
@@ -156,6 +156,15 @@ class BlockSplitBloomFilter {
   /// @param hash the hash of value to insert into Bloom filter.
   void InsertHash(uint64_t hash);
 
+  /// Get the index of the tiny Bloom filter block which the hash falls into, so the
+  /// probes of many hashes can be ordered by block to walk the bitset once.
+  ///
+  /// @param hash the hash of value.
+  /// @return the block index within [0, GetBitsetSize() / 32).
+  uint32_t BlockIndex(uint64_t hash) const {
+    return static_cast<uint32_t>(((hash >> 32) * (data_.size() / kBytesPerFilterBlock)) >> 32);
+  }
+
   uint32_t GetBitsetSize() const { return data_.size(); }
 
   /// Get the plain bitset value from the Bloom filter bitset.
@@ -182,6 +191,11 @@ class BlockSplitBloomFilter {
   static constexpr uint32_t SALT[kBitsSetPerBlock] = {0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
                                                       0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
 
+  // Check or set the kBitsSetPerBlock bits of the key in one block. The eight 32-bit
+  // words of a block are done at once with AVX2 or NEON when the CPU supports it.
+  static bool findInBlock(const uint32_t* block, uint32_t key);
+  static void insertInBlock(uint32_t* block, uint32_t key);
+
   // The underlying buffer of bitset.
   nonstd::span<char> data_;
 };
@@ -39,6 +39,8 @@
 
 #include <math.h>
 
+#include <algorithm>
+
 constexpr double D_R = M_PI / 180.0;
 
 // @brief The usual PI/180 constant
@@ -436,6 +438,133 @@ GeoHashRadius GeoHashHelper::GetAreasByShapeWGS84(GeoShape &geo_shape) {
   return radius;
 }
 
+enum GeoAreaOverlap { kGeoAreaOutside, kGeoAreaPartial, kGeoAreaInside };
+
+/* The relative error of the distances, the boxes are only excluded or taken
+ * as a whole when they are beyond it, so no member is missed by rounding. */
+constexpr double GEO_DISTANCE_SLACK = 1e-6;
+
+/* Only the circles smaller than a quarter of the meridian can have all the
+ * points of a box within them when its corners are. */
+constexpr double GEO_INSIDE_MAX_RADIUS = 1e7;
+
+static GeoAreaOverlap GetAreaOverlap(const GeoShape &geo_shape, const GeoHashArea &area) {
+  if (geo_shape.type == kGeoShapeTypeRectangular) {
+    /* Same as GetDistanceIfInBox(), the bounds don't wrap around the 180th meridian. */
+    const double *bounds = geo_shape.bounds;
+    if (area.longitude.max < bounds[0] || area.longitude.min > bounds[2] || area.latitude.max < bounds[1] ||
+        area.latitude.min > bounds[3]) {
+      return kGeoAreaOutside;
+    }
+    if (area.longitude.min >= bounds[0] && area.longitude.max <= bounds[2] && area.latitude.min >= bounds[1] &&
+        area.latitude.max <= bounds[3]) {
+      return kGeoAreaInside;
+    }
+    return kGeoAreaPartial;
+  }
+
+  double lon = geo_shape.xy[0];
+  double lat = geo_shape.xy[1];
+  double radius = geo_shape.radius * geo_shape.conversion;
+  if (GeoHashHelper::GetMinDistanceToArea(lon, lat, area) > radius * (1 + GEO_DISTANCE_SLACK)) {
+    return kGeoAreaOutside;
+  }
+  if (radius > GEO_INSIDE_MAX_RADIUS) return kGeoAreaPartial;
+  /* The distance has no maximum inside the box, so it's the largest at one of the corners. */
+  for (double corner_lon : {area.longitude.min, area.longitude.max}) {
+    for (double corner_lat : {area.latitude.min, area.latitude.max}) {
+      if (GeoHashHelper::GetDistance(lon, lat, corner_lon, corner_lat) > radius * (1 - GEO_DISTANCE_SLACK)) {
+        return kGeoAreaPartial;
+      }
+    }
+  }
+  return kGeoAreaInside;
+}
+
+/* Cover the search area with the geohash boxes and return the sorted score
+ * ranges of them. It starts from the 9 boxes of GetAreasByShapeWGS84(), then
+ * every box crossing the border of the shape is split into its 4 children,
+ * and the children outside of the shape are dropped, as long as the cover has
+ * at most 'max_boxes' boxes. The boxes inside the shape are kept as they are,
+ * so the cover mixes the precisions, and the adjacent boxes are merged into
+ * one range at the end. */
+std::vector<GeoHashScoreRange> GeoHashHelper::GetRangesByShapeWGS84(GeoShape &geo_shape, size_t max_boxes) {
+  struct CoverBox {
+    GeoHashBits hash;
+    bool inside;
+  };
+
+  GeoHashRadius n = GetAreasByShapeWGS84(geo_shape);
+  GeoHashRange long_range, lat_range;
+  GeohashGetCoordRange(&long_range, &lat_range);
+
+  GeoHashBits neighbors[9] = {n.hash,
+                              n.neighbors.north,
+                              n.neighbors.south,
+                              n.neighbors.east,
+                              n.neighbors.west,
+                              n.neighbors.north_east,
+                              n.neighbors.north_west,
+                              n.neighbors.south_east,
+                              n.neighbors.south_west};
+  std::vector<CoverBox> boxes;
+  for (const auto &hash : neighbors) {
+    if (HASHISZERO(hash)) continue;
+    /* With a huge radius, the neighbors can be the same box. */
+    bool duplicated = false;
+    for (const auto &box : boxes) {
+      if (box.hash.bits == hash.bits && box.hash.step == hash.step) duplicated = true;
+    }
+    if (duplicated) continue;
+
+    GeoHashArea area;
+    GeohashDecode(long_range, lat_range, hash, &area);
+    GeoAreaOverlap overlap = GetAreaOverlap(geo_shape, area);
+    if (overlap != kGeoAreaOutside) boxes.push_back(CoverBox{hash, overlap == kGeoAreaInside});
+  }
+
+  while (true) {
+    std::vector<CoverBox> refined;
+    bool split = false;
+    for (const auto &box : boxes) {
+      if (box.inside || box.hash.step >= GEO_STEP_MAX) {
+        refined.push_back(box);
+        continue;
+      }
+      split = true;
+      for (uint64_t child = 0; child < 4; child++) {
+        GeoHashBits hash{(box.hash.bits << 2) | child, static_cast<uint8_t>(box.hash.step + 1)};
+        GeoHashArea area;
+        GeohashDecode(long_range, lat_range, hash, &area);
+        GeoAreaOverlap overlap = GetAreaOverlap(geo_shape, area);
+        if (overlap != kGeoAreaOutside) refined.push_back(CoverBox{hash, overlap == kGeoAreaInside});
+      }
+    }
+    if (!split || refined.size() > max_boxes) break;
+    boxes = std::move(refined);
+  }
+
+  std::vector<GeoHashScoreRange> ranges;
+  ranges.reserve(boxes.size());
+  for (const auto &box : boxes) {
+    GeoHashBits next = box.hash;
+    next.bits++;
+    ranges.push_back(GeoHashScoreRange{Align52Bits(box.hash), Align52Bits(next)});
+  }
+  std::sort(ranges.begin(), ranges.end(),
+            [](const GeoHashScoreRange &a, const GeoHashScoreRange &b) { return a.min < b.min; });
+
+  std::vector<GeoHashScoreRange> merged;
+  for (const auto &range : ranges) {
+    if (!merged.empty() && merged.back().max >= range.min) {
+      merged.back().max = std::max(merged.back().max, range.max);
+    } else {
+      merged.push_back(range);
+    }
+  }
+  return merged;
+}
+
 GeoHashFix52Bits GeoHashHelper::Align52Bits(const GeoHashBits &hash) {
   uint64_t bits = hash.bits;
   bits <<= (52 - hash.step * 2);
@@ -454,6 +583,39 @@ double GeoHashHelper::GetDistance(double lon1d, double lat1d, double lon2d, doub
   return 2.0 * EARTH_RADIUS_IN_METERS * asin(sqrt(u * u + cos(lat1r) * cos(lat2r) * v * v));
 }
 
+/* Return the distance from the point to the nearest point of the box, 0 if the
+ * point is inside of it. */
+double GeoHashHelper::GetMinDistanceToArea(double lon, double lat, const GeoHashArea &area) {
+  /* Take the copy of the longitude nearest to the box. */
+  double center_lon = (area.longitude.min + area.longitude.max) / 2;
+  while (lon - center_lon > 180) lon -= 360;
+  while (lon - center_lon < -180) lon += 360;
+
+  bool lon_inside = lon >= area.longitude.min && lon <= area.longitude.max;
+  bool lat_inside = lat >= area.latitude.min && lat <= area.latitude.max;
+  if (lon_inside && lat_inside) return 0;
+
+  /* On a parallel, the distance grows with the difference of the longitudes. */
+  double nearest_lon = std::clamp(lon, area.longitude.min, area.longitude.max);
+  double distance = std::min(GetDistance(lon, lat, nearest_lon, area.latitude.min),
+                             GetDistance(lon, lat, nearest_lon, area.latitude.max));
+
+  /* On a meridian, the distance is the smallest at atan(tan(lat) / cos(delta_lon)),
+   * or at the nearest pole if the meridian is more than 90 degrees away. */
+  for (double edge_lon : {area.longitude.min, area.longitude.max}) {
+    double cos_delta_lon = cos(DegRad(edge_lon - lon));
+    double nearest_lat = NAN;
+    if (cos_delta_lon > 0) {
+      nearest_lat = RadDeg(atan(tan(DegRad(lat)) / cos_delta_lon));
+    } else {
+      nearest_lat = lat >= 0 ? 90 : -90;
+    }
+    nearest_lat = std::clamp(nearest_lat, area.latitude.min, area.latitude.max);
+    distance = std::min(distance, GetDistance(lon, lat, edge_lon, nearest_lat));
+  }
+  return distance;
+}
+
 int GeoHashHelper::GetDistanceIfInRadius(double x1, double y1, double x2, double y2, double radius, double *distance) {
   *distance = GetDistance(x1, y1, x2, y2);
   if (*distance > radius) return 0;
@@ -40,6 +40,8 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <vector>
+
 constexpr uint8_t GEO_STEP_MAX = 26; /* 26*2 = 52 bits. */
 
 /* Limits from EPSG:900913 / EPSG:3785 / OSGEO:41001 */
@@ -96,6 +98,12 @@ struct GeoHashRadius {
   GeoHashNeighbors neighbors;
 };
 
+/* The scores [min, max) of the members of one or more adjacent geohash boxes. */
+struct GeoHashScoreRange {
+  GeoHashFix52Bits min;
+  GeoHashFix52Bits max;
+};
+
 struct GeoShape {
   GeoShapeType type;
   double xy[2];
@@ -136,6 +144,8 @@ class GeoHashHelper {
   static uint8_t EstimateStepsByRadius(double range_meters, double lat);
   static int BoundingBox(GeoShape *geo_shape);
   static GeoHashRadius GetAreasByShapeWGS84(GeoShape &geo_shape);
+  static std::vector<GeoHashScoreRange> GetRangesByShapeWGS84(GeoShape &geo_shape, size_t max_boxes);
+  static double GetMinDistanceToArea(double lon, double lat, const GeoHashArea &area);
   static GeoHashFix52Bits Align52Bits(const GeoHashBits &hash);
   static double GetDistance(double lon1d, double lat1d, double lon2d, double lat2d);
   static int GetDistanceIfInRadius(double x1, double y1, double x2, double y2, double radius, double *distance);
@@ -53,6 +53,7 @@
 
 #include "hyperloglog.h"
 
+#include "common/bit_util.h"
 #include "vendor/murmurhash2.h"
 
 uint8_t HllDenseGetRegister(const uint8_t *registers, uint32_t register_index) {
@@ -157,31 +158,32 @@ void HllDenseRegHisto(nonstd::span<const uint8_t> registers, int *reghisto) {
   }
 }
 
-void HllMerge(std::vector<std::string> *dest_registers, const std::vector<nonstd::span<const uint8_t>> &registers) {
-  for (size_t segment_id = 0; segment_id < kHyperLogLogSegmentCount; segment_id++) {
-    std::string *dest_segment = &dest_registers->at(segment_id);
-    nonstd::span<const uint8_t> src_segment = registers[segment_id];
-    if (src_segment.empty()) {
-      continue;
-    }
-    if (dest_segment->empty()) {
-      DCHECK_EQ(kHyperLogLogSegmentBytes, src_segment.size());
-      *dest_segment = std::string(src_segment.begin(), src_segment.end());
-      continue;
-    }
-    // Do physical merge for this segment.
-    // NOLINTNEXTLINE
-    uint8_t *dest_segment_data = reinterpret_cast<uint8_t *>(dest_segment->data());
-    for (size_t register_idx = 0; register_idx < kHyperLogLogSegmentRegisters; register_idx++) {
-      uint8_t val = HllDenseGetRegister(src_segment.data(), register_idx);
-      uint8_t previous_val = HllDenseGetRegister(dest_segment_data, register_idx);
-      if (val > previous_val) {
-        HllDenseSetRegister(dest_segment_data, register_idx, val);
-      }
-    }
+void HllDenseUnpackSegment(const uint8_t *segment, uint8_t *registers) {
+  // Every 3 bytes hold 4 registers of 6 bits
+  for (size_t j = 0; j < kHyperLogLogSegmentRegisters / 4; j++, segment += 3, registers += 4) {
+    registers[0] = segment[0] & kHyperLogLogRegisterMax;
+    registers[1] = (segment[0] >> 6 | segment[1] << 2) & kHyperLogLogRegisterMax;
+    registers[2] = (segment[1] >> 4 | segment[2] << 4) & kHyperLogLogRegisterMax;
+    registers[3] = segment[2] >> 2;
   }
 }
 
+void HllDensePackSegment(const uint8_t *registers, uint8_t *segment) {
+  for (size_t j = 0; j < kHyperLogLogSegmentRegisters / 4; j++, segment += 3, registers += 4) {
+    segment[0] = static_cast<uint8_t>(registers[0] | registers[1] << 6);
+    segment[1] = static_cast<uint8_t>(registers[1] >> 2 | registers[2] << 4);
+    segment[2] = static_cast<uint8_t>(registers[2] >> 4 | registers[3] << 2);
+  }
+}
+
+void HllMergeUnpacked(uint8_t *dest_registers, nonstd::span<const uint8_t> segment) {
+  if (segment.empty()) return;
+  DCHECK_EQ(kHyperLogLogSegmentBytes, segment.size());
+  uint8_t registers[kHyperLogLogSegmentRegisters];
+  HllDenseUnpackSegment(segment.data(), registers);
+  util::simd::MaxBytes(dest_registers, registers, kHyperLogLogSegmentRegisters);
+}
+
 /* ========================= HyperLogLog Count ==============================
  * This is the core of the algorithm where the approximated count is computed.
  * The function uses the lower level HllDenseRegHisto()
@@ -223,10 +225,22 @@ double HllTau(double x) {
 }
 
 /* Return the approximated cardinality of the set based on the harmonic
- * mean of the registers values. */
-uint64_t HllDenseEstimate(const std::vector<nonstd::span<const uint8_t>> &registers) {
+ * mean of the registers values, which is summed from their histogram. */
+static uint64_t HllEstimateFromHisto(const int *reghisto) {
   constexpr double m = kHyperLogLogRegisterCount;
-  int j = 0;
+  /* Estimate cardinality from register histogram. See:
+   * "New cardinality estimation algorithms for HyperLogLog sketches"
+   * Otmar Ertl, arXiv:1702.01284 */
+  double z = m * HllTau((m - reghisto[kHyperLogLogHashBitCount + 1]) / m);
+  for (int j = kHyperLogLogHashBitCount; j >= 1; --j) {
+    z += reghisto[j];
+    z *= 0.5;
+  }
+  z += m * HllSigma(reghisto[0] / m);
+  return static_cast<int64_t>(llroundl(kHyperLogLogAlpha * m * m / z));
+}
+
+uint64_t HllDenseEstimate(const std::vector<nonstd::span<const uint8_t>> &registers) {
   /* Note that reghisto size could be just kHyperLogLogHashBitCount+2, because kHyperLogLogHashBitCount+1 is
    * the maximum frequency of the "000...1" sequence the hash function is
    * able to return. However it is slow to check for sanity of the
@@ -243,15 +257,25 @@ uint64_t HllDenseEstimate(const std::vector<nonstd::span<const uint8_t>> &regist
       HllDenseRegHisto(r, reghisto);
     }
   }
+  return HllEstimateFromHisto(reghisto);
+}
 
-  /* Estimate cardinality from register histogram. See:
-   * "New cardinality estimation algorithms for HyperLogLog sketches"
-   * Otmar Ertl, arXiv:1702.01284 */
-  double z = m * HllTau((m - reghisto[kHyperLogLogHashBitCount + 1]) / m);
-  for (j = kHyperLogLogHashBitCount; j >= 1; --j) {
-    z += reghisto[j];
-    z *= 0.5;
+uint64_t HllUnpackedEstimate(const uint8_t *registers) {
+  // Count into a few histograms in turn, so the increments of the same bucket don't wait for each other
+  int reghisto[4][64] = {{0}};
+  for (uint32_t i = 0; i < kHyperLogLogRegisterCount; i += 4) {
+    reghisto[0][registers[i] & 63]++;
+    reghisto[1][registers[i + 1] & 63]++;
+    reghisto[2][registers[i + 2] & 63]++;
+    reghisto[3][registers[i + 3] & 63]++;
   }
-  z += m * HllSigma(reghisto[0] / m);
-  return static_cast<int64_t>(llroundl(kHyperLogLogAlpha * m * m / z));
+  for (int j = 0; j < 64; j++) reghisto[0][j] += reghisto[1][j] + reghisto[2][j] + reghisto[3][j];
+  return HllEstimateFromHisto(reghisto[0]);
+}
+
+uint64_t HllSparseEstimate(const std::vector<std::pair<uint16_t, uint8_t>> &registers) {
+  int reghisto[64] = {0};
+  reghisto[0] = static_cast<int>(kHyperLogLogRegisterCount - registers.size());
+  for (const auto &[_, value] : registers) reghisto[value & 63]++;
+  return HllEstimateFromHisto(reghisto);
 }
@@ -22,6 +22,7 @@
 
 #include <cstdint>
 #include <nonstd/span.hpp>
+#include <utility>
 #include <vector>
 
 #include "redis_bitmap.h"
@@ -45,6 +46,8 @@ constexpr uint32_t kHyperLogLogRegisterBytes = (kHyperLogLogRegisterCount * kHyp
 // Copied from redis
 // https://github.com/valkey-io/valkey/blob/14e09e981e0039edbf8c41a208a258c18624cbb7/src/hyperloglog.c#L472
 constexpr uint32_t kHyperLogLogHashSeed = 0xadc83b19;
+/* The sparse encoding is promoted to the dense one when it has more non-zero registers than this. */
+constexpr size_t kHyperLogLogSparseMaxRegisters = 512;
 
 struct DenseHllResult {
   uint32_t register_index;
@@ -72,7 +75,22 @@ void HllDenseSetRegister(uint8_t *registers, uint32_t register_index, uint8_t va
 uint64_t HllDenseEstimate(const std::vector<nonstd::span<const uint8_t>> &registers);
 
 /**
- * Merge by computing MAX(registers_max[i],registers[i]) the HyperLogLog 'registers'
- * with an array of uint8_t kHyperLogLogRegisterCount registers pointed by 'dest_registers'.
+ * Unpack the kHyperLogLogSegmentRegisters registers of a segment into one byte per register, and pack them back.
  */
-void HllMerge(std::vector<std::string> *dest_registers, const std::vector<nonstd::span<const uint8_t>> &registers);
+void HllDenseUnpackSegment(const uint8_t *segment, uint8_t *registers);
+void HllDensePackSegment(const uint8_t *registers, uint8_t *segment);
+
+/**
+ * Merge a segment into the unpacked registers of the same segment by MAX, the segment could be empty.
+ */
+void HllMergeUnpacked(uint8_t *dest_registers, nonstd::span<const uint8_t> segment);
+
+/**
+ * Estimate the cardinality from all the kHyperLogLogRegisterCount registers unpacked.
+ */
+uint64_t HllUnpackedEstimate(const uint8_t *registers);
+
+/**
+ * Estimate the cardinality from the (index, value) pairs of the non-zero registers in the sparse encoding.
+ */
+uint64_t HllSparseEstimate(const std::vector<std::pair<uint16_t, uint8_t>> &registers);
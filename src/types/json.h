@@ -233,7 +233,7 @@ struct JsonValue {
         JsonValue query_value(origin);
         if (format == JsonStorageFormat::JSON) {
           s = query_value.Dump(&buffer, max_nesting_depth);
-        } else if (format == JsonStorageFormat::CBOR) {
+        } else if (format == JsonStorageFormat::CBOR || format == JsonStorageFormat::Split) {
           s = query_value.DumpCBOR(&buffer, max_nesting_depth);
         }
         results.emplace_back(buffer.size());
@@ -0,0 +1,153 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "json_projection.h"
+
+#include <cctype>
+#include <jsoncons/json_cursor.hpp>
+#include <jsoncons/json_decoder.hpp>
+#include <jsoncons/json_visitor.hpp>
+#include <jsoncons_ext/cbor/cbor_cursor.hpp>
+
+namespace {
+
+bool IsIdentifierChar(char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; }
+
+// Skips the value at the current event of the cursor, the cursor stays at its last event
+template <typename Cursor>
+void SkipValue(Cursor &cursor) {
+  auto type = cursor.current().event_type();
+  if (type == jsoncons::staj_event_type::begin_object || type == jsoncons::staj_event_type::begin_array) {
+    jsoncons::default_json_visitor skipper;
+    cursor.read_to(skipper);
+  }
+}
+
+// Walks down the steps from the value at the current event of the cursor,
+// returns whether a value is matched and decodes it into `result`
+template <typename Cursor>
+bool Project(Cursor &cursor, const std::vector<JsonPathStep> &steps, jsoncons::json *result) {
+  for (const auto &step : steps) {
+    if (const auto *name = std::get_if<std::string>(&step)) {
+      if (cursor.current().event_type() != jsoncons::staj_event_type::begin_object) return false;
+
+      bool found = false;
+      for (cursor.next(); cursor.current().event_type() != jsoncons::staj_event_type::end_object; cursor.next()) {
+        bool matched = cursor.current().template get<std::string_view>() == *name;
+        cursor.next();
+        if (matched) {
+          found = true;
+          break;
+        }
+        SkipValue(cursor);
+      }
+      if (!found) return false;
+    } else {
+      auto index = std::get<size_t>(step);
+      if (cursor.current().event_type() != jsoncons::staj_event_type::begin_array) return false;
+
+      bool found = false;
+      size_t i = 0;
+      for (cursor.next(); cursor.current().event_type() != jsoncons::staj_event_type::end_array; cursor.next(), i++) {
+        if (i == index) {
+          found = true;
+          break;
+        }
+        SkipValue(cursor);
+      }
+      if (!found) return false;
+    }
+  }
+
+  jsoncons::json_decoder<jsoncons::json> decoder;
+  cursor.read_to(decoder);
+  *result = decoder.get_result();
+  return true;
+}
+
+}  // namespace
+
+std::optional<std::vector<JsonPathStep>> ParseDefiniteJsonPath(std::string_view path) {
+  if (path.empty() || path[0] != '$') return std::nullopt;
+
+  std::vector<JsonPathStep> steps;
+  size_t pos = 1;
+  while (pos < path.size()) {
+    if (path[pos] == '.') {
+      size_t end = pos + 1;
+      while (end < path.size() && IsIdentifierChar(path[end])) end++;
+      if (end == pos + 1 || std::isdigit(static_cast<unsigned char>(path[pos + 1]))) return std::nullopt;
+
+      // `length` is resolved to the size of arrays and strings by jsoncons
+      auto name = path.substr(pos + 1, end - pos - 1);
+      if (name == "length") return std::nullopt;
+
+      steps.emplace_back(std::string(name));
+      pos = end;
+    } else if (path[pos] == '[' && pos + 1 < path.size()) {
+      char quote = path[pos + 1];
+      if (quote == '\'' || quote == '"') {
+        auto end = path.find(quote, pos + 2);
+        if (end == std::string_view::npos || end + 1 >= path.size() || path[end + 1] != ']') return std::nullopt;
+
+        auto name = path.substr(pos + 2, end - pos - 2);
+        if (name.find('\\') != std::string_view::npos) return std::nullopt;
+
+        steps.emplace_back(std::string(name));
+        pos = end + 2;
+      } else {
+        size_t end = pos + 1;
+        while (end < path.size() && std::isdigit(static_cast<unsigned char>(path[end]))) end++;
+        if (end == pos + 1 || end - pos - 1 > 9 || end >= path.size() || path[end] != ']') return std::nullopt;
+
+        steps.emplace_back(static_cast<size_t>(std::stoul(std::string(path.substr(pos + 1, end - pos - 1)))));
+        pos = end + 1;
+      }
+    } else {
+      return std::nullopt;
+    }
+  }
+
+  return steps;
+}
+
+StatusOr<JsonValue> ProjectJsonPath(std::string_view bytes, JsonStorageFormat format,
+                                    const std::vector<JsonPathStep> &steps) {
+  jsoncons::json matched;
+  bool found = false;
+
+  try {
+    if (format == JsonStorageFormat::JSON) {
+      jsoncons::json_string_cursor cursor(bytes);
+      found = Project(cursor, steps, &matched);
+    } else if (format == JsonStorageFormat::CBOR) {
+      jsoncons::cbor::cbor_bytes_cursor cursor(bytes);
+      found = Project(cursor, steps, &matched);
+    } else {
+      return {Status::NotOK, "JSON storage format not supported"};
+    }
+  } catch (const std::exception &e) {
+    return {Status::NotOK, e.what()};
+  }
+
+  jsoncons::json result(jsoncons::json_array_arg);
+  if (found) result.emplace_back(std::move(matched));
+  return JsonValue(std::move(result));
+}
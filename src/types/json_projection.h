@@ -0,0 +1,45 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "json.h"
+#include "status.h"
+#include "storage/redis_metadata.h"
+
+// A selector of a definite JSONPath, either the name of an object member or the index of an array element
+using JsonPathStep = std::variant<std::string, size_t>;
+
+// Parses a definite JSONPath made of member and index selectors only, e.g. `$.a['b'][0]`.
+// Other paths (wildcards, slices, unions, filters, recursive descent, negative indexes)
+// may match more than one value and need the whole document to be evaluated, so nullopt is returned.
+std::optional<std::vector<JsonPathStep>> ParseDefiniteJsonPath(std::string_view path);
+
+// Evaluates a definite JSONPath on an encoded document while decoding it with a cursor:
+// only the matched value is materialized and all other subtrees are skipped.
+// The result has the same shape as `JsonValue::Get`, i.e. an array of the matched value or an empty array.
+StatusOr<JsonValue> ProjectJsonPath(std::string_view bytes, JsonStorageFormat format,
+                                    const std::vector<JsonPathStep> &steps);
@@ -20,15 +20,21 @@
 
 #include "redis_bitmap.h"
 
+#include <glog/logging.h>
+
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <future>
 #include <memory>
 #include <utility>
 #include <vector>
 
 #include "common/bit_util.h"
+#include "common/task_runner.h"
 #include "db_util.h"
 #include "parse_util.h"
+#include "redis_bitmap_container.h"
 #include "redis_bitmap_string.h"
 
 namespace redis {
@@ -36,6 +42,11 @@ namespace redis {
 constexpr uint32_t kBitmapSegmentBits = 1024 * 8;
 constexpr uint32_t kBitmapSegmentBytes = 1024;
 
+// BITOP reads and computes the segments in windows, and computes a window by a few threads once it's large enough
+constexpr size_t kBitOpWindowSegments = 1024;
+constexpr size_t kBitOpParallelSegments = 64;
+constexpr size_t kBitOpConcurrency = 4;
+
 constexpr char kErrBitmapStringOutOfRange[] =
     "The size of the bitmap string exceeds the "
     "configuration item max-bitmap-to-string-mb";
@@ -101,7 +112,53 @@ rocksdb::Status Bitmap::GetMetadata(engine::Context &ctx, const Slice &ns_key, B
   if (!s.ok()) return s;
 
   Slice slice = *raw_value;
-  return ParseMetadata({kRedisBitmap, kRedisString}, &slice, metadata);
+  s = ParseMetadata({kRedisBitmap, kRedisString}, &slice, metadata);
+  if (!s.ok()) return s;
+  // the bit operations on strings work on the value in the metadata
+  if (metadata->Type() == kRedisString && metadata->IsSplit()) {
+    return rocksdb::Status::NotSupported("bit operations on chunked strings are not supported");
+  }
+  return rocksdb::Status::OK();
+}
+
+// The bitmaps created while bitmap-roaring-encoding is enabled are roaring encoded
+void Bitmap::initEncoding(BitmapMetadata *metadata) const {
+  metadata->encoding = storage_->GetConfig()->bitmap_roaring_encoding ? BitmapEncoding::ROARING : BitmapEncoding::RAW;
+}
+
+rocksdb::Status Bitmap::decodeSegment(const BitmapMetadata &metadata, uint32_t segment_offset, std::string *value) {
+  if (!metadata.IsRoaring()) return rocksdb::Status::OK();
+
+  // Pad the raw bytes to the size of the bitmap like the raw segments, which are never shrunk
+  size_t size = 0;
+  if (metadata.size > segment_offset) size = std::min(metadata.size - segment_offset, uint64_t{kBitmapSegmentBytes});
+  std::string dense;
+  auto s = BitmapContainer::ToDense(*value, size, &dense);
+  if (!s.ok()) return s;
+  *value = std::move(dense);
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status Bitmap::decodeSegment(const BitmapMetadata &metadata, uint32_t segment_offset,
+                                      rocksdb::PinnableSlice *value) {
+  if (!metadata.IsRoaring()) return rocksdb::Status::OK();
+
+  std::string dense = value->ToString();
+  auto s = decodeSegment(metadata, segment_offset, &dense);
+  if (!s.ok()) return s;
+  value->Reset();
+  *value->GetSelf() = std::move(dense);
+  value->PinSelf();
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status Bitmap::putSegment(const engine::WriteBatchBasePtr &batch, const BitmapMetadata &metadata,
+                                   const std::string &sub_key, const Slice &value) {
+  if (!metadata.IsRoaring()) return batch->Put(sub_key, value);
+
+  std::string container = BitmapContainer::FromDense(value);
+  if (container.empty()) return batch->Delete(sub_key);
+  return batch->Put(sub_key, container);
 }
 
 rocksdb::Status Bitmap::GetBit(engine::Context &ctx, const Slice &user_key, uint32_t bit_offset, bool *bit) {
@@ -127,6 +184,10 @@ rocksdb::Status Bitmap::GetBit(engine::Context &ctx, const Slice &user_key, uint
   // so we can return with *bit == false directly.
   if (!s.ok()) return s.IsNotFound() ? rocksdb::Status::OK() : s;
   uint32_t bit_offset_in_segment = bit_offset % kBitmapSegmentBits;
+  if (metadata.IsRoaring()) {
+    *bit = BitmapContainer::GetBit(value, bit_offset_in_segment);
+    return rocksdb::Status::OK();
+  }
   if (bit_offset_in_segment / 8 < value.size() &&
       util::lsb::GetBit(reinterpret_cast<const uint8_t *>(value.data()), bit_offset_in_segment)) {
     *bit = true;
@@ -165,6 +226,7 @@ rocksdb::Status Bitmap::GetString(engine::Context &ctx, const Slice &user_key, c
     }
     uint32_t frag_index = *parse_result;
     std::string fragment = iter->value().ToString();
+    if (auto s = decodeSegment(metadata, frag_index, &fragment); !s.ok()) return s;
     // To be compatible with data written before the commit d603b0e(#338)
     // and avoid returning extra null char after expansion.
     uint32_t valid_size = std::min(
@@ -194,6 +256,8 @@ rocksdb::Status Bitmap::SetBit(engine::Context &ctx, const Slice &user_key, uint
     return bitmap_string_db.SetBit(ctx, ns_key, &raw_value, bit_offset, new_bit, old_bit);
   }
 
+  if (s.IsNotFound()) initEncoding(&metadata);
+
   std::string value;
   uint32_t segment_index = SegmentSubKeyIndexForBit(bit_offset);
   std::string sub_key =
@@ -201,6 +265,10 @@ rocksdb::Status Bitmap::SetBit(engine::Context &ctx, const Slice &user_key, uint
   if (s.ok()) {
     s = storage_->Get(ctx, ctx.GetReadOptions(), sub_key, &value);
     if (!s.ok() && !s.IsNotFound()) return s;
+    if (s.ok()) {
+      s = decodeSegment(metadata, segment_index, &value);
+      if (!s.ok()) return s;
+    }
   }
   uint32_t bit_offset_in_segment = bit_offset % kBitmapSegmentBits;
   uint32_t byte_index = (bit_offset / 8) % kBitmapSegmentBytes;
@@ -212,10 +280,12 @@ rocksdb::Status Bitmap::SetBit(engine::Context &ctx, const Slice &user_key, uint
   *old_bit = util::lsb::GetBit(data_ptr, bit_offset_in_segment);
   util::lsb::SetBitTo(data_ptr, bit_offset_in_segment, new_bit);
   auto batch = storage_->GetWriteBatchBase();
-  WriteBatchLogData log_data(kRedisBitmap, {std::to_string(kRedisCmdSetBit), std::to_string(bit_offset)});
+  // The new bit is logged since the value of a roaring segment isn't its raw bytes
+  WriteBatchLogData log_data(kRedisBitmap,
+                             {std::to_string(kRedisCmdSetBit), std::to_string(bit_offset), new_bit ? "1" : "0"});
   s = batch->PutLogData(log_data.Encode());
   if (!s.ok()) return s;
-  s = batch->Put(sub_key, value);
+  s = putSegment(batch, metadata, sub_key, value);
   if (!s.ok()) return s;
   if (metadata.size != bitmap_size) {
     metadata.size = bitmap_size;
@@ -278,6 +348,15 @@ rocksdb::Status Bitmap::BitCount(engine::Context &ctx, const Slice &user_key, in
     if (!s.ok() && !s.IsNotFound()) return s;
     // NotFound means all bits in this segment are 0.
     if (s.IsNotFound()) continue;
+    if (metadata.IsRoaring()) {
+      // The segments within the range are counted by their containers
+      if (i != start_index && i != stop_index) {
+        *cnt += BitmapContainer::Count(pin_value);
+        continue;
+      }
+      s = decodeSegment(metadata, i * kBitmapSegmentBytes, &pin_value);
+      if (!s.ok()) return s;
+    }
     // Counting bits in [start_in_segment, stop_in_segment]
     int64_t start_in_segment = 0;                                                // start_index in 1024 bytes segment
     auto readable_stop_in_segment = static_cast<int64_t>(pin_value.size() - 1);  // stop_index  in 1024 bytes segment
@@ -385,6 +464,10 @@ rocksdb::Status Bitmap::BitPos(engine::Context &ctx, const Slice &user_key, bool
             .Encode();
     s = storage_->Get(ctx, read_options, sub_key, &pin_value);
     if (!s.ok() && !s.IsNotFound()) return s;
+    if (s.ok()) {
+      s = decodeSegment(metadata, i * kBitmapSegmentBytes, &pin_value);
+      if (!s.ok()) return s;
+    }
     if (s.IsNotFound()) {
       if (!bit) {
         // Note: even if stop is given, we can return immediately when bit is 0.
@@ -409,6 +492,12 @@ rocksdb::Status Bitmap::BitPos(engine::Context &ctx, const Slice &user_key, bool
       stop_byte_in_segment = (u_stop / to_bit_factor) % kBitmapSegmentBytes + 1;
       byte_with_bit_stop = stop_byte_in_segment;
     }
+    // The bytes without the bit can't hold the position, whatever part of them is in the range
+    if (byte_pos_in_segment < stop_byte_in_segment) {
+      byte_pos_in_segment += util::simd::SkipFilledBytes(
+          reinterpret_cast<const uint8_t *>(pin_value.data()) + byte_pos_in_segment,
+          stop_byte_in_segment - byte_pos_in_segment, bit ? 0 : UINT8_MAX);
+    }
     // Invariant:
     // 1. pin_value.size() <= kBitmapSegmentBytes.
     // 2. If it's the last segment, metadata.size % kBitmapSegmentBytes <= pin_value.size().
@@ -457,6 +546,180 @@ rocksdb::Status Bitmap::BitPos(engine::Context &ctx, const Slice &user_key, bool
   return rocksdb::Status::OK();
 }
 
+// SegmentIterator scans the segments of a source of BITOP. The subkeys are ordered by the decimal strings of the
+// offsets, not by the offsets, but the order is the same in all the sources, so their iterators are merged by it.
+class Bitmap::SegmentIterator {
+ public:
+  SegmentIterator(engine::Context &ctx, engine::Storage *storage, const std::string &ns_key,
+                  const BitmapMetadata &metadata)
+      : metadata_(metadata),
+        slot_id_encoded_(storage->IsSlotIdEncoded()),
+        prefix_key_(InternalKey(ns_key, "", metadata.version, slot_id_encoded_).Encode()),
+        next_version_prefix_key_(InternalKey(ns_key, "", metadata.version + 1, slot_id_encoded_).Encode()),
+        lower_bound_(prefix_key_),
+        upper_bound_(next_version_prefix_key_),
+        read_options_(ctx.DefaultScanOptions()) {
+    read_options_.iterate_lower_bound = &lower_bound_;
+    read_options_.iterate_upper_bound = &upper_bound_;
+    iter_ = util::UniqueIterator(ctx, read_options_);
+  }
+
+  rocksdb::Status Seek() {
+    iter_->Seek(prefix_key_);
+    return parse();
+  }
+  rocksdb::Status Next() {
+    iter_->Next();
+    return parse();
+  }
+  bool Valid() const { return valid_; }
+  const std::string &SubKey() const { return sub_key_; }
+  uint32_t FragIndex() const { return frag_index_; }
+  rocksdb::Status Value(std::string *value) const {
+    *value = iter_->value().ToString();
+    return decodeSegment(metadata_, frag_index_ * kBitmapSegmentBytes, value);
+  }
+
+ private:
+  rocksdb::Status parse() {
+    valid_ = iter_->Valid() && iter_->key().starts_with(prefix_key_);
+    if (!valid_) return iter_->status();
+
+    InternalKey ikey(iter_->key(), slot_id_encoded_);
+    sub_key_ = ikey.GetSubKey().ToString();
+    auto parse_result = ParseInt<uint32_t>(sub_key_, 10);
+    if (!parse_result) {
+      return rocksdb::Status::InvalidArgument(parse_result.Msg());
+    }
+    frag_index_ = *parse_result / kBitmapSegmentBytes;
+    return rocksdb::Status::OK();
+  }
+
+  const BitmapMetadata &metadata_;
+  bool slot_id_encoded_;
+  std::string prefix_key_;
+  std::string next_version_prefix_key_;
+  Slice lower_bound_;
+  Slice upper_bound_;
+  rocksdb::ReadOptions read_options_;
+  util::UniqueIterator iter_;
+  bool valid_ = false;
+  std::string sub_key_;
+  uint32_t frag_index_ = 0;
+};
+
+// The large windows of BITOP are computed by the threads of a pool shared by all the commands. It's never
+// stopped, so it's not destroyed at exit either.
+static TaskRunner *BitOpRunner() {
+  static TaskRunner *runner = [] {
+    auto *runner = new TaskRunner(kBitOpConcurrency - 1);
+    if (auto s = runner->Start(); !s.IsOK()) {
+      LOG(WARNING) << "[bitmap] Failed to start the BITOP workers: " << s.Msg();
+      delete runner;
+      return static_cast<TaskRunner *>(nullptr);
+    }
+    return runner;
+  }();
+  return runner;
+}
+
+void Bitmap::bitOpSegment(BitOpFlags op_flag, const std::vector<Slice> &fragments, size_t res_len,
+                          std::string *res) {
+  res->clear();
+  if (op_flag == kBitOpNot) {
+    // The bytes beyond the source segment are zeros, so they are all ones in the result
+    res->assign(kBitmapSegmentBytes, static_cast<char>(UCHAR_MAX));
+    if (!fragments.empty()) {
+      size_t len = std::min(fragments[0].size(), static_cast<size_t>(kBitmapSegmentBytes));
+      memcpy(res->data(), fragments[0].data(), len);
+      util::simd::BitwiseNot(reinterpret_cast<uint8_t *>(res->data()), len);
+    }
+    res->resize(res_len);
+    return;
+  }
+  if (fragments.empty()) return;
+
+  size_t frag_maxlen = 0, frag_minlen = fragments[0].size();
+  for (const auto &fragment : fragments) {
+    frag_maxlen = std::max(frag_maxlen, fragment.size());
+    frag_minlen = std::min(frag_minlen, fragment.size());
+  }
+  frag_maxlen = std::min(frag_maxlen, static_cast<size_t>(kBitmapSegmentBytes));
+  frag_minlen = std::min(frag_minlen, frag_maxlen);
+  res->assign(frag_maxlen, 0);
+  auto *output = reinterpret_cast<uint8_t *>(res->data());
+
+  // As far as we have data for all the input bitmaps, apply the operation to the whole range
+  // by the vector kernels, and only the rest byte by byte below.
+  memcpy(output, fragments[0].data(), frag_minlen);
+  for (size_t i = 1; i < fragments.size(); i++) {
+    const auto *src = reinterpret_cast<const uint8_t *>(fragments[i].data());
+    if (op_flag == kBitOpAnd) {
+      util::simd::BitwiseAnd(output, src, frag_minlen);
+    } else if (op_flag == kBitOpOr) {
+      util::simd::BitwiseOr(output, src, frag_minlen);
+    } else if (op_flag == kBitOpXor) {
+      util::simd::BitwiseXor(output, src, frag_minlen);
+    }
+  }
+
+  for (size_t j = frag_minlen; j < frag_maxlen; j++) {
+    uint8_t byte = (fragments[0].size() <= j) ? 0 : fragments[0][j];
+    for (size_t i = 1; i < fragments.size(); i++) {
+      uint8_t other = (fragments[i].size() <= j) ? 0 : fragments[i][j];
+      switch (op_flag) {
+        case kBitOpAnd:
+          byte &= other;
+          break;
+        case kBitOpOr:
+          byte |= other;
+          break;
+        case kBitOpXor:
+          byte ^= other;
+          break;
+        default:
+          break;
+      }
+    }
+    output[j] = byte;
+  }
+}
+
+void Bitmap::bitOpWindow(BitOpFlags op_flag, uint64_t max_bitmap_size, std::vector<BitOpSegment> *window) {
+  auto stop_index = static_cast<uint32_t>((max_bitmap_size - 1) / kBitmapSegmentBytes);
+  // The segments are independent of each other, the threads take them one by one
+  std::atomic<size_t> next = 0;
+  auto compute = [&] {
+    std::vector<Slice> fragments;
+    for (size_t w = next++; w < window->size(); w = next++) {
+      auto &segment = (*window)[w];
+      fragments.assign(segment.fragments.begin(), segment.fragments.end());
+      size_t res_len = kBitmapSegmentBytes;
+      if (segment.frag_index == stop_index && max_bitmap_size % kBitmapSegmentBytes != 0) {
+        // We should not set the extra bytes of the last segment to 0xff
+        res_len = max_bitmap_size % kBitmapSegmentBytes;
+      }
+      bitOpSegment(op_flag, fragments, res_len, &segment.result);
+    }
+  };
+
+  std::vector<std::future<void>> tasks;
+  if (auto runner = BitOpRunner(); runner && window->size() >= kBitOpParallelSegments) {
+    for (size_t tid = 1; tid < kBitOpConcurrency; tid++) {
+      auto done = std::make_shared<std::promise<void>>();
+      auto task = [&compute, done] {
+        compute();
+        done->set_value();
+      };
+      // the window is computed by this thread alone if the pool is busy
+      if (!runner->TryPublish(std::move(task), TaskPriority::kHigh, "bitop").IsOK()) break;
+      tasks.emplace_back(done->get_future());
+    }
+  }
+  compute();
+  for (auto &task : tasks) task.get();
+}
+
 rocksdb::Status Bitmap::BitOp(engine::Context &ctx, BitOpFlags op_flag, const std::string &op_name,
                               const Slice &user_key, const std::vector<Slice> &op_keys, int64_t *len) {
   std::string raw_value;
@@ -501,145 +764,103 @@ rocksdb::Status Bitmap::BitOp(engine::Context &ctx, BitOpFlags op_flag, const st
   if (!s.ok()) return s;
 
   BitmapMetadata res_metadata;
+  initEncoding(&res_metadata);
   // If the operation is AND and the number of keys is less than the number of op_keys,
   // we can skip setting the subkeys of the result bitmap and just set the metadata.
   const bool can_skip_op = op_flag == kBitOpAnd && num_keys != op_keys.size();
   if (!can_skip_op) {
-    uint64_t stop_index = (max_bitmap_size - 1) / kBitmapSegmentBytes;
-    std::unique_ptr<unsigned char[]> frag_res(new unsigned char[kBitmapSegmentBytes]);
-
-    rocksdb::ReadOptions read_options = ctx.GetReadOptions();
-    for (uint64_t frag_index = 0; frag_index <= stop_index; frag_index++) {
-      std::vector<rocksdb::PinnableSlice> fragments;
-      uint16_t frag_maxlen = 0, frag_minlen = 0;
-      for (const auto &meta_pair : meta_pairs) {
-        std::string sub_key = InternalKey(meta_pair.first, std::to_string(frag_index * kBitmapSegmentBytes),
-                                          meta_pair.second.version, storage_->IsSlotIdEncoded())
+    auto stop_index = static_cast<uint32_t>((max_bitmap_size - 1) / kBitmapSegmentBytes);
+    // The segments are read and computed in windows, and the results of a window are copied into the batch
+    // before the next one is read, so only a window of segments is held in memory besides the batch.
+    std::vector<BitOpSegment> window;
+    window.reserve(kBitOpWindowSegments);
+    auto flush_window = [&]() -> rocksdb::Status {
+      bitOpWindow(op_flag, max_bitmap_size, &window);
+      for (const auto &segment : window) {
+        if (segment.result.empty()) continue;
+        std::string sub_key = InternalKey(ns_key, std::to_string(segment.frag_index * kBitmapSegmentBytes),
+                                          res_metadata.version, storage_->IsSlotIdEncoded())
                                   .Encode();
-        rocksdb::PinnableSlice fragment;
-        auto s = storage_->Get(ctx, read_options, sub_key, &fragment);
-        if (!s.ok() && !s.IsNotFound()) {
-          return s;
+        auto s = putSegment(batch, res_metadata, sub_key, segment.result);
+        if (!s.ok()) return s;
+      }
+      window.clear();
+      return rocksdb::Status::OK();
+    };
+
+    if (op_flag == kBitOpNot) {
+      // The missing segments of the source are all ones in the result, so every segment is read by a MultiGet
+      const auto &[ns_op_key, metadata] = meta_pairs[0];
+      rocksdb::ReadOptions read_options = ctx.DefaultMultiGetOptions();
+      for (uint32_t window_begin = 0; window_begin <= stop_index; window_begin += kBitOpWindowSegments) {
+        size_t window_size = std::min<size_t>(kBitOpWindowSegments, stop_index - window_begin + 1);
+        std::vector<std::string> sub_keys;
+        sub_keys.reserve(window_size);
+        for (uint32_t frag_index = window_begin; frag_index < window_begin + window_size; frag_index++) {
+          sub_keys.emplace_back(InternalKey(ns_op_key, std::to_string(frag_index * kBitmapSegmentBytes),
+                                            metadata.version, storage_->IsSlotIdEncoded())
+                                    .Encode());
         }
-        if (s.IsNotFound()) {
-          if (op_flag == kBitOpAnd) {
-            // If any of the input bitmaps is empty, the result of AND
-            // is empty.
-            frag_maxlen = 0;
-            break;
-          }
-        } else {
-          if (frag_maxlen < fragment.size()) frag_maxlen = fragment.size();
-          if (fragment.size() < frag_minlen || frag_minlen == 0) frag_minlen = fragment.size();
-          fragments.emplace_back(std::move(fragment));
+        std::vector<Slice> sub_key_slices(sub_keys.begin(), sub_keys.end());
+        std::vector<rocksdb::PinnableSlice> values(window_size);
+        std::vector<rocksdb::Status> statuses(window_size);
+        storage_->MultiGet(ctx, read_options, storage_->GetDB()->DefaultColumnFamily(), window_size,
+                           sub_key_slices.data(), values.data(), statuses.data());
+        for (size_t w = 0; w < window_size; w++) {
+          auto &segment = window.emplace_back();
+          segment.frag_index = window_begin + w;
+          if (statuses[w].IsNotFound()) continue;
+          if (!statuses[w].ok()) return statuses[w];
+          std::string value = values[w].ToString();
+          auto s = decodeSegment(metadata, segment.frag_index * kBitmapSegmentBytes, &value);
+          if (!s.ok()) return s;
+          segment.fragments.emplace_back(std::move(value));
         }
+        auto s = flush_window();
+        if (!s.ok()) return s;
       }
-
-      size_t frag_numkeys = fragments.size();
-      if (frag_maxlen != 0 || op_flag == kBitOpNot) {
-        uint16_t j = 0;
-        if (op_flag == kBitOpNot) {
-          memset(frag_res.get(), UCHAR_MAX, kBitmapSegmentBytes);
-        } else {
-          memset(frag_res.get(), 0, frag_maxlen);
-        }
-
-        /* Fast path: as far as we have data for all the input bitmaps we
-         * can take a fast path that performs much better than the
-         * vanilla algorithm. On ARM we skip the fast path since it will
-         * result in GCC compiling the code using multiple-words load/store
-         * operations that are not supported even in ARM >= v6. */
-#ifndef USE_ALIGNED_ACCESS
-        if (frag_minlen >= sizeof(uint64_t) * 4 && frag_numkeys <= 16) {
-          auto *lres = reinterpret_cast<uint64_t *>(frag_res.get());
-          const uint64_t *lp[16];
-          for (uint64_t i = 0; i < frag_numkeys; i++) {
-            lp[i] = reinterpret_cast<const uint64_t *>(fragments[i].data());
-          }
-          memcpy(frag_res.get(), fragments[0].data(), frag_minlen);
-          auto apply_fast_path_op = [&](auto op) {
-            // Note: kBitOpNot cannot use this op, it only applying
-            // to kBitOpAnd, kBitOpOr, kBitOpXor.
-            DCHECK(op_flag != kBitOpNot);
-            while (frag_minlen >= sizeof(uint64_t) * 4) {
-              for (uint64_t i = 1; i < frag_numkeys; i++) {
-                op(lres[0], lp[i][0]);
-                op(lres[1], lp[i][1]);
-                op(lres[2], lp[i][2]);
-                op(lres[3], lp[i][3]);
-                lp[i] += 4;
-              }
-              lres += 4;
-              j += sizeof(uint64_t) * 4;
-              frag_minlen -= sizeof(uint64_t) * 4;
-            }
-          };
-
-          if (op_flag == kBitOpAnd) {
-            apply_fast_path_op([](uint64_t &a, uint64_t b) { a &= b; });
-          } else if (op_flag == kBitOpOr) {
-            apply_fast_path_op([](uint64_t &a, uint64_t b) { a |= b; });
-          } else if (op_flag == kBitOpXor) {
-            apply_fast_path_op([](uint64_t &a, uint64_t b) { a ^= b; });
-          } else if (op_flag == kBitOpNot) {
-            while (frag_minlen >= sizeof(uint64_t) * 4) {
-              lres[0] = ~lres[0];
-              lres[1] = ~lres[1];
-              lres[2] = ~lres[2];
-              lres[3] = ~lres[3];
-              lres += 4;
-              j += sizeof(uint64_t) * 4;
-              frag_minlen -= sizeof(uint64_t) * 4;
-            }
-          }
+    } else {
+      // The sources are scanned together, so only the segments present in them are read, and each of them once
+      std::vector<std::unique_ptr<SegmentIterator>> iters;
+      iters.reserve(num_keys);
+      for (const auto &[ns_op_key, metadata] : meta_pairs) {
+        auto &iter = iters.emplace_back(std::make_unique<SegmentIterator>(ctx, storage_, ns_op_key, metadata));
+        auto s = iter->Seek();
+        if (!s.ok()) return s;
+      }
+      while (true) {
+        const std::string *min_sub_key = nullptr;
+        for (const auto &iter : iters) {
+          if (iter->Valid() && (!min_sub_key || iter->SubKey() < *min_sub_key)) min_sub_key = &iter->SubKey();
         }
-#endif
-
-        uint8_t output = 0, byte = 0;
-        for (; j < frag_maxlen; j++) {
-          output = (fragments[0].size() <= j) ? 0 : fragments[0][j];
-          if (op_flag == kBitOpNot) output = ~output;
-          for (uint64_t i = 1; i < frag_numkeys; i++) {
-            byte = (fragments[i].size() <= j) ? 0 : fragments[i][j];
-            switch (op_flag) {
-              case kBitOpAnd:
-                output &= byte;
-                break;
-              case kBitOpOr:
-                output |= byte;
-                break;
-              case kBitOpXor:
-                output ^= byte;
-                break;
-              default:
-                break;
-            }
+        if (!min_sub_key) break;
+
+        std::string sub_key = *min_sub_key;
+        BitOpSegment segment;
+        for (const auto &iter : iters) {
+          if (!iter->Valid() || iter->SubKey() != sub_key) continue;
+          segment.frag_index = iter->FragIndex();
+          if (segment.frag_index <= stop_index) {
+            std::string value;
+            auto s = iter->Value(&value);
+            if (!s.ok()) return s;
+            segment.fragments.emplace_back(std::move(value));
           }
-          frag_res[j] = output;
+          auto s = iter->Next();
+          if (!s.ok()) return s;
         }
-
-        if (op_flag == kBitOpNot) {
-          if (frag_index == stop_index) {
-            // We should not set the extra bytes to 0xff. So we should limit
-            // `frag_maxlen` for the last segment.
-            if (max_bitmap_size == (frag_index + 1) * kBitmapSegmentBytes) {
-              // If the last fragment is full, `max_bitmap_size % kBitmapSegmentBytes`
-              // would be 0. In this case, we should set `frag_maxlen` to
-              // `kBitmapSegmentBytes` to avoid writing an empty fragment.
-              frag_maxlen = kBitmapSegmentBytes;
-            } else {
-              frag_maxlen = max_bitmap_size % kBitmapSegmentBytes;
-            }
-          } else {
-            frag_maxlen = kBitmapSegmentBytes;
-          }
+        if (segment.frag_index > stop_index) continue;
+        // If any of the input bitmaps doesn't have the segment, the result of AND is empty in it
+        if (op_flag == kBitOpAnd && segment.fragments.size() != num_keys) continue;
+
+        window.emplace_back(std::move(segment));
+        if (window.size() == kBitOpWindowSegments) {
+          auto s = flush_window();
+          if (!s.ok()) return s;
         }
-        std::string sub_key = InternalKey(ns_key, std::to_string(frag_index * kBitmapSegmentBytes),
-                                          res_metadata.version, storage_->IsSlotIdEncoded())
-                                  .Encode();
-        auto s = batch->Put(sub_key, Slice(reinterpret_cast<char *>(frag_res.get()), frag_maxlen));
-        if (!s.ok()) return s;
       }
+      auto s = flush_window();
+      if (!s.ok()) return s;
     }
   }
 
@@ -656,7 +877,7 @@ rocksdb::Status Bitmap::BitOp(engine::Context &ctx, BitOpFlags op_flag, const st
 class Bitmap::SegmentCacheStore {
  public:
   SegmentCacheStore(engine::Storage *storage, rocksdb::ColumnFamilyHandle *metadata_cf_handle,
-                    std::string namespace_key, const Metadata &bitmap_metadata)
+                    std::string namespace_key, const BitmapMetadata &bitmap_metadata)
       : storage_(storage),
         metadata_cf_handle_(metadata_cf_handle),
         ns_key_(std::move(namespace_key)),
@@ -677,13 +898,13 @@ class Bitmap::SegmentCacheStore {
   }
 
   // Add all dirty segments into write batch.
-  rocksdb::Status BatchForFlush(ObserverOrUniquePtr<rocksdb::WriteBatchBase> &batch) {
+  rocksdb::Status BatchForFlush(engine::WriteBatchBasePtr &batch) {
     uint64_t used_size = 0;
     for (auto &[index, content] : cache_) {
       if (content.first) {
         std::string sub_key =
             InternalKey(ns_key_, getSegmentSubKey(index), metadata_.version, storage_->IsSlotIdEncoded()).Encode();
-        auto s = batch->Put(sub_key, content.second);
+        auto s = putSegment(batch, metadata_, sub_key, content.second);
         if (!s.ok()) {
           return s;
         }
@@ -715,6 +936,10 @@ class Bitmap::SegmentCacheStore {
       if (!s.ok() && !s.IsNotFound()) {
         return s;
       }
+      if (s.ok()) {
+        s = decodeSegment(metadata_, index * kBitmapSegmentBytes, &str);
+        if (!s.ok()) return s;
+      }
     }
 
     is_dirty |= set_dirty;
@@ -727,7 +952,7 @@ class Bitmap::SegmentCacheStore {
   engine::Storage *storage_;
   rocksdb::ColumnFamilyHandle *metadata_cf_handle_;
   std::string ns_key_;
-  Metadata metadata_;
+  BitmapMetadata metadata_;
   // Segment index -> [is_dirty, segment_cache_string]
   std::unordered_map<uint32_t, std::pair<bool, std::string>> cache_;
 };
@@ -850,6 +1075,7 @@ rocksdb::Status Bitmap::bitfield(engine::Context &ctx, const Slice &user_key, co
   if (metadata.Type() != RedisType::kRedisBitmap) {
     return rocksdb::Status::InvalidArgument("The value is not a bitmap or string.");
   }
+  if (s.IsNotFound()) initEncoding(&metadata);
 
   // We firstly do the bitfield operation by fetching segments into memory.
   // Use SegmentCacheStore to record dirty segments. (if not read-only mode)
@@ -930,8 +1156,7 @@ template rocksdb::Status Bitmap::bitfield<true>(engine::Context &ctx, const Slic
                                                 std::vector<std::optional<BitfieldValue>> *);
 
 // Return true if there are any write operation to bitmap. Otherwise return false.
-bool Bitmap::bitfieldWriteAheadLog(const ObserverOrUniquePtr<rocksdb::WriteBatchBase> &batch,
-                                   const std::vector<BitfieldOperation> &ops) {
+bool Bitmap::bitfieldWriteAheadLog(const engine::WriteBatchBasePtr &batch, const std::vector<BitfieldOperation> &ops) {
   std::vector<std::string> cmd_args{std::to_string(kRedisCmdBitfield)};
   auto current_overflow = BitfieldOverflowBehavior::kWrap;
   for (BitfieldOperation op : ops) {
@@ -994,6 +1219,8 @@ bool Bitmap::GetBitFromValueAndOffset(std::string_view value, uint32_t bit_offse
 
 bool Bitmap::IsEmptySegment(const Slice &segment) {
   static const char zero_byte_segment[kBitmapSegmentBytes] = {0};
+  // The containers of the roaring segments are tagged by a non-zero byte, so they are never empty here
+  if (segment.size() > kBitmapSegmentBytes) return false;
   return !memcmp(zero_byte_segment, segment.data(), segment.size());
 }
 }  // namespace redis
@@ -73,10 +73,28 @@ class Bitmap : public Database {
   template <bool ReadOnly>
   rocksdb::Status bitfield(engine::Context &ctx, const Slice &user_key, const std::vector<BitfieldOperation> &ops,
                            std::vector<std::optional<BitfieldValue>> *rets);
-  static bool bitfieldWriteAheadLog(const ObserverOrUniquePtr<rocksdb::WriteBatchBase> &batch,
-                                    const std::vector<BitfieldOperation> &ops);
+  /// The segments of a source of BITOP in the order of their subkeys, see BitOp
+  class SegmentIterator;
+  /// The segment of the result of BITOP and the segments of the sources it's computed from
+  struct BitOpSegment {
+    uint32_t frag_index = 0;
+    std::vector<std::string> fragments;
+    std::string result;
+  };
+
+  static void bitOpWindow(BitOpFlags op_flag, uint64_t max_bitmap_size, std::vector<BitOpSegment> *window);
+  static void bitOpSegment(BitOpFlags op_flag, const std::vector<Slice> &fragments, size_t res_len, std::string *res);
+  static bool bitfieldWriteAheadLog(const engine::WriteBatchBasePtr &batch, const std::vector<BitfieldOperation> &ops);
   rocksdb::Status GetMetadata(engine::Context &ctx, const Slice &ns_key, BitmapMetadata *metadata,
                               std::string *raw_value);
+  void initEncoding(BitmapMetadata *metadata) const;
+  // Decode the value of a segment into its raw bytes, which does nothing for the raw bitmaps
+  static rocksdb::Status decodeSegment(const BitmapMetadata &metadata, uint32_t segment_offset, std::string *value);
+  static rocksdb::Status decodeSegment(const BitmapMetadata &metadata, uint32_t segment_offset,
+                                       rocksdb::PinnableSlice *value);
+  // Put the raw bytes of a segment, which are encoded into a container for the roaring bitmaps
+  static rocksdb::Status putSegment(const engine::WriteBatchBasePtr &batch, const BitmapMetadata &metadata,
+                                    const std::string &sub_key, const Slice &value);
 
   template <bool ReadOnly>
   static rocksdb::Status runBitfieldOperationsWithCache(engine::Context &ctx, SegmentCacheStore &cache,
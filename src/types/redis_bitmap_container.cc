@@ -0,0 +1,159 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "redis_bitmap_container.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "common/bit_util.h"
+
+namespace redis {
+
+namespace {
+
+constexpr size_t kOffsetBytes = sizeof(uint16_t);
+
+uint16_t OffsetAt(const rocksdb::Slice &container, size_t i) {
+  return DecodeFixed16(container.data() + 1 + i * kOffsetBytes);
+}
+
+size_t OffsetCount(const rocksdb::Slice &container) { return (container.size() - 1) / kOffsetBytes; }
+
+}  // namespace
+
+std::string BitmapContainer::FromDense(const rocksdb::Slice &dense) {
+  const auto *data = reinterpret_cast<const uint8_t *>(dense.data());
+  size_t len = dense.size();
+  while (len > 0 && data[len - 1] == 0) len--;
+  if (len == 0) return "";
+
+  size_t set_bits = util::RawPopcount(data, static_cast<int64_t>(len));
+  size_t runs = 0;
+  bool prev = false;
+  for (uint32_t i = 0; i < len * 8; i++) {
+    bool bit = util::lsb::GetBit(data, i);
+    if (bit && !prev) runs++;
+    prev = bit;
+  }
+
+  std::string container;
+  size_t array_size = set_bits * kOffsetBytes, run_size = runs * 2 * kOffsetBytes;
+  if (len <= std::min(array_size, run_size)) {
+    container.reserve(1 + len);
+    container.push_back(static_cast<char>(kBitset));
+    container.append(dense.data(), len);
+  } else if (array_size <= run_size) {
+    container.reserve(1 + array_size);
+    container.push_back(static_cast<char>(kArray));
+    for (uint32_t i = 0; i < len * 8; i++) {
+      if (util::lsb::GetBit(data, i)) PutFixed16(&container, static_cast<uint16_t>(i));
+    }
+  } else {
+    container.reserve(1 + run_size);
+    container.push_back(static_cast<char>(kRun));
+    prev = false;
+    for (uint32_t i = 0; i <= len * 8; i++) {
+      bool bit = i < len * 8 && util::lsb::GetBit(data, i);
+      if (bit && !prev) PutFixed16(&container, static_cast<uint16_t>(i));
+      if (!bit && prev) PutFixed16(&container, static_cast<uint16_t>(i - 1));
+      prev = bit;
+    }
+  }
+  return container;
+}
+
+rocksdb::Status BitmapContainer::ToDense(const rocksdb::Slice &container, size_t size, std::string *dense) {
+  dense->clear();
+  if (container.empty()) {
+    dense->resize(size, 0);
+    return rocksdb::Status::OK();
+  }
+
+  auto type = static_cast<uint8_t>(container[0]);
+  if (type == kBitset) {
+    dense->assign(container.data() + 1, container.size() - 1);
+    if (dense->size() < size) dense->resize(size, 0);
+    return rocksdb::Status::OK();
+  }
+  if ((type != kArray && type != kRun) || (container.size() - 1) % kOffsetBytes != 0 ||
+      (type == kRun && OffsetCount(container) % 2 != 0)) {
+    return rocksdb::Status::Corruption("invalid bitmap container");
+  }
+
+  // The offsets are ascending, so the last one tells the size of the segment
+  size_t count = OffsetCount(container);
+  size_t len = count == 0 ? 0 : OffsetAt(container, count - 1) / 8 + 1;
+  dense->resize(std::max(len, size), 0);
+  auto *data = reinterpret_cast<uint8_t *>(dense->data());
+  if (type == kArray) {
+    for (size_t i = 0; i < count; i++) util::lsb::SetBitTo(data, OffsetAt(container, i), true);
+  } else {
+    for (size_t i = 0; i + 1 < count; i += 2) {
+      for (uint32_t bit = OffsetAt(container, i); bit <= OffsetAt(container, i + 1); bit++) {
+        util::lsb::SetBitTo(data, bit, true);
+      }
+    }
+  }
+  return rocksdb::Status::OK();
+}
+
+bool BitmapContainer::GetBit(const rocksdb::Slice &container, uint32_t bit_offset) {
+  if (container.empty()) return false;
+
+  auto type = static_cast<uint8_t>(container[0]);
+  if (type == kBitset) {
+    return bit_offset / 8 < container.size() - 1 &&
+           util::lsb::GetBit(reinterpret_cast<const uint8_t *>(container.data() + 1), bit_offset);
+  }
+
+  // Find the first offset greater than the bit by binary search over the ascending offsets
+  size_t lo = 0, hi = OffsetCount(container);
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    if (OffsetAt(container, mid) <= bit_offset) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (type == kArray) return lo > 0 && OffsetAt(container, lo - 1) == bit_offset;
+  // Within a run the first offset is even and the last one is odd in the list
+  if (lo == 0) return false;
+  return (lo - 1) % 2 == 0 || OffsetAt(container, lo - 1) == bit_offset;
+}
+
+uint32_t BitmapContainer::Count(const rocksdb::Slice &container) {
+  if (container.empty()) return 0;
+
+  auto type = static_cast<uint8_t>(container[0]);
+  if (type == kBitset) {
+    return util::RawPopcount(reinterpret_cast<const uint8_t *>(container.data() + 1),
+                             static_cast<int64_t>(container.size() - 1));
+  }
+  size_t count = OffsetCount(container);
+  if (type == kArray) return count;
+
+  uint32_t bits = 0;
+  for (size_t i = 0; i + 1 < count; i += 2) bits += OffsetAt(container, i + 1) - OffsetAt(container, i) + 1;
+  return bits;
+}
+
+}  // namespace redis
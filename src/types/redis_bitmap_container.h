@@ -0,0 +1,58 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <rocksdb/status.h>
+
+#include <cstdint>
+#include <string>
+
+#include "common/encoding.h"
+
+namespace redis {
+
+// BitmapContainer is the value of a segment of the roaring encoded bitmaps. Instead of the raw bytes of the
+// segment, it's the smallest of the containers for the bits set in it, tagged by its first byte:
+//
+//   array:  kArray  | fixed16 offsets of the set bits, ascending
+//   run:    kRun    | fixed16 first and last offsets of each run of set bits, ascending
+//   bitset: kBitset | the raw bytes of the segment, without the trailing zero bytes
+//
+// So a sparse segment costs two bytes per set bit, and a long run four bytes, whatever its size.
+// A segment without any bit set has no container, its subkey is deleted.
+class BitmapContainer {
+ public:
+  enum Type : uint8_t {
+    kArray = 1,
+    kRun = 2,
+    kBitset = 3,
+  };
+
+  // Encode the raw bytes of a segment into the smallest container, an empty string if no bit is set
+  static std::string FromDense(const rocksdb::Slice &dense);
+  // Decode a container into the raw bytes of the segment, which are padded with zeros to `size` bytes at least
+  static rocksdb::Status ToDense(const rocksdb::Slice &container, size_t size, std::string *dense);
+
+  static bool GetBit(const rocksdb::Slice &container, uint32_t bit_offset);
+  static uint32_t Count(const rocksdb::Slice &container);
+};
+
+}  // namespace redis
@@ -20,6 +20,8 @@
 
 #include "redis_bloom_chain.h"
 
+#include <algorithm>
+
 #include "types/bloom_filter.h"
 
 namespace redis {
@@ -47,12 +49,13 @@ void BloomChain::getBFKeyList(const Slice &ns_key, const BloomChainMetadata &met
 
 rocksdb::Status BloomChain::getBFDataList(engine::Context &ctx, const std::vector<std::string> &bf_key_list,
                                           std::vector<rocksdb::PinnableSlice> *bf_data_list) {
-  bf_data_list->reserve(bf_key_list.size());
-  for (const auto &bf_key : bf_key_list) {
-    rocksdb::PinnableSlice pin_value;
-    rocksdb::Status s = storage_->Get(ctx, ctx.GetReadOptions(), bf_key, &pin_value);
+  std::vector<rocksdb::Slice> bf_key_slices(bf_key_list.begin(), bf_key_list.end());
+  std::vector<rocksdb::Status> statuses(bf_key_list.size());
+  bf_data_list->resize(bf_key_list.size());
+  storage_->MultiGet(ctx, ctx.DefaultMultiGetOptions(), storage_->GetDB()->DefaultColumnFamily(), bf_key_slices.size(),
+                     bf_key_slices.data(), bf_data_list->data(), statuses.data());
+  for (const auto &s : statuses) {
     if (!s.ok()) return s;
-    bf_data_list->push_back(std::move(pin_value));
   }
   return rocksdb::Status::OK();
 }
@@ -94,8 +97,7 @@ rocksdb::Status BloomChain::createBloomChain(engine::Context &ctx, const Slice &
 }
 
 rocksdb::Status BloomChain::createBloomFilterInBatch(const Slice &ns_key, BloomChainMetadata *metadata,
-                                                     ObserverOrUniquePtr<rocksdb::WriteBatchBase> &batch,
-                                                     std::string *bf_data) {
+                                                     engine::WriteBatchBasePtr &batch, std::string *bf_data) {
   uint32_t bloom_filter_bytes = BlockSplitBloomFilter::OptimalNumOfBytes(
       static_cast<uint32_t>(metadata->base_capacity * pow(metadata->expansion, metadata->n_filters)),
       metadata->error_rate);
@@ -116,12 +118,34 @@ void BloomChain::bloomAdd(uint64_t item_hash, std::string &bf_data) {
   block_split_bloom_filter.InsertHash(item_hash);
 }
 
-bool BloomChain::bloomCheck(uint64_t item_hash, std::string_view &bf_data) {
+bool BloomChain::bloomCheck(uint64_t item_hash, std::string_view bf_data) {
   const BlockSplitBloomFilter block_split_bloom_filter(
       nonstd::span<char>(const_cast<char *>(bf_data.data()), bf_data.size()));
   return block_split_bloom_filter.FindHash(item_hash);
 }
 
+void BloomChain::bloomCheckBatch(const std::vector<uint64_t> &item_hash_list,
+                                 const std::vector<std::string_view> &bf_data_list, std::vector<bool> *exists) {
+  std::vector<std::pair<uint32_t, size_t>> probes;
+  probes.reserve(item_hash_list.size());
+  // TODO: to test which direction for searching is better
+  for (auto it = bf_data_list.rbegin(); it != bf_data_list.rend(); ++it) {
+    const BlockSplitBloomFilter block_split_bloom_filter(
+        nonstd::span<char>(const_cast<char *>(it->data()), it->size()));
+    probes.clear();
+    for (size_t i = 0; i < item_hash_list.size(); ++i) {
+      if (!(*exists)[i]) probes.emplace_back(block_split_bloom_filter.BlockIndex(item_hash_list[i]), i);
+    }
+    if (probes.empty()) break;
+
+    // probing in the block order walks through the bitset once instead of jumping around it
+    std::sort(probes.begin(), probes.end());
+    for (const auto &[_, i] : probes) {
+      if (block_split_bloom_filter.FindHash(item_hash_list[i])) (*exists)[i] = true;
+    }
+  }
+}
+
 rocksdb::Status BloomChain::Reserve(engine::Context &ctx, const Slice &user_key, uint32_t capacity, double error_rate,
                                     uint16_t expansion) {
   std::string ns_key = AppendNamespacePrefix(user_key);
@@ -177,6 +201,19 @@ rocksdb::Status BloomChain::InsertCommon(engine::Context &ctx, const Slice &user
   std::vector<uint64_t> item_hash_list;
   getItemHashList(items, &item_hash_list);
 
+  // Only the last filter takes the new items, so all the items are probed against the filters before it at once
+  std::vector<bool> exists(items.size(), false);
+  std::vector<std::string_view> sealed_data_list;
+  sealed_data_list.reserve(bf_data_list.size() - 1);
+  for (size_t ii = 0; ii + 1 < bf_data_list.size(); ++ii) {
+    sealed_data_list.push_back(bf_data_list[ii].ToStringView());
+  }
+  bloomCheckBatch(item_hash_list, sealed_data_list, &exists);
+
+  // The filters taking the items of this command, which are copied once and checked item by item
+  std::vector<std::string> open_data_list{bf_data_list.back().ToString()};
+  bool tail_changed = false;
+
   uint64_t origin_size = metadata.size;
   auto batch = storage_->GetWriteBatchBase();
   WriteBatchLogData log_data(kRedisBloomFilter, {"insert"});
@@ -185,42 +222,34 @@ rocksdb::Status BloomChain::InsertCommon(engine::Context &ctx, const Slice &user
 
   for (size_t i = 0; i < items.size(); ++i) {
     // check
-    bool exist = false;
-    // TODO: to test which direction for searching is better
-    for (int ii = static_cast<int>(bf_data_list.size()) - 1; ii >= 0; --ii) {
-      std::string_view data = bf_data_list[ii].ToStringView();
-      exist = bloomCheck(item_hash_list[i], data);
-      if (exist) break;
+    for (auto it = open_data_list.rbegin(); !exists[i] && it != open_data_list.rend(); ++it) {
+      exists[i] = bloomCheck(item_hash_list[i], *it);
     }
 
     // insert
-    if (exist) {
+    if (exists[i]) {
       (*rets)[i] = BloomFilterAddResult::kExist;
-    } else {
-      if (metadata.size + 1 > metadata.GetCapacity()) {
-        if (metadata.IsScaling()) {
-          s = batch->Put(bf_key_list.back(), bf_data_list.back().ToStringView());
-          if (!s.ok()) return s;
-          std::string bf_data;
-          s = createBloomFilterInBatch(ns_key, &metadata, batch, &bf_data);
-          if (!s.ok()) return s;
-          rocksdb::PinnableSlice pin_slice;
-          *pin_slice.GetSelf() = std::move(bf_data);
-          pin_slice.PinSelf();
-          bf_data_list.push_back(std::move(pin_slice));
-          bf_key_list.push_back(getBFKey(ns_key, metadata, metadata.n_filters - 1));
-        } else {
-          (*rets)[i] = BloomFilterAddResult::kFull;
-          continue;
-        }
+      continue;
+    }
+    if (metadata.size + 1 > metadata.GetCapacity()) {
+      if (!metadata.IsScaling()) {
+        (*rets)[i] = BloomFilterAddResult::kFull;
+        continue;
+      }
+      if (tail_changed) {
+        s = batch->Put(bf_key_list.back(), open_data_list.back());
+        if (!s.ok()) return s;
       }
-      std::string data = bf_data_list.back().ToString();
-      bloomAdd(item_hash_list[i], data);
-      *bf_data_list.back().GetSelf() = std::move(data);
-      bf_data_list.back().PinSelf();
-      (*rets)[i] = BloomFilterAddResult::kOk;
-      metadata.size += 1;
+      std::string bf_data;
+      s = createBloomFilterInBatch(ns_key, &metadata, batch, &bf_data);
+      if (!s.ok()) return s;
+      open_data_list.push_back(std::move(bf_data));
+      bf_key_list.push_back(getBFKey(ns_key, metadata, metadata.n_filters - 1));
     }
+    bloomAdd(item_hash_list[i], open_data_list.back());
+    tail_changed = true;
+    (*rets)[i] = BloomFilterAddResult::kOk;
+    metadata.size += 1;
   }
 
   if (metadata.size != origin_size) {
@@ -228,7 +257,9 @@ rocksdb::Status BloomChain::InsertCommon(engine::Context &ctx, const Slice &user
     metadata.Encode(&bloom_chain_metadata_bytes);
     s = batch->Put(metadata_cf_handle_, ns_key, bloom_chain_metadata_bytes);
     if (!s.ok()) return s;
-    s = batch->Put(bf_key_list.back(), bf_data_list.back().ToStringView());
+  }
+  if (tail_changed) {
+    s = batch->Put(bf_key_list.back(), open_data_list.back());
     if (!s.ok()) return s;
   }
   return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
@@ -263,15 +294,13 @@ rocksdb::Status BloomChain::MExists(engine::Context &ctx, const Slice &user_key,
   std::vector<uint64_t> item_hash_list;
   getItemHashList(items, &item_hash_list);
 
-  for (size_t i = 0; i < items.size(); ++i) {
-    // check
-    // TODO: to test which direction for searching is better
-    for (int ii = static_cast<int>(bf_data_list.size()) - 1; ii >= 0; --ii) {
-      std::string_view data = bf_data_list[ii].ToStringView();
-      (*exists)[i] = bloomCheck(item_hash_list[i], data);
-      if ((*exists)[i]) break;
-    }
+  std::vector<std::string_view> bf_view_list;
+  bf_view_list.reserve(bf_data_list.size());
+  for (const auto &bf_data : bf_data_list) {
+    bf_view_list.push_back(bf_data.ToStringView());
   }
+  std::fill(exists->begin(), exists->end(), false);
+  bloomCheckBatch(item_hash_list, bf_view_list, exists);
 
   return rocksdb::Status::OK();
 }
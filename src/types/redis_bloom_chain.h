@@ -86,11 +86,17 @@ class BloomChain : public Database {
   rocksdb::Status createBloomChain(engine::Context &ctx, const Slice &ns_key, double error_rate, uint32_t capacity,
                                    uint16_t expansion, BloomChainMetadata *metadata);
   rocksdb::Status createBloomFilterInBatch(const Slice &ns_key, BloomChainMetadata *metadata,
-                                           ObserverOrUniquePtr<rocksdb::WriteBatchBase> &batch, std::string *bf_data);
+                                           engine::WriteBatchBasePtr &batch, std::string *bf_data);
 
   /// bf_data: [in/out] The content string of bloomfilter.
   static void bloomAdd(uint64_t item_hash, std::string &bf_data);
 
-  static bool bloomCheck(uint64_t item_hash, std::string_view &bf_data);
+  static bool bloomCheck(uint64_t item_hash, std::string_view bf_data);
+
+  /// Probe the items against the filters from the newest one, grouping the probes of each filter by block.
+  ///
+  /// exists: [in/out] The items already known to exist are skipped, and the found ones are set.
+  static void bloomCheckBatch(const std::vector<uint64_t> &item_hash_list,
+                              const std::vector<std::string_view> &bf_data_list, std::vector<bool> *exists);
 };
 }  // namespace redis
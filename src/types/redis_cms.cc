@@ -0,0 +1,243 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "redis_cms.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "xxh3.h"
+
+namespace redis {
+
+rocksdb::Status CountMinSketch::DimensionsByProb(double error, double probability, uint32_t *width,
+                                                 uint32_t *depth) {
+  double w = std::ceil(2 / error);
+  double d = std::ceil(std::log10(probability) / std::log10(0.5));
+  // Checked before the casts, which are undefined if the values don't fit in uint32_t
+  if (!(w >= 1 && d >= 1 && w * d <= static_cast<double>(kCMSMaxCounters))) {
+    return rocksdb::Status::InvalidArgument("the error rate or the probability is too small");
+  }
+
+  *width = static_cast<uint32_t>(w);
+  *depth = static_cast<uint32_t>(d);
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status CountMinSketch::getCMSMetadata(engine::Context &ctx, const Slice &ns_key,
+                                               CountMinSketchMetadata *metadata) {
+  return Database::GetMetadata(ctx, {kRedisCountMinSketch}, ns_key, metadata);
+}
+
+std::string CountMinSketch::getSegmentKey(const Slice &ns_key, const CountMinSketchMetadata &metadata,
+                                          uint32_t segment_index) {
+  std::string sub_key;
+  PutFixed32(&sub_key, segment_index);
+  return InternalKey(ns_key, sub_key, metadata.version, storage_->IsSlotIdEncoded()).Encode();
+}
+
+void CountMinSketch::getCounterIndexes(const CountMinSketchMetadata &metadata, const std::vector<Slice> &items,
+                                       std::vector<uint64_t> *indexes) {
+  indexes->reserve(items.size() * metadata.depth);
+  for (const auto &item : items) {
+    // The rows are independent enough with the double hashing of Kirsch and Mitzenmacher,
+    // so an item is hashed once instead of once per row.
+    uint64_t hash = XXH3_64bits(item.data(), item.size());
+    auto h1 = static_cast<uint32_t>(hash), h2 = static_cast<uint32_t>(hash >> 32);
+    for (uint32_t row = 0; row < metadata.depth; ++row) {
+      uint64_t column = (h1 + static_cast<uint64_t>(row) * h2) % metadata.width;
+      indexes->push_back(static_cast<uint64_t>(row) * metadata.width + column);
+    }
+  }
+}
+
+rocksdb::Status CountMinSketch::getSegments(engine::Context &ctx, const Slice &ns_key,
+                                            const CountMinSketchMetadata &metadata,
+                                            const std::vector<uint64_t> &indexes, SegmentMap *segments) {
+  std::vector<uint32_t> segment_indexes;
+  segment_indexes.reserve(indexes.size());
+  for (uint64_t index : indexes) {
+    segment_indexes.push_back(static_cast<uint32_t>(index / kCMSSegmentCounters));
+  }
+  std::sort(segment_indexes.begin(), segment_indexes.end());
+  segment_indexes.erase(std::unique(segment_indexes.begin(), segment_indexes.end()), segment_indexes.end());
+
+  std::vector<std::string> segment_keys;
+  std::vector<rocksdb::Slice> segment_key_slices;
+  segment_keys.reserve(segment_indexes.size());
+  segment_key_slices.reserve(segment_indexes.size());
+  for (uint32_t segment_index : segment_indexes) {
+    segment_keys.push_back(getSegmentKey(ns_key, metadata, segment_index));
+    segment_key_slices.emplace_back(segment_keys.back());
+  }
+  std::vector<rocksdb::PinnableSlice> values(segment_keys.size());
+  std::vector<rocksdb::Status> statuses(segment_keys.size());
+  storage_->MultiGet(ctx, ctx.DefaultMultiGetOptions(), storage_->GetDB()->DefaultColumnFamily(),
+                     segment_key_slices.size(), segment_key_slices.data(), values.data(), statuses.data());
+
+  uint64_t num_counters = static_cast<uint64_t>(metadata.width) * metadata.depth;
+  for (size_t i = 0; i < segment_indexes.size(); ++i) {
+    if (!statuses[i].ok() && !statuses[i].IsNotFound()) return statuses[i];
+
+    uint64_t segment_offset = static_cast<uint64_t>(segment_indexes[i]) * kCMSSegmentCounters;
+    uint64_t segment_counters = std::min<uint64_t>(kCMSSegmentCounters, num_counters - segment_offset);
+    std::string &segment = (*segments)[segment_indexes[i]];
+    segment = values[i].ToString();
+    segment.resize(segment_counters * sizeof(uint32_t), 0);
+  }
+  return rocksdb::Status::OK();
+}
+
+uint32_t CountMinSketch::getCounter(const SegmentMap &segments, uint64_t index) {
+  const std::string &segment = segments.at(static_cast<uint32_t>(index / kCMSSegmentCounters));
+  return DecodeFixed32(segment.data() + (index % kCMSSegmentCounters) * sizeof(uint32_t));
+}
+
+void CountMinSketch::setCounter(SegmentMap *segments, uint64_t index, uint32_t value) {
+  std::string &segment = segments->at(static_cast<uint32_t>(index / kCMSSegmentCounters));
+  EncodeFixed32(segment.data() + (index % kCMSSegmentCounters) * sizeof(uint32_t), value);
+}
+
+rocksdb::Status CountMinSketch::InitByDim(engine::Context &ctx, const Slice &user_key, uint32_t width,
+                                          uint32_t depth) {
+  if (width == 0 || depth == 0 || static_cast<uint64_t>(width) * depth > kCMSMaxCounters) {
+    return rocksdb::Status::InvalidArgument("invalid width or depth");
+  }
+  std::string ns_key = AppendNamespacePrefix(user_key);
+
+  LockGuard guard(storage_->GetLockManager(), ns_key);
+  CountMinSketchMetadata metadata;
+  rocksdb::Status s = getCMSMetadata(ctx, ns_key, &metadata);
+  if (!s.ok() && !s.IsNotFound()) return s;
+  if (!s.IsNotFound()) {
+    return rocksdb::Status::InvalidArgument("the key already exists");
+  }
+
+  metadata.width = width;
+  metadata.depth = depth;
+  metadata.count = 0;
+
+  auto batch = storage_->GetWriteBatchBase();
+  WriteBatchLogData log_data(kRedisCountMinSketch);
+  s = batch->PutLogData(log_data.Encode());
+  if (!s.ok()) return s;
+
+  std::string bytes;
+  metadata.Encode(&bytes);
+  s = batch->Put(metadata_cf_handle_, ns_key, bytes);
+  if (!s.ok()) return s;
+  return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+}
+
+rocksdb::Status CountMinSketch::IncrBy(engine::Context &ctx, const Slice &user_key,
+                                       const std::vector<std::pair<std::string, uint32_t>> &increments,
+                                       std::vector<uint32_t> *counts) {
+  std::string ns_key = AppendNamespacePrefix(user_key);
+
+  LockGuard guard(storage_->GetLockManager(), ns_key);
+  CountMinSketchMetadata metadata;
+  rocksdb::Status s = getCMSMetadata(ctx, ns_key, &metadata);
+  if (!s.ok()) return s;
+
+  std::vector<Slice> items;
+  items.reserve(increments.size());
+  for (const auto &[item, _] : increments) items.emplace_back(item);
+  std::vector<uint64_t> indexes;
+  getCounterIndexes(metadata, items, &indexes);
+
+  SegmentMap segments;
+  s = getSegments(ctx, ns_key, metadata, indexes, &segments);
+  if (!s.ok()) return s;
+
+  // all the increments are applied to the segments in memory, so they are written with one batch
+  counts->resize(increments.size());
+  for (size_t i = 0; i < increments.size(); ++i) {
+    uint32_t count = UINT32_MAX;
+    for (uint32_t row = 0; row < metadata.depth; ++row) {
+      uint64_t index = indexes[i * metadata.depth + row];
+      uint32_t counter = getCounter(segments, index);
+      if (counter > UINT32_MAX - increments[i].second) {
+        return rocksdb::Status::InvalidArgument("INCRBY overflow");
+      }
+      counter += increments[i].second;
+      setCounter(&segments, index, counter);
+      count = std::min(count, counter);
+    }
+    (*counts)[i] = count;
+    metadata.count += increments[i].second;
+  }
+
+  auto batch = storage_->GetWriteBatchBase();
+  WriteBatchLogData log_data(kRedisCountMinSketch);
+  s = batch->PutLogData(log_data.Encode());
+  if (!s.ok()) return s;
+
+  std::string bytes;
+  metadata.Encode(&bytes);
+  s = batch->Put(metadata_cf_handle_, ns_key, bytes);
+  if (!s.ok()) return s;
+  for (const auto &[segment_index, segment] : segments) {
+    s = batch->Put(getSegmentKey(ns_key, metadata, segment_index), segment);
+    if (!s.ok()) return s;
+  }
+  return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+}
+
+rocksdb::Status CountMinSketch::Query(engine::Context &ctx, const Slice &user_key,
+                                      const std::vector<std::string> &items, std::vector<uint32_t> *counts) {
+  std::string ns_key = AppendNamespacePrefix(user_key);
+
+  CountMinSketchMetadata metadata;
+  rocksdb::Status s = getCMSMetadata(ctx, ns_key, &metadata);
+  if (!s.ok()) return s;
+
+  std::vector<Slice> item_slices(items.begin(), items.end());
+  std::vector<uint64_t> indexes;
+  getCounterIndexes(metadata, item_slices, &indexes);
+
+  SegmentMap segments;
+  s = getSegments(ctx, ns_key, metadata, indexes, &segments);
+  if (!s.ok()) return s;
+
+  counts->resize(items.size());
+  for (size_t i = 0; i < items.size(); ++i) {
+    uint32_t count = UINT32_MAX;
+    for (uint32_t row = 0; row < metadata.depth; ++row) {
+      count = std::min(count, getCounter(segments, indexes[i * metadata.depth + row]));
+    }
+    (*counts)[i] = count;
+  }
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status CountMinSketch::Info(engine::Context &ctx, const Slice &user_key, CMSInfo *info) {
+  std::string ns_key = AppendNamespacePrefix(user_key);
+
+  CountMinSketchMetadata metadata;
+  rocksdb::Status s = getCMSMetadata(ctx, ns_key, &metadata);
+  if (!s.ok()) return s;
+
+  info->width = metadata.width;
+  info->depth = metadata.depth;
+  info->count = metadata.count;
+  return rocksdb::Status::OK();
+}
+
+}  // namespace redis
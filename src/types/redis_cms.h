@@ -0,0 +1,80 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "storage/redis_db.h"
+#include "storage/redis_metadata.h"
+
+namespace redis {
+
+/// The counters are stored in subkeys of kCMSSegmentCounters 32-bit counters each,
+/// row after row, and the segments without any count are not stored.
+constexpr uint32_t kCMSSegmentCounters = 1024;
+
+/// width * depth can't be larger than this, so the segment index fits in 32 bits.
+constexpr uint64_t kCMSMaxCounters = UINT32_MAX;
+
+struct CMSInfo {
+  uint32_t width;
+  uint32_t depth;
+  uint64_t count;
+};
+
+/// The count-min sketch compatible with the CMS.* commands of RedisBloom.
+class CountMinSketch : public Database {
+ public:
+  CountMinSketch(engine::Storage *storage, const std::string &ns) : Database(storage, ns) {}
+  rocksdb::Status InitByDim(engine::Context &ctx, const Slice &user_key, uint32_t width, uint32_t depth);
+  /// Add the increments and return the estimated count of each item after it.
+  rocksdb::Status IncrBy(engine::Context &ctx, const Slice &user_key,
+                         const std::vector<std::pair<std::string, uint32_t>> &increments,
+                         std::vector<uint32_t> *counts);
+  rocksdb::Status Query(engine::Context &ctx, const Slice &user_key, const std::vector<std::string> &items,
+                        std::vector<uint32_t> *counts);
+  rocksdb::Status Info(engine::Context &ctx, const Slice &user_key, CMSInfo *info);
+
+  /// The dimensions which overestimate the count by at most error * total count with the given probability,
+  /// the same as CMS.INITBYPROB of RedisBloom. It fails if they would exceed kCMSMaxCounters counters.
+  static rocksdb::Status DimensionsByProb(double error, double probability, uint32_t *width, uint32_t *depth);
+
+ private:
+  /// The segments read by a command, keyed by the segment index
+  using SegmentMap = std::map<uint32_t, std::string>;
+
+  rocksdb::Status getCMSMetadata(engine::Context &ctx, const Slice &ns_key, CountMinSketchMetadata *metadata);
+  std::string getSegmentKey(const Slice &ns_key, const CountMinSketchMetadata &metadata, uint32_t segment_index);
+
+  /// Hash each item once and derive its counter in every row from the hash, depth indexes per item.
+  static void getCounterIndexes(const CountMinSketchMetadata &metadata, const std::vector<Slice> &items,
+                                std::vector<uint64_t> *indexes);
+  /// Read the segments of the counter indexes with one MultiGet.
+  rocksdb::Status getSegments(engine::Context &ctx, const Slice &ns_key, const CountMinSketchMetadata &metadata,
+                              const std::vector<uint64_t> &indexes, SegmentMap *segments);
+  static uint32_t getCounter(const SegmentMap &segments, uint64_t index);
+  static void setCounter(SegmentMap *segments, uint64_t index, uint32_t value);
+};
+
+}  // namespace redis
@@ -0,0 +1,393 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "redis_cuckoo_filter.h"
+
+#include <algorithm>
+
+#include "xxh3.h"
+
+namespace redis {
+
+namespace {
+
+// Round up to a power of 2, so the alternate bucket of the alternate bucket is the bucket itself
+uint64_t RoundUpPower2(uint64_t n) {
+  uint64_t power = 1;
+  while (power < n) power <<= 1;
+  return power;
+}
+
+}  // namespace
+
+CuckooFilter::Lookup CuckooFilter::getLookup(const std::string &item) {
+  uint64_t hash = XXH64(item.data(), item.size(), /*seed=*/0);
+  // The fingerprint 0 marks an empty slot
+  auto fingerprint = static_cast<uint8_t>(hash % 255 + 1);
+  return {fingerprint, hash, getAltHash(fingerprint, hash)};
+}
+
+uint64_t CuckooFilter::getAltHash(uint8_t fingerprint, uint64_t index) {
+  return index ^ (static_cast<uint64_t>(fingerprint) * 0x5bd1e995);
+}
+
+void CuckooFilter::initMetadata(const CuckooFilterReserveOptions &options, CuckooFilterMetadata *metadata) {
+  uint64_t num_buckets = std::max<uint64_t>(1, options.capacity / options.bucket_size);
+  metadata->num_buckets = static_cast<uint32_t>(std::min<uint64_t>(RoundUpPower2(num_buckets), 1U << 31));
+  metadata->n_filters = 1;
+  metadata->bucket_size = options.bucket_size;
+  metadata->max_iterations = options.max_iterations;
+  metadata->expansion = options.expansion == 0 ? 0 : static_cast<uint16_t>(RoundUpPower2(options.expansion));
+  metadata->num_deletes = 0;
+  metadata->size = 0;
+}
+
+rocksdb::Status CuckooFilter::getCuckooFilterMetadata(engine::Context &ctx, const Slice &ns_key,
+                                                      CuckooFilterMetadata *metadata) {
+  return Database::GetMetadata(ctx, {kRedisCuckooFilter}, ns_key, metadata);
+}
+
+std::string CuckooFilter::getSegmentKey(const Slice &ns_key, const CuckooFilterMetadata &metadata,
+                                        uint16_t filter_index, uint32_t segment_index) {
+  std::string sub_key;
+  PutFixed16(&sub_key, filter_index);
+  PutFixed32(&sub_key, segment_index);
+  return InternalKey(ns_key, sub_key, metadata.version, storage_->IsSlotIdEncoded()).Encode();
+}
+
+rocksdb::Status CuckooFilter::getBucket(engine::Context &ctx, const Slice &ns_key, const CuckooFilterMetadata &metadata,
+                                        uint16_t filter_index, uint64_t hash, SegmentMap *segments,
+                                        uint8_t **bucket) {
+  uint64_t filter_buckets = metadata.GetFilterBuckets(filter_index);
+  uint64_t bucket_index = hash & (filter_buckets - 1);
+  auto segment_index = static_cast<uint32_t>(bucket_index / kCFSegmentBuckets);
+
+  auto [iter, inserted] = segments->try_emplace({filter_index, segment_index});
+  Segment &segment = iter->second;
+  if (inserted) {
+    // The segments without any fingerprint are not stored
+    std::string segment_key = getSegmentKey(ns_key, metadata, filter_index, segment_index);
+    auto s = storage_->Get(ctx, ctx.GetReadOptions(), segment_key, &segment.data);
+    if (!s.ok() && !s.IsNotFound()) {
+      segments->erase(iter);
+      return s;
+    }
+    uint64_t segment_offset = static_cast<uint64_t>(segment_index) * kCFSegmentBuckets;
+    uint64_t segment_buckets = std::min<uint64_t>(kCFSegmentBuckets, filter_buckets - segment_offset);
+    segment.data.resize(segment_buckets * metadata.bucket_size, 0);
+    segment.origin = segment.data;
+  }
+
+  uint64_t bucket_offset = (bucket_index % kCFSegmentBuckets) * metadata.bucket_size;
+  *bucket = reinterpret_cast<uint8_t *>(segment.data.data()) + bucket_offset;
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status CuckooFilter::writeSegments(const Slice &ns_key, const CuckooFilterMetadata &metadata,
+                                            const SegmentMap &segments, engine::WriteBatchBasePtr &batch) {
+  for (const auto &[index, segment] : segments) {
+    if (segment.data == segment.origin) continue;
+
+    std::string segment_key = getSegmentKey(ns_key, metadata, index.first, index.second);
+    auto s = segment.data.find_first_not_of('\0') == std::string::npos ? batch->Delete(segment_key)
+                                                                        : batch->Put(segment_key, segment.data);
+    if (!s.ok()) return s;
+  }
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status CuckooFilter::countFingerprint(engine::Context &ctx, const Slice &ns_key,
+                                               const CuckooFilterMetadata &metadata, const Lookup &lookup,
+                                               bool stop_at_first, SegmentMap *segments, uint64_t *count) {
+  *count = 0;
+  for (int i = metadata.n_filters - 1; i >= 0; --i) {
+    uint8_t *bucket1 = nullptr, *bucket2 = nullptr;
+    auto s = getBucket(ctx, ns_key, metadata, i, lookup.h1, segments, &bucket1);
+    if (!s.ok()) return s;
+    s = getBucket(ctx, ns_key, metadata, i, lookup.h2, segments, &bucket2);
+    if (!s.ok()) return s;
+
+    *count += std::count(bucket1, bucket1 + metadata.bucket_size, lookup.fingerprint);
+    if (bucket2 != bucket1) *count += std::count(bucket2, bucket2 + metadata.bucket_size, lookup.fingerprint);
+    if (stop_at_first && *count > 0) break;
+  }
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status CuckooFilter::insertFingerprint(engine::Context &ctx, const Slice &ns_key,
+                                                CuckooFilterMetadata *metadata, const Lookup &lookup,
+                                                SegmentMap *segments, bool *inserted) {
+  *inserted = false;
+  // a free slot in any sub-filter is taken before kicking out the fingerprints of the last one
+  for (int i = metadata->n_filters - 1; i >= 0; --i) {
+    for (uint64_t hash : {lookup.h1, lookup.h2}) {
+      uint8_t *bucket = nullptr;
+      auto s = getBucket(ctx, ns_key, *metadata, i, hash, segments, &bucket);
+      if (!s.ok()) return s;
+      uint8_t *slot = std::find(bucket, bucket + metadata->bucket_size, 0);
+      if (slot != bucket + metadata->bucket_size) {
+        *slot = lookup.fingerprint;
+        *inserted = true;
+        return rocksdb::Status::OK();
+      }
+    }
+  }
+
+  auto s = kickOutInsert(ctx, ns_key, *metadata, lookup, segments, inserted);
+  if (!s.ok() || *inserted) return s;
+
+  uint64_t next_filter_buckets = metadata->GetFilterBuckets(metadata->n_filters - 1) * metadata->expansion;
+  if (!metadata->IsScaling() || metadata->n_filters == UINT16_MAX || next_filter_buckets > kCFMaxFilterBuckets) {
+    return rocksdb::Status::OK();
+  }
+
+  // the new sub-filter is empty, so the fingerprint always fits in its first bucket
+  metadata->n_filters += 1;
+  uint8_t *bucket = nullptr;
+  s = getBucket(ctx, ns_key, *metadata, metadata->n_filters - 1, lookup.h1, segments, &bucket);
+  if (!s.ok()) return s;
+  bucket[0] = lookup.fingerprint;
+  *inserted = true;
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status CuckooFilter::kickOutInsert(engine::Context &ctx, const Slice &ns_key,
+                                            const CuckooFilterMetadata &metadata, const Lookup &lookup,
+                                            SegmentMap *segments, bool *inserted) {
+  uint16_t filter_index = metadata.n_filters - 1;
+  uint8_t fingerprint = lookup.fingerprint;
+  uint64_t index = lookup.h1;
+  uint8_t victim = 0;
+  // the fingerprints are put back when the kick-outs run out, so a failed insert changes nothing
+  std::vector<std::pair<uint8_t *, uint8_t>> swapped;
+  swapped.reserve(metadata.max_iterations);
+
+  *inserted = false;
+  for (uint16_t n = 0; n < metadata.max_iterations; ++n) {
+    uint8_t *bucket = nullptr;
+    auto s = getBucket(ctx, ns_key, metadata, filter_index, index, segments, &bucket);
+    if (!s.ok()) return s;
+    swapped.emplace_back(bucket + victim, bucket[victim]);
+    std::swap(bucket[victim], fingerprint);
+
+    // the kicked out fingerprint moves to its other bucket
+    index = getAltHash(fingerprint, index);
+    s = getBucket(ctx, ns_key, metadata, filter_index, index, segments, &bucket);
+    if (!s.ok()) return s;
+    uint8_t *slot = std::find(bucket, bucket + metadata.bucket_size, 0);
+    if (slot != bucket + metadata.bucket_size) {
+      *slot = fingerprint;
+      *inserted = true;
+      return rocksdb::Status::OK();
+    }
+    victim = (victim + 1) % metadata.bucket_size;
+  }
+
+  for (auto iter = swapped.rbegin(); iter != swapped.rend(); ++iter) {
+    *iter->first = iter->second;
+  }
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status CuckooFilter::Reserve(engine::Context &ctx, const Slice &user_key,
+                                      const CuckooFilterReserveOptions &options) {
+  std::string ns_key = AppendNamespacePrefix(user_key);
+
+  LockGuard guard(storage_->GetLockManager(), ns_key);
+  CuckooFilterMetadata metadata;
+  rocksdb::Status s = getCuckooFilterMetadata(ctx, ns_key, &metadata);
+  if (!s.ok() && !s.IsNotFound()) return s;
+  if (!s.IsNotFound()) {
+    return rocksdb::Status::InvalidArgument("the key already exists");
+  }
+
+  initMetadata(options, &metadata);
+
+  auto batch = storage_->GetWriteBatchBase();
+  WriteBatchLogData log_data(kRedisCuckooFilter);
+  s = batch->PutLogData(log_data.Encode());
+  if (!s.ok()) return s;
+
+  std::string bytes;
+  metadata.Encode(&bytes);
+  s = batch->Put(metadata_cf_handle_, ns_key, bytes);
+  if (!s.ok()) return s;
+  return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+}
+
+rocksdb::Status CuckooFilter::Add(engine::Context &ctx, const Slice &user_key, const std::string &item,
+                                  bool no_exist, CuckooFilterAddResult *ret) {
+  std::string ns_key = AppendNamespacePrefix(user_key);
+
+  LockGuard guard(storage_->GetLockManager(), ns_key);
+  CuckooFilterMetadata metadata;
+  rocksdb::Status s = getCuckooFilterMetadata(ctx, ns_key, &metadata);
+  if (s.IsNotFound()) {
+    initMetadata(CuckooFilterReserveOptions{}, &metadata);
+  } else if (!s.ok()) {
+    return s;
+  }
+
+  Lookup lookup = getLookup(item);
+  SegmentMap segments;
+  if (no_exist) {
+    uint64_t count = 0;
+    s = countFingerprint(ctx, ns_key, metadata, lookup, /*stop_at_first=*/true, &segments, &count);
+    if (!s.ok()) return s;
+    if (count > 0) {
+      *ret = CuckooFilterAddResult::kExist;
+      return rocksdb::Status::OK();
+    }
+  }
+
+  bool inserted = false;
+  s = insertFingerprint(ctx, ns_key, &metadata, lookup, &segments, &inserted);
+  if (!s.ok()) return s;
+  if (!inserted) {
+    *ret = CuckooFilterAddResult::kFull;
+    return rocksdb::Status::OK();
+  }
+  metadata.size += 1;
+
+  auto batch = storage_->GetWriteBatchBase();
+  WriteBatchLogData log_data(kRedisCuckooFilter);
+  s = batch->PutLogData(log_data.Encode());
+  if (!s.ok()) return s;
+
+  std::string bytes;
+  metadata.Encode(&bytes);
+  s = batch->Put(metadata_cf_handle_, ns_key, bytes);
+  if (!s.ok()) return s;
+  s = writeSegments(ns_key, metadata, segments, batch);
+  if (!s.ok()) return s;
+
+  *ret = CuckooFilterAddResult::kOk;
+  return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+}
+
+rocksdb::Status CuckooFilter::Remove(engine::Context &ctx, const Slice &user_key, const std::string &item,
+                                     bool *deleted) {
+  *deleted = false;
+  std::string ns_key = AppendNamespacePrefix(user_key);
+
+  LockGuard guard(storage_->GetLockManager(), ns_key);
+  CuckooFilterMetadata metadata;
+  rocksdb::Status s = getCuckooFilterMetadata(ctx, ns_key, &metadata);
+  if (!s.ok()) return s;
+
+  Lookup lookup = getLookup(item);
+  SegmentMap segments;
+  for (int i = metadata.n_filters - 1; i >= 0 && !*deleted; --i) {
+    for (uint64_t hash : {lookup.h1, lookup.h2}) {
+      uint8_t *bucket = nullptr;
+      s = getBucket(ctx, ns_key, metadata, i, hash, &segments, &bucket);
+      if (!s.ok()) return s;
+      uint8_t *slot = std::find(bucket, bucket + metadata.bucket_size, lookup.fingerprint);
+      if (slot != bucket + metadata.bucket_size) {
+        *slot = 0;
+        *deleted = true;
+        break;
+      }
+    }
+  }
+  if (!*deleted) return rocksdb::Status::OK();
+
+  metadata.size -= 1;
+  metadata.num_deletes += 1;
+
+  auto batch = storage_->GetWriteBatchBase();
+  WriteBatchLogData log_data(kRedisCuckooFilter);
+  s = batch->PutLogData(log_data.Encode());
+  if (!s.ok()) return s;
+
+  std::string bytes;
+  metadata.Encode(&bytes);
+  s = batch->Put(metadata_cf_handle_, ns_key, bytes);
+  if (!s.ok()) return s;
+  s = writeSegments(ns_key, metadata, segments, batch);
+  if (!s.ok()) return s;
+  return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+}
+
+rocksdb::Status CuckooFilter::Exists(engine::Context &ctx, const Slice &user_key, const std::string &item,
+                                     bool *exist) {
+  std::vector<bool> tmp{false};
+  rocksdb::Status s = MExists(ctx, user_key, {item}, &tmp);
+  *exist = tmp[0];
+  return s;
+}
+
+rocksdb::Status CuckooFilter::MExists(engine::Context &ctx, const Slice &user_key,
+                                      const std::vector<std::string> &items, std::vector<bool> *exists) {
+  std::string ns_key = AppendNamespacePrefix(user_key);
+
+  CuckooFilterMetadata metadata;
+  rocksdb::Status s = getCuckooFilterMetadata(ctx, ns_key, &metadata);
+  if (s.IsNotFound()) {
+    std::fill(exists->begin(), exists->end(), false);
+    return rocksdb::Status::OK();
+  }
+  if (!s.ok()) return s;
+
+  // the items share the segments, so each segment is read once per command
+  SegmentMap segments;
+  for (size_t i = 0; i < items.size(); ++i) {
+    uint64_t count = 0;
+    s = countFingerprint(ctx, ns_key, metadata, getLookup(items[i]), /*stop_at_first=*/true, &segments, &count);
+    if (!s.ok()) return s;
+    (*exists)[i] = count > 0;
+  }
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status CuckooFilter::Count(engine::Context &ctx, const Slice &user_key, const std::string &item,
+                                    uint64_t *count) {
+  *count = 0;
+  std::string ns_key = AppendNamespacePrefix(user_key);
+
+  CuckooFilterMetadata metadata;
+  rocksdb::Status s = getCuckooFilterMetadata(ctx, ns_key, &metadata);
+  if (s.IsNotFound()) return rocksdb::Status::OK();
+  if (!s.ok()) return s;
+
+  SegmentMap segments;
+  return countFingerprint(ctx, ns_key, metadata, getLookup(item), /*stop_at_first=*/false, &segments, count);
+}
+
+rocksdb::Status CuckooFilter::Info(engine::Context &ctx, const Slice &user_key, CuckooFilterInfo *info) {
+  std::string ns_key = AppendNamespacePrefix(user_key);
+
+  CuckooFilterMetadata metadata;
+  rocksdb::Status s = getCuckooFilterMetadata(ctx, ns_key, &metadata);
+  if (!s.ok()) return s;
+
+  info->bytes = metadata.GetBytes();
+  info->num_buckets = metadata.num_buckets;
+  info->n_filters = metadata.n_filters;
+  info->num_items = metadata.size;
+  info->num_deletes = metadata.num_deletes;
+  info->bucket_size = metadata.bucket_size;
+  info->expansion = metadata.expansion;
+  info->max_iterations = metadata.max_iterations;
+
+  return rocksdb::Status::OK();
+}
+
+}  // namespace redis
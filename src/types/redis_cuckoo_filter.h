@@ -0,0 +1,127 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "storage/redis_db.h"
+#include "storage/redis_metadata.h"
+
+namespace redis {
+
+const uint32_t kCFDefaultCapacity = 1024;
+const uint8_t kCFDefaultBucketSize = 2;
+const uint16_t kCFDefaultMaxIterations = 20;
+const uint16_t kCFDefaultExpansion = 1;
+const uint16_t kCFMaxExpansion = 32768;
+
+/// The buckets of a sub-filter are stored in subkeys of kCFSegmentBuckets buckets each,
+/// so adding or deleting an item usually rewrites a single segment.
+constexpr uint32_t kCFSegmentBuckets = 1024;
+
+/// A sub-filter can't have more buckets than this, so the filter is full when the next one would.
+constexpr uint64_t kCFMaxFilterBuckets = 1ULL << 32;
+
+enum class CuckooFilterAddResult {
+  kOk,
+  kExist,
+  kFull,
+};
+
+struct CuckooFilterReserveOptions {
+  uint32_t capacity = kCFDefaultCapacity;
+  uint8_t bucket_size = kCFDefaultBucketSize;
+  uint16_t max_iterations = kCFDefaultMaxIterations;
+  uint16_t expansion = kCFDefaultExpansion;
+};
+
+struct CuckooFilterInfo {
+  uint64_t bytes;
+  uint32_t num_buckets;
+  uint16_t n_filters;
+  uint64_t num_items;
+  uint64_t num_deletes;
+  uint8_t bucket_size;
+  uint16_t expansion;
+  uint16_t max_iterations;
+};
+
+/// The cuckoo filter compatible with the CF.* commands of RedisBloom. Each item is kept as an 8-bit
+/// fingerprint in one of its two candidate buckets, so unlike the bloom filter it can be deleted.
+class CuckooFilter : public Database {
+ public:
+  CuckooFilter(engine::Storage *storage, const std::string &ns) : Database(storage, ns) {}
+  rocksdb::Status Reserve(engine::Context &ctx, const Slice &user_key, const CuckooFilterReserveOptions &options);
+  /// Add the item and create the filter with the default options if it doesn't exist.
+  ///
+  /// no_exist: only add the item when it's not in the filter yet, like CF.ADDNX
+  rocksdb::Status Add(engine::Context &ctx, const Slice &user_key, const std::string &item, bool no_exist,
+                      CuckooFilterAddResult *ret);
+  rocksdb::Status Remove(engine::Context &ctx, const Slice &user_key, const std::string &item, bool *deleted);
+  rocksdb::Status Exists(engine::Context &ctx, const Slice &user_key, const std::string &item, bool *exist);
+  rocksdb::Status MExists(engine::Context &ctx, const Slice &user_key, const std::vector<std::string> &items,
+                          std::vector<bool> *exists);
+  rocksdb::Status Count(engine::Context &ctx, const Slice &user_key, const std::string &item, uint64_t *count);
+  rocksdb::Status Info(engine::Context &ctx, const Slice &user_key, CuckooFilterInfo *info);
+
+ private:
+  struct Lookup {
+    uint8_t fingerprint;
+    uint64_t h1;
+    uint64_t h2;
+  };
+
+  struct Segment {
+    std::string data;
+    // The data as read, so only the segments changed by a command are written back
+    std::string origin;
+  };
+
+  /// The segments read by a command, keyed by (filter index, segment index)
+  using SegmentMap = std::map<std::pair<uint16_t, uint32_t>, Segment>;
+
+  static Lookup getLookup(const std::string &item);
+  static uint64_t getAltHash(uint8_t fingerprint, uint64_t index);
+  static void initMetadata(const CuckooFilterReserveOptions &options, CuckooFilterMetadata *metadata);
+
+  rocksdb::Status getCuckooFilterMetadata(engine::Context &ctx, const Slice &ns_key, CuckooFilterMetadata *metadata);
+  std::string getSegmentKey(const Slice &ns_key, const CuckooFilterMetadata &metadata, uint16_t filter_index,
+                            uint32_t segment_index);
+
+  /// Get the bucket of the hash in the sub-filter, reading its segment into segments when it's not there yet.
+  rocksdb::Status getBucket(engine::Context &ctx, const Slice &ns_key, const CuckooFilterMetadata &metadata,
+                            uint16_t filter_index, uint64_t hash, SegmentMap *segments, uint8_t **bucket);
+  rocksdb::Status writeSegments(const Slice &ns_key, const CuckooFilterMetadata &metadata,
+                                const SegmentMap &segments, engine::WriteBatchBasePtr &batch);
+
+  rocksdb::Status countFingerprint(engine::Context &ctx, const Slice &ns_key, const CuckooFilterMetadata &metadata,
+                                   const Lookup &lookup, bool stop_at_first, SegmentMap *segments, uint64_t *count);
+  /// metadata: [in/out] A new sub-filter is added to the metadata when the item doesn't fit in the last one.
+  rocksdb::Status insertFingerprint(engine::Context &ctx, const Slice &ns_key, CuckooFilterMetadata *metadata,
+                                    const Lookup &lookup, SegmentMap *segments, bool *inserted);
+  rocksdb::Status kickOutInsert(engine::Context &ctx, const Slice &ns_key, const CuckooFilterMetadata &metadata,
+                                const Lookup &lookup, SegmentMap *segments, bool *inserted);
+};
+
+}  // namespace redis
@@ -20,13 +20,20 @@
 
 #include "redis_geo.h"
 
+#include <glog/logging.h>
+
 #include <algorithm>
+#include <thread>
+
+#include "db_util.h"
+#include "thread_util.h"
 
 namespace redis {
 
 rocksdb::Status Geo::Add(engine::Context &ctx, const Slice &user_key, std::vector<GeoPoint> *geo_points,
                          uint64_t *added_cnt) {
   std::vector<MemberScore> member_scores;
+  member_scores.reserve(geo_points->size());
   for (const auto &geo_point : *geo_points) {
     /* Turn the coordinates into the score of the element. */
     GeoHashBits hash;
@@ -80,7 +87,8 @@ rocksdb::Status Geo::Pos(engine::Context &ctx, const Slice &user_key, const std:
 
 rocksdb::Status Geo::Radius(engine::Context &ctx, const Slice &user_key, double longitude, double latitude,
                             double radius_meters, int count, DistanceSort sort, const std::string &store_key,
-                            bool store_distance, double unit_conversion, std::vector<GeoPoint> *geo_points) {
+                            bool store_distance, double unit_conversion, std::vector<GeoPoint> *geo_points,
+                            uint64_t *stored_cnt) {
   GeoShape geo_shape;
   geo_shape.type = kGeoShapeTypeCircular;
   geo_shape.xy[0] = longitude;
@@ -90,31 +98,35 @@ rocksdb::Status Geo::Radius(engine::Context &ctx, const Slice &user_key, double
 
   std::string dummy_member;
   return SearchStore(ctx, user_key, geo_shape, kLongLat, dummy_member, count, sort, store_key, store_distance,
-                     unit_conversion, geo_points);
+                     unit_conversion, geo_points, stored_cnt);
 }
 
 rocksdb::Status Geo::RadiusByMember(engine::Context &ctx, const Slice &user_key, const Slice &member,
                                     double radius_meters, int count, DistanceSort sort, const std::string &store_key,
-                                    bool store_distance, double unit_conversion, std::vector<GeoPoint> *geo_points) {
+                                    bool store_distance, double unit_conversion, std::vector<GeoPoint> *geo_points,
+                                    uint64_t *stored_cnt) {
+  *stored_cnt = 0;
   GeoPoint geo_point;
   auto s = Get(ctx, user_key, member, &geo_point);
   if (!s.ok()) return s.IsNotFound() ? rocksdb::Status::OK() : s;
 
   return Radius(ctx, user_key, geo_point.longitude, geo_point.latitude, radius_meters, count, sort, store_key,
-                store_distance, unit_conversion, geo_points);
+                store_distance, unit_conversion, geo_points, stored_cnt);
 }
 
 rocksdb::Status Geo::Search(engine::Context &ctx, const Slice &user_key, GeoShape geo_shape, OriginPointType point_type,
                             std::string &member, int count, DistanceSort sort, bool store_distance,
                             double unit_conversion, std::vector<GeoPoint> *geo_points) {
+  uint64_t stored_cnt = 0;
   return SearchStore(ctx, user_key, geo_shape, point_type, member, count, sort, "", store_distance, unit_conversion,
-                     geo_points);
+                     geo_points, &stored_cnt);
 }
 
 rocksdb::Status Geo::SearchStore(engine::Context &ctx, const Slice &user_key, GeoShape geo_shape,
                                  OriginPointType point_type, std::string &member, int count, DistanceSort sort,
                                  const std::string &store_key, bool store_distance, double unit_conversion,
-                                 std::vector<GeoPoint> *geo_points) {
+                                 std::vector<GeoPoint> *geo_points, uint64_t *stored_cnt) {
+  *stored_cnt = 0;
   if (point_type == kMember) {
     GeoPoint geo_point;
     auto s = Get(ctx, user_key, member, &geo_point);
@@ -139,11 +151,35 @@ rocksdb::Status Geo::SearchStore(engine::Context &ctx, const Slice &user_key, Ge
   }
   if (!s.ok()) return s.IsNotFound() ? rocksdb::Status::OK() : s;
 
-  // Get neighbor geohash boxes for radius search
-  GeoHashRadius georadius = GeoHashHelper::GetAreasByShapeWGS84(geo_shape);
+  // Cover the search area with the score ranges of the geohash boxes and get the matching points in them
+  std::vector<GeoHashScoreRange> ranges = GeoHashHelper::GetRangesByShapeWGS84(geo_shape, kGeoSearchMaxBoxes);
+  auto stored_score = [&](const GeoPoint &geo_point) {
+    return store_distance ? geo_point.dist / unit_conversion : geo_point.score;
+  };
+
+  // Without sorting, the points are stored in bounded batches as they're found by the scan of the ranges,
+  // instead of being collected first, and the scan stops after the first count points if count is given
+  if (!store_key.empty() && sort == kSortNone) {
+    LockGuard guard(storage_->GetLockManager(), AppendNamespacePrefix(store_key));
+    return storeMembers(
+        ctx, store_key,
+        [&](const MemberCallback &callback) {
+          uint64_t found = 0;
+          rocksdb::Status store_status;
+          auto scan_s = scanScoreRanges(
+              ctx, ns_key, metadata, ranges.data(), ranges.data() + ranges.size(), geo_shape,
+              [&](GeoPoint &&geo_point) {
+                store_status = callback(geo_point.member, stored_score(geo_point));
+                found++;
+                return store_status.ok() && (count <= 0 || found < static_cast<uint64_t>(count));
+              });
+          return scan_s.ok() ? store_status : scan_s;
+        },
+        stored_cnt);
+  }
 
-  // Get zset for all matching points
-  membersOfAllNeighbors(ctx, user_key, georadius, geo_shape, geo_points);
+  s = membersOfRanges(ctx, ns_key, metadata, ranges, geo_shape, geo_points);
+  if (!s.ok()) return s;
 
   // if no matching results, give empty reply
   if (geo_points->empty()) {
@@ -155,31 +191,30 @@ rocksdb::Status Geo::SearchStore(engine::Context &ctx, const Slice &user_key, Ge
     return rocksdb::Status::OK();
   }
 
-  // process [optional] sorting
-  if (sort == kSortASC) {
-    std::sort(geo_points->begin(), geo_points->end(), sortGeoPointASC);
-  } else if (sort == kSortDESC) {
-    std::sort(geo_points->begin(), geo_points->end(), sortGeoPointDESC);
+  // process [optional] sorting, only the first count points are sorted and kept when count is given
+  if (sort != kSortNone) {
+    auto compare = sort == kSortASC ? sortGeoPointASC : sortGeoPointDESC;
+    if (count > 0 && static_cast<size_t>(count) < geo_points->size()) {
+      auto nth = geo_points->begin() + count;
+      std::nth_element(geo_points->begin(), nth, geo_points->end(), compare);
+      geo_points->erase(nth, geo_points->end());
+    }
+    std::sort(geo_points->begin(), geo_points->end(), compare);
   }
 
-  // storing
+  // storing, the sorted points are kept to count already
   if (!store_key.empty()) {
-    auto result_length = static_cast<int64_t>(geo_points->size());
-    int64_t returned_items_count = (count == 0 || result_length < count) ? result_length : count;
-    if (returned_items_count == 0) {
-      auto s = ZSet::Del(ctx, user_key);
-      if (!s.ok()) return s;
-    } else {
-      std::vector<MemberScore> member_scores;
-      for (const auto &geo_point : *geo_points) {
-        if (returned_items_count-- <= 0) {
-          break;
-        }
-        double score = store_distance ? geo_point.dist / unit_conversion : geo_point.score;
-        member_scores.emplace_back(MemberScore{geo_point.member, score});
-      }
-      ZSet::Overwrite(ctx, store_key, member_scores);
-    }
+    LockGuard guard(storage_->GetLockManager(), AppendNamespacePrefix(store_key));
+    return storeMembers(
+        ctx, store_key,
+        [&](const MemberCallback &callback) {
+          for (const auto &geo_point : *geo_points) {
+            auto put_s = callback(geo_point.member, stored_score(geo_point));
+            if (!put_s.ok()) return put_s;
+          }
+          return rocksdb::Status::OK();
+        },
+        stored_cnt);
   }
   return rocksdb::Status::OK();
 }
@@ -255,113 +290,97 @@ int Geo::decodeGeoHash(double bits, double *xy) {
   return GeohashDecodeToLongLatWGS84(hash, xy);
 }
 
-/* Search all eight neighbors + self geohash box */
-int Geo::membersOfAllNeighbors(engine::Context &ctx, const Slice &user_key, GeoHashRadius n, const GeoShape &geo_shape,
-                               std::vector<GeoPoint> *geo_points) {
-  GeoHashBits neighbors[9];
-  unsigned int last_processed = 0;
-  int count = 0;
-
-  neighbors[0] = n.hash;
-  neighbors[1] = n.neighbors.north;
-  neighbors[2] = n.neighbors.south;
-  neighbors[3] = n.neighbors.east;
-  neighbors[4] = n.neighbors.west;
-  neighbors[5] = n.neighbors.north_east;
-  neighbors[6] = n.neighbors.north_west;
-  neighbors[7] = n.neighbors.south_east;
-  neighbors[8] = n.neighbors.south_west;
-
-  /* For each neighbor (*and* our own hashbox), get all the matching
-   * members and add them to the potential result list. */
-  for (unsigned int i = 0; i < sizeof(neighbors) / sizeof(*neighbors); i++) {
-    if (HASHISZERO(neighbors[i])) {
-      continue;
-    }
+/* Get the points within the search area from the score ranges, which are sorted
+ * and don't overlap. For a large zset, the ranges are split into a few groups
+ * scanned by their own threads, with the iterators on the same snapshot of ctx. */
+rocksdb::Status Geo::membersOfRanges(engine::Context &ctx, const Slice &ns_key, const ZSetMetadata &metadata,
+                                     const std::vector<GeoHashScoreRange> &ranges, const GeoShape &geo_shape,
+                                     std::vector<GeoPoint> *geo_points) {
+  size_t n_groups = metadata.size >= kGeoParallelScanMinSize ? std::min(kGeoParallelScanThreads, ranges.size()) : 1;
+  auto append_to = [](std::vector<GeoPoint> *points) {
+    return [points](GeoPoint &&geo_point) {
+      points->emplace_back(std::move(geo_point));
+      return true;
+    };
+  };
+  if (n_groups <= 1) {
+    return scanScoreRanges(ctx, ns_key, metadata, ranges.data(), ranges.data() + ranges.size(), geo_shape,
+                           append_to(geo_points));
+  }
 
-    /* When a huge Radius (in the 5000 km range or more) is used,
-     * adjacent neighbors can be the same, leading to duplicated
-     * elements. Skip every range which is the same as the one
-     * processed previously. */
-    if (last_processed && neighbors[i].bits == neighbors[last_processed].bits &&
-        neighbors[i].step == neighbors[last_processed].step) {
+  // bounds[i] and bounds[i + 1] are the first and the last range (exclusive) of the i-th group
+  std::vector<size_t> bounds(n_groups + 1);
+  for (size_t i = 0; i <= n_groups; i++) {
+    bounds[i] = i * ranges.size() / n_groups;
+  }
+  std::vector<std::vector<GeoPoint>> group_points(n_groups);
+  std::vector<rocksdb::Status> statuses(n_groups);
+  auto scan_group = [&](size_t i) {
+    statuses[i] = scanScoreRanges(ctx, ns_key, metadata, ranges.data() + bounds[i], ranges.data() + bounds[i + 1],
+                                  geo_shape, append_to(&group_points[i]));
+  };
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < n_groups; i++) {
+    auto t = util::CreateThread("geo-scan", [&, i] { scan_group(i); });
+    if (!t) {
+      // fall back to scan the group in the current thread
+      scan_group(i);
       continue;
     }
-    count += membersOfGeoHashBox(ctx, user_key, neighbors[i], geo_points, geo_shape);
-    last_processed = i;
+    workers.emplace_back(std::move(*t));
+  }
+  scan_group(0);
+  for (auto &worker : workers) {
+    if (auto s = util::ThreadJoin(worker); !s) {
+      LOG(WARNING) << "failed to join the geo scan thread: " << s.Msg();
+    }
   }
-  return count;
-}
-
-/* Obtain all members between the min/max of this geohash bounding box.
- * Populate a GeoArray of GeoPoints by calling getPointsInRange().
- * Return the number of points added to the array. */
-int Geo::membersOfGeoHashBox(engine::Context &ctx, const Slice &user_key, GeoHashBits hash,
-                             std::vector<GeoPoint> *geo_points, const GeoShape &geo_shape) {
-  GeoHashFix52Bits min = 0, max = 0;
-
-  scoresOfGeoHashBox(hash, &min, &max);
-  return getPointsInRange(ctx, user_key, static_cast<double>(min), static_cast<double>(max), geo_shape, geo_points);
-}
 
-/* Compute the sorted set scores min (inclusive), max (exclusive) we should
- * query in order to retrieve all the elements inside the specified area
- * 'hash'. The two scores are returned by reference in *min and *max. */
-void Geo::scoresOfGeoHashBox(GeoHashBits hash, GeoHashFix52Bits *min, GeoHashFix52Bits *max) {
-  /* We want to compute the sorted set scores that will include all the
-   * elements inside the specified GeoHash 'hash', which has as many
-   * bits as specified by hash.step * 2.
-   *
-   * So if step is, for example, 3, and the hash value in binary
-   * is 101010, since our score is 52 bits we want every element which
-   * is in binary: 101010?????????????????????????????????????????????
-   * Where ? can be 0 or 1.
-   *
-   * To get the min score we just use the initial hash value left
-   * shifted enough to get the 52 bit value. Later we increment the
-   * 6 bit prefis (see the hash.bits++ statement), and get the new
-   * prefix: 101011, which we align again to 52 bits to get the maximum
-   * value (which is excluded from the search). So we get everything
-   * between the two following scores (represented in binary):
-   *
-   * 1010100000000000000000000000000000000000000000000000 (included)
-   * and
-   * 1010110000000000000000000000000000000000000000000000 (excluded).
-   */
-  *min = GeoHashHelper::Align52Bits(hash);
-  hash.bits++;
-  *max = GeoHashHelper::Align52Bits(hash);
+  for (size_t i = 0; i < n_groups; i++) {
+    if (!statuses[i].ok()) return statuses[i];
+    geo_points->insert(geo_points->end(), std::make_move_iterator(group_points[i].begin()),
+                       std::make_move_iterator(group_points[i].end()));
+  }
+  return rocksdb::Status::OK();
 }
 
-/* Query a Redis sorted set to extract all the elements between 'min' and
- * 'max', appending them into the array of GeoPoint structures 'gparray'.
- * The command returns the number of elements added to the array.
- *
- * Elements which are farthest than 'radius' from the specified 'x' and 'y'
- * coordinates are not included.
- *
- * The ability of this function to append to an existing set of points is
- * important for good performances because querying by radius is performed
- * using multiple queries to the sorted set, that we later need to sort
- * via qsort. Similarly we need to be able to reject points outside the search
- * radius area ASAP in order to allocate and process more points than needed. */
-int Geo::getPointsInRange(engine::Context &ctx, const Slice &user_key, double min, double max,
-                          const GeoShape &geo_shape, std::vector<GeoPoint> *geo_points) {
-  /* include min in range; exclude max in range */
-  /* That's: min <= val < max */
-  RangeScoreSpec spec;
-  spec.min = min;
-  spec.max = max;
-  spec.maxex = true;
-  uint64_t size = 0;
-  std::vector<MemberScore> member_scores;
-  rocksdb::Status s = ZSet::RangeByScore(ctx, user_key, spec, &member_scores, &size);
-  if (!s.ok()) return 0;
-
-  for (const auto &member_score : member_scores) {
-    appendIfWithinShape(geo_points, geo_shape, member_score.score, member_score.member);
+/* Scan the score ranges [begin, end) with one iterator, seeking to the start
+ * of each range, and pass the points within the search area to the callback. */
+rocksdb::Status Geo::scanScoreRanges(engine::Context &ctx, const Slice &ns_key, const ZSetMetadata &metadata,
+                                     const GeoHashScoreRange *begin, const GeoHashScoreRange *end,
+                                     const GeoShape &geo_shape, const PointCallback &callback) {
+  std::string prefix_key = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
+  std::string next_version_prefix_key =
+      InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
+
+  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  rocksdb::Slice upper_bound(next_version_prefix_key);
+  read_options.iterate_upper_bound = &upper_bound;
+  rocksdb::Slice lower_bound(prefix_key);
+  read_options.iterate_lower_bound = &lower_bound;
+
+  auto iter = util::UniqueIterator(ctx, read_options, score_cf_handle_);
+  for (const auto *range = begin; range != end; range++) {
+    /* include min in range; exclude max in range */
+    auto min = static_cast<double>(range->min), max = static_cast<double>(range->max);
+    std::string start_score_bytes;
+    PutDouble(&start_score_bytes, min);
+    iter->Seek(InternalKey(ns_key, start_score_bytes, metadata.version, storage_->IsSlotIdEncoded()).Encode());
+    for (; iter->Valid() && iter->key().starts_with(prefix_key); iter->Next()) {
+      InternalKey ikey(iter->key(), storage_->IsSlotIdEncoded());
+      Slice score_key = ikey.GetSubKey();
+      double score = NAN;
+      GetDouble(&score_key, &score);
+      if (score >= max) break;
+
+      GeoPoint geo_point;
+      if (!pointWithinShape(geo_shape, score, &geo_point)) continue;
+      geo_point.member = score_key.ToString();
+      if (!callback(std::move(geo_point))) return rocksdb::Status::OK();
+    }
+    if (!iter->status().ok()) return iter->status();
   }
-  return 0;
+  return rocksdb::Status::OK();
 }
 
 /* Helper function for geoGetPointsInRange(): given a sorted set score
@@ -392,8 +411,7 @@ bool Geo::appendIfWithinRadius(std::vector<GeoPoint> *geo_points, double lon, do
   return true;
 }
 
-bool Geo::appendIfWithinShape(std::vector<GeoPoint> *geo_points, const GeoShape &geo_shape, double score,
-                              const std::string &member) {
+bool Geo::pointWithinShape(const GeoShape &geo_shape, double score, GeoPoint *geo_point) {
   double distance = NAN, xy[2];
   if (!decodeGeoHash(score, xy)) return false;
   if (geo_shape.type == kGeoShapeTypeCircular) {
@@ -408,19 +426,15 @@ bool Geo::appendIfWithinShape(std::vector<GeoPoint> *geo_points, const GeoShape
     }
   }
 
-  /* Append the new element. */
-  GeoPoint geo_point;
-  geo_point.longitude = xy[0];
-  geo_point.latitude = xy[1];
-  geo_point.dist = distance;
-  geo_point.member = member;
-  geo_point.score = score;
-  geo_points->emplace_back(geo_point);
+  geo_point->longitude = xy[0];
+  geo_point->latitude = xy[1];
+  geo_point->dist = distance;
+  geo_point->score = score;
   return true;
 }
 
 bool Geo::sortGeoPointASC(const GeoPoint &gp1, const GeoPoint &gp2) { return gp1.dist < gp2.dist; }
 
-bool Geo::sortGeoPointDESC(const GeoPoint &gp1, const GeoPoint &gp2) { return gp1.dist >= gp2.dist; }
+bool Geo::sortGeoPointDESC(const GeoPoint &gp1, const GeoPoint &gp2) { return gp1.dist > gp2.dist; }
 
 }  // namespace redis
@@ -20,6 +20,7 @@
 
 #pragma once
 
+#include <functional>
 #include <limits>
 #include <map>
 #include <string>
@@ -45,6 +46,13 @@ enum DistanceSort {
 
 enum OriginPointType { kNone, kLongLat, kMember };
 
+/* The search area is covered by at most this number of geohash boxes. */
+constexpr size_t kGeoSearchMaxBoxes = 64;
+
+/* The score ranges of the zsets with at least this number of members are scanned by several threads. */
+constexpr uint64_t kGeoParallelScanMinSize = 65536;
+constexpr size_t kGeoParallelScanThreads = 4;
+
 // Structures represent points and array of points on the earth.
 struct GeoPoint {
   double longitude;
@@ -69,35 +77,41 @@ class Geo : public ZSet {
                       std::map<std::string, GeoPoint> *geo_points);
   rocksdb::Status Radius(engine::Context &ctx, const Slice &user_key, double longitude, double latitude,
                          double radius_meters, int count, DistanceSort sort, const std::string &store_key,
-                         bool store_distance, double unit_conversion, std::vector<GeoPoint> *geo_points);
+                         bool store_distance, double unit_conversion, std::vector<GeoPoint> *geo_points,
+                         uint64_t *stored_cnt);
   rocksdb::Status RadiusByMember(engine::Context &ctx, const Slice &user_key, const Slice &member, double radius_meters,
                                  int count, DistanceSort sort, const std::string &store_key, bool store_distance,
-                                 double unit_conversion, std::vector<GeoPoint> *geo_points);
+                                 double unit_conversion, std::vector<GeoPoint> *geo_points, uint64_t *stored_cnt);
   rocksdb::Status Search(engine::Context &ctx, const Slice &user_key, GeoShape geo_shape, OriginPointType point_type,
                          std::string &member, int count, DistanceSort sort, bool store_distance, double unit_conversion,
                          std::vector<GeoPoint> *geo_points);
+  // SearchStore gets the points within the search area into geo_points, or stores them into the zset of
+  // store_key if it isn't empty. Without sorting, the points are stored as they're found by the scan,
+  // so they're never collected into geo_points.
   rocksdb::Status SearchStore(engine::Context &ctx, const Slice &user_key, GeoShape geo_shape,
                               OriginPointType point_type, std::string &member, int count, DistanceSort sort,
                               const std::string &store_key, bool store_distance, double unit_conversion,
-                              std::vector<GeoPoint> *geo_points);
+                              std::vector<GeoPoint> *geo_points, uint64_t *stored_cnt);
   rocksdb::Status Get(engine::Context &ctx, const Slice &user_key, const Slice &member, GeoPoint *geo_point);
   rocksdb::Status MGet(engine::Context &ctx, const Slice &user_key, const std::vector<Slice> &members,
                        std::map<std::string, GeoPoint> *geo_points);
   static std::string EncodeGeoHash(double longitude, double latitude);
 
  private:
+  // PointCallback is called with each point within the search area, and the scan stops once it returns false
+  using PointCallback = std::function<bool(GeoPoint &&geo_point)>;
+
   static int decodeGeoHash(double bits, double *xy);
-  int membersOfAllNeighbors(engine::Context &ctx, const Slice &user_key, GeoHashRadius n, const GeoShape &geo_shape,
-                            std::vector<GeoPoint> *geo_points);
-  int membersOfGeoHashBox(engine::Context &ctx, const Slice &user_key, GeoHashBits hash,
-                          std::vector<GeoPoint> *geo_points, const GeoShape &geo_shape);
-  static void scoresOfGeoHashBox(GeoHashBits hash, GeoHashFix52Bits *min, GeoHashFix52Bits *max);
-  int getPointsInRange(engine::Context &ctx, const Slice &user_key, double min, double max, const GeoShape &geo_shape,
-                       std::vector<GeoPoint> *geo_points);
+  rocksdb::Status membersOfRanges(engine::Context &ctx, const Slice &ns_key, const ZSetMetadata &metadata,
+                                  const std::vector<GeoHashScoreRange> &ranges, const GeoShape &geo_shape,
+                                  std::vector<GeoPoint> *geo_points);
+  rocksdb::Status scanScoreRanges(engine::Context &ctx, const Slice &ns_key, const ZSetMetadata &metadata,
+                                  const GeoHashScoreRange *begin, const GeoHashScoreRange *end,
+                                  const GeoShape &geo_shape, const PointCallback &callback);
   static bool appendIfWithinRadius(std::vector<GeoPoint> *geo_points, double lon, double lat, double radius,
                                    double score, const std::string &member);
-  static bool appendIfWithinShape(std::vector<GeoPoint> *geo_points, const GeoShape &geo_shape, double score,
-                                  const std::string &member);
+  // pointWithinShape decodes the point of the score into geo_point except its member, if it's within the shape
+  static bool pointWithinShape(const GeoShape &geo_shape, double score, GeoPoint *geo_point);
   static bool sortGeoPointASC(const GeoPoint &gp1, const GeoPoint &gp2);
   static bool sortGeoPointDESC(const GeoPoint &gp1, const GeoPoint &gp2);
 };
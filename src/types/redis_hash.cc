@@ -25,12 +25,17 @@
 #include <algorithm>
 #include <cctype>
 #include <cmath>
+#include <map>
 #include <random>
+#include <set>
 #include <utility>
 
 #include "db_util.h"
 #include "parse_util.h"
 #include "sample_helper.h"
+#include "storage/ttl_index.h"
+#include "string_util.h"
+#include "time_util.h"
 
 namespace redis {
 
@@ -38,82 +43,273 @@ rocksdb::Status Hash::GetMetadata(engine::Context &ctx, const Slice &ns_key, Has
   return Database::GetMetadata(ctx, {kRedisHash}, ns_key, metadata);
 }
 
-rocksdb::Status Hash::Size(engine::Context &ctx, const Slice &user_key, uint64_t *size) {
+static auto findInlineField(std::vector<std::pair<std::string, std::string>> &fields, const Slice &field) {
+  return std::lower_bound(fields.begin(), fields.end(), field.ToStringView(),
+                          [](const auto &field_value, std::string_view f) { return field_value.first < f; });
+}
+
+bool Hash::useInline(const HashMetadata &metadata) const {
+  // Only new hashes start with the INLINE encoding, a hash never goes back once it's converted to subkeys
+  return metadata.IsInline() || (metadata.size == 0 && storage_->GetConfig()->hash_max_inline_entries > 0);
+}
+
+rocksdb::Status Hash::getField(engine::Context &ctx, const std::string &ns_key, HashMetadata &metadata,
+                               const Slice &field, std::string *value, uint64_t *expire) {
+  if (expire) *expire = 0;
+  if (metadata.IsInline()) {
+    auto iter = findInlineField(metadata.inline_fields, field);
+    if (iter == metadata.inline_fields.end() || iter->first != field.ToStringView()) {
+      return rocksdb::Status::NotFound();
+    }
+    *value = iter->second;
+    return rocksdb::Status::OK();
+  }
+
+  std::string sub_key = InternalKey(ns_key, field, metadata.version, storage_->IsSlotIdEncoded()).Encode();
+  auto s = storage_->Get(ctx, ctx.GetReadOptions(), sub_key, value);
+  if (!s.ok() || metadata.expiring_fields == 0) return s;
+
+  uint64_t field_expire = 0;
+  s = getFieldExpire(ctx, ns_key, metadata, field, &field_expire);
+  if (!s.ok()) return s;
+  if (expire) *expire = field_expire;
+  return fieldExpired(field_expire) ? rocksdb::Status::NotFound() : rocksdb::Status::OK();
+}
+
+void Hash::setInlineField(HashMetadata *metadata, const Slice &field, const Slice &value) {
+  auto iter = findInlineField(metadata->inline_fields, field);
+  if (iter != metadata->inline_fields.end() && iter->first == field.ToStringView()) {
+    iter->second = value.ToString();
+  } else {
+    metadata->inline_fields.emplace(iter, field.ToString(), value.ToString());
+  }
+}
+
+rocksdb::Status Hash::putInlineMetadata(const std::string &ns_key, HashMetadata *metadata,
+                                        rocksdb::WriteBatchBase *batch) {
+  const auto config = storage_->GetConfig();
+  bool fits = metadata->inline_fields.size() <= static_cast<size_t>(config->hash_max_inline_entries);
+  for (auto iter = metadata->inline_fields.begin(); fits && iter != metadata->inline_fields.end(); ++iter) {
+    fits = iter->first.size() <= static_cast<size_t>(config->hash_max_inline_value) &&
+           iter->second.size() <= static_cast<size_t>(config->hash_max_inline_value);
+  }
+
+  metadata->size = metadata->inline_fields.size();
+  if (fits) {
+    metadata->encode_type = HashMetadata::EncodeType::INLINE;
+  } else {
+    // Grown too large, move the fields out to subkeys of the same version
+    auto s = moveInlineFields(ns_key, metadata, batch);
+    if (!s.ok()) return s;
+  }
+
+  std::string bytes;
+  metadata->Encode(&bytes);
+  return batch->Put(metadata_cf_handle_, ns_key, bytes);
+}
+
+rocksdb::Status Hash::moveInlineFields(const std::string &ns_key, HashMetadata *metadata,
+                                       rocksdb::WriteBatchBase *batch) {
+  for (const auto &[field, value] : metadata->inline_fields) {
+    std::string sub_key = InternalKey(ns_key, field, metadata->version, storage_->IsSlotIdEncoded()).Encode();
+    auto s = batch->Put(sub_key, value);
+    if (!s.ok()) return s;
+  }
+  metadata->encode_type = HashMetadata::EncodeType::SUBKEYS;
+  metadata->inline_fields.clear();
+  return rocksdb::Status::OK();
+}
+
+bool Hash::fieldExpired(uint64_t expire) { return expire != 0 && expire <= util::GetTimeStampMS(); }
+
+std::string Hash::fieldExpireKey(const Slice &ns_key, uint64_t version, const Slice &field) const {
+  std::string sub_key(1, kFieldExpireTag);
+  sub_key.append(field.data(), field.size());
+  return InternalKey(ns_key, sub_key, version, storage_->IsSlotIdEncoded()).Encode();
+}
+
+std::string Hash::expireIndexKey(const Slice &ns_key, uint64_t version, uint64_t expire, const Slice &field) const {
+  std::string sub_key(1, kExpireIndexTag);
+  PutFixed64(&sub_key, expire);
+  sub_key.append(field.data(), field.size());
+  return InternalKey(ns_key, sub_key, version, storage_->IsSlotIdEncoded()).Encode();
+}
+
+rocksdb::Status Hash::getFieldExpire(engine::Context &ctx, const Slice &ns_key, const HashMetadata &metadata,
+                                     const Slice &field, uint64_t *expire) {
+  *expire = 0;
+  if (metadata.expiring_fields == 0) return rocksdb::Status::OK();
+
+  std::string value;
+  auto s = storage_->Get(ctx, ctx.GetReadOptions(), storage_->GetCFHandle(ColumnFamilyID::SecondarySubkey),
+                         fieldExpireKey(ns_key, metadata.version, field), &value);
+  if (s.IsNotFound()) return rocksdb::Status::OK();
+  if (!s.ok()) return s;
+
+  Slice input(value);
+  if (!GetFixed64(&input, expire)) return rocksdb::Status::Corruption("invalid expire time of the hash field");
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status Hash::putFieldExpire(const Slice &ns_key, HashMetadata *metadata, const Slice &field,
+                                     uint64_t old_expire, uint64_t new_expire, rocksdb::WriteBatchBase *batch) {
+  auto cf_handle = storage_->GetCFHandle(ColumnFamilyID::SecondarySubkey);
+  if (old_expire != 0) {
+    auto s = batch->Delete(cf_handle, expireIndexKey(ns_key, metadata->version, old_expire, field));
+    if (!s.ok()) return s;
+  }
+
+  if (new_expire == 0) {
+    if (old_expire == 0) return rocksdb::Status::OK();
+    metadata->expiring_fields--;
+    return batch->Delete(cf_handle, fieldExpireKey(ns_key, metadata->version, field));
+  }
+
+  std::string value;
+  PutFixed64(&value, new_expire);
+  auto s = batch->Put(cf_handle, fieldExpireKey(ns_key, metadata->version, field), value);
+  if (!s.ok()) return s;
+  s = batch->Put(cf_handle, expireIndexKey(ns_key, metadata->version, new_expire, field), Slice());
+  if (!s.ok()) return s;
+  if (old_expire == 0) metadata->expiring_fields++;
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status Hash::expiredFields(engine::Context &ctx, const Slice &ns_key, const HashMetadata &metadata,
+                                    std::unordered_set<std::string> *fields) {
+  if (metadata.expiring_fields == 0) return rocksdb::Status::OK();
+
+  std::string prefix =
+      InternalKey(ns_key, std::string(1, kExpireIndexTag), metadata.version, storage_->IsSlotIdEncoded()).Encode();
+  std::string upper_bound_key = expireIndexKey(ns_key, metadata.version, util::GetTimeStampMS() + 1, "");
+  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  rocksdb::Slice upper_bound(upper_bound_key);
+  read_options.iterate_upper_bound = &upper_bound;
+
+  auto iter = util::UniqueIterator(ctx, read_options, ColumnFamilyID::SecondarySubkey);
+  for (iter->Seek(prefix); iter->Valid(); iter->Next()) {
+    InternalKey ikey(iter->key(), storage_->IsSlotIdEncoded());
+    auto sub_key = ikey.GetSubKey();
+    fields->emplace(sub_key.data() + 1 + sizeof(uint64_t), sub_key.size() - 1 - sizeof(uint64_t));
+  }
+  return iter->status();
+}
+
+rocksdb::Status Hash::Size(engine::Context &ctx, const Slice &user_key, uint64_t *size, uint64_t *expiring_fields) {
   *size = 0;
+  if (expiring_fields) *expiring_fields = 0;
 
   std::string ns_key = AppendNamespacePrefix(user_key);
   HashMetadata metadata(false);
   rocksdb::Status s = GetMetadata(ctx, ns_key, &metadata);
   if (!s.ok()) return s;
   *size = metadata.size;
+  if (expiring_fields) *expiring_fields = metadata.expiring_fields;
   return rocksdb::Status::OK();
 }
 
 rocksdb::Status Hash::Get(engine::Context &ctx, const Slice &user_key, const Slice &field, std::string *value) {
   std::string ns_key = AppendNamespacePrefix(user_key);
   HashMetadata metadata(false);
-  rocksdb::Status s = GetMetadata(ctx, ns_key, &metadata);
+  rocksdb::Status field_s;
+  rocksdb::Status s = GetMetadataAndSubKey(ctx, {kRedisHash}, ns_key, field, &metadata, value, &field_s);
   if (!s.ok()) return s;
-  rocksdb::ReadOptions read_options;
-  std::string sub_key = InternalKey(ns_key, field, metadata.version, storage_->IsSlotIdEncoded()).Encode();
-  return storage_->Get(ctx, ctx.GetReadOptions(), sub_key, value);
+  // the inline fields are in the metadata, the subkey read along with it doesn't exist
+  if (metadata.IsInline()) return getField(ctx, ns_key, metadata, field, value);
+  if (!field_s.ok() || metadata.expiring_fields == 0) return field_s;
+
+  uint64_t field_expire = 0;
+  s = getFieldExpire(ctx, ns_key, metadata, field, &field_expire);
+  if (!s.ok()) return s;
+  return fieldExpired(field_expire) ? rocksdb::Status::NotFound() : rocksdb::Status::OK();
 }
 
 rocksdb::Status Hash::IncrBy(engine::Context &ctx, const Slice &user_key, const Slice &field, int64_t increment,
                              int64_t *new_value) {
-  bool exists = false;
-  int64_t old_value = 0;
-
   std::string ns_key = AppendNamespacePrefix(user_key);
+  // the writes of a transaction are only committed by EXEC, so they can't be combined with others
+  bool combine = storage_->GetConfig()->incr_combining && !storage_->InTxn();
 
-  LockGuard guard(storage_->GetLockManager(), ns_key);
-  HashMetadata metadata;
-  rocksdb::Status s = GetMetadata(ctx, ns_key, &metadata);
-  if (!s.ok() && !s.IsNotFound()) return s;
+  using Op = engine::IncrCombiner<int64_t>::Op;
+  auto apply = [&](const std::vector<Op *> &ops) -> rocksdb::Status {
+    bool exists = false;
+    int64_t value = 0;
+    uint64_t field_expire = 0;
 
-  std::string sub_key = InternalKey(ns_key, field, metadata.version, storage_->IsSlotIdEncoded()).Encode();
-  if (s.ok()) {
-    std::string value_bytes;
-    s = storage_->Get(ctx, ctx.GetReadOptions(), sub_key, &value_bytes);
+    HashMetadata metadata;
+    rocksdb::Status s = GetMetadata(ctx, ns_key, &metadata);
     if (!s.ok() && !s.IsNotFound()) return s;
+
+    std::string sub_key = InternalKey(ns_key, field, metadata.version, storage_->IsSlotIdEncoded()).Encode();
     if (s.ok()) {
-      auto parse_result = ParseInt<int64_t>(value_bytes, 10);
-      if (!parse_result) {
-        return rocksdb::Status::InvalidArgument(parse_result.Msg());
+      std::string value_bytes;
+      s = getField(ctx, ns_key, metadata, field, &value_bytes, &field_expire);
+      if (!s.ok() && !s.IsNotFound()) return s;
+      if (s.ok()) {
+        auto parse_result = ParseInt<int64_t>(value_bytes, 10);
+        if (!parse_result) {
+          return rocksdb::Status::InvalidArgument(parse_result.Msg());
+        }
+        if (isspace(value_bytes[0])) {
+          return rocksdb::Status::InvalidArgument("value is not an integer");
+        }
+        value = *parse_result;
+        exists = true;
       }
-      if (isspace(value_bytes[0])) {
-        return rocksdb::Status::InvalidArgument("value is not an integer");
+    }
+    // an expired field which isn't reaped yet is still counted in the size, it's only replaced without its expire time
+    bool expired = !exists && field_expire != 0;
+
+    bool updated = false;
+    for (auto *op : ops) {
+      if ((op->increment < 0 && value < 0 && op->increment < (LLONG_MIN - value)) ||
+          (op->increment > 0 && value > 0 && op->increment > (LLONG_MAX - value))) {
+        op->status = rocksdb::Status::InvalidArgument("increment or decrement would overflow");
+        continue;
       }
-      old_value = *parse_result;
-      exists = true;
+      value += op->increment;
+      op->result = value;
+      updated = true;
     }
-  }
-  if ((increment < 0 && old_value < 0 && increment < (LLONG_MIN - old_value)) ||
-      (increment > 0 && old_value > 0 && increment > (LLONG_MAX - old_value))) {
-    return rocksdb::Status::InvalidArgument("increment or decrement would overflow");
-  }
+    if (!updated) return rocksdb::Status::OK();
 
-  *new_value = old_value + increment;
-  auto batch = storage_->GetWriteBatchBase();
-  WriteBatchLogData log_data(kRedisHash);
-  s = batch->PutLogData(log_data.Encode());
-  if (!s.ok()) return s;
-  s = batch->Put(sub_key, std::to_string(*new_value));
-  if (!s.ok()) return s;
-  if (!exists) {
-    metadata.size += 1;
-    std::string bytes;
-    metadata.Encode(&bytes);
-    s = batch->Put(metadata_cf_handle_, ns_key, bytes);
+    auto batch = storage_->GetWriteBatchBase();
+    WriteBatchLogData log_data(kRedisHash);
+    s = batch->PutLogData(log_data.Encode());
     if (!s.ok()) return s;
-  }
-  return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+    if (useInline(metadata)) {
+      setInlineField(&metadata, field, std::to_string(value));
+      s = putInlineMetadata(ns_key, &metadata, batch.Get());
+      if (!s.ok()) return s;
+      return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+    }
+    s = batch->Put(sub_key, std::to_string(value));
+    if (!s.ok()) return s;
+    if (expired) {
+      s = putFieldExpire(ns_key, &metadata, field, field_expire, 0, batch.Get());
+      if (!s.ok()) return s;
+    }
+    if (!exists) {
+      if (!expired) metadata.size += 1;
+      std::string bytes;
+      metadata.Encode(&bytes);
+      s = batch->Put(metadata_cf_handle_, ns_key, bytes);
+      if (!s.ok()) return s;
+    }
+    return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+  };
+
+  // the fields of a hash are combined separately, and serialized by the lock of the hash
+  std::string counter_key = "h" + ns_key;
+  PutSizedString(&counter_key, field);
+  return storage_->GetIncrCombiner()->IncrBy(ns_key, counter_key, combine, increment, new_value, apply);
 }
 
 rocksdb::Status Hash::IncrByFloat(engine::Context &ctx, const Slice &user_key, const Slice &field, double increment,
                                   double *new_value) {
   bool exists = false;
   double old_value = 0;
+  uint64_t field_expire = 0;
 
   std::string ns_key = AppendNamespacePrefix(user_key);
 
@@ -125,7 +321,7 @@ rocksdb::Status Hash::IncrByFloat(engine::Context &ctx, const Slice &user_key, c
   std::string sub_key = InternalKey(ns_key, field, metadata.version, storage_->IsSlotIdEncoded()).Encode();
   if (s.ok()) {
     std::string value_bytes;
-    s = storage_->Get(ctx, ctx.GetReadOptions(), sub_key, &value_bytes);
+    s = getField(ctx, ns_key, metadata, field, &value_bytes, &field_expire);
     if (!s.ok() && !s.IsNotFound()) return s;
     if (s.ok()) {
       auto value_stat = ParseFloat(value_bytes);
@@ -136,6 +332,7 @@ rocksdb::Status Hash::IncrByFloat(engine::Context &ctx, const Slice &user_key, c
       exists = true;
     }
   }
+  bool expired = !exists && field_expire != 0;
   double n = old_value + increment;
   if (std::isinf(n) || std::isnan(n)) {
     return rocksdb::Status::InvalidArgument("increment would produce NaN or Infinity");
@@ -146,10 +343,20 @@ rocksdb::Status Hash::IncrByFloat(engine::Context &ctx, const Slice &user_key, c
   WriteBatchLogData log_data(kRedisHash);
   s = batch->PutLogData(log_data.Encode());
   if (!s.ok()) return s;
+  if (useInline(metadata)) {
+    setInlineField(&metadata, field, std::to_string(*new_value));
+    s = putInlineMetadata(ns_key, &metadata, batch.Get());
+    if (!s.ok()) return s;
+    return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+  }
   s = batch->Put(sub_key, std::to_string(*new_value));
   if (!s.ok()) return s;
+  if (expired) {
+    s = putFieldExpire(ns_key, &metadata, field, field_expire, 0, batch.Get());
+    if (!s.ok()) return s;
+  }
   if (!exists) {
-    metadata.size += 1;
+    if (!expired) metadata.size += 1;
     std::string bytes;
     metadata.Encode(&bytes);
     s = batch->Put(metadata_cf_handle_, ns_key, bytes);
@@ -170,32 +377,85 @@ rocksdb::Status Hash::MGet(engine::Context &ctx, const Slice &user_key, const st
     return s;
   }
 
-  rocksdb::ReadOptions read_options = ctx.DefaultMultiGetOptions();
-  std::vector<rocksdb::Slice> keys;
+  if (metadata.IsInline()) {
+    for (const auto &field : fields) {
+      std::string value;
+      auto field_s = getField(ctx, ns_key, metadata, field, &value);
+      values->emplace_back(std::move(value));
+      statuses->emplace_back(field_s);
+    }
+    return rocksdb::Status::OK();
+  }
 
-  keys.reserve(fields.size());
-  std::vector<std::string> sub_keys;
-  sub_keys.resize(fields.size());
+  std::vector<std::string> values_vector;
+  auto statuses_vector = MultiGetSubKeys(ctx, ns_key, metadata, fields, &values_vector);
   for (size_t i = 0; i < fields.size(); i++) {
-    auto &field = fields[i];
-    sub_keys[i] = InternalKey(ns_key, field, metadata.version, storage_->IsSlotIdEncoded()).Encode();
-    keys.emplace_back(sub_keys[i]);
-  }
-
-  std::vector<rocksdb::PinnableSlice> values_vector;
-  values_vector.resize(keys.size());
-  std::vector<rocksdb::Status> statuses_vector;
-  statuses_vector.resize(keys.size());
-  storage_->MultiGet(ctx, read_options, storage_->GetDB()->DefaultColumnFamily(), keys.size(), keys.data(),
-                     values_vector.data(), statuses_vector.data());
-  for (size_t i = 0; i < keys.size(); i++) {
     if (!statuses_vector[i].ok() && !statuses_vector[i].IsNotFound()) return statuses_vector[i];
-    values->emplace_back(values_vector[i].ToString());
+    if (statuses_vector[i].ok() && metadata.expiring_fields > 0) {
+      uint64_t expire = 0;
+      s = getFieldExpire(ctx, ns_key, metadata, fields[i], &expire);
+      if (!s.ok()) return s;
+      if (fieldExpired(expire)) {
+        values_vector[i].clear();
+        statuses_vector[i] = rocksdb::Status::NotFound();
+      }
+    }
+    values->emplace_back(std::move(values_vector[i]));
     statuses->emplace_back(statuses_vector[i]);
   }
   return rocksdb::Status::OK();
 }
 
+std::vector<rocksdb::Status> Hash::MGetOfKeys(engine::Context &ctx, const std::vector<Slice> &user_keys,
+                                              const Slice &field, std::vector<std::string> *values) {
+  values->clear();
+  values->resize(user_keys.size());
+
+  std::vector<std::string> ns_keys;
+  ns_keys.reserve(user_keys.size());
+  for (const auto &user_key : user_keys) ns_keys.emplace_back(AppendNamespacePrefix(user_key));
+  std::vector<std::string> raw_metadatas;
+  auto statuses = MultiGetRawMetadata(ctx, std::vector<Slice>(ns_keys.begin(), ns_keys.end()), &raw_metadatas);
+
+  std::vector<HashMetadata> metadatas;
+  metadatas.reserve(user_keys.size());
+  std::vector<size_t> subkey_indexes;
+  std::vector<std::string> sub_keys;
+  for (size_t i = 0; i < user_keys.size(); i++) {
+    metadatas.emplace_back(false);
+    if (!statuses[i].ok()) continue;
+    Slice rest = raw_metadatas[i];
+    statuses[i] = ParseMetadata({kRedisHash}, &rest, &metadatas[i]);
+    if (!statuses[i].ok()) continue;
+    if (metadatas[i].IsInline()) {
+      statuses[i] = getField(ctx, ns_keys[i], metadatas[i], field, &(*values)[i]);
+      continue;
+    }
+    sub_keys.emplace_back(InternalKey(ns_keys[i], field, metadatas[i].version, storage_->IsSlotIdEncoded()).Encode());
+    subkey_indexes.emplace_back(i);
+  }
+  if (sub_keys.empty()) return statuses;
+
+  std::vector<Slice> key_slices(sub_keys.begin(), sub_keys.end());
+  std::vector<rocksdb::Status> sub_statuses(sub_keys.size());
+  std::vector<rocksdb::PinnableSlice> pin_values(sub_keys.size());
+  storage_->MultiGet(ctx, ctx.DefaultMultiGetOptions(), storage_->GetDB()->DefaultColumnFamily(), key_slices.size(),
+                     key_slices.data(), pin_values.data(), sub_statuses.data());
+  for (size_t j = 0; j < sub_keys.size(); j++) {
+    size_t i = subkey_indexes[j];
+    statuses[i] = sub_statuses[j];
+    if (!statuses[i].ok()) continue;
+    (*values)[i].assign(pin_values[j].data(), pin_values[j].size());
+    if (metadatas[i].expiring_fields == 0) continue;
+
+    uint64_t expire = 0;
+    statuses[i] = getFieldExpire(ctx, ns_keys[i], metadatas[i], field, &expire);
+    if (statuses[i].ok() && fieldExpired(expire)) statuses[i] = rocksdb::Status::NotFound();
+    if (!statuses[i].ok()) (*values)[i].clear();
+  }
+  return statuses;
+}
+
 rocksdb::Status Hash::Set(engine::Context &ctx, const Slice &user_key, const Slice &field, const Slice &value,
                           uint64_t *added_cnt) {
   return MSet(ctx, user_key, {{field.ToString(), value.ToString()}}, false, added_cnt);
@@ -215,8 +475,24 @@ rocksdb::Status Hash::Delete(engine::Context &ctx, const Slice &user_key, const
   s = GetMetadata(ctx, ns_key, &metadata);
   if (!s.ok()) return s.IsNotFound() ? rocksdb::Status::OK() : s;
 
+  if (metadata.IsInline()) {
+    for (const auto &field : fields) {
+      auto iter = findInlineField(metadata.inline_fields, field);
+      if (iter != metadata.inline_fields.end() && iter->first == field.ToStringView()) {
+        metadata.inline_fields.erase(iter);
+        *deleted_cnt += 1;
+      }
+    }
+    if (*deleted_cnt == 0) return rocksdb::Status::OK();
+    s = putInlineMetadata(ns_key, &metadata, batch.Get());
+    if (!s.ok()) return s;
+    return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+  }
+
   std::string value;
   std::unordered_set<std::string_view> field_set;
+  // the expired fields which aren't reaped yet are removed too, but they aren't counted as deleted
+  uint64_t removed = 0;
   for (const auto &field : fields) {
     if (!field_set.emplace(field.ToStringView()).second) {
       continue;
@@ -224,15 +500,21 @@ rocksdb::Status Hash::Delete(engine::Context &ctx, const Slice &user_key, const
     std::string sub_key = InternalKey(ns_key, field, metadata.version, storage_->IsSlotIdEncoded()).Encode();
     s = storage_->Get(ctx, ctx.GetReadOptions(), sub_key, &value);
     if (s.ok()) {
-      *deleted_cnt += 1;
+      uint64_t expire = 0;
+      s = getFieldExpire(ctx, ns_key, metadata, field, &expire);
+      if (!s.ok()) return s;
+      if (!fieldExpired(expire)) *deleted_cnt += 1;
+      removed++;
       s = batch->Delete(sub_key);
       if (!s.ok()) return s;
+      s = putFieldExpire(ns_key, &metadata, field, expire, 0, batch.Get());
+      if (!s.ok()) return s;
     }
   }
-  if (*deleted_cnt == 0) {
+  if (removed == 0) {
     return rocksdb::Status::OK();
   }
-  metadata.size -= *deleted_cnt;
+  metadata.size -= removed;
   std::string bytes;
   metadata.Encode(&bytes);
   s = batch->Put(metadata_cf_handle_, ns_key, bytes);
@@ -256,12 +538,43 @@ rocksdb::Status Hash::MSet(engine::Context &ctx, const Slice &user_key, const st
   s = batch->PutLogData(log_data.Encode());
   if (!s.ok()) return s;
   std::unordered_set<std::string_view> field_set;
+
+  if (useInline(metadata)) {
+    bool changed = false;
+    for (auto it = field_values.rbegin(); it != field_values.rend(); it++) {
+      if (!field_set.insert(it->field).second) {
+        continue;
+      }
+
+      auto iter = findInlineField(metadata.inline_fields, it->field);
+      if (iter != metadata.inline_fields.end() && iter->first == it->field) {
+        if (nx || iter->second == it->value) continue;
+        iter->second = it->value;
+      } else {
+        metadata.inline_fields.emplace(iter, it->field, it->value);
+        added++;
+      }
+      changed = true;
+    }
+    if (!changed) return rocksdb::Status::OK();
+
+    *added_cnt = added;
+    s = putInlineMetadata(ns_key, &metadata, batch.Get());
+    if (!s.ok()) return s;
+    return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+  }
+
+  // the expired fields which aren't reaped yet are added again, but they're still counted in the size
+  uint64_t expiring_fields = metadata.expiring_fields;
+  int size_added = 0;
   for (auto it = field_values.rbegin(); it != field_values.rend(); it++) {
     if (!field_set.insert(it->field).second) {
       continue;
     }
 
     bool exists = false;
+    bool expired = false;
+    uint64_t expire = 0;
     std::string sub_key = InternalKey(ns_key, it->field, metadata.version, storage_->IsSlotIdEncoded()).Encode();
 
     if (metadata.size > 0) {
@@ -270,21 +583,28 @@ rocksdb::Status Hash::MSet(engine::Context &ctx, const Slice &user_key, const st
       if (!s.ok() && !s.IsNotFound()) return s;
 
       if (s.ok()) {
-        if (nx || field_value == it->value) continue;
+        s = getFieldExpire(ctx, ns_key, metadata, it->field, &expire);
+        if (!s.ok()) return s;
+        expired = fieldExpired(expire);
+        // HSET removes the expire time of a field, so it's written even if the value is the same
+        if (!expired && (nx || (field_value == it->value && expire == 0))) continue;
 
-        exists = true;
+        exists = !expired;
       }
     }
 
     if (!exists) added++;
+    if (!exists && !expired) size_added++;
 
     s = batch->Put(sub_key, it->value);
     if (!s.ok()) return s;
+    s = putFieldExpire(ns_key, &metadata, it->field, expire, 0, batch.Get());
+    if (!s.ok()) return s;
   }
 
-  if (added > 0) {
-    *added_cnt = added;
-    metadata.size += added;
+  *added_cnt = added;
+  if (size_added > 0 || metadata.expiring_fields != expiring_fields) {
+    metadata.size += size_added;
     std::string bytes;
     metadata.Encode(&bytes);
     s = batch->Put(metadata_cf_handle_, ns_key, bytes);
@@ -305,6 +625,24 @@ rocksdb::Status Hash::RangeByLex(engine::Context &ctx, const Slice &user_key, co
   rocksdb::Status s = GetMetadata(ctx, ns_key, &metadata);
   if (!s.ok()) return s.IsNotFound() ? rocksdb::Status::OK() : s;
 
+  if (metadata.IsInline()) {
+    const auto &fields = metadata.inline_fields;
+    int64_t pos = 0;
+    auto n = static_cast<ptrdiff_t>(fields.size());
+    for (ptrdiff_t i = 0; i < n; i++) {
+      const auto &[field, value] = spec.reversed ? fields[n - 1 - i] : fields[i];
+      bool below_min = field < spec.min || (spec.minex && field == spec.min);
+      bool above_max = (spec.maxex && field == spec.max) || (!spec.max_infinite && field > spec.max);
+      if (spec.reversed ? below_min : above_max) break;
+      if (below_min || above_max) continue;
+      if (spec.offset >= 0 && pos++ < spec.offset) continue;
+
+      field_values->emplace_back(field, value);
+      if (spec.count > 0 && field_values->size() >= static_cast<unsigned>(spec.count)) break;
+    }
+    return rocksdb::Status::OK();
+  }
+
   std::string start_member = spec.reversed ? spec.max : spec.min;
   std::string start_key = InternalKey(ns_key, start_member, metadata.version, storage_->IsSlotIdEncoded()).Encode();
   std::string prefix_key = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
@@ -316,6 +654,10 @@ rocksdb::Status Hash::RangeByLex(engine::Context &ctx, const Slice &user_key, co
   rocksdb::Slice lower_bound(prefix_key);
   read_options.iterate_lower_bound = &lower_bound;
 
+  std::unordered_set<std::string> expired_fields;
+  s = expiredFields(ctx, ns_key, metadata, &expired_fields);
+  if (!s.ok()) return s;
+
   auto iter = util::UniqueIterator(ctx, read_options);
   if (!spec.reversed) {
     iter->Seek(start_key);
@@ -343,6 +685,7 @@ rocksdb::Status Hash::RangeByLex(engine::Context &ctx, const Slice &user_key, co
           (!spec.max_infinite && ikey.GetSubKey().ToString() > spec.max))
         break;
     }
+    if (expired_fields.count(ikey.GetSubKey().ToString())) continue;
     if (spec.offset >= 0 && pos++ < spec.offset) continue;
 
     field_values->emplace_back(ikey.GetSubKey().ToString(), iter->value().ToString());
@@ -360,16 +703,33 @@ rocksdb::Status Hash::GetAll(engine::Context &ctx, const Slice &user_key, std::v
   rocksdb::Status s = GetMetadata(ctx, ns_key, &metadata);
   if (!s.ok()) return s.IsNotFound() ? rocksdb::Status::OK() : s;
 
+  if (metadata.IsInline()) {
+    field_values->reserve(metadata.inline_fields.size());
+    for (auto &[field, value] : metadata.inline_fields) {
+      field_values->emplace_back(type == HashFetchType::kOnlyValue ? "" : std::move(field),
+                                 type == HashFetchType::kOnlyKey ? "" : std::move(value));
+    }
+    return rocksdb::Status::OK();
+  }
+
   std::string prefix_key = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
   std::string next_version_prefix_key =
       InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
 
-  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  rocksdb::ReadOptions read_options = ctx.SubKeyScanOptions(metadata.size);
   rocksdb::Slice upper_bound(next_version_prefix_key);
   read_options.iterate_upper_bound = &upper_bound;
 
+  std::unordered_set<std::string> expired_fields;
+  s = expiredFields(ctx, ns_key, metadata, &expired_fields);
+  if (!s.ok()) return s;
+
   auto iter = util::UniqueIterator(ctx, read_options);
   for (iter->Seek(prefix_key); iter->Valid() && iter->key().starts_with(prefix_key); iter->Next()) {
+    if (!expired_fields.empty()) {
+      InternalKey ikey(iter->key(), storage_->IsSlotIdEncoded());
+      if (expired_fields.count(ikey.GetSubKey().ToString())) continue;
+    }
     if (type == HashFetchType::kOnlyKey) {
       InternalKey ikey(iter->key(), storage_->IsSlotIdEncoded());
       field_values->emplace_back(ikey.GetSubKey().ToString(), "");
@@ -385,8 +745,70 @@ rocksdb::Status Hash::GetAll(engine::Context &ctx, const Slice &user_key, std::v
 
 rocksdb::Status Hash::Scan(engine::Context &ctx, const Slice &user_key, const std::string &cursor, uint64_t limit,
                            const std::string &field_prefix, std::vector<std::string> *fields,
-                           std::vector<std::string> *values) {
-  return SubKeyScanner::Scan(ctx, kRedisHash, user_key, cursor, limit, field_prefix, fields, values);
+                           std::vector<std::string> *values, const std::string &pattern, uint64_t time_budget_us,
+                           std::string *end_cursor) {
+  if (end_cursor) end_cursor->clear();
+  std::string ns_key = AppendNamespacePrefix(user_key);
+  HashMetadata metadata(false);
+  rocksdb::Status s = GetMetadata(ctx, ns_key, &metadata);
+  if (!s.ok()) return s;
+  if (!metadata.IsInline()) {
+    std::unordered_set<std::string> expired_fields;
+    s = expiredFields(ctx, ns_key, metadata, &expired_fields);
+    if (!s.ok()) return s;
+    if (expired_fields.empty()) {
+      return SubKeyScanner::Scan(ctx, kRedisHash, user_key, cursor, limit, field_prefix, fields, values, pattern,
+                                 time_budget_us, end_cursor);
+    }
+
+    // The expired fields are skipped, so the subkeys are scanned until a full page of the live fields is found,
+    // or the scan runs out of the subkeys or the time
+    uint64_t deadline = time_budget_us > 0 ? util::GetTimeStampUS() + time_budget_us : 0;
+    std::string scan_cursor = cursor;
+    while (true) {
+      std::vector<std::string> page_fields, page_values;
+      std::string page_end;
+      uint64_t page_budget = 0;
+      if (deadline > 0) page_budget = std::max<uint64_t>(deadline - std::min(deadline, util::GetTimeStampUS()), 1);
+      s = SubKeyScanner::Scan(ctx, kRedisHash, user_key, scan_cursor, limit, field_prefix, &page_fields,
+                              values != nullptr ? &page_values : nullptr, pattern, page_budget, &page_end);
+      if (!s.ok()) return s;
+      for (size_t i = 0; i < page_fields.size() && (limit == 0 || fields->size() < limit); i++) {
+        if (expired_fields.count(page_fields[i])) continue;
+        fields->emplace_back(std::move(page_fields[i]));
+        if (values != nullptr) values->emplace_back(std::move(page_values[i]));
+      }
+      if (limit > 0 && fields->size() >= limit) {
+        if (end_cursor) *end_cursor = fields->back();
+        break;
+      }
+      if (page_end.empty()) break;
+      if (deadline > 0 && util::GetTimeStampUS() >= deadline) {
+        if (end_cursor) *end_cursor = page_end;
+        break;
+      }
+      scan_cursor = page_end;
+    }
+    return rocksdb::Status::OK();
+  }
+
+  // Same order and cursor as the subkeys, which are sorted by field too
+  uint64_t cnt = 0;
+  auto iter = findInlineField(metadata.inline_fields, cursor.empty() ? field_prefix : cursor);
+  for (; iter != metadata.inline_fields.end(); ++iter) {
+    if (!cursor.empty() && iter->first == cursor) continue;
+    if (!Slice(iter->first).starts_with(field_prefix)) break;
+    if (!pattern.empty() && !util::StringMatch(pattern, iter->first, 0)) continue;
+
+    fields->emplace_back(iter->first);
+    if (values != nullptr) values->emplace_back(iter->second);
+    cnt++;
+    if (limit > 0 && cnt >= limit) {
+      if (end_cursor) *end_cursor = iter->first;
+      break;
+    }
+  }
+  return rocksdb::Status::OK();
 }
 
 rocksdb::Status Hash::RandField(engine::Context &ctx, const Slice &user_key, int64_t command_count,
@@ -399,17 +821,40 @@ rocksdb::Status Hash::RandField(engine::Context &ctx, const Slice &user_key, int
   rocksdb::Status s = GetMetadata(ctx, ns_key, &metadata);
   if (!s.ok()) return s;
 
-  std::vector<FieldValue> samples;
-  // TODO: Getting all values in Hash might be heavy, consider lazy-loading these values later
   if (count == 0) return rocksdb::Status::OK();
-  s = ExtractRandMemberFromSet<FieldValue>(
-      unique, count,
-      [this, user_key, type, &ctx](std::vector<FieldValue> *elements) {
-        return this->GetAll(ctx, user_key, elements, type);
-      },
-      field_values);
-  if (!s.ok()) {
-    return s;
+  field_values->clear();
+  // The inline fields are all in the metadata, so they're always sampled exactly
+  if (!metadata.IsInline() && UseSeekSample(storage_->GetConfig()->random_sample_exact, metadata.size, unique, count)) {
+    // the expired fields sampled are dropped, the missing ones are made up by GetAll below
+    std::unordered_set<std::string> expired_fields;
+    s = expiredFields(ctx, ns_key, metadata, &expired_fields);
+    if (!s.ok()) return s;
+    s = SampleRandMemberBySeek<FieldValue>(
+        unique, count,
+        [this, &ctx, &ns_key, &metadata, &expired_fields, type](std::mt19937_64 &gen, size_t n,
+                                                                std::vector<FieldValue> *run) {
+          std::vector<std::pair<std::string, std::string>> subkeys;
+          auto s = SampleSubKeys(ctx, ns_key, metadata, gen, n, &subkeys);
+          for (auto &[field, value] : subkeys) {
+            if (expired_fields.count(field)) continue;
+            run->emplace_back(std::move(field), type == HashFetchType::kOnlyKey ? "" : std::move(value));
+          }
+          return s;
+        },
+        [](const FieldValue &field_value) { return field_value.field; }, field_values);
+    if (!s.ok()) return s;
+  }
+  if (field_values->size() < count) {
+    // TODO: Getting all values in Hash might be heavy, consider lazy-loading these values later
+    s = ExtractRandMemberFromSet<FieldValue>(
+        unique, count,
+        [this, user_key, type, &ctx](std::vector<FieldValue> *elements) {
+          return this->GetAll(ctx, user_key, elements, type);
+        },
+        field_values);
+    if (!s.ok()) {
+      return s;
+    }
   }
   switch (type) {
     case HashFetchType::kAll:
@@ -429,4 +874,230 @@ rocksdb::Status Hash::RandField(engine::Context &ctx, const Slice &user_key, int
   return rocksdb::Status::OK();
 }
 
+rocksdb::Status Hash::ExpireFields(engine::Context &ctx, const Slice &user_key, uint64_t expire,
+                                   FieldExpireCondition condition, const std::vector<Slice> &fields,
+                                   std::vector<int64_t> *results) {
+  results->assign(fields.size(), -2);
+  std::string ns_key = AppendNamespacePrefix(user_key);
+
+  LockGuard guard(storage_->GetLockManager(), ns_key);
+  HashMetadata metadata(false);
+  rocksdb::Status s = GetMetadata(ctx, ns_key, &metadata);
+  if (!s.ok()) return s.IsNotFound() ? rocksdb::Status::OK() : s;
+
+  auto batch = storage_->GetWriteBatchBase();
+  WriteBatchLogData log_data(kRedisHash);
+  s = batch->PutLogData(log_data.Encode());
+  if (!s.ok()) return s;
+
+  // The fields are all read before any of them is changed, since the writes are only in the batch,
+  // and the state of a field is updated after each change, in case it's given more than once
+  struct FieldState {
+    bool exists = false;
+    uint64_t expire = 0;
+  };
+  std::map<std::string, FieldState> states;
+  for (const auto &field : fields) {
+    auto [iter, inserted] = states.emplace(field.ToString(), FieldState{});
+    if (!inserted) continue;
+    std::string value;
+    s = getField(ctx, ns_key, metadata, field, &value, &iter->second.expire);
+    if (!s.ok() && !s.IsNotFound()) return s;
+    // an expired field which isn't reaped yet keeps its expire time, and is replied as not existing
+    iter->second.exists = s.ok();
+  }
+
+  bool inline_deleted = false;
+  uint64_t removed = 0;
+  std::set<uint64_t> index_expires;
+  for (size_t i = 0; i < fields.size(); i++) {
+    const auto &field = fields[i];
+    auto &state = states[field.ToString()];
+    if (!state.exists) continue;
+
+    bool has_ttl = state.expire != 0;
+    bool met = true;
+    switch (condition) {
+      case FieldExpireCondition::kNone:
+        break;
+      case FieldExpireCondition::kNX:
+        met = !has_ttl;
+        break;
+      case FieldExpireCondition::kXX:
+        met = has_ttl;
+        break;
+      case FieldExpireCondition::kGT:
+        met = has_ttl && expire > state.expire;
+        break;
+      case FieldExpireCondition::kLT:
+        met = !has_ttl || expire < state.expire;
+        break;
+    }
+    if (!met) {
+      (*results)[i] = 0;
+      continue;
+    }
+
+    if (fieldExpired(expire)) {
+      if (metadata.IsInline()) {
+        metadata.inline_fields.erase(findInlineField(metadata.inline_fields, field));
+        metadata.size--;
+        inline_deleted = true;
+      } else {
+        s = batch->Delete(InternalKey(ns_key, field, metadata.version, storage_->IsSlotIdEncoded()).Encode());
+        if (!s.ok()) return s;
+        s = putFieldExpire(ns_key, &metadata, field, state.expire, 0, batch.Get());
+        if (!s.ok()) return s;
+        removed++;
+      }
+      state = {false, 0};
+      (*results)[i] = 2;
+      continue;
+    }
+
+    // the fields of an INLINE hash can't have expire times, so it's converted to subkeys first
+    if (metadata.IsInline()) {
+      s = moveInlineFields(ns_key, &metadata, batch.Get());
+      if (!s.ok()) return s;
+    }
+    s = putFieldExpire(ns_key, &metadata, field, state.expire, expire, batch.Get());
+    if (!s.ok()) return s;
+    state.expire = expire;
+    index_expires.insert(expire);
+    (*results)[i] = 1;
+  }
+
+  if (metadata.IsInline() && inline_deleted) {
+    // the deleted fields are only gone from the INLINE hash after it's written back
+    s = putInlineMetadata(ns_key, &metadata, batch.Get());
+    if (!s.ok()) return s;
+  } else if (inline_deleted || removed > 0 || !index_expires.empty()) {
+    metadata.size -= removed;
+    std::string bytes;
+    metadata.Encode(&bytes);
+    s = batch->Put(metadata_cf_handle_, ns_key, bytes);
+    if (!s.ok()) return s;
+  } else {
+    return rocksdb::Status::OK();
+  }
+
+  // An entry of the TTL index for each expire time, so the reaper deletes the fields soon after they expire
+  std::string index_value;
+  PutFixed64(&index_value, metadata.version);
+  index_value.push_back(engine::kTTLIndexHashFieldsTag);
+  for (auto field_expire : index_expires) {
+    s = batch->Put(storage_->GetCFHandle(ColumnFamilyID::TTLIndex), engine::ComposeTTLIndexKey(field_expire, ns_key),
+                   index_value);
+    if (!s.ok()) return s;
+  }
+  return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+}
+
+rocksdb::Status Hash::PersistFields(engine::Context &ctx, const Slice &user_key, const std::vector<Slice> &fields,
+                                    std::vector<int64_t> *results) {
+  results->assign(fields.size(), -2);
+  std::string ns_key = AppendNamespacePrefix(user_key);
+
+  LockGuard guard(storage_->GetLockManager(), ns_key);
+  HashMetadata metadata(false);
+  rocksdb::Status s = GetMetadata(ctx, ns_key, &metadata);
+  if (!s.ok()) return s.IsNotFound() ? rocksdb::Status::OK() : s;
+
+  auto batch = storage_->GetWriteBatchBase();
+  WriteBatchLogData log_data(kRedisHash);
+  s = batch->PutLogData(log_data.Encode());
+  if (!s.ok()) return s;
+
+  uint64_t expiring_fields = metadata.expiring_fields;
+  std::unordered_set<std::string_view> persisted;
+  for (size_t i = 0; i < fields.size(); i++) {
+    std::string value;
+    uint64_t expire = 0;
+    s = getField(ctx, ns_key, metadata, fields[i], &value, &expire);
+    if (s.IsNotFound()) continue;
+    if (!s.ok()) return s;
+
+    if (expire == 0 || persisted.count(fields[i].ToStringView())) {
+      (*results)[i] = -1;
+      continue;
+    }
+    s = putFieldExpire(ns_key, &metadata, fields[i], expire, 0, batch.Get());
+    if (!s.ok()) return s;
+    persisted.insert(fields[i].ToStringView());
+    (*results)[i] = 1;
+  }
+  if (metadata.expiring_fields == expiring_fields) return rocksdb::Status::OK();
+
+  std::string bytes;
+  metadata.Encode(&bytes);
+  s = batch->Put(metadata_cf_handle_, ns_key, bytes);
+  if (!s.ok()) return s;
+  return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+}
+
+rocksdb::Status Hash::FieldsExpireTime(engine::Context &ctx, const Slice &user_key, const std::vector<Slice> &fields,
+                                       std::vector<int64_t> *results) {
+  results->assign(fields.size(), -2);
+  std::string ns_key = AppendNamespacePrefix(user_key);
+
+  HashMetadata metadata(false);
+  rocksdb::Status s = GetMetadata(ctx, ns_key, &metadata);
+  if (!s.ok()) return s.IsNotFound() ? rocksdb::Status::OK() : s;
+
+  for (size_t i = 0; i < fields.size(); i++) {
+    std::string value;
+    uint64_t expire = 0;
+    s = getField(ctx, ns_key, metadata, fields[i], &value, &expire);
+    if (s.IsNotFound()) continue;
+    if (!s.ok()) return s;
+    (*results)[i] = expire == 0 ? -1 : static_cast<int64_t>(expire);
+  }
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status Hash::ReapExpiredFields(engine::Context &ctx, const Slice &ns_key, uint64_t version, uint64_t limit,
+                                        uint64_t *reaped, bool *done) {
+  *reaped = 0;
+  *done = true;
+
+  LockGuard guard(storage_->GetLockManager(), ns_key);
+  HashMetadata metadata(false);
+  rocksdb::Status s = GetMetadata(ctx, ns_key, &metadata);
+  // the fields of an expired, deleted or overwritten hash are left to the reaper of the key and compactions
+  if (!s.ok()) return s.IsNotFound() || s.IsInvalidArgument() ? rocksdb::Status::OK() : s;
+  if (metadata.version != version || metadata.expiring_fields == 0) return rocksdb::Status::OK();
+
+  std::unordered_set<std::string> fields;
+  s = expiredFields(ctx, ns_key, metadata, &fields);
+  if (!s.ok()) return s;
+  if (fields.empty()) return rocksdb::Status::OK();
+
+  auto batch = storage_->GetWriteBatchBase();
+  WriteBatchLogData log_data(kRedisHash);
+  s = batch->PutLogData(log_data.Encode());
+  if (!s.ok()) return s;
+
+  for (const auto &field : fields) {
+    if (*reaped >= limit) {
+      *done = false;
+      break;
+    }
+    uint64_t expire = 0;
+    s = getFieldExpire(ctx, ns_key, metadata, field, &expire);
+    if (!s.ok()) return s;
+    s = batch->Delete(InternalKey(ns_key, field, metadata.version, storage_->IsSlotIdEncoded()).Encode());
+    if (!s.ok()) return s;
+    s = putFieldExpire(ns_key, &metadata, field, expire, 0, batch.Get());
+    if (!s.ok()) return s;
+    (*reaped)++;
+  }
+
+  metadata.size -= *reaped;
+  std::string bytes;
+  metadata.Encode(&bytes);
+  s = batch->Put(metadata_cf_handle_, ns_key, bytes);
+  if (!s.ok()) return s;
+  return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+}
+
 }  // namespace redis
@@ -23,6 +23,7 @@
 #include <rocksdb/status.h>
 
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include "common/range_spec.h"
@@ -45,7 +46,9 @@ class Hash : public SubKeyScanner {
  public:
   Hash(engine::Storage *storage, const std::string &ns) : SubKeyScanner(storage, ns) {}
 
-  rocksdb::Status Size(engine::Context &ctx, const Slice &user_key, uint64_t *size);
+  // The size includes the expired fields not reaped yet, which are counted by expiring_fields if it's not null
+  rocksdb::Status Size(engine::Context &ctx, const Slice &user_key, uint64_t *size,
+                       uint64_t *expiring_fields = nullptr);
   rocksdb::Status Get(engine::Context &ctx, const Slice &user_key, const Slice &field, std::string *value);
   rocksdb::Status Set(engine::Context &ctx, const Slice &user_key, const Slice &field, const Slice &value,
                       uint64_t *added_cnt);
@@ -61,17 +64,71 @@ class Hash : public SubKeyScanner {
                              std::vector<FieldValue> *field_values);
   rocksdb::Status MGet(engine::Context &ctx, const Slice &user_key, const std::vector<Slice> &fields,
                        std::vector<std::string> *values, std::vector<rocksdb::Status> *statuses);
+  // MGetOfKeys reads the same field of many hashes, the fields in subkeys are read by one MultiGet.
+  // The status of a key is NotFound if it or its field doesn't exist, or InvalidArgument if it isn't a hash.
+  std::vector<rocksdb::Status> MGetOfKeys(engine::Context &ctx, const std::vector<Slice> &user_keys,
+                                          const Slice &field, std::vector<std::string> *values);
   rocksdb::Status GetAll(engine::Context &ctx, const Slice &user_key, std::vector<FieldValue> *field_values,
                          HashFetchType type = HashFetchType::kAll);
   rocksdb::Status Scan(engine::Context &ctx, const Slice &user_key, const std::string &cursor, uint64_t limit,
                        const std::string &field_prefix, std::vector<std::string> *fields,
-                       std::vector<std::string> *values = nullptr);
+                       std::vector<std::string> *values = nullptr, const std::string &pattern = "",
+                       uint64_t time_budget_us = 0, std::string *end_cursor = nullptr);
   rocksdb::Status RandField(engine::Context &ctx, const Slice &user_key, int64_t command_count,
                             std::vector<FieldValue> *field_values, HashFetchType type = HashFetchType::kOnlyKey);
 
+  enum class FieldExpireCondition { kNone, kNX, kXX, kGT, kLT };
+
+  // ExpireFields sets the expire time of the fields in milliseconds, and returns for each field -2 if it doesn't
+  // exist, 0 if the condition isn't met, 1 if the expire time is set, or 2 if the field is deleted since the time
+  // has passed. An INLINE hash is converted to subkeys first.
+  rocksdb::Status ExpireFields(engine::Context &ctx, const Slice &user_key, uint64_t expire,
+                               FieldExpireCondition condition, const std::vector<Slice> &fields,
+                               std::vector<int64_t> *results);
+  // PersistFields removes the expire time of the fields, and returns for each field -2 if it doesn't exist,
+  // -1 if it has no expire time, or 1 if the expire time is removed
+  rocksdb::Status PersistFields(engine::Context &ctx, const Slice &user_key, const std::vector<Slice> &fields,
+                                std::vector<int64_t> *results);
+  // FieldsExpireTime returns for each field its expire time in milliseconds, -2 if it doesn't exist, or -1 if it
+  // has no expire time
+  rocksdb::Status FieldsExpireTime(engine::Context &ctx, const Slice &user_key, const std::vector<Slice> &fields,
+                                   std::vector<int64_t> *results);
+  // ReapExpiredFields deletes at most `limit` expired fields of the version of the hash, and sets `done` if
+  // there's no expired field left
+  rocksdb::Status ReapExpiredFields(engine::Context &ctx, const Slice &ns_key, uint64_t version, uint64_t limit,
+                                    uint64_t *reaped, bool *done);
+
  private:
   rocksdb::Status GetMetadata(engine::Context &ctx, const Slice &ns_key, HashMetadata *metadata);
 
+  // Helpers for the INLINE encoding, see HashMetadata
+  bool useInline(const HashMetadata &metadata) const;
+  // getField returns NotFound for an expired field, and its expire time to `expire` if it's not null
+  rocksdb::Status getField(engine::Context &ctx, const std::string &ns_key, HashMetadata &metadata, const Slice &field,
+                           std::string *value, uint64_t *expire = nullptr);
+  static void setInlineField(HashMetadata *metadata, const Slice &field, const Slice &value);
+  rocksdb::Status putInlineMetadata(const std::string &ns_key, HashMetadata *metadata, rocksdb::WriteBatchBase *batch);
+  rocksdb::Status moveInlineFields(const std::string &ns_key, HashMetadata *metadata, rocksdb::WriteBatchBase *batch);
+
+  // Helpers for the expire times of the fields. Each expiring field has two entries in the secondary subkey
+  // column family, <kFieldExpireTag><field> -> <expire> to look up the expire time of a field, and
+  // <kExpireIndexTag><expire><field> -> "" to find the expired fields of a hash in the order of their expire times.
+  static constexpr char kFieldExpireTag = 'e';
+  static constexpr char kExpireIndexTag = 'i';
+
+  static bool fieldExpired(uint64_t expire);
+  std::string fieldExpireKey(const Slice &ns_key, uint64_t version, const Slice &field) const;
+  std::string expireIndexKey(const Slice &ns_key, uint64_t version, uint64_t expire, const Slice &field) const;
+  // getFieldExpire returns 0 if the field has no expire time
+  rocksdb::Status getFieldExpire(engine::Context &ctx, const Slice &ns_key, const HashMetadata &metadata,
+                                 const Slice &field, uint64_t *expire);
+  // putFieldExpire replaces the expire time of a field, an expire time of 0 removes it
+  rocksdb::Status putFieldExpire(const Slice &ns_key, HashMetadata *metadata, const Slice &field, uint64_t old_expire,
+                                 uint64_t new_expire, rocksdb::WriteBatchBase *batch);
+  // expiredFields returns the expired fields which aren't reaped yet
+  rocksdb::Status expiredFields(engine::Context &ctx, const Slice &ns_key, const HashMetadata &metadata,
+                                std::unordered_set<std::string> *fields);
+
   friend struct FieldValueRetriever;
 };
 
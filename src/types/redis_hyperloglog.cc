@@ -23,6 +23,9 @@
 #include <db_util.h>
 #include <stdint.h>
 
+#include <algorithm>
+
+#include "common/bit_util.h"
 #include "hyperloglog.h"
 #include "vendor/murmurhash2.h"
 
@@ -118,12 +121,18 @@ rocksdb::Status HyperLogLog::Add(engine::Context &ctx, const Slice &user_key,
   if (!s.ok() && !s.IsNotFound()) {
     return s;
   }
+  // A new HyperLogLog starts in the sparse encoding
+  if (s.IsNotFound()) metadata.encode_type = HyperLogLogMetadata::EncodeType::SPARSE;
 
   auto batch = storage_->GetWriteBatchBase();
   WriteBatchLogData log_data(kRedisHyperLogLog);
   s = batch->PutLogData(log_data.Encode());
   if (!s.ok()) return s;
 
+  if (metadata.encode_type == HyperLogLogMetadata::EncodeType::SPARSE) {
+    return addSparse(ctx, ns_key, element_hashes, &metadata, batch.Get(), ret);
+  }
+
   HllSegmentCache cache;
   for (uint64_t element_hash : element_hashes) {
     DenseHllResult dense_hll_result = ExtractDenseHllResult(element_hash);
@@ -170,6 +179,7 @@ rocksdb::Status HyperLogLog::Add(engine::Context &ctx, const Slice &user_key,
   // Update metadata
   {
     metadata.encode_type = HyperLogLogMetadata::EncodeType::DENSE;
+    metadata.cached_cardinality.reset();
     std::string bytes;
     metadata.Encode(&bytes);
     s = batch->Put(metadata_cf_handle_, ns_key, bytes);
@@ -178,11 +188,112 @@ rocksdb::Status HyperLogLog::Add(engine::Context &ctx, const Slice &user_key,
   return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
 }
 
-rocksdb::Status HyperLogLog::Count(engine::Context &ctx, const Slice &user_key, uint64_t *ret) {
+rocksdb::Status HyperLogLog::addSparse(engine::Context &ctx, const Slice &ns_key,
+                                       const std::vector<uint64_t> &element_hashes, HyperLogLogMetadata *metadata,
+                                       rocksdb::WriteBatchBase *batch, uint64_t *ret) {
+  auto &registers = metadata->sparse_registers;
+  for (uint64_t element_hash : element_hashes) {
+    DenseHllResult dense_hll_result = ExtractDenseHllResult(element_hash);
+    auto register_index = static_cast<uint16_t>(dense_hll_result.register_index);
+    auto iter = std::lower_bound(registers.begin(), registers.end(), register_index,
+                                 [](const auto &reg, uint16_t index) { return reg.first < index; });
+    if (iter != registers.end() && iter->first == register_index) {
+      if (dense_hll_result.hll_trailing_zero <= iter->second) continue;
+      iter->second = dense_hll_result.hll_trailing_zero;
+    } else {
+      registers.emplace(iter, register_index, dense_hll_result.hll_trailing_zero);
+    }
+    *ret = 1;
+  }
+  // Nothing changed, no need to write the metadata
+  if (*ret == 0) {
+    return rocksdb::Status::OK();
+  }
+
+  if (registers.size() > kHyperLogLogSparseMaxRegisters) {
+    // Promote to the dense encoding, the key has no segments before
+    std::vector<uint8_t> unpacked(kHyperLogLogRegisterCount, 0);
+    for (const auto &[index, value] : registers) unpacked[index] = value;
+    auto s = putDenseRegisters(ns_key, *metadata, unpacked.data(), batch);
+    if (!s.ok()) return s;
+    metadata->encode_type = HyperLogLogMetadata::EncodeType::DENSE;
+    registers.clear();
+  }
+  metadata->cached_cardinality.reset();
+  std::string bytes;
+  metadata->Encode(&bytes);
+  auto s = batch->Put(metadata_cf_handle_, ns_key, bytes);
+  if (!s.ok()) return s;
+  return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+}
+
+rocksdb::Status HyperLogLog::putDenseRegisters(const Slice &ns_key, const HyperLogLogMetadata &metadata,
+                                               const uint8_t *registers, rocksdb::WriteBatchBase *batch) {
+  std::string segment(kHyperLogLogSegmentBytes, 0);
+  for (uint32_t i = 0; i < kHyperLogLogSegmentCount; i++) {
+    const uint8_t *segment_registers = registers + i * kHyperLogLogSegmentRegisters;
+    // The segments without any register set are left empty
+    if (util::simd::SkipFilledBytes(segment_registers, kHyperLogLogSegmentRegisters, 0) ==
+        kHyperLogLogSegmentRegisters) {
+      continue;
+    }
+    HllDensePackSegment(segment_registers, reinterpret_cast<uint8_t *>(segment.data()));
+    std::string sub_key =
+        InternalKey(ns_key, std::to_string(i), metadata.version, storage_->IsSlotIdEncoded()).Encode();
+    auto s = batch->Put(sub_key, segment);
+    if (!s.ok()) return s;
+  }
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status HyperLogLog::Count(engine::Context &ctx, const Slice &user_key, uint64_t *ret, bool cache_result) {
   std::string ns_key = AppendNamespacePrefix(user_key);
   *ret = 0;
+  HyperLogLogMetadata metadata;
+  auto s = GetMetadata(ctx, ns_key, &metadata);
+  if (!s.ok()) return s.IsNotFound() ? rocksdb::Status::OK() : s;
+  if (metadata.cached_cardinality) {
+    *ret = *metadata.cached_cardinality;
+    return rocksdb::Status::OK();
+  }
+  if (!cache_result) return countRegisters(ctx, ns_key, metadata, ret);
+
+  // The cache is estimated from the latest registers under the lock, not the snapshot of the context,
+  // so it can't miss a PFADD committed in between
+  LockGuard guard(storage_->GetLockManager(), ns_key);
+  auto latest_ctx = engine::Context::NoTransactionContext(storage_);
+  s = GetMetadata(latest_ctx, ns_key, &metadata);
+  if (!s.ok()) return s.IsNotFound() ? rocksdb::Status::OK() : s;
+  if (metadata.cached_cardinality) {
+    *ret = *metadata.cached_cardinality;
+    return rocksdb::Status::OK();
+  }
+  s = countRegisters(latest_ctx, ns_key, metadata, ret);
+  if (!s.ok()) return s;
+
+  metadata.cached_cardinality = *ret;
+  auto batch = storage_->GetWriteBatchBase();
+  WriteBatchLogData log_data(kRedisHyperLogLog);
+  s = batch->PutLogData(log_data.Encode());
+  if (!s.ok()) return s;
+  std::string bytes;
+  metadata.Encode(&bytes);
+  s = batch->Put(metadata_cf_handle_, ns_key, bytes);
+  if (!s.ok()) return s;
+  // Losing the cache only costs the next PFCOUNT an estimate, so a failed write doesn't fail the command
+  [[maybe_unused]] auto write_status =
+      storage_->Write(latest_ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status HyperLogLog::countRegisters(engine::Context &ctx, const Slice &ns_key,
+                                            const HyperLogLogMetadata &metadata, uint64_t *ret) {
+  if (metadata.encode_type == HyperLogLogMetadata::EncodeType::SPARSE) {
+    *ret = HllSparseEstimate(metadata.sparse_registers);
+    return rocksdb::Status::OK();
+  }
   std::vector<rocksdb::PinnableSlice> registers;
-  auto s = getRegisters(ctx, ns_key, &registers);
+  auto s = getRegisters(ctx, ns_key, metadata, &registers);
   if (!s.ok()) {
     return s;
   }
@@ -193,41 +304,47 @@ rocksdb::Status HyperLogLog::Count(engine::Context &ctx, const Slice &user_key,
 }
 
 rocksdb::Status HyperLogLog::mergeUserKeys(engine::Context &ctx, const std::vector<Slice> &user_keys,
-                                           std::vector<std::string> *register_segments) {
+                                           std::vector<uint8_t> *registers) {
   DCHECK_GE(user_keys.size(), static_cast<size_t>(1));
 
-  std::string first_ns_key = AppendNamespacePrefix(user_keys[0]);
-  rocksdb::Status s = getRegisters(ctx, first_ns_key, register_segments);
-  if (!s.ok()) return s;
+  // The registers are merged unpacked, one byte for each, so the max of the sources is taken by vectors
+  registers->assign(kHyperLogLogRegisterCount, 0);
   // The set of keys that have been seen so far
   std::unordered_set<std::string_view> seend_user_keys;
-  seend_user_keys.emplace(user_keys[0].ToStringView());
-
-  for (size_t idx = 1; idx < user_keys.size(); idx++) {
-    rocksdb::Slice source_user_key = user_keys[idx];
+  for (const auto &source_user_key : user_keys) {
     if (!seend_user_keys.emplace(source_user_key.ToStringView()).second) {
       // Skip duplicate keys
       continue;
     }
     std::string source_key = AppendNamespacePrefix(source_user_key);
+    HyperLogLogMetadata metadata;
+    auto s = GetMetadata(ctx, source_key, &metadata);
+    if (s.IsNotFound()) continue;
+    if (!s.ok()) return s;
+    if (metadata.encode_type == HyperLogLogMetadata::EncodeType::SPARSE) {
+      for (const auto &[index, value] : metadata.sparse_registers) {
+        (*registers)[index] = std::max((*registers)[index], value);
+      }
+      continue;
+    }
     std::vector<rocksdb::PinnableSlice> source_registers;
-    s = getRegisters(ctx, source_key, &source_registers);
+    s = getRegisters(ctx, source_key, metadata, &source_registers);
     if (!s.ok()) return s;
     DCHECK_EQ(kHyperLogLogSegmentCount, source_registers.size());
-    DCHECK_EQ(kHyperLogLogSegmentCount, register_segments->size());
     std::vector<nonstd::span<const uint8_t>> source_register_span = TransformToSpan(source_registers);
-    HllMerge(register_segments, source_register_span);
+    for (uint32_t i = 0; i < kHyperLogLogSegmentCount; i++) {
+      HllMergeUnpacked(registers->data() + i * kHyperLogLogSegmentRegisters, source_register_span[i]);
+    }
   }
   return rocksdb::Status::OK();
 }
 
 rocksdb::Status HyperLogLog::CountMultiple(engine::Context &ctx, const std::vector<Slice> &user_key, uint64_t *ret) {
   DCHECK_GT(user_key.size(), static_cast<size_t>(1));
-  std::vector<std::string> register_segments;
-  auto s = mergeUserKeys(ctx, user_key, &register_segments);
+  std::vector<uint8_t> registers;
+  auto s = mergeUserKeys(ctx, user_key, &registers);
   if (!s.ok()) return s;
-  std::vector<nonstd::span<const uint8_t>> register_segment_span = TransformToSpan(register_segments);
-  *ret = HllDenseEstimate(register_segment_span);
+  *ret = HllUnpackedEstimate(registers.data());
   return rocksdb::Status::OK();
 }
 
@@ -239,11 +356,12 @@ rocksdb::Status HyperLogLog::Merge(engine::Context &ctx, const Slice &dest_user_
 
   std::string dest_key = AppendNamespacePrefix(dest_user_key);
   LockGuard guard(storage_->GetLockManager(), dest_key);
-  std::vector<std::string> registers;
+  std::vector<uint8_t> registers;
   HyperLogLogMetadata metadata;
 
-  rocksdb::Status s = GetMetadata(ctx, dest_user_key, &metadata);
+  rocksdb::Status s = GetMetadata(ctx, dest_key, &metadata);
   if (!s.ok() && !s.IsNotFound()) return s;
+  bool dest_dense = s.ok() && metadata.encode_type == HyperLogLogMetadata::EncodeType::DENSE;
   {
     std::vector<Slice> all_user_keys;
     all_user_keys.reserve(source_user_keys.size() + 1);
@@ -252,26 +370,37 @@ rocksdb::Status HyperLogLog::Merge(engine::Context &ctx, const Slice &dest_user_
       all_user_keys.push_back(source_user_key);
     }
     s = mergeUserKeys(ctx, all_user_keys, &registers);
+    if (!s.ok()) return s;
   }
 
   auto batch = storage_->GetWriteBatchBase();
   WriteBatchLogData log_data(kRedisHyperLogLog);
   s = batch->PutLogData(log_data.Encode());
   if (!s.ok()) return s;
-  for (uint32_t i = 0; i < kHyperLogLogSegmentCount; i++) {
-    if (registers[i].empty()) {
-      continue;
+
+  // The result keeps the sparse encoding if it's small enough, unless the dest key has the dense segments
+  metadata.sparse_registers.clear();
+  if (!dest_dense) {
+    for (uint32_t i = 0; i < kHyperLogLogRegisterCount; i++) {
+      if (registers[i] == 0) continue;
+      if (metadata.sparse_registers.size() == kHyperLogLogSparseMaxRegisters) {
+        metadata.sparse_registers.clear();
+        dest_dense = true;
+        break;
+      }
+      metadata.sparse_registers.emplace_back(static_cast<uint16_t>(i), registers[i]);
     }
-    std::string sub_key =
-        InternalKey(dest_key, std::to_string(i), metadata.version, storage_->IsSlotIdEncoded()).Encode();
-    s = batch->Put(sub_key, registers[i]);
+  }
+  if (dest_dense) {
+    s = putDenseRegisters(dest_key, metadata, registers.data(), batch.Get());
     if (!s.ok()) return s;
-    // Release memory after batch is written
-    registers[i].clear();
   }
   // Metadata
   {
-    metadata.encode_type = HyperLogLogMetadata::EncodeType::DENSE;
+    metadata.encode_type =
+        dest_dense ? HyperLogLogMetadata::EncodeType::DENSE : HyperLogLogMetadata::EncodeType::SPARSE;
+    // The merged registers are all in memory, so estimate them for the next PFCOUNT
+    metadata.cached_cardinality = HllUnpackedEstimate(registers.data());
     std::string bytes;
     metadata.Encode(&bytes);
     s = batch->Put(metadata_cf_handle_, dest_key, bytes);
@@ -282,18 +411,8 @@ rocksdb::Status HyperLogLog::Merge(engine::Context &ctx, const Slice &dest_user_
 }
 
 rocksdb::Status HyperLogLog::getRegisters(engine::Context &ctx, const Slice &ns_key,
+                                          const HyperLogLogMetadata &metadata,
                                           std::vector<rocksdb::PinnableSlice> *register_segments) {
-  HyperLogLogMetadata metadata;
-  rocksdb::Status s = GetMetadata(ctx, ns_key, &metadata);
-  if (!s.ok()) {
-    if (s.IsNotFound()) {
-      // return empty registers with the right size.
-      register_segments->resize(kHyperLogLogSegmentCount);
-      return rocksdb::Status::OK();
-    }
-    return s;
-  }
-
   // Multi get all segments
   std::vector<std::string> sub_segment_keys;
   sub_segment_keys.reserve(kHyperLogLogSegmentCount);
@@ -320,16 +439,4 @@ rocksdb::Status HyperLogLog::getRegisters(engine::Context &ctx, const Slice &ns_
   return rocksdb::Status::OK();
 }
 
-rocksdb::Status HyperLogLog::getRegisters(engine::Context &ctx, const Slice &ns_key,
-                                          std::vector<std::string> *register_segments) {
-  std::vector<rocksdb::PinnableSlice> pinnable_slices;
-  rocksdb::Status s = getRegisters(ctx, ns_key, &pinnable_slices);
-  if (!s.ok()) return s;
-  register_segments->reserve(kHyperLogLogSegmentCount);
-  for (auto &pinnable_slice : pinnable_slices) {
-    register_segments->push_back(pinnable_slice.ToString());
-  }
-  return rocksdb::Status::OK();
-}
-
 }  // namespace redis
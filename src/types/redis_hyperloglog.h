@@ -30,7 +30,9 @@ class HyperLogLog : public Database {
   explicit HyperLogLog(engine::Storage *storage, const std::string &ns) : Database(storage, ns) {}
   rocksdb::Status Add(engine::Context &ctx, const Slice &user_key, const std::vector<uint64_t> &element_hashes,
                       uint64_t *ret);
-  rocksdb::Status Count(engine::Context &ctx, const Slice &user_key, uint64_t *ret);
+  /// The cardinality is served by the cache of the metadata when it's valid. Otherwise it's estimated from
+  /// the registers, and cached for the next calls if cache_result is set, which isn't allowed on replicas.
+  rocksdb::Status Count(engine::Context &ctx, const Slice &user_key, uint64_t *ret, bool cache_result = false);
   /// The count when user_keys.size() is greater than 1.
   rocksdb::Status CountMultiple(engine::Context &ctx, const std::vector<Slice> &user_key, uint64_t *ret);
   rocksdb::Status Merge(engine::Context &ctx, const Slice &dest_user_key, const std::vector<Slice> &source_user_keys);
@@ -40,16 +42,23 @@ class HyperLogLog : public Database {
  private:
   [[nodiscard]] rocksdb::Status GetMetadata(engine::Context &ctx, const Slice &ns_key, HyperLogLogMetadata *metadata);
 
+  [[nodiscard]] rocksdb::Status countRegisters(engine::Context &ctx, const Slice &ns_key,
+                                               const HyperLogLogMetadata &metadata, uint64_t *ret);
+  /// Merge the registers of the keys into `registers`, which are unpacked as one byte for each register.
   [[nodiscard]] rocksdb::Status mergeUserKeys(engine::Context &ctx, const std::vector<Slice> &user_keys,
-                                              std::vector<std::string> *register_segments);
-  /// Using multi-get to acquire the register_segments
-  ///
-  /// If the metadata is not found, register_segments will be initialized with 16 empty slices.
+                                              std::vector<uint8_t> *registers);
+  /// Add the elements to a HyperLogLog in the sparse encoding, which is promoted to the dense encoding
+  /// when it has more than kHyperLogLogSparseMaxRegisters registers.
+  [[nodiscard]] rocksdb::Status addSparse(engine::Context &ctx, const Slice &ns_key,
+                                          const std::vector<uint64_t> &element_hashes, HyperLogLogMetadata *metadata,
+                                          rocksdb::WriteBatchBase *batch, uint64_t *ret);
+  /// Pack the unpacked registers into the dense segments, and put the non-empty ones into the batch.
+  [[nodiscard]] rocksdb::Status putDenseRegisters(const Slice &ns_key, const HyperLogLogMetadata &metadata,
+                                                  const uint8_t *registers, rocksdb::WriteBatchBase *batch);
+  /// Using multi-get to acquire the register_segments of the dense encoding
   [[nodiscard]] rocksdb::Status getRegisters(engine::Context &ctx, const Slice &ns_key,
+                                             const HyperLogLogMetadata &metadata,
                                              std::vector<rocksdb::PinnableSlice> *register_segments);
-  /// Same with getRegisters, but the result is stored in a vector of strings.
-  [[nodiscard]] rocksdb::Status getRegisters(engine::Context &ctx, const Slice &ns_key,
-                                             std::vector<std::string> *register_segments);
 };
 
 }  // namespace redis
@@ -20,29 +20,100 @@
 
 #include "redis_json.h"
 
+#include <cctype>
+#include <future>
+
+#include "db_util.h"
 #include "json.h"
+#include "json_projection.h"
 #include "lock_manager.h"
 #include "storage/redis_metadata.h"
 
 namespace redis {
 
+namespace {
+
+// JSON.MGET decodes the documents by a few threads if they take more than kMGetParallelBytes in total
+constexpr size_t kMGetParallelBytes = 1024 * 1024;
+constexpr size_t kMGetConcurrency = 4;
+
+// Returns the top-level member that a JSONPath is confined to, e.g. `counter` for both `$.counter` and
+// `$.counter.hits[0]`, so a command on the path only needs this member of a document in the split format.
+// Paths which may reach other members or refer to the root again (wildcards, recursive descent, filters)
+// aren't confined to a member.
+std::optional<std::string> TopLevelMemberOfPath(std::string_view path) {
+  if (path.size() < 3 || path[0] != '$' || path[1] != '.') return std::nullopt;
+
+  size_t end = 2;
+  while (end < path.size() && (std::isalnum(static_cast<unsigned char>(path[end])) || path[end] == '_')) end++;
+  if (end == 2) return std::nullopt;
+
+  auto rest = path.substr(end);
+  if (!rest.empty() && rest[0] != '.' && rest[0] != '[') return std::nullopt;
+  if (rest.find_first_of("$@?*()") != std::string_view::npos || rest.find("..") != std::string_view::npos) {
+    return std::nullopt;
+  }
+
+  return std::string(path.substr(2, end - 2));
+}
+
+}  // namespace
+
 rocksdb::Status Json::write(engine::Context &ctx, Slice ns_key, JsonMetadata *metadata, const JsonValue &json_val) {
   auto batch = storage_->GetWriteBatchBase();
   WriteBatchLogData log_data(kRedisJson);
   auto s = batch->PutLogData(log_data.Encode());
   if (!s.ok()) return s;
 
+  s = putValue(batch.Get(), ns_key, metadata, json_val);
+  if (!s.ok()) return s;
+
+  return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+}
+
+rocksdb::Status Json::putValue(rocksdb::WriteBatchBase *batch, Slice ns_key, JsonMetadata *metadata,
+                               const JsonValue &json_val) {
   auto format = storage_->GetConfig()->json_storage_format;
-  metadata->format = format;
+  if (format == JsonStorageFormat::Split && !json_val.value.is_object()) {
+    format = JsonStorageFormat::CBOR;
+  }
+  metadata->SetFormat(format);
+
+  auto max_nesting_depth = storage_->GetConfig()->json_max_nesting_depth;
+
+  if (format == JsonStorageFormat::Split) {
+    // the members of the previous version are left to the compaction filter
+    metadata->version = JsonMetadata().version;
+    metadata->size = json_val.value.size();
+
+    std::string bytes;
+    metadata->Encode(&bytes);
+    auto s = batch->Put(metadata_cf_handle_, ns_key, bytes);
+    if (!s.ok()) return s;
+
+    for (const auto &member : json_val.value.object_range()) {
+      bytes.clear();
+      auto redis_status = JsonValue(member.value()).DumpCBOR(&bytes, max_nesting_depth);
+      if (!redis_status) {
+        return rocksdb::Status::InvalidArgument("Failed to encode JSON into storage: " + redis_status.Msg());
+      }
+
+      std::string sub_key = InternalKey(ns_key, member.key(), metadata->version, storage_->IsSlotIdEncoded()).Encode();
+      s = batch->Put(sub_key, bytes);
+      if (!s.ok()) return s;
+    }
+
+    return rocksdb::Status::OK();
+  }
 
   std::string val;
   metadata->Encode(&val);
 
   Status redis_status;
   if (format == JsonStorageFormat::JSON) {
-    redis_status = json_val.Dump(&val, storage_->GetConfig()->json_max_nesting_depth);
+    redis_status = json_val.Dump(&val, max_nesting_depth);
   } else if (format == JsonStorageFormat::CBOR) {
-    redis_status = json_val.DumpCBOR(&val, storage_->GetConfig()->json_max_nesting_depth);
+    redis_status = json_val.DumpCBOR(&val, max_nesting_depth);
   } else {
     return rocksdb::Status::InvalidArgument("JSON storage format not supported");
   }
@@ -50,10 +121,7 @@ rocksdb::Status Json::write(engine::Context &ctx, Slice ns_key, JsonMetadata *me
     return rocksdb::Status::InvalidArgument("Failed to encode JSON into storage: " + redis_status.Msg());
   }
 
-  s = batch->Put(metadata_cf_handle_, ns_key, val);
-  if (!s.ok()) return s;
-
-  return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+  return batch->Put(metadata_cf_handle_, ns_key, val);
 }
 
 rocksdb::Status Json::parse(const JsonMetadata &metadata, const Slice &json_bytes, JsonValue *value) {
@@ -79,7 +147,109 @@ rocksdb::Status Json::read(engine::Context &ctx, const Slice &ns_key, JsonMetada
   auto s = GetMetadata(ctx, {kRedisJson}, ns_key, &bytes, metadata, &rest);
   if (!s.ok()) return s;
 
-  return parse(*metadata, rest, value);
+  return readValue(ctx, ns_key, *metadata, rest, value);
+}
+
+rocksdb::Status Json::readValue(engine::Context &ctx, const Slice &ns_key, const JsonMetadata &metadata,
+                                const Slice &rest, JsonValue *value) {
+  if (metadata.IsSplit()) return readSplit(ctx, ns_key, metadata, value);
+
+  return parse(metadata, rest, value);
+}
+
+rocksdb::Status Json::readSplit(engine::Context &ctx, const Slice &ns_key, const JsonMetadata &metadata,
+                                JsonValue *value) {
+  std::string prefix_key = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
+  std::string next_version_prefix_key =
+      InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
+
+  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  rocksdb::Slice upper_bound(next_version_prefix_key);
+  read_options.iterate_upper_bound = &upper_bound;
+  rocksdb::Slice lower_bound(prefix_key);
+  read_options.iterate_lower_bound = &lower_bound;
+
+  auto max_nesting_depth = storage_->GetConfig()->json_max_nesting_depth;
+
+  // the subkeys are sorted by the member names like the members of a jsoncons object,
+  // so every member is appended to the end of the object
+  jsoncons::json doc(jsoncons::json_object_arg);
+  doc.reserve(metadata.size);
+
+  auto iter = util::UniqueIterator(ctx, read_options);
+  for (iter->Seek(prefix_key); iter->Valid(); iter->Next()) {
+    InternalKey ikey(iter->key(), storage_->IsSlotIdEncoded());
+    auto member = JsonValue::FromCBOR(iter->value().ToStringView(), max_nesting_depth);
+    if (!member) return rocksdb::Status::Corruption(member.Msg());
+    doc.try_emplace(ikey.GetSubKey().ToString(), std::move(member->value));
+  }
+  if (auto s = iter->status(); !s.ok()) return s;
+
+  *value = JsonValue(std::move(doc));
+  return rocksdb::Status::OK();
+}
+
+std::optional<std::string> Json::splitMember(const JsonMetadata &metadata, std::string_view path) const {
+  if (!metadata.IsSplit() || storage_->GetConfig()->json_storage_format != JsonStorageFormat::Split) {
+    return std::nullopt;
+  }
+
+  return TopLevelMemberOfPath(path);
+}
+
+rocksdb::Status Json::readMember(engine::Context &ctx, const Slice &ns_key, const JsonMetadata &metadata,
+                                 const std::string &member, JsonValue *value) {
+  std::string sub_key = InternalKey(ns_key, member, metadata.version, storage_->IsSlotIdEncoded()).Encode();
+
+  jsoncons::json doc(jsoncons::json_object_arg);
+
+  std::string bytes;
+  auto s = storage_->Get(ctx, ctx.GetReadOptions(), sub_key, &bytes);
+  if (s.ok()) {
+    auto member_res = JsonValue::FromCBOR(bytes, storage_->GetConfig()->json_max_nesting_depth);
+    if (!member_res) return rocksdb::Status::Corruption(member_res.Msg());
+    doc.try_emplace(member, std::move(member_res->value));
+  } else if (!s.IsNotFound()) {
+    return s;
+  }
+
+  *value = JsonValue(std::move(doc));
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status Json::writeMember(engine::Context &ctx, const Slice &ns_key, JsonMetadata *metadata,
+                                  const std::string &member, bool existed, const JsonValue &value) {
+  bool exists = value.value.contains(member);
+  if (!exists && !existed) return rocksdb::Status::OK();
+
+  auto batch = storage_->GetWriteBatchBase();
+  WriteBatchLogData log_data(kRedisJson);
+  auto s = batch->PutLogData(log_data.Encode());
+  if (!s.ok()) return s;
+
+  std::string sub_key = InternalKey(ns_key, member, metadata->version, storage_->IsSlotIdEncoded()).Encode();
+  if (exists) {
+    std::string bytes;
+    auto redis_status =
+        JsonValue(value.value.at(member)).DumpCBOR(&bytes, storage_->GetConfig()->json_max_nesting_depth);
+    if (!redis_status) {
+      return rocksdb::Status::InvalidArgument("Failed to encode JSON into storage: " + redis_status.Msg());
+    }
+    s = batch->Put(sub_key, bytes);
+  } else {
+    s = batch->Delete(sub_key);
+  }
+  if (!s.ok()) return s;
+
+  if (exists != existed) {
+    metadata->size = exists ? metadata->size + 1 : metadata->size - 1;
+    std::string bytes;
+    metadata->Encode(&bytes);
+    s = batch->Put(metadata_cf_handle_, ns_key, bytes);
+    if (!s.ok()) return s;
+  }
+
+  return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
 }
 
 rocksdb::Status Json::create(engine::Context &ctx, const std::string &ns_key, JsonMetadata &metadata,
@@ -125,8 +295,9 @@ rocksdb::Status Json::Set(engine::Context &ctx, const std::string &user_key, con
   LockGuard guard(storage_->GetLockManager(), ns_key);
 
   JsonMetadata metadata;
-  JsonValue origin;
-  auto s = read(ctx, ns_key, &metadata, &origin);
+  std::string bytes;
+  Slice rest;
+  auto s = GetMetadata(ctx, {kRedisJson}, ns_key, &bytes, &metadata, &rest);
 
   if (s.IsNotFound()) {
     if (path != "$") return rocksdb::Status::InvalidArgument("new objects must be created at the root");
@@ -140,6 +311,22 @@ rocksdb::Status Json::Set(engine::Context &ctx, const std::string &user_key, con
   if (!new_res) return rocksdb::Status::InvalidArgument(new_res.Msg());
   auto new_val = *std::move(new_res);
 
+  if (auto member = splitMember(metadata, path)) {
+    JsonValue doc;
+    s = readMember(ctx, ns_key, metadata, *member, &doc);
+    if (!s.ok()) return s;
+
+    bool existed = doc.value.contains(*member);
+    auto set_res = doc.Set(path, std::move(new_val));
+    if (!set_res) return rocksdb::Status::InvalidArgument(set_res.Msg());
+
+    return writeMember(ctx, ns_key, &metadata, *member, existed, doc);
+  }
+
+  JsonValue origin;
+  s = readValue(ctx, ns_key, metadata, rest, &origin);
+  if (!s.ok()) return s;
+
   auto set_res = origin.Set(path, std::move(new_val));
   if (!set_res) return rocksdb::Status::InvalidArgument(set_res.Msg());
 
@@ -151,18 +338,21 @@ rocksdb::Status Json::Get(engine::Context &ctx, const std::string &user_key, con
   auto ns_key = AppendNamespacePrefix(user_key);
 
   JsonMetadata metadata;
+  std::string bytes;
+  Slice rest;
+  auto s = GetMetadata(ctx, {kRedisJson}, ns_key, &bytes, &metadata, &rest);
+  if (!s.ok()) return s;
+
+  if (paths.size() == 1) return getPath(ctx, ns_key, metadata, rest, paths[0], result);
+
   JsonValue json_val;
-  auto s = read(ctx, ns_key, &metadata, &json_val);
+  s = readValue(ctx, ns_key, metadata, rest, &json_val);
   if (!s.ok()) return s;
 
   JsonValue res;
 
   if (paths.empty()) {
     res = std::move(json_val);
-  } else if (paths.size() == 1) {
-    auto get_res = json_val.Get(paths[0]);
-    if (!get_res) return rocksdb::Status::InvalidArgument(get_res.Msg());
-    res = *std::move(get_res);
   } else {
     for (const auto &path : paths) {
       auto get_res = json_val.Get(path);
@@ -175,6 +365,51 @@ rocksdb::Status Json::Get(engine::Context &ctx, const std::string &user_key, con
   return rocksdb::Status::OK();
 }
 
+rocksdb::Status Json::getPath(engine::Context &ctx, const Slice &ns_key, const JsonMetadata &metadata,
+                              const Slice &rest, std::string_view path, JsonValue *result) {
+  if (auto member = splitMember(metadata, path)) {
+    JsonValue doc;
+    auto s = readMember(ctx, ns_key, metadata, *member, &doc);
+    if (!s.ok()) return s;
+
+    auto get_res = doc.Get(path);
+    if (!get_res) return rocksdb::Status::InvalidArgument(get_res.Msg());
+    *result = *std::move(get_res);
+    return rocksdb::Status::OK();
+  }
+
+  if (!metadata.IsSplit()) return getPathOfValue(metadata, rest, path, result);
+
+  JsonValue json_val;
+  auto s = readSplit(ctx, ns_key, metadata, &json_val);
+  if (!s.ok()) return s;
+
+  auto get_res = json_val.Get(path);
+  if (!get_res) return rocksdb::Status::InvalidArgument(get_res.Msg());
+  *result = *std::move(get_res);
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status Json::getPathOfValue(const JsonMetadata &metadata, const Slice &rest, std::string_view path,
+                                     JsonValue *result) {
+  if (auto steps = ParseDefiniteJsonPath(path)) {
+    // a document the cursor fails to go through is left to the full parse below to report the error
+    if (auto res = ProjectJsonPath(rest.ToStringView(), metadata.format, *steps)) {
+      *result = *std::move(res);
+      return rocksdb::Status::OK();
+    }
+  }
+
+  JsonValue json_val;
+  auto s = parse(metadata, rest, &json_val);
+  if (!s.ok()) return s;
+
+  auto get_res = json_val.Get(path);
+  if (!get_res) return rocksdb::Status::InvalidArgument(get_res.Msg());
+  *result = *std::move(get_res);
+  return rocksdb::Status::OK();
+}
+
 rocksdb::Status Json::ArrAppend(engine::Context &ctx, const std::string &user_key, const std::string &path,
                                 const std::vector<std::string> &values, Optionals<size_t> *results) {
   auto ns_key = AppendNamespacePrefix(user_key);
@@ -423,9 +658,10 @@ rocksdb::Status Json::Del(engine::Context &ctx, const std::string &user_key, con
 
   auto ns_key = AppendNamespacePrefix(user_key);
   LockGuard guard(storage_->GetLockManager(), ns_key);
-  JsonValue json_val;
   JsonMetadata metadata;
-  auto s = read(ctx, ns_key, &metadata, &json_val);
+  std::string bytes;
+  Slice rest;
+  auto s = GetMetadata(ctx, {kRedisJson}, ns_key, &bytes, &metadata, &rest);
 
   if (!s.ok() && !s.IsNotFound()) return s;
   if (s.IsNotFound()) {
@@ -437,6 +673,26 @@ rocksdb::Status Json::Del(engine::Context &ctx, const std::string &user_key, con
     return del(ctx, ns_key);
   }
 
+  if (auto member = splitMember(metadata, path)) {
+    JsonValue doc;
+    s = readMember(ctx, ns_key, metadata, *member, &doc);
+    if (!s.ok()) return s;
+
+    bool existed = doc.value.contains(*member);
+    auto res = doc.Del(path);
+    if (!res) return rocksdb::Status::InvalidArgument(res.Msg());
+
+    *result = *res;
+    if (*result == 0) {
+      return rocksdb::Status::OK();
+    }
+    return writeMember(ctx, ns_key, &metadata, *member, existed, doc);
+  }
+
+  JsonValue json_val;
+  s = readValue(ctx, ns_key, metadata, rest, &json_val);
+  if (!s.ok()) return s;
+
   auto res = json_val.Del(path);
   if (!res) return rocksdb::Status::InvalidArgument(res.Msg());
 
@@ -466,12 +722,31 @@ rocksdb::Status Json::numop(engine::Context &ctx, JsonValue::NumOpEnum op, const
   JsonValue number = std::move(number_res.GetValue());
 
   auto ns_key = AppendNamespacePrefix(user_key);
+
+  LockGuard guard(storage_->GetLockManager(), ns_key);
+
   JsonMetadata metadata;
-  JsonValue json_val;
-  auto s = read(ctx, ns_key, &metadata, &json_val);
+  std::string bytes;
+  Slice rest;
+  auto s = GetMetadata(ctx, {kRedisJson}, ns_key, &bytes, &metadata, &rest);
   if (!s.ok()) return s;
 
-  LockGuard guard(storage_->GetLockManager(), ns_key);
+  if (auto member = splitMember(metadata, path)) {
+    JsonValue doc;
+    s = readMember(ctx, ns_key, metadata, *member, &doc);
+    if (!s.ok()) return s;
+
+    bool existed = doc.value.contains(*member);
+    auto res = doc.NumOp(path, number, op, result);
+    if (!res) {
+      return rocksdb::Status::InvalidArgument(res.Msg());
+    }
+    return writeMember(ctx, ns_key, &metadata, *member, existed, doc);
+  }
+
+  JsonValue json_val;
+  s = readValue(ctx, ns_key, metadata, rest, &json_val);
+  if (!s.ok()) return s;
 
   auto res = json_val.NumOp(path, number, op, result);
   if (!res) {
@@ -541,24 +816,8 @@ std::vector<rocksdb::Status> Json::MGet(engine::Context &ctx, const std::vector<
     ns_keys[i] = Slice(ns_keys_string[i]);
   }
 
-  std::vector<JsonValue> json_vals;
-  json_vals.resize(ns_keys.size());
-  auto statuses = readMulti(ctx, ns_keys, json_vals);
-
   results.resize(ns_keys.size());
-  for (size_t i = 0; i < ns_keys.size(); i++) {
-    if (!statuses[i].ok()) {
-      continue;
-    }
-    auto res = json_vals[i].Get(path);
-
-    if (!res) {
-      statuses[i] = rocksdb::Status::Corruption(res.Msg());
-    } else {
-      results[i] = *std::move(res);
-    }
-  }
-  return statuses;
+  return readMulti(ctx, ns_keys, path, results);
 }
 
 rocksdb::Status Json::MSet(engine::Context &ctx, const std::vector<std::string> &user_keys,
@@ -595,25 +854,7 @@ rocksdb::Status Json::MSet(engine::Context &ctx, const std::vector<std::string>
       if (!set_res) return rocksdb::Status::InvalidArgument(set_res.Msg());
     }
 
-    auto format = storage_->GetConfig()->json_storage_format;
-    metadata.format = format;
-
-    std::string val;
-    metadata.Encode(&val);
-
-    Status res;
-    if (format == JsonStorageFormat::JSON) {
-      res = value.Dump(&val, storage_->GetConfig()->json_max_nesting_depth);
-    } else if (format == JsonStorageFormat::CBOR) {
-      res = value.DumpCBOR(&val, storage_->GetConfig()->json_max_nesting_depth);
-    } else {
-      return rocksdb::Status::InvalidArgument("JSON storage format not supported");
-    }
-    if (!res) {
-      return rocksdb::Status::InvalidArgument("Failed to encode JSON into storage: " + res.Msg());
-    }
-
-    s = batch->Put(metadata_cf_handle_, ns_keys[i], val);
+    s = putValue(batch.Get(), ns_keys[i], &metadata, value);
     if (!s.ok()) return s;
   }
 
@@ -621,13 +862,18 @@ rocksdb::Status Json::MSet(engine::Context &ctx, const std::vector<std::string>
 }
 
 std::vector<rocksdb::Status> Json::readMulti(engine::Context &ctx, const std::vector<Slice> &ns_keys,
-                                             std::vector<JsonValue> &values) {
+                                             std::string_view path, std::vector<JsonValue> &values) {
   rocksdb::ReadOptions read_options = ctx.DefaultMultiGetOptions();
 
   std::vector<rocksdb::Status> statuses(ns_keys.size());
   std::vector<rocksdb::PinnableSlice> pin_values(ns_keys.size());
   storage_->MultiGet(ctx, read_options, metadata_cf_handle_, ns_keys.size(), ns_keys.data(), pin_values.data(),
                      statuses.data());
+
+  // the documents in the split format are read by more reads, and the others are decoded from the values
+  // read above, which doesn't touch the storage and can be done by a few threads
+  std::vector<std::tuple<size_t, JsonMetadata, Slice>> docs;
+  size_t total_bytes = 0;
   for (size_t i = 0; i < ns_keys.size(); i++) {
     if (!statuses[i].ok()) continue;
     Slice rest(pin_values[i].data(), pin_values[i].size());
@@ -635,9 +881,28 @@ std::vector<rocksdb::Status> Json::readMulti(engine::Context &ctx, const std::ve
     statuses[i] = ParseMetadata({kRedisJson}, &rest, &metadata);
     if (!statuses[i].ok()) continue;
 
-    statuses[i] = parse(metadata, rest, &values[i]);
-    if (!statuses[i].ok()) continue;
+    if (metadata.IsSplit()) {
+      statuses[i] = getPath(ctx, ns_keys[i], metadata, rest, path, &values[i]);
+      continue;
+    }
+    total_bytes += rest.size();
+    docs.emplace_back(i, metadata, rest);
+  }
+
+  auto decode = [&](size_t tid, size_t concurrency) {
+    for (size_t d = tid; d < docs.size(); d += concurrency) {
+      const auto &[i, metadata, rest] = docs[d];
+      statuses[i] = getPathOfValue(metadata, rest, path, &values[i]);
+    }
+  };
+  size_t concurrency = total_bytes >= kMGetParallelBytes ? std::min(kMGetConcurrency, docs.size()) : 1;
+  std::vector<std::future<void>> tasks;
+  for (size_t tid = 1; tid < concurrency; tid++) {
+    tasks.emplace_back(std::async(std::launch::async, decode, tid, concurrency));
   }
+  decode(0, concurrency);
+  for (auto &task : tasks) task.get();
+
   return statuses;
 }
 
@@ -645,15 +910,16 @@ rocksdb::Status Json::DebugMemory(engine::Context &ctx, const std::string &user_
                                   std::vector<size_t> *results) {
   auto ns_key = AppendNamespacePrefix(user_key);
   JsonMetadata metadata;
-  if (path == "$") {
-    std::string bytes;
-    Slice rest;
-    auto s = GetMetadata(ctx, {kRedisJson}, ns_key, &bytes, &metadata, &rest);
-    if (!s.ok()) return s;
+  std::string bytes;
+  Slice rest;
+  auto s = GetMetadata(ctx, {kRedisJson}, ns_key, &bytes, &metadata, &rest);
+  if (!s.ok()) return s;
+
+  if (path == "$" && !metadata.IsSplit()) {
     results->emplace_back(rest.size());
   } else {
     JsonValue json_val;
-    auto s = read(ctx, ns_key, &metadata, &json_val);
+    s = readValue(ctx, ns_key, metadata, rest, &json_val);
     if (!s.ok()) return s;
     auto str_bytes = json_val.GetBytes(path, metadata.format, storage_->GetConfig()->json_max_nesting_depth);
     if (!str_bytes) return rocksdb::Status::InvalidArgument(str_bytes.Msg());
@@ -22,7 +22,9 @@
 
 #include <storage/redis_db.h>
 
+#include <optional>
 #include <string>
+#include <string_view>
 
 #include "json.h"
 #include "server/redis_reply.h"
@@ -85,15 +87,40 @@ class Json : public Database {
 
  private:
   rocksdb::Status write(engine::Context &ctx, Slice ns_key, JsonMetadata *metadata, const JsonValue &json_val);
+  rocksdb::Status putValue(rocksdb::WriteBatchBase *batch, Slice ns_key, JsonMetadata *metadata,
+                           const JsonValue &json_val);
   rocksdb::Status read(engine::Context &ctx, const Slice &ns_key, JsonMetadata *metadata, JsonValue *value);
+  rocksdb::Status readValue(engine::Context &ctx, const Slice &ns_key, const JsonMetadata &metadata, const Slice &rest,
+                            JsonValue *value);
+  rocksdb::Status readSplit(engine::Context &ctx, const Slice &ns_key, const JsonMetadata &metadata,
+                            JsonValue *value);
+  // return the top-level member that the path is confined to if the document is stored in the split format,
+  // so the command can work on a document with only this member instead of the whole one
+  std::optional<std::string> splitMember(const JsonMetadata &metadata, std::string_view path) const;
+  // read a member of a document in the split format as a document with only this member,
+  // which is an empty object if there is no such member
+  rocksdb::Status readMember(engine::Context &ctx, const Slice &ns_key, const JsonMetadata &metadata,
+                             const std::string &member, JsonValue *value);
+  // evaluate a single path on the document with the least decoding:
+  // a definite path on a document in the JSON or CBOR format is evaluated while going through the encoded bytes
+  rocksdb::Status getPath(engine::Context &ctx, const Slice &ns_key, const JsonMetadata &metadata, const Slice &rest,
+                          std::string_view path, JsonValue *result);
+  // getPath on a document which isn't in the split format, it doesn't read the storage
+  static rocksdb::Status getPathOfValue(const JsonMetadata &metadata, const Slice &rest, std::string_view path,
+                                        JsonValue *result);
+  // write back the member of a document read by `readMember`, which may be added or removed by the command
+  rocksdb::Status writeMember(engine::Context &ctx, const Slice &ns_key, JsonMetadata *metadata,
+                              const std::string &member, bool existed, const JsonValue &value);
   static rocksdb::Status parse(const JsonMetadata &metadata, const Slice &json_byt, JsonValue *value);
   rocksdb::Status create(engine::Context &ctx, const std::string &ns_key, JsonMetadata &metadata,
                          const std::string &value);
   rocksdb::Status del(engine::Context &ctx, const Slice &ns_key);
   rocksdb::Status numop(engine::Context &ctx, JsonValue::NumOpEnum op, const std::string &user_key,
                         const std::string &path, const std::string &value, JsonValue *result);
+  // evaluate the path on the document of each key, the documents are read by one MultiGet,
+  // and decoded in parallel if they're large
   std::vector<rocksdb::Status> readMulti(engine::Context &ctx, const std::vector<Slice> &ns_keys,
-                                         std::vector<JsonValue> &values);
+                                         std::string_view path, std::vector<JsonValue> &values);
 
   friend struct FieldValueRetriever;
 };
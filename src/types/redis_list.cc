@@ -136,6 +136,7 @@ rocksdb::Status List::PopMulti(engine::Context &ctx, const rocksdb::Slice &user_
     if (!s.ok()) return s;
     metadata.size -= 1;
     left ? ++metadata.head : --metadata.tail;
+    if (left) metadata.head_tombstones++;
     --count;
   }
 
@@ -143,6 +144,10 @@ rocksdb::Status List::PopMulti(engine::Context &ctx, const rocksdb::Slice &user_
     s = batch->Delete(metadata_cf_handle_, ns_key);
     if (!s.ok()) return s;
   } else {
+    if (metadata.head_tombstones >= kHeadTombstonesRangeDeletion) {
+      s = deleteHeadTombstones(ns_key, &metadata, batch.Get());
+      if (!s.ok()) return s;
+    }
     std::string bytes;
     metadata.Encode(&bytes);
     s = batch->Put(metadata_cf_handle_, ns_key, bytes);
@@ -152,6 +157,20 @@ rocksdb::Status List::PopMulti(engine::Context &ctx, const rocksdb::Slice &user_
   return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
 }
 
+rocksdb::Status List::deleteHeadTombstones(const Slice &ns_key, ListMetadata *metadata,
+                                           rocksdb::WriteBatchBase *batch) {
+  std::string begin_index, end_index;
+  PutFixed64(&begin_index, metadata->head - metadata->head_tombstones);
+  PutFixed64(&end_index, metadata->head);
+  std::string begin = InternalKey(ns_key, begin_index, metadata->version, storage_->IsSlotIdEncoded()).Encode();
+  std::string end = InternalKey(ns_key, end_index, metadata->version, storage_->IsSlotIdEncoded()).Encode();
+  auto s = batch->DeleteRange(storage_->GetCFHandle(ColumnFamilyID::PrimarySubkey), begin, end);
+  if (!s.ok()) return s;
+  storage_->AddCompactionHint(ColumnFamilyID::PrimarySubkey, std::move(begin), std::move(end));
+  metadata->head_tombstones = 0;
+  return rocksdb::Status::OK();
+}
+
 /*
  * LRem would remove which value is equal to elem, and count limit the remove number and direction
  * Caution: The LRem timing complexity is O(N), don't use it on a long list
@@ -191,7 +210,8 @@ rocksdb::Status List::Rem(engine::Context &ctx, const Slice &user_key, int count
 
   bool reversed = count < 0;
   std::vector<uint64_t> to_delete_indexes;
-  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  // both passes may walk through the whole list, and the second one rewrites the shifted part
+  rocksdb::ReadOptions read_options = ctx.SubKeyScanOptions(metadata.size);
   rocksdb::Slice upper_bound(next_version_prefix);
   read_options.iterate_upper_bound = &upper_bound;
   rocksdb::Slice lower_bound(prefix);
@@ -283,7 +303,8 @@ rocksdb::Status List::Insert(engine::Context &ctx, const Slice &user_key, const
   std::string prefix = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
   std::string next_version_prefix = InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
 
-  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  // the pivot is searched from the head, and the shorter side of it is scanned again to be shifted
+  rocksdb::ReadOptions read_options = ctx.SubKeyScanOptions(metadata.size);
   rocksdb::Slice upper_bound(next_version_prefix);
   read_options.iterate_upper_bound = &upper_bound;
 
@@ -387,7 +408,7 @@ rocksdb::Status List::Range(engine::Context &ctx, const Slice &user_key, int sta
   std::string prefix = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
   std::string next_version_prefix = InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
 
-  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  rocksdb::ReadOptions read_options = ctx.SubKeyScanOptions(std::min<uint64_t>(stop - start + 1, metadata.size));
   rocksdb::Slice upper_bound(next_version_prefix);
   read_options.iterate_upper_bound = &upper_bound;
 
@@ -38,6 +38,8 @@ struct PosSpec {
 };
 
 namespace redis {
+// The elements are stored one per subkey, at the contiguous positions between the head and the tail of the
+// metadata. So LINSERT and LREM rewrite every element on the shorter side of the inserted or removed ones.
 class List : public Database {
  public:
   explicit List(engine::Storage *storage, const std::string &ns) : Database(storage, ns) {}
@@ -64,6 +66,8 @@ class List : public Database {
 
  private:
   rocksdb::Status GetMetadata(engine::Context &ctx, const Slice &ns_key, ListMetadata *metadata);
+  // deleteHeadTombstones deletes the popped elements before the head by range
+  rocksdb::Status deleteHeadTombstones(const Slice &ns_key, ListMetadata *metadata, rocksdb::WriteBatchBase *batch);
   rocksdb::Status push(engine::Context &ctx, const Slice &user_key, const std::vector<Slice> &elems,
                        bool create_if_missing, bool left, uint64_t *new_size);
   rocksdb::Status lmoveOnSingleList(engine::Context &ctx, const Slice &src, bool src_left, bool dst_left,
@@ -20,8 +20,11 @@
 
 #include "redis_set.h"
 
+#include <algorithm>
+#include <iterator>
 #include <map>
 #include <memory>
+#include <numeric>
 #include <optional>
 
 #include "db_util.h"
@@ -161,7 +164,7 @@ rocksdb::Status Set::Members(engine::Context &ctx, const Slice &user_key, std::v
   std::string prefix = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
   std::string next_version_prefix = InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
 
-  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  rocksdb::ReadOptions read_options = ctx.SubKeyScanOptions(metadata.size);
   rocksdb::Slice upper_bound(next_version_prefix);
   read_options.iterate_upper_bound = &upper_bound;
 
@@ -174,11 +177,17 @@ rocksdb::Status Set::Members(engine::Context &ctx, const Slice &user_key, std::v
 }
 
 rocksdb::Status Set::IsMember(engine::Context &ctx, const Slice &user_key, const Slice &member, bool *flag) {
-  std::vector<int> exists;
-  rocksdb::Status s = MIsMember(ctx, user_key, {member}, &exists);
+  *flag = false;
+  std::string ns_key = AppendNamespacePrefix(user_key);
+
+  SetMetadata metadata(false);
+  std::string value;
+  rocksdb::Status member_s;
+  rocksdb::Status s = GetMetadataAndSubKey(ctx, {kRedisSet}, ns_key, member, &metadata, &value, &member_s);
   if (!s.ok()) return s;
-  *flag = exists[0];
-  return s;
+  if (!member_s.ok() && !member_s.IsNotFound()) return member_s;
+  *flag = member_s.ok();
+  return rocksdb::Status::OK();
 }
 
 rocksdb::Status Set::MIsMember(engine::Context &ctx, const Slice &user_key, const std::vector<Slice> &members,
@@ -191,16 +200,12 @@ rocksdb::Status Set::MIsMember(engine::Context &ctx, const Slice &user_key, cons
   rocksdb::Status s = GetMetadata(ctx, ns_key, &metadata);
   if (!s.ok()) return s;
 
-  std::string value;
-  for (const auto &member : members) {
-    std::string sub_key = InternalKey(ns_key, member, metadata.version, storage_->IsSlotIdEncoded()).Encode();
-    s = storage_->Get(ctx, ctx.GetReadOptions(), sub_key, &value);
-    if (!s.ok() && !s.IsNotFound()) return s;
-    if (s.IsNotFound()) {
-      exists->emplace_back(0);
-    } else {
-      exists->emplace_back(1);
-    }
+  std::vector<std::string> values;
+  auto statuses = MultiGetSubKeys(ctx, ns_key, metadata, members, &values);
+  exists->reserve(members.size());
+  for (const auto &member_s : statuses) {
+    if (!member_s.ok() && !member_s.IsNotFound()) return member_s;
+    exists->emplace_back(member_s.ok() ? 1 : 0);
   }
   return rocksdb::Status::OK();
 }
@@ -225,19 +230,33 @@ rocksdb::Status Set::Take(engine::Context &ctx, const Slice &user_key, std::vect
   rocksdb::Status s = GetMetadata(ctx, ns_key, &metadata);
   if (!s.ok()) return s.IsNotFound() ? rocksdb::Status::OK() : s;
 
-  ObserverOrUniquePtr<rocksdb::WriteBatchBase> batch = storage_->GetWriteBatchBase();
+  engine::WriteBatchBasePtr batch = storage_->GetWriteBatchBase();
   if (pop) {
     WriteBatchLogData log_data(kRedisSet);
     s = batch->PutLogData(log_data.Encode());
     if (!s.ok()) return s;
   }
   members->clear();
-  s = ExtractRandMemberFromSet<std::string>(
-      unique, count,
-      [this, user_key, &ctx](std::vector<std::string> *samples) { return this->Members(ctx, user_key, samples); },
-      members);
-  if (!s.ok()) {
-    return s;
+  if (UseSeekSample(storage_->GetConfig()->random_sample_exact, metadata.size, unique, static_cast<size_t>(count))) {
+    s = SampleRandMemberBySeek<std::string>(
+        unique, count,
+        [this, &ctx, &ns_key, &metadata](std::mt19937_64 &gen, size_t n, std::vector<std::string> *run) {
+          std::vector<std::pair<std::string, std::string>> subkeys;
+          auto s = SampleSubKeys(ctx, ns_key, metadata, gen, n, &subkeys);
+          for (auto &[member, _] : subkeys) run->emplace_back(std::move(member));
+          return s;
+        },
+        [](const std::string &member) { return member; }, members);
+    if (!s.ok()) return s;
+  }
+  if (members->size() < static_cast<size_t>(count)) {
+    s = ExtractRandMemberFromSet<std::string>(
+        unique, count,
+        [this, user_key, &ctx](std::vector<std::string> *samples) { return this->Members(ctx, user_key, samples); },
+        members);
+    if (!s.ok()) {
+      return s;
+    }
   }
   // Avoid to write an empty op-log if just random select some members.
   if (!pop) return rocksdb::Status::OK();
@@ -277,8 +296,10 @@ rocksdb::Status Set::Move(engine::Context &ctx, const Slice &src, const Slice &d
 }
 
 rocksdb::Status Set::Scan(engine::Context &ctx, const Slice &user_key, const std::string &cursor, uint64_t limit,
-                          const std::string &member_prefix, std::vector<std::string> *members) {
-  return SubKeyScanner::Scan(ctx, kRedisSet, user_key, cursor, limit, member_prefix, members);
+                          const std::string &member_prefix, std::vector<std::string> *members,
+                          const std::string &pattern, uint64_t time_budget_us, std::string *end_cursor) {
+  return SubKeyScanner::Scan(ctx, kRedisSet, user_key, cursor, limit, member_prefix, members, nullptr, pattern,
+                             time_budget_us, end_cursor);
 }
 
 /*
@@ -371,75 +392,83 @@ rocksdb::Status Set::Inter(engine::Context &ctx, const std::vector<Slice> &keys,
   }
   MultiLockGuard guard(storage_->GetLockManager(), lock_keys);
 
-  members->clear();
-
-  std::map<std::string, size_t> member_counters;
-  std::vector<std::string> target_members;
-  auto s = Members(ctx, keys[0], &target_members);
-  if (!s.ok() || target_members.empty()) return s;
-  for (const auto &member : target_members) {
-    member_counters[member] = 1;
-  }
-  for (size_t i = 1; i < keys.size(); i++) {
-    s = Members(ctx, keys[i], &target_members);
-    if (!s.ok() || target_members.empty()) return s;
-    for (const auto &member : target_members) {
-      if (member_counters.find(member) == member_counters.end()) continue;
-      member_counters[member]++;
-    }
-  }
-  for (const auto &iter : member_counters) {
-    if (iter.second == keys.size()) {  // all the sets contain this member
-      members->emplace_back(iter.first);
-    }
-  }
-  return rocksdb::Status::OK();
+  return inter(ctx, keys, 0, members);
 }
 
 rocksdb::Status Set::InterCard(engine::Context &ctx, const std::vector<Slice> &keys, uint64_t limit,
                                uint64_t *cardinality) {
   *cardinality = 0;
 
-  std::map<std::string, size_t> member_counters;
-  std::vector<std::string> target_members;
+  std::vector<std::string> members;
+  auto s = inter(ctx, keys, limit, &members);
+  if (!s.ok()) return s;
+  *cardinality = members.size();
+  return rocksdb::Status::OK();
+}
 
-  auto s = Members(ctx, keys[0], &target_members);
-  if (!s.ok() || target_members.empty()) return s;
-  for (const auto &member : target_members) {
-    member_counters[member] = 1;
-  }
-  if (limit == 0) {
-    limit = target_members.size();
-  }
+rocksdb::Status Set::inter(engine::Context &ctx, const std::vector<Slice> &keys, uint64_t limit,
+                           std::vector<std::string> *members) {
+  members->clear();
 
-  size_t keys_size = keys.size();
-  if (keys_size == 1) {
-    *cardinality = std::min(static_cast<uint64_t>(target_members.size()), limit);
-    return rocksdb::Status::OK();
+  std::vector<std::string> ns_keys;
+  std::vector<SetMetadata> metadatas;
+  ns_keys.reserve(keys.size());
+  metadatas.reserve(keys.size());
+  for (const auto &key : keys) {
+    ns_keys.emplace_back(AppendNamespacePrefix(key));
+    metadatas.emplace_back(false);
+    auto s = GetMetadata(ctx, ns_keys.back(), &metadatas.back());
+    if (!s.ok()) return s.IsNotFound() ? rocksdb::Status::OK() : s;
   }
 
-  bool limit_reached = false;
-  for (size_t i = 1; i < keys_size; i++) {
-    s = Members(ctx, keys[i], &target_members);
-    if (!s.ok() || target_members.empty()) {
-      return s;
+  // The sets are visited from the smallest one, whose members are the candidates of the intersection
+  std::vector<size_t> order(keys.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&](size_t l, size_t r) { return metadatas[l].size < metadatas[r].size; });
+
+  std::vector<std::string> candidates;
+  auto s = Members(ctx, keys[order[0]], &candidates);
+  if (!s.ok()) return s;
+
+  // A set of a comparable size is read by a merge with the candidates, since both of them are sorted
+  std::vector<size_t> probed_sets;
+  for (size_t i = 1; i < order.size() && !candidates.empty(); i++) {
+    if (metadatas[order[i]].size > candidates.size() * kInterMergeRatio) {
+      probed_sets.emplace_back(order[i]);
+      continue;
     }
 
-    for (const auto &member : target_members) {
-      auto iter = member_counters.find(member);
-      if (iter == member_counters.end()) continue;
-      if (++iter->second == keys_size) {
-        *cardinality += 1;
-        if (--limit == 0) {
-          limit_reached = true;
-          break;
-        }
+    std::vector<std::string> set_members, merged;
+    s = Members(ctx, keys[order[i]], &set_members);
+    if (!s.ok()) return s;
+    std::set_intersection(candidates.begin(), candidates.end(), set_members.begin(), set_members.end(),
+                          std::back_inserter(merged));
+    candidates = std::move(merged);
+  }
+
+  // A much larger set is probed by the candidates with a MultiGet of each batch, which stops once the limit is reached
+  for (size_t begin = 0; begin < candidates.size(); begin += kInterProbeBatchSize) {
+    std::vector<Slice> batch;
+    for (size_t i = begin; i < std::min(candidates.size(), begin + kInterProbeBatchSize); i++) {
+      batch.emplace_back(candidates[i]);
+    }
+    for (size_t i = 0; i < probed_sets.size() && !batch.empty(); i++) {
+      std::vector<std::string> values;
+      auto statuses = MultiGetSubKeys(ctx, ns_keys[probed_sets[i]], metadatas[probed_sets[i]], batch, &values);
+      std::vector<Slice> found;
+      for (size_t j = 0; j < batch.size(); j++) {
+        if (!statuses[j].ok() && !statuses[j].IsNotFound()) return statuses[j];
+        if (statuses[j].ok()) found.emplace_back(batch[j]);
       }
+      batch = std::move(found);
     }
 
-    if (limit_reached) break;
+    for (const auto &member : batch) {
+      members->emplace_back(member.ToString());
+      if (limit > 0 && members->size() >= limit) return rocksdb::Status::OK();
+    }
   }
-
   return rocksdb::Status::OK();
 }
 
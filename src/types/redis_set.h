@@ -57,10 +57,18 @@ class Set : public SubKeyScanner {
   rocksdb::Status InterStore(engine::Context &ctx, const Slice &dst, const std::vector<Slice> &keys,
                              uint64_t *saved_cnt);
   rocksdb::Status Scan(engine::Context &ctx, const Slice &user_key, const std::string &cursor, uint64_t limit,
-                       const std::string &member_prefix, std::vector<std::string> *members);
+                       const std::string &member_prefix, std::vector<std::string> *members,
+                       const std::string &pattern = "", uint64_t time_budget_us = 0, std::string *end_cursor = nullptr);
 
  private:
+  // a set at most this many times larger than the candidates of SINTER is merged with them instead of probed
+  static constexpr uint64_t kInterMergeRatio = 8;
+  static constexpr size_t kInterProbeBatchSize = 1024;
+
   rocksdb::Status GetMetadata(engine::Context &ctx, const Slice &ns_key, SetMetadata *metadata);
+  // inter returns at most limit members of the intersection of the sets, 0 means all
+  rocksdb::Status inter(engine::Context &ctx, const std::vector<Slice> &keys, uint64_t limit,
+                        std::vector<std::string> *members);
 };
 
 }  // namespace redis
@@ -20,18 +20,73 @@
 
 #include "redis_sortedint.h"
 
+#include <algorithm>
 #include <iostream>
+#include <iterator>
 #include <limits>
+#include <map>
 
 #include "db_util.h"
 #include "parse_util.h"
+#include "redis_sortedint_block.h"
 
 namespace redis {
 
+namespace {
+
+uint64_t SubKeyID(const Slice &key, bool slot_id_encoded) {
+  InternalKey ikey(key, slot_id_encoded);
+  Slice sub_key = ikey.GetSubKey();
+  uint64_t id = 0;
+  GetFixed64(&sub_key, &id);
+  return id;
+}
+
+// GroupIDsByBlock groups the ascending IDs by the first IDs of the blocks they belong to. The IDs before
+// the first block are grouped into it if to_first_block is true, or left ungrouped like the IDs of a
+// sortedint without any block.
+rocksdb::Status GroupIDsByBlock(rocksdb::Iterator *iter, const std::string &prefix, bool to_first_block,
+                                const std::vector<uint64_t> &ids,
+                                const std::function<std::string(uint64_t)> &sub_key, bool slot_id_encoded,
+                                std::map<uint64_t, std::vector<uint64_t>> *groups, std::vector<uint64_t> *ungrouped) {
+  std::optional<uint64_t> block_id, next_block_id;
+  for (const auto id : ids) {
+    if (!block_id || (next_block_id && id >= *next_block_id)) {
+      iter->SeekForPrev(sub_key(id));
+      if (!iter->Valid() && to_first_block && iter->status().ok()) iter->Seek(prefix);
+      if (!iter->Valid()) {
+        if (!iter->status().ok()) return iter->status();
+        ungrouped->emplace_back(id);
+        continue;
+      }
+      block_id = SubKeyID(iter->key(), slot_id_encoded);
+      iter->Next();
+      next_block_id = iter->Valid() ? std::optional(SubKeyID(iter->key(), slot_id_encoded)) : std::nullopt;
+      if (!iter->status().ok()) return iter->status();
+    }
+    (*groups)[*block_id].emplace_back(id);
+  }
+  return rocksdb::Status::OK();
+}
+
+}  // namespace
+
 rocksdb::Status Sortedint::GetMetadata(engine::Context &ctx, const Slice &ns_key, SortedintMetadata *metadata) {
   return Database::GetMetadata(ctx, {kRedisSortedint}, ns_key, metadata);
 }
 
+// The sortedints created while sortedint-block-encoding is enabled are block encoded
+void Sortedint::initEncoding(SortedintMetadata *metadata) const {
+  metadata->encoding =
+      storage_->GetConfig()->sortedint_block_encoding ? SortedintEncoding::BLOCK : SortedintEncoding::PLAIN;
+}
+
+std::string Sortedint::subKey(const Slice &ns_key, const SortedintMetadata &metadata, uint64_t id) const {
+  std::string id_buf;
+  PutFixed64(&id_buf, id);
+  return InternalKey(ns_key, id_buf, metadata.version, storage_->IsSlotIdEncoded()).Encode();
+}
+
 rocksdb::Status Sortedint::Add(engine::Context &ctx, const Slice &user_key, const std::vector<uint64_t> &ids,
                                uint64_t *added_cnt) {
   *added_cnt = 0;
@@ -42,21 +97,28 @@ rocksdb::Status Sortedint::Add(engine::Context &ctx, const Slice &user_key, cons
   SortedintMetadata metadata;
   rocksdb::Status s = GetMetadata(ctx, ns_key, &metadata);
   if (!s.ok() && !s.IsNotFound()) return s;
+  if (s.IsNotFound()) initEncoding(&metadata);
 
   std::string value;
   auto batch = storage_->GetWriteBatchBase();
-  WriteBatchLogData log_data(kRedisSortedint);
+  // The blocks are rewritten as a whole, so the command is logged to tell the replayers
+  WriteBatchLogData log_data = metadata.IsBlockEncoded()
+                                   ? WriteBatchLogData(kRedisSortedint, {std::to_string(kRedisCmdSIAdd)})
+                                   : WriteBatchLogData(kRedisSortedint);
   s = batch->PutLogData(log_data.Encode());
   if (!s.ok()) return s;
-  for (const auto id : ids) {
-    std::string id_buf;
-    PutFixed64(&id_buf, id);
-    std::string sub_key = InternalKey(ns_key, id_buf, metadata.version, storage_->IsSlotIdEncoded()).Encode();
-    s = storage_->Get(ctx, ctx.GetReadOptions(), sub_key, &value);
-    if (s.ok()) continue;
-    s = batch->Put(sub_key, Slice());
+  if (metadata.IsBlockEncoded()) {
+    s = addToBlocks(ctx, ns_key, metadata, ids, batch.Get(), added_cnt);
     if (!s.ok()) return s;
-    *added_cnt += 1;
+  } else {
+    for (const auto id : ids) {
+      std::string sub_key = subKey(ns_key, metadata, id);
+      s = storage_->Get(ctx, ctx.GetReadOptions(), sub_key, &value);
+      if (s.ok()) continue;
+      s = batch->Put(sub_key, Slice());
+      if (!s.ok()) return s;
+      *added_cnt += 1;
+    }
   }
 
   if (*added_cnt == 0) return rocksdb::Status::OK();
@@ -82,18 +144,27 @@ rocksdb::Status Sortedint::Remove(engine::Context &ctx, const Slice &user_key, c
 
   std::string value;
   auto batch = storage_->GetWriteBatchBase();
-  WriteBatchLogData log_data(kRedisSortedint);
+  std::vector<std::string> log_args;
+  if (metadata.IsBlockEncoded()) {
+    // the removed IDs are gone from the rewritten blocks, so they're logged for the replayers
+    log_args.emplace_back(std::to_string(kRedisCmdSIRem));
+    for (const auto id : ids) log_args.emplace_back(std::to_string(id));
+  }
+  WriteBatchLogData log_data(kRedisSortedint, std::move(log_args));
   s = batch->PutLogData(log_data.Encode());
   if (!s.ok()) return s;
-  for (const auto id : ids) {
-    std::string id_buf;
-    PutFixed64(&id_buf, id);
-    std::string sub_key = InternalKey(ns_key, id_buf, metadata.version, storage_->IsSlotIdEncoded()).Encode();
-    s = storage_->Get(ctx, ctx.GetReadOptions(), sub_key, &value);
-    if (!s.ok()) continue;
-    s = batch->Delete(sub_key);
+  if (metadata.IsBlockEncoded()) {
+    s = removeFromBlocks(ctx, ns_key, metadata, ids, batch.Get(), removed_cnt);
     if (!s.ok()) return s;
-    *removed_cnt += 1;
+  } else {
+    for (const auto id : ids) {
+      std::string sub_key = subKey(ns_key, metadata, id);
+      s = storage_->Get(ctx, ctx.GetReadOptions(), sub_key, &value);
+      if (!s.ok()) continue;
+      s = batch->Delete(sub_key);
+      if (!s.ok()) return s;
+      *removed_cnt += 1;
+    }
   }
   if (*removed_cnt == 0) return rocksdb::Status::OK();
   metadata.size -= *removed_cnt;
@@ -104,6 +175,159 @@ rocksdb::Status Sortedint::Remove(engine::Context &ctx, const Slice &user_key, c
   return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
 }
 
+rocksdb::Status Sortedint::addToBlocks(engine::Context &ctx, const Slice &ns_key, const SortedintMetadata &metadata,
+                                       const std::vector<uint64_t> &ids, rocksdb::WriteBatchBase *batch,
+                                       uint64_t *added_cnt) {
+  std::vector<uint64_t> sorted_ids = ids;
+  std::sort(sorted_ids.begin(), sorted_ids.end());
+  sorted_ids.erase(std::unique(sorted_ids.begin(), sorted_ids.end()), sorted_ids.end());
+
+  std::string prefix = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
+  std::string next_version_prefix = InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
+  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  rocksdb::Slice upper_bound(next_version_prefix);
+  read_options.iterate_upper_bound = &upper_bound;
+  rocksdb::Slice lower_bound(prefix);
+  read_options.iterate_lower_bound = &lower_bound;
+  auto iter = util::UniqueIterator(ctx, read_options);
+
+  // the IDs before the first block are added to it, and the IDs of a new sortedint to new blocks
+  std::map<uint64_t, std::vector<uint64_t>> groups;
+  std::vector<uint64_t> new_ids;
+  auto sub_key = [&](uint64_t id) { return subKey(ns_key, metadata, id); };
+  auto s = GroupIDsByBlock(iter.get(), prefix, true, sorted_ids, sub_key, storage_->IsSlotIdEncoded(), &groups,
+                           &new_ids);
+  if (!s.ok()) return s;
+
+  std::string value;
+  std::vector<uint64_t> block_ids, merged_ids;
+  for (const auto &[first_id, group_ids] : groups) {
+    s = storage_->Get(ctx, ctx.GetReadOptions(), sub_key(first_id), &value);
+    if (!s.ok()) return s;
+    block_ids.clear();
+    s = SortedintBlock::Decode(first_id, value, &block_ids);
+    if (!s.ok()) return s;
+
+    merged_ids.clear();
+    std::set_union(block_ids.begin(), block_ids.end(), group_ids.begin(), group_ids.end(),
+                   std::back_inserter(merged_ids));
+    if (merged_ids.size() == block_ids.size()) continue;
+    *added_cnt += merged_ids.size() - block_ids.size();
+    s = writeBlock(ns_key, metadata, first_id, merged_ids, batch);
+    if (!s.ok()) return s;
+  }
+
+  *added_cnt += new_ids.size();
+  return writeBlock(ns_key, metadata, std::nullopt, new_ids, batch);
+}
+
+rocksdb::Status Sortedint::removeFromBlocks(engine::Context &ctx, const Slice &ns_key,
+                                            const SortedintMetadata &metadata, const std::vector<uint64_t> &ids,
+                                            rocksdb::WriteBatchBase *batch, uint64_t *removed_cnt) {
+  std::vector<uint64_t> sorted_ids = ids;
+  std::sort(sorted_ids.begin(), sorted_ids.end());
+  sorted_ids.erase(std::unique(sorted_ids.begin(), sorted_ids.end()), sorted_ids.end());
+
+  std::string prefix = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
+  std::string next_version_prefix = InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
+  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  rocksdb::Slice upper_bound(next_version_prefix);
+  read_options.iterate_upper_bound = &upper_bound;
+  rocksdb::Slice lower_bound(prefix);
+  read_options.iterate_lower_bound = &lower_bound;
+  auto iter = util::UniqueIterator(ctx, read_options);
+
+  // the IDs before the first block don't exist
+  std::map<uint64_t, std::vector<uint64_t>> groups;
+  std::vector<uint64_t> absent_ids;
+  auto sub_key = [&](uint64_t id) { return subKey(ns_key, metadata, id); };
+  auto s = GroupIDsByBlock(iter.get(), prefix, false, sorted_ids, sub_key, storage_->IsSlotIdEncoded(), &groups,
+                           &absent_ids);
+  if (!s.ok()) return s;
+
+  std::string value;
+  std::vector<uint64_t> block_ids, left_ids;
+  for (const auto &[first_id, group_ids] : groups) {
+    s = storage_->Get(ctx, ctx.GetReadOptions(), sub_key(first_id), &value);
+    if (!s.ok()) return s;
+    block_ids.clear();
+    s = SortedintBlock::Decode(first_id, value, &block_ids);
+    if (!s.ok()) return s;
+
+    left_ids.clear();
+    std::set_difference(block_ids.begin(), block_ids.end(), group_ids.begin(), group_ids.end(),
+                        std::back_inserter(left_ids));
+    if (left_ids.size() == block_ids.size()) continue;
+    *removed_cnt += block_ids.size() - left_ids.size();
+    s = writeBlock(ns_key, metadata, first_id, left_ids, batch);
+    if (!s.ok()) return s;
+  }
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status Sortedint::writeBlock(const Slice &ns_key, const SortedintMetadata &metadata,
+                                      std::optional<uint64_t> old_first_id, const std::vector<uint64_t> &ids,
+                                      rocksdb::WriteBatchBase *batch) {
+  if (old_first_id && (ids.empty() || ids.front() != *old_first_id)) {
+    auto s = batch->Delete(subKey(ns_key, metadata, *old_first_id));
+    if (!s.ok()) return s;
+  }
+
+  // The IDs are split evenly, so the blocks are about half full after a split and take a few more IDs before
+  // they're split again
+  size_t n_blocks = (ids.size() + SortedintBlock::kMaxIDs - 1) / SortedintBlock::kMaxIDs;
+  for (size_t i = 0; i < n_blocks; i++) {
+    size_t begin = ids.size() * i / n_blocks, end = ids.size() * (i + 1) / n_blocks;
+    auto s = batch->Put(subKey(ns_key, metadata, ids[begin]), SortedintBlock::Encode(ids.data() + begin, end - begin));
+    if (!s.ok()) return s;
+  }
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status Sortedint::iterateIDs(engine::Context &ctx, const Slice &ns_key, const SortedintMetadata &metadata,
+                                      uint64_t start_id, bool reversed,
+                                      const std::function<bool(uint64_t)> &callback) {
+  std::string start_key = subKey(ns_key, metadata, start_id);
+  std::string prefix = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
+  std::string next_version_prefix = InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
+
+  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  rocksdb::Slice upper_bound(next_version_prefix);
+  read_options.iterate_upper_bound = &upper_bound;
+  rocksdb::Slice lower_bound(prefix);
+  read_options.iterate_lower_bound = &lower_bound;
+  auto iter = util::UniqueIterator(ctx, read_options);
+
+  if (!metadata.IsBlockEncoded()) {
+    for (!reversed ? iter->Seek(start_key) : iter->SeekForPrev(start_key);
+         iter->Valid() && iter->key().starts_with(prefix); !reversed ? iter->Next() : iter->Prev()) {
+      if (!callback(SubKeyID(iter->key(), storage_->IsSlotIdEncoded()))) break;
+    }
+    return iter->status();
+  }
+
+  // the first block may hold the IDs before the start ID, which are skipped
+  iter->SeekForPrev(start_key);
+  if (!reversed && !iter->Valid() && iter->status().ok()) iter->Seek(start_key);
+  std::vector<uint64_t> ids;
+  for (; iter->Valid() && iter->key().starts_with(prefix); !reversed ? iter->Next() : iter->Prev()) {
+    ids.clear();
+    auto s = SortedintBlock::Decode(SubKeyID(iter->key(), storage_->IsSlotIdEncoded()), iter->value(), &ids);
+    if (!s.ok()) return s;
+    if (!reversed) {
+      for (auto it = std::lower_bound(ids.begin(), ids.end(), start_id); it != ids.end(); ++it) {
+        if (!callback(*it)) return rocksdb::Status::OK();
+      }
+    } else {
+      for (auto it = std::make_reverse_iterator(std::upper_bound(ids.begin(), ids.end(), start_id));
+           it != ids.rend(); ++it) {
+        if (!callback(*it)) return rocksdb::Status::OK();
+      }
+    }
+  }
+  return iter->status();
+}
+
 rocksdb::Status Sortedint::Card(engine::Context &ctx, const Slice &user_key, uint64_t *size) {
   *size = 0;
   std::string ns_key = AppendNamespacePrefix(user_key);
@@ -125,34 +349,17 @@ rocksdb::Status Sortedint::Range(engine::Context &ctx, const Slice &user_key, ui
   rocksdb::Status s = GetMetadata(ctx, ns_key, &metadata);
   if (!s.ok()) return s.IsNotFound() ? rocksdb::Status::OK() : s;
 
-  std::string start_buf;
   uint64_t start_id = cursor_id;
   if (reversed && cursor_id == 0) {
     start_id = std::numeric_limits<uint64_t>::max();
   }
-  PutFixed64(&start_buf, start_id);
-  std::string start_key = InternalKey(ns_key, start_buf, metadata.version, storage_->IsSlotIdEncoded()).Encode();
-  std::string prefix = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
-  std::string next_version_prefix = InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
 
-  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
-  rocksdb::Slice upper_bound(next_version_prefix);
-  read_options.iterate_upper_bound = &upper_bound;
-  rocksdb::Slice lower_bound(prefix);
-  read_options.iterate_lower_bound = &lower_bound;
-
-  uint64_t id = 0, pos = 0;
-  auto iter = util::UniqueIterator(ctx, read_options);
-  for (!reversed ? iter->Seek(start_key) : iter->SeekForPrev(start_key);
-       iter->Valid() && iter->key().starts_with(prefix); !reversed ? iter->Next() : iter->Prev()) {
-    InternalKey ikey(iter->key(), storage_->IsSlotIdEncoded());
-    Slice sub_key = ikey.GetSubKey();
-    GetFixed64(&sub_key, &id);
-    if (id == cursor_id || pos++ < offset) continue;
+  uint64_t pos = 0;
+  return iterateIDs(ctx, ns_key, metadata, start_id, reversed, [&](uint64_t id) {
+    if (id == cursor_id || pos++ < offset) return true;
     ids->emplace_back(id);
-    if (limit > 0 && ids->size() >= limit) break;
-  }
-  return rocksdb::Status::OK();
+    return limit == 0 || ids->size() < limit;
+  });
 }
 
 rocksdb::Status Sortedint::RangeByValue(engine::Context &ctx, const Slice &user_key, SortedintRangeSpec spec,
@@ -166,45 +373,20 @@ rocksdb::Status Sortedint::RangeByValue(engine::Context &ctx, const Slice &user_
   rocksdb::Status s = GetMetadata(ctx, ns_key, &metadata);
   if (!s.ok()) return s.IsNotFound() ? rocksdb::Status::OK() : s;
 
-  std::string start_buf;
-  PutFixed64(&start_buf, spec.reversed ? spec.max : spec.min);
-  std::string start_key = InternalKey(ns_key, start_buf, metadata.version, storage_->IsSlotIdEncoded()).Encode();
-  std::string prefix_key = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
-  std::string next_version_prefix_key =
-      InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
-
-  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
-  rocksdb::Slice upper_bound(next_version_prefix_key);
-  read_options.iterate_upper_bound = &upper_bound;
-  rocksdb::Slice lower_bound(prefix_key);
-  read_options.iterate_lower_bound = &lower_bound;
-
   int pos = 0;
-  auto iter = util::UniqueIterator(ctx, read_options);
-  if (!spec.reversed) {
-    iter->Seek(start_key);
-  } else {
-    iter->SeekForPrev(start_key);
-  }
-
-  uint64_t id = 0;
-  for (; iter->Valid() && iter->key().starts_with(prefix_key); !spec.reversed ? iter->Next() : iter->Prev()) {
-    InternalKey ikey(iter->key(), storage_->IsSlotIdEncoded());
-    Slice sub_key = ikey.GetSubKey();
-    GetFixed64(&sub_key, &id);
+  return iterateIDs(ctx, ns_key, metadata, spec.reversed ? spec.max : spec.min, spec.reversed, [&](uint64_t id) {
     if (spec.reversed) {
-      if ((spec.minex && id == spec.min) || id < spec.min) break;
-      if ((spec.maxex && id == spec.max) || id > spec.max) continue;
+      if ((spec.minex && id == spec.min) || id < spec.min) return false;
+      if ((spec.maxex && id == spec.max) || id > spec.max) return true;
     } else {
-      if ((spec.minex && id == spec.min) || id < spec.min) continue;
-      if ((spec.maxex && id == spec.max) || id > spec.max) break;
+      if ((spec.minex && id == spec.min) || id < spec.min) return true;
+      if ((spec.maxex && id == spec.max) || id > spec.max) return false;
     }
-    if (spec.offset >= 0 && pos++ < spec.offset) continue;
+    if (spec.offset >= 0 && pos++ < spec.offset) return true;
     if (ids) ids->emplace_back(id);
     if (size) *size += 1;
-    if (spec.count > 0 && ids && ids->size() >= static_cast<unsigned>(spec.count)) break;
-  }
-  return rocksdb::Status::OK();
+    return !(spec.count > 0 && ids && ids->size() >= static_cast<unsigned>(spec.count));
+  });
 }
 
 rocksdb::Status Sortedint::MExist(engine::Context &ctx, const Slice &user_key, const std::vector<uint64_t> &ids,
@@ -215,12 +397,38 @@ rocksdb::Status Sortedint::MExist(engine::Context &ctx, const Slice &user_key, c
   rocksdb::Status s = GetMetadata(ctx, ns_key, &metadata);
   if (!s.ok()) return s;
 
+  if (metadata.IsBlockEncoded()) {
+    std::string prefix = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
+    rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+    rocksdb::Slice lower_bound(prefix);
+    read_options.iterate_lower_bound = &lower_bound;
+    auto iter = util::UniqueIterator(ctx, read_options);
+
+    // the IDs are looked up in the block they belong to, which is decoded once for the adjacent IDs
+    std::optional<uint64_t> block_id;
+    std::vector<uint64_t> block_ids;
+    for (const auto id : ids) {
+      iter->SeekForPrev(subKey(ns_key, metadata, id));
+      if (!iter->Valid() || !iter->key().starts_with(prefix)) {
+        if (!iter->status().ok()) return iter->status();
+        exists->emplace_back(0);
+        continue;
+      }
+      auto first_id = SubKeyID(iter->key(), storage_->IsSlotIdEncoded());
+      if (block_id != first_id) {
+        block_ids.clear();
+        s = SortedintBlock::Decode(first_id, iter->value(), &block_ids);
+        if (!s.ok()) return s;
+        block_id = first_id;
+      }
+      exists->emplace_back(std::binary_search(block_ids.begin(), block_ids.end(), id) ? 1 : 0);
+    }
+    return rocksdb::Status::OK();
+  }
+
   std::string value;
   for (const auto id : ids) {
-    std::string id_buf;
-    PutFixed64(&id_buf, id);
-    std::string sub_key = InternalKey(ns_key, id_buf, metadata.version, storage_->IsSlotIdEncoded()).Encode();
-    s = storage_->Get(ctx, ctx.GetReadOptions(), sub_key, &value);
+    s = storage_->Get(ctx, ctx.GetReadOptions(), subKey(ns_key, metadata, id), &value);
     if (!s.ok() && !s.IsNotFound()) return s;
     if (s.IsNotFound()) {
       exists->emplace_back(0);
@@ -20,7 +20,9 @@
 
 #pragma once
 
+#include <functional>
 #include <limits>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -55,6 +57,24 @@ class Sortedint : public Database {
 
  private:
   rocksdb::Status GetMetadata(engine::Context &ctx, const Slice &ns_key, SortedintMetadata *metadata);
+  void initEncoding(SortedintMetadata *metadata) const;
+  std::string subKey(const Slice &ns_key, const SortedintMetadata &metadata, uint64_t id) const;
+
+  // The block encoded sortedints add and remove the IDs by rewriting the blocks they belong to,
+  // an ID belongs to the block with the largest first ID not larger than it
+  rocksdb::Status addToBlocks(engine::Context &ctx, const Slice &ns_key, const SortedintMetadata &metadata,
+                              const std::vector<uint64_t> &ids, rocksdb::WriteBatchBase *batch, uint64_t *added_cnt);
+  rocksdb::Status removeFromBlocks(engine::Context &ctx, const Slice &ns_key, const SortedintMetadata &metadata,
+                                   const std::vector<uint64_t> &ids, rocksdb::WriteBatchBase *batch,
+                                   uint64_t *removed_cnt);
+  // writeBlock replaces the block of old_first_id with the IDs, which are split into more blocks if there are
+  // too many of them, or removed if there's none
+  rocksdb::Status writeBlock(const Slice &ns_key, const SortedintMetadata &metadata,
+                             std::optional<uint64_t> old_first_id, const std::vector<uint64_t> &ids,
+                             rocksdb::WriteBatchBase *batch);
+  // iterateIDs calls the callback with the IDs from start_id on, descending if reversed, until it returns false
+  rocksdb::Status iterateIDs(engine::Context &ctx, const Slice &ns_key, const SortedintMetadata &metadata,
+                             uint64_t start_id, bool reversed, const std::function<bool(uint64_t)> &callback);
 };
 
 }  // namespace redis
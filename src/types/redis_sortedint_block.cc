@@ -0,0 +1,98 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "redis_sortedint_block.h"
+
+#include <algorithm>
+
+#include "common/encoding.h"
+
+namespace redis {
+
+namespace {
+
+constexpr size_t kHeaderSize = 2 + 1;
+
+uint8_t DeltaWidth(uint64_t max_delta) {
+  uint8_t width = 0;
+  while (width < 64 && (max_delta >> width) != 0) width++;
+  // the wider deltas may span 9 bytes with the bit offset, which a 64-bit load can't read
+  return width > 56 ? 64 : width;
+}
+
+uint64_t LoadLittleEndian64(const uint8_t *p, size_t avail) {
+  uint64_t word = 0;
+  for (size_t i = 0; i < std::min<size_t>(avail, 8); i++) {
+    word |= static_cast<uint64_t>(p[i]) << (8 * i);
+  }
+  return word;
+}
+
+}  // namespace
+
+std::string SortedintBlock::Encode(const uint64_t *ids, size_t n) {
+  uint64_t max_delta = 0;
+  for (size_t i = 1; i < n; i++) {
+    max_delta = std::max(max_delta, ids[i] - ids[i - 1]);
+  }
+  uint8_t width = DeltaWidth(max_delta);
+
+  std::string block;
+  PutFixed16(&block, static_cast<uint16_t>(n));
+  PutFixed8(&block, width);
+  size_t packed_bytes = ((n - 1) * width + 7) / 8;
+  block.resize(kHeaderSize + packed_bytes, '\0');
+
+  auto packed = reinterpret_cast<uint8_t *>(block.data() + kHeaderSize);
+  size_t bit = 0;
+  for (size_t i = 1; i < n; i++, bit += width) {
+    uint64_t word = (ids[i] - ids[i - 1]) << (bit % 8);
+    for (size_t j = 0; j * 8 < width + bit % 8; j++) {
+      packed[bit / 8 + j] |= static_cast<uint8_t>(word >> (8 * j));
+    }
+  }
+  return block;
+}
+
+rocksdb::Status SortedintBlock::Decode(uint64_t first_id, const rocksdb::Slice &block, std::vector<uint64_t> *ids) {
+  if (block.size() < kHeaderSize) return rocksdb::Status::Corruption("the sortedint block is too short");
+  size_t n = DecodeFixed16(block.data());
+  uint8_t width = static_cast<uint8_t>(block[2]);
+  size_t packed_bytes = block.size() - kHeaderSize;
+  if (n == 0 || width > 64 || packed_bytes != ((n - 1) * width + 7) / 8) {
+    return rocksdb::Status::Corruption("the sortedint block is malformed");
+  }
+
+  auto packed = reinterpret_cast<const uint8_t *>(block.data() + kHeaderSize);
+  uint64_t mask = width == 64 ? ~uint64_t(0) : (uint64_t(1) << width) - 1;
+  size_t base = ids->size();
+  ids->resize(base + n);
+  uint64_t *out = ids->data() + base;
+  out[0] = first_id;
+  size_t bit = 0;
+  for (size_t i = 1; i < n; i++, bit += width) {
+    size_t pos = bit / 8;
+    uint64_t delta = (LoadLittleEndian64(packed + pos, packed_bytes - pos) >> (bit % 8)) & mask;
+    out[i] = out[i - 1] + delta;
+  }
+  return rocksdb::Status::OK();
+}
+
+}  // namespace redis
@@ -0,0 +1,51 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <rocksdb/slice.h>
+#include <rocksdb/status.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace redis {
+
+// SortedintBlock is the value of a block of the block encoded sortedints, which packs up to kMaxIDs
+// ascending IDs under the subkey of the first one:
+//
+//   fixed16 count | fixed8 width | the deltas between the adjacent IDs, `width` bits each
+//
+// The deltas are packed from the lowest bit of each byte, and the widths above 56 bits are rounded
+// up to 64, so any delta is read by one unaligned 64-bit load. Dense IDs cost a few bits each, instead
+// of a subkey each.
+class SortedintBlock {
+ public:
+  static constexpr size_t kMaxIDs = 128;
+
+  // Encode the ascending and unique IDs into a block, the first one is left to the subkey
+  static std::string Encode(const uint64_t *ids, size_t n);
+  // Decode the IDs of a block, whose first ID is taken from its subkey, and append them to ids
+  static rocksdb::Status Decode(uint64_t first_id, const rocksdb::Slice &block, std::vector<uint64_t> *ids);
+};
+
+}  // namespace redis
@@ -22,6 +22,7 @@
 
 #include <rocksdb/status.h>
 
+#include <algorithm>
 #include <memory>
 #include <utility>
 #include <vector>
@@ -66,6 +67,25 @@ rocksdb::Status Stream::GetLastGeneratedID(engine::Context &ctx, const Slice &st
   return rocksdb::Status::OK();
 }
 
+std::vector<rocksdb::Status> Stream::MultiGetMetadata(engine::Context &ctx,
+                                                      const std::vector<std::string> &stream_names,
+                                                      std::vector<StreamMetadata> *metadatas) {
+  std::vector<std::string> ns_keys;
+  ns_keys.reserve(stream_names.size());
+  for (const auto &name : stream_names) ns_keys.emplace_back(AppendNamespacePrefix(name));
+  std::vector<Slice> key_slices(ns_keys.begin(), ns_keys.end());
+
+  std::vector<std::string> raw_values;
+  auto statuses = MultiGetRawMetadata(ctx, key_slices, &raw_values);
+  metadatas->assign(stream_names.size(), StreamMetadata(false));
+  for (size_t i = 0; i < statuses.size(); i++) {
+    if (!statuses[i].ok()) continue;
+    Slice slice = raw_values[i];
+    statuses[i] = ParseMetadata({kRedisStream}, &slice, &(*metadatas)[i]);
+  }
+  return statuses;
+}
+
 StreamEntryID Stream::entryIDFromInternalKey(const rocksdb::Slice &key) const {
   InternalKey ikey(key, storage_->IsSlotIdEncoded());
   Slice entry_id = ikey.GetSubKey();
@@ -86,14 +106,31 @@ std::string Stream::internalKeyFromEntryID(const std::string &ns_key, const Stre
 
 rocksdb::Status Stream::Add(engine::Context &ctx, const Slice &stream_name, const StreamAddOptions &options,
                             const std::vector<std::string> &args, StreamEntryID *id) {
-  for (auto const &v : args) {
-    if (v.size() > INT32_MAX) {
-      return rocksdb::Status::InvalidArgument("argument length is too high");
+  std::vector<StreamEntryID> ids;
+  auto s = addEntries(ctx, stream_name, options, {{options.next_id_strategy.get(), &args}}, &ids);
+  if (!ids.empty()) *id = ids.back();
+  return s;
+}
+
+rocksdb::Status Stream::AddEntries(engine::Context &ctx, const Slice &stream_name, const StreamAddOptions &options,
+                                   const std::vector<StreamAddEntry> &entries, std::vector<StreamEntryID> *ids) {
+  std::vector<AddEntryRef> refs;
+  refs.reserve(entries.size());
+  for (const auto &entry : entries) refs.emplace_back(entry.next_id_strategy.get(), &entry.values);
+  return addEntries(ctx, stream_name, options, refs, ids);
+}
+
+rocksdb::Status Stream::addEntries(engine::Context &ctx, const Slice &stream_name, const StreamAddOptions &options,
+                                   const std::vector<AddEntryRef> &entries, std::vector<StreamEntryID> *ids) {
+  ids->clear();
+  for (const auto &[strategy, args] : entries) {
+    for (auto const &v : *args) {
+      if (v.size() > INT32_MAX) {
+        return rocksdb::Status::InvalidArgument("argument length is too high");
+      }
     }
   }
 
-  std::string entry_value = EncodeStreamEntryValue(args);
-
   std::string ns_key = AppendNamespacePrefix(stream_name);
 
   LockGuard guard(storage_->GetLockManager(), ns_key);
@@ -105,46 +142,65 @@ rocksdb::Status Stream::Add(engine::Context &ctx, const Slice &stream_name, cons
     return s;
   }
 
-  StreamEntryID next_entry_id;
-  auto status = options.next_id_strategy->GenerateID(metadata.last_generated_id, &next_entry_id);
-  if (!status.IsOK()) return rocksdb::Status::InvalidArgument(status.Msg());
+  // all the IDs are generated first, so nothing is written if one of them is invalid
+  StreamEntryID last_id = metadata.last_generated_id;
+  for (const auto &[strategy, args] : entries) {
+    StreamEntryID next_entry_id;
+    auto status = strategy->GenerateID(last_id, &next_entry_id);
+    if (!status.IsOK()) {
+      ids->clear();
+      return rocksdb::Status::InvalidArgument(status.Msg());
+    }
+    ids->push_back(next_entry_id);
+    last_id = next_entry_id;
+  }
 
   auto batch = storage_->GetWriteBatchBase();
   WriteBatchLogData log_data(kRedisStream);
   s = batch->PutLogData(log_data.Encode());
   if (!s.ok()) return s;
 
-  bool should_add = true;
+  // the entries before it would be removed by the trimming right away, so they're not added
+  size_t first_added = 0;
 
-  // trim the stream before adding a new entry to provide atomic XADD + XTRIM
+  // trim the stream before adding the new entries to provide atomic XADD + XTRIM
   if (options.trim_options.strategy != StreamTrimStrategy::None) {
     StreamTrimOptions trim_options = options.trim_options;
     if (trim_options.strategy == StreamTrimStrategy::MaxLen) {
-      // because one entry will be added, we can trim up to (MAXLEN-1) if MAXLEN was specified
-      trim_options.max_len = options.trim_options.max_len > 0 ? options.trim_options.max_len - 1 : 0;
+      // because the entries will be added, we can trim up to (MAXLEN-n) if MAXLEN was specified
+      auto max_len = options.trim_options.max_len;
+      trim_options.max_len = max_len > entries.size() ? max_len - entries.size() : 0;
     }
 
     uint64_t delete_cnt = 0;
     s = trim(ctx, ns_key, trim_options, &metadata, batch->GetWriteBatch(), delete_cnt);
     if (!s.ok()) return s;
 
-    if (trim_options.strategy == StreamTrimStrategy::MinID && next_entry_id < trim_options.min_id) {
-      // there is no sense to add this element because it would be removed, so just modify metadata and return it's ID
-      should_add = false;
+    if (!trim_options.approximate && trim_options.strategy == StreamTrimStrategy::MinID) {
+      // there is no sense to add the elements because they would be removed, so just modify metadata for them
+      while (first_added < ids->size() && (*ids)[first_added] < trim_options.min_id) first_added++;
     }
 
-    if (trim_options.strategy == StreamTrimStrategy::MaxLen && options.trim_options.max_len == 0) {
-      // there is no sense to add this element because it would be removed, so just modify metadata and return it's ID
-      should_add = false;
+    if (!trim_options.approximate && trim_options.strategy == StreamTrimStrategy::MaxLen) {
+      // there is no sense to add the elements because they would be removed, so just modify metadata for them
+      first_added = entries.size() - std::min<uint64_t>(entries.size(), options.trim_options.max_len);
     }
   }
 
-  if (should_add) {
+  for (size_t i = 0; i < entries.size(); i++) {
+    const auto &next_entry_id = (*ids)[i];
+    metadata.last_generated_id = next_entry_id;
+    metadata.entries_added += 1;
+
+    if (i < first_added) {
+      metadata.max_deleted_entry_id = next_entry_id;
+      continue;
+    }
+
     std::string entry_key = internalKeyFromEntryID(ns_key, metadata, next_entry_id);
-    s = batch->Put(stream_cf_handle_, entry_key, entry_value);
+    s = batch->Put(stream_cf_handle_, entry_key, EncodeStreamEntryValue(*entries[i].second));
     if (!s.ok()) return s;
 
-    metadata.last_generated_id = next_entry_id;
     metadata.last_entry_id = next_entry_id;
     metadata.size += 1;
 
@@ -152,20 +208,13 @@ rocksdb::Status Stream::Add(engine::Context &ctx, const Slice &stream_name, cons
       metadata.first_entry_id = next_entry_id;
       metadata.recorded_first_entry_id = next_entry_id;
     }
-  } else {
-    metadata.last_generated_id = next_entry_id;
-    metadata.max_deleted_entry_id = next_entry_id;
   }
 
-  metadata.entries_added += 1;
-
   std::string metadata_bytes;
   metadata.Encode(&metadata_bytes);
   s = batch->Put(metadata_cf_handle_, ns_key, metadata_bytes);
   if (!s.ok()) return s;
 
-  *id = next_entry_id;
-
   return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
 }
 
@@ -202,6 +251,7 @@ std::string Stream::encodeStreamConsumerGroupMetadataValue(const StreamConsumerG
   PutFixed64(&dst, consumer_group_metadata.last_delivered_id.seq);
   PutFixed64(&dst, static_cast<uint64_t>(consumer_group_metadata.entries_read));
   PutFixed64(&dst, consumer_group_metadata.lag);
+  PutFixed8(&dst, consumer_group_metadata.pel_time_indexed ? 1 : 0);
   return dst;
 }
 
@@ -216,6 +266,11 @@ StreamConsumerGroupMetadata Stream::decodeStreamConsumerGroupMetadataValue(const
   GetFixed64(&input, &entries_read);
   consumer_group_metadata.entries_read = static_cast<int64_t>(entries_read);
   GetFixed64(&input, &consumer_group_metadata.lag);
+  // the groups written before the PEL time index don't have the flag
+  uint8_t pel_time_indexed = 0;
+  if (GetFixed8(&input, &pel_time_indexed)) {
+    consumer_group_metadata.pel_time_indexed = pel_time_indexed != 0;
+  }
   return consumer_group_metadata;
 }
 
@@ -294,6 +349,57 @@ StreamEntryID Stream::groupAndEntryIdFromPelInternalKey(rocksdb::Slice key, std:
   return entry_id;
 }
 
+std::string Stream::internalPelTimeIndexKey(const std::string &ns_key, const StreamMetadata &metadata,
+                                            const std::string &group_name, uint64_t delivery_time_ms,
+                                            const StreamEntryID &id) const {
+  std::string sub_key;
+  PutFixed64(&sub_key, UINT64_MAX);
+  PutFixed8(&sub_key, (uint8_t)StreamSubkeyType::StreamPelTimeIndex);
+  PutFixed64(&sub_key, group_name.size());
+  sub_key += group_name;
+  PutFixed64(&sub_key, delivery_time_ms);
+  PutFixed64(&sub_key, id.ms);
+  PutFixed64(&sub_key, id.seq);
+  return InternalKey(ns_key, sub_key, metadata.version, storage_->IsSlotIdEncoded()).Encode();
+}
+
+StreamEntryID Stream::entryIdFromPelTimeIndexKey(rocksdb::Slice key, uint64_t *delivery_time_ms) const {
+  InternalKey ikey(key, storage_->IsSlotIdEncoded());
+  Slice subkey = ikey.GetSubKey();
+  uint64_t entry_delimiter = 0;
+  GetFixed64(&subkey, &entry_delimiter);
+  uint8_t type_delimiter = 0;
+  GetFixed8(&subkey, &type_delimiter);
+  uint64_t group_name_len = 0;
+  GetFixed64(&subkey, &group_name_len);
+  subkey.remove_prefix(group_name_len);
+  GetFixed64(&subkey, delivery_time_ms);
+  StreamEntryID entry_id;
+  GetFixed64(&subkey, &entry_id.ms);
+  GetFixed64(&subkey, &entry_id.seq);
+  return entry_id;
+}
+
+// Move the PEL entry in the time index from the old delivery time to the new one,
+// nullopt for the entry which is added to or removed from the PEL.
+rocksdb::Status Stream::updatePelTimeIndex(rocksdb::WriteBatchBase *batch, const std::string &ns_key,
+                                           const StreamMetadata &metadata, const std::string &group_name,
+                                           const StreamEntryID &id, std::optional<uint64_t> old_delivery_time_ms,
+                                           std::optional<uint64_t> new_delivery_time_ms) {
+  if (old_delivery_time_ms == new_delivery_time_ms) return rocksdb::Status::OK();
+  if (old_delivery_time_ms) {
+    auto s = batch->Delete(stream_cf_handle_,
+                           internalPelTimeIndexKey(ns_key, metadata, group_name, *old_delivery_time_ms, id));
+    if (!s.ok()) return s;
+  }
+  if (new_delivery_time_ms) {
+    auto s = batch->Put(stream_cf_handle_,
+                        internalPelTimeIndexKey(ns_key, metadata, group_name, *new_delivery_time_ms, id), Slice());
+    if (!s.ok()) return s;
+  }
+  return rocksdb::Status::OK();
+}
+
 std::string Stream::encodeStreamPelEntryValue(const StreamPelEntry &pel_entry) {
   std::string dst;
   PutFixed64(&dst, pel_entry.last_delivery_time_ms);
@@ -352,6 +458,7 @@ rocksdb::Status Stream::DeletePelEntries(engine::Context &ctx, const Slice &stre
   s = batch->PutLogData(log_data.Encode());
   if (!s.ok()) return s;
 
+  StreamConsumerGroupMetadata group_metadata = decodeStreamConsumerGroupMetadataValue(get_group_value);
   std::map<std::string, uint64_t> consumer_acknowledges;
   for (const auto &id : entry_ids) {
     std::string entry_key = internalPelKeyFromGroupAndEntryId(ns_key, metadata, group_name, id);
@@ -368,10 +475,14 @@ rocksdb::Status Stream::DeletePelEntries(engine::Context &ctx, const Slice &stre
       // increment ack for each related consumer
       auto pel_entry = decodeStreamPelEntryValue(value);
       consumer_acknowledges[pel_entry.consumer_name]++;
+      if (group_metadata.pel_time_indexed) {
+        s = updatePelTimeIndex(batch.Get(), ns_key, metadata, group_name, id, pel_entry.last_delivery_time_ms,
+                               std::nullopt);
+        if (!s.ok()) return s;
+      }
     }
   }
   if (*acknowledged > 0) {
-    StreamConsumerGroupMetadata group_metadata = decodeStreamConsumerGroupMetadataValue(get_group_value);
     group_metadata.pending_number -= *acknowledged;
     std::string group_value = encodeStreamConsumerGroupMetadataValue(group_metadata);
     s = batch->Put(stream_cf_handle_, group_key, group_value);
@@ -450,6 +561,7 @@ rocksdb::Status Stream::ClaimPelEntries(engine::Context &ctx, const Slice &strea
     std::string value;
     s = storage_->Get(ctx, ctx.GetReadOptions(), stream_cf_handle_, entry_key, &value);
     StreamPelEntry pel_entry;
+    std::optional<uint64_t> old_delivery_time_ms;
 
     if (!s.ok() && s.IsNotFound() && options.force) {
       pel_entry = {0, 0, ""};
@@ -458,6 +570,7 @@ rocksdb::Status Stream::ClaimPelEntries(engine::Context &ctx, const Slice &strea
 
     if (s.ok()) {
       pel_entry = decodeStreamPelEntryValue(value);
+      old_delivery_time_ms = pel_entry.last_delivery_time_ms;
     }
 
     if (s.ok() || (s.IsNotFound() && options.force)) {
@@ -512,6 +625,11 @@ rocksdb::Status Stream::ClaimPelEntries(engine::Context &ctx, const Slice &strea
       std::string pel_value = encodeStreamPelEntryValue(pel_entry);
       s = batch->Put(stream_cf_handle_, entry_key, pel_value);
       if (!s.ok()) return s;
+      if (group_metadata.pel_time_indexed) {
+        s = updatePelTimeIndex(batch.Get(), ns_key, metadata, group_name, id, old_delivery_time_ms,
+                               pel_entry.last_delivery_time_ms);
+        if (!s.ok()) return s;
+      }
     }
   }
 
@@ -561,6 +679,12 @@ rocksdb::Status Stream::AutoClaim(engine::Context &ctx, const Slice &stream_name
   }
 
   StreamConsumerMetadata current_consumer_metadata = decodeStreamConsumerMetadataValue(get_consumer_value);
+  std::string group_key = internalKeyFromGroupName(ns_key, metadata, group_name);
+  std::string get_group_value;
+  s = storage_->Get(ctx, ctx.GetReadOptions(), stream_cf_handle_, group_key, &get_group_value);
+  if (!s.ok()) return s;
+  bool pel_time_indexed = decodeStreamConsumerGroupMetadataValue(get_group_value).pel_time_indexed;
+
   std::map<std::string, uint64_t> claimed_consumer_entity_count;
   std::string prefix_key = internalPelKeyFromGroupAndEntryId(ns_key, metadata, group_name, options.start_id);
   std::string end_key = internalPelKeyFromGroupAndEntryId(ns_key, metadata, group_name, StreamEntryID::Maximum());
@@ -607,6 +731,11 @@ rocksdb::Status Stream::AutoClaim(engine::Context &ctx, const Slice &stream_name
         deleted_entries.push_back(entry_id);
         s = batch->Delete(stream_cf_handle_, iter->key());
         if (!s.ok()) return s;
+        if (pel_time_indexed) {
+          s = updatePelTimeIndex(batch.Get(), ns_key, metadata, group_name, entry_id,
+                                 penl_entry.last_delivery_time_ms, std::nullopt);
+          if (!s.ok()) return s;
+        }
         --count;
         continue;
       }
@@ -627,6 +756,11 @@ rocksdb::Status Stream::AutoClaim(engine::Context &ctx, const Slice &stream_name
     if (penl_entry.consumer_name != consumer_name) {
       ++total_claimed_count;
       claimed_consumer_entity_count[penl_entry.consumer_name] += 1;
+      if (pel_time_indexed) {
+        s = updatePelTimeIndex(batch.Get(), ns_key, metadata, group_name, entry_id,
+                               penl_entry.last_delivery_time_ms, now_ms);
+        if (!s.ok()) return s;
+      }
       penl_entry.consumer_name = consumer_name;
       penl_entry.last_delivery_time_ms = now_ms;
       // Increment the delivery attempts counter unless JUSTID option provided
@@ -713,6 +847,7 @@ rocksdb::Status Stream::CreateGroup(engine::Context &ctx, const Slice &stream_na
     }
   }
   consumer_group_metadata.entries_read = options.entries_read;
+  consumer_group_metadata.pel_time_indexed = true;
   std::string entry_key = internalKeyFromGroupName(ns_key, metadata, group_name);
   std::string entry_value = encodeStreamConsumerGroupMetadataValue(consumer_group_metadata);
 
@@ -882,6 +1017,7 @@ rocksdb::Status Stream::DestroyConsumer(engine::Context &ctx, const Slice &strea
   }
 
   StreamConsumerMetadata consumer_metadata = decodeStreamConsumerMetadataValue(get_consumer_value);
+  StreamConsumerGroupMetadata group_metadata = decodeStreamConsumerGroupMetadataValue(get_group_value);
   deleted_pel = consumer_metadata.pending_number;
   auto batch = storage_->GetWriteBatchBase();
   WriteBatchLogData log_data(kRedisStream);
@@ -903,6 +1039,13 @@ rocksdb::Status Stream::DestroyConsumer(engine::Context &ctx, const Slice &strea
     if (pel_entry.consumer_name == consumer_name) {
       s = batch->Delete(stream_cf_handle_, iter->key());
       if (!s.ok()) return s;
+      if (group_metadata.pel_time_indexed) {
+        std::string tmp_group_name;
+        StreamEntryID entry_id = groupAndEntryIdFromPelInternalKey(iter->key(), tmp_group_name);
+        s = updatePelTimeIndex(batch.Get(), ns_key, metadata, group_name, entry_id, pel_entry.last_delivery_time_ms,
+                               std::nullopt);
+        if (!s.ok()) return s;
+      }
     }
   }
 
@@ -912,7 +1055,6 @@ rocksdb::Status Stream::DestroyConsumer(engine::Context &ctx, const Slice &strea
 
   s = batch->Delete(stream_cf_handle_, consumer_key);
   if (!s.ok()) return s;
-  StreamConsumerGroupMetadata group_metadata = decodeStreamConsumerGroupMetadataValue(get_group_value);
   group_metadata.consumer_number -= 1;
   group_metadata.pending_number -= deleted_pel;
   s = batch->Put(stream_cf_handle_, group_key, encodeStreamConsumerGroupMetadataValue(group_metadata));
@@ -987,50 +1129,71 @@ rocksdb::Status Stream::DeleteEntries(engine::Context &ctx, const Slice &stream_
   rocksdb::Slice lower_bound(prefix_key);
   read_options.iterate_lower_bound = &lower_bound;
 
-  auto iter = util::UniqueIterator(ctx, read_options, stream_cf_handle_);
-
-  for (const auto &id : ids) {
-    std::string entry_key = internalKeyFromEntryID(ns_key, metadata, id);
-    std::string value;
-    s = storage_->Get(ctx, read_options, stream_cf_handle_, entry_key, &value);
-    if (s.ok()) {
-      *deleted_cnt += 1;
-      s = batch->Delete(stream_cf_handle_, entry_key);
-      if (!s.ok()) return s;
+  // check the entries by one MultiGet in the order of the IDs, each of them is only counted once
+  std::vector<StreamEntryID> sorted_ids = ids;
+  std::sort(sorted_ids.begin(), sorted_ids.end());
+  sorted_ids.erase(std::unique(sorted_ids.begin(), sorted_ids.end()), sorted_ids.end());
+
+  std::vector<std::string> keys;
+  std::vector<rocksdb::Slice> key_slices;
+  keys.reserve(sorted_ids.size());
+  key_slices.reserve(sorted_ids.size());
+  for (const auto &id : sorted_ids) {
+    keys.emplace_back(internalKeyFromEntryID(ns_key, metadata, id));
+    key_slices.emplace_back(keys.back());
+  }
+  std::vector<rocksdb::PinnableSlice> values(keys.size());
+  std::vector<rocksdb::Status> statuses(keys.size());
+  storage_->MultiGet(ctx, ctx.DefaultMultiGetOptions(), stream_cf_handle_, key_slices.size(), key_slices.data(),
+                     values.data(), statuses.data());
+
+  std::vector<StreamEntryID> deleted_ids;
+  for (size_t i = 0; i < keys.size(); i++) {
+    if (statuses[i].IsNotFound()) continue;
+    if (!statuses[i].ok()) return statuses[i];
+
+    s = batch->Delete(stream_cf_handle_, keys[i]);
+    if (!s.ok()) return s;
+    deleted_ids.emplace_back(sorted_ids[i]);
+  }
+  *deleted_cnt = deleted_ids.size();
 
-      if (metadata.max_deleted_entry_id < id) {
-        metadata.max_deleted_entry_id = id;
-      }
+  if (*deleted_cnt > 0 && metadata.max_deleted_entry_id < deleted_ids.back()) {
+    metadata.max_deleted_entry_id = deleted_ids.back();
+  }
 
-      if (*deleted_cnt == metadata.size) {
+  auto is_deleted = [&deleted_ids](const StreamEntryID &id) {
+    return std::binary_search(deleted_ids.begin(), deleted_ids.end(), id);
+  };
+  if (*deleted_cnt >= metadata.size) {
+    metadata.first_entry_id.Clear();
+    metadata.last_entry_id.Clear();
+    metadata.recorded_first_entry_id.Clear();
+  } else if (*deleted_cnt > 0) {
+    // the deletions are not written yet, so the new first and last entries are the ones not deleted
+    auto iter = util::UniqueIterator(ctx, read_options, stream_cf_handle_);
+    if (is_deleted(metadata.first_entry_id)) {
+      iter->Seek(internalKeyFromEntryID(ns_key, metadata, metadata.first_entry_id));
+      while (iter->Valid() && is_deleted(entryIDFromInternalKey(iter->key()))) iter->Next();
+      if (iter->Valid()) {
+        metadata.first_entry_id = entryIDFromInternalKey(iter->key());
+        metadata.recorded_first_entry_id = metadata.first_entry_id;
+      } else {
         metadata.first_entry_id.Clear();
-        metadata.last_entry_id.Clear();
         metadata.recorded_first_entry_id.Clear();
-        break;
-      }
-
-      if (id == metadata.first_entry_id) {
-        iter->Seek(entry_key);
-        iter->Next();
-        if (iter->Valid()) {
-          metadata.first_entry_id = entryIDFromInternalKey(iter->key());
-          metadata.recorded_first_entry_id = metadata.first_entry_id;
-        } else {
-          metadata.first_entry_id.Clear();
-          metadata.recorded_first_entry_id.Clear();
-        }
       }
+    }
 
-      if (id == metadata.last_entry_id) {
-        iter->Seek(entry_key);
-        iter->Prev();
-        if (iter->Valid()) {
-          metadata.last_entry_id = entryIDFromInternalKey(iter->key());
-        } else {
-          metadata.last_entry_id.Clear();
-        }
+    if (is_deleted(metadata.last_entry_id)) {
+      iter->Seek(internalKeyFromEntryID(ns_key, metadata, metadata.last_entry_id));
+      while (iter->Valid() && is_deleted(entryIDFromInternalKey(iter->key()))) iter->Prev();
+      if (iter->Valid()) {
+        metadata.last_entry_id = entryIDFromInternalKey(iter->key());
+      } else {
+        metadata.last_entry_id.Clear();
       }
     }
+    if (auto st = iter->status(); !st.ok()) return st;
   }
 
   if (*deleted_cnt > 0) {
@@ -1434,6 +1597,40 @@ rocksdb::Status Stream::Range(engine::Context &ctx, const Slice &stream_name, co
   return range(ctx, ns_key, metadata, options, entries);
 }
 
+rocksdb::Status Stream::MultiRange(engine::Context &ctx, const std::vector<std::string> &stream_names,
+                                   const std::vector<StreamRangeOptions> &options,
+                                   std::vector<std::vector<StreamEntry>> *entries) {
+  entries->clear();
+  entries->resize(stream_names.size());
+
+  std::vector<StreamMetadata> metadatas;
+  auto statuses = MultiGetMetadata(ctx, stream_names, &metadatas);
+  for (size_t i = 0; i < stream_names.size(); i++) {
+    if (statuses[i].IsNotFound()) continue;
+    if (!statuses[i].ok()) return statuses[i];
+
+    const auto &opts = options[i];
+    if (opts.with_count && opts.count == 0) continue;
+    if (opts.exclude_start && opts.start.IsMaximum()) {
+      return rocksdb::Status::InvalidArgument("invalid start ID for the interval");
+    }
+    if (opts.exclude_end && opts.end.IsMinimum()) {
+      return rocksdb::Status::InvalidArgument("invalid end ID for the interval");
+    }
+
+    // the readers usually wait for the new entries, so most of the streams have nothing after the start
+    const auto &metadata = metadatas[i];
+    if (metadata.size == 0) continue;
+    bool after_last = opts.exclude_start ? metadata.last_entry_id <= opts.start : metadata.last_entry_id < opts.start;
+    if (!opts.reverse && after_last) continue;
+
+    auto s = range(ctx, AppendNamespacePrefix(stream_names[i]), metadata, opts, &(*entries)[i]);
+    if (!s.ok()) return s;
+  }
+
+  return rocksdb::Status::OK();
+}
+
 rocksdb::Status Stream::RangeWithPending(engine::Context &ctx, const Slice &stream_name, StreamRangeOptions &options,
                                          std::vector<StreamEntry> *entries, std::string &group_name,
                                          std::string &consumer_name, bool noack, bool latest) {
@@ -1517,6 +1714,11 @@ rocksdb::Status Stream::RangeWithPending(engine::Context &ctx, const Slice &stre
         std::string pel_value = encodeStreamPelEntryValue(pel_entry);
         s = batch->Put(stream_cf_handle_, pel_key, pel_value);
         if (!s.ok()) return s;
+        if (consumergroup_metadata.pel_time_indexed) {
+          s = updatePelTimeIndex(batch.Get(), ns_key, metadata, group_name, id, std::nullopt,
+                                 pel_entry.last_delivery_time_ms);
+          if (!s.ok()) return s;
+        }
         consumergroup_metadata.entries_read += 1;
         consumergroup_metadata.pending_number += 1;
         consumer_metadata.pending_number += 1;
@@ -1553,6 +1755,11 @@ rocksdb::Status Stream::RangeWithPending(engine::Context &ctx, const Slice &stre
         return rocksdb::Status::InvalidArgument(rv.Msg());
       }
       entries->emplace_back(entry_id.ToString(), std::move(values));
+      if (consumergroup_metadata.pel_time_indexed) {
+        s = updatePelTimeIndex(batch.Get(), ns_key, metadata, group_name, entry_id, pel_entry.last_delivery_time_ms,
+                               now_ms);
+        if (!s.ok()) return s;
+      }
       pel_entry.last_delivery_count += 1;
       pel_entry.last_delivery_time_ms = now_ms;
       s = batch->Put(stream_cf_handle_, iter->key(), encodeStreamPelEntryValue(pel_entry));
@@ -1614,22 +1821,30 @@ rocksdb::Status Stream::Trim(engine::Context &ctx, const Slice &stream_name, con
 
 rocksdb::Status Stream::trim(engine::Context &ctx, const std::string &ns_key, const StreamTrimOptions &options,
                              StreamMetadata *metadata, rocksdb::WriteBatch *batch, uint64_t &delete_cnt) {
+  // Removing fewer entries by point deletions is cheaper than adding a range tombstone,
+  // which every read of the stream has to check until it's compacted
+  constexpr uint64_t kMinRangeDeletionEntries = 32;
+
+  delete_cnt = 0;
   if (metadata->size == 0) {
-    delete_cnt = 0;
     return rocksdb::Status::OK();
   }
 
   if (options.strategy == StreamTrimStrategy::MaxLen && metadata->size <= options.max_len) {
-    delete_cnt = 0;
     return rocksdb::Status::OK();
   }
 
   if (options.strategy == StreamTrimStrategy::MinID && metadata->first_entry_id >= options.min_id) {
-    delete_cnt = 0;
     return rocksdb::Status::OK();
   }
 
-  delete_cnt = 0;
+  uint64_t max_delete_cnt = options.strategy == StreamTrimStrategy::MaxLen ? metadata->size - options.max_len
+                                                                           : metadata->size;
+  if (options.approximate) {
+    if (options.limit > 0) max_delete_cnt = std::min(max_delete_cnt, options.limit);
+    max_delete_cnt -= max_delete_cnt % kStreamTrimChunkEntries;
+    if (max_delete_cnt == 0) return rocksdb::Status::OK();
+  }
 
   std::string next_version_prefix_key =
       InternalKey(ns_key, "", metadata->version + 1, storage_->IsSlotIdEncoded()).Encode();
@@ -1645,44 +1860,67 @@ rocksdb::Status Stream::trim(engine::Context &ctx, const std::string &ns_key, co
   std::string start_key = internalKeyFromEntryID(ns_key, *metadata, metadata->first_entry_id);
   iter->Seek(start_key);
 
-  std::string last_deleted;
-  while (iter->Valid() && metadata->size > 0) {
-    if (options.strategy == StreamTrimStrategy::MaxLen && metadata->size <= options.max_len) {
-      break;
-    }
-
-    if (options.strategy == StreamTrimStrategy::MinID && metadata->first_entry_id >= options.min_id) {
-      break;
-    }
-
-    auto s = batch->Delete(stream_cf_handle_, iter->key());
-    if (!s.ok()) {
-      return s;
-    }
-
+  // only find the end of the removed entries here, they are removed by one range deletion
+  // unless there are only a few of them, whose keys are kept for the point deletions
+  std::vector<std::string> deleted_keys;
+  StreamEntryID last_deleted_id;
+  std::string chunk_start_key;
+  StreamEntryID chunk_start_last_deleted_id;
+  for (; iter->Valid() && delete_cnt < max_delete_cnt; iter->Next()) {
+    if (identifySubkeyType(iter->key()) != StreamSubkeyType::StreamEntry) break;
+    auto entry_id = entryIDFromInternalKey(iter->key());
+    if (options.strategy == StreamTrimStrategy::MinID && entry_id >= options.min_id) break;
+
+    if (delete_cnt % kStreamTrimChunkEntries == 0) {
+      chunk_start_key = iter->key().ToString();
+      chunk_start_last_deleted_id = last_deleted_id;
+    }
+    if (deleted_keys.size() < kMinRangeDeletionEntries) deleted_keys.emplace_back(iter->key().ToString());
     delete_cnt += 1;
-    metadata->size -= 1;
-    last_deleted = iter->key().ToString();
+    last_deleted_id = entry_id;
+  }
+  if (auto s = iter->status(); !s.ok()) {
+    return s;
+  }
 
-    iter->Next();
+  // the first entry which is kept, or the end of the entries if all of them are removed
+  std::string end_key;
+  if (options.approximate && delete_cnt % kStreamTrimChunkEntries != 0) {
+    // the entries of the last chunk are not all removable, so the whole chunk is kept
+    delete_cnt -= delete_cnt % kStreamTrimChunkEntries;
+    end_key = chunk_start_key;
+    last_deleted_id = chunk_start_last_deleted_id;
+  } else if (iter->Valid() && identifySubkeyType(iter->key()) == StreamSubkeyType::StreamEntry) {
+    end_key = iter->key().ToString();
+  } else {
+    std::string entries_end;
+    PutFixed64(&entries_end, UINT64_MAX);
+    end_key = InternalKey(ns_key, entries_end, metadata->version, storage_->IsSlotIdEncoded()).Encode();
+  }
+  if (delete_cnt == 0) {
+    return rocksdb::Status::OK();
+  }
 
-    if (iter->Valid()) {
-      metadata->first_entry_id = entryIDFromInternalKey(iter->key());
-      metadata->recorded_first_entry_id = metadata->first_entry_id;
-    } else {
-      metadata->first_entry_id.Clear();
-      metadata->recorded_first_entry_id.Clear();
+  if (delete_cnt < kMinRangeDeletionEntries) {
+    for (uint64_t i = 0; i < delete_cnt; i++) {
+      auto s = batch->Delete(stream_cf_handle_, deleted_keys[i]);
+      if (!s.ok()) return s;
     }
+  } else {
+    auto s = batch->DeleteRange(stream_cf_handle_, deleted_keys.front(), end_key);
+    if (!s.ok()) return s;
+    storage_->AddCompactionHint(ColumnFamilyID::Stream, deleted_keys.front(), end_key);
   }
 
+  metadata->size -= delete_cnt;
+  metadata->max_deleted_entry_id = last_deleted_id;
   if (metadata->size == 0) {
     metadata->first_entry_id.Clear();
     metadata->last_entry_id.Clear();
     metadata->recorded_first_entry_id.Clear();
-  }
-
-  if (delete_cnt > 0) {
-    metadata->max_deleted_entry_id = entryIDFromInternalKey(last_deleted);
+  } else {
+    metadata->first_entry_id = entryIDFromInternalKey(end_key);
+    metadata->recorded_first_entry_id = metadata->first_entry_id;
   }
 
   return rocksdb::Status::OK();
@@ -1766,6 +2004,11 @@ rocksdb::Status Stream::GetPendingEntries(engine::Context &ctx, StreamPendingOpt
     return s.IsNotFound() ? rocksdb::Status::OK() : s;
   }
 
+  StreamConsumerGroupMetadata group_metadata = decodeStreamConsumerGroupMetadataValue(get_group_value);
+  if (options.with_count && options.with_time && group_metadata.pel_time_indexed) {
+    return getIdlePelEntries(ctx, ns_key, metadata, options, &ext_results);
+  }
+
   std::string prefix_key = internalPelKeyFromGroupAndEntryId(ns_key, metadata, group_name, options.start_id);
   std::string end_key = internalPelKeyFromGroupAndEntryId(ns_key, metadata, group_name, options.end_id);
 
@@ -1834,4 +2077,68 @@ rocksdb::Status Stream::GetPendingEntries(engine::Context &ctx, StreamPendingOpt
   return rocksdb::Status::OK();
 }
 
+// Get the PEL entries idle for at least options.idle_time from the time index of the group, so only
+// the idle entries are read instead of the whole PEL. The index keys are checked against the PEL
+// entries, which skips the stale keys of the entries overwritten without reading them first.
+rocksdb::Status Stream::getIdlePelEntries(engine::Context &ctx, const std::string &ns_key,
+                                          const StreamMetadata &metadata, const StreamPendingOptions &options,
+                                          std::vector<StreamNACK> *results) {
+  uint64_t now = util::GetTimeStampMS();
+  if (options.idle_time > now || options.count == 0) return rocksdb::Status::OK();
+  uint64_t max_delivery_time_ms = now - options.idle_time;
+
+  const std::string &group_name = options.group_name;
+  std::string prefix_key = internalPelTimeIndexKey(ns_key, metadata, group_name, 0, StreamEntryID::Minimum());
+  std::string end_key =
+      internalPelTimeIndexKey(ns_key, metadata, group_name, max_delivery_time_ms + 1, StreamEntryID::Minimum());
+
+  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  rocksdb::Slice upper_bound(end_key);
+  read_options.iterate_upper_bound = &upper_bound;
+  rocksdb::Slice lower_bound(prefix_key);
+  read_options.iterate_lower_bound = &lower_bound;
+
+  // the idle entries in the ID range, with the delivery time of the index key
+  std::vector<std::pair<StreamEntryID, uint64_t>> candidates;
+  auto iter = util::UniqueIterator(ctx, read_options, stream_cf_handle_);
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    uint64_t delivery_time_ms = 0;
+    StreamEntryID entry_id = entryIdFromPelTimeIndexKey(iter->key(), &delivery_time_ms);
+    if (entry_id < options.start_id || !(entry_id < options.end_id)) continue;
+    candidates.emplace_back(entry_id, delivery_time_ms);
+  }
+  if (auto s = iter->status(); !s.ok()) {
+    return s;
+  }
+  std::sort(candidates.begin(), candidates.end());
+
+  // read the PEL entries in the order of the IDs, a batch at a time until there are enough of them
+  constexpr size_t kPelReadBatchSize = 128;
+  for (size_t begin = 0; begin < candidates.size() && results->size() < options.count; begin += kPelReadBatchSize) {
+    size_t end = std::min(begin + kPelReadBatchSize, candidates.size());
+    std::vector<std::string> keys;
+    std::vector<rocksdb::Slice> key_slices;
+    keys.reserve(end - begin);
+    key_slices.reserve(end - begin);
+    for (size_t i = begin; i < end; i++) {
+      keys.emplace_back(internalPelKeyFromGroupAndEntryId(ns_key, metadata, group_name, candidates[i].first));
+      key_slices.emplace_back(keys.back());
+    }
+    std::vector<rocksdb::PinnableSlice> values(keys.size());
+    std::vector<rocksdb::Status> statuses(keys.size());
+    storage_->MultiGet(ctx, ctx.DefaultMultiGetOptions(), stream_cf_handle_, key_slices.size(), key_slices.data(),
+                       values.data(), statuses.data());
+
+    for (size_t i = 0; i < keys.size() && results->size() < options.count; i++) {
+      if (statuses[i].IsNotFound()) continue;
+      if (!statuses[i].ok()) return statuses[i];
+      StreamPelEntry pel_entry = decodeStreamPelEntryValue(values[i].ToString());
+      if (pel_entry.last_delivery_time_ms != candidates[begin + i].second) continue;
+      if (options.with_consumer && options.consumer != pel_entry.consumer_name) continue;
+      results->push_back({candidates[begin + i].first, std::move(pel_entry)});
+    }
+  }
+  return rocksdb::Status::OK();
+}
+
 }  // namespace redis
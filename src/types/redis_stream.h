@@ -24,6 +24,7 @@
 
 #include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "storage/redis_db.h"
@@ -39,6 +40,9 @@ class Stream : public SubKeyScanner {
       : SubKeyScanner(storage, ns), stream_cf_handle_(storage->GetCFHandle(ColumnFamilyID::Stream)) {}
   rocksdb::Status Add(engine::Context &ctx, const Slice &stream_name, const StreamAddOptions &options,
                       const std::vector<std::string> &values, StreamEntryID *id);
+  // AddEntries adds the entries by one write like Add, the strategy of the next ID in the options is ignored
+  rocksdb::Status AddEntries(engine::Context &ctx, const Slice &stream_name, const StreamAddOptions &options,
+                             const std::vector<StreamAddEntry> &entries, std::vector<StreamEntryID> *ids);
   rocksdb::Status CreateGroup(engine::Context &ctx, const Slice &stream_name, const StreamXGroupCreateOptions &options,
                               const std::string &group_name);
   rocksdb::Status DestroyGroup(engine::Context &ctx, const Slice &stream_name, const std::string &group_name,
@@ -78,12 +82,26 @@ class Stream : public SubKeyScanner {
                        uint64_t *delete_cnt);
   rocksdb::Status GetMetadata(engine::Context &ctx, const Slice &stream_name, StreamMetadata *metadata);
   rocksdb::Status GetLastGeneratedID(engine::Context &ctx, const Slice &stream_name, StreamEntryID *id);
+  // MultiGetMetadata reads the metadata of the streams by one MultiGet, the status of a stream is NotFound
+  // if it doesn't exist
+  std::vector<rocksdb::Status> MultiGetMetadata(engine::Context &ctx, const std::vector<std::string> &stream_names,
+                                                std::vector<StreamMetadata> *metadatas);
+  // MultiRange reads the entries of the streams like Range, and their metadata by one MultiGet, so a stream
+  // without any entry in the range is skipped without seeking its entries
+  rocksdb::Status MultiRange(engine::Context &ctx, const std::vector<std::string> &stream_names,
+                             const std::vector<StreamRangeOptions> &options,
+                             std::vector<std::vector<StreamEntry>> *entries);
   rocksdb::Status SetId(engine::Context &ctx, const Slice &stream_name, const StreamEntryID &last_generated_id,
                         std::optional<uint64_t> entries_added, std::optional<StreamEntryID> max_deleted_id);
 
  private:
+  using AddEntryRef = std::pair<NextStreamEntryIDGenerationStrategy *, const std::vector<std::string> *>;
+
   rocksdb::ColumnFamilyHandle *stream_cf_handle_;
 
+  rocksdb::Status addEntries(engine::Context &ctx, const Slice &stream_name, const StreamAddOptions &options,
+                             const std::vector<AddEntryRef> &entries, std::vector<StreamEntryID> *ids);
+
   rocksdb::Status range(engine::Context &ctx, const std::string &ns_key, const StreamMetadata &metadata,
                         const StreamRangeOptions &options, std::vector<StreamEntry> *entries) const;
   rocksdb::Status getEntryRawValue(engine::Context &ctx, const std::string &ns_key, const StreamMetadata &metadata,
@@ -109,6 +127,16 @@ class Stream : public SubKeyScanner {
   std::string internalPelKeyFromGroupAndEntryId(const std::string &ns_key, const StreamMetadata &metadata,
                                                 const std::string &group_name, const StreamEntryID &id);
   StreamEntryID groupAndEntryIdFromPelInternalKey(rocksdb::Slice key, std::string &group_name);
+  std::string internalPelTimeIndexKey(const std::string &ns_key, const StreamMetadata &metadata,
+                                      const std::string &group_name, uint64_t delivery_time_ms,
+                                      const StreamEntryID &id) const;
+  StreamEntryID entryIdFromPelTimeIndexKey(rocksdb::Slice key, uint64_t *delivery_time_ms) const;
+  rocksdb::Status updatePelTimeIndex(rocksdb::WriteBatchBase *batch, const std::string &ns_key,
+                                     const StreamMetadata &metadata, const std::string &group_name,
+                                     const StreamEntryID &id, std::optional<uint64_t> old_delivery_time_ms,
+                                     std::optional<uint64_t> new_delivery_time_ms);
+  rocksdb::Status getIdlePelEntries(engine::Context &ctx, const std::string &ns_key, const StreamMetadata &metadata,
+                                    const StreamPendingOptions &options, std::vector<StreamNACK> *results);
   static std::string encodeStreamPelEntryValue(const StreamPelEntry &pel_entry);
   static StreamPelEntry decodeStreamPelEntryValue(const std::string &value);
   StreamSubkeyType identifySubkeyType(const rocksdb::Slice &key) const;
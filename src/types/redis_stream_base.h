@@ -127,10 +127,16 @@ struct StreamEntry {
   StreamEntry(std::string k, std::vector<std::string> vv) : key(std::move(k)), values(std::move(vv)) {}
 };
 
+// The approximate trimming (`~`) only removes whole chunks of this many entries from the head
+constexpr uint64_t kStreamTrimChunkEntries = 100;
+
 struct StreamTrimOptions {
   uint64_t max_len;
   StreamEntryID min_id;
   StreamTrimStrategy strategy = StreamTrimStrategy::None;
+  bool approximate = false;
+  // the max number of entries removed by an approximate trimming, 0 means no limit
+  uint64_t limit = 100 * kStreamTrimChunkEntries;
 };
 
 struct StreamAddOptions {
@@ -139,6 +145,12 @@ struct StreamAddOptions {
   bool nomkstream = false;
 };
 
+// StreamAddEntry is one of the entries added by Stream::AddEntries, each one has its own strategy of the ID
+struct StreamAddEntry {
+  std::unique_ptr<NextStreamEntryIDGenerationStrategy> next_id_strategy;
+  std::vector<std::string> values;
+};
+
 struct StreamRangeOptions {
   StreamEntryID start;
   StreamEntryID end;
@@ -188,6 +200,9 @@ struct StreamConsumerGroupMetadata {
   StreamEntryID last_delivered_id;
   int64_t entries_read = -1;
   uint64_t lag = 0;
+  // whether the PEL entries of the group are also kept in the index by delivery time,
+  // which is maintained for the groups created since it was introduced
+  bool pel_time_indexed = false;
 };
 
 struct StreamConsumerMetadata {
@@ -201,6 +216,7 @@ enum class StreamSubkeyType {
   StreamConsumerGroupMetadata = 1,
   StreamConsumerMetadata = 2,
   StreamPelEntry = 3,
+  StreamPelTimeIndex = 4,
 };
 
 struct StreamPelEntry {
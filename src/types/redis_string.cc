@@ -20,12 +20,14 @@
 
 #include "redis_string.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <optional>
 #include <string>
 
+#include "db_util.h"
 #include "parse_util.h"
 #include "storage/redis_metadata.h"
 #include "time_util.h"
@@ -34,20 +36,13 @@ namespace redis {
 
 std::vector<rocksdb::Status> String::getRawValues(engine::Context &ctx, const std::vector<Slice> &keys,
                                                   std::vector<std::string> *raw_values) {
-  raw_values->clear();
-
-  rocksdb::ReadOptions read_options = ctx.DefaultMultiGetOptions();
-  raw_values->resize(keys.size());
-  std::vector<rocksdb::Status> statuses(keys.size());
-  std::vector<rocksdb::PinnableSlice> pin_values(keys.size());
-  storage_->MultiGet(ctx, read_options, metadata_cf_handle_, keys.size(), keys.data(), pin_values.data(),
-                     statuses.data());
+  auto statuses = MultiGetRawMetadata(ctx, keys, raw_values);
   for (size_t i = 0; i < keys.size(); i++) {
     if (!statuses[i].ok()) continue;
-    (*raw_values)[i].assign(pin_values[i].data(), pin_values[i].size());
     Metadata metadata(kRedisNone, false);
     Slice slice = (*raw_values)[i];
     auto s = ParseMetadata({kRedisString}, &slice, &metadata);
+    if (s.ok() && metadata.IsSplit()) s = joinChunks(ctx, keys[i].ToString(), metadata, &(*raw_values)[i]);
     if (!s.ok()) {
       statuses[i] = s;
       (*raw_values)[i].clear();
@@ -65,7 +60,115 @@ rocksdb::Status String::getRawValue(engine::Context &ctx, const std::string &ns_
 
   Metadata metadata(kRedisNone, false);
   Slice slice = *raw_value;
-  return ParseMetadata({kRedisString}, &slice, &metadata);
+  s = ParseMetadata({kRedisString}, &slice, &metadata);
+  if (!s.ok()) return s;
+  if (metadata.IsSplit()) return joinChunks(ctx, ns_key, metadata, raw_value);
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status String::joinChunks(engine::Context &ctx, const std::string &ns_key, const Metadata &metadata,
+                                   std::string *raw_value) {
+  std::string value;
+  auto s = readChunks(ctx, ns_key, metadata, 0, metadata.size, &value);
+  if (!s.ok()) return s;
+
+  raw_value->resize(Metadata::GetOffsetAfterExpire((*raw_value)[0]));
+  (*raw_value)[0] = static_cast<char>((*raw_value)[0] & ~METADATA_SPLIT_MASK);
+  raw_value->append(value);
+  return rocksdb::Status::OK();
+}
+
+std::string String::chunkKey(const std::string &ns_key, const Metadata &metadata, uint32_t index) const {
+  std::string sub_key;
+  PutFixed32(&sub_key, index);
+  return InternalKey(ns_key, sub_key, metadata.version, storage_->IsSlotIdEncoded()).Encode();
+}
+
+rocksdb::Status String::readChunks(engine::Context &ctx, const std::string &ns_key, const Metadata &metadata,
+                                   uint64_t offset, uint64_t count, std::string *value) {
+  // the value is allocated at once and the chunks are copied into it, the missing ones are left as zeros
+  value->assign(count, '\0');
+  if (count == 0) return rocksdb::Status::OK();
+
+  auto first_index = static_cast<uint32_t>(offset / kChunkSize);
+  auto last_index = static_cast<uint32_t>((offset + count - 1) / kChunkSize);
+  std::string start_key = chunkKey(ns_key, metadata, first_index);
+  std::string prefix = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
+  std::string next_version_prefix = InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
+
+  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  rocksdb::Slice upper_bound(next_version_prefix);
+  read_options.iterate_upper_bound = &upper_bound;
+  auto iter = util::UniqueIterator(ctx, read_options);
+  for (iter->Seek(start_key); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
+    InternalKey ikey(iter->key(), storage_->IsSlotIdEncoded());
+    Slice sub_key = ikey.GetSubKey();
+    uint32_t index = 0;
+    if (!GetFixed32(&sub_key, &index)) return rocksdb::Status::Corruption("invalid chunk key");
+    if (index > last_index) break;
+
+    // copy the overlap of the chunk and the range
+    uint64_t chunk_begin = static_cast<uint64_t>(index) * kChunkSize;
+    uint64_t begin = std::max(offset, chunk_begin);
+    uint64_t end = std::min({offset + count, chunk_begin + iter->value().size(), metadata.size});
+    if (begin < end) {
+      std::copy_n(iter->value().data() + (begin - chunk_begin), end - begin, value->data() + (begin - offset));
+    }
+  }
+  return iter->status();
+}
+
+rocksdb::Status String::writeChunks(engine::Context &ctx, const std::string &ns_key, const Metadata &metadata,
+                                    uint64_t offset, Slice value, rocksdb::WriteBatchBase *batch) {
+  if (value.empty()) return rocksdb::Status::OK();
+
+  auto first_index = static_cast<uint32_t>(offset / kChunkSize);
+  auto last_index = static_cast<uint32_t>((offset + value.size() - 1) / kChunkSize);
+  std::string chunk;
+  for (uint32_t index = first_index; index <= last_index; index++) {
+    uint64_t chunk_begin = static_cast<uint64_t>(index) * kChunkSize;
+    uint64_t chunk_size = std::min<uint64_t>(kChunkSize, metadata.size - chunk_begin);
+    uint64_t begin = std::max(offset, chunk_begin);
+    uint64_t end = std::min(offset + value.size(), chunk_begin + chunk_size);
+    std::string sub_key = chunkKey(ns_key, metadata, index);
+
+    // the chunks partially written are merged with their old bytes
+    if (begin == chunk_begin && end == chunk_begin + chunk_size) {
+      auto s = batch->Put(sub_key, Slice(value.data() + (begin - offset), end - begin));
+      if (!s.ok()) return s;
+      continue;
+    }
+    auto s = storage_->Get(ctx, ctx.GetReadOptions(), sub_key, &chunk);
+    if (!s.ok() && !s.IsNotFound()) return s;
+    if (s.IsNotFound()) chunk.clear();
+    if (chunk.size() < end - chunk_begin) chunk.resize(end - chunk_begin, '\0');
+    std::copy_n(value.data() + (begin - offset), end - begin, chunk.data() + (begin - chunk_begin));
+    s = batch->Put(sub_key, chunk);
+    if (!s.ok()) return s;
+  }
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status String::writeRange(engine::Context &ctx, const std::string &ns_key, Metadata metadata,
+                                   uint64_t offset, const std::string &value, uint64_t *new_size) {
+  *new_size = metadata.size;
+  if (value.empty()) return rocksdb::Status::OK();
+
+  if (offset + value.size() > metadata.size) metadata.size = offset + value.size();
+  *new_size = metadata.size;
+
+  auto batch = storage_->GetWriteBatchBase();
+  // only the chunks are written, which are replayed by SETRANGE
+  WriteBatchLogData log_data(kRedisString, {std::to_string(kRedisCmdSetRange)});
+  auto s = batch->PutLogData(log_data.Encode());
+  if (!s.ok()) return s;
+  std::string bytes;
+  metadata.Encode(&bytes);
+  s = batch->Put(metadata_cf_handle_, ns_key, bytes);
+  if (!s.ok()) return s;
+  s = writeChunks(ctx, ns_key, metadata, offset, value, batch.Get());
+  if (!s.ok()) return s;
+  return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
 }
 
 rocksdb::Status String::getValueAndExpire(engine::Context &ctx, const std::string &ns_key, std::string *value,
@@ -108,11 +211,39 @@ rocksdb::Status String::updateRawValue(engine::Context &ctx, const std::string &
   WriteBatchLogData log_data(kRedisString);
   auto s = batch->PutLogData(log_data.Encode());
   if (!s.ok()) return s;
-  s = batch->Put(metadata_cf_handle_, ns_key, raw_value);
+
+  Metadata metadata(kRedisString, false);
+  s = metadata.Decode(raw_value);
+  if (!s.ok()) return s;
+  size_t offset = Metadata::GetOffsetAfterExpire(raw_value[0]);
+  s = putValue(ctx, ns_key, metadata.expire, Slice(raw_value.data() + offset, raw_value.size() - offset), batch.Get());
   if (!s.ok()) return s;
   return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
 }
 
+rocksdb::Status String::putValue(engine::Context &ctx, const std::string &ns_key, uint64_t expire, Slice value,
+                                 rocksdb::WriteBatchBase *batch) {
+  uint64_t threshold = static_cast<uint64_t>(storage_->GetConfig()->string_chunk_threshold_kb) * KiB;
+  std::string bytes;
+  if (threshold == 0 || value.size() < threshold) {
+    Metadata metadata(kRedisString, false);
+    metadata.expire = expire;
+    metadata.Encode(&bytes);
+    bytes.append(value.data(), value.size());
+    return batch->Put(metadata_cf_handle_, ns_key, bytes);
+  }
+
+  // the chunks of the old value are dropped with its version
+  Metadata metadata(kRedisString);
+  metadata.flags |= METADATA_SPLIT_MASK;
+  metadata.expire = expire;
+  metadata.size = value.size();
+  metadata.Encode(&bytes);
+  auto s = batch->Put(metadata_cf_handle_, ns_key, bytes);
+  if (!s.ok()) return s;
+  return writeChunks(ctx, ns_key, metadata, 0, value, batch);
+}
+
 rocksdb::Status String::Append(engine::Context &ctx, const std::string &user_key, const std::string &value,
                                uint64_t *new_size) {
   *new_size = 0;
@@ -120,11 +251,16 @@ rocksdb::Status String::Append(engine::Context &ctx, const std::string &user_key
 
   LockGuard guard(storage_->GetLockManager(), ns_key);
   std::string raw_value;
-  rocksdb::Status s = getRawValue(ctx, ns_key, &raw_value);
+  Metadata metadata(kRedisString, false);
+  Slice rest;
+  rocksdb::Status s = GetMetadata(ctx, {kRedisString}, ns_key, &raw_value, &metadata, &rest);
   if (!s.ok() && !s.IsNotFound()) return s;
+  // only the last chunks of a chunked string are written
+  if (s.ok() && metadata.IsSplit()) return writeRange(ctx, ns_key, metadata, metadata.size, value, new_size);
   if (s.IsNotFound()) {
-    Metadata metadata(kRedisString, false);
-    metadata.Encode(&raw_value);
+    raw_value.clear();
+    Metadata new_metadata(kRedisString, false);
+    new_metadata.Encode(&raw_value);
   }
   raw_value.append(value);
   *new_size = raw_value.size() - Metadata::GetOffsetAfterExpire(raw_value[0]);
@@ -160,7 +296,6 @@ rocksdb::Status String::GetEx(engine::Context &ctx, const std::string &user_key,
   rocksdb::Status s = getValue(ctx, ns_key, value);
   if (!s.ok()) return s;
 
-  std::string raw_data;
   Metadata metadata(kRedisString, false);
   if (expire.has_value()) {
     metadata.expire = expire.value();
@@ -168,13 +303,11 @@ rocksdb::Status String::GetEx(engine::Context &ctx, const std::string &user_key,
     // If there is no ttl or persist is false, then skip the following updates.
     return rocksdb::Status::OK();
   }
-  metadata.Encode(&raw_data);
-  raw_data.append(value->data(), value->size());
   auto batch = storage_->GetWriteBatchBase();
   WriteBatchLogData log_data(kRedisString);
   s = batch->PutLogData(log_data.Encode());
   if (!s.ok()) return s;
-  s = batch->Put(metadata_cf_handle_, ns_key, raw_data);
+  s = putValue(ctx, ns_key, metadata.expire, *value, batch.Get());
   if (!s.ok()) return s;
   s = storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
   if (!s.ok()) return s;
@@ -197,6 +330,52 @@ rocksdb::Status String::GetDel(engine::Context &ctx, const std::string &user_key
   return storage_->Delete(ctx, storage_->DefaultWriteOptions(), metadata_cf_handle_, ns_key);
 }
 
+rocksdb::Status String::GetRange(engine::Context &ctx, const std::string &user_key, int start, int stop,
+                                 std::optional<std::string> *value) {
+  std::string ns_key = AppendNamespacePrefix(user_key);
+
+  std::string raw_value;
+  Metadata metadata(kRedisString, false);
+  Slice rest;
+  auto s = GetMetadata(ctx, {kRedisString}, ns_key, &raw_value, &metadata, &rest);
+  if (!s.ok()) return s;
+
+  auto size = static_cast<int>(metadata.IsSplit() ? metadata.size : rest.size());
+  if (start < 0) start = size + start;
+  if (stop < 0) stop = size + stop;
+  if (start < 0) start = 0;
+  if (stop > size) stop = size;
+  if (start > stop) {
+    *value = std::nullopt;
+    return rocksdb::Status::OK();
+  }
+
+  auto count = static_cast<size_t>(std::min(stop - start + 1, size - start));
+  if (!metadata.IsSplit()) {
+    *value = std::string(rest.data() + start, count);
+    return rocksdb::Status::OK();
+  }
+  // only the chunks in the range of a chunked string are read
+  std::string range;
+  s = readChunks(ctx, ns_key, metadata, start, count, &range);
+  if (!s.ok()) return s;
+  *value = std::move(range);
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status String::Strlen(engine::Context &ctx, const std::string &user_key, uint64_t *len) {
+  *len = 0;
+  std::string ns_key = AppendNamespacePrefix(user_key);
+
+  std::string raw_value;
+  Metadata metadata(kRedisString, false);
+  Slice rest;
+  auto s = GetMetadata(ctx, {kRedisString}, ns_key, &raw_value, &metadata, &rest);
+  if (!s.ok()) return s;
+  *len = metadata.IsSplit() ? metadata.size : rest.size();
+  return rocksdb::Status::OK();
+}
+
 rocksdb::Status String::Set(engine::Context &ctx, const std::string &user_key, const std::string &value) {
   std::vector<StringPair> pairs{StringPair{user_key, value}};
   return MSet(ctx, pairs, /*expire=*/0, /*lock=*/true);
@@ -255,12 +434,13 @@ rocksdb::Status String::Set(engine::Context &ctx, const std::string &user_key, c
   }
 
   // Create new value
-  std::string new_raw_value;
-  Metadata metadata(kRedisString, false);
-  metadata.expire = expire;
-  metadata.Encode(&new_raw_value);
-  new_raw_value.append(value);
-  return updateRawValue(ctx, ns_key, new_raw_value);
+  auto batch = storage_->GetWriteBatchBase();
+  WriteBatchLogData log_data(kRedisString);
+  auto s = batch->PutLogData(log_data.Encode());
+  if (!s.ok()) return s;
+  s = putValue(ctx, ns_key, expire, value, batch.Get());
+  if (!s.ok()) return s;
+  return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
 }
 
 rocksdb::Status String::SetEX(engine::Context &ctx, const std::string &user_key, const std::string &value,
@@ -291,10 +471,15 @@ rocksdb::Status String::SetRange(engine::Context &ctx, const std::string &user_k
 
   LockGuard guard(storage_->GetLockManager(), ns_key);
   std::string raw_value;
-  rocksdb::Status s = getRawValue(ctx, ns_key, &raw_value);
+  Metadata metadata(kRedisString, false);
+  Slice rest;
+  rocksdb::Status s = GetMetadata(ctx, {kRedisString}, ns_key, &raw_value, &metadata, &rest);
   if (!s.ok() && !s.IsNotFound()) return s;
+  // only the chunks in the range of a chunked string are written
+  if (s.ok() && metadata.IsSplit()) return writeRange(ctx, ns_key, metadata, offset, value, new_size);
 
   if (s.IsNotFound()) {
+    raw_value.clear();
     // Return 0 directly instead of storing an empty key when set nothing on a non-existing string.
     if (value.empty()) {
       *new_size = 0;
@@ -328,39 +513,51 @@ rocksdb::Status String::SetRange(engine::Context &ctx, const std::string &user_k
 rocksdb::Status String::IncrBy(engine::Context &ctx, const std::string &user_key, int64_t increment,
                                int64_t *new_value) {
   std::string ns_key = AppendNamespacePrefix(user_key);
+  // the writes of a transaction are only committed by EXEC, so they can't be combined with others
+  bool combine = storage_->GetConfig()->incr_combining && !storage_->InTxn();
 
-  LockGuard guard(storage_->GetLockManager(), ns_key);
-  std::string raw_value;
-  rocksdb::Status s = getRawValue(ctx, ns_key, &raw_value);
-  if (!s.ok() && !s.IsNotFound()) return s;
-  if (s.IsNotFound()) {
-    Metadata metadata(kRedisString, false);
-    metadata.Encode(&raw_value);
-  }
+  using Op = engine::IncrCombiner<int64_t>::Op;
+  auto apply = [&](const std::vector<Op *> &ops) -> rocksdb::Status {
+    std::string raw_value;
+    rocksdb::Status s = getRawValue(ctx, ns_key, &raw_value);
+    if (!s.ok() && !s.IsNotFound()) return s;
+    if (s.IsNotFound()) {
+      Metadata metadata(kRedisString, false);
+      metadata.Encode(&raw_value);
+    }
 
-  size_t offset = Metadata::GetOffsetAfterExpire(raw_value[0]);
-  std::string value = raw_value.substr(offset);
-  int64_t n = 0;
-  if (!value.empty()) {
-    auto parse_result = ParseInt<int64_t>(value, 10);
-    if (!parse_result) {
-      return rocksdb::Status::InvalidArgument("value is not an integer or out of range");
+    size_t offset = Metadata::GetOffsetAfterExpire(raw_value[0]);
+    std::string value = raw_value.substr(offset);
+    int64_t n = 0;
+    if (!value.empty()) {
+      auto parse_result = ParseInt<int64_t>(value, 10);
+      if (!parse_result) {
+        return rocksdb::Status::InvalidArgument("value is not an integer or out of range");
+      }
+      if (isspace(value[0])) {
+        return rocksdb::Status::InvalidArgument("value is not an integer");
+      }
+      n = *parse_result;
     }
-    if (isspace(value[0])) {
-      return rocksdb::Status::InvalidArgument("value is not an integer");
+
+    bool updated = false;
+    for (auto *op : ops) {
+      if ((op->increment < 0 && n <= 0 && op->increment < (LLONG_MIN - n)) ||
+          (op->increment > 0 && n >= 0 && op->increment > (LLONG_MAX - n))) {
+        op->status = rocksdb::Status::InvalidArgument("increment or decrement would overflow");
+        continue;
+      }
+      n += op->increment;
+      op->result = n;
+      updated = true;
     }
-    n = *parse_result;
-  }
-  if ((increment < 0 && n <= 0 && increment < (LLONG_MIN - n)) ||
-      (increment > 0 && n >= 0 && increment > (LLONG_MAX - n))) {
-    return rocksdb::Status::InvalidArgument("increment or decrement would overflow");
-  }
-  n += increment;
-  *new_value = n;
+    if (!updated) return rocksdb::Status::OK();
 
-  raw_value = raw_value.substr(0, offset);
-  raw_value.append(std::to_string(n));
-  return updateRawValue(ctx, ns_key, raw_value);
+    raw_value = raw_value.substr(0, offset);
+    raw_value.append(std::to_string(n));
+    return updateRawValue(ctx, ns_key, raw_value);
+  };
+  return storage_->GetIncrCombiner()->IncrBy(ns_key, "s" + ns_key, combine, increment, new_value, apply);
 }
 
 rocksdb::Status String::IncrByFloat(engine::Context &ctx, const std::string &user_key, double increment,
@@ -417,13 +614,8 @@ rocksdb::Status String::MSet(engine::Context &ctx, const std::vector<StringPair>
   auto s = batch->PutLogData(log_data.Encode());
   if (!s.ok()) return s;
   for (const auto &pair : pairs) {
-    std::string bytes;
-    Metadata metadata(kRedisString, false);
-    metadata.expire = expire_ms;
-    metadata.Encode(&bytes);
-    bytes.append(pair.value.data(), pair.value.size());
     std::string ns_key = AppendNamespacePrefix(pair.key);
-    s = batch->Put(metadata_cf_handle_, ns_key, bytes);
+    s = putValue(ctx, ns_key, expire_ms, pair.value, batch.Get());
     if (!s.ok()) return s;
   }
   return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
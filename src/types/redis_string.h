@@ -76,6 +76,10 @@ using StringLCSResult = std::variant<std::string, uint32_t, StringLCSIdxResult>;
 namespace redis {
 class String : public Database {
  public:
+  // The values reaching string-chunk-threshold-kb are split into the chunks of kChunkSize bytes,
+  // stored under the subkeys of their big-endian 32-bit indexes. The missing bytes are zeros.
+  static constexpr size_t kChunkSize = 64 * 1024;
+
   explicit String(engine::Storage *storage, const std::string &ns) : Database(storage, ns) {}
   rocksdb::Status Append(engine::Context &ctx, const std::string &user_key, const std::string &value,
                          uint64_t *new_size);
@@ -85,6 +89,10 @@ class String : public Database {
   rocksdb::Status GetSet(engine::Context &ctx, const std::string &user_key, const std::string &new_value,
                          std::optional<std::string> &old_value);
   rocksdb::Status GetDel(engine::Context &ctx, const std::string &user_key, std::string *value);
+  // GetRange returns the value between the start and the stop offsets like GETRANGE, or nullopt if the range is empty
+  rocksdb::Status GetRange(engine::Context &ctx, const std::string &user_key, int start, int stop,
+                           std::optional<std::string> *value);
+  rocksdb::Status Strlen(engine::Context &ctx, const std::string &user_key, uint64_t *len);
   rocksdb::Status Set(engine::Context &ctx, const std::string &user_key, const std::string &value);
   rocksdb::Status Set(engine::Context &ctx, const std::string &user_key, const std::string &value, StringSetArgs args,
                       std::optional<std::string> &ret);
@@ -119,6 +127,23 @@ class String : public Database {
   std::vector<rocksdb::Status> getRawValues(engine::Context &ctx, const std::vector<Slice> &keys,
                                             std::vector<std::string> *raw_values);
   rocksdb::Status updateRawValue(engine::Context &ctx, const std::string &ns_key, const std::string &raw_value);
+  // putValue writes a new value, which is chunked if it reaches string-chunk-threshold-kb
+  rocksdb::Status putValue(engine::Context &ctx, const std::string &ns_key, uint64_t expire, Slice value,
+                           rocksdb::WriteBatchBase *batch);
+
+  std::string chunkKey(const std::string &ns_key, const Metadata &metadata, uint32_t index) const;
+  // joinChunks turns the raw value of a chunked string into a plain one holding the whole value
+  rocksdb::Status joinChunks(engine::Context &ctx, const std::string &ns_key, const Metadata &metadata,
+                             std::string *raw_value);
+  // readChunks reads count bytes from the offset of a chunked value
+  rocksdb::Status readChunks(engine::Context &ctx, const std::string &ns_key, const Metadata &metadata, uint64_t offset,
+                             uint64_t count, std::string *value);
+  // writeChunks writes the value at the offset of a chunked value, whose size is already updated in the metadata
+  rocksdb::Status writeChunks(engine::Context &ctx, const std::string &ns_key, const Metadata &metadata,
+                              uint64_t offset, Slice value, rocksdb::WriteBatchBase *batch);
+  // writeRange writes the value at the offset of a chunked string, like APPEND and SETRANGE
+  rocksdb::Status writeRange(engine::Context &ctx, const std::string &ns_key, Metadata metadata, uint64_t offset,
+                             const std::string &value, uint64_t *new_size);
 };
 
 }  // namespace redis
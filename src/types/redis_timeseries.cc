@@ -0,0 +1,568 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "redis_timeseries.h"
+
+#include <algorithm>
+
+#include "db_util.h"
+
+namespace redis {
+
+namespace {
+
+/// Aggregate the samples in order bucket by bucket, so only the bucket being aggregated is kept in memory.
+class Aggregation {
+ public:
+  Aggregation(const TSRangeOptions &options, std::vector<TSSample> *samples)
+      : aggregator_(options.aggregator),
+        bucket_duration_(options.bucket_duration),
+        limit_(options.count),
+        samples_(samples) {}
+
+  /// Return false once the limit of the samples is reached.
+  bool Add(const TSSample &sample) {
+    if (aggregator_ == TSAggregator::kNone) {
+      samples_->push_back(sample);
+      return !reached();
+    }
+
+    uint64_t bucket = sample.ts - sample.ts % bucket_duration_;
+    if (count_ > 0 && bucket != bucket_) {
+      flush();
+      if (reached()) return false;
+    }
+    if (count_ == 0) {
+      bucket_ = bucket;
+      sum_ = 0;
+      min_ = max_ = first_ = sample.value;
+    }
+    sum_ += sample.value;
+    min_ = std::min(min_, sample.value);
+    max_ = std::max(max_, sample.value);
+    last_ = sample.value;
+    count_++;
+    return true;
+  }
+
+  void Finish() {
+    if (count_ > 0 && !reached()) flush();
+  }
+
+ private:
+  bool reached() const { return limit_ > 0 && samples_->size() >= limit_; }
+
+  void flush() {
+    double value = 0;
+    switch (aggregator_) {
+      case TSAggregator::kAvg:
+        value = sum_ / static_cast<double>(count_);
+        break;
+      case TSAggregator::kSum:
+        value = sum_;
+        break;
+      case TSAggregator::kMin:
+        value = min_;
+        break;
+      case TSAggregator::kMax:
+        value = max_;
+        break;
+      case TSAggregator::kRange:
+        value = max_ - min_;
+        break;
+      case TSAggregator::kCount:
+        value = static_cast<double>(count_);
+        break;
+      case TSAggregator::kFirst:
+        value = first_;
+        break;
+      case TSAggregator::kLast:
+      case TSAggregator::kNone:
+        value = last_;
+        break;
+    }
+    samples_->push_back({bucket_, value});
+    count_ = 0;
+  }
+
+  TSAggregator aggregator_;
+  uint64_t bucket_duration_;
+  uint64_t limit_;
+  std::vector<TSSample> *samples_;
+
+  uint64_t bucket_ = 0;
+  uint64_t count_ = 0;
+  double sum_ = 0;
+  double min_ = 0;
+  double max_ = 0;
+  double first_ = 0;
+  double last_ = 0;
+};
+
+}  // namespace
+
+bool TimeSeries::IsChunkOutOfRetention(const Slice &chunk, uint64_t retain_from) {
+  uint64_t last_ts = 0;
+  return TSChunk::PeekLastTimestamp(chunk, &last_ts) && last_ts < retain_from;
+}
+
+rocksdb::Status TimeSeries::getTimeSeriesMetadata(engine::Context &ctx, const Slice &ns_key,
+                                                  TimeSeriesMetadata *metadata) {
+  return Database::GetMetadata(ctx, {kRedisTimeSeries}, ns_key, metadata);
+}
+
+std::string TimeSeries::getChunkKey(const Slice &ns_key, const TimeSeriesMetadata &metadata, uint64_t chunk_start) {
+  std::string sub_key;
+  PutFixed64(&sub_key, chunk_start);
+  return InternalKey(ns_key, sub_key, metadata.version, storage_->IsSlotIdEncoded()).Encode();
+}
+
+rocksdb::Status TimeSeries::loadChunk(engine::Context &ctx, const Slice &ns_key, const TimeSeriesMetadata &metadata,
+                                      uint64_t chunk_start, ChunkMap *chunks) {
+  if (chunks->count(chunk_start) > 0) return rocksdb::Status::OK();
+
+  rocksdb::PinnableSlice value;
+  auto s = storage_->Get(ctx, ctx.GetReadOptions(), getChunkKey(ns_key, metadata, chunk_start), &value);
+  if (!s.ok()) return s;
+
+  TSChunk chunk;
+  if (!chunk.Load(value)) return rocksdb::Status::Corruption("invalid time series chunk");
+  chunks->emplace(chunk_start, std::move(chunk));
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status TimeSeries::findChunk(engine::Context &ctx, const Slice &ns_key, const TimeSeriesMetadata &metadata,
+                                      uint64_t ts, ChunkMap *chunks, ChunkMap::iterator *chunk) {
+  std::optional<uint64_t> chunk_start;
+  if (auto iter = chunks->upper_bound(ts); iter != chunks->begin()) {
+    chunk_start = std::prev(iter)->first;
+  }
+
+  // a chunk which isn't loaded yet may be closer to the timestamp
+  std::string prefix_key = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
+  std::string next_version_prefix_key =
+      InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
+  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  rocksdb::Slice upper_bound(next_version_prefix_key);
+  read_options.iterate_upper_bound = &upper_bound;
+  rocksdb::Slice lower_bound(prefix_key);
+  read_options.iterate_lower_bound = &lower_bound;
+
+  auto iter = util::UniqueIterator(ctx, read_options);
+  iter->SeekForPrev(getChunkKey(ns_key, metadata, ts));
+  if (iter->Valid() && iter->key().starts_with(prefix_key)) {
+    InternalKey ikey(iter->key(), storage_->IsSlotIdEncoded());
+    Slice sub_key = ikey.GetSubKey();
+    uint64_t stored_start = 0;
+    GetFixed64(&sub_key, &stored_start);
+    if (!chunk_start || stored_start > *chunk_start) {
+      TSChunk stored_chunk;
+      if (!stored_chunk.Load(iter->value())) return rocksdb::Status::Corruption("invalid time series chunk");
+      chunks->emplace(stored_start, std::move(stored_chunk));
+      chunk_start = stored_start;
+    }
+  }
+  if (auto s = iter->status(); !s.ok()) return s;
+
+  *chunk = chunk_start ? chunks->find(*chunk_start) : chunks->end();
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status TimeSeries::upsertChunk(TimeSeriesMetadata *metadata, TSDuplicatePolicy policy,
+                                        const TSSample &sample, ChunkMap *chunks, ChunkMap::iterator chunk,
+                                        bool *added) {
+  std::vector<TSSample> merged;
+  merged.reserve(chunk->second.Count() + 1);
+
+  std::string bytes = chunk->second.Encode();
+  TSChunkIterator chunk_iter(bytes);
+  TSSample current{0, 0};
+  bool inserted = false;
+  *added = true;
+  while (chunk_iter.Next(&current)) {
+    if (!inserted && current.ts == sample.ts) {
+      switch (policy) {
+        case TSDuplicatePolicy::kBlock:
+          return rocksdb::Status::InvalidArgument(
+              "TSDB: Error at upsert, update is not supported when DUPLICATE_POLICY is set to BLOCK mode");
+        case TSDuplicatePolicy::kFirst:
+          break;
+        case TSDuplicatePolicy::kLast:
+          current.value = sample.value;
+          break;
+        case TSDuplicatePolicy::kMin:
+          current.value = std::min(current.value, sample.value);
+          break;
+        case TSDuplicatePolicy::kMax:
+          current.value = std::max(current.value, sample.value);
+          break;
+        case TSDuplicatePolicy::kSum:
+          current.value += sample.value;
+          break;
+      }
+      *added = false;
+      inserted = true;
+    } else if (!inserted && current.ts > sample.ts) {
+      merged.push_back(sample);
+      inserted = true;
+    }
+    merged.push_back(current);
+  }
+  if (!inserted) merged.push_back(sample);
+
+  auto encode = [&merged](size_t begin, size_t end) {
+    TSChunk encoded;
+    for (size_t i = begin; i < end; ++i) encoded.Append(merged[i].ts, merged[i].value);
+    return encoded;
+  };
+  TSChunk encoded = encode(0, merged.size());
+  if (encoded.DataSize() <= metadata->chunk_size || merged.size() < 2) {
+    chunk->second = std::move(encoded);
+    return rocksdb::Status::OK();
+  }
+
+  // the first half keeps the key of the chunk, and the second half is keyed before the next chunk
+  size_t split = merged.size() / 2;
+  chunk->second = encode(0, split);
+  (*chunks)[merged[split].ts] = encode(split, merged.size());
+  if (chunk->first == metadata->head_chunk) metadata->head_chunk = merged[split].ts;
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status TimeSeries::Create(engine::Context &ctx, const Slice &user_key, const TSCreateOptions &options) {
+  std::string ns_key = AppendNamespacePrefix(user_key);
+
+  LockGuard guard(storage_->GetLockManager(), ns_key);
+  TimeSeriesMetadata metadata;
+  rocksdb::Status s = getTimeSeriesMetadata(ctx, ns_key, &metadata);
+  if (!s.ok() && !s.IsNotFound()) return s;
+  if (!s.IsNotFound()) {
+    return rocksdb::Status::InvalidArgument("TSDB: key already exists");
+  }
+
+  metadata.retention = options.retention;
+  metadata.chunk_size = options.chunk_size;
+  metadata.duplicate_policy = options.duplicate_policy;
+  metadata.labels = options.labels;
+
+  auto batch = storage_->GetWriteBatchBase();
+  WriteBatchLogData log_data(kRedisTimeSeries);
+  s = batch->PutLogData(log_data.Encode());
+  if (!s.ok()) return s;
+
+  std::string bytes;
+  metadata.Encode(&bytes);
+  s = batch->Put(metadata_cf_handle_, ns_key, bytes);
+  if (!s.ok()) return s;
+  return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+}
+
+rocksdb::Status TimeSeries::Add(engine::Context &ctx, const Slice &user_key, const std::vector<TSSample> &samples,
+                                const TSCreateOptions *create_options, std::optional<TSDuplicatePolicy> on_duplicate,
+                                std::vector<rocksdb::Status> *results) {
+  std::string ns_key = AppendNamespacePrefix(user_key);
+
+  LockGuard guard(storage_->GetLockManager(), ns_key);
+  TimeSeriesMetadata metadata;
+  rocksdb::Status s = getTimeSeriesMetadata(ctx, ns_key, &metadata);
+  if (!s.ok() && !(s.IsNotFound() && create_options)) return s;
+  if (s.IsNotFound()) {
+    metadata.retention = create_options->retention;
+    metadata.chunk_size = create_options->chunk_size;
+    metadata.duplicate_policy = create_options->duplicate_policy;
+    metadata.labels = create_options->labels;
+  }
+  TSDuplicatePolicy policy = on_duplicate.value_or(metadata.duplicate_policy);
+  uint64_t retain_from = metadata.RetainFrom();
+
+  // all the samples are added to the chunks in memory, so they are written with one batch
+  ChunkMap chunks;
+  results->assign(samples.size(), rocksdb::Status::OK());
+  for (size_t i = 0; i < samples.size(); ++i) {
+    const TSSample &sample = samples[i];
+    if (sample.ts < metadata.RetainFrom()) {
+      (*results)[i] = rocksdb::Status::InvalidArgument("TSDB: Timestamp is older than retention");
+      continue;
+    }
+
+    bool added = true;
+    if (metadata.size == 0) {
+      chunks[sample.ts].Append(sample.ts, sample.value);
+      metadata.head_chunk = sample.ts;
+    } else if (sample.ts > metadata.last_timestamp) {
+      // the samples in order are appended to the newest chunk until it is full
+      s = loadChunk(ctx, ns_key, metadata, metadata.head_chunk, &chunks);
+      if (!s.ok() && !s.IsNotFound()) return s;
+      if (s.IsNotFound() || chunks[metadata.head_chunk].DataSize() >= metadata.chunk_size) {
+        metadata.head_chunk = sample.ts;
+      }
+      chunks[metadata.head_chunk].Append(sample.ts, sample.value);
+    } else {
+      ChunkMap::iterator chunk;
+      s = findChunk(ctx, ns_key, metadata, sample.ts, &chunks, &chunk);
+      if (!s.ok()) return s;
+      if (chunk == chunks.end()) {
+        // a sample before all the chunks starts a chunk of its own
+        chunks[sample.ts].Append(sample.ts, sample.value);
+      } else if (sample.ts > chunk->second.LastTimestamp()) {
+        // the sample is between the chunk and the next one, so it's appended to the chunk
+        if (chunk->second.DataSize() >= metadata.chunk_size) {
+          chunks[sample.ts].Append(sample.ts, sample.value);
+        } else {
+          chunk->second.Append(sample.ts, sample.value);
+        }
+      } else {
+        s = upsertChunk(&metadata, policy, sample, &chunks, chunk, &added);
+        if (!s.ok()) {
+          (*results)[i] = s;
+          continue;
+        }
+      }
+    }
+
+    if (added) metadata.size++;
+    metadata.last_timestamp = std::max(metadata.last_timestamp, sample.ts);
+  }
+
+  // The retention only moves forward with the newest sample, so the chunks it leaves behind are dropped here
+  // with their samples, and the size of the series keeps counting the retained samples only. The compaction
+  // filter then never meets a chunk out of the retention which isn't deleted yet.
+  std::vector<uint64_t> dropped;
+  if (metadata.RetainFrom() > retain_from) {
+    s = dropChunksOutOfRetention(ctx, ns_key, &metadata, &chunks, &dropped);
+    if (!s.ok()) return s;
+  }
+
+  auto batch = storage_->GetWriteBatchBase();
+  WriteBatchLogData log_data(kRedisTimeSeries);
+  s = batch->PutLogData(log_data.Encode());
+  if (!s.ok()) return s;
+
+  std::string bytes;
+  metadata.Encode(&bytes);
+  s = batch->Put(metadata_cf_handle_, ns_key, bytes);
+  if (!s.ok()) return s;
+  for (const auto &[chunk_start, chunk] : chunks) {
+    s = batch->Put(getChunkKey(ns_key, metadata, chunk_start), chunk.Encode());
+    if (!s.ok()) return s;
+  }
+  for (auto chunk_start : dropped) {
+    s = batch->Delete(getChunkKey(ns_key, metadata, chunk_start));
+    if (!s.ok()) return s;
+  }
+  return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+}
+
+rocksdb::Status TimeSeries::dropChunksOutOfRetention(engine::Context &ctx, const Slice &ns_key,
+                                                     TimeSeriesMetadata *metadata, ChunkMap *chunks,
+                                                     std::vector<uint64_t> *dropped) {
+  uint64_t retain_from = metadata->RetainFrom();
+  auto drop = [metadata](const TSChunk &chunk) {
+    metadata->size -= std::min<uint64_t>(metadata->size, chunk.Count());
+  };
+
+  // the chunks don't overlap, so the ones out of the retention are the oldest ones
+  std::string prefix_key = InternalKey(ns_key, "", metadata->version, storage_->IsSlotIdEncoded()).Encode();
+  std::string next_version_prefix_key =
+      InternalKey(ns_key, "", metadata->version + 1, storage_->IsSlotIdEncoded()).Encode();
+  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  rocksdb::Slice upper_bound(next_version_prefix_key);
+  read_options.iterate_upper_bound = &upper_bound;
+  rocksdb::Slice lower_bound(prefix_key);
+  read_options.iterate_lower_bound = &lower_bound;
+
+  auto iter = util::UniqueIterator(ctx, read_options);
+  for (iter->Seek(prefix_key); iter->Valid() && iter->key().starts_with(prefix_key); iter->Next()) {
+    InternalKey ikey(iter->key(), storage_->IsSlotIdEncoded());
+    Slice sub_key = ikey.GetSubKey();
+    uint64_t chunk_start = 0;
+    GetFixed64(&sub_key, &chunk_start);
+    if (chunk_start >= retain_from) break;
+
+    // the chunk may be changed by the samples just added
+    if (auto chunk = chunks->find(chunk_start); chunk != chunks->end()) {
+      if (chunk->second.LastTimestamp() >= retain_from) break;
+      drop(chunk->second);
+      chunks->erase(chunk);
+    } else {
+      TSChunk stored_chunk;
+      if (!stored_chunk.Load(iter->value())) return rocksdb::Status::Corruption("invalid time series chunk");
+      if (stored_chunk.LastTimestamp() >= retain_from) break;
+      drop(stored_chunk);
+    }
+    dropped->push_back(chunk_start);
+  }
+  if (auto s = iter->status(); !s.ok()) return s;
+
+  // the chunks started by the samples just added aren't stored yet
+  for (auto chunk = chunks->begin(); chunk != chunks->end() && chunk->second.LastTimestamp() < retain_from;) {
+    drop(chunk->second);
+    chunk = chunks->erase(chunk);
+  }
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status TimeSeries::Get(engine::Context &ctx, const Slice &user_key, std::optional<TSSample> *sample) {
+  std::string ns_key = AppendNamespacePrefix(user_key);
+
+  TimeSeriesMetadata metadata;
+  rocksdb::Status s = getTimeSeriesMetadata(ctx, ns_key, &metadata);
+  if (!s.ok()) return s;
+
+  *sample = std::nullopt;
+  if (metadata.size == 0) return rocksdb::Status::OK();
+
+  // the newest sample is the last one of the newest chunk, which is kept in the header of the chunk
+  ChunkMap chunks;
+  s = loadChunk(ctx, ns_key, metadata, metadata.head_chunk, &chunks);
+  if (s.IsNotFound()) return rocksdb::Status::OK();
+  if (!s.ok()) return s;
+
+  const TSChunk &head = chunks.begin()->second;
+  *sample = TSSample{head.LastTimestamp(), head.LastValue()};
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status TimeSeries::rangeSeries(engine::Context &ctx, const Slice &ns_key, const TimeSeriesMetadata &metadata,
+                                        const TSRangeOptions &options, std::vector<TSSample> *samples) {
+  uint64_t from = std::max(options.from, metadata.RetainFrom());
+  if (metadata.size == 0 || from > options.to) return rocksdb::Status::OK();
+
+  std::string prefix_key = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
+  std::string next_version_prefix_key =
+      InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
+  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  rocksdb::Slice upper_bound(next_version_prefix_key);
+  read_options.iterate_upper_bound = &upper_bound;
+  rocksdb::Slice lower_bound(prefix_key);
+  read_options.iterate_lower_bound = &lower_bound;
+
+  // the range starts from the chunk which the sample of the start belongs to
+  std::string start_key = getChunkKey(ns_key, metadata, from);
+  auto iter = util::UniqueIterator(ctx, read_options);
+  iter->SeekForPrev(start_key);
+  if (!iter->Valid()) iter->Seek(start_key);
+
+  Aggregation aggregation(options, samples);
+  bool done = false;
+  for (; !done && iter->Valid() && iter->key().starts_with(prefix_key); iter->Next()) {
+    InternalKey ikey(iter->key(), storage_->IsSlotIdEncoded());
+    Slice sub_key = ikey.GetSubKey();
+    uint64_t chunk_start = 0;
+    GetFixed64(&sub_key, &chunk_start);
+    if (chunk_start > options.to) break;
+
+    TSChunk chunk;
+    if (!chunk.Load(iter->value())) return rocksdb::Status::Corruption("invalid time series chunk");
+    if (chunk.LastTimestamp() < from) continue;
+
+    TSChunkIterator chunk_iter(iter->value());
+    TSSample sample{0, 0};
+    while (chunk_iter.Next(&sample)) {
+      if (sample.ts < from) continue;
+      if (sample.ts > options.to || !aggregation.Add(sample)) {
+        done = true;
+        break;
+      }
+    }
+  }
+  if (auto s = iter->status(); !s.ok()) return s;
+
+  aggregation.Finish();
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status TimeSeries::Range(engine::Context &ctx, const Slice &user_key, const TSRangeOptions &options,
+                                  std::vector<TSSample> *samples) {
+  std::string ns_key = AppendNamespacePrefix(user_key);
+
+  TimeSeriesMetadata metadata;
+  rocksdb::Status s = getTimeSeriesMetadata(ctx, ns_key, &metadata);
+  if (!s.ok()) return s;
+
+  return rangeSeries(ctx, ns_key, metadata, options, samples);
+}
+
+rocksdb::Status TimeSeries::MRange(engine::Context &ctx, const TSLabels &filters, const TSRangeOptions &options,
+                                   std::vector<TSMRangeEntry> *entries) {
+  // there is no index of the labels, so the series are found by scanning the metadata of the namespace
+  std::string ns_prefix = ComposeNamespaceKey(namespace_, "", false);
+  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  auto iter = util::UniqueIterator(ctx, read_options, metadata_cf_handle_);
+  for (iter->Seek(ns_prefix); iter->Valid() && iter->key().starts_with(ns_prefix); iter->Next()) {
+    Metadata base(kRedisNone, false);
+    if (!base.Decode(iter->value()).ok() || base.Type() != kRedisTimeSeries || base.Expired()) continue;
+
+    TimeSeriesMetadata metadata(false);
+    if (auto s = metadata.Decode(iter->value()); !s.ok()) return s;
+    bool matched = std::all_of(filters.begin(), filters.end(), [&metadata](const auto &filter) {
+      return std::find(metadata.labels.begin(), metadata.labels.end(), filter) != metadata.labels.end();
+    });
+    if (!matched) continue;
+
+    auto [_, user_key] = ExtractNamespaceKey(iter->key(), storage_->IsSlotIdEncoded());
+    TSMRangeEntry entry{user_key.ToString(), metadata.labels, {}};
+    auto s = rangeSeries(ctx, iter->key(), metadata, options, &entry.samples);
+    if (!s.ok()) return s;
+    entries->push_back(std::move(entry));
+  }
+  return iter->status();
+}
+
+rocksdb::Status TimeSeries::Info(engine::Context &ctx, const Slice &user_key, TSInfo *info) {
+  std::string ns_key = AppendNamespacePrefix(user_key);
+
+  TimeSeriesMetadata metadata;
+  rocksdb::Status s = getTimeSeriesMetadata(ctx, ns_key, &metadata);
+  if (!s.ok()) return s;
+
+  TSRangeOptions first_options;
+  first_options.count = 1;
+  std::vector<TSSample> first_samples;
+  s = rangeSeries(ctx, ns_key, metadata, first_options, &first_samples);
+  if (!s.ok()) return s;
+
+  // the chunks out of the retention are dropped with their samples by Add, but the samples out of the retention
+  // of the oldest chunk left are still counted by the size of the series, so they are counted off here
+  uint64_t hidden_samples = 0;
+  if (uint64_t retain_from = metadata.RetainFrom(); metadata.size > 0 && retain_from > 0) {
+    ChunkMap chunks;
+    ChunkMap::iterator chunk;
+    s = findChunk(ctx, ns_key, metadata, retain_from - 1, &chunks, &chunk);
+    if (!s.ok()) return s;
+    if (chunk != chunks.end()) {
+      std::string bytes = chunk->second.Encode();
+      TSChunkIterator chunk_iter(bytes);
+      TSSample sample{0, 0};
+      while (chunk_iter.Next(&sample) && sample.ts < retain_from) hidden_samples++;
+    }
+  }
+
+  info->total_samples = metadata.size - std::min(metadata.size, hidden_samples);
+  info->first_timestamp = first_samples.empty() ? 0 : first_samples[0].ts;
+  info->last_timestamp = metadata.last_timestamp;
+  info->retention = metadata.retention;
+  info->chunk_size = metadata.chunk_size;
+  info->duplicate_policy = metadata.duplicate_policy;
+  info->labels = std::move(metadata.labels);
+  return rocksdb::Status::OK();
+}
+
+}  // namespace redis
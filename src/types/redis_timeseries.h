@@ -0,0 +1,140 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <map>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "storage/redis_db.h"
+#include "storage/redis_metadata.h"
+#include "timeseries_chunk.h"
+
+namespace redis {
+
+constexpr uint32_t kTSDefaultChunkSize = 4096;
+constexpr uint32_t kTSMinChunkSize = 48;
+constexpr uint32_t kTSMaxChunkSize = 1048576;
+
+using TSLabels = std::vector<std::pair<std::string, std::string>>;
+
+struct TSCreateOptions {
+  uint64_t retention = 0;
+  uint32_t chunk_size = kTSDefaultChunkSize;
+  TSDuplicatePolicy duplicate_policy = TSDuplicatePolicy::kBlock;
+  TSLabels labels;
+};
+
+enum class TSAggregator : uint8_t {
+  kNone,
+  kAvg,
+  kSum,
+  kMin,
+  kMax,
+  kRange,
+  kCount,
+  kFirst,
+  kLast,
+};
+
+struct TSRangeOptions {
+  uint64_t from = 0;
+  uint64_t to = UINT64_MAX;
+  /// The max number of the samples, or of the buckets if aggregated, and 0 means no limit
+  uint64_t count = 0;
+  TSAggregator aggregator = TSAggregator::kNone;
+  /// The samples are aggregated in the buckets [n * bucket_duration, (n + 1) * bucket_duration)
+  uint64_t bucket_duration = 0;
+};
+
+struct TSInfo {
+  uint64_t total_samples;
+  uint64_t first_timestamp;
+  uint64_t last_timestamp;
+  uint64_t retention;
+  uint32_t chunk_size;
+  TSDuplicatePolicy duplicate_policy;
+  TSLabels labels;
+};
+
+struct TSMRangeEntry {
+  std::string key;
+  TSLabels labels;
+  std::vector<TSSample> samples;
+};
+
+/// The time series compatible with the TS.* commands of RedisTimeSeries.
+///
+/// The samples are stored in Gorilla-compressed chunks (see TSChunk), each in a subkey keyed by
+/// the timestamp of its first sample, so a range is read by decoding the chunks of the range in order.
+/// The samples out of the retention are hidden from the reads. The chunks whose samples are all out of the
+/// retention are deleted by Add with their samples subtracted from the size of the metadata, while the hidden
+/// samples of the oldest chunk left are still counted by the size and are counted off by Info.
+class TimeSeries : public Database {
+ public:
+  TimeSeries(engine::Storage *storage, const std::string &ns) : Database(storage, ns) {}
+  rocksdb::Status Create(engine::Context &ctx, const Slice &user_key, const TSCreateOptions &options);
+  /// Add the samples to the series, and set the status of each of them to results.
+  /// The series is created by create_options first if it doesn't exist and create_options isn't null,
+  /// and on_duplicate overrides the duplicate policy of the series if it's set.
+  rocksdb::Status Add(engine::Context &ctx, const Slice &user_key, const std::vector<TSSample> &samples,
+                      const TSCreateOptions *create_options, std::optional<TSDuplicatePolicy> on_duplicate,
+                      std::vector<rocksdb::Status> *results);
+  /// Get the newest sample, or nullopt if the series is empty.
+  rocksdb::Status Get(engine::Context &ctx, const Slice &user_key, std::optional<TSSample> *sample);
+  rocksdb::Status Range(engine::Context &ctx, const Slice &user_key, const TSRangeOptions &options,
+                        std::vector<TSSample> *samples);
+  /// Range all the series whose labels match all the label=value filters of the namespace.
+  rocksdb::Status MRange(engine::Context &ctx, const TSLabels &filters, const TSRangeOptions &options,
+                         std::vector<TSMRangeEntry> *entries);
+  rocksdb::Status Info(engine::Context &ctx, const Slice &user_key, TSInfo *info);
+
+  /// A chunk whose samples are all before retain_from (see TimeSeriesMetadata::RetainFrom) can be dropped.
+  static bool IsChunkOutOfRetention(const Slice &chunk, uint64_t retain_from);
+
+ private:
+  /// The chunks read or written by a command, keyed by the timestamp of their first sample
+  using ChunkMap = std::map<uint64_t, TSChunk>;
+
+  rocksdb::Status getTimeSeriesMetadata(engine::Context &ctx, const Slice &ns_key, TimeSeriesMetadata *metadata);
+  std::string getChunkKey(const Slice &ns_key, const TimeSeriesMetadata &metadata, uint64_t chunk_start);
+  rocksdb::Status loadChunk(engine::Context &ctx, const Slice &ns_key, const TimeSeriesMetadata &metadata,
+                            uint64_t chunk_start, ChunkMap *chunks);
+  /// Find the chunk which the sample of the timestamp belongs to, the one with the largest first timestamp
+  /// not after it, and load it to the chunks. Return chunks->end() if the timestamp is before all the chunks.
+  rocksdb::Status findChunk(engine::Context &ctx, const Slice &ns_key, const TimeSeriesMetadata &metadata,
+                            uint64_t ts, ChunkMap *chunks, ChunkMap::iterator *chunk);
+  /// Insert the sample into a chunk which has a sample at or after its timestamp, by decoding and encoding
+  /// the chunk again. The chunk is split in two if it grows beyond the chunk size.
+  static rocksdb::Status upsertChunk(TimeSeriesMetadata *metadata, TSDuplicatePolicy policy,
+                                     const TSSample &sample, ChunkMap *chunks, ChunkMap::iterator chunk,
+                                     bool *added);
+  rocksdb::Status rangeSeries(engine::Context &ctx, const Slice &ns_key, const TimeSeriesMetadata &metadata,
+                              const TSRangeOptions &options, std::vector<TSSample> *samples);
+  /// Drop the chunks whose samples are all out of the retention from the chunks and subtract their samples from
+  /// the size of the series, the starts of the stored ones to be deleted are appended to dropped.
+  rocksdb::Status dropChunksOutOfRetention(engine::Context &ctx, const Slice &ns_key, TimeSeriesMetadata *metadata,
+                                           ChunkMap *chunks, std::vector<uint64_t> *dropped);
+};
+
+}  // namespace redis
@@ -0,0 +1,348 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "redis_topk.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include "xxh3.h"
+
+namespace redis {
+
+namespace {
+
+// The subkey of the heap is a single byte, and the ones of the bucket segments are 5 bytes
+constexpr char kHeapSubKey = 'h';
+constexpr char kSegmentSubKeyPrefix = 's';
+
+constexpr size_t kBucketBytes = 2 * sizeof(uint32_t);
+
+}  // namespace
+
+TopK::Lookup TopK::getLookup(const Slice &item) {
+  // One hash gives both the fingerprint and the double hashing of the columns
+  XXH128_hash_t hash = XXH3_128bits(item.data(), item.size());
+  return {static_cast<uint32_t>(hash.high64), static_cast<uint32_t>(hash.low64),
+          static_cast<uint32_t>(hash.low64 >> 32)};
+}
+
+uint64_t TopK::getBucketIndex(const TopKMetadata &metadata, const Lookup &lookup, uint32_t row) {
+  uint64_t column = (lookup.h1 + static_cast<uint64_t>(row) * lookup.h2) % metadata.width;
+  return static_cast<uint64_t>(row) * metadata.width + column;
+}
+
+rocksdb::Status TopK::getTopKMetadata(engine::Context &ctx, const Slice &ns_key, TopKMetadata *metadata) {
+  return Database::GetMetadata(ctx, {kRedisTopK}, ns_key, metadata);
+}
+
+std::string TopK::getSegmentKey(const Slice &ns_key, const TopKMetadata &metadata, uint32_t segment_index) {
+  std::string sub_key(1, kSegmentSubKeyPrefix);
+  PutFixed32(&sub_key, segment_index);
+  return InternalKey(ns_key, sub_key, metadata.version, storage_->IsSlotIdEncoded()).Encode();
+}
+
+std::string TopK::getHeapKey(const Slice &ns_key, const TopKMetadata &metadata) {
+  return InternalKey(ns_key, std::string(1, kHeapSubKey), metadata.version, storage_->IsSlotIdEncoded()).Encode();
+}
+
+rocksdb::Status TopK::getHeap(engine::Context &ctx, const Slice &ns_key, const TopKMetadata &metadata,
+                              std::vector<HeapEntry> *heap) {
+  std::string value;
+  auto s = storage_->Get(ctx, ctx.GetReadOptions(), getHeapKey(ns_key, metadata), &value);
+  if (s.IsNotFound()) return rocksdb::Status::OK();
+  if (!s.ok()) return s;
+
+  Slice input(value);
+  while (!input.empty()) {
+    HeapEntry entry;
+    Slice item;
+    if (!GetFixed32(&input, &entry.count) || !GetFixed32(&input, &entry.fingerprint) ||
+        !GetSizedString(&input, &item)) {
+      return rocksdb::Status::Corruption("invalid top-k heap");
+    }
+    entry.item = item.ToString();
+    heap->push_back(std::move(entry));
+  }
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status TopK::getSegments(engine::Context &ctx, const Slice &ns_key, const TopKMetadata &metadata,
+                                  const std::vector<Lookup> &lookups, SegmentMap *segments) {
+  std::vector<uint32_t> segment_indexes;
+  segment_indexes.reserve(lookups.size() * metadata.depth);
+  for (const auto &lookup : lookups) {
+    for (uint32_t row = 0; row < metadata.depth; ++row) {
+      segment_indexes.push_back(static_cast<uint32_t>(getBucketIndex(metadata, lookup, row) / kTopKSegmentBuckets));
+    }
+  }
+  std::sort(segment_indexes.begin(), segment_indexes.end());
+  segment_indexes.erase(std::unique(segment_indexes.begin(), segment_indexes.end()), segment_indexes.end());
+
+  std::vector<std::string> segment_keys;
+  std::vector<rocksdb::Slice> segment_key_slices;
+  segment_keys.reserve(segment_indexes.size());
+  segment_key_slices.reserve(segment_indexes.size());
+  for (uint32_t segment_index : segment_indexes) {
+    segment_keys.push_back(getSegmentKey(ns_key, metadata, segment_index));
+    segment_key_slices.emplace_back(segment_keys.back());
+  }
+  std::vector<rocksdb::PinnableSlice> values(segment_keys.size());
+  std::vector<rocksdb::Status> statuses(segment_keys.size());
+  storage_->MultiGet(ctx, ctx.DefaultMultiGetOptions(), storage_->GetDB()->DefaultColumnFamily(),
+                     segment_key_slices.size(), segment_key_slices.data(), values.data(), statuses.data());
+
+  uint64_t num_buckets = static_cast<uint64_t>(metadata.width) * metadata.depth;
+  for (size_t i = 0; i < segment_indexes.size(); ++i) {
+    if (!statuses[i].ok() && !statuses[i].IsNotFound()) return statuses[i];
+
+    uint64_t segment_offset = static_cast<uint64_t>(segment_indexes[i]) * kTopKSegmentBuckets;
+    uint64_t segment_buckets = std::min<uint64_t>(kTopKSegmentBuckets, num_buckets - segment_offset);
+    std::string &segment = (*segments)[segment_indexes[i]];
+    segment = values[i].ToString();
+    segment.resize(segment_buckets * kBucketBytes, 0);
+  }
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status TopK::Reserve(engine::Context &ctx, const Slice &user_key, uint32_t k, uint32_t width,
+                              uint32_t depth, double decay) {
+  if (k == 0 || width == 0 || depth == 0 || static_cast<uint64_t>(width) * depth > kTopKMaxBuckets) {
+    return rocksdb::Status::InvalidArgument("invalid k, width or depth");
+  }
+  if (decay <= 0 || decay > 1) {
+    return rocksdb::Status::InvalidArgument("decay should be larger than 0 and not larger than 1");
+  }
+  std::string ns_key = AppendNamespacePrefix(user_key);
+
+  LockGuard guard(storage_->GetLockManager(), ns_key);
+  TopKMetadata metadata;
+  rocksdb::Status s = getTopKMetadata(ctx, ns_key, &metadata);
+  if (!s.ok() && !s.IsNotFound()) return s;
+  if (!s.IsNotFound()) {
+    return rocksdb::Status::InvalidArgument("the key already exists");
+  }
+
+  metadata.k = k;
+  metadata.width = width;
+  metadata.depth = depth;
+  metadata.decay = decay;
+
+  auto batch = storage_->GetWriteBatchBase();
+  WriteBatchLogData log_data(kRedisTopK);
+  s = batch->PutLogData(log_data.Encode());
+  if (!s.ok()) return s;
+
+  std::string bytes;
+  metadata.Encode(&bytes);
+  s = batch->Put(metadata_cf_handle_, ns_key, bytes);
+  if (!s.ok()) return s;
+  return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+}
+
+rocksdb::Status TopK::IncrBy(engine::Context &ctx, const Slice &user_key,
+                             const std::vector<std::pair<std::string, uint32_t>> &increments,
+                             std::vector<std::optional<std::string>> *expelled) {
+  std::string ns_key = AppendNamespacePrefix(user_key);
+
+  LockGuard guard(storage_->GetLockManager(), ns_key);
+  TopKMetadata metadata;
+  rocksdb::Status s = getTopKMetadata(ctx, ns_key, &metadata);
+  if (!s.ok()) return s;
+
+  std::vector<Lookup> lookups;
+  lookups.reserve(increments.size());
+  for (const auto &[item, _] : increments) lookups.push_back(getLookup(item));
+
+  std::vector<HeapEntry> heap;
+  s = getHeap(ctx, ns_key, metadata, &heap);
+  if (!s.ok()) return s;
+  SegmentMap segments;
+  s = getSegments(ctx, ns_key, metadata, lookups, &segments);
+  if (!s.ok()) return s;
+
+  static thread_local std::mt19937 gen(std::random_device{}());
+  std::uniform_real_distribution<double> chance(0, 1);
+  // the heap keeps the smallest count on its front
+  auto heap_compare = [](const HeapEntry &lhs, const HeapEntry &rhs) { return lhs.count > rhs.count; };
+
+  // all the increments are applied to the segments and the heap in memory, so they are written with one batch
+  expelled->assign(increments.size(), std::nullopt);
+  for (size_t i = 0; i < increments.size(); ++i) {
+    const Lookup &lookup = lookups[i];
+    uint32_t increment = increments[i].second;
+    uint32_t max_count = 0;
+    for (uint32_t row = 0; row < metadata.depth; ++row) {
+      uint64_t index = getBucketIndex(metadata, lookup, row);
+      char *bucket = segments.at(static_cast<uint32_t>(index / kTopKSegmentBuckets)).data() +
+                     (index % kTopKSegmentBuckets) * kBucketBytes;
+      uint32_t fingerprint = DecodeFixed32(bucket);
+      uint32_t count = DecodeFixed32(bucket + sizeof(uint32_t));
+
+      if (count == 0) {
+        fingerprint = lookup.fingerprint;
+        count = increment;
+      } else if (fingerprint == lookup.fingerprint) {
+        count = count > UINT32_MAX - increment ? UINT32_MAX : count + increment;
+      } else {
+        // the count of another item decays with the probability decay^count, and the bucket is
+        // taken over once it decays to 0
+        double probability = std::pow(metadata.decay, count);
+        for (uint32_t remaining = increment; remaining > 0; --remaining) {
+          if (chance(gen) >= probability) continue;
+          if (--count == 0) {
+            fingerprint = lookup.fingerprint;
+            count = remaining;
+            break;
+          }
+          probability /= metadata.decay;
+        }
+      }
+
+      EncodeFixed32(bucket, fingerprint);
+      EncodeFixed32(bucket + sizeof(uint32_t), count);
+      if (fingerprint == lookup.fingerprint) max_count = std::max(max_count, count);
+    }
+
+    uint32_t heap_min = heap.size() < metadata.k ? 0 : heap.front().count;
+    if (max_count == 0 || max_count < heap_min) continue;
+
+    const std::string &item = increments[i].first;
+    auto iter = std::find_if(heap.begin(), heap.end(), [&](const HeapEntry &entry) {
+      return entry.fingerprint == lookup.fingerprint && entry.item == item;
+    });
+    if (iter != heap.end()) {
+      iter->count = max_count;
+      std::make_heap(heap.begin(), heap.end(), heap_compare);
+    } else {
+      if (heap.size() == metadata.k) {
+        std::pop_heap(heap.begin(), heap.end(), heap_compare);
+        (*expelled)[i] = std::move(heap.back().item);
+        heap.pop_back();
+      }
+      heap.push_back({max_count, lookup.fingerprint, item});
+      std::push_heap(heap.begin(), heap.end(), heap_compare);
+    }
+  }
+
+  auto batch = storage_->GetWriteBatchBase();
+  WriteBatchLogData log_data(kRedisTopK);
+  s = batch->PutLogData(log_data.Encode());
+  if (!s.ok()) return s;
+
+  std::string heap_bytes;
+  for (const auto &entry : heap) {
+    PutFixed32(&heap_bytes, entry.count);
+    PutFixed32(&heap_bytes, entry.fingerprint);
+    PutSizedString(&heap_bytes, entry.item);
+  }
+  s = batch->Put(getHeapKey(ns_key, metadata), heap_bytes);
+  if (!s.ok()) return s;
+  for (const auto &[segment_index, segment] : segments) {
+    s = batch->Put(getSegmentKey(ns_key, metadata, segment_index), segment);
+    if (!s.ok()) return s;
+  }
+  return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+}
+
+rocksdb::Status TopK::Query(engine::Context &ctx, const Slice &user_key, const std::vector<std::string> &items,
+                            std::vector<bool> *exists) {
+  std::string ns_key = AppendNamespacePrefix(user_key);
+
+  TopKMetadata metadata;
+  rocksdb::Status s = getTopKMetadata(ctx, ns_key, &metadata);
+  if (!s.ok()) return s;
+
+  std::vector<HeapEntry> heap;
+  s = getHeap(ctx, ns_key, metadata, &heap);
+  if (!s.ok()) return s;
+
+  exists->resize(items.size());
+  for (size_t i = 0; i < items.size(); ++i) {
+    (*exists)[i] =
+        std::any_of(heap.begin(), heap.end(), [&](const HeapEntry &entry) { return entry.item == items[i]; });
+  }
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status TopK::Count(engine::Context &ctx, const Slice &user_key, const std::vector<std::string> &items,
+                            std::vector<uint32_t> *counts) {
+  std::string ns_key = AppendNamespacePrefix(user_key);
+
+  TopKMetadata metadata;
+  rocksdb::Status s = getTopKMetadata(ctx, ns_key, &metadata);
+  if (!s.ok()) return s;
+
+  std::vector<Lookup> lookups;
+  lookups.reserve(items.size());
+  for (const auto &item : items) lookups.push_back(getLookup(item));
+  SegmentMap segments;
+  s = getSegments(ctx, ns_key, metadata, lookups, &segments);
+  if (!s.ok()) return s;
+
+  counts->assign(items.size(), 0);
+  for (size_t i = 0; i < items.size(); ++i) {
+    for (uint32_t row = 0; row < metadata.depth; ++row) {
+      uint64_t index = getBucketIndex(metadata, lookups[i], row);
+      const char *bucket = segments.at(static_cast<uint32_t>(index / kTopKSegmentBuckets)).data() +
+                           (index % kTopKSegmentBuckets) * kBucketBytes;
+      if (DecodeFixed32(bucket) == lookups[i].fingerprint) {
+        (*counts)[i] = std::max((*counts)[i], DecodeFixed32(bucket + sizeof(uint32_t)));
+      }
+    }
+  }
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status TopK::List(engine::Context &ctx, const Slice &user_key, std::vector<TopKItem> *items) {
+  std::string ns_key = AppendNamespacePrefix(user_key);
+
+  TopKMetadata metadata;
+  rocksdb::Status s = getTopKMetadata(ctx, ns_key, &metadata);
+  if (!s.ok()) return s;
+
+  std::vector<HeapEntry> heap;
+  s = getHeap(ctx, ns_key, metadata, &heap);
+  if (!s.ok()) return s;
+
+  std::sort(heap.begin(), heap.end(), [](const HeapEntry &lhs, const HeapEntry &rhs) { return lhs.count > rhs.count; });
+  items->reserve(heap.size());
+  for (auto &entry : heap) {
+    items->push_back({std::move(entry.item), entry.count});
+  }
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status TopK::Info(engine::Context &ctx, const Slice &user_key, TopKInfo *info) {
+  std::string ns_key = AppendNamespacePrefix(user_key);
+
+  TopKMetadata metadata;
+  rocksdb::Status s = getTopKMetadata(ctx, ns_key, &metadata);
+  if (!s.ok()) return s;
+
+  info->k = metadata.k;
+  info->width = metadata.width;
+  info->depth = metadata.depth;
+  info->decay = metadata.decay;
+  return rocksdb::Status::OK();
+}
+
+}  // namespace redis
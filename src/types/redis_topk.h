@@ -0,0 +1,107 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <map>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "storage/redis_db.h"
+#include "storage/redis_metadata.h"
+
+namespace redis {
+
+const uint32_t kTopKDefaultWidth = 8;
+const uint32_t kTopKDefaultDepth = 7;
+const double kTopKDefaultDecay = 0.9;
+const uint32_t kTopKMaxIncrement = 100000;
+
+/// The HeavyKeeper buckets are stored in subkeys of kTopKSegmentBuckets buckets each, row after row,
+/// and the segments without any count are not stored.
+constexpr uint32_t kTopKSegmentBuckets = 1024;
+
+/// width * depth can't be larger than this, so the segment index fits in 32 bits.
+constexpr uint64_t kTopKMaxBuckets = UINT32_MAX;
+
+struct TopKItem {
+  std::string item;
+  uint32_t count;
+};
+
+struct TopKInfo {
+  uint32_t k;
+  uint32_t width;
+  uint32_t depth;
+  double decay;
+};
+
+/// The top-k compatible with the TOPK.* commands of RedisBloom. The counts are estimated by HeavyKeeper,
+/// and the k items with the largest counts are kept in a min-heap stored in a subkey of its own.
+class TopK : public Database {
+ public:
+  TopK(engine::Storage *storage, const std::string &ns) : Database(storage, ns) {}
+  rocksdb::Status Reserve(engine::Context &ctx, const Slice &user_key, uint32_t k, uint32_t width, uint32_t depth,
+                          double decay);
+  /// Add the increments and return the item expelled from the top-k by each of them.
+  rocksdb::Status IncrBy(engine::Context &ctx, const Slice &user_key,
+                         const std::vector<std::pair<std::string, uint32_t>> &increments,
+                         std::vector<std::optional<std::string>> *expelled);
+  rocksdb::Status Query(engine::Context &ctx, const Slice &user_key, const std::vector<std::string> &items,
+                        std::vector<bool> *exists);
+  rocksdb::Status Count(engine::Context &ctx, const Slice &user_key, const std::vector<std::string> &items,
+                        std::vector<uint32_t> *counts);
+  /// Get the top-k items, from the largest count to the smallest.
+  rocksdb::Status List(engine::Context &ctx, const Slice &user_key, std::vector<TopKItem> *items);
+  rocksdb::Status Info(engine::Context &ctx, const Slice &user_key, TopKInfo *info);
+
+ private:
+  struct HeapEntry {
+    uint32_t count;
+    uint32_t fingerprint;
+    std::string item;
+  };
+
+  struct Lookup {
+    uint32_t fingerprint;
+    uint32_t h1;
+    uint32_t h2;
+  };
+
+  /// The segments read by a command, keyed by the segment index
+  using SegmentMap = std::map<uint32_t, std::string>;
+
+  static Lookup getLookup(const Slice &item);
+  static uint64_t getBucketIndex(const TopKMetadata &metadata, const Lookup &lookup, uint32_t row);
+
+  rocksdb::Status getTopKMetadata(engine::Context &ctx, const Slice &ns_key, TopKMetadata *metadata);
+  std::string getSegmentKey(const Slice &ns_key, const TopKMetadata &metadata, uint32_t segment_index);
+  std::string getHeapKey(const Slice &ns_key, const TopKMetadata &metadata);
+
+  rocksdb::Status getHeap(engine::Context &ctx, const Slice &ns_key, const TopKMetadata &metadata,
+                          std::vector<HeapEntry> *heap);
+  /// Read the segments of the buckets of all the items with one MultiGet.
+  rocksdb::Status getSegments(engine::Context &ctx, const Slice &ns_key, const TopKMetadata &metadata,
+                              const std::vector<Lookup> &lookups, SegmentMap *segments);
+};
+
+}  // namespace redis
@@ -20,18 +20,31 @@
 
 #include "redis_zset.h"
 
+#include <algorithm>
 #include <cmath>
 #include <limits>
 #include <map>
 #include <memory>
 #include <optional>
-#include <set>
+#include <queue>
 
 #include "db_util.h"
+#include "redis_zset_rank.h"
 #include "sample_helper.h"
 
 namespace redis {
 
+namespace {
+
+// LowerScoreFloor keeps all the members at or above the score floor of the zset
+void LowerScoreFloor(ZSetMetadata *metadata, double score, bool *lowered) {
+  if (score >= metadata->score_floor) return;
+  metadata->score_floor = score;
+  *lowered = true;
+}
+
+}  // namespace
+
 rocksdb::Status ZSet::GetMetadata(engine::Context &ctx, const Slice &ns_key, ZSetMetadata *metadata) {
   return Database::GetMetadata(ctx, {kRedisZSet}, ns_key, metadata);
 }
@@ -46,74 +59,106 @@ rocksdb::Status ZSet::Add(engine::Context &ctx, const Slice &user_key, ZAddFlags
   ZSetMetadata metadata;
   rocksdb::Status s = GetMetadata(ctx, ns_key, &metadata);
   if (!s.ok() && !s.IsNotFound()) return s;
+  if (s.IsNotFound()) metadata.rank_indexed = storage_->GetConfig()->zset_rank_index;
+  ZSetRankIndex rank_index(storage_, ns_key, metadata);
 
   int added = 0;
   int changed = 0;
+  bool floor_lowered = false;
   auto batch = storage_->GetWriteBatchBase();
   WriteBatchLogData log_data(kRedisZSet);
   s = batch->PutLogData(log_data.Encode());
   if (!s.ok()) return s;
+  // The last score of a member wins, and the old scores of the members are read by one MultiGet
+  std::vector<MemberScore *> unique_mscores;
   std::unordered_set<std::string_view> added_member_keys;
   for (auto it = mscores->rbegin(); it != mscores->rend(); ++it) {
-    if (!added_member_keys.insert(it->member).second) {
-      continue;
-    }
-    std::string member_key = InternalKey(ns_key, it->member, metadata.version, storage_->IsSlotIdEncoded()).Encode();
-    if (metadata.size > 0) {
-      std::string old_score_bytes;
-      s = storage_->Get(ctx, ctx.GetReadOptions(), member_key, &old_score_bytes);
-      if (!s.ok() && !s.IsNotFound()) return s;
-      if (s.ok()) {
-        if (!s.IsNotFound() && flags.HasNX()) {
+    if (added_member_keys.insert(it->member).second) unique_mscores.emplace_back(&*it);
+  }
+  std::vector<std::string> old_score_values(unique_mscores.size());
+  std::vector<rocksdb::Status> old_statuses(unique_mscores.size(), rocksdb::Status::NotFound());
+  if (metadata.size > 0) {
+    std::vector<Slice> members;
+    members.reserve(unique_mscores.size());
+    for (const auto *ms : unique_mscores) members.emplace_back(ms->member);
+    old_statuses = MultiGetSubKeys(ctx, ns_key, metadata, members, &old_score_values);
+  }
+
+  auto encode_key = [&](const std::string &sub_key) {
+    return InternalKey(ns_key, sub_key, metadata.version, storage_->IsSlotIdEncoded()).Encode();
+  };
+  auto score_key = [&](double score, const std::string &member) {
+    std::string score_bytes;
+    PutDouble(&score_bytes, score);
+    score_bytes.append(member);
+    return encode_key(score_bytes);
+  };
+
+  // The writes are put into the batch in the order of their keys, so the inserts into the memtable are local
+  std::vector<std::pair<std::string, std::string>> member_puts;
+  std::vector<std::string> score_deletes;
+  std::vector<std::string> score_puts;
+  for (size_t i = 0; i < unique_mscores.size(); i++) {
+    auto *ms = unique_mscores[i];
+    if (!old_statuses[i].ok() && !old_statuses[i].IsNotFound()) return old_statuses[i];
+    if (old_statuses[i].ok()) {
+      if (flags.HasNX()) {
+        continue;
+      }
+      double old_score = DecodeDouble(old_score_values[i].data());
+      if (flags.HasIncr()) {
+        if ((flags.HasLT() && ms->score >= 0) || (flags.HasGT() && ms->score <= 0)) {
           continue;
         }
-        double old_score = DecodeDouble(old_score_bytes.data());
-        if (flags.HasIncr()) {
-          if ((flags.HasLT() && it->score >= 0) || (flags.HasGT() && it->score <= 0)) {
-            continue;
-          }
-          it->score += old_score;
-          if (std::isnan(it->score)) {
-            return rocksdb::Status::InvalidArgument("resulting score is not a number (NaN)");
-          }
+        ms->score += old_score;
+        if (std::isnan(ms->score)) {
+          return rocksdb::Status::InvalidArgument("resulting score is not a number (NaN)");
         }
-        if (it->score != old_score) {
-          if ((flags.HasLT() && it->score >= old_score) || (flags.HasGT() && it->score <= old_score)) {
-            continue;
-          }
-          old_score_bytes.append(it->member);
-          std::string old_score_key =
-              InternalKey(ns_key, old_score_bytes, metadata.version, storage_->IsSlotIdEncoded()).Encode();
-          s = batch->Delete(score_cf_handle_, old_score_key);
-          if (!s.ok()) return s;
-          std::string new_score_bytes;
-          PutDouble(&new_score_bytes, it->score);
-          s = batch->Put(member_key, new_score_bytes);
-          if (!s.ok()) return s;
-          new_score_bytes.append(it->member);
-          std::string new_score_key =
-              InternalKey(ns_key, new_score_bytes, metadata.version, storage_->IsSlotIdEncoded()).Encode();
-          s = batch->Put(score_cf_handle_, new_score_key, Slice());
-          if (!s.ok()) return s;
-          changed++;
+      }
+      if (ms->score != old_score) {
+        if ((flags.HasLT() && ms->score >= old_score) || (flags.HasGT() && ms->score <= old_score)) {
+          continue;
         }
-        continue;
+        score_deletes.emplace_back(score_key(old_score, ms->member));
+        std::string new_score_bytes;
+        PutDouble(&new_score_bytes, ms->score);
+        member_puts.emplace_back(encode_key(ms->member), std::move(new_score_bytes));
+        score_puts.emplace_back(score_key(ms->score, ms->member));
+        LowerScoreFloor(&metadata, ms->score, &floor_lowered);
+        rank_index.Add(old_score, -1);
+        rank_index.Add(ms->score, 1);
+        changed++;
       }
+      continue;
     }
     if (flags.HasXX()) {
       continue;
     }
     std::string score_bytes;
-    PutDouble(&score_bytes, it->score);
+    PutDouble(&score_bytes, ms->score);
+    member_puts.emplace_back(encode_key(ms->member), std::move(score_bytes));
+    score_puts.emplace_back(score_key(ms->score, ms->member));
+    LowerScoreFloor(&metadata, ms->score, &floor_lowered);
+    rank_index.Add(ms->score, 1);
+    added++;
+  }
+
+  std::sort(member_puts.begin(), member_puts.end());
+  std::sort(score_deletes.begin(), score_deletes.end());
+  std::sort(score_puts.begin(), score_puts.end());
+  for (const auto &[member_key, score_bytes] : member_puts) {
     s = batch->Put(member_key, score_bytes);
     if (!s.ok()) return s;
-    score_bytes.append(it->member);
-    std::string score_key = InternalKey(ns_key, score_bytes, metadata.version, storage_->IsSlotIdEncoded()).Encode();
-    s = batch->Put(score_cf_handle_, score_key, Slice());
+  }
+  for (const auto &key : score_deletes) {
+    s = batch->Delete(score_cf_handle_, key);
     if (!s.ok()) return s;
-    added++;
   }
-  if (added > 0) {
+  for (const auto &key : score_puts) {
+    s = batch->Put(score_cf_handle_, key, Slice());
+    if (!s.ok()) return s;
+  }
+  if (added > 0 || floor_lowered) {
     *added_cnt = added;
     metadata.size += added;
     std::string bytes;
@@ -124,9 +169,28 @@ rocksdb::Status ZSet::Add(engine::Context &ctx, const Slice &user_key, ZAddFlags
   if (flags.HasCH()) {
     *added_cnt += changed;
   }
+  s = rank_index.Flush(ctx, batch.Get());
+  if (!s.ok()) return s;
   return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
 }
 
+std::string ZSet::scoreFloorKey(const Slice &ns_key, const ZSetMetadata &metadata) const {
+  std::string score_bytes;
+  PutDouble(&score_bytes, metadata.score_floor);
+  return InternalKey(ns_key, score_bytes, metadata.version, storage_->IsSlotIdEncoded()).Encode();
+}
+
+rocksdb::Status ZSet::deleteHeadTombstones(const Slice &ns_key, ZSetMetadata *metadata,
+                                           rocksdb::WriteBatchBase *batch) {
+  std::string begin = InternalKey(ns_key, "", metadata->version, storage_->IsSlotIdEncoded()).Encode();
+  std::string end = scoreFloorKey(ns_key, *metadata);
+  auto s = batch->DeleteRange(score_cf_handle_, begin, end);
+  if (!s.ok()) return s;
+  storage_->AddCompactionHint(ColumnFamilyID::SecondarySubkey, std::move(begin), std::move(end));
+  metadata->head_tombstones = 0;
+  return rocksdb::Status::OK();
+}
+
 rocksdb::Status ZSet::Card(engine::Context &ctx, const Slice &user_key, uint64_t *size) {
   *size = 0;
 
@@ -167,22 +231,25 @@ rocksdb::Status ZSet::Pop(engine::Context &ctx, const Slice &user_key, int count
   if (count > static_cast<int>(metadata.size)) count = static_cast<int>(metadata.size);
 
   std::string score_bytes;
-  double score = min ? kMinScore : kMaxScore;
+  double score = min ? metadata.score_floor : kMaxScore;
   PutDouble(&score_bytes, score);
   std::string start_key = InternalKey(ns_key, score_bytes, metadata.version, storage_->IsSlotIdEncoded()).Encode();
   std::string prefix_key = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
   std::string next_version_prefix_key =
       InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
+  std::string floor_key = scoreFloorKey(ns_key, metadata);
 
   auto batch = storage_->GetWriteBatchBase();
   WriteBatchLogData log_data(kRedisZSet);
   s = batch->PutLogData(log_data.Encode());
   if (!s.ok()) return s;
+  ZSetRankIndex rank_index(storage_, ns_key, metadata);
 
   rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
   rocksdb::Slice upper_bound(next_version_prefix_key);
   read_options.iterate_upper_bound = &upper_bound;
-  rocksdb::Slice lower_bound(prefix_key);
+  // the scans never go below the score floor, where there're only the tombstones of the popped members
+  rocksdb::Slice lower_bound(floor_key);
   read_options.iterate_lower_bound = &lower_bound;
 
   auto iter = util::UniqueIterator(ctx, read_options, score_cf_handle_);
@@ -201,16 +268,27 @@ rocksdb::Status ZSet::Pop(engine::Context &ctx, const Slice &user_key, int count
     if (!s.ok()) return s;
     s = batch->Delete(score_cf_handle_, iter->key());
     if (!s.ok()) return s;
+    rank_index.Add(score, -1);
     if (mscores->size() >= static_cast<unsigned>(count)) break;
   }
 
   if (!mscores->empty()) {
     metadata.size -= mscores->size();
+    if (min) {
+      metadata.score_floor = mscores->back().score;
+      metadata.head_tombstones += mscores->size();
+      if (metadata.head_tombstones >= kHeadTombstonesRangeDeletion) {
+        s = deleteHeadTombstones(ns_key, &metadata, batch.Get());
+        if (!s.ok()) return s;
+      }
+    }
     std::string bytes;
     metadata.Encode(&bytes);
     s = batch->Put(metadata_cf_handle_, ns_key, bytes);
     if (!s.ok()) return s;
   }
+  s = rank_index.Flush(ctx, batch.Get());
+  if (!s.ok()) return s;
   return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
 }
 
@@ -237,34 +315,52 @@ rocksdb::Status ZSet::RangeByRank(engine::Context &ctx, const Slice &user_key, c
   if (start < 0) start += static_cast<int>(metadata.size);
   if (stop < 0) stop += static_cast<int>(metadata.size);
   if (start < 0) start = 0;
-  if (stop < 0 || start > stop) {
+  if (stop < 0 || start > stop || start >= static_cast<int>(metadata.size)) {
     return rocksdb::Status::OK();
   }
 
   std::string score_bytes;
-  double score = !(spec.reversed) ? kMinScore : kMaxScore;
+  double score = !(spec.reversed) ? metadata.score_floor : kMaxScore;
   PutDouble(&score_bytes, score);
   std::string start_key = InternalKey(ns_key, score_bytes, metadata.version, storage_->IsSlotIdEncoded()).Encode();
   std::string prefix_key = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
   std::string next_version_prefix_key =
       InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
+  std::string floor_key = scoreFloorKey(ns_key, metadata);
 
   int removed_subkey = 0;
-  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  // the rank index locates the start directly, otherwise the members before it are scanned too
+  uint64_t scanned = metadata.rank_indexed ? stop - start + 1 : stop + 1;
+  rocksdb::ReadOptions read_options = ctx.SubKeyScanOptions(std::min<uint64_t>(scanned, metadata.size));
   rocksdb::Slice upper_bound(next_version_prefix_key);
   read_options.iterate_upper_bound = &upper_bound;
-  rocksdb::Slice lower_bound(prefix_key);
+  rocksdb::Slice lower_bound(floor_key);
   read_options.iterate_lower_bound = &lower_bound;
 
   auto batch = storage_->GetWriteBatchBase();
+  ZSetRankIndex rank_index(storage_, ns_key, metadata);
   auto iter = util::UniqueIterator(ctx, read_options, score_cf_handle_);
-  iter->Seek(start_key);
-  // see comment in RangeByScore()
-  if (spec.reversed && (!iter->Valid() || !iter->key().starts_with(prefix_key))) {
-    iter->SeekForPrev(start_key);
+  int count = 0;
+  if (metadata.rank_indexed) {
+    uint64_t rank = spec.reversed ? metadata.size - 1 - start : start;
+    double rank_score = 0;
+    uint64_t ties_before = 0;
+    s = rank_index.FindByRank(ctx, rank, &rank_score, &ties_before);
+    if (!s.ok()) return s;
+
+    std::string rank_score_bytes;
+    PutDouble(&rank_score_bytes, rank_score);
+    iter->Seek(InternalKey(ns_key, rank_score_bytes, metadata.version, storage_->IsSlotIdEncoded()).Encode());
+    for (; ties_before > 0 && iter->Valid(); ties_before--) iter->Next();
+    count = start;
+  } else {
+    iter->Seek(start_key);
+    // see comment in RangeByScore()
+    if (spec.reversed && (!iter->Valid() || !iter->key().starts_with(prefix_key))) {
+      iter->SeekForPrev(start_key);
+    }
   }
 
-  int count = 0;
   for (; iter->Valid() && iter->key().starts_with(prefix_key); !(spec.reversed) ? iter->Next() : iter->Prev()) {
     InternalKey ikey(iter->key(), storage_->IsSlotIdEncoded());
     Slice score_key = ikey.GetSubKey();
@@ -276,6 +372,7 @@ rocksdb::Status ZSet::RangeByRank(engine::Context &ctx, const Slice &user_key, c
         if (!s.ok()) return s;
         s = batch->Delete(score_cf_handle_, iter->key());
         if (!s.ok()) return s;
+        rank_index.Add(score, -1);
         removed_subkey++;
       } else {
         if (mscores) mscores->emplace_back(MemberScore{score_key.ToString(), score});
@@ -291,6 +388,8 @@ rocksdb::Status ZSet::RangeByRank(engine::Context &ctx, const Slice &user_key, c
     metadata.Encode(&bytes);
     s = batch->Put(metadata_cf_handle_, ns_key, bytes);
     if (!s.ok()) return s;
+    s = rank_index.Flush(ctx, batch.Get());
+    if (!s.ok()) return s;
     return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
   }
   return rocksdb::Status::OK();
@@ -350,22 +449,25 @@ rocksdb::Status ZSet::RangeByScore(engine::Context &ctx, const Slice &user_key,
   }
 
   std::string start_score_bytes;
-  PutDouble(&start_score_bytes, spec.reversed ? (spec.maxex ? spec.max : max_next_score) : spec.min);
+  PutDouble(&start_score_bytes,
+            spec.reversed ? (spec.maxex ? spec.max : max_next_score) : std::max(spec.min, metadata.score_floor));
   std::string start_key =
       InternalKey(ns_key, start_score_bytes, metadata.version, storage_->IsSlotIdEncoded()).Encode();
   std::string prefix_key = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
   std::string next_version_prefix_key =
       InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
+  std::string floor_key = scoreFloorKey(ns_key, metadata);
 
   rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
   rocksdb::Slice upper_bound(next_version_prefix_key);
   read_options.iterate_upper_bound = &upper_bound;
-  rocksdb::Slice lower_bound(prefix_key);
+  rocksdb::Slice lower_bound(floor_key);
   read_options.iterate_lower_bound = &lower_bound;
 
   int pos = 0;
   auto iter = util::UniqueIterator(ctx, read_options, score_cf_handle_);
   auto batch = storage_->GetWriteBatchBase();
+  ZSetRankIndex rank_index(storage_, ns_key, metadata);
   WriteBatchLogData log_data(kRedisZSet);
   s = batch->PutLogData(log_data.Encode());
   if (!s.ok()) return s;
@@ -397,6 +499,7 @@ rocksdb::Status ZSet::RangeByScore(engine::Context &ctx, const Slice &user_key,
       if (!s.ok()) return s;
       s = batch->Delete(score_cf_handle_, iter->key());
       if (!s.ok()) return s;
+      rank_index.Add(score, -1);
     } else {
       if (mscores) mscores->emplace_back(MemberScore{score_key.ToString(), score});
     }
@@ -410,6 +513,8 @@ rocksdb::Status ZSet::RangeByScore(engine::Context &ctx, const Slice &user_key,
     metadata.Encode(&bytes);
     s = batch->Put(metadata_cf_handle_, ns_key, bytes);
     if (!s.ok()) return s;
+    s = rank_index.Flush(ctx, batch.Get());
+    if (!s.ok()) return s;
     return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
   }
   return rocksdb::Status::OK();
@@ -452,6 +557,7 @@ rocksdb::Status ZSet::RangeByLex(engine::Context &ctx, const Slice &user_key, co
   int pos = 0;
   auto iter = util::UniqueIterator(ctx, read_options);
   auto batch = storage_->GetWriteBatchBase();
+  ZSetRankIndex rank_index(storage_, ns_key, metadata);
   WriteBatchLogData log_data(kRedisZSet);
   s = batch->PutLogData(log_data.Encode());
   if (!s.ok()) return s;
@@ -489,6 +595,7 @@ rocksdb::Status ZSet::RangeByLex(engine::Context &ctx, const Slice &user_key, co
       if (!s.ok()) return s;
       s = batch->Delete(iter->key());
       if (!s.ok()) return s;
+      rank_index.Add(DecodeDouble(iter->value().data()), -1);
     } else {
       if (mscores) mscores->emplace_back(MemberScore{member.ToString(), DecodeDouble(iter->value().data())});
     }
@@ -502,6 +609,8 @@ rocksdb::Status ZSet::RangeByLex(engine::Context &ctx, const Slice &user_key, co
     metadata.Encode(&bytes);
     s = batch->Put(metadata_cf_handle_, ns_key, bytes);
     if (!s.ok()) return s;
+    s = rank_index.Flush(ctx, batch.Get());
+    if (!s.ok()) return s;
     return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
   }
   return rocksdb::Status::OK();
@@ -510,13 +619,11 @@ rocksdb::Status ZSet::RangeByLex(engine::Context &ctx, const Slice &user_key, co
 rocksdb::Status ZSet::Score(engine::Context &ctx, const Slice &user_key, const Slice &member, double *score) {
   std::string ns_key = AppendNamespacePrefix(user_key);
   ZSetMetadata metadata(false);
-  rocksdb::Status s = GetMetadata(ctx, ns_key, &metadata);
-  if (!s.ok()) return s;
-
   std::string score_bytes;
-  std::string member_key = InternalKey(ns_key, member, metadata.version, storage_->IsSlotIdEncoded()).Encode();
-  s = storage_->Get(ctx, ctx.GetReadOptions(), member_key, &score_bytes);
+  rocksdb::Status member_s;
+  rocksdb::Status s = GetMetadataAndSubKey(ctx, {kRedisZSet}, ns_key, member, &metadata, &score_bytes, &member_s);
   if (!s.ok()) return s;
+  if (!member_s.ok()) return member_s;
   *score = DecodeDouble(score_bytes.data());
   return rocksdb::Status::OK();
 }
@@ -535,6 +642,7 @@ rocksdb::Status ZSet::Remove(engine::Context &ctx, const Slice &user_key, const
   WriteBatchLogData log_data(kRedisZSet);
   s = batch->PutLogData(log_data.Encode());
   if (!s.ok()) return s;
+  ZSetRankIndex rank_index(storage_, ns_key, metadata);
   int removed = 0;
   std::unordered_set<std::string_view> mset;
   for (const auto &member : members) {
@@ -545,6 +653,7 @@ rocksdb::Status ZSet::Remove(engine::Context &ctx, const Slice &user_key, const
     std::string score_bytes;
     s = storage_->Get(ctx, ctx.GetReadOptions(), member_key, &score_bytes);
     if (s.ok()) {
+      rank_index.Add(DecodeDouble(score_bytes.data()), -1);
       score_bytes.append(member.data(), member.size());
       std::string score_key = InternalKey(ns_key, score_bytes, metadata.version, storage_->IsSlotIdEncoded()).Encode();
       s = batch->Delete(member_key);
@@ -562,6 +671,8 @@ rocksdb::Status ZSet::Remove(engine::Context &ctx, const Slice &user_key, const
     s = batch->Put(metadata_cf_handle_, ns_key, bytes);
     if (!s.ok()) return s;
   }
+  s = rank_index.Flush(ctx, batch.Get());
+  if (!s.ok()) return s;
   return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
 }
 
@@ -583,6 +694,14 @@ rocksdb::Status ZSet::Rank(engine::Context &ctx, const Slice &user_key, const Sl
   if (!s.ok()) return s.IsNotFound() ? rocksdb::Status::OK() : s;
 
   double target_score = DecodeDouble(score_bytes.data());
+  if (metadata.rank_indexed) {
+    s = rankByIndex(ctx, ns_key, metadata, member, target_score, member_rank);
+    if (!s.ok()) return s;
+    if (reversed) *member_rank = static_cast<int>(metadata.size) - 1 - *member_rank;
+    *member_score = target_score;
+    return rocksdb::Status::OK();
+  }
+
   std::string start_score_bytes;
   double start_score = !reversed ? kMinScore : kMaxScore;
   PutDouble(&start_score_bytes, start_score);
@@ -618,11 +737,49 @@ rocksdb::Status ZSet::Rank(engine::Context &ctx, const Slice &user_key, const Sl
   return rocksdb::Status::OK();
 }
 
+rocksdb::Status ZSet::rankByIndex(engine::Context &ctx, const Slice &ns_key, const ZSetMetadata &metadata,
+                                  const Slice &member, double score, int *member_rank) {
+  uint64_t rank = 0;
+  ZSetRankIndex rank_index(storage_, ns_key, metadata);
+  auto s = rank_index.CountLess(ctx, score, &rank);
+  if (!s.ok()) return s;
+
+  // the members with the same score are ordered by themselves
+  std::string score_bytes;
+  PutDouble(&score_bytes, score);
+  std::string score_prefix_key =
+      InternalKey(ns_key, score_bytes, metadata.version, storage_->IsSlotIdEncoded()).Encode();
+  std::string next_version_prefix_key =
+      InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
+
+  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  rocksdb::Slice upper_bound(next_version_prefix_key);
+  read_options.iterate_upper_bound = &upper_bound;
+  rocksdb::Slice lower_bound(score_prefix_key);
+  read_options.iterate_lower_bound = &lower_bound;
+
+  auto iter = util::UniqueIterator(ctx, read_options, score_cf_handle_);
+  for (iter->Seek(score_prefix_key); iter->Valid() && iter->key().starts_with(score_prefix_key); iter->Next()) {
+    InternalKey ikey(iter->key(), storage_->IsSlotIdEncoded());
+    Slice score_key = ikey.GetSubKey();
+    score_key.remove_prefix(sizeof(double));
+    if (score_key == member) break;
+    rank++;
+  }
+  s = iter->status();
+  if (!s.ok()) return s;
+
+  *member_rank = static_cast<int>(rank);
+  return rocksdb::Status::OK();
+}
+
 rocksdb::Status ZSet::Overwrite(engine::Context &ctx, const Slice &user_key, const MemberScores &mscores) {
   std::string ns_key = AppendNamespacePrefix(user_key);
 
   LockGuard guard(storage_->GetLockManager(), ns_key);
   ZSetMetadata metadata;
+  metadata.rank_indexed = storage_->GetConfig()->zset_rank_index;
+  ZSetRankIndex rank_index(storage_, ns_key, metadata);
   auto batch = storage_->GetWriteBatchBase();
   WriteBatchLogData log_data(kRedisZSet);
   auto s = batch->PutLogData(log_data.Encode());
@@ -637,23 +794,161 @@ rocksdb::Status ZSet::Overwrite(engine::Context &ctx, const Slice &user_key, con
     std::string score_key = InternalKey(ns_key, score_bytes, metadata.version, storage_->IsSlotIdEncoded()).Encode();
     s = batch->Put(score_cf_handle_, score_key, Slice());
     if (!s.ok()) return s;
+    rank_index.Add(ms.score, 1);
   }
   metadata.size = static_cast<uint32_t>(mscores.size());
   std::string bytes;
   metadata.Encode(&bytes);
   s = batch->Put(metadata_cf_handle_, ns_key, bytes);
   if (!s.ok()) return s;
+  s = rank_index.Flush(ctx, batch.Get());
+  if (!s.ok()) return s;
   return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
 }
 
-rocksdb::Status ZSet::InterStore(engine::Context &ctx, const Slice &dst, const std::vector<KeyWeight> &keys_weights,
-                                 AggregateMethod aggregate_method, uint64_t *saved_cnt) {
+// MemberIterator iterates the members of a zset in member order by its primary subkeys
+class ZSet::MemberIterator {
+ public:
+  MemberIterator(engine::Context &ctx, engine::Storage *storage, const std::string &ns_key,
+                 const ZSetMetadata &metadata)
+      : slot_id_encoded_(storage->IsSlotIdEncoded()),
+        ns_key_(ns_key),
+        version_(metadata.version),
+        size_(metadata.size),
+        prefix_key_(InternalKey(ns_key, "", metadata.version, slot_id_encoded_).Encode()),
+        next_version_prefix_key_(InternalKey(ns_key, "", metadata.version + 1, slot_id_encoded_).Encode()),
+        lower_bound_(prefix_key_),
+        upper_bound_(next_version_prefix_key_),
+        iter_(ctx, readOptions(ctx, metadata.size), storage->GetCFHandle(ColumnFamilyID::PrimarySubkey)) {
+    iter_->Seek(prefix_key_);
+  }
+
+  uint64_t Size() const { return size_; }
+  bool Valid() const { return iter_->Valid(); }
+  Slice Member() const { return InternalKey(iter_->key(), slot_id_encoded_).GetSubKey(); }
+  double Score() const { return DecodeDouble(iter_->value().data()); }
+  rocksdb::Status Status() const { return iter_->status(); }
+  void Next() { iter_->Next(); }
+  // Seek moves to the first member not less than the member, only if the current one is less than it
+  void Seek(const Slice &member) {
+    if (Valid() && Member().compare(member) < 0) {
+      iter_->Seek(InternalKey(ns_key_, member, version_, slot_id_encoded_).Encode());
+    }
+  }
+
+ private:
+  rocksdb::ReadOptions readOptions(engine::Context &ctx, uint64_t size) {
+    rocksdb::ReadOptions read_options = ctx.SubKeyScanOptions(size);
+    read_options.iterate_lower_bound = &lower_bound_;
+    read_options.iterate_upper_bound = &upper_bound_;
+    return read_options;
+  }
+
+  bool slot_id_encoded_;
+  std::string ns_key_;
+  uint64_t version_;
+  uint64_t size_;
+  std::string prefix_key_;
+  std::string next_version_prefix_key_;
+  rocksdb::Slice lower_bound_;
+  rocksdb::Slice upper_bound_;
+  util::UniqueIterator iter_;
+};
+
+namespace {
+
+double WeightedScore(double score, double weight) {
+  score *= weight;
+  return std::isnan(score) ? 0 : score;
+}
+
+double AggregateScore(AggregateMethod aggregate_method, double target, double score) {
+  switch (aggregate_method) {
+    case kAggregateSum:
+      target += score;
+      return std::isnan(target) ? 0 : target;
+    case kAggregateMin:
+      return std::min(target, score);
+    case kAggregateMax:
+      return std::max(target, score);
+  }
+  return target;
+}
+
+}  // namespace
+
+rocksdb::Status ZSet::newMemberIterators(engine::Context &ctx, const std::vector<Slice> &user_keys,
+                                         std::vector<std::unique_ptr<MemberIterator>> *iters) {
+  iters->clear();
+  iters->reserve(user_keys.size());
+  for (const auto &user_key : user_keys) {
+    std::string ns_key = AppendNamespacePrefix(user_key);
+    ZSetMetadata metadata(false);
+    auto s = GetMetadata(ctx, ns_key, &metadata);
+    if (!s.ok() && !s.IsNotFound()) return s;
+    iters->emplace_back(s.ok() ? std::make_unique<MemberIterator>(ctx, storage_, ns_key, metadata) : nullptr);
+  }
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status ZSet::storeMembers(engine::Context &ctx, const Slice &user_key, const MembersProducer &producer,
+                                   uint64_t *saved_cnt) {
   *saved_cnt = 0;
-  std::vector<MemberScore> members;
-  auto s = Inter(ctx, keys_weights, aggregate_method, &members);
+  std::string ns_key = AppendNamespacePrefix(user_key);
+
+  // The members are written in several batches to bound the size of each write. They have a new version,
+  // so they stay invisible until the metadata is written by the last batch, like Database::Copy.
+  ZSetMetadata metadata;
+  metadata.rank_indexed = storage_->GetConfig()->zset_rank_index;
+  ZSetRankIndex rank_index(storage_, ns_key, metadata);
+  WriteBatchLogData log_data(kRedisZSet);
+  engine::StagedWriteBatch staged(ctx, storage_, metadata.version, log_data.Encode());
+  auto put_member = [&](const std::string &member, double score) -> rocksdb::Status {
+    std::string score_bytes;
+    std::string member_key = InternalKey(ns_key, member, metadata.version, storage_->IsSlotIdEncoded()).Encode();
+    PutDouble(&score_bytes, score);
+    auto s = staged.Get()->Put(member_key, score_bytes);
+    if (!s.ok()) return s;
+    score_bytes.append(member);
+    std::string score_key = InternalKey(ns_key, score_bytes, metadata.version, storage_->IsSlotIdEncoded()).Encode();
+    s = staged.Get()->Put(score_cf_handle_, score_key, Slice());
+    if (!s.ok()) return s;
+    rank_index.Add(score, 1);
+    metadata.size++;
+    return staged.Flush();
+  };
+
+  auto s = staged.Begin();
+  if (!s.ok()) return s;
+  s = producer(put_member);
+  if (!s.ok()) return s;
+
+  std::string bytes;
+  metadata.Encode(&bytes);
+  s = staged.Get()->Put(metadata_cf_handle_, ns_key, bytes);
+  if (!s.ok()) return s;
+  s = rank_index.Flush(ctx, staged.Get());
   if (!s.ok()) return s;
-  *saved_cnt = members.size();
-  return Overwrite(ctx, dst, members);
+  s = staged.Commit();
+  if (!s.ok()) return s;
+  *saved_cnt = metadata.size;
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status ZSet::InterStore(engine::Context &ctx, const Slice &dst, const std::vector<KeyWeight> &keys_weights,
+                                 AggregateMethod aggregate_method, uint64_t *saved_cnt) {
+  std::vector<std::string> lock_keys;
+  lock_keys.reserve(keys_weights.size() + 1);
+  for (const auto &key_weight : keys_weights) {
+    lock_keys.emplace_back(AppendNamespacePrefix(key_weight.key));
+  }
+  lock_keys.emplace_back(AppendNamespacePrefix(dst));
+  MultiLockGuard guard(storage_->GetLockManager(), lock_keys);
+
+  return storeMembers(
+      ctx, dst,
+      [&](const MemberCallback &callback) { return interMembers(ctx, keys_weights, aggregate_method, 0, callback); },
+      saved_cnt);
 }
 
 rocksdb::Status ZSet::Inter(engine::Context &ctx, const std::vector<KeyWeight> &keys_weights,
@@ -666,116 +961,97 @@ rocksdb::Status ZSet::Inter(engine::Context &ctx, const std::vector<KeyWeight> &
   }
   MultiLockGuard guard(storage_->GetLockManager(), lock_keys);
 
-  std::map<std::string, double> dst_zset;
-  std::map<std::string, size_t> member_counters;
-  std::vector<MemberScore> target_mscores;
-  uint64_t target_size = 0;
-  RangeScoreSpec spec;
-  auto s = RangeByScore(ctx, keys_weights[0].key, spec, &target_mscores, &target_size);
-  if (!s.ok() || target_mscores.empty()) return s;
-
-  for (const auto &ms : target_mscores) {
-    double score = ms.score * keys_weights[0].weight;
-    if (std::isnan(score)) score = 0;
-    dst_zset[ms.member] = score;
-    member_counters[ms.member] = 1;
-  }
-
-  for (size_t i = 1; i < keys_weights.size(); i++) {
-    s = RangeByScore(ctx, keys_weights[i].key, spec, &target_mscores, &target_size);
-    if (!s.ok() || target_mscores.empty()) return s;
-
-    for (const auto &ms : target_mscores) {
-      if (dst_zset.find(ms.member) == dst_zset.end()) continue;
-      member_counters[ms.member]++;
-      double score = ms.score * keys_weights[i].weight;
-      if (std::isnan(score)) score = 0;
-      switch (aggregate_method) {
-        case kAggregateSum:
-          dst_zset[ms.member] += score;
-          if (std::isnan(dst_zset[ms.member])) {
-            dst_zset[ms.member] = 0;
-          }
-          break;
-        case kAggregateMin:
-          if (dst_zset[ms.member] > score) {
-            dst_zset[ms.member] = score;
-          }
-          break;
-        case kAggregateMax:
-          if (dst_zset[ms.member] < score) {
-            dst_zset[ms.member] = score;
-          }
-          break;
+  return interMembers(ctx, keys_weights, aggregate_method, 0, [members](const std::string &member, double score) {
+    if (members) members->emplace_back(MemberScore{member, score});
+    return rocksdb::Status::OK();
+  });
+}
+
+rocksdb::Status ZSet::interMembers(engine::Context &ctx, const std::vector<KeyWeight> &keys_weights,
+                                   AggregateMethod aggregate_method, uint64_t limit, const MemberCallback &callback) {
+  std::vector<Slice> user_keys;
+  user_keys.reserve(keys_weights.size());
+  for (const auto &key_weight : keys_weights) {
+    user_keys.emplace_back(key_weight.key);
+  }
+  std::vector<std::unique_ptr<MemberIterator>> iters;
+  auto s = newMemberIterators(ctx, user_keys, &iters);
+  if (!s.ok()) return s;
+  for (const auto &iter : iters) {
+    if (!iter) return rocksdb::Status::OK();
+  }
+
+  // the smallest zset drives the merge, and the others are probed from the smaller to the larger
+  std::vector<size_t> probe_order(iters.size());
+  for (size_t i = 0; i < iters.size(); i++) probe_order[i] = i;
+  std::stable_sort(probe_order.begin(), probe_order.end(),
+                   [&iters](size_t a, size_t b) { return iters[a]->Size() < iters[b]->Size(); });
+
+  auto &driver = iters[probe_order[0]];
+  uint64_t emitted = 0;
+  while (driver->Valid()) {
+    std::string member = driver->Member().ToString();
+    bool matched = true;
+    for (size_t i = 1; i < probe_order.size(); i++) {
+      auto &iter = iters[probe_order[i]];
+      iter->Seek(member);
+      if (!iter->Valid()) return iter->Status();
+      if (iter->Member() != member) {
+        // no member before the current one of the probed zset can be in the intersection
+        driver->Seek(iter->Member());
+        matched = false;
+        break;
       }
     }
-  }
-  if (members && !dst_zset.empty()) {
-    members->reserve(dst_zset.size());
-    for (const auto &iter : dst_zset) {
-      if (member_counters[iter.first] != keys_weights.size()) continue;
-      members->emplace_back(MemberScore{iter.first, iter.second});
+    if (!matched) continue;
+
+    // the scores are aggregated in the order of the keys
+    double score = WeightedScore(iters[0]->Score(), keys_weights[0].weight);
+    for (size_t i = 1; i < iters.size(); i++) {
+      score = AggregateScore(aggregate_method, score, WeightedScore(iters[i]->Score(), keys_weights[i].weight));
     }
+    s = callback(member, score);
+    if (!s.ok()) return s;
+    if (limit > 0 && ++emitted >= limit) return rocksdb::Status::OK();
+    driver->Next();
   }
-
-  return rocksdb::Status::OK();
+  return driver->Status();
 }
 
 rocksdb::Status ZSet::InterCard(engine::Context &ctx, const std::vector<std::string> &user_keys, uint64_t limit,
                                 uint64_t *inter_cnt) {
   std::vector<std::string> lock_keys;
   lock_keys.reserve(user_keys.size());
+  std::vector<KeyWeight> keys_weights;
+  keys_weights.reserve(user_keys.size());
   for (const auto &user_key : user_keys) {
     std::string ns_key = AppendNamespacePrefix(user_key);
     lock_keys.emplace_back(std::move(ns_key));
+    keys_weights.emplace_back(KeyWeight{user_key, 1});
   }
   MultiLockGuard guard(storage_->GetLockManager(), lock_keys);
 
-  std::vector<MemberScores> mscores_list;
-  mscores_list.reserve(user_keys.size());
-  RangeScoreSpec spec;
-  for (const auto &user_key : user_keys) {
-    MemberScores mscores;
-    auto s = RangeByScore(ctx, user_key, spec, &mscores, nullptr);
-    if (!s.ok() || mscores.empty()) return s;
-    mscores_list.emplace_back(std::move(mscores));
-  }
-  std::sort(mscores_list.begin(), mscores_list.end(),
-            [](const MemberScores &v1, const MemberScores &v2) { return v1.size() < v2.size(); });
-
-  auto base_mscores = mscores_list[0];
-  std::map<std::string, size_t> member_counters;
-  uint64_t cardinality = 0;
-  for (const auto &base_ms : base_mscores) {
-    member_counters[base_ms.member] = 1;
-    for (size_t i = 1; i < mscores_list.size(); i++) {
-      for (const auto &ms : mscores_list[i]) {
-        if (base_ms.member == ms.member) {
-          member_counters[ms.member]++;
-          break;
-        }
-      }
-    }
-    if (member_counters[base_ms.member] == mscores_list.size()) {
-      cardinality++;
-      if (limit > 0 && cardinality >= limit) {
-        *inter_cnt = limit;
-        return rocksdb::Status::OK();
-      };
-    }
-  }
-  *inter_cnt = cardinality;
-  return rocksdb::Status::OK();
+  *inter_cnt = 0;
+  return interMembers(ctx, keys_weights, kAggregateSum, limit, [inter_cnt](const std::string &, double) {
+    (*inter_cnt)++;
+    return rocksdb::Status::OK();
+  });
 }
 
 rocksdb::Status ZSet::UnionStore(engine::Context &ctx, const Slice &dst, const std::vector<KeyWeight> &keys_weights,
                                  AggregateMethod aggregate_method, uint64_t *saved_cnt) {
-  *saved_cnt = 0;
-  std::vector<MemberScore> members;
-  auto s = Union(ctx, keys_weights, aggregate_method, &members);
-  if (!s.ok()) return s;
-  *saved_cnt = members.size();
-  return Overwrite(ctx, dst, members);
+  std::vector<std::string> lock_keys;
+  lock_keys.reserve(keys_weights.size() + 1);
+  for (const auto &key_weight : keys_weights) {
+    lock_keys.emplace_back(AppendNamespacePrefix(key_weight.key));
+  }
+  lock_keys.emplace_back(AppendNamespacePrefix(dst));
+  MultiLockGuard guard(storage_->GetLockManager(), lock_keys);
+
+  return storeMembers(
+      ctx, dst,
+      [&](const MemberCallback &callback) { return unionMembers(ctx, keys_weights, aggregate_method, callback); },
+      saved_cnt);
 }
 
 rocksdb::Status ZSet::Union(engine::Context &ctx, const std::vector<KeyWeight> &keys_weights,
@@ -788,43 +1064,63 @@ rocksdb::Status ZSet::Union(engine::Context &ctx, const std::vector<KeyWeight> &
   }
   MultiLockGuard guard(storage_->GetLockManager(), lock_keys);
 
-  std::map<std::string, double> dst_zset;
-  std::vector<MemberScore> target_mscores;
-  uint64_t target_size = 0;
-  RangeScoreSpec spec;
+  return unionMembers(ctx, keys_weights, aggregate_method, [members](const std::string &member, double score) {
+    if (members) members->emplace_back(MemberScore{member, score});
+    return rocksdb::Status::OK();
+  });
+}
+
+rocksdb::Status ZSet::unionMembers(engine::Context &ctx, const std::vector<KeyWeight> &keys_weights,
+                                   AggregateMethod aggregate_method, const MemberCallback &callback) {
+  std::vector<Slice> user_keys;
+  user_keys.reserve(keys_weights.size());
   for (const auto &key_weight : keys_weights) {
-    // get all member
-    auto s = RangeByScore(ctx, key_weight.key, spec, &target_mscores, &target_size);
-    if (!s.ok() && !s.IsNotFound()) return s;
-    for (const auto &ms : target_mscores) {
-      double score = ms.score * key_weight.weight;
-      if (std::isnan(score)) score = 0;
-      if (dst_zset.find(ms.member) == dst_zset.end()) {
-        dst_zset[ms.member] = score;
-      } else {
-        switch (aggregate_method) {
-          case kAggregateSum:
-            dst_zset[ms.member] += score;
-            if (std::isnan(dst_zset[ms.member])) dst_zset[ms.member] = 0;
-            break;
-          case kAggregateMin:
-            if (dst_zset[ms.member] > score) {
-              dst_zset[ms.member] = score;
-            }
-            break;
-          case kAggregateMax:
-            if (dst_zset[ms.member] < score) {
-              dst_zset[ms.member] = score;
-            }
-            break;
-        }
-      }
+    user_keys.emplace_back(key_weight.key);
+  }
+  std::vector<std::unique_ptr<MemberIterator>> iters;
+  auto s = newMemberIterators(ctx, user_keys, &iters);
+  if (!s.ok()) return s;
+
+  // a min-heap of the zsets by their current members, the lower index goes first for the same member
+  auto greater = [&iters](size_t a, size_t b) {
+    int cmp = iters[a]->Member().compare(iters[b]->Member());
+    return cmp > 0 || (cmp == 0 && a > b);
+  };
+  std::priority_queue<size_t, std::vector<size_t>, decltype(greater)> heap(greater);
+  for (size_t i = 0; i < iters.size(); i++) {
+    if (!iters[i]) continue;
+    if (iters[i]->Valid()) {
+      heap.push(i);
+    } else if (s = iters[i]->Status(); !s.ok()) {
+      return s;
     }
   }
-  if (members && !dst_zset.empty()) {
-    members->reserve(dst_zset.size());
-    for (const auto &iter : dst_zset) {
-      members->emplace_back(MemberScore{iter.first, iter.second});
+
+  std::vector<size_t> matched;
+  while (!heap.empty()) {
+    std::string member = iters[heap.top()]->Member().ToString();
+    matched.clear();
+    while (!heap.empty() && iters[heap.top()]->Member() == member) {
+      matched.emplace_back(heap.top());
+      heap.pop();
+    }
+
+    // the scores are aggregated in the order of the keys, as the popped indexes are
+    double score = WeightedScore(iters[matched[0]]->Score(), keys_weights[matched[0]].weight);
+    for (size_t i = 1; i < matched.size(); i++) {
+      double weighted = WeightedScore(iters[matched[i]]->Score(), keys_weights[matched[i]].weight);
+      score = AggregateScore(aggregate_method, score, weighted);
+    }
+    s = callback(member, score);
+    if (!s.ok()) return s;
+
+    for (auto i : matched) {
+      iters[i]->Next();
+      if (iters[i]->Valid()) {
+        heap.push(i);
+      } else if (s = iters[i]->Status(); !s.ok()) {
+        return s;
+      }
     }
   }
   return rocksdb::Status::OK();
@@ -832,10 +1128,12 @@ rocksdb::Status ZSet::Union(engine::Context &ctx, const std::vector<KeyWeight> &
 
 rocksdb::Status ZSet::Scan(engine::Context &ctx, const Slice &user_key, const std::string &cursor, uint64_t limit,
                            const std::string &member_prefix, std::vector<std::string> *members,
-                           std::vector<double> *scores) {
+                           std::vector<double> *scores, const std::string &pattern, uint64_t time_budget_us,
+                           std::string *end_cursor) {
   if (scores != nullptr) {
     std::vector<std::string> values;
-    auto s = SubKeyScanner::Scan(ctx, kRedisZSet, user_key, cursor, limit, member_prefix, members, &values);
+    auto s = SubKeyScanner::Scan(ctx, kRedisZSet, user_key, cursor, limit, member_prefix, members, &values, pattern,
+                                 time_budget_us, end_cursor);
     if (!s.ok()) return s;
 
     for (const auto &value : values) {
@@ -844,7 +1142,8 @@ rocksdb::Status ZSet::Scan(engine::Context &ctx, const Slice &user_key, const st
     }
     return s;
   }
-  return SubKeyScanner::Scan(ctx, kRedisZSet, user_key, cursor, limit, member_prefix, members);
+  return SubKeyScanner::Scan(ctx, kRedisZSet, user_key, cursor, limit, member_prefix, members, nullptr, pattern,
+                             time_budget_us, end_cursor);
 }
 
 rocksdb::Status ZSet::MGet(engine::Context &ctx, const Slice &user_key, const std::vector<Slice> &members,
@@ -857,17 +1156,15 @@ rocksdb::Status ZSet::MGet(engine::Context &ctx, const Slice &user_key, const st
   rocksdb::Status s = GetMetadata(ctx, ns_key, &metadata);
   if (!s.ok()) return s;
 
-  std::string score_bytes;
-  for (const auto &member : members) {
-    std::string member_key = InternalKey(ns_key, member, metadata.version, storage_->IsSlotIdEncoded()).Encode();
-    score_bytes.clear();
-    s = storage_->Get(ctx, ctx.GetReadOptions(), member_key, &score_bytes);
-    if (!s.ok() && !s.IsNotFound()) return s;
-    if (s.IsNotFound()) {
+  std::vector<std::string> score_bytes;
+  auto statuses = MultiGetSubKeys(ctx, ns_key, metadata, members, &score_bytes);
+  for (size_t i = 0; i < members.size(); i++) {
+    if (!statuses[i].ok() && !statuses[i].IsNotFound()) return statuses[i];
+    if (statuses[i].IsNotFound()) {
       continue;
     }
-    double target_score = DecodeDouble(score_bytes.data());
-    (*mscores)[member.ToString()] = target_score;
+    double target_score = DecodeDouble(score_bytes[i].data());
+    (*mscores)[members[i].ToString()] = target_score;
   }
   return rocksdb::Status::OK();
 }
@@ -885,7 +1182,7 @@ rocksdb::Status ZSet::GetAllMemberScores(engine::Context &ctx, const Slice &user
   std::string next_version_prefix_key =
       InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
 
-  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  rocksdb::ReadOptions read_options = ctx.SubKeyScanOptions(metadata.size);
 
   rocksdb::Slice upper_bound(next_version_prefix_key);
   rocksdb::Slice lower_bound(prefix_key);
@@ -920,6 +1217,18 @@ rocksdb::Status ZSet::RandMember(engine::Context &ctx, const Slice &user_key, in
   if (!s.ok()) return s.IsNotFound() ? rocksdb::Status::OK() : s;
   if (metadata.size == 0) return rocksdb::Status::OK();
 
+  member_scores->clear();
+  if (UseSeekSample(storage_->GetConfig()->random_sample_exact, metadata.size, unique, count)) {
+    s = SampleRandMemberBySeek<MemberScore>(
+        unique, count,
+        [this, &ctx, &ns_key, &metadata](std::mt19937_64 &gen, size_t n, std::vector<MemberScore> *run) {
+          return sampleMemberScores(ctx, ns_key, metadata, gen, n, run);
+        },
+        [](const MemberScore &member_score) { return member_score.member; }, member_scores);
+    if (!s.ok()) return s;
+    if (member_scores->size() == count) return rocksdb::Status::OK();
+  }
+
   return ExtractRandMemberFromSet<MemberScore>(
       unique, count,
       [this, user_key, &ctx](std::vector<MemberScore> *scores) -> rocksdb::Status {
@@ -928,44 +1237,113 @@ rocksdb::Status ZSet::RandMember(engine::Context &ctx, const Slice &user_key, in
       member_scores);
 }
 
-rocksdb::Status ZSet::Diff(engine::Context &ctx, const std::vector<Slice> &keys, MemberScores *members) {
-  members->clear();
-  MemberScores source_member_scores;
-  RangeScoreSpec spec;
-  uint64_t first_element_size = 0;
-  auto s = RangeByScore(ctx, keys[0], spec, &source_member_scores, &first_element_size);
+rocksdb::Status ZSet::sampleMemberScores(engine::Context &ctx, const Slice &ns_key, const ZSetMetadata &metadata,
+                                         std::mt19937_64 &gen, size_t n, std::vector<MemberScore> *member_scores) {
+  if (!metadata.rank_indexed) {
+    std::vector<std::pair<std::string, std::string>> subkeys;
+    auto s = SampleSubKeys(ctx, ns_key, metadata, gen, n, &subkeys);
+    for (auto &[member, value] : subkeys) {
+      Slice score_bytes(value);
+      double score = 0;
+      GetDouble(&score_bytes, &score);
+      member_scores->emplace_back(MemberScore{std::move(member), score});
+    }
+    return s;
+  }
+
+  // The rank index locates a random rank, so the points are uniform over the members
+  uint64_t rank = std::uniform_int_distribution<uint64_t>(0, metadata.size - 1)(gen);
+  double rank_score = 0;
+  uint64_t ties_before = 0;
+  ZSetRankIndex rank_index(storage_, ns_key, metadata);
+  auto s = rank_index.FindByRank(ctx, rank, &rank_score, &ties_before);
   if (!s.ok()) return s;
 
-  if (first_element_size == 0) {
-    return rocksdb::Status::OK();
-  }
+  std::string prefix_key = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
+  std::string next_version_prefix_key =
+      InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
+  rocksdb::ReadOptions read_options = ctx.SubKeyScanOptions(ties_before + n);
+  rocksdb::Slice upper_bound(next_version_prefix_key);
+  read_options.iterate_upper_bound = &upper_bound;
+  rocksdb::Slice lower_bound(prefix_key);
+  read_options.iterate_lower_bound = &lower_bound;
+  auto iter = util::UniqueIterator(ctx, read_options, score_cf_handle_);
 
-  std::set<std::string> exclude_members;
-  MemberScores target_member_scores;
-  for (size_t i = 1; i < keys.size(); i++) {
-    uint64_t size = 0;
-    s = RangeByScore(ctx, keys[i], spec, &target_member_scores, &size);
-    if (!s.ok()) return s;
-    for (auto &member_score : target_member_scores) {
-      exclude_members.emplace(std::move(member_score.member));
+  std::string rank_score_bytes;
+  PutDouble(&rank_score_bytes, rank_score);
+  iter->Seek(InternalKey(ns_key, rank_score_bytes, metadata.version, storage_->IsSlotIdEncoded()).Encode());
+  for (; ties_before > 0 && iter->Valid(); ties_before--) iter->Next();
+  // wrap around to the first member after the last one
+  for (bool wrapped = false; member_scores->size() < n; iter->Next()) {
+    if (!iter->Valid()) {
+      if (!iter->status().ok() || wrapped) break;
+      wrapped = true;
+      iter->Seek(prefix_key);
+      if (!iter->Valid()) break;
     }
-    target_member_scores.clear();
+    InternalKey ikey(iter->key(), storage_->IsSlotIdEncoded());
+    Slice score_key = ikey.GetSubKey();
+    double score = 0;
+    GetDouble(&score_key, &score);
+    member_scores->emplace_back(MemberScore{score_key.ToString(), score});
   }
-  for (const auto &member_score : source_member_scores) {
-    if (exclude_members.find(member_score.member) == exclude_members.end()) {
-      members->push_back(member_score);
+  return iter->status();
+}
+
+rocksdb::Status ZSet::Diff(engine::Context &ctx, const std::vector<Slice> &keys, MemberScores *members) {
+  members->clear();
+  auto s = diffMembers(ctx, keys, [members](const std::string &member, double score) {
+    members->emplace_back(MemberScore{member, score});
+    return rocksdb::Status::OK();
+  });
+  if (!s.ok()) return s;
+
+  // the members are replied in the order of the scores like the first zset
+  std::sort(members->begin(), members->end(), [](const MemberScore &a, const MemberScore &b) {
+    return a.score < b.score || (a.score == b.score && a.member < b.member);
+  });
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status ZSet::diffMembers(engine::Context &ctx, const std::vector<Slice> &keys,
+                                  const MemberCallback &callback) {
+  std::vector<std::unique_ptr<MemberIterator>> iters;
+  auto s = newMemberIterators(ctx, keys, &iters);
+  if (!s.ok() || !iters[0]) return s;
+
+  auto &source = iters[0];
+  for (; source->Valid(); source->Next()) {
+    std::string member = source->Member().ToString();
+    bool excluded = false;
+    for (size_t i = 1; i < iters.size() && !excluded; i++) {
+      if (!iters[i]) continue;
+      iters[i]->Seek(member);
+      if (!iters[i]->Valid()) {
+        if (s = iters[i]->Status(); !s.ok()) return s;
+        continue;
+      }
+      excluded = iters[i]->Member() == member;
     }
+    if (excluded) continue;
+
+    s = callback(member, source->Score());
+    if (!s.ok()) return s;
   }
-  return rocksdb::Status::OK();
+  return source->Status();
 }
 
 rocksdb::Status ZSet::DiffStore(engine::Context &ctx, const Slice &dst, const std::vector<Slice> &keys,
                                 uint64_t *stored_count) {
-  MemberScores mscores;
-  auto s = Diff(ctx, keys, &mscores);
-  if (!s.ok()) return s;
-  *stored_count = mscores.size();
-  return Overwrite(ctx, dst, mscores);
+  std::vector<std::string> lock_keys;
+  lock_keys.reserve(keys.size() + 1);
+  for (const auto &key : keys) {
+    lock_keys.emplace_back(AppendNamespacePrefix(key));
+  }
+  lock_keys.emplace_back(AppendNamespacePrefix(dst));
+  MultiLockGuard guard(storage_->GetLockManager(), lock_keys);
+
+  return storeMembers(
+      ctx, dst, [&](const MemberCallback &callback) { return diffMembers(ctx, keys, callback); }, stored_count);
 }
 
 }  // namespace redis
@@ -20,8 +20,10 @@
 
 #pragma once
 
+#include <functional>
 #include <limits>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -108,7 +110,8 @@ class ZSet : public SubKeyScanner {
   rocksdb::Status Score(engine::Context &ctx, const Slice &user_key, const Slice &member, double *score);
   rocksdb::Status Scan(engine::Context &ctx, const Slice &user_key, const std::string &cursor, uint64_t limit,
                        const std::string &member_prefix, std::vector<std::string> *members,
-                       std::vector<double> *scores = nullptr);
+                       std::vector<double> *scores = nullptr, const std::string &pattern = "",
+                       uint64_t time_budget_us = 0, std::string *end_cursor = nullptr);
   rocksdb::Status Overwrite(engine::Context &ctx, const Slice &user_key, const MemberScores &mscores);
   rocksdb::Status InterStore(engine::Context &ctx, const Slice &dst, const std::vector<KeyWeight> &keys_weights,
                              AggregateMethod aggregate_method, uint64_t *saved_cnt);
@@ -139,8 +142,42 @@ class ZSet : public SubKeyScanner {
   rocksdb::Status RandMember(engine::Context &ctx, const Slice &user_key, int64_t command_count,
                              std::vector<MemberScore> *member_scores);
 
- private:
+ protected:
+  using MemberCallback = std::function<rocksdb::Status(const std::string &member, double score)>;
+  using MembersProducer = std::function<rocksdb::Status(const MemberCallback &)>;
+
+  // storeMembers replaces the zset with the members produced, written in batches of bounded size.
+  // The key must be locked by the caller.
+  rocksdb::Status storeMembers(engine::Context &ctx, const Slice &user_key, const MembersProducer &producer,
+                               uint64_t *saved_cnt);
+
   rocksdb::ColumnFamilyHandle *score_cf_handle_;
+
+ private:
+  class MemberIterator;
+
+  // newMemberIterators opens an iterator in member order for each zset, a missing zset gets a null iterator
+  rocksdb::Status newMemberIterators(engine::Context &ctx, const std::vector<Slice> &user_keys,
+                                     std::vector<std::unique_ptr<MemberIterator>> *iters);
+  // interMembers, unionMembers and diffMembers merge the zsets in one pass over their members in member order,
+  // passing each member of the result to the callback. The members are neither locked nor materialized.
+  rocksdb::Status interMembers(engine::Context &ctx, const std::vector<KeyWeight> &keys_weights,
+                               AggregateMethod aggregate_method, uint64_t limit, const MemberCallback &callback);
+  rocksdb::Status unionMembers(engine::Context &ctx, const std::vector<KeyWeight> &keys_weights,
+                               AggregateMethod aggregate_method, const MemberCallback &callback);
+  rocksdb::Status diffMembers(engine::Context &ctx, const std::vector<Slice> &keys, const MemberCallback &callback);
+
+  // sampleMemberScores reads at most n neighbouring members from a random point for SampleRandMemberBySeek
+  rocksdb::Status sampleMemberScores(engine::Context &ctx, const Slice &ns_key, const ZSetMetadata &metadata,
+                                     std::mt19937_64 &gen, size_t n, std::vector<MemberScore> *member_scores);
+  // rankByIndex gets the rank of the member with the score in ascending order by the rank index
+  rocksdb::Status rankByIndex(engine::Context &ctx, const Slice &ns_key, const ZSetMetadata &metadata,
+                              const Slice &member, double score, int *member_rank);
+
+  // scoreFloorKey encodes the score key of the score floor, there're no members in the score index before it
+  std::string scoreFloorKey(const Slice &ns_key, const ZSetMetadata &metadata) const;
+  // deleteHeadTombstones deletes the score keys of the members popped before the score floor by range
+  rocksdb::Status deleteHeadTombstones(const Slice &ns_key, ZSetMetadata *metadata, rocksdb::WriteBatchBase *batch);
 };
 
 }  // namespace redis
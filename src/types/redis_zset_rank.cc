@@ -0,0 +1,142 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "redis_zset_rank.h"
+
+#include "db_util.h"
+#include "encoding.h"
+
+namespace redis {
+
+ZSetRankIndex::ZSetRankIndex(engine::Storage *storage, const Slice &ns_key, const ZSetMetadata &metadata)
+    : storage_(storage),
+      cf_handle_(storage->GetCFHandle(ColumnFamilyID::ZSetRank)),
+      ns_key_(ns_key.ToString()),
+      version_(metadata.version),
+      enabled_(metadata.rank_indexed) {}
+
+std::string ZSetRankIndex::nodeKey(size_t level, const std::string &prefix) const {
+  std::string sub_key;
+  sub_key.push_back(static_cast<char>(level));
+  sub_key.append(prefix);
+  return InternalKey(ns_key_, sub_key, version_, storage_->IsSlotIdEncoded()).Encode();
+}
+
+void ZSetRankIndex::Add(double score, int64_t delta) {
+  if (!enabled_ || delta == 0) return;
+
+  std::string score_bytes;
+  PutDouble(&score_bytes, score);
+  for (size_t len = 1; len <= kScoreBytes; len++) {
+    deltas_[score_bytes.substr(0, len)] += delta;
+  }
+}
+
+rocksdb::Status ZSetRankIndex::Flush(engine::Context &ctx, rocksdb::WriteBatchBase *batch) {
+  for (const auto &[prefix, delta] : deltas_) {
+    if (delta == 0) continue;
+
+    std::string key = nodeKey(prefix.size(), prefix);
+    std::string value;
+    auto s = storage_->Get(ctx, ctx.GetReadOptions(), cf_handle_, key, &value);
+    if (!s.ok() && !s.IsNotFound()) return s;
+
+    int64_t count = delta;
+    if (s.ok()) {
+      if (value.size() != sizeof(uint64_t)) return rocksdb::Status::Corruption("invalid zset rank node");
+      count += static_cast<int64_t>(DecodeFixed64(value.data()));
+    }
+    if (count > 0) {
+      value.clear();
+      PutFixed64(&value, count);
+      s = batch->Put(cf_handle_, key, value);
+    } else {
+      s = batch->Delete(cf_handle_, key);
+    }
+    if (!s.ok()) return s;
+  }
+  deltas_.clear();
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status ZSetRankIndex::CountLess(engine::Context &ctx, double score, uint64_t *count) {
+  *count = 0;
+
+  std::string score_bytes;
+  PutDouble(&score_bytes, score);
+  std::string prefix_key = InternalKey(ns_key_, "", version_, storage_->IsSlotIdEncoded()).Encode();
+  std::string next_version_prefix_key = InternalKey(ns_key_, "", version_ + 1, storage_->IsSlotIdEncoded()).Encode();
+
+  rocksdb::ReadOptions read_options = ctx.GetReadOptions();
+  rocksdb::Slice upper_bound(next_version_prefix_key);
+  read_options.iterate_upper_bound = &upper_bound;
+  rocksdb::Slice lower_bound(prefix_key);
+  read_options.iterate_lower_bound = &lower_bound;
+  auto iter = util::UniqueIterator(ctx, read_options, cf_handle_);
+
+  // at each level, count the siblings of the path of the score which are less than it
+  for (size_t len = 1; len <= kScoreBytes; len++) {
+    std::string children_key = nodeKey(len, score_bytes.substr(0, len - 1));
+    std::string node_key = nodeKey(len, score_bytes.substr(0, len));
+    for (iter->Seek(children_key); iter->Valid() && iter->key().compare(node_key) < 0; iter->Next()) {
+      if (iter->value().size() != sizeof(uint64_t)) return rocksdb::Status::Corruption("invalid zset rank node");
+      *count += DecodeFixed64(iter->value().data());
+    }
+    if (auto s = iter->status(); !s.ok()) return s;
+  }
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status ZSetRankIndex::FindByRank(engine::Context &ctx, uint64_t rank, double *score, uint64_t *ties_before) {
+  std::string prefix_key = InternalKey(ns_key_, "", version_, storage_->IsSlotIdEncoded()).Encode();
+  std::string next_version_prefix_key = InternalKey(ns_key_, "", version_ + 1, storage_->IsSlotIdEncoded()).Encode();
+
+  rocksdb::ReadOptions read_options = ctx.GetReadOptions();
+  rocksdb::Slice upper_bound(next_version_prefix_key);
+  read_options.iterate_upper_bound = &upper_bound;
+  rocksdb::Slice lower_bound(prefix_key);
+  read_options.iterate_lower_bound = &lower_bound;
+  auto iter = util::UniqueIterator(ctx, read_options, cf_handle_);
+
+  // descend into the child which holds the rank, skipping the members of its preceding siblings
+  std::string prefix;
+  for (size_t len = 1; len <= kScoreBytes; len++) {
+    std::string children_key = nodeKey(len, prefix);
+    bool found = false;
+    for (iter->Seek(children_key); iter->Valid() && iter->key().starts_with(children_key); iter->Next()) {
+      if (iter->value().size() != sizeof(uint64_t)) return rocksdb::Status::Corruption("invalid zset rank node");
+      uint64_t count = DecodeFixed64(iter->value().data());
+      if (rank < count) {
+        prefix.push_back(iter->key()[iter->key().size() - 1]);
+        found = true;
+        break;
+      }
+      rank -= count;
+    }
+    if (auto s = iter->status(); !s.ok()) return s;
+    if (!found) return rocksdb::Status::NotFound("rank is out of range");
+  }
+
+  *score = DecodeDouble(prefix.data());
+  *ties_before = rank;
+  return rocksdb::Status::OK();
+}
+
+}  // namespace redis
@@ -0,0 +1,71 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+
+#include "storage/redis_metadata.h"
+#include "storage/storage.h"
+
+namespace redis {
+
+// ZSetRankIndex counts the members of a zset by the prefixes of their encoded scores, which makes
+// a radix tree of depth 8 and fanout 256 in the zset_rank column family. The node of the l-byte prefix p
+// is stored as `InternalKey(ns_key, l + p, version) -> fixed64 count`, so the number of members below
+// a score is summed from the siblings on its path and the member at a rank is found by descending
+// the tree, both with at most one seek per level whatever the size of the zset.
+//
+// Only the zsets whose metadata is marked as rank indexed are counted, Add and Flush do nothing for others.
+class ZSetRankIndex {
+ public:
+  ZSetRankIndex(engine::Storage *storage, const Slice &ns_key, const ZSetMetadata &metadata);
+
+  bool Enabled() const { return enabled_; }
+
+  // Add counts `delta` members more (or less if it's negative) with the score, until Flush
+  void Add(double score, int64_t delta);
+  // Flush writes the counts changed by Add into the batch, which must be done under the lock of the key
+  rocksdb::Status Flush(engine::Context &ctx, rocksdb::WriteBatchBase *batch);
+
+  // CountLess gets the number of members whose score is less than the score
+  rocksdb::Status CountLess(engine::Context &ctx, double score, uint64_t *count);
+  // FindByRank gets the score of the member at the rank in ascending order,
+  // and the number of members before it with the same score
+  rocksdb::Status FindByRank(engine::Context &ctx, uint64_t rank, double *score, uint64_t *ties_before);
+
+ private:
+  static constexpr size_t kScoreBytes = sizeof(double);
+
+  // nodeKey encodes the key of the node of the prefix at the level, the children of the prefix p
+  // are all the keys starting with `nodeKey(p.size() + 1, p)`
+  std::string nodeKey(size_t level, const std::string &prefix) const;
+
+  engine::Storage *storage_;
+  rocksdb::ColumnFamilyHandle *cf_handle_;
+  std::string ns_key_;
+  uint64_t version_;
+  bool enabled_;
+  // the delta of the count of each node, by the subkey of the node
+  std::map<std::string, int64_t> deltas_;
+};
+
+}  // namespace redis
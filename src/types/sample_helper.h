@@ -22,9 +22,44 @@
 
 #include <rocksdb/status.h>
 
+#include <algorithm>
+#include <cstdint>
 #include <random>
+#include <string>
+#include <unordered_set>
 #include <vector>
 
+/// The structures with fewer elements than this are always sampled by ExtractRandMemberFromSet.
+constexpr uint64_t kSeekSampleMinSize = 4096;
+/// The number of the neighbouring elements read at each random point by SampleRandMemberBySeek.
+constexpr size_t kSeekSampleRunLength = 4;
+
+/// UseSeekSample returns whether to sample `count` elements from a structure of `size` elements by
+/// SampleRandMemberBySeek. The small structures and the unique samples of a large part of a structure
+/// are sampled exactly, since they read most of the elements anyway.
+inline bool UseSeekSample(bool exact, uint64_t size, bool unique, size_t count) {
+  return !exact && size >= kSeekSampleMinSize && (!unique || count <= size / 4);
+}
+
+/// RandomKeyBetween returns a random key between `first` and `last` in the byte order, which is drawn from
+/// the 8 bytes after the common prefix of them.
+inline std::string RandomKeyBetween(std::mt19937_64 &gen, const std::string &first, const std::string &last) {
+  size_t common = 0;
+  while (common < first.size() && common < last.size() && first[common] == last[common]) common++;
+  // the 8 bytes after the common prefix in big endian, padded with zeros
+  auto load = [common](const std::string &key) {
+    uint64_t value = 0;
+    for (size_t i = common; i < common + 8; i++) {
+      value = value << 8 | (i < key.size() ? static_cast<uint8_t>(key[i]) : 0);
+    }
+    return value;
+  };
+  uint64_t value = std::uniform_int_distribution<uint64_t>(load(first), load(last))(gen);
+  std::string key = first.substr(0, common);
+  for (int shift = 56; shift >= 0; shift -= 8) key.push_back(static_cast<char>(value >> shift));
+  return key;
+}
+
 /// ExtractRandMemberFromSet is a helper function to extract random elements from a kvrocks structure.
 ///
 /// The complexity of the function is O(N) where N is the number of elements inside the structure.
@@ -65,3 +100,36 @@ rocksdb::Status ExtractRandMemberFromSet(bool unique, size_t count, const GetAll
   }
   return rocksdb::Status::OK();
 }
+
+/// SampleRandMemberBySeek is a helper function to sample random elements from a large kvrocks structure
+/// without reading all the elements.
+///
+/// `seek_fn(gen, n, &run)` reads at most n neighbouring elements from a random point of the structure, and
+/// about count / kSeekSampleRunLength points are read, so the complexity is O(count) instead of O(N).
+/// The trade-off is the uniformity: the neighbours of a sampled element are more likely to be sampled
+/// together, and the elements after a sparse part of the random points are more likely to be sampled.
+/// The duplicates are dropped by `key_fn` for the unique samples, so fewer than `count` elements may be
+/// returned after too many duplicates, and the caller should fall back to ExtractRandMemberFromSet.
+template <typename ElementType, typename SeekFnType, typename KeyFnType>
+rocksdb::Status SampleRandMemberBySeek(bool unique, size_t count, const SeekFnType &seek_fn, const KeyFnType &key_fn,
+                                       std::vector<ElementType> *elements) {
+  elements->clear();
+  elements->reserve(count);
+  std::mt19937_64 gen(std::random_device{}());
+  std::unordered_set<std::string> sampled;
+  size_t max_seeks = 4 * (count / kSeekSampleRunLength + 1) + 16;
+  for (size_t seeks = 0; elements->size() < count && seeks < max_seeks; seeks++) {
+    std::vector<ElementType> run;
+    auto s = seek_fn(gen, std::min(kSeekSampleRunLength, count - elements->size()), &run);
+    if (!s.ok()) return s;
+    if (run.empty()) break;
+    for (auto &element : run) {
+      if (unique && !sampled.emplace(key_fn(element)).second) continue;
+      elements->emplace_back(std::move(element));
+      if (elements->size() == count) break;
+    }
+  }
+  // the neighbours are read together, so they're shuffled not to be replied next to each other
+  std::shuffle(elements->begin(), elements->end(), gen);
+  return rocksdb::Status::OK();
+}
@@ -0,0 +1,220 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "timeseries_chunk.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "encoding.h"
+
+namespace {
+
+// the offsets of the fields of the header
+constexpr size_t kLastTimestampOffset = 4 + 8;
+constexpr size_t kStreamBitsOffset = 4 + 8 + 8 + 8 + 8 + 1 + 1;
+
+uint64_t DoubleBits(double value) {
+  uint64_t bits = 0;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+double BitsDouble(uint64_t bits) {
+  double value = 0;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+int64_t SignExtend(uint64_t value, uint32_t bits) {
+  return static_cast<int64_t>(value << (64 - bits)) >> (64 - bits);
+}
+
+}  // namespace
+
+bool TSChunk::Load(const rocksdb::Slice &bytes) {
+  if (bytes.size() < kHeaderSize) return false;
+
+  rocksdb::Slice input(bytes);
+  uint64_t last_delta = 0;
+  GetFixed32(&input, &count_);
+  GetFixed64(&input, &first_ts_);
+  GetFixed64(&input, &last_ts_);
+  GetFixed64(&input, &last_delta);
+  GetFixed64(&input, &last_value_);
+  GetFixed8(&input, &leading_);
+  GetFixed8(&input, &trailing_);
+  GetFixed32(&input, &stream_bits_);
+  last_delta_ = static_cast<int64_t>(last_delta);
+
+  if (input.size() != (static_cast<size_t>(stream_bits_) + 7) / 8) return false;
+  if ((count_ == 0) != (stream_bits_ == 0)) return false;
+  stream_.assign(input.data(), input.size());
+  return true;
+}
+
+std::string TSChunk::Encode() const {
+  std::string dst;
+  dst.reserve(kHeaderSize + stream_.size());
+  PutFixed32(&dst, count_);
+  PutFixed64(&dst, first_ts_);
+  PutFixed64(&dst, last_ts_);
+  PutFixed64(&dst, static_cast<uint64_t>(last_delta_));
+  PutFixed64(&dst, last_value_);
+  PutFixed8(&dst, leading_);
+  PutFixed8(&dst, trailing_);
+  PutFixed32(&dst, stream_bits_);
+  dst.append(stream_);
+  return dst;
+}
+
+double TSChunk::LastValue() const { return BitsDouble(last_value_); }
+
+bool TSChunk::PeekLastTimestamp(const rocksdb::Slice &bytes, uint64_t *ts) {
+  if (bytes.size() < kHeaderSize) return false;
+  *ts = DecodeFixed64(bytes.data() + kLastTimestampOffset);
+  return true;
+}
+
+void TSChunk::writeBits(uint64_t value, uint32_t bits) {
+  while (bits > 0) {
+    uint32_t offset = stream_bits_ % 8;
+    if (offset == 0) stream_.push_back(0);
+    uint32_t room = 8 - offset;
+    uint32_t n = std::min(room, bits);
+    auto piece = static_cast<uint8_t>((value >> (bits - n)) & ((1U << n) - 1));
+    stream_.back() = static_cast<char>(static_cast<uint8_t>(stream_.back()) | (piece << (room - n)));
+    bits -= n;
+    stream_bits_ += n;
+  }
+}
+
+void TSChunk::Append(uint64_t ts, double value) {
+  uint64_t value_bits = DoubleBits(value);
+  if (count_ == 0) {
+    first_ts_ = ts;
+    writeBits(ts, 64);
+    writeBits(value_bits, 64);
+  } else {
+    // the delta-of-delta of regular samples is 0 and takes one bit
+    auto delta = static_cast<int64_t>(ts - last_ts_);
+    int64_t dod = delta - last_delta_;
+    if (dod == 0) {
+      writeBits(0b0, 1);
+    } else if (dod >= -64 && dod <= 63) {
+      writeBits(0b10, 2);
+      writeBits(static_cast<uint64_t>(dod), 7);
+    } else if (dod >= -256 && dod <= 255) {
+      writeBits(0b110, 3);
+      writeBits(static_cast<uint64_t>(dod), 9);
+    } else if (dod >= -2048 && dod <= 2047) {
+      writeBits(0b1110, 4);
+      writeBits(static_cast<uint64_t>(dod), 12);
+    } else {
+      writeBits(0b1111, 4);
+      writeBits(static_cast<uint64_t>(dod), 64);
+    }
+    last_delta_ = delta;
+
+    // only the meaningful bits of the XOR are written, in the window of the previous XOR if they fit in it
+    uint64_t xor_bits = value_bits ^ last_value_;
+    if (xor_bits == 0) {
+      writeBits(0b0, 1);
+    } else {
+      auto leading = static_cast<uint8_t>(__builtin_clzll(xor_bits));
+      auto trailing = static_cast<uint8_t>(__builtin_ctzll(xor_bits));
+      if (leading_ != UINT8_MAX && leading >= leading_ && trailing >= trailing_) {
+        writeBits(0b10, 2);
+        writeBits(xor_bits >> trailing_, 64 - leading_ - trailing_);
+      } else {
+        leading_ = leading;
+        trailing_ = trailing;
+        uint32_t meaningful = 64 - leading - trailing;
+        writeBits(0b11, 2);
+        writeBits(leading, 6);
+        writeBits(meaningful - 1, 6);
+        writeBits(xor_bits >> trailing, meaningful);
+      }
+    }
+  }
+  last_ts_ = ts;
+  last_value_ = value_bits;
+  count_++;
+}
+
+TSChunkIterator::TSChunkIterator(const rocksdb::Slice &bytes)
+    : stream_(bytes.data() + TSChunk::kHeaderSize, bytes.size() - TSChunk::kHeaderSize),
+      count_(DecodeFixed32(bytes.data())),
+      stream_bits_(DecodeFixed32(bytes.data() + kStreamBitsOffset)) {}
+
+uint64_t TSChunkIterator::readBits(uint32_t bits) {
+  uint64_t value = 0;
+  while (bits > 0) {
+    uint32_t offset = bit_offset_ % 8;
+    uint32_t room = 8 - offset;
+    uint32_t n = std::min(room, bits);
+    size_t byte_index = bit_offset_ / 8;
+    auto byte = byte_index < stream_.size() ? static_cast<uint8_t>(stream_[byte_index]) : 0;
+    value = (value << n) | ((byte >> (room - n)) & ((1U << n) - 1));
+    bits -= n;
+    bit_offset_ += n;
+  }
+  return value;
+}
+
+bool TSChunkIterator::Next(TSSample *sample) {
+  if (index_ >= count_) return false;
+
+  if (index_ == 0) {
+    ts_ = readBits(64);
+    value_ = readBits(64);
+  } else {
+    int64_t dod = 0;
+    if (readBits(1) == 0) {
+      dod = 0;
+    } else if (readBits(1) == 0) {
+      dod = SignExtend(readBits(7), 7);
+    } else if (readBits(1) == 0) {
+      dod = SignExtend(readBits(9), 9);
+    } else if (readBits(1) == 0) {
+      dod = SignExtend(readBits(12), 12);
+    } else {
+      dod = static_cast<int64_t>(readBits(64));
+    }
+    delta_ += dod;
+    ts_ += static_cast<uint64_t>(delta_);
+
+    if (readBits(1) != 0) {
+      if (readBits(1) != 0) {
+        leading_ = static_cast<uint8_t>(readBits(6));
+        auto meaningful = static_cast<uint32_t>(readBits(6)) + 1;
+        trailing_ = static_cast<uint8_t>(64 - leading_ - meaningful);
+      }
+      value_ ^= readBits(64 - leading_ - trailing_) << trailing_;
+    }
+  }
+  // a corrupted stream ends before all the samples are decoded
+  if (bit_offset_ > stream_bits_) return false;
+
+  index_++;
+  sample->ts = ts_;
+  sample->value = BitsDouble(value_);
+  return true;
+}
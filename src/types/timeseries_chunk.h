@@ -0,0 +1,102 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <rocksdb/slice.h>
+
+#include <cstdint>
+#include <string>
+
+struct TSSample {
+  uint64_t ts;
+  double value;
+
+  bool operator==(const TSSample &other) const { return ts == other.ts && value == other.value; }
+};
+
+/// A chunk of samples compressed like Gorilla: the timestamps are encoded by their delta-of-delta
+/// and the values by their XOR with the previous value. The header keeps the state of the encoder,
+/// so a sample is appended without decoding the chunk.
+///
+/// The header is, in order:
+///   count (fixed32), first timestamp (fixed64), last timestamp (fixed64), last delta (fixed64),
+///   last value (fixed64 bits of the double), leading and trailing zeros of the last XOR window (fixed8 each),
+///   the number of bits of the stream (fixed32),
+/// and the bit stream follows it.
+class TSChunk {
+ public:
+  static constexpr size_t kHeaderSize = 4 + 8 + 8 + 8 + 8 + 1 + 1 + 4;
+
+  TSChunk() = default;
+
+  /// Load an encoded chunk, return false if it's corrupted.
+  bool Load(const rocksdb::Slice &bytes);
+  /// Append a sample newer than the last one of the chunk.
+  void Append(uint64_t ts, double value);
+  std::string Encode() const;
+
+  uint32_t Count() const { return count_; }
+  uint64_t FirstTimestamp() const { return first_ts_; }
+  uint64_t LastTimestamp() const { return last_ts_; }
+  double LastValue() const;
+  /// The number of bytes of the compressed samples, without the header
+  size_t DataSize() const { return stream_.size(); }
+
+  /// The last timestamp of an encoded chunk, without loading it.
+  static bool PeekLastTimestamp(const rocksdb::Slice &bytes, uint64_t *ts);
+
+ private:
+  void writeBits(uint64_t value, uint32_t bits);
+
+  uint32_t count_ = 0;
+  uint64_t first_ts_ = 0;
+  uint64_t last_ts_ = 0;
+  int64_t last_delta_ = 0;
+  uint64_t last_value_ = 0;
+  // there is no XOR window before the first XOR with meaningful bits
+  uint8_t leading_ = UINT8_MAX;
+  uint8_t trailing_ = 0;
+  uint32_t stream_bits_ = 0;
+  std::string stream_;
+};
+
+/// Decode the samples of an encoded chunk in order, without materializing them.
+class TSChunkIterator {
+ public:
+  /// The chunk must be loaded by TSChunk::Load successfully once.
+  explicit TSChunkIterator(const rocksdb::Slice &bytes);
+
+  bool Next(TSSample *sample);
+
+ private:
+  uint64_t readBits(uint32_t bits);
+
+  rocksdb::Slice stream_;
+  uint32_t count_ = 0;
+  uint32_t index_ = 0;
+  uint32_t stream_bits_ = 0;
+  uint64_t bit_offset_ = 0;
+  uint64_t ts_ = 0;
+  int64_t delta_ = 0;
+  uint64_t value_ = 0;
+  uint8_t leading_ = 0;
+  uint8_t trailing_ = 0;
+};
@@ -0,0 +1,111 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+#include "encoding.h"
+#include "storage/redis_metadata.h"
+
+namespace {
+
+void BM_InternalKeyEncode(benchmark::State &state) {
+  std::string ns_key = ComposeNamespaceKey("__namespace", "user:profile:0001", false);
+  std::string sub_key(static_cast<size_t>(state.range(0)), 'f');
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(InternalKey(ns_key, sub_key, 1, false).Encode());
+  }
+}
+BENCHMARK(BM_InternalKeyEncode)->Arg(8)->Arg(128);
+
+void BM_InternalKeyDecode(benchmark::State &state) {
+  std::string ns_key = ComposeNamespaceKey("__namespace", "user:profile:0001", false);
+  std::string encoded = InternalKey(ns_key, "field", 1, false).Encode();
+  for (auto _ : state) {
+    InternalKey key(encoded, false);
+    benchmark::DoNotOptimize(key.GetSubKey());
+  }
+}
+BENCHMARK(BM_InternalKeyDecode);
+
+void BM_MetadataDecode(benchmark::State &state) {
+  HashMetadata metadata;
+  metadata.size = 1000;
+  metadata.expire = 0;
+  std::string encoded;
+  metadata.Encode(&encoded);
+
+  for (auto _ : state) {
+    HashMetadata decoded(false);
+    auto s = decoded.Decode(encoded);
+    benchmark::DoNotOptimize(s);
+    benchmark::DoNotOptimize(decoded.size);
+  }
+}
+BENCHMARK(BM_MetadataDecode);
+
+void BM_PutFixed64(benchmark::State &state) {
+  std::string dst;
+  uint64_t n = 0;
+  for (auto _ : state) {
+    dst.clear();
+    PutFixed64(&dst, n++);
+    benchmark::DoNotOptimize(dst.data());
+  }
+}
+BENCHMARK(BM_PutFixed64);
+
+void BM_GetFixed64(benchmark::State &state) {
+  std::string src;
+  PutFixed64(&src, 0x0123456789abcdef);
+  for (auto _ : state) {
+    Slice input(src);
+    uint64_t value = 0;
+    benchmark::DoNotOptimize(GetFixed64(&input, &value));
+    benchmark::DoNotOptimize(value);
+  }
+}
+BENCHMARK(BM_GetFixed64);
+
+void BM_PutVarint32(benchmark::State &state) {
+  std::string dst;
+  auto value = static_cast<uint32_t>(state.range(0));
+  for (auto _ : state) {
+    dst.clear();
+    PutVarint32(&dst, value);
+    benchmark::DoNotOptimize(dst.data());
+  }
+}
+BENCHMARK(BM_PutVarint32)->Arg(100)->Arg(1 << 30);
+
+void BM_GetVarint32(benchmark::State &state) {
+  std::string src;
+  PutVarint32(&src, static_cast<uint32_t>(state.range(0)));
+  for (auto _ : state) {
+    Slice input(src);
+    uint32_t value = 0;
+    benchmark::DoNotOptimize(GetVarint32(&input, &value));
+    benchmark::DoNotOptimize(value);
+  }
+}
+BENCHMARK(BM_GetVarint32)->Arg(100)->Arg(1 << 30);
+
+}  // namespace
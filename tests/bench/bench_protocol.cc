@@ -0,0 +1,136 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "config/config.h"
+#include "event_util.h"
+#include "server/redis_reply.h"
+#include "server/redis_request.h"
+#include "server/server.h"
+#include "storage/storage.h"
+
+namespace {
+
+// The request parser counts the inbound bytes in the stats of the server, so it's given a server
+// which listens on no port and is never started. It lives as long as the benchmark process.
+Server *BenchServer() {
+  static Server *srv = [] {
+    auto dir = std::filesystem::temp_directory_path() / "kvrocks_bench";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    auto conf_path = (dir / "kvrocks.conf").string();
+    std::ofstream(conf_path, std::ios::out) << "";
+
+    auto config = new Config();
+    auto s = config->Load(CLIOptions(conf_path));
+    CHECK(s.IsOK()) << "Failed to load the config: " << s.Msg();
+    config->db_dir = (dir / "db").string();
+    config->port = 0;
+    config->binds.clear();
+    config->workers = 1;
+
+    auto storage = new engine::Storage(config);
+    s = storage->Open();
+    CHECK(s.IsOK()) << "Failed to open the storage: " << s.Msg();
+    return new Server(storage, config);
+  }();
+  return srv;
+}
+
+std::string SetCommand(size_t value_size) {
+  std::string value(value_size, 'v');
+  return "*3\r\n$3\r\nSET\r\n$8\r\nkey:0001\r\n$" + std::to_string(value_size) + "\r\n" + value + "\r\n";
+}
+
+void BM_RequestTokenize(benchmark::State &state) {
+  // a pipeline of 16 commands
+  std::string pipeline;
+  for (int i = 0; i < 16; i++) pipeline += SetCommand(static_cast<size_t>(state.range(0)));
+
+  redis::Request req(BenchServer());
+  UniqueEvbuf input;
+  for (auto _ : state) {
+    evbuffer_add(input.get(), pipeline.data(), pipeline.size());
+    auto s = req.Tokenize(input.get());
+    benchmark::DoNotOptimize(s);
+    req.GetCommands()->clear();
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * pipeline.size()));
+}
+BENCHMARK(BM_RequestTokenize)->Arg(16)->Arg(1024)->Arg(64 * 1024);
+
+void BM_RequestTokenizeInline(benchmark::State &state) {
+  std::string pipeline;
+  for (int i = 0; i < 16; i++) pipeline += "GET key:0001\r\n";
+
+  redis::Request req(BenchServer());
+  UniqueEvbuf input;
+  for (auto _ : state) {
+    evbuffer_add(input.get(), pipeline.data(), pipeline.size());
+    auto s = req.Tokenize(input.get());
+    benchmark::DoNotOptimize(s);
+    req.GetCommands()->clear();
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * pipeline.size()));
+}
+BENCHMARK(BM_RequestTokenizeInline);
+
+void BM_ReplyBulkString(benchmark::State &state) {
+  std::string value(static_cast<size_t>(state.range(0)), 'v');
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(redis::BulkString(value));
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * value.size()));
+}
+BENCHMARK(BM_ReplyBulkString)->Arg(16)->Arg(1024)->Arg(64 * 1024);
+
+void BM_ReplyInteger(benchmark::State &state) {
+  int64_t n = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(redis::Integer(n++));
+  }
+}
+BENCHMARK(BM_ReplyInteger);
+
+void BM_ReplyMultiBulkString(benchmark::State &state) {
+  std::vector<std::string> values(static_cast<size_t>(state.range(0)), std::string(32, 'v'));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(redis::MultiBulkString(redis::RESP::v2, values));
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * values.size()));
+}
+BENCHMARK(BM_ReplyMultiBulkString)->Arg(10)->Arg(1000);
+
+void BM_ReplyArrayOfBulkStrings(benchmark::State &state) {
+  std::vector<std::string> values(static_cast<size_t>(state.range(0)), std::string(32, 'v'));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(redis::ArrayOfBulkStrings(values));
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * values.size()));
+}
+BENCHMARK(BM_ReplyArrayOfBulkStrings)->Arg(10)->Arg(1000);
+
+}  // namespace
@@ -0,0 +1,114 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "search/hnsw_indexer.h"
+#include "search/search_encoding.h"
+#include "string_util.h"
+#include "types/bloom_filter.h"
+#include "types/geohash.h"
+#include "types/redis_hyperloglog.h"
+
+namespace {
+
+void BM_StringMatch(benchmark::State &state) {
+  std::string key = "user:profile:00012345:settings";
+  std::vector<std::string> patterns = {"user:*", "*:settings", "user:profile:0001????:*", "user:[a-p]*:*:s*"};
+  const auto &pattern = patterns[state.range(0)];
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(util::StringMatch(pattern, key, 0));
+  }
+}
+BENCHMARK(BM_StringMatch)->DenseRange(0, 3);
+
+void BM_GeohashEncode(benchmark::State &state) {
+  double longitude = -180, latitude = -85;
+  for (auto _ : state) {
+    GeoHashBits hash;
+    benchmark::DoNotOptimize(GeohashEncodeWGS84(longitude, latitude, GEO_STEP_MAX, &hash));
+    benchmark::DoNotOptimize(hash.bits);
+    longitude = longitude >= 180 ? -180 : longitude + 0.001;
+    latitude = latitude >= 85 ? -85 : latitude + 0.001;
+  }
+}
+BENCHMARK(BM_GeohashEncode);
+
+void BM_HllHash(benchmark::State &state) {
+  std::string element(static_cast<size_t>(state.range(0)), 'e');
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(redis::HyperLogLog::HllHash(element));
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * element.size()));
+}
+BENCHMARK(BM_HllHash)->Arg(16)->Arg(256);
+
+void BM_BloomFilterProbe(benchmark::State &state) {
+  auto [filter, bitset] = CreateBlockSplitBloomFilter(1024 * 1024);
+  for (int i = 0; i < 100000; i++) {
+    auto item = "item:" + std::to_string(i);
+    filter.InsertHash(BlockSplitBloomFilter::Hash(item.data(), item.size()));
+  }
+
+  // the half of the probes hit the filter
+  std::vector<std::string> items;
+  for (int i = 0; i < 1024; i++) items.emplace_back("item:" + std::to_string(i * 200));
+  size_t i = 0;
+  for (auto _ : state) {
+    const auto &item = items[i++ % items.size()];
+    benchmark::DoNotOptimize(filter.FindHash(BlockSplitBloomFilter::Hash(item.data(), item.size())));
+  }
+}
+BENCHMARK(BM_BloomFilterProbe);
+
+void BM_HnswComputeSimilarity(benchmark::State &state) {
+  redis::HnswVectorFieldMetadata metadata;
+  metadata.vector_type = redis::VectorType::FLOAT64;
+  metadata.dim = static_cast<uint16_t>(state.range(0));
+  metadata.distance_metric = static_cast<redis::DistanceMetric>(state.range(1));
+
+  kqir::NumericArray left, right;
+  for (uint16_t i = 0; i < metadata.dim; i++) {
+    left.push_back(std::sin(i));
+    right.push_back(std::cos(i));
+  }
+  redis::VectorItem left_item, right_item;
+  auto s = redis::VectorItem::Create("left", left, &metadata, &left_item);
+  if (s) s = redis::VectorItem::Create("right", right, &metadata, &right_item);
+  if (!s) {
+    state.SkipWithError(s.Msg());
+    return;
+  }
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(redis::ComputeSimilarity(left_item, right_item));
+  }
+}
+BENCHMARK(BM_HnswComputeSimilarity)
+    ->ArgNames({"dim", "metric"})
+    ->ArgsProduct({{128, 768}, {static_cast<int64_t>(redis::DistanceMetric::L2),
+                                static_cast<int64_t>(redis::DistanceMetric::IP),
+                                static_cast<int64_t>(redis::DistanceMetric::COSINE)}});
+
+}  // namespace
@@ -0,0 +1,421 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+// kvrocks_storage_bench drives the data types on an engine::Storage directly, so the numbers
+// are not mixed with the network and the protocol costs of redis-benchmark.
+//
+// Every type is loaded once, and then each combination of the distributions and the read ratios
+// runs as a scenario of --ops operations over --threads threads. A scenario reports the throughput,
+// the latency percentiles, and the deltas of the RocksDB statistics while it runs.
+
+#include <fmt/format.h>
+#include <glog/logging.h>
+#include <rocksdb/statistics.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <random>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "config/config.h"
+#include "latency_histogram.h"
+#include "parse_util.h"
+#include "server/server.h"
+#include "storage/storage.h"
+#include "string_util.h"
+#include "workload.h"
+
+Server *GetServer() { return nullptr; }
+
+namespace {
+
+struct BenchOptions {
+  std::string conf_file;
+  std::string dir = (std::filesystem::temp_directory_path() / "kvrocks_storage_bench").string();
+  std::vector<std::string> types{std::begin(bench::kScenarioTypes), std::end(bench::kScenarioTypes)};
+  std::vector<bench::Distribution> distributions{bench::Distribution::kUniform, bench::Distribution::kZipfian};
+  std::vector<double> read_ratios{1, 0.9, 0.5};
+  uint64_t keys = 10000;
+  uint64_t elements = 100;
+  size_t value_size = 64;
+  uint64_t ops = 1000000;
+  int threads = 4;
+  double zipf_theta = 0.99;
+  bool skip_load = false;
+  bool json = false;
+};
+
+// The tickers whose deltas are reported for every scenario
+constexpr std::pair<const char *, rocksdb::Tickers> kTickers[] = {
+    {"block_cache_hit", rocksdb::Tickers::BLOCK_CACHE_HIT},
+    {"block_cache_miss", rocksdb::Tickers::BLOCK_CACHE_MISS},
+    {"bytes_read", rocksdb::Tickers::BYTES_READ},
+    {"bytes_written", rocksdb::Tickers::BYTES_WRITTEN},
+    {"file_bytes_read", rocksdb::Tickers::NON_LAST_LEVEL_READ_BYTES},
+    {"last_level_bytes_read", rocksdb::Tickers::LAST_LEVEL_READ_BYTES},
+    {"wal_bytes", rocksdb::Tickers::WAL_FILE_BYTES},
+    {"flush_write_bytes", rocksdb::Tickers::FLUSH_WRITE_BYTES},
+    {"compact_write_bytes", rocksdb::Tickers::COMPACT_WRITE_BYTES},
+};
+constexpr size_t kNumTickers = std::size(kTickers);
+
+using TickerValues = std::array<uint64_t, kNumTickers>;
+
+TickerValues GetTickers(engine::Storage *storage) {
+  TickerValues values{};
+  auto stats = storage->GetDB()->GetDBOptions().statistics;
+  if (!stats) return values;
+  for (size_t i = 0; i < kNumTickers; i++) values[i] = stats->getTickerCount(kTickers[i].second);
+  return values;
+}
+
+struct ScenarioResult {
+  std::string type;
+  bench::Distribution distribution = bench::Distribution::kUniform;
+  double read_ratio = 0;
+  uint64_t ops = 0;
+  uint64_t errors = 0;
+  double seconds = 0;
+  LatencyHistogram::Snapshot latencies;
+  TickerValues tickers;
+};
+
+void PrintUsage(const char *program) {
+  std::cout << program << " benchmarks the data types on the storage engine without the network" << std::endl
+            << "Usage:" << std::endl
+            << "  -c, --config <filename>      load the storage options from the config file" << std::endl
+            << "  --dir <path>                 the directory of the database, default to the temp directory"
+            << std::endl
+            << "  --types <t1,t2,...>          the types of string, hash, zset, list, set, stream, bitmap and json"
+            << std::endl
+            << "  --distributions <d1,d2,...>  the distributions of uniform and zipfian to pick the keys"
+            << std::endl
+            << "  --read-ratios <r1,r2,...>    the ratios of the reads in the operations, e.g. 1,0.9,0.5"
+            << std::endl
+            << "  --keys <n>                   the number of keys of each type" << std::endl
+            << "  --elements <n>               the number of elements of each key" << std::endl
+            << "  --value-size <n>             the size of the values of the elements" << std::endl
+            << "  --ops <n>                    the number of operations of each scenario" << std::endl
+            << "  --threads <n>                the number of threads to run the operations" << std::endl
+            << "  --zipf-theta <theta>         the skew of the zipfian distribution, in (0, 1)" << std::endl
+            << "  --skip-load                  reuse the keys loaded in the directory before" << std::endl
+            << "  --json                       print the results in JSON" << std::endl
+            << "  -h, --help                   print this help message" << std::endl;
+}
+
+template <typename T>
+T ParseNumber(std::string_view name, const char *value) {
+  auto result = [value]() -> StatusOr<T> {
+    if constexpr (std::is_floating_point_v<T>) {
+      return ParseFloat<T>(value);
+    } else {
+      return ParseInt<T>(value, NumericRange<T>{1, std::numeric_limits<T>::max()});
+    }
+  }();
+  if (!result) {
+    std::cerr << "Invalid value of --" << name << ": " << result.Msg() << std::endl;
+    std::exit(1);
+  }
+  return *result;
+}
+
+BenchOptions ParseBenchOptions(int argc, char **argv) {
+  using namespace std::string_view_literals;
+  BenchOptions opts;
+
+  for (int i = 1; i < argc; i++) {
+    std::string_view arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if ((arg == "-c"sv || arg == "--config"sv) && has_value) {
+      opts.conf_file = argv[++i];
+    } else if (arg == "--dir"sv && has_value) {
+      opts.dir = argv[++i];
+    } else if (arg == "--types"sv && has_value) {
+      opts.types = util::Split(argv[++i], ",");
+    } else if (arg == "--distributions"sv && has_value) {
+      opts.distributions.clear();
+      for (const auto &name : util::Split(argv[++i], ",")) {
+        if (util::EqualICase(name, "uniform")) {
+          opts.distributions.push_back(bench::Distribution::kUniform);
+        } else if (util::EqualICase(name, "zipfian")) {
+          opts.distributions.push_back(bench::Distribution::kZipfian);
+        } else {
+          std::cerr << "Unknown distribution: " << name << std::endl;
+          std::exit(1);
+        }
+      }
+    } else if (arg == "--read-ratios"sv && has_value) {
+      opts.read_ratios.clear();
+      for (const auto &ratio : util::Split(argv[++i], ",")) {
+        auto value = ParseNumber<double>("read-ratios", ratio.c_str());
+        if (value < 0 || value > 1) {
+          std::cerr << "The read ratio should be in [0, 1]: " << ratio << std::endl;
+          std::exit(1);
+        }
+        opts.read_ratios.push_back(value);
+      }
+    } else if (arg == "--keys"sv && has_value) {
+      opts.keys = ParseNumber<uint64_t>("keys", argv[++i]);
+    } else if (arg == "--elements"sv && has_value) {
+      opts.elements = ParseNumber<uint64_t>("elements", argv[++i]);
+    } else if (arg == "--value-size"sv && has_value) {
+      opts.value_size = ParseNumber<size_t>("value-size", argv[++i]);
+    } else if (arg == "--ops"sv && has_value) {
+      opts.ops = ParseNumber<uint64_t>("ops", argv[++i]);
+    } else if (arg == "--threads"sv && has_value) {
+      opts.threads = ParseNumber<int>("threads", argv[++i]);
+    } else if (arg == "--zipf-theta"sv && has_value) {
+      opts.zipf_theta = ParseNumber<double>("zipf-theta", argv[++i]);
+      if (opts.zipf_theta <= 0 || opts.zipf_theta >= 1) {
+        std::cerr << "The zipfian theta should be in (0, 1)" << std::endl;
+        std::exit(1);
+      }
+    } else if (arg == "--skip-load"sv) {
+      opts.skip_load = true;
+    } else if (arg == "--json"sv) {
+      opts.json = true;
+    } else if (arg == "-h"sv || arg == "--help"sv) {
+      PrintUsage(*argv);
+      std::exit(0);
+    } else {
+      PrintUsage(*argv);
+      std::exit(1);
+    }
+  }
+
+  return opts;
+}
+
+// RunThreads runs fn(thread_index) in every thread and waits them to finish
+template <typename F>
+void RunThreads(int threads, F &&fn) {
+  std::vector<std::thread> workers;
+  for (int i = 0; i < threads; i++) workers.emplace_back(fn, i);
+  for (auto &worker : workers) worker.join();
+}
+
+Status LoadScenario(engine::Storage *storage, bench::Scenario *scenario, const BenchOptions &opts) {
+  std::atomic<uint64_t> next_key = 0;
+  std::atomic<bool> failed = false;
+  std::string error;
+  std::mutex error_mu;
+
+  RunThreads(opts.threads, [&](int) {
+    auto ctx = engine::Context::NoTransactionContext(storage);
+    for (auto i = next_key++; i < opts.keys && !failed; i = next_key++) {
+      auto s = scenario->Load(ctx, scenario->Key(i));
+      if (!s.ok()) {
+        std::lock_guard<std::mutex> guard(error_mu);
+        failed = true;
+        error = s.ToString();
+      }
+    }
+  });
+  if (failed) return {Status::NotOK, fmt::format("failed to load the {} keys: {}", scenario->GetType(), error)};
+  return Status::OK();
+}
+
+ScenarioResult RunScenario(engine::Storage *storage, bench::Scenario *scenario, bench::Distribution distribution,
+                           double read_ratio, const BenchOptions &opts) {
+  bench::KeyChooser key_chooser(distribution, opts.keys, opts.zipf_theta);
+  bench::KeyChooser element_chooser(distribution, opts.elements, opts.zipf_theta);
+  LatencyHistogram latencies;
+  std::atomic<uint64_t> errors = 0;
+
+  auto tickers_before = GetTickers(storage);
+  auto start = std::chrono::steady_clock::now();
+  RunThreads(opts.threads, [&](int index) {
+    std::mt19937_64 rng(index + 1);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    auto ops = opts.ops / opts.threads + (static_cast<uint64_t>(index) < opts.ops % opts.threads ? 1 : 0);
+
+    for (uint64_t i = 0; i < ops; i++) {
+      auto key = scenario->Key(key_chooser.Next(uniform(rng)));
+      auto element = element_chooser.Next(uniform(rng));
+      bool is_read = uniform(rng) < read_ratio;
+
+      auto op_start = std::chrono::steady_clock::now();
+      auto ctx = engine::Context::NoTransactionContext(storage);
+      auto s = is_read ? scenario->Read(ctx, key, element) : scenario->Write(ctx, key, element);
+      auto op_end = std::chrono::steady_clock::now();
+      // the latencies are recorded in nanoseconds
+      latencies.Record(static_cast<uint64_t>((op_end - op_start) / std::chrono::nanoseconds(1)));
+      if (!s.ok() && !s.IsNotFound()) errors++;
+    }
+  });
+  auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  // flush the memtables, so the write amplification includes the data written in the scenario
+  rocksdb::FlushOptions flush_options;
+  flush_options.wait = true;
+  std::vector<rocksdb::ColumnFamilyHandle *> cf_handles;
+  for (const auto &cf : engine::ColumnFamilyConfigs::ListAllColumnFamilies()) {
+    cf_handles.push_back(storage->GetCFHandle(cf.Id()));
+  }
+  if (auto s = storage->GetDB()->Flush(flush_options, cf_handles); !s.ok()) {
+    LOG(WARNING) << "Failed to flush the memtables: " << s.ToString();
+  }
+
+  auto tickers_after = GetTickers(storage);
+  TickerValues deltas{};
+  for (size_t i = 0; i < kNumTickers; i++) deltas[i] = tickers_after[i] - tickers_before[i];
+
+  ScenarioResult result;
+  result.type = scenario->GetType();
+  result.distribution = distribution;
+  result.read_ratio = read_ratio;
+  result.ops = opts.ops;
+  result.errors = errors;
+  result.seconds = seconds;
+  result.latencies = latencies.GetSnapshot();
+  result.tickers = deltas;
+  return result;
+}
+
+uint64_t TickerValue(const TickerValues &tickers, rocksdb::Tickers ticker) {
+  for (size_t i = 0; i < kNumTickers; i++) {
+    if (kTickers[i].second == ticker) return tickers[i];
+  }
+  return 0;
+}
+
+// WriteAmplification is the bytes written to the WAL and the SST files per byte written by the user
+double WriteAmplification(const TickerValues &tickers) {
+  auto user_bytes = TickerValue(tickers, rocksdb::Tickers::BYTES_WRITTEN);
+  if (user_bytes == 0) return 0;
+  auto bytes = TickerValue(tickers, rocksdb::Tickers::WAL_FILE_BYTES) +
+               TickerValue(tickers, rocksdb::Tickers::FLUSH_WRITE_BYTES) +
+               TickerValue(tickers, rocksdb::Tickers::COMPACT_WRITE_BYTES);
+  return static_cast<double>(bytes) / static_cast<double>(user_bytes);
+}
+
+void PrintResult(const ScenarioResult &result, bool json, bool last) {
+  auto distribution = result.distribution == bench::Distribution::kUniform ? "uniform" : "zipfian";
+  double throughput = result.seconds > 0 ? static_cast<double>(result.ops) / result.seconds : 0;
+  constexpr double percentiles[] = {50, 90, 99, 99.9, 100};
+
+  if (json) {
+    std::string out = fmt::format(
+        R"(  {{"type": "{}", "distribution": "{}", "read_ratio": {}, "ops": {}, "errors": {}, "seconds": {:.3f}, )"
+        R"("ops_per_sec": {:.1f}, "latency_us": {{)",
+        result.type, distribution, result.read_ratio, result.ops, result.errors, result.seconds, throughput);
+    for (size_t i = 0; i < std::size(percentiles); i++) {
+      out += fmt::format(R"({}"p{}": {:.3f})", i > 0 ? ", " : "", percentiles[i],
+                         static_cast<double>(result.latencies.Percentile(percentiles[i])) / 1000);
+    }
+    out += R"(}, "rocksdb": {)";
+    for (size_t i = 0; i < kNumTickers; i++) {
+      out += fmt::format(R"({}"{}": {})", i > 0 ? ", " : "", kTickers[i].first, result.tickers[i]);
+    }
+    out += fmt::format(R"(, "write_amplification": {:.2f}}}}}{})", WriteAmplification(result.tickers),
+                       last ? "" : ",");
+    std::cout << out << std::endl;
+    return;
+  }
+
+  std::cout << fmt::format("{} {} read_ratio={}: {:.1f} ops/sec, {} errors in {:.3f} seconds", result.type,
+                           distribution, result.read_ratio, throughput, result.errors, result.seconds)
+            << std::endl;
+  std::cout << "  latency(us):";
+  for (auto p : percentiles) {
+    std::cout << fmt::format(" p{}={:.3f}", p, static_cast<double>(result.latencies.Percentile(p)) / 1000);
+  }
+  std::cout << std::endl << "  rocksdb:";
+  for (size_t i = 0; i < kNumTickers; i++) std::cout << " " << kTickers[i].first << "=" << result.tickers[i];
+  std::cout << fmt::format(" write_amplification={:.2f}", WriteAmplification(result.tickers)) << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_logtostderr = true;
+  FLAGS_minloglevel = google::WARNING;
+
+  auto opts = ParseBenchOptions(argc, argv);
+  for (const auto &type : opts.types) {
+    if (std::find(std::begin(bench::kScenarioTypes), std::end(bench::kScenarioTypes), type) ==
+        std::end(bench::kScenarioTypes)) {
+      std::cerr << "Unknown type: " << type << std::endl;
+      return 1;
+    }
+  }
+
+  if (!opts.skip_load) std::filesystem::remove_all(opts.dir);
+  std::filesystem::create_directories(opts.dir);
+  auto conf_file = opts.conf_file;
+  if (conf_file.empty()) {
+    conf_file = opts.dir + "/kvrocks.conf";
+    std::ofstream(conf_file, std::ios::out) << "";
+  }
+  Config config;
+  if (auto s = config.Load(CLIOptions(conf_file)); !s) {
+    std::cerr << "Failed to load the config: " << s.Msg() << std::endl;
+    return 1;
+  }
+  config.db_dir = opts.dir + "/db";
+
+  engine::Storage storage(&config);
+  if (auto s = storage.Open(); !s) {
+    std::cerr << "Failed to open the storage: " << s.Msg() << std::endl;
+    return 1;
+  }
+
+  std::vector<std::unique_ptr<bench::Scenario>> scenarios;
+  for (const auto &type : opts.types) {
+    scenarios.emplace_back(bench::CreateScenario(type, &storage, opts.elements, opts.value_size));
+  }
+
+  size_t total = scenarios.size() * opts.distributions.size() * opts.read_ratios.size();
+  size_t done = 0;
+  if (opts.json) std::cout << "[" << std::endl;
+  for (const auto &scenario : scenarios) {
+    if (!opts.skip_load) {
+      auto start = std::chrono::steady_clock::now();
+      if (auto s = LoadScenario(&storage, scenario.get(), opts); !s) {
+        std::cerr << s.Msg() << std::endl;
+        return 1;
+      }
+      auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      std::cerr << fmt::format("Loaded {} {} keys of {} elements in {:.3f} seconds", opts.keys, scenario->GetType(),
+                               opts.elements, seconds)
+                << std::endl;
+    }
+
+    for (auto distribution : opts.distributions) {
+      for (auto read_ratio : opts.read_ratios) {
+        auto result = RunScenario(&storage, scenario.get(), distribution, read_ratio, opts);
+        PrintResult(result, opts.json, ++done == total);
+      }
+    }
+  }
+  if (opts.json) std::cout << "]" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,344 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "workload.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "config/config.h"
+#include "types/redis_bitmap.h"
+#include "types/redis_hash.h"
+#include "types/redis_json.h"
+#include "types/redis_list.h"
+#include "types/redis_set.h"
+#include "types/redis_stream.h"
+#include "types/redis_string.h"
+#include "types/redis_zset.h"
+
+namespace bench {
+
+namespace {
+
+// The elements are written to a key by batches of kLoadBatch elements
+constexpr uint64_t kLoadBatch = 1024;
+
+double Zeta(uint64_t n, double theta) {
+  double sum = 0;
+  for (uint64_t i = 1; i <= n; i++) sum += 1 / std::pow(static_cast<double>(i), theta);
+  return sum;
+}
+
+uint64_t FNVHash64(uint64_t value) {
+  uint64_t hash = 0xcbf29ce484222325;
+  for (int i = 0; i < 8; i++) {
+    hash ^= value & 0xff;
+    hash *= 0x100000001b3;
+    value >>= 8;
+  }
+  return hash;
+}
+
+// The elements of a string don't matter, every operation is a point lookup or a write of the metadata
+// column family, so it compares the memtables of it (rocksdb.metadata_memtable)
+class StringScenario : public Scenario {
+ public:
+  StringScenario(engine::Storage *storage, uint64_t elements, size_t value_size)
+      : Scenario("string", elements, value_size), db_(storage, kDefaultNamespace) {}
+
+  rocksdb::Status Load(engine::Context &ctx, const std::string &key) override { return db_.Set(ctx, key, value_); }
+
+  rocksdb::Status Read(engine::Context &ctx, const std::string &key, uint64_t) override {
+    std::string value;
+    return db_.Get(ctx, key, &value);
+  }
+
+  rocksdb::Status Write(engine::Context &ctx, const std::string &key, uint64_t) override {
+    return db_.Set(ctx, key, value_);
+  }
+
+ private:
+  redis::String db_;
+};
+
+class HashScenario : public Scenario {
+ public:
+  HashScenario(engine::Storage *storage, uint64_t elements, size_t value_size)
+      : Scenario("hash", elements, value_size), db_(storage, kDefaultNamespace) {}
+
+  rocksdb::Status Load(engine::Context &ctx, const std::string &key) override {
+    for (uint64_t i = 0; i < elements_; i += kLoadBatch) {
+      std::vector<FieldValue> field_values;
+      for (uint64_t j = i; j < std::min(i + kLoadBatch, elements_); j++) field_values.emplace_back(Element(j), value_);
+      uint64_t added = 0;
+      auto s = db_.MSet(ctx, key, field_values, false, &added);
+      if (!s.ok()) return s;
+    }
+    return rocksdb::Status::OK();
+  }
+
+  rocksdb::Status Read(engine::Context &ctx, const std::string &key, uint64_t element) override {
+    std::string value;
+    return db_.Get(ctx, key, Element(element), &value);
+  }
+
+  rocksdb::Status Write(engine::Context &ctx, const std::string &key, uint64_t element) override {
+    uint64_t added = 0;
+    return db_.Set(ctx, key, Element(element), value_, &added);
+  }
+
+ private:
+  redis::Hash db_;
+};
+
+class ZSetScenario : public Scenario {
+ public:
+  ZSetScenario(engine::Storage *storage, uint64_t elements, size_t value_size)
+      : Scenario("zset", elements, value_size), db_(storage, kDefaultNamespace) {}
+
+  rocksdb::Status Load(engine::Context &ctx, const std::string &key) override {
+    for (uint64_t i = 0; i < elements_; i += kLoadBatch) {
+      std::vector<MemberScore> member_scores;
+      for (uint64_t j = i; j < std::min(i + kLoadBatch, elements_); j++) {
+        member_scores.push_back({Element(j), static_cast<double>(j)});
+      }
+      uint64_t added = 0;
+      auto s = db_.Add(ctx, key, ZAddFlags::Default(), &member_scores, &added);
+      if (!s.ok()) return s;
+    }
+    return rocksdb::Status::OK();
+  }
+
+  rocksdb::Status Read(engine::Context &ctx, const std::string &key, uint64_t element) override {
+    double score = 0;
+    return db_.Score(ctx, key, Element(element), &score);
+  }
+
+  rocksdb::Status Write(engine::Context &ctx, const std::string &key, uint64_t element) override {
+    double score = 0;
+    return db_.IncrBy(ctx, key, Element(element), 1, &score);
+  }
+
+ private:
+  redis::ZSet db_;
+};
+
+class ListScenario : public Scenario {
+ public:
+  ListScenario(engine::Storage *storage, uint64_t elements, size_t value_size)
+      : Scenario("list", elements, value_size), db_(storage, kDefaultNamespace) {}
+
+  rocksdb::Status Load(engine::Context &ctx, const std::string &key) override {
+    for (uint64_t i = 0; i < elements_; i += kLoadBatch) {
+      std::vector<Slice> elems(std::min(kLoadBatch, elements_ - i), value_);
+      uint64_t size = 0;
+      auto s = db_.Push(ctx, key, elems, false, &size);
+      if (!s.ok()) return s;
+    }
+    return rocksdb::Status::OK();
+  }
+
+  rocksdb::Status Read(engine::Context &ctx, const std::string &key, uint64_t element) override {
+    std::string elem;
+    return db_.Index(ctx, key, static_cast<int>(element), &elem);
+  }
+
+  rocksdb::Status Write(engine::Context &ctx, const std::string &key, uint64_t element) override {
+    return db_.Set(ctx, key, static_cast<int>(element), value_);
+  }
+
+ private:
+  redis::List db_;
+};
+
+class SetScenario : public Scenario {
+ public:
+  SetScenario(engine::Storage *storage, uint64_t elements, size_t value_size)
+      : Scenario("set", elements, value_size), db_(storage, kDefaultNamespace) {}
+
+  rocksdb::Status Load(engine::Context &ctx, const std::string &key) override {
+    for (uint64_t i = 0; i < elements_; i += kLoadBatch) {
+      std::vector<std::string> members;
+      for (uint64_t j = i; j < std::min(i + kLoadBatch, elements_); j++) members.emplace_back(Element(j));
+      uint64_t added = 0;
+      auto s = db_.Add(ctx, key, {members.begin(), members.end()}, &added);
+      if (!s.ok()) return s;
+    }
+    return rocksdb::Status::OK();
+  }
+
+  rocksdb::Status Read(engine::Context &ctx, const std::string &key, uint64_t element) override {
+    bool flag = false;
+    return db_.IsMember(ctx, key, Element(element), &flag);
+  }
+
+  // Adding an existing member writes nothing, so the write removes the member and adds it back by turns
+  rocksdb::Status Write(engine::Context &ctx, const std::string &key, uint64_t element) override {
+    auto member = Element(element);
+    uint64_t count = 0;
+    auto s = db_.Remove(ctx, key, {member}, &count);
+    if (!s.ok() || count > 0) return s;
+    return db_.Add(ctx, key, {member}, &count);
+  }
+
+ private:
+  redis::Set db_;
+};
+
+// The element i of a stream is the entry i+1-0, the writes append new entries
+class StreamScenario : public Scenario {
+ public:
+  StreamScenario(engine::Storage *storage, uint64_t elements, size_t value_size)
+      : Scenario("stream", elements, value_size), db_(storage, kDefaultNamespace) {}
+
+  rocksdb::Status Load(engine::Context &ctx, const std::string &key) override {
+    for (uint64_t i = 0; i < elements_; i++) {
+      redis::StreamAddOptions options;
+      options.next_id_strategy = std::make_unique<redis::FullySpecifiedEntryID>(redis::StreamEntryID{i + 1, 0});
+      redis::StreamEntryID id;
+      auto s = db_.Add(ctx, key, options, {"field", value_}, &id);
+      if (!s.ok()) return s;
+    }
+    return rocksdb::Status::OK();
+  }
+
+  rocksdb::Status Read(engine::Context &ctx, const std::string &key, uint64_t element) override {
+    redis::StreamRangeOptions options;
+    options.start = redis::StreamEntryID{element + 1, 0};
+    options.end = options.start;
+    options.count = 1;
+    options.with_count = true;
+    std::vector<redis::StreamEntry> entries;
+    return db_.Range(ctx, key, options, &entries);
+  }
+
+  rocksdb::Status Write(engine::Context &ctx, const std::string &key, uint64_t) override {
+    redis::StreamAddOptions options;
+    options.next_id_strategy = std::make_unique<redis::AutoGeneratedEntryID>();
+    redis::StreamEntryID id;
+    return db_.Add(ctx, key, options, {"field", value_}, &id);
+  }
+
+ private:
+  redis::Stream db_;
+};
+
+// The elements of a bitmap are its bits, the value size doesn't matter
+class BitmapScenario : public Scenario {
+ public:
+  BitmapScenario(engine::Storage *storage, uint64_t elements, size_t value_size)
+      : Scenario("bitmap", elements, value_size), db_(storage, kDefaultNamespace) {}
+
+  rocksdb::Status Load(engine::Context &ctx, const std::string &key) override {
+    for (uint64_t i = 0; i < elements_; i++) {
+      bool old_bit = false;
+      auto s = db_.SetBit(ctx, key, static_cast<uint32_t>(i), true, &old_bit);
+      if (!s.ok()) return s;
+    }
+    return rocksdb::Status::OK();
+  }
+
+  rocksdb::Status Read(engine::Context &ctx, const std::string &key, uint64_t element) override {
+    bool bit = false;
+    return db_.GetBit(ctx, key, static_cast<uint32_t>(element), &bit);
+  }
+
+  rocksdb::Status Write(engine::Context &ctx, const std::string &key, uint64_t element) override {
+    bool old_bit = false;
+    return db_.SetBit(ctx, key, static_cast<uint32_t>(element), element % 2 == 0, &old_bit);
+  }
+
+ private:
+  redis::Bitmap db_;
+};
+
+// The elements of a JSON value are the fields of its root object
+class JsonScenario : public Scenario {
+ public:
+  JsonScenario(engine::Storage *storage, uint64_t elements, size_t value_size)
+      : Scenario("json", elements, value_size), db_(storage, kDefaultNamespace), json_value_('"' + value_ + '"') {}
+
+  rocksdb::Status Load(engine::Context &ctx, const std::string &key) override {
+    std::string object = "{";
+    for (uint64_t i = 0; i < elements_; i++) {
+      if (i > 0) object += ",";
+      object += "\"f" + std::to_string(i) + "\":" + json_value_;
+    }
+    object += "}";
+    return db_.Set(ctx, key, "$", object);
+  }
+
+  rocksdb::Status Read(engine::Context &ctx, const std::string &key, uint64_t element) override {
+    JsonValue value;
+    return db_.Get(ctx, key, {"$.f" + std::to_string(element)}, &value);
+  }
+
+  rocksdb::Status Write(engine::Context &ctx, const std::string &key, uint64_t element) override {
+    return db_.Set(ctx, key, "$.f" + std::to_string(element), json_value_);
+  }
+
+ private:
+  redis::Json db_;
+  std::string json_value_;
+};
+
+}  // namespace
+
+KeyChooser::KeyChooser(Distribution distribution, uint64_t n, double theta)
+    : distribution_(distribution), n_(std::max<uint64_t>(n, 1)), theta_(theta) {
+  if (distribution_ != Distribution::kZipfian || n_ < 3) return;
+
+  alpha_ = 1 / (1 - theta_);
+  zetan_ = Zeta(n_, theta_);
+  eta_ = (1 - std::pow(2.0 / static_cast<double>(n_), 1 - theta_)) / (1 - Zeta(2, theta_) / zetan_);
+}
+
+uint64_t KeyChooser::Next(double u) const {
+  if (distribution_ != Distribution::kZipfian || n_ < 3) {
+    return std::min(static_cast<uint64_t>(u * static_cast<double>(n_)), n_ - 1);
+  }
+
+  uint64_t rank = 0;
+  double uz = u * zetan_;
+  if (uz < 1) {
+    rank = 0;
+  } else if (uz < 1 + std::pow(0.5, theta_)) {
+    rank = 1;
+  } else {
+    rank = static_cast<uint64_t>(static_cast<double>(n_) * std::pow(eta_ * u - eta_ + 1, alpha_));
+  }
+  return FNVHash64(std::min(rank, n_ - 1)) % n_;
+}
+
+std::unique_ptr<Scenario> CreateScenario(const std::string &type, engine::Storage *storage, uint64_t elements,
+                                         size_t value_size) {
+  if (type == "string") return std::make_unique<StringScenario>(storage, elements, value_size);
+  if (type == "hash") return std::make_unique<HashScenario>(storage, elements, value_size);
+  if (type == "zset") return std::make_unique<ZSetScenario>(storage, elements, value_size);
+  if (type == "list") return std::make_unique<ListScenario>(storage, elements, value_size);
+  if (type == "set") return std::make_unique<SetScenario>(storage, elements, value_size);
+  if (type == "stream") return std::make_unique<StreamScenario>(storage, elements, value_size);
+  if (type == "bitmap") return std::make_unique<BitmapScenario>(storage, elements, value_size);
+  if (type == "json") return std::make_unique<JsonScenario>(storage, elements, value_size);
+  return nullptr;
+}
+
+}  // namespace bench
@@ -0,0 +1,79 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "storage/storage.h"
+
+namespace bench {
+
+enum class Distribution { kUniform, kZipfian };
+
+// KeyChooser picks the indexes in [0, n) of the keys or the elements to access.
+// The zipfian indexes are drawn as in YCSB and then scrambled, so the hot ones are spread over the key space.
+class KeyChooser {
+ public:
+  KeyChooser(Distribution distribution, uint64_t n, double theta = 0.99);
+
+  // Next maps a uniform random number in [0, 1) to an index
+  uint64_t Next(double u) const;
+
+ private:
+  Distribution distribution_;
+  uint64_t n_;
+  double theta_;
+  double alpha_ = 0;
+  double zetan_ = 0;
+  double eta_ = 0;
+};
+
+// Scenario drives the API of one data type, each key is a collection of the given number of elements
+class Scenario {
+ public:
+  Scenario(std::string type, uint64_t elements, size_t value_size)
+      : type_(std::move(type)), elements_(elements), value_(value_size, 'v') {}
+  virtual ~Scenario() = default;
+
+  const std::string &GetType() const { return type_; }
+  std::string Key(uint64_t i) const { return "bench:" + type_ + ":" + std::to_string(i); }
+  static std::string Element(uint64_t i) { return "element:" + std::to_string(i); }
+
+  // Load fills the key with all the elements
+  virtual rocksdb::Status Load(engine::Context &ctx, const std::string &key) = 0;
+  virtual rocksdb::Status Read(engine::Context &ctx, const std::string &key, uint64_t element) = 0;
+  virtual rocksdb::Status Write(engine::Context &ctx, const std::string &key, uint64_t element) = 0;
+
+ protected:
+  std::string type_;
+  uint64_t elements_;
+  std::string value_;
+};
+
+// CreateScenario returns nullptr if the type is unknown, the known types are listed in kScenarioTypes
+std::unique_ptr<Scenario> CreateScenario(const std::string &type, engine::Storage *storage, uint64_t elements,
+                                         size_t value_size);
+
+inline constexpr const char *kScenarioTypes[] = {"string", "hash", "zset", "list", "set", "stream", "bitmap", "json"};
+
+}  // namespace bench
@@ -0,0 +1,489 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+// kvrocks_vector_bench evaluates the parameters of the HNSW indexes by the recall and the latency.
+//
+// The base vectors of a SIFT/GloVe-like dataset in the fvecs format are written to hashes, and each
+// combination of --m and --ef-construction builds an index over them through IndexUpdater. Then the
+// query vectors are searched by the HnswVectorFieldKnnScan executor with each --ef-runtime, and the
+// recall@k against the ground truth, the QPS and the latency percentiles are reported, along with
+// the build time and the index bytes per vector. Without the ground truth file, it's computed by
+// brute force. Without a dataset, random vectors are generated.
+
+#include <fmt/format.h>
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <variant>
+#include <vector>
+
+#include "config/config.h"
+#include "latency_histogram.h"
+#include "parse_util.h"
+#include "search/index_info.h"
+#include "search/indexer.h"
+#include "search/ir_plan.h"
+#include "search/plan_executor.h"
+#include "search/search_encoding.h"
+#include "server/server.h"
+#include "storage/storage.h"
+#include "string_util.h"
+#include "types/redis_hash.h"
+
+Server *GetServer() { return nullptr; }
+
+namespace {
+
+constexpr const char *kNamespace = "vector_bench";
+constexpr const char *kKeyPrefix = "vec:";
+constexpr const char *kField = "v";
+
+using Vectors = std::vector<std::vector<float>>;
+
+struct BenchOptions {
+  std::string dir = (std::filesystem::temp_directory_path() / "kvrocks_vector_bench").string();
+  std::string base_file;
+  std::string query_file;
+  std::string groundtruth_file;
+  size_t base_limit = 0;
+  size_t query_limit = 1000;
+  // the random dataset if no base file is given
+  size_t random_base = 10000;
+  size_t random_query = 100;
+  uint16_t random_dim = 128;
+  uint16_t k = 10;
+  std::vector<uint16_t> m{16};
+  std::vector<uint32_t> ef_construction{200};
+  std::vector<uint32_t> ef_runtime{10, 50, 100, 200};
+  redis::DistanceMetric metric = redis::DistanceMetric::L2;
+  redis::VectorType vector_type = redis::VectorType::FLOAT32;
+  redis::VectorQuantization quantization = redis::VectorQuantization::NONE;
+  int threads = 1;
+  bool json = false;
+};
+
+void PrintUsage(const char *program) {
+  std::cout << program << " benchmarks the recall and the latency of the HNSW vector indexes" << std::endl
+            << "Usage:" << std::endl
+            << "  --base <path.fvecs>             the base vectors, random vectors are used if it's absent" << std::endl
+            << "  --query <path.fvecs>            the query vectors" << std::endl
+            << "  --groundtruth <path.ivecs>      the ids of the nearest base vectors of the queries" << std::endl
+            << "  --base-limit <n>                read the first n base vectors only" << std::endl
+            << "  --query-limit <n>               read the first n query vectors only, default to 1000" << std::endl
+            << "  --random <base>,<query>,<dim>   the size of the random dataset, default to 10000,100,128"
+            << std::endl
+            << "  --k <n>                         the number of the nearest neighbors, default to 10" << std::endl
+            << "  --m <m1,m2,...>                 the max outgoing edges of the nodes, default to 16" << std::endl
+            << "  --ef-construction <e1,e2,...>   the candidates during the construction, default to 200"
+            << std::endl
+            << "  --ef-runtime <e1,e2,...>        the candidates during the search, default to 10,50,100,200"
+            << std::endl
+            << "  --metric <L2|IP|COSINE>         the distance metric, default to L2" << std::endl
+            << "  --type <FLOAT32|FLOAT64>        the type of the stored vectors, default to FLOAT32" << std::endl
+            << "  --quantization <NONE|SQ8>       the quantization of the vectors, default to NONE" << std::endl
+            << "  --threads <n>                   the number of the threads to search, default to 1" << std::endl
+            << "  --dir <path>                    the directory of the database" << std::endl
+            << "  --json                          print the results in JSON" << std::endl
+            << "  -h, --help                      print this help message" << std::endl;
+}
+
+[[noreturn]] void Fail(const std::string &msg) {
+  std::cerr << msg << std::endl;
+  std::exit(1);
+}
+
+template <typename T>
+std::vector<T> ParseList(std::string_view name, const std::string &value) {
+  std::vector<T> list;
+  for (const auto &item : util::Split(value, ",")) {
+    auto n = ParseInt<T>(item, NumericRange<T>{1, std::numeric_limits<T>::max()});
+    if (!n) Fail(fmt::format("Invalid value of --{}: {}", name, n.Msg()));
+    list.push_back(*n);
+  }
+  return list;
+}
+
+BenchOptions ParseBenchOptions(int argc, char **argv) {
+  using namespace std::string_view_literals;
+  BenchOptions opts;
+
+  for (int i = 1; i < argc; i++) {
+    std::string_view arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "--base"sv && has_value) {
+      opts.base_file = argv[++i];
+    } else if (arg == "--query"sv && has_value) {
+      opts.query_file = argv[++i];
+    } else if (arg == "--groundtruth"sv && has_value) {
+      opts.groundtruth_file = argv[++i];
+    } else if (arg == "--base-limit"sv && has_value) {
+      opts.base_limit = ParseList<size_t>("base-limit", argv[++i])[0];
+    } else if (arg == "--query-limit"sv && has_value) {
+      opts.query_limit = ParseList<size_t>("query-limit", argv[++i])[0];
+    } else if (arg == "--random"sv && has_value) {
+      auto sizes = ParseList<size_t>("random", argv[++i]);
+      if (sizes.size() != 3 || sizes[2] > UINT16_MAX) Fail("--random should be <base>,<query>,<dim>");
+      opts.random_base = sizes[0];
+      opts.random_query = sizes[1];
+      opts.random_dim = static_cast<uint16_t>(sizes[2]);
+    } else if (arg == "--k"sv && has_value) {
+      opts.k = ParseList<uint16_t>("k", argv[++i])[0];
+    } else if (arg == "--m"sv && has_value) {
+      opts.m = ParseList<uint16_t>("m", argv[++i]);
+    } else if (arg == "--ef-construction"sv && has_value) {
+      opts.ef_construction = ParseList<uint32_t>("ef-construction", argv[++i]);
+    } else if (arg == "--ef-runtime"sv && has_value) {
+      opts.ef_runtime = ParseList<uint32_t>("ef-runtime", argv[++i]);
+    } else if (arg == "--metric"sv && has_value) {
+      std::string metric = argv[++i];
+      if (util::EqualICase(metric, "L2")) {
+        opts.metric = redis::DistanceMetric::L2;
+      } else if (util::EqualICase(metric, "IP")) {
+        opts.metric = redis::DistanceMetric::IP;
+      } else if (util::EqualICase(metric, "COSINE")) {
+        opts.metric = redis::DistanceMetric::COSINE;
+      } else {
+        Fail("Unknown metric: " + metric);
+      }
+    } else if (arg == "--type"sv && has_value) {
+      std::string type = argv[++i];
+      if (util::EqualICase(type, "FLOAT32")) {
+        opts.vector_type = redis::VectorType::FLOAT32;
+      } else if (util::EqualICase(type, "FLOAT64")) {
+        opts.vector_type = redis::VectorType::FLOAT64;
+      } else {
+        Fail("Unknown vector type: " + type);
+      }
+    } else if (arg == "--quantization"sv && has_value) {
+      std::string quantization = argv[++i];
+      if (util::EqualICase(quantization, "NONE")) {
+        opts.quantization = redis::VectorQuantization::NONE;
+      } else if (util::EqualICase(quantization, "SQ8")) {
+        opts.quantization = redis::VectorQuantization::SQ8;
+      } else {
+        Fail("Unknown quantization: " + quantization);
+      }
+    } else if (arg == "--threads"sv && has_value) {
+      opts.threads = ParseList<int>("threads", argv[++i])[0];
+    } else if (arg == "--dir"sv && has_value) {
+      opts.dir = argv[++i];
+    } else if (arg == "--json"sv) {
+      opts.json = true;
+    } else if (arg == "-h"sv || arg == "--help"sv) {
+      PrintUsage(*argv);
+      std::exit(0);
+    } else {
+      PrintUsage(*argv);
+      std::exit(1);
+    }
+  }
+
+  if (!opts.base_file.empty() && opts.query_file.empty()) Fail("--query is required with --base");
+  return opts;
+}
+
+// ReadVecs reads the vectors of the fvecs or ivecs format, where each vector is `int32 dim | dim * 4 bytes`
+template <typename T>
+std::vector<std::vector<T>> ReadVecs(const std::string &path, size_t limit) {
+  std::ifstream file(path, std::ios::in | std::ios::binary);
+  if (!file.is_open()) Fail(fmt::format("Failed to open {}: {}", path, strerror(errno)));
+
+  std::vector<std::vector<T>> vecs;
+  int32_t dim = 0;
+  while ((limit == 0 || vecs.size() < limit) && file.read(reinterpret_cast<char *>(&dim), sizeof(dim))) {
+    if (dim <= 0 || dim > UINT16_MAX) Fail(fmt::format("Invalid dimension {} in {}", dim, path));
+    std::vector<T> vec(dim);
+    if (!file.read(reinterpret_cast<char *>(vec.data()), static_cast<std::streamsize>(dim * sizeof(T)))) {
+      Fail(fmt::format("Truncated vector in {}", path));
+    }
+    vecs.emplace_back(std::move(vec));
+  }
+  return vecs;
+}
+
+Vectors RandomVectors(size_t n, uint16_t dim, uint64_t seed) {
+  std::mt19937_64 rng(seed);
+  std::normal_distribution<float> normal(0, 1);
+  Vectors vecs(n, std::vector<float>(dim));
+  for (auto &vec : vecs) {
+    for (auto &v : vec) v = normal(rng);
+  }
+  return vecs;
+}
+
+double Distance(redis::DistanceMetric metric, const std::vector<float> &a, const std::vector<float> &b) {
+  double dot = 0, norm_a = 0, norm_b = 0, l2 = 0;
+  for (size_t i = 0; i < a.size(); i++) {
+    dot += double(a[i]) * b[i];
+    norm_a += double(a[i]) * a[i];
+    norm_b += double(b[i]) * b[i];
+    l2 += (double(a[i]) - b[i]) * (double(a[i]) - b[i]);
+  }
+  switch (metric) {
+    case redis::DistanceMetric::IP:
+      return -dot;
+    case redis::DistanceMetric::COSINE:
+      return norm_a == 0 || norm_b == 0 ? 1 : 1 - dot / std::sqrt(norm_a * norm_b);
+    default:
+      return l2;
+  }
+}
+
+// GroundTruth finds the k nearest base vectors of each query by brute force over all the cores
+std::vector<std::vector<int32_t>> GroundTruth(const Vectors &base, const Vectors &queries, size_t k,
+                                              redis::DistanceMetric metric) {
+  std::vector<std::vector<int32_t>> truth(queries.size());
+  std::atomic<size_t> next = 0;
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < std::max(std::thread::hardware_concurrency(), 1U); t++) {
+    threads.emplace_back([&] {
+      for (auto q = next++; q < queries.size(); q = next++) {
+        std::vector<std::pair<double, int32_t>> distances;
+        distances.reserve(base.size());
+        for (size_t i = 0; i < base.size(); i++) {
+          distances.emplace_back(Distance(metric, queries[q], base[i]), static_cast<int32_t>(i));
+        }
+        auto n = std::min(k, distances.size());
+        std::partial_sort(distances.begin(), distances.begin() + static_cast<ptrdiff_t>(n), distances.end());
+        for (size_t i = 0; i < n; i++) truth[q].push_back(distances[i].second);
+      }
+    });
+  }
+  for (auto &thread : threads) thread.join();
+  return truth;
+}
+
+std::string EncodeVector(const std::vector<float> &vec, redis::VectorType type) {
+  std::string blob;
+  for (auto v : vec) {
+    if (type == redis::VectorType::FLOAT32) {
+      blob.append(reinterpret_cast<const char *>(&v), sizeof(v));
+    } else {
+      double d = v;
+      blob.append(reinterpret_cast<const char *>(&d), sizeof(d));
+    }
+  }
+  return blob;
+}
+
+struct BuildResult {
+  std::unique_ptr<kqir::IndexInfo> info;
+  double seconds = 0;
+  double bytes_per_vector = 0;
+};
+
+BuildResult BuildIndex(engine::Storage *storage, redis::GlobalIndexer *indexer, size_t n, uint16_t dim, uint16_t m,
+                       uint32_t ef_construction, const BenchOptions &opts) {
+  auto field_metadata = std::make_unique<redis::HnswVectorFieldMetadata>();
+  field_metadata->vector_type = opts.vector_type;
+  field_metadata->dim = dim;
+  field_metadata->distance_metric = opts.metric;
+  field_metadata->m = m;
+  field_metadata->ef_construction = ef_construction;
+  field_metadata->quantization = opts.quantization;
+
+  redis::IndexMetadata index_metadata;
+  index_metadata.on_data_type = redis::IndexOnDataType::HASH;
+  BuildResult result;
+  result.info =
+      std::make_unique<kqir::IndexInfo>(fmt::format("idx_m{}_efc{}", m, ef_construction), index_metadata, kNamespace);
+  result.info->Add(kqir::FieldInfo(kField, std::move(field_metadata)));
+  result.info->prefixes.prefixes.emplace_back(kKeyPrefix);
+
+  redis::IndexUpdater updater(result.info.get());
+  updater.indexer = indexer;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < n; i++) {
+    auto ctx = engine::Context::NoTransactionContext(storage);
+    if (auto s = updater.Update(ctx, {}, kKeyPrefix + std::to_string(i)); !s) {
+      Fail(fmt::format("Failed to index the vector {}: {}", i, s.Msg()));
+    }
+  }
+  result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  // the index is flushed, so its size is the size of the SST files
+  rocksdb::FlushOptions flush_options;
+  flush_options.wait = true;
+  auto cf_handle = storage->GetCFHandle(ColumnFamilyID::Search);
+  if (auto s = storage->GetDB()->Flush(flush_options, cf_handle); !s.ok()) {
+    LOG(WARNING) << "Failed to flush the search column family: " << s.ToString();
+  }
+  auto prefix = redis::SearchKey(kNamespace, result.info->name, kField).ConstructHnswFieldPrefix();
+  auto limit = util::StringNext(prefix);
+  rocksdb::Range range(prefix, limit);
+  rocksdb::SizeApproximationOptions size_options;
+  size_options.include_memtables = true;
+  size_options.include_files = true;
+  uint64_t size = 0;
+  if (auto s = storage->GetDB()->GetApproximateSizes(size_options, cf_handle, &range, 1, &size); s.ok() && n > 0) {
+    result.bytes_per_vector = static_cast<double>(size) / static_cast<double>(n);
+  }
+  return result;
+}
+
+struct SearchResult {
+  double recall = 0;
+  double qps = 0;
+  LatencyHistogram::Snapshot latencies;
+};
+
+SearchResult Search(engine::Storage *storage, const kqir::IndexInfo *info, const Vectors &queries,
+                    const std::vector<std::vector<int32_t>> &truth, uint32_t ef_runtime, const BenchOptions &opts) {
+  const auto *field = &info->fields.at(kField);
+  LatencyHistogram latencies;
+  std::atomic<size_t> next = 0;
+  std::atomic<uint64_t> hits = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < opts.threads; t++) {
+    threads.emplace_back([&] {
+      for (auto q = next++; q < queries.size(); q = next++) {
+        kqir::NumericArray query(queries[q].begin(), queries[q].end());
+        auto query_start = std::chrono::steady_clock::now();
+        auto op = std::make_unique<kqir::HnswVectorFieldKnnScan>(std::make_unique<kqir::FieldRef>(kField, field),
+                                                                 std::move(query), opts.k, ef_runtime);
+        kqir::ExecutorContext ctx(op.get(), storage);
+        std::unordered_set<int32_t> ids;
+        while (true) {
+          auto row = ctx.Next();
+          if (!row) Fail("Failed to search the index: " + row.Msg());
+          if (std::holds_alternative<kqir::ExecutorNode::End>(*row)) break;
+          auto key = std::get<kqir::ExecutorNode::RowType>(*row).key;
+          ids.insert(*ParseInt<int32_t>(key.substr(strlen(kKeyPrefix))));
+        }
+        latencies.Record(static_cast<uint64_t>((std::chrono::steady_clock::now() - query_start) /
+                                               std::chrono::microseconds(1)));
+
+        auto n = std::min<size_t>(opts.k, truth[q].size());
+        for (size_t i = 0; i < n; i++) hits += ids.count(truth[q][i]);
+      }
+    });
+  }
+  for (auto &thread : threads) thread.join();
+  auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  SearchResult result;
+  result.recall = static_cast<double>(hits) / static_cast<double>(queries.size() * opts.k);
+  result.qps = seconds > 0 ? static_cast<double>(queries.size()) / seconds : 0;
+  result.latencies = latencies.GetSnapshot();
+  return result;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_logtostderr = true;
+  FLAGS_minloglevel = google::WARNING;
+
+  auto opts = ParseBenchOptions(argc, argv);
+
+  Vectors base, queries;
+  std::vector<std::vector<int32_t>> truth;
+  if (opts.base_file.empty()) {
+    base = RandomVectors(opts.random_base, opts.random_dim, 1);
+    queries = RandomVectors(opts.random_query, opts.random_dim, 2);
+  } else {
+    base = ReadVecs<float>(opts.base_file, opts.base_limit);
+    queries = ReadVecs<float>(opts.query_file, opts.query_limit);
+  }
+  if (base.empty() || queries.empty()) Fail("No base or query vectors");
+  auto dim = static_cast<uint16_t>(base[0].size());
+  for (const auto &vec : queries) {
+    if (vec.size() != dim) Fail("The dimensions of the base and the query vectors are different");
+  }
+
+  // the ground truth of a limited base can't be read from the file of the full base
+  if (!opts.groundtruth_file.empty() && opts.base_limit == 0) {
+    truth = ReadVecs<int32_t>(opts.groundtruth_file, opts.query_limit);
+    if (truth.size() < queries.size()) Fail("The ground truth has less queries than the query file");
+  } else {
+    std::cerr << "Computing the ground truth of " << queries.size() << " queries by brute force" << std::endl;
+    truth = GroundTruth(base, queries, opts.k, opts.metric);
+  }
+
+  std::filesystem::remove_all(opts.dir);
+  std::filesystem::create_directories(opts.dir);
+  auto conf_file = opts.dir + "/kvrocks.conf";
+  std::ofstream(conf_file, std::ios::out) << "";
+  Config config;
+  if (auto s = config.Load(CLIOptions(conf_file)); !s) Fail("Failed to load the config: " + s.Msg());
+  config.db_dir = opts.dir + "/db";
+  engine::Storage storage(&config);
+  if (auto s = storage.Open(); !s) Fail("Failed to open the storage: " + s.Msg());
+
+  // the vectors are written once, and shared by the indexes of all the parameters
+  {
+    redis::Hash hash(&storage, kNamespace);
+    for (size_t i = 0; i < base.size(); i++) {
+      auto ctx = engine::Context::NoTransactionContext(&storage);
+      uint64_t added = 0;
+      auto s = hash.Set(ctx, kKeyPrefix + std::to_string(i), kField, EncodeVector(base[i], opts.vector_type), &added);
+      if (!s.ok()) Fail("Failed to write the vectors: " + s.ToString());
+    }
+  }
+
+  redis::GlobalIndexer indexer(&storage);
+  bool first = true;
+  if (opts.json) std::cout << "[" << std::endl;
+  for (auto m : opts.m) {
+    for (auto ef_construction : opts.ef_construction) {
+      auto build = BuildIndex(&storage, &indexer, base.size(), dim, m, ef_construction, opts);
+      if (!opts.json) {
+        std::cout << fmt::format("m={} ef_construction={}: built {} vectors in {:.3f} seconds, {:.1f} bytes per vector",
+                                 m, ef_construction, base.size(), build.seconds, build.bytes_per_vector)
+                  << std::endl;
+      }
+
+      for (auto ef_runtime : opts.ef_runtime) {
+        auto result = Search(&storage, build.info.get(), queries, truth, ef_runtime, opts);
+        auto p50 = result.latencies.Percentile(50), p99 = result.latencies.Percentile(99);
+        if (opts.json) {
+          std::cout << (first ? "" : ",\n")
+                    << fmt::format(R"(  {{"m": {}, "ef_construction": {}, "ef_runtime": {}, "k": {}, )"
+                                   R"("build_seconds": {:.3f}, "bytes_per_vector": {:.1f}, "recall": {:.4f}, )"
+                                   R"("qps": {:.1f}, "p50_us": {}, "p99_us": {}}})",
+                                   m, ef_construction, ef_runtime, opts.k, build.seconds, build.bytes_per_vector,
+                                   result.recall, result.qps, p50, p99);
+        } else {
+          std::cout << fmt::format("  ef_runtime={}: recall@{}={:.4f} qps={:.1f} p50={}us p99={}us", ef_runtime,
+                                   opts.k, result.recall, result.qps, p50, p99)
+                    << std::endl;
+        }
+        first = false;
+      }
+    }
+  }
+  if (opts.json) std::cout << std::endl << "]" << std::endl;
+
+  return 0;
+}
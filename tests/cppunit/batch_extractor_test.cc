@@ -0,0 +1,82 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "storage/batch_extractor.h"
+
+#include <gtest/gtest.h>
+#include <rocksdb/write_batch.h>
+
+#include "server/redis_reply.h"
+#include "test_base.h"
+
+class WriteBatchExtractorTest : public TestBase {
+ protected:
+  explicit WriteBatchExtractorTest() = default;
+  ~WriteBatchExtractorTest() override = default;
+
+  void putSubKey(rocksdb::WriteBatch *batch, const std::string &ns, const std::string &key, const std::string &sub_key,
+                 const std::string &value) {
+    std::string ns_key = ComposeNamespaceKey(ns, key, false);
+    auto s = batch->Put(storage_->GetCFHandle(ColumnFamilyID::PrimarySubkey),
+                        InternalKey(ns_key, sub_key, 1, false).Encode(), value);
+    EXPECT_TRUE(s.ok()) << s.ToString();
+  }
+};
+
+TEST_F(WriteBatchExtractorTest, GroupByNamespace) {
+  rocksdb::WriteBatch batch;
+  auto s = batch.PutLogData(redis::WriteBatchLogData(kRedisHash).Encode());
+  EXPECT_TRUE(s.ok()) << s.ToString();
+  putSubKey(&batch, "ns1", "k1", "f1", "v1");
+  putSubKey(&batch, "ns2", "k2", "f2", "v2");
+  putSubKey(&batch, "ns1", "k1", "f3", "v3");
+
+  WriteBatchExtractor extractor(false);
+  s = batch.Iterate(&extractor);
+  EXPECT_TRUE(s.ok()) << s.ToString();
+
+  auto resp_commands = extractor.GetRESPCommands();
+  ASSERT_EQ(resp_commands->size(), 2);
+  EXPECT_EQ((*resp_commands)["ns1"], std::vector<std::string>({redis::ArrayOfBulkStrings({"HSET", "k1", "f1", "v1"}),
+                                                               redis::ArrayOfBulkStrings({"HSET", "k1", "f3", "v3"})}));
+  EXPECT_EQ((*resp_commands)["ns2"], std::vector<std::string>({redis::ArrayOfBulkStrings({"HSET", "k2", "f2", "v2"})}));
+}
+
+TEST_F(WriteBatchExtractorTest, RESPOutput) {
+  rocksdb::WriteBatch batch;
+  auto s = batch.PutLogData(redis::WriteBatchLogData(kRedisSet).Encode());
+  EXPECT_TRUE(s.ok()) << s.ToString();
+  putSubKey(&batch, "ns1", "k1", "m1", "");
+  putSubKey(&batch, "ns2", "k2", "m2", "");
+  s = batch.Delete(storage_->GetCFHandle(ColumnFamilyID::Metadata), ComposeNamespaceKey("ns1", "k3", false));
+  EXPECT_TRUE(s.ok()) << s.ToString();
+
+  std::string output = "*1\r\n$4\r\nPING\r\n";
+  WriteBatchExtractor extractor(false);
+  extractor.SetRESPOutput(&output);
+  s = batch.Iterate(&extractor);
+  EXPECT_TRUE(s.ok()) << s.ToString();
+
+  // the commands are appended in the order of the batch, whatever their namespaces are
+  EXPECT_EQ(extractor.GetRESPCommandCount(), 3);
+  EXPECT_EQ(output, "*1\r\n$4\r\nPING\r\n" + redis::ArrayOfBulkStrings({"SADD", "k1", "m1"}) +
+                        redis::ArrayOfBulkStrings({"SADD", "k2", "m2"}) + redis::ArrayOfBulkStrings({"DEL", "k3"}));
+  EXPECT_TRUE(extractor.GetRESPCommands()->empty());
+}
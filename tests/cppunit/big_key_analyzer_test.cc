@@ -0,0 +1,95 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "storage/big_key_analyzer.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+
+#include "test_base.h"
+#include "types/redis_set.h"
+#include "types/redis_string.h"
+
+class BigKeyAnalyzerTest : public TestBase {
+ protected:
+  void SetUp() override { std::remove(path_.c_str()); }
+  void TearDown() override { std::remove(path_.c_str()); }
+
+  void addSet(redis::Set *set, const std::string &key, int n) {
+    std::vector<std::string> members;
+    for (int i = 0; i < n; i++) members.emplace_back("member" + std::to_string(i));
+    std::vector<Slice> member_slices(members.begin(), members.end());
+    uint64_t ret = 0;
+    ASSERT_TRUE(set->Add(*ctx_, key, member_slices, &ret).ok());
+  }
+
+  std::string path_ = "test_big_keys";
+};
+
+TEST_F(BigKeyAnalyzerTest, TopKeys) {
+  redis::Set set(storage_.get(), "big_keys_ns");
+  redis::Set other_set(storage_.get(), "other_ns");
+  redis::String string(storage_.get(), "big_keys_ns");
+  addSet(&set, "set1", 10);
+  addSet(&set, "set2", 100);
+  addSet(&set, "set3", 50);
+  addSet(&other_set, "set4", 1000);
+  ASSERT_TRUE(string.Set(*ctx_, "string", std::string(4096, 'a')).ok());
+  ASSERT_TRUE(string.Set(*ctx_, "small_string", "a").ok());
+
+  BigKeyAnalyzer analyzer(storage_.get(), path_);
+  ASSERT_TRUE(analyzer.Run(2).IsOK());
+  EXPECT_TRUE(analyzer.IsDone());
+  EXPECT_EQ(analyzer.GetScannedKeys(), 6);
+
+  auto top_keys = analyzer.GetTopKeys("big_keys_ns");
+  ASSERT_EQ(top_keys.size(), 2);
+  const auto &sets = top_keys[kRedisSet];
+  ASSERT_EQ(sets.by_elements.size(), 2);
+  EXPECT_EQ(sets.by_elements[0].key, "set2");
+  EXPECT_EQ(sets.by_elements[0].elements, 100);
+  EXPECT_EQ(sets.by_elements[1].key, "set3");
+  ASSERT_EQ(sets.by_bytes.size(), 2);
+  EXPECT_GE(sets.by_bytes[0].bytes, sets.by_bytes[1].bytes);
+  const auto &strings = top_keys[kRedisString];
+  ASSERT_EQ(strings.by_bytes.size(), 2);
+  EXPECT_EQ(strings.by_bytes[0].key, "string");
+  EXPECT_GE(strings.by_bytes[0].bytes, 4096);
+
+  auto other_top_keys = analyzer.GetTopKeys("other_ns");
+  ASSERT_EQ(other_top_keys[kRedisSet].by_elements.size(), 1);
+  EXPECT_EQ(other_top_keys[kRedisSet].by_elements[0].key, "set4");
+
+  // the results are saved, and a finished analysis restarts from the beginning
+  BigKeyAnalyzer loaded(storage_.get(), path_);
+  ASSERT_TRUE(loaded.Load().IsOK());
+  EXPECT_TRUE(loaded.IsDone());
+  EXPECT_EQ(loaded.GetScannedKeys(), 6);
+  EXPECT_EQ(loaded.GetTopKeys("big_keys_ns")[kRedisSet].by_elements[0].key, "set2");
+  ASSERT_TRUE(loaded.Run(2).IsOK());
+  EXPECT_EQ(loaded.GetScannedKeys(), 6);
+
+  ASSERT_TRUE(loaded.Reset().IsOK());
+  EXPECT_TRUE(loaded.GetTopKeys("big_keys_ns").empty());
+  BigKeyAnalyzer reset(storage_.get(), path_);
+  ASSERT_TRUE(reset.Load().IsOK());
+  EXPECT_EQ(reset.GetScannedKeys(), 0);
+}
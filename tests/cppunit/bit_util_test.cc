@@ -0,0 +1,98 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "bit_util.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace {
+
+std::vector<uint8_t> RandomBytes(std::mt19937 *rng, size_t count) {
+  std::vector<uint8_t> bytes(count);
+  for (auto &b : bytes) b = static_cast<uint8_t>((*rng)());
+  return bytes;
+}
+
+}  // namespace
+
+TEST(BitUtil, SimdPopcount) {
+  std::mt19937 rng(42);
+  for (size_t count : {0, 1, 31, 64, 100, 1024, 4099}) {
+    auto bytes = RandomBytes(&rng, count + 7);
+    for (size_t offset = 0; offset < 7; offset += 3) {
+      size_t expected = 0;
+      for (size_t i = 0; i < count; i++) expected += __builtin_popcount(bytes[offset + i]);
+      ASSERT_EQ(util::simd::Popcount(bytes.data() + offset, count), expected) << util::simd::KernelName();
+      ASSERT_EQ(util::RawPopcount(bytes.data() + offset, static_cast<int64_t>(count)), expected);
+    }
+  }
+}
+
+TEST(BitUtil, SimdSkipFilledBytes) {
+  for (uint8_t fill : {0, UINT8_MAX}) {
+    for (size_t count : {1, 33, 64, 200, 1024}) {
+      std::vector<uint8_t> bytes(count, fill);
+      ASSERT_EQ(util::simd::SkipFilledBytes(bytes.data(), count, fill), count);
+      for (size_t pos : {size_t(0), count / 2, count - 1}) {
+        bytes[pos] = fill ^ 0x10;
+        ASSERT_EQ(util::simd::SkipFilledBytes(bytes.data(), count, fill), pos);
+        // the scan from the byte holding the bit finds it in the byte right after the filled ones
+        ASSERT_EQ(util::msb::RawBitpos(bytes.data(), static_cast<int64_t>(count), fill == 0),
+                  static_cast<int64_t>(pos * 8 + 3));
+        bytes[pos] = fill;
+      }
+      // no bit set to one is -1, while the zero bits are found in the padding on the right
+      ASSERT_EQ(util::msb::RawBitpos(bytes.data(), static_cast<int64_t>(count), fill == 0),
+                fill == 0 ? -1 : static_cast<int64_t>(count * 8));
+    }
+  }
+}
+
+TEST(BitUtil, SimdBitwise) {
+  std::mt19937 rng(7);
+  for (size_t count : {1, 63, 64, 129, 1024, 1031}) {
+    auto a = RandomBytes(&rng, count);
+    auto b = RandomBytes(&rng, count);
+
+    auto res = a;
+    util::simd::BitwiseAnd(res.data(), b.data(), count);
+    for (size_t i = 0; i < count; i++) ASSERT_EQ(res[i], a[i] & b[i]);
+
+    res = a;
+    util::simd::BitwiseOr(res.data(), b.data(), count);
+    for (size_t i = 0; i < count; i++) ASSERT_EQ(res[i], a[i] | b[i]);
+
+    res = a;
+    util::simd::BitwiseXor(res.data(), b.data(), count);
+    for (size_t i = 0; i < count; i++) ASSERT_EQ(res[i], a[i] ^ b[i]);
+
+    res = a;
+    util::simd::BitwiseNot(res.data(), count);
+    for (size_t i = 0; i < count; i++) ASSERT_EQ(res[i], static_cast<uint8_t>(~a[i]));
+
+    res = a;
+    util::simd::MaxBytes(res.data(), b.data(), count);
+    for (size_t i = 0; i < count; i++) ASSERT_EQ(res[i], std::max(a[i], b[i]));
+  }
+}
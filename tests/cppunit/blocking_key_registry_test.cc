@@ -0,0 +1,50 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "server/blocking_key_registry.h"
+
+#include <gtest/gtest.h>
+
+TEST(BlockingKeyRegistry, TakeInBlockedOrder) {
+  BlockingKeyRegistry registry;
+  // the workers are only compared, never dereferenced
+  auto *worker1 = reinterpret_cast<Worker *>(0x10);
+  auto *worker2 = reinterpret_cast<Worker *>(0x20);
+
+  registry.Block("list", {worker1, 1});
+  registry.Block("list", {worker2, 2});
+  registry.Block("list", {worker1, 3});
+  registry.Block("list", {worker2, 4});
+  registry.Block("other", {worker1, 5});
+
+  // one waiter is taken for each pushed element, first come first served
+  auto taken = registry.Take("list", 1);
+  ASSERT_EQ(taken.size(), 1);
+  ASSERT_EQ(taken[worker1], std::vector<int>{1});
+
+  registry.Unblock("list", worker1, 3);
+  taken = registry.Take("list", 3);
+  ASSERT_EQ(taken.size(), 1);
+  ASSERT_EQ(taken[worker2], (std::vector<int>{2, 4}));
+
+  ASSERT_TRUE(registry.Take("list", 1).empty());
+  taken = registry.Take("other", 10);
+  ASSERT_EQ(taken[worker1], std::vector<int>{5});
+}
@@ -0,0 +1,62 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+#include "storage/cache_warmup.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+
+#include "test_base.h"
+
+class CacheWarmupTest : public TestBase {
+ protected:
+  CacheWarmupTest() { hash_ = std::make_unique<redis::Hash>(storage_.get(), "warmup_ns"); }
+  ~CacheWarmupTest() override { std::remove(path_.c_str()); }
+
+  std::string path_ = "test_block_cache_warmup";
+  std::unique_ptr<redis::Hash> hash_;
+};
+
+TEST_F(CacheWarmupTest, DumpAndLoad) {
+  uint64_t ret = 0;
+  for (int i = 0; i < 4; i++) {
+    auto s = hash_->Set(*ctx_, "hash" + std::to_string(i), "field", "value", &ret);
+    ASSERT_TRUE(s.ok());
+  }
+
+  engine::CacheWarmup warmup(path_, 100);
+  // Nothing has been saved yet
+  ASSERT_TRUE(warmup.Load(storage_.get()).IsOK());
+  EXPECT_EQ(warmup.GetTotalKeys(), 0);
+
+  // Only one in kSampleRate lookups is recorded
+  for (int i = 0; i < 4; i++) {
+    for (uint32_t n = 0; n < engine::CacheWarmup::kSampleRate; n++) {
+      warmup.Record(hash_->AppendNamespacePrefix("hash" + std::to_string(i)));
+    }
+  }
+  ASSERT_TRUE(warmup.Dump().IsOK());
+
+  engine::CacheWarmup restarted(path_, 100);
+  ASSERT_TRUE(restarted.Load(storage_.get()).IsOK());
+  EXPECT_EQ(restarted.GetTotalKeys(), 4);
+  EXPECT_EQ(restarted.GetLoadedKeys(), 4);
+  EXPECT_FALSE(restarted.IsLoading());
+}
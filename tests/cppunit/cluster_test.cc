@@ -422,3 +422,56 @@ TEST_F(ClusterTest, GetReplicas) {
   ASSERT_FALSE(unknown_node.IsOK());
   ASSERT_EQ(unknown_node.Msg(), "Invalid cluster node id");
 }
+
+TEST_F(ClusterTest, TopologyChanges) {
+  auto config = storage_->GetConfig();
+  // don't start workers
+  config->workers = 0;
+  Server server(storage_.get(), config);
+  // we don't need the server resource, so just stop it once it's started
+  server.Stop();
+  server.Join();
+
+  const std::string master_id = "159dde1194ebf5bfc5a293dff839c3d1476f2a49";
+  const std::string my_id = "bb2e5b3c5282086df51eff6b3e35519aede96fa6";
+  const std::string nodes =
+      "7dbee3d628f04cc5d763b36e92b10533e627a1d0 127.0.0.1 6480 slave " + master_id + "\n" + master_id +
+      " 127.0.0.1 6479 master - 8192-16383\n" + my_id + " 127.0.0.1 6379 master - 0-8191";
+
+  Cluster cluster(&server, {"127.0.0.1"}, 6379);
+  Status s = cluster.SetClusterNodes(nodes, 2, false);
+  ASSERT_TRUE(s.IsOK());
+  ASSERT_EQ(cluster.GetMyId(), my_id);
+
+  // the replication is switched by the cron, since the topology change doesn't take the exclusivity
+  ASSERT_TRUE(cluster.HasPendingReplicationSwitch());
+  s = cluster.SetMasterSlaveRepl();
+  ASSERT_TRUE(s.IsOK());
+  ASSERT_FALSE(cluster.HasPendingReplicationSwitch());
+
+  // the replication relationship isn't changed by a new version of the same nodes
+  s = cluster.SetClusterNodes(nodes, 3, false);
+  ASSERT_TRUE(s.IsOK());
+  ASSERT_FALSE(cluster.HasPendingReplicationSwitch());
+
+  std::vector<SlotInfo> slots_infos;
+  s = cluster.SetSlotRanges({{0, 0}}, master_id, 4);
+  ASSERT_TRUE(s.IsOK());
+  s = cluster.GetSlotsInfo(&slots_infos);
+  ASSERT_TRUE(s.IsOK());
+  ASSERT_EQ(slots_infos.size(), 3);
+  ASSERT_EQ(slots_infos[0].start, 0);
+  ASSERT_EQ(slots_infos[0].end, 0);
+  ASSERT_EQ(slots_infos[0].nodes[0].id, master_id);
+  ASSERT_EQ(slots_infos[1].start, 1);
+  ASSERT_EQ(slots_infos[1].end, 8191);
+  ASSERT_EQ(slots_infos[1].nodes[0].id, my_id);
+
+  std::string output_nodes;
+  s = cluster.GetClusterNodes(&output_nodes);
+  ASSERT_TRUE(s.IsOK());
+  ASSERT_NE(output_nodes.find("myself,master - "), std::string::npos);
+  ASSERT_NE(output_nodes.find(" connected 0 8192-16383\n"), std::string::npos);
+  ASSERT_NE(output_nodes.find(" connected 1-8191\n"), std::string::npos);
+  ASSERT_EQ(cluster.GetVersion(), 4);
+}
@@ -56,6 +56,9 @@ TEST(Compact, Filter) {
   // Compact twice to workaround issue fixed by: https://github.com/facebook/rocksdb/pull/11468
   status = storage->Compact(nullptr, nullptr, nullptr);
   assert(status.ok());
+  // The second field of each hash reuses the metadata looked up for the first one
+  EXPECT_GT(storage->GetDBStats()->compaction_filter_cache_hits, 0);
+  EXPECT_GT(storage->GetDBStats()->compaction_filter_cache_misses, 0);
 
   rocksdb::DB* db = storage->GetDB();
   rocksdb::ReadOptions read_options;
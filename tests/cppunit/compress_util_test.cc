@@ -0,0 +1,61 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "compress_util.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+TEST(CompressUtil, ParseCompressionType) {
+  ASSERT_EQ(*util::ParseCompressionType("no"), util::CompressionType::kNone);
+  ASSERT_EQ(*util::ParseCompressionType("LZ4"), util::CompressionType::kLZ4);
+  ASSERT_EQ(*util::ParseCompressionType("zstd"), util::CompressionType::kZSTD);
+  ASSERT_FALSE(util::ParseCompressionType("snappy"));
+  ASSERT_STREQ(util::CompressionTypeName(util::CompressionType::kZSTD), "zstd");
+}
+
+TEST(CompressUtil, Frame) {
+  std::string input;
+  for (int i = 0; i < 1000; i++) input += "$3\r\nset\r\n$5\r\nkey" + std::to_string(i % 10) + "\r\n";
+
+  for (auto type : {util::CompressionType::kNone, util::CompressionType::kLZ4, util::CompressionType::kZSTD}) {
+    std::string frame;
+    util::CompressFrame(type, input, &frame);
+    if (type != util::CompressionType::kNone) ASSERT_LT(frame.size(), input.size() / 4);
+
+    std::string output = "prefix";
+    ASSERT_TRUE(util::DecompressFrame(frame, &output).IsOK());
+    ASSERT_EQ(output, "prefix" + input);
+
+    frame.resize(frame.size() - 1);
+    output.clear();
+    ASSERT_FALSE(util::DecompressFrame(frame, &output).IsOK());
+    ASSERT_TRUE(output.empty());
+  }
+
+  // the incompressible data is kept as it is
+  std::string frame;
+  util::CompressFrame(util::CompressionType::kLZ4, "abc", &frame);
+  ASSERT_EQ(frame[0], static_cast<char>(util::CompressionType::kNone));
+  std::string output;
+  ASSERT_TRUE(util::DecompressFrame(frame, &output).IsOK());
+  ASSERT_EQ(output, "abc");
+}
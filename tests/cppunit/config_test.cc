@@ -37,11 +37,15 @@ TEST(Config, GetAndSet) {
   EXPECT_FALSE(s.IsOK());
   std::map<std::string, std::string> mutable_cases = {
       {"workers", "4"},
+      {"worker-connection-pool-size", "128"},
       {"log-level", "info"},
       {"timeout", "1000"},
       {"maxclients", "2000"},
       {"max-backup-to-keep", "1"},
       {"max-backup-keep-hours", "4000"},
+      {"backup-threads", "8"},
+      {"namespace-quotas", "ns1:1000:1048576:0:2 ns2:100:0:0"},
+      {"backup-rate-limit-mb", "100"},
       {"requirepass", "mytest_requirepass"},
       {"masterauth", "mytest_masterauth"},
       {"compact-cron", "1 2 3 4 5"},
@@ -49,7 +53,18 @@ TEST(Config, GetAndSet) {
       {"dbsize-scan-cron", "1 2 3 2 1"},
       {"max-io-mb", "5000"},
       {"max-db-size", "6000"},
+      {"write-stall-policy", "reject-delayed"},
       {"max-replication-mb", "7000"},
+      {"replication-compression", "zstd"},
+      {"replica-apply-batch-size-kb", "128"},
+      {"repl-backlog-size-mb", "64"},
+      {"migrate-concurrency", "4"},
+      {"migrate-adaptive-rate", "yes"},
+      {"migrate-adaptive-latency-us", "5000"},
+      {"migrate-adaptive-pending-compaction-mb", "1024"},
+      {"secondary-catch-up-interval-ms", "500"},
+      {"secondary-max-lag-ms", "3000"},
+      {"fullsync-fetch-threads", "8"},
       {"slave-serve-stale-data", "no"},
       {"slave-read-only", "no"},
       {"slave-priority", "101"},
@@ -62,6 +77,9 @@ TEST(Config, GetAndSet) {
       {"backup-dir", "test_dir/backup"},
 
       {"rocksdb.compression", "no"},
+      {"rocksdb.compression_max_dict_bytes", "16384"},
+      {"rocksdb.compression_zstd_max_train_bytes", "1638400"},
+      {"rocksdb.compression_parallel_threads", "4"},
       {"rocksdb.max_open_files", "1234"},
       {"rocksdb.write_buffer_size", "1234"},
       {"rocksdb.max_write_buffer_number", "1"},
@@ -117,6 +135,8 @@ TEST(Config, GetAndSet) {
       {"dir", "test_dir"},
       {"pidfile", "test.pid"},
       {"supervised", "no"},
+      {"secondary-db-dir", "test_dir"},
+      {"backup-incremental", "yes"},
       {"rocksdb.block_size", "1234"},
       {"rocksdb.max_background_flushes", "-1"},
       {"rocksdb.wal_ttl_seconds", "10000"},
@@ -128,6 +148,7 @@ TEST(Config, GetAndSet) {
       {"rocksdb.row_cache_size", "100"},
       {"rocksdb.rate_limiter_auto_tuned", "yes"},
       {"rocksdb.compression_level", "32767"},
+      {"rocksdb.compression_dict_column_families", "metadata"},
   };
   for (const auto &iter : immutable_cases) {
     s = config.Set(nullptr, iter.first, iter.second);
@@ -158,6 +179,41 @@ TEST(Config, GetRenameCommand) {
   ASSERT_EQ(values[0], "rename-command");
   ASSERT_EQ(values[2], "rename-command");
   ASSERT_EQ(values[4], "rename-command");
+
+  ASSERT_EQ(redis::CommandTable::Lookup("KEYS"), nullptr);
+  ASSERT_EQ(redis::CommandTable::Lookup("Get_New")->name, "get");
+  ASSERT_EQ(redis::CommandTable::Lookup("set_new")->name, "set");
+  ASSERT_EQ(redis::CommandTable::Lookup("hGetAll")->name, "hgetall");
+  redis::CommandTable::Reset();
+  ASSERT_EQ(redis::CommandTable::Lookup("keys")->name, "keys");
+  ASSERT_EQ(redis::CommandTable::Lookup("get_new"), nullptr);
+}
+
+TEST(Config, CPUs) {
+  const char *path = "test.conf";
+  unlink(path);
+
+  std::ofstream output_file(path, std::ios::out);
+  output_file << "worker-cpus \"0-2,4;8,10-11\"\n";
+  output_file << "replication-cpus 5\n";
+  output_file << "rocksdb.background_cpus 6-7\n";
+  output_file.close();
+  Config config;
+  ASSERT_TRUE(config.Load(CLIOptions(path)).IsOK());
+  ASSERT_EQ(config.worker_cpus, (std::vector<std::vector<int>>{{0, 1, 2, 4}, {8, 10, 11}}));
+  ASSERT_EQ(config.replication_cpus, std::vector<int>{5});
+  ASSERT_EQ(config.rocks_db.background_cpus, (std::vector<int>{6, 7}));
+  ASSERT_TRUE(config.background_task_cpus.empty());
+  unlink(path);
+
+  for (const auto &cpus : {"3-1", "1-2-3", "x", "1024"}) {
+    std::ofstream output_file(path, std::ios::out);
+    output_file << "worker-cpus " << cpus << "\n";
+    output_file.close();
+    Config config;
+    ASSERT_FALSE(config.Load(CLIOptions(path)).IsOK()) << cpus;
+    unlink(path);
+  }
 }
 
 TEST(Config, Rewrite) {
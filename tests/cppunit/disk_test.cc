@@ -252,3 +252,38 @@ TEST_F(RedisDiskTest, StreamDisk) {
   EXPECT_LE(key_size, approximate_size / estimation_factor_);
   auto s = stream->Del(*ctx_, key_);
 }
+
+TEST_F(RedisDiskTest, MemoryUsage) {
+  std::unique_ptr<redis::Set> set = std::make_unique<redis::Set>(storage_.get(), "memory_ns_set");
+  std::unique_ptr<redis::String> string = std::make_unique<redis::String>(storage_.get(), "memory_ns_set");
+  std::unique_ptr<redis::Disk> disk = std::make_unique<redis::Disk>(storage_.get(), "memory_ns_set");
+  key_ = "memory_usage_key";
+  uint64_t approximate_size = 0;
+  uint64_t ret = 0;
+  std::vector<Slice> members;
+  std::vector<std::string> values(100);
+  for (int i = 0; i < int(values.size()); i++) {
+    values[i] = std::string(1024, static_cast<char>('a' + i % 26)) + std::to_string(i);
+    members.emplace_back(values[i]);
+    approximate_size += key_.size() + values[i].size() + 8;
+  }
+  rocksdb::Status s = set->Add(*ctx_, key_, members, &ret);
+  EXPECT_TRUE(s.ok() && ret == values.size());
+
+  uint64_t usage = 0;
+  EXPECT_TRUE(disk->GetKeyMemoryUsage(*ctx_, key_, 0, &usage).ok());
+  EXPECT_GE(usage, approximate_size * estimation_factor_);
+  EXPECT_LE(usage, approximate_size / estimation_factor_);
+  EXPECT_TRUE(disk->GetKeyMemoryUsage(*ctx_, key_, 5, &usage).ok());
+  EXPECT_GE(usage, approximate_size);
+  EXPECT_LE(usage, approximate_size * 2);
+
+  std::string value(4096, 'v');
+  EXPECT_TRUE(string->Set(*ctx_, "memory_usage_string", value).ok());
+  EXPECT_TRUE(disk->GetKeyMemoryUsage(*ctx_, "memory_usage_string", 5, &usage).ok());
+  EXPECT_GE(usage, value.size());
+
+  EXPECT_TRUE(disk->GetKeyMemoryUsage(*ctx_, "memory_usage_nonexistent", 0, &usage).IsNotFound());
+  s = set->Del(*ctx_, key_);
+  s = string->Del(*ctx_, "memory_usage_string");
+}
@@ -24,6 +24,7 @@
 #include <rocksdb/slice.h>
 
 #include <cstdint>
+#include <cstring>
 #include <limits>
 #include <string>
 #include <vector>
@@ -56,3 +57,38 @@ TEST(Util, EncodeAndDecodeInt32AsVarint32) {
     ASSERT_EQ(result, values[i]);
   }
 }
+
+TEST(Util, DecodeArrays) {
+  // the sizes cover the vectorized blocks and the scalar tails of all the kernels
+  for (size_t n : {0, 1, 3, 4, 7, 8, 9, 17, 64}) {
+    std::vector<uint32_t> u32s(n);
+    std::vector<uint64_t> u64s(n);
+    std::vector<double> doubles(n);
+    std::vector<float> floats(n);
+    std::string u32_bytes, u64_bytes, double_bytes, float_bytes;
+    for (size_t i = 0; i < n; i++) {
+      u32s[i] = static_cast<uint32_t>(i * 2654435761U);
+      u64s[i] = i * 0x9e3779b97f4a7c15ULL;
+      doubles[i] = (i % 2 ? -1.0 : 1.0) * static_cast<double>(i) * 1.25;
+      floats[i] = static_cast<float>(doubles[i]);
+      PutFixed32(&u32_bytes, u32s[i]);
+      PutFixed64(&u64_bytes, u64s[i]);
+      PutDouble(&double_bytes, doubles[i]);
+      uint32_t bits = 0;
+      memcpy(&bits, &floats[i], sizeof(bits));
+      PutFixed32(&float_bytes, bits);
+    }
+
+    std::vector<uint32_t> got_u32s(n);
+    std::vector<uint64_t> got_u64s(n);
+    std::vector<double> got_doubles(n), got_floats(n);
+    DecodeFixed32Array(u32_bytes.data(), got_u32s.data(), n);
+    DecodeFixed64Array(u64_bytes.data(), got_u64s.data(), n);
+    DecodeDoubleArray(double_bytes.data(), got_doubles.data(), n);
+    DecodeFloatArray(float_bytes.data(), got_floats.data(), n);
+    ASSERT_EQ(got_u32s, u32s);
+    ASSERT_EQ(got_u64s, u64s);
+    ASSERT_EQ(got_doubles, doubles);
+    for (size_t i = 0; i < n; i++) ASSERT_EQ(got_floats[i], floats[i]);
+  }
+}
@@ -0,0 +1,101 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "search/field_stats.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+
+using namespace redis;
+
+TEST(FieldStatsTest, Buckets) {
+  for (double v : {0.0, 1e-20, -1e-20, 1.0, 1.5, -3.0, 1000.0, 1e30, -1e30}) {
+    auto [lo, hi] = FieldStats::BucketBounds(FieldStats::BucketOf(v));
+    ASSERT_LE(lo, v);
+    ASSERT_LE(v, hi);
+  }
+
+  ASSERT_EQ(FieldStats::BucketOf(std::numeric_limits<double>::infinity()), FieldStats::kBuckets - 1);
+  ASSERT_EQ(FieldStats::BucketOf(-std::numeric_limits<double>::infinity()), 0U);
+  ASSERT_EQ(FieldStats::BucketOf(1), FieldStats::BucketOf(1.9));
+  ASSERT_NE(FieldStats::BucketOf(1), FieldStats::BucketOf(2));
+  ASSERT_NE(FieldStats::BucketOf(1), FieldStats::BucketOf(-1));
+}
+
+TEST(FieldStatsTest, Tag) {
+  TagFieldMetadata tag;
+  tag.case_sensitive = false;
+
+  FieldStats stats;
+  for (int i = 0; i < 100; i++) {
+    stats.Update(&tag, {}, kqir::StringArray{i % 4 == 0 ? "A" : "b", "c"});
+  }
+  ASSERT_EQ(stats.GetCardinality(), 100);
+  ASSERT_DOUBLE_EQ(stats.TagSelectivity(&tag, "a"), 0.25);
+  ASSERT_DOUBLE_EQ(stats.TagSelectivity(&tag, "B"), 0.75);
+  ASSERT_DOUBLE_EQ(stats.TagSelectivity(&tag, "c"), 1);
+  ASSERT_DOUBLE_EQ(stats.TagSelectivity(&tag, "d"), 0);
+
+  stats.Update(&tag, kqir::StringArray{"a", "c"}, kqir::StringArray{"b"});
+  stats.Update(&tag, kqir::StringArray{"b", "c"}, {});
+  ASSERT_EQ(stats.GetCardinality(), 99);
+  ASSERT_DOUBLE_EQ(stats.TagSelectivity(&tag, "a"), 24.0 / 99);
+  ASSERT_DOUBLE_EQ(stats.TagSelectivity(&tag, "c"), 98.0 / 99);
+}
+
+TEST(FieldStatsTest, Numeric) {
+  NumericFieldMetadata numeric;
+
+  FieldStats stats;
+  for (int i = 0; i < 1024; i++) {
+    stats.Update(&numeric, {}, kqir::Numeric(i));
+  }
+  ASSERT_EQ(stats.GetCardinality(), 1024);
+  ASSERT_DOUBLE_EQ(stats.NumericSelectivity(-std::numeric_limits<double>::infinity(), 1024), 1);
+  ASSERT_DOUBLE_EQ(stats.NumericSelectivity(2000, 3000), 0);
+  ASSERT_NEAR(stats.NumericSelectivity(512, 1024), 0.5, 0.01);
+  ASSERT_NEAR(stats.NumericSelectivity(0, 256), 0.25, 0.01);
+  ASSERT_NEAR(stats.NumericSelectivity(768, 1024), 0.25, 0.01);
+  ASSERT_LT(stats.NumericSelectivity(100, std::nextafter(100, 101)), 0.01);
+}
+
+TEST(FieldStatsTest, EncodeAndDecode) {
+  TagFieldMetadata tag;
+  FieldStats stats;
+  for (int i = 0; i < 10; i++) {
+    stats.Update(&tag, {}, kqir::StringArray{std::to_string(i % 3)});
+  }
+
+  std::string value;
+  stats.Encode(&value);
+
+  FieldStats decoded(false);
+  Slice input = value;
+  ASSERT_TRUE(decoded.Decode(&input).ok());
+  ASSERT_TRUE(decoded.IsComplete());
+  ASSERT_EQ(decoded.GetCardinality(), 10);
+  ASSERT_DOUBLE_EQ(decoded.TagSelectivity(&tag, "0"), 0.4);
+  ASSERT_DOUBLE_EQ(decoded.TagSelectivity(&tag, "1"), 0.3);
+
+  Slice truncated(value.data(), value.size() - 1);
+  ASSERT_FALSE(decoded.Decode(&truncated).ok());
+}
@@ -21,6 +21,9 @@
 #include <gtest/gtest.h>
 #include <test_base.h>
 
+#include <algorithm>
+#include <cmath>
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <random>
@@ -74,7 +77,7 @@ struct HnswIndexTest : TestBase {
     metadata.m = 3;
     metadata.distance_metric = redis::DistanceMetric::L2;
     auto search_key = redis::SearchKey(ns, idx_name, key);
-    hnsw_index = std::make_unique<redis::HnswIndex>(search_key, &metadata, storage_.get(), seed);
+    hnsw_index = std::make_unique<redis::HnswIndex>(search_key, &metadata, storage_.get(), nullptr, seed);
   }
 
   void TearDown() override { hnsw_index.reset(); }
@@ -609,3 +612,145 @@ TEST_F(HnswIndexTest, SearchKnnAndRange) {
   expected = {"key11"};
   EXPECT_EQ(key_strs, expected);
 }
+
+TEST_F(HnswIndexTest, SearchWithGraphCache) {
+  storage_->GetConfig()->hnsw_cache_size = 1;
+  redis::HnswGraphCache cache;
+  hnsw_index->cache = &cache;
+
+  engine::Context ctx(storage_.get());
+  auto write = [&](const std::function<Status(engine::WriteBatchBasePtr&)>& update) {
+    auto batch = storage_->GetWriteBatchBase();
+    ASSERT_TRUE(update(batch).IsOK());
+    ASSERT_TRUE(storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch()).ok());
+    hnsw_index->InvalidateCache(batch->GetWriteBatch());
+  };
+
+  std::vector<std::vector<double>> vectors = {{11.0, 12.0, 13.0}, {14.0, 15.0, 16.0}, {17.0, 18.0, 19.0},
+                                              {12.0, 13.0, 14.0}, {30.0, 40.0, 35.0}, {10.0, 9.0, 8.0}};
+  std::vector<uint16_t> levels = {1, 2, 0, 1, 0, 0};
+  for (size_t i = 0; i < vectors.size(); i++) {
+    write([&](engine::WriteBatchBasePtr& batch) {
+      return hnsw_index->InsertVectorEntryInternal(ctx, "key" + std::to_string(i + 1), vectors[i], batch, levels[i]);
+    });
+  }
+
+  std::vector<double> query_vector = {31.0, 32.0, 23.0};
+  auto s1 = hnsw_index->KnnSearch(ctx, query_vector, 3);
+  ASSERT_TRUE(s1.IsOK());
+  auto hits = cache.GetHits();
+  auto s2 = hnsw_index->KnnSearch(ctx, query_vector, 3);
+  ASSERT_TRUE(s2.IsOK());
+  EXPECT_EQ(GetVectorKeys(s1.GetValue()), GetVectorKeys(s2.GetValue()));
+  EXPECT_GT(cache.GetHits(), hits);
+  EXPECT_GT(cache.GetUsage(), 0);
+
+  // the search without the cache gets the same result
+  hnsw_index->cache = nullptr;
+  auto s3 = hnsw_index->KnnSearch(ctx, query_vector, 3);
+  ASSERT_TRUE(s3.IsOK());
+  EXPECT_EQ(GetVectorKeys(s3.GetValue()), GetVectorKeys(s2.GetValue()));
+  hnsw_index->cache = &cache;
+
+  // the deleted node is erased from the cache, so it's not found by the search anymore
+  write([&](engine::WriteBatchBasePtr& batch) { return hnsw_index->DeleteVectorEntry(ctx, "key5", batch); });
+  auto s4 = hnsw_index->KnnSearch(ctx, query_vector, 3);
+  ASSERT_TRUE(s4.IsOK());
+  auto key_strs = GetVectorKeys(s4.GetValue());
+  EXPECT_EQ(std::find(key_strs.begin(), key_strs.end(), "key5"), key_strs.end());
+
+  hnsw_index->cache = nullptr;
+  auto s5 = hnsw_index->KnnSearch(ctx, query_vector, 3);
+  ASSERT_TRUE(s5.IsOK());
+  EXPECT_EQ(GetVectorKeys(s5.GetValue()), key_strs);
+}
+
+TEST_F(HnswIndexTest, SearchQuantizedVectors) {
+  redis::HnswVectorFieldMetadata sq8_metadata = metadata;
+  sq8_metadata.quantization = redis::VectorQuantization::SQ8;
+  sq8_metadata.ef_runtime = 10;
+  redis::HnswIndex sq8_index(redis::SearchKey(ns, idx_name, "sq8_vector"), &sq8_metadata, storage_.get(), nullptr,
+                             seed);
+
+  engine::Context ctx(storage_.get());
+  std::vector<std::vector<double>> vectors = {{11.0, 12.0, 13.0}, {14.0, 15.0, 16.0}, {17.0, 18.0, 19.0},
+                                              {12.0, 13.0, 14.0}, {30.0, 40.0, 35.0}, {10.0, 9.0, 8.0}};
+  std::vector<uint16_t> levels = {1, 2, 0, 1, 0, 0};
+  for (size_t i = 0; i < vectors.size(); i++) {
+    InsertEntryIntoHnswIndex(ctx, "key" + std::to_string(i + 1), vectors[i], levels[i], &sq8_index, storage_.get());
+  }
+
+  // the node holds the codes, and the full vector is stored aside
+  redis::HnswNode node("key5", 0);
+  auto node_metadata = node.DecodeMetadata(ctx, sq8_index.search_key);
+  ASSERT_TRUE(node_metadata.IsOK());
+  EXPECT_EQ(node_metadata->quantization, redis::VectorQuantization::SQ8);
+  std::string full_vector;
+  auto s = storage_->Get(ctx, ctx.GetReadOptions(), storage_->GetCFHandle(ColumnFamilyID::Search),
+                         sq8_index.search_key.ConstructHnswVector("key5"), &full_vector);
+  ASSERT_TRUE(s.ok());
+
+  // the distances are re-ranked with the full vectors
+  std::vector<double> query_vector = {31.0, 32.0, 23.0};
+  auto result = sq8_index.KnnSearch(ctx, query_vector, 3);
+  ASSERT_TRUE(result.IsOK());
+  std::vector<std::string> expected = {"key5", "key3", "key2"};
+  EXPECT_EQ(GetVectorKeys(result.GetValue()), expected);
+  EXPECT_DOUBLE_EQ(result->front().first, std::sqrt(1.0 * 1 + 8.0 * 8 + 12.0 * 12));
+
+  // the ef_runtime of the query overrides the one of the field
+  result = sq8_index.KnnSearch(ctx, query_vector, 3, 1);
+  ASSERT_TRUE(result.IsOK());
+  EXPECT_EQ(result->size(), 3);
+
+  auto batch = storage_->GetWriteBatchBase();
+  ASSERT_TRUE(sq8_index.DeleteVectorEntry(ctx, "key5", batch).IsOK());
+  ASSERT_TRUE(storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch()).ok());
+  s = storage_->Get(ctx, ctx.GetReadOptions(), storage_->GetCFHandle(ColumnFamilyID::Search),
+                    sq8_index.search_key.ConstructHnswVector("key5"), &full_vector);
+  EXPECT_TRUE(s.IsNotFound());
+}
+
+TEST_F(HnswIndexTest, CheckGraphHealthAndRelinkNode) {
+  engine::Context ctx(storage_.get());
+  std::vector<std::vector<double>> vectors = {{11.0, 12.0, 13.0}, {14.0, 15.0, 16.0}, {17.0, 18.0, 19.0},
+                                              {12.0, 13.0, 14.0}, {30.0, 40.0, 35.0}, {10.0, 9.0, 8.0}};
+  std::vector<uint16_t> levels = {1, 2, 0, 1, 0, 0};
+  for (size_t i = 0; i < vectors.size(); i++) {
+    InsertEntryIntoHnswIndex(ctx, "key" + std::to_string(i + 1), vectors[i], levels[i], hnsw_index.get(),
+                             storage_.get());
+  }
+
+  auto health = hnsw_index->CheckGraphHealth(ctx);
+  ASSERT_TRUE(health.IsOK());
+  EXPECT_EQ(health->nodes, 6);
+  EXPECT_GT(health->AverageDegree(), 0);
+  EXPECT_TRUE(health->unreachable.empty());
+
+  // the edges of key6 are lost, so it can't be found by the searches
+  redis::HnswNode node("key6", 0);
+  node.DecodeNeighbours(ctx, hnsw_index->search_key);
+  ASSERT_FALSE(node.neighbours.empty());
+  auto batch = storage_->GetWriteBatchBase();
+  for (const auto& neighbour : node.neighbours) {
+    ASSERT_TRUE(hnsw_index->RemoveEdge("key6", neighbour, 0, batch).IsOK());
+  }
+  ASSERT_TRUE(storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch()).ok());
+
+  health = hnsw_index->CheckGraphHealth(ctx);
+  ASSERT_TRUE(health.IsOK());
+  EXPECT_EQ(health->unreachable, std::vector<std::string>{"key6"});
+
+  ASSERT_TRUE(hnsw_index->RelinkNode(ctx, "key6").IsOK());
+  health = hnsw_index->CheckGraphHealth(ctx);
+  ASSERT_TRUE(health.IsOK());
+  EXPECT_EQ(health->nodes, 6);
+  EXPECT_TRUE(health->unreachable.empty());
+
+  auto result = hnsw_index->KnnSearch(ctx, {10.0, 9.0, 8.0}, 1);
+  ASSERT_TRUE(result.IsOK());
+  EXPECT_EQ(GetVectorKeys(*result), std::vector<std::string>{"key6"});
+
+  // a removed node is skipped
+  EXPECT_TRUE(hnsw_index->RelinkNode(ctx, "key7").IsOK());
+}
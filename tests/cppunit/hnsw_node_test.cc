@@ -22,6 +22,7 @@
 #include <gtest/gtest.h>
 #include <test_base.h>
 
+#include <cmath>
 #include <iostream>
 #include <memory>
 #include <unordered_set>
@@ -176,3 +177,67 @@ TEST_F(NodeTest, ModifyNeighbours) {
   EXPECT_EQ(node2.neighbours.size(), 1);
   EXPECT_EQ(node2.neighbours[0], "node1");
 }
+
+TEST_F(NodeTest, EncodeAndDecodeFloat32Metadata) {
+  redis::HnswNodeFieldMetadata metadata(2, {0.5, -1.25, 3.0}, redis::VectorType::FLOAT32);
+  std::string encoded;
+  metadata.Encode(&encoded);
+
+  redis::HnswNodeFieldMetadata decoded;
+  Slice input(encoded);
+  ASSERT_TRUE(decoded.Decode(&input).ok());
+  EXPECT_EQ(decoded.num_neighbours, 2);
+  EXPECT_EQ(decoded.vector_type, redis::VectorType::FLOAT32);
+  EXPECT_EQ(decoded.vector, std::vector<double>({0.5, -1.25, 3.0}));
+  EXPECT_DOUBLE_EQ(decoded.norm, std::sqrt(0.25 + 1.5625 + 9.0));
+
+  std::string encoded64;
+  redis::HnswNodeFieldMetadata(2, {0.5, -1.25, 3.0}).Encode(&encoded64);
+  EXPECT_LT(encoded.size(), encoded64.size());
+}
+
+TEST_F(NodeTest, DecodeLegacyMetadata) {
+  std::string encoded;
+  PutFixed16(&encoded, 1);
+  PutFixed16(&encoded, 2);
+  PutDouble(&encoded, 3);
+  PutDouble(&encoded, 4);
+
+  redis::HnswNodeFieldMetadata decoded;
+  Slice input(encoded);
+  ASSERT_TRUE(decoded.Decode(&input).ok());
+  EXPECT_EQ(decoded.num_neighbours, 1);
+  EXPECT_EQ(decoded.vector_type, redis::VectorType::FLOAT64);
+  EXPECT_EQ(decoded.vector, std::vector<double>({3, 4}));
+  EXPECT_LT(decoded.norm, 0);
+}
+
+TEST_F(NodeTest, EncodeAndDecodeSQ8Metadata) {
+  std::vector<double> vector = {-1.0, 0.3, 2.5, 7.0};
+  redis::HnswNodeFieldMetadata metadata(1, vector, redis::VectorType::FLOAT32, redis::VectorQuantization::SQ8);
+  std::string encoded;
+  metadata.Encode(&encoded);
+
+  redis::HnswNodeFieldMetadata decoded;
+  Slice input(encoded);
+  ASSERT_TRUE(decoded.Decode(&input).ok());
+  EXPECT_EQ(decoded.num_neighbours, 1);
+  EXPECT_EQ(decoded.vector_type, redis::VectorType::FLOAT32);
+  EXPECT_EQ(decoded.quantization, redis::VectorQuantization::SQ8);
+  EXPECT_DOUBLE_EQ(decoded.norm, redis::VectorNorm(vector.data(), vector.size()));
+  ASSERT_EQ(decoded.vector.size(), vector.size());
+  double step = (7.0 - -1.0) / 255;
+  for (size_t i = 0; i < vector.size(); i++) {
+    EXPECT_NEAR(decoded.vector[i], vector[i], step / 2 + 1e-9);
+  }
+
+  // encoding the decoded approximations again keeps them
+  std::string reencoded;
+  decoded.Encode(&reencoded);
+  redis::HnswNodeFieldMetadata redecoded;
+  input = Slice(reencoded);
+  ASSERT_TRUE(redecoded.Decode(&input).ok());
+  for (size_t i = 0; i < vector.size(); i++) {
+    EXPECT_NEAR(redecoded.vector[i], decoded.vector[i], 1e-9);
+  }
+}
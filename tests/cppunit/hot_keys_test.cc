@@ -0,0 +1,81 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "stats/hot_keys.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+TEST(HotKeys, TopKeys) {
+  HotKeys hot_keys;
+  for (int i = 0; i < 1000; i++) {
+    hot_keys.Record("ns1", "cold" + std::to_string(i), false);
+  }
+  for (int i = 0; i < 100; i++) {
+    hot_keys.Record("ns1", "hot_read", false);
+    hot_keys.Record("ns2", "hot_write", true);
+    if (i % 2 == 0) hot_keys.Record("ns1", "warm", true);
+  }
+
+  auto entries = hot_keys.GetTop(3, "");
+  ASSERT_EQ(entries.size(), 3);
+  ASSERT_GE(entries[0].writes + entries[0].reads, 100);
+  ASSERT_EQ(entries[2].key, "warm");
+  ASSERT_GE(entries[2].writes, 50);
+
+  for (const auto &entry : entries) {
+    if (entry.key == "hot_read") {
+      ASSERT_EQ(entry.ns, "ns1");
+      ASSERT_GE(entry.reads, 100);
+    } else if (entry.key == "hot_write") {
+      ASSERT_EQ(entry.ns, "ns2");
+      ASSERT_GE(entry.writes, 100);
+    }
+  }
+
+  entries = hot_keys.GetTop(10, "ns2");
+  ASSERT_EQ(entries.size(), 1);
+  ASSERT_EQ(entries[0].key, "hot_write");
+
+  hot_keys.Decay();
+  entries = hot_keys.GetTop(1, "ns2");
+  ASSERT_EQ(entries.size(), 1);
+  ASSERT_GE(entries[0].writes, 50);
+  ASSERT_LT(entries[0].writes, 100);
+}
+
+TEST(HotKeys, EstimateAccesses) {
+  HotKeys hot_keys;
+  ASSERT_EQ(hot_keys.EstimateAccesses("ns1", "key"), 0);
+  ASSERT_EQ(hot_keys.EstimateLastAccess("ns1", "key"), 0);
+
+  for (int i = 0; i < 10; i++) {
+    hot_keys.Record("ns1", "key", i % 2 == 0);
+  }
+  ASSERT_GE(hot_keys.EstimateAccesses("ns1", "key"), 10);
+  ASSERT_GT(hot_keys.EstimateLastAccess("ns1", "key"), 0);
+  ASSERT_EQ(hot_keys.EstimateAccesses("ns2", "key"), 0);
+
+  hot_keys.Decay();
+  ASSERT_GE(hot_keys.EstimateAccesses("ns1", "key"), 5);
+  ASSERT_LT(hot_keys.EstimateAccesses("ns1", "key"), 10);
+  ASSERT_GT(hot_keys.EstimateLastAccess("ns1", "key"), 0);
+}
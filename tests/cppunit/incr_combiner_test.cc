@@ -0,0 +1,101 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+#include "storage/incr_combiner.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <climits>
+#include <thread>
+
+#include "test_base.h"
+#include "types/redis_hash.h"
+#include "types/redis_string.h"
+
+class IncrCombinerTest : public TestBase {
+ protected:
+  IncrCombinerTest() {
+    config_.incr_combining = true;
+    string_ = std::make_unique<redis::String>(storage_.get(), "incr_combiner_ns");
+    hash_ = std::make_unique<redis::Hash>(storage_.get(), "incr_combiner_ns");
+  }
+
+  std::unique_ptr<redis::String> string_;
+  std::unique_ptr<redis::Hash> hash_;
+};
+
+TEST_F(IncrCombinerTest, ConcurrentIncrBy) {
+  constexpr int kThreads = 8, kIncrsPerThread = 200;
+  std::vector<std::vector<int64_t>> results(kThreads);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; i++) {
+    threads.emplace_back([&, i] {
+      for (int j = 0; j < kIncrsPerThread; j++) {
+        engine::Context ctx(storage_.get());
+        int64_t ret = 0;
+        auto s = string_->IncrBy(ctx, "counter", 1, &ret);
+        ASSERT_TRUE(s.ok());
+        results[i].push_back(ret);
+        s = hash_->IncrBy(ctx, "hash", "field", 2, &ret);
+        ASSERT_TRUE(s.ok());
+      }
+    });
+  }
+  for (auto &t : threads) t.join();
+
+  // every increment got its own result
+  std::vector<int64_t> all;
+  for (const auto &r : results) all.insert(all.end(), r.begin(), r.end());
+  std::sort(all.begin(), all.end());
+  for (size_t i = 0; i < all.size(); i++) {
+    EXPECT_EQ(all[i], static_cast<int64_t>(i + 1));
+  }
+
+  engine::Context ctx(storage_.get());
+  std::string value;
+  ASSERT_TRUE(string_->Get(ctx, "counter", &value).ok());
+  EXPECT_EQ(value, std::to_string(kThreads * kIncrsPerThread));
+  ASSERT_TRUE(hash_->Get(ctx, "hash", "field", &value).ok());
+  EXPECT_EQ(value, std::to_string(2 * kThreads * kIncrsPerThread));
+}
+
+TEST_F(IncrCombinerTest, OverflowFailsOnlyItsOwnIncrement) {
+  engine::IncrCombiner<int64_t> combiner(storage_->GetLockManager());
+  using Op = engine::IncrCombiner<int64_t>::Op;
+  int64_t counter = LLONG_MAX - 1;
+  auto apply = [&](const std::vector<Op *> &ops) -> rocksdb::Status {
+    for (auto *op : ops) {
+      if (op->increment > LLONG_MAX - counter) {
+        op->status = rocksdb::Status::InvalidArgument("increment or decrement would overflow");
+        continue;
+      }
+      counter += op->increment;
+      op->result = counter;
+    }
+    return rocksdb::Status::OK();
+  };
+
+  int64_t ret = 0;
+  auto s = combiner.IncrBy("key", "key", true, 2, &ret, apply);
+  EXPECT_TRUE(s.IsInvalidArgument());
+  s = combiner.IncrBy("key", "key", true, 1, &ret, apply);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(ret, LLONG_MAX);
+}
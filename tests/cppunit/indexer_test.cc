@@ -23,8 +23,13 @@
 #include <gtest/gtest.h>
 #include <test_base.h>
 
+#include <chrono>
 #include <memory>
+#include <thread>
 
+#include "db_util.h"
+#include "search/index_builder.h"
+#include "search/index_delta_applier.h"
 #include "search/index_info.h"
 #include "search/search_encoding.h"
 #include "storage/redis_metadata.h"
@@ -286,6 +291,92 @@ TEST_F(IndexerTest, JsonTagBuildIndex) {
   }
 }
 
+TEST_F(IndexerTest, JsonTagBackgroundBuild) {
+  redis::Json db(storage_.get(), ns);
+  auto cfhandler = storage_->GetCFHandle(ColumnFamilyID::Search);
+  auto idxname = "jsontest";
+
+  std::vector<std::string> keys;
+  for (int i = 0; i < 1000; i++) {
+    keys.emplace_back("idxtestjson:build" + std::to_string(i));
+    auto s_set = db.Set(*ctx_, keys.back(), "$", R"({"x": "food,kitChen", "y": )" + std::to_string(i) + "}");
+    ASSERT_TRUE(s_set.ok());
+  }
+
+  redis::IndexBuilder builder(indexer.updater_list[1]);
+  ASSERT_TRUE(builder.Start({}).IsOK());
+  while (builder.IsRunning()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  ASSERT_TRUE(builder.IsDone());
+  ASSERT_EQ(builder.GetFailures(), 0U);
+  ASSERT_EQ(builder.GetIndexedKeys(), keys.size());
+  ASSERT_EQ(builder.GetPercentIndexed(), 1.0);
+
+  for (const auto &key : keys) {
+    std::string val;
+    auto index_key = redis::SearchKey(ns, idxname, "$.x").ConstructTagFieldData("kitchen", key);
+    ASSERT_TRUE(storage_->Get(*ctx_, ctx_->DefaultMultiGetOptions(), cfhandler, index_key, &val).ok());
+  }
+
+  // the progress is removed once the build completes
+  std::string val;
+  auto progress_key = redis::SearchKey(ns, idxname).ConstructIndexBuildProgress();
+  ASSERT_TRUE(storage_->Get(*ctx_, ctx_->DefaultMultiGetOptions(), cfhandler, progress_key, &val).IsNotFound());
+}
+
+TEST_F(IndexerTest, JsonTagAsyncDelta) {
+  redis::Json db(storage_.get(), ns);
+  auto cfhandler = storage_->GetCFHandle(ColumnFamilyID::Search);
+  auto key = "idxtestjson:async";
+  auto idxname = "jsontest";
+
+  redis::IndexDeltaApplier applier(indexer.updater_list[1]);
+  ASSERT_TRUE(applier.Start().IsOK());
+
+  for (const auto *value : {R"({"x": "food,kitChen"})", R"({"x": "food,Beauty"})"}) {
+    auto record = indexer.Record(*ctx_, key, ns);
+    ASSERT_TRUE(record.IsOK());
+    ASSERT_TRUE(db.Set(*ctx_, key, "$", value).ok());
+    ASSERT_TRUE(applier.Append(*ctx_, key, record->fields).IsOK());
+  }
+  ASSERT_TRUE(applier.Wait(std::chrono::seconds(10)));
+  ASSERT_EQ(applier.GetPendingDeltas(), 0U);
+  ASSERT_EQ(applier.GetFailures(), 0U);
+
+  std::string val;
+  for (const auto *tag : {"food", "beauty"}) {
+    auto index_key = redis::SearchKey(ns, idxname, "$.x").ConstructTagFieldData(tag, key);
+    ASSERT_TRUE(storage_->Get(*ctx_, ctx_->DefaultMultiGetOptions(), cfhandler, index_key, &val).ok());
+  }
+  auto index_key = redis::SearchKey(ns, idxname, "$.x").ConstructTagFieldData("kitchen", key);
+  ASSERT_TRUE(storage_->Get(*ctx_, ctx_->DefaultMultiGetOptions(), cfhandler, index_key, &val).IsNotFound());
+
+  // the applied deltas are removed
+  util::UniqueIterator iter(*ctx_, ctx_->DefaultScanOptions(), ColumnFamilyID::Search);
+  auto delta_prefix = redis::SearchKey(ns, idxname).ConstructIndexDeltaPrefix();
+  iter->Seek(delta_prefix);
+  ASSERT_FALSE(iter->Valid() && iter->key().starts_with(delta_prefix));
+}
+
+TEST(IndexDeltaTest, EncodeAndDecode) {
+  redis::IndexUpdater::FieldValues original;
+  original.emplace("tag", T("a,b"));
+  original.emplace("num", kqir::MakeValue<kqir::Numeric>(1.5));
+  original.emplace("vec", kqir::MakeValue<kqir::NumericArray>(kqir::NumericArray{1, 2, 3}));
+
+  std::string encoded;
+  redis::EncodeIndexDelta("key", original, &encoded);
+
+  std::string key;
+  redis::IndexUpdater::FieldValues decoded;
+  ASSERT_TRUE(redis::DecodeIndexDelta(encoded, &key, &decoded).IsOK());
+  ASSERT_EQ(key, "key");
+  ASSERT_EQ(decoded, original);
+
+  ASSERT_FALSE(redis::DecodeIndexDelta(Slice(encoded.data(), encoded.size() - 1), &key, &decoded).IsOK());
+}
+
 TEST_F(IndexerTest, JsonHnswVector) {
   redis::Json db(storage_.get(), ns);
   auto cfhandler = storage_->GetCFHandle(ColumnFamilyID::Search);
@@ -207,6 +207,8 @@ static IndexMap MakeIndexMap() {
   auto f7 = FieldInfo("v2", std::move(hnsw_field_meta));
   f7.metadata->noindex = true;
 
+  auto f8 = FieldInfo("x1", std::make_unique<redis::TextFieldMetadata>());
+
   auto ia = std::make_unique<IndexInfo>("ia", redis::IndexMetadata(), "");
   ia->Add(std::move(f1));
   ia->Add(std::move(f2));
@@ -215,6 +217,7 @@ static IndexMap MakeIndexMap() {
   ia->Add(std::move(f5));
   ia->Add(std::move(f6));
   ia->Add(std::move(f7));
+  ia->Add(std::move(f8));
 
   IndexMap res;
   res.Insert(std::move(ia));
@@ -243,6 +246,15 @@ TEST(IRPassTest, IndexSelection) {
             "project *: (top-n sort n3, asc, 0, 1: full-scan ia)");
   ASSERT_EQ(PassManager::Execute(passes, ParseS(sc, "select * from ia where n2 = 1 order by n1"))->Dump(),
             "project *: (filter n2 = 1: numeric-scan n1, [-inf, inf), asc)");
+  ASSERT_EQ(
+      PassManager::Execute(passes, ParseS(sc, "select * from ia where n1 >= 1 order by n1 desc limit 10"))->Dump(),
+      "project *: (limit 0, 10: numeric-scan n1, [1, inf), desc)");
+  ASSERT_EQ(PassManager::Execute(passes, ParseS(sc, "select * from ia where n1 >= 1 and n2 = 1 order by n1 limit 10"))
+                ->Dump(),
+            "project *: (limit 0, 10: (filter n2 = 1: numeric-scan n1, [1, inf), asc))");
+  ASSERT_EQ(
+      PassManager::Execute(passes, ParseS(sc, "select * from ia where n1 < 1 or n1 >= 5 order by n1 desc"))->Dump(),
+      "project *: (merge numeric-scan n1, [5, inf), desc, numeric-scan n1, [-inf, 1), desc)");
 
   ASSERT_EQ(PassManager::Execute(passes, ParseS(sc, "select * from ia where n1 = 1"))->Dump(),
             fmt::format("project *: numeric-scan n1, [1, {}), asc", IntervalSet::NextNum(1)));
@@ -263,7 +275,15 @@ TEST(IRPassTest, IndexSelection) {
   ASSERT_EQ(PassManager::Execute(passes, ParseS(sc, "select * from ia where n1 = 1 and n3 = 2"))->Dump(),
             fmt::format("project *: (filter n3 = 2: numeric-scan n1, [1, {}), asc)", IntervalSet::NextNum(1)));
   ASSERT_EQ(PassManager::Execute(passes, ParseS(sc, "select * from ia where n1 = 1 and t1 hastag \"a\""))->Dump(),
-            fmt::format("project *: (filter t1 hastag \"a\": numeric-scan n1, [1, {}), asc)", IntervalSet::NextNum(1)));
+            fmt::format("project *: (intersect tag-scan t1, a, numeric-scan n1, [1, {}), asc)",
+                        IntervalSet::NextNum(1)));
+  ASSERT_EQ(
+      PassManager::Execute(passes, ParseS(sc, "select * from ia where n1 = 1 and t1 hastag \"a\" and n2 >= 2"))->Dump(),
+      fmt::format("project *: (filter n2 >= 2: (intersect tag-scan t1, a, numeric-scan n1, [1, {}), asc))",
+                  IntervalSet::NextNum(1)));
+  ASSERT_EQ(
+      PassManager::Execute(passes, ParseS(sc, "select * from ia where t1 hastag \"a\" and t1 hastag \"b\""))->Dump(),
+      "project *: (intersect tag-scan t1, a, tag-scan t1, b)");
   ASSERT_EQ(PassManager::Execute(passes, ParseS(sc, "select * from ia where t1 hastag \"a\""))->Dump(),
             "project *: tag-scan t1, a");
   ASSERT_EQ(
@@ -277,6 +297,10 @@ TEST(IRPassTest, IndexSelection) {
             "project *: (limit 0, 5: hnsw-vector-knn-scan v1, [3.000000, 1.000000, 2.000000], 5)");
   ASSERT_EQ(PassManager::Execute(passes, ParseS(sc, "select * from ia order by v1 <-> [3,1,2] limit 2, 7"))->Dump(),
             "project *: (limit 2, 7: hnsw-vector-knn-scan v1, [3.000000, 1.000000, 2.000000], 9)");
+  ASSERT_EQ(PassManager::Execute(
+                passes, ParseS(sc, "select * from ia where t1 hastag \"a\" order by v1 <-> [3,1,2] limit 5"))
+                ->Dump(),
+            "project *: (limit 0, 5: hnsw-vector-knn-scan v1, [3.000000, 1.000000, 2.000000], 5, (tag-scan t1, a))");
   ASSERT_EQ(PassManager::Execute(passes, ParseS(sc, "select * from ia where v2 <-> [3,1,2] < 5"))->Dump(),
             "project *: (filter v2 <-> [3.000000, 1.000000, 2.000000] < 5: full-scan ia)");
   ASSERT_EQ(PassManager::Execute(passes, ParseS(sc, "select * from ia where n1 >= 1 and v1 <-> [3,1,2] < 5"))->Dump(),
@@ -306,6 +330,14 @@ TEST(IRPassTest, IndexSelection) {
   ASSERT_EQ(
       PassManager::Execute(passes, ParseS(sc, "select * from ia where t1 hastag \"a\" or t1 hastag \"b\""))->Dump(),
       "project *: (merge tag-scan t1, a, (filter not t1 hastag \"a\": tag-scan t1, b))");
+  ASSERT_EQ(PassManager::Execute(passes, ParseS(sc, "select * from ia where x1 match \"Quick foxes\""))->Dump(),
+            "project *: text-scan x1, quick fox");
+  ASSERT_EQ(
+      PassManager::Execute(passes, ParseS(sc, "select * from ia where x1 matchphrase \"quick fox\" and n1 >= 1"))
+          ->Dump(),
+      "project *: (filter n1 >= 1: text-scan x1, \"quick fox\")");
+  ASSERT_EQ(PassManager::Execute(passes, ParseS(sc, "select * from ia where not x1 match \"fox\""))->Dump(),
+            "project *: (filter not x1 match \"fox\": full-scan ia)");
 
   ASSERT_EQ(
       PassManager::Execute(
@@ -313,3 +345,24 @@ TEST(IRPassTest, IndexSelection) {
           ->Dump(),
       "project *: (filter n3 = 1: (merge numeric-scan n1, [1, 2), asc, numeric-scan n1, [3, 4), asc))");
 }
+
+TEST(IRPassTest, IndexSelectionWithStats) {
+  auto index_map = MakeIndexMap();
+  auto sc = SemaChecker(index_map);
+  auto& fields = index_map.Find("ia", "")->second->fields;
+
+  // n1 is 1 in all the documents, one of them has tag "a" and the others have tag "b"
+  for (int i = 0; i < 100; i++) {
+    auto& t1 = fields.at("t1");
+    t1.stats->Update(t1.metadata.get(), {}, StringArray{i == 0 ? "a" : "b"});
+    auto& n1 = fields.at("n1");
+    n1.stats->Update(n1.metadata.get(), {}, Numeric(1));
+  }
+
+  auto passes = PassManager::Default();
+  ASSERT_EQ(PassManager::Execute(passes, ParseS(sc, "select * from ia where n1 = 1 and t1 hastag \"c\""))->Dump(),
+            fmt::format("project *: (intersect tag-scan t1, c, numeric-scan n1, [1, {}), asc)",
+                        IntervalSet::NextNum(1)));
+  ASSERT_EQ(PassManager::Execute(passes, ParseS(sc, "select * from ia where n1 >= 5 and t1 hastag \"b\""))->Dump(),
+            "project *: (filter t1 hastag \"b\": numeric-scan n1, [5, inf), asc)");
+}
@@ -101,7 +101,11 @@ TEST(SemaCheckerTest, Simple) {
     ASSERT_EQ(checker.Check(Parse("select f5 from ia order by f5 <-> [3.6,4.7,5.6] limit 5")->get()).Msg(),
               "field `f5` is marked as NOINDEX and cannot be used for KNN search");
     ASSERT_EQ(checker.Check(Parse("select f5 from ia where f2 = 1 order by f4 <-> [3.6,4.7,5.6] limit 5")->get()).Msg(),
-              "KNN search cannot be combined with other query expressions");
+              "ok");
+    ASSERT_EQ(
+        checker.Check(Parse("select f5 from ia where f4 <-> [1,2,3] < 1 order by f4 <-> [3.6,4.7,5.6] limit 5")->get())
+            .Msg(),
+        "the filter of a KNN search cannot contain vector queries");
     ASSERT_EQ(checker.Check(Parse("select f5 from ia where true order by f4 <-> [3.6,4.7,5.6] limit 5")->get()).Msg(),
               "ok");
     ASSERT_EQ(checker.Check(Parse("select f5 from ia where false order by f4 <-> [3.6,4.7,5.6] limit 5")->get()).Msg(),
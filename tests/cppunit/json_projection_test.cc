@@ -0,0 +1,60 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "types/json_projection.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+TEST(JsonProjection, ParseDefinitePath) {
+  auto steps = ParseDefiniteJsonPath("$.a['b c'][12].d");
+  ASSERT_TRUE(steps.has_value());
+  ASSERT_EQ(*steps, (std::vector<JsonPathStep>{"a", "b c", size_t(12), "d"}));
+
+  ASSERT_EQ(ParseDefiniteJsonPath("$"), std::vector<JsonPathStep>{});
+
+  for (const auto &path : {"a", "$..a", "$.*", "$[*]", "$[-1]", "$[0:2]", "$[0,1]", "$.a[?(@.b)]", "$.length", "$.",
+                           "$['a", "$[1"}) {
+    ASSERT_FALSE(ParseDefiniteJsonPath(path).has_value()) << path;
+  }
+}
+
+TEST(JsonProjection, ProjectMatchesQuery) {
+  auto doc = JsonValue::FromString(R"({"a":{"b c":[1,{"d":"x"},[2,3]],"e":null},"f":[{"g":1}],"h":"s"})").GetValue();
+  std::string json_bytes = doc.Dump().GetValue();
+  std::string cbor_bytes = doc.DumpCBOR().GetValue();
+
+  for (const auto &path : {"$", "$.a", "$.a['b c'][1].d", "$.a['b c'][2][1]", "$.a.e", "$.f[0].g", "$.h", "$.x",
+                           "$.a['b c'][3]", "$.h[0]", "$[0]", "$.f.g"}) {
+    auto expected = doc.Get(path).GetValue();
+    for (const auto &[format, bytes] :
+         {std::pair{JsonStorageFormat::JSON, json_bytes}, std::pair{JsonStorageFormat::CBOR, cbor_bytes}}) {
+      auto steps = ParseDefiniteJsonPath(path);
+      ASSERT_TRUE(steps.has_value()) << path;
+      auto res = ProjectJsonPath(bytes, format, *steps);
+      ASSERT_TRUE(res) << res.Msg();
+      ASSERT_EQ(res->value, expected.value) << path;
+    }
+  }
+
+  ASSERT_FALSE(ProjectJsonPath("{\"a\":", JsonStorageFormat::JSON, {"a"}));
+}
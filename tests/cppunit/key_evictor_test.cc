@@ -0,0 +1,98 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "storage/key_evictor.h"
+
+#include <gtest/gtest.h>
+
+#include "test_base.h"
+#include "types/redis_string.h"
+
+class KeyEvictorTest : public TestBase {
+ protected:
+  KeyEvictorTest() {
+    string_ = std::make_unique<redis::String>(storage_.get(), "evictor_ns");
+    config_.max_db_size = 1;
+    evictor_ = std::make_unique<engine::KeyEvictor>(storage_.get(), &hot_keys_, [this] { return total_size_; });
+  }
+
+  ~KeyEvictorTest() override {
+    config_.max_db_size = 0;
+    config_.max_db_size_policy = kMaxDBSizeNoEviction;
+  }
+
+  void setKeys(int n) {
+    for (int i = 0; i < n; i++) {
+      auto s = string_->Set(*ctx_, "key" + std::to_string(i), "value");
+      ASSERT_TRUE(s.ok());
+    }
+  }
+
+  HotKeys hot_keys_;
+  std::unique_ptr<redis::String> string_;
+  std::unique_ptr<engine::KeyEvictor> evictor_;
+  uint64_t total_size_ = 0;
+};
+
+TEST_F(KeyEvictorTest, EvictUntilLowWatermark) {
+  config_.max_db_size_policy = kMaxDBSizeAllKeysLFU;
+  setKeys(10);
+
+  total_size_ = 2 * GiB;
+  auto evicted = evictor_->Evict();
+  ASSERT_TRUE(evicted);
+  EXPECT_GT(*evicted, 0);
+  EXPECT_FALSE(storage_->ReachedDBSizeLimit());
+
+  // the size is measured on each call, the round stops below the low watermark
+  total_size_ = GiB / 2;
+  evicted = evictor_->Evict();
+  ASSERT_TRUE(evicted);
+  EXPECT_EQ(*evicted, 0);
+
+  // the next round waits for a compaction
+  total_size_ = 2 * GiB;
+  evicted = evictor_->Evict();
+  ASSERT_TRUE(evicted);
+  EXPECT_EQ(*evicted, 0);
+  EXPECT_FALSE(storage_->ReachedDBSizeLimit());
+}
+
+TEST_F(KeyEvictorTest, RejectWritesIfNothingToEvict) {
+  // no key has an expire time
+  config_.max_db_size_policy = kMaxDBSizeVolatileTTL;
+  setKeys(10);
+
+  total_size_ = 2 * GiB;
+  auto evicted = evictor_->Evict();
+  ASSERT_TRUE(evicted);
+  EXPECT_EQ(*evicted, 0);
+  EXPECT_TRUE(storage_->ReachedDBSizeLimit());
+  int exists = 0;
+  auto s = string_->Exists(*ctx_, {"key0"}, &exists);
+  ASSERT_TRUE(s.ok());
+  EXPECT_EQ(exists, 1);
+
+  // the writes are accepted again once the DB is below max-db-size
+  total_size_ = GiB / 2;
+  evicted = evictor_->Evict();
+  ASSERT_TRUE(evicted);
+  EXPECT_FALSE(storage_->ReachedDBSizeLimit());
+}
@@ -0,0 +1,105 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+#include "storage/lazy_free.h"
+
+#include <gtest/gtest.h>
+
+#include "test_base.h"
+#include "time_util.h"
+#include "types/redis_hash.h"
+#include "types/redis_zset.h"
+
+class LazyFreeTest : public TestBase {
+ protected:
+  LazyFreeTest() {
+    hash_ = std::make_unique<redis::Hash>(storage_.get(), "lazy_free_ns");
+    zset_ = std::make_unique<redis::ZSet>(storage_.get(), "lazy_free_ns");
+  }
+
+  size_t countEntries(ColumnFamilyID cf) {
+    size_t n = 0;
+    auto iter = util::UniqueIterator(*ctx_, ctx_->DefaultScanOptions(), cf);
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) n++;
+    return n;
+  }
+
+  std::unique_ptr<redis::Hash> hash_;
+  std::unique_ptr<redis::ZSet> zset_;
+};
+
+TEST_F(LazyFreeTest, UnlinkRemovesSubKeys) {
+  uint64_t ret = 0;
+  for (int i = 0; i < 10; i++) {
+    auto s = hash_->Set(*ctx_, "hash", "field" + std::to_string(i), "value", &ret);
+    ASSERT_TRUE(s.ok());
+  }
+  std::vector<MemberScore> members{{"a", 1}, {"b", 2}};
+  auto s = zset_->Add(*ctx_, "zset", ZAddFlags::Default(), &members, &ret);
+  ASSERT_TRUE(s.ok());
+  s = hash_->Set(*ctx_, "live_hash", "field", "value", &ret);
+  ASSERT_TRUE(s.ok());
+
+  auto queue = storage_->GetLazyFreeQueue();
+  uint64_t freed_keys = queue->GetFreedKeys();
+  std::vector<Slice> keys{"hash", "zset", "not_exist"};
+  uint64_t deleted_cnt = 0;
+  s = hash_->MDel(*ctx_, keys, &deleted_cnt, true);
+  ASSERT_TRUE(s.ok());
+  EXPECT_EQ(deleted_cnt, 2);
+  EXPECT_EQ(queue->GetPendingKeys(), 2);
+
+  ASSERT_TRUE(storage_->LazyFree().IsOK());
+  ctx_->RefreshLatestSnapshot();
+  EXPECT_EQ(queue->GetPendingKeys(), 0);
+  EXPECT_EQ(queue->GetPendingBytes(), 0);
+  EXPECT_EQ(queue->GetFreedKeys(), freed_keys + 2);
+
+  // Only the field of the live hash is left
+  EXPECT_EQ(countEntries(ColumnFamilyID::PrimarySubkey), 1);
+  EXPECT_EQ(countEntries(ColumnFamilyID::SecondarySubkey), 0);
+  std::string value;
+  s = hash_->Get(*ctx_, "live_hash", "field", &value);
+  EXPECT_TRUE(s.ok() && value == "value");
+}
+
+TEST_F(LazyFreeTest, UnlinkRemovesFieldExpireIndex) {
+  uint64_t ret = 0;
+  for (int i = 0; i < 10; i++) {
+    auto s = hash_->Set(*ctx_, "hash", "field" + std::to_string(i), "value", &ret);
+    ASSERT_TRUE(s.ok());
+  }
+  std::vector<int64_t> results;
+  auto s = hash_->ExpireFields(*ctx_, "hash", util::GetTimeStampMS() + 100000, redis::Hash::FieldExpireCondition::kNone,
+                               {"field0", "field1"}, &results);
+  ASSERT_TRUE(s.ok());
+  ctx_->RefreshLatestSnapshot();
+  ASSERT_GT(countEntries(ColumnFamilyID::SecondarySubkey), 0);
+
+  uint64_t deleted_cnt = 0;
+  s = hash_->MDel(*ctx_, {"hash"}, &deleted_cnt, true);
+  ASSERT_TRUE(s.ok());
+  EXPECT_EQ(deleted_cnt, 1);
+
+  // The expire times of the fields are indexed in the secondary subkeys, which go with the fields
+  ASSERT_TRUE(storage_->LazyFree().IsOK());
+  ctx_->RefreshLatestSnapshot();
+  EXPECT_EQ(countEntries(ColumnFamilyID::PrimarySubkey), 0);
+  EXPECT_EQ(countEntries(ColumnFamilyID::SecondarySubkey), 0);
+}
@@ -0,0 +1,98 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "common/lock_manager.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+// try_lock on a mutex held by the calling thread is undefined, so the stripe is probed from another thread
+static bool IsLocked(LockManager *lock_mgr, const std::string &key) {
+  bool locked = false;
+  std::thread([&] {
+    auto mutex = lock_mgr->Get(key);
+    locked = !mutex->try_lock();
+    if (!locked) mutex->unlock();
+  }).join();
+  return locked;
+}
+
+TEST(LockManager, MultiLockDuplicateKeys) {
+  // With only two stripes, most of these keys share a stripe
+  LockManager lock_mgr(1);
+  std::vector<std::string> keys;
+  for (int i = 0; i < 20; i++) keys.emplace_back("key" + std::to_string(i % 10));
+
+  {
+    MultiLockGuard guard(&lock_mgr, keys);
+    for (const auto &key : keys) {
+      ASSERT_TRUE(IsLocked(&lock_mgr, key));
+    }
+    MultiLockGuard moved(std::move(guard));
+  }
+  for (const auto &key : keys) {
+    ASSERT_FALSE(IsLocked(&lock_mgr, key));
+  }
+}
+
+TEST(LockManager, Contentions) {
+  LockManager lock_mgr(4);
+  ASSERT_EQ(0, lock_mgr.GetContentions());
+
+  uint64_t counter = 0;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&] {
+      for (int j = 0; j < 10000; j++) {
+        LockGuard guard(&lock_mgr, std::string("key"));
+        counter++;
+      }
+    });
+  }
+  for (auto &t : threads) t.join();
+
+  ASSERT_EQ(40000, counter);
+  auto hot = lock_mgr.GetHotStripes(5);
+  ASSERT_LE(hot.size(), 1);
+  uint64_t contentions = hot.empty() ? 0 : hot[0].second;
+  ASSERT_EQ(contentions, lock_mgr.GetContentions());
+}
+
+TEST(LockManager, TxnLockGuardPinsStripes) {
+  LockManager lock_mgr(4);
+  std::vector<std::string> keys{"a", "b", "c"};
+  {
+    TxnLockGuard txn_guard(&lock_mgr, keys);
+    {
+      // Both would deadlock if they locked the stripes held by the transaction again
+      LockGuard guard(&lock_mgr, std::string("a"));
+      MultiLockGuard multi_guard(&lock_mgr, std::vector<std::string>{"b", "c", "d"});
+      ASSERT_TRUE(IsLocked(&lock_mgr, "d"));
+    }
+    // The nested guards must not release the stripes of the transaction
+    ASSERT_TRUE(IsLocked(&lock_mgr, "a"));
+  }
+  for (const auto &key : keys) {
+    ASSERT_FALSE(IsLocked(&lock_mgr, key));
+  }
+}
@@ -22,16 +22,44 @@
 
 #include <gtest/gtest.h>
 
+#include <thread>
+#include <vector>
+
 TEST(LogCollector, PushEntry) {
   LogCollector<PerfEntry> perf_log;
   perf_log.SetMaxEntries(1);
-  perf_log.PushEntry(std::make_unique<PerfEntry>());
-  perf_log.PushEntry(std::make_unique<PerfEntry>());
+  perf_log.PushEntry(PerfEntry{});
+  perf_log.PushEntry(PerfEntry{});
   EXPECT_EQ(perf_log.Size(), 1);
   perf_log.SetMaxEntries(2);
-  perf_log.PushEntry(std::make_unique<PerfEntry>());
-  perf_log.PushEntry(std::make_unique<PerfEntry>());
+  perf_log.PushEntry(PerfEntry{});
+  perf_log.PushEntry(PerfEntry{});
   EXPECT_EQ(perf_log.Size(), 2);
   perf_log.Reset();
   EXPECT_EQ(perf_log.Size(), 0);
 }
+
+TEST(LogCollector, ConcurrentPush) {
+  LogCollector<PerfEntry> perf_log;
+  perf_log.SetMaxEntries(16);
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&perf_log] {
+      for (int j = 0; j < 1000; j++) {
+        PerfEntry entry;
+        entry.cmd_name = "get";
+        perf_log.PushEntry(std::move(entry));
+      }
+    });
+  }
+  for (int i = 0; i < 10; i++) perf_log.GetLatestEntries(0);
+  for (auto &thread : threads) thread.join();
+
+  EXPECT_EQ(perf_log.Size(), 16);
+  // the latest entries are taken from the newest one, and the ids are kept after the ring is resized
+  perf_log.SetMaxEntries(4);
+  EXPECT_EQ(perf_log.Size(), 4);
+  auto entries = perf_log.GetLatestEntries(1);
+  EXPECT_NE(entries.find(":4000\r\n"), std::string::npos);
+}
@@ -0,0 +1,107 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "storage/metadata_cache.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+TEST(MetadataCache, LookupAndErase) {
+  engine::MetadataCache cache(1024 * 1024);
+  std::string value;
+
+  ASSERT_FALSE(cache.Lookup("key", &value));
+  cache.Insert("key", "value", cache.GetGeneration("key"));
+  ASSERT_TRUE(cache.Lookup("key", &value));
+  ASSERT_EQ("value", value);
+  ASSERT_EQ(1, cache.GetHits());
+  ASSERT_EQ(1, cache.GetMisses());
+
+  cache.Erase("key");
+  ASSERT_FALSE(cache.Lookup("key", &value));
+  ASSERT_EQ(0, cache.GetUsage());
+}
+
+TEST(MetadataCache, RacingWriteDropsInsert) {
+  engine::MetadataCache cache(1024 * 1024);
+  std::string value;
+
+  // A write between reading the DB and inserting, the read value may be stale
+  auto generation = cache.GetGeneration("key");
+  cache.Erase("key");
+  cache.Insert("key", "stale", generation);
+  ASSERT_FALSE(cache.Lookup("key", &value));
+}
+
+TEST(MetadataCache, Capacity) {
+  size_t capacity = engine::MetadataCache::kShards * 1024;
+  engine::MetadataCache cache(capacity);
+  for (int i = 0; i < 10000; i++) {
+    std::string key = "key" + std::to_string(i);
+    cache.Insert(key, "value", cache.GetGeneration(key));
+  }
+  ASSERT_GT(cache.GetUsage(), 0);
+  ASSERT_LE(cache.GetUsage(), capacity);
+
+  std::string value;
+  ASSERT_TRUE(cache.Lookup("key9999", &value));
+  ASSERT_FALSE(cache.Lookup("key0", &value));
+
+  cache.Clear();
+  ASSERT_EQ(0, cache.GetUsage());
+}
+
+TEST(MetadataCache, AbsentKeys) {
+  size_t absent_capacity = engine::MetadataCache::kShards * 1024;
+  engine::MetadataCache cache(1024 * 1024, absent_capacity);
+  std::string value;
+  bool absent = false;
+
+  cache.InsertAbsent("key", cache.GetGeneration("key"));
+  ASSERT_TRUE(cache.Lookup("key", &value, &absent));
+  ASSERT_TRUE(absent);
+  ASSERT_EQ(1, cache.GetAbsentHits());
+  // the absent keys are misses for the callers which don't expect them
+  ASSERT_FALSE(cache.Lookup("key", &value));
+
+  // a write to the key erases it, and a racing lookup isn't inserted
+  auto generation = cache.GetGeneration("key");
+  cache.Erase("key");
+  cache.InsertAbsent("key", generation);
+  ASSERT_FALSE(cache.Lookup("key", &value, &absent));
+
+  cache.Insert("key", "value", cache.GetGeneration("key"));
+  ASSERT_TRUE(cache.Lookup("key", &value, &absent));
+  ASSERT_FALSE(absent);
+  ASSERT_EQ("value", value);
+
+  // the absent keys are bounded apart from the metadata
+  for (int i = 0; i < 10000; i++) {
+    std::string key = "absent" + std::to_string(i);
+    cache.InsertAbsent(key, cache.GetGeneration(key));
+  }
+  ASSERT_LE(cache.GetAbsentUsage(), absent_capacity);
+  ASSERT_TRUE(cache.Lookup("key", &value, &absent));
+  ASSERT_FALSE(absent);
+
+  cache.Clear();
+  ASSERT_EQ(0, cache.GetAbsentUsage());
+}
@@ -44,6 +44,31 @@ TEST(InternalKey, EncodeAndDecode) {
   EXPECT_EQ(ikey, ikey1);
 }
 
+TEST(InternalKey, CompactEncodeAndDecode) {
+  Slice key = "test-metadata-key";
+  Slice sub_key = "test-metadata-sub-key";
+  Slice ns = "namespace";
+  uint64_t version = InternalKey::kCompactVersionFlag | 12;
+  for (bool slot_id_encoded : {false, true}) {
+    std::string ns_key = ComposeNamespaceKey(ns, key, slot_id_encoded);
+    InternalKey ikey(ns_key, sub_key, version, slot_id_encoded);
+    ASSERT_TRUE(ikey.IsCompact());
+    std::string bytes = ikey.Encode();
+    // the key is replaced by the marker
+    EXPECT_EQ(bytes.size(), 1 + ns.size() + (slot_id_encoded ? 2 : 0) + 1 + 8 + sub_key.size());
+    EXPECT_EQ(bytes.find(key.ToString()), std::string::npos);
+    EXPECT_TRUE(Slice(bytes).starts_with(ikey.EncodePrefix()));
+
+    InternalKey ikey1(bytes, slot_id_encoded);
+    EXPECT_TRUE(ikey1.IsCompact());
+    EXPECT_EQ(ikey1.GetNamespace(), ns);
+    EXPECT_TRUE(ikey1.GetKey().empty());
+    EXPECT_EQ(ikey1.GetSubKey(), sub_key);
+    EXPECT_EQ(ikey1.GetVersion(), version);
+    EXPECT_EQ(ikey1.Encode(), bytes);
+  }
+}
+
 TEST(Metadata, EncodeAndDecode) {
   std::string string_bytes;
   Metadata string_md(kRedisString);
@@ -66,6 +91,30 @@ TEST(Metadata, EncodeAndDecode) {
   ASSERT_EQ(list_md, list_md1);
 }
 
+TEST(Metadata, HashInlineEncodeAndDecode) {
+  HashMetadata hash_md;
+  hash_md.encode_type = HashMetadata::EncodeType::INLINE;
+  hash_md.inline_fields = {{"a", "1"}, {"b", ""}};
+  hash_md.size = hash_md.inline_fields.size();
+  std::string bytes;
+  hash_md.Encode(&bytes);
+  HashMetadata hash_md1(false);
+  ASSERT_TRUE(hash_md1.Decode(bytes).ok());
+  ASSERT_EQ(hash_md, hash_md1);
+  ASSERT_TRUE(hash_md1.IsInline());
+  ASSERT_EQ(hash_md1.inline_fields, hash_md.inline_fields);
+
+  // The SUBKEYS encoding is the plain metadata
+  HashMetadata subkeys_md;
+  std::string subkeys_bytes, plain_bytes;
+  subkeys_md.Encode(&subkeys_bytes);
+  subkeys_md.Metadata::Encode(&plain_bytes);
+  ASSERT_EQ(subkeys_bytes, plain_bytes);
+  ASSERT_TRUE(hash_md1.Decode(subkeys_bytes).ok());
+  ASSERT_FALSE(hash_md1.IsInline());
+  ASSERT_TRUE(hash_md1.inline_fields.empty());
+}
+
 class RedisTypeTest : public TestBase {
  public:
   RedisTypeTest() {
@@ -98,6 +147,40 @@ TEST_F(RedisTypeTest, GetMetadata) {
   EXPECT_TRUE(s.ok());
 }
 
+TEST_F(RedisTypeTest, MultiGetMetadataAndSubKeys) {
+  uint64_t ret = 0;
+  std::vector<FieldValue> fvs;
+  for (size_t i = 0; i < fields_.size(); i++) {
+    fvs.emplace_back(fields_[i].ToString(), values_[i].ToString());
+  }
+  rocksdb::Status s = hash_->MSet(*ctx_, key_, fvs, false, &ret);
+  EXPECT_TRUE(s.ok() && fvs.size() == ret);
+
+  std::string ns_key = redis_->AppendNamespacePrefix(key_);
+  std::string missing_ns_key = redis_->AppendNamespacePrefix("test-redis-type-missing");
+  std::vector<std::string> raw_values;
+  auto statuses = redis_->MultiGetRawMetadata(*ctx_, {ns_key, missing_ns_key, ns_key}, &raw_values);
+  ASSERT_EQ(statuses.size(), 3);
+  EXPECT_TRUE(statuses[0].ok() && statuses[2].ok());
+  EXPECT_TRUE(statuses[1].IsNotFound());
+  EXPECT_EQ(raw_values[0], raw_values[2]);
+
+  HashMetadata metadata(false);
+  ASSERT_TRUE(metadata.Decode(raw_values[0]).ok());
+  std::vector<std::string> values;
+  statuses = redis_->MultiGetSubKeys(*ctx_, ns_key, metadata, {fields_[2], "no-such-field", fields_[0]}, &values);
+  EXPECT_TRUE(statuses[0].ok() && statuses[1].IsNotFound() && statuses[2].ok());
+  EXPECT_EQ(values[0], values_[2].ToString());
+  EXPECT_EQ(values[2], values_[0].ToString());
+
+  int exists = 0;
+  s = redis_->Exists(*ctx_, {key_, "test-redis-type-missing", key_}, &exists);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(exists, 2);
+  s = redis_->Del(*ctx_, key_);
+  EXPECT_TRUE(s.ok());
+}
+
 TEST_F(RedisTypeTest, Expire) {
   uint64_t ret = 0;
   std::vector<FieldValue> fvs;
@@ -191,6 +274,41 @@ TEST_F(RedisTypeTest, ExpireTimeKeyNotExisted) {
   s = redis_->Del(*ctx_, key_);
 }
 
+TEST_F(RedisTypeTest, ScanKeyNumStats) {
+  uint64_t ret = 0;
+  auto metadata_cf = storage_->GetCFHandle(ColumnFamilyID::Metadata);
+  for (int round = 0; round < 4; round++) {
+    for (int i = 0; i < 100; i++) {
+      auto key = "scan-key-" + std::to_string(round) + "-" + std::to_string(i);
+      auto s = hash_->Set(*ctx_, key, "field", "value", &ret);
+      ASSERT_TRUE(s.ok());
+      if (i % 10 == 0) {
+        s = redis_->Expire(*ctx_, key, util::GetTimeStampMS() + 100 * 1000);
+        ASSERT_TRUE(s.ok());
+      }
+    }
+    // flush every round to split the keys into several SST files
+    ASSERT_TRUE(storage_->GetDB()->Flush(rocksdb::FlushOptions(), metadata_cf).ok());
+  }
+  ctx_->RefreshLatestSnapshot();
+
+  KeyNumStats expected;
+  auto s = redis_->GetKeyNumStats(*ctx_, "", &expected);
+  ASSERT_TRUE(s.ok());
+  EXPECT_EQ(expected.n_key, 400);
+  EXPECT_EQ(expected.n_expires, 40);
+
+  for (int threads : {1, 2, 4, 16}) {
+    KeyNumStats stats;
+    s = redis_->ScanKeyNumStats(*ctx_, threads, &stats);
+    ASSERT_TRUE(s.ok());
+    EXPECT_EQ(stats.n_key, expected.n_key);
+    EXPECT_EQ(stats.n_expires, expected.n_expires);
+    EXPECT_EQ(stats.n_expired, expected.n_expired);
+    EXPECT_NEAR(stats.avg_ttl, expected.avg_ttl, 1);
+  }
+}
+
 TEST(Metadata, MetadataDecodingBackwardCompatibleSimpleKey) {
   auto expire_at = (util::GetTimeStamp() + 10) * 1000;
   Metadata md_old(kRedisString, true, false);
@@ -264,3 +382,25 @@ TEST(Metadata, Metadata64bitSize) {
   EXPECT_EQ(md_decoded.Type(), kRedisHash);
   EXPECT_EQ(md_decoded.size, big_size);
 }
+
+TEST(Metadata, PeekExpireAt) {
+  uint64_t now = util::GetTimeStampMS();
+  for (bool use_64bit : {false, true}) {
+    for (auto type : {kRedisString, kRedisHash, kRedisStream}) {
+      for (uint64_t size : {0, 1}) {
+        for (uint64_t expire : {uint64_t(0), (now / 1000 - 10) * 1000, (now / 1000 + 10) * 1000}) {
+          Metadata md(type, true, use_64bit);
+          md.expire = expire;
+          md.size = size;
+          std::string encoded_bytes;
+          md.Encode(&encoded_bytes);
+
+          bool expired = false;
+          ASSERT_TRUE(Metadata::PeekExpireAt(encoded_bytes, now, &expired));
+          EXPECT_EQ(expired, md.ExpireAt(now));
+          ASSERT_FALSE(Metadata::PeekExpireAt(Slice(encoded_bytes.data(), encoded_bytes.size() - 1), now, &expired));
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,60 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "cluster/migration_throttle.h"
+
+#include <gtest/gtest.h>
+
+TEST(MigrationThrottle, Adjust) {
+  MigrationThrottle throttle(nullptr);
+  constexpr size_t kMaxRate = 100 * MiB;
+  constexpr size_t kStep = kMaxRate / MigrationThrottle::kIncreaseSteps;
+  constexpr uint64_t kInterval = MigrationThrottle::kIntervalMs;
+  uint64_t now = 1000000;
+
+  // It starts a step above the min rate
+  EXPECT_EQ(throttle.Adjust(kMaxRate, "", now), MigrationThrottle::kMinBytesPerSec + kStep);
+
+  // The rate is only adjusted once per interval
+  EXPECT_EQ(throttle.Adjust(kMaxRate, "", now + kInterval / 2), MigrationThrottle::kMinBytesPerSec + kStep);
+  now += kInterval;
+  EXPECT_EQ(throttle.Adjust(kMaxRate, "", now), MigrationThrottle::kMinBytesPerSec + kStep * 2);
+
+  // It's raised up to the max rate
+  for (size_t i = 0; i < MigrationThrottle::kIncreaseSteps; i++) {
+    now += kInterval;
+    throttle.Adjust(kMaxRate, "", now);
+  }
+  EXPECT_EQ(throttle.GetRate(), kMaxRate);
+
+  // and halved while the nodes are overloaded, down to the min rate
+  now += kInterval;
+  EXPECT_EQ(throttle.Adjust(kMaxRate, "source:latency", now), kMaxRate / 2);
+  EXPECT_EQ(throttle.GetLoad(), "source:latency");
+  for (int i = 0; i < 10; i++) {
+    now += kInterval;
+    throttle.Adjust(kMaxRate, "destination:write-stall", now);
+  }
+  EXPECT_EQ(throttle.GetRate(), MigrationThrottle::kMinBytesPerSec);
+
+  // A lower max rate takes effect at once
+  now += kInterval;
+  EXPECT_EQ(throttle.Adjust(kMaxRate / 200, "", now), kMaxRate / 200);
+}
@@ -0,0 +1,79 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "server/monitor_feed.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+TEST(MonitorFeed, FormatRecord) {
+  MonitorFeed::Record record{1700000000123456, 1, "__namespace", "127.0.0.1:6666", {"set", "a", "b\n"}};
+  ASSERT_EQ(MonitorFeed::FormatRecord(record), "1700000000.123456 [__namespace 127.0.0.1:6666] \"set\" \"a\" \"b\\n\"");
+}
+
+TEST(MonitorFeed, Deliver) {
+  std::mutex mu;
+  std::vector<std::string> lines;
+  MonitorFeed feed([&](const MonitorFeed::Record &record, const std::string &line, uint64_t dropped) {
+    std::lock_guard<std::mutex> guard(mu);
+    ASSERT_EQ(dropped, 0);
+    lines.emplace_back(line);
+  });
+  ASSERT_TRUE(feed.Start());
+
+  feed.Push({1000000, 1, "ns", "addr", {"get", "a"}});
+  feed.Push({2000000, 2, "ns", "addr", {"get", "b"}});
+  for (int i = 0; i < 100; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    std::lock_guard<std::mutex> guard(mu);
+    if (lines.size() == 2) break;
+  }
+  feed.Stop();
+
+  ASSERT_EQ(lines, std::vector<std::string>({"1.0 [ns addr] \"get\" \"a\"", "2.0 [ns addr] \"get\" \"b\""}));
+  ASSERT_EQ(feed.GetDroppedRecords(), 0);
+}
+
+TEST(MonitorFeed, DropWhenFull) {
+  std::atomic<uint64_t> delivered = 0, dropped = 0;
+  MonitorFeed feed([&](const MonitorFeed::Record &, const std::string &, uint64_t n) {
+    delivered++;
+    dropped += n;
+  });
+
+  // the queue is filled before the thread starts, so the records over the capacity are dropped
+  for (size_t i = 0; i < MonitorFeed::kMaxQueuedRecords + 10; i++) {
+    feed.Push({0, 1, "ns", "addr", {"ping"}});
+  }
+  ASSERT_EQ(feed.GetDroppedRecords(), 10);
+
+  ASSERT_TRUE(feed.Start());
+  for (int i = 0; i < 100 && delivered < MonitorFeed::kMaxQueuedRecords; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  feed.Stop();
+  ASSERT_EQ(delivered, MonitorFeed::kMaxQueuedRecords);
+  ASSERT_EQ(dropped, 10);
+}
@@ -0,0 +1,66 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "storage/namespace_purger.h"
+
+#include <gtest/gtest.h>
+
+#include "test_base.h"
+#include "types/redis_hash.h"
+
+class NamespacePurgerTest : public TestBase {
+ protected:
+  size_t countSubKeys(const std::string &ns) {
+    auto prefix = ComposeNamespaceKey(ns, "", false);
+    size_t n = 0;
+    auto iter = util::UniqueIterator(*ctx_, ctx_->DefaultScanOptions(), ColumnFamilyID::PrimarySubkey);
+    for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) n++;
+    return n;
+  }
+};
+
+TEST_F(NamespacePurgerTest, PurgeFlushedNamespace) {
+  redis::Hash flushed(storage_.get(), "flushed_ns");
+  redis::Hash live(storage_.get(), "live_ns");
+  uint64_t ret = 0;
+  for (int i = 0; i < 10; i++) {
+    ASSERT_TRUE(flushed.Set(*ctx_, "hash", "field" + std::to_string(i), "value", &ret).ok());
+  }
+  ASSERT_TRUE(live.Set(*ctx_, "hash", "field", "value", &ret).ok());
+
+  ASSERT_TRUE(flushed.FlushDB(*ctx_).ok());
+  // the namespace is writable at once, and the new key never sees the subkeys of the flushed one
+  ASSERT_TRUE(flushed.Set(*ctx_, "hash", "new_field", "value", &ret).ok());
+  ctx_->RefreshLatestSnapshot();
+  std::vector<FieldValue> field_values;
+  ASSERT_TRUE(flushed.GetAll(*ctx_, "hash", &field_values).ok());
+  ASSERT_EQ(field_values.size(), 1);
+  EXPECT_EQ(countSubKeys("flushed_ns"), 11);
+
+  NamespacePurger purger(storage_.get(), "flushed_ns");
+  ASSERT_TRUE(purger.Purge().IsOK());
+  EXPECT_EQ(purger.GetPurgedBytes(), purger.GetTotalBytes());
+
+  ctx_->RefreshLatestSnapshot();
+  EXPECT_EQ(countSubKeys("flushed_ns"), 1);
+  EXPECT_EQ(countSubKeys("live_ns"), 1);
+  std::string value;
+  EXPECT_TRUE(live.Get(*ctx_, "hash", "field", &value).ok());
+}
@@ -0,0 +1,75 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "server/namespace_quota.h"
+
+#include <gtest/gtest.h>
+
+TEST(NamespaceQuotas, Admit) {
+  NamespaceQuotas quotas;
+  ASSERT_FALSE(quotas.HasQuotas());
+  ASSERT_TRUE(quotas.Admit("ns", true));
+
+  quotas.Reset({{"ns", NamespaceQuota{2, 100, 0, 3}}});
+  ASSERT_TRUE(quotas.HasQuota("ns"));
+  ASSERT_FALSE(quotas.HasQuota("other"));
+  ASSERT_EQ(quotas.GetWeight("ns"), 3);
+  ASSERT_EQ(quotas.GetWeight("other"), 1);
+
+  // the ops bucket holds one second of tokens
+  ASSERT_TRUE(quotas.Admit("ns", false));
+  ASSERT_TRUE(quotas.Admit("ns", false));
+  ASSERT_FALSE(quotas.Admit("ns", false));
+  ASSERT_TRUE(quotas.Admit("other", false));
+
+  // the read bytes are charged after the command, and the debt throttles the next reads but not the writes
+  quotas.Reset({{"ns", NamespaceQuota{0, 100, 0, 1}}});
+  ASSERT_TRUE(quotas.Admit("ns", false));
+  quotas.Charge("ns", 1000, 1000);
+  ASSERT_FALSE(quotas.Admit("ns", false));
+  ASSERT_TRUE(quotas.Admit("ns", true));
+
+  auto stats = quotas.GetStats();
+  ASSERT_EQ(stats.size(), 1);
+  ASSERT_EQ(stats["ns"].quota.read_bytes, 100);
+  ASSERT_EQ(stats["ns"].throttled_reads, 1);
+  ASSERT_EQ(stats["ns"].throttled_writes, 0);
+
+  quotas.Reset({});
+  ASSERT_FALSE(quotas.HasQuotas());
+}
+
+TEST(NamespaceFairQueue, WeightedOrder) {
+  NamespaceFairQueue queue(8);
+  std::string order;
+  for (int i = 0; i < 4; i++) {
+    ASSERT_TRUE(queue.Push("a", 1, [&order] { order += "a"; }).IsOK());
+  }
+  for (int i = 0; i < 4; i++) {
+    ASSERT_TRUE(queue.Push("b", 2, [&order] { order += "b"; }).IsOK());
+  }
+  ASSERT_FALSE(queue.Push("c", 1, [] {}).IsOK());
+  ASSERT_EQ(queue.Size(), 8);
+
+  // the namespace of the weight 2 is served twice as often, though its tasks are queued later
+  while (auto task = queue.Pop()) task();
+  ASSERT_EQ(order, "babbabaa");
+  ASSERT_EQ(queue.Size(), 0);
+}
@@ -52,11 +52,19 @@ TEST_F(NamespaceTest, AddAndDelete) {
     for (const auto &iter : tokens) {
       ASSERT_EQ(iter.first, ns->Get(iter.second).GetValue());
     }
+    for (const auto &iter : tokens) {
+      ASSERT_EQ(iter.second, ns->GetByToken(iter.first).GetValue());
+    }
 
     for (const auto &iter : tokens) {
       ASSERT_TRUE(ns->Set(iter.second, "new_" + iter.first).IsOK());
     }
 
+    for (const auto &iter : tokens) {
+      ASSERT_TRUE(ns->GetByToken(iter.first).Is<Status::NotFound>());
+      ASSERT_EQ(iter.second, ns->GetByToken("new_" + iter.first).GetValue());
+    }
+
     auto list_tokens = ns->List();
     ASSERT_EQ(list_tokens.size(), tokens.size());
     for (const auto &iter : tokens) {
@@ -67,5 +75,6 @@ TEST_F(NamespaceTest, AddAndDelete) {
       ASSERT_TRUE(ns->Del(iter.second).IsOK());
     }
     ASSERT_EQ(0, ns->List().size());
+    ASSERT_TRUE(ns->GetByToken("new_tokens").Is<Status::NotFound>());
   }
 }
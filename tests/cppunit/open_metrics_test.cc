@@ -0,0 +1,64 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "stats/open_metrics.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+TEST(OpenMetrics, FamilyAndSamples) {
+  std::string output;
+  OpenMetricsWriter writer(&output);
+  writer.Family("kvrocks_commands", "counter", "Commands processed");
+  writer.Sample("kvrocks_commands_total", {}, uint64_t{42});
+  writer.Family("kvrocks_command_calls", "counter", "Calls of each command");
+  writer.Sample("kvrocks_command_calls_total", {{"cmd", "get"}}, uint64_t{3});
+  writer.Sample("kvrocks_command_calls_total", {{"cmd", "a\"b\\c\n"}, {"cf", "default"}}, 1.5);
+  writer.Finish();
+
+  ASSERT_EQ(output,
+            "# TYPE kvrocks_commands counter\n"
+            "# HELP kvrocks_commands Commands processed\n"
+            "kvrocks_commands_total 42\n"
+            "# TYPE kvrocks_command_calls counter\n"
+            "# HELP kvrocks_command_calls Calls of each command\n"
+            "kvrocks_command_calls_total{cmd=\"get\"} 3\n"
+            "kvrocks_command_calls_total{cmd=\"a\\\"b\\\\c\\n\",cf=\"default\"} 1.5\n"
+            "# EOF\n");
+}
+
+TEST(OpenMetrics, Histogram) {
+  LatencyHistogram histogram;
+  histogram.Record(1);
+  histogram.Record(100);
+  histogram.Record(100);
+  histogram.Record(uint64_t{1} << 40);
+
+  std::string output;
+  OpenMetricsWriter writer(&output);
+  writer.Histogram("kvrocks_latency_seconds", {{"cmd", "get"}}, histogram.GetSnapshot());
+
+  // the buckets are cumulative, and the value beyond the last finite bucket only falls into +Inf
+  ASSERT_NE(output.find("kvrocks_latency_seconds_bucket{cmd=\"get\",le=\"7e-06\"} 1\n"), std::string::npos);
+  ASSERT_NE(output.find("kvrocks_latency_seconds_bucket{cmd=\"get\",le=\"0.000127\"} 3\n"), std::string::npos);
+  ASSERT_NE(output.find("kvrocks_latency_seconds_bucket{cmd=\"get\",le=\"+Inf\"} 4\n"), std::string::npos);
+  ASSERT_NE(output.find("kvrocks_latency_seconds_count{cmd=\"get\"} 4\n"), std::string::npos);
+}
@@ -0,0 +1,65 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "search/plan_cache.h"
+
+#include <gtest/gtest.h>
+
+using namespace kqir;
+
+static std::unique_ptr<PlanOperator> MakePlan(const std::string &tag) {
+  return std::make_unique<TagFieldScan>(std::make_unique<FieldRef>("t"), tag);
+}
+
+TEST(PlanCacheTest, GetAndPut) {
+  PlanCache cache;
+  ASSERT_EQ(cache.Get("q1", "idx"), nullptr);
+
+  cache.Put("q1", *MakePlan("a"), 2);
+  auto plan = cache.Get("q1", "idx");
+  ASSERT_NE(plan, nullptr);
+  ASSERT_EQ(plan->Dump(), "tag-scan t, a");
+
+  auto stats = cache.GetStats("idx");
+  ASSERT_EQ(stats.hits, 1);
+  ASSERT_EQ(stats.misses, 1);
+  ASSERT_EQ(cache.GetStats("other").hits, 0);
+
+  cache.Put("q1", *MakePlan("b"), 0);
+  ASSERT_EQ(cache.Get("q1", "idx")->Dump(), "tag-scan t, a");
+}
+
+TEST(PlanCacheTest, Eviction) {
+  PlanCache cache;
+  cache.Put("q1", *MakePlan("a"), 2);
+  cache.Put("q2", *MakePlan("b"), 2);
+  ASSERT_NE(cache.Get("q1", "idx"), nullptr);
+
+  // q2 is the least recently used one
+  cache.Put("q3", *MakePlan("c"), 2);
+  ASSERT_EQ(cache.Size(), 2);
+  ASSERT_EQ(cache.Get("q2", "idx"), nullptr);
+  ASSERT_NE(cache.Get("q1", "idx"), nullptr);
+  ASSERT_NE(cache.Get("q3", "idx"), nullptr);
+
+  cache.Clear("idx");
+  ASSERT_EQ(cache.Size(), 0);
+  ASSERT_EQ(cache.GetStats("idx").hits, 0);
+}
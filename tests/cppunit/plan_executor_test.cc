@@ -297,6 +297,149 @@ TEST(PlanExecutorTest, Merge) {
   }
 }
 
+static auto AllRows(ExecutorContext& ctx) {
+  std::vector<ExecutorNode::RowType> rows;
+  while (true) {
+    auto batch = ctx.NextBatch();
+    EXPECT_EQ(batch.Msg(), Status::ok_msg);
+    if (!batch || batch->Empty()) break;
+
+    EXPECT_LE(batch->Size(), ExecutorNode::kBatchSize);
+    for (size_t i = 0; i < batch->Size(); i++) rows.push_back(batch->Row(i));
+  }
+  return rows;
+}
+
+TEST(PlanExecutorTest, Batch) {
+  std::vector<ExecutorNode::RowType> data;
+  for (int i = 0; i < 3000; i++) {
+    data.push_back({"k" + std::to_string(i), {{FieldI("f1"), T(i % 3 == 0 ? "x" : "y")}, {FieldI("f3"), N(i)}},
+                    IndexI()});
+  }
+
+  auto field1 = std::make_unique<FieldRef>("f1", FieldI("f1"));
+  auto field3 = std::make_unique<FieldRef>("f3", FieldI("f3"));
+  auto op = std::make_unique<Projection>(
+      std::make_unique<Limit>(
+          std::make_unique<Filter>(
+              std::make_unique<Mock>(data),
+              OrExpr::Create(Node::List<QueryExpr>(
+                  std::make_unique<NumericCompareExpr>(NumericCompareExpr::LT, field3->CloneAs<FieldRef>(),
+                                                       std::make_unique<NumericLiteral>(10)),
+                  std::make_unique<NotExpr>(std::make_unique<TagContainExpr>(field1->CloneAs<FieldRef>(),
+                                                                             std::make_unique<StringLiteral>("y")))))),
+          std::make_unique<LimitClause>(5, 1000)),
+      std::make_unique<SelectClause>(Node::List<FieldRef>(field3->CloneAs<FieldRef>())));
+
+  std::vector<ExecutorNode::RowType> expected;
+  for (int i = 0, matched = 0; i < 3000 && expected.size() < 1000; i++) {
+    if (i >= 10 && i % 3 != 0) continue;
+    if (matched++ < 5) continue;
+    expected.push_back({"k" + std::to_string(i), {{FieldI("f3"), N(i)}}, IndexI()});
+  }
+
+  auto ctx = ExecutorContext(op.get());
+  auto rows = AllRows(ctx);
+  ASSERT_EQ(rows.size(), 1000);
+  ASSERT_EQ(rows, expected);
+  ASSERT_TRUE(AllRows(ctx).empty());
+}
+
+TEST(PlanExecutorTest, Profile) {
+  std::vector<ExecutorNode::RowType> data;
+  for (int i = 0; i < 10; i++) {
+    data.push_back({"k" + std::to_string(i), {{FieldI("f3"), N(i)}}, IndexI()});
+  }
+
+  auto field = std::make_unique<FieldRef>("f3", FieldI("f3"));
+  auto op = std::make_unique<Limit>(
+      std::make_unique<Filter>(std::make_unique<Mock>(data),
+                               std::make_unique<NumericCompareExpr>(NumericCompareExpr::GET, field->CloneAs<FieldRef>(),
+                                                                    std::make_unique<NumericLiteral>(4))),
+      std::make_unique<LimitClause>(1, 3));
+  auto filter = dynamic_cast<Filter*>(op->op.get());
+
+  auto ctx = ExecutorContext(op.get(), true);
+  ASSERT_EQ(NextRow(ctx).key, "k5");
+  ASSERT_EQ(NextRow(ctx).key, "k6");
+  ASSERT_EQ(NextRow(ctx).key, "k7");
+  ASSERT_EQ(ctx.Next().GetValue(), exe_end);
+
+  ASSERT_NE(ctx.GetProfile(op.get()), nullptr);
+  EXPECT_EQ(ctx.GetProfile(op.get())->calls, 4);
+  EXPECT_EQ(ctx.GetProfile(op.get())->rows, 3);
+  // the limit reads the row skipped by the offset as well
+  EXPECT_EQ(ctx.GetProfile(filter)->rows, 4);
+  // the mock is read until the rows before the filtered ones are skipped
+  EXPECT_EQ(ctx.GetProfile(filter->source.get())->rows, 8);
+
+  auto unprofiled = ExecutorContext(op.get());
+  EXPECT_EQ(unprofiled.GetProfile(op.get()), nullptr);
+}
+
+TEST(PlanExecutorTest, Aggregate) {
+  std::vector<ExecutorNode::RowType> data;
+  for (int i = 0; i < 3000; i++) {
+    ExecutorNode::RowType row{"k" + std::to_string(i), {{FieldI("f1"), T(i % 3 == 0 ? "x" : "y")}}, IndexI()};
+    // the rows of every tenth key have no f3
+    if (i % 10 != 0) row.fields.emplace(FieldI("f3"), N(i % 100));
+    data.push_back(std::move(row));
+  }
+
+  auto make_op = [&data](uint64_t max_memory) {
+    std::vector<Aggregate::Reducer> reducers;
+    reducers.push_back({Aggregate::COUNT, nullptr, "count"});
+    reducers.push_back({Aggregate::SUM, std::make_unique<FieldRef>("f3", FieldI("f3")), "sum"});
+    reducers.push_back({Aggregate::MAX, std::make_unique<FieldRef>("f3", FieldI("f3")), "max"});
+    reducers.push_back({Aggregate::COUNT_DISTINCT, std::make_unique<FieldRef>("f3", FieldI("f3")), "distinct"});
+    std::vector<Aggregate::Apply> applies;
+    applies.push_back({*ArithmeticExpr::Parse("@sum / (@count - 0)"), "avg"});
+
+    return std::make_unique<Aggregate>(
+        std::make_unique<Mock>(data), Node::List<FieldRef>(std::make_unique<FieldRef>("f1", FieldI("f1"))),
+        std::move(reducers), std::move(applies),
+        std::make_unique<SortByClause>(SortByClause::DESC, std::make_unique<FieldRef>("count")), max_memory);
+  };
+
+  auto op = make_op(0);
+  ASSERT_TRUE(op->Check());
+  ASSERT_EQ(op->Dump(),
+            "(aggregate groupby @f1 reduce count() as count reduce sum(@f3) as sum reduce max(@f3) as max "
+            "reduce count_distinct(@f3) as distinct apply (@sum / (@count - 0)) as avg sortby count, desc: mock)");
+
+  double sum_x = 0, sum_y = 0;
+  for (int i = 0; i < 3000; i++) {
+    if (i % 10 != 0) (i % 3 == 0 ? sum_x : sum_y) += i % 100;
+  }
+
+  auto ctx = ExecutorContext(op.get());
+  auto row = NextRow(ctx);
+  ASSERT_EQ(row.fields.at(FieldI("f1")), T("y"));
+  ASSERT_EQ(row.fields.at(op->FindColumn("count")), N(2000));
+  ASSERT_EQ(row.fields.at(op->FindColumn("sum")), N(sum_y));
+  ASSERT_EQ(row.fields.at(op->FindColumn("max")), N(99));
+  ASSERT_NEAR(row.fields.at(op->FindColumn("distinct")).Get<Numeric>(), 90, 2);
+  ASSERT_EQ(row.fields.at(op->FindColumn("avg")), N(sum_y / 2000));
+  row = NextRow(ctx);
+  ASSERT_EQ(row.fields.at(FieldI("f1")), T("x"));
+  ASSERT_EQ(row.fields.at(op->FindColumn("count")), N(1000));
+  ASSERT_EQ(row.fields.at(op->FindColumn("sum")), N(sum_x));
+  ASSERT_EQ(ctx.Next().GetValue(), exe_end);
+
+  op = make_op(100);
+  ctx = ExecutorContext(op.get());
+  ASSERT_FALSE(ctx.Next());
+
+  std::vector<Aggregate::Apply> applies;
+  applies.push_back({*ArithmeticExpr::Parse("@sum * 2"), "double"});
+  auto invalid = Aggregate(std::make_unique<Mock>(data), {}, {}, std::move(applies), nullptr);
+  ASSERT_EQ(invalid.Check().Msg(), "column `sum` is not defined before APPLY");
+
+  ASSERT_FALSE(ArithmeticExpr::Parse("@sum +"));
+  ASSERT_FALSE(ArithmeticExpr::Parse("(@sum"));
+  ASSERT_EQ((*ArithmeticExpr::Parse("1 + 2 * @a - 3"))->Dump(), "((1 + (2 * @a)) - 3)");
+}
+
 class PlanExecutorTestC : public TestBase {
  protected:
   explicit PlanExecutorTestC() : json_(std::make_unique<redis::Json>(storage_.get(), "search_ns")) {}
@@ -465,6 +608,45 @@ TEST_F(PlanExecutorTestC, TagFieldScan) {
   }
 }
 
+TEST_F(PlanExecutorTestC, Intersect) {
+  redis::GlobalIndexer indexer(storage_.get());
+  indexer.Add(redis::IndexUpdater(IndexI()));
+
+  std::vector<std::string> keys;
+  for (int i = 0; i < 60; ++i) keys.push_back("test2:k" + std::to_string(i));
+
+  {
+    auto updates = ScopedUpdates(*ctx_, indexer, std::vector<std::string_view>(keys.begin(), keys.end()), "search_ns");
+    for (int i = 0; i < 60; ++i) {
+      auto f1 = i % 3 == 0 ? "cpp,rust" : "cpp";
+      auto f2 = i % 10 == 0 ? 1 : 2;
+      json_->Set(*ctx_, keys[i], "$", fmt::format("{{\"f1\": \"{}\", \"f2\": {}}}", f1, f2));
+    }
+  }
+
+  {
+    auto op = std::make_unique<Intersect>(Node::List<PlanOperator>(
+        std::make_unique<TagFieldScan>(std::make_unique<FieldRef>("f1", FieldI("f1")), "cpp"),
+        std::make_unique<TagFieldScan>(std::make_unique<FieldRef>("f1", FieldI("f1")), "rust"),
+        std::make_unique<NumericFieldScan>(std::make_unique<FieldRef>("f2", FieldI("f2")),
+                                           Interval(1, IntervalSet::NextNum(1)), SortByClause::ASC)));
+
+    auto ctx = ExecutorContext(op.get(), storage_.get());
+    ASSERT_EQ(NextRow(ctx).key, "test2:k0");
+    ASSERT_EQ(NextRow(ctx).key, "test2:k30");
+    ASSERT_EQ(ctx.Next().GetValue(), exe_end);
+  }
+
+  {
+    auto op = std::make_unique<Intersect>(Node::List<PlanOperator>(
+        std::make_unique<TagFieldScan>(std::make_unique<FieldRef>("f1", FieldI("f1")), "rust"),
+        std::make_unique<TagFieldScan>(std::make_unique<FieldRef>("f1", FieldI("f1")), "java")));
+
+    auto ctx = ExecutorContext(op.get(), storage_.get());
+    ASSERT_EQ(ctx.Next().GetValue(), exe_end);
+  }
+}
+
 TEST_F(PlanExecutorTestC, HnswVectorFieldScans) {
   redis::GlobalIndexer indexer(storage_.get());
   indexer.Add(redis::IndexUpdater(IndexI()));
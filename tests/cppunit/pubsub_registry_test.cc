@@ -0,0 +1,66 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "server/pubsub_registry.h"
+
+#include <gtest/gtest.h>
+
+TEST(PubSubRegistry, MatchByWorker) {
+  PubSubRegistry registry;
+  // the workers are only compared, never dereferenced
+  auto *worker1 = reinterpret_cast<Worker *>(0x10);
+  auto *worker2 = reinterpret_cast<Worker *>(0x20);
+
+  registry.Subscribe("news.tech", {worker1, 1});
+  registry.Subscribe("news.tech", {worker2, 2});
+  registry.Subscribe("news.art", {worker1, 3});
+  registry.PSubscribe("news.*", {worker1, 4});
+  registry.PSubscribe("news.*", {worker2, 5});
+  registry.PSubscribe("*tech", {worker2, 6});
+  registry.PSubscribe("news.a*", {worker1, 7});
+  registry.PSubscribe("sport.*", {worker1, 8});
+  ASSERT_EQ(registry.GetChannelSize(), 2);
+  ASSERT_EQ(registry.GetPatternSize(), 4);
+
+  auto matches = registry.Match("news.tech");
+  ASSERT_EQ(matches.patterns.size(), 2);
+  ASSERT_EQ(matches.subscribers.size(), 2);
+  ASSERT_EQ(matches.subscribers[worker1].size(), 2);
+  ASSERT_EQ(matches.subscribers[worker2].size(), 3);
+  for (const auto &[fd, index] : matches.subscribers[worker1]) {
+    if (fd == 1) ASSERT_EQ(index, PubSubRegistry::kChannelMatch);
+    if (fd == 4) ASSERT_EQ(matches.patterns[index - 1], "news.*");
+  }
+
+  ASSERT_TRUE(registry.Match("weather").subscribers.empty());
+  ASSERT_EQ(registry.GetChannels(""), (std::vector<std::string>{"news.art", "news.tech"}));
+  ASSERT_EQ(registry.GetChannels("*art"), (std::vector<std::string>{"news.art"}));
+  ASSERT_EQ(registry.GetSubscribeNum("news.tech"), 2);
+
+  registry.Unsubscribe("news.tech", worker1, 1);
+  registry.PUnsubscribe("news.*", worker1, 4);
+  registry.PUnsubscribe("news.*", worker2, 5);
+  ASSERT_EQ(registry.GetSubscribeNum("news.tech"), 1);
+  ASSERT_EQ(registry.GetPatternSize(), 3);
+  matches = registry.Match("news.tech");
+  ASSERT_EQ(matches.patterns, (std::vector<std::string>{"*tech"}));
+  ASSERT_EQ(matches.subscribers.size(), 1);
+  ASSERT_EQ(matches.subscribers[worker2].size(), 2);
+}
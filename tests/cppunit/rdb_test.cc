@@ -308,4 +308,21 @@ TEST_F(RDBTest, LoadEmptyKeys) {
 
   s = keyExist("zset_listpack");
   ASSERT_TRUE(s.IsNotFound());
-}
\ No newline at end of file
+}
+
+TEST_F(RDBTest, LoadWithoutWAL) {
+  tmp_rdb_ = "hash-zipmap.rdb";
+  ScopedTestRDBFile temp(tmp_rdb_, hash_zipmap_payload, sizeof(hash_zipmap_payload) - 1);
+  auto stream_ptr = std::make_unique<RdbFileStream>(tmp_rdb_);
+  ASSERT_TRUE(stream_ptr->Open().IsOK());
+
+  RDB rdb(storage_.get(), ns_, std::move(stream_ptr));
+  auto s = rdb.LoadRdb(*ctx_, 0, true, true);
+  ASSERT_TRUE(s.IsOK());
+
+  std::map<std::string, std::string> hash_expect = {
+      {"f1", "v1"},
+      {"f2", "v2"},
+  };
+  hashCheck("hash", hash_expect);
+}
@@ -78,6 +78,11 @@ TEST(RedisQueryParserTest, Simple) {
   AssertIR(Parse("@a:{x} @b:[1 inf]"), "(and a hastag \"x\", b >= 1)");
   AssertIR(Parse("@a:{x} | @b:[1 inf]"), "(or a hastag \"x\", b >= 1)");
   AssertIR(Parse("@a:{x} @b:[1 inf] @c:{y}"), "(and a hastag \"x\", b >= 1, c hastag \"y\")");
+  AssertIR(Parse("@a:hello"), "a match \"hello\"");
+  AssertIR(Parse("@a:(quick brown fox)"), "a match \"quick brown fox\"");
+  AssertIR(Parse(R"(@a:"quick brown")"), "a matchphrase \"quick brown\"");
+  AssertIR(Parse("@a:(quick) @b:{x}"), "(and a match \"quick\", b hastag \"x\")");
+  AssertIR(Parse("-@a:fox"), "not a match \"fox\"");
   AssertIR(Parse("@a:{x}|@b:[1 inf] | @c:{y}"), "(or a hastag \"x\", b >= 1, c hastag \"y\")");
   AssertIR(Parse("@a:[1 inf] @b:[inf 2]| @c:[(3 inf]"), "(or (and a >= 1, b <= 2), c > 3)");
   AssertIR(Parse("@a:[1 inf] | @b:[inf 2] @c:[(3 inf]"), "(or a >= 1, (and b <= 2, c > 3))");
@@ -100,6 +105,8 @@ TEST(RedisQueryParserTest, Params) {
   AssertIR(Parse("@c:{$y}", {{"y", "hello"}}), "c hastag \"hello\"");
   AssertIR(Parse("@c:{$y} @d:[$zzz inf]", {{"y", "hello"}, {"zzz", "3"}}), "(and c hastag \"hello\", d >= 3)");
   ASSERT_EQ(Parse("@c:{$y}", {{"z", "hello"}}).Msg(), "parameter with name `y` not found");
+  AssertIR(Parse("@c:$q", {{"q", "quick fox"}}), "c match \"quick fox\"");
+  AssertIR(Parse("@c:(brown $q)", {{"q", "fox"}}), "c match \"brown fox\"");
 }
 
 TEST(RedisQueryParserTest, Vector) {
@@ -117,13 +124,8 @@ TEST(RedisQueryParserTest, Vector) {
   AssertSyntaxError(Parse("KNN 5 @vector $BLOB", {{"BLOB", vec_str}}));
   AssertSyntaxError(Parse("* =>[KNN -1 @vector $BLOB]", {{"BLOB", vec_str}}));
   AssertSyntaxError(Parse("*=>[KNN 5 $vector_blob_param]", {{"vector_blob_param", vec_str}}));
-  AssertSyntaxError(Parse("(*) => [KNN 10 @doc_embedding $BLOB]", {{"BLOB", vec_str}}));
-  AssertSyntaxError(Parse("(@a:[1 2]) => [KNN 8 @vec_embedding $blob]", {{"blob", vec_str}}));
-  AssertSyntaxError(Parse("(@a:{x|y}) => [KNN 8 @vec_embedding $blob]", {{"blob", vec_str}}));
-  AssertSyntaxError(Parse("(@a:{x|y}) => [KNN 8 @vec_embedding $blob]", {{"blob", vec_str}}));
-  AssertSyntaxError(Parse("(@a:{x}|@b:[1 inf] | @c:{y}) => [KNN 8 @vec_embedding $blob]", {{"blob", vec_str}}));
-  AssertSyntaxError(Parse("(@a:{x}|@b:[1 inf] | @field:[VECTOR_RANGE 10 $vector]) => [KNN 8 @vec_embedding $blob]",
-                          {{"blob", vec_str}, {"vector", vec_str}}));
+  AssertSyntaxError(Parse("@a:{x} => [KNN 8 @vec_embedding $blob] @b:{y}", {{"blob", vec_str}}));
+  AssertSyntaxError(Parse("=> [KNN 8 @vec_embedding $blob]", {{"blob", vec_str}}));
 
   AssertIR(Parse("@field:[VECTOR_RANGE 10 $vector]", {{"vector", vec_str}}),
            "field <-> [1.000000, 2.000000, 3.000000] < 10");
@@ -133,6 +135,17 @@ TEST(RedisQueryParserTest, Vector) {
            "KNN k=10, doc_embedding <-> [1.000000, 2.000000, 3.000000]");
   AssertIR(Parse("* =>[KNN 5 @vector $BLOB]", {{"BLOB", vec_str}}),
            "KNN k=5, vector <-> [1.000000, 2.000000, 3.000000]");
+  AssertIR(Parse("*=>[KNN 10 @vector $BLOB EF_RUNTIME 100]", {{"BLOB", vec_str}}),
+           "KNN k=10 ef_runtime=100, vector <-> [1.000000, 2.000000, 3.000000]");
+  AssertIR(Parse("*=>[KNN $k @vector $BLOB EF_RUNTIME $ef]", {{"BLOB", vec_str}, {"k", "3"}, {"ef", "20"}}),
+           "KNN k=3 ef_runtime=20, vector <-> [1.000000, 2.000000, 3.000000]");
+  AssertSyntaxError(Parse("*=>[KNN 10 @vector $BLOB EF_RUNTIME]", {{"BLOB", vec_str}}));
+  AssertIR(Parse("(*) => [KNN 10 @doc_embedding $BLOB]", {{"BLOB", vec_str}}),
+           "KNN k=10, doc_embedding <-> [1.000000, 2.000000, 3.000000]");
+  AssertIR(Parse("@a:{x|y} => [KNN 8 @vec_embedding $blob]", {{"blob", vec_str}}),
+           "(or a hastag \"x\", a hastag \"y\") => KNN k=8, vec_embedding <-> [1.000000, 2.000000, 3.000000]");
+  AssertIR(Parse("(@a:{x} @b:[1 inf]) => [KNN 8 @vec_embedding $blob EF_RUNTIME 20]", {{"blob", vec_str}}),
+           "(and a hastag \"x\", b >= 1) => KNN k=8 ef_runtime=20, vec_embedding <-> [1.000000, 2.000000, 3.000000]");
 
   vec_str = vec_str.substr(0, 3);
   ASSERT_EQ(Parse("@field:[VECTOR_RANGE 10 $vector]", {{"vector", vec_str}}).Msg(),
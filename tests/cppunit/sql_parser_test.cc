@@ -119,6 +119,9 @@ TEST(SQLParserTest, Simple) {
   AssertIR(Parse("select a from b where x hastag \"hi\""), "select a from b where x hastag \"hi\"");
   AssertIR(Parse(R"(select a from b where x hastag "a\nb")"), R"(select a from b where x hastag "a\nb")");
   AssertIR(Parse(R"(select a from b where x hastag "")"), R"(select a from b where x hastag "")");
+  AssertIR(Parse(R"(select a from b where x match "quick fox")"), R"(select a from b where x match "quick fox")");
+  AssertIR(Parse(R"(select a from b where x matchphrase "quick fox")"),
+           R"(select a from b where x matchphrase "quick fox")");
   AssertIR(Parse(R"(select a from b where x hastag "hello ,  hi")"), R"(select a from b where x hastag "hello ,  hi")");
   AssertIR(Parse(R"(select a from b where x hastag "a\nb\t\n")"), R"(select a from b where x hastag "a\nb\t\n")");
   AssertIR(Parse(R"(select a from b where x hastag "a\u0000")"), R"(select a from b where x hastag "a\x00")");
@@ -0,0 +1,91 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "stats/stats.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+TEST(Stats, CommandStatsAcrossThreads) {
+  Stats stats;
+  stats.InitCommandStats(4);
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; i++) {
+    threads.emplace_back([&stats] {
+      for (int j = 0; j < 1000; j++) {
+        stats.IncrCalls(1);
+        stats.IncrLatency(2, 1);
+        stats.IncrCalls(3);
+      }
+    });
+  }
+  for (auto &t : threads) t.join();
+
+  ASSERT_EQ(stats.GetTotalCalls(), 16000);
+  auto stat = stats.GetCommandStat(1);
+  ASSERT_EQ(stat.calls, 8000);
+  ASSERT_EQ(stat.latency, 16000);
+  ASSERT_EQ(stats.GetCommandStat(3).calls, 8000);
+  ASSERT_EQ(stats.GetCommandStat(0).calls, 0);
+}
+
+TEST(Stats, CommandAllocation) {
+  Stats stats;
+  stats.InitCommandStats(2);
+
+  std::vector<std::thread> threads;
+  for (uint64_t i = 1; i <= 4; i++) {
+    threads.emplace_back([&stats, i] { stats.RecordAllocation(i * 100, 1); });
+  }
+  for (auto &t : threads) t.join();
+
+  auto stat = stats.GetCommandStat(1);
+  ASSERT_EQ(stat.alloc_bytes, 1000);
+  ASSERT_EQ(stat.max_alloc_bytes, 400);
+  ASSERT_EQ(stats.GetCommandStat(0).max_alloc_bytes, 0);
+}
+
+TEST(Stats, LatencyHistogram) {
+  for (uint64_t v : {0ULL, 1ULL, 7ULL, 8ULL, 9ULL, 100ULL, 1000ULL, 123456ULL, 1ULL << 35}) {
+    auto index = LatencyHistogram::BucketIndex(v);
+    ASSERT_LT(index, LatencyHistogram::kBuckets);
+    auto upper = LatencyHistogram::BucketUpperBound(index);
+    ASSERT_GE(upper, v);
+    ASSERT_LE(upper - v, v / LatencyHistogram::kSubBuckets);
+  }
+  ASSERT_EQ(LatencyHistogram::BucketIndex(UINT64_MAX), LatencyHistogram::kBuckets - 1);
+
+  LatencyHistogram histogram;
+  for (uint64_t i = 1; i <= 1000; i++) histogram.Record(i);
+  auto snapshot = histogram.GetSnapshot();
+  ASSERT_EQ(snapshot.count, 1000);
+  ASSERT_NEAR(snapshot.Percentile(50), 500, 500 / LatencyHistogram::kSubBuckets);
+  ASSERT_NEAR(snapshot.Percentile(99), 990, 990 / LatencyHistogram::kSubBuckets);
+  ASSERT_EQ(LatencyHistogram().GetSnapshot().Percentile(99), 0);
+
+  // Only the slow values recorded after the snapshot count
+  for (int i = 0; i < 10; i++) histogram.Record(100000);
+  auto delta = histogram.GetSnapshot().Since(snapshot);
+  ASSERT_EQ(delta.count, 10);
+  ASSERT_NEAR(delta.Percentile(50), 100000, 100000 / LatencyHistogram::kSubBuckets);
+}
@@ -19,11 +19,17 @@
  */
 
 #include <config/config.h>
+#include <db_util.h>
 #include <gtest/gtest.h>
+#include <rocksdb_crc32c.h>
 #include <status.h>
 #include <storage/storage.h>
+#include <types/redis_hash.h>
 
 #include <filesystem>
+#include <set>
+#include <thread>
+#include <vector>
 
 TEST(Storage, CreateBackup) {
   std::error_code ec;
@@ -58,3 +64,409 @@ TEST(Storage, CreateBackup) {
   std::filesystem::remove_all(config.db_dir, ec);
   ASSERT_TRUE(!ec);
 }
+
+TEST(Storage, CreateIncrementalBackup) {
+  std::error_code ec;
+
+  Config config;
+  config.db_dir = "test_incr_backup_dir/db";
+  config.backup_dir = "test_incr_backup_dir/backup";
+  config.backup_incremental = true;
+  config.slot_id_encoded = false;
+
+  std::filesystem::remove_all("test_incr_backup_dir", ec);
+  ASSERT_TRUE(!ec);
+  std::filesystem::create_directories("test_incr_backup_dir", ec);
+  ASSERT_TRUE(!ec);
+
+  auto storage = std::make_unique<engine::Storage>(&config);
+  auto s = storage->Open();
+  ASSERT_TRUE(s.IsOK());
+
+  auto ctx = engine::Context(storage.get());
+  for (int i = 0; i < 2; i++) {
+    rocksdb::WriteBatch batch;
+    batch.Put("k" + std::to_string(i), "v");
+    ASSERT_TRUE(storage->Write(ctx, rocksdb::WriteOptions(), &batch).ok());
+    ASSERT_TRUE(storage->FlushMemTables().ok());
+    s = storage->CreateBackup();
+    ASSERT_TRUE(s.IsOK());
+  }
+
+  rocksdb::BackupEngineOptions options(config.backup_dir);
+  options.share_files_with_checksum = true;
+  {
+    auto engine = util::BackupEngineOpen(rocksdb::Env::Default(), options);
+    ASSERT_TRUE(engine.IsOK());
+    std::vector<rocksdb::BackupInfo> infos;
+    (*engine)->GetBackupInfo(&infos, true);
+    ASSERT_EQ(2, infos.size());
+    // the SST file of the first backup is shared by the second one
+    std::set<std::string> first_files;
+    for (const auto &file : infos[0].file_details) first_files.insert(file.relative_filename);
+    bool shared = false;
+    for (const auto &file : infos[1].file_details) {
+      if (file.file_type == rocksdb::kTableFile && first_files.count(file.relative_filename)) shared = true;
+    }
+    ASSERT_TRUE(shared);
+
+    auto restore_status = (*engine)->RestoreDBFromLatestBackup("test_incr_backup_dir/restore",
+                                                               "test_incr_backup_dir/restore");
+    ASSERT_TRUE(restore_status.ok());
+    ASSERT_TRUE(std::filesystem::exists("test_incr_backup_dir/restore/CURRENT"));
+  }
+
+  storage->PurgeOldBackups(1, 0);
+  {
+    auto engine = util::BackupEngineOpen(rocksdb::Env::Default(), options);
+    ASSERT_TRUE(engine.IsOK());
+    std::vector<rocksdb::BackupInfo> infos;
+    (*engine)->GetBackupInfo(&infos);
+    ASSERT_EQ(1, infos.size());
+  }
+
+  storage = nullptr;
+  std::filesystem::remove_all("test_incr_backup_dir", ec);
+  ASSERT_TRUE(!ec);
+}
+
+TEST(Storage, GroupCommit) {
+  rocksdb::WriteBatch dst;
+  dst.Put("k1", "v1");
+  rocksdb::WriteBatch src;
+  src.Put("k2", "v2");
+  src.Delete("k3");
+  std::string rep = dst.Data();
+  engine::GroupCommitter::MergeBatches(&rep, src);
+  rocksdb::WriteBatch merged(rep);
+  ASSERT_EQ(merged.Count(), 3);
+
+  std::error_code ec;
+  Config config;
+  config.db_dir = "test_group_commit_dir";
+  config.slot_id_encoded = false;
+  config.group_commit_enabled = true;
+  config.group_commit_max_delay_us = 1000;
+  config.group_commit_max_batch_size = 8;
+
+  std::filesystem::remove_all(config.db_dir, ec);
+  ASSERT_TRUE(!ec);
+
+  auto storage = std::make_unique<engine::Storage>(&config);
+  auto s = storage->Open();
+  ASSERT_TRUE(s.IsOK());
+
+  constexpr int threads_num = 8;
+  constexpr int writes_per_thread = 100;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < threads_num; t++) {
+    threads.emplace_back([&storage, t] {
+      for (int i = 0; i < writes_per_thread; i++) {
+        auto ctx = engine::Context::NoTransactionContext(storage.get());
+        rocksdb::WriteBatch batch;
+        batch.Put(std::to_string(t) + "-" + std::to_string(i), "v");
+        ASSERT_TRUE(storage->Write(ctx, storage->DefaultWriteOptions(), &batch).ok());
+      }
+    });
+  }
+  for (auto &thread : threads) thread.join();
+
+  auto ctx = engine::Context::NoTransactionContext(storage.get());
+  for (int t = 0; t < threads_num; t++) {
+    for (int i = 0; i < writes_per_thread; i++) {
+      std::string value;
+      ASSERT_TRUE(storage->Get(ctx, ctx.GetReadOptions(), std::to_string(t) + "-" + std::to_string(i), &value).ok());
+      ASSERT_EQ(value, "v");
+    }
+  }
+  const auto &stats = storage->GetGroupCommitStats();
+  ASSERT_EQ(stats.batches, threads_num * writes_per_thread);
+  ASSERT_LE(stats.groups, stats.batches);
+
+  storage.reset();
+  std::filesystem::remove_all(config.db_dir, ec);
+  ASSERT_TRUE(!ec);
+}
+
+TEST(Storage, SharedSnapshot) {
+  std::error_code ec;
+  Config config;
+  config.db_dir = "test_shared_snapshot_dir";
+  config.slot_id_encoded = false;
+  config.txn_context_enabled = true;
+
+  std::filesystem::remove_all(config.db_dir, ec);
+  ASSERT_TRUE(!ec);
+
+  auto storage = std::make_unique<engine::Storage>(&config);
+  auto s = storage->Open();
+  ASSERT_TRUE(s.IsOK());
+
+  {
+    // Nothing is written in between, so the snapshot is shared
+    engine::Context ctx1(storage.get());
+    engine::Context ctx2(storage.get());
+    ASSERT_NE(ctx1.snapshot, nullptr);
+    ASSERT_EQ(ctx1.snapshot, ctx2.snapshot);
+
+    auto write_ctx = engine::Context::NoTransactionContext(storage.get());
+    rocksdb::WriteBatch batch;
+    batch.Put("k", "v");
+    ASSERT_TRUE(storage->Write(write_ctx, storage->DefaultWriteOptions(), &batch).ok());
+
+    // A Context after the write must see it
+    engine::Context ctx3(storage.get());
+    ASSERT_NE(ctx3.snapshot, ctx1.snapshot);
+    std::string value;
+    ASSERT_TRUE(storage->Get(ctx3, ctx3.GetReadOptions(), "k", &value).ok());
+    ASSERT_EQ(value, "v");
+    ASSERT_TRUE(storage->Get(ctx1, ctx1.GetReadOptions(), "k", &value).IsNotFound());
+  }
+
+  storage.reset();
+  std::filesystem::remove_all(config.db_dir, ec);
+  ASSERT_TRUE(!ec);
+}
+
+TEST(Storage, MetadataAndSubKeyOnSnapshot) {
+  std::error_code ec;
+  Config config;
+  config.db_dir = "test_metadata_and_subkey_dir";
+  config.slot_id_encoded = false;
+  config.txn_context_enabled = true;
+  config.metadata_cache_size = 1;
+
+  std::filesystem::remove_all(config.db_dir, ec);
+  ASSERT_TRUE(!ec);
+
+  auto storage = std::make_unique<engine::Storage>(&config);
+  auto s = storage->Open();
+  ASSERT_TRUE(s.IsOK());
+
+  redis::Hash hash(storage.get(), "ns");
+  uint64_t added = 0;
+  std::string value;
+  {
+    engine::Context ctx(storage.get());
+    ASSERT_TRUE(hash.Set(ctx, "key", "field", "v1", &added).ok());
+  }
+  {
+    // the metadata read on the latest snapshot fills the cache
+    engine::Context ctx(storage.get());
+    ASSERT_TRUE(hash.Get(ctx, "key", "field", &value).ok());
+    ASSERT_EQ(value, "v1");
+  }
+
+  auto old_ctx = std::make_unique<engine::Context>(storage.get());
+  {
+    engine::Context ctx(storage.get());
+    ASSERT_TRUE(hash.Del(ctx, "key").ok());
+  }
+  {
+    engine::Context ctx(storage.get());
+    ASSERT_TRUE(hash.Set(ctx, "key", "field", "v2", &added).ok());
+  }
+  {
+    engine::Context ctx(storage.get());
+    ASSERT_TRUE(hash.Get(ctx, "key", "field", &value).ok());
+    ASSERT_EQ(value, "v2");
+  }
+
+  // the version of the cache is a newer one, so the field of the version on the snapshot is read again
+  auto hits = storage->GetMetadataCache()->GetHits();
+  ASSERT_TRUE(hash.Get(*old_ctx, "key", "field", &value).ok());
+  ASSERT_EQ(value, "v1");
+  ASSERT_TRUE(hash.Get(*old_ctx, "key", "missing", &value).IsNotFound());
+  {
+    engine::Context ctx(storage.get());
+    ASSERT_TRUE(hash.Get(ctx, "key", "field", &value).ok());
+    ASSERT_EQ(value, "v2");
+  }
+  ASSERT_EQ(storage->GetMetadataCache()->GetHits(), hits + 3);
+
+  old_ctx.reset();
+  storage.reset();
+  std::filesystem::remove_all(config.db_dir, ec);
+  ASSERT_TRUE(!ec);
+}
+
+TEST(Storage, HashMetadataMemtable) {
+  for (auto type : {MemtableType::kHashSkipList, MemtableType::kHashLinkList}) {
+    std::error_code ec;
+    Config config;
+    config.db_dir = "test_hash_metadata_memtable_dir";
+    config.slot_id_encoded = false;
+    config.rocks_db.metadata_memtable = type;
+
+    std::filesystem::remove_all(config.db_dir, ec);
+    ASSERT_TRUE(!ec);
+
+    auto storage = std::make_unique<engine::Storage>(&config);
+    auto s = storage->Open();
+    ASSERT_TRUE(s.IsOK());
+
+    auto ctx = engine::Context::NoTransactionContext(storage.get());
+    auto cf = storage->GetCFHandle(ColumnFamilyID::Metadata);
+    std::set<std::string> keys;
+    for (int i = 0; i < 100; i++) {
+      // the keys are written out of order, so the scan below checks the memtable sorts them
+      auto key = "key" + std::to_string(i * 37 % 100);
+      rocksdb::WriteBatch batch;
+      batch.Put(cf, key, "v" + key);
+      ASSERT_TRUE(storage->Write(ctx, storage->DefaultWriteOptions(), &batch).ok());
+      keys.insert(key);
+    }
+
+    for (const auto &key : keys) {
+      std::string value;
+      ASSERT_TRUE(storage->Get(ctx, ctx.GetReadOptions(), cf, key, &value).ok());
+      ASSERT_EQ(value, "v" + key);
+    }
+    std::string value;
+    ASSERT_TRUE(storage->Get(ctx, ctx.GetReadOptions(), cf, "missing", &value).IsNotFound());
+
+    std::unique_ptr<rocksdb::Iterator> iter(storage->NewIterator(ctx, ctx.DefaultScanOptions(), cf));
+    auto expected = keys.begin();
+    for (iter->Seek("key"); iter->Valid(); iter->Next(), expected++) {
+      ASSERT_NE(expected, keys.end());
+      ASSERT_EQ(iter->key().ToString(), *expected);
+    }
+    ASSERT_EQ(expected, keys.end());
+    iter.reset();
+
+    storage.reset();
+    std::filesystem::remove_all(config.db_dir, ec);
+    ASSERT_TRUE(!ec);
+  }
+}
+
+TEST(Storage, WriteBatchPool) {
+  std::error_code ec;
+  Config config;
+  config.db_dir = "test_write_batch_pool_dir";
+  config.slot_id_encoded = false;
+
+  std::filesystem::remove_all(config.db_dir, ec);
+  ASSERT_TRUE(!ec);
+
+  auto storage = std::make_unique<engine::Storage>(&config);
+  auto s = storage->Open();
+  ASSERT_TRUE(s.IsOK());
+
+  auto write = [&storage](int i) {
+    auto ctx = engine::Context::NoTransactionContext(storage.get());
+    auto batch = storage->GetWriteBatchBase();
+    ASSERT_TRUE(batch->Put("k" + std::to_string(i), "v").ok());
+    ASSERT_TRUE(storage->Write(ctx, storage->DefaultWriteOptions(), batch->GetWriteBatch()).ok());
+  };
+  write(0);
+  auto allocations = storage->GetDBStats()->write_batch_allocations.load();
+  // The batch of the first write is reused by the following ones, and it starts empty every time
+  for (int i = 1; i < 100; i++) {
+    write(i);
+    auto batch = storage->GetWriteBatchBase();
+    ASSERT_EQ(batch->GetWriteBatch()->Count(), 0);
+  }
+  ASSERT_EQ(storage->GetDBStats()->write_batch_allocations.load(), allocations);
+
+  storage.reset();
+  std::filesystem::remove_all(config.db_dir, ec);
+  ASSERT_TRUE(!ec);
+}
+
+TEST(Storage, StagedVersion) {
+  std::error_code ec;
+  Config config;
+  config.db_dir = "test_staged_version_dir";
+  config.slot_id_encoded = false;
+
+  std::filesystem::remove_all(config.db_dir, ec);
+  ASSERT_TRUE(!ec);
+
+  auto storage = std::make_unique<engine::Storage>(&config);
+  ASSERT_TRUE(storage->Open().IsOK());
+  auto ctx = engine::Context(storage.get());
+
+  // A version written in several batches and never committed is unstaged
+  uint64_t version = 42;
+  {
+    engine::StagedWriteBatch staged(ctx, storage.get(), version, "");
+    ASSERT_TRUE(staged.Begin().ok());
+    ASSERT_TRUE(staged.Get()->Put("k", std::string(engine::StagedWriteBatch::kMaxBatchBytes, 'a')).ok());
+    ASSERT_TRUE(staged.Flush().ok());
+    ASSERT_TRUE(storage->IsStagedVersion(version));
+  }
+  ASSERT_FALSE(storage->IsStagedVersion(version));
+  std::string value;
+  auto propagate_cf = storage->GetCFHandle(ColumnFamilyID::Propagate);
+  ASSERT_TRUE(storage->GetDB()->Get(rocksdb::ReadOptions(), propagate_cf, "staged_version_42", &value).IsNotFound());
+
+  // The versions staged by the master are staged by the replica until they are committed
+  rocksdb::WriteBatch batch;
+  ASSERT_TRUE(batch.Put(propagate_cf, "staged_version_42", "").ok());
+  ASSERT_TRUE(storage->ReplicaApplyWriteBatch(std::string(batch.Data())).IsOK());
+  ASSERT_TRUE(storage->IsStagedVersion(version));
+  batch.Clear();
+  ASSERT_TRUE(batch.Delete(propagate_cf, "staged_version_42").ok());
+  ASSERT_TRUE(storage->ReplicaApplyWriteBatch(std::string(batch.Data())).IsOK());
+  ASSERT_FALSE(storage->IsStagedVersion(version));
+
+  storage.reset();
+  std::filesystem::remove_all(config.db_dir, ec);
+  ASSERT_TRUE(!ec);
+}
+
+TEST(Storage, ResumeTmpFile) {
+  std::error_code ec;
+  Config config;
+  config.db_dir = "test_resume_tmp_file_dir";
+  config.slot_id_encoded = false;
+  std::filesystem::remove_all(config.db_dir, ec);
+  ASSERT_TRUE(!ec);
+
+  auto storage = std::make_unique<engine::Storage>(&config);
+  ASSERT_TRUE(storage->Open().IsOK());
+
+  using Manager = engine::Storage::ReplDataManager;
+  const std::string dir = config.db_dir;
+  const std::string file = "000001.sst";
+  // larger than the read buffer, so the crc is computed over several chunks
+  std::string data(3 * 1024 * 1024 + 7, 'a');
+  for (size_t i = 0; i < data.size(); i++) data[i] = static_cast<char>(i % 251);
+  size_t half = data.size() / 2;
+
+  uint64_t size = 0;
+  uint32_t crc = 0;
+  ASSERT_EQ(Manager::ResumeTmpFile(storage.get(), dir, file, &size, &crc), nullptr);
+
+  auto tmp = Manager::NewTmpFile(storage.get(), dir, file);
+  ASSERT_NE(tmp, nullptr);
+  ASSERT_TRUE(tmp->Append(Slice(data.data(), half)).ok());
+  ASSERT_TRUE(tmp->Close().ok());
+  tmp.reset();
+
+  tmp = Manager::ResumeTmpFile(storage.get(), dir, file, &size, &crc);
+  ASSERT_NE(tmp, nullptr);
+  ASSERT_EQ(size, half);
+  ASSERT_EQ(crc, rocksdb::crc32c::Value(data.data(), half));
+  ASSERT_EQ(Manager::GetTmpFileSize(storage.get(), dir, file), half);
+
+  ASSERT_TRUE(tmp->Append(Slice(data.data() + half, data.size() - half)).ok());
+  ASSERT_TRUE(tmp->Close().ok());
+  tmp.reset();
+  ASSERT_TRUE(Manager::SwapTmpFile(storage.get(), dir, file).IsOK());
+
+  auto full_crc = rocksdb::crc32c::Value(data.data(), data.size());
+  ASSERT_TRUE(Manager::FileExists(storage.get(), dir, file, full_crc));
+  ASSERT_FALSE(Manager::FileExists(storage.get(), dir, file, full_crc + 1));
+
+  tmp = Manager::NewTmpFile(storage.get(), dir, file);
+  ASSERT_NE(tmp, nullptr);
+  tmp.reset();
+  Manager::RemoveTmpFile(storage.get(), dir, file);
+  ASSERT_EQ(Manager::ResumeTmpFile(storage.get(), dir, file, &size, &crc), nullptr);
+
+  storage.reset();
+  std::filesystem::remove_all(config.db_dir, ec);
+  ASSERT_TRUE(!ec);
+}
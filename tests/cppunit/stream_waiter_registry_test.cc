@@ -0,0 +1,54 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "server/stream_waiter_registry.h"
+
+#include <gtest/gtest.h>
+
+TEST(StreamWaiterRegistry, TakeReadableByWorker) {
+  StreamWaiterRegistry registry;
+  // the workers are only compared, never dereferenced
+  auto *worker1 = reinterpret_cast<Worker *>(0x10);
+  auto *worker2 = reinterpret_cast<Worker *>(0x20);
+
+  registry.Block("ns", "s", {worker1, 1, {1, 0}, 10});
+  registry.Block("ns", "s", {worker1, 2, {1, 0}, 20});
+  registry.Block("ns", "s", {worker2, 3, {1, 0}, std::nullopt});
+  registry.Block("ns", "s", {worker2, 4, {5, 0}, 10});
+  registry.Block("other", "s", {worker1, 5, {1, 0}, 10});
+
+  // the waiters which have read the entry are kept
+  auto readable = registry.TakeReadable("ns", "s", {3, 0});
+  ASSERT_EQ(readable.size(), 2);
+  ASSERT_EQ(readable[worker1].size(), 2);
+  ASSERT_EQ(readable[worker2].size(), 1);
+  ASSERT_EQ(readable[worker2][0].fd, 3);
+  ASSERT_FALSE(readable[worker2][0].read_count);
+
+  // the woken waiters are removed
+  ASSERT_TRUE(registry.TakeReadable("ns", "s", {3, 1}).empty());
+
+  readable = registry.TakeReadable("ns", "s", {6, 0});
+  ASSERT_EQ(readable.size(), 1);
+  ASSERT_EQ(readable[worker2][0].fd, 4);
+
+  registry.Unblock("other", "s", worker1, 5);
+  ASSERT_TRUE(registry.TakeReadable("other", "s", {6, 0}).empty());
+}
@@ -51,3 +51,31 @@ TEST_F(StringReplyTest, BulkString) {
 
   ASSERT_EQ(result.length(), 13 * 10 + 14 * 90 + 15 * 900 + 17 * 9000 + 18 * 90000 + 9);
 }
+
+TEST_F(StringReplyTest, ReplyWriter) {
+  std::string result;
+  auto writer = redis::ReplyWriter(redis::RESP::v2, &result);
+  writer.ArrayHeader(values.size());
+  for (const auto &v : values) {
+    writer.BulkString(v);
+  }
+  ASSERT_EQ(result, redis::ArrayOfBulkStrings(values));
+
+  std::vector<std::string> elems{"a", "bb", "ccc", "dddd"};
+  for (auto ver : {redis::RESP::v2, redis::RESP::v3}) {
+    std::string map_reply;
+    auto map_writer = redis::ReplyWriter(ver, &map_reply);
+    map_writer.MapHeader(elems.size() / 2);
+    for (const auto &elem : elems) {
+      map_writer.BulkString(elem);
+    }
+    ASSERT_EQ(map_reply, redis::MapOfBulkStrings(ver, elems));
+
+    std::string scalar_reply;
+    auto scalar_writer = redis::ReplyWriter(ver, &scalar_reply);
+    scalar_writer.Integer(-42);
+    scalar_writer.Double(1.5);
+    scalar_writer.NilString();
+    ASSERT_EQ(scalar_reply, redis::Integer(-42) + redis::Double(ver, 1.5) + redis::NilString(ver));
+  }
+}
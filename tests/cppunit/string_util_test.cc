@@ -51,6 +51,16 @@ TEST(StringUtil, Trim) {
   }
 }
 
+TEST(StringUtil, ConstantTimeEqual) {
+  ASSERT_TRUE(util::ConstantTimeEqual("", ""));
+  ASSERT_TRUE(util::ConstantTimeEqual("password", "password"));
+  ASSERT_FALSE(util::ConstantTimeEqual("password", "passwore"));
+  ASSERT_FALSE(util::ConstantTimeEqual("password", "pass"));
+  ASSERT_FALSE(util::ConstantTimeEqual("pass", "password"));
+  ASSERT_FALSE(util::ConstantTimeEqual("", "a"));
+  ASSERT_FALSE(util::ConstantTimeEqual(std::string("a\0", 2), "a"));
+}
+
 TEST(StringUtil, Split) {
   std::vector<std::string> expected = {"a", "b", "c", "d"};
   std::vector<std::string> array = util::Split("a,b,c,d", ",");
@@ -84,6 +94,15 @@ TEST(StringUtil, HasPrefix) {
   ASSERT_FALSE(util::HasPrefix("has", "has_prefix"));
 }
 
+TEST(StringUtil, StringMatchPrefix) {
+  ASSERT_EQ(util::StringMatchPrefix("user:123:*"), "user:123:");
+  ASSERT_EQ(util::StringMatchPrefix("user:?:name"), "user:");
+  ASSERT_EQ(util::StringMatchPrefix("user:[ab]*"), "user:");
+  ASSERT_EQ(util::StringMatchPrefix("a\\*b*"), "a*b");
+  ASSERT_EQ(util::StringMatchPrefix("key"), "key");
+  ASSERT_EQ(util::StringMatchPrefix("*"), "");
+}
+
 TEST(StringUtil, EscapeString) {
   std::unordered_map<std::string, std::string> origin_to_escaped = {
       {"abc", "abc"},
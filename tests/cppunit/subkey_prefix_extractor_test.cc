@@ -0,0 +1,46 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "storage/subkey_prefix_extractor.h"
+
+#include <gtest/gtest.h>
+
+#include "storage/redis_metadata.h"
+
+TEST(SubKeyPrefixExtractor, Transform) {
+  for (bool slot_id_encoded : {false, true}) {
+    engine::SubKeyPrefixExtractor extractor(slot_id_encoded);
+    std::string ns_key = ComposeNamespaceKey("ns", "key", slot_id_encoded);
+    std::string prefix = InternalKey(ns_key, "", 42, slot_id_encoded).Encode();
+    std::string sub_key = InternalKey(ns_key, "field", 42, slot_id_encoded).Encode();
+
+    ASSERT_TRUE(extractor.InDomain(prefix));
+    ASSERT_TRUE(extractor.InDomain(sub_key));
+    EXPECT_EQ(extractor.Transform(prefix), prefix);
+    EXPECT_EQ(extractor.Transform(sub_key), prefix);
+
+    // A different version is a different prefix
+    std::string next_version = InternalKey(ns_key, "field", 43, slot_id_encoded).Encode();
+    EXPECT_NE(extractor.Transform(next_version), prefix);
+
+    EXPECT_FALSE(extractor.InDomain(""));
+    EXPECT_FALSE(extractor.InDomain(rocksdb::Slice(prefix.data(), prefix.size() - 1)));
+  }
+}
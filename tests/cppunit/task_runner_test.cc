@@ -23,7 +23,9 @@
 #include <gtest/gtest.h>
 
 #include <atomic>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 #include "time_util.h"
 
@@ -106,3 +108,54 @@ TEST(TaskRunner, PublishAfterStart) {
   tr.Cancel();
   _ = tr.Join();
 }
+
+TEST(TaskRunner, Priority) {
+  std::vector<int> order;
+  std::mutex mu;
+  TaskRunner tr(1, 1024);
+
+  for (int i = 0; i < 3; i++) {
+    tr.Publish(
+        [&, i] {
+          std::lock_guard<std::mutex> guard(mu);
+          order.push_back(i);
+        },
+        TaskPriority::kLow, "bulk");
+  }
+  tr.Publish(
+      [&] {
+        std::lock_guard<std::mutex> guard(mu);
+        order.push_back(-1);
+      },
+      TaskPriority::kHigh, "latency");
+
+  auto _ = tr.Start();
+  std::this_thread::sleep_for(0.1s);
+  tr.Cancel();
+  _ = tr.Join();
+
+  ASSERT_EQ(order, std::vector<int>({-1, 0, 1, 2}));
+  auto stats = tr.GetStats();
+  ASSERT_EQ(stats["bulk"].count, 3);
+  ASSERT_EQ(stats["latency"].count, 1);
+}
+
+TEST(TaskRunner, Steal) {
+  std::atomic<int> counter = 0;
+  TaskRunner tr(2, 1024);
+  auto _ = tr.Start();
+
+  // the tasks published from the long task go to the deque of its thread, and are stolen by the other one
+  tr.Publish([&] {
+    for (int i = 0; i < 10; i++) {
+      tr.Publish([&counter] { counter.fetch_add(1); });
+    }
+    std::this_thread::sleep_for(0.5s);
+  });
+
+  std::this_thread::sleep_for(0.2s);
+  ASSERT_EQ(counter, 10);
+
+  tr.Cancel();
+  _ = tr.Join();
+}
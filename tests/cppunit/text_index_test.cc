@@ -0,0 +1,168 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "search/text_index.h"
+
+#include <gtest/gtest.h>
+#include <test_base.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "fmt/format.h"
+#include "search/text_analyzer.h"
+
+using namespace redis;
+
+TEST(TextAnalyzerTest, Tokenize) {
+  ASSERT_EQ(TokenizeText("The quick, brown FOXES jumped!", true),
+            (std::vector<std::string>{"the", "quick", "brown", "fox", "jump"}));
+  ASSERT_EQ(TokenizeText("The quick, brown FOXES jumped!", false),
+            (std::vector<std::string>{"the", "quick", "brown", "foxes", "jumped"}));
+  ASSERT_EQ(TokenizeText("  --  ", true), std::vector<std::string>{});
+  ASSERT_EQ(TokenizeText("café au lait", false), (std::vector<std::string>{"café", "au", "lait"}));
+}
+
+TEST(TextAnalyzerTest, Stem) {
+  ASSERT_EQ(StemWord("running"), "run");
+  ASSERT_EQ(StemWord("stopped"), "stop");
+  ASSERT_EQ(StemWord("falling"), "fall");
+  ASSERT_EQ(StemWord("flies"), "fly");
+  ASSERT_EQ(StemWord("classes"), "class");
+  ASSERT_EQ(StemWord("churches"), "church");
+  ASSERT_EQ(StemWord("jumps"), "jump");
+  ASSERT_EQ(StemWord("bus"), "bus");
+  ASSERT_EQ(StemWord("status"), "status");
+  ASSERT_EQ(StemWord("speed"), "speed");
+  ASSERT_EQ(StemWord("string"), "string");
+}
+
+TEST(TextAnalyzerTest, Match) {
+  auto doc = TokenizeText("the quick brown fox jumps over the lazy dog", true);
+  ASSERT_TRUE(MatchTokens(doc, TokenizeText("brown quick", true), false));
+  ASSERT_TRUE(MatchTokens(doc, TokenizeText("quick brown", true), true));
+  ASSERT_FALSE(MatchTokens(doc, TokenizeText("brown quick", true), true));
+  ASSERT_TRUE(MatchTokens(doc, TokenizeText("jumped over the", true), true));
+  ASSERT_FALSE(MatchTokens(doc, TokenizeText("quick cat", true), false));
+  ASSERT_FALSE(MatchTokens(doc, {}, false));
+}
+
+TEST(TextPostingBlockTest, EncodeDecode) {
+  TextPostingBlock block;
+  block.postings = {{"doc1", 3, {0, 2}}, {"doc10", 1, {0}}, {"doc2", 100, {5, 50, 99}}, {"other", 2, {1}}};
+
+  std::string value;
+  block.Encode(&value);
+
+  TextPostingBlock decoded;
+  ASSERT_TRUE(decoded.Decode(value).ok());
+  ASSERT_EQ(decoded.postings, block.postings);
+
+  Slice last_key;
+  ASSERT_TRUE(TextPostingBlock::DecodeLastKey(value, &last_key).ok());
+  ASSERT_EQ(last_key.ToString(), "other");
+
+  ASSERT_FALSE(decoded.Decode(Slice(value.data(), value.size() - 1)).ok());
+}
+
+struct TextIndexTest : TestBase {
+  SearchKey search_key{"text_test", "idx", "f"};
+  TextIndex index{search_key, storage_.get()};
+
+  static std::string Key(int i) { return fmt::format("key{:03}", i); }
+
+  void Update(const std::string &key, const std::string &original, const std::string &current) {
+    auto ctx = engine::Context::NoTransactionContext(storage_.get());
+    ASSERT_TRUE(index.Update(ctx, key, TokenizeText(original, true), TokenizeText(current, true)).IsOK());
+  }
+
+  uint64_t DocFreq(const std::string &term) {
+    auto ctx = engine::Context::NoTransactionContext(storage_.get());
+    return *index.GetDocFreq(ctx, term);
+  }
+
+  TextFieldHeader Header() {
+    auto ctx = engine::Context::NoTransactionContext(storage_.get());
+    return *index.GetFieldHeader(ctx);
+  }
+
+  std::vector<std::string> Keys(const std::string &term) {
+    auto ctx = engine::Context::NoTransactionContext(storage_.get());
+    TextPostingCursor cursor(ctx, search_key, term);
+    std::vector<std::string> keys;
+    EXPECT_TRUE(cursor.Seek({}).IsOK());
+    for (; cursor.Valid(); EXPECT_TRUE(cursor.Next().IsOK())) keys.push_back(cursor.Get().key);
+    return keys;
+  }
+};
+
+TEST_F(TextIndexTest, Update) {
+  // the postings of a term are split into blocks
+  for (int i = 0; i < 300; i++) {
+    Update(Key(i), "", i % 2 == 0 ? "quick fox" : "lazy dogs and fox");
+  }
+
+  ASSERT_EQ(DocFreq("fox"), 300);
+  ASSERT_EQ(DocFreq("quick"), 150);
+  ASSERT_EQ(DocFreq("dog"), 150);
+  ASSERT_EQ(DocFreq("cat"), 0);
+  ASSERT_EQ(Header().docs, 300);
+  ASSERT_EQ(Header().tokens, 150 * 2 + 150 * 4);
+
+  auto keys = Keys("fox");
+  ASSERT_EQ(keys.size(), 300);
+  ASSERT_TRUE(std::is_sorted(keys.begin(), keys.end()));
+  ASSERT_EQ(Keys("quick").size(), 150);
+
+  {
+    auto ctx = engine::Context::NoTransactionContext(storage_.get());
+    TextPostingCursor cursor(ctx, search_key, "quick");
+    ASSERT_TRUE(cursor.Seek(Key(151)).IsOK());
+    ASSERT_TRUE(cursor.Valid());
+    ASSERT_EQ(cursor.Get().key, Key(152));
+    ASSERT_EQ(cursor.Get().length, 2);
+    ASSERT_EQ(cursor.Get().positions, std::vector<uint32_t>{0});
+    ASSERT_TRUE(cursor.Seek(Key(152)).IsOK());
+    ASSERT_EQ(cursor.Get().key, Key(152));
+    ASSERT_TRUE(cursor.Seek(Key(299)).IsOK());
+    ASSERT_FALSE(cursor.Valid());
+  }
+
+  Update(Key(0), "quick fox", "lazy dog");
+  ASSERT_EQ(DocFreq("quick"), 149);
+  ASSERT_EQ(DocFreq("fox"), 299);
+  ASSERT_EQ(DocFreq("dog"), 151);
+  ASSERT_EQ(Header().docs, 300);
+  ASSERT_EQ(Header().tokens, 150 * 2 + 150 * 4);
+  ASSERT_EQ(Keys("quick").front(), Key(2));
+
+  Update(Key(2), "quick fox", "");
+  ASSERT_EQ(DocFreq("quick"), 148);
+  ASSERT_EQ(Header().docs, 299);
+  ASSERT_EQ(Header().tokens, 150 * 2 + 150 * 4 - 2);
+  ASSERT_EQ(Keys("quick").front(), Key(4));
+
+  // indexing a key again without its original text doesn't count it twice
+  Update(Key(4), "", "quick fox");
+  ASSERT_EQ(DocFreq("quick"), 148);
+  ASSERT_EQ(Header().docs, 299);
+  ASSERT_EQ(Header().tokens, 150 * 2 + 150 * 4 - 2);
+}
@@ -0,0 +1,56 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+#include "storage/tiered_cache_tuner.h"
+
+#include <gtest/gtest.h>
+
+using engine::TieredCacheTuner;
+
+TEST(TieredCacheTuner, Rebalance) {
+  TieredCacheTuner tuner(0.2);
+  constexpr uint64_t kLookups = TieredCacheTuner::kMinLookups;
+
+  // The first period only sets the baseline
+  uint64_t hits = 0, misses = 0, secondary_hits = 0;
+  EXPECT_FALSE(tuner.Tune(hits, misses, secondary_hits));
+
+  // Too few lookups
+  hits += kLookups / 2;
+  EXPECT_FALSE(tuner.Tune(hits, misses, secondary_hits));
+
+  // 10% of the lookups are served by the secondary cache
+  hits += kLookups;
+  secondary_hits += kLookups / 10;
+  EXPECT_TRUE(tuner.Tune(hits, misses, secondary_hits));
+  EXPECT_DOUBLE_EQ(tuner.GetRatio(), 0.2 + TieredCacheTuner::kStep);
+
+  // 3% is between the thresholds
+  misses += kLookups;
+  secondary_hits += kLookups * 3 / 100;
+  EXPECT_FALSE(tuner.Tune(hits, misses, secondary_hits));
+  EXPECT_DOUBLE_EQ(tuner.GetRatio(), 0.2 + TieredCacheTuner::kStep);
+
+  // No secondary hits, it's shrunk down to the lower bound
+  for (int i = 0; i < 10; i++) {
+    hits += kLookups;
+    tuner.Tune(hits, misses, secondary_hits);
+  }
+  EXPECT_DOUBLE_EQ(tuner.GetRatio(), TieredCacheTuner::kMinRatio);
+}
@@ -0,0 +1,81 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "server/tracer.h"
+
+#include <gtest/gtest.h>
+
+#include <jsoncons/json.hpp>
+#include <string>
+
+TEST(Tracer, ParseTraceContext) {
+  auto context = TraceContext::Parse("00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01");
+  ASSERT_TRUE(context);
+  ASSERT_EQ(context->trace_id[0], 0x4b);
+  ASSERT_EQ(context->trace_id[15], 0x36);
+  ASSERT_EQ(context->span_id[0], 0x00);
+  ASSERT_EQ(context->span_id[7], 0xb7);
+
+  ASSERT_FALSE(TraceContext::Parse(""));
+  ASSERT_FALSE(TraceContext::Parse("01-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01"));
+  ASSERT_FALSE(TraceContext::Parse("00-4BF92F3577B34DA6A3CE929D0E0E4736-00f067aa0ba902b7-01"));
+  ASSERT_FALSE(TraceContext::Parse("00-00000000000000000000000000000000-00f067aa0ba902b7-01"));
+  ASSERT_FALSE(TraceContext::Parse("00-4bf92f3577b34da6a3ce929d0e0e4736-0000000000000000-01"));
+  ASSERT_FALSE(TraceContext::Parse("00-4bf92f3577b34da6a3ce929d0e0e4736_00f067aa0ba902b7-01"));
+}
+
+TEST(Tracer, EncodeBatch) {
+  Span span;
+  span.trace_id[15] = 1;
+  span.span_id[7] = 2;
+  span.name = "get";
+  span.is_server = true;
+  span.start_ns = 1000;
+  span.end_ns = 2000;
+  span.attributes.emplace_back("db.operation", "get");
+
+  Span stage;
+  stage.trace_id = span.trace_id;
+  stage.span_id[7] = 3;
+  stage.parent_span_id = span.span_id;
+  stage.name = "execute";
+  stage.start_ns = 1200;
+  stage.end_ns = 1800;
+
+  std::string line;
+  Tracer::EncodeBatch({span, stage}, &line);
+  auto request = jsoncons::json::parse(line);
+  const auto &resource_spans = request["resourceSpans"][0];
+  ASSERT_EQ(resource_spans["resource"]["attributes"][0]["value"]["stringValue"].as_string(), "kvrocks");
+
+  const auto &spans = resource_spans["scopeSpans"][0]["spans"];
+  ASSERT_EQ(spans.size(), 2);
+  ASSERT_EQ(spans[0]["traceId"].as_string(), "00000000000000000000000000000001");
+  ASSERT_EQ(spans[0]["spanId"].as_string(), "0000000000000002");
+  ASSERT_FALSE(spans[0].contains("parentSpanId"));
+  ASSERT_EQ(spans[0]["kind"].as<int>(), 2);
+  ASSERT_EQ(spans[0]["startTimeUnixNano"].as_string(), "1000");
+  ASSERT_EQ(spans[0]["attributes"][0]["key"].as_string(), "db.operation");
+
+  ASSERT_EQ(spans[1]["name"].as_string(), "execute");
+  ASSERT_EQ(spans[1]["parentSpanId"].as_string(), "0000000000000002");
+  ASSERT_EQ(spans[1]["kind"].as<int>(), 1);
+  ASSERT_EQ(spans[1]["endTimeUnixNano"].as_string(), "1800");
+}
@@ -0,0 +1,109 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "server/tracking_table.h"
+
+#include <gtest/gtest.h>
+
+TEST(TrackingTable, TrackAndInvalidate) {
+  TrackingTable table;
+  // the workers are only compared, never dereferenced
+  auto *worker = reinterpret_cast<Worker *>(0x10);
+  table.EnableClient(1, "ns", {worker, 11, 1, redis::RESP::v3, false}, {});
+  table.EnableClient(2, "ns", {worker, 12, 2, redis::RESP::v3, false}, {false, false, false, true, 0, {}});
+  ASSERT_TRUE(table.HasClients());
+
+  ASSERT_TRUE(table.Track("ns", "a", 1, 0).empty());
+  ASSERT_TRUE(table.Track("ns", "a", 2, 0).empty());
+  ASSERT_TRUE(table.Track("ns", "b", 1, 0).empty());
+  ASSERT_TRUE(table.Track("other", "a", 1, 0).empty());
+  ASSERT_EQ(table.GetKeySize(), 3);
+
+  // the writer in the NOLOOP mode isn't notified
+  auto invalidations = table.Invalidate("ns", {"a", "b", "c"}, 2);
+  ASSERT_EQ(invalidations.size(), 1);
+  ASSERT_EQ(invalidations[1], (std::vector<std::string>{"a", "b"}));
+  ASSERT_EQ(table.GetKeySize(), 1);
+
+  // the keys are notified once until they are read again
+  ASSERT_TRUE(table.Invalidate("ns", {"a"}, 1).empty());
+
+  auto ids = table.InvalidateAll();
+  ASSERT_EQ(ids, (std::vector<uint64_t>{1, 2}));
+  ASSERT_EQ(table.GetKeySize(), 0);
+
+  table.DisableClient(1);
+  table.DisableClient(2);
+  ASSERT_FALSE(table.HasClients());
+  ASSERT_FALSE(table.GetTarget(1));
+}
+
+TEST(TrackingTable, Broadcast) {
+  TrackingTable table;
+  auto *worker = reinterpret_cast<Worker *>(0x10);
+  TrackingOptions options;
+  options.bcast = true;
+  options.prefixes = {"user:", "user:1"};
+  table.EnableClient(1, "ns", {worker, 11, 1, redis::RESP::v3, false}, options);
+  table.EnableClient(2, "ns", {worker, 12, 3, redis::RESP::v2, true}, {true, false, false, false, 3, {}});
+
+  auto invalidations = table.Invalidate("ns", {"user:10", "item:1"}, 3);
+  ASSERT_EQ(invalidations.size(), 2);
+  ASSERT_EQ(invalidations[1], (std::vector<std::string>{"user:10"}));
+  ASSERT_EQ(invalidations[2], (std::vector<std::string>{"user:10", "item:1"}));
+  ASSERT_TRUE(table.Invalidate("other", {"user:10"}, 3).empty());
+
+  table.DisableClient(1);
+  invalidations = table.Invalidate("ns", {"user:10"}, 3);
+  ASSERT_EQ(invalidations.size(), 1);
+  ASSERT_TRUE(table.GetTarget(2)->redirected);
+}
+
+TEST(TrackingTable, EvictBeyondMaxKeys) {
+  TrackingTable table;
+  auto *worker = reinterpret_cast<Worker *>(0x10);
+  table.EnableClient(1, "ns", {worker, 11, 1, redis::RESP::v3, false}, {});
+
+  size_t evicted = 0;
+  for (int i = 0; i < 100; i++) {
+    for (const auto &[id, keys] : table.Track("ns", "key" + std::to_string(i), 1, 10)) {
+      ASSERT_EQ(id, 1);
+      evicted += keys.size();
+    }
+  }
+  ASSERT_EQ(table.GetKeySize(), 10);
+  ASSERT_EQ(evicted, 90);
+}
+
+TEST(TrackingTable, BreakRedirect) {
+  TrackingTable table;
+  auto *worker = reinterpret_cast<Worker *>(0x10);
+  table.EnableClient(1, "ns", {worker, 12, 2, redis::RESP::v3, true}, {false, false, false, false, 2, {}});
+  ASSERT_EQ(table.GetTarget(1)->id, 2);
+
+  // the broken client is reported once, and its invalidations are dropped until it enables tracking again
+  ASSERT_TRUE(table.BreakRedirect(1));
+  ASSERT_FALSE(table.BreakRedirect(1));
+  ASSERT_FALSE(table.GetTarget(1));
+  ASSERT_FALSE(table.BreakRedirect(3));
+
+  table.EnableClient(1, "ns", {worker, 11, 1, redis::RESP::v3, false}, {});
+  ASSERT_TRUE(table.GetTarget(1));
+}
@@ -0,0 +1,106 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "server/traffic_capture.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <filesystem>
+
+static const redis::CommandAttributes *GetAttributes(const std::string &name) {
+  return redis::CommandTable::GetOriginal()->at(name);
+}
+
+TEST(TrafficCapture, CaptureAndRead) {
+  auto path = (std::filesystem::temp_directory_path() / "traffic_capture_test.cap").string();
+  TrafficCapture capture;
+  ASSERT_TRUE(capture.Start({path, 1, false, false, 0}));
+  ASSERT_TRUE(capture.IsRunning());
+  ASSERT_TRUE(capture.IsSampled(1));
+
+  capture.Capture(1, GetAttributes("set"), {"set", "a", "1"});
+  capture.Capture(2, GetAttributes("get"), {"get", "a"});
+  // the commands carrying passwords are never captured
+  capture.Capture(1, GetAttributes("auth"), {"auth", "secret"});
+  capture.Stop();
+  ASSERT_FALSE(capture.IsRunning());
+  ASSERT_EQ(capture.GetCapturedCommands(), 2);
+
+  TrafficCaptureReader reader(path);
+  ASSERT_TRUE(reader.Open());
+  TrafficCapture::Record record;
+  ASSERT_TRUE(*reader.Next(&record));
+  ASSERT_EQ(record.conn_id, 1);
+  ASSERT_EQ(record.args, (std::vector<std::string>{"set", "a", "1"}));
+  auto first_time = record.time_us;
+  ASSERT_TRUE(*reader.Next(&record));
+  ASSERT_EQ(record.conn_id, 2);
+  ASSERT_EQ(record.args, (std::vector<std::string>{"get", "a"}));
+  ASSERT_GE(record.time_us, first_time);
+  ASSERT_FALSE(*reader.Next(&record));
+
+  std::remove(path.c_str());
+}
+
+TEST(TrafficCapture, Anonymize) {
+  auto path = (std::filesystem::temp_directory_path() / "traffic_capture_anonymize_test.cap").string();
+  TrafficCapture capture;
+  ASSERT_TRUE(capture.Start({path, 1, true, true, 0}));
+  capture.Capture(1, GetAttributes("set"), {"set", "user:{1000}:name", "alice smith", "EX", "100"});
+  capture.Capture(1, GetAttributes("get"), {"get", "user:{1000}:name"});
+  capture.Capture(1, GetAttributes("get"), {"get", "user:{1000}:mail"});
+  capture.Stop();
+
+  TrafficCaptureReader reader(path);
+  ASSERT_TRUE(reader.Open());
+  TrafficCapture::Record set_record, get_record, other_record;
+  ASSERT_TRUE(*reader.Next(&set_record));
+  ASSERT_TRUE(*reader.Next(&get_record));
+  ASSERT_TRUE(*reader.Next(&other_record));
+
+  const auto &key = set_record.args[1];
+  ASSERT_EQ(key.find("user"), std::string::npos);
+  // the same keys are mapped to the same hashes, and the keys with the same tag share the tag
+  ASSERT_EQ(get_record.args[1], key);
+  ASSERT_NE(other_record.args[1], key);
+  ASSERT_EQ(other_record.args[1].substr(0, other_record.args[1].find('}')), key.substr(0, key.find('}')));
+  // the values keep their sizes, the options and the numbers are kept
+  ASSERT_EQ(set_record.args[2], std::string(11, 'x'));
+  ASSERT_EQ(set_record.args[3], "EX");
+  ASSERT_EQ(set_record.args[4], "100");
+
+  std::remove(path.c_str());
+}
+
+TEST(TrafficCapture, Sample) {
+  auto path = (std::filesystem::temp_directory_path() / "traffic_capture_sample_test.cap").string();
+  TrafficCapture capture;
+  ASSERT_FALSE(capture.Start({path, 0, false, false, 0}));
+  ASSERT_TRUE(capture.Start({path, 0.5, false, false, 0}));
+
+  int sampled = 0;
+  for (uint64_t id = 1; id <= 10000; id++) sampled += capture.IsSampled(id) ? 1 : 0;
+  ASSERT_GT(sampled, 4000);
+  ASSERT_LT(sampled, 6000);
+  capture.Stop();
+
+  std::remove(path.c_str());
+}
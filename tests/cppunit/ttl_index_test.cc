@@ -0,0 +1,100 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "storage/ttl_index.h"
+
+#include <gtest/gtest.h>
+
+#include "test_base.h"
+#include "time_util.h"
+#include "types/redis_hash.h"
+#include "types/redis_string.h"
+
+class TTLIndexTest : public TestBase {
+ protected:
+  TTLIndexTest() {
+    config_.ttl_index_enabled = true;
+    hash_ = std::make_unique<redis::Hash>(storage_.get(), "ttl_ns");
+    string_ = std::make_unique<redis::String>(storage_.get(), "ttl_ns");
+  }
+
+  size_t countEntries(ColumnFamilyID cf) {
+    size_t n = 0;
+    auto iter = util::UniqueIterator(*ctx_, ctx_->DefaultScanOptions(), cf);
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) n++;
+    return n;
+  }
+
+  std::unique_ptr<redis::Hash> hash_;
+  std::unique_ptr<redis::String> string_;
+};
+
+TEST(TTLIndex, EncodeAndDecode) {
+  uint64_t expire = 0;
+  rocksdb::Slice ns_key;
+  std::string key = engine::ComposeTTLIndexKey(12345, "ns_key");
+  ASSERT_TRUE(engine::ParseTTLIndexKey(key, &expire, &ns_key));
+  EXPECT_EQ(expire, 12345);
+  EXPECT_EQ(ns_key.ToString(), "ns_key");
+  EXPECT_LT(engine::ComposeTTLIndexKey(1, "b"), engine::ComposeTTLIndexKey(256, "a"));
+}
+
+TEST_F(TTLIndexTest, ReapExpiredKeys) {
+  uint64_t ret = 0;
+  auto s = hash_->Set(*ctx_, "expired_hash", "f1", "v1", &ret);
+  ASSERT_TRUE(s.ok());
+  s = hash_->Set(*ctx_, "expired_hash", "f2", "v2", &ret);
+  ASSERT_TRUE(s.ok());
+  s = hash_->Expire(*ctx_, "expired_hash", 1);
+  ASSERT_TRUE(s.ok());
+  s = hash_->Set(*ctx_, "live_hash", "f1", "v1", &ret);
+  ASSERT_TRUE(s.ok());
+  s = string_->SetEX(*ctx_, "live_string", "v", util::GetTimeStampMS() + 1000000);
+  ASSERT_TRUE(s.ok());
+  EXPECT_EQ(countEntries(ColumnFamilyID::TTLIndex), 2);
+
+  engine::ExpiredKeyReaper reaper(storage_.get());
+  auto reaped = reaper.Reap(100);
+  ASSERT_TRUE(reaped);
+  EXPECT_EQ(*reaped, 1);
+  ctx_->RefreshLatestSnapshot();
+
+  // The expired hash is gone with its fields, the string isn't expired yet
+  EXPECT_EQ(countEntries(ColumnFamilyID::TTLIndex), 1);
+  EXPECT_EQ(countEntries(ColumnFamilyID::PrimarySubkey), 1);
+  std::string value;
+  s = string_->Get(*ctx_, "live_string", &value);
+  EXPECT_TRUE(s.ok() && value == "v");
+
+  // An entry whose key has been rewritten without the TTL is only dropped
+  s = string_->Set(*ctx_, "live_string", "v2");
+  ASSERT_TRUE(s.ok());
+  rocksdb::WriteBatch batch;
+  s = batch.Put(storage_->GetCFHandle(ColumnFamilyID::TTLIndex),
+                engine::ComposeTTLIndexKey(1, string_->AppendNamespacePrefix("live_string")), std::string(8, '\0'));
+  ASSERT_TRUE(s.ok());
+  s = storage_->Write(*ctx_, storage_->DefaultWriteOptions(), &batch);
+  ASSERT_TRUE(s.ok());
+  reaped = reaper.Reap(100);
+  ASSERT_TRUE(reaped);
+  EXPECT_EQ(*reaped, 0);
+  s = string_->Get(*ctx_, "live_string", &value);
+  EXPECT_TRUE(s.ok() && value == "v2");
+}
@@ -20,10 +20,13 @@
 
 #include <gtest/gtest.h>
 
+#include <cstring>
 #include <memory>
 
+#include "common/bit_util.h"
 #include "test_base.h"
 #include "types/redis_bitmap.h"
+#include "types/redis_bitmap_container.h"
 #include "types/redis_string.h"
 
 class RedisBitmapTest : public TestFixture, public ::testing::TestWithParam<bool> {
@@ -631,3 +634,132 @@ TEST_P(RedisBitmapTest, BitfieldStringGetSetTest) {
     i += 8;
   }
 }
+
+TEST_P(RedisBitmapTest, BitOpSparse) {
+  if (!GetParam()) GTEST_SKIP() << "BITOP doesn't support the bitmap strings";
+
+  std::string key_a = key_ + "_a", key_b = key_ + "_b", dst = key_ + "_dst";
+  bool bit = false;
+  // The segments of both sources interleave, and the lexical order of their subkeys isn't the numeric one
+  for (uint32_t i = 0; i < 200; i++) {
+    bitmap_->SetBit(*ctx_, key_a, i * 3 * 1024 * 8 + 5, true, &bit);
+    bitmap_->SetBit(*ctx_, key_b, i * 2 * 1024 * 8 + 5, true, &bit);
+  }
+  bitmap_->SetBit(*ctx_, key_b, 200000000U, true, &bit);
+
+  int64_t len = 0;
+  uint32_t cnt = 0;
+  bitmap_->BitOp(*ctx_, kBitOpOr, "or", dst, {key_a, key_b}, &len);
+  EXPECT_EQ(len, 200000000LL / 8 + 1);
+  bitmap_->BitCount(*ctx_, dst, 0, -1, false, &cnt);
+  // the segments i * 6 are shared by both sources
+  EXPECT_EQ(cnt, 200 + 200 - 67 + 1);
+
+  bitmap_->BitOp(*ctx_, kBitOpAnd, "and", dst, {key_a, key_b}, &len);
+  bitmap_->BitCount(*ctx_, dst, 0, -1, false, &cnt);
+  EXPECT_EQ(cnt, 67);
+  bitmap_->GetBit(*ctx_, dst, 6 * 1024 * 8 + 5, &bit);
+  EXPECT_TRUE(bit);
+  bitmap_->GetBit(*ctx_, dst, 3 * 1024 * 8 + 5, &bit);
+  EXPECT_FALSE(bit);
+
+  bitmap_->BitOp(*ctx_, kBitOpXor, "xor", dst, {key_a, key_b}, &len);
+  bitmap_->BitCount(*ctx_, dst, 0, -1, false, &cnt);
+  EXPECT_EQ(cnt, 200 + 200 - 2 * 67 + 1);
+
+  bitmap_->BitOp(*ctx_, kBitOpNot, "not", dst, {key_a}, &len);
+  EXPECT_EQ(len, (199 * 3 * 1024 * 8 + 5) / 8 + 1);
+  bitmap_->BitCount(*ctx_, dst, 0, -1, false, &cnt);
+  EXPECT_EQ(cnt, len * 8 - 200);
+
+  for (const auto &key : {key_a, key_b, dst}) {
+    auto s = bitmap_->Del(*ctx_, key);
+  }
+}
+
+TEST(BitmapContainer, EncodeAndDecode) {
+  std::string sparse(1024, 0), runs(1024, 0), dense(700, 0);
+  sparse[3] = 0x10;
+  sparse[1000] = 0x01;
+  memset(runs.data() + 100, 0xff, 300);
+  for (size_t i = 0; i < dense.size(); i++) dense[i] = static_cast<char>(i * 37 + 1);
+
+  for (const auto &segment : {sparse, runs, dense}) {
+    std::string container = redis::BitmapContainer::FromDense(segment);
+    EXPECT_LT(container.size(), segment.size() + 2);
+    std::string decoded;
+    ASSERT_TRUE(redis::BitmapContainer::ToDense(container, segment.size(), &decoded).ok());
+    EXPECT_EQ(decoded, segment);
+
+    uint32_t set_bits = 0;
+    for (uint32_t bit = 0; bit < segment.size() * 8; bit++) {
+      bool expected = util::lsb::GetBit(reinterpret_cast<const uint8_t *>(segment.data()), bit);
+      EXPECT_EQ(redis::BitmapContainer::GetBit(container, bit), expected) << bit;
+      set_bits += expected;
+    }
+    EXPECT_EQ(redis::BitmapContainer::Count(container), set_bits);
+  }
+  EXPECT_EQ(redis::BitmapContainer::FromDense(sparse).size(), 1 + 2 * 2);
+  EXPECT_EQ(redis::BitmapContainer::FromDense(runs).size(), 1 + 2 * 2);
+  EXPECT_TRUE(redis::BitmapContainer::FromDense(std::string(1024, 0)).empty());
+}
+
+TEST_P(RedisBitmapTest, RoaringEncoding) {
+  if (!GetParam()) GTEST_SKIP() << "only the bitmaps are roaring encoded";
+
+  storage_->GetConfig()->bitmap_roaring_encoding = true;
+  std::string key_a = key_ + "_a", dst = key_ + "_dst";
+  uint32_t offsets[] = {0, 123, 1024 * 8, 1024 * 8 + 1, 3 * 1024 * 8, 3 * 1024 * 8 + 1, 100 * 1024 * 8 + 7};
+  bool bit = false;
+  for (const auto &offset : offsets) {
+    bitmap_->SetBit(*ctx_, key_, offset, true, &bit);
+    EXPECT_FALSE(bit);
+  }
+  for (uint32_t offset = 50 * 1024 * 8; offset < 52 * 1024 * 8; offset++) {
+    bitmap_->SetBit(*ctx_, key_a, offset, true, &bit);
+  }
+  storage_->GetConfig()->bitmap_roaring_encoding = false;
+
+  for (const auto &offset : offsets) {
+    bitmap_->GetBit(*ctx_, key_, offset, &bit);
+    EXPECT_TRUE(bit);
+  }
+  bitmap_->GetBit(*ctx_, key_, 124, &bit);
+  EXPECT_FALSE(bit);
+
+  uint32_t cnt = 0;
+  bitmap_->BitCount(*ctx_, key_, 0, -1, false, &cnt);
+  EXPECT_EQ(cnt, 7);
+  bitmap_->BitCount(*ctx_, key_, 1, 3 * 1024, false, &cnt);
+  EXPECT_EQ(cnt, 5);
+  bitmap_->BitCount(*ctx_, key_a, 0, -1, false, &cnt);
+  EXPECT_EQ(cnt, 2 * 1024 * 8);
+
+  int64_t pos = 0;
+  bitmap_->BitPos(*ctx_, key_, true, 16, -1, false, &pos, false);
+  EXPECT_EQ(pos, 1024 * 8);
+  bitmap_->BitPos(*ctx_, key_a, false, 50 * 1024, -1, false, &pos, false);
+  EXPECT_EQ(pos, 52 * 1024 * 8);
+
+  // Clearing the only bit of a segment drops its container
+  bitmap_->SetBit(*ctx_, key_, 100 * 1024 * 8 + 7, false, &bit);
+  EXPECT_TRUE(bit);
+  bitmap_->GetBit(*ctx_, key_, 100 * 1024 * 8 + 7, &bit);
+  EXPECT_FALSE(bit);
+
+  int64_t len = 0;
+  bitmap_->BitOp(*ctx_, kBitOpOr, "or", dst, {key_, key_a}, &len);
+  bitmap_->BitCount(*ctx_, dst, 0, -1, false, &cnt);
+  EXPECT_EQ(cnt, 6 + 2 * 1024 * 8);
+
+  std::string value;
+  bitmap_->GetString(*ctx_, key_, 1024 * 1024, &value);
+  EXPECT_EQ(value.size(), 100 * 1024 + 1);
+  EXPECT_EQ(static_cast<uint8_t>(value[0]), 0x80);
+  EXPECT_EQ(static_cast<uint8_t>(value[1024]), 0xc0);
+  EXPECT_EQ(static_cast<uint8_t>(value[100 * 1024]), 0);
+
+  for (const auto &key : {key_a, dst}) {
+    auto s = bitmap_->Del(*ctx_, key);
+  }
+}
@@ -21,6 +21,8 @@
 #include <gtest/gtest.h>
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "test_base.h"
 #include "types/redis_bloom_chain.h"
@@ -81,3 +83,37 @@ TEST_F(RedisBloomChainTest, BasicAddAndTest) {
   }
   s = sb_chain_->Del(*ctx_, key_);
 }
+
+TEST_F(RedisBloomChainTest, MAddAndMExistsAcrossFilters) {
+  auto s = sb_chain_->Reserve(*ctx_, key_, 10, 0.01, 2);
+  EXPECT_TRUE(s.ok());
+
+  // 100 items scale the chain to several filters within one command
+  std::vector<std::string> items;
+  for (int i = 0; i < 100; i++) items.push_back("item" + std::to_string(i));
+  items.emplace_back("item7");
+  std::vector<redis::BloomFilterAddResult> rets(items.size());
+  s = sb_chain_->MAdd(*ctx_, key_, items, &rets);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(rets.back(), redis::BloomFilterAddResult::kExist);
+
+  redis::BloomFilterInfo info;
+  s = sb_chain_->Info(*ctx_, key_, &info);
+  EXPECT_TRUE(s.ok());
+  EXPECT_GT(info.n_filters, 1);
+
+  std::vector<std::string> lookups = items;
+  lookups.emplace_back("not_inserted");
+  std::vector<bool> exists(lookups.size());
+  s = sb_chain_->MExists(*ctx_, key_, lookups, &exists);
+  EXPECT_TRUE(s.ok());
+  for (size_t i = 0; i < items.size(); i++) EXPECT_TRUE(exists[i]) << items[i];
+  EXPECT_FALSE(exists.back());
+
+  // the items of an earlier command are found in the sealed filters
+  s = sb_chain_->MAdd(*ctx_, key_, {"item0", "item99"}, &rets);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(rets[0], redis::BloomFilterAddResult::kExist);
+  EXPECT_EQ(rets[1], redis::BloomFilterAddResult::kExist);
+  s = sb_chain_->Del(*ctx_, key_);
+}
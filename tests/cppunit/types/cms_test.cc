@@ -0,0 +1,89 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "test_base.h"
+#include "types/redis_cms.h"
+
+class RedisCMSTest : public TestBase {
+ protected:
+  explicit RedisCMSTest() { cms_ = std::make_unique<redis::CountMinSketch>(storage_.get(), "cms_ns"); }
+  ~RedisCMSTest() override = default;
+
+  void SetUp() override { key_ = "test_cms_key"; }
+  void TearDown() override { [[maybe_unused]] auto s = cms_->Del(*ctx_, key_); }
+
+  std::unique_ptr<redis::CountMinSketch> cms_;
+};
+
+TEST_F(RedisCMSTest, InitByDim) {
+  auto s = cms_->InitByDim(*ctx_, key_, 2000, 5);
+  EXPECT_TRUE(s.ok());
+
+  s = cms_->InitByDim(*ctx_, key_, 2000, 5);
+  EXPECT_EQ(s.ToString(), "Invalid argument: the key already exists");
+
+  redis::CMSInfo info;
+  s = cms_->Info(*ctx_, key_, &info);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(info.width, 2000);
+  EXPECT_EQ(info.depth, 5);
+  EXPECT_EQ(info.count, 0);
+
+  uint32_t width = 0, depth = 0;
+  s = redis::CountMinSketch::DimensionsByProb(0.25, 0.01, &width, &depth);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(width, 8);
+  EXPECT_EQ(depth, 7);
+
+  s = redis::CountMinSketch::DimensionsByProb(1e-300, 0.01, &width, &depth);
+  EXPECT_TRUE(s.IsInvalidArgument());
+}
+
+TEST_F(RedisCMSTest, IncrByAndQuery) {
+  std::vector<uint32_t> counts;
+  auto s = cms_->IncrBy(*ctx_, key_, {{"a", 1}}, &counts);
+  EXPECT_TRUE(s.IsNotFound());
+
+  s = cms_->InitByDim(*ctx_, key_, 4096, 4);
+  EXPECT_TRUE(s.ok());
+
+  s = cms_->IncrBy(*ctx_, key_, {{"a", 3}, {"b", 5}, {"a", 2}}, &counts);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(counts, std::vector<uint32_t>({3, 5, 5}));
+
+  s = cms_->Query(*ctx_, key_, {"a", "b", "c"}, &counts);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(counts, std::vector<uint32_t>({5, 5, 0}));
+
+  s = cms_->IncrBy(*ctx_, key_, {{"b", UINT32_MAX}}, &counts);
+  EXPECT_EQ(s.ToString(), "Invalid argument: INCRBY overflow");
+
+  redis::CMSInfo info;
+  s = cms_->Info(*ctx_, key_, &info);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(info.count, 10);
+}
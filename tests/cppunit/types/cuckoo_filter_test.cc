@@ -0,0 +1,155 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "test_base.h"
+#include "types/redis_cuckoo_filter.h"
+
+class RedisCuckooFilterTest : public TestBase {
+ protected:
+  explicit RedisCuckooFilterTest() { cf_ = std::make_unique<redis::CuckooFilter>(storage_.get(), "cf_ns"); }
+  ~RedisCuckooFilterTest() override = default;
+
+  void SetUp() override { key_ = "test_cf_key"; }
+  void TearDown() override { [[maybe_unused]] auto s = cf_->Del(*ctx_, key_); }
+
+  std::unique_ptr<redis::CuckooFilter> cf_;
+};
+
+TEST_F(RedisCuckooFilterTest, Reserve) {
+  redis::CuckooFilterReserveOptions options;
+  options.capacity = 1000;
+  options.bucket_size = 4;
+  options.expansion = 3;
+  auto s = cf_->Reserve(*ctx_, key_, options);
+  EXPECT_TRUE(s.ok());
+
+  s = cf_->Reserve(*ctx_, key_, options);
+  EXPECT_FALSE(s.ok());
+  EXPECT_EQ(s.ToString(), "Invalid argument: the key already exists");
+
+  redis::CuckooFilterInfo info;
+  s = cf_->Info(*ctx_, key_, &info);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(info.num_buckets, 256);
+  EXPECT_EQ(info.bytes, 1024);
+  EXPECT_EQ(info.n_filters, 1);
+  EXPECT_EQ(info.num_items, 0);
+  EXPECT_EQ(info.expansion, 4);
+}
+
+TEST_F(RedisCuckooFilterTest, AddDeleteAndExists) {
+  redis::CuckooFilterAddResult ret = redis::CuckooFilterAddResult::kOk;
+  bool exist = false;
+  auto s = cf_->Exists(*ctx_, key_, "item", &exist);
+  EXPECT_TRUE(s.ok());
+  EXPECT_FALSE(exist);
+
+  std::vector<std::string> items;
+  for (int i = 0; i < 100; i++) items.push_back("item" + std::to_string(i));
+  for (const auto &item : items) {
+    s = cf_->Add(*ctx_, key_, item, false, &ret);
+    EXPECT_TRUE(s.ok());
+    EXPECT_EQ(ret, redis::CuckooFilterAddResult::kOk);
+  }
+  s = cf_->Add(*ctx_, key_, "item0", true, &ret);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(ret, redis::CuckooFilterAddResult::kExist);
+
+  // an item added twice is counted and deleted twice
+  s = cf_->Add(*ctx_, key_, "item1", false, &ret);
+  EXPECT_TRUE(s.ok());
+  uint64_t count = 0;
+  s = cf_->Count(*ctx_, key_, "item1", &count);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(count, 2);
+
+  std::vector<bool> exists(items.size());
+  s = cf_->MExists(*ctx_, key_, items, &exists);
+  EXPECT_TRUE(s.ok());
+  for (size_t i = 0; i < items.size(); i++) EXPECT_TRUE(exists[i]) << items[i];
+
+  bool deleted = false;
+  for (int i = 0; i < 2; i++) {
+    s = cf_->Remove(*ctx_, key_, "item1", &deleted);
+    EXPECT_TRUE(s.ok());
+    EXPECT_TRUE(deleted);
+  }
+  s = cf_->Exists(*ctx_, key_, "item1", &exist);
+  EXPECT_TRUE(s.ok());
+  EXPECT_FALSE(exist);
+  s = cf_->Remove(*ctx_, key_, "item1", &deleted);
+  EXPECT_TRUE(s.ok());
+  EXPECT_FALSE(deleted);
+
+  redis::CuckooFilterInfo info;
+  s = cf_->Info(*ctx_, key_, &info);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(info.num_items, 99);
+  EXPECT_EQ(info.num_deletes, 2);
+}
+
+TEST_F(RedisCuckooFilterTest, ScaleAndFull) {
+  redis::CuckooFilterReserveOptions options;
+  options.capacity = 8;
+  options.bucket_size = 2;
+  options.max_iterations = 5;
+  options.expansion = 2;
+  auto s = cf_->Reserve(*ctx_, key_, options);
+  EXPECT_TRUE(s.ok());
+
+  // 4 buckets of 2 can't hold 40 items, so new sub-filters are added
+  redis::CuckooFilterAddResult ret = redis::CuckooFilterAddResult::kOk;
+  for (int i = 0; i < 40; i++) {
+    s = cf_->Add(*ctx_, key_, "item" + std::to_string(i), false, &ret);
+    EXPECT_TRUE(s.ok());
+    EXPECT_EQ(ret, redis::CuckooFilterAddResult::kOk);
+  }
+  redis::CuckooFilterInfo info;
+  s = cf_->Info(*ctx_, key_, &info);
+  EXPECT_TRUE(s.ok());
+  EXPECT_GT(info.n_filters, 1);
+  EXPECT_EQ(info.num_items, 40);
+  for (int i = 0; i < 40; i++) {
+    bool exist = false;
+    s = cf_->Exists(*ctx_, key_, "item" + std::to_string(i), &exist);
+    EXPECT_TRUE(s.ok());
+    EXPECT_TRUE(exist);
+  }
+
+  // a non-scaling filter reports full instead of growing
+  std::string nonscaling_key = "test_cf_nonscaling_key";
+  options.expansion = 0;
+  s = cf_->Reserve(*ctx_, nonscaling_key, options);
+  EXPECT_TRUE(s.ok());
+  bool full = false;
+  for (int i = 0; i < 40 && !full; i++) {
+    s = cf_->Add(*ctx_, nonscaling_key, "item" + std::to_string(i), false, &ret);
+    EXPECT_TRUE(s.ok());
+    full = ret == redis::CuckooFilterAddResult::kFull;
+  }
+  EXPECT_TRUE(full);
+  s = cf_->Del(*ctx_, nonscaling_key);
+}
@@ -21,6 +21,7 @@
 #include <gtest/gtest.h>
 #include <math.h>
 
+#include <algorithm>
 #include <memory>
 
 #include "test_base.h"
@@ -122,7 +123,9 @@ TEST_F(RedisGeoTest, Radius) {
   geo_->Add(*ctx_, key_, &geo_points, &ret);
   EXPECT_EQ(static_cast<int>(fields_.size()), ret);
   std::vector<GeoPoint> gps;
-  geo_->Radius(*ctx_, key_, longitudes_[0], latitudes_[0], 100000000, 100, kSortASC, std::string(), false, 1, &gps);
+  uint64_t stored_cnt = 0;
+  geo_->Radius(*ctx_, key_, longitudes_[0], latitudes_[0], 100000000, 100, kSortASC, std::string(), false, 1, &gps,
+               &stored_cnt);
   EXPECT_EQ(gps.size(), fields_.size());
   for (size_t i = 0; i < gps.size(); i++) {
     EXPECT_EQ(gps[i].member, fields_[i].ToString());
@@ -140,7 +143,9 @@ TEST_F(RedisGeoTest, RadiusByMember) {
   geo_->Add(*ctx_, key_, &geo_points, &ret);
   EXPECT_EQ(fields_.size(), ret);
   std::vector<GeoPoint> gps;
-  geo_->RadiusByMember(*ctx_, key_, fields_[0], 100000000, 100, kSortASC, std::string(), false, 1, &gps);
+  uint64_t stored_cnt = 0;
+  geo_->RadiusByMember(*ctx_, key_, fields_[0], 100000000, 100, kSortASC, std::string(), false, 1, &gps,
+                       &stored_cnt);
   EXPECT_EQ(gps.size(), fields_.size());
   for (size_t i = 0; i < gps.size(); i++) {
     EXPECT_EQ(gps[i].member, fields_[i].ToString());
@@ -148,3 +153,57 @@ TEST_F(RedisGeoTest, RadiusByMember) {
   }
   auto s = geo_->Del(*ctx_, key_);
 }
+
+TEST_F(RedisGeoTest, RadiusWithCount) {
+  uint64_t ret = 0;
+  std::vector<GeoPoint> geo_points;
+  for (int i = 0; i < 100; i++) {
+    geo_points.emplace_back(GeoPoint{13.0 + i * 0.001, 52.0, "member-" + std::to_string(i)});
+  }
+  geo_->Add(*ctx_, key_, &geo_points, &ret);
+  EXPECT_EQ(ret, 100);
+  std::vector<GeoPoint> gps;
+  uint64_t stored_cnt = 0;
+  geo_->Radius(*ctx_, key_, 13.05, 52.0, 10000, 5, kSortASC, std::string(), false, 1, &gps, &stored_cnt);
+  ASSERT_EQ(gps.size(), 5);
+  EXPECT_EQ(gps[0].member, "member-50");
+  for (size_t i = 1; i < gps.size(); i++) {
+    EXPECT_LE(gps[i - 1].dist, gps[i].dist);
+    EXPECT_LE(gps[i].dist, 200);
+  }
+  gps.clear();
+  geo_->Radius(*ctx_, key_, 13.05, 52.0, 1000, 0, kSortDESC, std::string(), false, 1, &gps, &stored_cnt);
+  ASSERT_EQ(gps.size(), 29);
+  for (size_t i = 1; i < gps.size(); i++) {
+    EXPECT_GE(gps[i - 1].dist, gps[i].dist);
+  }
+  auto s = geo_->Del(*ctx_, key_);
+}
+
+TEST(GeoHashHelperTest, RangesByShape) {
+  GeoShape geo_shape{};
+  geo_shape.type = kGeoShapeTypeCircular;
+  geo_shape.xy[0] = 13.4;
+  geo_shape.xy[1] = 52.5;
+  geo_shape.radius = 50000;
+  geo_shape.conversion = 1;
+  auto ranges = GeoHashHelper::GetRangesByShapeWGS84(geo_shape, kGeoSearchMaxBoxes);
+  ASSERT_FALSE(ranges.empty());
+  for (size_t i = 1; i < ranges.size(); i++) {
+    EXPECT_LT(ranges[i - 1].max, ranges[i].min);
+  }
+
+  // every point within the radius should be in one of the ranges
+  for (double lon = 12.5; lon <= 14.3; lon += 0.01) {
+    for (double lat = 52; lat <= 53; lat += 0.01) {
+      if (GeoHashHelper::GetDistance(13.4, 52.5, lon, lat) > geo_shape.radius) continue;
+      GeoHashBits hash;
+      GeohashEncodeWGS84(lon, lat, GEO_STEP_MAX, &hash);
+      GeoHashFix52Bits score = GeoHashHelper::Align52Bits(hash);
+      auto iter = std::find_if(ranges.begin(), ranges.end(), [score](const GeoHashScoreRange &range) {
+        return score >= range.min && score < range.max;
+      });
+      EXPECT_NE(iter, ranges.end()) << lon << "," << lat;
+    }
+  }
+}
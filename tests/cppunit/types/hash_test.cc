@@ -391,3 +391,52 @@ TEST_F(RedisHashTest, HRandField) {
 
   s = hash_->Del(*ctx_, key_);
 }
+
+TEST_F(RedisHashTest, InlineEncoding) {
+  storage_->GetConfig()->hash_max_inline_entries = 3;
+  uint64_t ret = 0;
+  for (size_t i = 0; i < fields_.size(); i++) {
+    auto s = hash_->Set(*ctx_, key_, fields_[i], values_[i], &ret);
+    EXPECT_TRUE(s.ok() && ret == 1);
+  }
+
+  auto get_metadata = [this] {
+    std::string bytes;
+    auto s = storage_->Get(*ctx_, ctx_->GetReadOptions(), storage_->GetCFHandle(ColumnFamilyID::Metadata),
+                           hash_->AppendNamespacePrefix(key_), &bytes);
+    EXPECT_TRUE(s.ok());
+    HashMetadata metadata(false);
+    EXPECT_TRUE(metadata.Decode(bytes).ok());
+    return metadata;
+  };
+  EXPECT_TRUE(get_metadata().IsInline());
+
+  std::vector<std::string> fields, values;
+  auto s = hash_->Scan(*ctx_, key_, "", 2, "", &fields, &values);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(fields, std::vector<std::string>({fields_[0].ToString(), fields_[1].ToString()}));
+  fields.clear();
+  values.clear();
+  s = hash_->Scan(*ctx_, key_, fields_[1].ToString(), 10, "", &fields, &values);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(values, std::vector<std::string>({values_[2].ToString()}));
+
+  // One more field than the limit moves the hash to subkeys
+  s = hash_->Set(*ctx_, key_, "extra", "value", &ret);
+  EXPECT_TRUE(s.ok() && ret == 1);
+  auto metadata = get_metadata();
+  EXPECT_FALSE(metadata.IsInline());
+  EXPECT_EQ(metadata.size, fields_.size() + 1);
+  std::vector<FieldValue> fvs;
+  s = hash_->GetAll(*ctx_, key_, &fvs);
+  EXPECT_TRUE(s.ok() && fvs.size() == fields_.size() + 1);
+  for (size_t i = 0; i < fields_.size(); i++) {
+    std::string got;
+    s = hash_->Get(*ctx_, key_, fields_[i], &got);
+    EXPECT_TRUE(s.ok());
+    EXPECT_EQ(values_[i], got);
+  }
+
+  s = hash_->Del(*ctx_, key_);
+  storage_->GetConfig()->hash_max_inline_entries = 0;
+}
@@ -21,8 +21,10 @@
 #include <gtest/gtest.h>
 
 #include <memory>
+#include <random>
 
 #include "test_base.h"
+#include "types/hyperloglog.h"
 #include "types/redis_hyperloglog.h"
 
 class RedisHyperLogLogTest : public TestBase {
@@ -174,3 +176,102 @@ TEST_F(RedisHyperLogLogTest, PFCOUNT_multiple_keys_merge_returns_cardinality_of_
   double right = card / 100 * 5;
   ASSERT_LT(left, right) << "left : " << left << ", right: " << right;
 }
+
+TEST_F(RedisHyperLogLogTest, PFCOUNT_cached_cardinality) {
+  uint64_t ret = 0, cached = 0;
+  ASSERT_TRUE(hll_->Add(*ctx_, "hll", computeHashes({"1", "2", "3", "4", "5"}), &ret).ok() && ret == 1);
+  ASSERT_TRUE(hll_->Count(*ctx_, "hll", &ret, /*cache_result=*/true).ok() && ret == 5);
+  ASSERT_TRUE(hll_->Count(*ctx_, "hll", &cached).ok() && cached == 5);
+
+  // The cache is written out of the context, so it's checked from the latest metadata
+  auto latest_ctx = engine::Context::NoTransactionContext(storage_.get());
+  redis::Database db(storage_.get(), "hll_ns");
+  std::string ns_key = db.AppendNamespacePrefix("hll");
+  HyperLogLogMetadata metadata(false);
+  ASSERT_TRUE(db.GetMetadata(latest_ctx, {kRedisHyperLogLog}, ns_key, &metadata).ok());
+  ASSERT_EQ(metadata.cached_cardinality, 5);
+
+  // PFADD without a register changed keeps the cache, and drops it otherwise
+  ASSERT_TRUE(hll_->Add(*ctx_, "hll", computeHashes({"1"}), &ret).ok() && ret == 0);
+  ASSERT_TRUE(db.GetMetadata(latest_ctx, {kRedisHyperLogLog}, ns_key, &metadata).ok());
+  ASSERT_EQ(metadata.cached_cardinality, 5);
+  ASSERT_TRUE(hll_->Add(*ctx_, "hll", computeHashes({"6", "7"}), &ret).ok() && ret == 1);
+  ASSERT_TRUE(db.GetMetadata(latest_ctx, {kRedisHyperLogLog}, ns_key, &metadata).ok());
+  ASSERT_FALSE(metadata.cached_cardinality.has_value());
+  ASSERT_TRUE(hll_->Count(*ctx_, "hll", &ret, /*cache_result=*/true).ok() && ret == 7);
+
+  // PFMERGE caches the cardinality of the union
+  ASSERT_TRUE(hll_->Add(*ctx_, "hll1", computeHashes({"7", "8"}), &ret).ok() && ret == 1);
+  ASSERT_TRUE(hll_->Merge(*ctx_, "hll", {"hll1"}).ok());
+  ASSERT_TRUE(db.GetMetadata(latest_ctx, {kRedisHyperLogLog}, ns_key, &metadata).ok());
+  ASSERT_EQ(metadata.cached_cardinality, 8);
+}
+
+TEST_F(RedisHyperLogLogTest, SparseEncoding) {
+  auto latest_ctx = engine::Context::NoTransactionContext(storage_.get());
+  redis::Database db(storage_.get(), "hll_ns");
+  auto get_metadata = [&](const std::string &user_key) {
+    HyperLogLogMetadata metadata(false);
+    EXPECT_TRUE(db.GetMetadata(latest_ctx, {kRedisHyperLogLog}, db.AppendNamespacePrefix(user_key), &metadata).ok());
+    return metadata;
+  };
+
+  uint64_t ret = 0;
+  ASSERT_TRUE(hll_->Add(*ctx_, "hll", computeHashes({"1", "2", "3"}), &ret).ok() && ret == 1);
+  ASSERT_EQ(get_metadata("hll").encode_type, HyperLogLogMetadata::EncodeType::SPARSE);
+  ASSERT_EQ(get_metadata("hll").sparse_registers.size(), 3U);
+  ASSERT_TRUE(hll_->Count(*ctx_, "hll", &ret).ok() && ret == 3);
+
+  // The sparse and the dense keys are merged into the same registers
+  std::vector<std::string> elements;
+  for (int i = 0; i < 2000; i++) elements.emplace_back("e" + std::to_string(i));
+  std::vector<std::string_view> views(elements.begin(), elements.end());
+  ASSERT_TRUE(hll_->Add(*ctx_, "hll1", computeHashes(views), &ret).ok() && ret == 1);
+  ASSERT_EQ(get_metadata("hll1").encode_type, HyperLogLogMetadata::EncodeType::DENSE);
+  uint64_t dense_count = 0;
+  ASSERT_TRUE(hll_->Count(*ctx_, "hll1", &dense_count).ok());
+
+  // Promoted one by one, the registers are the same as the ones added at once
+  for (const auto &element : views) {
+    ASSERT_TRUE(hll_->Add(*ctx_, "hll2", computeHashes({element}), &ret).ok());
+  }
+  ASSERT_EQ(get_metadata("hll2").encode_type, HyperLogLogMetadata::EncodeType::DENSE);
+  ASSERT_TRUE(hll_->Count(*ctx_, "hll2", &ret).ok() && ret == dense_count);
+
+  uint64_t union_count = 0;
+  ASSERT_TRUE(hll_->CountMultiple(*ctx_, {"hll", "hll1"}, &union_count).ok());
+  ASSERT_TRUE(hll_->Merge(*ctx_, "hll3", {"hll"}).ok());
+  ASSERT_EQ(get_metadata("hll3").encode_type, HyperLogLogMetadata::EncodeType::SPARSE);
+  ASSERT_TRUE(hll_->Merge(*ctx_, "hll", {"hll1"}).ok());
+  ASSERT_EQ(get_metadata("hll").encode_type, HyperLogLogMetadata::EncodeType::DENSE);
+  ASSERT_TRUE(hll_->Count(*ctx_, "hll", &ret).ok() && ret == union_count);
+  ASSERT_TRUE(hll_->CountMultiple(*ctx_, {"hll3", "hll1"}, &ret).ok() && ret == union_count);
+}
+
+TEST(HyperLogLog, UnpackedRegisters) {
+  std::mt19937 rng(5);
+  std::vector<std::string> segments(kHyperLogLogSegmentCount);
+  std::vector<uint8_t> registers(kHyperLogLogRegisterCount);
+  for (uint32_t i = 0; i < kHyperLogLogSegmentCount; i++) {
+    if (i % 5 == 0) continue;
+    uint8_t *unpacked = registers.data() + i * kHyperLogLogSegmentRegisters;
+    for (uint32_t j = 0; j < kHyperLogLogSegmentRegisters; j++) unpacked[j] = rng() % 20;
+    segments[i].resize(kHyperLogLogSegmentBytes);
+    HllDensePackSegment(unpacked, reinterpret_cast<uint8_t *>(segments[i].data()));
+    for (uint32_t j = 0; j < kHyperLogLogSegmentRegisters; j++) {
+      ASSERT_EQ(HllDenseGetRegister(reinterpret_cast<const uint8_t *>(segments[i].data()), j), unpacked[j]);
+    }
+  }
+
+  std::vector<nonstd::span<const uint8_t>> spans;
+  for (const auto &segment : segments) {
+    spans.emplace_back(reinterpret_cast<const uint8_t *>(segment.data()), segment.size());
+  }
+  ASSERT_EQ(HllUnpackedEstimate(registers.data()), HllDenseEstimate(spans));
+
+  std::vector<uint8_t> merged(kHyperLogLogSegmentRegisters, 10);
+  HllMergeUnpacked(merged.data(), spans[1]);
+  for (uint32_t j = 0; j < kHyperLogLogSegmentRegisters; j++) {
+    ASSERT_EQ(merged[j], std::max<uint8_t>(10, registers[kHyperLogLogSegmentRegisters + j]));
+  }
+}
@@ -701,3 +701,58 @@ TEST_F(RedisJsonTest, StrLen) {
     ASSERT_EQ(results[i], result1[i]);
   }
 }
+
+TEST_F(RedisJsonTest, SplitStorageFormat) {
+  storage_->GetConfig()->json_storage_format = JsonStorageFormat::Split;
+
+  ASSERT_TRUE(json_->Set(*ctx_, key_, "$", R"({"a":1,"b":{"x":[1,2]},"c":"foo"})").ok());
+  JsonStorageFormat format = JsonStorageFormat::JSON;
+  ASSERT_TRUE(json_->Info(*ctx_, key_, &format).ok());
+  ASSERT_EQ(format, JsonStorageFormat::Split);
+  ASSERT_TRUE(json_->Get(*ctx_, key_, {}, &json_val_).ok());
+  ASSERT_EQ(json_val_.value, jsoncons::json::parse(R"({"a":1,"b":{"x":[1,2]},"c":"foo"})"));
+
+  // paths under a single member only touch this member
+  ASSERT_TRUE(json_->Set(*ctx_, key_, "$.b.x[1]", "3").ok());
+  ASSERT_TRUE(json_->Set(*ctx_, key_, "$.d", "true").ok());
+  ASSERT_TRUE(json_->Get(*ctx_, key_, {"$.b.x"}, &json_val_).ok());
+  ASSERT_EQ(json_val_.Dump().GetValue(), "[[1,3]]");
+  ASSERT_TRUE(json_->Get(*ctx_, key_, {"$.e"}, &json_val_).ok());
+  ASSERT_EQ(json_val_.Dump().GetValue(), "[]");
+
+  JsonValue res = JsonValue::FromString("[]").GetValue();
+  ASSERT_TRUE(json_->NumIncrBy(*ctx_, key_, "$.a", "2", &res).ok());
+  ASSERT_EQ(res.Print(0, true).GetValue(), "[3]");
+  res.value.clear();
+  ASSERT_TRUE(json_->NumMultBy(*ctx_, key_, "$.a", "2", &res).ok());
+  ASSERT_EQ(res.Print(0, true).GetValue(), "[6]");
+
+  size_t result = 0;
+  ASSERT_TRUE(json_->Del(*ctx_, key_, "$.c", &result).ok());
+  ASSERT_EQ(result, 1);
+  ASSERT_TRUE(json_->Del(*ctx_, key_, "$.c", &result).ok());
+  ASSERT_EQ(result, 0);
+
+  ASSERT_TRUE(json_->Get(*ctx_, key_, {}, &json_val_).ok());
+  ASSERT_EQ(json_val_.value, jsoncons::json::parse(R"({"a":6,"b":{"x":[1,3]},"d":true})"));
+
+  // other paths work on the whole document
+  ASSERT_TRUE(json_->Set(*ctx_, key_, "$..x", "0").ok());
+  ASSERT_TRUE(json_->Get(*ctx_, key_, {}, &json_val_).ok());
+  ASSERT_EQ(json_val_.value, jsoncons::json::parse(R"({"a":6,"b":{"x":0},"d":true})"));
+
+  // an empty object still exists
+  ASSERT_TRUE(json_->Set(*ctx_, key_, "$", "{}").ok());
+  ASSERT_TRUE(json_->Get(*ctx_, key_, {}, &json_val_).ok());
+  ASSERT_EQ(json_val_.Dump().GetValue(), "{}");
+
+  // documents whose root isn't an object fall back to CBOR
+  ASSERT_TRUE(json_->Set(*ctx_, key_, "$", "[1,2]").ok());
+  ASSERT_TRUE(json_->Info(*ctx_, key_, &format).ok());
+  ASSERT_EQ(format, JsonStorageFormat::CBOR);
+  ASSERT_TRUE(json_->Get(*ctx_, key_, {}, &json_val_).ok());
+  ASSERT_EQ(json_val_.Dump().GetValue(), "[1,2]");
+
+  storage_->GetConfig()->json_storage_format = JsonStorageFormat::JSON;
+  ASSERT_TRUE(json_->Del(*ctx_, key_, "$", &result).ok());
+}
@@ -21,9 +21,11 @@
 #include <gtest/gtest.h>
 
 #include <memory>
+#include <set>
 
 #include "test_base.h"
 #include "types/redis_set.h"
+#include "types/sample_helper.h"
 
 class RedisSetTest : public TestBase {
  protected:
@@ -274,3 +276,30 @@ TEST_F(RedisSetTest, TakeWithoutPop) {
   s = set_->Remove(*ctx_, key_, fields_, &ret);
   EXPECT_TRUE(s.ok() && fields_.size() == ret);
 }
+
+TEST_F(RedisSetTest, TakeBySeekSample) {
+  std::vector<std::string> members;
+  for (uint64_t i = 0; i < kSeekSampleMinSize; i++) members.emplace_back("member-" + std::to_string(i));
+  std::vector<Slice> slices(members.begin(), members.end());
+  uint64_t ret = 0;
+  ASSERT_TRUE(set_->Add(*ctx_, key_, slices, &ret).ok() && ret == members.size());
+
+  std::vector<std::string> taken;
+  ASSERT_TRUE(set_->Take(*ctx_, key_, &taken, 100, false).ok());
+  ASSERT_EQ(taken.size(), 100);
+  std::set<std::string> unique_taken(taken.begin(), taken.end());
+  ASSERT_EQ(unique_taken.size(), 100);
+  ASSERT_TRUE(set_->Take(*ctx_, key_, &taken, -200, false).ok());
+  ASSERT_EQ(taken.size(), 200);
+
+  ASSERT_TRUE(set_->Take(*ctx_, key_, &taken, 100, true).ok());
+  ASSERT_EQ(taken.size(), 100);
+  for (const auto &member : taken) {
+    bool flag = true;
+    ASSERT_TRUE(set_->IsMember(*ctx_, key_, member, &flag).ok());
+    ASSERT_FALSE(flag);
+  }
+  ASSERT_TRUE(set_->Card(*ctx_, key_, &ret).ok());
+  ASSERT_EQ(ret, members.size() - 100);
+  ASSERT_TRUE(set_->Del(*ctx_, key_).ok());
+}
@@ -20,10 +20,13 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <limits>
 #include <memory>
 
 #include "test_base.h"
 #include "types/redis_sortedint.h"
+#include "types/redis_sortedint_block.h"
 
 class RedisSortedintTest : public TestBase {
  protected:
@@ -66,3 +69,71 @@ TEST_F(RedisSortedintTest, Range) {
   EXPECT_TRUE(s.ok() && ids_.size() == ret);
   s = sortedint_->Del(*ctx_, key_);
 }
+
+TEST(SortedintBlockTest, EncodeAndDecode) {
+  std::vector<uint64_t> ids = {7, 8, 100, 1000, 1ULL << 40, std::numeric_limits<uint64_t>::max()};
+  auto block = SortedintBlock::Encode(ids.data(), ids.size());
+  std::vector<uint64_t> decoded;
+  ASSERT_TRUE(SortedintBlock::Decode(ids[0], block, &decoded).ok());
+  EXPECT_EQ(ids, decoded);
+
+  decoded.clear();
+  EXPECT_TRUE(SortedintBlock::Decode(ids[0], block.substr(0, block.size() - 1), &decoded).IsCorruption());
+}
+
+TEST_F(RedisSortedintTest, BlockEncoding) {
+  storage_->GetConfig()->sortedint_block_encoding = true;
+
+  // more IDs than a block holds, so the blocks are split
+  std::vector<uint64_t> ids;
+  for (uint64_t id = 1000; id > 0; id -= 2) ids.emplace_back(id);
+  uint64_t ret = 0;
+  auto s = sortedint_->Add(*ctx_, key_, ids, &ret);
+  EXPECT_TRUE(s.ok() && ret == 500);
+  s = sortedint_->Add(*ctx_, key_, {1, 2, 1001}, &ret);
+  EXPECT_TRUE(s.ok() && ret == 2);
+  s = sortedint_->Card(*ctx_, key_, &ret);
+  EXPECT_TRUE(s.ok() && ret == 502);
+
+  std::vector<uint64_t> range_ids;
+  s = sortedint_->Range(*ctx_, key_, 0, 0, 3, false, &range_ids);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(range_ids, std::vector<uint64_t>({1, 2, 4}));
+  s = sortedint_->Range(*ctx_, key_, 500, 1, 3, false, &range_ids);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(range_ids, std::vector<uint64_t>({504, 506, 508}));
+  s = sortedint_->Range(*ctx_, key_, 0, 0, 3, true, &range_ids);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(range_ids, std::vector<uint64_t>({1001, 1000, 998}));
+
+  SortedintRangeSpec spec;
+  ASSERT_TRUE(redis::Sortedint::ParseRangeSpec("(255", "260", &spec).IsOK());
+  int size = 0;
+  s = sortedint_->RangeByValue(*ctx_, key_, spec, &range_ids, &size);
+  EXPECT_TRUE(s.ok() && size == 3);
+  EXPECT_EQ(range_ids, std::vector<uint64_t>({256, 258, 260}));
+  spec.reversed = true;
+  s = sortedint_->RangeByValue(*ctx_, key_, spec, &range_ids, &size);
+  EXPECT_TRUE(s.ok() && size == 3);
+  EXPECT_EQ(range_ids, std::vector<uint64_t>({260, 258, 256}));
+
+  std::vector<int> exists;
+  s = sortedint_->MExist(*ctx_, key_, {0, 1, 3, 500, 501, 1001, 1002}, &exists);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(exists, std::vector<int>({0, 1, 0, 1, 0, 1, 0}));
+
+  s = sortedint_->Remove(*ctx_, key_, {1, 2, 3, 500}, &ret);
+  EXPECT_TRUE(s.ok() && ret == 3);
+  s = sortedint_->Range(*ctx_, key_, 0, 0, 0, false, &range_ids);
+  EXPECT_TRUE(s.ok() && range_ids.size() == 499);
+  EXPECT_EQ(range_ids.front(), 4);
+  EXPECT_EQ(std::count(range_ids.begin(), range_ids.end(), 500), 0);
+
+  s = sortedint_->Remove(*ctx_, key_, range_ids, &ret);
+  EXPECT_TRUE(s.ok() && ret == 499);
+  s = sortedint_->Card(*ctx_, key_, &ret);
+  EXPECT_TRUE(s.ok() && ret == 0);
+
+  storage_->GetConfig()->sortedint_block_encoding = false;
+  s = sortedint_->Del(*ctx_, key_);
+}
@@ -2017,6 +2017,81 @@ TEST_F(RedisStreamTest, TrimWithMinIdGreaterThanLastEntryID) {
   EXPECT_EQ(length, 0);
 }
 
+TEST_F(RedisStreamTest, TrimManyEntriesByRange) {
+  redis::StreamAddOptions add_options;
+  for (int i = 1; i <= 250; i++) {
+    add_options.next_id_strategy = *ParseNextStreamEntryIDStrategy(std::to_string(i) + "-0");
+    redis::StreamEntryID id;
+    auto s = stream_->Add(*ctx_, name_, add_options, {"key", "val"}, &id);
+    EXPECT_TRUE(s.ok());
+  }
+
+  redis::StreamTrimOptions options;
+  options.strategy = redis::StreamTrimStrategy::MinID;
+  options.min_id = redis::StreamEntryID{101, 0};
+  uint64_t trimmed = 0;
+  auto s = stream_->Trim(*ctx_, name_, options, &trimmed);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(trimmed, 100);
+
+  redis::StreamRangeOptions range_options;
+  range_options.start = redis::StreamEntryID::Minimum();
+  range_options.end = redis::StreamEntryID::Maximum();
+  std::vector<redis::StreamEntry> entries;
+  s = stream_->Range(*ctx_, name_, range_options, &entries);
+  EXPECT_TRUE(s.ok());
+  ASSERT_EQ(entries.size(), 150);
+  EXPECT_EQ(entries.front().key, "101-0");
+
+  options.strategy = redis::StreamTrimStrategy::MaxLen;
+  options.max_len = 0;
+  s = stream_->Trim(*ctx_, name_, options, &trimmed);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(trimmed, 150);
+
+  uint64_t length = 0;
+  s = stream_->Len(*ctx_, name_, redis::StreamLenOptions{}, &length);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(length, 0);
+}
+
+TEST_F(RedisStreamTest, TrimApproximatelyByWholeChunks) {
+  redis::StreamAddOptions add_options;
+  for (int i = 1; i <= 250; i++) {
+    add_options.next_id_strategy = *ParseNextStreamEntryIDStrategy(std::to_string(i) + "-0");
+    redis::StreamEntryID id;
+    auto s = stream_->Add(*ctx_, name_, add_options, {"key", "val"}, &id);
+    EXPECT_TRUE(s.ok());
+  }
+
+  redis::StreamTrimOptions options;
+  options.strategy = redis::StreamTrimStrategy::MaxLen;
+  options.approximate = true;
+  options.max_len = 60;
+  uint64_t trimmed = 0;
+  auto s = stream_->Trim(*ctx_, name_, options, &trimmed);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(trimmed, 100);
+
+  options.strategy = redis::StreamTrimStrategy::MinID;
+  options.min_id = redis::StreamEntryID{199, 0};
+  s = stream_->Trim(*ctx_, name_, options, &trimmed);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(trimmed, 0);
+
+  options.min_id = redis::StreamEntryID{201, 0};
+  s = stream_->Trim(*ctx_, name_, options, &trimmed);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(trimmed, 100);
+
+  redis::StreamInfo info;
+  s = stream_->GetStreamInfo(*ctx_, name_, false, 0, &info);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(info.size, 50);
+  EXPECT_EQ(info.first_entry->key, "201-0");
+  EXPECT_EQ(info.max_deleted_entry_id.ToString(), "200-0");
+}
+
 TEST_F(RedisStreamTest, StreamInfoOnNonExistingStream) {
   redis::StreamInfo info;
   auto s = stream_->GetStreamInfo(*ctx_, name_, false, 0, &info);
@@ -2525,3 +2600,74 @@ TEST_F(RedisStreamTest, StreamConsumerGroupCreateAndDestroy) {
   s = stream_->DestroyGroup(*ctx_, stream_name, group_name, &delete_cnt);
   EXPECT_TRUE(delete_cnt == 0);
 }
+
+TEST_F(RedisStreamTest, PendingEntriesByIdleTime) {
+  redis::StreamXGroupCreateOptions create_options = {true, 0, "0"};
+  std::string group_name = "TestGroup";
+  std::string consumer_name = "TestConsumer";
+  auto s = stream_->CreateGroup(*ctx_, name_, create_options, group_name);
+  EXPECT_TRUE(s.ok());
+
+  std::vector<redis::StreamEntryID> ids;
+  for (int i = 1; i <= 3; i++) {
+    redis::StreamAddOptions add_options;
+    add_options.next_id_strategy = *ParseNextStreamEntryIDStrategy(std::to_string(i) + "-0");
+    redis::StreamEntryID id;
+    s = stream_->Add(*ctx_, name_, add_options, {"key" + std::to_string(i), "val"}, &id);
+    EXPECT_TRUE(s.ok());
+    ids.push_back(id);
+  }
+
+  redis::StreamRangeOptions range_options;
+  range_options.start = redis::StreamEntryID::Minimum();
+  range_options.end = redis::StreamEntryID::Maximum();
+  range_options.with_count = true;
+  range_options.count = 10;
+  std::vector<redis::StreamEntry> entries;
+  s = stream_->RangeWithPending(*ctx_, name_, range_options, &entries, group_name, consumer_name, false, true);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(entries.size(), 3);
+
+  // the claimed entry is delivered again, so it isn't idle any more
+  redis::StreamClaimOptions claim_options;
+  redis::StreamClaimResult claim_result;
+  s = stream_->ClaimPelEntries(*ctx_, name_, group_name, "OtherConsumer", 0, {ids[1]}, claim_options, &claim_result);
+  EXPECT_TRUE(s.ok());
+
+  redis::StreamPendingOptions pending_options;
+  pending_options.stream_name = name_;
+  pending_options.group_name = group_name;
+  pending_options.with_count = true;
+  pending_options.count = 10;
+  pending_options.with_time = true;
+  pending_options.idle_time = 60000;
+  redis::StreamGetPendingEntryResult pending_result;
+  std::vector<redis::StreamNACK> nacks;
+  s = stream_->GetPendingEntries(*ctx_, pending_options, pending_result, nacks);
+  EXPECT_TRUE(s.ok());
+  ASSERT_EQ(nacks.size(), 2);
+  EXPECT_EQ(nacks[0].id, ids[0]);
+  EXPECT_EQ(nacks[1].id, ids[2]);
+  EXPECT_EQ(nacks[1].pel_entry.consumer_name, consumer_name);
+
+  uint64_t acknowledged = 0;
+  s = stream_->DeletePelEntries(*ctx_, name_, group_name, {ids[0]}, &acknowledged);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(acknowledged, 1);
+
+  nacks.clear();
+  pending_options.count = 1;
+  s = stream_->GetPendingEntries(*ctx_, pending_options, pending_result, nacks);
+  EXPECT_TRUE(s.ok());
+  ASSERT_EQ(nacks.size(), 1);
+  EXPECT_EQ(nacks[0].id, ids[2]);
+
+  nacks.clear();
+  pending_options.idle_time = 0;
+  pending_options.count = 10;
+  s = stream_->GetPendingEntries(*ctx_, pending_options, pending_result, nacks);
+  EXPECT_TRUE(s.ok());
+  ASSERT_EQ(nacks.size(), 2);
+  EXPECT_EQ(nacks[0].id, ids[1]);
+  EXPECT_EQ(nacks[0].pel_entry.consumer_name, "OtherConsumer");
+}
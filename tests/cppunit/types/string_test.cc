@@ -21,6 +21,7 @@
 #include <gtest/gtest.h>
 
 #include <memory>
+#include <optional>
 
 #include "test_base.h"
 #include "time_util.h"
@@ -359,3 +360,52 @@ TEST_F(RedisStringTest, LCS) {
                     4},
                    std::get<StringLCSIdxResult>(rst));
 }
+
+TEST_F(RedisStringTest, ChunkedValue) {
+  storage_->GetConfig()->string_chunk_threshold_kb = 1;
+
+  // a value of a few chunks, whose last chunk is partial
+  std::string value;
+  for (size_t i = 0; value.size() < 2 * redis::String::kChunkSize + 100; i++) value += std::to_string(i);
+  auto s = string_->Set(*ctx_, key_, value);
+  ASSERT_TRUE(s.ok());
+  std::string got;
+  s = string_->Get(*ctx_, key_, &got);
+  EXPECT_TRUE(s.ok() && got == value);
+  uint64_t len = 0;
+  s = string_->Strlen(*ctx_, key_, &len);
+  EXPECT_TRUE(s.ok() && len == value.size());
+
+  std::optional<std::string> range;
+  auto start = static_cast<int>(redis::String::kChunkSize - 10);
+  s = string_->GetRange(*ctx_, key_, start, start + 19, &range);
+  EXPECT_TRUE(s.ok() && range == value.substr(start, 20));
+  s = string_->GetRange(*ctx_, key_, -5, -1, &range);
+  EXPECT_TRUE(s.ok() && range == value.substr(value.size() - 5));
+  s = string_->GetRange(*ctx_, key_, 5, 1, &range);
+  EXPECT_TRUE(s.ok() && !range);
+
+  uint64_t new_size = 0;
+  s = string_->Append(*ctx_, key_, "tail", &new_size);
+  value += "tail";
+  EXPECT_TRUE(s.ok() && new_size == value.size());
+  s = string_->SetRange(*ctx_, key_, start, "across-the-chunks", &new_size);
+  value.replace(start, 17, "across-the-chunks");
+  EXPECT_TRUE(s.ok() && new_size == value.size());
+  // the bytes between the end and the offset are zeros
+  s = string_->SetRange(*ctx_, key_, 4 * redis::String::kChunkSize, "far", &new_size);
+  value.resize(4 * redis::String::kChunkSize, '\0');
+  value += "far";
+  EXPECT_TRUE(s.ok() && new_size == value.size());
+  s = string_->Get(*ctx_, key_, &got);
+  EXPECT_TRUE(s.ok() && got == value);
+
+  // a short value overwrites the chunks
+  s = string_->Set(*ctx_, key_, "short");
+  ASSERT_TRUE(s.ok());
+  s = string_->Get(*ctx_, key_, &got);
+  EXPECT_TRUE(s.ok() && got == "short");
+
+  storage_->GetConfig()->string_chunk_threshold_kb = 0;
+  s = string_->Del(*ctx_, key_);
+}
@@ -0,0 +1,195 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "test_base.h"
+#include "types/redis_timeseries.h"
+#include "types/timeseries_chunk.h"
+
+TEST(TSChunk, AppendAndIterate) {
+  std::vector<TSSample> samples = {{1000, 1.5},  {1010, 1.5},  {1020, 2.25},    {1030, -3},  {1031, 0},
+                                   {1200, 1e10}, {5000, 1e-9}, {100000, 1.5e30}, {100001, 7}};
+  TSChunk chunk;
+  for (const auto &sample : samples) chunk.Append(sample.ts, sample.value);
+  EXPECT_EQ(chunk.Count(), samples.size());
+  EXPECT_EQ(chunk.FirstTimestamp(), 1000);
+  EXPECT_EQ(chunk.LastTimestamp(), 100001);
+  EXPECT_EQ(chunk.LastValue(), 7);
+
+  std::string bytes = chunk.Encode();
+  TSChunk loaded;
+  ASSERT_TRUE(loaded.Load(bytes));
+  EXPECT_FALSE(loaded.Load(bytes.substr(0, bytes.size() - 1)));
+
+  // the appends continue from the state kept in the header
+  ASSERT_TRUE(loaded.Load(bytes));
+  loaded.Append(100002, 7);
+  samples.push_back({100002, 7});
+
+  bytes = loaded.Encode();
+  std::vector<TSSample> decoded;
+  TSChunkIterator iter(bytes);
+  TSSample sample{0, 0};
+  while (iter.Next(&sample)) decoded.push_back(sample);
+  EXPECT_EQ(decoded, samples);
+
+  uint64_t last_ts = 0;
+  EXPECT_TRUE(TSChunk::PeekLastTimestamp(bytes, &last_ts));
+  EXPECT_EQ(last_ts, 100002);
+}
+
+class RedisTimeSeriesTest : public TestBase {
+ protected:
+  explicit RedisTimeSeriesTest() { ts_ = std::make_unique<redis::TimeSeries>(storage_.get(), "ts_ns"); }
+  ~RedisTimeSeriesTest() override = default;
+
+  void SetUp() override { key_ = "test_ts_key"; }
+  void TearDown() override { [[maybe_unused]] auto s = ts_->Del(*ctx_, key_); }
+
+  std::unique_ptr<redis::TimeSeries> ts_;
+};
+
+TEST_F(RedisTimeSeriesTest, AddAndRange) {
+  std::vector<rocksdb::Status> results;
+  auto s = ts_->Add(*ctx_, key_, {{10, 1}}, nullptr, std::nullopt, &results);
+  EXPECT_TRUE(s.IsNotFound());
+
+  redis::TSCreateOptions options;
+  options.chunk_size = redis::kTSMinChunkSize;
+  s = ts_->Create(*ctx_, key_, options);
+  EXPECT_TRUE(s.ok());
+
+  // small chunks, so the samples out of order are upserted into full chunks and split them
+  std::vector<TSSample> samples;
+  for (uint64_t ts = 0; ts < 100; ts += 2) samples.push_back({ts, static_cast<double>(ts)});
+  for (uint64_t ts = 1; ts < 100; ts += 2) samples.push_back({ts, static_cast<double>(ts)});
+  s = ts_->Add(*ctx_, key_, samples, nullptr, std::nullopt, &results);
+  EXPECT_TRUE(s.ok());
+  for (const auto &result : results) EXPECT_TRUE(result.ok());
+
+  s = ts_->Add(*ctx_, key_, {{50, 1}}, nullptr, std::nullopt, &results);
+  EXPECT_TRUE(s.ok());
+  EXPECT_TRUE(results[0].IsInvalidArgument());
+  s = ts_->Add(*ctx_, key_, {{50, 1}}, nullptr, TSDuplicatePolicy::kSum, &results);
+  EXPECT_TRUE(s.ok() && results[0].ok());
+
+  std::vector<TSSample> range;
+  redis::TSRangeOptions range_options;
+  s = ts_->Range(*ctx_, key_, range_options, &range);
+  EXPECT_TRUE(s.ok());
+  ASSERT_EQ(range.size(), 100);
+  for (uint64_t ts = 0; ts < 100; ++ts) {
+    EXPECT_EQ(range[ts].ts, ts);
+    EXPECT_EQ(range[ts].value, ts == 50 ? 51 : ts);
+  }
+
+  range.clear();
+  range_options.from = 10;
+  range_options.to = 39;
+  range_options.aggregator = redis::TSAggregator::kAvg;
+  range_options.bucket_duration = 10;
+  range_options.count = 2;
+  s = ts_->Range(*ctx_, key_, range_options, &range);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(range, std::vector<TSSample>({{10, 14.5}, {20, 24.5}}));
+
+  std::optional<TSSample> last;
+  s = ts_->Get(*ctx_, key_, &last);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(last, TSSample({99, 99}));
+
+  redis::TSInfo info;
+  s = ts_->Info(*ctx_, key_, &info);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(info.total_samples, 100);
+  EXPECT_EQ(info.first_timestamp, 0);
+  EXPECT_EQ(info.last_timestamp, 99);
+}
+
+TEST_F(RedisTimeSeriesTest, RetentionAndMRange) {
+  redis::TSCreateOptions options;
+  options.retention = 100;
+  options.labels = {{"host", "a"}, {"metric", "cpu"}};
+  std::vector<rocksdb::Status> results;
+  auto s = ts_->Add(*ctx_, key_, {{1000, 1}, {1050, 2}, {1200, 3}, {1099, 4}}, &options, std::nullopt, &results);
+  EXPECT_TRUE(s.ok());
+  EXPECT_TRUE(results[0].ok() && results[1].ok() && results[2].ok());
+  EXPECT_TRUE(results[3].IsInvalidArgument());
+
+  std::vector<redis::TSMRangeEntry> entries;
+  redis::TSRangeOptions range_options;
+  s = ts_->MRange(*ctx_, {{"metric", "cpu"}}, range_options, &entries);
+  EXPECT_TRUE(s.ok());
+  ASSERT_EQ(entries.size(), 1);
+  EXPECT_EQ(entries[0].key, key_);
+  EXPECT_EQ(entries[0].labels, options.labels);
+  // the samples out of the retention are hidden before they are compacted
+  EXPECT_EQ(entries[0].samples, std::vector<TSSample>({{1200, 3}}));
+
+  // so are they from the samples of the series
+  redis::TSInfo info;
+  s = ts_->Info(*ctx_, key_, &info);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(info.total_samples, 1);
+  EXPECT_EQ(info.first_timestamp, 1200);
+
+  entries.clear();
+  s = ts_->MRange(*ctx_, {{"metric", "mem"}}, range_options, &entries);
+  EXPECT_TRUE(s.ok());
+  EXPECT_TRUE(entries.empty());
+}
+
+TEST_F(RedisTimeSeriesTest, DropChunksOutOfRetention) {
+  redis::TSCreateOptions options;
+  options.retention = 100;
+  // every sample starts a chunk of its own
+  options.chunk_size = 1;
+  std::vector<rocksdb::Status> results;
+  auto s = ts_->Add(*ctx_, key_, {{1000, 1}, {1050, 2}, {1060, 3}}, &options, std::nullopt, &results);
+  EXPECT_TRUE(s.ok());
+
+  redis::TSInfo info;
+  s = ts_->Info(*ctx_, key_, &info);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(info.total_samples, 3);
+
+  // the chunks of 1000 and 1050 fall out of the retention
+  s = ts_->Add(*ctx_, key_, {{1155, 4}}, nullptr, std::nullopt, &results);
+  EXPECT_TRUE(s.ok());
+  s = ts_->Info(*ctx_, key_, &info);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(info.total_samples, 2);
+  EXPECT_EQ(info.first_timestamp, 1060);
+
+  // so does a chunk started by the same batch
+  s = ts_->Add(*ctx_, key_, {{1100, 5}, {1250, 6}}, nullptr, std::nullopt, &results);
+  EXPECT_TRUE(s.ok());
+  s = ts_->Info(*ctx_, key_, &info);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(info.total_samples, 2);
+  EXPECT_EQ(info.first_timestamp, 1155);
+}
@@ -0,0 +1,92 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "test_base.h"
+#include "types/redis_topk.h"
+
+class RedisTopKTest : public TestBase {
+ protected:
+  explicit RedisTopKTest() { topk_ = std::make_unique<redis::TopK>(storage_.get(), "topk_ns"); }
+  ~RedisTopKTest() override = default;
+
+  void SetUp() override { key_ = "test_topk_key"; }
+  void TearDown() override { [[maybe_unused]] auto s = topk_->Del(*ctx_, key_); }
+
+  std::unique_ptr<redis::TopK> topk_;
+};
+
+TEST_F(RedisTopKTest, Reserve) {
+  auto s = topk_->Reserve(*ctx_, key_, 2, 0, 7, 0.9);
+  EXPECT_EQ(s.ToString(), "Invalid argument: invalid k, width or depth");
+
+  s = topk_->Reserve(*ctx_, key_, 2, 50, 5, 0.9);
+  EXPECT_TRUE(s.ok());
+  s = topk_->Reserve(*ctx_, key_, 2, 50, 5, 0.9);
+  EXPECT_EQ(s.ToString(), "Invalid argument: the key already exists");
+
+  redis::TopKInfo info;
+  s = topk_->Info(*ctx_, key_, &info);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(info.k, 2);
+  EXPECT_EQ(info.width, 50);
+  EXPECT_EQ(info.depth, 5);
+  EXPECT_DOUBLE_EQ(info.decay, 0.9);
+}
+
+TEST_F(RedisTopKTest, IncrByAndList) {
+  auto s = topk_->Reserve(*ctx_, key_, 2, 1000, 5, 0.9);
+  EXPECT_TRUE(s.ok());
+
+  std::vector<std::optional<std::string>> expelled;
+  s = topk_->IncrBy(*ctx_, key_, {{"a", 10}, {"b", 5}}, &expelled);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(expelled, std::vector<std::optional<std::string>>({std::nullopt, std::nullopt}));
+
+  s = topk_->IncrBy(*ctx_, key_, {{"c", 20}}, &expelled);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(expelled, std::vector<std::optional<std::string>>({"b"}));
+
+  std::vector<bool> exists;
+  s = topk_->Query(*ctx_, key_, {"a", "b", "c"}, &exists);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(exists, std::vector<bool>({true, false, true}));
+
+  std::vector<uint32_t> counts;
+  s = topk_->Count(*ctx_, key_, {"a", "b", "c"}, &counts);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(counts, std::vector<uint32_t>({10, 5, 20}));
+
+  std::vector<redis::TopKItem> items;
+  s = topk_->List(*ctx_, key_, &items);
+  EXPECT_TRUE(s.ok());
+  ASSERT_EQ(items.size(), 2);
+  EXPECT_EQ(items[0].item, "c");
+  EXPECT_EQ(items[0].count, 20);
+  EXPECT_EQ(items[1].item, "a");
+  EXPECT_EQ(items[1].count, 10);
+}
@@ -613,3 +613,167 @@ TEST_F(RedisZSetTest, DiffStore) {
   s = zset_->Del(*ctx_, "zsetdiff");
   EXPECT_TRUE(s.ok());
 }
+
+TEST_F(RedisZSetTest, UnionAndInter) {
+  uint64_t ret = 0;
+  std::vector<MemberScore> k1_mscores = {{"a", 1}, {"b", 2}, {"c", 3}, {"e", 5}};
+  std::vector<MemberScore> k2_mscores = {{"b", 20}, {"c", 30}, {"d", 40}, {"e", 50}};
+  std::vector<MemberScore> k3_mscores = {{"c", 300}, {"e", 500}};
+  zset_->Add(*ctx_, "zset_k1", ZAddFlags::Default(), &k1_mscores, &ret);
+  zset_->Add(*ctx_, "zset_k2", ZAddFlags::Default(), &k2_mscores, &ret);
+  zset_->Add(*ctx_, "zset_k3", ZAddFlags::Default(), &k3_mscores, &ret);
+  std::vector<KeyWeight> keys_weights = {{"zset_k1", 1}, {"zset_k2", 2}, {"zset_k3", 1}, {"zset_missing", 1}};
+
+  std::vector<MemberScore> members;
+  auto s = zset_->Union(*ctx_, keys_weights, kAggregateSum, &members);
+  EXPECT_TRUE(s.ok());
+  std::vector<MemberScore> expected_union = {{"a", 1}, {"b", 42}, {"c", 363}, {"d", 80}, {"e", 605}};
+  ASSERT_EQ(expected_union.size(), members.size());
+  for (size_t i = 0; i < members.size(); i++) {
+    EXPECT_EQ(expected_union[i].member, members[i].member);
+    EXPECT_EQ(expected_union[i].score, members[i].score);
+  }
+
+  members.clear();
+  s = zset_->Inter(*ctx_, {keys_weights.begin(), keys_weights.begin() + 3}, kAggregateMax, &members);
+  EXPECT_TRUE(s.ok());
+  std::vector<MemberScore> expected_inter = {{"c", 300}, {"e", 500}};
+  ASSERT_EQ(expected_inter.size(), members.size());
+  for (size_t i = 0; i < members.size(); i++) {
+    EXPECT_EQ(expected_inter[i].member, members[i].member);
+    EXPECT_EQ(expected_inter[i].score, members[i].score);
+  }
+
+  members.clear();
+  s = zset_->Inter(*ctx_, keys_weights, kAggregateSum, &members);
+  EXPECT_TRUE(s.ok());
+  EXPECT_TRUE(members.empty());
+
+  // the destination may be one of the sources
+  s = zset_->InterStore(*ctx_, "zset_k1", {keys_weights.begin(), keys_weights.begin() + 2}, kAggregateMin, &ret);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(3, ret);
+  zset_->RangeByRank(*ctx_, "zset_k1", RangeRankSpec(), &members, nullptr);
+  std::vector<MemberScore> expected_stored = {{"b", 2}, {"c", 3}, {"e", 5}};
+  ASSERT_EQ(expected_stored.size(), members.size());
+  for (size_t i = 0; i < members.size(); i++) {
+    EXPECT_EQ(expected_stored[i].member, members[i].member);
+    EXPECT_EQ(expected_stored[i].score, members[i].score);
+  }
+
+  for (const auto &key : {"zset_k1", "zset_k2", "zset_k3"}) {
+    s = zset_->Del(*ctx_, key);
+    EXPECT_TRUE(s.ok());
+  }
+}
+
+TEST_F(RedisZSetTest, RankIndex) {
+  std::string indexed_key = "rank_indexed_zset", scanned_key = "rank_scanned_zset";
+  auto apply = [this](const std::string &key) {
+    uint64_t ret = 0;
+    std::vector<MemberScore> mscores;
+    for (int i = 0; i < 300; i++) {
+      mscores.emplace_back(MemberScore{"member-" + std::to_string(i), (i % 37) * 1.5 - 20});
+    }
+    zset_->Add(*ctx_, key, ZAddFlags::Default(), &mscores, &ret);
+    EXPECT_EQ(300, ret);
+
+    std::vector<Slice> removed = {"member-0", "member-10", "member-37", "member-299"};
+    zset_->Remove(*ctx_, key, removed, &ret);
+    EXPECT_EQ(removed.size(), ret);
+    double score = 0;
+    zset_->IncrBy(*ctx_, key, "member-5", -1000, &score);
+    zset_->IncrBy(*ctx_, key, "member-6", 0.25, &score);
+    std::vector<MemberScore> popped;
+    zset_->Pop(*ctx_, key, 3, false, &popped);
+    RangeScoreSpec spec;
+    spec.min = 10;
+    spec.max = 12;
+    spec.with_deletion = true;
+    zset_->RangeByScore(*ctx_, key, spec, nullptr, &ret);
+  };
+  storage_->GetConfig()->zset_rank_index = true;
+  apply(indexed_key);
+  storage_->GetConfig()->zset_rank_index = false;
+  apply(scanned_key);
+
+  uint64_t size = 0;
+  zset_->Card(*ctx_, indexed_key, &size);
+  std::vector<MemberScore> members;
+  zset_->RangeByRank(*ctx_, scanned_key, RangeRankSpec(), &members, nullptr);
+  ASSERT_EQ(size, members.size());
+  for (const auto &reversed : {false, true}) {
+    for (const auto &member : members) {
+      int indexed_rank = 0, scanned_rank = 0;
+      double indexed_score = 0, scanned_score = 0;
+      zset_->Rank(*ctx_, indexed_key, member.member, reversed, &indexed_rank, &indexed_score);
+      zset_->Rank(*ctx_, scanned_key, member.member, reversed, &scanned_rank, &scanned_score);
+      EXPECT_EQ(scanned_rank, indexed_rank);
+      EXPECT_EQ(scanned_score, indexed_score);
+    }
+    for (int start = 0; start < static_cast<int>(size); start += 17) {
+      RangeRankSpec spec;
+      spec.start = start;
+      spec.stop = start + 20;
+      spec.reversed = reversed;
+      std::vector<MemberScore> indexed_members, scanned_members;
+      zset_->RangeByRank(*ctx_, indexed_key, spec, &indexed_members, nullptr);
+      zset_->RangeByRank(*ctx_, scanned_key, spec, &scanned_members, nullptr);
+      ASSERT_EQ(scanned_members.size(), indexed_members.size());
+      for (size_t i = 0; i < scanned_members.size(); i++) {
+        EXPECT_EQ(scanned_members[i].member, indexed_members[i].member);
+      }
+    }
+  }
+
+  auto s = zset_->Del(*ctx_, indexed_key);
+  s = zset_->Del(*ctx_, scanned_key);
+}
+
+TEST_F(RedisZSetTest, PopMinAfterHeadTombstones) {
+  std::vector<MemberScore> mscores;
+  for (int i = 0; i < 1500; i++) {
+    mscores.emplace_back(MemberScore{"member-" + std::to_string(i), static_cast<double>(i)});
+  }
+  uint64_t ret = 0;
+  zset_->Add(*ctx_, key_, ZAddFlags::Default(), &mscores, &ret);
+  EXPECT_EQ(1500, ret);
+
+  // popping more than kHeadTombstonesRangeDeletion members deletes the score keys before the score floor by range
+  std::vector<MemberScore> popped;
+  for (int i = 0; i < 11; i++) {
+    std::vector<MemberScore> batch;
+    zset_->Pop(*ctx_, key_, 100, true, &batch);
+    popped.insert(popped.end(), batch.begin(), batch.end());
+  }
+  ASSERT_EQ(1100, popped.size());
+  for (size_t i = 0; i < popped.size(); i++) {
+    EXPECT_EQ(static_cast<double>(i), popped[i].score);
+  }
+  ZSetMetadata metadata(false);
+  auto ns_key = zset_->AppendNamespacePrefix(key_);
+  ASSERT_TRUE(zset_->GetMetadata(*ctx_, ns_key, &metadata).ok());
+  EXPECT_EQ(1099, metadata.score_floor);
+  EXPECT_EQ(0, metadata.head_tombstones);
+
+  // a member below the score floor lowers it, so it's still found by the pops and the ranges
+  std::vector<MemberScore> low{{"low", -1}};
+  zset_->Add(*ctx_, key_, ZAddFlags::Default(), &low, &ret);
+  EXPECT_EQ(1, ret);
+  std::vector<MemberScore> members;
+  RangeScoreSpec spec;
+  spec.count = 2;
+  zset_->RangeByScore(*ctx_, key_, spec, &members, nullptr);
+  ASSERT_EQ(2, members.size());
+  EXPECT_EQ("low", members[0].member);
+  EXPECT_EQ(1100, members[1].score);
+  members.clear();
+  zset_->Pop(*ctx_, key_, 1, true, &members);
+  ASSERT_EQ(1, members.size());
+  EXPECT_EQ("low", members[0].member);
+
+  uint64_t size = 0;
+  zset_->Card(*ctx_, key_, &size);
+  EXPECT_EQ(400, size);
+  auto s = zset_->Del(*ctx_, key_);
+}
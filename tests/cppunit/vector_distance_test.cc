@@ -0,0 +1,54 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "search/vector_distance.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+TEST(VectorDistance, MatchesNaiveLoop) {
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<double> dist(-10, 10);
+
+  for (size_t dim : {0, 1, 3, 4, 7, 8, 15, 16, 17, 31, 64, 100, 257}) {
+    std::vector<double> a(dim), b(dim);
+    for (size_t i = 0; i < dim; i++) {
+      a[i] = dist(gen);
+      b[i] = dist(gen);
+    }
+
+    double ip = 0, l2 = 0, norm = 0;
+    for (size_t i = 0; i < dim; i++) {
+      ip += a[i] * b[i];
+      l2 += (a[i] - b[i]) * (a[i] - b[i]);
+      norm += a[i] * a[i];
+    }
+
+    EXPECT_NEAR(redis::InnerProduct(a.data(), b.data(), dim), ip, 1e-9 * (1 + std::abs(ip))) << dim;
+    EXPECT_NEAR(redis::SquaredL2Distance(a.data(), b.data(), dim), l2, 1e-9 * (1 + l2)) << dim;
+    EXPECT_NEAR(redis::VectorNorm(a.data(), dim), std::sqrt(norm), 1e-9 * (1 + norm)) << dim;
+  }
+
+  EXPECT_NE(std::string(redis::VectorDistanceKernelName()), "");
+}
@@ -0,0 +1,50 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "server/watched_key_table.h"
+
+#include <gtest/gtest.h>
+
+TEST(WatchedKeyTable, Versions) {
+  WatchedKeyTable table;
+  ASSERT_TRUE(table.Empty());
+
+  // Keys without watchers are not tracked
+  table.Touch("a");
+  ASSERT_TRUE(table.Empty());
+
+  auto version = table.Watch("a");
+  ASSERT_FALSE(table.Empty());
+  table.Touch("b");
+  ASSERT_EQ(version, table.GetVersion("a"));
+  table.Touch("a");
+  ASSERT_NE(version, table.GetVersion("a"));
+
+  auto global_version = table.GetGlobalVersion();
+  table.TouchAll();
+  ASSERT_NE(global_version, table.GetGlobalVersion());
+
+  // The key is tracked until the last watcher is gone
+  table.Watch("a");
+  table.Unwatch("a");
+  ASSERT_FALSE(table.Empty());
+  table.Unwatch("a");
+  ASSERT_TRUE(table.Empty());
+}
@@ -573,3 +573,82 @@ func TestClusterReset(t *testing.T) {
 		require.NoError(t, rdb0.Do(ctx, "clusterx", "SETNODES", clusterNodes, "1").Err())
 	})
 }
+
+func TestClusterSlotStats(t *testing.T) {
+	srv := util.StartServer(t, map[string]string{"cluster-enabled": "yes"})
+	defer srv.Close()
+
+	ctx := context.Background()
+	rdb := srv.NewClient()
+	defer func() { require.NoError(t, rdb.Close()) }()
+
+	for i := 0; i < 3; i++ {
+		require.NoError(t, rdb.Set(ctx, fmt.Sprintf("{%s}%d", util.SlotTable[0], i), "value", 0).Err())
+	}
+	require.NoError(t, rdb.HSet(ctx, util.SlotTable[1], "field", "value").Err())
+	require.NoError(t, rdb.Do(ctx, "compact").Err())
+	require.Eventually(t, func() bool {
+		return util.FindInfoEntry(rdb, "is_compacting") == "no"
+	}, 10*time.Second, 100*time.Millisecond)
+
+	keyCount := func(entry interface{}) int64 {
+		stats := entry.([]interface{})[1].([]interface{})
+		require.EqualValues(t, "key-count", stats[0])
+		require.EqualValues(t, "bytes", stats[2])
+		return stats[1].(int64)
+	}
+
+	t.Run("slot stats of a range of slots", func(t *testing.T) {
+		entries := rdb.Do(ctx, "cluster", "slot-stats", "slotsrange", 0, 2).Val().([]interface{})
+		require.Len(t, entries, 3)
+		for i, expected := range []int64{3, 1, 0} {
+			require.EqualValues(t, i, entries[i].([]interface{})[0])
+			require.EqualValues(t, expected, keyCount(entries[i]))
+		}
+	})
+
+	t.Run("slot stats ordered by the key count", func(t *testing.T) {
+		entries := rdb.Do(ctx, "cluster", "slot-stats", "orderby", "key-count", "limit", 1).Val().([]interface{})
+		require.Len(t, entries, 1)
+		require.EqualValues(t, 0, entries[0].([]interface{})[0])
+
+		entries = rdb.Do(ctx, "cluster", "slot-stats", "orderby", "key-count", "asc").Val().([]interface{})
+		require.Len(t, entries, 2)
+		require.EqualValues(t, 1, entries[0].([]interface{})[0])
+		require.EqualValues(t, 1, keyCount(entries[0]))
+	})
+
+	t.Run("slot stats with invalid arguments", func(t *testing.T) {
+		require.Error(t, rdb.Do(ctx, "cluster", "slot-stats", "slotsrange", 2, 1).Err())
+		require.Error(t, rdb.Do(ctx, "cluster", "slot-stats", "slotsrange", 0, 16384).Err())
+		require.Error(t, rdb.Do(ctx, "cluster", "slot-stats", "orderby", "cpu-usec").Err())
+	})
+}
+
+func TestClusterKeysInSlot(t *testing.T) {
+	srv := util.StartServer(t, map[string]string{"cluster-enabled": "yes"})
+	defer srv.Close()
+
+	ctx := context.Background()
+	rdb := srv.NewClient()
+	defer func() { require.NoError(t, rdb.Close()) }()
+
+	for i := 0; i < 3; i++ {
+		require.NoError(t, rdb.Set(ctx, fmt.Sprintf("{%s}%d", util.SlotTable[1], i), "value", 0).Err())
+	}
+	require.NoError(t, rdb.Set(ctx, util.SlotTable[0], "value", 0).Err())
+	require.NoError(t, rdb.Set(ctx, util.SlotTable[2], "value", 0).Err())
+
+	require.EqualValues(t, 3, rdb.Do(ctx, "cluster", "countkeysinslot", 1).Val())
+	require.EqualValues(t, 0, rdb.Do(ctx, "cluster", "countkeysinslot", 3).Val())
+
+	keys, err := rdb.Do(ctx, "cluster", "getkeysinslot", 1, 2).StringSlice()
+	require.NoError(t, err)
+	require.Equal(t, []string{fmt.Sprintf("{%s}0", util.SlotTable[1]), fmt.Sprintf("{%s}1", util.SlotTable[1])}, keys)
+	keys, err = rdb.Do(ctx, "cluster", "getkeysinslot", 0, 10).StringSlice()
+	require.NoError(t, err)
+	require.Equal(t, []string{util.SlotTable[0]}, keys)
+
+	require.Error(t, rdb.Do(ctx, "cluster", "getkeysinslot", 16384, 1).Err())
+	require.Error(t, rdb.Do(ctx, "cluster", "getkeysinslot", 0, -1).Err())
+}
@@ -277,6 +277,146 @@ func TestReplicationWithMultiSlaves(t *testing.T) {
 		}, 50*time.Second, 100*time.Millisecond)
 		require.Equal(t, "2", util.FindInfoEntry(rdbC, "sync_full"))
 	})
+
+	t.Run("Multi slaves receive the same incremental updates", func(t *testing.T) {
+		ctx := context.Background()
+		for i := 0; i < 1000; i++ {
+			require.NoError(t, rdbC.Set(ctx, fmt.Sprintf("multi-slaves-%d", i), i, 0).Err())
+		}
+		util.WaitForOffsetSync(t, rdbC, rdbA, 5*time.Second)
+		util.WaitForOffsetSync(t, rdbC, rdbB, 5*time.Second)
+		for _, rdb := range []*redis.Client{rdbA, rdbB} {
+			require.Equal(t, "0", rdb.Get(ctx, "multi-slaves-0").Val())
+			require.Equal(t, "999", rdb.Get(ctx, "multi-slaves-999").Val())
+		}
+	})
+}
+
+func TestReplicationCompression(t *testing.T) {
+	master := util.StartServer(t, map[string]string{})
+	defer master.Close()
+	masterClient := master.NewClient()
+	defer func() { require.NoError(t, masterClient.Close()) }()
+
+	var slaveClients []*redis.Client
+	for _, compression := range []string{"lz4", "zstd"} {
+		slave := util.StartServer(t, map[string]string{"replication-compression": compression})
+		defer slave.Close()
+		slaveClient := slave.NewClient()
+		defer func() { require.NoError(t, slaveClient.Close()) }()
+		util.SlaveOf(t, slaveClient, master)
+		util.WaitForSync(t, slaveClient)
+		require.Eventually(t, func() bool {
+			return slave.LogFileMatches(t, ".*the compression of the stream: "+compression+".*")
+		}, 5*time.Second, 100*time.Millisecond)
+		slaveClients = append(slaveClients, slaveClient)
+	}
+
+	t.Run("Slaves receive the compressed incremental updates", func(t *testing.T) {
+		ctx := context.Background()
+		value := strings.Repeat("compressible", 100)
+		for i := 0; i < 1000; i++ {
+			require.NoError(t, masterClient.Set(ctx, fmt.Sprintf("compression-%d", i), value, 0).Err())
+		}
+		require.NoError(t, masterClient.Del(ctx, "compression-0").Err())
+		for _, slaveClient := range slaveClients {
+			util.WaitForOffsetSync(t, masterClient, slaveClient, 5*time.Second)
+			require.EqualValues(t, 0, slaveClient.Exists(ctx, "compression-0").Val())
+			require.Equal(t, value, slaveClient.Get(ctx, "compression-999").Val())
+		}
+
+		rawBytes, err := strconv.Atoi(util.FindInfoEntry(masterClient, "repl_compression_raw_bytes"))
+		require.NoError(t, err)
+		sentBytes, err := strconv.Atoi(util.FindInfoEntry(masterClient, "repl_compression_sent_bytes"))
+		require.NoError(t, err)
+		require.Greater(t, rawBytes, 2*1000*len(value))
+		require.Less(t, sentBytes, rawBytes/4)
+		ratio, err := strconv.ParseFloat(util.FindInfoEntry(masterClient, "repl_compression_ratio"), 64)
+		require.NoError(t, err)
+		require.Greater(t, ratio, 4.0)
+	})
+}
+
+func TestReplicationBatchDelay(t *testing.T) {
+	master := util.StartServer(t, map[string]string{"repl-batch-delay-us": "5000"})
+	defer master.Close()
+	masterClient := master.NewClient()
+	defer func() { require.NoError(t, masterClient.Close()) }()
+
+	slave := util.StartServer(t, map[string]string{})
+	defer slave.Close()
+	slaveClient := slave.NewClient()
+	defer func() { require.NoError(t, slaveClient.Close()) }()
+	util.SlaveOf(t, slaveClient, master)
+	util.WaitForSync(t, slaveClient)
+
+	t.Run("Slave receives the batches gathered by the master", func(t *testing.T) {
+		ctx := context.Background()
+		for i := 0; i < 1000; i++ {
+			require.NoError(t, masterClient.Set(ctx, fmt.Sprintf("delay-%d", i), i, 0).Err())
+		}
+		// the last batches are sent after the delay even if no more batch comes
+		util.WaitForOffsetSync(t, masterClient, slaveClient, 5*time.Second)
+		require.Equal(t, "999", slaveClient.Get(ctx, "delay-999").Val())
+
+		sends, err := strconv.Atoi(util.FindInfoEntry(masterClient, "repl_sends"))
+		require.NoError(t, err)
+		require.Greater(t, sends, 0)
+		batchesPerSend, err := strconv.ParseFloat(util.FindInfoEntry(masterClient, "repl_batches_per_send"), 64)
+		require.NoError(t, err)
+		require.Greater(t, batchesPerSend, 1.0)
+	})
+}
+
+func TestReplicationApplyBatches(t *testing.T) {
+	master := util.StartServer(t, map[string]string{})
+	defer master.Close()
+	masterClient := master.NewClient()
+	defer func() { require.NoError(t, masterClient.Close()) }()
+
+	slave := util.StartServer(t, map[string]string{"replica-apply-batch-size-kb": "64"})
+	defer slave.Close()
+	slaveClient := slave.NewClient()
+	defer func() { require.NoError(t, slaveClient.Close()) }()
+	util.SlaveOf(t, slaveClient, master)
+	util.WaitForSync(t, slaveClient)
+
+	t.Run("Slave applies the batches in groups", func(t *testing.T) {
+		ctx := context.Background()
+		pipe := masterClient.Pipeline()
+		for i := 0; i < 5000; i++ {
+			pipe.Set(ctx, fmt.Sprintf("apply-batches-%d", i), i, 0)
+			pipe.Incr(ctx, "apply-batches-counter")
+		}
+		_, err := pipe.Exec(ctx)
+		require.NoError(t, err)
+		require.NoError(t, masterClient.Del(ctx, "apply-batches-0").Err())
+
+		util.WaitForOffsetSync(t, masterClient, slaveClient, 10*time.Second)
+		require.EqualValues(t, 0, slaveClient.Exists(ctx, "apply-batches-0").Val())
+		require.Equal(t, "4999", slaveClient.Get(ctx, "apply-batches-4999").Val())
+		require.Equal(t, "5000", slaveClient.Get(ctx, "apply-batches-counter").Val())
+	})
+
+	t.Run("Slave runs the side effects of the grouped batches", func(t *testing.T) {
+		ctx := context.Background()
+		sub := slaveClient.Subscribe(ctx, "apply-batches-channel")
+		defer func() { require.NoError(t, sub.Close()) }()
+		_, err := sub.Receive(ctx)
+		require.NoError(t, err)
+
+		pipe := masterClient.Pipeline()
+		for i := 0; i < 100; i++ {
+			pipe.Publish(ctx, "apply-batches-channel", strconv.Itoa(i))
+		}
+		_, err = pipe.Exec(ctx)
+		require.NoError(t, err)
+		for i := 0; i < 100; i++ {
+			msg, err := sub.ReceiveMessage(ctx)
+			require.NoError(t, err)
+			require.Equal(t, strconv.Itoa(i), msg.Payload)
+		}
+	})
 }
 
 func TestReplicationWithLimitSpeed(t *testing.T) {
@@ -365,6 +505,82 @@ func TestReplicationShareCheckpoint(t *testing.T) {
 	})
 }
 
+func TestReplicationBacklog(t *testing.T) {
+	master := util.StartServer(t, map[string]string{
+		"rocksdb.write_buffer_size":       "4",
+		"rocksdb.max_write_buffer_number": "1",
+		"rocksdb.wal_ttl_seconds":         "0",
+		"rocksdb.wal_size_limit_mb":       "0",
+		"repl-backlog-size-mb":            "64",
+	})
+	defer master.Close()
+	masterClient := master.NewClient()
+	defer func() { require.NoError(t, masterClient.Close()) }()
+
+	slave := util.StartServer(t, map[string]string{})
+	defer slave.Close()
+	slaveClient := slave.NewClient()
+	defer func() { require.NoError(t, slaveClient.Close()) }()
+	util.SlaveOf(t, slaveClient, master)
+	util.WaitForSync(t, slaveClient)
+
+	t.Run("Slave resumes from the backlog after the WAL is purged", func(t *testing.T) {
+		ctx := context.Background()
+		require.NoError(t, slaveClient.SlaveOf(ctx, "no", "one").Err())
+		syncFull := util.FindInfoEntry(masterClient, "sync_full")
+		require.Equal(t, "1", util.FindInfoEntry(masterClient, "repl_backlog_active"))
+
+		// the memtables are flushed and the WAL files are purged
+		value := strings.Repeat("a", 128*1024)
+		for i := 0; i < 200; i++ {
+			require.NoError(t, masterClient.Set(ctx, fmt.Sprintf("backlog-%d", i), value, 0).Err())
+			if i%20 == 0 {
+				time.Sleep(100 * time.Millisecond)
+			}
+		}
+
+		util.SlaveOf(t, slaveClient, master)
+		util.WaitForOffsetSync(t, masterClient, slaveClient, 10*time.Second)
+		require.Equal(t, syncFull, util.FindInfoEntry(masterClient, "sync_full"))
+		require.Equal(t, value, slaveClient.Get(ctx, "backlog-199").Val())
+	})
+}
+
+func TestReplicationWait(t *testing.T) {
+	master := util.StartServer(t, map[string]string{})
+	defer master.Close()
+	masterClient := master.NewClient()
+	defer func() { require.NoError(t, masterClient.Close()) }()
+
+	slave := util.StartServer(t, map[string]string{})
+	defer slave.Close()
+	slaveClient := slave.NewClient()
+	defer func() { require.NoError(t, slaveClient.Close()) }()
+	util.SlaveOf(t, slaveClient, master)
+	util.WaitForSync(t, slaveClient)
+
+	ctx := context.Background()
+	t.Run("WAIT returns once the writes are acked by the replicas", func(t *testing.T) {
+		for i := 0; i < 100; i++ {
+			require.NoError(t, masterClient.Set(ctx, fmt.Sprintf("wait-%d", i), i, 0).Err())
+		}
+		require.EqualValues(t, 1, masterClient.Do(ctx, "WAIT", 1, 5000).Val())
+		require.Equal(t, "99", slaveClient.Get(ctx, "wait-99").Val())
+	})
+
+	t.Run("WAIT returns the acked replicas on the timeout", func(t *testing.T) {
+		require.NoError(t, masterClient.Set(ctx, "wait", "v", 0).Err())
+		start := time.Now()
+		require.EqualValues(t, 1, masterClient.Do(ctx, "WAIT", 2, 200).Val())
+		require.GreaterOrEqual(t, time.Since(start), 200*time.Millisecond)
+		require.EqualValues(t, 1, masterClient.Do(ctx, "WAIT", 0, 0).Val())
+	})
+
+	t.Run("WAIT can't be used with replicas", func(t *testing.T) {
+		util.ErrorRegexp(t, slaveClient.Do(ctx, "WAIT", 1, 100).Err(), ".*replica.*")
+	})
+}
+
 func TestReplicationContinueRunning(t *testing.T) {
 	master := util.StartServer(t, map[string]string{})
 	defer master.Close()
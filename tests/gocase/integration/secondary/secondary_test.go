@@ -0,0 +1,71 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+package secondary
+
+import (
+	"context"
+	"path/filepath"
+	"testing"
+	"time"
+
+	"github.com/apache/kvrocks/tests/gocase/util"
+	"github.com/stretchr/testify/require"
+)
+
+func TestSecondaryInstance(t *testing.T) {
+	ctx := context.Background()
+
+	primary := util.StartServer(t, map[string]string{})
+	defer primary.Close()
+	rdbP := primary.NewClient()
+	defer func() { require.NoError(t, rdbP.Close()) }()
+	require.NoError(t, rdbP.Set(ctx, "a", "1", 0).Err())
+
+	dir := rdbP.ConfigGet(ctx, "dir").Val()["dir"]
+	secondary := util.StartServer(t, map[string]string{
+		"secondary-db-dir":               filepath.Join(dir, "db"),
+		"secondary-catch-up-interval-ms": "100",
+	})
+	defer secondary.Close()
+	rdbS := secondary.NewClient()
+	defer func() { require.NoError(t, rdbS.Close()) }()
+
+	t.Run("Secondary instance serves the data of the primary instance", func(t *testing.T) {
+		require.Equal(t, "1", rdbS.Get(ctx, "a").Val())
+		require.Equal(t, "yes", util.FindInfoEntry(rdbS, "secondary_instance"))
+	})
+
+	t.Run("Secondary instance catches up with the new writes", func(t *testing.T) {
+		require.NoError(t, rdbP.Set(ctx, "a", "2", 0).Err())
+		require.NoError(t, rdbP.HSet(ctx, "h", "f", "v").Err())
+		require.Eventually(t, func() bool {
+			return rdbS.Get(ctx, "a").Val() == "2" && rdbS.HGet(ctx, "h", "f").Val() == "v"
+		}, 5*time.Second, 100*time.Millisecond)
+		require.NoError(t, rdbP.Del(ctx, "h").Err())
+		require.Eventually(t, func() bool {
+			return rdbS.Exists(ctx, "h").Val() == 0
+		}, 5*time.Second, 100*time.Millisecond)
+	})
+
+	t.Run("Secondary instance rejects the writes", func(t *testing.T) {
+		require.ErrorContains(t, rdbS.Set(ctx, "b", "1", 0).Err(), "secondary instance")
+		require.ErrorContains(t, rdbS.SlaveOf(ctx, primary.Host(), "1234").Err(), "secondary instance")
+	})
+}
@@ -47,6 +47,7 @@ const (
 
 	MigrationTypeRedisCommand SlotMigrationType = "redis-command"
 	MigrationTypeRawKeyValue  SlotMigrationType = "raw-key-value"
+	MigrationTypeRawSSTFile   SlotMigrationType = "raw-sst-file"
 )
 
 var testSlot = 0
@@ -941,7 +942,7 @@ func TestSlotMigrateDataType(t *testing.T) {
 		require.EqualValues(t, 0, rdb0.Exists(ctx, util.SlotTable[slotWithDeletedKey]).Val())
 	}
 
-	testMigrationTypes := []SlotMigrationType{MigrationTypeRedisCommand, MigrationTypeRawKeyValue}
+	testMigrationTypes := []SlotMigrationType{MigrationTypeRedisCommand, MigrationTypeRawKeyValue, MigrationTypeRawSSTFile}
 
 	for _, testType := range testMigrationTypes {
 		t.Run(fmt.Sprintf("MIGRATE - Slot migrate all types of existing data using %s", testType), func(t *testing.T) {
@@ -969,6 +970,27 @@ func TestSlotMigrateDataType(t *testing.T) {
 		})
 	}
 
+	t.Run("MIGRATE - Migrate the expire times of the keys and the hash fields using raw-sst-file", func(t *testing.T) {
+		require.NoError(t, rdb0.ConfigSet(ctx, "migrate-type", string(MigrationTypeRawSSTFile)).Err())
+
+		testSlot += 1
+		key := fmt.Sprintf("hash_{%s}", util.SlotTable[testSlot])
+		require.NoError(t, rdb0.HSet(ctx, key, "f1", "v1", "f2", "v2").Err())
+		require.NoError(t, rdb0.Expire(ctx, key, time.Hour).Err())
+		require.EqualValues(t, []interface{}{int64(1)}, rdb0.Do(ctx, "HPEXPIRE", key, 3000, "FIELDS", 1, "f1").Val())
+
+		require.Equal(t, "OK", rdb0.Do(ctx, "clusterx", "migrate", testSlot, id1).Val())
+		waitForMigrateState(t, rdb0, testSlot, SlotMigrationStateSuccess)
+		require.Greater(t, rdb1.TTL(ctx, key).Val(), time.Duration(0))
+		require.EqualValues(t, 2, rdb1.HLen(ctx, key).Val())
+
+		// the expired field is deleted by the reaper of the destination, which walks the migrated TTL index
+		require.Eventually(t, func() bool {
+			return rdb1.HLen(ctx, key).Val() == 1
+		}, 10*time.Second, 100*time.Millisecond)
+		require.Equal(t, "v2", rdb1.HGet(ctx, key, "f2").Val())
+	})
+
 	t.Run("MIGRATE - Accessing slot is forbidden on source server but not on destination server", func(t *testing.T) {
 		testSlot += 1
 		require.NoError(t, rdb0.Set(ctx, util.SlotTable[testSlot], 3, 0).Err())
@@ -1114,6 +1136,111 @@ func TestSlotMigrateDataType(t *testing.T) {
 	})
 }
 
+func TestSlotMigrateConcurrently(t *testing.T) {
+	ctx := context.Background()
+
+	srv0 := util.StartServer(t, map[string]string{"cluster-enabled": "yes", "migrate-concurrency": "2"})
+	defer func() { srv0.Close() }()
+	rdb0 := srv0.NewClient()
+	defer func() { require.NoError(t, rdb0.Close()) }()
+	id0 := "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx00"
+	require.NoError(t, rdb0.Do(ctx, "clusterx", "SETNODEID", id0).Err())
+
+	srv1 := util.StartServer(t, map[string]string{"cluster-enabled": "yes"})
+	defer func() { srv1.Close() }()
+	rdb1 := srv1.NewClient()
+	defer func() { require.NoError(t, rdb1.Close()) }()
+	id1 := "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx01"
+	require.NoError(t, rdb1.Do(ctx, "clusterx", "SETNODEID", id1).Err())
+
+	clusterNodes := fmt.Sprintf("%s %s %d master - 0-10000\n", id0, srv0.Host(), srv0.Port())
+	clusterNodes += fmt.Sprintf("%s %s %d master - 10001-16383", id1, srv1.Host(), srv1.Port())
+	require.NoError(t, rdb0.Do(ctx, "clusterx", "SETNODES", clusterNodes, "1").Err())
+	require.NoError(t, rdb1.Do(ctx, "clusterx", "SETNODES", clusterNodes, "1").Err())
+
+	t.Run("MIGRATE - Migrate slot ranges concurrently up to migrate-concurrency", func(t *testing.T) {
+		cnt := 20000
+		for _, slot := range []int{0, 1, 2} {
+			for i := 0; i < cnt; i++ {
+				require.NoError(t, rdb0.LPush(ctx, util.SlotTable[slot], i).Err())
+			}
+		}
+		require.Equal(t, "OK", rdb0.Do(ctx, "clusterx", "migrate", "0 1", id1).Val())
+		require.ErrorContains(t, rdb0.Do(ctx, "clusterx", "migrate", 2, id1).Err(), "There are already 2 migrating jobs")
+		require.ErrorContains(t, rdb0.Do(ctx, "clusterx", "migrate", "1-2", id1).Err(), "being migrated")
+
+		nodes := rdb0.ClusterNodes(ctx).Val()
+		require.Contains(t, nodes, fmt.Sprintf("[0->-%s]", id1))
+		require.Contains(t, nodes, fmt.Sprintf("[1->-%s]", id1))
+
+		require.Eventually(t, func() bool {
+			i := rdb0.ClusterInfo(ctx).Val()
+			return strings.Count(i, fmt.Sprintf("migrating_state: %s", SlotMigrationStateSuccess)) == 2
+		}, 10*time.Second, 100*time.Millisecond)
+		for _, slot := range []int{0, 1} {
+			require.EqualValues(t, cnt, rdb1.LLen(ctx, util.SlotTable[slot]).Val())
+		}
+
+		require.Equal(t, "OK", rdb0.Do(ctx, "clusterx", "migrate", 2, id1).Val())
+		waitForMigrateState(t, rdb0, 2, SlotMigrationStateSuccess)
+		require.EqualValues(t, cnt, rdb1.LLen(ctx, util.SlotTable[2]).Val())
+	})
+}
+
+func TestSlotMigrateAdaptiveRate(t *testing.T) {
+	ctx := context.Background()
+
+	srv0 := util.StartServer(t, map[string]string{
+		"cluster-enabled":       "yes",
+		"migrate-type":          "raw-key-value",
+		"migrate-adaptive-rate": "yes",
+	})
+	defer func() { srv0.Close() }()
+	rdb0 := srv0.NewClient()
+	defer func() { require.NoError(t, rdb0.Close()) }()
+	id0 := "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx00"
+	require.NoError(t, rdb0.Do(ctx, "clusterx", "SETNODEID", id0).Err())
+
+	srv1 := util.StartServer(t, map[string]string{"cluster-enabled": "yes"})
+	defer func() { srv1.Close() }()
+	rdb1 := srv1.NewClient()
+	defer func() { require.NoError(t, rdb1.Close()) }()
+	id1 := "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx01"
+	require.NoError(t, rdb1.Do(ctx, "clusterx", "SETNODEID", id1).Err())
+
+	clusterNodes := fmt.Sprintf("%s %s %d master - 0-10000\n", id0, srv0.Host(), srv0.Port())
+	clusterNodes += fmt.Sprintf("%s %s %d master - 10001-16383", id1, srv1.Host(), srv1.Port())
+	require.NoError(t, rdb0.Do(ctx, "clusterx", "SETNODES", clusterNodes, "1").Err())
+	require.NoError(t, rdb1.Do(ctx, "clusterx", "SETNODES", clusterNodes, "1").Err())
+
+	t.Run("MIGRATE - The nodes report their load", func(t *testing.T) {
+		require.Equal(t, "", rdb1.Do(ctx, "cluster", "overload").Val())
+		require.NoError(t, rdb1.ConfigSet(ctx, "migrate-adaptive-latency-us", "1").Err())
+		require.NoError(t, rdb1.Set(ctx, "foo", "bar", 0).Err())
+		time.Sleep(time.Second)
+		require.Contains(t, rdb1.Do(ctx, "cluster", "overload").Val(), "latency")
+		require.NoError(t, rdb1.ConfigSet(ctx, "migrate-adaptive-latency-us", "10000").Err())
+		time.Sleep(time.Second)
+		require.Equal(t, "", rdb1.Do(ctx, "cluster", "overload").Val())
+	})
+
+	t.Run("MIGRATE - Migrate with the adaptive rate", func(t *testing.T) {
+		slot := 0
+		cnt := 20000
+		for i := 0; i < cnt; i++ {
+			require.NoError(t, rdb0.LPush(ctx, util.SlotTable[slot], i).Err())
+		}
+		require.Equal(t, "OK", rdb0.Do(ctx, "clusterx", "migrate", slot, id1).Val())
+		waitForMigrateState(t, rdb0, slot, SlotMigrationStateSuccess)
+		require.EqualValues(t, cnt, rdb1.LLen(ctx, util.SlotTable[slot]).Val())
+
+		info := rdb0.ClusterInfo(ctx).Val()
+		require.Contains(t, info, "migrate_rate:")
+		require.Regexp(t, "migrate_rate_limit: [1-9][0-9]*", info)
+		require.Contains(t, rdb1.ClusterInfo(ctx).Val(), "import_rate:")
+	})
+}
+
 func TestSlotMigrateTypeFallback(t *testing.T) {
 	ctx := context.Background()
 
@@ -0,0 +1,254 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+package perf
+
+import (
+	"bytes"
+	"context"
+	"encoding/binary"
+	"fmt"
+	"math"
+	"os"
+	"strings"
+	"testing"
+	"time"
+
+	"github.com/apache/kvrocks/tests/gocase/util"
+	"github.com/redis/go-redis/v9"
+	"github.com/stretchr/testify/require"
+)
+
+const (
+	// the number of the concurrent clients of a workload
+	concurrency = 16
+	// the number of the keys of the point reads and the writes
+	keys = 100000
+	// the number of the commands of a pipeline
+	pipeline = 100
+	// the number of the elements of a big collection
+	bigCollection = 100000
+	// the number of the elements read by a range read
+	rangeSize = 100
+	// the dimension of the vectors of the search workloads
+	vectorDim = 16
+)
+
+var value = strings.Repeat("v", 64)
+
+func TestMain(m *testing.M) {
+	code := m.Run()
+	if util.PerfEnable() && util.PerfReport() != "" {
+		if err := writeReport(util.PerfReport()); err != nil {
+			fmt.Fprintf(os.Stderr, "failed to write the performance report: %v\n", err)
+			code = 1
+		}
+	}
+	os.Exit(code)
+}
+
+func startServer(t *testing.T) (*util.KvrocksServer, *redis.Client) {
+	if !util.PerfEnable() {
+		t.Skip("performance cases run only if perf enabled.")
+	}
+
+	srv := util.StartServer(t, Configs())
+	rdb := srv.NewClientWithOption(&redis.Options{PoolSize: concurrency})
+	setKvrocksVersion(util.FindInfoEntry(rdb, "kvrocks_version"))
+	return srv, rdb
+}
+
+// pipelined runs the commands of the calls i * pipeline to (i + 1) * pipeline - 1 in a pipeline
+func pipelined(rdb *redis.Client, args func(j int) []interface{}) func(ctx context.Context, i int) error {
+	return func(ctx context.Context, i int) error {
+		p := rdb.Pipeline()
+		for j := i * pipeline; j < (i+1)*pipeline; j++ {
+			p.Do(ctx, args(j)...)
+		}
+		_, err := p.Exec(ctx)
+		return err
+	}
+}
+
+// pointRead runs a read command of the key i, a nil reply is an error since all the keys are written before
+func pointRead(rdb *redis.Client, args func(i int) []interface{}) func(ctx context.Context, i int) error {
+	return func(ctx context.Context, i int) error {
+		return rdb.Do(ctx, args(i)...).Err()
+	}
+}
+
+func TestPerfString(t *testing.T) {
+	srv, rdb := startServer(t)
+	defer srv.Close()
+	defer func() { require.NoError(t, rdb.Close()) }()
+
+	Bench(t, "string.set.pipelined", concurrency, keys/pipeline, pipeline, pipelined(rdb, func(j int) []interface{} {
+		return []interface{}{"SET", fmt.Sprintf("string:%d", j), value}
+	}))
+	Bench(t, "string.get", concurrency, keys, 1, pointRead(rdb, func(i int) []interface{} {
+		return []interface{}{"GET", fmt.Sprintf("string:%d", i)}
+	}))
+	Bench(t, "string.mget.10", concurrency, keys/10, 10, pointRead(rdb, func(i int) []interface{} {
+		args := []interface{}{"MGET"}
+		for j := i * 10; j < (i+1)*10; j++ {
+			args = append(args, fmt.Sprintf("string:%d", j))
+		}
+		return args
+	}))
+}
+
+func TestPerfHash(t *testing.T) {
+	srv, rdb := startServer(t)
+	defer srv.Close()
+	defer func() { require.NoError(t, rdb.Close()) }()
+
+	// the fields are spread over 100 hashes
+	Bench(t, "hash.hset.pipelined", concurrency, keys/pipeline, pipeline, pipelined(rdb, func(j int) []interface{} {
+		return []interface{}{"HSET", fmt.Sprintf("hash:%d", j%100), fmt.Sprintf("field:%d", j), value}
+	}))
+	Bench(t, "hash.hget", concurrency, keys, 1, pointRead(rdb, func(i int) []interface{} {
+		return []interface{}{"HGET", fmt.Sprintf("hash:%d", i%100), fmt.Sprintf("field:%d", i)}
+	}))
+	Bench(t, "hash.hgetall.1000", concurrency, 1000, bigCollection/100, pointRead(rdb, func(i int) []interface{} {
+		return []interface{}{"HGETALL", fmt.Sprintf("hash:%d", i%100)}
+	}))
+}
+
+func TestPerfSet(t *testing.T) {
+	srv, rdb := startServer(t)
+	defer srv.Close()
+	defer func() { require.NoError(t, rdb.Close()) }()
+
+	Bench(t, "set.sadd.pipelined", concurrency, keys/pipeline, pipeline, pipelined(rdb, func(j int) []interface{} {
+		return []interface{}{"SADD", fmt.Sprintf("set:%d", j%100), fmt.Sprintf("member:%d", j)}
+	}))
+	Bench(t, "set.sismember", concurrency, keys, 1, pointRead(rdb, func(i int) []interface{} {
+		return []interface{}{"SISMEMBER", fmt.Sprintf("set:%d", i%100), fmt.Sprintf("member:%d", i)}
+	}))
+}
+
+func TestPerfZSet(t *testing.T) {
+	srv, rdb := startServer(t)
+	defer srv.Close()
+	defer func() { require.NoError(t, rdb.Close()) }()
+
+	// all the members are in one big sorted set
+	Bench(t, "zset.zadd.pipelined", concurrency, bigCollection/pipeline, pipeline, pipelined(rdb,
+		func(j int) []interface{} {
+			return []interface{}{"ZADD", "zset", j, fmt.Sprintf("member:%d", j)}
+		}))
+	Bench(t, "zset.zscore", concurrency, keys, 1, pointRead(rdb, func(i int) []interface{} {
+		return []interface{}{"ZSCORE", "zset", fmt.Sprintf("member:%d", i%bigCollection)}
+	}))
+	Bench(t, "zset.zrank", concurrency, keys/10, 1, pointRead(rdb, func(i int) []interface{} {
+		return []interface{}{"ZRANK", "zset", fmt.Sprintf("member:%d", i*10%bigCollection)}
+	}))
+	Bench(t, "zset.zrange.100", concurrency, keys/10, rangeSize, pointRead(rdb, func(i int) []interface{} {
+		start := i * 10 % (bigCollection - rangeSize)
+		return []interface{}{"ZRANGE", "zset", start, start + rangeSize - 1, "WITHSCORES"}
+	}))
+	Bench(t, "zset.zrangebyscore.100", concurrency, keys/10, rangeSize, pointRead(rdb, func(i int) []interface{} {
+		start := i * 10 % (bigCollection - rangeSize)
+		return []interface{}{"ZRANGEBYSCORE", "zset", start, start + rangeSize - 1}
+	}))
+}
+
+func TestPerfList(t *testing.T) {
+	srv, rdb := startServer(t)
+	defer srv.Close()
+	defer func() { require.NoError(t, rdb.Close()) }()
+
+	Bench(t, "list.rpush.pipelined", concurrency, bigCollection/pipeline, pipeline, pipelined(rdb,
+		func(j int) []interface{} {
+			return []interface{}{"RPUSH", "list", fmt.Sprintf("element:%d", j)}
+		}))
+	Bench(t, "list.lindex", concurrency, keys/10, 1, pointRead(rdb, func(i int) []interface{} {
+		return []interface{}{"LINDEX", "list", i * 10 % bigCollection}
+	}))
+	Bench(t, "list.lrange.100", concurrency, keys/10, rangeSize, pointRead(rdb, func(i int) []interface{} {
+		start := i * 10 % (bigCollection - rangeSize)
+		return []interface{}{"LRANGE", "list", start, start + rangeSize - 1}
+	}))
+}
+
+func vectorOf(i int) []byte {
+	var buf bytes.Buffer
+	for d := 0; d < vectorDim; d++ {
+		_ = binary.Write(&buf, binary.LittleEndian, math.Sin(float64(i*vectorDim+d)))
+	}
+	return buf.Bytes()
+}
+
+func TestPerfSearch(t *testing.T) {
+	srv, rdb := startServer(t)
+	defer srv.Close()
+	defer func() { require.NoError(t, rdb.Close()) }()
+
+	ctx := context.Background()
+	require.NoError(t, rdb.Do(ctx, "FT.CREATE", "perfidx", "ON", "HASH", "PREFIX", "1", "doc:", "SCHEMA",
+		"tag", "TAG", "num", "NUMERIC", "vec", "VECTOR", "HNSW", "6", "TYPE", "FLOAT64", "DIM", vectorDim,
+		"DISTANCE_METRIC", "L2").Err())
+
+	docs := keys / 10
+	Bench(t, "search.hset.indexed", concurrency, docs/pipeline, pipeline, pipelined(rdb, func(j int) []interface{} {
+		return []interface{}{"HSET", fmt.Sprintf("doc:%d", j), "tag", fmt.Sprintf("t%d", j%100), "num", j,
+			"vec", vectorOf(j)}
+	}))
+	Bench(t, "search.tag", concurrency, docs/10, 1, pointRead(rdb, func(i int) []interface{} {
+		return []interface{}{"FT.SEARCH", "perfidx", fmt.Sprintf("@tag:{t%d}", i%100), "LIMIT", 0, 10}
+	}))
+	Bench(t, "search.numeric_range", concurrency, docs/10, 1, pointRead(rdb, func(i int) []interface{} {
+		start := i * 10 % docs
+		return []interface{}{"FT.SEARCH", "perfidx", fmt.Sprintf("@num:[%d %d]", start, start+rangeSize), "LIMIT", 0, 10}
+	}))
+	Bench(t, "search.knn.10", concurrency, docs/10, 1, pointRead(rdb, func(i int) []interface{} {
+		return []interface{}{"FT.SEARCH", "perfidx", "*=>[KNN 10 @vec $BLOB]", "PARAMS", 2, "BLOB", vectorOf(docs + i)}
+	}))
+}
+
+func TestPerfReplication(t *testing.T) {
+	master, masterClient := startServer(t)
+	defer master.Close()
+	defer func() { require.NoError(t, masterClient.Close()) }()
+
+	Bench(t, "replication.master.set.pipelined", concurrency, keys/pipeline, pipeline, pipelined(masterClient,
+		func(j int) []interface{} {
+			return []interface{}{"SET", fmt.Sprintf("string:%d", j), value}
+		}))
+
+	replica, replicaClient := startServer(t)
+	defer replica.Close()
+	defer func() { require.NoError(t, replicaClient.Close()) }()
+
+	// the catch-up of a new replica is the full sync of all the keys
+	start := time.Now()
+	util.SlaveOf(t, replicaClient, master)
+	util.WaitForSync(t, replicaClient)
+	util.WaitForOffsetSync(t, masterClient, replicaClient, 5*time.Minute)
+	Elapsed(t, "replication.full_sync", keys, time.Since(start))
+
+	// the incremental catch-up replays the writes of the master after the sync
+	start = time.Now()
+	Bench(t, "replication.incremental.set.pipelined", concurrency, keys/pipeline, pipeline, pipelined(masterClient,
+		func(j int) []interface{} {
+			return []interface{}{"SET", fmt.Sprintf("string:%d", j), strings.Repeat("w", 64)}
+		}))
+	util.WaitForOffsetSync(t, masterClient, replicaClient, 5*time.Minute)
+	Elapsed(t, "replication.incremental_catch_up", keys, time.Since(start))
+}
@@ -0,0 +1,178 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+package perf
+
+import (
+	"context"
+	"encoding/json"
+	"math"
+	"os"
+	"runtime"
+	"sort"
+	"sync"
+	"sync/atomic"
+	"testing"
+	"time"
+
+	"github.com/stretchr/testify/require"
+)
+
+// Result is the throughput and the latencies of a workload, an operation is a command,
+// so a pipeline of n commands is n operations but one latency sample
+type Result struct {
+	Workload  string  `json:"workload"`
+	Ops       int     `json:"ops"`
+	Seconds   float64 `json:"seconds"`
+	OpsPerSec float64 `json:"ops_per_sec"`
+	P50Us     float64 `json:"p50_us"`
+	P99Us     float64 `json:"p99_us"`
+}
+
+// Report is written to the path of `-perfReport` after all the workloads are run,
+// the reports of the same hardware and the same configs can be compared between releases
+type Report struct {
+	KvrocksVersion string            `json:"kvrocks_version"`
+	GoVersion      string            `json:"go_version"`
+	OS             string            `json:"os"`
+	Arch           string            `json:"arch"`
+	NumCPU         int               `json:"num_cpu"`
+	StartTime      string            `json:"start_time"`
+	Configs        map[string]string `json:"configs"`
+	Results        []Result          `json:"results"`
+}
+
+var (
+	reportMu sync.Mutex
+	report   = Report{
+		GoVersion: runtime.Version(),
+		OS:        runtime.GOOS,
+		Arch:      runtime.GOARCH,
+		NumCPU:    runtime.NumCPU(),
+		StartTime: time.Now().UTC().Format(time.RFC3339),
+		Configs:   Configs(),
+	}
+)
+
+// Configs returns the fixed configs of the servers of all the workloads
+func Configs() map[string]string {
+	return map[string]string{
+		"workers":                   "8",
+		"txn-context-enabled":       "no",
+		"rocksdb.block_cache_size":  "1024",
+		"rocksdb.write_buffer_size": "64",
+	}
+}
+
+func setKvrocksVersion(version string) {
+	reportMu.Lock()
+	defer reportMu.Unlock()
+	report.KvrocksVersion = version
+}
+
+func record(t testing.TB, result Result) {
+	t.Logf("%s: %d ops in %.2fs, %.0f ops/s, p50 %.0fus, p99 %.0fus",
+		result.Workload, result.Ops, result.Seconds, result.OpsPerSec, result.P50Us, result.P99Us)
+
+	reportMu.Lock()
+	defer reportMu.Unlock()
+	report.Results = append(report.Results, result)
+}
+
+func writeReport(path string) error {
+	reportMu.Lock()
+	defer reportMu.Unlock()
+
+	data, err := json.MarshalIndent(report, "", "  ")
+	if err != nil {
+		return err
+	}
+	return os.WriteFile(path, append(data, '\n'), 0o644)
+}
+
+// Bench calls op `calls` times by `concurrency` goroutines, each call is a latency sample of `batch` operations.
+// The argument of op is the index of the call, from 0 to calls - 1.
+func Bench(t testing.TB, workload string, concurrency, calls, batch int, op func(ctx context.Context, i int) error) {
+	ctx := context.Background()
+	var next atomic.Int64
+	latencies := make([][]time.Duration, concurrency)
+	errs := make([]error, concurrency)
+
+	var wg sync.WaitGroup
+	start := time.Now()
+	for w := 0; w < concurrency; w++ {
+		wg.Add(1)
+		go func(w int) {
+			defer wg.Done()
+			for {
+				i := int(next.Add(1) - 1)
+				if i >= calls {
+					return
+				}
+				begin := time.Now()
+				if err := op(ctx, i); err != nil {
+					errs[w] = err
+					return
+				}
+				latencies[w] = append(latencies[w], time.Since(begin))
+			}
+		}(w)
+	}
+	wg.Wait()
+	elapsed := time.Since(start)
+	for _, err := range errs {
+		require.NoError(t, err, workload)
+	}
+
+	var samples []time.Duration
+	for _, l := range latencies {
+		samples = append(samples, l...)
+	}
+	sort.Slice(samples, func(i, j int) bool { return samples[i] < samples[j] })
+	ops := calls * batch
+	record(t, Result{
+		Workload:  workload,
+		Ops:       ops,
+		Seconds:   elapsed.Seconds(),
+		OpsPerSec: float64(ops) / elapsed.Seconds(),
+		P50Us:     percentile(samples, 0.50),
+		P99Us:     percentile(samples, 0.99),
+	})
+}
+
+// Elapsed records a workload measured as a whole, e.g. the catch-up of a replica, which has no latency samples
+func Elapsed(t testing.TB, workload string, ops int, elapsed time.Duration) {
+	record(t, Result{
+		Workload:  workload,
+		Ops:       ops,
+		Seconds:   elapsed.Seconds(),
+		OpsPerSec: float64(ops) / elapsed.Seconds(),
+	})
+}
+
+func percentile(sorted []time.Duration, p float64) float64 {
+	if len(sorted) == 0 {
+		return 0
+	}
+	i := int(math.Ceil(p*float64(len(sorted)))) - 1
+	if i < 0 {
+		i = 0
+	}
+	return float64(sorted[i].Nanoseconds()) / 1000
+}
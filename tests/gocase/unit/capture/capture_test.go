@@ -0,0 +1,100 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+package capture
+
+import (
+	"context"
+	"encoding/binary"
+	"fmt"
+	"os"
+	"path/filepath"
+	"testing"
+
+	"github.com/apache/kvrocks/tests/gocase/util"
+	"github.com/stretchr/testify/require"
+)
+
+// readCapturedArgs decodes the records of a capture file, see TrafficCapture
+func readCapturedArgs(t *testing.T, path string) [][]string {
+	data, err := os.ReadFile(path)
+	require.NoError(t, err)
+	require.GreaterOrEqual(t, len(data), 8)
+	require.Equal(t, "KVRCAP01", string(data[:8]))
+	data = data[8:]
+
+	var records [][]string
+	for len(data) > 0 {
+		require.GreaterOrEqual(t, len(data), 20)
+		argc := binary.LittleEndian.Uint32(data[16:20])
+		data = data[20:]
+		args := make([]string, 0, argc)
+		for i := uint32(0); i < argc; i++ {
+			require.GreaterOrEqual(t, len(data), 4)
+			n := binary.LittleEndian.Uint32(data[:4])
+			require.GreaterOrEqual(t, len(data), 4+int(n))
+			args = append(args, string(data[4:4+n]))
+			data = data[4+n:]
+		}
+		records = append(records, args)
+	}
+	return records
+}
+
+func TestCapture(t *testing.T) {
+	srv := util.StartServer(t, map[string]string{})
+	defer srv.Close()
+
+	ctx := context.Background()
+	rdb := srv.NewClient()
+	defer func() { require.NoError(t, rdb.Close()) }()
+
+	t.Run("Capture the pipelined GETs in order", func(t *testing.T) {
+		for i := 0; i < 10; i++ {
+			require.NoError(t, rdb.Set(ctx, fmt.Sprintf("k%d", i), "v", 0).Err())
+		}
+		path := filepath.Join(t.TempDir(), "traffic.cap")
+		require.NoError(t, rdb.Do(ctx, "CAPTURE", "START", path).Err())
+
+		// the GETs are read by one batch, see pipeline-batch-read-size
+		pipe := rdb.Pipeline()
+		pipe.Set(ctx, "k0", "v0", 0)
+		for i := 0; i < 10; i++ {
+			pipe.Get(ctx, fmt.Sprintf("k%d", i))
+		}
+		pipe.Set(ctx, "k1", "v1", 0)
+		_, err := pipe.Exec(ctx)
+		require.NoError(t, err)
+
+		require.NoError(t, rdb.Do(ctx, "CAPTURE", "STOP").Err())
+
+		var captured [][]string
+		for _, args := range readCapturedArgs(t, path) {
+			if args[0] == "set" || args[0] == "get" {
+				captured = append(captured, args)
+			}
+		}
+		expected := [][]string{{"set", "k0", "v0"}}
+		for i := 0; i < 10; i++ {
+			expected = append(expected, []string{"get", fmt.Sprintf("k%d", i)})
+		}
+		expected = append(expected, []string{"set", "k1", "v1"})
+		require.Equal(t, expected, captured)
+	})
+}
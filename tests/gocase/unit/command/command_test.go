@@ -289,4 +289,19 @@ func TestCommand(t *testing.T) {
 		require.Equal(t, "dst", vs[0])
 		require.Equal(t, "src", vs[1])
 	})
+
+	t.Run("COMMAND GETKEYS SORT", func(t *testing.T) {
+		r := rdb.Do(ctx, "COMMAND", "GETKEYS", "SORT", "src", "BY", "store", "LIMIT", "0", "10", "GET", "#")
+		vs, err := r.Slice()
+		require.NoError(t, err)
+		require.Len(t, vs, 1)
+		require.Equal(t, "src", vs[0])
+
+		r = rdb.Do(ctx, "COMMAND", "GETKEYS", "SORT", "src", "BY", "w_*", "GET", "#", "STORE", "dst")
+		vs, err = r.Slice()
+		require.NoError(t, err)
+		require.Len(t, vs, 2)
+		require.Equal(t, "src", vs[0])
+		require.Equal(t, "dst", vs[1])
+	})
 }
@@ -473,6 +473,15 @@ func TestCopyHash(t *testing.T) {
 		})
 	})
 
+	t.Run("Copy hash replace its previous copy", func(t *testing.T) {
+		require.NoError(t, rdb.Del(ctx, "a", "a1").Err())
+		require.NoError(t, rdb.HSet(ctx, "a", "a", "1", "b", "2", "c", "3").Err())
+		require.NoError(t, rdb.Copy(ctx, "a", "a1", 0, true).Err())
+		require.NoError(t, rdb.HDel(ctx, "a", "a").Err())
+		require.NoError(t, rdb.Copy(ctx, "a", "a1", 0, true).Err())
+		require.EqualValues(t, map[string]string{"b": "2", "c": "3"}, rdb.HGetAll(ctx, "a1").Val())
+	})
+
 }
 
 func TestCopySet(t *testing.T) {
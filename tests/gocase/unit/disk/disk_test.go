@@ -157,4 +157,19 @@ func TestDisk(t *testing.T) {
 		_, err = rdb.MemoryUsage(ctx, "nonexistentkey").Result()
 		require.ErrorIs(t, err, redis.Nil)
 	})
+
+	t.Run("Memory usage with samples", func(t *testing.T) {
+		key := "memory-usage-samples-key"
+		require.NoError(t, rdb.Del(ctx, key).Err())
+		for i := 0; i < 100; i++ {
+			require.NoError(t, rdb.HSet(ctx, key, "field"+strconv.Itoa(i), strings.Repeat("v", 1024)).Err())
+		}
+
+		size, err := rdb.MemoryUsage(ctx, key, 5).Result()
+		require.NoError(t, err)
+		require.GreaterOrEqual(t, size, int64(100*1024))
+
+		require.ErrorContains(t, rdb.Do(ctx, "memory", "usage", key, "samples").Err(), "no more item")
+		require.ErrorContains(t, rdb.Do(ctx, "memory", "usage", key, "count", "5").Err(), "syntax")
+	})
 }
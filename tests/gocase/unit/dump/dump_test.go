@@ -193,3 +193,40 @@ func TestDump_IntegerEncoding(t *testing.T) {
 		require.Equal(t, v, got)
 	}
 }
+
+func TestDump_Native(t *testing.T) {
+	srv := util.StartServer(t, map[string]string{})
+	defer srv.Close()
+
+	ctx := context.Background()
+	rdb := srv.NewClient()
+	defer func() { require.NoError(t, rdb.Close()) }()
+
+	require.NoError(t, rdb.Set(ctx, "string", "value", 0).Err())
+	require.NoError(t, rdb.HSet(ctx, "hash", "f1", "v1", "f2", "v2").Err())
+	memberScores := []redis.Z{{Member: "a", Score: 1}, {Member: "b", Score: 2.5}}
+	require.NoError(t, rdb.ZAdd(ctx, "zset", memberScores...).Err())
+	require.NoError(t, rdb.XAdd(ctx, &redis.XAddArgs{Stream: "stream", ID: "1-1", Values: []string{"f", "v"}}).Err())
+
+	restore := func(key string) {
+		serialized, err := rdb.Do(ctx, "dump", key, "native").Text()
+		require.NoError(t, err)
+		require.NoError(t, rdb.RestoreReplace(ctx, "restore_"+key, 0, serialized).Err())
+	}
+
+	restore("string")
+	require.Equal(t, "value", rdb.Get(ctx, "restore_string").Val())
+	restore("hash")
+	require.Equal(t, map[string]string{"f1": "v1", "f2": "v2"}, rdb.HGetAll(ctx, "restore_hash").Val())
+	restore("zset")
+	require.Equal(t, memberScores, rdb.ZRangeWithScores(ctx, "restore_zset", 0, -1).Val())
+	require.Equal(t, memberScores[1:], rdb.ZRangeByScoreWithScores(ctx, "restore_zset", &redis.ZRangeBy{Min: "2", Max: "3"}).Val())
+	restore("stream")
+	require.Equal(t, []redis.XMessage{{ID: "1-1", Values: map[string]interface{}{"f": "v"}}},
+		rdb.XRange(ctx, "restore_stream", "-", "+").Val())
+
+	serialized, err := rdb.Do(ctx, "dump", "hash", "native").Text()
+	require.NoError(t, err)
+	corrupted := serialized[:len(serialized)-1] + string(serialized[len(serialized)-1]^0xff)
+	require.Error(t, rdb.RestoreReplace(ctx, "restore_hash", 0, corrupted).Err())
+}
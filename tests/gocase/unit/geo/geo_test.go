@@ -21,6 +21,7 @@ package geo
 
 import (
 	"context"
+	"fmt"
 	"math"
 	"math/rand"
 	"reflect"
@@ -322,6 +323,22 @@ var testGeo = func(t *testing.T, configs util.KvrocksServerConfigs) {
 			rdb.GeoSearchStore(ctx, "points", "points2", &redis.GeoSearchStoreQuery{GeoSearchQuery: redis.GeoSearchQuery{BoxWidth: 200, BoxHeight: 200, BoxUnit: "km", Longitude: -77.0368707, Latitude: 38.9071923, Sort: "DESC"}, StoreDist: false}).Val())
 	})
 
+	t.Run("GEOSEARCHSTORE without sorting", func(t *testing.T) {
+		require.NoError(t, rdb.Del(ctx, "points", "points2").Err())
+		for i := 0; i < 1000; i++ {
+			require.NoError(t, rdb.GeoAdd(ctx, "points", &redis.GeoLocation{Name: fmt.Sprintf("p%d", i), Longitude: 13 + float64(i)*0.0001, Latitude: 52}).Err())
+		}
+		require.EqualValues(t, 1000, rdb.Do(ctx, "GEOSEARCHSTORE", "points2", "points", "FROMLONLAT", 13.05, 52, "BYRADIUS", 100, "km").Val())
+		require.EqualValues(t, 1000, rdb.ZCard(ctx, "points2").Val())
+		require.Equal(t, rdb.ZScore(ctx, "points", "p500").Val(), rdb.ZScore(ctx, "points2", "p500").Val())
+
+		require.EqualValues(t, 10, rdb.Do(ctx, "GEOSEARCHSTORE", "points2", "points", "FROMLONLAT", 13.05, 52, "BYRADIUS", 100, "km", "COUNT", 10, "STOREDIST").Val())
+		require.EqualValues(t, 10, rdb.ZCard(ctx, "points2").Val())
+		for _, z := range rdb.ZRangeWithScores(ctx, "points2", 0, -1).Val() {
+			require.Less(t, z.Score, 100.0)
+		}
+	})
+
 	t.Run("GEOSEARCHSTORE will overwrite the dst key", func(t *testing.T) {
 		// dst key wrong type
 		require.NoError(t, rdb.Do(ctx, "del", "src", "dst").Err())
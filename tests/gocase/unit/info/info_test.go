@@ -95,6 +95,49 @@ func TestInfo(t *testing.T) {
 		require.Less(t, lastBgsaveTimeSec, 3)
 	})
 
+	t.Run("reuse the pooled connections", func(t *testing.T) {
+		// a single worker, so the new connection takes the pooled one
+		srv := util.StartServer(t, map[string]string{"workers": "1"})
+		defer srv.Close()
+		rdb := srv.NewClient()
+		defer func() { require.NoError(t, rdb.Close()) }()
+
+		c := srv.NewClient()
+		require.NoError(t, c.Do(ctx, "client", "setname", "pooled").Err())
+		require.NoError(t, c.Close())
+		require.Eventually(t, func() bool {
+			return MustAtoi(t, util.FindInfoEntry(rdb, "pooled_clients", "clients")) > 0
+		}, 5*time.Second, 100*time.Millisecond)
+
+		reused := MustAtoi(t, util.FindInfoEntry(rdb, "reused_clients", "clients"))
+		c = srv.NewClient()
+		defer func() { require.NoError(t, c.Close()) }()
+		// the state of the last client is never seen by the new one
+		require.Equal(t, "", c.ClientGetName(ctx).Val())
+		require.Greater(t, MustAtoi(t, util.FindInfoEntry(rdb, "reused_clients", "clients")), reused)
+	})
+
+	t.Run("get the startup timeline by INFO", func(t *testing.T) {
+		startup := MustAtoi(t, util.FindInfoEntry(rdb, "startup_ms", "server"))
+		total := 0
+		for _, phase := range []string{"storage_open", "namespaces", "replication", "lua_scripts", "search_indexes", "cluster"} {
+			ms := MustAtoi(t, util.FindInfoEntry(rdb, "startup_"+phase+"_ms", "server"))
+			require.GreaterOrEqual(t, ms, 0)
+			total += ms
+		}
+		require.Equal(t, startup, total)
+	})
+
+	t.Run("get the utilization of the workers by INFO", func(t *testing.T) {
+		require.NoError(t, rdb.ConfigSet(ctx, "worker-rebalance-interval", "1").Err())
+		defer func() { require.NoError(t, rdb.ConfigSet(ctx, "worker-rebalance-interval", "0").Err()) }()
+		require.Regexp(t, `^\d+\.\d{2}$`, util.FindInfoEntry(rdb, "worker_0_utilization", "cpu"))
+		require.GreaterOrEqual(t, MustAtoi(t, util.FindInfoEntry(rdb, "rebalanced_clients", "cpu")), 0)
+		workers := rdb.ConfigGet(ctx, "workers").Val()["workers"]
+		require.Equal(t, workers, util.FindInfoEntry(rdb, "worker_threads", "cpu"))
+		require.GreaterOrEqual(t, MustAtoi(t, util.FindInfoEntry(rdb, "worker_max_loop_delay_us", "cpu")), 0)
+	})
+
 	t.Run("get cluster information by INFO - cluster not enabled", func(t *testing.T) {
 		require.Equal(t, "0", util.FindInfoEntry(rdb, "cluster_enabled", "cluster"))
 	})
@@ -102,6 +145,26 @@ func TestInfo(t *testing.T) {
 	t.Run("get cluster information by INFO - cluster enabled", func(t *testing.T) {
 		require.Equal(t, "1", util.FindInfoEntry(rdb0, "cluster_enabled", "cluster"))
 	})
+
+	t.Run("get latency percentiles by INFO and LATENCY HISTOGRAM", func(t *testing.T) {
+		for i := 0; i < 10; i++ {
+			require.NoError(t, rdb.Set(ctx, "latency_key", i, 0).Err())
+		}
+		r := util.FindInfoEntry(rdb, "latency_percentiles_usec_set", "latencystats")
+		require.Regexp(t, `^p50=\d+,p99=\d+,p99\.9=\d+$`, r)
+
+		histograms := rdb.Do(ctx, "LATENCY", "HISTOGRAM", "set", "no-such-command").Val().([]interface{})
+		require.Len(t, histograms, 2)
+		require.Equal(t, "set", histograms[0])
+		histogram := histograms[1].([]interface{})
+		require.Equal(t, "calls", histogram[0])
+		require.EqualValues(t, 10, histogram[1])
+		require.Equal(t, "histogram_usec", histogram[2])
+		buckets := histogram[3].([]interface{})
+		require.EqualValues(t, 10, buckets[len(buckets)-1])
+
+		require.Error(t, rdb.Do(ctx, "LATENCY", "DOCTOR").Err())
+	})
 }
 
 func TestKeyspaceHitMiss(t *testing.T) {
@@ -142,3 +205,61 @@ func TestKeyspaceHitMiss(t *testing.T) {
 	require.Equal(t, "2", util.FindInfoEntry(rdb0, "keyspace_hits", "stats"))
 	require.Equal(t, "3", util.FindInfoEntry(rdb0, "keyspace_misses", "stats"))
 }
+
+func TestRebalanceWorkers(t *testing.T) {
+	srv := util.StartServer(t, map[string]string{
+		"workers":                    "1",
+		"worker-rebalance-interval":  "1",
+		"worker-rebalance-threshold": "1",
+	})
+	defer srv.Close()
+
+	ctx := context.Background()
+	rdb := srv.NewClient()
+	defer func() { require.NoError(t, rdb.Close()) }()
+
+	values := make([]interface{}, 1000)
+	for i := range values {
+		values[i] = fmt.Sprintf("value%d", i)
+	}
+	require.NoError(t, rdb.RPush(ctx, "list", values...).Err())
+
+	// all the busy connections are accepted by the only worker, then a new idle worker is added
+	var clients []*redis.Client
+	for i := 0; i < 4; i++ {
+		c := srv.NewClientWithOption(&redis.Options{PoolSize: 1})
+		defer func() { require.NoError(t, c.Close()) }()
+		require.NoError(t, c.Ping(ctx).Err())
+		clients = append(clients, c)
+	}
+	require.NoError(t, rdb.ConfigSet(ctx, "workers", "2").Err())
+
+	stop := make(chan struct{})
+	done := make(chan struct{}, len(clients))
+	for _, c := range clients {
+		go func(c *redis.Client) {
+			defer func() { done <- struct{}{} }()
+			for {
+				select {
+				case <-stop:
+					return
+				default:
+					c.LRange(ctx, "list", 0, -1)
+				}
+			}
+		}(c)
+	}
+
+	require.Eventually(t, func() bool {
+		n, err := strconv.Atoi(util.FindInfoEntry(rdb, "rebalanced_clients", "cpu"))
+		return err == nil && n > 0
+	}, 10*time.Second, 100*time.Millisecond)
+
+	close(stop)
+	for range clients {
+		<-done
+	}
+	for _, c := range clients {
+		require.NoError(t, c.Ping(ctx).Err())
+	}
+}
@@ -21,7 +21,10 @@ package introspection
 
 import (
 	"context"
+	"encoding/json"
 	"fmt"
+	"os"
+	"path/filepath"
 	"strconv"
 	"strings"
 	"testing"
@@ -137,6 +140,25 @@ func TestIntrospection(t *testing.T) {
 		require.Regexp(t, ".*name= .*", rdb.ClientList(ctx).Val())
 	})
 
+	t.Run("CLIENT TOP orders the clients by the resource", func(t *testing.T) {
+		busy := srv.NewClient()
+		defer func() { require.NoError(t, busy.Close()) }()
+		require.NoError(t, busy.Do(ctx, "CLIENT", "SETNAME", "busy").Err())
+		for i := 0; i < 500; i++ {
+			require.NoError(t, busy.Set(ctx, "top-key", strings.Repeat("x", 100), 0).Err())
+		}
+
+		for _, resource := range []string{"CMDS", "NET-IN"} {
+			top := rdb.Do(ctx, "CLIENT", "TOP", resource, "COUNT", "1").Val().(string)
+			require.Len(t, strings.Split(strings.TrimSpace(top), "\n"), 1)
+			require.Contains(t, top, "name=busy")
+		}
+		require.Regexp(t, "tot-cmds=[0-9]+ tot-cpu-us=[0-9]+ tot-read-bytes=[0-9]+ tot-net-in=[0-9]+ tot-net-out=[0-9]+",
+			rdb.ClientList(ctx).Val())
+		require.ErrorContains(t, rdb.Do(ctx, "CLIENT", "TOP", "MEMORY").Err(), "the resource should be one of")
+		require.ErrorContains(t, rdb.Do(ctx, "CLIENT", "TOP", "CPU", "COUNT", "0").Err(), "out of numeric range")
+	})
+
 	t.Run("CLIENT INFO shows empty fields for unassigned names", func(t *testing.T) {
 		require.Regexp(t, ".*name= .*", rdb.Do(ctx, "CLIENT", "INFO").Val())
 	})
@@ -265,6 +287,55 @@ func TestIntrospection(t *testing.T) {
 		require.NoError(t, rdb.Do(ctx, "SET", "key", "value").Err())
 		require.EqualValues(t, 1, rdb.Do(ctx, "MOVE", "key", "0").Val())
 	})
+
+	t.Run("HOTKEYS reports the most accessed keys", func(t *testing.T) {
+		require.NoError(t, rdb.ConfigSet(ctx, "hotkeys-sample-interval", "1").Err())
+		for i := 0; i < 100; i++ {
+			require.NoError(t, rdb.Set(ctx, "hotkey", i, 0).Err())
+			require.NoError(t, rdb.Get(ctx, "hotkey").Err())
+		}
+
+		entries := rdb.Do(ctx, "HOTKEYS", "COUNT", "1").Val().([]interface{})
+		require.Len(t, entries, 1)
+		entry := entries[0].([]interface{})
+		require.Equal(t, []interface{}{"key", "hotkey", "namespace", "__namespace"}, entry[:4])
+		require.Equal(t, "reads", entry[4])
+		require.GreaterOrEqual(t, entry[5].(int64), int64(100))
+		require.Equal(t, "writes", entry[6])
+		require.GreaterOrEqual(t, entry[7].(int64), int64(100))
+
+		require.Empty(t, rdb.Do(ctx, "HOTKEYS", "NAMESPACE", "no-such-namespace").Val())
+		require.Error(t, rdb.Do(ctx, "HOTKEYS", "COUNT", "0").Err())
+		require.NoError(t, rdb.ConfigSet(ctx, "hotkeys-sample-interval", "100").Err())
+	})
+
+	t.Run("PROFILE CPU samples the stacks in the collapsed format", func(t *testing.T) {
+		require.ErrorContains(t, rdb.Do(ctx, "PROFILE", "CPU", "START", "0").Err(), "out of numeric range")
+		require.ErrorContains(t, rdb.Do(ctx, "PROFILE", "CPU", "RESTART").Err(), "unknown subcommand")
+
+		if err := rdb.Do(ctx, "PROFILE", "CPU", "START", "10", "1000").Err(); err != nil {
+			t.Skipf("the CPU profiling isn't supported: %v", err)
+		}
+		require.ErrorContains(t, rdb.Do(ctx, "PROFILE", "CPU", "START").Err(), "already running")
+		for i := 0; i < 2000; i++ {
+			require.NoError(t, rdb.Set(ctx, "profiled", i, 0).Err())
+		}
+		status := rdb.Do(ctx, "PROFILE", "CPU", "STATUS").Val().([]interface{})
+		require.Equal(t, []interface{}{"running", int64(1)}, status[:2])
+		require.NoError(t, rdb.Do(ctx, "PROFILE", "CPU", "STOP").Err())
+		status = rdb.Do(ctx, "PROFILE", "CPU", "STATUS").Val().([]interface{})
+		require.Equal(t, []interface{}{"running", int64(0)}, status[:2])
+
+		dump := rdb.Do(ctx, "PROFILE", "CPU", "DUMP").Val().(string)
+		for _, line := range strings.Split(strings.TrimSpace(dump), "\n") {
+			if line == "" {
+				continue
+			}
+			count, err := strconv.Atoi(line[strings.LastIndex(line, " ")+1:])
+			require.NoError(t, err)
+			require.Positive(t, count)
+		}
+	})
 }
 
 func TestMultiServerIntrospection(t *testing.T) {
@@ -326,3 +397,63 @@ func TestMultiServerIntrospection(t *testing.T) {
 		}, 5*time.Second, 100*time.Millisecond)
 	})
 }
+
+func TestTracing(t *testing.T) {
+	traceFile := filepath.Join(t.TempDir(), "spans.json")
+	srv := util.StartServer(t, map[string]string{"trace-file": traceFile})
+	defer srv.Close()
+
+	ctx := context.Background()
+	rdb := srv.NewClient()
+	defer func() { require.NoError(t, rdb.Close()) }()
+
+	t.Run("CLIENT SETINFO TRACEPARENT makes the commands children of the span", func(t *testing.T) {
+		require.ErrorContains(t, rdb.Do(ctx, "CLIENT", "SETINFO", "TRACEPARENT", "00-xyz").Err(), "invalid traceparent")
+		require.ErrorContains(t, rdb.Do(ctx, "CLIENT", "SETINFO", "NO-SUCH-ATTR", "1").Err(), "Unrecognized option")
+
+		traceID := "4bf92f3577b34da6a3ce929d0e0e4736"
+		traceparent := fmt.Sprintf("00-%s-00f067aa0ba902b7-01", traceID)
+		require.NoError(t, rdb.Do(ctx, "CLIENT", "SETINFO", "TRACEPARENT", traceparent).Err())
+		require.NoError(t, rdb.Set(ctx, "traced", "value", 0).Err())
+		require.NoError(t, rdb.Do(ctx, "CLIENT", "SETINFO", "TRACEPARENT", "").Err())
+		require.NoError(t, rdb.Set(ctx, "untraced", "value", 0).Err())
+
+		require.Eventually(t, func() bool {
+			content, err := os.ReadFile(traceFile)
+			return err == nil && strings.Contains(string(content), `"name":"set"`)
+		}, 5*time.Second, 100*time.Millisecond)
+
+		content, err := os.ReadFile(traceFile)
+		require.NoError(t, err)
+		var names []string
+		for _, line := range strings.Split(strings.TrimSpace(string(content)), "\n") {
+			var request struct {
+				ResourceSpans []struct {
+					ScopeSpans []struct {
+						Spans []struct {
+							TraceID      string `json:"traceId"`
+							ParentSpanID string `json:"parentSpanId"`
+							Name         string `json:"name"`
+						} `json:"spans"`
+					} `json:"scopeSpans"`
+				} `json:"resourceSpans"`
+			}
+			require.NoError(t, json.Unmarshal([]byte(line), &request))
+			for _, span := range request.ResourceSpans[0].ScopeSpans[0].Spans {
+				require.Equal(t, traceID, span.TraceID)
+				require.NotEmpty(t, span.ParentSpanID)
+				names = append(names, span.Name)
+			}
+		}
+		// the SET after the trace context is cleared isn't traced
+		sets := 0
+		for _, name := range names {
+			if name == "set" {
+				sets++
+			}
+		}
+		require.Equal(t, 1, sets)
+		require.Contains(t, names, "execute")
+		require.Contains(t, names, "parse")
+	})
+}
@@ -26,6 +26,7 @@ import (
 	"time"
 
 	"github.com/apache/kvrocks/tests/gocase/util"
+	"github.com/redis/go-redis/v9"
 	"github.com/stretchr/testify/require"
 )
 
@@ -79,6 +80,11 @@ func TestKeyspace(t *testing.T) {
 		require.EqualValues(t, 6, rdb.Do(ctx, "dbsize").Val())
 	})
 
+	t.Run("DBSize approx", func(t *testing.T) {
+		require.EqualValues(t, 6, rdb.Do(ctx, "dbsize", "approx").Val())
+		require.Contains(t, rdb.Info(ctx, "keyspace").Val(), "approx_keys:6")
+	})
+
 	t.Run("DEL all keys", func(t *testing.T) {
 		vals := rdb.Keys(ctx, "*").Val()
 		require.EqualValues(t, len(vals), rdb.Del(ctx, vals...).Val())
@@ -206,3 +212,46 @@ func TestKeyspace(t *testing.T) {
 		require.Equal(t, "none", rdb.Type(ctx, key).Val())
 	})
 }
+
+func TestKeyspaceWithHeavyCommandPool(t *testing.T) {
+	srv := util.StartServer(t, map[string]string{
+		"heavy-command-threads":        "2",
+		"heavy-command-cost-threshold": "10",
+	})
+	defer srv.Close()
+
+	ctx := context.Background()
+	rdb := srv.NewClient()
+	defer func() { require.NoError(t, rdb.Close()) }()
+
+	t.Run("KEYS and big DEL are served by the heavy command pool", func(t *testing.T) {
+		require.NoError(t, rdb.Set(ctx, "foo", "bar", 0).Err())
+		for i := 0; i < 100; i++ {
+			require.NoError(t, rdb.SAdd(ctx, "big", i).Err())
+		}
+		keys := rdb.Keys(ctx, "*").Val()
+		sort.Strings(keys)
+		require.Equal(t, []string{"big", "foo"}, keys)
+		require.EqualValues(t, 2, rdb.Del(ctx, "big", "foo").Val())
+		require.Empty(t, rdb.Keys(ctx, "*").Val())
+	})
+
+	t.Run("Commands pipelined after a heavy command keep their order", func(t *testing.T) {
+		for i := 0; i < 100; i++ {
+			require.NoError(t, rdb.SAdd(ctx, "big", i).Err())
+		}
+		pipe := rdb.Pipeline()
+		pipe.Set(ctx, "a", "1", 0)
+		pipe.Del(ctx, "big")
+		pipe.Get(ctx, "a")
+		pipe.Keys(ctx, "*")
+		pipe.Exists(ctx, "big")
+		cmds, err := pipe.Exec(ctx)
+		require.NoError(t, err)
+		require.Equal(t, "OK", cmds[0].(*redis.StatusCmd).Val())
+		require.EqualValues(t, 1, cmds[1].(*redis.IntCmd).Val())
+		require.Equal(t, "1", cmds[2].(*redis.StringCmd).Val())
+		require.Equal(t, []string{"a"}, cmds[3].(*redis.StringSliceCmd).Val())
+		require.EqualValues(t, 0, cmds[4].(*redis.IntCmd).Val())
+	})
+}
@@ -22,6 +22,7 @@ package multi
 import (
 	"context"
 	"fmt"
+	"sync"
 	"testing"
 
 	"github.com/apache/kvrocks/tests/gocase/util"
@@ -323,3 +324,60 @@ func TestMulti(t *testing.T) {
 		require.Equal(t, rdb.Do(ctx, "EXEC").Val(), []interface{}{int64(51)})
 	})
 }
+
+func TestMultiConcurrentExec(t *testing.T) {
+	srv := util.StartServer(t, map[string]string{
+		"txn-concurrent-exec": "yes",
+	})
+	defer srv.Close()
+
+	ctx := context.Background()
+	rdb := srv.NewClient()
+	defer func() { require.NoError(t, rdb.Close()) }()
+
+	t.Run("Concurrent EXECs on the same keys are isolated", func(t *testing.T) {
+		require.NoError(t, rdb.Del(ctx, "counter", "history").Err())
+
+		var wg sync.WaitGroup
+		for i := 0; i < 8; i++ {
+			wg.Add(1)
+			go func() {
+				defer wg.Done()
+				for j := 0; j < 50; j++ {
+					_, err := rdb.TxPipelined(ctx, func(pipe redis.Pipeliner) error {
+						pipe.Incr(ctx, "counter")
+						pipe.RPush(ctx, "history", "x")
+						return nil
+					})
+					require.NoError(t, err)
+				}
+			}()
+		}
+		wg.Wait()
+
+		require.EqualValues(t, 400, rdb.Get(ctx, "counter").Val())
+		require.EqualValues(t, 400, rdb.LLen(ctx, "history").Val())
+	})
+
+	t.Run("EXEC with keyless commands", func(t *testing.T) {
+		require.NoError(t, rdb.Set(ctx, "a", "1", 0).Err())
+		require.NoError(t, rdb.Do(ctx, "MULTI").Err())
+		require.NoError(t, rdb.Do(ctx, "INCR", "a").Err())
+		require.NoError(t, rdb.Do(ctx, "PING").Err())
+		v := rdb.Do(ctx, "EXEC").Val()
+		require.Equal(t, "[2 PONG]", fmt.Sprintf("%v", v))
+	})
+
+	t.Run("WATCH still aborts EXEC", func(t *testing.T) {
+		rdb2 := srv.NewClient()
+		defer func() { require.NoError(t, rdb2.Close()) }()
+
+		require.NoError(t, rdb.Set(ctx, "x", 30, 0).Err())
+		require.NoError(t, rdb.Do(ctx, "WATCH", "x").Err())
+		require.NoError(t, rdb2.Set(ctx, "x", 40, 0).Err())
+		require.NoError(t, rdb.Do(ctx, "MULTI").Err())
+		require.NoError(t, rdb.Do(ctx, "INCR", "x").Err())
+		require.Equal(t, rdb.Do(ctx, "EXEC").Val(), nil)
+		require.Equal(t, "40", rdb.Get(ctx, "x").Val())
+	})
+}
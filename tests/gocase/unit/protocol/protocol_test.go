@@ -21,6 +21,8 @@ package protocol
 
 import (
 	"context"
+	"fmt"
+	"strings"
 	"testing"
 
 	"github.com/redis/go-redis/v9"
@@ -138,6 +140,31 @@ func TestProtocolNetwork(t *testing.T) {
 		require.NoError(t, c.Write("type foo\n"))
 		c.MustRead(t, "+string")
 	})
+
+	t.Run("pipelined GET commands keep their order and errors", func(t *testing.T) {
+		c := srv.NewTCPClient()
+		defer func() { require.NoError(t, c.Close()) }()
+		require.NoError(t, c.WriteArgs("SET", "pipeline-str", "v1"))
+		c.MustRead(t, "+OK")
+		require.NoError(t, c.WriteArgs("LPUSH", "pipeline-list", "e"))
+		c.MustRead(t, ":1")
+		require.NoError(t, c.WriteArgs("SETBIT", "pipeline-bit", "1", "1"))
+		c.MustRead(t, ":0")
+
+		var req strings.Builder
+		for _, key := range []string{"pipeline-str", "pipeline-none", "pipeline-list", "pipeline-bit", "pipeline-str"} {
+			req.WriteString(fmt.Sprintf("*2\r\n$3\r\nGET\r\n$%d\r\n%s\r\n", len(key), key))
+		}
+		require.NoError(t, c.Write(req.String()))
+		c.MustRead(t, "$2")
+		c.MustRead(t, "v1")
+		c.MustRead(t, "$-1")
+		c.MustMatch(t, "WRONGTYPE")
+		c.MustRead(t, "$1")
+		c.MustRead(t, "@")
+		c.MustRead(t, "$2")
+		c.MustRead(t, "v1")
+	})
 }
 
 func TestProtocolRESP2(t *testing.T) {
@@ -446,3 +446,66 @@ func testPubSub(t *testing.T, configs util.KvrocksServerConfigs) {
 		require.EqualValues(t, 0, receiveType(t, pubsub, &redis.Subscription{}).Count)
 	})
 }
+
+func TestKeyspaceNotifications(t *testing.T) {
+	srv := util.StartServer(t, map[string]string{})
+	defer srv.Close()
+
+	ctx := context.Background()
+	rdb := srv.NewClient()
+	defer func() { require.NoError(t, rdb.Close()) }()
+
+	t.Run("Keyspace notifications are disabled by default", func(t *testing.T) {
+		pubsub := rdb.PSubscribe(ctx, "__key*")
+		defer pubsub.Close()
+		receiveType(t, pubsub, &redis.Subscription{})
+		require.NoError(t, rdb.Set(ctx, "foo", "bar", 0).Err())
+		require.NoError(t, pubsub.Ping(ctx))
+		receiveType(t, pubsub, &redis.Pong{})
+	})
+
+	t.Run("Keyspace and keyevent notifications of the write commands", func(t *testing.T) {
+		require.NoError(t, rdb.ConfigSet(ctx, "notify-keyspace-events", "KEA").Err())
+		defer func() { require.NoError(t, rdb.ConfigSet(ctx, "notify-keyspace-events", "").Err()) }()
+
+		pubsub := rdb.PSubscribe(ctx, "__keyspace@0__:*", "__keyevent@0__:*")
+		defer pubsub.Close()
+		receiveType(t, pubsub, &redis.Subscription{})
+		receiveType(t, pubsub, &redis.Subscription{})
+
+		require.NoError(t, rdb.Set(ctx, "foo", "bar", 0).Err())
+		msg := receiveType(t, pubsub, &redis.Message{})
+		require.Equal(t, "__keyspace@0__:foo", msg.Channel)
+		require.Equal(t, "set", msg.Payload)
+		msg = receiveType(t, pubsub, &redis.Message{})
+		require.Equal(t, "__keyevent@0__:set", msg.Channel)
+		require.Equal(t, "foo", msg.Payload)
+
+		// the read commands are not notified
+		require.NoError(t, rdb.Get(ctx, "foo").Err())
+		require.NoError(t, rdb.HSet(ctx, "hash", "f", "v").Err())
+		msg = receiveType(t, pubsub, &redis.Message{})
+		require.Equal(t, "__keyspace@0__:hash", msg.Channel)
+		require.Equal(t, "hset", msg.Payload)
+		receiveType(t, pubsub, &redis.Message{})
+	})
+
+	t.Run("Keyspace notifications filtered by classes", func(t *testing.T) {
+		require.NoError(t, rdb.ConfigSet(ctx, "notify-keyspace-events", "Kh").Err())
+		defer func() { require.NoError(t, rdb.ConfigSet(ctx, "notify-keyspace-events", "").Err()) }()
+
+		pubsub := rdb.PSubscribe(ctx, "__key*")
+		defer pubsub.Close()
+		receiveType(t, pubsub, &redis.Subscription{})
+
+		require.NoError(t, rdb.Set(ctx, "foo", "bar", 0).Err())
+		require.NoError(t, rdb.HSet(ctx, "hash", "f", "v2").Err())
+		msg := receiveType(t, pubsub, &redis.Message{})
+		require.Equal(t, "__keyspace@0__:hash", msg.Channel)
+		require.Equal(t, "hset", msg.Payload)
+	})
+
+	t.Run("Invalid keyspace event classes", func(t *testing.T) {
+		require.ErrorContains(t, rdb.ConfigSet(ctx, "notify-keyspace-events", "KEQ").Err(), "invalid keyspace event class")
+	})
+}
@@ -27,8 +27,10 @@ import (
 	"path/filepath"
 	"strings"
 	"testing"
+	"time"
 
 	"github.com/apache/kvrocks/tests/gocase/util"
+	"github.com/redis/go-redis/v9"
 	"github.com/stretchr/testify/require"
 )
 
@@ -59,3 +61,44 @@ func TestLoadRDB(t *testing.T) {
 		require.EqualValues(t, 601, client.LLen(ctx, "ABCD").Val())
 	})
 }
+
+func TestExportRDB(t *testing.T) {
+	srv := util.StartServer(t, map[string]string{})
+	defer srv.Close()
+
+	ctx := context.Background()
+	client := srv.NewClient()
+	defer func() { require.NoError(t, client.Close()) }()
+
+	require.NoError(t, client.Set(ctx, "string", "value", 0).Err())
+	require.NoError(t, client.Set(ctx, "expiring", "value", time.Hour).Err())
+	require.NoError(t, client.RPush(ctx, "list", "a", "b", "c").Err())
+	require.NoError(t, client.SAdd(ctx, "set", "a", "b").Err())
+	require.NoError(t, client.HSet(ctx, "hash", "f1", "v1", "f2", "v2").Err())
+	require.NoError(t, client.ZAdd(ctx, "zset", redis.Z{Score: 1, Member: "a"}, redis.Z{Score: 2.5, Member: "b"}).Err())
+	require.NoError(t, client.XAdd(ctx, &redis.XAddArgs{Stream: "stream", Values: []string{"f", "v"}}).Err())
+
+	rdbFileName := filepath.Join(t.TempDir(), "export.rdb")
+	require.NoError(t, client.Do(ctx, "RDB", "SAVE", rdbFileName).Err())
+	require.Eventually(t, func() bool {
+		return util.FindInfoEntry(client, "rdb_export_in_progress") == "0"
+	}, 10*time.Second, 100*time.Millisecond)
+	require.Equal(t, "ok", util.FindInfoEntry(client, "last_rdb_export_status"))
+	require.Equal(t, "6", util.FindInfoEntry(client, "rdb_export_keys"))
+	require.Equal(t, "1", util.FindInfoEntry(client, "rdb_export_skipped_keys"))
+
+	target := util.StartServer(t, map[string]string{})
+	defer target.Close()
+	targetClient := target.NewClient()
+	defer func() { require.NoError(t, targetClient.Close()) }()
+
+	require.NoError(t, targetClient.Do(ctx, "RDB", "LOAD", rdbFileName).Err())
+	require.Equal(t, "value", targetClient.Get(ctx, "string").Val())
+	require.Greater(t, targetClient.TTL(ctx, "expiring").Val(), time.Duration(0))
+	require.Equal(t, []string{"a", "b", "c"}, targetClient.LRange(ctx, "list", 0, -1).Val())
+	require.ElementsMatch(t, []string{"a", "b"}, targetClient.SMembers(ctx, "set").Val())
+	require.Equal(t, map[string]string{"f1": "v1", "f2": "v2"}, targetClient.HGetAll(ctx, "hash").Val())
+	require.Equal(t, []redis.Z{{Score: 1, Member: "a"}, {Score: 2.5, Member: "b"}},
+		targetClient.ZRangeWithScores(ctx, "zset", 0, -1).Val())
+	require.EqualValues(t, 0, targetClient.Exists(ctx, "stream").Val())
+}
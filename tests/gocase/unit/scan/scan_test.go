@@ -97,6 +97,34 @@ func ScanTest(t *testing.T, rdb *redis.Client, ctx context.Context) {
 		require.Len(t, keys, 1000)
 	})
 
+	t.Run("SCAN MATCH with a glob pattern", func(t *testing.T) {
+		require.NoError(t, rdb.FlushDB(ctx).Err())
+		util.Populate(t, rdb, "key:", 1000, 10)
+		require.NoError(t, rdb.Set(ctx, "other:1", "v", 0).Err())
+		keys := scanAll(t, rdb, "match", "key:?5", "count", "3")
+		slices.Sort(keys)
+		require.Equal(t, []string{"key:15", "key:25", "key:35", "key:45", "key:55", "key:65", "key:75", "key:85", "key:95"}, keys)
+		require.Equal(t, []string{"other:1"}, scanAll(t, rdb, "match", "*er:1"))
+		require.Empty(t, scanAll(t, rdb, "match", "key:[ab]*"))
+	})
+
+	t.Run("SCAN PARALLEL and parallel KEYS", func(t *testing.T) {
+		require.NoError(t, rdb.FlushDB(ctx).Err())
+		util.Populate(t, rdb, "key:", 1000, 10)
+		util.Populate(t, rdb, "other:", 100, 10)
+		expected := scanAll(t, rdb, "match", "key:*")
+		require.Len(t, expected, 1000)
+		require.Equal(t, expected, scanAll(t, rdb, "match", "key:*", "count", "7", "parallel", "4"))
+		require.Equal(t, expected, scanAll(t, rdb, "match", "key:*", "count", "2000", "parallel", "4"))
+		require.Len(t, scanAll(t, rdb, "count", "10", "parallel", "3"), 1100)
+
+		require.NoError(t, rdb.ConfigSet(ctx, "keys-scan-threads", "4").Err())
+		defer func() { require.NoError(t, rdb.ConfigSet(ctx, "keys-scan-threads", "1").Err()) }()
+		require.Equal(t, expected, rdb.Keys(ctx, "key:*").Val())
+
+		util.ErrorRegexp(t, rdb.Do(ctx, "SCAN", "0", "parallel", "0").Err(), ".*out of numeric range.*")
+	})
+
 	t.Run("SCAN guarantees check under write load", func(t *testing.T) {
 		require.NoError(t, rdb.FlushDB(ctx).Err())
 		util.Populate(t, rdb, "", 100, 10)
@@ -203,6 +231,47 @@ func ScanTest(t *testing.T, rdb *redis.Client, ctx context.Context) {
 		require.Equal(t, []string{"1", "10", "foo", "foobar"}, keys)
 	})
 
+	t.Run("HSCAN, SSCAN and ZSCAN with a glob pattern", func(t *testing.T) {
+		require.NoError(t, rdb.Del(ctx, "myhash", "myset", "myzset").Err())
+		for i := 0; i < 100; i++ {
+			member := fmt.Sprintf("session:%d:x", i)
+			require.NoError(t, rdb.HSet(ctx, "myhash", member, i).Err())
+			require.NoError(t, rdb.SAdd(ctx, "myset", member).Err())
+			require.NoError(t, rdb.ZAdd(ctx, "myzset", redis.Z{Score: float64(i), Member: member}).Err())
+		}
+		require.NoError(t, rdb.HSet(ctx, "myhash", "session:5:y", 0).Err())
+		require.NoError(t, rdb.SAdd(ctx, "myset", "session:5:y").Err())
+		require.NoError(t, rdb.ZAdd(ctx, "myzset", redis.Z{Score: 0, Member: "session:5:y"}).Err())
+
+		expected := []string{"session:50:x", "session:51:x", "session:52:x", "session:53:x", "session:54:x",
+			"session:55:x", "session:56:x", "session:57:x", "session:58:x", "session:59:x", "session:5:x"}
+		for _, cmd := range []string{"HSCAN", "SSCAN", "ZSCAN"} {
+			key := map[string]string{"HSCAN": "myhash", "SSCAN": "myset", "ZSCAN": "myzset"}[cmd]
+			var members []string
+			c := "0"
+			for {
+				res := rdb.Do(ctx, cmd, key, c, "match", "session:5*:x", "count", "3").Val().([]interface{})
+				c = res[0].(string)
+				elems := res[1].([]interface{})
+				step := 1
+				if cmd != "SSCAN" {
+					step = 2
+				}
+				for i := 0; i < len(elems); i += step {
+					members = append(members, elems[i].(string))
+				}
+				if c == "0" {
+					break
+				}
+			}
+			require.Equal(t, expected, members, cmd)
+		}
+
+		keys, _, err := rdb.SScan(ctx, "myset", 0, "*:[xz]", 1000).Result()
+		require.NoError(t, err)
+		require.Len(t, keys, 100)
+	})
+
 	for _, test := range []struct {
 		name   string
 		keyGen func(int) interface{}
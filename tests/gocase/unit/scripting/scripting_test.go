@@ -23,6 +23,7 @@ import (
 	"context"
 	"fmt"
 	"math/big"
+	"sync"
 	"testing"
 	"time"
 
@@ -147,6 +148,21 @@ return {type(foo),foo}
 		require.Equal(t, "[number 1]", fmt.Sprintf("%v", r.Val()))
 	})
 
+	t.Run("EVAL - Lua number -> Redis command argument conversion", func(t *testing.T) {
+		require.NoError(t, rdb.Del(ctx, "x", "y").Err())
+		r := rdb.Eval(ctx, `
+redis.call('set',KEYS[1],12345678901234)
+local a = redis.call('get',KEYS[1])
+redis.call('set',KEYS[1],-7)
+local b = redis.call('get',KEYS[1])
+redis.call('set',KEYS[1],1.5)
+local c = redis.call('get',KEYS[1])
+return {a,b,c,redis.call('incrby',KEYS[2],-5)}
+`, []string{"x", "y"})
+		require.NoError(t, r.Err())
+		require.Equal(t, "[12345678901234 -7 1.5 -5]", fmt.Sprintf("%v", r.Val()))
+	})
+
 	t.Run("EVAL - Redis bulk -> Lua type conversion", func(t *testing.T) {
 		require.NoError(t, rdb.Set(ctx, "mykey", "myval", 0).Err())
 		r := rdb.Eval(ctx, `
@@ -520,6 +536,41 @@ func TestScriptingMasterSlave(t *testing.T) {
 		require.Equal(t, []bool{false}, masterClient.ScriptExists(ctx, sha).Val())
 		require.Equal(t, []bool{false}, slaveClient.ScriptExists(ctx, sha).Val())
 	})
+
+	t.Run("SCRIPTING: no-writes script can be evaluated on slave", func(t *testing.T) {
+		require.NoError(t, masterClient.Set(ctx, "no-writes-key", "v1", 0).Err())
+		util.WaitForOffsetSync(t, masterClient, slaveClient, 5*time.Second)
+
+		r := slaveClient.Do(ctx, "EVAL", `#!lua flags=no-writes
+return redis.call('get', KEYS[1])`, "1", "no-writes-key")
+		require.NoError(t, r.Err())
+		require.Equal(t, "v1", r.Val())
+
+		r = slaveClient.Do(ctx, "EVAL", `#!lua flags=no-writes
+return redis.call('set', KEYS[1], 'v2')`, "1", "no-writes-key")
+		util.ErrorRegexp(t, r.Err(), ".*Write commands are not allowed from read-only scripts.*")
+	})
+}
+
+func TestScriptingRestart(t *testing.T) {
+	srv := util.StartServer(t, map[string]string{})
+	defer srv.Close()
+
+	ctx := context.Background()
+	rdb := srv.NewClient()
+	defer func() { require.NoError(t, rdb.Close()) }()
+
+	t.Run("SCRIPT LOAD - scripts are available to every worker after restart", func(t *testing.T) {
+		sha := rdb.ScriptLoad(ctx, `return 'loaded ' .. ARGV[1]`).Val()
+
+		srv.Restart()
+
+		require.Equal(t, "loaded a", rdb.EvalSha(ctx, sha, []string{}, "a").Val())
+		require.Equal(t, "loaded b", rdb.Do(ctx, "EVALSHA_RO", sha, "0", "b").Val())
+
+		require.NoError(t, rdb.ScriptFlush(ctx).Err())
+		util.ErrorRegexp(t, rdb.EvalSha(ctx, sha, []string{}, "c").Err(), "NOSCRIPT.*")
+	})
 }
 
 func TestScriptingWithRESP3(t *testing.T) {
@@ -886,3 +937,48 @@ func TestEvalScriptFlags(t *testing.T) {
 
 	})
 }
+
+func TestScriptLockDeclaredKeys(t *testing.T) {
+	srv := util.StartServer(t, map[string]string{
+		"script-lock-declared-keys": "yes",
+	})
+	defer srv.Close()
+
+	ctx := context.Background()
+	rdb := srv.NewClient()
+	defer func() { require.NoError(t, rdb.Close()) }()
+
+	t.Run("Concurrent scripts on the same keys are isolated", func(t *testing.T) {
+		require.NoError(t, rdb.Del(ctx, "counter").Err())
+
+		var wg sync.WaitGroup
+		for i := 0; i < 8; i++ {
+			wg.Add(1)
+			go func() {
+				defer wg.Done()
+				for j := 0; j < 50; j++ {
+					r := rdb.Eval(ctx, `local v = tonumber(redis.call('get', KEYS[1]) or '0')
+					return redis.call('set', KEYS[1], v + 1)`, []string{"counter"})
+					require.NoError(t, r.Err())
+				}
+			}()
+		}
+		wg.Wait()
+
+		require.EqualValues(t, "400", rdb.Get(ctx, "counter").Val())
+	})
+
+	t.Run("Scripts with declared keys can't access the other keys", func(t *testing.T) {
+		r := rdb.Eval(ctx, `return redis.call('set', 'undeclared', 'v')`, []string{"declared"})
+		util.ErrorRegexp(t, r.Err(), "ERR .* Script attempted to access a key not declared in KEYS")
+
+		r = rdb.Eval(ctx, `return redis.call('flushdb')`, []string{"declared"})
+		util.ErrorRegexp(t, r.Err(), "ERR .* Write commands without keys are not allowed.*")
+	})
+
+	t.Run("Scripts without declared keys run exclusively", func(t *testing.T) {
+		r := rdb.Eval(ctx, `return redis.call('set', 'undeclared', 'v')`, []string{})
+		require.NoError(t, r.Err())
+		require.Equal(t, "v", rdb.Get(ctx, "undeclared").Val())
+	})
+}
@@ -23,7 +23,9 @@ import (
 	"bytes"
 	"context"
 	"encoding/binary"
+	"fmt"
 	"testing"
+	"time"
 
 	"github.com/apache/kvrocks/tests/gocase/util"
 	"github.com/redis/go-redis/v9"
@@ -72,6 +74,11 @@ func TestSearch(t *testing.T) {
 
 		srv.Restart()
 		verify(t)
+		// the index with a vector field is warmed up after the restart
+		require.Eventually(t, func() bool {
+			idxInfo := rdb.Do(ctx, "FT.INFO", "testidx1").Val().([]interface{})
+			return idxInfo[18] == "loading" && idxInfo[19] == int64(0)
+		}, 10*time.Second, 100*time.Millisecond)
 
 		require.NoError(t, rdb.Do(ctx, "FT.CREATE", "testidx2", "SCHEMA", "x", "NUMERIC").Err())
 		require.NoError(t, rdb.Do(ctx, "FT.DROPINDEX", "testidx2").Err())
@@ -192,6 +199,225 @@ func TestSearch(t *testing.T) {
 		verifyTagVals(t, res, expectedC)
 	})
 
+	t.Run("FT.SEARCH on quantized vectors", func(t *testing.T) {
+		require.NoError(t, rdb.Do(ctx, "FT.CREATE", "testidx3", "ON", "JSON", "PREFIX", "1", "test3:", "SCHEMA",
+			"v", "VECTOR", "HNSW", "8", "TYPE", "FLOAT64", "DIM", "3", "DISTANCE_METRIC", "L2", "QUANTIZATION", "SQ8").Err())
+		require.ErrorContains(t, rdb.Do(ctx, "FT.CREATE", "testidx4", "ON", "JSON", "SCHEMA",
+			"v", "VECTOR", "HNSW", "8", "TYPE", "FLOAT64", "DIM", "3", "DISTANCE_METRIC", "L2", "QUANTIZATION", "PQ").Err(),
+			"unsupported vector quantization")
+
+		require.NoError(t, rdb.Do(ctx, "JSON.SET", "test3:k1", "$", `{"v": [2,3,4]}`).Err())
+		require.NoError(t, rdb.Do(ctx, "JSON.SET", "test3:k2", "$", `{"v": [12,13,14]}`).Err())
+		require.NoError(t, rdb.Do(ctx, "JSON.SET", "test3:k3", "$", `{"v": [23,24,25]}`).Err())
+
+		var buf bytes.Buffer
+		require.NoError(t, SetBinaryBuffer(&buf, []float64{13, 14, 15}))
+		for _, query := range []string{`*=>[KNN 2 @v $BLOB]`, `*=>[KNN 2 @v $BLOB EF_RUNTIME 50]`} {
+			res := rdb.Do(ctx, "FT.SEARCH", "testidx3", query, "PARAMS", "2", "BLOB", buf.Bytes())
+			require.NoError(t, res.Err())
+			require.Equal(t, int64(2), res.Val().([]interface{})[0])
+			require.Equal(t, "test3:k2", res.Val().([]interface{})[1])
+			require.Equal(t, "test3:k3", res.Val().([]interface{})[3])
+		}
+
+		require.NoError(t, rdb.Do(ctx, "FT.DROPINDEX", "testidx3").Err())
+	})
+
+	t.Run("FT.CREATE builds the index of existing keys", func(t *testing.T) {
+		for i := 0; i < 600; i++ {
+			require.NoError(t, rdb.Do(ctx, "HSET", fmt.Sprintf("test4:k%d", i), "n", i).Err())
+		}
+		require.NoError(t, rdb.Do(ctx, "FT.CREATE", "testidx4", "ON", "HASH", "PREFIX", "1", "test4:", "SCHEMA", "n", "NUMERIC").Err())
+
+		require.Eventually(t, func() bool {
+			idxInfo := rdb.Do(ctx, "FT.INFO", "testidx4").Val().([]interface{})
+			return idxInfo[6] == "indexing" && idxInfo[7] == int64(0)
+		}, 5*time.Second, 50*time.Millisecond)
+		idxInfo := rdb.Do(ctx, "FT.INFO", "testidx4").Val().([]interface{})
+		require.Equal(t, "percent_indexed", idxInfo[8])
+		require.Equal(t, "1", idxInfo[9])
+		require.Equal(t, "hash_indexing_failures", idxInfo[10])
+		require.Equal(t, int64(0), idxInfo[11])
+
+		res := rdb.Do(ctx, "FT.SEARCH", "testidx4", "@n:[590 1000]", "LIMIT", "0", "100")
+		require.NoError(t, res.Err())
+		require.Equal(t, int64(10), res.Val().([]interface{})[0])
+
+		require.NoError(t, rdb.Do(ctx, "FT.DROPINDEX", "testidx4").Err())
+	})
+
+	t.Run("FT.SEARCH with async indexing", func(t *testing.T) {
+		require.NoError(t, rdb.Do(ctx, "FT.CREATE", "testidx5", "ON", "HASH", "PREFIX", "1", "test5:", "SCHEMA", "n", "NUMERIC", "t", "TAG").Err())
+		require.NoError(t, rdb.ConfigSet(ctx, "search-async-indexing", "yes").Err())
+		defer func() { require.NoError(t, rdb.ConfigSet(ctx, "search-async-indexing", "no").Err()) }()
+
+		for i := 0; i < 100; i++ {
+			require.NoError(t, rdb.Do(ctx, "HSET", fmt.Sprintf("test5:k%d", i%10), "n", i, "t", fmt.Sprintf("t%d", i)).Err())
+		}
+
+		res := rdb.Do(ctx, "FT.SEARCH", "testidx5", "@n:[90 99]", "WAITINDEX", "5000")
+		require.NoError(t, res.Err())
+		require.Equal(t, int64(10), res.Val().([]interface{})[0])
+		res = rdb.Do(ctx, "FT.SEARCH", "testidx5", "@n:[0 89]", "WAITINDEX", "5000")
+		require.NoError(t, res.Err())
+		require.Equal(t, int64(0), res.Val().([]interface{})[0])
+		res = rdb.Do(ctx, "FT.SEARCH", "testidx5", "@t:{t5}", "WAITINDEX", "5000")
+		require.NoError(t, res.Err())
+		require.Equal(t, int64(0), res.Val().([]interface{})[0])
+
+		// the commands pipelined after a waiting search are replied after it
+		for i := 0; i < 100; i++ {
+			require.NoError(t, rdb.Do(ctx, "HSET", fmt.Sprintf("test5:k%d", i%10), "n", i+100).Err())
+		}
+		pipe := rdb.Pipeline()
+		search := pipe.Do(ctx, "FT.SEARCH", "testidx5", "@n:[190 199]", "WAITINDEX", "5000")
+		get := pipe.HGet(ctx, "test5:k0", "n")
+		_, err := pipe.Exec(ctx)
+		require.NoError(t, err)
+		require.Equal(t, int64(10), search.Val().([]interface{})[0])
+		require.Equal(t, "190", get.Val())
+
+		require.ErrorContains(t, rdb.Do(ctx, "FT.SEARCH", "testidx5", "*", "WAITINDEX", "0").Err(), "out of numeric range")
+		require.NoError(t, rdb.Do(ctx, "FT.DROPINDEX", "testidx5").Err())
+	})
+
+	t.Run("FT.SEARCH reuses the cached plans", func(t *testing.T) {
+		require.NoError(t, rdb.Do(ctx, "FT.CREATE", "testidx6", "ON", "HASH", "PREFIX", "1", "test6:", "SCHEMA", "n", "NUMERIC").Err())
+		for i := 0; i < 10; i++ {
+			require.NoError(t, rdb.Do(ctx, "HSET", fmt.Sprintf("test6:k%d", i), "n", i).Err())
+		}
+
+		for i := 0; i < 4; i++ {
+			res := rdb.Do(ctx, "FT.SEARCH", "testidx6", "@n:[$lo 9]", "PARAMS", "2", "lo", "5")
+			require.NoError(t, res.Err())
+			require.Equal(t, int64(5), res.Val().([]interface{})[0])
+		}
+		idxInfo := rdb.Do(ctx, "FT.INFO", "testidx6").Val().([]interface{})
+		require.Equal(t, "plan_cache_hits", idxInfo[12])
+		require.Equal(t, int64(3), idxInfo[13])
+		require.Equal(t, "plan_cache_hit_rate", idxInfo[14])
+		require.Equal(t, "0.75", idxInfo[15])
+
+		// the parameters are a part of the key
+		res := rdb.Do(ctx, "FT.SEARCH", "testidx6", "@n:[$lo 9]", "PARAMS", "2", "lo", "8")
+		require.NoError(t, res.Err())
+		require.Equal(t, int64(2), res.Val().([]interface{})[0])
+		require.Equal(t, int64(3), rdb.Do(ctx, "FT.INFO", "testidx6").Val().([]interface{})[13])
+
+		// the cached plans refer to the dropped index
+		require.NoError(t, rdb.Do(ctx, "FT.DROPINDEX", "testidx6").Err())
+		require.NoError(t, rdb.Do(ctx, "FT.CREATE", "testidx6", "ON", "HASH", "PREFIX", "1", "test6:", "SCHEMA", "n", "NUMERIC").Err())
+		require.Eventually(t, func() bool {
+			res := rdb.Do(ctx, "FT.SEARCH", "testidx6", "@n:[$lo 9]", "PARAMS", "2", "lo", "5")
+			return res.Err() == nil && res.Val().([]interface{})[0] == int64(5)
+		}, 5*time.Second, 50*time.Millisecond)
+
+		require.NoError(t, rdb.Do(ctx, "FT.DROPINDEX", "testidx6").Err())
+	})
+
+	t.Run("FT.SEARCH intersects the tag and numeric scans", func(t *testing.T) {
+		require.NoError(t, rdb.Do(ctx, "FT.CREATE", "testidx7", "ON", "HASH", "PREFIX", "1", "test7:", "SCHEMA", "n", "NUMERIC", "t", "TAG").Err())
+		for i := 0; i < 60; i++ {
+			tags := "a"
+			if i%3 == 0 {
+				tags = "a,b"
+			}
+			require.NoError(t, rdb.Do(ctx, "HSET", fmt.Sprintf("test7:k%d", i), "n", i%10, "t", tags).Err())
+		}
+
+		require.Contains(t, rdb.Do(ctx, "FT.EXPLAIN", "testidx7", "@t:{a} @t:{b} @n:[0 0]").Val(), "intersect")
+		res := rdb.Do(ctx, "FT.SEARCH", "testidx7", "@t:{a} @t:{b} @n:[0 0]")
+		require.NoError(t, res.Err())
+		require.Equal(t, int64(2), res.Val().([]interface{})[0])
+		require.Equal(t, "test7:k0", res.Val().([]interface{})[1])
+		require.Equal(t, "test7:k30", res.Val().([]interface{})[3])
+
+		require.NoError(t, rdb.Do(ctx, "FT.DROPINDEX", "testidx7").Err())
+	})
+
+	t.Run("FT.PROFILE", func(t *testing.T) {
+		require.NoError(t, rdb.Do(ctx, "FT.CREATE", "testidx9", "ON", "HASH", "PREFIX", "1", "test9:", "SCHEMA", "n", "NUMERIC").Err())
+		for i := 0; i < 20; i++ {
+			require.NoError(t, rdb.Do(ctx, "HSET", fmt.Sprintf("test9:k%d", i), "n", i).Err())
+		}
+
+		res := rdb.Do(ctx, "FT.PROFILE", "testidx9", "SEARCH", "QUERY", "@n:[5 9]", "LIMIT", "0", "3")
+		require.NoError(t, res.Err())
+		results := res.Val().([]interface{})[0].([]interface{})
+		require.Equal(t, int64(3), results[0])
+
+		// the root of the plan is the projection
+		profile := res.Val().([]interface{})[1].([]interface{})
+		require.Equal(t, []interface{}{"type", "Projection"}, profile[:2])
+		require.Equal(t, "rows", profile[6])
+		require.Equal(t, int64(3), profile[7])
+		require.Equal(t, "time_ms", profile[8])
+		require.Equal(t, "children", profile[18])
+		require.Len(t, profile[19].([]interface{}), 1)
+
+		require.ErrorContains(t, rdb.Do(ctx, "FT.PROFILE", "testidx9", "AGGREGATE", "QUERY", "*").Err(), "only SEARCH queries")
+		require.NoError(t, rdb.Do(ctx, "FT.DROPINDEX", "testidx9").Err())
+	})
+
+	t.Run("FT.AGGREGATE", func(t *testing.T) {
+		require.NoError(t, rdb.Do(ctx, "FT.CREATE", "testidx10", "ON", "HASH", "PREFIX", "1", "test10:", "SCHEMA", "c", "TAG", "n", "NUMERIC").Err())
+		for i := 0; i < 30; i++ {
+			require.NoError(t, rdb.Do(ctx, "HSET", fmt.Sprintf("test10:k%d", i), "c", []string{"a", "b", "c"}[i%3], "n", i%5).Err())
+		}
+
+		res := rdb.Do(ctx, "FT.AGGREGATE", "testidx10", "@n:[1 4]", "GROUPBY", "1", "@c", "REDUCE", "COUNT", "0", "AS", "count",
+			"REDUCE", "SUM", "1", "@n", "AS", "sum", "REDUCE", "COUNT_DISTINCT", "1", "@n", "AS", "distinct",
+			"APPLY", "@sum / @count", "AS", "avg", "SORTBY", "2", "@c", "DESC", "LIMIT", "0", "2")
+		require.NoError(t, res.Err())
+		require.Equal(t, []interface{}{int64(2),
+			[]interface{}{"c", "c", "count", "8", "sum", "20", "distinct", "4", "avg", "2.5"},
+			[]interface{}{"c", "b", "count", "8", "sum", "20", "distinct", "4", "avg", "2.5"},
+		}, res.Val())
+
+		res = rdb.Do(ctx, "FT.AGGREGATE", "testidx10", "*", "GROUPBY", "0", "REDUCE", "MAX", "1", "@n")
+		require.NoError(t, res.Err())
+		require.Equal(t, []interface{}{int64(1), []interface{}{"__generated_aliasmaxn", "4"}}, res.Val())
+
+		require.ErrorContains(t, rdb.Do(ctx, "FT.AGGREGATE", "testidx10", "*", "REDUCE", "COUNT", "0").Err(), "REDUCE must follow GROUPBY")
+		require.ErrorContains(t, rdb.Do(ctx, "FT.AGGREGATE", "testidx10", "*", "GROUPBY", "1", "@c", "APPLY", "@x * 2", "AS", "y").Err(),
+			"column `x` is not defined")
+
+		require.NoError(t, rdb.ConfigSet(ctx, "search-aggregate-max-memory", "0").Err())
+		require.NoError(t, rdb.Do(ctx, "FT.AGGREGATE", "testidx10", "*", "GROUPBY", "1", "@n").Err())
+		require.NoError(t, rdb.ConfigSet(ctx, "search-aggregate-max-memory", "256").Err())
+		require.NoError(t, rdb.Do(ctx, "FT.DROPINDEX", "testidx10").Err())
+	})
+
+	t.Run("FT.INFO reports the health of the HNSW graphs", func(t *testing.T) {
+		require.NoError(t, rdb.Do(ctx, "FT.CREATE", "testidx8", "ON", "JSON", "PREFIX", "1", "test8:", "SCHEMA",
+			"v", "VECTOR", "HNSW", "6", "TYPE", "FLOAT64", "DIM", "3", "DISTANCE_METRIC", "L2").Err())
+		for i := 0; i < 100; i++ {
+			require.NoError(t, rdb.Do(ctx, "JSON.SET", fmt.Sprintf("test8:k%d", i), "$", fmt.Sprintf(`{"v": [%d,%d,%d]}`, i, i%7, i%13)).Err())
+		}
+		for i := 0; i < 100; i += 3 {
+			require.NoError(t, rdb.Do(ctx, "DEL", fmt.Sprintf("test8:k%d", i)).Err())
+		}
+
+		require.NoError(t, rdb.ConfigSet(ctx, "hnsw-maintenance-interval", "1").Err())
+		defer func() { require.NoError(t, rdb.ConfigSet(ctx, "hnsw-maintenance-interval", "3600").Err()) }()
+		require.Eventually(t, func() bool {
+			idxInfo := rdb.Do(ctx, "FT.INFO", "testidx8").Val().([]interface{})
+			return idxInfo[16] == "hnsw_graphs" && len(idxInfo[17].([]interface{})) == 1
+		}, 10*time.Second, 100*time.Millisecond)
+		graph := rdb.Do(ctx, "FT.INFO", "testidx8").Val().([]interface{})[17].([]interface{})[0].([]interface{})
+		require.Equal(t, []interface{}{"identifier", "v", "nodes", int64(66)}, graph[:4])
+		require.Equal(t, "unreachable_nodes", graph[8])
+
+		// the relinked nodes can be found by the searches
+		var buf bytes.Buffer
+		require.NoError(t, SetBinaryBuffer(&buf, []float64{50, 1, 11}))
+		res := rdb.Do(ctx, "FT.SEARCH", "testidx8", `*=>[KNN 1 @v $BLOB]`, "PARAMS", "2", "BLOB", buf.Bytes())
+		require.NoError(t, res.Err())
+		require.Equal(t, "test8:k50", res.Val().([]interface{})[1])
+
+		require.NoError(t, rdb.Do(ctx, "FT.DROPINDEX", "testidx8").Err())
+	})
+
 	t.Run("FT.DROPINDEX", func(t *testing.T) {
 		require.NoError(t, rdb.Do(ctx, "FT.DROPINDEX", "testidx1").Err())
 
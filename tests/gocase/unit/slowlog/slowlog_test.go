@@ -173,3 +173,37 @@ func TestSlowlog(t *testing.T) {
 	})
 
 }
+
+func TestSlowlogWithPerfStats(t *testing.T) {
+	srv := util.StartServer(t, map[string]string{
+		"slowlog-log-slower-than":         "0",
+		"profiling-stats-sample-interval": "1",
+	})
+	defer srv.Close()
+	ctx := context.Background()
+	rdb := srv.NewClient()
+	defer func() { require.NoError(t, rdb.Close()) }()
+
+	t.Run("SLOWLOG - sampled entries carry perf stats", func(t *testing.T) {
+		require.NoError(t, rdb.Set(ctx, "foo", "bar", 0).Err())
+		require.NoError(t, rdb.Do(ctx, "slowlog", "reset").Err())
+		require.Equal(t, "bar", rdb.Get(ctx, "foo").Val())
+
+		entries := rdb.Do(ctx, "slowlog", "get", 1).Val().([]interface{})
+		require.Len(t, entries, 1)
+		entry := entries[0].([]interface{})
+		require.Len(t, entry, 7)
+		require.Equal(t, []interface{}{"get", "foo"}, entry[3])
+		require.Contains(t, entry[6], "memtable_get=")
+	})
+
+	t.Run("INFO perfstats aggregates sampled commands", func(t *testing.T) {
+		r := util.FindInfoEntry(rdb, "perfstat_get", "perfstats")
+		require.Regexp(t, `^samples=\d+,block_cache_hit=\d+`, r)
+
+		require.NoError(t, rdb.ConfigSet(ctx, "profiling-stats-sample-interval", "0").Err())
+		samples := util.FindInfoEntry(rdb, "perfstat_get", "perfstats")
+		require.Equal(t, "bar", rdb.Get(ctx, "foo").Val())
+		require.Equal(t, samples, util.FindInfoEntry(rdb, "perfstat_get", "perfstats"))
+	})
+}
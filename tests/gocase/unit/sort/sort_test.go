@@ -302,6 +302,32 @@ func TestListSort(t *testing.T) {
 		require.Equal(t, []interface{}{"5", "6", "4"}, byResult)
 	})
 
+	t.Run("SORT BY + GET with many elements", func(t *testing.T) {
+		var expected []string
+		for i := 0; i < 500; i++ {
+			rdb.RPush(ctx, "many_uid", i)
+			rdb.HSet(ctx, fmt.Sprintf("many_info_%d", i), "level", 1000-i, "name", fmt.Sprintf("name_%d", i))
+			if i%3 != 0 {
+				rdb.Set(ctx, fmt.Sprintf("many_name_%d", i), fmt.Sprintf("s_%d", i), 0)
+			}
+		}
+		for i := 489; i >= 480; i-- {
+			expected = append(expected, fmt.Sprintf("name_%d", i))
+		}
+
+		sortResult, err := rdb.Sort(ctx, "many_uid", &redis.Sort{By: "many_info_*->level", Offset: 10, Count: 10,
+			Get: []string{"many_info_*->name"}}).Result()
+		require.NoError(t, err)
+		require.Equal(t, expected, sortResult)
+
+		getResult, err := rdb.Do(ctx, "Sort", "many_uid", "By", "many_info_*->level", "Desc", "Get", "#",
+			"Get", "many_name_*").Slice()
+		require.NoError(t, err)
+		require.Len(t, getResult, 1000)
+		require.Equal(t, []interface{}{"0", nil, "1", "s_1", "2", "s_2", "3", nil}, getResult[:8])
+		require.Equal(t, []interface{}{"498", nil, "499", "s_499"}, getResult[996:])
+	})
+
 	t.Run("SORT STORE", func(t *testing.T) {
 		rdb.RPush(ctx, "numbers", 1, 3, 5, 7, 9, 2, 4, 6, 8, 10)
 
@@ -0,0 +1,180 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+package tracking
+
+import (
+	"context"
+	"strconv"
+	"strings"
+	"testing"
+	"time"
+
+	"github.com/apache/kvrocks/tests/gocase/util"
+	"github.com/stretchr/testify/require"
+)
+
+func TestClientTracking(t *testing.T) {
+	srv := util.StartServer(t, map[string]string{})
+	defer srv.Close()
+
+	ctx := context.Background()
+	rdb := srv.NewClient()
+	defer func() { require.NoError(t, rdb.Close()) }()
+
+	// the invalidations of the trackers are redirected to the subscriber
+	sub := srv.NewTCPClient()
+	defer func() { require.NoError(t, sub.Close()) }()
+	require.NoError(t, sub.WriteArgs("CLIENT", "ID"))
+	line, err := sub.ReadLine()
+	require.NoError(t, err)
+	subID := strings.TrimPrefix(line, ":")
+	require.NoError(t, sub.WriteArgs("SUBSCRIBE", "__redis__:invalidate"))
+	for _, s := range []string{"*3", "$9", "subscribe", "$20", "__redis__:invalidate", ":1"} {
+		sub.MustRead(t, s)
+	}
+	mustReadInvalidation := func(keys ...string) {
+		for _, s := range []string{"*3", "$7", "message", "$20", "__redis__:invalidate"} {
+			sub.MustRead(t, s)
+		}
+		sub.MustRead(t, "*"+strconv.Itoa(len(keys)))
+		for _, key := range keys {
+			sub.MustRead(t, "$"+strconv.Itoa(len(key)))
+			sub.MustRead(t, key)
+		}
+	}
+
+	t.Run("CLIENT TRACKING requires RESP3 or REDIRECT", func(t *testing.T) {
+		c := srv.NewTCPClient()
+		defer func() { require.NoError(t, c.Close()) }()
+		require.NoError(t, c.WriteArgs("CLIENT", "TRACKING", "ON"))
+		c.MustMatch(t, "requires RESP3")
+		require.NoError(t, c.WriteArgs("CLIENT", "TRACKING", "ON", "REDIRECT", "123456"))
+		c.MustMatch(t, "does not exist")
+		require.NoError(t, c.WriteArgs("CLIENT", "TRACKING", "ON", "OPTIN", "OPTOUT"))
+		c.MustMatch(t, "both OPTIN and OPTOUT")
+		require.NoError(t, c.WriteArgs("CLIENT", "TRACKING", "ON", "PREFIX", "a"))
+		c.MustMatch(t, "requires BCAST")
+		require.NoError(t, c.WriteArgs("CLIENT", "GETREDIRECT"))
+		c.MustRead(t, ":-1")
+	})
+
+	t.Run("The keys read by the tracker are invalidated on writes", func(t *testing.T) {
+		tracker := srv.NewTCPClient()
+		defer func() { require.NoError(t, tracker.Close()) }()
+		require.NoError(t, tracker.WriteArgs("CLIENT", "TRACKING", "ON", "REDIRECT", subID))
+		tracker.MustRead(t, "+OK")
+		require.NoError(t, tracker.WriteArgs("CLIENT", "GETREDIRECT"))
+		tracker.MustRead(t, ":"+subID)
+		require.NoError(t, tracker.WriteArgs("GET", "foo"))
+		tracker.MustRead(t, "$-1")
+
+		require.NoError(t, rdb.Set(ctx, "foo", "bar", 0).Err())
+		mustReadInvalidation("foo")
+
+		// the key isn't tracked after it's invalidated until it's read again
+		require.NoError(t, rdb.Set(ctx, "foo", "baz", 0).Err())
+		require.NoError(t, tracker.WriteArgs("GET", "foo"))
+		tracker.MustRead(t, "$3")
+		tracker.MustRead(t, "baz")
+		require.NoError(t, rdb.Del(ctx, "foo").Err())
+		mustReadInvalidation("foo")
+
+		// FLUSHDB invalidates all the keys by a null array
+		require.NoError(t, tracker.WriteArgs("GET", "foo"))
+		tracker.MustRead(t, "$-1")
+		require.NoError(t, rdb.FlushDB(ctx).Err())
+		for _, s := range []string{"*3", "$7", "message", "$20", "__redis__:invalidate", "*-1"} {
+			sub.MustRead(t, s)
+		}
+
+		require.NoError(t, tracker.WriteArgs("CLIENT", "TRACKING", "OFF"))
+		tracker.MustRead(t, "+OK")
+	})
+
+	t.Run("The OPTIN tracker only tracks the keys after CLIENT CACHING YES", func(t *testing.T) {
+		tracker := srv.NewTCPClient()
+		defer func() { require.NoError(t, tracker.Close()) }()
+		require.NoError(t, tracker.WriteArgs("CLIENT", "TRACKING", "ON", "REDIRECT", subID, "OPTIN"))
+		tracker.MustRead(t, "+OK")
+		require.NoError(t, tracker.WriteArgs("GET", "k1"))
+		tracker.MustRead(t, "$-1")
+		require.NoError(t, tracker.WriteArgs("CLIENT", "CACHING", "YES"))
+		tracker.MustRead(t, "+OK")
+		require.NoError(t, tracker.WriteArgs("GET", "k2"))
+		tracker.MustRead(t, "$-1")
+
+		require.NoError(t, rdb.MSet(ctx, "k1", "v1", "k2", "v2").Err())
+		mustReadInvalidation("k2")
+	})
+
+	t.Run("The BCAST tracker is notified of the keys with its prefixes", func(t *testing.T) {
+		tracker := srv.NewTCPClient()
+		defer func() { require.NoError(t, tracker.Close()) }()
+		require.NoError(t, tracker.WriteArgs("CLIENT", "TRACKING", "ON", "REDIRECT", subID, "BCAST", "PREFIX", "user:"))
+		tracker.MustRead(t, "+OK")
+
+		require.NoError(t, rdb.MSet(ctx, "user:1", "a", "item:1", "b", "user:2", "c").Err())
+		mustReadInvalidation("user:1", "user:2")
+	})
+
+	t.Run("The RESP3 tracker is told once when its redirect client is gone", func(t *testing.T) {
+		redirect := srv.NewTCPClient()
+		require.NoError(t, redirect.WriteArgs("CLIENT", "ID"))
+		line, err := redirect.ReadLine()
+		require.NoError(t, err)
+		redirectID := strings.TrimPrefix(line, ":")
+
+		tracker := srv.NewTCPClient()
+		defer func() { require.NoError(t, tracker.Close()) }()
+		require.NoError(t, tracker.WriteArgs("HELLO", "3"))
+		require.NoError(t, tracker.WriteArgs("PING"))
+		for line != "+PONG" {
+			line, err = tracker.ReadLine()
+			require.NoError(t, err)
+		}
+		require.NoError(t, tracker.WriteArgs("CLIENT", "TRACKING", "ON", "REDIRECT", redirectID))
+		tracker.MustRead(t, "+OK")
+
+		// the fd of the closed client may be reused, the invalidations mustn't go there
+		require.NoError(t, redirect.Close())
+		require.Eventually(t, func() bool {
+			return !strings.Contains(rdb.ClientList(ctx).Val(), "id="+redirectID+" ")
+		}, 5*time.Second, 10*time.Millisecond)
+		other := srv.NewTCPClient()
+		defer func() { require.NoError(t, other.Close()) }()
+
+		require.NoError(t, tracker.WriteArgs("GET", "broken"))
+		tracker.MustRead(t, "_")
+		require.NoError(t, rdb.Set(ctx, "broken", "1", 0).Err())
+		for _, s := range []string{">2", "$21", "tracking-redir-broken", ":" + redirectID} {
+			tracker.MustRead(t, s)
+		}
+
+		// the invalidations are dropped from now on
+		require.NoError(t, tracker.WriteArgs("GET", "broken"))
+		tracker.MustRead(t, "$1")
+		tracker.MustRead(t, "1")
+		require.NoError(t, rdb.Set(ctx, "broken", "2", 0).Err())
+		require.NoError(t, tracker.WriteArgs("PING"))
+		tracker.MustRead(t, "+PONG")
+		require.NoError(t, other.WriteArgs("PING"))
+		other.MustRead(t, "+PONG")
+	})
+}
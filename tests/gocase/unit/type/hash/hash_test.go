@@ -31,6 +31,7 @@ import (
 	"time"
 
 	"github.com/apache/kvrocks/tests/gocase/util"
+	"github.com/redis/go-redis/v9"
 	"github.com/stretchr/testify/require"
 )
 
@@ -867,6 +868,40 @@ func TestHGetAllWithRESP3(t *testing.T) {
 	}, result)
 }
 
+func TestHGetAllStreaming(t *testing.T) {
+	srv := util.StartServer(t, map[string]string{
+		"reply-streaming-threshold": "100",
+	})
+	defer srv.Close()
+
+	rdb := srv.NewClient()
+	defer func() { require.NoError(t, rdb.Close()) }()
+
+	ctx := context.Background()
+
+	expected := make(map[string]string)
+	var args []interface{}
+	for i := 0; i < 5000; i++ {
+		field, value := fmt.Sprintf("field-%d", i), strings.Repeat("v", 100)+strconv.Itoa(i)
+		expected[field] = value
+		args = append(args, field, value)
+	}
+	require.NoError(t, rdb.Del(ctx, "hash").Err())
+	require.NoError(t, rdb.HSet(ctx, "hash", args...).Err())
+
+	// The commands pipelined after a streamed reply are replied in order
+	pipe := rdb.Pipeline()
+	hgetall := pipe.HGetAll(ctx, "hash")
+	hlen := pipe.HLen(ctx, "hash")
+	_, err := pipe.Exec(ctx)
+	require.NoError(t, err)
+	require.EqualValues(t, expected, hgetall.Val())
+	require.EqualValues(t, 5000, hlen.Val())
+
+	require.NoError(t, rdb.HSet(ctx, "small", "f", "v").Err())
+	require.EqualValues(t, map[string]string{"f": "v"}, rdb.HGetAll(ctx, "small").Val())
+}
+
 func TestHashWithAsyncIOEnabled(t *testing.T) {
 	srv := util.StartServer(t, map[string]string{
 		"rocksdb.read_options.async_io": "yes",
@@ -948,3 +983,80 @@ func TestHashWithAsyncIODisabled(t *testing.T) {
 		require.Len(t, rdb.HVals(ctx, testKey).Val(), 50)
 	})
 }
+
+func TestHashFieldExpire(t *testing.T) {
+	srv := util.StartServer(t, map[string]string{})
+	defer srv.Close()
+
+	rdb := srv.NewClient()
+	defer func() { require.NoError(t, rdb.Close()) }()
+
+	ctx := context.Background()
+
+	t.Run("HEXPIRE sets the TTL of the fields", func(t *testing.T) {
+		require.NoError(t, rdb.Del(ctx, "hfe").Err())
+		require.NoError(t, rdb.HSet(ctx, "hfe", "f1", "v1", "f2", "v2", "f3", "v3").Err())
+
+		require.EqualValues(t, []interface{}{int64(1), int64(1), int64(-2)},
+			rdb.Do(ctx, "HEXPIRE", "hfe", 100, "FIELDS", 3, "f1", "f2", "f4").Val())
+		ttl := rdb.Do(ctx, "HTTL", "hfe", "FIELDS", 3, "f1", "f3", "f4").Val().([]interface{})
+		require.GreaterOrEqual(t, ttl[0].(int64), int64(99))
+		require.EqualValues(t, -1, ttl[1])
+		require.EqualValues(t, -2, ttl[2])
+		require.EqualValues(t, []interface{}{int64(-2)}, rdb.Do(ctx, "HTTL", "no-such-hash", "FIELDS", 1, "f1").Val())
+
+		require.EqualValues(t, []interface{}{int64(0), int64(1)},
+			rdb.Do(ctx, "HEXPIRE", "hfe", 200, "NX", "FIELDS", 2, "f1", "f3").Val())
+		require.EqualValues(t, []interface{}{int64(0)}, rdb.Do(ctx, "HEXPIRE", "hfe", 50, "GT", "FIELDS", 1, "f1").Val())
+		require.EqualValues(t, []interface{}{int64(1)}, rdb.Do(ctx, "HEXPIRE", "hfe", 50, "LT", "FIELDS", 1, "f1").Val())
+
+		require.EqualValues(t, []interface{}{int64(1), int64(-1)},
+			rdb.Do(ctx, "HPERSIST", "hfe", "FIELDS", 2, "f1", "f1").Val())
+		require.EqualValues(t, []interface{}{int64(-1)}, rdb.Do(ctx, "HTTL", "hfe", "FIELDS", 1, "f1").Val())
+
+		require.ErrorContains(t, rdb.Do(ctx, "HEXPIRE", "hfe", 100, "FIELDS", 2, "f1").Err(), "numfields")
+	})
+
+	t.Run("The expired fields are gone", func(t *testing.T) {
+		require.NoError(t, rdb.Del(ctx, "hfe").Err())
+		require.NoError(t, rdb.HSet(ctx, "hfe", "f1", "v1", "f2", "v2", "f3", "v3").Err())
+		require.EqualValues(t, []interface{}{int64(1), int64(1)},
+			rdb.Do(ctx, "HPEXPIRE", "hfe", 100, "FIELDS", 2, "f1", "f2").Val())
+		time.Sleep(200 * time.Millisecond)
+
+		require.Equal(t, redis.Nil, rdb.HGet(ctx, "hfe", "f1").Err())
+		require.Equal(t, []interface{}{nil, "v3"}, rdb.HMGet(ctx, "hfe", "f2", "f3").Val())
+		require.Equal(t, map[string]string{"f3": "v3"}, rdb.HGetAll(ctx, "hfe").Val())
+		require.Equal(t, []string{"f3"}, rdb.HKeys(ctx, "hfe").Val())
+		require.False(t, rdb.HExists(ctx, "hfe", "f1").Val())
+
+		// HSET adds an expired field again without its TTL
+		require.EqualValues(t, 1, rdb.HSet(ctx, "hfe", "f1", "new").Val())
+		require.EqualValues(t, []interface{}{int64(-1)}, rdb.Do(ctx, "HTTL", "hfe", "FIELDS", 1, "f1").Val())
+		require.EqualValues(t, 0, rdb.HDel(ctx, "hfe", "f2").Val())
+
+		// the reaper deletes the expired fields in the background
+		require.Eventually(t, func() bool {
+			return rdb.HLen(ctx, "hfe").Val() == 2
+		}, 5*time.Second, 100*time.Millisecond)
+	})
+
+	t.Run("HEXPIRE with a time in the past deletes the fields", func(t *testing.T) {
+		require.NoError(t, rdb.Del(ctx, "hfe").Err())
+		require.NoError(t, rdb.HSet(ctx, "hfe", "f1", "v1", "f2", "v2").Err())
+		require.EqualValues(t, []interface{}{int64(2)}, rdb.Do(ctx, "HEXPIREAT", "hfe", 1, "FIELDS", 1, "f1").Val())
+		require.EqualValues(t, 1, rdb.HLen(ctx, "hfe").Val())
+		require.EqualValues(t, []interface{}{int64(2)}, rdb.Do(ctx, "HPEXPIREAT", "hfe", 0, "FIELDS", 1, "f2").Val())
+		require.EqualValues(t, 0, rdb.Exists(ctx, "hfe").Val())
+	})
+
+	t.Run("HINCRBY keeps the TTL of a live field", func(t *testing.T) {
+		require.NoError(t, rdb.Del(ctx, "hfe").Err())
+		require.NoError(t, rdb.HSet(ctx, "hfe", "n", "1").Err())
+		expireAt := time.Now().Add(time.Hour).UnixMilli()
+		require.EqualValues(t, []interface{}{int64(1)}, rdb.Do(ctx, "HPEXPIREAT", "hfe", expireAt, "FIELDS", 1, "n").Val())
+		require.EqualValues(t, 3, rdb.HIncrBy(ctx, "hfe", "n", 2).Val())
+		require.EqualValues(t, []interface{}{expireAt}, rdb.Do(ctx, "HPEXPIRETIME", "hfe", "FIELDS", 1, "n").Val())
+		require.EqualValues(t, []interface{}{expireAt / 1000}, rdb.Do(ctx, "HEXPIRETIME", "hfe", "FIELDS", 1, "n").Val())
+	})
+}
@@ -21,6 +21,8 @@ package json
 
 import (
 	"context"
+	"fmt"
+	"strings"
 	"testing"
 
 	"github.com/redis/go-redis/v9"
@@ -114,6 +116,26 @@ func testJSON(t *testing.T, configs util.KvrocksServerConfigs) {
 		EqualJSON(t, `{"x":1,"y":2}`, rdb.Do(ctx, "JSON.GET", "a").Val())
 	})
 
+	t.Run("JSON storage format split", func(t *testing.T) {
+		require.NoError(t, rdb.Do(ctx, "CONFIG", "SET", "json-storage-format", "split").Err())
+		defer func() {
+			require.NoError(t, rdb.Do(ctx, "CONFIG", "SET", "json-storage-format", "json").Err())
+		}()
+
+		require.NoError(t, rdb.Do(ctx, "JSON.SET", "c", "$", `{"x":1, "y":{"z":[1,2]}}`).Err())
+		require.Equal(t, "split", rdb.Do(ctx, "JSON.INFO", "c").Val().([]interface{})[1])
+		EqualJSON(t, `[3]`, rdb.Do(ctx, "JSON.NUMINCRBY", "c", "$.x", "2").Val())
+		require.NoError(t, rdb.Do(ctx, "JSON.SET", "c", "$.y.z[0]", `"a"`).Err())
+		require.NoError(t, rdb.Do(ctx, "JSON.SET", "c", "$.w", `[]`).Err())
+		EqualJSON(t, `[["a",2]]`, rdb.Do(ctx, "JSON.GET", "c", "$.y.z").Val())
+		EqualJSON(t, `{"w":[],"x":3,"y":{"z":["a",2]}}`, rdb.Do(ctx, "JSON.GET", "c").Val())
+		require.EqualValues(t, 1, rdb.Do(ctx, "JSON.DEL", "c", "$.w").Val())
+		EqualJSON(t, `{"x":3,"y":{"z":["a",2]}}`, rdb.Do(ctx, "JSON.GET", "c").Val())
+
+		require.NoError(t, rdb.Do(ctx, "COPY", "c", "d").Err())
+		EqualJSON(t, `{"x":3,"y":{"z":["a",2]}}`, rdb.Do(ctx, "JSON.GET", "d").Val())
+	})
+
 	t.Run("JSON.ARRAPPEND basics", func(t *testing.T) {
 		require.NoError(t, rdb.Do(ctx, "SET", "a", `1`).Err())
 		require.Error(t, rdb.Do(ctx, "JSON.ARRAPPEND", "a", "$", `1`).Err())
@@ -637,6 +659,28 @@ func testJSON(t *testing.T, configs util.KvrocksServerConfigs) {
 
 	})
 
+	t.Run("JSON.MGET of large documents keeps the order of the keys", func(t *testing.T) {
+		// the documents take more than 1MB in total, so they're decoded in parallel
+		var keys []interface{}
+		padding := strings.Repeat("x", 64*1024)
+		for i := 0; i < 32; i++ {
+			key := fmt.Sprintf("mget-large-%d", i)
+			require.NoError(t, rdb.Do(ctx, "JSON.SET", key, "$", fmt.Sprintf(`{"i": %d, "padding": "%s"}`, i, padding)).Err())
+			keys = append(keys, key)
+		}
+		keys = append(keys, "mget-large-nonexists")
+
+		for _, path := range []string{"$.i", "$..i"} {
+			vals, err := rdb.Do(ctx, append(append([]interface{}{"JSON.MGET"}, keys...), path)...).Slice()
+			require.NoError(t, err)
+			require.Len(t, vals, 33)
+			for i := 0; i < 32; i++ {
+				require.EqualValues(t, fmt.Sprintf("[%d]", i), vals[i])
+			}
+			require.Nil(t, vals[32])
+		}
+	})
+
 	t.Run("JSON.MSET basics", func(t *testing.T) {
 		require.NoError(t, rdb.Do(ctx, "JSON.DEL", "a0").Err())
 		require.Error(t, rdb.Do(ctx, "JSON.MSET", "a0", "$.a", `{"a": 1, "b": 2, "nested": {"a": 3}, "c": null}`, "a1", "$", `{"a": 4, "b": 5, "nested": {"a": 6}, "c": null}`).Err())
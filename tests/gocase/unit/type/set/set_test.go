@@ -21,6 +21,7 @@ package set
 
 import (
 	"context"
+	"fmt"
 	"sort"
 	"strconv"
 	"testing"
@@ -490,6 +491,30 @@ var setTests = func(t *testing.T, configs util.KvrocksServerConfigs) {
 		require.EqualValues(t, 0, rdb.SInterCard(ctx, 0, "set3").Val())
 	})
 
+	t.Run("SINTER and SINTERCARD of a small set and much larger sets", func(t *testing.T) {
+		require.NoError(t, rdb.Del(ctx, "set1", "set2", "set3").Err())
+		var large []interface{}
+		for i := 0; i < 5000; i++ {
+			large = append(large, fmt.Sprintf("m%04d", i))
+		}
+		require.NoError(t, rdb.SAdd(ctx, "set1", large...).Err())
+		require.NoError(t, rdb.SAdd(ctx, "set2", large[:3000]...).Err())
+		var small []interface{}
+		var expected []string
+		for i := 0; i < 5000; i += 50 {
+			small = append(small, fmt.Sprintf("m%04d", i), fmt.Sprintf("x%04d", i))
+			if i < 3000 {
+				expected = append(expected, fmt.Sprintf("m%04d", i))
+			}
+		}
+		require.NoError(t, rdb.SAdd(ctx, "set3", small...).Err())
+
+		require.Equal(t, expected, rdb.SInter(ctx, "set1", "set2", "set3").Val())
+		require.Equal(t, expected, rdb.SInter(ctx, "set3", "set1", "set2").Val())
+		require.EqualValues(t, len(expected), rdb.SInterCard(ctx, 0, "set1", "set3", "set2").Val())
+		require.EqualValues(t, 7, rdb.SInterCard(ctx, 7, "set1", "set3", "set2").Val())
+	})
+
 	t.Run("SINTER with same integer elements but different encoding", func(t *testing.T) {
 		require.NoError(t, rdb.Del(ctx, "set1", "set2").Err())
 		require.NoError(t, rdb.SAdd(ctx, "set1", 1, 2, 3).Err())
@@ -246,6 +246,65 @@ var streamTests = func(t *testing.T, configs util.KvrocksServerConfigs) {
 		require.EqualValues(t, "1641544570597-1", items[1].ID)
 	})
 
+	t.Run("XADDMULTI adds the entries by one write", func(t *testing.T) {
+		require.NoError(t, rdb.Del(ctx, "mystream").Err())
+		require.ErrorContains(t, rdb.Do(ctx, "XADDMULTI", "mystream", "*", "2", "a", "1").Err(), "field-value pairs")
+		require.Equal(t, redis.Nil, rdb.Do(ctx, "XADDMULTI", "mystream", "NOMKSTREAM", "*", "1", "a", "1").Err())
+
+		ids, err := rdb.Do(ctx, "XADDMULTI", "mystream", "1-1", "1", "a", "1", "*", "2", "b", "2", "c", "3").StringSlice()
+		require.NoError(t, err)
+		require.Len(t, ids, 2)
+		require.Equal(t, "1-1", ids[0])
+		items := rdb.XRange(ctx, "mystream", "-", "+").Val()
+		require.Len(t, items, 2)
+		require.Equal(t, ids[1], items[1].ID)
+		require.EqualValues(t, map[string]interface{}{"b": "2", "c": "3"}, items[1].Values)
+
+		// nothing is added if one of the IDs is invalid
+		require.ErrorContains(t, rdb.Do(ctx, "XADDMULTI", "mystream", "*", "1", "a", "1", "1-2", "1", "a", "1").Err(),
+			"equal or smaller")
+		require.EqualValues(t, 2, rdb.XLen(ctx, "mystream").Val())
+
+		ids, err = rdb.Do(ctx, "XADDMULTI", "mystream", "MAXLEN", "3",
+			"*", "1", "a", "1", "*", "1", "a", "2", "*", "1", "a", "3", "*", "1", "a", "4").StringSlice()
+		require.NoError(t, err)
+		require.Len(t, ids, 4)
+		items = rdb.XRange(ctx, "mystream", "-", "+").Val()
+		require.Len(t, items, 3)
+		require.Equal(t, ids[1:], []string{items[0].ID, items[1].ID, items[2].ID})
+		info := rdb.XInfoStream(ctx, "mystream").Val()
+		require.EqualValues(t, 6, info.EntriesAdded)
+		require.Equal(t, ids[0], info.MaxDeletedEntryID)
+	})
+
+	t.Run("XREAD of many streams", func(t *testing.T) {
+		var streams []string
+		for i := 0; i < 50; i++ {
+			stream := fmt.Sprintf("xread-stream-%d", i)
+			require.NoError(t, rdb.Del(ctx, stream).Err())
+			if i%2 == 0 {
+				require.NoError(t, rdb.XAdd(ctx, &redis.XAddArgs{Stream: stream, ID: "1-1", Values: []string{"i", fmt.Sprint(i)}}).Err())
+			}
+			streams = append(streams, stream)
+		}
+		for range streams {
+			streams = append(streams, "0-0")
+		}
+		r, err := rdb.XRead(ctx, &redis.XReadArgs{Streams: streams}).Result()
+		require.NoError(t, err)
+		require.Len(t, r, 25)
+		for i, stream := range r {
+			require.Equal(t, fmt.Sprintf("xread-stream-%d", i*2), stream.Stream)
+			require.Equal(t, []redis.XMessage{{ID: "1-1", Values: map[string]interface{}{"i": fmt.Sprint(i * 2)}}}, stream.Messages)
+		}
+
+		// the streams without entries after the IDs are skipped
+		for i := 50; i < 100; i++ {
+			streams[i] = "1-1"
+		}
+		require.Equal(t, redis.Nil, rdb.XRead(ctx, &redis.XReadArgs{Streams: streams, Block: -1}).Err())
+	})
+
 	t.Run("XADD mass insertion and XLEN", func(t *testing.T) {
 		require.NoError(t, rdb.Del(ctx, "mystream").Err())
 		insertIntoStreamKey(t, rdb, "mystream")
@@ -584,6 +643,20 @@ var streamTests = func(t *testing.T, configs util.KvrocksServerConfigs) {
 		require.EqualValues(t, 555, rdb.XLen(ctx, "mystream").Val())
 	})
 
+	t.Run("XTRIM with ~ only removes whole chunks", func(t *testing.T) {
+		require.NoError(t, rdb.Del(ctx, "mystream").Err())
+		for i := 0; i < 250; i++ {
+			require.NoError(t, rdb.XAdd(ctx, &redis.XAddArgs{Stream: "mystream", Values: map[string]interface{}{"xitem": i}}).Err())
+		}
+		require.EqualValues(t, 100, rdb.Do(ctx, "XTRIM", "mystream", "MAXLEN", "~", 60).Val())
+		require.EqualValues(t, 150, rdb.XLen(ctx, "mystream").Val())
+		require.EqualValues(t, 0, rdb.Do(ctx, "XTRIM", "mystream", "MAXLEN", "~", 60, "LIMIT", 99).Val())
+		require.EqualValues(t, 100, rdb.Do(ctx, "XTRIM", "mystream", "MAXLEN", "~", 0, "LIMIT", 100).Val())
+		require.EqualValues(t, 50, rdb.XLen(ctx, "mystream").Val())
+		require.EqualValues(t, 40, rdb.Do(ctx, "XTRIM", "mystream", "MAXLEN", 10).Val())
+		require.ErrorContains(t, rdb.Do(ctx, "XTRIM", "mystream", "MAXLEN", 10, "LIMIT", 10).Err(), "LIMIT")
+	})
+
 	t.Run("XADD with LIMIT consecutive calls", func(t *testing.T) {
 		require.NoError(t, rdb.Del(ctx, "mystream").Err())
 		for i := 0; i < 100; i++ {
@@ -201,6 +201,29 @@ func basicTests(t *testing.T, rdb *redis.Client, ctx context.Context, enabledRES
 		require.Equal(t, []redis.Z{{5, "x"}, {10, "a"}, {20, "b"}, {30, "c"}}, rdb.ZRangeWithScores(ctx, "myzset", 0, -1).Val())
 	})
 
+	t.Run("ZADD - Many members with duplicated and unchanged scores", func(t *testing.T) {
+		rdb.Del(ctx, "myzset")
+		var members []redis.Z
+		for i := 0; i < 1000; i++ {
+			members = append(members, redis.Z{Score: float64(i), Member: fmt.Sprintf("m%d", i)})
+		}
+		require.Equal(t, int64(1000), rdb.ZAdd(ctx, "myzset", members...).Val())
+
+		// the unchanged scores aren't counted by CH, and the last score of a duplicated member wins
+		for i := range members {
+			if i%2 == 0 {
+				members[i].Score = -members[i].Score - 1
+			}
+		}
+		members = append(members, redis.Z{Score: 5000, Member: "m1"}, redis.Z{Score: 5001, Member: "new"})
+		require.Equal(t, int64(502), rdb.ZAddArgs(ctx, "myzset", redis.ZAddArgs{Ch: true, Members: members}).Val())
+		require.EqualValues(t, 1001, rdb.ZCard(ctx, "myzset").Val())
+		require.Equal(t, float64(5000), rdb.ZScore(ctx, "myzset", "m1").Val())
+		require.Equal(t, float64(-1), rdb.ZScore(ctx, "myzset", "m0").Val())
+		require.Equal(t, []redis.Z{{-999, "m998"}, {-997, "m996"}}, rdb.ZRangeWithScores(ctx, "myzset", 0, 1).Val())
+		require.Equal(t, []redis.Z{{5000, "m1"}, {5001, "new"}}, rdb.ZRangeWithScores(ctx, "myzset", -2, -1).Val())
+	})
+
 	t.Run("ZADD - Variadic version will raise error on missing arg", func(t *testing.T) {
 		rdb.Del(ctx, "myzset")
 		util.ErrorRegexp(t, rdb.Do(ctx, "zadd", "myzset", 10, "a", 20, "b", 30, "c", 40).Err(), ".*syntax.*")
@@ -26,6 +26,8 @@ var workspace = flag.String("workspace", "", "directory of cases workspace")
 var deleteOnExit = flag.Bool("deleteOnExit", false, "whether to delete workspace on exit")
 var cliPath = flag.String("cliPath", "redis-cli", "path to redis-cli")
 var tlsEnable = flag.Bool("tlsEnable", false, "enable TLS-related test cases")
+var perfEnable = flag.Bool("perfEnable", false, "enable the performance cases")
+var perfReport = flag.String("perfReport", "", "path to write the JSON report of the performance cases")
 
 func CLIPath() string {
 	return *cliPath
@@ -34,3 +36,11 @@ func CLIPath() string {
 func TLSEnable() bool {
 	return *tlsEnable
 }
+
+func PerfEnable() bool {
+	return *perfEnable
+}
+
+func PerfReport() string {
+	return *perfReport
+}
@@ -0,0 +1,283 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include <fmt/format.h>
+#include <getopt.h>
+#include <glog/logging.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include "cli/version_util.h"
+#include "io_util.h"
+#include "latency_histogram.h"
+#include "parse_util.h"
+#include "scope_exit.h"
+#include "server/redis_reply.h"
+#include "server/traffic_capture.h"
+#include "version.h"
+
+struct Options {
+  std::string capture_file;
+  std::string host = "127.0.0.1";
+  uint32_t port = 6666;
+  std::string password;
+  // the replay speed relative to the capture, 0 means as fast as possible
+  double speed = 1;
+};
+
+[[noreturn]] static void Usage(const char *program, int status) {
+  std::cout << program << " replays the traffic captured by the CAPTURE command of kvrocks\n"
+            << "\t-f <path> the capture file\n"
+            << "\t-H <host> the host of the server, defaulting to 127.0.0.1\n"
+            << "\t-p <port> the port of the server, defaulting to 6666\n"
+            << "\t-a <password> the password of the server\n"
+            << "\t-s <speed> replay the inter-arrival times scaled by 1/speed, defaulting to 1\n"
+            << "\t-m replay at max speed, ignoring the inter-arrival times\n"
+            << "\t-h print this help message\n"
+            << "\t-v print version information\n";
+  exit(status);
+}
+
+static Options ParseCommandLineOptions(int argc, char **argv) {
+  int ch = 0;
+  Options opts;
+  while ((ch = ::getopt(argc, argv, "f:H:p:a:s:mhv")) != -1) {
+    switch (ch) {
+      case 'f':
+        opts.capture_file = optarg;
+        break;
+      case 'H':
+        opts.host = optarg;
+        break;
+      case 'p': {
+        auto port = ParseInt<uint32_t>(optarg, NumericRange<uint32_t>{1, 65535});
+        if (!port) Usage(argv[0], 1);
+        opts.port = *port;
+        break;
+      }
+      case 'a':
+        opts.password = optarg;
+        break;
+      case 's': {
+        auto speed = ParseFloat<double>(optarg);
+        if (!speed || *speed <= 0) Usage(argv[0], 1);
+        opts.speed = *speed;
+        break;
+      }
+      case 'm':
+        opts.speed = 0;
+        break;
+      case 'v':
+        std::cout << "kvrocks-replay " << PrintVersion << std::endl;
+        exit(0);
+      case 'h':
+        Usage(argv[0], 0);
+      default:
+        Usage(argv[0], 1);
+    }
+  }
+  if (opts.capture_file.empty()) Usage(argv[0], 1);
+  return opts;
+}
+
+// ReplyReader reads the RESP replies from a blocking socket, only the errors are kept
+class ReplyReader {
+ public:
+  explicit ReplyReader(int fd) : fd_(fd) {}
+
+  // ReadReply returns whether the reply is an error
+  StatusOr<bool> ReadReply() {
+    auto line = GET_OR_RET(readLine());
+    if (line.empty()) return {Status::NotOK, "empty reply"};
+
+    switch (line[0]) {
+      case '-':
+        return true;
+      case '!':
+        GET_OR_RET(readBulk(line));
+        return true;
+      case '$':
+      case '=':
+        GET_OR_RET(readBulk(line));
+        return false;
+      case '*':
+      case '~':
+      case '>':
+      case '%':
+      case '|': {
+        auto n = GET_OR_RET(ParseInt<int64_t>(line.substr(1)));
+        if (line[0] == '%' || line[0] == '|') n *= 2;
+        bool is_error = false;
+        for (int64_t i = 0; i < n; i++) is_error = GET_OR_RET(ReadReply()) || is_error;
+        return is_error;
+      }
+      default:
+        // the simple strings, integers, nulls, doubles, booleans and big numbers
+        return false;
+    }
+  }
+
+ private:
+  int fd_;
+  std::string buf_;
+  size_t pos_ = 0;
+
+  Status fill() {
+    if (pos_ > 0) {
+      buf_.erase(0, pos_);
+      pos_ = 0;
+    }
+    char data[16 * 1024];
+    auto n = read(fd_, data, sizeof(data));
+    if (n < 0) return Status::FromErrno("failed to read the reply");
+    if (n == 0) return {Status::NotOK, "the connection is closed by the server"};
+    buf_.append(data, n);
+    return Status::OK();
+  }
+
+  StatusOr<std::string> readLine() {
+    while (true) {
+      auto end = buf_.find("\r\n", pos_);
+      if (end != std::string::npos) {
+        auto line = buf_.substr(pos_, end - pos_);
+        pos_ = end + 2;
+        return line;
+      }
+      GET_OR_RET(fill());
+    }
+  }
+
+  Status readBulk(const std::string &line) {
+    auto len = GET_OR_RET(ParseInt<int64_t>(line.substr(1)));
+    if (len < 0) return Status::OK();
+    auto size = static_cast<size_t>(len) + 2;
+    while (buf_.size() - pos_ < size) GET_OR_RET(fill());
+    pos_ += size;
+    return Status::OK();
+  }
+};
+
+struct ReplayStats {
+  std::atomic<uint64_t> commands = 0;
+  std::atomic<uint64_t> errors = 0;
+  std::atomic<uint64_t> failed_connections = 0;
+  LatencyHistogram latencies;
+};
+
+static std::atomic<bool> stop = false;
+
+extern "C" void SignalHandler([[maybe_unused]] int sig) { stop = true; }
+
+// ReplayConnection sends the commands of a captured connection one by one, like the client did
+static Status ReplayConnection(const Options &opts, const std::vector<TrafficCapture::Record> &records,
+                               std::chrono::steady_clock::time_point start, ReplayStats *stats) {
+  int fd = GET_OR_RET(util::SockConnect(opts.host, opts.port).Prefixed("failed to connect to the server"));
+  auto guard = MakeScopeExit([fd] { close(fd); });
+  ReplyReader reader(fd);
+
+  if (!opts.password.empty()) {
+    GET_OR_RET(util::SockSend(fd, redis::ArrayOfBulkStrings({"AUTH", opts.password})));
+    if (GET_OR_RET(reader.ReadReply())) return {Status::NotOK, "failed to authenticate"};
+  }
+
+  for (const auto &record : records) {
+    if (stop) break;
+    if (opts.speed > 0) {
+      auto offset = std::chrono::microseconds(static_cast<uint64_t>(static_cast<double>(record.time_us) / opts.speed));
+      std::this_thread::sleep_until(start + offset);
+    }
+
+    auto send_time = std::chrono::steady_clock::now();
+    GET_OR_RET(util::SockSend(fd, redis::ArrayOfBulkStrings(record.args)));
+    bool is_error = GET_OR_RET(reader.ReadReply());
+    auto latency = std::chrono::steady_clock::now() - send_time;
+    stats->latencies.Record(static_cast<uint64_t>(latency / std::chrono::microseconds(1)));
+    stats->commands.fetch_add(1, std::memory_order_relaxed);
+    if (is_error) stats->errors.fetch_add(1, std::memory_order_relaxed);
+  }
+  return Status::OK();
+}
+
+Server *GetServer() { return nullptr; }
+
+int main(int argc, char *argv[]) {
+  google::InitGoogleLogging("kvrocks-replay");
+  FLAGS_logtostderr = true;
+
+  signal(SIGPIPE, SIG_IGN);
+  signal(SIGINT, SignalHandler);
+  signal(SIGTERM, SignalHandler);
+
+  auto opts = ParseCommandLineOptions(argc, argv);
+
+  // The records are grouped by the connections, every connection is replayed by a thread to keep the concurrency
+  std::map<uint64_t, std::vector<TrafficCapture::Record>> connections;
+  TrafficCaptureReader capture_reader(opts.capture_file);
+  if (auto s = capture_reader.Open(); !s) {
+    LOG(ERROR) << s.Msg();
+    return 1;
+  }
+  uint64_t total = 0;
+  while (true) {
+    TrafficCapture::Record record;
+    auto s = capture_reader.Next(&record);
+    if (!s) {
+      // the last record may be cut by a crash, the complete ones are still replayed
+      LOG(WARNING) << "Stop reading the capture file: " << s.Msg();
+      break;
+    }
+    if (!*s) break;
+    connections[record.conn_id].emplace_back(std::move(record));
+    total++;
+  }
+  LOG(INFO) << "Replay " << total << " commands of " << connections.size() << " connections";
+
+  ReplayStats stats;
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (const auto &[id, records] : connections) {
+    threads.emplace_back([&, id = id] {
+      if (auto s = ReplayConnection(opts, records, start, &stats); !s) {
+        LOG(WARNING) << "Failed to replay the connection " << id << ": " << s.Msg();
+        stats.failed_connections++;
+      }
+    });
+  }
+  for (auto &thread : threads) thread.join();
+  auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  auto latencies = stats.latencies.GetSnapshot();
+  std::cout << fmt::format("commands: {}, errors: {}, failed connections: {}, seconds: {:.3f}, ops/sec: {:.1f}",
+                           stats.commands.load(), stats.errors.load(), stats.failed_connections.load(), seconds,
+                           seconds > 0 ? static_cast<double>(stats.commands) / seconds : 0)
+            << std::endl;
+  std::cout << fmt::format("latency(us): p50={} p90={} p99={} p99.9={} max={}", latencies.Percentile(50),
+                           latencies.Percentile(90), latencies.Percentile(99), latencies.Percentile(99.9),
+                           latencies.Percentile(100))
+            << std::endl;
+  return stats.failed_connections > 0 ? 1 : 0;
+}
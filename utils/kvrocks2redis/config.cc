@@ -92,6 +92,13 @@ Status Config::parseConfigFromString(const std::string &input) {
     cluster_enabled = GET_OR_RET(yesnotoi(args[0]).Prefixed("key 'cluster-enable'"));
   } else if (size == 1 && key == "cluster-enabled") {
     cluster_enabled = GET_OR_RET(yesnotoi(args[0]).Prefixed("key 'cluster-enabled'"));
+  } else if (size == 1 && key == "parse-threads") {
+    parse_threads = GET_OR_RET(ParseInt<int>(args[0], {1, 64}, 10).Prefixed("key 'parse-threads'"));
+  } else if (size == 1 && key == "redis-connections") {
+    redis_connections = GET_OR_RET(ParseInt<int>(args[0], {1, 64}, 10).Prefixed("key 'redis-connections'"));
+  } else if (size == 1 && key == "checkpoint-interval-ms") {
+    checkpoint_interval_ms =
+        GET_OR_RET(ParseInt<int>(args[0], {0, 3600 * 1000}, 10).Prefixed("key 'checkpoint-interval-ms'"));
   } else if (size >= 2 && strncasecmp(key.data(), "namespace.", 10) == 0) {
     std::string ns = original_key.substr(10);
     if (ns.size() > INT8_MAX) {
@@ -51,6 +51,10 @@ struct Config {
   std::map<std::string, RedisServer> tokens;
   bool cluster_enabled = false;
 
+  int parse_threads = 1;
+  int redis_connections = 1;
+  int checkpoint_interval_ms = 1000;
+
   Status Load(std::string path);
   Config() = default;
   ~Config() = default;
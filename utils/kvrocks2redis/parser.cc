@@ -167,15 +167,24 @@ Status Parser::parseBitmapSegment(const Slice &ns, const Slice &user_key, int in
 }
 
 Status Parser::ParseWriteBatch(const std::string &batch_string) {
+  auto resp_commands = GET_OR_RET(ExtractWriteBatch(batch_string));
+  return WriteCommands(resp_commands);
+}
+
+StatusOr<std::map<std::string, std::vector<std::string>>> Parser::ExtractWriteBatch(
+    const std::string &batch_string) const {
   rocksdb::WriteBatch write_batch(batch_string);
-  WriteBatchExtractor write_batch_extractor(slot_id_encoded_, -1, true);
+  WriteBatchExtractor write_batch_extractor(slot_id_encoded_, -1, true, storage_);
 
   auto db_status = write_batch.Iterate(&write_batch_extractor);
   if (!db_status.ok())
     return {Status::NotOK, fmt::format("failed to iterate over the write batch: {}", db_status.ToString())};
 
-  auto resp_commands = write_batch_extractor.GetRESPCommands();
-  for (const auto &iter : *resp_commands) {
+  return std::move(*write_batch_extractor.GetRESPCommands());
+}
+
+Status Parser::WriteCommands(const std::map<std::string, std::vector<std::string>> &resp_commands) {
+  for (const auto &iter : resp_commands) {
     auto s = writer_->Write(iter.first, iter.second);
     if (!s.IsOK()) {
       LOG(ERROR) << "[kvrocks2redis] Failed to write to AOF from the write batch. Error: " << s.Msg();
@@ -41,6 +41,10 @@ class Parser {
 
   Status ParseFullDB();
   Status ParseWriteBatch(const std::string &batch_string);
+  // ExtractWriteBatch returns the commands of the write batch by their namespaces without writing them,
+  // so the batches can be extracted by several threads at the same time
+  StatusOr<std::map<std::string, std::vector<std::string>>> ExtractWriteBatch(const std::string &batch_string) const;
+  Status WriteCommands(const std::map<std::string, std::vector<std::string>> &resp_commands);
 
  protected:
   engine::Storage *storage_ = nullptr;
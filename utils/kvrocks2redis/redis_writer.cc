@@ -20,180 +20,300 @@
 
 #include "redis_writer.h"
 
-#include <assert.h>
+#include <event2/buffer.h>
 #include <fcntl.h>
+#include <fmt/format.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
-#include <system_error>
-
 #include "io_util.h"
 #include "server/redis_reply.h"
 #include "thread_util.h"
 
 RedisWriter::RedisWriter(kvrocks2redis::Config *config) : Writer(config) {
-  try {
-    t_ = std::thread([this]() {
-      util::ThreadSetName("redis-writer");
-      this->sync();
-      assert(stop_flag_);
-    });
-  } catch (const std::system_error &e) {
-    LOG(ERROR) << "[kvrocks2redis] Failed to create thread: " << e.what();
-    return;
+  for (const auto &iter : config_->tokens) {
+    auto &links = links_[iter.first];
+    for (int partition = 0; partition < config_->redis_connections; partition++) {
+      auto link = std::make_unique<Link>(iter.first, partition, iter.second);
+      link->aof_fd = open(GetAofFilePath(iter.first, partition).data(), O_RDONLY | O_CREAT, 0666);
+      if (link->aof_fd < 0) {
+        LOG(ERROR) << "[kvrocks2redis] Failed to open aof file: " << strerror(errno);
+        return;
+      }
+
+      auto s = readNextOffsetFromFile(link.get());
+      links.push_back(std::move(link));
+      if (!s.IsOK()) {
+        LOG(ERROR) << s.Msg();
+        return;
+      }
+    }
+  }
+
+  for (int partition = 0; partition < config_->redis_connections; partition++) {
+    auto t = util::CreateThread("redis-writer", [this, partition] { this->sync(partition); });
+    if (!t) {
+      LOG(ERROR) << "[kvrocks2redis] Failed to create thread: " << t.Msg();
+      return;
+    }
+    threads_.push_back(std::move(*t));
   }
 }
 
 RedisWriter::~RedisWriter() {
-  for (const auto &iter : next_offset_fds_) {
-    close(iter.second);
-  }
-  for (const auto &iter : redis_fds_) {
-    close(iter.second);
+  Stop();
+  for (const auto &[ns, links] : links_) {
+    for (const auto &link : links) {
+      if (link->aof_fd >= 0) close(link->aof_fd);
+      if (link->next_offset_fd >= 0) close(link->next_offset_fd);
+      if (link->redis_fd >= 0) close(link->redis_fd);
+    }
   }
 }
 
-Status RedisWriter::Write(const std::string &ns, const std::vector<std::string> &aofs) {
-  auto s = Writer::Write(ns, aofs);
+Status RedisWriter::FlushDB(const std::string &ns) {
+  // the links of the namespace are paused, so nothing parsed before the flush is sent after it
+  auto iter = links_.find(ns);
+  if (iter == links_.end()) return Writer::FlushDB(ns);
+
+  const auto &links = iter->second;
+  std::vector<std::unique_lock<std::mutex>> guards;
+  for (const auto &link : links) {
+    guards.emplace_back(link->mu);
+  }
+
+  auto s = Writer::FlushDB(ns);
+  if (!s.IsOK()) return s;
+
+  for (const auto &link : links) {
+    link->next_offset = 0;
+    s = checkpoint(link.get(), true);
+    if (!s.IsOK()) return s;
+  }
+
+  auto link = links[0].get();
+  s = getRedisConn(link);
+  if (!s.IsOK()) return s;
+
+  s = util::SockSend(link->redis_fd, redis::ArrayOfBulkStrings({"FLUSHDB"}));
   if (!s.IsOK()) {
-    return s;
+    closeRedisConn(link);
+    return s.Prefixed("failed to send FLUSHDB command");
+  }
+
+  auto error_reply = readReplies(link, 1);
+  if (!error_reply) {
+    closeRedisConn(link);
+    return {Status::NotOK, "read redis FLUSHDB response err: " + error_reply.Msg()};
+  }
+  if (!error_reply->empty()) {
+    return {Status::NotOK, "[kvrocks2redis] redis FLUSHDB failed: " + *error_reply};
   }
 
   return Status::OK();
 }
 
-Status RedisWriter::FlushDB(const std::string &ns) {
-  auto s = Writer::FlushDB(ns);
-  if (!s.IsOK()) {
-    return s;
+Status RedisWriter::WriteBarrier(const std::string &ns, const std::string &command) {
+  auto iter = links_.find(ns);
+  if (iter == links_.end()) return Writer::WriteBarrier(ns, command);
+
+  // the commands are appended to the AOF files by this thread, so nothing is appended while waiting
+  const auto &links = iter->second;
+  for (const auto &link : links) {
+    while (true) {
+      if (stop_flag_) return {Status::NotOK, "the redis writer is stopped"};
+      {
+        std::lock_guard<std::mutex> guard(link->mu);
+        struct stat st {};
+        if (fstat(link->aof_fd, &st) < 0) return Status::FromErrno("Failed to stat aof file");
+        if (link->next_offset >= st.st_size) break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
   }
 
-  s = updateNextOffset(ns, 0);
+  auto link = links[0].get();
+  std::lock_guard<std::mutex> guard(link->mu);
+  auto s = getRedisConn(link);
+  if (!s.IsOK()) return s;
+
+  s = util::SockSend(link->redis_fd, command);
   if (!s.IsOK()) {
-    return s;
+    closeRedisConn(link);
+    return s.Prefixed("failed to send the command of several partitions");
   }
 
-  s = Write(ns, {redis::ArrayOfBulkStrings({"FLUSHDB"})});
-  if (!s.IsOK()) return s;
+  auto error_reply = readReplies(link, 1);
+  if (!error_reply) {
+    closeRedisConn(link);
+    return {Status::NotOK, "read redis response err: " + error_reply.Msg()};
+  }
+  if (!error_reply->empty()) {
+    return {Status::NotOK, "[kvrocks2redis] redis command of several partitions failed: " + *error_reply};
+  }
 
   return Status::OK();
 }
 
 void RedisWriter::Stop() {
-  if (stop_flag_) return;
-
-  stop_flag_ = true;  // Stopping procedure is asynchronous,
+  if (threads_.empty()) return;
 
-  if (t_.joinable()) t_.join();
-  // handled by sync func
-  LOG(INFO) << "[kvrocks2redis] redis_writer Stopped";
-}
-
-void RedisWriter::sync() {
-  for (const auto &iter : config_->tokens) {
-    Status s = readNextOffsetFromFile(iter.first, &next_offsets_[iter.first]);
-    if (!s.IsOK()) {
-      LOG(ERROR) << s.Msg();
-      return;
+  stop_flag_ = true;
+  for (auto &t : threads_) {
+    if (auto s = util::ThreadJoin(t); !s) {
+      LOG(WARNING) << "[kvrocks2redis] Failed to join the redis writer thread: " << s.Msg();
     }
   }
+  threads_.clear();
+  LOG(INFO) << "[kvrocks2redis] redis_writer Stopped";
+}
 
-  size_t chunk_size = 4 * 1024 * 1024;
-  char *buffer = new char[chunk_size];
+void RedisWriter::sync(int partition) {
+  std::string buffer(kChunkSize, '\0');
   while (!stop_flag_) {
-    for (const auto &iter : config_->tokens) {
-      Status s = GetAofFd(iter.first);
-      if (!s.IsOK()) {
-        LOG(ERROR) << s.Msg();
+    bool sent = false;
+    for (const auto &[ns, links] : links_) {
+      if (links.size() <= static_cast<size_t>(partition)) continue;
+
+      auto link = links[partition].get();
+      std::lock_guard<std::mutex> guard(link->mu);
+      auto s = sendAof(link, &buffer);
+      if (!s) {
+        LOG(ERROR) << "[kvrocks2redis] Failed to send the aof of namespace " << ns << ", partition " << partition
+                   << ": " << s.Msg();
         continue;
       }
+      sent = sent || *s;
+    }
 
-      s = getRedisConn(iter.first, iter.second.host, iter.second.port, iter.second.auth, iter.second.db_number);
-      if (!s.IsOK()) {
-        LOG(ERROR) << s.Msg();
-        continue;
-      }
+    if (!sent) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
 
-      while (true) {
-        auto getted_line_leng = pread(aof_fds_[iter.first], buffer, chunk_size, next_offsets_[iter.first]);
-        if (getted_line_leng <= 0) {
-          if (getted_line_leng < 0) {
-            LOG(ERROR) << "ERR read aof file : " << strerror(errno);
-          }
-          break;
-        }
-
-        std::string con = std::string(buffer, getted_line_leng);
-        s = util::SockSend(redis_fds_[iter.first], std::string(buffer, getted_line_leng));
-        if (!s.IsOK()) {
-          LOG(ERROR) << "ERR send data to redis err: " << s.Msg();
-          break;
-        }
-
-        auto line_state = util::SockReadLine(redis_fds_[iter.first]);
-        if (!line_state) {
-          LOG(ERROR) << "read redis response err: " << s.Msg();
-          break;
-        }
-
-        std::string line = *line_state;
-        if (line.compare(0, 1, "-") == 0) {
-          // Ooops, something went wrong , sync process has been terminated, administrator should be notified
-          // when full sync is needed, please remove last_next_seq config file, and restart kvrocks2redis
-          LOG(ERROR) << "[kvrocks2redis] CRITICAL - redis sync return error , administrator confirm needed : " << line;
-          delete[] buffer;
-          Stop();
-          return;
-        }
-
-        s = updateNextOffset(iter.first, next_offsets_[iter.first] + getted_line_leng);
-        if (!s.IsOK()) {
-          LOG(ERROR) << "ERR updating next offset: " << s.Msg();
-          break;
-        }
-      }
-      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  for (const auto &[ns, links] : links_) {
+    if (links.size() <= static_cast<size_t>(partition)) continue;
+
+    auto link = links[partition].get();
+    std::lock_guard<std::mutex> guard(link->mu);
+    if (auto s = checkpoint(link, true); !s.IsOK()) {
+      LOG(ERROR) << "ERR updating next offset: " << s.Msg();
+    }
+  }
+}
+
+// sendAof pipelines the complete commands of the next chunk of the AOF file, and returns whether it sent any
+StatusOr<bool> RedisWriter::sendAof(Link *link, std::string *buffer) {
+  auto read_len = pread(link->aof_fd, buffer->data(), buffer->size(), link->next_offset);
+  if (read_len < 0) return Status::FromErrno("ERR read aof file");
+  if (read_len == 0) return false;
+
+  // a command cut by the end of the chunk is read again with the next chunk
+  std::string_view chunk(buffer->data(), read_len);
+  size_t size = 0, count = 0;
+  while (auto command_size = RESPSize(chunk.substr(size))) {
+    size += command_size;
+    count++;
+  }
+  if (count == 0) {
+    // the command is larger than the chunk, or it's still being written
+    if (static_cast<size_t>(read_len) == buffer->size()) buffer->resize(buffer->size() * 2);
+    return false;
+  }
+
+  auto s = getRedisConn(link);
+  if (!s.IsOK()) return s;
+
+  s = util::SockSend(link->redis_fd, std::string(chunk.substr(0, size)));
+  if (!s.IsOK()) {
+    closeRedisConn(link);
+    return s.Prefixed("ERR send data to redis err");
+  }
+
+  auto error_reply = readReplies(link, count);
+  if (!error_reply) {
+    closeRedisConn(link);
+    return {Status::NotOK, "read redis response err: " + error_reply.Msg()};
+  }
+  if (!error_reply->empty()) {
+    // Ooops, something went wrong , sync process has been terminated, administrator should be notified
+    // when full sync is needed, please remove last_next_seq config file, and restart kvrocks2redis
+    LOG(ERROR) << "[kvrocks2redis] CRITICAL - redis sync return error , administrator confirm needed : "
+               << *error_reply;
+    stop_flag_ = true;
+    return false;
+  }
+
+  link->next_offset += static_cast<std::istream::off_type>(size);
+  s = checkpoint(link, false);
+  if (!s.IsOK()) return s.Prefixed("ERR updating next offset");
+
+  return true;
+}
+
+// readReplies reads the replies of the pipelined commands, and returns the first error reply, or an empty string
+StatusOr<std::string> RedisWriter::readReplies(Link *link, size_t count) {
+  std::string error_reply;
+  auto replies = link->replies.get();
+  while (count > 0) {
+    size_t len = evbuffer_get_length(replies);
+    std::string_view data(len ? reinterpret_cast<const char *>(evbuffer_pullup(replies, -1)) : "", len);
+    size_t size = 0;
+    while (count > 0) {
+      auto reply_size = RESPSize(data.substr(size));
+      if (reply_size == 0) break;
+
+      if (data[size] == '-' && error_reply.empty()) error_reply = data.substr(size, reply_size - 2);
+      size += reply_size;
+      count--;
+    }
+    evbuffer_drain(replies, size);
+
+    if (count > 0 && evbuffer_read(replies, link->redis_fd, -1) <= 0) {
+      return {Status::NotOK, "the connection is closed or broken"};
     }
   }
 
-  delete[] buffer;
+  return error_reply;
 }
 
-Status RedisWriter::getRedisConn(const std::string &ns, const std::string &host, uint32_t port, const std::string &auth,
-                                 int db_index) {
-  auto iter = redis_fds_.find(ns);
-  if (iter == redis_fds_.end()) {
-    redis_fds_[ns] = GET_OR_RET(util::SockConnect(host, port).Prefixed("Failed to connect to redis"));
+Status RedisWriter::getRedisConn(Link *link) {
+  if (link->redis_fd >= 0) return Status::OK();
 
-    if (!auth.empty()) {
-      auto s = authRedis(ns, auth);
-      if (!s.IsOK()) {
-        close(redis_fds_[ns]);
-        redis_fds_.erase(ns);
-        return s;
-      }
+  int fd = GET_OR_RET(util::SockConnect(link->server.host, link->server.port).Prefixed("Failed to connect to redis"));
+  if (!link->server.auth.empty()) {
+    auto s = authRedis(fd, link->server.auth);
+    if (!s.IsOK()) {
+      close(fd);
+      return s;
     }
+  }
 
-    if (db_index != 0) {
-      auto s = selectDB(ns, db_index);
-      if (!s.IsOK()) {
-        close(redis_fds_[ns]);
-        redis_fds_.erase(ns);
-        return s;
-      }
+  if (link->server.db_number != 0) {
+    auto s = selectDB(fd, link->server.db_number);
+    if (!s.IsOK()) {
+      close(fd);
+      return s;
     }
   }
 
+  link->redis_fd = fd;
   return Status::OK();
 }
 
-Status RedisWriter::authRedis(const std::string &ns, const std::string &auth) {
+void RedisWriter::closeRedisConn(Link *link) {
+  // the replies of the broken pipeline are dropped, its commands are sent again by the new connection
+  close(link->redis_fd);
+  link->redis_fd = -1;
+  evbuffer_drain(link->replies.get(), evbuffer_get_length(link->replies.get()));
+}
+
+Status RedisWriter::authRedis(int fd, const std::string &auth) {
   const auto auth_len_str = std::to_string(auth.length());
-  auto s = util::SockSend(redis_fds_[ns], "*2" CRLF "$4" CRLF "auth" CRLF "$" + auth_len_str + CRLF + auth + CRLF);
+  auto s = util::SockSend(fd, "*2" CRLF "$4" CRLF "auth" CRLF "$" + auth_len_str + CRLF + auth + CRLF);
   if (!s.IsOK()) {
     return s.Prefixed("[kvrocks2redis] failed to send AUTH command");
   }
 
-  std::string line = GET_OR_RET(util::SockReadLine(redis_fds_[ns]).Prefixed("read redis auth response err"));
+  std::string line = GET_OR_RET(util::SockReadLine(fd).Prefixed("read redis auth response err"));
   if (line.compare(0, 3, "+OK") != 0) {
     return {Status::NotOK, "[kvrocks2redis] redis Auth failed: " + line};
   }
@@ -201,17 +321,16 @@ Status RedisWriter::authRedis(const std::string &ns, const std::string &auth) {
   return Status::OK();
 }
 
-Status RedisWriter::selectDB(const std::string &ns, int db_number) {
+Status RedisWriter::selectDB(int fd, int db_number) {
   const auto db_number_str = std::to_string(db_number);
   const auto db_number_str_len = std::to_string(db_number_str.length());
-  auto s = util::SockSend(redis_fds_[ns],
-                          "*2" CRLF "$6" CRLF "select" CRLF "$" + db_number_str_len + CRLF + db_number_str + CRLF);
+  auto s = util::SockSend(fd, "*2" CRLF "$6" CRLF "select" CRLF "$" + db_number_str_len + CRLF + db_number_str + CRLF);
   if (!s.IsOK()) {
     return s.Prefixed("failed to send SELECT command to socket");
   }
 
   LOG(INFO) << "[kvrocks2redis] select db request was sent, waiting for response";
-  std::string line = GET_OR_RET(util::SockReadLine(redis_fds_[ns]).Prefixed("read select db response err"));
+  std::string line = GET_OR_RET(util::SockReadLine(fd).Prefixed("read select db response err"));
   if (line.compare(0, 3, "+OK") != 0) {
     return {Status::NotOK, "[kvrocks2redis] redis select db failed: " + line};
   }
@@ -219,39 +338,48 @@ Status RedisWriter::selectDB(const std::string &ns, int db_number) {
   return Status::OK();
 }
 
-Status RedisWriter::updateNextOffset(const std::string &ns, std::istream::off_type offset) {
-  next_offsets_[ns] = offset;
-  return writeNextOffsetToFile(ns, offset);
+// checkpoint saves the offset of the link at most once per checkpoint-interval-ms, unless it's forced
+Status RedisWriter::checkpoint(Link *link, bool force) {
+  auto now = std::chrono::steady_clock::now();
+  if (!force && now - link->last_checkpoint < std::chrono::milliseconds(config_->checkpoint_interval_ms)) {
+    return Status::OK();
+  }
+
+  link->last_checkpoint = now;
+  return writeNextOffsetToFile(link);
 }
 
-Status RedisWriter::readNextOffsetFromFile(const std::string &ns, std::istream::off_type *offset) {
-  next_offset_fds_[ns] = open(getNextOffsetFilePath(ns).data(), O_RDWR | O_CREAT, 0666);
-  if (next_offset_fds_[ns] < 0) {
+Status RedisWriter::readNextOffsetFromFile(Link *link) {
+  link->next_offset_fd = open(getNextOffsetFilePath(link->ns, link->partition).data(), O_RDWR | O_CREAT, 0666);
+  if (link->next_offset_fd < 0) {
     return Status::FromErrno("Failed to open next offset file");
   }
 
-  *offset = 0;
+  link->next_offset = 0;
   // 256 + 1 byte, extra one byte for the ending \0
   char buf[257];
   memset(buf, '\0', sizeof(buf));
-  if (read(next_offset_fds_[ns], buf, sizeof(buf)) > 0) {
-    *offset = std::stoll(buf);
+  if (read(link->next_offset_fd, buf, sizeof(buf)) > 0) {
+    link->next_offset = std::stoll(buf);
   }
+  link->last_checkpoint = std::chrono::steady_clock::now();
 
   return Status::OK();
 }
 
-Status RedisWriter::writeNextOffsetToFile(const std::string &ns, std::istream::off_type offset) {
-  std::string offset_string = std::to_string(offset);
+Status RedisWriter::writeNextOffsetToFile(Link *link) {
+  std::string offset_string = std::to_string(link->next_offset);
   // append to 256 byte (overwrite entire first 21 byte, aka the largest SequenceNumber size )
   int append_byte = 256 - static_cast<int>(offset_string.size());
   while (append_byte-- > 0) {
     offset_string += " ";
   }
   offset_string += '\0';
-  return util::Pwrite(next_offset_fds_[ns], offset_string, 0);
+  return util::Pwrite(link->next_offset_fd, offset_string, 0);
 }
 
-std::string RedisWriter::getNextOffsetFilePath(const std::string &ns) {
-  return config_->output_dir + ns + "_" + config_->next_offset_file_name;
+std::string RedisWriter::getNextOffsetFilePath(const std::string &ns, int partition) {
+  // the first partition keeps the file name from before the partitions
+  if (partition == 0) return config_->output_dir + ns + "_" + config_->next_offset_file_name;
+  return fmt::format("{}{}_{}_{}", config_->output_dir, ns, partition, config_->next_offset_file_name);
 }
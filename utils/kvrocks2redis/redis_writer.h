@@ -22,13 +22,22 @@
 
 #include <glog/logging.h>
 
+#include <atomic>
+#include <chrono>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
+#include <utility>
 #include <vector>
 
+#include "event_util.h"
 #include "writer.h"
 
+// RedisWriter sends the AOF files to the target redis of their namespaces. Each partition of the keys
+// has its own thread, which pipelines the commands of its AOF files to redis by one connection per namespace,
+// so the partitions are sent concurrently while the commands of a key are still applied in order.
 class RedisWriter : public Writer {
  public:
   explicit RedisWriter(kvrocks2redis::Config *config);
@@ -37,26 +46,52 @@ class RedisWriter : public Writer {
   RedisWriter &operator=(const RedisWriter &) = delete;
 
   ~RedisWriter();
-  Status Write(const std::string &ns, const std::vector<std::string> &aofs) override;
   Status FlushDB(const std::string &ns) override;
 
   void Stop() override;
 
+ protected:
+  // WriteBarrier waits until all the partitions of the namespace have sent their AOF files, and sends the command
+  // directly, so like FLUSHDB, it isn't sent again from the AOF files after a restart
+  Status WriteBarrier(const std::string &ns, const std::string &command) override;
+
  private:
-  std::thread t_;
-  bool stop_flag_ = false;
-  std::map<std::string, int> next_offset_fds_;
-  std::map<std::string, std::istream::off_type> next_offsets_;
-  std::map<std::string, int> redis_fds_;
-
-  void sync();
-  Status getRedisConn(const std::string &ns, const std::string &host, uint32_t port, const std::string &auth,
-                      int db_index);
-  Status authRedis(const std::string &ns, const std::string &auth);
-  Status selectDB(const std::string &ns, int db_number);
-
-  Status updateNextOffset(const std::string &ns, std::istream::off_type offset);
-  Status readNextOffsetFromFile(const std::string &ns, std::istream::off_type *offset);
-  Status writeNextOffsetToFile(const std::string &ns, std::istream::off_type offset);
-  std::string getNextOffsetFilePath(const std::string &ns);
+  // Link is the state of sending the AOF file of a partition of a namespace
+  struct Link {
+    std::string ns;
+    int partition;
+    kvrocks2redis::RedisServer server;
+
+    std::mutex mu;
+    int aof_fd = -1;
+    int redis_fd = -1;
+    UniqueEvbuf replies;
+    int next_offset_fd = -1;
+    std::istream::off_type next_offset = 0;
+    std::chrono::steady_clock::time_point last_checkpoint;
+
+    Link(std::string ns, int partition, kvrocks2redis::RedisServer server)
+        : ns(std::move(ns)), partition(partition), server(std::move(server)) {}
+  };
+
+  static constexpr size_t kChunkSize = 4 * 1024 * 1024;
+
+  std::vector<std::thread> threads_;
+  std::atomic<bool> stop_flag_ = false;
+  // the links are created before the threads start, and never changed after that
+  std::map<std::string, std::vector<std::unique_ptr<Link>>> links_;
+
+  void sync(int partition);
+  StatusOr<bool> sendAof(Link *link, std::string *buffer);
+  StatusOr<std::string> readReplies(Link *link, size_t count);
+
+  Status getRedisConn(Link *link);
+  void closeRedisConn(Link *link);
+  static Status authRedis(int fd, const std::string &auth);
+  static Status selectDB(int fd, int db_number);
+
+  Status checkpoint(Link *link, bool force);
+  Status readNextOffsetFromFile(Link *link);
+  Status writeNextOffsetToFile(Link *link);
+  std::string getNextOffsetFilePath(const std::string &ns, int partition);
 };
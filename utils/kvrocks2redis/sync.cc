@@ -27,12 +27,16 @@
 #include <rocksdb/write_batch.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <fstream>
 #include <string>
+#include <thread>
+#include <utility>
 
 #include "event_util.h"
 #include "io_util.h"
 #include "server/redis_reply.h"
+#include "thread_util.h"
 
 void SendStringToEvent(bufferevent *bev, const std::string &data) {
   auto output = bufferevent_get_output(bev);
@@ -69,6 +73,11 @@ void Sync::Start() {
       LOG(ERROR) << s.Msg();
     }
   }
+
+  s = writeNextSeqToFile(next_seq_);
+  if (!s.IsOK()) {
+    LOG(ERROR) << "[kvrocks2redis] Failed to update next sequence: " << s.Msg();
+  }
 }
 
 void Sync::Stop() {
@@ -119,24 +128,29 @@ Status Sync::incrementBatchLoop() {
     }
     if (next_seq_ <= storage_->LatestSeqNumber()) {
       storage_->GetDB()->GetUpdatesSince(next_seq_, &iter);
-      for (; iter->Valid(); iter->Next()) {
-        auto batch = iter->GetBatch();
-        if (batch.sequence != next_seq_) {
-          if (next_seq_ > batch.sequence) {
-            LOG(ERROR) << "checkWALBoundary with sequence: " << next_seq_
-                       << ", but GetWALIter return older sequence: " << batch.sequence;
+      while (iter->Valid() && !IsStopped()) {
+        Status wal_status;
+        std::vector<std::unique_ptr<rocksdb::WriteBatch>> batches;
+        size_t window_bytes = 0;
+        auto seq = next_seq_;
+        for (; iter->Valid() && batches.size() < kMaxWindowBatches && window_bytes < kMaxWindowBytes; iter->Next()) {
+          auto batch = iter->GetBatch();
+          if (batch.sequence != seq) {
+            if (seq > batch.sequence) {
+              LOG(ERROR) << "checkWALBoundary with sequence: " << seq
+                         << ", but GetWALIter return older sequence: " << batch.sequence;
+            }
+            wal_status = {Status::NotOK};
+            break;
           }
-          return {Status::NotOK};
-        }
-        auto s = parser_->ParseWriteBatch(batch.writeBatchPtr->Data());
-        if (!s.IsOK()) {
-          return s.Prefixed(
-              fmt::format("failed to parse write batch '{}'", util::StringToHex(batch.writeBatchPtr->Data())));
-        }
-        s = updateNextSeq(next_seq_ + batch.writeBatchPtr->Count());
-        if (!s.IsOK()) {
-          return s.Prefixed("failed to update next sequence");
+          seq += batch.writeBatchPtr->Count();
+          window_bytes += batch.writeBatchPtr->GetDataSize();
+          batches.push_back(std::move(batch.writeBatchPtr));
         }
+
+        auto s = parseBatches(batches);
+        if (!s.IsOK()) return s;
+        if (!wal_status.IsOK()) return wal_status;
       }
     } else {
       usleep(10000);
@@ -145,6 +159,57 @@ Status Sync::incrementBatchLoop() {
   return Status::OK();
 }
 
+Status Sync::parseBatches(const std::vector<std::unique_ptr<rocksdb::WriteBatch>> &batches) {
+  std::vector<std::map<std::string, std::vector<std::string>>> commands(batches.size());
+  std::vector<Status> statuses(batches.size());
+  auto threads = std::min(static_cast<size_t>(config_->parse_threads), batches.size());
+  auto extract = [&](size_t first) {
+    for (size_t i = first; i < batches.size(); i += threads) {
+      auto res = parser_->ExtractWriteBatch(batches[i]->Data());
+      if (res) {
+        commands[i] = std::move(*res);
+      } else {
+        statuses[i] = std::move(res).ToStatus();
+      }
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (size_t first = 1; first < threads; first++) {
+    auto t = util::CreateThread("k2r-parser", [&extract, first] { extract(first); });
+    if (t) {
+      workers.push_back(std::move(*t));
+    } else {
+      LOG(WARNING) << "[kvrocks2redis] Failed to create parser thread: " << t.Msg();
+      extract(first);
+    }
+  }
+  extract(0);
+  for (auto &t : workers) {
+    if (auto s = util::ThreadJoin(t); !s) {
+      LOG(WARNING) << "[kvrocks2redis] Failed to join parser thread: " << s.Msg();
+    }
+  }
+
+  // the commands are written in the order of the WAL, so the commands of a key are kept in order
+  for (size_t i = 0; i < batches.size(); i++) {
+    if (!statuses[i].IsOK()) {
+      return statuses[i].Prefixed(
+          fmt::format("failed to parse write batch '{}'", util::StringToHex(batches[i]->Data())));
+    }
+
+    auto s = parser_->WriteCommands(commands[i]);
+    if (!s.IsOK()) return s;
+
+    s = updateNextSeq(next_seq_ + batches[i]->Count());
+    if (!s.IsOK()) {
+      return s.Prefixed("failed to update next sequence");
+    }
+  }
+
+  return Status::OK();
+}
+
 void Sync::parseKVFromLocalStorage() {
   LOG(INFO) << "[kvrocks2redis] Start parsing kv from the local storage";
   for (const auto &iter : config_->tokens) {
@@ -162,14 +227,22 @@ void Sync::parseKVFromLocalStorage() {
     return;
   }
   auto last_seq = storage_->GetDB()->GetLatestSequenceNumber();
-  s = updateNextSeq(last_seq + 1);
+  s = updateNextSeq(last_seq + 1, true);
   if (!s.IsOK()) {
     LOG(ERROR) << "[kvrocks2redis] Failed to update next sequence: " << s.Msg();
   }
 }
 
-Status Sync::updateNextSeq(rocksdb::SequenceNumber seq) {
+// updateNextSeq saves the next sequence at most once per checkpoint-interval-ms, unless it's forced
+Status Sync::updateNextSeq(rocksdb::SequenceNumber seq, bool force) {
   next_seq_ = seq;
+
+  auto now = std::chrono::steady_clock::now();
+  if (!force && now - last_checkpoint_ < std::chrono::milliseconds(config_->checkpoint_interval_ms)) {
+    return Status::OK();
+  }
+
+  last_checkpoint_ = now;
   return writeNextSeqToFile(seq);
 }
 
@@ -23,7 +23,12 @@
 #include <event2/bufferevent.h>
 #include <unistd.h>
 
+#include <chrono>
 #include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
 
 #include "cluster/replication.h"
 #include "config.h"
@@ -53,6 +58,12 @@ class Sync {
   kvrocks2redis::Config *config_ = nullptr;
   int next_seq_fd_;
   rocksdb::SequenceNumber next_seq_ = static_cast<rocksdb::SequenceNumber>(0);
+  std::chrono::steady_clock::time_point last_checkpoint_;
+
+  // The WAL batches are read by windows, the batches of a window are extracted by parse-threads threads
+  // at the same time, and their commands are written in the order of the WAL after that
+  static constexpr size_t kMaxWindowBatches = 1024;
+  static constexpr size_t kMaxWindowBytes = 64 * 1024 * 1024;
 
   // Internal states managed by IncrementBatchLoop procedure
   enum IncrementBatchLoopState {
@@ -61,13 +72,14 @@ class Sync {
   } incr_state_ = Incr_batch_size;
 
   Status incrementBatchLoop();
+  Status parseBatches(const std::vector<std::unique_ptr<rocksdb::WriteBatch>> &batches);
 
   Status tryCatchUpWithPrimary();
   Status checkWalBoundary();
 
   void parseKVFromLocalStorage();
 
-  Status updateNextSeq(rocksdb::SequenceNumber seq);
+  Status updateNextSeq(rocksdb::SequenceNumber seq, bool force = false);
   Status readNextSeqFromFile(rocksdb::SequenceNumber *seq);
   Status writeNextSeqToFile(rocksdb::SequenceNumber seq) const;
 };
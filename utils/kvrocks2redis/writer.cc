@@ -21,11 +21,47 @@
 #include "writer.h"
 
 #include <fcntl.h>
+#include <fmt/format.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cstring>
 
+#include "cluster/redis_slot.h"
 #include "io_util.h"
+#include "parse_util.h"
+#include "server/redis_reply.h"
+#include "string_util.h"
+
+namespace {
+
+// commandArg returns the argument of the command at the index, or an empty string if there isn't one
+std::string_view commandArg(std::string_view command, size_t index) {
+  auto eol = command.find(CRLF);
+  if (command.empty() || command[0] != '*' || eol == std::string_view::npos) return {};
+
+  size_t pos = eol + 2;
+  for (size_t i = 0; pos < command.size() && command[pos] == '$'; i++) {
+    auto size = Writer::RESPSize(command.substr(pos));
+    if (size == 0) return {};
+    if (i == index) {
+      auto begin = command.find(CRLF, pos) + 2;
+      return command.substr(begin, pos + size - 2 - begin);
+    }
+    pos += size;
+  }
+  return {};
+}
+
+// commandArgCount returns the number of the arguments of the command, including its name
+size_t commandArgCount(std::string_view command) {
+  auto eol = command.find(CRLF);
+  if (command.empty() || command[0] != '*' || eol == std::string_view::npos) return 0;
+  auto count = ParseInt<int64_t>(std::string(command.substr(1, eol - 1)), 10);
+  return count && *count > 0 ? static_cast<size_t>(*count) : 0;
+}
+
+}  // namespace
 
 Writer::~Writer() {
   for (const auto &iter : aof_fds_) {
@@ -34,47 +70,119 @@ Writer::~Writer() {
 }
 
 Status Writer::Write(const std::string &ns, const std::vector<std::string> &aofs) {
-  GET_OR_RET(GetAofFd(ns));
+  // the commands of a partition are appended by one write, until a command of several partitions
+  std::map<int, std::string> partitions;
+  auto flush = [&]() -> Status {
+    for (const auto &[partition, data] : partitions) {
+      GET_OR_RET(GetAofFd(ns, partition));
+      GET_OR_RET(util::Write(aof_fds_[{ns, partition}], data));
+    }
+    partitions.clear();
+    return Status::OK();
+  };
+
   for (const auto &aof : aofs) {
-    GET_OR_RET(util::Write(aof_fds_[ns], aof));
+    auto partition = Partition(aof);
+    if (partition >= 0) {
+      partitions[partition] += aof;
+      continue;
+    }
+    GET_OR_RET(flush());
+    GET_OR_RET(WriteBarrier(ns, aof));
   }
 
-  return Status::OK();
+  return flush();
+}
+
+Status Writer::WriteBarrier(const std::string &ns, const std::string &command) {
+  GET_OR_RET(GetAofFd(ns, 0));
+  return util::Write(aof_fds_[{ns, 0}], command);
 }
 
 Status Writer::FlushDB(const std::string &ns) {
-  GET_OR_RET(GetAofFd(ns, true));
+  for (int partition = 0; partition < config_->redis_connections; partition++) {
+    GET_OR_RET(GetAofFd(ns, partition, true));
+  }
 
   return Status::OK();
 }
 
-Status Writer::GetAofFd(const std::string &ns, bool truncate) {
-  auto aof_fd = aof_fds_.find(ns);
+Status Writer::GetAofFd(const std::string &ns, int partition, bool truncate) {
+  auto aof_fd = aof_fds_.find({ns, partition});
   if (aof_fd == aof_fds_.end()) {
-    return OpenAofFile(ns, truncate);
+    return OpenAofFile(ns, partition, truncate);
   } else if (truncate) {
-    close(aof_fds_[ns]);
-    return OpenAofFile(ns, truncate);
+    close(aof_fd->second);
+    return OpenAofFile(ns, partition, truncate);
   }
-  if (aof_fds_[ns] < 0) {
+  if (aof_fd->second < 0) {
     return Status::FromErrno("Failed to open aof file:");
   }
   return Status::OK();
 }
 
-Status Writer::OpenAofFile(const std::string &ns, bool truncate) {
+Status Writer::OpenAofFile(const std::string &ns, int partition, bool truncate) {
   int openmode = O_RDWR | O_CREAT | O_APPEND;
   if (truncate) {
     openmode |= O_TRUNC;
   }
-  aof_fds_[ns] = open(GetAofFilePath(ns).data(), openmode, 0666);
-  if (aof_fds_[ns] < 0) {
+  auto &aof_fd = aof_fds_[{ns, partition}];
+  aof_fd = open(GetAofFilePath(ns, partition).data(), openmode, 0666);
+  if (aof_fd < 0) {
     return Status::FromErrno("Failed to open aof file:");
   }
 
   return Status::OK();
 }
 
-std::string Writer::GetAofFilePath(const std::string &ns) {
-  return config_->output_dir + ns + "_" + config_->aof_file_name;
+std::string Writer::GetAofFilePath(const std::string &ns, int partition) {
+  // the first partition keeps the file name from before the partitions
+  if (partition == 0) return config_->output_dir + ns + "_" + config_->aof_file_name;
+  return fmt::format("{}{}_{}_{}", config_->output_dir, ns, partition, config_->aof_file_name);
+}
+
+int Writer::Partition(std::string_view command) const {
+  if (config_->redis_connections <= 1) return 0;
+
+  // LMOVE has a source and a destination, and BITOP has a destination after the operation and then the sources
+  auto name = commandArg(command, 0);
+  size_t first = 1, last = 1;
+  if (util::EqualICase(name, "LMOVE")) {
+    last = 2;
+  } else if (util::EqualICase(name, "BITOP")) {
+    first = 2;
+    last = std::max<size_t>(commandArgCount(command), first + 1) - 1;
+  }
+
+  int partition = -1;
+  for (size_t i = first; i <= last; i++) {
+    auto key = commandArg(command, i);
+    int key_partition = static_cast<int>(GetSlotIdFromKey(key) % config_->redis_connections);
+    if (partition >= 0 && key_partition != partition) return -1;
+    partition = key_partition;
+  }
+  return partition;
+}
+
+size_t Writer::RESPSize(std::string_view data) {
+  auto eol = data.find(CRLF);
+  if (eol == std::string_view::npos) return 0;
+
+  size_t size = eol + 2;
+  if (data[0] != '$' && data[0] != '*') return size;
+
+  auto len = ParseInt<int64_t>(std::string(data.substr(1, eol - 1)), 10);
+  if (!len || *len < 0) return size;
+
+  if (data[0] == '$') {
+    size += static_cast<size_t>(*len) + 2;
+    return data.size() >= size ? size : 0;
+  }
+
+  for (int64_t i = 0; i < *len; i++) {
+    auto elem_size = RESPSize(data.substr(size));
+    if (elem_size == 0) return 0;
+    size += elem_size;
+  }
+  return size;
 }
@@ -23,6 +23,8 @@
 #include <fstream>
 #include <map>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 #include "config.h"
@@ -36,14 +38,27 @@ class Writer {
   Writer &operator=(const Writer &) = delete;
 
   ~Writer();
-  virtual Status Write(const std::string &ns, const std::vector<std::string> &aofs);
+  // Write appends the commands to the AOF files of their partitions, the commands of a partition are kept in order.
+  // A command of the keys in several partitions is written by WriteBarrier after the commands before it.
+  Status Write(const std::string &ns, const std::vector<std::string> &aofs);
   virtual Status FlushDB(const std::string &ns);
   virtual void Stop() {}
-  Status OpenAofFile(const std::string &ns, bool truncate);
-  Status GetAofFd(const std::string &ns, bool truncate = false);
-  std::string GetAofFilePath(const std::string &ns);
+  Status OpenAofFile(const std::string &ns, int partition, bool truncate);
+  Status GetAofFd(const std::string &ns, int partition, bool truncate = false);
+  std::string GetAofFilePath(const std::string &ns, int partition);
+
+  // Partition returns the partition of the command by the slot of its keys, in [0, redis-connections),
+  // or -1 if the keys are in several partitions, e.g. LMOVE or BITOP
+  int Partition(std::string_view command) const;
+  // RESPSize returns the size of the first RESP value of the data, or 0 if it isn't complete
+  static size_t RESPSize(std::string_view data);
 
  protected:
+  // WriteBarrier writes a command of the keys in several partitions, so that it's applied after the commands
+  // written before it, and before the commands written after it, in all the partitions. A plain AOF file
+  // only has a partition, and the command is appended to the first one.
+  virtual Status WriteBarrier(const std::string &ns, const std::string &command);
+
   kvrocks2redis::Config *config_ = nullptr;
-  std::map<std::string, int> aof_fds_;
+  std::map<std::pair<std::string, int>, int> aof_fds_;
 };
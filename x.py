@@ -112,8 +112,8 @@ def prepare() -> None:
             dst.symlink_to(hook)
             print(f"{hook.name} installed at {dst}.")
 
-def build(dir: str, jobs: Optional[int], ghproxy: bool, ninja: bool, unittest: bool, compiler: str, cmake_path: str, D: List[str],
-          skip_build: bool) -> None:
+def build(dir: str, jobs: Optional[int], ghproxy: bool, ninja: bool, unittest: bool, benchmark: bool, compiler: str,
+          cmake_path: str, D: List[str], skip_build: bool) -> None:
     basedir = Path(__file__).parent.absolute()
 
     find_command("autoconf", msg="autoconf is required to build jemalloc")
@@ -136,6 +136,8 @@ def build(dir: str, jobs: Optional[int], ghproxy: bool, ninja: bool, unittest: b
         cmake_options += ["-DCMAKE_C_COMPILER=gcc", "-DCMAKE_CXX_COMPILER=g++"]
     elif compiler == 'clang':
         cmake_options += ["-DCMAKE_C_COMPILER=clang", "-DCMAKE_CXX_COMPILER=clang++"]
+    if benchmark:
+        cmake_options.append("-DENABLE_BENCHMARK=ON")
     if D:
         cmake_options += [f"-D{o}" for o in D]
 
@@ -147,6 +149,8 @@ def build(dir: str, jobs: Optional[int], ghproxy: bool, ninja: bool, unittest: b
     target = ["kvrocks", "kvrocks2redis"]
     if unittest:
         target.append("unittest")
+    if benchmark:
+        target += ["kvrocks_bench", "kvrocks_storage_bench", "kvrocks_vector_bench"]
 
     options = ["--build", "."]
     if jobs is not None:
@@ -378,6 +382,7 @@ if __name__ == '__main__':
                               help='use https://mirror.ghproxy.com to fetch dependencies')
     parser_build.add_argument('--ninja', default=False, action='store_true', help='use Ninja to build kvrocks')
     parser_build.add_argument('--unittest', default=False, action='store_true', help='build unittest target')
+    parser_build.add_argument('--benchmark', default=False, action='store_true', help='build kvrocks_bench, kvrocks_storage_bench and kvrocks_vector_bench targets')
     parser_build.add_argument('--compiler', default='auto', choices=('auto', 'gcc', 'clang'),
                               help="compiler used to build kvrocks")
     parser_build.add_argument('--cmake-path', default='cmake', help="path of cmake binary used to build kvrocks")